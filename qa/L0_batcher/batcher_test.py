@@ -213,9 +213,8 @@ class BatcherTest(unittest.TestCase):
         # Send two requests with sum of static batch sizes ==
         # preferred size, but with different shapes (using model with
         # variable-size tensors). This should cause the requests to
-        # not be batched. The first response will come back
-        # immediately and the second delayed by the max batch queue
-        # delay
+        # not be batched. Each shape forms its own batch and so both
+        # responses are delayed by the max batch queue delay.
         for trial in _trials:
             try:
                 url = "localhost:8000"
@@ -227,7 +226,8 @@ class BatcherTest(unittest.TestCase):
 
                 threads = []
                 threads.append(threading.Thread(target=self.check_response,
-                                                args=(trial, 1, (3000, None)),
+                                                args=(trial, 1,
+                                                      (_max_queue_delay_ms * 1.5, _max_queue_delay_ms)),
                                                 kwargs={'input_size': 16,
                                                 'shm_region_names': ['ip00', 'ip01', 'op00', 'op01']}))
                 threads.append(threading.Thread(target=self.check_response,
@@ -282,9 +282,10 @@ class BatcherTest(unittest.TestCase):
     def test_multi_batch_not_preferred_different_shape(self):
         # Send two requests with total static batch size in between
         # preferred sizes. Then send a request with a different shape
-        # and a non-preferred batch size. This should cause the first
-        # two requests to be immediately responded to and the third
-        # response to be delayed by the max batch queue delay.
+        # and a non-preferred batch size. The different shape does not
+        # interrupt the batch being formed for the first two requests
+        # so all responses should be delayed by the max batch queue
+        # delay.
         for trial in _trials:
             try:
                 url = "localhost:8000"
@@ -296,10 +297,12 @@ class BatcherTest(unittest.TestCase):
 
                 threads = []
                 threads.append(threading.Thread(target=self.check_response,
-                                                args=(trial, 1, (3000, None)),
+                                                args=(trial, 1,
+                                                      (_max_queue_delay_ms * 1.5, _max_queue_delay_ms)),
                                                 kwargs={'shm_region_names': ['ip00', 'ip01', 'op00', 'op01']}))
                 threads.append(threading.Thread(target=self.check_response,
-                                                args=(trial, 3, (3000, None)),
+                                                args=(trial, 3,
+                                                      (_max_queue_delay_ms * 1.5, _max_queue_delay_ms)),
                                                 kwargs={'shm_region_names': ['ip10', 'ip11', 'op10', 'op11']}))
                 threads.append(threading.Thread(target=self.check_response,
                                                 args=(trial, 1,
@@ -320,11 +323,10 @@ class BatcherTest(unittest.TestCase):
     def test_multi_batch_preferred_different_shape(self):
         # Send two requests with total static batch size in between
         # preferred sizes. Then send a request with a different shape
-        # and a non-preferred batch size. This should cause the first
-        # two requests to be immediately responded to. Send a forth
-        # request with the same shape as the third that causes a
-        # preferred size so that third and forth response are sent
-        # immediately.
+        # and a non-preferred batch size. The first two requests wait
+        # for the max batch queue delay. Send a forth request with the
+        # same shape as the third that causes a preferred size so
+        # that third and forth response are sent immediately.
         for trial in _trials:
             try:
                 url = "localhost:8000"
@@ -361,6 +363,47 @@ class BatcherTest(unittest.TestCase):
             except InferenceServerException as ex:
                 self.assertTrue(False, "unexpected error {}".format(ex))
 
+    def test_multi_batch_interleaved_different_shape(self):
+        # Send four requests alternating between two different shapes
+        # such that each shape sums to a preferred size. Each shape
+        # forms its own batch and so the interleaving should not break
+        # up the batches and all responses are sent immediately.
+        for trial in _trials:
+            try:
+                url = "localhost:8000"
+                protocol = ProtocolType.HTTP
+                model_name = tu.get_model_name(trial, np.float32, np.float32, np.float32)
+
+                self.check_setup(url, protocol, model_name)
+                self.assertFalse("TRTSERVER_DELAY_SCHEDULER" in os.environ)
+
+                threads = []
+                threads.append(threading.Thread(target=self.check_response,
+                                                args=(trial, 1, (3000, None)),
+                                                kwargs={'input_size': 16,
+                                                'shm_region_names': ['ip00', 'ip01', 'op00', 'op01']}))
+                threads.append(threading.Thread(target=self.check_response,
+                                                args=(trial, 1, (3000, None)),
+                                                kwargs={'input_size': 8,
+                                                'shm_region_names': ['ip10', 'ip11', 'op10', 'op11']}))
+                threads.append(threading.Thread(target=self.check_response,
+                                                args=(trial, 1, (3000, None)),
+                                                kwargs={'input_size': 16,
+                                                'shm_region_names': ['ip20', 'ip21', 'op20', 'op21']}))
+                threads.append(threading.Thread(target=self.check_response,
+                                                args=(trial, 1, (3000, None)),
+                                                kwargs={'input_size': 8,
+                                                'shm_region_names': ['ip30', 'ip31', 'op30', 'op31']}))
+                for t in threads:
+                    t.start()
+                    time.sleep(0.2)
+                for t in threads:
+                    t.join()
+                self.check_deferred_exception()
+                self.check_status(url, protocol, model_name, (1,), 2, 4)
+            except InferenceServerException as ex:
+                self.assertTrue(False, "unexpected error {}".format(ex))
+
     def test_multi_batch_gt_max_preferred(self):
         # Send two requests with first not having preferred size and
         # second being larger than max preferred size. Delay the
@@ -603,10 +646,10 @@ class BatcherTest(unittest.TestCase):
         # and a non-preferred batch size. Use
         # TRTSERVER_DELAY_SCHEDULER in the environment so that
         # requests can be queued up before scheduler starts
-        # servicing. This should cause the first two requests to be
-        # immediately responded to. Send a forth request with the same
-        # shape as the third that causes a preferred size so that
-        # third and forth response are sent immediately.
+        # servicing. The first two requests wait for the max batch
+        # queue delay. Send a forth request with the same shape as the
+        # third that causes a preferred size so that third and forth
+        # response are sent immediately.
         for trial in _trials:
             try:
                 url = "localhost:8000"
@@ -621,10 +664,12 @@ class BatcherTest(unittest.TestCase):
 
                 threads = []
                 threads.append(threading.Thread(target=self.check_response,
-                                                args=(trial, 1, (3000, None)),
+                                                args=(trial, 1,
+                                                      (_max_queue_delay_ms * 1.5, _max_queue_delay_ms - 2000)),
                                                 kwargs={'shm_region_names': ['ip00', 'ip01', 'op00', 'op01']}))
                 threads.append(threading.Thread(target=self.check_response,
-                                                args=(trial, 3, (3000, None)),
+                                                args=(trial, 3,
+                                                      (_max_queue_delay_ms * 1.5, _max_queue_delay_ms - 2000)),
                                                 kwargs={'shm_region_names': ['ip10', 'ip11', 'op10', 'op11']}))
                 threads.append(threading.Thread(target=self.check_response,
                                                 args=(trial, 1, (3000, None)),
@@ -170,6 +170,7 @@ export BATCHER_TYPE=VARIABLE
 for i in \
         test_multi_batch_not_preferred_different_shape \
         test_multi_batch_preferred_different_shape \
+        test_multi_batch_interleaved_different_shape \
         test_multi_batch_different_shape ; do
     SERVER_ARGS="--model-repository=`pwd`/var_models"
     SERVER_LOG="./$i.VARIABLE.serverlog"
@@ -27,6 +27,7 @@
 
 SIMPLE_CLIENT=../clients/simple_client
 TRACE_SUMMARY=../common/trace_summary.py
+TRACE_CONVERT=../common/trace_convert.py
 
 SERVER=/opt/tensorrtserver/bin/trtserver
 source ../common/util.sh
@@ -213,6 +214,156 @@ fi
 
 set -e
 
+# trace-rate == 1, trace-level=MAX, trace-format=BINARY make sure
+# every request is traced and the binary trace converts to the JSON
+# and Chrome trace formats
+SERVER_ARGS="--trace-file=trace_binary.bin --trace-level=MAX --trace-rate=1 --trace-format=BINARY --model-repository=`pwd`/models"
+SERVER_LOG="./inference_server_binary.log"
+run_server
+if [ "$SERVER_PID" == "0" ]; then
+    echo -e "\n***\n*** Failed to start $SERVER\n***"
+    cat $SERVER_LOG
+    exit 1
+fi
+
+set +e
+
+for p in {1..10}; do
+    $SIMPLE_CLIENT >> client_binary.log 2>&1
+    if [ $? -ne 0 ]; then
+        RET=1
+    fi
+
+    $SIMPLE_CLIENT -i grpc -u localhost:8001 >> client_binary.log 2>&1
+    if [ $? -ne 0 ]; then
+        RET=1
+    fi
+done
+
+set -e
+
+kill $SERVER_PID
+wait $SERVER_PID
+
+set +e
+
+$TRACE_CONVERT -o trace_binary.log trace_binary.bin
+if [ $? -ne 0 ]; then
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+
+$TRACE_SUMMARY -t trace_binary.log > summary_binary.log
+
+if [ `grep -c "compute input end" summary_binary.log` != "20" ]; then
+    cat summary_binary.log
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+
+if [ `grep -c ^simple summary_binary.log` != "20" ]; then
+    cat summary_binary.log
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+
+$TRACE_CONVERT -f chrome -o trace_binary.json trace_binary.bin
+if [ $? -ne 0 ]; then
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+
+python -c "import json; assert len(json.load(open('trace_binary.json'))['traceEvents']) > 0"
+if [ $? -ne 0 ]; then
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+
+set -e
+
+# trace-rate == 1000, trace-tail-latency=simple:0 make sure every
+# request slower than the threshold is traced regardless of the
+# sampling rate
+SERVER_ARGS="--trace-file=trace_tail_all.log --trace-level=MIN --trace-rate=1000 --trace-tail-latency=simple:0 --model-repository=`pwd`/models"
+SERVER_LOG="./inference_server_tail_all.log"
+run_server
+if [ "$SERVER_PID" == "0" ]; then
+    echo -e "\n***\n*** Failed to start $SERVER\n***"
+    cat $SERVER_LOG
+    exit 1
+fi
+
+set +e
+
+for p in {1..10}; do
+    $SIMPLE_CLIENT >> client_tail_all.log 2>&1
+    if [ $? -ne 0 ]; then
+        RET=1
+    fi
+
+    $SIMPLE_CLIENT -i grpc -u localhost:8001 >> client_tail_all.log 2>&1
+    if [ $? -ne 0 ]; then
+        RET=1
+    fi
+done
+
+set -e
+
+kill $SERVER_PID
+wait $SERVER_PID
+
+set +e
+
+$TRACE_SUMMARY -t trace_tail_all.log > summary_tail_all.log
+
+if [ `grep -c ^simple summary_tail_all.log` != "20" ]; then
+    cat summary_tail_all.log
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+
+set -e
+
+# trace-rate == 1000, trace-tail-latency=simple:60000000 make sure no
+# successful request faster than the threshold is traced
+SERVER_ARGS="--trace-file=trace_tail_none.log --trace-level=MIN --trace-rate=1000 --trace-tail-latency=simple:60000000 --model-repository=`pwd`/models"
+SERVER_LOG="./inference_server_tail_none.log"
+run_server
+if [ "$SERVER_PID" == "0" ]; then
+    echo -e "\n***\n*** Failed to start $SERVER\n***"
+    cat $SERVER_LOG
+    exit 1
+fi
+
+set +e
+
+for p in {1..10}; do
+    $SIMPLE_CLIENT >> client_tail_none.log 2>&1
+    if [ $? -ne 0 ]; then
+        RET=1
+    fi
+
+    $SIMPLE_CLIENT -i grpc -u localhost:8001 >> client_tail_none.log 2>&1
+    if [ $? -ne 0 ]; then
+        RET=1
+    fi
+done
+
+set -e
+
+kill $SERVER_PID
+wait $SERVER_PID
+
+set +e
+
+if [ -s ./trace_tail_none.log ]; then
+    cat trace_tail_none.log
+    echo -e "\n***\n*** Test Failed, unexpected traces in trace_tail_none.log\n***"
+    RET=1
+fi
+
+set -e
+
 if [ $RET -eq 0 ]; then
     echo -e "\n***\n*** Test Passed\n***"
 else
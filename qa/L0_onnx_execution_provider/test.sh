@@ -38,11 +38,12 @@ fi
 DATADIR=/data/inferenceserver/${REPO_VERSION}
 
 SERVER=/opt/tensorrtserver/bin/trtserver
-SERVER_ARGS="--model-repository=`pwd`/models --log-verbose=1 --exit-on-error=false"
+SERVER_ARGS="--model-repository=`pwd`/models --log-verbose=1 --exit-on-error=false --tensorrt-engine-cache-dir=`pwd`/engine_cache"
 SERVER_LOG="./inference_server.log"
 source ../common/util.sh
 
 rm -f ./*.log
+rm -fr engine_cache && mkdir -p engine_cache
 rm -fr models && mkdir -p models && \
     cp -r $DATADIR/onnx_model_store/resnet50 \
        models/resnet50_def && \
@@ -59,6 +60,13 @@ rm -fr models && mkdir -p models && \
                 config.pbtxt && \
             echo "optimization { execution_accelerators { gpu_execution_accelerator : [ { name : \"tensorrt\"} ] } }" >> config.pbtxt && \
             echo "instance_group [ { gpus: [0] } ]" >> config.pbtxt) && \
+    # TensorRT execution accelerator with parameters
+    cp -r models/resnet50_def models/resnet50_trt_fp16 && \
+    (cd models/resnet50_trt_fp16 && \
+            sed -i 's/^name: "resnet50_def"/name: "resnet50_trt_fp16"/' \
+                config.pbtxt && \
+            echo "optimization { execution_accelerators { gpu_execution_accelerator : [ { name : \"tensorrt\" parameters { key: \"precision_mode\" value: \"FP16\" } parameters { key: \"max_workspace_size_bytes\" value: \"1073741824\" } } ] } }" >> config.pbtxt && \
+            echo "instance_group [ { gpus: [0] } ]" >> config.pbtxt) && \
     # CPU execution accelerators
     cp -r models/resnet50_def models/resnet50_openvino && \
     (cd models/resnet50_openvino && \
@@ -106,6 +114,16 @@ if [ $? -ne 0 ]; then
     RET=1
 fi
 
+grep "TensorRT Execution Accelerator is set for resnet50_trt_fp16" $SERVER_LOG
+if [ $? -ne 0 ]; then
+    echo -e "\n***\n*** Failed. Expected TensorRT Execution Accelerator is set\n***"
+    RET=1
+fi
+if [ -z "$(ls -A engine_cache/onnxruntime/resnet50_trt_fp16/1)" ]; then
+    echo -e "\n***\n*** Failed. Expected TensorRT engines are cached\n***"
+    RET=1
+fi
+
 
 grep "OpenVINO Execution Accelerator is set for resnet50_openvino" $SERVER_LOG
 if [ $? -ne 0 ]; then
@@ -45,7 +45,8 @@ SERVER_ARGS=--model-repository=$DATADIR
 SERVER_LOG="./inference_server.log"
 source ../common/util.sh
 
-rm -f $SERVER_LOG $CLIENT_LOG
+rm -f $SERVER_LOG $CLIENT_LOG $CLIENT_LOG.worker request_intervals workload \
+    trace report.json metrics.log
 
 RET=0
 
@@ -69,6 +70,293 @@ if [ $(cat $CLIENT_LOG | grep ": 0 infer/sec\|: 0 usec" | wc -l) -ne 0 ]; then
     echo -e "\n***\n*** Test Failed\n***"
     RET=1
 fi
+if [ $(cat $CLIENT_LOG | grep "p99 latency: .* usec (corrected .* usec)" | wc -l) -eq 0 ]; then
+    cat $CLIENT_LOG
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+set -e
+
+# Inputs and outputs in system shared memory, with both protocols
+for PROTOCOL in grpc http; do
+    if [ "$PROTOCOL" == "grpc" ]; then
+        URL=localhost:8001
+    else
+        URL=localhost:8000
+    fi
+    set +e
+    $PERF_CLIENT -v -i $PROTOCOL -u $URL -m graphdef_int32_int32_int32 -t 2 \
+        --shared-memory system -p2000 -b 1 >$CLIENT_LOG 2>&1
+    if [ $? -ne 0 ]; then
+        cat $CLIENT_LOG
+        echo -e "\n***\n*** Test Failed\n***"
+        RET=1
+    fi
+    if [ $(cat $CLIENT_LOG | grep ": 0 infer/sec\|: 0 usec" | wc -l) -ne 0 ]; then
+        cat $CLIENT_LOG
+        echo -e "\n***\n*** Test Failed\n***"
+        RET=1
+    fi
+    set -e
+done
+
+# Request rate mode with each request distribution
+printf "5000\n15000\n10000\n" > request_intervals
+for RATE_ARGS in "--request-rate-range 50:100:50" \
+                 "--request-rate-range 50 --request-distribution poisson" \
+                 "--request-intervals request_intervals"; do
+    set +e
+    $PERF_CLIENT -v -i grpc -u localhost:8001 -m graphdef_int32_int32_int32 \
+        $RATE_ARGS -p2000 -b 1 >$CLIENT_LOG 2>&1
+    if [ $? -ne 0 ]; then
+        cat $CLIENT_LOG
+        echo -e "\n***\n*** Test Failed\n***"
+        RET=1
+    fi
+    if [ $(cat $CLIENT_LOG | grep ": 0 infer/sec\|: 0 usec" | wc -l) -ne 0 ]; then
+        cat $CLIENT_LOG
+        echo -e "\n***\n*** Test Failed\n***"
+        RET=1
+    fi
+    if [ $(cat $CLIENT_LOG | grep "^Request Rate: " | wc -l) -eq 0 ]; then
+        cat $CLIENT_LOG
+        echo -e "\n***\n*** Test Failed\n***"
+        RET=1
+    fi
+    set -e
+done
+
+# Binary search for the knee point, with a latency limit that the
+# highest load stays within
+set +e
+$PERF_CLIENT -v -i grpc -u localhost:8001 -m graphdef_int32_int32_int32 \
+    --binary-search -t 1 -c 8 -l 10000 -p2000 -b 1 >$CLIENT_LOG 2>&1
+if [ $? -ne 0 ]; then
+    cat $CLIENT_LOG
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+if [ $(cat $CLIENT_LOG | grep "^Knee point: Concurrency 8," | wc -l) -ne 1 ]; then
+    cat $CLIENT_LOG
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+$PERF_CLIENT -v -i grpc -u localhost:8001 -m graphdef_int32_int32_int32 \
+    --binary-search --request-rate-range 50:200:50 -l 10000 -p2000 -b 1 \
+    >$CLIENT_LOG 2>&1
+if [ $? -ne 0 ]; then
+    cat $CLIENT_LOG
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+if [ $(cat $CLIENT_LOG | grep "^Knee point: Request Rate 200," | wc -l) -ne 1 ]; then
+    cat $CLIENT_LOG
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+# Binary search requires a latency limit
+$PERF_CLIENT -v -i grpc -u localhost:8001 -m graphdef_int32_int32_int32 \
+    --binary-search -t 1 -c 8 -p2000 -b 1 >$CLIENT_LOG 2>&1
+if [ $? -eq 0 ]; then
+    cat $CLIENT_LOG
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+set -e
+
+# Request rate mode can't be combined with a concurrency
+set +e
+$PERF_CLIENT -v -i grpc -u localhost:8001 -m graphdef_int32_int32_int32 \
+    --request-rate-range 50 -t 2 -p2000 -b 1 >$CLIENT_LOG 2>&1
+if [ $? -eq 0 ]; then
+    cat $CLIENT_LOG
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+set -e
+
+# Mixed workload of several models at the same time
+cat > workload <<EOF
+# model                          load
+graphdef_int32_int32_int32       weight=3
+graphdef_nobatch_int32_int32_int32 concurrency=1
+savedmodel_int32_int32_int32     rate=50 distribution=poisson
+EOF
+set +e
+$PERF_CLIENT -v -i grpc -u localhost:8001 --workload workload -t 4 \
+    -p2000 >$CLIENT_LOG 2>&1
+if [ $? -ne 0 ]; then
+    cat $CLIENT_LOG
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+if [ $(cat $CLIENT_LOG | grep "^Model: " | wc -l) -ne 3 ]; then
+    cat $CLIENT_LOG
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+if [ $(cat $CLIENT_LOG | grep ": 0 infer/sec\|: 0 usec" | wc -l) -ne 0 ]; then
+    cat $CLIENT_LOG
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+set -e
+
+# A workload can't be combined with a single model
+set +e
+$PERF_CLIENT -v -i grpc -u localhost:8001 --workload workload \
+    -m graphdef_int32_int32_int32 -p2000 >$CLIENT_LOG 2>&1
+if [ $? -eq 0 ]; then
+    cat $CLIENT_LOG
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+set -e
+
+# Replay a recorded trace of two models at twice the recorded speed, the
+# correlation IDs are ignored for models without sequence batcher
+cat > trace <<EOF
+# time (usec),model,batch size,correlation ID,input
+1000000,graphdef_int32_int32_int32,4
+1000000,graphdef_nobatch_int32_int32_int32,1,7
+1100000,graphdef_int32_int32_int32,1
+1150000,graphdef_nobatch_int32_int32_int32,1,7
+1150000,graphdef_int32_int32_int32,2,0,INPUT0:16;INPUT1:16
+1600000,graphdef_int32_int32_int32,8
+2000000,graphdef_nobatch_int32_int32_int32,1,7
+EOF
+set +e
+$PERF_CLIENT -v -i grpc -u localhost:8001 --trace trace --trace-speed 2 \
+    >$CLIENT_LOG 2>&1
+if [ $? -ne 0 ]; then
+    cat $CLIENT_LOG
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+if [ $(cat $CLIENT_LOG | grep "^Model: graphdef_int32_int32_int32 (4 requests)" | wc -l) -ne 1 ]; then
+    cat $CLIENT_LOG
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+if [ $(cat $CLIENT_LOG | grep "Request count: 3$" | wc -l) -ne 1 ]; then
+    cat $CLIENT_LOG
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+set -e
+
+# A trace request with a batch size larger than the model allows must fail
+echo "0,graphdef_nobatch_int32_int32_int32,2" > trace
+set +e
+$PERF_CLIENT -v -i grpc -u localhost:8001 --trace trace >$CLIENT_LOG 2>&1
+if [ $? -eq 0 ]; then
+    cat $CLIENT_LOG
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+set -e
+
+# Generate the load from two perf_client processes, a worker and the
+# coordinator that profiles the model
+set +e
+$PERF_CLIENT -i grpc -u localhost:8001 -m graphdef_int32_int32_int32 \
+    --worker-port 9900 >$CLIENT_LOG.worker 2>&1 &
+WORKER_PID=$!
+sleep 2
+$PERF_CLIENT -v -i grpc -u localhost:8001 -m graphdef_int32_int32_int32 \
+    --workers localhost:9900 -t 4 -p2000 >$CLIENT_LOG 2>&1
+if [ $? -ne 0 ]; then
+    cat $CLIENT_LOG
+    cat $CLIENT_LOG.worker
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+wait $WORKER_PID
+if [ $? -ne 0 ]; then
+    cat $CLIENT_LOG.worker
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+if [ $(cat $CLIENT_LOG | grep "this host and 1 workers" | wc -l) -ne 1 ]; then
+    cat $CLIENT_LOG
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+if [ $(cat $CLIENT_LOG | grep ": 0 infer/sec\|: 0 usec" | wc -l) -ne 0 ]; then
+    cat $CLIENT_LOG
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+set -e
+
+# A worker set for a different batch size rejects the coordinator
+set +e
+$PERF_CLIENT -i grpc -u localhost:8001 -m graphdef_int32_int32_int32 -b 2 \
+    --worker-port 9900 >$CLIENT_LOG.worker 2>&1 &
+WORKER_PID=$!
+sleep 2
+$PERF_CLIENT -v -i grpc -u localhost:8001 -m graphdef_int32_int32_int32 \
+    --workers localhost:9900 -t 4 -p2000 >$CLIENT_LOG 2>&1
+if [ $? -eq 0 ]; then
+    cat $CLIENT_LOG
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+wait $WORKER_PID
+set -e
+
+# Write the report in JSON with the GPU metrics of the server, every
+# measurement window and the server side statistic must be included
+set +e
+$PERF_CLIENT -v -i grpc -u localhost:8001 -m graphdef_int32_int32_int32 -t 2 \
+    -p2000 --json report.json --metrics-url localhost:8002/metrics \
+    >$CLIENT_LOG 2>&1
+if [ $? -ne 0 ]; then
+    cat $CLIENT_LOG
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+python -c "
+import json, sys
+m = json.load(open('report.json'))['models'][0]['measurements'][0]
+sys.exit(0 if (len(m['windows']) >= 3) and (len(m['gpus']) > 0) and
+         (m['server']['request_count'] > 0) and
+         ('p99' in m['client']['latency_us']) else 1)" >>$CLIENT_LOG 2>&1
+if [ $? -ne 0 ]; then
+    cat $CLIENT_LOG
+    cat report.json
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
+set -e
+
+# The requests made so far are recorded in the latency histograms and
+# the scheduler metrics, the compute time is broken down into its
+# input, infer and output parts, and the CPU time of the scheduler
+# threads is reported for the model
+set +e
+curl -s localhost:8002/metrics >metrics.log 2>&1
+for M in request compute queue; do
+    if [ $(cat metrics.log | grep "^nv_inference_${M}_latency_us_bucket{.*model=\"graphdef_int32_int32_int32\"" | wc -l) -eq 0 ]; then
+        cat metrics.log
+        echo -e "\n***\n*** Test Failed\n***"
+        RET=1
+    fi
+done
+for M in nv_inference_queue_length nv_inference_inflight_executions nv_inference_exec_batch_size_bucket \
+         nv_inference_compute_input_duration_us nv_inference_compute_infer_duration_us \
+         nv_inference_compute_output_duration_us nv_cpu_thread_time_us; do
+    if [ $(cat metrics.log | grep "^${M}{.*model=\"graphdef_int32_int32_int32\"" | wc -l) -eq 0 ]; then
+        cat metrics.log
+        echo -e "\n***\n*** Test Failed\n***"
+        RET=1
+    fi
+done
+if [ $(cat metrics.log | grep "^nv_cpu_memory_resident_bytes " | wc -l) -eq 0 ]; then
+    cat metrics.log
+    echo -e "\n***\n*** Test Failed\n***"
+    RET=1
+fi
 set -e
 
 # Test perf client behavior on different model with different batch size
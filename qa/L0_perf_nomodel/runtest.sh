@@ -42,6 +42,7 @@ INSTANCE_COUNTS=${INSTANCE_COUNTS:=1}
 CONCURRENCY=${CONCURRENCY:=1}
 
 PERF_CLIENT=../clients/perf_client
+PERF_INPROCESS=/opt/tensorrtserver/bin/perf_inprocess
 PERF_CLIENT_PROTOCOL=${PERF_CLIENT_PROTOCOL:=grpc}
 PERF_CLIENT_PERCENTILE=${PERF_CLIENT_PERCENTILE:=95}
 PERF_CLIENT_STABILIZE_WINDOW=${PERF_CLIENT_STABILIZE_WINDOW:=5000}
@@ -112,6 +113,25 @@ for BACKEND in $BACKENDS; do
                 echo "dynamic_batching { preferred_batch_size: [ ${DYNAMIC_BATCH} ] }" >> config.pbtxt)
     fi
 
+    # The "inprocess" protocol measures the server through the C API
+    # without a separate server process, so there is no network
+    # overhead and no metrics endpoint.
+    if [ $PERF_CLIENT_PROTOCOL == "inprocess" ]; then
+        set +e
+        $PERF_INPROCESS -v \
+                 --model-repository=`pwd`/models \
+                 -p${PERF_CLIENT_STABILIZE_WINDOW} \
+                 -s${PERF_CLIENT_STABILIZE_THRESHOLD} \
+                 ${PERF_CLIENT_PERCENTILE_ARGS} -m ${MODEL_NAME} \
+                 -b${STATIC_BATCH} -t${CONCURRENCY} \
+                 -f ${RESULTDIR}/${NAME}.csv >> ${RESULTDIR}/${NAME}.log 2>&1
+        if (( $? != 0 )); then
+            RET=1
+        fi
+        set -e
+        continue
+    fi
+
     SERVER_LOG="${RESULTDIR}/${NAME}.serverlog"
     run_server
     if (( $SERVER_PID == 0 )); then
@@ -0,0 +1,197 @@
+#!/usr/bin/python
+
+# Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+
+import argparse
+import csv
+import json
+import os
+import re
+import sys
+
+FLAGS = None
+CONCURRENCY = "Concurrency"
+INFERPERSEC = "Inferences/Second"
+P99LATENCY = "p99 latency"
+
+# Results are collected into subdirectories named for the protocol
+# and concurrency, each with one CSV per backend and batch size as
+# written by L0_perf_nomodel/runtest.sh.
+RESULT_DIR_RE = re.compile(r'^(\w+)_concurrency(\d+)$')
+RESULT_CSV_RE = re.compile(r'^([a-z]+)_sbatch(\d+)_instance(\d+)\.csv$')
+
+def result_key(backend, protocol, batch, concurrency):
+    return "{}/{}/batch{}/concurrency{}".format(backend, protocol, batch,
+                                               concurrency)
+
+def read_csv_row(path, concurrency):
+    """
+    Return a map from CSV heading to value for the row of the given
+    concurrency, or None if there is no such row.
+    """
+    with open(path, "r") as csv_file:
+        csv_reader = csv.reader(csv_file, delimiter=',')
+        header_row = None
+        for row in csv_reader:
+            if header_row is None:
+                header_row = row
+            elif (len(row) > 0) and (int(row[0]) == concurrency):
+                return dict(zip(header_row, row))
+
+    return None
+
+def collect(path):
+    """
+    Create a map from result key to the throughput and p99 latency of
+    every CSV under 'path'.
+    """
+    results = dict()
+    for subdir in sorted(os.listdir(path)):
+        dir_match = RESULT_DIR_RE.match(subdir)
+        if (dir_match is None) or not os.path.isdir(os.path.join(path, subdir)):
+            continue
+
+        protocol = dir_match.group(1)
+        concurrency = int(dir_match.group(2))
+        for f in sorted(os.listdir(os.path.join(path, subdir))):
+            csv_match = RESULT_CSV_RE.match(f)
+            if csv_match is None:
+                continue
+
+            row = read_csv_row(os.path.join(path, subdir, f), concurrency)
+            if (row is None) or (INFERPERSEC not in row) or (P99LATENCY not in row):
+                print("warning: no results for concurrency {} in {}".format(
+                    concurrency, os.path.join(subdir, f)))
+                continue
+
+            key = result_key(csv_match.group(1), protocol,
+                             int(csv_match.group(2)), concurrency)
+            results[key] = {
+                "instance_count" : int(csv_match.group(3)),
+                "throughput" : float(row[INFERPERSEC]),
+                "p99_latency_us" : float(row[P99LATENCY]) }
+
+    return results
+
+def compare(baseline, results):
+    """
+    Compare results against the baseline and return the number of
+    regressions. Throughput may drop, and p99 latency may rise, by
+    the baseline's tolerance, as a percentage, before a result is a
+    regression. An entry of the baseline can override the tolerances.
+    """
+    tolerance = baseline.get("tolerance", dict())
+    baseline_results = baseline.get("results", dict())
+
+    regressions = 0
+    print("{:<44}{:>14}{:>14}{:>10}".format("", "baseline", "undertest", "delta"))
+    for key in sorted(results.keys()):
+        result = results[key]
+        if key not in baseline_results:
+            print("{:<44}{:>14}{:>14.0f}".format(key + " infer/sec", "<none>",
+                                                 result["throughput"]))
+            continue
+
+        base = baseline_results[key]
+        entry_tolerance = dict(tolerance)
+        entry_tolerance.update(base.get("tolerance", dict()))
+
+        # Throughput regresses when it drops, latency when it rises.
+        for name, label, higher_is_better in (
+                ("throughput", "infer/sec", True),
+                ("p99_latency_us", "p99 usec", False)):
+            if (base.get(name, 0) == 0) or (result[name] == 0):
+                continue
+
+            delta = ((result[name] / base[name]) - 1.0) * 100.0
+            slowdown = -delta if higher_is_better else delta
+            allowed = entry_tolerance.get(name, 0.0)
+            status = ""
+            if slowdown > allowed:
+                status = "  REGRESSION (> {}%)".format(allowed)
+                regressions += 1
+
+            print("{:<44}{:>14.0f}{:>14.0f}{:>9.2f}%{}".format(
+                key + " " + label, base[name], result[name], delta, status))
+
+    for key in sorted(baseline_results.keys()):
+        if key not in results:
+            print("warning: no under-test result for baseline {}".format(key))
+
+    return regressions
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--results', type=str, required=True,
+                        help='Path to the directory containing the CSV results ' +
+                        'being analyzed.')
+    parser.add_argument('--output', type=str, required=False,
+                        help='Write the collected results to this JSON file.')
+    parser.add_argument('--baseline', type=str, required=False,
+                        help='JSON baseline to compare the results against. ' +
+                        'Exits with an error if any result regresses.')
+    parser.add_argument('--update-baseline', action="store_true", required=False,
+                        default=False,
+                        help='Replace the results in the baseline with the ' +
+                        'collected results, keeping its tolerances, instead ' +
+                        'of comparing against it.')
+
+    FLAGS = parser.parse_args()
+
+    results = collect(FLAGS.results)
+    if len(results) == 0:
+        print("error: no results found in {}".format(FLAGS.results))
+        sys.exit(1)
+
+    if FLAGS.output is not None:
+        with open(FLAGS.output, "w") as output_file:
+            json.dump(results, output_file, indent=2, sort_keys=True)
+
+    if FLAGS.baseline is None:
+        sys.exit(0)
+
+    baseline = dict()
+    if os.path.exists(FLAGS.baseline):
+        with open(FLAGS.baseline, "r") as baseline_file:
+            baseline = json.load(baseline_file)
+
+    if FLAGS.update_baseline:
+        previous = baseline.get("results", dict())
+        for key, result in results.items():
+            if (key in previous) and ("tolerance" in previous[key]):
+                result["tolerance"] = previous[key]["tolerance"]
+        baseline["results"] = results
+        with open(FLAGS.baseline, "w") as baseline_file:
+            json.dump(baseline, baseline_file, indent=2, sort_keys=True)
+            baseline_file.write("\n")
+        sys.exit(0)
+
+    print("Baseline: {}".format(baseline.get("name", FLAGS.baseline)))
+    print("Tolerances: {}".format(baseline.get("tolerance", dict())))
+    regressions = compare(baseline, results)
+    if regressions > 0:
+        print("\n{} regression(s) against the baseline".format(regressions))
+        sys.exit(1)
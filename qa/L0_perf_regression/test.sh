@@ -0,0 +1,131 @@
+#!/bin/bash
+# Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+REPO_VERSION=${NVIDIA_TENSORRT_SERVER_VERSION}
+if [ "$#" -ge 1 ]; then
+    REPO_VERSION=$1
+fi
+if [ -z "$REPO_VERSION" ]; then
+    echo -e "Repository version must be specified"
+    echo -e "\n***\n*** Test Failed\n***"
+    exit 1
+fi
+
+# Baseline to compare against. Set UPDATE_BASELINE=1 to replace its
+# results with the results collected here instead.
+BASELINE=${BASELINE:=baseline/perf_baseline.json}
+UPDATE_BASELINE=${UPDATE_BASELINE:=0}
+
+# The fixed matrix of backend x protocol x batch size x
+# concurrency. Concurrency 1 measures latency with a single instance,
+# higher concurrency measures throughput with several instances.
+BACKENDS=${BACKENDS:="plan custom graphdef savedmodel onnx libtorch netdef"}
+PROTOCOLS=${PROTOCOLS:="grpc http"}
+BATCH_SIZES=${BATCH_SIZES:="1 8"}
+CONCURRENCIES=(1 8)
+INSTANCE_COUNTS=(1 4)
+
+# Confidence percentile, window and threshold used to stabilize the
+# results, as in L0_perf_nomodel.
+PERF_CLIENT_PERCENTILE=${PERF_CLIENT_PERCENTILE:=95}
+PERF_CLIENT_STABILIZE_WINDOW=5000
+PERF_CLIENT_STABILIZE_THRESHOLD=5.0
+
+RUNTEST=../L0_perf_nomodel/runtest.sh
+ANALYZE=./perf_regression.py
+RESULTS_JSON=${REPO_VERSION}.json
+ANALYZE_LOG=${REPO_VERSION}.analysis
+
+rm -fr ${REPO_VERSION} ${RESULTS_JSON} ${ANALYZE_LOG}
+mkdir -p ${REPO_VERSION}
+
+#
+# Data Collection
+#
+
+RET=0
+set +e
+
+for PROTOCOL in $PROTOCOLS; do
+    for idx in "${!CONCURRENCIES[@]}"; do
+        CONCURRENCY=${CONCURRENCIES[$idx]}
+        INSTANCE_COUNT=${INSTANCE_COUNTS[$idx]}
+
+        RESULTNAME="${PROTOCOL} concurrency ${CONCURRENCY}" \
+                  RESULTDIR=${REPO_VERSION}/${PROTOCOL}_concurrency${CONCURRENCY} \
+                  PERF_CLIENT_PERCENTILE=${PERF_CLIENT_PERCENTILE} \
+                  PERF_CLIENT_STABILIZE_WINDOW=${PERF_CLIENT_STABILIZE_WINDOW} \
+                  PERF_CLIENT_STABILIZE_THRESHOLD=${PERF_CLIENT_STABILIZE_THRESHOLD} \
+                  PERF_CLIENT_PROTOCOL=${PROTOCOL} \
+                  TENSOR_SIZE=1 \
+                  BACKENDS=${BACKENDS} \
+                  STATIC_BATCH_SIZES=${BATCH_SIZES} \
+                  DYNAMIC_BATCH_SIZES=1 \
+                  INSTANCE_COUNTS=${INSTANCE_COUNT} \
+                  CONCURRENCY=${CONCURRENCY} \
+                  bash -x ${RUNTEST} ${REPO_VERSION}
+        if (( $? != 0 )); then
+            RET=1
+        fi
+    done
+done
+
+set -e
+
+if (( $RET != 0 )); then
+    echo -e "\n***\n*** Data Collection FAILED\n***"
+    exit $RET
+fi
+
+#
+# Analyze
+#
+
+set +e
+
+if (( $UPDATE_BASELINE != 0 )); then
+    $ANALYZE --results=${REPO_VERSION} --output=${RESULTS_JSON} \
+             --baseline=${BASELINE} --update-baseline >> ${ANALYZE_LOG} 2>&1
+else
+    $ANALYZE --results=${REPO_VERSION} --output=${RESULTS_JSON} \
+             --baseline=${BASELINE} >> ${ANALYZE_LOG} 2>&1
+fi
+if (( $? != 0 )); then
+    RET=1
+fi
+
+set -e
+
+cat ${ANALYZE_LOG}
+
+if (( $RET == 0 )); then
+    echo -e "\n***\n*** Test Passed\n***"
+else
+    echo -e "\n***\n*** Test FAILED\n***"
+fi
+
+exit $RET
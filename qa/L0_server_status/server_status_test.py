@@ -97,6 +97,32 @@ class ServerStatusTest(unittest.TestCase):
             self.assertTrue(
                 ex.message().startswith("no status available for unknown model"))
 
+    def test_model_memory_usage(self):
+        # A TensorRT model accounts the GPU memory of its engine,
+        # activations and bindings, a GraphDef model doesn't.
+        try:
+            for pair in [("localhost:8000", ProtocolType.HTTP), ("localhost:8001", ProtocolType.GRPC)]:
+                model_name = "plan_float32_float32_float32"
+                server_status0, req_id0 = _get_server_status(pair[0], pair[1], model_name)
+                for v, version_status in iteritems(server_status0.model_status[model_name].version_status):
+                    if version_status.ready_state != server_status.MODEL_READY:
+                        continue
+                    self.assertGreater(len(version_status.memory_usage), 0,
+                                       "expected memory usage for model " + model_name)
+                    for usage in version_status.memory_usage:
+                        self.assertGreaterEqual(usage.device_id, 0)
+                        self.assertGreater(usage.model_byte_size, 0)
+                        self.assertGreater(usage.io_byte_size, 0)
+
+                model_name = "graphdef_float32_float32_float32"
+                server_status1, req_id1 = _get_server_status(pair[0], pair[1], model_name)
+                for v, version_status in iteritems(server_status1.model_status[model_name].version_status):
+                    self.assertEqual(len(version_status.memory_usage), 0,
+                                     "unexpected memory usage for model " + model_name)
+
+        except InferenceServerException as ex:
+            self.assertTrue(False, "unexpected error {}".format(ex))
+
     def test_model_latest_infer(self):
         input_size = 16
         tensor_shape = (input_size,)
@@ -55,6 +55,20 @@ except Exception as ex:
 
 # unregister after register
 shared_memory_ctx.unregister(shm_op0_handle)
+
+# A numpy view of the region sees the values set in the region and
+# writes directly into the region
+shm_view = shm.get_contents_as_numpy(shm_op0_handle, np.int32, [2])
+assert shm_view[0] == 1
+shm_view[1] = 3
+assert shm.get_contents_as_numpy(shm_op0_handle, np.int32, [1], 4)[0] == 3
+
+# Raises error if the view exceeds the region
+try:
+    shm.get_contents_as_numpy(shm_op0_handle, np.int32, [2], 4)
+except Exception as ex:
+    assert "exceeds the shared memory region" in str(ex)
+del shm_view
 shm.destroy_shared_memory_region(shm_op0_handle)
 
 shm_op0_handle = shm.create_shared_memory_region("output0_data", "/output0", 64)
@@ -27,6 +27,7 @@
 
 SIMPLE_CALLBACK_CLIENT=../clients/simple_callback_client
 SIMPLE_CALLBACK_CLIENT_PY=../clients/simple_callback_client.py
+SIMPLE_ASYNCIO_CLIENT_PY=../clients/simple_asyncio_client.py
 
 CLIENT_LOG="./client.log"
 
@@ -63,6 +64,21 @@ if [ $? -ne 0 ]; then
     RET=1
 fi
 
+python $SIMPLE_ASYNCIO_CLIENT_PY -v >>$CLIENT_LOG 2>&1
+if [ $? -ne 0 ]; then
+    RET=1
+fi
+
+python $SIMPLE_ASYNCIO_CLIENT_PY -u localhost:8001 -i grpc -v >>$CLIENT_LOG 2>&1
+if [ $? -ne 0 ]; then
+    RET=1
+fi
+
+python $SIMPLE_ASYNCIO_CLIENT_PY -u localhost:8001 -i grpc -s -v >>$CLIENT_LOG 2>&1
+if [ $? -ne 0 ]; then
+    RET=1
+fi
+
 set -e
 
 kill $SERVER_PID
@@ -27,6 +27,7 @@
 
 SIMPLE_CLIENT=../clients/simple_sequence_client
 SIMPLE_CLIENT_PY=../clients/simple_sequence_client.py
+PERF_CLIENT=../clients/perf_client
 
 CLIENT_LOG="./client.log"
 
@@ -35,7 +36,7 @@ SERVER_ARGS=--model-repository=`pwd`/models
 SERVER_LOG="./inference_server.log"
 source ../common/util.sh
 
-rm -f $CLIENT_LOG $SERVER_LOG
+rm -f $CLIENT_LOG $CLIENT_LOG.perf $SERVER_LOG
 
 run_server
 if [ "$SERVER_PID" == "0" ]; then
@@ -78,6 +79,18 @@ if [ $? -ne 0 ]; then
     RET=1
 fi
 
+# Many more live sequences than requests in flight
+$PERF_CLIENT -v -i grpc -u localhost:8001 -m simple_sequence -t 4 \
+    --num-of-sequences 200 --sequence-length 5 -p2000 >$CLIENT_LOG.perf 2>&1
+if [ $? -ne 0 ]; then
+    cat $CLIENT_LOG.perf
+    RET=1
+fi
+if [ $(cat $CLIENT_LOG.perf | grep "Sequence step latency: p50" | wc -l) -eq 0 ]; then
+    cat $CLIENT_LOG.perf
+    RET=1
+fi
+
 set -e
 
 kill $SERVER_PID
@@ -27,6 +27,8 @@
 
 SIMPLE_SHM_CLIENT=../clients/simple_shm_client
 SIMPLE_SHM_CLIENT_PY=../clients/simple_shm_client.py
+SIMPLE_CUDA_SHM_CLIENT=../clients/simple_cuda_shm_client
+SIMPLE_CUDA_SHM_CLIENT_PY=../clients/simple_cuda_shm_client.py
 
 SERVER=/opt/tensorrtserver/bin/trtserver
 SERVER_ARGS=--model-repository=`pwd`/models
@@ -67,6 +69,21 @@ if [ $? -ne 0 ]; then
     RET=1
 fi
 
+# Run using CUDA shared memory for both inputs and outputs (GRPC
+# only). The CUDA clients are only built when the clients are built
+# with TRTIS_ENABLE_CLIENT_GPU.
+if [ -f $SIMPLE_CUDA_SHM_CLIENT ]; then
+    $SIMPLE_CUDA_SHM_CLIENT -v >>client_cuda_c++.log 2>&1
+    if [ $? -ne 0 ]; then
+        RET=1
+    fi
+
+    python $SIMPLE_CUDA_SHM_CLIENT_PY -v >>client_cuda_py.log 2>&1
+    if [ $? -ne 0 ]; then
+        RET=1
+    fi
+fi
+
 if [ `grep -c "localhost:8000" client_c++.log` != "10" ]; then
     echo -e "\n***\n*** Failed. Expected 10 Host: localhost:8000 headers for C++ client\n***"
     RET=1
@@ -38,7 +38,7 @@ fi
 DATADIR=/data/inferenceserver/${REPO_VERSION}
 
 SERVER=/opt/tensorrtserver/bin/trtserver
-SERVER_ARGS="--model-repository=`pwd`/models --log-verbose=1 --exit-on-error=false"
+SERVER_ARGS="--model-repository=`pwd`/models --log-verbose=1 --exit-on-error=false --tensorrt-engine-cache-dir=`pwd`/engine_cache"
 SERVER_LOG="./inference_server.log"
 source ../common/util.sh
 
@@ -48,6 +48,7 @@ for MODEL in \
         graphdef_float32_float32_float32 \
         savedmodel_float32_float32_float32; do
     rm -f ./*.log
+    rm -fr engine_cache && mkdir -p engine_cache
     rm -fr models && mkdir -p models
     cp -r $DATADIR/qa_model_repository/${MODEL} \
        models/${MODEL}_def && \
@@ -175,10 +176,41 @@ for MODEL in \
         RET=1
     fi
 
+    # Only GraphDef models cache the converted graph
+    if [[ $MODEL == graphdef* ]]; then
+        if [ -z "$(ls -A engine_cache/tensorflow/${MODEL}_trt/1)" ]; then
+            echo -e "\n***\n*** Failed. Expected TF-TRT converted graph is cached\n***"
+            RET=1
+        fi
+    fi
+
     set -e
 
     kill $SERVER_PID
     wait $SERVER_PID
+
+    # A restart loads the converted graph from the cache
+    if [[ $MODEL == graphdef* ]]; then
+        run_server_tolive
+        if [ "$SERVER_PID" == "0" ]; then
+            echo -e "\n***\n*** Failed to start $SERVER\n***"
+            cat $SERVER_LOG
+            exit 1
+        fi
+
+        set +e
+
+        grep "Loaded TF-TRT converted graph from cache" $SERVER_LOG
+        if [ $? -ne 0 ]; then
+            echo -e "\n***\n*** Failed. Expected TF-TRT converted graph is loaded from cache\n***"
+            RET=1
+        fi
+
+        set -e
+
+        kill $SERVER_PID
+        wait $SERVER_PID
+    fi
 done
 
 if [ $RET -eq 0 ]; then
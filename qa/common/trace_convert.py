@@ -0,0 +1,147 @@
+#!/usr/bin/python
+
+# Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+import argparse
+import json
+import argparse
+import json
+import struct
+import sys
+
+FLAGS = None
+
+# A binary trace file, written by trtserver --trace-format=BINARY,
+# starts with an 8 byte magic and a uint32 version followed by the
+# trace records. All values are little-endian. A record is:
+#
+#   uint32 record byte size, not including this field
+#   int64  model version
+#   uint32 model name length, followed by the model name
+#   uint32 timestamp count
+#   for each timestamp:
+#     uint32 name length, followed by the name
+#     uint64 timestamp in nanoseconds
+MAGIC = b'TRTISTRC'
+VERSION = 1
+
+# Spans shown in the Chrome trace, as (name, start timestamp, end
+# timestamp).
+CHROME_SPANS = (
+    ("http recv", "http recv start", "http recv end"),
+    ("http send", "http send start", "http send end"),
+    ("grpc wait/read", "grpc wait/read start", "grpc wait/read end"),
+    ("grpc send", "grpc send start", "grpc send end"),
+    ("request handler", "request handler start", "request handler end"),
+    ("queue", "queue start", "compute start"),
+    ("compute", "compute start", "compute end"),
+    ("compute input", "compute start", "compute input end"),
+    ("compute infer", "compute input end", "compute output start"),
+    ("compute output", "compute output start", "compute end"),
+)
+
+def read_string(data, offset):
+    (length,) = struct.unpack_from('<I', data, offset)
+    offset += 4
+    return data[offset:offset + length].decode('utf-8'), offset + length
+
+def read_traces(data):
+    if data[:len(MAGIC)] != MAGIC:
+        raise ValueError('not a binary trace file')
+    (version,) = struct.unpack_from('<I', data, len(MAGIC))
+    if version != VERSION:
+        raise ValueError('unsupported binary trace version {}'.format(version))
+
+    traces = list()
+    offset = len(MAGIC) + 4
+    while offset < len(data):
+        (size,) = struct.unpack_from('<I', data, offset)
+        offset += 4
+        end = offset + size
+        if end > len(data):
+            raise ValueError('truncated trace record at offset {}'.format(offset))
+
+        (model_version,) = struct.unpack_from('<q', data, offset)
+        model_name, offset = read_string(data, offset + 8)
+        (cnt,) = struct.unpack_from('<I', data, offset)
+        offset += 4
+
+        timestamps = list()
+        for _ in range(cnt):
+            name, offset = read_string(data, offset)
+            (ns,) = struct.unpack_from('<Q', data, offset)
+            offset += 8
+            timestamps.append({"name" : name, "ns" : ns})
+
+        traces.append({"timestamps" : timestamps,
+                       "model_name" : model_name,
+                       "model_version" : model_version})
+        offset = end
+
+    return traces
+
+def to_chrome(traces):
+    # Each trace is shown as its own thread of the model's process so
+    # that the spans of concurrent requests don't overlap.
+    events = list()
+    for tid, trace in enumerate(traces):
+        pid = "{} ({})".format(trace["model_name"], trace["model_version"])
+        timestamps = dict()
+        for ts in trace["timestamps"]:
+            timestamps[ts["name"]] = ts["ns"]
+
+        for name, start, end in CHROME_SPANS:
+            if (start in timestamps) and (end in timestamps) and \
+               (timestamps[end] >= timestamps[start]):
+                events.append({"name" : name, "ph" : "X",
+                               "pid" : pid, "tid" : tid,
+                               "ts" : timestamps[start] / 1000.0,
+                               "dur" : (timestamps[end] - timestamps[start]) / 1000.0})
+
+    return {"traceEvents" : events, "displayTimeUnit" : "ns"}
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(
+        description='Convert a binary trtserver trace file to JSON.')
+    parser.add_argument('-f', '--format', choices=['json', 'chrome'], default='json',
+                        help='Output the trtserver JSON trace format, which ' +
+                        'trace_summary.py reads, or the Chrome trace event ' +
+                        'format for chrome://tracing. Default is json.')
+    parser.add_argument('-o', '--output', type=str, required=False, default=None,
+                        help='Output file. Default is stdout.')
+    parser.add_argument('file', type=str, help='Binary trace file')
+    FLAGS = parser.parse_args()
+
+    with open(FLAGS.file, 'rb') as f:
+        traces = read_traces(f.read())
+
+    result = traces if FLAGS.format == 'json' else to_chrome(traces)
+    if FLAGS.output is None:
+        json.dump(result, sys.stdout)
+    else:
+        with open(FLAGS.output, 'w') as f:
+            json.dump(result, f)
@@ -235,6 +235,9 @@ NetDefBackend::CreateExecutionContext(
         ModelSequenceBatching::Control::CONTROL_SEQUENCE_START, &input_names));
     RETURN_IF_ERROR(ValidateSequenceControl(
         ModelSequenceBatching::Control::CONTROL_SEQUENCE_READY, &input_names));
+    for (const auto& state : Config().sequence_batching().state()) {
+      input_names.push_back(state.input_name());
+    }
   }
 
   try {
@@ -366,13 +369,18 @@ NetDefBackend::Context::SetFixedSizedInputTensor(
     const std::string& name, const std::vector<int64_t>& shape,
     const Caffe2Workspace::DataType dtype, const size_t batch1_byte_size,
     const size_t total_byte_size, std::vector<Scheduler::Payload>* payloads,
-    std::vector<std::unique_ptr<char[]>>* input_buffers, bool* cuda_copy)
+    bool* cuda_copy)
 {
   // The entire input tensor must be delivered as a single
-  // contiguous chunk so create a buffer large enough to hold the
-  // entire dynamic batched input.
-  input_buffers->emplace_back(new char[total_byte_size]);
-  char* buffer = input_buffers->back().get();
+  // contiguous chunk so use the memory of the workspace tensor,
+  // which is kept from one execution to the next, to hold the entire
+  // dynamic batched input.
+  char* buffer = nullptr;
+  Caffe2Workspace::Error err = workspace_->GetInputTensorBuffer(
+      name, shape, dtype, total_byte_size, &buffer);
+  if (!err.IsOk()) {
+    return Status(RequestStatusCode::INTERNAL, err.Message());
+  }
 
   // Visit the payloads in order and copy the input tensors to
   // 'buffer'.
@@ -387,12 +395,6 @@ NetDefBackend::Context::SetFixedSizedInputTensor(
   *cuda_copy |= SetInputBuffer(
       name, expected_byte_sizes, payloads, TRTSERVER_MEMORY_CPU, buffer);
 
-  Caffe2Workspace::Error err = workspace_->SetInputTensor(
-      name, shape, dtype, static_cast<const char*>(buffer), total_byte_size);
-  if (!err.IsOk()) {
-    return Status(RequestStatusCode::INTERNAL, err.Message());
-  }
-
   return Status::Success;
 }
 
@@ -456,7 +458,7 @@ Status
 NetDefBackend::Context::SetInput(
     const std::string& name, const DataType datatype, const DimsList& dims,
     const size_t total_batch_size, std::vector<Scheduler::Payload>* payloads,
-    std::vector<std::unique_ptr<char[]>>* input_buffers, bool* cuda_copy)
+    bool* cuda_copy)
 {
   // Get the shape of the input. The provider has already checked that
   // the request shape is valid so don't need to do it here.
@@ -483,7 +485,7 @@ NetDefBackend::Context::SetInput(
 
   return SetFixedSizedInputTensor(
       name, shape, dtype, batch1_byte_size, total_byte_size, payloads,
-      input_buffers, cuda_copy);
+      cuda_copy);
 }
 
 Status
@@ -531,10 +533,6 @@ NetDefBackend::Context::Run(
             name_ + "', max allowed is " + std::to_string(max_batch_size_));
   }
 
-  // Hold reference to each buffer of input data to that it stays
-  // until the inference has completed.
-  std::vector<std::unique_ptr<char[]>> input_buffers;
-
   // Create a tensor for each input sized correctly for the total
   // payload batch size. Concatenate input values from each payload
   // into the corresponding tensor.
@@ -549,7 +547,7 @@ NetDefBackend::Context::Run(
 
     RETURN_IF_ERROR(SetInput(
         name, input_config->data_type(), input.dims(), total_batch_size,
-        payloads, &input_buffers, &cuda_copy));
+        payloads, &cuda_copy));
   }
 
   // Additional inputs added to the provider...
@@ -562,7 +560,7 @@ NetDefBackend::Context::Run(
           pr.second;
       RETURN_IF_ERROR(SetInput(
           name, override->datatype_, override->dims_, total_batch_size,
-          payloads, &input_buffers, &cuda_copy));
+          payloads, &cuda_copy));
     }
   }
 #ifdef TRTIS_ENABLE_GPU
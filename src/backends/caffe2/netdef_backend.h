@@ -29,6 +29,7 @@
 #include "src/core/backend.h"
 #include "src/core/backend_context.h"
 #include "src/core/model_config.pb.h"
+#include "src/core/provider.h"
 #include "src/core/scheduler.h"
 #include "src/core/status.h"
 
@@ -83,8 +84,7 @@ class NetDefBackend : public InferenceBackend {
     Status SetInput(
         const std::string& name, const DataType datatype, const DimsList& dims,
         const size_t total_batch_size,
-        std::vector<Scheduler::Payload>* payloads,
-        std::vector<std::unique_ptr<char[]>>* input_buffers, bool* cuda_copy);
+        std::vector<Scheduler::Payload>* payloads, bool* cuda_copy);
 
     // Run model to execute for one or more requests. This function
     // assumes that it is only called by the single runner thread that
@@ -95,12 +95,13 @@ class NetDefBackend : public InferenceBackend {
     Status Run(
         const NetDefBackend* base, std::vector<Scheduler::Payload>* payloads);
 
-    // Set an input tensor from one or more payloads.
+    // Set an input tensor from one or more payloads. The payload data
+    // is copied directly into the memory of the workspace tensor.
     Status SetFixedSizedInputTensor(
         const std::string& input_name, const std::vector<int64_t>& shape,
         const Caffe2Workspace::DataType dtype, const size_t batch1_byte_size,
         const size_t total_byte_size, std::vector<Scheduler::Payload>* payloads,
-        std::vector<std::unique_ptr<char[]>>* input_buffers, bool* cuda_copy);
+        bool* cuda_copy);
 
     // Read an output tensor into one or more payloads.
     Status ReadFixedSizedOutputTensor(
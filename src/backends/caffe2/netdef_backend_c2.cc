@@ -28,6 +28,7 @@
 
 #include <google/protobuf/io/coded_stream.h>
 #include <stdint.h>
+#include <algorithm>
 #include "caffe2/core/context_gpu.h"
 #include "caffe2/core/init.h"
 #include "caffe2/core/types.h"
@@ -57,6 +58,9 @@ class Caffe2WorkspaceImpl : public Caffe2Workspace {
   Error SetInputTensor(
       const std::string& name, const std::vector<int64_t>& shape,
       const DataType dtype, const char* content, size_t byte_size) override;
+  Error GetInputTensorBuffer(
+      const std::string& name, const std::vector<int64_t>& shape,
+      const DataType dtype, size_t byte_size, char** buffer) override;
   Error GetOutputTensor(
       const std::string& name, const Caffe2Workspace::DataType dtype,
       const char** content, size_t* byte_size,
@@ -64,6 +68,10 @@ class Caffe2WorkspaceImpl : public Caffe2Workspace {
   Error Run() override;
 
  private:
+  // Get the tensor of the 'name'd input.
+  Error GetInputTensor(
+      const std::string& name, caffe2::Tensor** input_tensor);
+
   // The Caffe2 workspace.
   std::unique_ptr<caffe2::Workspace> ws_;
 
@@ -84,6 +92,10 @@ class Caffe2WorkspaceImpl : public Caffe2Workspace {
   // outputs.
   std::set<std::string> potential_input_names_;
   std::set<std::string> potential_output_names_;
+
+  // Names of the inputs whose tensors already hold the memory for the
+  // maximum batch size.
+  std::set<std::string> reserved_input_names_;
 };
 
 namespace {
@@ -414,13 +426,9 @@ Caffe2WorkspaceImpl::Create(
 }
 
 Caffe2Workspace::Error
-Caffe2WorkspaceImpl::SetInputTensor(
-    const std::string& name, const std::vector<int64_t>& shape,
-    const Caffe2Workspace::DataType dtype, const char* content,
-    size_t byte_size)
+Caffe2WorkspaceImpl::GetInputTensor(
+    const std::string& name, caffe2::Tensor** input_tensor)
 {
-  // Find the input tensor in the model and set it to use 'content'
-  // in-place.
   caffe2::Blob* blob = nullptr;
   try {
     blob = ws_->GetBlob(name);
@@ -445,6 +453,24 @@ Caffe2WorkspaceImpl::SetInputTensor(
     return Error("failed to get NetDef tensor for input '" + name + "'");
   }
 
+  *input_tensor = input;
+  return Error();
+}
+
+Caffe2Workspace::Error
+Caffe2WorkspaceImpl::SetInputTensor(
+    const std::string& name, const std::vector<int64_t>& shape,
+    const Caffe2Workspace::DataType dtype, const char* content,
+    size_t byte_size)
+{
+  // Find the input tensor in the model and set it to use 'content'
+  // in-place.
+  caffe2::Tensor* input = nullptr;
+  Error err = GetInputTensor(name, &input);
+  if (!err.IsOk()) {
+    return err;
+  }
+
   input->Resize(shape);
 
   const auto pr = ConvertDatatype(dtype);
@@ -454,6 +480,10 @@ Caffe2WorkspaceImpl::SetInputTensor(
         "' to Caffe2 NetDef datatype");
   }
 
+  // The tensor no longer owns its memory so it must be reserved again
+  // if the input is later written into the tensor.
+  reserved_input_names_.erase(name);
+
   input->ShareExternalPointer(const_cast<char*>(content), pr.second, byte_size);
 
   if ((input->size() * input->itemsize()) != byte_size) {
@@ -466,6 +496,63 @@ Caffe2WorkspaceImpl::SetInputTensor(
   return Error();
 }
 
+Caffe2Workspace::Error
+Caffe2WorkspaceImpl::GetInputTensorBuffer(
+    const std::string& name, const std::vector<int64_t>& shape,
+    const Caffe2Workspace::DataType dtype, size_t byte_size, char** buffer)
+{
+  caffe2::Tensor* input = nullptr;
+  Error err = GetInputTensor(name, &input);
+  if (!err.IsOk()) {
+    return err;
+  }
+
+  const auto pr = ConvertDatatype(dtype);
+  if (!pr.first) {
+    return Error(
+        "Failed to convert datatype '" + DataTypeName(dtype) +
+        "' to Caffe2 NetDef datatype");
+  }
+
+  // Allocate for the maximum batch size once. A tensor keeps its
+  // memory when it is resized to fewer elements, so smaller batches
+  // don't allocate.
+  if ((max_batch_size_ != NO_BATCHING) && !shape.empty() &&
+      (reserved_input_names_.find(name) == reserved_input_names_.end())) {
+    std::vector<int64_t> max_shape(shape);
+    max_shape[0] = std::max(max_shape[0], (int64_t)max_batch_size_);
+    try {
+      input->Resize(max_shape);
+      input->raw_mutable_data(pr.second);
+    }
+    catch (caffe2::EnforceNotMet ex) {
+      return Error(
+          "failed to allocate NetDef tensor for input '" + name +
+          "': " + ex.msg());
+    }
+    reserved_input_names_.insert(name);
+  }
+
+  try {
+    input->Resize(shape);
+    *buffer = static_cast<char*>(input->raw_mutable_data(pr.second));
+  }
+  catch (caffe2::EnforceNotMet ex) {
+    return Error(
+        "failed to allocate NetDef tensor for input '" + name +
+        "': " + ex.msg());
+  }
+
+  if ((input->size() * input->itemsize()) != byte_size) {
+    return Error(
+        "unexpected size " + std::to_string(byte_size) +
+        " for inference input '" + name + "', expecting " +
+        std::to_string(input->size() * input->itemsize()));
+  }
+
+  return Error();
+}
+
 Caffe2Workspace::Error
 Caffe2WorkspaceImpl::GetOutputTensor(
     const std::string& name, const Caffe2Workspace::DataType dtype,
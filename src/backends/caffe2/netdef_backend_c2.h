@@ -92,6 +92,15 @@ class Caffe2Workspace {
       const std::string& name, const std::vector<int64_t>& shape,
       const DataType dtype, const char* content, size_t byte_size) = 0;
 
+  // Get in 'buffer' the memory of an input tensor, resized to
+  // 'shape', so that the input can be written directly into the
+  // tensor instead of being set with SetInputTensor(). The memory is
+  // sized for the maximum batch size on first use and is reused by
+  // later calls.
+  virtual Error GetInputTensorBuffer(
+      const std::string& name, const std::vector<int64_t>& shape,
+      const DataType dtype, size_t byte_size, char** buffer) = 0;
+
   // Get the value for an output tensor after inferencing.
   virtual Error GetOutputTensor(
       const std::string& name, const Caffe2Workspace::DataType dtype,
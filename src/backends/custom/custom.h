@@ -96,6 +96,18 @@ typedef struct custom_initdata_struct {
   /// and must be copied if a persistent copy of required by the
   /// custom backend.
   const char** server_parameters;
+
+  /// The number of GPU devices (i.e. the length of 'gpu_device_ids').
+  size_t gpu_device_cnt;
+
+  /// The GPU devices to initialize for. An instance of a KIND_MULTI_GPU
+  /// instance group is given all the GPUs of the group, the first of
+  /// which is 'gpu_device_id' and is where the inputs are provided and
+  /// the outputs are expected. Other GPU instances are given only
+  /// 'gpu_device_id' and CPU instances no GPU. This array is owned by
+  /// the caller and must be copied if a persistent copy is required by
+  /// the custom backend.
+  const int* gpu_device_ids;
 } CustomInitializeData;
 
 /// A payload represents the input tensors and the required output
@@ -144,6 +156,31 @@ typedef struct custom_payload_struct {
   int error_code;
 } CustomPayload;
 
+/// A tensor provided to or computed by the CustomExecuteV3
+/// function. The tensor holds the values for all the payloads of the
+/// execution, batched together in the order of the payloads.
+typedef struct custom_tensor_struct {
+  /// The name of the tensor as a null-terminated string.
+  const char* name;
+
+  /// The number of dimensions in the tensor's shape.
+  size_t shape_dim_cnt;
+
+  /// The shape of the tensor. If the model supports batching the
+  /// first dimension is the total batch size of the payloads.
+  const int64_t* shape_dims;
+
+  /// The buffer holding the tensor values. For an output tensor the
+  /// backend must write the values into this buffer.
+  void* buffer;
+
+  /// The size, in bytes, of 'buffer'.
+  uint64_t byte_size;
+
+  /// The memory type of 'buffer'.
+  CustomMemoryType memory_type;
+} CustomTensor;
+
 /// Type for the CustomGetNextInput callback function.
 ///
 /// This callback function is provided in the call to ComputeExecute
@@ -230,6 +267,34 @@ typedef int (*CustomExecuteV2Fn_t)(
     void*, uint32_t, CustomPayload*, CustomGetNextInputV2Fn_t,
     CustomGetOutputV2Fn_t);
 
+/// Type for the CustomExecuteV3 function.
+typedef int (*CustomExecuteV3Fn_t)(
+    void*, uint32_t, CustomPayload*, uint32_t, const CustomTensor*, uint32_t,
+    const CustomTensor*, void*);
+
+/// Type for the CustomExecuteComplete callback function.
+///
+/// This callback function is provided in the call to
+/// CustomExecuteAsync and must be called exactly once, from any
+/// thread, when the execution of the payloads completes. After it
+/// returns the payloads and the input and output contexts must not be
+/// used. The custom state may be finalized by CustomFinalize from
+/// within this callback.
+///
+/// \param complete_context The completion context provided in call
+/// to CustomExecuteAsync.
+/// \param error_code The error code of the execution. Zero indicates
+/// success, all other values indicate failure and are backend
+/// defined. Errors isolated to a single payload should be reported
+/// in the 'error_code' of that payload.
+typedef void (*CustomExecuteCompleteFn_t)(
+    void* complete_context, int error_code);
+
+/// Type for the CustomExecuteAsync function.
+typedef int (*CustomExecuteAsyncFn_t)(
+    void*, uint32_t, CustomPayload*, CustomGetNextInputV2Fn_t,
+    CustomGetOutputV2Fn_t, CustomExecuteCompleteFn_t, void*);
+
 /// Get the custom version. For a custom backend that doesn't define this entry
 /// point, the inference server will assume the backend version is 1. The
 /// currently supported versions are defined below, returning any other version
@@ -245,6 +310,21 @@ typedef int (*CustomExecuteV2Fn_t)(
 /// CustomGetNextInputV2Fn_t and CustomGetOutputV2Fn_t define the function
 /// signature for the input and output callbacks.
 ///
+/// Version 3: The input tensors of all payloads are gathered into one
+/// batch buffer per input and the backend writes each required output
+/// into one batch buffer per output. For an instance on a GPU the
+/// buffers are in the memory of that GPU, when it has room, and the
+/// backend is given the CUDA stream to execute on. The CustomExecuteV3
+/// function must be defined. The inputs and outputs must not be of
+/// TYPE_STRING and the outputs must have a fixed-size shape.
+///
+/// Version 4: Like version 2, except that the execution is
+/// asynchronous. The CustomExecuteAsync function must be defined and
+/// may return before the execution completes. An instance may be
+/// given several executions to have in flight at once, up to the
+/// limit set in the model configuration, and the input and output
+/// callbacks may be called from any thread.
+///
 /// \return the custom version.
 TRTIS_CUSTOM_EXPORT uint32_t CustomVersion();
 
@@ -309,6 +389,58 @@ TRTIS_CUSTOM_EXPORT int CustomExecuteV2(
     void* custom_context, uint32_t payload_cnt, CustomPayload* payloads,
     CustomGetNextInputV2Fn_t input_fn, CustomGetOutputV2Fn_t output_fn);
 
+/// Execute the custom model using the version 3 implementation of the execute
+/// interface. This function must be defined when the custom backend returns 3
+/// from CustomVersion. The 'input_context' and 'output_context' of the
+/// payloads are not used by this version.
+///
+/// The work that fills the input buffers is queued on 'cuda_stream'
+/// and the outputs are read after the work queued on 'cuda_stream'
+/// by this function completes, so the backend should queue its work
+/// on 'cuda_stream' and doesn't need to synchronize with it. A
+/// backend that does work on another stream or on the CPU must
+/// synchronize with 'cuda_stream' before reading an input in GPU
+/// memory, and must have completed writing the outputs before
+/// returning.
+///
+/// \param custom_context The custom state associated with the context
+/// that should execute. Can be nullptr if no custom state.
+/// \param payload_cnt The number of payloads to execute.
+/// \param payloads The payloads to execute.
+/// \param input_cnt The number of input tensors.
+/// \param inputs The input tensors, holding the inputs of all
+/// payloads.
+/// \param output_cnt The number of output tensors.
+/// \param outputs The output tensors that must be computed. These are
+/// the outputs required by at least one payload.
+/// \param cuda_stream The cudaStream_t to execute on, or nullptr if the
+/// instance is not on a GPU.
+/// \return An error code. Zero indicates success, all other values
+/// indicate failure. Use CustomErrorString to get the error string
+/// for an error code.
+TRTIS_CUSTOM_EXPORT int CustomExecuteV3(
+    void* custom_context, uint32_t payload_cnt, CustomPayload* payloads,
+    uint32_t input_cnt, const CustomTensor* inputs, uint32_t output_cnt,
+    const CustomTensor* outputs, void* cuda_stream);
+
+/// Execute the custom model using the version 4 implementation of the execute
+/// interface. This function must be defined when the custom backend returns 4
+/// from CustomVersion. It may return before the execution completes and may
+/// be called again, for other payloads, before earlier executions complete.
+/// See CustomExecute for description of the other parameters.
+///
+/// \param complete_fn The callback function to call when the execution
+/// completes (see CustomExecuteCompleteFn_t). It must not be called if
+/// this function returns an error.
+/// \param complete_context The context to pass to 'complete_fn'.
+/// \return An error code. Zero indicates that the execution was
+/// started, all other values indicate that it failed to start. Use
+/// CustomErrorString to get the error string for an error code.
+TRTIS_CUSTOM_EXPORT int CustomExecuteAsync(
+    void* custom_context, uint32_t payload_cnt, CustomPayload* payloads,
+    CustomGetNextInputV2Fn_t input_fn, CustomGetOutputV2Fn_t output_fn,
+    CustomExecuteCompleteFn_t complete_fn, void* complete_context);
+
 #ifdef __cplusplus
 }
 #endif
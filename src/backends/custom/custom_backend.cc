@@ -27,6 +27,7 @@
 #include "src/backends/custom/custom_backend.h"
 
 #include <stdint.h>
+#include <algorithm>
 #include "src/backends/custom/loader.h"
 #include "src/core/constants.h"
 #include "src/core/logging.h"
@@ -69,19 +70,44 @@ ToTRTServerMemoryType(CustomMemoryType memory_type)
 
 namespace nvidia { namespace inferenceserver {
 
+namespace {
+
+// The number of executions each instance of a version 4 custom
+// backend may have in flight if the model configuration doesn't set
+// it.
+constexpr uint32_t kDefaultMaxInflightExecutions = 2;
+
+}  // namespace
+
 CustomBackend::Context::Context(
     const std::string& name, const int gpu_device, const int max_batch_size)
     : BackendContext(name, gpu_device, max_batch_size),
       library_handle_(nullptr), library_context_handle_(nullptr),
       InitializeFn_(nullptr), FinalizeFn_(nullptr), ErrorStringFn_(nullptr),
-      ExecuteFn_(nullptr)
+      ExecuteFn_(nullptr), ExecuteV2Fn_(nullptr), ExecuteV3Fn_(nullptr),
+      ExecuteAsyncFn_(nullptr), max_inflight_executions_(1), inflight_cnt_(0)
 {
 }
 
 CustomBackend::Context::~Context()
 {
   LOG_VERBOSE(1) << "~CustomBackend::Context " << name_;
-  if (FinalizeFn_ != nullptr) {
+
+  FinalizeInstance();
+  UnloadCustom(library_handle_);
+  library_handle_ = nullptr;
+}
+
+void
+CustomBackend::Context::FinalizeInstance()
+{
+  // Wait for the executions still in flight in the custom library.
+  {
+    std::unique_lock<std::mutex> lock(inflight_mu_);
+    inflight_cv_.wait(lock, [this] { return inflight_cnt_ == 0; });
+  }
+
+  if ((FinalizeFn_ != nullptr) && (library_context_handle_ != nullptr)) {
     int err = FinalizeFn_(library_context_handle_);
     if (err != 0) {
       LOG_ERROR << "error finalizing custom library: (" << err << ") "
@@ -89,10 +115,7 @@ CustomBackend::Context::~Context()
     }
   }
 
-  UnloadCustom(library_handle_);
-
   library_context_handle_ = nullptr;
-  library_handle_ = nullptr;
 }
 
 Status
@@ -123,6 +146,18 @@ CustomBackend::CreateExecutionContexts(
         RETURN_IF_ERROR(CreateExecutionContext(
             instance_name, Context::NO_GPU_DEVICE, libraries));
         total_context_cnt++;
+      } else if (group.kind() == ModelInstanceGroup::KIND_MULTI_GPU) {
+        // A single context spans all the GPUs of the group and is
+        // created on the first of them.
+        std::string instance_name = group.name() + "_" + std::to_string(c);
+        for (int gpu_device : group.gpus()) {
+          instance_name += "_gpu" + std::to_string(gpu_device);
+        }
+        RETURN_IF_ERROR(
+            CreateExecutionContext(instance_name, group.gpus(0), libraries));
+        contexts_.back()->gpu_devices_.assign(
+            group.gpus().begin(), group.gpus().end());
+        total_context_cnt++;
       } else {
         for (int gpu_device : group.gpus()) {
           const std::string instance_name = group.name() + "_" +
@@ -145,7 +180,8 @@ CustomBackend::CreateExecutionContexts(
           uint32_t runner_idx, std::vector<Scheduler::Payload>* payloads,
           std::function<void(Status)> func) {
         RunBackend(runner_idx, payloads, func);
-      }));
+      },
+      [this](uint32_t runner_idx) { ReleaseBackend(runner_idx); }));
 
   LOG_VERBOSE(1) << "custom backend for " << Name() << std::endl << *this;
   return Status::Success;
@@ -213,17 +249,73 @@ CustomBackend::CreateExecutionContext(
       mn_itr->second, &(context->library_handle_), &(context->InitializeFn_),
       &(context->FinalizeFn_), &(context->ErrorStringFn_),
       &(context->ExecuteFn_), &(context->ExecuteV2Fn_),
+      &(context->ExecuteV3Fn_), &(context->ExecuteAsyncFn_),
       &(context->custom_version_)));
 
-  // Only create stream on V1 as backend is not aware of different memory
-  // types. For other version, the backend should handle this explicitly.
-  if (context->custom_version_ == 1) {
+  if (context->custom_version_ == 4) {
+    const uint32_t max_inflight =
+        Config().optimization().custom().max_inflight_executions();
+    context->max_inflight_executions_ =
+        (max_inflight == 0) ? kDefaultMaxInflightExecutions : max_inflight;
+  }
+
+  if (context->custom_version_ == 3) {
+    RETURN_IF_ERROR(ValidateV3Config());
+  }
+
+  // Create stream on V1 as backend is not aware of different memory
+  // types, and on V3 as the inputs and outputs are copied by the
+  // server and the backend executes on the stream. For V2, the
+  // backend should handle this explicitly.
+  if ((context->custom_version_ == 1) || (context->custom_version_ == 3)) {
+#ifdef TRTIS_ENABLE_GPU
+    if (gpu_device != Context::NO_GPU_DEVICE) {
+      cudaError_t cuerr = cudaSetDevice(gpu_device);
+      if (cuerr != cudaSuccess) {
+        return Status(
+            RequestStatusCode::INTERNAL, "unable to set device for " +
+                                             instance_name + ": " +
+                                             cudaGetErrorString(cuerr));
+      }
+    }
+#endif  // TRTIS_ENABLE_GPU
     RETURN_IF_ERROR(context->CreateCudaStream());
   }
 
   return Status::Success;
 }
 
+Status
+CustomBackend::ValidateV3Config() const
+{
+  for (const auto& io : Config().input()) {
+    if (io.data_type() == TYPE_STRING) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "custom interface version 3 does not support TYPE_STRING input '" +
+              io.name() + "' for " + Name());
+    }
+  }
+
+  for (const auto& io : Config().output()) {
+    if (io.data_type() == TYPE_STRING) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "custom interface version 3 does not support TYPE_STRING output '" +
+              io.name() + "' for " + Name());
+    }
+    if (GetByteSize(io) < 0) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "custom interface version 3 requires a fixed-size shape for "
+          "output '" +
+              io.name() + "' for " + Name());
+    }
+  }
+
+  return Status::Success;
+}
+
 Status
 CustomBackend::InitBackend(uint32_t runner_idx)
 {
@@ -248,6 +340,14 @@ CustomBackend::InitBackend(uint32_t runner_idx)
   init_data.serialized_model_config_size = serialized_config.size();
   init_data.gpu_device_id = context->gpu_device_;
 
+  std::vector<int> gpu_devices = context->gpu_devices_;
+  if (gpu_devices.empty() &&
+      (context->gpu_device_ != Context::NO_GPU_DEVICE)) {
+    gpu_devices.push_back(context->gpu_device_);
+  }
+  init_data.gpu_device_cnt = gpu_devices.size();
+  init_data.gpu_device_ids = gpu_devices.empty() ? nullptr : &gpu_devices[0];
+
   std::vector<const char*> server_param_values;
   for (const auto& param : server_params_) {
     server_param_values.push_back(param.c_str());
@@ -277,6 +377,14 @@ CustomBackend::InitBackend(uint32_t runner_idx)
   return Status::Success;
 }
 
+void
+CustomBackend::ReleaseBackend(uint32_t runner_idx)
+{
+  if (runner_idx < contexts_.size()) {
+    contexts_[runner_idx]->FinalizeInstance();
+  }
+}
+
 void
 CustomBackend::RunBackend(
     uint32_t runner_idx, std::vector<Scheduler::Payload>* payloads,
@@ -301,34 +409,40 @@ CustomBackend::RunBackend(
     }
   }
 
-  Status status = contexts_[runner_idx]->Run(this, payloads);
-
-  // Stop compute timers.
-  for (auto& payload : *payloads) {
-    if (payload.stats_ != nullptr) {
-      payload.stats_->CaptureTimestamp(
-          ModelInferStats::TimestampKind::kComputeEnd);
+  auto OnComplete = [payloads, OnCompleteQueuedPayloads](Status status) {
+    // Stop compute timers.
+    for (auto& payload : *payloads) {
+      if (payload.stats_ != nullptr) {
+        payload.stats_->CaptureTimestamp(
+            ModelInferStats::TimestampKind::kComputeEnd);
+      }
     }
-  }
 
-  OnCompleteQueuedPayloads(status);
+    OnCompleteQueuedPayloads(status);
+  };
+
+  // A version 4 backend completes the payloads from its own thread
+  // so that the runner can go on to schedule the next batch.
+  Context* context = contexts_[runner_idx].get();
+  if (context->custom_version_ == 4) {
+    context->RunAsync(this, payloads, std::move(OnComplete));
+  } else {
+    OnComplete(context->Run(this, payloads));
+  }
 }
 
 Status
-CustomBackend::Context::Run(
-    CustomBackend* base, std::vector<Scheduler::Payload>* payloads)
+CustomBackend::Context::InitExecution(
+    CustomBackend* base, std::vector<Scheduler::Payload>* payloads,
+    Execution* execution)
 {
-  LOG_VERBOSE(1) << "Running " << name_ << " with " << payloads->size()
-                 << " request payloads";
-
   // Each payload will have the same number and shape for inputs. Get
   // the shape for each input into a vector suitable to passing via
   // the custom backend interface. As a performance improvement for
   // models that don't have any variable-size input tensors we could
   // calculate the input tensor shapes once during backend
   // initialization.
-  std::unordered_map<std::string, std::unique_ptr<std::vector<int64_t>>>
-      input_shapes;
+  auto& input_shapes = execution->input_shapes_;
 
   if (!payloads->empty()) {
     const InferRequestHeader& request_header =
@@ -366,6 +480,8 @@ CustomBackend::Context::Run(
     total_requested_outputs += request_header.output_size();
   }
 
+  execution->total_batch_size_ = total_batch_size;
+
   // If there are no valid payloads then no need to run the
   // inference. The payloads will have their error status set so can
   // just return.
@@ -387,29 +503,29 @@ CustomBackend::Context::Run(
   // names of the payloads. We don't want this to resize as that will
   // invalidate the pointers so set the capacity big enough to hold
   // all the pointers for all the payloads.
-  std::vector<const char*> work_input_name_ptrs;
+  auto& work_input_name_ptrs = execution->input_name_ptrs_;
   work_input_name_ptrs.reserve(total_inputs);
-  std::vector<const char*> work_output_name_ptrs;
+  auto& work_output_name_ptrs = execution->output_name_ptrs_;
   work_output_name_ptrs.reserve(total_requested_outputs);
 
   // Similarly for input dim sizes and the dimension values.
-  std::vector<size_t> work_input_dim_cnts;
+  auto& work_input_dim_cnts = execution->input_dim_cnts_;
   work_input_dim_cnts.reserve(total_inputs);
-  std::vector<const int64_t*> work_input_dims_ptrs;
+  auto& work_input_dims_ptrs = execution->input_dims_ptrs_;
   work_input_dims_ptrs.reserve(total_inputs);
 
   // We use the following to hold contexts needed for the input and
   // output callbacks. We don't want this to resize as that will
   // invalidate the pointers so set the capacity big enough to hold
   // the contexts for all the payloads.
-  std::vector<GetInputOutputContext> work_io_contexts;
+  auto& work_io_contexts = execution->io_contexts_;
   work_io_contexts.reserve(payloads->size());
 
   // Collect the payload information into a array of custom::Payload
   // structs that can be passed to the backend. Every payload must
   // have an OK status (checked above) so we don't bother to check
   // that here.
-  std::vector<CustomPayload> custom_payloads;
+  auto& custom_payloads = execution->custom_payloads_;
   for (auto& payload : *payloads) {
     const InferRequestHeader& request_header =
         payload.request_provider_->RequestHeader();
@@ -461,6 +577,73 @@ CustomBackend::Context::Run(
     custom_payload.error_code = 0;
   }
 
+  // Version 3 is given the inputs of all payloads gathered into one
+  // buffer per input, and buffers to write the required outputs
+  // into.
+  if (custom_version_ == 3) {
+    RETURN_IF_ERROR(SetInputTensorsV3(
+        base, payloads, total_batch_size, &execution->v3_shapes_,
+        &execution->v3_inputs_));
+    RETURN_IF_ERROR(SetOutputTensorsV3(
+        base, payloads, total_batch_size, &execution->v3_shapes_,
+        &execution->v3_outputs_));
+  }
+
+  return Status::Success;
+}
+
+Status
+CustomBackend::Context::CompleteExecution(
+    std::vector<Scheduler::Payload>* payloads, Execution* execution,
+    const int err)
+{
+  for (auto& payload : *payloads) {
+    if (payload.stats_ != nullptr) {
+      payload.stats_->CaptureTimestamp(
+          ModelInferStats::TimestampKind::kComputeOutputStart);
+    }
+  }
+
+  if (err != 0) {
+    return Status(
+        RequestStatusCode::INTERNAL, "execute error for '" + name_ + "': (" +
+                                         std::to_string(err) + ") " +
+                                         LibraryErrorString(err));
+  }
+
+  // Transfer payload errors back to the Payload objects.
+  const auto& custom_payloads = execution->custom_payloads_;
+  for (size_t i = 0; i < custom_payloads.size(); ++i) {
+    if (custom_payloads[i].error_code != 0) {
+      (*payloads)[i].status_ = Status(
+          RequestStatusCode::INTERNAL,
+          "payload error for '" + name_ + "': (" +
+              std::to_string(custom_payloads[i].error_code) + ") " +
+              LibraryErrorString(custom_payloads[i].error_code));
+    }
+  }
+
+  if (custom_version_ == 3) {
+    ReadOutputTensorsV3(
+        payloads, execution->total_batch_size_, execution->v3_outputs_);
+  }
+
+  return Status::Success;
+}
+
+Status
+CustomBackend::Context::Run(
+    CustomBackend* base, std::vector<Scheduler::Payload>* payloads)
+{
+  LOG_VERBOSE(1) << "Running " << name_ << " with " << payloads->size()
+                 << " request payloads";
+
+  Execution execution;
+  RETURN_IF_ERROR(InitExecution(base, payloads, &execution));
+  if (execution.total_batch_size_ == 0) {
+    return Status::Success;
+  }
+
   for (auto& payload : *payloads) {
     if (payload.stats_ != nullptr) {
       payload.stats_->CaptureTimestamp(
@@ -471,8 +654,22 @@ CustomBackend::Context::Run(
   // Execute the custom backend which will use CustomGetOutput to get
   // the output buffers into which it will write the results for the
   // requested outputs.
+  auto& custom_payloads = execution.custom_payloads_;
   int err = 0;
   switch (custom_version_) {
+    case 3: {
+      void* stream = nullptr;
+#ifdef TRTIS_ENABLE_GPU
+      if (gpu_device_ != NO_GPU_DEVICE) {
+        stream = stream_;
+      }
+#endif  // TRTIS_ENABLE_GPU
+      err = ExecuteV3Fn_(
+          library_context_handle_, custom_payloads.size(), &custom_payloads[0],
+          execution.v3_inputs_.size(), execution.v3_inputs_.data(),
+          execution.v3_outputs_.size(), execution.v3_outputs_.data(), stream);
+      break;
+    }
     case 2:
       err = ExecuteV2Fn_(
           library_context_handle_, custom_payloads.size(), &custom_payloads[0],
@@ -485,37 +682,273 @@ CustomBackend::Context::Run(
       break;
   }
 
+  // After execution, input buffer can be clean up if any
+  input_buffers_.clear();
+
+  return CompleteExecution(payloads, &execution, err);
+}
+
+void
+CustomBackend::Context::RunAsync(
+    CustomBackend* base, std::vector<Scheduler::Payload>* payloads,
+    std::function<void(Status)>&& OnComplete)
+{
+  LOG_VERBOSE(1) << "Running " << name_ << " asynchronously with "
+                 << payloads->size() << " request payloads";
+
+  std::unique_ptr<Execution> execution(new Execution());
+  Status status = InitExecution(base, payloads, execution.get());
+  if (!status.IsOk() || (execution->total_batch_size_ == 0)) {
+    OnComplete(status);
+    return;
+  }
+
+  // Wait for an earlier execution to complete if the instance already
+  // has as many in flight as allowed.
+  {
+    std::unique_lock<std::mutex> lock(inflight_mu_);
+    inflight_cv_.wait(
+        lock, [this] { return inflight_cnt_ < max_inflight_executions_; });
+    inflight_cnt_++;
+  }
+
   for (auto& payload : *payloads) {
     if (payload.stats_ != nullptr) {
       payload.stats_->CaptureTimestamp(
-          ModelInferStats::TimestampKind::kComputeOutputStart);
+          ModelInferStats::TimestampKind::kComputeInputEnd);
     }
   }
 
-  // After execution, input buffer can be clean up if any
-  input_buffers_.clear();
+  execution->context_ = this;
+  execution->payloads_ = payloads;
+  execution->OnComplete_ = std::move(OnComplete);
+
+  // The execution is owned by the custom backend until it calls
+  // CustomExecuteComplete.
+  Execution* inflight = execution.release();
+  int err = ExecuteAsyncFn_(
+      library_context_handle_, inflight->custom_payloads_.size(),
+      &inflight->custom_payloads_[0], CustomGetNextInputV2, CustomGetOutputV2,
+      CustomExecuteComplete, inflight);
 
+  // The completion is not called for an execution that failed to
+  // start.
   if (err != 0) {
-    return Status(
-        RequestStatusCode::INTERNAL, "execute error for '" + name_ + "': (" +
-                                         std::to_string(err) + ") " +
-                                         LibraryErrorString(err));
+    CompleteInflight(inflight, err);
   }
+}
 
-  // Transfer payload errors back to the Payload objects.
-  for (size_t i = 0; i < custom_payloads.size(); ++i) {
-    if (custom_payloads[i].error_code != 0) {
-      (*payloads)[i].status_ = Status(
-          RequestStatusCode::INTERNAL,
-          "payload error for '" + name_ + "': (" +
-              std::to_string(custom_payloads[i].error_code) + ") " +
-              LibraryErrorString(custom_payloads[i].error_code));
+void
+CustomBackend::Context::CompleteInflight(Execution* execution, const int err)
+{
+  std::unique_ptr<Execution> completed(execution);
+  Status status = CompleteExecution(completed->payloads_, completed.get(), err);
+  std::function<void(Status)> OnComplete = std::move(completed->OnComplete_);
+  completed.reset();
+
+  // Release the slot before completing the payloads as that may
+  // release the last reference to the backend, destroying this
+  // context which waits for all executions to complete.
+  {
+    std::lock_guard<std::mutex> lock(inflight_mu_);
+    inflight_cnt_--;
+  }
+  inflight_cv_.notify_all();
+
+  OnComplete(status);
+}
+
+Status
+CustomBackend::Context::SetInputTensorsV3(
+    CustomBackend* base, std::vector<Scheduler::Payload>* payloads,
+    const uint32_t total_batch_size, std::deque<std::vector<int64_t>>* shapes,
+    std::vector<CustomTensor>* inputs)
+{
+  // Every payload has the same shape for each input so take the
+  // inputs and shapes from the first payload.
+  const InferRequestHeader& request_header =
+      payloads->front().request_provider_->RequestHeader();
+
+  bool host_cuda_copy = false;
+  for (const auto& input : request_header.input()) {
+    const ModelInput* io;
+    RETURN_IF_ERROR(base->GetInput(input.name(), &io));
+
+    shapes->emplace_back();
+    std::vector<int64_t>& shape = shapes->back();
+    if (max_batch_size_ != NO_BATCHING) {
+      shape.push_back(total_batch_size);
+    }
+    shape.insert(shape.end(), input.dims().begin(), input.dims().end());
+
+    const int64_t batch1_byte_size = GetByteSize(io->data_type(), input.dims());
+    if (batch1_byte_size < 0) {
+      return Status(
+          RequestStatusCode::INTERNAL, "unable to determine size of input '" +
+                                           input.name() + "' for '" + name_ +
+                                           "'");
+    }
+
+    size_t total_byte_size = 0;
+    std::vector<size_t> expected_byte_sizes;
+    for (auto& payload : *payloads) {
+      expected_byte_sizes.push_back(
+          payload.request_provider_->RequestHeader().batch_size() *
+          batch1_byte_size);
+      total_byte_size += expected_byte_sizes.back();
     }
+
+    TensorBuffer* tb;
+    RETURN_IF_ERROR(GetTensorBuffer(
+        &input_tensor_buffers_, input.name(), total_byte_size,
+        batch1_byte_size * std::max(max_batch_size_, 1), &tb));
+
+    // The copies are issued on 'stream_' which the backend executes
+    // on, so only copies into CPU memory must be waited for.
+    const bool cuda_copy = SetInputBuffer(
+        input.name(), expected_byte_sizes, payloads, tb->memory_type_,
+        tb->buffer_);
+    host_cuda_copy |= (cuda_copy && (tb->memory_type_ == TRTSERVER_MEMORY_CPU));
+
+    inputs->emplace_back();
+    CustomTensor& tensor = inputs->back();
+    tensor.name = input.name().c_str();
+    tensor.shape_dim_cnt = shape.size();
+    tensor.shape_dims = shape.data();
+    tensor.buffer = tb->buffer_;
+    tensor.byte_size = total_byte_size;
+    tensor.memory_type = ToCustomMemoryType(tb->memory_type_);
+  }
+
+#ifdef TRTIS_ENABLE_GPU
+  if (host_cuda_copy) {
+    cudaStreamSynchronize(stream_);
   }
+#endif  // TRTIS_ENABLE_GPU
 
   return Status::Success;
 }
 
+Status
+CustomBackend::Context::SetOutputTensorsV3(
+    CustomBackend* base, std::vector<Scheduler::Payload>* payloads,
+    const uint32_t total_batch_size, std::deque<std::vector<int64_t>>* shapes,
+    std::vector<CustomTensor>* outputs)
+{
+  for (const auto& output : base->Config().output()) {
+    bool required = false;
+    for (const auto& payload : *payloads) {
+      if ((payload.response_provider_ != nullptr) &&
+          payload.response_provider_->RequiresOutput(output.name())) {
+        required = true;
+        break;
+      }
+    }
+    if (!required) {
+      continue;
+    }
+
+    shapes->emplace_back();
+    std::vector<int64_t>& shape = shapes->back();
+    if (max_batch_size_ != NO_BATCHING) {
+      shape.push_back(total_batch_size);
+    }
+    shape.insert(shape.end(), output.dims().begin(), output.dims().end());
+
+    // The output shape is fixed-size, checked by ValidateV3Config().
+    const int64_t batch1_byte_size = GetByteSize(output);
+    const size_t total_byte_size = batch1_byte_size * total_batch_size;
+
+    TensorBuffer* tb;
+    RETURN_IF_ERROR(GetTensorBuffer(
+        &output_tensor_buffers_, output.name(), total_byte_size,
+        batch1_byte_size * std::max(max_batch_size_, 1), &tb));
+
+    outputs->emplace_back();
+    CustomTensor& tensor = outputs->back();
+    tensor.name = output.name().c_str();
+    tensor.shape_dim_cnt = shape.size();
+    tensor.shape_dims = shape.data();
+    tensor.buffer = tb->buffer_;
+    tensor.byte_size = total_byte_size;
+    tensor.memory_type = ToCustomMemoryType(tb->memory_type_);
+  }
+
+  return Status::Success;
+}
+
+void
+CustomBackend::Context::ReadOutputTensorsV3(
+    std::vector<Scheduler::Payload>* payloads, const uint32_t total_batch_size,
+    const std::vector<CustomTensor>& outputs)
+{
+  bool cuda_copy = false;
+  for (const auto& output : outputs) {
+    const std::vector<int64_t> content_shape(
+        output.shape_dims, output.shape_dims + output.shape_dim_cnt);
+    cuda_copy |= SetFixedSizeOutputBuffer(
+        output.name, output.byte_size / total_batch_size,
+        static_cast<const char*>(output.buffer), content_shape,
+        ToTRTServerMemoryType(output.memory_type), payloads);
+  }
+
+#ifdef TRTIS_ENABLE_GPU
+  if (cuda_copy) {
+    cudaStreamSynchronize(stream_);
+  }
+#endif  // TRTIS_ENABLE_GPU
+}
+
+Status
+CustomBackend::Context::GetTensorBuffer(
+    std::unordered_map<std::string, TensorBuffer>* buffers,
+    const std::string& name, const size_t byte_size, const size_t capacity,
+    TensorBuffer** buffer)
+{
+  TensorBuffer& tb = (*buffers)[name];
+
+  if ((tb.memory_ == nullptr) || (tb.byte_size_ < byte_size)) {
+    tb.memory_.reset();
+
+    const size_t alloc_size =
+        std::max(std::max(capacity, byte_size), (size_t)1);
+    TRTSERVER_Memory_Type memory_type = TRTSERVER_MEMORY_CPU;
+#ifdef TRTIS_ENABLE_GPU
+    if (gpu_device_ != NO_GPU_DEVICE) {
+      cudaError_t err = cudaSetDevice(gpu_device_);
+      if (err != cudaSuccess) {
+        return Status(
+            RequestStatusCode::INTERNAL,
+            "unable to set device for '" + name_ +
+                "': " + std::string(cudaGetErrorString(err)));
+      }
+      memory_type = TRTSERVER_MEMORY_GPU;
+    }
+#endif  // TRTIS_ENABLE_GPU
+    tb.memory_.reset(new AllocatedSystemMemory(alloc_size, memory_type));
+    tb.buffer_ = tb.memory_->MutableBuffer(&tb.memory_type_);
+
+    // Fall back to CPU memory if GPU memory is exhausted.
+    if ((tb.buffer_ == nullptr) && (memory_type != TRTSERVER_MEMORY_CPU)) {
+      tb.memory_.reset(
+          new AllocatedSystemMemory(alloc_size, TRTSERVER_MEMORY_CPU));
+      tb.buffer_ = tb.memory_->MutableBuffer(&tb.memory_type_);
+    }
+    if (tb.buffer_ == nullptr) {
+      tb.memory_.reset();
+      return Status(
+          RequestStatusCode::INTERNAL, "unable to allocate " +
+                                           std::to_string(alloc_size) +
+                                           " bytes for tensor '" + name + "'");
+    }
+
+    tb.byte_size_ = alloc_size;
+  }
+
+  *buffer = &tb;
+  return Status::Success;
+}
+
 bool
 CustomBackend::Context::GetNextInput(
     GetInputOutputContext* input_context, const char* cname,
@@ -529,14 +962,16 @@ CustomBackend::Context::GetNextInput(
   // If the memory type is on GPU, implicitly copying it to CPU memory
   // to ensure backward capability
   if (ok && (src_memory_type == CUSTOM_MEMORY_GPU)) {
-    input_buffers_.emplace_back();
-    auto& buffer_unique_ptr = input_buffers_.back();
-    buffer_unique_ptr.reset(new char[*content_byte_size]);
+    // The custom backend may get inputs from several threads.
+    char* buffer = new char[*content_byte_size];
+    {
+      std::lock_guard<std::mutex> lock(input_buffers_mu_);
+      input_buffers_.emplace_back(buffer);
+    }
     cudaError_t err = cudaMemcpyAsync(
-        buffer_unique_ptr.get(), *content, *content_byte_size,
-        cudaMemcpyDeviceToHost, stream_);
+        buffer, *content, *content_byte_size, cudaMemcpyDeviceToHost, stream_);
     if (err == cudaSuccess) {
-      *content = buffer_unique_ptr.get();
+      *content = buffer;
       // Use cudaMemcpyAsync to avoid synchronization on default stream,
       // but stream synchronization must be done per copy to ensure that
       // the data is ready.
@@ -664,6 +1099,14 @@ CustomGetOutput(
       content, &memory_type);
 }
 
+void
+CustomExecuteComplete(void* complete_context, int error_code)
+{
+  CustomBackend::Context::Execution* execution =
+      static_cast<CustomBackend::Context::Execution*>(complete_context);
+  execution->context_->CompleteInflight(execution, error_code);
+}
+
 bool
 CustomGetNextInputV2(
     void* input_context, const char* name, const void** content,
@@ -25,10 +25,16 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
 #include "src/backends/custom/custom.h"
 #include "src/core/backend.h"
 #include "src/core/backend_context.h"
 #include "src/core/model_config.pb.h"
+#include "src/core/provider.h"
 #include "src/core/scheduler.h"
 #include "src/core/status.h"
 
@@ -52,9 +58,18 @@ class CustomBackend : public InferenceBackend {
       const std::unordered_map<std::string, std::string>& libraries);
 
  private:
+  // Check that the model configuration can be executed by version 3
+  // of the custom interface, which only batches fixed-size tensors.
+  Status ValidateV3Config() const;
+
   // Init model on the context associated with 'runner_idx'.
   Status InitBackend(uint32_t runner_idx);
 
+  // Release the model instance on the context associated with
+  // 'runner_idx'. InitBackend() must be called before the context is
+  // used again.
+  void ReleaseBackend(uint32_t runner_idx);
+
   // Run model on the context associated with 'runner_idx' to
   // execute for one or more requests.
   void RunBackend(
@@ -72,6 +87,7 @@ class CustomBackend : public InferenceBackend {
   friend bool CustomGetOutputV2(
       void*, const char*, size_t, int64_t*, uint64_t, void**,
       CustomMemoryType*);
+  friend void CustomExecuteComplete(void*, int);
 
   // For each model instance there is a context.
   struct Context : BackendContext {
@@ -88,6 +104,10 @@ class CustomBackend : public InferenceBackend {
     // Return the shared library reported error string for 'err'.
     std::string LibraryErrorString(const int err);
 
+    // Wait for the executions in flight and then finalize the custom
+    // library instance of this context, if any.
+    void FinalizeInstance();
+
     // Run model to execute for one or more requests. This function
     // assumes that it is only called by the single runner thread that
     // is assigned to this context. A non-OK return status indicates
@@ -96,6 +116,15 @@ class CustomBackend : public InferenceBackend {
     // it will be reported in that payload.
     Status Run(CustomBackend* base, std::vector<Scheduler::Payload>* payloads);
 
+    // Start to run model to execute for one or more requests with a
+    // version 4 custom backend, and call 'OnComplete' when the
+    // execution completes, which may be after returning and from
+    // another thread. Wait first for an earlier execution to complete
+    // if 'max_inflight_executions_' are in flight.
+    void RunAsync(
+        CustomBackend* base, std::vector<Scheduler::Payload>* payloads,
+        std::function<void(Status)>&& OnComplete);
+
     struct GetInputOutputContext {
       GetInputOutputContext(
           CustomBackend::Context* context, Scheduler::Payload* payload)
@@ -106,6 +135,54 @@ class CustomBackend : public InferenceBackend {
       Scheduler::Payload* payload_;
     };
 
+    // The payloads and the tensors passed to the custom library for
+    // one execution. An asynchronous execution holds it until the
+    // execution completes.
+    struct Execution {
+      Execution() : total_batch_size_(0), context_(nullptr), payloads_(nullptr)
+      {
+      }
+
+      uint32_t total_batch_size_;
+      std::unordered_map<std::string, std::unique_ptr<std::vector<int64_t>>>
+          input_shapes_;
+      std::vector<const char*> input_name_ptrs_;
+      std::vector<const char*> output_name_ptrs_;
+      std::vector<size_t> input_dim_cnts_;
+      std::vector<const int64_t*> input_dims_ptrs_;
+      std::vector<GetInputOutputContext> io_contexts_;
+      std::vector<CustomPayload> custom_payloads_;
+
+      // The tensors of a version 3 execution. The shapes are held in
+      // a deque as the tensors reference them.
+      std::deque<std::vector<int64_t>> v3_shapes_;
+      std::vector<CustomTensor> v3_inputs_;
+      std::vector<CustomTensor> v3_outputs_;
+
+      // The context, payloads and completion of an asynchronous
+      // execution.
+      Context* context_;
+      std::vector<Scheduler::Payload>* payloads_;
+      std::function<void(Status)> OnComplete_;
+    };
+
+    // Collect 'payloads' into 'execution' in the form passed to the
+    // custom library. If the payloads have no batch the execution's
+    // 'total_batch_size_' is 0 and nothing needs to be executed.
+    Status InitExecution(
+        CustomBackend* base, std::vector<Scheduler::Payload>* payloads,
+        Execution* execution);
+
+    // Report the result of 'execution' of 'payloads' whose execute
+    // function returned 'err'.
+    Status CompleteExecution(
+        std::vector<Scheduler::Payload>* payloads, Execution* execution,
+        const int err);
+
+    // Complete an asynchronous 'execution' whose execute function
+    // reported 'err', and delete it.
+    void CompleteInflight(Execution* execution, const int err);
+
     // Callback used by custom backends to get the next block of input
     // for a 'name'd input tensor. This function will enforce that
     // the 'content' will be in CPU memory.
@@ -127,6 +204,53 @@ class CustomBackend : public InferenceBackend {
         size_t shape_dim_cnt, int64_t* shape_dims, uint64_t content_byte_size,
         void** content, CustomMemoryType* memory_type);
 
+    // A buffer reused by the version 3 executions of the context for
+    // the batch of an input or output.
+    struct TensorBuffer {
+      TensorBuffer()
+          : buffer_(nullptr), memory_type_(TRTSERVER_MEMORY_CPU),
+            byte_size_(0)
+      {
+      }
+      std::unique_ptr<AllocatedSystemMemory> memory_;
+      char* buffer_;
+      TRTSERVER_Memory_Type memory_type_;
+      size_t byte_size_;
+    };
+
+    // Return in 'buffer' the buffer for 'name' in 'buffers' that holds
+    // at least 'byte_size' bytes, in the memory of the context's GPU
+    // if there is room or else in CPU memory. A new buffer holds
+    // 'capacity' bytes so that it fits the largest batch.
+    Status GetTensorBuffer(
+        std::unordered_map<std::string, TensorBuffer>* buffers,
+        const std::string& name, const size_t byte_size,
+        const size_t capacity, TensorBuffer** buffer);
+
+    // Gather the inputs of 'payloads' into one buffer per input and
+    // describe them in 'inputs' for a version 3 execution. The shapes
+    // referenced by 'inputs' are held in 'shapes'.
+    Status SetInputTensorsV3(
+        CustomBackend* base, std::vector<Scheduler::Payload>* payloads,
+        const uint32_t total_batch_size,
+        std::deque<std::vector<int64_t>>* shapes,
+        std::vector<CustomTensor>* inputs);
+
+    // Describe in 'outputs' the buffers that a version 3 execution
+    // writes the outputs required by 'payloads' into. The shapes
+    // referenced by 'outputs' are held in 'shapes'.
+    Status SetOutputTensorsV3(
+        CustomBackend* base, std::vector<Scheduler::Payload>* payloads,
+        const uint32_t total_batch_size,
+        std::deque<std::vector<int64_t>>* shapes,
+        std::vector<CustomTensor>* outputs);
+
+    // Copy the 'outputs' of a version 3 execution to 'payloads'.
+    void ReadOutputTensorsV3(
+        std::vector<Scheduler::Payload>* payloads,
+        const uint32_t total_batch_size,
+        const std::vector<CustomTensor>& outputs);
+
     // The handle to the shared library associated with this context.
     void* library_handle_;
 
@@ -140,11 +264,25 @@ class CustomBackend : public InferenceBackend {
     CustomErrorStringFn_t ErrorStringFn_;
     CustomExecuteFn_t ExecuteFn_;
     CustomExecuteV2Fn_t ExecuteV2Fn_;
+    CustomExecuteV3Fn_t ExecuteV3Fn_;
+    CustomExecuteAsyncFn_t ExecuteAsyncFn_;
 
     // The version of the custom interface.
     int custom_version_;
 
+    // The number of asynchronous executions allowed in flight and the
+    // number in flight.
+    uint32_t max_inflight_executions_;
+    std::mutex inflight_mu_;
+    std::condition_variable inflight_cv_;
+    uint32_t inflight_cnt_;
+
+    std::mutex input_buffers_mu_;
     std::vector<std::unique_ptr<char[]>> input_buffers_;
+
+    // The buffers of the version 3 executions.
+    std::unordered_map<std::string, TensorBuffer> input_tensor_buffers_;
+    std::unordered_map<std::string, TensorBuffer> output_tensor_buffers_;
   };
 
   std::vector<std::string> server_params_;
@@ -182,4 +320,8 @@ bool CustomGetOutputV2(
     int64_t* shape_dims, uint64_t content_byte_size, void** content,
     CustomMemoryType* memory_type);
 
+// Callback used by custom backends to complete an asynchronous
+// execution.
+void CustomExecuteComplete(void* complete_context, int error_code);
+
 }}  // namespace nvidia::inferenceserver
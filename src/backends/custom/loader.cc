@@ -63,7 +63,8 @@ LoadCustom(
     const std::string& path, void** dlhandle,
     CustomInitializeFn_t* InitializeFn, CustomFinalizeFn_t* FinalizeFn,
     CustomErrorStringFn_t* ErrorStringFn, CustomExecuteFn_t* ExecuteFn,
-    CustomExecuteV2Fn_t* ExecuteV2Fn, int* custom_version)
+    CustomExecuteV2Fn_t* ExecuteV2Fn, CustomExecuteV3Fn_t* ExecuteV3Fn,
+    CustomExecuteAsyncFn_t* ExecuteAsyncFn, int* custom_version)
 {
   *dlhandle = nullptr;
   *InitializeFn = nullptr;
@@ -71,6 +72,8 @@ LoadCustom(
   *ErrorStringFn = nullptr;
   *ExecuteFn = nullptr;
   *ExecuteV2Fn = nullptr;
+  *ExecuteV3Fn = nullptr;
+  *ExecuteAsyncFn = nullptr;
   *custom_version = 0;
 
   // Load the custom library
@@ -122,6 +125,12 @@ LoadCustom(
     case 2:
       status = GetEntrypoint(handle, "CustomExecuteV2", &exec_fn);
       break;
+    case 3:
+      status = GetEntrypoint(handle, "CustomExecuteV3", &exec_fn);
+      break;
+    case 4:
+      status = GetEntrypoint(handle, "CustomExecuteAsync", &exec_fn);
+      break;
     default:
       status = Status(
           RequestStatusCode::INVALID_ARG,
@@ -141,8 +150,12 @@ LoadCustom(
 
   if (*custom_version == 1) {
     *ExecuteFn = (CustomExecuteFn_t)exec_fn;
-  } else {
+  } else if (*custom_version == 2) {
     *ExecuteV2Fn = (CustomExecuteV2Fn_t)exec_fn;
+  } else if (*custom_version == 3) {
+    *ExecuteV3Fn = (CustomExecuteV3Fn_t)exec_fn;
+  } else {
+    *ExecuteAsyncFn = (CustomExecuteAsyncFn_t)exec_fn;
   }
 
   return Status::Success;
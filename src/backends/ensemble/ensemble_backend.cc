@@ -44,7 +44,8 @@ EnsembleBackend::Init(
   RETURN_IF_ERROR(SetModelConfig(path, config));
 
   std::unique_ptr<Scheduler> scheduler;
-  RETURN_IF_ERROR(EnsembleScheduler::Create(server, config, &scheduler));
+  RETURN_IF_ERROR(
+      EnsembleScheduler::Create(server, config, MetricReporter(), &scheduler));
   RETURN_IF_ERROR(SetScheduler(std::move(scheduler)));
 
   LOG_VERBOSE(1) << "ensemble backend for " << Name() << std::endl << *this;
@@ -344,8 +344,9 @@ AutoFillOnnx::Create(
     // Load session
     std::string onnx_file_content;
     RETURN_IF_ERROR(ReadTextFile(onnx_path, &onnx_file_content));
-    status =
-        OnnxLoader::LoadSession(onnx_file_content, session_options, &session);
+    status = OnnxLoader::LoadSession(
+        onnx_file_content, session_options,
+        false /* use_global_thread_pool */, &session);
 
     if (status.IsOk()) {
       local_autofill.reset(new AutoFillOnnxImpl(model_name, onnx_file));
@@ -39,6 +39,9 @@ OnnxLoader::~OnnxLoader()
   if (env_ != nullptr) {
     OrtReleaseEnv(env_);
   }
+  if (global_env_ != nullptr) {
+    OrtReleaseEnv(global_env_);
+  }
 }
 
 Status
@@ -89,22 +92,35 @@ OnnxLoader::Stop()
 Status
 OnnxLoader::LoadSession(
     const std::string& model_data, const OrtSessionOptions* session_options,
-    OrtSession** session)
+    const bool use_global_thread_pool, OrtSession** session)
 {
   if (loader != nullptr) {
+    OrtEnv* env = loader->env_;
     {
       std::lock_guard<std::mutex> lk(loader->mu_);
       if (loader->closing_) {
         return Status(
             RequestStatusCode::UNAVAILABLE, "OnnxLoader has been stopped");
-      } else {
-        loader->live_session_cnt_++;
       }
+
+      if (use_global_thread_pool) {
+        if (loader->global_env_ == nullptr) {
+          OrtThreadingOptions* threading_options;
+          RETURN_IF_ORT_ERROR(OrtCreateThreadingOptions(&threading_options));
+          OrtResourceWrapper<OrtThreadingOptions*> threading_options_wrapper(
+              threading_options, &OrtReleaseThreadingOptions);
+          RETURN_IF_ORT_ERROR(OrtCreateEnvWithGlobalThreadPools(
+              ORT_LOGGING_LEVEL_WARNING, "log", threading_options,
+              &loader->global_env_));
+        }
+        env = loader->global_env_;
+      }
+
+      loader->live_session_cnt_++;
     }
 
     OrtStatus* status = OrtCreateSessionFromArray(
-        loader->env_, model_data.c_str(), model_data.size(), session_options,
-        session);
+        env, model_data.c_str(), model_data.size(), session_options, session);
 
     if (status != nullptr) {
       TryRelease(true);
@@ -48,11 +48,14 @@ class OnnxLoader {
   ///
   /// \param model_path The path to the Onnx model
   /// \param session_options The options to use when creating the session
+  /// \param use_global_thread_pool Whether the session runs on the thread
+  /// pools shared by all sessions. 'session_options' must then disable the
+  /// per-session threads
   /// \param session Returns the Onnx model session
   /// \return Error status.
   static Status LoadSession(
       const std::string& model_path, const OrtSessionOptions* session_options,
-      OrtSession** session);
+      const bool use_global_thread_pool, OrtSession** session);
 
   /// Unload a Onnx model session
   ///
@@ -60,7 +63,10 @@ class OnnxLoader {
   static Status UnloadSession(OrtSession* session);
 
  private:
-  OnnxLoader(OrtEnv* env) : env_(env), live_session_cnt_(0), closing_(false) {}
+  OnnxLoader(OrtEnv* env)
+      : env_(env), global_env_(nullptr), live_session_cnt_(0), closing_(false)
+  {
+  }
 
   /// Decrease 'live_session_cnt_' if 'decrement_session_cnt' is true, and then
   /// release Onnx Runtime environment if it is closing and no live sessions
@@ -72,6 +78,11 @@ class OnnxLoader {
 
   OrtEnv* env_;
 
+  // The environment owning the shared thread pools. Created on the
+  // first load of a session that uses them so that the pools don't
+  // take threads otherwise.
+  OrtEnv* global_env_;
+
   std::mutex mu_;
   size_t live_session_cnt_;
   bool closing_;
@@ -26,11 +26,17 @@
 
 #include "src/backends/onnx/onnx_backend.h"
 
+#include <errno.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
 #include <mutex>
 #include "src/backends/onnx/loader.h"
 #include "src/backends/onnx/onnx_utils.h"
 #include "src/core/constants.h"
+#include "src/core/filesystem.h"
 #include "src/core/logging.h"
 #include "src/core/model_config_cuda.h"
 #include "src/core/model_config_utils.h"
@@ -49,10 +55,63 @@
 
 namespace nvidia { namespace inferenceserver {
 
+namespace {
+
+// Create directory 'path' and any of its parents that don't exist.
+Status
+MakeDirectories(const std::string& path)
+{
+  size_t pos = 0;
+  do {
+    pos = path.find('/', pos + 1);
+    const std::string dir = path.substr(0, pos);
+    if ((mkdir(dir.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH) != 0) &&
+        (errno != EEXIST)) {
+      return Status(
+          RequestStatusCode::INTERNAL, "failed to create directory '" + dir +
+                                           "': " + strerror(errno));
+    }
+  } while (pos != std::string::npos);
+
+  return Status::Success;
+}
+
+// Set the variables in 'env' in the environment of the process and
+// return in 'previous' whether each was set before and its value.
+void
+SetEnvironment(
+    const std::map<std::string, std::string>& env,
+    std::map<std::string, std::pair<bool, std::string>>* previous)
+{
+  for (const auto& pr : env) {
+    const char* value = getenv(pr.first.c_str());
+    (*previous)[pr.first] = (value == nullptr)
+                                ? std::make_pair(false, std::string())
+                                : std::make_pair(true, std::string(value));
+    setenv(pr.first.c_str(), pr.second.c_str(), 1 /* overwrite */);
+  }
+}
+
+// Restore the variables changed by SetEnvironment().
+void
+RestoreEnvironment(
+    const std::map<std::string, std::pair<bool, std::string>>& previous)
+{
+  for (const auto& pr : previous) {
+    if (pr.second.first) {
+      setenv(pr.first.c_str(), pr.second.second.c_str(), 1 /* overwrite */);
+    } else {
+      unsetenv(pr.first.c_str());
+    }
+  }
+}
+
+}  // namespace
+
 OnnxBackend::Context::Context(
     const std::string& name, const int gpu_device, const int max_batch_size)
     : BackendContext(name, gpu_device, max_batch_size), session_(nullptr),
-      allocator_(nullptr)
+      allocator_(nullptr), cuda_memory_info_(nullptr)
 {
 }
 
@@ -61,10 +120,32 @@ OnnxBackend::Context::~Context()
   LOG_VERBOSE(1) << "~OnnxBackend::Context ";
 
   ReleaseOrtRunResources();
+  for (auto buffers : {&input_buffers_, &output_buffers_}) {
+    for (auto& pr : *buffers) {
+      if (pr.second.tensor_ != nullptr) {
+        OrtReleaseValue(pr.second.tensor_);
+      }
+    }
+    buffers->clear();
+  }
+  if (cuda_memory_info_ != nullptr) {
+    OrtReleaseMemoryInfo(cuda_memory_info_);
+  }
+  // 'allocator_' is default allocator which is managed by ONNX Runtime
+}
+
+OnnxBackend::SharedSession::~SharedSession()
+{
   if (session_ != nullptr) {
     OnnxLoader::UnloadSession(session_);
   }
-  // 'allocator_' is default allocator which is managed by ONNX Runtime
+}
+
+OnnxBackend::~OnnxBackend()
+{
+  // The contexts must be destroyed before the sessions they use.
+  contexts_.clear();
+  sessions_.clear();
 }
 
 Status
@@ -78,9 +159,11 @@ OnnxBackend::Init(const std::string& path, const ModelConfig& config)
 
 Status
 OnnxBackend::CreateExecutionContexts(
-    const std::unordered_map<std::string, std::string>& models)
+    const std::unordered_map<std::string, std::string>& models,
+    const std::string& engine_cache_dir)
 {
-  // [TODO] configurable like optimization policy in Tensorflow models
+  RETURN_IF_ERROR(SetTensorRTSettings(engine_cache_dir));
+
   // Create a "prototype" session option, which will be cloned and set
   // context-specific option on context creation.
   OrtSessionOptions* session_options;
@@ -88,10 +171,48 @@ OnnxBackend::CreateExecutionContexts(
 
   OrtResourceWrapper<OrtSessionOptions*> options_wrapper(
       session_options, &OrtReleaseSessionOptions);
-  RETURN_IF_ORT_ERROR(OrtSetSessionThreadPoolSize(session_options, 1));
-  // disable graph optimization
+
+  const ModelOptimizationPolicy::OnnxRuntime& ort_config =
+      Config().optimization().onnxruntime();
+  if ((ort_config.intra_op_thread_count() < 0) ||
+      (ort_config.inter_op_thread_count() < 0)) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "thread counts of ONNX Runtime for " + Name() +
+            " must be non-negative");
+  }
+
+  if (ort_config.use_global_thread_pool()) {
+    RETURN_IF_ORT_ERROR(OrtDisablePerSessionThreads(session_options));
+  } else {
+    if (ort_config.intra_op_thread_count() > 0) {
+      RETURN_IF_ORT_ERROR(OrtSetIntraOpNumThreads(
+          session_options, ort_config.intra_op_thread_count()));
+    }
+    RETURN_IF_ORT_ERROR(OrtSetInterOpNumThreads(
+        session_options, std::max(1, ort_config.inter_op_thread_count())));
+  }
+
+  RETURN_IF_ORT_ERROR(OrtSetSessionExecutionMode(
+      session_options,
+      (ort_config.execution_mode() ==
+       ModelOptimizationPolicy::OnnxRuntime::PARALLEL)
+          ? ORT_PARALLEL
+          : ORT_SEQUENTIAL));
+
+  // Graph optimization is disabled unless the configuration sets a
+  // positive level.
+  GraphOptimizationLevel optimization_level = ORT_DISABLE_ALL;
+  const int level = Config().optimization().graph().level();
+  if (level == 1) {
+    optimization_level = ORT_ENABLE_BASIC;
+  } else if (level == 2) {
+    optimization_level = ORT_ENABLE_EXTENDED;
+  } else if (level >= 3) {
+    optimization_level = ORT_ENABLE_ALL;
+  }
   RETURN_IF_ORT_ERROR(
-      OrtSetSessionGraphOptimizationLevel(session_options, ORT_DISABLE_ALL));
+      OrtSetSessionGraphOptimizationLevel(session_options, optimization_level));
 
   Status status = CreateExecutionContextsHelper(session_options, models);
 
@@ -102,6 +223,84 @@ OnnxBackend::CreateExecutionContexts(
   return Status::Success;
 }
 
+Status
+OnnxBackend::SetTensorRTSettings(const std::string& engine_cache_dir)
+{
+  trt_env_.clear();
+  if (!Config().optimization().has_execution_accelerators()) {
+    return Status::Success;
+  }
+
+  bool use_trt = false;
+  std::string engine_cache_path;
+  for (const auto& execution_accelerator : Config()
+                                               .optimization()
+                                               .execution_accelerators()
+                                               .gpu_execution_accelerator()) {
+    if (execution_accelerator.name() != kTensorRTExecutionAccelerator) {
+      continue;
+    }
+
+    use_trt = true;
+    for (const auto& parameter : execution_accelerator.parameters()) {
+      if (parameter.first == "precision_mode") {
+        if (parameter.second == "FP32") {
+          trt_env_["ORT_TENSORRT_FP16_ENABLE"] = "0";
+          trt_env_["ORT_TENSORRT_INT8_ENABLE"] = "0";
+        } else if (parameter.second == "FP16") {
+          trt_env_["ORT_TENSORRT_FP16_ENABLE"] = "1";
+          trt_env_["ORT_TENSORRT_INT8_ENABLE"] = "0";
+        } else if (parameter.second == "INT8") {
+          trt_env_["ORT_TENSORRT_FP16_ENABLE"] = "0";
+          trt_env_["ORT_TENSORRT_INT8_ENABLE"] = "1";
+        } else {
+          return Status(
+              RequestStatusCode::INVALID_ARG, "unknown precision mode '" +
+                                                  parameter.second +
+                                                  "' is requested");
+        }
+      } else if (parameter.first == "max_workspace_size_bytes") {
+        try {
+          trt_env_["ORT_TENSORRT_MAX_WORKSPACE_SIZE"] =
+              std::to_string(std::stoull(parameter.second));
+        }
+        catch (const std::exception& ex) {
+          return Status(
+              RequestStatusCode::INVALID_ARG,
+              "failed to convert max_workspace_size_bytes '" +
+                  parameter.second + "' to integral number");
+        }
+      } else if (parameter.first == "engine_cache_path") {
+        engine_cache_path = parameter.second;
+      } else {
+        return Status(
+            RequestStatusCode::INVALID_ARG,
+            "unknown parameter '" + parameter.first +
+                "' is provided for TensorRT Execution Accelerator");
+      }
+    }
+  }
+
+  if (!use_trt) {
+    return Status::Success;
+  }
+
+  // Without a path of its own the model caches its engines in a
+  // directory for its version, since the provider names the engines
+  // by the subgraphs they compute and not by the model.
+  if (engine_cache_path.empty() && !engine_cache_dir.empty()) {
+    engine_cache_path = JoinPath(
+        {engine_cache_dir, "onnxruntime", Name(), std::to_string(Version())});
+  }
+  if (!engine_cache_path.empty()) {
+    RETURN_IF_ERROR(MakeDirectories(engine_cache_path));
+    trt_env_["ORT_TENSORRT_ENGINE_CACHE_ENABLE"] = "1";
+    trt_env_["ORT_TENSORRT_ENGINE_CACHE_PATH"] = engine_cache_path;
+  }
+
+  return Status::Success;
+}
+
 Status
 OnnxBackend::CreateExecutionContextsHelper(
     OrtSessionOptions* session_options,
@@ -211,6 +410,8 @@ OnnxBackend::CreateExecutionContext(
       session_options, &OrtReleaseSessionOptions);
 
   // Set execution execution_accelerators (execution providers in ONNX Runtime)
+  bool need_lock = false;
+  bool use_trt = false;
   if (gpu_device != Context::NO_GPU_DEVICE) {
 #ifdef TRTIS_ENABLE_GPU
     if (Config().optimization().has_execution_accelerators()) {
@@ -226,6 +427,8 @@ OnnxBackend::CreateExecutionContext(
             RETURN_IF_ORT_ERROR(
                 OrtSessionOptionsAppendExecutionProvider_Tensorrt(
                     session_options, gpu_device));
+            need_lock = true;
+            use_trt = true;
             LOG_VERBOSE(1) << "TensorRT Execution Accelerator is set for "
                            << instance_name << " on device " << gpu_device;
           } else {
@@ -254,7 +457,6 @@ OnnxBackend::CreateExecutionContext(
 #endif  // TRTIS_ENABLE_GPU
   }
 
-  bool need_lock = false;
   if (Config().optimization().has_execution_accelerators()) {
     for (const auto& execution_accelerator : Config()
                                                  .optimization()
@@ -281,17 +483,60 @@ OnnxBackend::CreateExecutionContext(
     }
   }
 
-  // ONNX session creation with OpenVINO is not thread-safe,
-  // so multiple creations are serialized with a global lock.
+  // ONNX session creation with OpenVINO is not thread-safe, and the
+  // TensorRT provider reads its settings from the environment of the
+  // process, so multiple creations are serialized with a global lock.
   static std::mutex global_context_mu;
   std::unique_lock<std::mutex> glock(global_context_mu, std::defer_lock);
   if (need_lock) {
     glock.lock();
   }
 
-  RETURN_IF_ERROR(OnnxLoader::LoadSession(
-      op_itr->second, session_options, &context->session_));
+  // Instances on CPU may share a session since a session can run
+  // concurrently. OpenVINO sessions are not shared because their
+  // creation isn't thread-safe so running them may not be either.
+  const bool share_session =
+      Config().optimization().onnxruntime().share_session() &&
+      (gpu_device == Context::NO_GPU_DEVICE) && !need_lock;
+  if (share_session) {
+    for (const auto& shared : sessions_) {
+      if (shared->shared_ && (shared->gpu_device_ == gpu_device)) {
+        context->session_ = shared->session_;
+        LOG_VERBOSE(1) << "Instance " << instance_name
+                       << " shares the session of " << Name();
+        break;
+      }
+    }
+  }
+
+  if (context->session_ == nullptr) {
+    std::map<std::string, std::pair<bool, std::string>> previous_env;
+    if (use_trt) {
+      SetEnvironment(trt_env_, &previous_env);
+    }
+    OrtSession* session = nullptr;
+    Status status = OnnxLoader::LoadSession(
+        op_itr->second, session_options,
+        Config().optimization().onnxruntime().use_global_thread_pool(),
+        &session);
+    RestoreEnvironment(previous_env);
+    RETURN_IF_ERROR(status);
+
+    std::unique_ptr<SharedSession> shared(new SharedSession());
+    shared->gpu_device_ = gpu_device;
+    shared->shared_ = share_session;
+    shared->session_ = session;
+    sessions_.push_back(std::move(shared));
+    context->session_ = session;
+  }
   RETURN_IF_ORT_ERROR(OrtGetAllocatorWithDefaultOptions(&context->allocator_));
+#ifdef TRTIS_ENABLE_GPU
+  if (gpu_device != Context::NO_GPU_DEVICE) {
+    RETURN_IF_ORT_ERROR(OrtCreateMemoryInfo(
+        "Cuda", OrtDeviceAllocator, gpu_device, OrtMemTypeDefault,
+        &context->cuda_memory_info_));
+  }
+#endif  // TRTIS_ENABLE_GPU
 
   // If this is a sequence model then make sure that the required
   // inputs are present in the model and have the correct shape and
@@ -304,7 +549,7 @@ OnnxBackend::CreateExecutionContext(
     RETURN_IF_ERROR(context->ValidateSequenceControl(
         Config().name(), Config().sequence_batching(),
         ModelSequenceBatching::Control::CONTROL_SEQUENCE_READY));
-    expected_input_cnt += 2;
+    expected_input_cnt += 2 + Config().sequence_batching().state_size();
   }
 
   RETURN_IF_ERROR(context->ValidateInputs(
@@ -545,11 +790,8 @@ OnnxBackend::Context::Run(
             name_ + "', max allowed is " + std::to_string(max_batch_size_));
   }
 
-  // Hold reference to each buffer of input data so that it stays
-  // until the inference has completed.
-  std::vector<std::unique_ptr<char[]>> input_buffers;
-
   std::vector<const char*> input_names;
+  bool cuda_copy = false;
 
   for (const auto& input : input_request_provider->RequestHeader().input()) {
     const std::string& name = input.name();
@@ -562,7 +804,7 @@ OnnxBackend::Context::Run(
     // into the corresponding tensor.
     RETURN_IF_ERROR(SetInputTensor(
         name, input_config->data_type(), input.dims(), total_batch_size,
-        payloads, &input_buffers, &input_names));
+        payloads, &input_names, &cuda_copy));
   }
 
   // Additional inputs added to the provider...
@@ -576,16 +818,30 @@ OnnxBackend::Context::Run(
 
       RETURN_IF_ERROR(SetInputTensor(
           name, override->datatype_, override->dims_, total_batch_size,
-          payloads, &input_buffers, &input_names));
+          payloads, &input_names, &cuda_copy));
     }
   }
 
-  // Request to retrieve all output specified in model config
-  // and reserve placeholder for output tensors
+#ifdef TRTIS_ENABLE_GPU
+  // ONNX Runtime reads the inputs on streams of its own.
+  if (cuda_copy) {
+    cudaStreamSynchronize(stream_);
+  }
+#endif  // TRTIS_ENABLE_GPU
+
+  // Request to retrieve all output specified in model config. The
+  // outputs with a shape known before the run are written into
+  // pre-allocated tensors, the others are allocated by the run.
   std::vector<const char*> output_names;
   for (const auto& output : base->Config().output()) {
     output_names.emplace_back(output.name().c_str());
     output_tensors_.emplace_back(nullptr);
+    RETURN_IF_ERROR(SetOutputTensor(
+        output, total_batch_size, payloads, &output_tensors_.back()));
+  }
+  std::vector<bool> allocated_by_run;
+  for (const auto& tensor : output_tensors_) {
+    allocated_by_run.push_back(tensor == nullptr);
   }
 
   for (auto& payload : *payloads) {
@@ -601,6 +857,12 @@ OnnxBackend::Context::Run(
       (const OrtValue* const*)input_tensors_.data(), input_tensors_.size(),
       output_names.data(), output_names.size(), output_tensors_.data()));
 
+  for (size_t idx = 0; idx < output_tensors_.size(); ++idx) {
+    if (allocated_by_run[idx] && (output_tensors_[idx] != nullptr)) {
+      run_tensors_.push_back(output_tensors_[idx]);
+    }
+  }
+
   for (auto& payload : *payloads) {
     if (payload.stats_ != nullptr) {
       payload.stats_->CaptureTimestamp(
@@ -617,12 +879,10 @@ Status
 OnnxBackend::Context::SetInputTensor(
     const std::string& name, const DataType data_type, const DimsList& dims,
     size_t total_batch_size, std::vector<Scheduler::Payload>* payloads,
-    std::vector<std::unique_ptr<char[]>>* input_buffers,
-    std::vector<const char*>* input_names)
+    std::vector<const char*>* input_names, bool* cuda_copy)
 {
   input_names->emplace_back(name.c_str());
   input_tensors_.emplace_back(nullptr);
-  input_buffers->emplace_back();
 
   size_t batch1_element_cnt = 1;
   std::vector<int64_t> input_dims;
@@ -664,44 +924,230 @@ OnnxBackend::Context::SetInputTensor(
     total_byte_size += expected_byte_sizes.back();
   }
 
-  // Reserve one more byte at the end of input_buffer to ensure last element
-  // of String data can become valid C string.
-  const size_t buffer_size =
-      total_byte_size + ((data_type != TYPE_STRING) ? 0 : 1);
-  input_buffers->back().reset((new char[buffer_size]));
-  char* buffer = input_buffers->back().get();
-
-  // Store data into input buffer
-  SetInputBuffer(
-      name, expected_byte_sizes, payloads, TRTSERVER_MEMORY_CPU, buffer);
-
   if (data_type != TYPE_STRING) {
-    const OrtMemoryInfo* allocator_info;
-    RETURN_IF_ORT_ERROR(OrtAllocatorGetInfo(allocator_, &allocator_info));
-    RETURN_IF_ORT_ERROR(OrtCreateTensorWithDataAsOrtValue(
-        allocator_info, (void*)input_buffers->back().get(), total_byte_size,
-        input_dims.data(), input_dims.size(), ConvertToOnnxDataType(data_type),
+    // Size a new buffer for the largest batch so that it is reused by
+    // all later runs.
+    size_t capacity = total_byte_size;
+    if ((max_batch_size_ != NO_BATCHING) && (total_batch_size != 0)) {
+      capacity = (total_byte_size / total_batch_size) * max_batch_size_;
+    }
+
+    // The inputs of a GPU context are staged in GPU memory so that
+    // ONNX Runtime doesn't copy them on every run.
+    const TRTSERVER_Memory_Type memory_type =
+        (gpu_device_ == NO_GPU_DEVICE) ? TRTSERVER_MEMORY_CPU
+                                       : TRTSERVER_MEMORY_GPU;
+    char* buffer;
+    TRTSERVER_Memory_Type buffer_memory_type;
+    RETURN_IF_ERROR(GetTensorBuffer(
+        &input_buffers_, name, data_type, input_dims, total_byte_size,
+        capacity, memory_type, &buffer, &buffer_memory_type,
         &input_tensors_.back()));
+
+    // Store data into input buffer
+    *cuda_copy |= SetInputBuffer(
+        name, expected_byte_sizes, payloads, buffer_memory_type, buffer);
   } else {
-    std::vector<const char*> string_data;
+    // Reserve one more byte at the end of input_buffer to ensure last element
+    // of String data can become valid C string.
+    const size_t buffer_size = total_byte_size + 1;
+    char* buffer;
+    TRTSERVER_Memory_Type buffer_memory_type;
+    RETURN_IF_ERROR(GetTensorBuffer(
+        &input_buffers_, name, data_type, input_dims, buffer_size,
+        buffer_size, TRTSERVER_MEMORY_CPU, &buffer, &buffer_memory_type,
+        nullptr /* tensor */));
+
+    // Store data into input buffer
+    SetInputBuffer(
+        name, expected_byte_sizes, payloads, TRTSERVER_MEMORY_CPU, buffer);
+
     // Onnx String tensor is created by passing array of C strings,
     // set such array and modify data in input buffer to be C strings
     SetStringInputBuffer(
         name, expected_byte_sizes, expected_element_cnts, payloads, buffer,
-        &string_data);
+        &string_data_);
     // Make sure to make the last string data valid C string
     buffer[total_byte_size] = 0;
 
+    // ONNX Runtime copies the strings into the tensor so the tensor
+    // can't be reused by the next run.
     RETURN_IF_ORT_ERROR(OrtCreateTensorAsOrtValue(
         allocator_, input_dims.data(), input_dims.size(),
         ONNX_TENSOR_ELEMENT_DATA_TYPE_STRING, &input_tensors_.back()));
+    run_tensors_.push_back(input_tensors_.back());
     RETURN_IF_ORT_ERROR(OrtFillStringTensor(
-        input_tensors_.back(), string_data.data(), string_data.size()));
+        input_tensors_.back(), string_data_.data(), string_data_.size()));
   }
 
   return Status::Success;
 }
 
+Status
+OnnxBackend::Context::SetOutputTensor(
+    const ModelOutput& output, const size_t total_batch_size,
+    std::vector<Scheduler::Payload>* payloads, OrtValue** tensor)
+{
+  *tensor = nullptr;
+
+  // Only a fixed-size output of a known shape can be pre-allocated.
+  const DimsList& dims =
+      output.has_reshape() ? output.reshape().shape() : output.dims();
+  if (output.data_type() == TYPE_STRING) {
+    return Status::Success;
+  }
+
+  std::vector<int64_t> shape;
+  if (max_batch_size_ != NO_BATCHING) {
+    shape.push_back(total_batch_size);
+  }
+  for (const auto dim : dims) {
+    if (dim < 0) {
+      return Status::Success;
+    }
+    shape.push_back(dim);
+  }
+
+  const size_t byte_size =
+      GetElementCount(shape) * GetDataTypeByteSize(output.data_type());
+  if (byte_size == 0) {
+    return Status::Success;
+  }
+
+  // If a single request needs the output then the run writes it
+  // straight into the response buffer.
+  // [TODO] currently ONNX output data are always on CPU
+  // https://github.com/microsoft/onnxruntime/issues/1621
+  const std::string& name = output.name();
+  if (payloads->size() == 1) {
+    auto& payload = payloads->front();
+    if (payload.status_.IsOk() && (payload.response_provider_ != nullptr) &&
+        payload.response_provider_->RequiresOutput(name)) {
+      void* buffer = nullptr;
+      Status status = payload.response_provider_->AllocateOutputBuffer(
+          name, &buffer, byte_size, shape, TRTSERVER_MEMORY_CPU);
+      if (!status.IsOk()) {
+        payload.status_ = status;
+      } else if (buffer != nullptr) {
+        RETURN_IF_ERROR(CreateTensor(
+            output.data_type(), shape, static_cast<char*>(buffer), byte_size,
+            TRTSERVER_MEMORY_CPU, tensor));
+        run_tensors_.push_back(*tensor);
+        direct_outputs_.insert(name);
+        return Status::Success;
+      }
+    }
+  }
+
+  size_t capacity = byte_size;
+  if ((max_batch_size_ != NO_BATCHING) && (total_batch_size != 0)) {
+    capacity = (byte_size / total_batch_size) * max_batch_size_;
+  }
+
+  char* buffer;
+  TRTSERVER_Memory_Type buffer_memory_type;
+  return GetTensorBuffer(
+      &output_buffers_, name, output.data_type(), shape, byte_size, capacity,
+      TRTSERVER_MEMORY_CPU, &buffer, &buffer_memory_type, tensor);
+}
+
+Status
+OnnxBackend::Context::GetTensorBuffer(
+    std::unordered_map<std::string, TensorBuffer>* buffers,
+    const std::string& name, const DataType data_type,
+    const std::vector<int64_t>& shape, const size_t byte_size,
+    const size_t capacity, const TRTSERVER_Memory_Type memory_type,
+    char** buffer, TRTSERVER_Memory_Type* buffer_memory_type,
+    OrtValue** tensor)
+{
+  TensorBuffer& tb = (*buffers)[name];
+
+  if ((tb.memory_ == nullptr) || (tb.byte_size_ < byte_size) ||
+      (tb.requested_memory_type_ != memory_type)) {
+    if (tb.tensor_ != nullptr) {
+      OrtReleaseValue(tb.tensor_);
+      tb.tensor_ = nullptr;
+    }
+    tb.shape_.clear();
+    tb.memory_.reset();
+
+    const size_t alloc_size =
+        std::max(std::max(capacity, byte_size), (size_t)1);
+#ifdef TRTIS_ENABLE_GPU
+    if (memory_type == TRTSERVER_MEMORY_GPU) {
+      cudaError_t err = cudaSetDevice(gpu_device_);
+      if (err != cudaSuccess) {
+        return Status(
+            RequestStatusCode::INTERNAL,
+            "unable to set device for '" + name_ +
+                "': " + std::string(cudaGetErrorString(err)));
+      }
+    }
+#endif  // TRTIS_ENABLE_GPU
+    tb.memory_.reset(new AllocatedSystemMemory(alloc_size, memory_type));
+    tb.buffer_ = tb.memory_->MutableBuffer(&tb.memory_type_);
+
+    // Fall back to CPU memory if GPU memory is exhausted.
+    if ((tb.buffer_ == nullptr) && (memory_type != TRTSERVER_MEMORY_CPU)) {
+      tb.memory_.reset(
+          new AllocatedSystemMemory(alloc_size, TRTSERVER_MEMORY_CPU));
+      tb.buffer_ = tb.memory_->MutableBuffer(&tb.memory_type_);
+    }
+    if (tb.buffer_ == nullptr) {
+      tb.memory_.reset();
+      return Status(
+          RequestStatusCode::INTERNAL, "unable to allocate " +
+                                           std::to_string(alloc_size) +
+                                           " bytes for tensor '" + name + "'");
+    }
+
+    tb.requested_memory_type_ = memory_type;
+    tb.byte_size_ = alloc_size;
+  }
+
+  *buffer = tb.buffer_;
+  *buffer_memory_type = tb.memory_type_;
+
+  if (tensor != nullptr) {
+    if ((tb.tensor_ == nullptr) || (tb.shape_ != shape)) {
+      if (tb.tensor_ != nullptr) {
+        OrtReleaseValue(tb.tensor_);
+        tb.tensor_ = nullptr;
+      }
+      RETURN_IF_ERROR(CreateTensor(
+          data_type, shape, tb.buffer_, byte_size, tb.memory_type_,
+          &tb.tensor_));
+      tb.shape_ = shape;
+    }
+    *tensor = tb.tensor_;
+  }
+
+  return Status::Success;
+}
+
+Status
+OnnxBackend::Context::CreateTensor(
+    const DataType data_type, const std::vector<int64_t>& shape, char* buffer,
+    const size_t byte_size, const TRTSERVER_Memory_Type memory_type,
+    OrtValue** tensor)
+{
+  const OrtMemoryInfo* memory_info = cuda_memory_info_;
+  if (memory_type == TRTSERVER_MEMORY_CPU) {
+    RETURN_IF_ORT_ERROR(OrtAllocatorGetInfo(allocator_, &memory_info));
+  }
+  if (memory_info == nullptr) {
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "unable to create tensor in GPU memory for '" + name_ + "'");
+  }
+
+  RETURN_IF_ORT_ERROR(OrtCreateTensorWithDataAsOrtValue(
+      memory_info, (void*)buffer, byte_size, shape.data(), shape.size(),
+      ConvertToOnnxDataType(data_type), tensor));
+
+  return Status::Success;
+}
+
 void
 OnnxBackend::Context::SetStringInputBuffer(
     const std::string& name, const std::vector<size_t>& expected_byte_sizes,
@@ -709,8 +1155,17 @@ OnnxBackend::Context::SetStringInputBuffer(
     std::vector<Scheduler::Payload>* payloads, char* input_buffer,
     std::vector<const char*>* string_data)
 {
+  // Size the string table for the whole batch up front and fill it
+  // in place.
+  size_t total_element_cnt = 0;
+  for (const size_t cnt : expected_element_cnts) {
+    total_element_cnt += cnt;
+  }
+  string_data->resize(total_element_cnt);
+
   // offset for each payload
   size_t buffer_copy_offset = 0;
+  size_t string_idx = 0;
   for (size_t idx = 0; idx < expected_byte_sizes.size(); idx++) {
     auto& payload = (*payloads)[idx];
     const size_t expected_byte_size = expected_byte_sizes[idx];
@@ -747,7 +1202,7 @@ OnnxBackend::Context::SetStringInputBuffer(
                   " bytes available");
           break;
         } else {
-          string_data->push_back(data_content);
+          (*string_data)[string_idx + element_cnt] = data_content;
           element_cnt++;
           data_content = data_content + len;
           remaining_bytes -= len;
@@ -755,20 +1210,21 @@ OnnxBackend::Context::SetStringInputBuffer(
       }
     }
 
-    FillStringData(string_data, expected_element_cnt - element_cnt);
+    FillStringData(
+        string_data, string_idx + element_cnt,
+        expected_element_cnt - element_cnt);
 
     buffer_copy_offset += expected_byte_size;
+    string_idx += expected_element_cnt;
   }
 }
 
 void
 OnnxBackend::Context::FillStringData(
-    std::vector<const char*>* string_data, size_t cnt)
+    std::vector<const char*>* string_data, size_t idx, size_t cnt)
 {
   static const char* empty = "";
-  for (size_t c = 0; c < cnt; c++) {
-    string_data->push_back(empty);
-  }
+  std::fill_n(string_data->begin() + idx, cnt, empty);
 }
 
 Status
@@ -781,6 +1237,11 @@ OnnxBackend::Context::ReadOutputTensors(
   for (size_t idx = 0; idx < output_names.size(); idx++) {
     std::string name = std::string(output_names[idx]);
 
+    // The run has already written the output into the response.
+    if (direct_outputs_.find(name) != direct_outputs_.end()) {
+      continue;
+    }
+
     const ModelOutput* output_config;
     RETURN_IF_ERROR(base->GetOutput(name, &output_config));
 
@@ -819,15 +1280,19 @@ OnnxBackend::Context::ReadOutputTensors(
       RETURN_IF_ORT_ERROR(
           OrtGetStringTensorDataLength(output_tensor, &total_length));
 
-      char content[total_length];
-      size_t offsets[element_count + 1];
+      // Read the strings into buffers kept by the context instead of
+      // on the stack, which a large batch of strings would overflow.
+      string_output_content_.resize(total_length);
+      string_output_offsets_.resize(element_count + 1);
       RETURN_IF_ORT_ERROR(OrtGetStringTensorContent(
-          output_tensor, content, total_length, offsets, element_count));
+          output_tensor, string_output_content_.data(), total_length,
+          string_output_offsets_.data(), element_count));
       // Mark "passed end byte offset"
-      offsets[element_count] = total_length;
+      string_output_offsets_[element_count] = total_length;
 
       SetStringOutputBuffer(
-          name, batch1_element_cnt, content, content_shape, offsets, payloads);
+          name, batch1_element_cnt, string_output_content_.data(),
+          content_shape, string_output_offsets_.data(), payloads);
     } else {
       // Fixed size data type...
       const size_t actual_byte_size =
@@ -920,21 +1385,16 @@ OnnxBackend::Context::SetStringOutputBuffer(
 void
 OnnxBackend::Context::ReleaseOrtRunResources()
 {
-  // Release input tensor if set
-  for (auto& tensor : input_tensors_) {
-    if (tensor != nullptr) {
-      OrtReleaseValue(tensor);
-    }
+  // Release the tensors created for the run. The tensors of
+  // 'input_buffers_' and 'output_buffers_' are kept for the next run.
+  for (auto& tensor : run_tensors_) {
+    OrtReleaseValue(tensor);
   }
-  input_tensors_.clear();
+  run_tensors_.clear();
 
-  // Release output tensor if set
-  for (auto& tensor : output_tensors_) {
-    if (tensor != nullptr) {
-      OrtReleaseValue(tensor);
-    }
-  }
+  input_tensors_.clear();
   output_tensors_.clear();
+  direct_outputs_.clear();
 }
 
 std::ostream&
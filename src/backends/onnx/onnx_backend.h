@@ -26,9 +26,13 @@
 #pragma once
 
 #include <onnxruntime_c_api.h>
+#include <map>
+#include <set>
+#include <unordered_map>
 #include "src/core/backend.h"
 #include "src/core/backend_context.h"
 #include "src/core/model_config.pb.h"
+#include "src/core/provider.h"
 #include "src/core/scheduler.h"
 #include "src/core/status.h"
 
@@ -38,19 +42,27 @@ class OnnxBackend : public InferenceBackend {
  public:
   OnnxBackend() = default;
   OnnxBackend(OnnxBackend&&) = default;
+  ~OnnxBackend();
 
   Status Init(const std::string& path, const ModelConfig& config);
 
   // Create a context for execution for each instance for the
-  // serialized plans specified in 'models'.
+  // serialized plans specified in 'models'. The engines built by the
+  // TensorRT execution provider are cached in a subdirectory of
+  // 'engine_cache_dir' unless it is empty.
   Status CreateExecutionContexts(
-      const std::unordered_map<std::string, std::string>& paths);
+      const std::unordered_map<std::string, std::string>& paths,
+      const std::string& engine_cache_dir);
   Status CreateExecutionContext(
       const std::string& instance_name, const int gpu_device,
       OrtSessionOptions* base_session_options,
       const std::unordered_map<std::string, std::string>& paths);
 
  private:
+  // Set in 'trt_env_' the settings of the TensorRT execution provider
+  // given by the parameters of the accelerator.
+  Status SetTensorRTSettings(const std::string& engine_cache_dir);
+
   // Helper function for CreateExecutionContexts() so that session_options
   // will be released properly regardless of possible errors
   Status CreateExecutionContextsHelper(
@@ -97,12 +109,59 @@ class OnnxBackend : public InferenceBackend {
     Status Run(
         const OnnxBackend* base, std::vector<Scheduler::Payload>* payloads);
 
-    // Set an input tensor from one or more payloads.
+    // Set an input tensor from one or more payloads. Set 'cuda_copy'
+    // to true if the input is copied asynchronously on 'stream_'.
     Status SetInputTensor(
         const std::string& name, const DataType data_type, const DimsList& dims,
         size_t total_batch_size, std::vector<Scheduler::Payload>* payloads,
-        std::vector<std::unique_ptr<char[]>>* input_buffers,
-        std::vector<const char*>* input_names);
+        std::vector<const char*>* input_names, bool* cuda_copy);
+
+    // Set in 'tensor' the pre-allocated tensor that the run writes
+    // output 'output' into, or nullptr if ONNX Runtime must allocate
+    // the output because its shape is not known before the run.
+    Status SetOutputTensor(
+        const ModelOutput& output, const size_t total_batch_size,
+        std::vector<Scheduler::Payload>* payloads, OrtValue** tensor);
+
+    // A buffer reused by the runs of the context for an input or
+    // output, and the tensor wrapping the buffer for the shape of the
+    // last run that used it.
+    struct TensorBuffer {
+      TensorBuffer()
+          : buffer_(nullptr), memory_type_(TRTSERVER_MEMORY_CPU),
+            requested_memory_type_(TRTSERVER_MEMORY_CPU), byte_size_(0),
+            tensor_(nullptr)
+      {
+      }
+      std::unique_ptr<AllocatedSystemMemory> memory_;
+      char* buffer_;
+      TRTSERVER_Memory_Type memory_type_;
+      TRTSERVER_Memory_Type requested_memory_type_;
+      size_t byte_size_;
+      std::vector<int64_t> shape_;
+      OrtValue* tensor_;
+    };
+
+    // Return in 'buffer' the buffer for 'name' in 'buffers' that holds
+    // at least 'byte_size' bytes, preferably in 'memory_type', and the
+    // memory type of the buffer in 'buffer_memory_type'. A new buffer
+    // holds 'capacity' bytes so that it fits the largest batch. If
+    // 'tensor' is not nullptr also return a tensor of 'data_type' and
+    // 'shape' using 'byte_size' bytes of the buffer.
+    Status GetTensorBuffer(
+        std::unordered_map<std::string, TensorBuffer>* buffers,
+        const std::string& name, const DataType data_type,
+        const std::vector<int64_t>& shape, const size_t byte_size,
+        const size_t capacity, const TRTSERVER_Memory_Type memory_type,
+        char** buffer, TRTSERVER_Memory_Type* buffer_memory_type,
+        OrtValue** tensor);
+
+    // Return in 'tensor' a tensor of 'data_type' and 'shape' that
+    // wraps 'byte_size' bytes of 'buffer' in 'memory_type'.
+    Status CreateTensor(
+        const DataType data_type, const std::vector<int64_t>& shape,
+        char* buffer, const size_t byte_size,
+        const TRTSERVER_Memory_Type memory_type, OrtValue** tensor);
 
     // Helper function to modify 'input_buffer' into format needed for creating
     // Onnx String tensor and to set meta data 'string_data'
@@ -112,8 +171,10 @@ class OnnxBackend : public InferenceBackend {
         std::vector<Scheduler::Payload>* payloads, char* input_buffer,
         std::vector<const char*>* string_data);
 
-    // Helper function to fill 'string_data' with 'cnt' number of empty string
-    void FillStringData(std::vector<const char*>* string_data, size_t cnt);
+    // Helper function to set 'cnt' entries of 'string_data' starting
+    // at 'idx' to empty string
+    void FillStringData(
+        std::vector<const char*>* string_data, size_t idx, size_t cnt);
 
     // Read output tensors into one or more payloads accordingly.
     Status ReadOutputTensors(
@@ -131,15 +192,57 @@ class OnnxBackend : public InferenceBackend {
     void ReleaseOrtRunResources();
 
     // Onnx Runtime variables that are used across runs
+    // The session of the context, owned by 'sessions_' of the
+    // backend.
     OrtSession* session_;
     OrtAllocator* allocator_;
 
+    // The memory info of tensors in the memory of the context's GPU,
+    // or nullptr for a CPU context.
+    OrtMemoryInfo* cuda_memory_info_;
+
+    // The buffers of the inputs and of the outputs with fixed shapes,
+    // reused from one run to the next. For a GPU context the
+    // non-string inputs are in GPU memory.
+    std::unordered_map<std::string, TensorBuffer> input_buffers_;
+    std::unordered_map<std::string, TensorBuffer> output_buffers_;
+
     // Onnx Runtime variables that will be reset and used for every run
     std::vector<OrtValue*> input_tensors_;
     std::vector<OrtValue*> output_tensors_;
+
+    // The tensors created for the current run only, and the outputs
+    // written by the current run directly into the response buffer.
+    std::vector<OrtValue*> run_tensors_;
+    std::set<std::string> direct_outputs_;
+
+    // The string element pointers of a string input, and the contents
+    // and offsets of a string output, reused from one tensor and one
+    // run to the next so that a batch of strings is marshalled
+    // without per-element allocations.
+    std::vector<const char*> string_data_;
+    std::vector<char> string_output_content_;
+    std::vector<size_t> string_output_offsets_;
   };
 
   std::vector<std::unique_ptr<Context>> contexts_;
+
+  // The sessions used by the contexts. A session created with
+  // 'shared_' set is used by all the contexts on its device that
+  // share sessions.
+  struct SharedSession {
+    ~SharedSession();
+    int gpu_device_;
+    bool shared_;
+    OrtSession* session_;
+  };
+
+  std::vector<std::unique_ptr<SharedSession>> sessions_;
+
+  // The environment variables that configure the TensorRT execution
+  // provider. ONNX Runtime reads the settings of the provider only
+  // from the environment so they are set while a session is created.
+  std::map<std::string, std::string> trt_env_;
 };
 
 std::ostream& operator<<(std::ostream& out, const OnnxBackend& pb);
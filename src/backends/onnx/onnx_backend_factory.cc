@@ -85,7 +85,8 @@ OnnxBackendFactory::CreateBackend(
   // requested for this model.
   std::unique_ptr<OnnxBackend> local_backend(new OnnxBackend);
   RETURN_IF_ERROR(local_backend->Init(path, model_config));
-  RETURN_IF_ERROR(local_backend->CreateExecutionContexts(models));
+  RETURN_IF_ERROR(local_backend->CreateExecutionContexts(
+      models, backend_config_->engine_cache_dir));
 
   *backend = std::move(local_backend);
   return Status::Success;
@@ -41,6 +41,11 @@ class OnnxBackendFactory {
     // Autofill missing required model configuration settings based on
     // model definition file.
     bool autofill;
+
+    // Directory to cache the engines built by the TensorRT execution
+    // provider in. Empty if engines are not cached unless the model
+    // configuration gives a directory.
+    std::string engine_cache_dir;
   };
 
   static Status Create(
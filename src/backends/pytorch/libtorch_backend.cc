@@ -26,9 +26,12 @@
 
 #include "src/backends/pytorch/libtorch_backend.h"
 
+#include <ATen/Parallel.h>
+#include <sched.h>
 #include <stdint.h>
 #include <exception>
 #include <memory>
+#include <mutex>
 #include "src/core/constants.h"
 #include "src/core/logging.h"
 #include "src/core/model_config_cuda.h"
@@ -38,6 +41,7 @@
 
 #ifdef TRTIS_ENABLE_GPU
 #include <c10/cuda/CUDACachingAllocator.h>
+#include <c10/cuda/CUDAGuard.h>
 #include <cuda_runtime_api.h>
 #endif  // TRTIS_ENABLE_GPU
 
@@ -47,6 +51,12 @@ struct LibTorchBackend::Context::InputMetaData {
   std::string name_;
   std::vector<int64_t> shape_;
   torch::ScalarType torch_type_;
+
+  // The data of the input, either in 'input_buffer_' or in place in
+  // the request.
+  const char* content_;
+  size_t byte_size_;
+  TRTSERVER_Memory_Type memory_type_;
   std::unique_ptr<AllocatedSystemMemory> input_buffer_;
 };
 
@@ -66,6 +76,27 @@ LibTorchBackend::Context::~Context()
   LOG_VERBOSE(1) << "~LibTorchBackend::Context ";
 }
 
+Status
+LibTorchBackend::Context::InitRunnerThread(const int intra_op_thread_count)
+{
+  // Threads started by this thread inherit its CPUs, so the bound
+  // must be set before LibTorch starts the intra-op threads.
+  if (!host_cpus_.empty()) {
+    RETURN_IF_ERROR(SetThreadCpuAffinity(host_cpus_));
+    LOG_VERBOSE(1) << "Instance " << name_ << " bound to "
+                   << host_cpus_.size() << " CPUs";
+  }
+
+  // LibTorch parallelizes an operator with OpenMP, whose thread count
+  // is a setting of the calling thread, so each instance gets its own
+  // team of intra-op threads.
+  if (intra_op_thread_count > 0) {
+    at::set_num_threads(intra_op_thread_count);
+  }
+
+  return Status::Success;
+}
+
 std::pair<bool, torch::ScalarType>
 ConvertDataTypeToTorchType(const DataType& dtype)
 {
@@ -140,25 +171,125 @@ Status
 LibTorchBackend::Init(const std::string& path, const ModelConfig& config)
 {
   RETURN_IF_ERROR(ValidateModelConfig(config, kPyTorchLibTorchPlatform));
+
+  const auto& libtorch = config.optimization().libtorch();
+  if ((libtorch.intra_op_thread_count() < 0) ||
+      (libtorch.inter_op_thread_count() < 0)) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "thread counts of LibTorch model '" + config.name() +
+            "' must not be negative");
+  }
+  if (libtorch.partition_host_cpus() &&
+      (libtorch.intra_op_thread_count() == 0)) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "partition_host_cpus of LibTorch model '" + config.name() +
+            "' requires intra_op_thread_count");
+  }
+
   RETURN_IF_ERROR(SetModelConfig(path, config));
 
   return Status::Success;
 }
 
+namespace {
+
+// Set the size of the inter-op thread pool of LibTorch, which is
+// shared by the whole process and can only be set before it starts.
+void
+SetInterOpThreadCount(const std::string& model_name, const int count)
+{
+  static std::mutex mu;
+  static int set_count = 0;
+
+  std::lock_guard<std::mutex> lock(mu);
+  if (set_count == 0) {
+    try {
+      at::set_num_interop_threads(count);
+      set_count = count;
+    }
+    catch (const std::exception& ex) {
+      LOG_WARNING << "Unable to set LibTorch inter-op thread count for '"
+                  << model_name << "': " << ex.what();
+    }
+  } else if (set_count != count) {
+    LOG_WARNING << "LibTorch inter-op thread count " << count << " of '"
+                << model_name << "' is ignored, the count is already "
+                << set_count;
+  }
+}
+
+// Get the CPUs that the server may run on.
+std::vector<int>
+GetAllowedCpus()
+{
+  std::vector<int> cpus;
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  if (sched_getaffinity(0, sizeof(cpuset), &cpuset) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &cpuset)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+
+  return cpus;
+}
+
+}  // namespace
+
 Status
 LibTorchBackend::CreateExecutionContexts(
     const std::unordered_map<std::string, std::string>& models)
 {
   uint32_t total_context_cnt = 0;
 
+  const auto& libtorch = Config().optimization().libtorch();
+  if (libtorch.inter_op_thread_count() > 0) {
+    SetInterOpThreadCount(Name(), libtorch.inter_op_thread_count());
+  }
+
   // Create a context for each instance.
   for (const auto& group : Config().instance_group()) {
+    // The CPU instances of the group take consecutive slices of its
+    // CPUs, wrapping around if there are more threads than CPUs.
+    std::vector<int> group_cpus;
+    if (libtorch.partition_host_cpus() &&
+        (group.kind() == ModelInstanceGroup::KIND_CPU)) {
+      group_cpus.assign(group.host_cpus().begin(), group.host_cpus().end());
+      if (group_cpus.empty()) {
+        group_cpus = GetAllowedCpus();
+      }
+    }
+
     for (int c = 0; c < group.count(); c++) {
       if (group.kind() == ModelInstanceGroup::KIND_CPU) {
         const std::string instance_name =
             group.name() + "_" + std::to_string(c) + "_cpu";
         RETURN_IF_ERROR(CreateExecutionContext(
             instance_name, Context::NO_GPU_DEVICE, models));
+        if (!group_cpus.empty()) {
+          const int thread_cnt = libtorch.intra_op_thread_count();
+          std::vector<int>& host_cpus = contexts_.back()->host_cpus_;
+          for (int t = 0; t < thread_cnt; t++) {
+            host_cpus.push_back(
+                group_cpus[(c * thread_cnt + t) % group_cpus.size()]);
+          }
+        }
+        total_context_cnt++;
+      } else if (group.kind() == ModelInstanceGroup::KIND_MULTI_GPU) {
+        // A single context spans all the GPUs of the group and takes
+        // the inputs on the first of them.
+        std::string instance_name = group.name() + "_" + std::to_string(c);
+        for (int gpu_device : group.gpus()) {
+          instance_name += "_gpu" + std::to_string(gpu_device);
+        }
+        const std::vector<int> gpu_devices(
+            group.gpus().begin(), group.gpus().end());
+        RETURN_IF_ERROR(CreateExecutionContext(
+            instance_name, gpu_devices.front(), models, gpu_devices));
         total_context_cnt++;
       } else {
         for (int gpu_device : group.gpus()) {
@@ -177,7 +308,10 @@ LibTorchBackend::CreateExecutionContexts(
   // this model. Each runner is exclusively tied to the context.
   RETURN_IF_ERROR(SetConfiguredScheduler(
       total_context_cnt,
-      [](uint32_t runner_idx) -> Status { return Status::Success; },
+      [this](uint32_t runner_idx) -> Status {
+        return contexts_[runner_idx]->InitRunnerThread(
+            Config().optimization().libtorch().intra_op_thread_count());
+      },
       [this](
           uint32_t runner_idx, std::vector<Scheduler::Payload>* payloads,
           std::function<void(Status)> func) {
@@ -190,7 +324,8 @@ LibTorchBackend::CreateExecutionContexts(
 Status
 LibTorchBackend::CreateExecutionContext(
     const std::string& instance_name, const int gpu_device,
-    const std::unordered_map<std::string, std::string>& models)
+    const std::unordered_map<std::string, std::string>& models,
+    const std::vector<int>& gpu_devices)
 {
   // For a GPU context, determine the model file to use for device
   // compute capability. CPU always uses the default model file.
@@ -240,6 +375,7 @@ LibTorchBackend::CreateExecutionContext(
 
   contexts_.emplace_back(new Context(instance_name, gpu_device, mbs));
   Context* context = contexts_.back().get();
+  context->gpu_devices_ = gpu_devices;
 
   RETURN_IF_ERROR(context->CreateCudaStream());
 
@@ -247,13 +383,24 @@ LibTorchBackend::CreateExecutionContext(
     context->device_ = torch::Device(torch::kCPU);
   } else {
     context->device_ = torch::Device(torch::kCUDA, gpu_device);
+#ifdef TRTIS_ENABLE_GPU
+    context->torch_stream_.reset(new c10::cuda::CUDAStream(
+        c10::cuda::getStreamFromPool(false /* isHighPriority */, gpu_device)));
+#endif  // TRTIS_ENABLE_GPU
   }
 
   try {
     // lp_itr->second is the torch model serialized to string
     std::istringstream model_stream(lp_itr->second);
-    context->torch_model_ = std::make_shared<torch::jit::script::Module>(
-        torch::jit::load(model_stream, context->device_));
+    if (gpu_devices.empty()) {
+      context->torch_model_ = std::make_shared<torch::jit::script::Module>(
+          torch::jit::load(model_stream, context->device_));
+    } else {
+      // A model that spans multiple GPUs places its parts on them
+      // itself, so it is loaded onto the devices it was saved on.
+      context->torch_model_ = std::make_shared<torch::jit::script::Module>(
+          torch::jit::load(model_stream));
+    }
 
     // load the torch model in eval mode (Solve PyTorch bug during saving model)
     // https://github.com/pytorch/pytorch/issues/26884
@@ -388,25 +535,41 @@ Status
 LibTorchBackend::Context::SetInputTensor(
     const InputMetaData& meta_data, torch::jit::IValue* tensor)
 {
-  TRTSERVER_Memory_Type memory_type;
-  size_t total_byte_size = meta_data.input_buffer_->TotalByteSize();
-  char* buffer = meta_data.input_buffer_->MutableBuffer(&memory_type);
+  // Input data in GPU memory may be on another GPU than the instance,
+  // in which case the tensor is copied to the instance's GPU below.
+  torch::Device content_device(torch::kCPU);
+  if (meta_data.memory_type_ == TRTSERVER_MEMORY_GPU) {
+#ifdef TRTIS_ENABLE_GPU
+    cudaPointerAttributes attributes;
+    cudaError_t err = cudaPointerGetAttributes(&attributes, meta_data.content_);
+    if (err != cudaSuccess) {
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "failed to get device of inference input '" + meta_data.name_ +
+              "': " + cudaGetErrorString(err));
+    }
+    content_device = torch::Device(torch::kCUDA, attributes.device);
+#else
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "GPU memory is not supported for inference input '" +
+            meta_data.name_ + "'");
+#endif  // TRTIS_ENABLE_GPU
+  }
 
   torch::TensorOptions options{meta_data.torch_type_};
-  auto updated_options = options.device(
-      (memory_type == TRTSERVER_MEMORY_CPU) ? torch::kCPU : torch::kCUDA);
-  torch::Tensor input_tensor =
-      torch::from_blob(buffer, meta_data.shape_, updated_options);
-  input_tensor = input_tensor.to(device_);
+  torch::Tensor input_tensor = torch::from_blob(
+      const_cast<char*>(meta_data.content_), meta_data.shape_,
+      options.device(content_device));
 
-  if (input_tensor.nbytes() != total_byte_size) {
+  if (input_tensor.nbytes() != meta_data.byte_size_) {
     return Status(
         RequestStatusCode::INTERNAL,
-        "unexpected size " + std::to_string(total_byte_size) +
+        "unexpected size " + std::to_string(meta_data.byte_size_) +
             " for inference input '" + meta_data.name_ + "', expecting " +
             std::to_string(input_tensor.nbytes()));
   }
-  *tensor = input_tensor;
+  *tensor = input_tensor.to(device_);
 
   return Status::Success;
 }
@@ -456,7 +619,7 @@ LibTorchBackend::Context::ReadFixedSizedOutputTensor(
       (device_ == torch::kCPU) ? TRTSERVER_MEMORY_CPU : TRTSERVER_MEMORY_GPU;
   *cuda_copy |= SetFixedSizeOutputBuffer(
       name, batch1_byte_size, (char*)content, content_shape,
-      content_memory_type, payloads);
+      content_memory_type, payloads, dtype);
 
   return Status::Success;
 }
@@ -468,6 +631,11 @@ LibTorchBackend::Context::GetOutputTensor(
     size_t* byte_size, std::vector<int64_t>* content_shape)
 {
   try {
+    // The outputs of a model that spans multiple GPUs can be on any of
+    // them, they are read from the device that took the inputs.
+    if ((*outputs_)[op_index].device() != device_) {
+      (*outputs_)[op_index] = (*outputs_)[op_index].to(device_);
+    }
     torch::Tensor output_flat = (*outputs_)[op_index].flatten();
 
     // verify output datatype matches datatype from model config
@@ -546,6 +714,23 @@ LibTorchBackend::Context::SetFixedSizedInputBuffer(
     const size_t total_byte_size, std::vector<Scheduler::Payload>* payloads,
     InputMetaData* meta_data, bool* cuda_copy)
 {
+  meta_data->byte_size_ = total_byte_size;
+
+  // The input of a single request that is in one chunk is used by the
+  // tensor in place. The buffer of the request outlives the run.
+  std::vector<InferRequestProvider::InputChunk> chunks;
+  if (payloads->size() == 1) {
+    auto& payload = payloads->front();
+    payload.status_ = payload.request_provider_->GetInputChunks(
+        name, total_byte_size, &chunks);
+    if (payload.status_.IsOk() && (chunks.size() == 1) &&
+        (chunks[0].byte_size_ == total_byte_size)) {
+      meta_data->content_ = static_cast<const char*>(chunks[0].content_);
+      meta_data->memory_type_ = chunks[0].memory_type_;
+      return Status::Success;
+    }
+  }
+
   // The entire input tensor must be delivered as a single
   // contiguous chunk so create a buffer large enough to hold the
   // entire dynamic batched input.
@@ -554,6 +739,36 @@ LibTorchBackend::Context::SetFixedSizedInputBuffer(
   meta_data->input_buffer_.reset(
       new AllocatedSystemMemory(total_byte_size, memory_type));
   char* buffer = meta_data->input_buffer_->MutableBuffer(&memory_type);
+  meta_data->content_ = buffer;
+  meta_data->memory_type_ = memory_type;
+
+  // The chunks of a single request were already taken from the
+  // request so gather them directly.
+  if (payloads->size() == 1) {
+    auto& payload = payloads->front();
+    size_t offset = 0;
+    for (const auto& chunk : chunks) {
+      if (!payload.status_.IsOk() ||
+          (offset + chunk.byte_size_ > total_byte_size)) {
+        break;
+      }
+      bool cuda_used = false;
+      payload.status_ = CopyBuffer(
+          name, chunk.memory_type_, memory_type, chunk.byte_size_,
+          chunk.content_, buffer + offset, &cuda_used, InputStream());
+      *cuda_copy |= cuda_used;
+      offset += chunk.byte_size_;
+    }
+    if (payload.status_.IsOk() && (offset != total_byte_size)) {
+      payload.status_ = Status(
+          RequestStatusCode::INVALID_ARG,
+          "unexpected size " + std::to_string(offset) +
+              " for inference input '" + name + "', expecting " +
+              std::to_string(total_byte_size));
+    }
+
+    return Status::Success;
+  }
 
   // Visit the payloads in order and copy the input tensors to 'buffer'.
   std::vector<size_t> expected_byte_sizes;
@@ -564,12 +779,24 @@ LibTorchBackend::Context::SetFixedSizedInputBuffer(
         request_header.batch_size() * batch1_byte_size);
   }
 
-  *cuda_copy |=
-      SetInputBuffer(name, expected_byte_sizes, payloads, memory_type, buffer);
+  *cuda_copy |= SetInputBuffer(
+      name, expected_byte_sizes, payloads, memory_type, buffer,
+      InputStream());
 
   return Status::Success;
 }
 
+cudaStream_t
+LibTorchBackend::Context::InputStream() const
+{
+#ifdef TRTIS_ENABLE_GPU
+  if (torch_stream_ != nullptr) {
+    return torch_stream_->stream();
+  }
+#endif  // TRTIS_ENABLE_GPU
+  return nullptr;
+}
+
 Status
 LibTorchBackend::Context::Run(
     const LibTorchBackend* base, std::vector<Scheduler::Payload>* payloads)
@@ -615,6 +842,16 @@ LibTorchBackend::Context::Run(
             name_ + "', max allowed is " + std::to_string(max_batch_size_));
   }
 
+#ifdef TRTIS_ENABLE_GPU
+  // A GPU instance copies its inputs and runs the model on its own
+  // stream, so no synchronization is needed between the two and the
+  // instances on a GPU can overlap.
+  std::unique_ptr<c10::cuda::CUDAStreamGuard> stream_guard;
+  if (torch_stream_ != nullptr) {
+    stream_guard.reset(new c10::cuda::CUDAStreamGuard(*torch_stream_));
+  }
+#endif  // TRTIS_ENABLE_GPU
+
   // Additional inputs added to the provider...
   const std::shared_ptr<InferRequestProvider::InputOverrideMap>&
       input_override_map = input_request_provider->GetInputOverride();
@@ -676,13 +913,13 @@ LibTorchBackend::Context::Run(
     }
   }
 #ifdef TRTIS_ENABLE_GPU
-  if (cuda_copy) {
+  if (cuda_copy && (torch_stream_ == nullptr)) {
     cudaStreamSynchronize(stream_);
   }
 #endif  // TRTIS_ENABLE_GPU
 
   for (size_t i = 0; i < inputs_.size(); i++) {
-    SetInputTensor(input_meta_data[i], &(inputs_[i]));
+    RETURN_IF_ERROR(SetInputTensor(input_meta_data[i], &(inputs_[i])));
   }
 
   for (auto& payload : *payloads) {
@@ -695,6 +932,14 @@ LibTorchBackend::Context::Run(
   // Run...
   RETURN_IF_ERROR(Execute(&inputs_, &outputs_));
 
+#ifdef TRTIS_ENABLE_GPU
+  // The outputs are copied to the payloads on 'stream_' so wait for
+  // the model to produce them.
+  if (torch_stream_ != nullptr) {
+    cudaStreamSynchronize(torch_stream_->stream());
+  }
+#endif  // TRTIS_ENABLE_GPU
+
   for (auto& payload : *payloads) {
     if (payload.stats_ != nullptr) {
       payload.stats_->CaptureTimestamp(
@@ -765,6 +1010,9 @@ LibTorchBackend::Context::Execute(
 {
   torch::jit::IValue model_outputs_;
 
+  // Inference doesn't need the autograd graph of the run.
+  torch::NoGradGuard no_grad;
+
   try {
     model_outputs_ = torch_model_->forward(*inputs_);
     auto model_outputs_tuple = model_outputs_.toTuple();
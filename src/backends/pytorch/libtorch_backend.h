@@ -37,6 +37,10 @@
 #include "src/core/scheduler.h"
 #include "src/core/status.h"
 
+#ifdef TRTIS_ENABLE_GPU
+#include <c10/cuda/CUDAStream.h>
+#endif  // TRTIS_ENABLE_GPU
+
 namespace nvidia { namespace inferenceserver {
 
 class AllocatedSystemMemory;
@@ -54,7 +58,8 @@ class LibTorchBackend : public InferenceBackend {
       const std::unordered_map<std::string, std::string>& paths);
   Status CreateExecutionContext(
       const std::string& instance_name, const int gpu_device,
-      const std::unordered_map<std::string, std::string>& paths);
+      const std::unordered_map<std::string, std::string>& paths,
+      const std::vector<int>& gpu_devices = std::vector<int>());
 
  private:
   // Run model on the context associated with 'runner_idx' to
@@ -79,6 +84,10 @@ class LibTorchBackend : public InferenceBackend {
     DISALLOW_COPY_AND_ASSIGN(Context);
     DISALLOW_MOVE(Context);
 
+    // Set up the threading of the instance from its runner thread,
+    // which the execution of the instance runs on.
+    Status InitRunnerThread(const int intra_op_thread_count);
+
     Status ValidateInputs(
         const ::google::protobuf::RepeatedPtrField<ModelInput>& ios);
     Status ValidateOutputs(
@@ -100,7 +109,9 @@ class LibTorchBackend : public InferenceBackend {
     Status Run(
         const LibTorchBackend* base, std::vector<Scheduler::Payload>* payloads);
 
-    // Helper function to set an input buffer from one or more payloads.
+    // Helper function to set an input buffer from one or more
+    // payloads. The input of a single request that is in one chunk is
+    // used in place instead of being copied.
     Status SetFixedSizedInputBuffer(
         const std::string& name, const size_t batch1_byte_size,
         const size_t total_byte_size, std::vector<Scheduler::Payload>* payloads,
@@ -126,10 +137,26 @@ class LibTorchBackend : public InferenceBackend {
         std::vector<torch::jit::IValue>* inputs_,
         std::vector<torch::Tensor>* outputs_);
 
+    // The stream to copy inputs on, or nullptr to copy them on
+    // 'stream_'.
+    cudaStream_t InputStream() const;
+
     std::shared_ptr<torch::jit::script::Module> torch_model_;
     torch::Device device_;
+
+#ifdef TRTIS_ENABLE_GPU
+    // The stream that the inputs are copied, and the model is run,
+    // on for a GPU instance so that the instances on a GPU can
+    // overlap. Null for a CPU instance.
+    std::unique_ptr<c10::cuda::CUDAStream> torch_stream_;
+#endif  // TRTIS_ENABLE_GPU
+
     std::unordered_map<std::string, int> input_index_map_;
     std::unordered_map<std::string, int> output_index_map_;
+
+    // The CPUs that the threads of the instance are bound to, empty
+    // if they are not bound by the instance.
+    std::vector<int> host_cpus_;
   };
 
   std::vector<std::unique_ptr<Context>> contexts_;
@@ -26,10 +26,14 @@
 
 #include "src/backends/tensorflow/base_backend.h"
 
+#include <ctype.h>
+#include <map>
 #include <set>
+#include <stdexcept>
 #include "src/backends/tensorflow/tf_utils.h"
 #include "src/backends/tensorflow/tf_virtual_device.h"
 #include "src/core/constants.h"
+#include "src/core/filesystem.h"
 #include "src/core/logging.h"
 #include "src/core/model_config.pb.h"
 #include "src/core/model_config_utils.h"
@@ -42,6 +46,67 @@
 
 namespace nvidia { namespace inferenceserver {
 
+namespace {
+
+// Model configuration parameters that configure the TensorFlow
+// sessions of the model.
+constexpr char kInterOpThreadsParameter[] = "TF_INTER_OP_THREADS";
+constexpr char kIntraOpThreadsParameter[] = "TF_INTRA_OP_THREADS";
+constexpr char kPerSessionThreadsParameter[] = "TF_PER_SESSION_THREADS";
+constexpr char kVirtualDevicePerInstanceParameter[] =
+    "TF_VIRTUAL_DEVICE_PER_INSTANCE";
+
+Status
+GetIntParameter(const ModelConfig& config, const char* key, int* value)
+{
+  const auto itr = config.parameters().find(key);
+  if (itr == config.parameters().end()) {
+    return Status::Success;
+  }
+
+  const std::string& str = itr->second.string_value();
+  try {
+    size_t pos;
+    *value = std::stoi(str, &pos);
+    if ((pos != str.size()) || (*value < 0)) {
+      throw std::invalid_argument(str);
+    }
+  }
+  catch (...) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "expected a non-negative integer for parameter '" + std::string(key) +
+            "' of model '" + config.name() + "', got '" + str + "'");
+  }
+
+  return Status::Success;
+}
+
+Status
+GetBoolParameter(const ModelConfig& config, const char* key, bool* value)
+{
+  const auto itr = config.parameters().find(key);
+  if (itr == config.parameters().end()) {
+    return Status::Success;
+  }
+
+  const std::string& str = itr->second.string_value();
+  if (str == "true") {
+    *value = true;
+  } else if (str == "false") {
+    *value = false;
+  } else {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "expected 'true' or 'false' for parameter '" + std::string(key) +
+            "' of model '" + config.name() + "', got '" + str + "'");
+  }
+
+  return Status::Success;
+}
+
+}  // namespace
+
 BaseBackend::Context::Context(
     const std::string& name, const int gpu_device, const int max_batch_size)
     : BackendContext(name, gpu_device, max_batch_size),
@@ -52,6 +117,11 @@ BaseBackend::Context::Context(
 BaseBackend::Context::~Context()
 {
   LOG_VERBOSE(1) << "~BaseBackend::Context ";
+
+  for (auto& pr : input_tensors_) {
+    TRTISTF_TensorDelete(pr.second);
+  }
+  input_tensors_.clear();
 }
 
 Status
@@ -75,19 +145,24 @@ BaseBackend::CreateExecutionContexts(
 
   uint32_t total_context_cnt = 0;
 
+  // The number of instances created so far on each GPU.
+  std::map<int, size_t> gpu_instance_cnts;
+
   for (const auto& group : Config().instance_group()) {
     for (int c = 0; c < group.count(); c++) {
       if (group.kind() == ModelInstanceGroup::KIND_CPU) {
         const std::string instance_name =
             group.name() + "_" + std::to_string(c) + "_cpu";
         RETURN_IF_ERROR(CreateExecutionContext(
-            instance_name, Context::NO_GPU_DEVICE, backend_config, paths));
+            instance_name, Context::NO_GPU_DEVICE, 0 /* device_instance_idx */,
+            backend_config, paths));
         total_context_cnt++;
       } else if (group.kind() == ModelInstanceGroup::KIND_MODEL) {
         const std::string instance_name =
             group.name() + "_" + std::to_string(c) + "_model_device";
         RETURN_IF_ERROR(CreateExecutionContext(
-            instance_name, Context::MODEL_DEVICE, backend_config, paths));
+            instance_name, Context::MODEL_DEVICE, 0 /* device_instance_idx */,
+            backend_config, paths));
         total_context_cnt++;
       } else {
         for (int gpu_device : group.gpus()) {
@@ -95,7 +170,8 @@ BaseBackend::CreateExecutionContexts(
                                             std::to_string(c) + "_gpu" +
                                             std::to_string(gpu_device);
           RETURN_IF_ERROR(CreateExecutionContext(
-              instance_name, gpu_device, backend_config, paths));
+              instance_name, gpu_device, gpu_instance_cnts[gpu_device]++,
+              backend_config, paths));
           total_context_cnt++;
         }
       }
@@ -121,14 +197,35 @@ BaseBackend::CreateExecutionContexts(
 Status
 BaseBackend::CreateExecutionContext(
     const std::string& instance_name, const int gpu_device,
+    const size_t device_instance_idx,
     const std::shared_ptr<GraphDefBackendFactory::Config>& backend_config,
     const std::unordered_map<std::string, std::string>& paths)
 {
+  TRTISTF_SessionThreadConfig thread_config;
+  thread_config.inter_op_threads_ = 0;
+  thread_config.intra_op_threads_ = 0;
+  thread_config.use_per_session_threads_ = false;
+  bool vgpu_per_instance = false;
+  RETURN_IF_ERROR(GetIntParameter(
+      Config(), kInterOpThreadsParameter, &thread_config.inter_op_threads_));
+  RETURN_IF_ERROR(GetIntParameter(
+      Config(), kIntraOpThreadsParameter, &thread_config.intra_op_threads_));
+  RETURN_IF_ERROR(GetBoolParameter(
+      Config(), kPerSessionThreadsParameter,
+      &thread_config.use_per_session_threads_));
+  RETURN_IF_ERROR(GetBoolParameter(
+      Config(), kVirtualDevicePerInstanceParameter, &vgpu_per_instance));
+
   // For a GPU context, determine the model file to use for device
   // compute capability. CPU always uses the default model file.
   std::string cc_model_filename;
   int vgpu_device = gpu_device;
 
+  // Converted TF-TRT graphs only run on the kind of GPU they were
+  // converted for, so the cache is keyed by the GPU SKU and compute
+  // capability. Empty unless the context uses a specific GPU.
+  std::string gpu_key;
+
   if (gpu_device == Context::NO_GPU_DEVICE) {
     cc_model_filename = Config().default_model_filename();
 
@@ -152,15 +249,32 @@ BaseBackend::CreateExecutionContext(
 
     const std::string cc =
         std::to_string(cuprops.major) + "." + std::to_string(cuprops.minor);
+
+    gpu_key = cuprops.name;
+    for (auto& c : gpu_key) {
+      if (!isalnum(static_cast<unsigned char>(c))) {
+        c = '_';
+      }
+    }
+    gpu_key += "_" + cc;
+
     const auto& cc_itr = Config().cc_model_filenames().find(cc);
     cc_model_filename = (cc_itr == Config().cc_model_filenames().end())
                             ? Config().default_model_filename()
                             : cc_itr->second;
 
-    // Get virtual device tracker instance, and get next device id
+    // Get virtual device tracker instance, and get next device id.
+    // The instances of a model that asks for a virtual device per
+    // instance are spread over the virtual devices of the GPU so that
+    // they don't share a device, and so its streams.
     if (VirtualDeviceTracker::HasVirtualDevice()) {
-      RETURN_IF_ERROR(
-          VirtualDeviceTracker::GetNextVirtualDevice(gpu_device, &vgpu_device));
+      if (vgpu_per_instance) {
+        RETURN_IF_ERROR(VirtualDeviceTracker::GetVirtualDevice(
+            gpu_device, device_instance_idx, &vgpu_device));
+      } else {
+        RETURN_IF_ERROR(VirtualDeviceTracker::GetNextVirtualDevice(
+            gpu_device, &vgpu_device));
+      }
     }
 
     LOG_INFO << "Creating instance " << instance_name << " on GPU "
@@ -194,6 +308,10 @@ BaseBackend::CreateExecutionContext(
 
   TRTISTF_TFTRTConfig* tftrt_config_ptr = nullptr;
   TRTISTF_TFTRTConfig tftrt_config;
+  std::string tftrt_cache_path;
+  std::vector<const char*> tftrt_output_names;
+  bool has_graph_level = Config().optimization().has_graph();
+  int graph_level = Config().optimization().graph().level();
   if (Config().optimization().has_execution_accelerators()) {
     // Set default values
     tftrt_config.minimum_segment_size_ = 3;
@@ -201,6 +319,9 @@ BaseBackend::CreateExecutionContext(
     tftrt_config.max_batch_size_ = std::max(Config().max_batch_size(), 1);
     tftrt_config.precision_mode_ = TRTISTF_MODE_FP32;
     tftrt_config.is_dynamic_op_ = false;
+    tftrt_config.cache_path_ = nullptr;
+    tftrt_config.output_names_ = nullptr;
+    tftrt_config.output_count_ = 0;
     for (const auto& io : Config().input()) {
       const auto& dims = io.has_reshape() ? io.reshape().shape() : io.dims();
       for (const auto& dim : dims) {
@@ -235,6 +356,8 @@ BaseBackend::CreateExecutionContext(
                                                  .execution_accelerators()
                                                  .gpu_execution_accelerator()) {
       if (execution_accelerator.name() == kTensorRTExecutionAccelerator) {
+        std::string engine_cache_path;
+
         // Validate and set parameters
         for (const auto& parameter : execution_accelerator.parameters()) {
           if (parameter.first == "precision_mode") {
@@ -271,6 +394,8 @@ BaseBackend::CreateExecutionContext(
                   "failed to convert max_workspace_size_bytes '" +
                       parameter.second + "' to integral number");
             }
+          } else if (parameter.first == "engine_cache_path") {
+            engine_cache_path = parameter.second;
           } else {
             return Status(
                 RequestStatusCode::INVALID_ARG,
@@ -280,6 +405,67 @@ BaseBackend::CreateExecutionContext(
         }
         LOG_VERBOSE(1) << "TensorRT Execution Accelerator is set for "
                        << instance_name;
+        tftrt_config_ptr = &tftrt_config;
+
+        // Without a path of its own the model caches its converted
+        // graphs in a directory for its version. Within it the
+        // graphs are keyed by GPU, model file and conversion settings
+        // since any of them changes the converted graph.
+        if (engine_cache_path.empty() &&
+            !graphdef_backend_config->engine_cache_dir.empty()) {
+          engine_cache_path = JoinPath(
+              {graphdef_backend_config->engine_cache_dir, "tensorflow",
+               Name(), std::to_string(Version())});
+        }
+        if (!engine_cache_path.empty() && !gpu_key.empty()) {
+          const char* precision =
+              (tftrt_config.precision_mode_ == TRTISTF_MODE_FP16)
+                  ? "FP16"
+                  : (tftrt_config.precision_mode_ == TRTISTF_MODE_INT8)
+                        ? "INT8"
+                        : "FP32";
+          tftrt_cache_path = JoinPath(
+              {engine_cache_path, gpu_key,
+               cc_model_filename + "_" + precision + "_s" +
+                   std::to_string(tftrt_config.minimum_segment_size_) +
+                   "_w" +
+                   std::to_string(tftrt_config.max_workspace_size_bytes_) +
+                   "_b" + std::to_string(tftrt_config.max_batch_size_) +
+                   (tftrt_config.is_dynamic_op_ ? "_dynamic" : "") +
+                   ".tftrt"});
+          for (const auto& io : Config().output()) {
+            tftrt_output_names.push_back(io.name().c_str());
+          }
+          tftrt_config.cache_path_ = tftrt_cache_path.c_str();
+          tftrt_config.output_names_ = tftrt_output_names.data();
+          tftrt_config.output_count_ = tftrt_output_names.size();
+        }
+      } else if (execution_accelerator.name() == kXLAExecutionAccelerator) {
+        // XLA auto-clustering is the graph optimization of TensorFlow
+        // so the accelerator overrides the graph optimization level.
+        has_graph_level = true;
+        graph_level = 1;
+        for (const auto& parameter : execution_accelerator.parameters()) {
+          if (parameter.first == "level") {
+            if (parameter.second == "1") {
+              graph_level = 1;
+            } else if (parameter.second == "2") {
+              graph_level = 2;
+            } else {
+              return Status(
+                  RequestStatusCode::INVALID_ARG,
+                  "unknown XLA level '" + parameter.second +
+                      "' is requested, expecting '1' or '2'");
+            }
+          } else {
+            return Status(
+                RequestStatusCode::INVALID_ARG,
+                "unknown parameter '" + parameter.first +
+                    "' is provided for XLA Execution Accelerator");
+          }
+        }
+        LOG_VERBOSE(1) << "XLA Execution Accelerator is set for "
+                       << instance_name << " with level " << graph_level;
       } else {
         return Status(
             RequestStatusCode::INVALID_ARG, "unknown Execution Accelerator '" +
@@ -287,14 +473,13 @@ BaseBackend::CreateExecutionContext(
                                                 "' is requested");
       }
     }
-    tftrt_config_ptr = &tftrt_config;
   }
 
   RETURN_IF_ERROR(CreateTRTISTFModel(
-      graphdef_backend_config, vgpu_device, Config().optimization().has_graph(),
-      Config().optimization().graph().level(), gdp_itr->second,
+      graphdef_backend_config, vgpu_device, has_graph_level, graph_level,
+      gdp_itr->second,
       &context->trtistf_model_, &context->input_name_map_,
-      &context->output_name_map_, tftrt_config_ptr));
+      &context->output_name_map_, tftrt_config_ptr, &thread_config));
 
   return Status::Success;
 }
@@ -376,9 +561,7 @@ namespace {
 void
 FillStringTensor(TRTISTF_Tensor* tensor, const size_t idx, const size_t cnt)
 {
-  for (size_t c = 0; c < cnt; ++c) {
-    TRTISTF_TensorSetString(tensor, idx + c, nullptr);
-  }
+  TRTISTF_TensorSetStrings(tensor, idx, cnt, nullptr, nullptr, nullptr);
 }
 
 void
@@ -400,27 +583,19 @@ ReadStringOutputTensor(
     // the output tensor.
     if ((payload.response_provider_ != nullptr) &&
         payload.response_provider_->RequiresOutput(output_name)) {
-      // Serialize the output tensor strings. Each string is
-      // serialized as a 4-byte length followed by the string itself
-      // with no null-terminator.
-      std::string serialized;
-      for (size_t e = 0; e < expected_element_cnt; ++e) {
-        const char* cstr = TRTISTF_TensorString(tensor, tensor_element_idx + e);
-        const uint32_t len = strlen(cstr);
-        serialized.append(
-            reinterpret_cast<const char*>(&len), sizeof(uint32_t));
-        if (len > 0) {
-          serialized.append(cstr);
-        }
-      }
+      // Serialize the output tensor strings directly into the output
+      // buffer. Each string is serialized as a 4-byte length followed
+      // by the string itself with no null-terminator.
+      const size_t serialized_byte_size = TRTISTF_TensorSerializeStrings(
+          tensor, tensor_element_idx, expected_element_cnt, nullptr);
 
       void* content;
       Status status = payload.response_provider_->AllocateOutputBuffer(
-          output_name, &content, serialized.size(), shape);
+          output_name, &content, serialized_byte_size, shape);
       if (status.IsOk()) {
-        memcpy(
-            content, reinterpret_cast<const void*>(serialized.c_str()),
-            serialized.size());
+        TRTISTF_TensorSerializeStrings(
+            tensor, tensor_element_idx, expected_element_cnt,
+            static_cast<char*>(content));
       } else {
         payload.status_ = status;
       }
@@ -461,17 +636,78 @@ BaseBackend::Context::SetInput(
   }
 
   const TRTISTF_DataType dtype = ConvertDataType(datatype);
-  TRTISTF_Tensor* tensor = TRTISTF_TensorNew(
-      input_tensor_name->c_str(), dtype, shape.size(),
-      (shape.size() == 0) ? nullptr : &shape[0]);
-  if (tensor == nullptr) {
-    return Status(
-        RequestStatusCode::INTERNAL,
-        "failed to create input tensor '" + name + "' with shape " +
-            DimsListToString(shape) + " and data type " +
-            DataType_Name(datatype) + " for '" + name_ + "'");
+
+  // The input of a single request that is in one chunk of host memory
+  // is used by the tensor in place. The buffer of the request outlives
+  // the run.
+  if ((dtype != TRTISTF_DataType::TRTISTF_TYPE_STRING) &&
+      (payloads->size() == 1) && payloads->front().status_.IsOk()) {
+    auto& payload = payloads->front();
+    const size_t byte_size =
+        batch1_element_cnt * total_batch_size * GetDataTypeByteSize(datatype);
+    std::vector<InferRequestProvider::InputChunk> chunks;
+    payload.status_ =
+        payload.request_provider_->GetInputChunks(name, byte_size, &chunks);
+
+    TRTISTF_Tensor* tensor = nullptr;
+    if (payload.status_.IsOk() && (chunks.size() == 1) &&
+        (chunks[0].memory_type_ == TRTSERVER_MEMORY_CPU) &&
+        (chunks[0].byte_size_ == byte_size)) {
+      tensor = TRTISTF_TensorNewWithData(
+          input_tensor_name->c_str(), dtype, shape.size(),
+          (shape.size() == 0) ? nullptr : &shape[0],
+          const_cast<char*>(static_cast<const char*>(chunks[0].content_)),
+          byte_size);
+    }
+
+    if (tensor != nullptr) {
+      *input_tensors = TRTISTF_TensorListNew(tensor, *input_tensors);
+      return Status::Success;
+    }
+
+    // Otherwise gather the chunks into a tensor of its own.
+    RETURN_IF_ERROR(GetInputTensor(*input_tensor_name, dtype, shape, &tensor));
+    *input_tensors = TRTISTF_TensorListNew(tensor, *input_tensors);
+    if (TRTISTF_TensorDataByteSize(tensor) != byte_size) {
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "failed to create input tensor '" + name +
+              "' with expected byte size " + std::to_string(byte_size) +
+              ", got " + std::to_string(TRTISTF_TensorDataByteSize(tensor)));
+    }
+
+    bool cuda_copy = false;
+    size_t offset = 0;
+    for (const auto& chunk : chunks) {
+      if (!payload.status_.IsOk() || (offset + chunk.byte_size_ > byte_size)) {
+        break;
+      }
+      bool cuda_used = false;
+      payload.status_ = CopyBuffer(
+          name, chunk.memory_type_, TRTSERVER_MEMORY_CPU, chunk.byte_size_,
+          chunk.content_, TRTISTF_TensorData(tensor) + offset, &cuda_used);
+      cuda_copy |= cuda_used;
+      offset += chunk.byte_size_;
+    }
+    if (payload.status_.IsOk() && (offset != byte_size)) {
+      payload.status_ = Status(
+          RequestStatusCode::INVALID_ARG,
+          "unexpected size " + std::to_string(offset) +
+              " for inference input '" + name + "', expecting " +
+              std::to_string(byte_size));
+    }
+#ifdef TRTIS_ENABLE_GPU
+    if (cuda_copy) {
+      cudaStreamSynchronize(stream_);
+    }
+#endif  // TRTIS_ENABLE_GPU
+
+    return Status::Success;
   }
 
+  TRTISTF_Tensor* tensor;
+  RETURN_IF_ERROR(GetInputTensor(*input_tensor_name, dtype, shape, &tensor));
+
   TRTISTF_TensorList* tlink = TRTISTF_TensorListNew(tensor, *input_tensors);
   *input_tensors = tlink;
 
@@ -495,6 +731,64 @@ BaseBackend::Context::SetInput(
   return Status::Success;
 }
 
+Status
+BaseBackend::Context::GetInputTensor(
+    const std::string& tensor_name, const TRTISTF_DataType dtype,
+    const std::vector<int64_t>& shape, TRTISTF_Tensor** tensor)
+{
+  *tensor = nullptr;
+
+  const auto itr = input_tensors_.find(tensor_name);
+  if (itr != input_tensors_.end()) {
+    TRTISTF_Tensor* prev = itr->second;
+    input_tensors_.erase(itr);
+
+    const TRTISTF_Shape* prev_shape = TRTISTF_TensorShape(prev);
+    bool same_shape = (TRTISTF_TensorDataType(prev) == dtype) &&
+                      (prev_shape->rank_ == shape.size());
+    for (size_t i = 0; same_shape && (i < shape.size()); ++i) {
+      same_shape = (prev_shape->dims_[i] == shape[i]);
+    }
+
+    if (same_shape && TRTISTF_TensorIsReusable(prev)) {
+      *tensor = prev;
+      return Status::Success;
+    }
+
+    TRTISTF_TensorDelete(prev);
+  }
+
+  *tensor = TRTISTF_TensorNew(
+      tensor_name.c_str(), dtype, shape.size(),
+      (shape.size() == 0) ? nullptr : const_cast<int64_t*>(&shape[0]));
+  if (*tensor == nullptr) {
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "failed to create input tensor '" + tensor_name + "' with shape " +
+            DimsListToString(shape) + " and data type " +
+            DataType_Name(ConvertDataType(dtype)) + " for '" + name_ + "'");
+  }
+
+  return Status::Success;
+}
+
+void
+BaseBackend::Context::KeepInputTensors(TRTISTF_TensorList* input_tensors)
+{
+  for (TRTISTF_TensorList* itr = input_tensors; itr != nullptr;
+       itr = itr->next_) {
+    if ((itr->tensor_ != nullptr) && TRTISTF_TensorIsReusable(itr->tensor_)) {
+      const std::string tensor_name = TRTISTF_TensorName(itr->tensor_);
+      auto& kept = input_tensors_[tensor_name];
+      if (kept != nullptr) {
+        TRTISTF_TensorDelete(kept);
+      }
+      kept = itr->tensor_;
+      itr->tensor_ = nullptr;
+    }
+  }
+}
+
 void
 BaseBackend::Context::SetFixedSizedInputTensor(
     TRTISTF_Tensor* tensor, const std::string& input_name,
@@ -524,6 +818,12 @@ BaseBackend::Context::SetStringInputTensor(
 {
   size_t tensor_element_idx = 0;
 
+  // The offset and byte size of each string of a payload within its
+  // content, reused across the payloads so that the strings are set
+  // into the tensor with one call per payload.
+  std::vector<size_t> offsets;
+  std::vector<size_t> byte_sizes;
+
   // Visit the payloads in order and copy the input values into the
   // input tensor. Skip payloads that had errors since they are not
   // included in the dynamic batch.
@@ -534,34 +834,48 @@ BaseBackend::Context::SetStringInputTensor(
         request_header.batch_size() * batch1_element_cnt;
     size_t element_idx = 0;
 
-    // For string data type, we always need to copy the data to CPU so that
-    // we can read string length and construct the string properly.
-    auto src_memory_type = TRTSERVER_MEMORY_CPU;
-    const void* vcontent;
-    size_t content_byte_size = expected_element_cnt * sizeof(uint32_t);
-    payload.status_ = payload.request_provider_->GetNextInputContent(
-        input_name, &vcontent, &content_byte_size, &src_memory_type, true);
+    // For string data type, we always need the data to be contiguous
+    // in CPU memory so that we can read string length and construct
+    // the string properly.
+    std::vector<InferRequestProvider::InputChunk> chunks;
+    payload.status_ = payload.request_provider_->GetInputChunks(
+        input_name, expected_element_cnt * sizeof(uint32_t), &chunks);
 
-    const char* content = reinterpret_cast<const char*>(vcontent);
-#ifdef TRTIS_ENABLE_GPU
+    const char* content = nullptr;
+    size_t content_byte_size = 0;
     std::unique_ptr<char[]> cpu_buffer;
-    if (src_memory_type != TRTSERVER_MEMORY_CPU) {
+    if ((chunks.size() == 1) &&
+        (chunks[0].memory_type_ == TRTSERVER_MEMORY_CPU)) {
+      content = reinterpret_cast<const char*>(chunks[0].content_);
+      content_byte_size = chunks[0].byte_size_;
+    } else if (payload.status_.IsOk()) {
+      // Gather the chunks into a single CPU buffer in one pass.
+      for (const auto& chunk : chunks) {
+        content_byte_size += chunk.byte_size_;
+      }
       cpu_buffer.reset(new char[content_byte_size]);
-      cudaError_t err = cudaMemcpyAsync(
-          cpu_buffer.get(), vcontent, content_byte_size, cudaMemcpyDeviceToHost,
-          stream_);
-      if (err != cudaSuccess) {
-        payload.status_ = Status(
-            RequestStatusCode::INTERNAL,
-            "input '" + input_name + "' is in GPU memory and failed to use" +
-                " CUDA copy to CPU memory for setting String input data: " +
-                std::string(cudaGetErrorString(err)));
-      } else {
+      content = cpu_buffer.get();
+
+      bool cuda_copy = false;
+      size_t offset = 0;
+      for (const auto& chunk : chunks) {
+        bool cuda_used = false;
+        payload.status_ = CopyBuffer(
+            input_name, chunk.memory_type_, TRTSERVER_MEMORY_CPU,
+            chunk.byte_size_, chunk.content_, cpu_buffer.get() + offset,
+            &cuda_used);
+        cuda_copy |= cuda_used;
+        if (!payload.status_.IsOk()) {
+          break;
+        }
+        offset += chunk.byte_size_;
+      }
+#ifdef TRTIS_ENABLE_GPU
+      if (cuda_copy) {
         cudaStreamSynchronize(stream_);
       }
-      content = cpu_buffer.get();
-    }
 #endif  // TRTIS_ENABLE_GPU
+    }
 
     if (!payload.status_.IsOk()) {
       FillStringTensor(
@@ -570,10 +884,16 @@ BaseBackend::Context::SetStringInputTensor(
       continue;
     }
 
-    // Parse content and assign them to the 'tensor'. Each string
-    // in 'content' is a 4-byte length followed by the string
-    // itself with no null-terminator.
-    while (content_byte_size >= sizeof(uint32_t)) {
+    // Parse content in one pass and assign the strings to the
+    // 'tensor'. Each string in 'content' is a 4-byte length followed
+    // by the string itself with no null-terminator.
+    offsets.clear();
+    byte_sizes.clear();
+    offsets.reserve(expected_element_cnt);
+    byte_sizes.reserve(expected_element_cnt);
+
+    size_t offset = 0;
+    while ((content_byte_size - offset) >= sizeof(uint32_t)) {
       if (element_idx >= expected_element_cnt) {
         payload.status_ = Status(
             RequestStatusCode::INVALID_ARG,
@@ -581,35 +901,26 @@ BaseBackend::Context::SetStringInputTensor(
                 std::to_string(element_idx + 1) + " for inference input '" +
                 input_name + "', expecting " +
                 std::to_string(expected_element_cnt));
-        FillStringTensor(
-            tensor, tensor_element_idx + element_idx,
-            expected_element_cnt - element_idx);
         break;
       }
 
-      const uint32_t len = *(reinterpret_cast<const uint32_t*>(content));
-      content += sizeof(uint32_t);
-      content_byte_size -= sizeof(uint32_t);
+      uint32_t len;
+      memcpy(&len, content + offset, sizeof(uint32_t));
+      offset += sizeof(uint32_t);
 
-      if (content_byte_size < len) {
+      if ((content_byte_size - offset) < len) {
         payload.status_ = Status(
             RequestStatusCode::INVALID_ARG,
             "incomplete string data for inference input '" + input_name +
                 "', expecting string of length " + std::to_string(len) +
-                " but only " + std::to_string(content_byte_size) +
+                " but only " + std::to_string(content_byte_size - offset) +
                 " bytes available");
-        FillStringTensor(
-            tensor, tensor_element_idx + element_idx,
-            expected_element_cnt - element_idx);
         break;
       }
 
-      std::string str(content, len);
-      content += len;
-      content_byte_size -= len;
-
-      TRTISTF_TensorSetString(
-          tensor, tensor_element_idx + element_idx, str.c_str());
+      offsets.push_back(offset);
+      byte_sizes.push_back(len);
+      offset += len;
       element_idx++;
     }
 
@@ -619,11 +930,15 @@ BaseBackend::Context::SetStringInputTensor(
           "expected " + std::to_string(expected_element_cnt) +
               " strings for inference input '" + input_name + "', got " +
               std::to_string(element_idx));
-      FillStringTensor(
-          tensor, tensor_element_idx + element_idx,
-          expected_element_cnt - element_idx);
     }
 
+    TRTISTF_TensorSetStrings(
+        tensor, tensor_element_idx, element_idx, content, offsets.data(),
+        byte_sizes.data());
+    FillStringTensor(
+        tensor, tensor_element_idx + element_idx,
+        expected_element_cnt - element_idx);
+
     tensor_element_idx += expected_element_cnt;
   }
 }
@@ -774,8 +1089,8 @@ BaseBackend::Context::Run(
   {
     TRTISTF_TensorList* rtl;
     RETURN_IF_TRTISTF_ERROR(TRTISTF_ModelRun(
-        trtistf_model_.get(), *(input_tensors.release()),
-        required_outputs.size(), output_names_cstr, &rtl));
+        trtistf_model_.get(), *input_tensors, required_outputs.size(),
+        output_names_cstr, &rtl));
     output_tensors.reset(rtl);
   }
 
@@ -872,6 +1187,11 @@ BaseBackend::Context::Run(
   }
 #endif  // TRTIS_ENABLE_GPU
 
+  // Once the outputs, which may share the data of the inputs, are
+  // released the input tensors can be kept for the next run.
+  output_tensors.reset();
+  KeepInputTensors(*input_tensors);
+
   return Status::Success;
 }
 
@@ -51,6 +51,7 @@ class BaseBackend : public InferenceBackend {
       const std::unordered_map<std::string, std::string>& paths);
   Status CreateExecutionContext(
       const std::string& instance_name, const int gpu_device,
+      const size_t device_instance_idx,
       const std::shared_ptr<GraphDefBackendFactory::Config>& backend_config,
       const std::unordered_map<std::string, std::string>& paths);
 
@@ -65,7 +66,8 @@ class BaseBackend : public InferenceBackend {
       const int gpu_device, const bool has_graph_level, const int graph_level,
       const std::string& model_path, TRTISTFModelHandle* trtistf_model,
       IONameMap* input_name_map, IONameMap* output_name_map,
-      const TRTISTF_TFTRTConfig* tftrt_config) = 0;
+      const TRTISTF_TFTRTConfig* tftrt_config,
+      const TRTISTF_SessionThreadConfig* thread_config) = 0;
 
   // For each model instance there is a context.
   struct Context : BackendContext {
@@ -93,6 +95,15 @@ class BaseBackend : public InferenceBackend {
         std::vector<Scheduler::Payload>* payloads,
         TRTISTF_TensorList** input_tensors);
 
+    // Return in 'tensor' a tensor for input 'tensor_name' of 'dtype'
+    // and 'shape', reusing the tensor of the previous run if possible.
+    Status GetInputTensor(
+        const std::string& tensor_name, const TRTISTF_DataType dtype,
+        const std::vector<int64_t>& shape, TRTISTF_Tensor** tensor);
+
+    // Keep the reusable tensors in 'input_tensors' for the next run.
+    void KeepInputTensors(TRTISTF_TensorList* input_tensors);
+
     // Helper function to set the input for fixed-sized data type
     void SetFixedSizedInputTensor(
         TRTISTF_Tensor* tensor, const std::string& input_name,
@@ -130,6 +141,10 @@ class BaseBackend : public InferenceBackend {
 
     // TRTISTFModel for this context.
     TRTISTFModelHandle trtistf_model_;
+
+    // The input tensors of the previous run, by tensor name, that a
+    // later run reuses for the inputs whose shape doesn't change.
+    std::unordered_map<std::string, TRTISTF_Tensor*> input_tensors_;
   };
 
  private:
@@ -50,7 +50,8 @@ GraphDefBackend::CreateTRTISTFModel(
     const int device_id, const bool has_graph_level, const int graph_level,
     const std::string& model_path, TRTISTFModelHandle* trtistf_model,
     IONameMap* input_name_map, IONameMap* output_name_map,
-    const TRTISTF_TFTRTConfig* tftrt_config)
+    const TRTISTF_TFTRTConfig* tftrt_config,
+    const TRTISTF_SessionThreadConfig* thread_config)
 {
   TRTISTF_Model* model = nullptr;
   RETURN_IF_TRTISTF_ERROR(TRTISTF_ModelCreateFromGraphDef(
@@ -58,7 +59,7 @@ GraphDefBackend::CreateTRTISTFModel(
       has_graph_level, graph_level, backend_config->allow_gpu_memory_growth,
       backend_config->per_process_gpu_memory_fraction,
       backend_config->allow_soft_placement, backend_config->memory_limit_mb,
-      tftrt_config));
+      tftrt_config, thread_config));
 
   trtistf_model->reset(model);
 
@@ -42,7 +42,8 @@ class GraphDefBackend : public BaseBackend {
       const int device_id, const bool has_graph_level, const int graph_level,
       const std::string& model_path, TRTISTFModelHandle* trtistf_model,
       IONameMap* input_name_map, IONameMap* output_name_map,
-      const TRTISTF_TFTRTConfig* tftrt_config) override;
+      const TRTISTF_TFTRTConfig* tftrt_config,
+      const TRTISTF_SessionThreadConfig* thread_config) override;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(GraphDefBackend);
@@ -46,6 +46,11 @@ class GraphDefBackendFactory {
     float per_process_gpu_memory_fraction;
     bool allow_soft_placement;
     std::map<int, std::vector<float>> memory_limit_mb;
+
+    // Directory to cache the graphs converted by TF-TRT in. Empty if
+    // converted graphs are not cached unless the model configuration
+    // gives a directory.
+    std::string engine_cache_dir;
   };
 
   static Status Create(
@@ -68,15 +68,24 @@ SavedModelBackend::CreateTRTISTFModel(
     const int device_id, const bool has_graph_level, const int graph_level,
     const std::string& model_path, TRTISTFModelHandle* trtistf_model,
     IONameMap* input_name_map, IONameMap* output_name_map,
-    const TRTISTF_TFTRTConfig* tftrt_config)
+    const TRTISTF_TFTRTConfig* tftrt_config,
+    const TRTISTF_SessionThreadConfig* thread_config)
 {
+  // The session of a SavedModel is created, and its graph converted,
+  // while the model is loaded so a converted graph can't be
+  // substituted.
+  if ((tftrt_config != nullptr) && (tftrt_config->cache_path_ != nullptr)) {
+    LOG_WARNING << "TF-TRT converted graph of SavedModel '" << Name()
+                << "' is not cached";
+  }
+
   TRTISTF_Model* model = nullptr;
   RETURN_IF_TRTISTF_ERROR(TRTISTF_ModelCreateFromSavedModel(
       &model, model_path.c_str(), model_path.c_str(), device_id,
       has_graph_level, graph_level, backend_config->allow_gpu_memory_growth,
       backend_config->per_process_gpu_memory_fraction,
       backend_config->allow_soft_placement, backend_config->memory_limit_mb,
-      tftrt_config));
+      tftrt_config, thread_config));
 
   trtistf_model->reset(model);
 
@@ -106,7 +115,7 @@ SavedModelBackend::CreateTRTISTFModel(
         ModelSequenceBatching::Control::CONTROL_SEQUENCE_START, inputs));
     RETURN_IF_ERROR(ValidateSequenceControl(
         ModelSequenceBatching::Control::CONTROL_SEQUENCE_READY, inputs));
-    expected_input_cnt += 2;
+    expected_input_cnt += 2 + Config().sequence_batching().state_size();
   }
 
   // Verify that the model configuration input and outputs match what
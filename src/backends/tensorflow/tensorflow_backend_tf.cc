@@ -28,12 +28,19 @@
 
 #include "tensorflow/cc/saved_model/loader.h"
 #include "tensorflow/cc/saved_model/tag_constants.h"
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/device_set.h"
+#include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/graph/default_device.h"
+#include "tensorflow/core/grappler/clusters/virtual_cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/optimizers/meta_optimizer.h"
 #include "tensorflow/core/grappler/utils.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/protobuf/meta_graph.pb.h"
 #include "tensorflow/core/protobuf/rewriter_config.pb.h"
@@ -182,6 +189,7 @@ NewSessionOptions(
     const bool allow_soft_placement,
     const std::map<int, std::vector<float>>& memory_limit_mb,
     const TRTISTF_TFTRTConfig* tftrt_config,
+    const TRTISTF_SessionThreadConfig* thread_config,
     tensorflow::SessionOptions* session_options)
 {
   session_options->config.mutable_gpu_options()->set_allow_growth(
@@ -190,6 +198,15 @@ NewSessionOptions(
       ->set_per_process_gpu_memory_fraction(per_process_gpu_memory_fraction);
   session_options->config.set_allow_soft_placement(allow_soft_placement);
 
+  if (thread_config != nullptr) {
+    session_options->config.set_inter_op_parallelism_threads(
+        thread_config->inter_op_threads_);
+    session_options->config.set_intra_op_parallelism_threads(
+        thread_config->intra_op_threads_);
+    session_options->config.set_use_per_session_threads(
+        thread_config->use_per_session_threads_);
+  }
+
   // Create virtual devices
   if (!memory_limit_mb.empty()) {
     (*(session_options->config.mutable_device_count()))["GPU"] =
@@ -252,6 +269,100 @@ NewSessionOptions(
   }
 }
 
+// Convert 'graph_def' with the TF-TRT optimizer set in
+// 'session_options'. The converted graph is read from the cache file
+// in 'tftrt_config' if an earlier load wrote it, and is written to
+// the cache file otherwise.
+tensorflow::Status
+LoadOrConvertTFTRTGraph(
+    const tensorflow::SessionOptions& session_options,
+    const TRTISTF_TFTRTConfig* tftrt_config, tensorflow::GraphDef* graph_def)
+{
+  tensorflow::Env* env = tensorflow::Env::Default();
+  const std::string cache_path(tftrt_config->cache_path_);
+  if (env->FileExists(cache_path).ok()) {
+    TF_RETURN_IF_ERROR(tensorflow::ReadBinaryProto(env, cache_path, graph_def));
+    LOG(INFO) << "Loaded TF-TRT converted graph from cache " << cache_path;
+    return tensorflow::Status::OK();
+  }
+
+  // Run the optimizers the way the session would, on the devices of
+  // the session. The model outputs are the fetch nodes so the
+  // conversion keeps them out of the TensorRT engines.
+  std::vector<std::unique_ptr<tensorflow::Device>> devices;
+  TF_RETURN_IF_ERROR(tensorflow::DeviceFactory::AddDevices(
+      session_options, "/job:localhost/replica:0/task:0", &devices));
+  tensorflow::DeviceSet device_set;
+  tensorflow::Device* cpu_device = nullptr;
+  for (const auto& device : devices) {
+    device_set.AddDevice(device.get());
+    if ((cpu_device == nullptr) &&
+        (device->device_type() == tensorflow::DEVICE_CPU)) {
+      cpu_device = device.get();
+      device_set.set_client_device(cpu_device);
+    }
+  }
+
+  tensorflow::grappler::GrapplerItem item;
+  item.id = "tftrt";
+  item.graph = *graph_def;
+  for (size_t i = 0; i < tftrt_config->output_count_; ++i) {
+    item.fetch.emplace_back(tftrt_config->output_names_[i]);
+  }
+
+  tensorflow::grappler::VirtualCluster cluster(&device_set);
+  tensorflow::GraphDef converted;
+  TF_RETURN_IF_ERROR(tensorflow::grappler::RunMetaOptimizer(
+      item, session_options.config, cpu_device, &cluster, &converted));
+  graph_def->Swap(&converted);
+
+  // Failing to cache the graph only makes later loads slower. Write
+  // to a temporary file first so a partially written graph is never
+  // read.
+  const std::string tmp_path =
+      cache_path + ".tmp" + std::to_string(env->NowMicros());
+  tensorflow::Status status =
+      env->RecursivelyCreateDir(tensorflow::io::Dirname(cache_path).ToString());
+  if (status.ok()) {
+    status = tensorflow::WriteBinaryProto(env, tmp_path, *graph_def);
+  }
+  if (status.ok()) {
+    status = env->RenameFile(tmp_path, cache_path);
+  }
+  if (status.ok()) {
+    LOG(INFO) << "Cached TF-TRT converted graph in " << cache_path;
+  } else {
+    env->DeleteFile(tmp_path).IgnoreError();
+    LOG(WARNING) << "Unable to cache TF-TRT converted graph: "
+                 << status.error_message();
+  }
+
+  return tensorflow::Status::OK();
+}
+
+//
+// WrappedBufferAllocator
+//
+// An allocator that hands out a single existing buffer so that a
+// tensor can use memory it doesn't own. The allocator deletes itself
+// when the tensor buffer is released, which may be after the tensor
+// is deleted if TensorFlow still references the buffer.
+//
+class WrappedBufferAllocator : public tensorflow::Allocator {
+ public:
+  WrappedBufferAllocator(void* data) : data_(data) {}
+
+  std::string Name() override { return "trtis_wrapped_buffer"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override
+  {
+    return data_;
+  }
+  void DeallocateRaw(void* ptr) override { delete this; }
+
+ private:
+  void* data_;
+};
+
 //
 // TensorImpl
 //
@@ -260,12 +371,17 @@ class TensorImpl {
   TensorImpl(
       const char* name, TRTISTF_DataType dtype, TRTISTF_Shape* shape,
       const tensorflow::TensorShape& tfshape);
+  TensorImpl(
+      const char* name, TRTISTF_DataType dtype, TRTISTF_Shape* shape,
+      const tensorflow::TensorShape& tfshape,
+      WrappedBufferAllocator* allocator);
   TensorImpl(tensorflow::Tensor&& tftensor);
   ~TensorImpl();
 
   const std::string& Name() const { return name_; }
   TRTISTF_DataType DataType() const { return dtype_; }
   TRTISTF_Shape* Shape() const { return shape_; }
+  bool IsWrapped() const { return wrapped_; }
 
   tensorflow::Tensor& TFTensor() { return tftensor_; }
 
@@ -274,6 +390,10 @@ class TensorImpl {
 
   const std::string& String(size_t idx) const;
   void SetString(size_t idx, const std::string& str);
+  void SetStrings(
+      size_t idx, size_t cnt, const char* base, const size_t* offsets,
+      const size_t* byte_sizes);
+  size_t SerializeStrings(size_t idx, size_t cnt, char* buffer) const;
 
  private:
   void Init();
@@ -281,6 +401,7 @@ class TensorImpl {
   const std::string name_;
   const TRTISTF_DataType dtype_;
   TRTISTF_Shape* shape_;
+  const bool wrapped_;
 
   tensorflow::Tensor tftensor_;
   char* nonstring_base_;
@@ -291,15 +412,25 @@ class TensorImpl {
 TensorImpl::TensorImpl(
     const char* name, TRTISTF_DataType dtype, TRTISTF_Shape* shape,
     const tensorflow::TensorShape& tfshape)
-    : name_(name), dtype_(dtype), shape_(shape),
+    : name_(name), dtype_(dtype), shape_(shape), wrapped_(false),
       tftensor_(ConvertDataType(dtype), tfshape)
 {
   Init();
 }
 
+TensorImpl::TensorImpl(
+    const char* name, TRTISTF_DataType dtype, TRTISTF_Shape* shape,
+    const tensorflow::TensorShape& tfshape, WrappedBufferAllocator* allocator)
+    : name_(name), dtype_(dtype), shape_(shape), wrapped_(true),
+      tftensor_(allocator, ConvertDataType(dtype), tfshape)
+{
+  Init();
+}
+
 TensorImpl::TensorImpl(tensorflow::Tensor&& tftensor)
     : name_(), dtype_(ConvertDataType(tftensor.dtype())),
-      shape_(ConvertShape(tftensor.shape())), tftensor_(std::move(tftensor))
+      shape_(ConvertShape(tftensor.shape())), wrapped_(false),
+      tftensor_(std::move(tftensor))
 {
   Init();
 }
@@ -339,6 +470,48 @@ TensorImpl::SetString(size_t idx, const std::string& str)
   flat(idx) = str;
 }
 
+void
+TensorImpl::SetStrings(
+    size_t idx, size_t cnt, const char* base, const size_t* offsets,
+    const size_t* byte_sizes)
+{
+  auto flat = tftensor_.flat<std::string>();
+  if (base == nullptr) {
+    for (size_t e = 0; e < cnt; ++e) {
+      flat(idx + e).clear();
+    }
+  } else {
+    for (size_t e = 0; e < cnt; ++e) {
+      flat(idx + e).assign(base + offsets[e], byte_sizes[e]);
+    }
+  }
+}
+
+size_t
+TensorImpl::SerializeStrings(size_t idx, size_t cnt, char* buffer) const
+{
+  auto flat = tftensor_.flat<std::string>();
+  size_t byte_size = cnt * sizeof(uint32_t);
+  if (buffer == nullptr) {
+    for (size_t e = 0; e < cnt; ++e) {
+      byte_size += flat(idx + e).size();
+    }
+    return byte_size;
+  }
+
+  char* pos = buffer;
+  for (size_t e = 0; e < cnt; ++e) {
+    const std::string& str = flat(idx + e);
+    const uint32_t len = str.size();
+    memcpy(pos, &len, sizeof(uint32_t));
+    pos += sizeof(uint32_t);
+    memcpy(pos, str.data(), len);
+    pos += len;
+  }
+
+  return pos - buffer;
+}
+
 //
 // ModelImpl
 //
@@ -407,17 +580,17 @@ ModelImpl::Run(
 {
   std::vector<std::pair<std::string, tensorflow::Tensor>> tfinputs;
 
+  // The session shares the buffers of the input tensors, so the
+  // caller can reuse the tensors once their buffers are no longer
+  // referenced by the outputs.
   for (TRTISTF_TensorList* itr = input_tensors; itr != nullptr;
        itr = itr->next_) {
     if (itr->tensor_ != nullptr) {
       TensorImpl* tensor = reinterpret_cast<TensorImpl*>(itr->tensor_);
-      tfinputs.emplace_back(
-          std::make_pair(tensor->Name(), std::move(tensor->TFTensor())));
+      tfinputs.emplace_back(std::make_pair(tensor->Name(), tensor->TFTensor()));
     }
   }
 
-  TRTISTF_TensorListDelete(input_tensors);
-
   std::vector<tensorflow::Tensor> tfoutputs;
   RETURN_IF_TF_ERROR(session_->Run(tfinputs, output_names, {}, &tfoutputs));
 
@@ -587,6 +760,57 @@ TRTISTF_TensorNew(
   return reinterpret_cast<TRTISTF_Tensor*>(tensor);
 }
 
+TRTISTF_Tensor*
+TRTISTF_TensorNewWithData(
+    const char* name, TRTISTF_DataType dtype, size_t shape_rank,
+    int64_t* shape_dims, char* data, size_t byte_size)
+{
+  // TensorFlow kernels may require the data of a tensor to be aligned.
+  if ((dtype == TRTISTF_DataType::TRTISTF_TYPE_STRING) || (data == nullptr) ||
+      ((reinterpret_cast<uintptr_t>(data) %
+        tensorflow::Allocator::kAllocatorAlignment) != 0)) {
+    return nullptr;
+  }
+
+  TRTISTF_Shape* shape = TRTISTF_ShapeNew(shape_rank, shape_dims);
+  tensorflow::TensorShape tfshape;
+  ConvertShape(shape, &tfshape);
+  if ((tfshape.num_elements() == 0) ||
+      ((tfshape.num_elements() *
+        tensorflow::DataTypeSize(ConvertDataType(dtype))) !=
+       (int64_t)byte_size)) {
+    TRTISTF_ShapeDelete(shape);
+    return nullptr;
+  }
+
+  TensorImpl* tensor = new TensorImpl(
+      name, dtype, shape, tfshape, new WrappedBufferAllocator(data));
+  return reinterpret_cast<TRTISTF_Tensor*>(tensor);
+}
+
+void
+TRTISTF_TensorDelete(TRTISTF_Tensor* tensor)
+{
+  TensorImpl* t = reinterpret_cast<TensorImpl*>(tensor);
+  delete t;
+}
+
+bool
+TRTISTF_TensorIsReusable(TRTISTF_Tensor* tensor)
+{
+  TensorImpl* t = reinterpret_cast<TensorImpl*>(tensor);
+  return !t->IsWrapped() &&
+         (t->DataType() != TRTISTF_DataType::TRTISTF_TYPE_STRING) &&
+         t->TFTensor().IsInitialized() && t->TFTensor().RefCountIsOne();
+}
+
+const char*
+TRTISTF_TensorName(TRTISTF_Tensor* tensor)
+{
+  TensorImpl* t = reinterpret_cast<TensorImpl*>(tensor);
+  return t->Name().c_str();
+}
+
 TRTISTF_DataType
 TRTISTF_TensorDataType(TRTISTF_Tensor* tensor)
 {
@@ -642,6 +866,23 @@ TRTISTF_TensorSetString(TRTISTF_Tensor* tensor, size_t idx, const char* cstr)
   t->SetString(idx, str);
 }
 
+void
+TRTISTF_TensorSetStrings(
+    TRTISTF_Tensor* tensor, size_t idx, size_t cnt, const char* base,
+    const size_t* offsets, const size_t* byte_sizes)
+{
+  TensorImpl* t = reinterpret_cast<TensorImpl*>(tensor);
+  t->SetStrings(idx, cnt, base, offsets, byte_sizes);
+}
+
+size_t
+TRTISTF_TensorSerializeStrings(
+    TRTISTF_Tensor* tensor, size_t idx, size_t cnt, char* buffer)
+{
+  TensorImpl* t = reinterpret_cast<TensorImpl*>(tensor);
+  return t->SerializeStrings(idx, cnt, buffer);
+}
+
 //
 // TRTISTF_Model
 //
@@ -653,16 +894,14 @@ TRTISTF_ModelCreateFromGraphDef(
     const float per_process_gpu_memory_fraction,
     const bool allow_soft_placement,
     const std::map<int, std::vector<float>>& memory_limit_mb,
-    const TRTISTF_TFTRTConfig* tftrt_config)
+    const TRTISTF_TFTRTConfig* tftrt_config,
+    const TRTISTF_SessionThreadConfig* thread_config)
 {
   tensorflow::SessionOptions session_options;
   NewSessionOptions(
       has_graph_level, graph_level, allow_gpu_memory_growth,
       per_process_gpu_memory_fraction, allow_soft_placement, memory_limit_mb,
-      tftrt_config, &session_options);
-
-  tensorflow::Session* session;
-  RETURN_IF_TF_ERROR(tensorflow::NewSession(session_options, &session));
+      tftrt_config, thread_config, &session_options);
 
   tensorflow::GraphDef graph_def;
   RETURN_IF_TF_ERROR(tensorflow::ReadBinaryProto(
@@ -690,6 +929,20 @@ TRTISTF_ModelCreateFromGraphDef(
     }
   }
 
+  // When the converted graph is cached it is converted here instead
+  // of by the session, which then must not convert it again.
+  if ((tftrt_config != nullptr) && (tftrt_config->cache_path_ != nullptr)) {
+    RETURN_IF_TF_ERROR(
+        LoadOrConvertTFTRTGraph(session_options, tftrt_config, &graph_def));
+    session_options = tensorflow::SessionOptions();
+    NewSessionOptions(
+        has_graph_level, graph_level, allow_gpu_memory_growth,
+        per_process_gpu_memory_fraction, allow_soft_placement, memory_limit_mb,
+        nullptr /* tftrt_config */, thread_config, &session_options);
+  }
+
+  tensorflow::Session* session;
+  RETURN_IF_TF_ERROR(tensorflow::NewSession(session_options, &session));
   RETURN_IF_TF_ERROR(session->Create(graph_def));
 
   // Go through all graph nodes and collect the possible inputs and
@@ -724,13 +977,14 @@ TRTISTF_ModelCreateFromSavedModel(
     const float per_process_gpu_memory_fraction,
     const bool allow_soft_placement,
     const std::map<int, std::vector<float>>& memory_limit_mb,
-    const TRTISTF_TFTRTConfig* tftrt_config)
+    const TRTISTF_TFTRTConfig* tftrt_config,
+    const TRTISTF_SessionThreadConfig* thread_config)
 {
   tensorflow::SessionOptions session_options;
   NewSessionOptions(
       has_graph_level, graph_level, allow_gpu_memory_growth,
       per_process_gpu_memory_fraction, allow_soft_placement, memory_limit_mb,
-      tftrt_config, &session_options);
+      tftrt_config, thread_config, &session_options);
 
 
   if (device_id != TRTISTF_MODEL_DEVICE) {
@@ -99,8 +99,30 @@ typedef struct {
   size_t max_workspace_size_bytes_;
   TRTISTF_TFTRTPrecisionMode precision_mode_;
   size_t minimum_segment_size_;
+
+  // Path of the file caching the graph converted by TF-TRT, or
+  // nullptr if the converted graph is not cached. Only GraphDef
+  // models use the cache.
+  const char* cache_path_;
+
+  // Names of the model outputs, which the conversion must keep in the
+  // graph. Only used when the converted graph is cached.
+  const char* const* output_names_;
+  size_t output_count_;
 } TRTISTF_TFTRTConfig;
 
+// Session threading configuration
+typedef struct {
+  // Number of threads in the pool that runs independent ops, and in
+  // the pool that parallelizes a single op. 0 lets TensorFlow choose.
+  int inter_op_threads_;
+  int intra_op_threads_;
+
+  // If true the session has thread pools of its own instead of
+  // sharing the process-wide pools with all other sessions.
+  bool use_per_session_threads_;
+} TRTISTF_SessionThreadConfig;
+
 // A shape
 typedef struct {
   // Number of dimensions in the shape
@@ -163,6 +185,27 @@ TRTISTF_EXPORT TRTISTF_Tensor* TRTISTF_TensorNew(
     const char* name, TRTISTF_DataType dtype, size_t shape_rank,
     int64_t* shape_dims);
 
+// Create a new tensor with a given name, type and shape that uses
+// the 'byte_size' bytes of host memory at 'data' instead of
+// allocating its own. The memory must stay valid until the tensor and
+// any output produced from it by TRTISTF_ModelRun are deleted.
+// Return nullptr if the tensor can't use the memory, for example
+// because 'data' is not aligned as TensorFlow requires.
+TRTISTF_EXPORT TRTISTF_Tensor* TRTISTF_TensorNewWithData(
+    const char* name, TRTISTF_DataType dtype, size_t shape_rank,
+    int64_t* shape_dims, char* data, size_t byte_size);
+
+// Delete a tensor.
+TRTISTF_EXPORT void TRTISTF_TensorDelete(TRTISTF_Tensor* tensor);
+
+// Return true if a tensor owns its data and no other tensor
+// references the data, so that the tensor can be overwritten and
+// used as an input of another TRTISTF_ModelRun.
+TRTISTF_EXPORT bool TRTISTF_TensorIsReusable(TRTISTF_Tensor* tensor);
+
+// Return a tensor's name. The name is owned by the tensor.
+TRTISTF_EXPORT const char* TRTISTF_TensorName(TRTISTF_Tensor* tensor);
+
 // Return a tensor's datatype.
 TRTISTF_EXPORT TRTISTF_DataType TRTISTF_TensorDataType(TRTISTF_Tensor* tensor);
 
@@ -198,6 +241,24 @@ TRTISTF_EXPORT const char* TRTISTF_TensorString(
 TRTISTF_EXPORT void TRTISTF_TensorSetString(
     TRTISTF_Tensor* tensor, size_t idx, const char* str);
 
+// Set 'cnt' strings starting at index 'idx' within a tensor. Defined
+// only for string type. String 'e' is the 'byte_sizes[e]' bytes of
+// 'base' starting at 'offsets[e]' and may contain null bytes. The
+// strings are copied by the tensor. 'base' may be NULL to indicate
+// that all 'cnt' strings should be set to empty, in which case
+// 'offsets' and 'byte_sizes' are ignored.
+TRTISTF_EXPORT void TRTISTF_TensorSetStrings(
+    TRTISTF_Tensor* tensor, size_t idx, size_t cnt, const char* base,
+    const size_t* offsets, const size_t* byte_sizes);
+
+// Serialize 'cnt' strings starting at index 'idx' within a tensor
+// into 'buffer'. Defined only for string type. Each string is
+// serialized as a 4-byte length followed by the string itself with no
+// null-terminator. Return the size, in bytes, of the serialized
+// strings. 'buffer' may be NULL to only get the size.
+TRTISTF_EXPORT size_t TRTISTF_TensorSerializeStrings(
+    TRTISTF_Tensor* tensor, size_t idx, size_t cnt, char* buffer);
+
 //
 // Model
 //
@@ -213,7 +274,8 @@ TRTISTF_EXPORT TRTISTF_Error* TRTISTF_ModelCreateFromGraphDef(
     const float per_process_gpu_memory_fraction,
     const bool allow_soft_placement,
     const std::map<int, std::vector<float>>& memory_limit_mb,
-    const TRTISTF_TFTRTConfig* tftrt_config);
+    const TRTISTF_TFTRTConfig* tftrt_config,
+    const TRTISTF_SessionThreadConfig* thread_config);
 
 // Create a SavedModel model.
 TRTISTF_EXPORT TRTISTF_Error* TRTISTF_ModelCreateFromSavedModel(
@@ -223,7 +285,8 @@ TRTISTF_EXPORT TRTISTF_Error* TRTISTF_ModelCreateFromSavedModel(
     const float per_process_gpu_memory_fraction,
     const bool allow_soft_placement,
     const std::map<int, std::vector<float>>& memory_limit_mb,
-    const TRTISTF_TFTRTConfig* tftrt_config);
+    const TRTISTF_TFTRTConfig* tftrt_config,
+    const TRTISTF_SessionThreadConfig* thread_config);
 
 // Delete a model.
 TRTISTF_EXPORT void TRTISTF_ModelDelete(TRTISTF_Model* model);
@@ -237,11 +300,12 @@ TRTISTF_EXPORT TRTISTF_IOList* TRTISTF_ModelInputs(TRTISTF_Model* model);
 TRTISTF_EXPORT TRTISTF_IOList* TRTISTF_ModelOutputs(TRTISTF_Model* model);
 
 // Run a model using the provides input tensors to produce the named
-// outputs. Ownership of the 'input_tensors' is passed to the model
-// and the caller must not access (or free) it after this
-// call. 'output_tensors' returns the outputs in the same order as
-// 'output_names'. The caller must free 'output_tensors' by calling
-// TRTISTF_TensorListDelete.
+// outputs. The caller retains ownership of 'input_tensors' and must
+// free them by calling TRTISTF_TensorListDelete. An output may share
+// the data of an input so an input must not be overwritten while the
+// outputs exist. 'output_tensors' returns the outputs in the same
+// order as 'output_names'. The caller must free 'output_tensors' by
+// calling TRTISTF_TensorListDelete.
 TRTISTF_EXPORT TRTISTF_Error* TRTISTF_ModelRun(
     TRTISTF_Model* model, TRTISTF_TensorList* input_tensors, size_t num_outputs,
     const char** output_names, TRTISTF_TensorList** output_tensors);
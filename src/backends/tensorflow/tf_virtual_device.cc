@@ -103,6 +103,29 @@ VirtualDeviceTracker::GetNextVirtualDevice(
   return Status::Success;
 }
 
+Status
+VirtualDeviceTracker::GetVirtualDevice(
+    const int gpu_device, const size_t idx, int* vgpu_device)
+{
+  if (!instance_) {
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "VirtualDeviceTracker has not been initialized");
+  }
+
+  const auto itr = instance_->num_virtual_per_physical_.find(gpu_device);
+  if (itr == instance_->num_virtual_per_physical_.end()) {
+    return Status(
+        RequestStatusCode::INTERNAL, "Invalid physical device ID " +
+                                         std::to_string(gpu_device) +
+                                         " while creating model instance");
+  }
+
+  *vgpu_device = (idx % itr->second) +
+                 instance_->virtual_device_base_index_[gpu_device];
+  return Status::Success;
+}
+
 bool
 VirtualDeviceTracker::HasVirtualDevice()
 {
@@ -51,6 +51,14 @@ class VirtualDeviceTracker {
   // bounds or if no VirtualDeviceTracker has been initialized
   static Status GetNextVirtualDevice(const int gpu_device, int* vgpu_device);
 
+  // Gets the device ID of the virtual device at index 'idx', modulo
+  // the number of virtual devices, on the physical device indexed by
+  // gpu_device. Doesn't change the round robin state. Returns an error
+  // status if gpu_device is out of bounds or if no VirtualDeviceTracker
+  // has been initialized
+  static Status GetVirtualDevice(
+      const int gpu_device, const size_t idx, int* vgpu_device);
+
   // Returns True if the VirtualDevice Tracker has been initialized, else false.
   static bool HasVirtualDevice();
 
@@ -0,0 +1,290 @@
+// Copyright (c) 2018-2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/backends/tensorrt/builder.h"
+
+#include <NvInfer.h>
+#include <NvOnnxParser.h>
+#include <cuda_runtime_api.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <memory>
+#include "src/backends/tensorrt/logging.h"
+#include "src/core/filesystem.h"
+#include "src/core/logging.h"
+
+namespace nvidia { namespace inferenceserver {
+
+namespace {
+
+// 64-bit FNV-1a so that the cache key of a model is the same from
+// one server run to the next.
+uint64_t
+HashBytes(const char* data, const size_t size, uint64_t hash)
+{
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+Status
+ToDims(
+    const std::string& name,
+    const google::protobuf::RepeatedField<int64_t>& shape,
+    nvinfer1::Dims* dims)
+{
+  if (shape.size() > nvinfer1::Dims::MAX_DIMS) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "profile shape of input '" + name + "' has more than " +
+            std::to_string(nvinfer1::Dims::MAX_DIMS) + " dimensions");
+  }
+
+  dims->nbDims = shape.size();
+  for (int i = 0; i < shape.size(); ++i) {
+    dims->d[i] = shape[i];
+  }
+
+  return Status::Success;
+}
+
+// Destroy a TensorRT object when going out of scope.
+template <typename T>
+struct TrtDestroyer {
+  void operator()(T* obj) const
+  {
+    if (obj != nullptr) {
+      obj->destroy();
+    }
+  }
+};
+
+template <typename T>
+using TrtUniquePtr = std::unique_ptr<T, TrtDestroyer<T>>;
+
+}  // namespace
+
+Status
+BuildPlan(
+    const char* onnx_data, const size_t onnx_byte_size,
+    const ModelOptimizationPolicy::TensorRTBuild& settings,
+    std::vector<char>* plan)
+{
+  if (onnx_byte_size == 0) {
+    return Status(RequestStatusCode::INVALID_ARG, "empty ONNX model");
+  }
+
+  TrtUniquePtr<nvinfer1::IBuilder> builder(
+      nvinfer1::createInferBuilder(tensorrt_logger));
+  if (builder == nullptr) {
+    return Status(
+        RequestStatusCode::INTERNAL, "unable to create TensorRT builder");
+  }
+
+  // An ONNX network always has an explicit batch dimension.
+  const uint32_t flags =
+      1U << static_cast<uint32_t>(
+          nvinfer1::NetworkDefinitionCreationFlag::kEXPLICIT_BATCH);
+  TrtUniquePtr<nvinfer1::INetworkDefinition> network(
+      builder->createNetworkV2(flags));
+  if (network == nullptr) {
+    return Status(
+        RequestStatusCode::INTERNAL, "unable to create TensorRT network");
+  }
+
+  TrtUniquePtr<nvonnxparser::IParser> parser(
+      nvonnxparser::createParser(*network, tensorrt_logger));
+  if (parser == nullptr) {
+    return Status(
+        RequestStatusCode::INTERNAL, "unable to create TensorRT ONNX parser");
+  }
+
+  if (!parser->parse(onnx_data, onnx_byte_size)) {
+    std::string errors;
+    for (int i = 0; i < parser->getNbErrors(); ++i) {
+      errors += std::string("; ") + parser->getError(i)->desc();
+    }
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "unable to parse ONNX model" + errors);
+  }
+
+  TrtUniquePtr<nvinfer1::IBuilderConfig> config(
+      builder->createBuilderConfig());
+  if (config == nullptr) {
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "unable to create TensorRT builder config");
+  }
+
+  config->setMaxWorkspaceSize(
+      (settings.max_workspace_size_bytes() == 0)
+          ? (1ULL << 30)
+          : settings.max_workspace_size_bytes());
+  if (settings.fp16()) {
+    if (!builder->platformHasFastFp16()) {
+      LOG_WARNING << "FP16 is requested but the GPU has no fast FP16";
+    }
+    config->setFlag(nvinfer1::BuilderFlag::kFP16);
+  }
+  if (settings.int8()) {
+    if (!builder->platformHasFastInt8()) {
+      LOG_WARNING << "INT8 is requested but the GPU has no fast INT8";
+    }
+    config->setFlag(nvinfer1::BuilderFlag::kINT8);
+  }
+
+  for (const auto& profile_settings : settings.profile()) {
+    nvinfer1::IOptimizationProfile* profile =
+        builder->createOptimizationProfile();
+    for (const auto& input : profile_settings.input()) {
+      nvinfer1::Dims min_dims, opt_dims, max_dims;
+      RETURN_IF_ERROR(ToDims(input.name(), input.min(), &min_dims));
+      RETURN_IF_ERROR(ToDims(input.name(), input.opt(), &opt_dims));
+      RETURN_IF_ERROR(ToDims(input.name(), input.max(), &max_dims));
+      if (!profile->setDimensions(
+              input.name().c_str(), nvinfer1::OptProfileSelector::kMIN,
+              min_dims) ||
+          !profile->setDimensions(
+              input.name().c_str(), nvinfer1::OptProfileSelector::kOPT,
+              opt_dims) ||
+          !profile->setDimensions(
+              input.name().c_str(), nvinfer1::OptProfileSelector::kMAX,
+              max_dims)) {
+        return Status(
+            RequestStatusCode::INVALID_ARG,
+            "invalid optimization profile shapes for input '" +
+                input.name() + "'");
+      }
+    }
+    if (config->addOptimizationProfile(profile) < 0) {
+      return Status(
+          RequestStatusCode::INVALID_ARG, "invalid optimization profile");
+    }
+  }
+
+  TrtUniquePtr<nvinfer1::ICudaEngine> engine(
+      builder->buildEngineWithConfig(*network, *config));
+  if (engine == nullptr) {
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "unable to build TensorRT engine from ONNX model");
+  }
+
+  TrtUniquePtr<nvinfer1::IHostMemory> serialized(engine->serialize());
+  if (serialized == nullptr) {
+    return Status(
+        RequestStatusCode::INTERNAL, "unable to serialize TensorRT engine");
+  }
+
+  const char* data = static_cast<const char*>(serialized->data());
+  plan->assign(data, data + serialized->size());
+
+  return Status::Success;
+}
+
+Status
+LoadOrBuildPlan(
+    const std::string& cache_dir, const char* onnx_data,
+    const size_t onnx_byte_size,
+    const ModelOptimizationPolicy::TensorRTBuild& settings,
+    const int gpu_device, std::vector<char>* plan)
+{
+  if (cache_dir.empty() || (onnx_byte_size == 0)) {
+    return BuildPlan(onnx_data, onnx_byte_size, settings, plan);
+  }
+
+  // The cache key is the GPU SKU, the TensorRT version and a hash of
+  // the model and of the settings the engine is built with.
+  cudaDeviceProp cuprops;
+  cudaError_t cuerr = cudaGetDeviceProperties(&cuprops, gpu_device);
+  if (cuerr != cudaSuccess) {
+    return Status(
+        RequestStatusCode::INTERNAL,
+        std::string("unable to get CUDA device properties: ") +
+            cudaGetErrorString(cuerr));
+  }
+
+  std::string sku(cuprops.name);
+  for (auto& c : sku) {
+    if (!isalnum(static_cast<unsigned char>(c))) {
+      c = '_';
+    }
+  }
+
+  std::string serialized_settings;
+  settings.SerializeToString(&serialized_settings);
+  uint64_t hash =
+      HashBytes(onnx_data, onnx_byte_size, 14695981039346656037ULL);
+  hash = HashBytes(
+      serialized_settings.data(), serialized_settings.size(), hash);
+
+  char hash_str[17];
+  snprintf(
+      hash_str, sizeof(hash_str), "%016llx",
+      static_cast<unsigned long long>(hash));
+
+  const std::string cache_path = JoinPath(
+      {cache_dir, sku + "_" + std::to_string(cuprops.major) + "." +
+                      std::to_string(cuprops.minor) + "_trt" +
+                      std::to_string(getInferLibVersion()) + "_" + hash_str +
+                      ".plan"});
+
+  bool exists = false;
+  RETURN_IF_ERROR(FileExists(cache_path, &exists));
+  if (exists) {
+    std::string plan_str;
+    RETURN_IF_ERROR(ReadTextFile(cache_path, &plan_str));
+    plan->assign(plan_str.begin(), plan_str.end());
+    LOG_INFO << "Loaded TensorRT engine from cache " << cache_path;
+    return Status::Success;
+  }
+
+  RETURN_IF_ERROR(BuildPlan(onnx_data, onnx_byte_size, settings, plan));
+
+  // Failing to cache the plan only makes later loads slower. Write to
+  // a temporary file first so a partially written plan is never read.
+  const std::string tmp_path = cache_path + ".tmp";
+  Status status =
+      WriteTextFile(tmp_path, std::string(plan->begin(), plan->end()));
+  if (status.IsOk() && (rename(tmp_path.c_str(), cache_path.c_str()) != 0)) {
+    status = Status(
+        RequestStatusCode::INTERNAL,
+        "failed to rename " + tmp_path + " to " + cache_path);
+  }
+  if (status.IsOk()) {
+    LOG_INFO << "Cached TensorRT engine in " << cache_path;
+  } else {
+    LOG_WARNING << "Unable to cache TensorRT engine: " << status.Message();
+  }
+
+  return Status::Success;
+}
+
+}}  // namespace nvidia::inferenceserver
@@ -0,0 +1,69 @@
+// Copyright (c) 2018-2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <string>
+#include <vector>
+#include "src/core/model_config.pb.h"
+#include "src/core/status.h"
+
+namespace nvidia { namespace inferenceserver {
+
+/// Build a TensorRT plan from an ONNX model for the current CUDA
+/// device and return the serialized engine.
+///
+/// \param onnx_data The binary blob of the ONNX model
+/// \param onnx_byte_size The byte size of 'onnx_data'
+/// \param settings The settings to build the engine with
+/// \param plan Returns the serialized engine
+/// \return Error status.
+Status BuildPlan(
+    const char* onnx_data, const size_t onnx_byte_size,
+    const ModelOptimizationPolicy::TensorRTBuild& settings,
+    std::vector<char>* plan);
+
+/// Return the TensorRT plan built from an ONNX model for a CUDA
+/// device. The plan is read from the cache directory if it was
+/// built before for the same GPU, TensorRT version, model and
+/// settings. Otherwise it is built and, if there is a cache
+/// directory, written to the cache for later loads.
+///
+/// \param cache_dir The directory caching built plans, or empty to
+/// always build
+/// \param onnx_data The binary blob of the ONNX model
+/// \param onnx_byte_size The byte size of 'onnx_data'
+/// \param settings The settings to build the engine with
+/// \param gpu_device The CUDA device to build for. Must be the
+/// current device.
+/// \param plan Returns the serialized engine
+/// \return Error status.
+Status LoadOrBuildPlan(
+    const std::string& cache_dir, const char* onnx_data,
+    const size_t onnx_byte_size,
+    const ModelOptimizationPolicy::TensorRTBuild& settings,
+    const int gpu_device, std::vector<char>* plan);
+
+}}  // namespace nvidia::inferenceserver
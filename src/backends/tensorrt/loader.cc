@@ -36,8 +36,8 @@ namespace nvidia { namespace inferenceserver {
 
 Status
 LoadPlan(
-    const std::vector<char>& model_data, nvinfer1::IRuntime** runtime,
-    nvinfer1::ICudaEngine** engine)
+    const char* model_data, const size_t model_byte_size, const int dla_core,
+    nvinfer1::IRuntime** runtime, nvinfer1::ICudaEngine** engine)
 {
   *engine = nullptr;
   *runtime = nullptr;
@@ -53,8 +53,20 @@ LoadPlan(
         RequestStatusCode::INTERNAL, "unable to create TensorRT runtime");
   }
 
+  // The DLA core must be selected before the engine is deserialized.
+  if (dla_core >= 0) {
+    if (dla_core >= (*runtime)->getNbDLACores()) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "unable to use DLA core " + std::to_string(dla_core) + ", " +
+              std::to_string((*runtime)->getNbDLACores()) +
+              " DLA cores available");
+    }
+    (*runtime)->setDLACore(dla_core);
+  }
+
   *engine = (*runtime)->deserializeCudaEngine(
-      &model_data[0], model_data.size(), onnx_plugin_factory);
+      model_data, model_byte_size, onnx_plugin_factory);
   if (*engine == nullptr) {
     return Status(
         RequestStatusCode::INTERNAL, "unable to create TensorRT engine");
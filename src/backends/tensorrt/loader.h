@@ -36,13 +36,16 @@ namespace nvidia { namespace inferenceserver {
 /// even if an error is returned.
 ///
 /// \param model_data The binary blob of the plan data
+/// \param model_byte_size The byte size of 'model_data'
+/// \param dla_core The DLA core to run the layers of the plan that
+/// were built for DLA on, or -1 if the plan was built for the GPU
 /// \param runtime Returns the IRuntime object, or nullptr if failed
 /// to create
 /// \param engine Returns the ICudaEngine object, or nullptr if failed
 /// to create
 /// \return Error status.
 Status LoadPlan(
-    const std::vector<char>& model_data, nvinfer1::IRuntime** runtime,
-    nvinfer1::ICudaEngine** engine);
+    const char* model_data, const size_t model_byte_size, const int dla_core,
+    nvinfer1::IRuntime** runtime, nvinfer1::ICudaEngine** engine);
 
 }}  // namespace nvidia::inferenceserver
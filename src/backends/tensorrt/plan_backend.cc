@@ -29,6 +29,9 @@
 #include <NvInfer.h>
 #include <stdint.h>
 #include <mutex>
+#include <sstream>
+#include <thread>
+#include "src/backends/tensorrt/builder.h"
 #include "src/backends/tensorrt/loader.h"
 #include "src/backends/tensorrt/plan_utils.h"
 #include "src/core/constants.h"
@@ -40,11 +43,42 @@
 
 namespace nvidia { namespace inferenceserver {
 
+namespace {
+
+// The number of sets of binding buffers for each context.
+constexpr size_t kBindingSetCount = 2;
+
+// Return the shape of input 'name' of a request, or nullptr if the
+// request doesn't have that input.
+const DimsList*
+RequestInputDims(
+    const InferRequestProvider& request_provider, const std::string& name)
+{
+  const auto& override_map = request_provider.GetInputOverride();
+  if (override_map != nullptr) {
+    const auto itr = override_map->find(name);
+    if (itr != override_map->end()) {
+      return &itr->second->dims_;
+    }
+  }
+
+  for (const auto& input : request_provider.RequestHeader().input()) {
+    if (input.name() == name) {
+      return &input.dims();
+    }
+  }
+
+  return nullptr;
+}
+
+}  // namespace
+
 PlanBackend::Context::Context(
     const std::string& name, const int gpu_device, const int max_batch_size)
-    : BackendContext(name, gpu_device, max_batch_size), runtime_(nullptr),
-      engine_(nullptr), context_(nullptr), byte_sizes_(nullptr),
-      buffers_(nullptr)
+    : BackendContext(name, gpu_device, max_batch_size), engine_(nullptr),
+      context_(nullptr), implicit_batch_(true),
+      num_bindings_(0), byte_sizes_(nullptr), buffers_(nullptr),
+      next_binding_set_(0), input_stream_(nullptr), activation_pool_(nullptr)
 {
   stream_ = nullptr;
 }
@@ -53,12 +87,15 @@ PlanBackend::Context::~Context()
 {
   LOG_VERBOSE(1) << "~PlanBackend::Context ";
 
+  // Queued completions may still use the binding sets.
+  StopCompletions();
+
   if (byte_sizes_ != nullptr) {
     delete[] byte_sizes_;
     byte_sizes_ = nullptr;
   }
   if (buffers_ != nullptr) {
-    for (int i = 0; i < engine_->getNbBindings(); ++i) {
+    for (int i = 0; i < num_bindings_; ++i) {
       if (buffers_[i] != nullptr) {
         cudaError_t err = cudaFree(buffers_[i]);
         if (err != cudaSuccess) {
@@ -72,36 +109,75 @@ PlanBackend::Context::~Context()
     buffers_ = nullptr;
   }
 
-  for (const auto& pr : cuda_graph_execs_) {
-    cudaError_t err = cudaGraphExecDestroy(pr.second);
-    if (err != cudaSuccess) {
-      LOG_ERROR << "Failed to destroy cuda graph exec: "
-                << cudaGetErrorString(err);
+  for (size_t s = 0; s < binding_sets_.size(); ++s) {
+    BindingSet& set = binding_sets_[s];
+    for (const auto& pr : set.cuda_graph_execs_) {
+      cudaError_t err = cudaGraphExecDestroy(pr.second);
+      if (err != cudaSuccess) {
+        LOG_ERROR << "Failed to destroy cuda graph exec: "
+                  << cudaGetErrorString(err);
+      }
     }
-  }
-  cuda_graph_execs_.clear();
+    set.cuda_graph_execs_.clear();
 
-  for (const auto& pr : cuda_graphs_) {
-    cudaError_t err = cudaGraphDestroy(pr.second);
-    if (err != cudaSuccess) {
-      LOG_ERROR << "Failed to destroy cuda graph exec: "
-                << cudaGetErrorString(err);
+    for (const auto& pr : set.cuda_graphs_) {
+      cudaError_t err = cudaGraphDestroy(pr.second);
+      if (err != cudaSuccess) {
+        LOG_ERROR << "Failed to destroy cuda graph exec: "
+                  << cudaGetErrorString(err);
+      }
     }
-  }
-  cuda_graphs_.clear();
+    set.cuda_graphs_.clear();
 
-  if (stream_ != nullptr) {
-    cudaError_t err = cudaStreamDestroy(stream_);
-    if (err != cudaSuccess) {
-      LOG_ERROR << "Failed to destroy cuda stream: " << cudaGetErrorString(err);
+    for (cudaEvent_t event : {set.ready_event_, set.done_event_}) {
+      if (event != nullptr) {
+        cudaError_t err = cudaEventDestroy(event);
+        if (err != cudaSuccess) {
+          LOG_ERROR << "Failed to destroy cuda event: "
+                    << cudaGetErrorString(err);
+        }
+      }
+    }
+
+    // The buffers of the first set are owned by 'buffers_'.
+    if (s != 0) {
+      for (void* buffer : set.buffers_) {
+        if (buffer != nullptr) {
+          cudaError_t err = cudaFree(buffer);
+          if (err != cudaSuccess) {
+            LOG_ERROR << "Failed to free cuda memory for '" << name_
+                      << "': " << cudaGetErrorString(err);
+          }
+        }
+      }
+    }
+  }
+  binding_sets_.clear();
+
+  for (cudaStream_t* stream : {&stream_, &input_stream_}) {
+    if (*stream != nullptr) {
+      cudaError_t err = cudaStreamDestroy(*stream);
+      if (err != cudaSuccess) {
+        LOG_ERROR << "Failed to destroy cuda stream: "
+                  << cudaGetErrorString(err);
+      }
+      *stream = nullptr;
     }
-    stream_ = nullptr;
   }
 
+  for (const auto& profile : profiles_) {
+    profile.context_->destroy();
+  }
+  profiles_.clear();
+
   if (context_ != nullptr) {
     context_->destroy();
     context_ = nullptr;
   }
+}
+
+PlanBackend::SharedEngine::~SharedEngine()
+{
   if (engine_ != nullptr) {
     engine_->destroy();
     engine_ = nullptr;
@@ -112,6 +188,127 @@ PlanBackend::Context::~Context()
   }
 }
 
+PlanBackend::ActivationPool::ActivationPool(const size_t count)
+    : buffers_(count, Buffer{nullptr, nullptr, false}), held_cnt_(0),
+      next_(0), byte_size_(0)
+{
+}
+
+PlanBackend::ActivationPool::~ActivationPool()
+{
+  for (auto& buffer : buffers_) {
+    if (buffer.event_ != nullptr) {
+      cudaEventSynchronize(buffer.event_);
+      cudaEventDestroy(buffer.event_);
+    }
+    if (buffer.memory_ != nullptr) {
+      cudaError_t err = cudaFree(buffer.memory_);
+      if (err != cudaSuccess) {
+        LOG_ERROR << "Failed to free activation memory: "
+                  << cudaGetErrorString(err);
+      }
+    }
+  }
+}
+
+Status
+PlanBackend::ActivationPool::Reserve(const size_t byte_size)
+{
+  for (auto& buffer : buffers_) {
+    if (buffer.event_ == nullptr) {
+      cudaError_t err =
+          cudaEventCreateWithFlags(&buffer.event_, cudaEventDisableTiming);
+      if (err != cudaSuccess) {
+        buffer.event_ = nullptr;
+        return Status(
+            RequestStatusCode::INTERNAL,
+            std::string("unable to create activation memory event: ") +
+                cudaGetErrorString(err));
+      }
+    }
+  }
+
+  if (byte_size <= byte_size_) {
+    return Status::Success;
+  }
+
+  // No execution uses the pool yet so the buffers can be replaced.
+  for (auto& buffer : buffers_) {
+    if (buffer.memory_ != nullptr) {
+      cudaFree(buffer.memory_);
+      buffer.memory_ = nullptr;
+    }
+    cudaError_t err = cudaMalloc(&buffer.memory_, byte_size);
+    if (err != cudaSuccess) {
+      buffer.memory_ = nullptr;
+      byte_size_ = 0;
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "unable to allocate " + std::to_string(byte_size) +
+              " bytes of activation memory: " + cudaGetErrorString(err));
+    }
+  }
+
+  byte_size_ = byte_size;
+  return Status::Success;
+}
+
+void*
+PlanBackend::ActivationPool::Acquire(cudaStream_t stream, size_t* idx)
+{
+  std::unique_lock<std::mutex> lock(mu_);
+  cv_.wait(lock, [this] { return held_cnt_ < buffers_.size(); });
+
+  // Take the next buffer in turn that is not held, preferring one
+  // whose last execution has already completed.
+  size_t selected = buffers_.size();
+  for (size_t i = 0; i < buffers_.size(); ++i) {
+    const size_t b = (next_ + i) % buffers_.size();
+    if (buffers_[b].held_) {
+      continue;
+    }
+    if (selected == buffers_.size()) {
+      selected = b;
+    }
+    if (cudaEventQuery(buffers_[b].event_) == cudaSuccess) {
+      selected = b;
+      break;
+    }
+  }
+
+  Buffer& buffer = buffers_[selected];
+  buffer.held_ = true;
+  held_cnt_++;
+  next_ = (selected + 1) % buffers_.size();
+  lock.unlock();
+
+  cudaStreamWaitEvent(stream, buffer.event_, 0);
+  *idx = selected;
+  return buffer.memory_;
+}
+
+void
+PlanBackend::ActivationPool::Release(const size_t idx, cudaStream_t stream)
+{
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    Buffer& buffer = buffers_[idx];
+    cudaEventRecord(buffer.event_, stream);
+    buffer.held_ = false;
+    held_cnt_--;
+  }
+  cv_.notify_one();
+}
+
+PlanBackend::~PlanBackend()
+{
+  // The contexts must be destroyed before the activation memory and
+  // the engines they use.
+  contexts_.clear();
+  activation_pools_.clear();
+  engines_.clear();
+}
+
 Status
 PlanBackend::Init(const std::string& path, const ModelConfig& config)
 {
@@ -123,20 +320,40 @@ PlanBackend::Init(const std::string& path, const ModelConfig& config)
 
 Status
 PlanBackend::CreateExecutionContexts(
-    const std::unordered_map<std::string, std::vector<char>>& models)
+    const std::unordered_map<std::string, std::shared_ptr<MappedFile>>&
+        models,
+    const std::string& engine_cache_dir)
 {
   // TensorRT engine creation is not thread-safe, so multiple creations
-  // are serialized with a global lock.
+  // are serialized with a global lock. Within the lock the contexts of
+  // different GPUs are created in parallel, each GPU deserializing
+  // with runtimes of its own.
   static std::mutex global_context_mu;
   std::lock_guard<std::mutex> glock(global_context_mu);
 
-  uint32_t total_context_cnt = 0;
+  // Collect the instances to create, and for each GPU the indices of
+  // its instances. The index of an instance is the index of its runner.
+  struct Instance {
+    std::string name_;
+    int gpu_device_;
+    int dla_core_;
+    std::vector<int> profiles_;
+  };
+  std::vector<Instance> instances;
+  std::map<int, std::vector<size_t>> device_instances;
+
+  // The instances of a model on DLA are spread over its DLA cores,
+  // and layers that DLA doesn't support fall back to the GPU.
+  std::vector<int> dla_cores;
+  RETURN_IF_ERROR(GetDLACores(&dla_cores));
+  if (!dla_cores.empty() &&
+      !Config().optimization().tensorrt_build().onnx_model_filename().empty()) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "the DLA execution accelerator of model " + Name() +
+            " requires a plan built for DLA, not an ONNX model to build");
+  }
 
-  // Create a runtime/engine/context trifecta for each instance.
-  //
-  // TODO [DLIS-14] This can be optimized by sharing a runtime (across
-  // all instances?), and sharing an engine across instances that have
-  // access to the same GPU.
   for (const auto& group : Config().instance_group()) {
     // TensorRT requires that every context have a GPU.
     if ((group.kind() != ModelInstanceGroup::KIND_GPU) ||
@@ -147,18 +364,89 @@ PlanBackend::CreateExecutionContexts(
               " must be KIND_GPU and must specify at least one GPU id");
     }
 
+    const std::vector<int> profiles(
+        group.profile().begin(), group.profile().end());
     for (int c = 0; c < group.count(); c++) {
       for (int gpu_device : group.gpus()) {
-        const std::string instance_name = group.name() + "_" +
-                                          std::to_string(c) + "_gpu" +
-                                          std::to_string(gpu_device);
-        RETURN_IF_ERROR(
-            CreateExecutionContext(instance_name, gpu_device, models));
-        total_context_cnt++;
+        std::string instance_name = group.name() + "_" + std::to_string(c) +
+                                    "_gpu" + std::to_string(gpu_device);
+        int dla_core = -1;
+        if (!dla_cores.empty()) {
+          dla_core = dla_cores[c % dla_cores.size()];
+          instance_name += "_dla" + std::to_string(dla_core);
+        }
+        device_instances[gpu_device].push_back(instances.size());
+        instances.push_back(
+            Instance{instance_name, gpu_device, dla_core, profiles});
       }
     }
   }
 
+  // The contexts on a GPU can share a pool of activation memory. An
+  // instance executes one batch at a time so a pool needs at most one
+  // buffer for each instance on the GPU.
+  const int pool_size =
+      Config().optimization().cuda().activation_memory_pool_size();
+  if (pool_size < 0) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "activation memory pool size for " + Name() +
+            " must be non-negative, got " + std::to_string(pool_size));
+  }
+  activation_pools_.clear();
+  if (pool_size > 0) {
+    for (const auto& pr : device_instances) {
+      activation_pools_[pr.first].reset(new ActivationPool(
+          std::min((size_t)pool_size, pr.second.size())));
+    }
+  }
+
+  // The instances of a GPU are created in order so that they can
+  // share the GPU's engine.
+  const bool build =
+      !Config().optimization().tensorrt_build().onnx_model_filename().empty();
+  const uint32_t total_context_cnt = instances.size();
+  contexts_.resize(total_context_cnt);
+  std::vector<Status> device_status(device_instances.size());
+  std::vector<std::thread> device_threads;
+  size_t device_cnt = 0;
+  for (const auto& pr : device_instances) {
+    Status* status = &device_status[device_cnt++];
+    const std::vector<size_t>* indices = &pr.second;
+    const int gpu_device = pr.first;
+    device_threads.emplace_back([this, &instances, &models,
+                                 &engine_cache_dir, build, status, indices,
+                                 gpu_device]() {
+      // An engine built from an ONNX model is built once for the GPU
+      // and shared by its instances.
+      std::vector<char> built_plan;
+      if (build) {
+        *status =
+            BuildEngine(gpu_device, models, engine_cache_dir, &built_plan);
+        if (!status->IsOk()) {
+          return;
+        }
+      }
+
+      for (const size_t idx : *indices) {
+        const Instance& instance = instances[idx];
+        *status = CreateExecutionContext(
+            instance.name_, instance.gpu_device_, instance.dla_core_,
+            instance.profiles_, models, build ? &built_plan : nullptr, idx);
+        if (!status->IsOk()) {
+          break;
+        }
+      }
+    });
+  }
+
+  for (auto& thread : device_threads) {
+    thread.join();
+  }
+  for (const auto& status : device_status) {
+    RETURN_IF_ERROR(status);
+  }
+
   // Create a scheduler with one thread for each context available for
   // this model. Each runner is exclusively tied to the context.
   RETURN_IF_ERROR(SetConfiguredScheduler(
@@ -178,7 +466,10 @@ PlanBackend::CreateExecutionContexts(
 Status
 PlanBackend::CreateExecutionContext(
     const std::string& instance_name, const int gpu_device,
-    const std::unordered_map<std::string, std::vector<char>>& models)
+    const int dla_core, const std::vector<int>& profiles,
+    const std::unordered_map<std::string, std::shared_ptr<MappedFile>>&
+        models,
+    const std::vector<char>* built_plan, const size_t context_idx)
 {
   cudaError_t cuerr;
 
@@ -196,26 +487,44 @@ PlanBackend::CreateExecutionContext(
       std::to_string(cuprops.major) + "." + std::to_string(cuprops.minor);
   const auto& cc_itr = Config().cc_model_filenames().find(cc);
   const std::string& cc_model_filename =
-      (cc_itr == Config().cc_model_filenames().end())
-          ? Config().default_model_filename()
-          : cc_itr->second;
-
-  const auto& mn_itr = models.find(cc_model_filename);
-  if (mn_itr == models.end()) {
-    return Status(
-        RequestStatusCode::INTERNAL,
-        "unable to find PLAN model '" + cc_model_filename + "' for " + Name());
+      (built_plan != nullptr)
+          ? Config().optimization().tensorrt_build().onnx_model_filename()
+          : (cc_itr == Config().cc_model_filenames().end())
+                ? Config().default_model_filename()
+                : cc_itr->second;
+
+  const char* model_data = nullptr;
+  size_t model_byte_size = 0;
+  if (built_plan != nullptr) {
+    model_data = built_plan->data();
+    model_byte_size = built_plan->size();
+  } else {
+    const auto& mn_itr = models.find(cc_model_filename);
+    if (mn_itr == models.end()) {
+      return Status(
+          RequestStatusCode::INTERNAL, "unable to find PLAN model '" +
+                                           cc_model_filename + "' for " +
+                                           Name());
+    }
+    model_data = mn_itr->second->Data();
+    model_byte_size = mn_itr->second->Size();
   }
 
-  LOG_INFO << "Creating instance " << instance_name << " on GPU " << gpu_device
-           << " (" << cc << ") using " << cc_model_filename;
+  if (dla_core >= 0) {
+    LOG_INFO << "Creating instance " << instance_name << " on DLA core "
+             << dla_core << " of GPU " << gpu_device << " (" << cc
+             << ") using " << cc_model_filename;
+  } else {
+    LOG_INFO << "Creating instance " << instance_name << " on GPU "
+             << gpu_device << " (" << cc << ") using " << cc_model_filename;
+  }
 
   // Max batch size. A value of 0 in the config becomes NO_BATCHING.
   const int mbs = (Config().max_batch_size() <= 0) ? Context::NO_BATCHING
                                                    : Config().max_batch_size();
 
-  contexts_.emplace_back(new Context(instance_name, gpu_device, mbs));
-  const std::unique_ptr<Context>& context = contexts_.back();
+  contexts_[context_idx].reset(new Context(instance_name, gpu_device, mbs));
+  const std::unique_ptr<Context>& context = contexts_[context_idx];
 
   // Set the device before generating engine and context.
   cuerr = cudaSetDevice(gpu_device);
@@ -225,10 +534,29 @@ PlanBackend::CreateExecutionContext(
                                          ": " + cudaGetErrorString(cuerr));
   }
 
-  RETURN_IF_ERROR(
-      LoadPlan(mn_itr->second, &context->runtime_, &context->engine_));
+  RETURN_IF_ERROR(AcquireEngine(
+      gpu_device, dla_core, model_data, model_byte_size, profiles,
+      &context->engine_));
+
+  // A context that shares activation memory needs the pool to hold
+  // the activations of its engine. The pool memory is accounted as
+  // the pool grows.
+  const auto& pool_itr = activation_pools_.find(gpu_device);
+  if (pool_itr != activation_pools_.end()) {
+    ActivationPool* pool = pool_itr->second.get();
+    const size_t prev_byte_size = pool->byte_size_;
+    RETURN_IF_ERROR(pool->Reserve(context->engine_->getDeviceMemorySize()));
+    AddMemoryUsage(
+        gpu_device, MemoryKind::WORKSPACE,
+        (pool->byte_size_ - prev_byte_size) * pool->buffers_.size());
+    context->activation_pool_ = pool;
+  }
 
-  if (context->max_batch_size_ > context->engine_->getMaxBatchSize()) {
+  // The maximum batch size of an engine with explicit dimensions is
+  // given by its optimization profiles.
+  context->implicit_batch_ = context->engine_->hasImplicitBatchDimension();
+  if (context->implicit_batch_ &&
+      (context->max_batch_size_ > context->engine_->getMaxBatchSize())) {
     return Status(
         RequestStatusCode::INVALID_ARG,
         "unexpected configuration maximum batch size " +
@@ -237,7 +565,11 @@ PlanBackend::CreateExecutionContext(
             std::to_string(context->engine_->getMaxBatchSize()));
   }
 
-  const int num_expected_bindings = context->engine_->getNbBindings();
+  // The execution contexts of the optimization profiles are needed to
+  // size the bindings.
+  RETURN_IF_ERROR(context->InitializeProfiles(profiles));
+
+  const int num_expected_bindings = context->num_bindings_;
 
   // Collect all the expected input and allowed output tensor names
   // and validate that the model configuration specifies only those.
@@ -282,35 +614,87 @@ PlanBackend::CreateExecutionContext(
     }
   }
 
-  // Now the TRT execution context
-  context->context_ = context->engine_->createExecutionContext();
-  if (context->context_ == nullptr) {
-    return Status(
-        RequestStatusCode::INTERNAL, "unable to create TensorRT context");
+  RETURN_IF_ERROR(context->InitializeBindingSets());
+
+  // Now the TRT execution context. An engine with explicit dimensions
+  // uses the contexts of its profiles.
+  if (context->implicit_batch_) {
+    context->context_ =
+        (context->activation_pool_ != nullptr)
+            ? context->engine_->createExecutionContextWithoutDeviceMemory()
+            : context->engine_->createExecutionContext();
+    if (context->context_ == nullptr) {
+      return Status(
+          RequestStatusCode::INTERNAL, "unable to create TensorRT context");
+    }
+  }
+
+  // Each binding set holds a buffer for every binding, and each TRT
+  // execution context that doesn't use the pool holds the activation
+  // memory of the engine.
+  uint64_t io_byte_size = 0;
+  for (int i = 0; i < num_expected_bindings; ++i) {
+    io_byte_size += context->byte_sizes_[i];
+  }
+  AddMemoryUsage(
+      gpu_device, MemoryKind::IO,
+      io_byte_size * context->binding_sets_.size());
+  if (context->activation_pool_ == nullptr) {
+    const size_t exec_context_cnt =
+        context->implicit_batch_ ? 1 : context->profiles_.size();
+    AddMemoryUsage(
+        gpu_device, MemoryKind::WORKSPACE,
+        context->engine_->getDeviceMemorySize() * exec_context_cnt);
   }
 
   // Create CUDA stream associated with the execution context
   const int cuda_stream_priority =
       GetCudaStreamPriority(Config().optimization().priority());
   RETURN_IF_ERROR(context->CreateCudaStream(cuda_stream_priority));
+  RETURN_IF_ERROR(context->CreateCudaStream(
+      cuda_stream_priority, &context->input_stream_));
 
   // CUDA 10.1 starts to support CUDA graphs.
-  // If enabled, build CUDA graphs for a default set of graph
-  // sizes. Graphs are most likely to help for small batch sizes so by
+  // If enabled, build CUDA graphs for the configured batch sizes.
+  // Graphs are most likely to help for small batch sizes so by
   // default build for batch sizes 1, 2, 3, 4, 6, 8, 12, 16. If any
-  // build fails don't attempt for any larger batch sizes.
+  // build fails don't attempt for any larger batch sizes. The graphs
+  // fix the shapes of the bindings so they are not used for an engine
+  // with explicit dimensions, and fix the activation memory so they
+  // are not used with an activation memory pool.
 #ifdef TRTIS_ENABLE_CUDA_GRAPH
-  const bool use_cuda_graphs = Config().optimization().cuda().graphs();
+  const auto& cuda_config = Config().optimization().cuda();
+  const bool use_cuda_graphs = cuda_config.graphs() &&
+                               context->implicit_batch_ &&
+                               (context->activation_pool_ == nullptr);
   if (use_cuda_graphs) {
-    if (context->BuildCudaGraph(1)) {
-      for (int bs : std::vector<int>{2, 3, 4, 6, 8, 12, 16}) {
-        if (bs <= Config().max_batch_size()) {
-          if (!context->BuildCudaGraph(bs)) {
-            break;
-          }
+    const int max_graph_batch_size = std::max(1, context->max_batch_size_);
+    std::set<int> graph_batch_sizes(
+        cuda_config.graph_batch_sizes().begin(),
+        cuda_config.graph_batch_sizes().end());
+    if (graph_batch_sizes.empty()) {
+      for (int bs : std::vector<int>{1, 2, 3, 4, 6, 8, 12, 16}) {
+        if (bs <= max_graph_batch_size) {
+          graph_batch_sizes.insert(bs);
         }
       }
     }
+
+    for (int bs : graph_batch_sizes) {
+      if ((bs < 1) || (bs > max_graph_batch_size)) {
+        return Status(
+            RequestStatusCode::INVALID_ARG,
+            "CUDA graph batch size " + std::to_string(bs) + " for " +
+                Name() + " must be between 1 and " +
+                std::to_string(max_graph_batch_size));
+      }
+    }
+
+    for (int bs : graph_batch_sizes) {
+      if (!context->BuildCudaGraph(bs)) {
+        break;
+      }
+    }
   }
 #endif
 
@@ -320,6 +704,155 @@ PlanBackend::CreateExecutionContext(
   return Status::Success;
 }
 
+Status
+PlanBackend::BuildEngine(
+    const int gpu_device,
+    const std::unordered_map<std::string, std::shared_ptr<MappedFile>>&
+        models,
+    const std::string& engine_cache_dir, std::vector<char>* plan)
+{
+  const auto& settings = Config().optimization().tensorrt_build();
+  const auto& mn_itr = models.find(settings.onnx_model_filename());
+  if (mn_itr == models.end()) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "unable to find ONNX model '" + settings.onnx_model_filename() +
+            "' for " + Name());
+  }
+
+  cudaError_t cuerr = cudaSetDevice(gpu_device);
+  if (cuerr != cudaSuccess) {
+    return Status(
+        RequestStatusCode::INTERNAL, "unable to set device for " + Name() +
+                                         ": " + cudaGetErrorString(cuerr));
+  }
+
+  LOG_INFO << "Building TensorRT engine for " << Name() << " on GPU "
+           << gpu_device << " from " << settings.onnx_model_filename();
+
+  Status status = LoadOrBuildPlan(
+      engine_cache_dir, mn_itr->second->Data(), mn_itr->second->Size(),
+      settings, gpu_device, plan);
+  if (!status.IsOk()) {
+    return Status(
+        status.Code(), "unable to build TensorRT engine for " + Name() +
+                           ": " + status.Message());
+  }
+
+  return Status::Success;
+}
+
+Status
+PlanBackend::GetDLACores(std::vector<int>* dla_cores)
+{
+  dla_cores->clear();
+  if (!Config().optimization().has_execution_accelerators()) {
+    return Status::Success;
+  }
+
+  for (const auto& execution_accelerator :
+       Config()
+           .optimization()
+           .execution_accelerators()
+           .gpu_execution_accelerator()) {
+    if (execution_accelerator.name() != kDLAExecutionAccelerator) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "unknown Execution Accelerator '" + execution_accelerator.name() +
+              "' is requested for " + Name());
+    }
+
+    // The "cores" parameter is a comma-separated list of DLA core
+    // indices, by default only core 0.
+    std::string cores_str = "0";
+    const auto& param_itr = execution_accelerator.parameters().find("cores");
+    if (param_itr != execution_accelerator.parameters().end()) {
+      cores_str = param_itr->second;
+    }
+
+    std::stringstream ss(cores_str);
+    std::string core;
+    while (std::getline(ss, core, ',')) {
+      int dla_core = -1;
+      try {
+        dla_core = std::stoi(core);
+      }
+      catch (...) {
+      }
+      if (dla_core < 0) {
+        return Status(
+            RequestStatusCode::INVALID_ARG,
+            "invalid DLA core '" + core + "' requested for " + Name());
+      }
+      dla_cores->push_back(dla_core);
+    }
+  }
+
+  return Status::Success;
+}
+
+Status
+PlanBackend::AcquireEngine(
+    const int gpu_device, const int dla_core, const char* model_data,
+    const size_t model_byte_size, const std::vector<int>& profiles,
+    nvinfer1::ICudaEngine** engine)
+{
+  std::set<int> used_profiles(profiles.begin(), profiles.end());
+  if (used_profiles.empty()) {
+    used_profiles.insert(0);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(engines_mu_);
+    for (const auto& shared : engines_) {
+      if ((shared->gpu_device_ != gpu_device) ||
+          (shared->dla_core_ != dla_core)) {
+        continue;
+      }
+
+      // The profiles of an engine with an implicit batch dimension
+      // are not used.
+      bool can_share = shared->engine_->hasImplicitBatchDimension();
+      if (!can_share) {
+        can_share = true;
+        for (const int p : used_profiles) {
+          if (shared->profiles_.find(p) != shared->profiles_.end()) {
+            can_share = false;
+            break;
+          }
+        }
+      }
+
+      if (can_share) {
+        shared->profiles_.insert(used_profiles.begin(), used_profiles.end());
+        *engine = shared->engine_;
+        return Status::Success;
+      }
+    }
+  }
+
+  // Only the thread creating the contexts of 'gpu_device' adds engines
+  // for it, so the engine can be deserialized without holding the
+  // lock.
+  std::unique_ptr<SharedEngine> shared(new SharedEngine());
+  shared->gpu_device_ = gpu_device;
+  shared->dla_core_ = dla_core;
+  shared->profiles_ = used_profiles;
+  RETURN_IF_ERROR(LoadPlan(
+      model_data, model_byte_size, dla_core, &shared->runtime_,
+      &shared->engine_));
+
+  // The weights of the engine are held in device memory and take
+  // about as much as the serialized engine.
+  AddMemoryUsage(gpu_device, MemoryKind::MODEL, model_byte_size);
+
+  *engine = shared->engine_;
+  std::lock_guard<std::mutex> lock(engines_mu_);
+  engines_.push_back(std::move(shared));
+
+  return Status::Success;
+}
+
 Status
 PlanBackend::Context::ValidateInputs(
     const ::google::protobuf::RepeatedPtrField<ModelInput>& ios)
@@ -389,7 +922,13 @@ PlanBackend::Context::InitializeInputBinding(
   }
 
   nvinfer1::Dims engine_dims = engine_->getBindingDimensions(index);
-  if (!CompareDims(engine_dims, model_config_dims)) {
+  const bool dims_match =
+      implicit_batch_
+          ? CompareDims(engine_dims, model_config_dims)
+          : CompareDynamicDims(
+                engine_dims, model_config_dims,
+                (max_batch_size_ != NO_BATCHING) /* has_batch_dim */);
+  if (!dims_match) {
     return Status(
         RequestStatusCode::INVALID_ARG,
         "unexpected shape for input '" + input_name +
@@ -398,7 +937,12 @@ PlanBackend::Context::InitializeInputBinding(
             DimsDebugString(engine_dims) + " for " + name_);
   }
 
-  const int64_t byte_size = GetByteSize(max_batch_size_, dt, model_config_dims);
+  int64_t byte_size;
+  if (implicit_batch_) {
+    byte_size = GetByteSize(max_batch_size_, dt, model_config_dims);
+  } else {
+    RETURN_IF_ERROR(GetMaxProfileByteSize(index, dt, &byte_size));
+  }
   if (byte_size == -1) {
     return Status(
         RequestStatusCode::INTERNAL,
@@ -448,6 +992,14 @@ PlanBackend::Context::InitializeSequenceControlInputBindings(
 
       RETURN_IF_ERROR(
           InitializeInputBinding(tensor_name, tensor_datatype, dims));
+      staged_inputs_.emplace(
+          engine_->getBindingIndex(tensor_name.c_str()), std::vector<char>());
+    }
+
+    // Each implicit state is delivered to the model through an input.
+    for (const auto& state : config.sequence_batching().state()) {
+      RETURN_IF_ERROR(InitializeInputBinding(
+          state.input_name(), state.data_type(), state.dims()));
     }
   }
 
@@ -507,7 +1059,13 @@ PlanBackend::Context::InitializeConfigOutputBindings(
         (io.has_reshape()) ? io.reshape().shape() : io.dims();
 
     nvinfer1::Dims engine_dims = engine_->getBindingDimensions(index);
-    if (!CompareDims(engine_dims, model_config_dims)) {
+    const bool dims_match =
+        implicit_batch_
+            ? CompareDims(engine_dims, model_config_dims)
+            : CompareDynamicDims(
+                  engine_dims, model_config_dims,
+                  (max_batch_size_ != NO_BATCHING) /* has_batch_dim */);
+    if (!dims_match) {
       return Status(
           RequestStatusCode::INVALID_ARG,
           "unexpected shape for output '" + io.name() +
@@ -516,8 +1074,12 @@ PlanBackend::Context::InitializeConfigOutputBindings(
               DimsDebugString(engine_dims) + " for " + name_);
     }
 
-    const int64_t byte_size =
-        GetByteSize(max_batch_size_, dt, model_config_dims);
+    int64_t byte_size;
+    if (implicit_batch_) {
+      byte_size = GetByteSize(max_batch_size_, dt, model_config_dims);
+    } else {
+      RETURN_IF_ERROR(GetMaxProfileByteSize(index, dt, &byte_size));
+    }
     if (byte_size == -1) {
       return Status(
           RequestStatusCode::INTERNAL, "unable to calculate size for output '" +
@@ -567,23 +1129,327 @@ PlanBackend::Run(
     }
   }
 
-  Status status = contexts_[runner_idx]->Run(payloads);
+  Context* context = contexts_[runner_idx].get();
+  Status status = context->Run(payloads);
 
-  // Stop compute timers.
-  for (auto& payload : *payloads) {
-    if (payload.stats_ != nullptr) {
-      payload.stats_->CaptureTimestamp(
-          ModelInferStats::TimestampKind::kComputeEnd);
+  auto OnComplete = [payloads, status, OnCompleteQueuedPayloads]() {
+    // Stop compute timers.
+    for (auto& payload : *payloads) {
+      if (payload.stats_ != nullptr) {
+        payload.stats_->CaptureTimestamp(
+            ModelInferStats::TimestampKind::kComputeEnd);
+      }
+    }
+
+    OnCompleteQueuedPayloads(status);
+  };
+
+  // The payloads are complete once the execution and the copies of
+  // its outputs finish. That is waited for on the context's
+  // completion thread so that the runner can schedule the next batch
+  // into the other binding set in the meantime. The implicit state of
+  // a sequence is saved when its payload completes, so a model with
+  // implicit state completes synchronously to make sure the state is
+  // saved before the next execution of the sequence.
+  if (status.IsOk() && (Config().sequence_batching().state_size() == 0)) {
+    context->CompleteAsync(std::move(OnComplete), kBindingSetCount);
+  } else {
+    cudaStreamSynchronize(context->stream_);
+    OnComplete();
+  }
+}
+
+Status
+PlanBackend::Context::InitializeProfiles(const std::vector<int>& profiles)
+{
+  const int profile_cnt = std::max(1, engine_->getNbOptimizationProfiles());
+  num_bindings_ = engine_->getNbBindings() / profile_cnt;
+
+  if (implicit_batch_) {
+    if (!profiles.empty()) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "optimization profiles can only be specified for a TensorRT "
+          "engine with explicit dimensions, for " +
+              name_);
+    }
+
+    return Status::Success;
+  }
+
+  for (int i = 0; i < num_bindings_; ++i) {
+    if (engine_->isShapeBinding(i)) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "shape tensor binding '" + std::string(engine_->getBindingName(i)) +
+              "' is not supported for " + name_);
+    }
+  }
+
+  std::set<int> used_profiles;
+  for (const int p : (profiles.empty() ? std::vector<int>{0} : profiles)) {
+    if ((p < 0) || (p >= profile_cnt)) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "unexpected optimization profile " + std::to_string(p) +
+              ", model has " + std::to_string(profile_cnt) +
+              " profiles, for " + name_);
+    }
+    if (!used_profiles.insert(p).second) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "optimization profile " + std::to_string(p) +
+              " is specified more than once for " + name_);
+    }
+
+    nvinfer1::IExecutionContext* context =
+        (activation_pool_ != nullptr)
+            ? engine_->createExecutionContextWithoutDeviceMemory()
+            : engine_->createExecutionContext();
+    if (context == nullptr) {
+      return Status(
+          RequestStatusCode::INTERNAL, "unable to create TensorRT context");
+    }
+    profiles_.push_back(Profile{p, context});
+
+    if (!context->setOptimizationProfile(p)) {
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "unable to set optimization profile " + std::to_string(p) +
+              " for " + name_);
+    }
+  }
+
+  return Status::Success;
+}
+
+Status
+PlanBackend::Context::GetMaxProfileByteSize(
+    const int index, const DataType dt, int64_t* byte_size)
+{
+  *byte_size = 0;
+  for (const auto& profile : profiles_) {
+    const int offset = profile.index_ * num_bindings_;
+
+    // Set every input to its largest shape in the profile so that the
+    // largest shape of each output is known.
+    for (int i = 0; i < num_bindings_; ++i) {
+      if (!engine_->bindingIsInput(i)) {
+        continue;
+      }
+
+      nvinfer1::Dims dims = engine_->getProfileDimensions(
+          offset + i, profile.index_, nvinfer1::OptProfileSelector::kMAX);
+      if ((max_batch_size_ != NO_BATCHING) && (dims.nbDims > 0)) {
+        dims.d[0] = std::min(dims.d[0], max_batch_size_);
+      }
+      if (!profile.context_->setBindingDimensions(offset + i, dims)) {
+        return Status(
+            RequestStatusCode::INTERNAL,
+            "unable to set shape " + DimsDebugString(dims) + " for input '" +
+                engine_->getBindingName(i) + "' for " + name_);
+      }
+    }
+
+    const nvinfer1::Dims dims =
+        profile.context_->getBindingDimensions(offset + index);
+    std::vector<int64_t> shape;
+    for (int i = 0; i < dims.nbDims; ++i) {
+      if (dims.d[i] < 0) {
+        return Status(
+            RequestStatusCode::INTERNAL,
+            "unable to determine the shape of '" +
+                std::string(engine_->getBindingName(index)) +
+                "' for optimization profile " +
+                std::to_string(profile.index_) + " for " + name_);
+      }
+      shape.push_back(dims.d[i]);
     }
+
+    *byte_size = std::max(*byte_size, GetByteSize(dt, shape));
   }
 
-  OnCompleteQueuedPayloads(status);
+  return Status::Success;
+}
+
+Status
+PlanBackend::Context::SelectProfile(
+    const size_t total_batch_size, std::vector<Scheduler::Payload>* payloads,
+    const Profile** profile)
+{
+  // The shape of each input, including the batch dimension, is taken
+  // from the first payload. The payloads of a batch must have the
+  // same shapes so any other payload fails.
+  const InferRequestProvider& first_provider =
+      *payloads->front().request_provider_;
+  std::vector<std::vector<int64_t>> shapes(num_bindings_);
+  for (int bindex = 0; bindex < num_bindings_; ++bindex) {
+    if (!engine_->bindingIsInput(bindex)) {
+      continue;
+    }
+
+    const std::string name = engine_->getBindingName(bindex);
+    const DimsList* dims = RequestInputDims(first_provider, name);
+    if (dims == nullptr) {
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "unable to find shape of input '" + name + "' for " + name_);
+    }
+
+    if (max_batch_size_ != NO_BATCHING) {
+      shapes[bindex].push_back(total_batch_size);
+    }
+    shapes[bindex].insert(shapes[bindex].end(), dims->begin(), dims->end());
+
+    for (size_t idx = 1; idx < payloads->size(); ++idx) {
+      auto& payload = (*payloads)[idx];
+      const DimsList* payload_dims =
+          RequestInputDims(*payload.request_provider_, name);
+      if ((payload_dims == nullptr) || !CompareDims(*dims, *payload_dims)) {
+        if (payload.status_.IsOk()) {
+          payload.status_ = Status(
+              RequestStatusCode::INVALID_ARG,
+              "shape of input '" + name + "' differs from the shape of " +
+                  "other requests batched together for " + name_);
+        }
+      }
+    }
+  }
+
+  // Of the profiles that allow the shapes choose the one with the
+  // smallest maximum shapes, which is the one the engine is most
+  // closely optimized for.
+  *profile = nullptr;
+  int64_t best_max_element_cnt = 0;
+  for (const auto& candidate : profiles_) {
+    const int offset = candidate.index_ * num_bindings_;
+    bool allowed = true;
+    int64_t max_element_cnt = 0;
+    for (int bindex = 0; allowed && (bindex < num_bindings_); ++bindex) {
+      if (!engine_->bindingIsInput(bindex)) {
+        continue;
+      }
+
+      const nvinfer1::Dims min_dims = engine_->getProfileDimensions(
+          offset + bindex, candidate.index_,
+          nvinfer1::OptProfileSelector::kMIN);
+      const nvinfer1::Dims max_dims = engine_->getProfileDimensions(
+          offset + bindex, candidate.index_,
+          nvinfer1::OptProfileSelector::kMAX);
+      allowed = DimsWithinRange(shapes[bindex], min_dims, max_dims);
+
+      int64_t element_cnt = 1;
+      for (int i = 0; i < max_dims.nbDims; ++i) {
+        element_cnt *= max_dims.d[i];
+      }
+      max_element_cnt += element_cnt;
+    }
+
+    if (allowed &&
+        ((*profile == nullptr) || (max_element_cnt < best_max_element_cnt))) {
+      *profile = &candidate;
+      best_max_element_cnt = max_element_cnt;
+    }
+  }
+
+  if (*profile == nullptr) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "no optimization profile of " + name_ +
+            " allows the shapes of the inputs");
+  }
+
+  const int offset = (*profile)->index_ * num_bindings_;
+  for (int bindex = 0; bindex < num_bindings_; ++bindex) {
+    if (!engine_->bindingIsInput(bindex)) {
+      continue;
+    }
+
+    nvinfer1::Dims dims;
+    dims.nbDims = shapes[bindex].size();
+    for (int i = 0; i < dims.nbDims; ++i) {
+      dims.d[i] = shapes[bindex][i];
+    }
+    if (!(*profile)->context_->setBindingDimensions(offset + bindex, dims)) {
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "unable to set shape " + DimsDebugString(dims) + " for input '" +
+              engine_->getBindingName(bindex) + "' for " + name_);
+    }
+  }
+
+  if (!(*profile)->context_->allInputDimensionsSpecified()) {
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "unable to set the shapes of all inputs for " + name_);
+  }
+
+  return Status::Success;
+}
+
+Status
+PlanBackend::Context::InitializeBindingSets()
+{
+  const int num_bindings = num_bindings_;
+
+  binding_sets_.resize(kBindingSetCount);
+  for (size_t s = 0; s < binding_sets_.size(); ++s) {
+    BindingSet& set = binding_sets_[s];
+    set.ready_event_ = nullptr;
+    set.done_event_ = nullptr;
+    set.staged_inputs_ = staged_inputs_;
+
+    if (s == 0) {
+      set.buffers_.assign(buffers_, buffers_ + num_bindings);
+    } else {
+      set.buffers_.resize(num_bindings, nullptr);
+      for (int i = 0; i < num_bindings; ++i) {
+        cudaError_t err = cudaMalloc(&set.buffers_[i], byte_sizes_[i]);
+        if (err != cudaSuccess) {
+          set.buffers_[i] = nullptr;
+          return Status(
+              RequestStatusCode::INTERNAL,
+              "unable to allocate memory for binding '" +
+                  std::string(engine_->getBindingName(i)) + "' for " +
+                  name_ + ": " + cudaGetErrorString(err));
+        }
+      }
+    }
+
+    for (cudaEvent_t* event : {&set.ready_event_, &set.done_event_}) {
+      cudaError_t err =
+          cudaEventCreateWithFlags(event, cudaEventDisableTiming);
+      if (err != cudaSuccess) {
+        *event = nullptr;
+        return Status(
+            RequestStatusCode::INTERNAL,
+            "unable to create cuda event for " + name_ + ": " +
+                cudaGetErrorString(err));
+      }
+    }
+  }
+
+  return Status::Success;
 }
 
 // CUDA 10.1 starts to support CUDA graphs.
 #ifdef TRTIS_ENABLE_CUDA_GRAPH
 bool
 PlanBackend::Context::BuildCudaGraph(const int batch_size)
+{
+  // Capture a graph for each binding set since the buffers are part
+  // of the graph.
+  for (BindingSet& set : binding_sets_) {
+    if (!BuildCudaGraph(batch_size, &set)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool
+PlanBackend::Context::BuildCudaGraph(const int batch_size, BindingSet* set)
 {
   bool captured = true;
   cudaError_t cuerr;
@@ -595,7 +1461,8 @@ PlanBackend::Context::BuildCudaGraph(const int batch_size)
               << cudaGetErrorString(cuerr);
     captured = false;
   } else {
-    if (!context_->enqueue(batch_size, buffers_, stream_, nullptr)) {
+    if (!context_->enqueue(
+            batch_size, set->buffers_.data(), stream_, nullptr)) {
       LOG_WARNING << "unable to record CUDA graph for " << name_;
       captured = false;
     }
@@ -615,8 +1482,8 @@ PlanBackend::Context::BuildCudaGraph(const int batch_size)
                   << cudaGetErrorString(cuerr);
         captured = false;
       } else {
-        cuda_graphs_.insert(std::make_pair(batch_size, graph));
-        cuda_graph_execs_.insert(std::make_pair(batch_size, graph_exec));
+        set->cuda_graphs_.insert(std::make_pair(batch_size, graph));
+        set->cuda_graph_execs_.insert(std::make_pair(batch_size, graph_exec));
       }
     }
   }
@@ -670,16 +1537,69 @@ PlanBackend::Context::Run(std::vector<Scheduler::Payload>* payloads)
             name_ + "', max allowed is " + std::to_string(max_batch_size_));
   }
 
+  // An engine with explicit dimensions executes using the profile
+  // that best matches the input shapes, in the profile's own binding
+  // indices.
+  const Profile* profile = nullptr;
+  if (!implicit_batch_) {
+    RETURN_IF_ERROR(SelectProfile(total_batch_size, payloads, &profile));
+  }
+  const int binding_offset =
+      (profile == nullptr) ? 0 : (profile->index_ * num_bindings_);
+
+  // The shape of each binding for this execution, including the batch
+  // dimension if the model supports batching, and the byte size of a
+  // single batch of it.
+  std::vector<std::vector<int64_t>> shapes(num_bindings_);
+  std::vector<size_t> batch1_byte_sizes(num_bindings_);
+  for (int bindex = 0; bindex < num_bindings_; ++bindex) {
+    if (profile == nullptr) {
+      if (max_batch_size_ != NO_BATCHING) {
+        shapes[bindex].push_back(total_batch_size);
+      }
+      const nvinfer1::Dims dims = engine_->getBindingDimensions(bindex);
+      shapes[bindex].insert(shapes[bindex].end(), dims.d, dims.d + dims.nbDims);
+      batch1_byte_sizes[bindex] =
+          byte_sizes_[bindex] / std::max(1, max_batch_size_);
+    } else {
+      const nvinfer1::Dims dims =
+          profile->context_->getBindingDimensions(binding_offset + bindex);
+      shapes[bindex].assign(dims.d, dims.d + dims.nbDims);
+      const DataType dt =
+          ConvertTrtTypeToDataType(engine_->getBindingDataType(bindex));
+      batch1_byte_sizes[bindex] =
+          GetByteSize(dt, shapes[bindex]) /
+          ((max_batch_size_ != NO_BATCHING) ? total_batch_size : 1);
+    }
+
+    if (byte_sizes_[bindex] < (batch1_byte_sizes[bindex] * total_batch_size)) {
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "unexpected size for '" +
+              std::string(engine_->getBindingName(bindex)) + "', byte-size " +
+              std::to_string(byte_sizes_[bindex]) + " is less than " +
+              std::to_string(total_batch_size) + " * " +
+              std::to_string(batch1_byte_sizes[bindex]));
+    }
+  }
+
+  // Use the next binding set. Its inputs are copied on
+  // 'input_stream_', which first waits for the last execution using
+  // the set to copy its outputs, so that the copies can overlap an
+  // execution that is still running in the other set.
+  BindingSet& set = binding_sets_[next_binding_set_];
+  next_binding_set_ = (next_binding_set_ + 1) % binding_sets_.size();
+  cudaStreamWaitEvent(input_stream_, set.done_event_, 0);
+
   // For each input, concatenate input values from each payload into
   // the corresponding binding.
-  for (int bindex = 0; bindex < engine_->getNbBindings(); ++bindex) {
+  for (int bindex = 0; bindex < num_bindings_; ++bindex) {
     if (!engine_->bindingIsInput(bindex)) {
       continue;
     }
 
     const std::string& name = engine_->getBindingName(bindex);
-    const size_t batch1_byte_size =
-        byte_sizes_[bindex] / std::max(1, max_batch_size_);
+    const size_t batch1_byte_size = batch1_byte_sizes[bindex];
 
     // Visit the payloads in order and copy the input tensors to
     // GPU. Skip payloads that had errors since they are not included
@@ -692,87 +1612,164 @@ PlanBackend::Context::Run(std::vector<Scheduler::Payload>* payloads)
           request_header.batch_size() * batch1_byte_size);
     }
 
-    SetInputBuffer(
-        name, expected_byte_sizes, payloads, TRTSERVER_MEMORY_GPU,
-        static_cast<char*>(buffers_[bindex]));
+    auto staged_itr = set.staged_inputs_.find(bindex);
+    if (staged_itr != set.staged_inputs_.end()) {
+      SetStagedInputBuffer(
+          name, expected_byte_sizes, payloads, TRTSERVER_MEMORY_GPU,
+          static_cast<char*>(set.buffers_[bindex]), &staged_itr->second,
+          input_stream_);
+    } else {
+      SetInputBuffer(
+          name, expected_byte_sizes, payloads, TRTSERVER_MEMORY_GPU,
+          static_cast<char*>(set.buffers_[bindex]), input_stream_);
+    }
   }
 
-  for (auto& payload : *payloads) {
-    if (payload.stats_ != nullptr) {
-      payload.stats_->CaptureTimestamp(
-          ModelInferStats::TimestampKind::kComputeInputEnd);
+  // Execution must not start until the inputs are in place.
+  CaptureInputCopyEnd(payloads, input_stream_);
+  cudaEventRecord(set.ready_event_, input_stream_);
+  cudaStreamWaitEvent(stream_, set.ready_event_, 0);
+
+  // When there is a single request its output buffers can be
+  // allocated before execution. An output buffer that is in GPU
+  // memory on this context's device, for example a CUDA shared memory
+  // region registered by the client, is bound directly as the
+  // TensorRT binding so that the output is written in place instead
+  // of being copied out of the binding set after execution. The
+  // bindings of the profiles not used are left unset.
+  std::vector<void*> bindings(engine_->getNbBindings(), nullptr);
+  std::copy(
+      set.buffers_.begin(), set.buffers_.end(),
+      bindings.begin() + binding_offset);
+  std::unordered_map<int, void*> preallocated_outputs;
+  bool direct_output = false;
+  Scheduler::Payload& first_payload = payloads->front();
+  if ((payloads->size() == 1) &&
+      (first_payload.response_provider_ != nullptr)) {
+    for (int bindex = 0; bindex < num_bindings_; ++bindex) {
+      const std::string& name = engine_->getBindingName(bindex);
+      if (engine_->bindingIsInput(bindex) ||
+          !first_payload.response_provider_->RequiresOutput(name)) {
+        continue;
+      }
+
+      const size_t byte_size = batch1_byte_sizes[bindex] * total_batch_size;
+      if (byte_size == 0) {
+        continue;
+      }
+
+      void* buffer = nullptr;
+      Status status = first_payload.response_provider_->AllocateOutputBuffer(
+          name, &buffer, byte_size, shapes[bindex], TRTSERVER_MEMORY_GPU);
+      if (!status.IsOk()) {
+        first_payload.status_ = status;
+        break;
+      }
+      if (buffer == nullptr) {
+        continue;
+      }
+
+      preallocated_outputs.emplace(bindex, buffer);
+
+      cudaPointerAttributes attributes;
+      if ((cudaPointerGetAttributes(&attributes, buffer) == cudaSuccess) &&
+          (attributes.device == gpu_device_)) {
+        bindings[binding_offset + bindex] = buffer;
+        direct_output = true;
+      } else {
+        cudaGetLastError();  // clear the error from a non-CUDA pointer
+      }
     }
   }
 
-  // Async execute the inference using a CUDA graph if available for
-  // the batch-size, otherwise execution normally.
-  auto itr = cuda_graph_execs_.find(total_batch_size);
-  if (itr != cuda_graph_execs_.end()) {
+  // Async execute the inference using the CUDA graph of the smallest
+  // batch-size that holds the batch if there is one, otherwise
+  // execute normally. The entries past the batch hold stale inputs
+  // and their outputs are not copied out. The CUDA graphs are
+  // captured with the binding set's buffers so can't be used when an
+  // output is bound directly. A context without device memory of its
+  // own executes using a buffer of the activation memory pool.
+  size_t activation_idx = 0;
+  if (activation_pool_ != nullptr) {
+    void* memory = activation_pool_->Acquire(stream_, &activation_idx);
+    ((profile != nullptr) ? profile->context_ : context_)
+        ->setDeviceMemory(memory);
+  }
+
+  Status enqueue_status;
+  auto itr = set.cuda_graph_execs_.lower_bound(total_batch_size);
+  if (profile != nullptr) {
+    if (!profile->context_->enqueueV2(bindings.data(), stream_, nullptr)) {
+      enqueue_status = Status(
+          RequestStatusCode::INTERNAL,
+          "unable to enqueue for inference " + name_);
+    }
+  } else if (!direct_output && (itr != set.cuda_graph_execs_.end())) {
     cudaError_t err = cudaGraphLaunch(itr->second, stream_);
     if (err != cudaSuccess) {
-      cudaStreamSynchronize(stream_);
-      return Status(
+      enqueue_status = Status(
           RequestStatusCode::INTERNAL,
           "unable to execute graph for inference " + name_ + ": " +
               cudaGetErrorString(err));
     }
   } else {
-    if (!context_->enqueue(total_batch_size, buffers_, stream_, nullptr)) {
-      cudaStreamSynchronize(stream_);
-      return Status(
+    if (!context_->enqueue(
+            total_batch_size, bindings.data(), stream_, nullptr)) {
+      enqueue_status = Status(
           RequestStatusCode::INTERNAL,
           "unable to enqueue for inference " + name_);
     }
   }
 
-  for (auto& payload : *payloads) {
-    if (payload.stats_ != nullptr) {
-      payload.stats_->CaptureTimestamp(
-          ModelInferStats::TimestampKind::kComputeOutputStart);
-    }
+  if (activation_pool_ != nullptr) {
+    activation_pool_->Release(activation_idx, stream_);
+  }
+  if (!enqueue_status.IsOk()) {
+    cudaStreamSynchronize(stream_);
+    return enqueue_status;
   }
 
+  CaptureOutputCopyStart(payloads);
+
   // For each requested output verify that the output can accept the
   // actual model output and then copy that output from the GPU
-  bool cuda_copy = false;
-  for (int bindex = 0; bindex < engine_->getNbBindings(); ++bindex) {
+  for (int bindex = 0; bindex < num_bindings_; ++bindex) {
     if (engine_->bindingIsInput(bindex)) {
       continue;
     }
 
     const std::string& name = engine_->getBindingName(bindex);
-    const size_t batch1_byte_size =
-        (byte_sizes_[bindex] / std::max(1, max_batch_size_));
-
-    // Get the shape of the output. If model supports batching then
-    // prepend the batch dimension onto the output shape.
-    std::vector<int64_t> shape;
-    if (max_batch_size_ != NO_BATCHING) {
-      shape.push_back(total_batch_size);
-    }
-    nvinfer1::Dims dims = engine_->getBindingDimensions(bindex);
-    for (int i = 0; i < dims.nbDims; ++i) {
-      shape.push_back(dims.d[i]);
-    }
+    const size_t batch1_byte_size = batch1_byte_sizes[bindex];
+
+    // An output bound directly is already in place. Any other
+    // preallocated output only needs to be copied.
+    auto pr = preallocated_outputs.find(bindex);
+    if (pr != preallocated_outputs.end()) {
+      if (bindings[binding_offset + bindex] != set.buffers_[bindex]) {
+        continue;
+      }
 
-    if (byte_sizes_[bindex] < (batch1_byte_size * total_batch_size)) {
-      return Status(
-          RequestStatusCode::INTERNAL,
-          "unexpected size for output '" + name + "', byte-size " +
-              std::to_string(byte_sizes_[bindex]) + " is less than " +
-              std::to_string(total_batch_size) + " * " +
-              std::to_string(batch1_byte_size));
+      bool cuda_used = false;
+      Status status = CopyBuffer(
+          name, TRTSERVER_MEMORY_GPU, TRTSERVER_MEMORY_GPU,
+          batch1_byte_size * total_batch_size, set.buffers_[bindex],
+          pr->second, &cuda_used);
+      if (!status.IsOk()) {
+        first_payload.status_ = status;
+      }
+      continue;
     }
 
-    cuda_copy |= SetFixedSizeOutputBuffer(
-        name, batch1_byte_size, static_cast<char*>(buffers_[bindex]), shape,
-        TRTSERVER_MEMORY_GPU /* src_memory_type */, payloads);
+    SetFixedSizeOutputBuffer(
+        name, batch1_byte_size, static_cast<char*>(set.buffers_[bindex]),
+        shapes[bindex], TRTSERVER_MEMORY_GPU /* src_memory_type */, payloads,
+        ConvertTrtTypeToDataType(engine_->getBindingDataType(bindex)));
   }
 
-  // Wait for the copy-out to complete
-  if (cuda_copy) {
-    cudaStreamSynchronize(stream_);
-  }
+  // The binding set can be reused once the outputs are copied
+  // out. The caller waits for the execution and copy-out to complete
+  // before completing the payloads.
+  cudaEventRecord(set.done_event_, stream_);
   return Status::Success;
 }
 
@@ -793,7 +1790,7 @@ operator<<(std::ostream& out, const PlanBackend& pb)
         << std::endl
         << "  bindings:" << std::endl;
 
-    for (int i = 0; i < context->engine_->getNbBindings(); ++i) {
+    for (int i = 0; i < context->num_bindings_; ++i) {
       out << "    " << i << ": byte_size=" << context->byte_sizes_[i]
           << ", buffer=" << context->buffers_[i] << " ]" << std::endl;
     }
@@ -27,8 +27,13 @@
 
 #include <NvInfer.h>
 #include <cuda_runtime_api.h>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
 #include "src/core/backend.h"
 #include "src/core/backend_context.h"
+#include "src/core/filesystem.h"
 #include "src/core/model_config.pb.h"
 #include "src/core/scheduler.h"
 #include "src/core/status.h"
@@ -39,18 +44,50 @@ class PlanBackend : public InferenceBackend {
  public:
   PlanBackend() = default;
   PlanBackend(PlanBackend&&) = default;
+  ~PlanBackend();
 
   Status Init(const std::string& path, const ModelConfig& config);
 
   // Create a context for execution for each instance for the
-  // serialized plans specified in 'models'.
+  // serialized plans specified in 'models', or for the engine built
+  // from the ONNX model in 'models' if the model is configured to be
+  // built. Built engines are cached in 'engine_cache_dir' unless it
+  // is empty.
   Status CreateExecutionContexts(
-      const std::unordered_map<std::string, std::vector<char>>& models);
+      const std::unordered_map<std::string, std::shared_ptr<MappedFile>>&
+          models,
+      const std::string& engine_cache_dir);
   Status CreateExecutionContext(
       const std::string& instance_name, const int gpu_device,
-      const std::unordered_map<std::string, std::vector<char>>& models);
+      const int dla_core, const std::vector<int>& profiles,
+      const std::unordered_map<std::string, std::shared_ptr<MappedFile>>&
+          models,
+      const std::vector<char>* built_plan, const size_t context_idx);
 
  private:
+  // Return in 'dla_cores' the DLA cores given by the "dla" GPU
+  // execution accelerator of the model, or an empty vector if the
+  // model runs on the GPU only.
+  Status GetDLACores(std::vector<int>* dla_cores);
+
+  // Return in 'plan' the engine built for 'gpu_device' from the ONNX
+  // model in 'models', reading it from 'engine_cache_dir' if it was
+  // built before.
+  Status BuildEngine(
+      const int gpu_device,
+      const std::unordered_map<std::string, std::shared_ptr<MappedFile>>&
+          models,
+      const std::string& engine_cache_dir, std::vector<char>* plan);
+
+  // Return in 'engine' an engine for 'model_data' on 'gpu_device',
+  // and on DLA core 'dla_core' unless it is -1, for a context that
+  // uses 'profiles', deserializing it only if no engine already on
+  // the GPU and DLA core can be shared.
+  Status AcquireEngine(
+      const int gpu_device, const int dla_core, const char* model_data,
+      const size_t model_byte_size, const std::vector<int>& profiles,
+      nvinfer1::ICudaEngine** engine);
+
   // Run model on the context associated with 'runner_idx' to
   // execute for one or more requests.
   void Run(
@@ -61,6 +98,8 @@ class PlanBackend : public InferenceBackend {
   DISALLOW_COPY_AND_ASSIGN(PlanBackend);
   friend std::ostream& operator<<(std::ostream&, const PlanBackend&);
 
+  struct ActivationPool;
+
   // For each model instance there is a context.
   struct Context : BackendContext {
     Context(
@@ -84,34 +123,169 @@ class PlanBackend : public InferenceBackend {
         const ::google::protobuf::RepeatedPtrField<ModelInput>& ios);
     Status InitializeConfigOutputBindings(
         const ::google::protobuf::RepeatedPtrField<ModelOutput>& ios);
+    Status InitializeBindingSets();
+    Status InitializeProfiles(const std::vector<int>& profiles);
+
+    // For an engine with explicit dimensions, return in 'byte_size'
+    // the largest size of the binding at 'index' over the profiles of
+    // the context, with the batch dimension at most 'max_batch_size_'.
+    Status GetMaxProfileByteSize(
+        const int index, const DataType dt, int64_t* byte_size);
+
+    struct Profile;
+
+    // For an engine with explicit dimensions, return in 'profile' the
+    // profile of the context that best matches the shapes of the
+    // inputs of 'payloads', and set those shapes in the profile's
+    // execution context.
+    Status SelectProfile(
+        const size_t total_batch_size,
+        std::vector<Scheduler::Payload>* payloads, const Profile** profile);
+
+    struct BindingSet;
     bool BuildCudaGraph(const int batch_size);
+    bool BuildCudaGraph(const int batch_size, BindingSet* set);
 
     // Run model to execute for one or more requests. This function
     // assumes that it is only called by the single runner thread that
     // is assigned to this context. A non-OK return status indicates
     // an internal error that prevents any of the of requests from
     // completing. If an error is isolate to a single request payload
-    // it will be reported in that payload.
+    // it will be reported in that payload. The execution and the
+    // copies of the outputs are issued on 'stream_' but not waited
+    // for, the caller must wait for 'stream_' before completing the
+    // payloads.
     Status Run(std::vector<Scheduler::Payload>* payloads);
 
-    // TensorRT components for the model
-    nvinfer1::IRuntime* runtime_;
+    // TensorRT components for the model. The engine is owned by the
+    // backend and may be shared with other contexts on the same
+    // GPU. For an engine with explicit dimensions 'context_' is
+    // nullptr and each profile has its own execution context.
     nvinfer1::ICudaEngine* engine_;
     nvinfer1::IExecutionContext* context_;
 
+    // True if the engine has an implicit batch dimension. Otherwise
+    // the engine has explicit, possibly dynamic, dimensions and one or
+    // more optimization profiles.
+    bool implicit_batch_;
+
+    // The number of bindings of each optimization profile. The
+    // bindings of profile 'p' have engine binding indices starting at
+    // 'p * num_bindings_'. All other binding indices in the context
+    // are relative to the profile.
+    int num_bindings_;
+
+    // For an engine with explicit dimensions, the optimization
+    // profiles used by the context and the execution context for
+    // each.
+    struct Profile {
+      int index_;
+      nvinfer1::IExecutionContext* context_;
+    };
+    std::vector<Profile> profiles_;
+
     // For each binding index of the TensorRT engine, the size of the
     // corresponding tensor and pointer to the CUDA buffer for the
     // tensor. These are arrays with size equal to number of bindings.
     uint64_t* byte_sizes_;
     void** buffers_;
 
-    // The CUDA graphs captured for the model for different
-    // batch-sizes.
-    std::unordered_map<int, cudaGraph_t> cuda_graphs_;
-    std::unordered_map<int, cudaGraphExec_t> cuda_graph_execs_;
+    // For each sequence control input binding, an empty vector. Each
+    // binding set tracks the contents of its own control buffers.
+    std::unordered_map<int, std::vector<char>> staged_inputs_;
+
+    // A CUDA buffer for each binding and the state that depends on
+    // those buffers. The buffers of the first set are 'buffers_'. The
+    // inputs of an execution are copied into one set on
+    // 'input_stream_' while a previous execution may still be running
+    // on 'stream_' using another set.
+    struct BindingSet {
+      std::vector<void*> buffers_;
+
+      // For each sequence control input binding, the contents last
+      // copied to its CUDA buffer. Control values are mostly the same
+      // from one execution to the next so only changes are copied.
+      std::unordered_map<int, std::vector<char>> staged_inputs_;
+
+      // Recorded on 'input_stream_' once the inputs are copied into
+      // the set, and on 'stream_' once the outputs are copied out of
+      // the set so that it can be reused.
+      cudaEvent_t ready_event_;
+      cudaEvent_t done_event_;
+
+      // The CUDA graphs captured using the set for different
+      // batch-sizes, ordered by batch-size.
+      std::map<int, cudaGraph_t> cuda_graphs_;
+      std::map<int, cudaGraphExec_t> cuda_graph_execs_;
+    };
+
+    std::vector<BindingSet> binding_sets_;
+    size_t next_binding_set_;
+
+    // The stream where inputs are copied into a binding set.
+    cudaStream_t input_stream_;
+
+    // If not nullptr the execution contexts have no device memory of
+    // their own and execute using activation memory from the pool.
+    ActivationPool* activation_pool_;
   };
 
   std::vector<std::unique_ptr<Context>> contexts_;
+
+  // The engines deserialized on each GPU, each with the optimization
+  // profiles used by the contexts that share it. An execution context
+  // can only use a profile that no other context of the engine uses,
+  // so a context that needs a profile already in use gets an engine
+  // of its own.
+  struct SharedEngine {
+    ~SharedEngine();
+    int gpu_device_;
+    int dla_core_;
+    nvinfer1::IRuntime* runtime_;
+    nvinfer1::ICudaEngine* engine_;
+    std::set<int> profiles_;
+  };
+
+  std::mutex engines_mu_;
+  std::vector<std::unique_ptr<SharedEngine>> engines_;
+
+  // The activation memory shared by the contexts on a GPU. Each
+  // execution holds one buffer of the pool from its enqueue until the
+  // enqueue returns, and the next execution to use the buffer waits
+  // on the GPU for the previous one to complete.
+  struct ActivationPool {
+    explicit ActivationPool(const size_t count);
+    ~ActivationPool();
+
+    // Make each buffer at least 'byte_size' bytes. Must be called on
+    // the pool's GPU before any execution uses the pool.
+    Status Reserve(const size_t byte_size);
+
+    // Return a buffer for an execution on 'stream', and in 'idx' the
+    // index to release it with. Blocks while all buffers are held.
+    void* Acquire(cudaStream_t stream, size_t* idx);
+
+    // Release the buffer at 'idx' once the work already issued on
+    // 'stream' completes.
+    void Release(const size_t idx, cudaStream_t stream);
+
+    struct Buffer {
+      void* memory_;
+      cudaEvent_t event_;
+      bool held_;
+    };
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::vector<Buffer> buffers_;
+    size_t held_cnt_;
+    size_t next_;
+    size_t byte_size_;
+  };
+
+  // The activation pool of each GPU, only when the contexts share
+  // activation memory. Filled before any context is created.
+  std::map<int, std::unique_ptr<ActivationPool>> activation_pools_;
 };
 
 std::ostream& operator<<(std::ostream& out, const PlanBackend& pb);
@@ -75,12 +75,14 @@ PlanBackendFactory::CreateBackend(
   std::set<std::string> plan_files;
   RETURN_IF_ERROR(GetDirectoryFiles(path, &plan_files));
 
-  std::unordered_map<std::string, std::vector<char>> models;
+  // The model files are mapped rather than read so that a large plan
+  // isn't held in memory in addition to the engines deserialized from
+  // it. The mappings are released once the contexts are created.
+  std::unordered_map<std::string, std::shared_ptr<MappedFile>> models;
   for (const auto& filename : plan_files) {
     const auto plan_path = JoinPath({path, filename});
-    std::string model_data_str;
-    RETURN_IF_ERROR(ReadTextFile(plan_path, &model_data_str));
-    std::vector<char> model_data(model_data_str.begin(), model_data_str.end());
+    std::shared_ptr<MappedFile> model_data;
+    RETURN_IF_ERROR(MapFile(plan_path, &model_data));
     models.emplace(filename, std::move(model_data));
   }
 
@@ -88,7 +90,8 @@ PlanBackendFactory::CreateBackend(
   // requested for this model.
   std::unique_ptr<PlanBackend> local_backend(new PlanBackend);
   RETURN_IF_ERROR(local_backend->Init(path, model_config));
-  RETURN_IF_ERROR(local_backend->CreateExecutionContexts(models));
+  RETURN_IF_ERROR(local_backend->CreateExecutionContexts(
+      models, backend_config_->engine_cache_dir));
 
   *backend = std::move(local_backend);
   return Status::Success;
@@ -38,6 +38,10 @@ class PlanBackendFactory {
     // Autofill missing required model configuration settings based on
     // model definition file.
     bool autofill;
+
+    // Directory where engines built from ONNX models are cached. If
+    // empty the engines are not cached.
+    std::string engine_cache_dir;
   };
 
   static Status Create(
@@ -84,6 +84,49 @@ CompareDims(const nvinfer1::Dims& model_dims, const DimsList& dims)
   return true;
 }
 
+bool
+CompareDynamicDims(
+    const nvinfer1::Dims& model_dims, const DimsList& dims,
+    const bool has_batch_dim)
+{
+  const int offset = has_batch_dim ? 1 : 0;
+  if (model_dims.nbDims != (dims.size() + offset)) {
+    return false;
+  }
+
+  if (has_batch_dim && (model_dims.d[0] != -1)) {
+    return false;
+  }
+
+  for (int i = 0; i < dims.size(); ++i) {
+    if ((model_dims.d[i + offset] != -1) &&
+        (model_dims.d[i + offset] != dims[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool
+DimsWithinRange(
+    const std::vector<int64_t>& dims, const nvinfer1::Dims& min_dims,
+    const nvinfer1::Dims& max_dims)
+{
+  if ((min_dims.nbDims != (int)dims.size()) ||
+      (max_dims.nbDims != (int)dims.size())) {
+    return false;
+  }
+
+  for (size_t i = 0; i < dims.size(); ++i) {
+    if ((dims[i] < min_dims.d[i]) || (dims[i] > max_dims.d[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 const std::string
 DimsDebugString(const nvinfer1::Dims& dims)
 {
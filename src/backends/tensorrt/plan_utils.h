@@ -38,6 +38,21 @@ std::pair<bool, nvinfer1::DataType> ConvertDataTypeToTrtType(
 
 bool CompareDims(const nvinfer1::Dims& model_dims, const DimsList& dims);
 
+// Compare the dimensions of a binding of an engine with explicit
+// dimensions to 'dims'. If 'has_batch_dim' is true the first model
+// dimension is the batch dimension, which must be dynamic, and is not
+// part of 'dims'. A dynamic model dimension matches any value in
+// 'dims' while a fixed one must be equal.
+bool CompareDynamicDims(
+    const nvinfer1::Dims& model_dims, const DimsList& dims,
+    const bool has_batch_dim);
+
+// Return true if each dimension of 'dims' is within the corresponding
+// dimensions of 'min_dims' and 'max_dims'.
+bool DimsWithinRange(
+    const std::vector<int64_t>& dims, const nvinfer1::Dims& min_dims,
+    const nvinfer1::Dims& max_dims);
+
 const std::string DimsDebugString(const nvinfer1::Dims& dims);
 
 }}  // namespace nvidia::inferenceserver
@@ -0,0 +1,228 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <benchmark/benchmark.h>
+#include <google/protobuf/text_format.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fstream>
+#include <numeric>
+#include "src/core/backend.h"
+#include "src/core/filesystem.h"
+#include "src/core/model_config.pb.h"
+#include "src/core/provider.h"
+
+namespace ni = nvidia::inferenceserver;
+
+namespace {
+
+// Return the request provider for one input of 'chunk_cnt' chunks of
+// 'chunk_byte_size' bytes each, all referencing 'data'.
+std::shared_ptr<ni::InferRequestProvider>
+CreateChunkedRequest(
+    const std::vector<char>& data, size_t chunk_cnt, size_t chunk_byte_size)
+{
+  ni::InferRequestHeader header;
+  header.set_batch_size(1);
+  auto input = header.add_input();
+  input->set_name("INPUT");
+  input->set_batch_byte_size(chunk_cnt * chunk_byte_size);
+
+  auto memory = std::make_shared<ni::SystemMemoryReference>();
+  for (size_t i = 0; i < chunk_cnt; ++i) {
+    memory->AddBuffer(
+        &data[i * chunk_byte_size], chunk_byte_size, TRTSERVER_MEMORY_CPU);
+  }
+
+  std::shared_ptr<ni::InferRequestProvider> provider;
+  ni::InferRequestProvider::Create(
+      "provider", -1, std::make_shared<const ni::InferRequestHeader>(header),
+      {{"INPUT", memory}}, &provider);
+  return provider;
+}
+
+// Read all of an input split into chunks, either chunk by chunk or,
+// if 'force_contiguous', gathered into a single copy.
+void
+BM_GetNextInputContent(benchmark::State& state)
+{
+  const size_t chunk_cnt = state.range(0);
+  const size_t chunk_byte_size = state.range(1);
+  const bool force_contiguous = (state.range(2) != 0);
+  const std::vector<char> data(chunk_cnt * chunk_byte_size);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto provider = CreateChunkedRequest(data, chunk_cnt, chunk_byte_size);
+    state.ResumeTiming();
+
+    while (true) {
+      const void* content;
+      size_t content_byte_size = data.size();
+      TRTSERVER_Memory_Type memory_type = TRTSERVER_MEMORY_CPU;
+      ni::Status status = provider->GetNextInputContent(
+          "INPUT", &content, &content_byte_size, &memory_type,
+          force_contiguous);
+      if (!status.IsOk()) {
+        state.SkipWithError(status.AsString().c_str());
+        break;
+      }
+      if (content == nullptr) {
+        break;
+      }
+      benchmark::DoNotOptimize(content);
+    }
+  }
+
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_GetNextInputContent)
+    ->Args({1, 1 << 20, 0})
+    ->Args({64, 16 << 10, 0})
+    ->Args({64, 16 << 10, 1})
+    ->Args({1024, 1 << 10, 1});
+
+// A backend that only holds a model configuration, which is all that
+// InferResponseProvider::FinalizeResponse() needs.
+class ConfigOnlyBackend : public ni::InferenceBackend {
+ public:
+  ni::Status Init(const std::string& path, const ni::ModelConfig& config)
+  {
+    return SetModelConfig(path, config);
+  }
+};
+
+TRTSERVER_Error*
+ResponseAlloc(
+    TRTSERVER_ResponseAllocator* allocator, void** buffer, void** buffer_userp,
+    const char* tensor_name, size_t byte_size,
+    TRTSERVER_Memory_Type memory_type, int64_t memory_type_id, void* userp)
+{
+  *buffer = (byte_size == 0) ? nullptr : malloc(byte_size);
+  *buffer_userp = nullptr;
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+ResponseRelease(
+    TRTSERVER_ResponseAllocator* allocator, void* buffer, void* buffer_userp,
+    size_t byte_size, TRTSERVER_Memory_Type memory_type,
+    int64_t memory_type_id)
+{
+  free(buffer);
+  return nullptr;  // Success
+}
+
+// Build the response for a batch of classification results, including
+// the top-k sort and label lookup for each batch entry.
+void
+BM_FinalizeResponseClassification(benchmark::State& state)
+{
+  const size_t batch_size = state.range(0);
+  const size_t class_cnt = 1000;
+  const size_t topk = state.range(1);
+
+  // The backend version is taken from the name of the model path
+  // and the labels are read from the model directory.
+  char model_dir[] = "/tmp/trtis_benchmark_XXXXXX";
+  if (mkdtemp(model_dir) == nullptr) {
+    state.SkipWithError("failed to create model directory");
+    return;
+  }
+  const std::string labels_path = ni::JoinPath({model_dir, "labels.txt"});
+  {
+    std::ofstream labels(labels_path);
+    for (size_t i = 0; i < class_cnt; ++i) {
+      labels << "label_" << i << std::endl;
+    }
+  }
+
+  ni::ModelConfig config;
+  google::protobuf::TextFormat::ParseFromString(
+      R"(
+      name: "classifier"
+      max_batch_size: 64
+      output [ { name: "PROB" data_type: TYPE_FP32 dims: [ 1000 ]
+                 label_filename: "labels.txt" } ]
+      )",
+      &config);
+
+  ConfigOnlyBackend backend;
+  ni::Status status = backend.Init(ni::JoinPath({model_dir, "1"}), config);
+  unlink(labels_path.c_str());
+  rmdir(model_dir);
+  if (!status.IsOk()) {
+    state.SkipWithError(status.AsString().c_str());
+    return;
+  }
+
+  ni::InferRequestHeader header;
+  header.set_batch_size(batch_size);
+  auto output = header.add_output();
+  output->set_name("PROB");
+  output->mutable_cls()->set_count(topk);
+
+  TRTSERVER_ResponseAllocator* allocator = nullptr;
+  std::shared_ptr<ni::InferResponseProvider> provider;
+  status = ni::InferResponseProvider::Create(
+      std::make_shared<const ni::InferRequestHeader>(header),
+      backend.GetLabelProvider(), allocator, ResponseAlloc,
+      nullptr /* alloc_userp */, ResponseRelease, &provider);
+  if (!status.IsOk()) {
+    state.SkipWithError(status.AsString().c_str());
+    return;
+  }
+
+  std::vector<float> scores(batch_size * class_cnt);
+  std::iota(scores.begin(), scores.end(), 0.0f);
+  void* buffer;
+  status = provider->AllocateOutputBuffer(
+      "PROB", &buffer, scores.size() * sizeof(float),
+      {(int64_t)batch_size, (int64_t)class_cnt});
+  if (!status.IsOk() || (buffer == nullptr)) {
+    state.SkipWithError("failed to allocate output buffer");
+    return;
+  }
+  memcpy(buffer, &scores[0], scores.size() * sizeof(float));
+
+  // FinalizeResponse() rebuilds the response header from scratch each
+  // time it is called.
+  for (auto _ : state) {
+    status = provider->FinalizeResponse(backend);
+    if (!status.IsOk()) {
+      state.SkipWithError(status.AsString().c_str());
+      break;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * batch_size);
+}
+BENCHMARK(BM_FinalizeResponseClassification)
+    ->Args({1, 1})
+    ->Args({1, 5})
+    ->Args({32, 5});
+
+}  // namespace
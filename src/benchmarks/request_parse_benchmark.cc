@@ -0,0 +1,167 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <benchmark/benchmark.h>
+#include <google/protobuf/text_format.h>
+#include <google/protobuf/util/json_util.h>
+#include "src/core/api.pb.h"
+#include "src/core/grpc_service.pb.h"
+
+namespace ni = nvidia::inferenceserver;
+
+namespace {
+
+// A request header with 'input_cnt' inputs, each with a classification
+// and a raw output, similar to what an image classification client
+// sends.
+ni::InferRequestHeader
+MakeRequestHeader(size_t input_cnt)
+{
+  ni::InferRequestHeader header;
+  header.set_id(42);
+  header.set_batch_size(8);
+  for (size_t i = 0; i < input_cnt; ++i) {
+    auto input = header.add_input();
+    input->set_name("INPUT" + std::to_string(i));
+    input->add_dims(3);
+    input->add_dims(224);
+    input->add_dims(224);
+    input->set_batch_byte_size(8 * 3 * 224 * 224 * sizeof(float));
+  }
+  header.add_output()->set_name("PROB");
+  auto cls = header.add_output();
+  cls->set_name("CLASSES");
+  cls->mutable_cls()->set_count(5);
+  return header;
+}
+
+// The HTTP endpoint accepts the request header in text, JSON or
+// binary protobuf format and serializes the text and JSON formats for
+// the C API. These benchmarks follow the same steps for a header that
+// misses the server's parsed-header cache.
+void
+BM_HttpParseHeaderText(benchmark::State& state)
+{
+  std::string text;
+  google::protobuf::TextFormat::PrintToString(
+      MakeRequestHeader(state.range(0)), &text);
+
+  for (auto _ : state) {
+    ni::InferRequestHeader header;
+    std::string serialized;
+    if (!google::protobuf::TextFormat::ParseFromString(text, &header) ||
+        !header.SerializeToString(&serialized)) {
+      state.SkipWithError("failed to parse text header");
+      break;
+    }
+    benchmark::DoNotOptimize(serialized);
+  }
+
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_HttpParseHeaderText)->Arg(1)->Arg(8);
+
+void
+BM_HttpParseHeaderJson(benchmark::State& state)
+{
+  std::string json;
+  google::protobuf::util::MessageToJsonString(
+      MakeRequestHeader(state.range(0)), &json);
+
+  for (auto _ : state) {
+    ni::InferRequestHeader header;
+    std::string serialized;
+    if (!google::protobuf::util::JsonStringToMessage(json, &header).ok() ||
+        !header.SerializeToString(&serialized)) {
+      state.SkipWithError("failed to parse json header");
+      break;
+    }
+    benchmark::DoNotOptimize(serialized);
+  }
+
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_HttpParseHeaderJson)->Arg(1)->Arg(8);
+
+void
+BM_HttpParseHeaderBinary(benchmark::State& state)
+{
+  std::string binary;
+  MakeRequestHeader(state.range(0)).SerializeToString(&binary);
+
+  for (auto _ : state) {
+    ni::InferRequestHeader header;
+    if (!header.ParseFromString(binary)) {
+      state.SkipWithError("failed to parse binary header");
+      break;
+    }
+    benchmark::DoNotOptimize(header);
+  }
+
+  state.SetBytesProcessed(state.iterations() * binary.size());
+}
+BENCHMARK(BM_HttpParseHeaderBinary)->Arg(1)->Arg(8);
+
+// The GRPC endpoint parses the whole InferRequest message, including
+// the raw input tensors, and then serializes the request header for
+// the C API which parses it again.
+void
+BM_GrpcParseInferRequest(benchmark::State& state)
+{
+  const size_t input_cnt = state.range(0);
+  const size_t input_byte_size = state.range(1);
+
+  ni::InferRequest request;
+  request.set_model_name("resnet50");
+  request.set_model_version(-1);
+  *request.mutable_meta_data() = MakeRequestHeader(input_cnt);
+  for (size_t i = 0; i < input_cnt; ++i) {
+    request.add_raw_input(std::string(input_byte_size, '\1'));
+  }
+  std::string wire;
+  request.SerializeToString(&wire);
+
+  for (auto _ : state) {
+    ni::InferRequest parsed;
+    std::string serialized;
+    ni::InferRequestHeader header;
+    if (!parsed.ParseFromString(wire) ||
+        !parsed.meta_data().SerializeToString(&serialized) ||
+        !header.ParseFromString(serialized)) {
+      state.SkipWithError("failed to parse infer request");
+      break;
+    }
+    benchmark::DoNotOptimize(header);
+  }
+
+  state.SetBytesProcessed(state.iterations() * wire.size());
+}
+BENCHMARK(BM_GrpcParseInferRequest)
+    ->Args({1, 4 << 10})
+    ->Args({1, 1 << 20})
+    ->Args({8, 64 << 10});
+
+}  // namespace
@@ -0,0 +1,246 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <benchmark/benchmark.h>
+#include <google/protobuf/text_format.h>
+#include <condition_variable>
+#include <mutex>
+#include "src/core/dynamic_batch_scheduler.h"
+#include "src/core/model_config.pb.h"
+#include "src/core/provider.h"
+#include "src/core/sequence_batch_scheduler.h"
+#include "src/core/server_status.h"
+
+namespace ni = nvidia::inferenceserver;
+
+namespace {
+
+constexpr size_t kInputByteSize = 16 * sizeof(float);
+
+// Tracks the requests issued by one benchmark iteration so that the
+// iteration can wait for all of them to complete.
+class Completions {
+ public:
+  void Expect(size_t cnt)
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    pending_ += cnt;
+  }
+
+  void Complete(const ni::Status& status)
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (!status.IsOk()) {
+      failed_ = true;
+    }
+    if (--pending_ == 0) {
+      cv_.notify_all();
+    }
+  }
+
+  // Return false if any request failed.
+  bool Wait()
+  {
+    std::unique_lock<std::mutex> lk(mu_);
+    cv_.wait(lk, [this] { return pending_ == 0; });
+    return !failed_;
+  }
+
+ private:
+  std::mutex mu_;
+  std::condition_variable cv_;
+  size_t pending_ = 0;
+  bool failed_ = false;
+};
+
+ni::ModelConfig
+ParseConfig(const std::string& text)
+{
+  ni::ModelConfig config;
+  google::protobuf::TextFormat::ParseFromString(text, &config);
+  return config;
+}
+
+// A run function standing in for a backend that does no work.
+void
+NullRun(
+    uint32_t runner_idx, std::vector<ni::Scheduler::Payload>* payloads,
+    std::function<void(const ni::Status&)> OnRunComplete)
+{
+  OnRunComplete(ni::Status::Success);
+}
+
+std::shared_ptr<ni::InferRequestProvider>
+CreateRequest(
+    const std::string& model_name, const std::vector<char>& data,
+    uint64_t correlation_id, uint32_t flags)
+{
+  ni::InferRequestHeader header;
+  header.set_batch_size(1);
+  header.set_correlation_id(correlation_id);
+  header.set_flags(flags);
+  auto input = header.add_input();
+  input->set_name("INPUT");
+  input->add_dims(16);
+  input->set_batch_byte_size(data.size());
+  header.add_output()->set_name("OUTPUT");
+
+  auto memory = std::make_shared<ni::SystemMemoryReference>();
+  memory->AddBuffer(&data[0], data.size(), TRTSERVER_MEMORY_CPU);
+
+  std::shared_ptr<ni::InferRequestProvider> provider;
+  ni::InferRequestProvider::Create(
+      model_name, -1, std::make_shared<const ni::InferRequestHeader>(header),
+      {{"INPUT", memory}}, &provider);
+  return provider;
+}
+
+const char* kModelIO = R"(
+  max_batch_size: 8
+  input [ { name: "INPUT" data_type: TYPE_FP32 dims: [ 16 ] } ]
+  output [ { name: "OUTPUT" data_type: TYPE_FP32 dims: [ 16 ] } ]
+)";
+
+// Enqueue a burst of requests to a dynamic batch scheduler whose
+// runners complete immediately and wait for all of them to be
+// dispatched and completed. The runners share one queue or, if the
+// third argument is non-zero, each has its own queue.
+void
+BM_DynamicBatchEnqueue(benchmark::State& state)
+{
+  const size_t burst = state.range(0);
+  const uint32_t runner_cnt = state.range(1);
+  const bool instance_queues = (state.range(2) != 0);
+  const ni::ModelConfig config = ParseConfig(
+      std::string("name: \"dynamic\"") + kModelIO +
+      "dynamic_batching { preferred_batch_size: [ 4, 8 ] instance_queues: " +
+      (instance_queues ? "true" : "false") + " }");
+
+  std::unique_ptr<ni::Scheduler> scheduler;
+  ni::Status status = ni::DynamicBatchScheduler::Create(
+      config, runner_cnt, [](uint32_t) { return ni::Status::Success; },
+      NullRun, nullptr /* OnRelease */, nullptr /* metric_reporter */,
+      &scheduler);
+  if (!status.IsOk()) {
+    state.SkipWithError(status.AsString().c_str());
+    return;
+  }
+
+  const std::vector<char> data(kInputByteSize);
+  Completions completions;
+  auto OnComplete = [&completions](const ni::Status& status) {
+    completions.Complete(status);
+  };
+
+  for (auto _ : state) {
+    completions.Expect(burst);
+    for (size_t i = 0; i < burst; ++i) {
+      auto stats =
+          std::make_shared<ni::ModelInferStats>(nullptr, config.name());
+      scheduler->Enqueue(
+          stats, CreateRequest(config.name(), data, 0, 0),
+          nullptr /* response_provider */, OnComplete);
+    }
+    if (!completions.Wait()) {
+      state.SkipWithError("request failed");
+      break;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * burst);
+}
+BENCHMARK(BM_DynamicBatchEnqueue)
+    ->Args({1, 1, 0})
+    ->Args({64, 1, 0})
+    ->Args({64, 4, 0})
+    ->Args({64, 8, 0})
+    ->Args({64, 8, 1})
+    ->UseRealTime();
+
+// Start a set of sequences on a sequence batch scheduler, send one
+// request in each and end them, so that every request goes through
+// slot assignment and release.
+void
+BM_SequenceBatchSlotAssign(benchmark::State& state)
+{
+  const size_t sequence_cnt = state.range(0);
+  const ni::ModelConfig config = ParseConfig(
+      std::string("name: \"sequence\"") + kModelIO + R"(
+      sequence_batching {
+        max_sequence_idle_microseconds: 5000000
+        control_input [
+          {
+            name: "START"
+            control [ { kind: CONTROL_SEQUENCE_START
+                        int32_false_true: [ 0, 1 ] } ]
+          },
+          {
+            name: "READY"
+            control [ { kind: CONTROL_SEQUENCE_READY
+                        int32_false_true: [ 0, 1 ] } ]
+          }
+        ]
+      }
+      instance_group [ { count: 2 kind: KIND_CPU } ])");
+
+  std::unique_ptr<ni::Scheduler> scheduler;
+  ni::Status status = ni::SequenceBatchScheduler::Create(
+      config, 2 /* runner_cnt */,
+      [](uint32_t) { return ni::Status::Success; }, NullRun,
+      nullptr /* metric_reporter */, &scheduler);
+  if (!status.IsOk()) {
+    state.SkipWithError(status.AsString().c_str());
+    return;
+  }
+
+  const std::vector<char> data(kInputByteSize);
+  Completions completions;
+  auto OnComplete = [&completions](const ni::Status& status) {
+    completions.Complete(status);
+  };
+
+  const uint32_t flags = ni::InferRequestHeader::FLAG_SEQUENCE_START |
+                         ni::InferRequestHeader::FLAG_SEQUENCE_END;
+  for (auto _ : state) {
+    completions.Expect(sequence_cnt);
+    for (size_t i = 0; i < sequence_cnt; ++i) {
+      auto stats =
+          std::make_shared<ni::ModelInferStats>(nullptr, config.name());
+      scheduler->Enqueue(
+          stats, CreateRequest(config.name(), data, i + 1, flags),
+          nullptr /* response_provider */, OnComplete);
+    }
+    if (!completions.Wait()) {
+      state.SkipWithError("request failed");
+      break;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * sequence_cnt);
+}
+BENCHMARK(BM_SequenceBatchSlotAssign)->Arg(1)->Arg(16)->Arg(64)->UseRealTime();
+
+}  // namespace
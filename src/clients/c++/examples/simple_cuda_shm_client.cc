@@ -0,0 +1,296 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cuda_runtime_api.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <iostream>
+#include <string>
+#include "src/clients/c++/library/request_grpc.h"
+
+namespace ni = nvidia::inferenceserver;
+namespace nic = nvidia::inferenceserver::client;
+
+#define FAIL_IF_ERR(X, MSG)                                        \
+  {                                                                \
+    nic::Error err = (X);                                          \
+    if (!err.IsOk()) {                                             \
+      std::cerr << "error: " << (MSG) << ": " << err << std::endl; \
+      exit(1);                                                     \
+    }                                                              \
+  }
+
+#define FAIL_IF_CUDA_ERR(X, MSG)                                         \
+  {                                                                      \
+    cudaError_t err = (X);                                               \
+    if (err != cudaSuccess) {                                            \
+      std::cerr << "error: " << (MSG) << ": " << cudaGetErrorString(err) \
+                << std::endl;                                            \
+      exit(1);                                                           \
+    }                                                                    \
+  }
+
+namespace {
+
+void
+Usage(char** argv, const std::string& msg = std::string())
+{
+  if (!msg.empty()) {
+    std::cerr << "error: " << msg << std::endl;
+  }
+
+  std::cerr << "Usage: " << argv[0] << " [options]" << std::endl;
+  std::cerr << "\t-v" << std::endl;
+  std::cerr << "\t-u <GRPC URL for inference service>" << std::endl;
+  std::cerr << "\t-d <GPU holding the CUDA shared memory>" << std::endl;
+  std::cerr << std::endl;
+
+  exit(1);
+}
+
+}  // namespace
+
+// Allocate 'byte_size' bytes of device memory on GPU 'device_id' and
+// write its cudaIpcMemHandle_t into the system shared memory region
+// 'shm_key' so that the inference server can open it.
+void*
+CreateCudaSharedMemoryRegion(
+    const std::string& shm_key, size_t byte_size, int device_id)
+{
+  void* dev_ptr;
+  FAIL_IF_CUDA_ERR(cudaSetDevice(device_id), "unable to set GPU device");
+  FAIL_IF_CUDA_ERR(
+      cudaMalloc(&dev_ptr, byte_size), "unable to allocate CUDA memory");
+
+  cudaIpcMemHandle_t ipc_handle;
+  FAIL_IF_CUDA_ERR(
+      cudaIpcGetMemHandle(&ipc_handle, dev_ptr),
+      "unable to get CUDA IPC handle");
+
+  int shm_fd = shm_open(shm_key.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+  if (shm_fd == -1) {
+    std::cerr << "error: unable to get shared memory descriptor for "
+                 "shared-memory key '" +
+                     shm_key + "'"
+              << std::endl;
+    exit(1);
+  }
+  if ((ftruncate(shm_fd, sizeof(ipc_handle)) == -1) ||
+      (pwrite(shm_fd, &ipc_handle, sizeof(ipc_handle), 0) !=
+       (ssize_t)sizeof(ipc_handle))) {
+    std::cerr << "error: unable to write CUDA IPC handle to shared-memory "
+                 "key '" +
+                     shm_key + "'"
+              << std::endl;
+    exit(1);
+  }
+  close(shm_fd);
+
+  return dev_ptr;
+}
+
+void
+DestroyCudaSharedMemoryRegion(const std::string& shm_key, void* dev_ptr)
+{
+  if (shm_unlink(shm_key.c_str()) == -1) {
+    std::cerr << "error: unable to unlink shared memory for key '" + shm_key +
+                     "'"
+              << std::endl;
+    exit(1);
+  }
+  FAIL_IF_CUDA_ERR(cudaFree(dev_ptr), "unable to free CUDA memory");
+}
+
+int
+main(int argc, char** argv)
+{
+  bool verbose = false;
+  std::string url("localhost:8001");
+  int device_id = 0;
+
+  // Parse commandline...
+  int opt;
+  while ((opt = getopt(argc, argv, "vu:d:")) != -1) {
+    switch (opt) {
+      case 'v':
+        verbose = true;
+        break;
+      case 'u':
+        url = optarg;
+        break;
+      case 'd':
+        device_id = std::stoi(optarg);
+        break;
+      case '?':
+        Usage(argv);
+        break;
+    }
+  }
+
+  // We use a simple model that takes 2 input tensors of 16 integers
+  // each and returns 2 output tensors of 16 integers each. One output
+  // tensor is the element-wise sum of the inputs and one output is
+  // the element-wise difference.
+  std::string model_name = "simple";
+
+  // Create the inference context for the model and the shared memory
+  // control context. CUDA shared memory can only be registered using
+  // GRPC.
+  std::unique_ptr<nic::InferContext> infer_ctx;
+  FAIL_IF_ERR(
+      nic::InferGrpcContext::Create(
+          &infer_ctx, url, model_name, -1 /* model_version */, verbose),
+      "unable to create inference context");
+
+  std::unique_ptr<nic::SharedMemoryControlContext> shared_memory_ctx;
+  FAIL_IF_ERR(
+      nic::SharedMemoryControlGrpcContext::Create(
+          &shared_memory_ctx, url, verbose),
+      "unable to create shared memory control context");
+
+  std::shared_ptr<nic::InferContext::Input> input0, input1;
+  std::shared_ptr<nic::InferContext::Output> output0, output1;
+  FAIL_IF_ERR(infer_ctx->GetInput("INPUT0", &input0), "unable to get INPUT0");
+  FAIL_IF_ERR(infer_ctx->GetInput("INPUT1", &input1), "unable to get INPUT1");
+  FAIL_IF_ERR(
+      infer_ctx->GetOutput("OUTPUT0", &output0), "unable to get OUTPUT0");
+  FAIL_IF_ERR(
+      infer_ctx->GetOutput("OUTPUT1", &output1), "unable to get OUTPUT1");
+
+  FAIL_IF_ERR(input0->Reset(), "unable to reset INPUT0");
+  FAIL_IF_ERR(input1->Reset(), "unable to reset INPUT1");
+
+  // Get the size of the inputs and outputs from the Shape and DataType
+  int input_byte_size =
+      infer_ctx->ByteSize(input0->Dims(), ni::DataType::TYPE_INT32);
+  int output_byte_size =
+      infer_ctx->ByteSize(output0->Dims(), ni::DataType::TYPE_INT32);
+
+  // Create Output0 and Output1 in CUDA Shared Memory and register it
+  // with TRTIS
+  void* output_dev_ptr = CreateCudaSharedMemoryRegion(
+      "/output_simple", output_byte_size * 2, device_id);
+  FAIL_IF_ERR(
+      shared_memory_ctx->RegisterCudaSharedMemory(
+          "output_data", "/output_simple", 0, sizeof(cudaIpcMemHandle_t), 0,
+          output_byte_size * 2, device_id),
+      "unable to register CUDA shared memory output region");
+
+  // Set the context options to do batch-size 1 requests. Also request that
+  // all output tensors be returned using CUDA shared memory.
+  std::unique_ptr<nic::InferContext::Options> options;
+  FAIL_IF_ERR(
+      nic::InferContext::Options::Create(&options),
+      "unable to create inference options");
+
+  options->SetBatchSize(1);
+  options->AddSharedMemoryResult(output0, "output_data", 0, output_byte_size);
+  options->AddSharedMemoryResult(
+      output1, "output_data", output_byte_size, output_byte_size);
+
+  FAIL_IF_ERR(
+      infer_ctx->SetRunOptions(*options), "unable to set inference options");
+
+  // Create Input0 and Input1 in CUDA Shared Memory. Initialize Input0
+  // to unique integers and Input1 to all ones.
+  int input0_data[16], input1_data[16];
+  for (size_t i = 0; i < 16; ++i) {
+    input0_data[i] = i;
+    input1_data[i] = 1;
+  }
+
+  void* input_dev_ptr = CreateCudaSharedMemoryRegion(
+      "/input_simple", input_byte_size * 2, device_id);
+  FAIL_IF_CUDA_ERR(
+      cudaMemcpy(
+          input_dev_ptr, input0_data, input_byte_size,
+          cudaMemcpyHostToDevice),
+      "unable to copy INPUT0 to CUDA memory");
+  FAIL_IF_CUDA_ERR(
+      cudaMemcpy(
+          reinterpret_cast<char*>(input_dev_ptr) + input_byte_size,
+          input1_data, input_byte_size, cudaMemcpyHostToDevice),
+      "unable to copy INPUT1 to CUDA memory");
+
+  // Register Input CUDA shared memory with TRTIS
+  FAIL_IF_ERR(
+      shared_memory_ctx->RegisterCudaSharedMemory(
+          "input_data", "/input_simple", 0, sizeof(cudaIpcMemHandle_t), 0,
+          input_byte_size * 2, device_id),
+      "unable to register CUDA shared memory input region");
+
+  // Set the shared memory region for Inputs
+  FAIL_IF_ERR(
+      input0->SetSharedMemory("input_data", 0, input_byte_size),
+      "failed setting shared memory input");
+  FAIL_IF_ERR(
+      input1->SetSharedMemory("input_data", input_byte_size, input_byte_size),
+      "failed setting shared memory input");
+
+  // Send inference request to the inference server.
+  std::map<std::string, std::unique_ptr<nic::InferContext::Result>> results;
+  FAIL_IF_ERR(infer_ctx->Run(&results), "unable to run model");
+
+  // Copy the results from CUDA shared memory. Walk over all 16 result
+  // elements and print the sum and difference calculated by the model.
+  int output0_data[16], output1_data[16];
+  FAIL_IF_CUDA_ERR(
+      cudaMemcpy(
+          output0_data, output_dev_ptr, output_byte_size,
+          cudaMemcpyDeviceToHost),
+      "unable to copy OUTPUT0 from CUDA memory");
+  FAIL_IF_CUDA_ERR(
+      cudaMemcpy(
+          output1_data,
+          reinterpret_cast<char*>(output_dev_ptr) + output_byte_size,
+          output_byte_size, cudaMemcpyDeviceToHost),
+      "unable to copy OUTPUT1 from CUDA memory");
+
+  for (size_t i = 0; i < 16; ++i) {
+    std::cout << input0_data[i] << " + " << input1_data[i] << " = "
+              << output0_data[i] << std::endl;
+    std::cout << input0_data[i] << " - " << input1_data[i] << " = "
+              << output1_data[i] << std::endl;
+
+    if ((input0_data[i] + input1_data[i]) != output0_data[i]) {
+      std::cerr << "error: incorrect sum" << std::endl;
+      exit(1);
+    }
+    if ((input0_data[i] - input1_data[i]) != output1_data[i]) {
+      std::cerr << "error: incorrect difference" << std::endl;
+      exit(1);
+    }
+  }
+
+  // Unregister and free the CUDA shared memory
+  FAIL_IF_ERR(
+      shared_memory_ctx->UnregisterAllSharedMemory(),
+      "unable to unregister shared memory regions");
+  DestroyCudaSharedMemoryRegion("/input_simple", input_dev_ptr);
+  DestroyCudaSharedMemoryRegion("/output_simple", output_dev_ptr);
+  return 0;
+}
@@ -42,6 +42,7 @@ InferContext::Result::~Result() {}
 InferContext::Options::~Options() {}
 InferContext::Request::~Request() {}
 InferContext::~InferContext() {}
+InferContextBatcher::~InferContextBatcher() {}
 
 //==============================================================================
 
@@ -0,0 +1,612 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#define DLL_EXPORTING
+
+#include "src/clients/c++/library/request_common.h"
+
+namespace nvidia { namespace inferenceserver { namespace client {
+
+class BatchedRequestImpl;
+class BatchedInferContextImpl;
+class InferContextBatcherImpl;
+
+//==============================================================================
+
+// A request made with a BatchedInferContextImpl. The request holds a
+// copy of its input values and the options it was made with until it
+// is combined with other requests and sent by the batcher.
+class BatchedRequestImpl : public RequestImpl {
+ public:
+  BatchedRequestImpl(
+      const uint64_t id, BatchedInferContextImpl* ctx,
+      InferContext::OnCompleteFn callback)
+      : RequestImpl(id, std::move(callback)), ctx_(ctx)
+  {
+  }
+
+ private:
+  friend class BatchedInferContextImpl;
+  friend class InferContextBatcherImpl;
+
+  // The context that made the request.
+  BatchedInferContextImpl* ctx_;
+
+  // The options and batch size of the request. Requests can only be
+  // combined if they have the same 'key_', which describes the
+  // options and the input shapes.
+  std::shared_ptr<InferOptionsImpl> options_;
+  size_t batch_size_;
+  std::string key_;
+
+  // For each input, the shape set for the input (if any) and the
+  // value of each batch entry.
+  std::vector<std::vector<int64_t>> input_shapes_;
+  std::vector<std::vector<std::vector<uint8_t>>> input_values_;
+
+  // The time the request was made.
+  std::chrono::steady_clock::time_point arrival_;
+
+  // The status and results of the completed request.
+  Error status_;
+  InferContext::ResultMap results_;
+};
+
+//==============================================================================
+
+// An InferContext whose asynchronous requests are combined with the
+// requests of other contexts by an InferContextBatcherImpl. It has
+// its own inputs but shares the outputs of the batcher's context.
+class BatchedInferContextImpl : public InferContextImpl {
+ public:
+  BatchedInferContextImpl(
+      const std::shared_ptr<InferContextBatcherImpl>& batcher,
+      const InferContext& base);
+  ~BatchedInferContextImpl();
+
+  Error SetRunOptions(const Options& options) override;
+  Error Run(ResultMap* results) override;
+  Error AsyncRun(std::shared_ptr<Request>* async_request) override;
+  Error AsyncRun(OnCompleteFn callback) override;
+  Error GetAsyncRunResults(
+      ResultMap* results, bool* is_ready,
+      const std::shared_ptr<Request>& async_request, bool wait) override;
+
+  // Called by the batcher when 'request' is complete.
+  void RequestComplete(
+      const std::shared_ptr<BatchedRequestImpl>& request, const Error& status,
+      ResultMap&& results);
+
+ private:
+  Error AsyncRun(
+      std::shared_ptr<Request>* async_request, OnCompleteFn callback);
+
+  std::shared_ptr<InferContextBatcherImpl> batcher_;
+
+  // The options set by the most recent SetRunOptions().
+  std::shared_ptr<InferOptionsImpl> options_;
+  std::string options_key_;
+
+  // The number of requests that are not yet complete.
+  size_t pending_cnt_;
+};
+
+//==============================================================================
+
+class InferContextBatcherImpl
+    : public InferContextBatcher,
+      public std::enable_shared_from_this<InferContextBatcherImpl> {
+ public:
+  InferContextBatcherImpl(
+      std::unique_ptr<InferContext>&& ctx, uint64_t max_delay_us);
+  ~InferContextBatcherImpl();
+
+  Error CreateContext(std::unique_ptr<InferContext>* ctx) override;
+
+  // Queue 'request' to be combined with other requests.
+  void Enqueue(const std::shared_ptr<BatchedRequestImpl>& request);
+
+ private:
+  using Batch = std::vector<std::shared_ptr<BatchedRequestImpl>>;
+
+  // A combined request that has been sent and the requests it is
+  // made of.
+  struct Issued {
+    std::shared_ptr<Batch> batch_;
+    std::shared_ptr<InferContext::Request> request_;
+  };
+
+  void Worker();
+  void Issue(const std::shared_ptr<Batch>& batch);
+  void Complete(const Issued& issued);
+
+  std::unique_ptr<InferContext> ctx_;
+  const std::chrono::microseconds max_delay_;
+
+  // The options key of the combined requests most recently sent. The
+  // options of 'ctx_' are only changed to a different key when no
+  // combined request is in flight, since changing them alters how
+  // in-flight results are interpreted.
+  std::string issued_key_;
+  size_t in_flight_cnt_;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<std::shared_ptr<BatchedRequestImpl>> pending_;
+  std::deque<Issued> completed_;
+  bool exiting_;
+  std::thread worker_;
+};
+
+//==============================================================================
+
+BatchedInferContextImpl::BatchedInferContextImpl(
+    const std::shared_ptr<InferContextBatcherImpl>& batcher,
+    const InferContext& base)
+    : InferContextImpl(base.ModelName(), base.ModelVersion(), 0, false),
+      batcher_(batcher), pending_cnt_(0)
+{
+  max_batch_size_ = base.MaxBatchSize();
+
+  for (const auto& io : base.Inputs()) {
+    std::shared_ptr<Input> input =
+        std::make_shared<InputImpl>(*reinterpret_cast<InputImpl*>(io.get()));
+    input->Reset();
+    inputs_.emplace_back(std::move(input));
+  }
+  outputs_ = base.Outputs();
+}
+
+BatchedInferContextImpl::~BatchedInferContextImpl()
+{
+  // The batcher references this context until all of its requests
+  // are complete.
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this] { return pending_cnt_ == 0; });
+}
+
+Error
+BatchedInferContextImpl::SetRunOptions(const Options& boptions)
+{
+  const InferOptionsImpl& options =
+      reinterpret_cast<const InferOptionsImpl&>(boptions);
+
+  if (options.BatchSize() > max_batch_size_) {
+    return Error(
+        RequestStatusCode::INVALID_ARG,
+        "run batch-size " + std::to_string(options.BatchSize()) +
+            " exceeds maximum batch size " + std::to_string(max_batch_size_) +
+            " allowed for model '" + model_name_ + "'");
+  }
+
+  if ((options.Flags() != 0) || (options.CorrelationId() != 0)) {
+    return Error(
+        RequestStatusCode::UNSUPPORTED,
+        "sequence flags and correlation IDs are not supported for batched "
+        "requests");
+  }
+
+  // The key identifies the options that requests must share to be
+  // combined, the batch size is not part of it.
+  std::string key = std::to_string(options.Priority()) + ":" +
+                    std::to_string(options.TimeoutMicroseconds()) + ":" +
+                    std::to_string(options.MaxQueueDelayMicroseconds());
+  for (const auto& p : options.Outputs()) {
+    const InferOptionsImpl::OutputOptions& ooptions = p.second;
+    if (!ooptions.shm_name.empty()) {
+      return Error(
+          RequestStatusCode::UNSUPPORTED,
+          "shared memory output '" + p.first->Name() +
+              "' is not supported for batched requests");
+    }
+
+    key += ";" + p.first->Name() + ":" +
+           std::to_string((int)ooptions.result_format) + ":" +
+           std::to_string(ooptions.u64);
+  }
+
+  batch_size_ = std::max((size_t)1, options.BatchSize());
+  for (const auto& io : inputs_) {
+    reinterpret_cast<InputImpl*>(io.get())->SetBatchSize(batch_size_);
+  }
+
+  options_ = std::make_shared<InferOptionsImpl>(options);
+  options_key_ = std::move(key);
+
+  return Error::Success;
+}
+
+Error
+BatchedInferContextImpl::Run(ResultMap* results)
+{
+  std::shared_ptr<Request> request;
+  Error err = AsyncRun(&request, nullptr);
+  if (!err.IsOk()) {
+    return err;
+  }
+
+  bool is_ready;
+  return GetAsyncRunResults(results, &is_ready, request, true /* wait */);
+}
+
+Error
+BatchedInferContextImpl::AsyncRun(std::shared_ptr<Request>* async_request)
+{
+  return AsyncRun(async_request, nullptr);
+}
+
+Error
+BatchedInferContextImpl::AsyncRun(OnCompleteFn callback)
+{
+  std::shared_ptr<Request> request;
+  return AsyncRun(&request, std::move(callback));
+}
+
+Error
+BatchedInferContextImpl::AsyncRun(
+    std::shared_ptr<Request>* async_request, OnCompleteFn callback)
+{
+  if (options_ == nullptr) {
+    return Error(
+        RequestStatusCode::INVALID_ARG,
+        "run options must be set before making a batched request");
+  }
+
+  std::shared_ptr<BatchedRequestImpl> request;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    request = std::make_shared<BatchedRequestImpl>(
+        async_request_id_++, this, std::move(callback));
+  }
+
+  request->Timer().CaptureTimestamp(RequestTimers::Kind::REQUEST_START);
+  request->options_ = options_;
+  request->batch_size_ = batch_size_;
+  request->key_ = options_key_;
+  request->arrival_ = std::chrono::steady_clock::now();
+
+  // Copy the input values so the inputs can be set for the next
+  // request right away.
+  for (const auto& io : inputs_) {
+    InputImpl* input = reinterpret_cast<InputImpl*>(io.get());
+    if (input->IsSharedMemory()) {
+      return Error(
+          RequestStatusCode::UNSUPPORTED,
+          "shared memory input '" + input->Name() +
+              "' is not supported for batched requests");
+    }
+
+    Error err = input->PrepareForRequest();
+    if (!err.IsOk()) {
+      return err;
+    }
+
+    request->input_shapes_.push_back(input->Shape());
+    request->input_values_.emplace_back(batch_size_);
+    for (size_t b = 0; b < batch_size_; ++b) {
+      const uint8_t* buf;
+      size_t byte_size;
+      err = input->GetRaw(b, &buf, &byte_size);
+      if (!err.IsOk()) {
+        return err;
+      }
+      request->input_values_.back()[b].assign(buf, buf + byte_size);
+    }
+
+    request->key_ += ";" + input->Name() + ":";
+    for (const auto dim : input->Shape()) {
+      request->key_ += std::to_string(dim) + ",";
+    }
+  }
+
+  request->SetRunIndex(reinterpret_cast<uintptr_t>(request.get()));
+  *async_request = request;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ongoing_async_requests_.emplace(request->RunIndex(), request);
+    pending_cnt_++;
+  }
+
+  batcher_->Enqueue(request);
+  return Error::Success;
+}
+
+Error
+BatchedInferContextImpl::GetAsyncRunResults(
+    ResultMap* results, bool* is_ready,
+    const std::shared_ptr<Request>& async_request, bool wait)
+{
+  Error err = IsRequestReady(async_request, is_ready, wait);
+  if (!err.IsOk() || !(*is_ready)) {
+    return err;
+  }
+
+  std::shared_ptr<BatchedRequestImpl> request =
+      std::static_pointer_cast<BatchedRequestImpl>(async_request);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ongoing_async_requests_.erase(request->RunIndex());
+  }
+
+  *results = std::move(request->results_);
+  return request->status_;
+}
+
+void
+BatchedInferContextImpl::RequestComplete(
+    const std::shared_ptr<BatchedRequestImpl>& request, const Error& status,
+    ResultMap&& results)
+{
+  request->Timer().CaptureTimestamp(RequestTimers::Kind::REQUEST_END);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    request->status_ = status;
+    request->results_ = std::move(results);
+    request->SetIsReady(true);
+
+    context_stat_.completed_request_count++;
+    context_stat_.cumulative_total_request_time_ns +=
+        request->Timer().Duration(
+            RequestTimers::Kind::REQUEST_START,
+            RequestTimers::Kind::REQUEST_END);
+  }
+
+  if (request->HasCallback()) {
+    request->callback_(this, request);
+  }
+
+  // Only now can the context be destroyed, so notify while holding
+  // the lock to keep 'cv_' valid until the notification is done.
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_cnt_--;
+  cv_.notify_all();
+}
+
+//==============================================================================
+
+InferContextBatcherImpl::InferContextBatcherImpl(
+    std::unique_ptr<InferContext>&& ctx, uint64_t max_delay_us)
+    : ctx_(std::move(ctx)), max_delay_(max_delay_us), in_flight_cnt_(0),
+      exiting_(false)
+{
+  worker_ = std::thread(&InferContextBatcherImpl::Worker, this);
+}
+
+InferContextBatcherImpl::~InferContextBatcherImpl()
+{
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    exiting_ = true;
+  }
+  cv_.notify_all();
+  worker_.join();
+}
+
+Error
+InferContextBatcherImpl::CreateContext(std::unique_ptr<InferContext>* ctx)
+{
+  ctx->reset(new BatchedInferContextImpl(shared_from_this(), *ctx_));
+  return Error::Success;
+}
+
+void
+InferContextBatcherImpl::Enqueue(
+    const std::shared_ptr<BatchedRequestImpl>& request)
+{
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    pending_.push_back(request);
+  }
+  cv_.notify_all();
+}
+
+void
+InferContextBatcherImpl::Worker()
+{
+  const size_t max_batch_size = ctx_->MaxBatchSize();
+
+  std::unique_lock<std::mutex> lock(mu_);
+  while (true) {
+    if (!completed_.empty()) {
+      Issued issued = std::move(completed_.front());
+      completed_.pop_front();
+      lock.unlock();
+      Complete(issued);
+      lock.lock();
+      in_flight_cnt_--;
+      continue;
+    }
+
+    // Every context waits for its requests to complete before it is
+    // destroyed, so when exiting nothing can be pending.
+    if (exiting_ && pending_.empty() && (in_flight_cnt_ == 0)) {
+      break;
+    }
+
+    if (pending_.empty()) {
+      cv_.wait(lock);
+      continue;
+    }
+
+    // Combine the requests at the front of the queue that share the
+    // options of the first request, up to the maximum batch size.
+    const std::string& key = pending_.front()->key_;
+    if ((key != issued_key_) && (in_flight_cnt_ > 0)) {
+      cv_.wait(lock);
+      continue;
+    }
+
+    size_t cnt = 0;
+    size_t batch_size = 0;
+    bool full = false;
+    for (const auto& request : pending_) {
+      if ((request->key_ != key) ||
+          ((batch_size + request->batch_size_) > max_batch_size)) {
+        full = true;
+        break;
+      }
+      cnt++;
+      batch_size += request->batch_size_;
+    }
+
+    // Wait for more requests unless the batch can't grow or the
+    // first request has waited the maximum delay.
+    const auto deadline = pending_.front()->arrival_ + max_delay_;
+    if (!full && (batch_size < max_batch_size) && !exiting_ &&
+        (std::chrono::steady_clock::now() < deadline)) {
+      cv_.wait_until(lock, deadline);
+      continue;
+    }
+
+    std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+    for (size_t i = 0; i < cnt; ++i) {
+      batch->push_back(std::move(pending_.front()));
+      pending_.pop_front();
+    }
+
+    issued_key_ = key;
+    in_flight_cnt_++;
+    lock.unlock();
+    Issue(batch);
+    lock.lock();
+  }
+}
+
+void
+InferContextBatcherImpl::Issue(const std::shared_ptr<Batch>& batch)
+{
+  const std::shared_ptr<BatchedRequestImpl>& first = batch->front();
+
+  size_t batch_size = 0;
+  for (const auto& request : *batch) {
+    batch_size += request->batch_size_;
+  }
+
+  InferOptionsImpl options(*first->options_);
+  options.SetBatchSize(batch_size);
+  Error err = ctx_->SetRunOptions(options);
+
+  // Set each input to the values of all the requests, in request
+  // order.
+  const auto& inputs = ctx_->Inputs();
+  for (size_t i = 0; err.IsOk() && (i < inputs.size()); ++i) {
+    const std::shared_ptr<InferContext::Input>& input = inputs[i];
+    err = input->Reset();
+    if (err.IsOk() && !first->input_shapes_[i].empty()) {
+      err = input->SetShape(first->input_shapes_[i]);
+    }
+    for (const auto& request : *batch) {
+      for (const auto& value : request->input_values_[i]) {
+        if (err.IsOk()) {
+          err = input->SetRaw(value.data(), value.size());
+        }
+      }
+    }
+  }
+
+  if (err.IsOk()) {
+    err = ctx_->AsyncRun(
+        [this, batch](
+            InferContext* ctx,
+            const std::shared_ptr<InferContext::Request>& request) {
+          {
+            std::lock_guard<std::mutex> lock(mu_);
+            completed_.push_back(Issued{batch, request});
+          }
+          cv_.notify_all();
+        });
+  }
+
+  if (!err.IsOk()) {
+    for (const auto& request : *batch) {
+      request->ctx_->RequestComplete(request, err, InferContext::ResultMap());
+    }
+
+    std::lock_guard<std::mutex> lock(mu_);
+    in_flight_cnt_--;
+  }
+}
+
+void
+InferContextBatcherImpl::Complete(const Issued& issued)
+{
+  InferContext::ResultMap results;
+  bool is_ready;
+  Error err =
+      ctx_->GetAsyncRunResults(&results, &is_ready, issued.request_, true);
+
+  // Split each result into the batch entries of each request.
+  size_t batch_offset = 0;
+  for (const auto& request : *issued.batch_) {
+    Error request_err = err;
+    InferContext::ResultMap request_results;
+    if (request_err.IsOk()) {
+      for (const auto& pr : results) {
+        std::unique_ptr<ResultImpl> result;
+        request_err = reinterpret_cast<ResultImpl*>(pr.second.get())
+                          ->Slice(batch_offset, request->batch_size_, &result);
+        if (!request_err.IsOk()) {
+          request_results.clear();
+          break;
+        }
+        request_results.emplace(pr.first, std::move(result));
+      }
+    }
+
+    batch_offset += request->batch_size_;
+    request->ctx_->RequestComplete(
+        request, request_err, std::move(request_results));
+  }
+}
+
+//==============================================================================
+
+Error
+InferContextBatcher::Create(
+    std::shared_ptr<InferContextBatcher>* batcher,
+    std::unique_ptr<InferContext>&& ctx, uint64_t max_delay_us)
+{
+  if (ctx->MaxBatchSize() == 0) {
+    return Error(
+        RequestStatusCode::INVALID_ARG,
+        "model '" + ctx->ModelName() +
+            "' does not support batching, requests can't be combined");
+  }
+
+  if (ctx->CorrelationId() != 0) {
+    return Error(
+        RequestStatusCode::INVALID_ARG,
+        "a context with a correlation ID can't be used to combine requests");
+  }
+
+  batcher->reset(new InferContextBatcherImpl(std::move(ctx), max_delay_us));
+  return Error::Success;
+}
+
+}}}  // namespace nvidia::inferenceserver::client
@@ -375,6 +375,68 @@ ResultImpl::ResultImpl(
 {
 }
 
+ResultImpl::ResultImpl(const ResultImpl& from, size_t batch_size)
+    : output_(from.output_), result_format_(from.result_format_),
+      batch_size_(batch_size),
+      has_fixed_batch1_byte_size_(from.has_fixed_batch1_byte_size_),
+      batch1_byte_size_(from.batch1_byte_size_),
+      batch1_element_count_(from.batch1_element_count_), shape_(from.shape_),
+      use_shm_(from.use_shm_), inplace_(false), inplace_ptrs_(batch_size),
+      buffers_(batch_size), bufs_idx_(batch_size), bufs_pos_(batch_size),
+      bufs_byte_size_(batch_size), model_name_(from.model_name_),
+      model_version_(from.model_version_), class_pos_(batch_size)
+{
+}
+
+Error
+ResultImpl::Slice(
+    size_t batch_offset, size_t batch_size,
+    std::unique_ptr<ResultImpl>* result) const
+{
+  if (use_shm_) {
+    return Error(
+        RequestStatusCode::UNSUPPORTED,
+        "cannot slice shared memory output '" + output_->Name() + "'");
+  }
+
+  if ((batch_offset + batch_size) > batch_size_) {
+    return Error(
+        RequestStatusCode::INVALID_ARG,
+        "unexpected batch entries " + std::to_string(batch_offset) + " to " +
+            std::to_string(batch_offset + batch_size) +
+            " requested for output '" + output_->Name() + "', batch size is " +
+            std::to_string(batch_size_));
+  }
+
+  std::unique_ptr<ResultImpl> slice(new ResultImpl(*this, batch_size));
+
+  if (result_format_ == InferContext::Result::ResultFormat::RAW) {
+    for (size_t b = 0; b < batch_size; ++b) {
+      const uint8_t* buf;
+      size_t byte_size;
+      Error err = GetRaw(batch_offset + b, &buf, &byte_size);
+      if (!err.IsOk()) {
+        return err;
+      }
+
+      slice->buffers_[b].assign(buf, buf + byte_size);
+      slice->bufs_byte_size_[b] = byte_size;
+    }
+  } else {
+    slice->class_result_ = class_result_;
+    slice->class_result_.clear_batch_classes();
+    for (size_t b = 0; b < batch_size; ++b) {
+      if ((batch_offset + b) < (size_t)class_result_.batch_classes().size()) {
+        *slice->class_result_.add_batch_classes() =
+            class_result_.batch_classes(batch_offset + b);
+      }
+    }
+  }
+
+  *result = std::move(slice);
+  return Error::Success;
+}
+
 Error
 ResultImpl::GetRawShape(std::vector<int64_t>* shape) const
 {
@@ -899,7 +961,13 @@ InferContextImpl::SetRunOptions(const InferContext::Options& boptions)
   infer_request_.Clear();
   infer_request_.set_flags(options.Flags());
   infer_request_.set_batch_size(batch_size_);
-  infer_request_.set_correlation_id(correlation_id_);
+  infer_request_.set_correlation_id(
+      (options.CorrelationId() != 0) ? options.CorrelationId()
+                                     : correlation_id_);
+  infer_request_.set_priority(options.Priority());
+  infer_request_.set_timeout_microseconds(options.TimeoutMicroseconds());
+  infer_request_.set_max_queue_delay_microseconds(
+      options.MaxQueueDelayMicroseconds());
 
   for (const auto& io : inputs_) {
     reinterpret_cast<InputImpl*>(io.get())->SetBatchSize(batch_size_);
@@ -989,6 +1057,25 @@ InferContextImpl::UpdateStat(const RequestTimers& timer)
   context_stat_.cumulative_send_time_ns += send_time_ns;
   context_stat_.cumulative_receive_time_ns += recv_time_ns;
 
+  // The fine-grained timestamps are not captured on every path, e.g. a
+  // failed request has no response, so only accumulate the valid ones.
+  const uint64_t marshal_time_ns = timer.Duration(
+      RequestTimers::Kind::MARSHAL_START, RequestTimers::Kind::MARSHAL_END);
+  if (marshal_time_ns != std::numeric_limits<uint64_t>::max()) {
+    context_stat_.cumulative_marshal_time_ns += marshal_time_ns;
+  }
+  const uint64_t wait_time_ns = timer.Duration(
+      RequestTimers::Kind::SEND_END, RequestTimers::Kind::RESPONSE_FIRST_BYTE);
+  if (wait_time_ns != std::numeric_limits<uint64_t>::max()) {
+    context_stat_.cumulative_response_wait_time_ns += wait_time_ns;
+  }
+  const uint64_t unmarshal_time_ns = timer.Duration(
+      RequestTimers::Kind::UNMARSHAL_START,
+      RequestTimers::Kind::UNMARSHAL_END);
+  if (unmarshal_time_ns != std::numeric_limits<uint64_t>::max()) {
+    context_stat_.cumulative_unmarshal_time_ns += unmarshal_time_ns;
+  }
+
   return Error::Success;
 }
 
@@ -68,6 +68,24 @@ class RequestTimers {
     /// byte).
     RECV_END,
 
+    /// The start of building the request to send, before any request
+    /// byte is sent.
+    MARSHAL_START,
+
+    /// The end of building the request to send.
+    MARSHAL_END,
+
+    /// The arrival of the first byte of the response. GRPC delivers a
+    /// response as a whole so for GRPC this is the time that the
+    /// complete response is delivered to the client library.
+    RESPONSE_FIRST_BYTE,
+
+    /// The start of extracting the response received from the server.
+    UNMARSHAL_START,
+
+    /// The end of extracting the response received from the server.
+    UNMARSHAL_END,
+
     COUNT__
   };
 
@@ -128,7 +146,11 @@ class RequestTimers {
 
 class InferOptionsImpl : public InferContext::Options {
  public:
-  InferOptionsImpl() : flags_(0), batch_size_(0) {}
+  InferOptionsImpl()
+      : flags_(0), batch_size_(0), priority_(0), timeout_us_(0),
+        max_queue_delay_us_(0), correlation_id_(0)
+  {
+  }
   ~InferOptionsImpl() = default;
 
   bool Flag(InferRequestHeader::Flag flag) const override;
@@ -139,6 +161,30 @@ class InferOptionsImpl : public InferContext::Options {
   size_t BatchSize() const override { return batch_size_; }
   void SetBatchSize(size_t batch_size) override { batch_size_ = batch_size; }
 
+  uint32_t Priority() const override { return priority_; }
+  void SetPriority(uint32_t priority) override { priority_ = priority; }
+
+  uint64_t TimeoutMicroseconds() const override { return timeout_us_; }
+  void SetTimeoutMicroseconds(uint64_t timeout_us) override
+  {
+    timeout_us_ = timeout_us;
+  }
+
+  uint64_t MaxQueueDelayMicroseconds() const override
+  {
+    return max_queue_delay_us_;
+  }
+  void SetMaxQueueDelayMicroseconds(uint64_t delay_us) override
+  {
+    max_queue_delay_us_ = delay_us;
+  }
+
+  CorrelationID CorrelationId() const override { return correlation_id_; }
+  void SetCorrelationId(CorrelationID correlation_id) override
+  {
+    correlation_id_ = correlation_id;
+  }
+
   Error AddRawResult(
       const std::shared_ptr<InferContext::Output>& output) override;
   Error AddClassResult(
@@ -170,6 +216,10 @@ class InferOptionsImpl : public InferContext::Options {
  private:
   uint32_t flags_;
   size_t batch_size_;
+  uint32_t priority_;
+  uint64_t timeout_us_;
+  uint64_t max_queue_delay_us_;
+  CorrelationID correlation_id_;
   std::deque<OutputOptionsPair> outputs_;
 };
 
@@ -349,7 +399,16 @@ class ResultImpl : public InferContext::Result {
       const uint8_t* buf, size_t size, const bool inplace,
       size_t* result_bytes);
 
+  // Return in 'result' a new result holding a copy of the
+  // 'batch_size' batch entries of this result starting at
+  // 'batch_offset'.
+  Error Slice(
+      size_t batch_offset, size_t batch_size,
+      std::unique_ptr<ResultImpl>* result) const;
+
  private:
+  ResultImpl(const ResultImpl& from, size_t batch_size);
+
   Error SetBatchRawResult(
       const size_t batch1_byte_size, const uint8_t* buf, size_t size,
       size_t* result_bytes);
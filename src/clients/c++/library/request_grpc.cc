@@ -28,7 +28,10 @@
 
 #include "src/clients/c++/library/request_grpc.h"
 
+#include <grpcpp/generic/generic_stub.h>
 #include <grpcpp/grpcpp.h>
+#include <grpcpp/impl/codegen/proto_utils.h>
+#include <atomic>
 #include <cstdint>
 #include <iostream>
 #include "src/clients/c++/library/request_common.h"
@@ -63,6 +66,52 @@ GetChannel(const std::string& url)
   }
 }
 
+// The full name of the Infer method of GRPCService in
+// grpc_service.proto.
+constexpr char kInferMethod[] = "/nvidia.inferenceserver.GRPCService/Infer";
+
+// Return a slice holding the protobuf encoding of the tag and length
+// of a 'raw_input' field of InferRequest that has 'byte_size' bytes,
+// which are then given by the slices that follow.
+grpc::Slice
+RawInputFieldHeader(size_t byte_size)
+{
+  char buf[16];
+  size_t len = 0;
+  // Wire type 2 is length-delimited.
+  uint64_t value = (InferRequest::kRawInputFieldNumber << 3) | 2;
+  for (int i = 0; i < 2; ++i) {
+    while (value >= 0x80) {
+      buf[len++] = static_cast<char>(value | 0x80);
+      value >>= 7;
+    }
+    buf[len++] = static_cast<char>(value);
+    value = byte_size;
+  }
+
+  return grpc::Slice(buf, len);
+}
+
+Error
+ParseCompressionAlgorithm(
+    const std::string& name, grpc_compression_algorithm* algorithm)
+{
+  if (name == "none") {
+    *algorithm = GRPC_COMPRESS_NONE;
+  } else if (name == "deflate") {
+    *algorithm = GRPC_COMPRESS_DEFLATE;
+  } else if (name == "gzip") {
+    *algorithm = GRPC_COMPRESS_GZIP;
+  } else {
+    return Error(
+        RequestStatusCode::INVALID_ARG,
+        "unknown compression algorithm '" + name +
+            "', expected 'none', 'deflate' or 'gzip'");
+  }
+
+  return Error::Success;
+}
+
 }  // namespace
 
 //==============================================================================
@@ -306,6 +355,11 @@ class SharedMemoryControlGrpcContextImpl : public SharedMemoryControlContext {
   Error RegisterSharedMemory(
       const std::string& name, const std::string& shm_key, const size_t offset,
       const size_t byte_size) override;
+  Error RegisterCudaSharedMemory(
+      const std::string& name, const std::string& shm_key,
+      const size_t handle_offset, const size_t handle_byte_size,
+      const size_t offset, const size_t byte_size,
+      const int device_id) override;
   Error UnregisterSharedMemory(const std::string& name) override;
   Error UnregisterAllSharedMemory() override;
   Error GetSharedMemoryStatus(SharedMemoryStatus* shm_status) override;
@@ -353,6 +407,39 @@ SharedMemoryControlGrpcContextImpl::RegisterSharedMemory(
   }
 }
 
+Error
+SharedMemoryControlGrpcContextImpl::RegisterCudaSharedMemory(
+    const std::string& name, const std::string& shm_key,
+    const size_t handle_offset, const size_t handle_byte_size,
+    const size_t offset, const size_t byte_size, const int device_id)
+{
+  SharedMemoryControlRequest request;
+  SharedMemoryControlResponse response;
+  grpc::ClientContext context;
+
+  auto rshm_region = request.mutable_register_();
+  rshm_region->set_name(name);
+  auto shm_id = rshm_region->mutable_cuda_shared_memory();
+  shm_id->set_shared_memory_key(shm_key);
+  shm_id->set_offset(handle_offset);
+  shm_id->set_byte_size(handle_byte_size);
+  shm_id->set_device_id(device_id);
+  rshm_region->set_offset(offset);
+  rshm_region->set_byte_size(byte_size);
+
+  grpc::Status status =
+      stub_->SharedMemoryControl(&context, request, &response);
+  if (status.ok()) {
+    return Error(response.request_status());
+  } else {
+    // Something wrong with the GRPC conncection
+    return Error(
+        RequestStatusCode::INTERNAL,
+        "GRPC client failed: " + std::to_string(status.error_code()) + ": " +
+            status.error_message());
+  }
+}
+
 Error
 SharedMemoryControlGrpcContextImpl::UnregisterSharedMemory(
     const std::string& name)
@@ -480,6 +567,9 @@ class GrpcRequestImpl : public RequestImpl {
   Error GetResults(
       const InferGrpcContextImpl& ctx, InferContext::ResultMap* results) const;
 
+  // Parse the reply of a completed call into 'grpc_response_'.
+  void ParseReply();
+
  private:
   Error InitResult(
       const std::shared_ptr<InferContext::Output>& infer_output,
@@ -489,16 +579,61 @@ class GrpcRequestImpl : public RequestImpl {
   friend class InferGrpcContextImpl;
   friend class InferGrpcStreamContextImpl;
 
-  // Variables for GRPC call
+  friend class CompletionQueuePool;
+
+  // Variables for GRPC call. The serialized reply of an Infer call
+  // is held in 'grpc_reply_' until it is parsed.
   grpc::ClientContext grpc_context_;
   grpc::Status grpc_status_;
+  grpc::ByteBuffer grpc_reply_;
   std::shared_ptr<InferResponse> grpc_response_;
+
+  // The context that completes the call when it is completed by a
+  // CompletionQueuePool.
+  InferGrpcContextImpl* context_;
+};
+
+//==============================================================================
+
+// A pool of threads, shared by InferGrpcContext objects, that
+// complete asynchronous Infer calls. Each thread waits on a
+// completion queue of its own and the queues are handed out in turn,
+// so the replies of a single context are parsed in parallel. The tag
+// of each call is its GrpcRequestImpl.
+class CompletionQueuePool {
+ public:
+  explicit CompletionQueuePool(size_t thread_count);
+  ~CompletionQueuePool();
+
+  // Return the pool used by the contexts created now, or nullptr if
+  // each context completes its calls on a thread of its own.
+  static std::shared_ptr<CompletionQueuePool> Get();
+
+  // Set the number of threads of the pool used by the contexts
+  // created after this call.
+  static void SetThreadCount(size_t thread_count);
+
+  // Return the completion queue for the next call.
+  grpc::CompletionQueue* NextQueue();
+
+ private:
+  void Process(grpc::CompletionQueue* queue);
+
+  static std::mutex mu_;
+  static size_t thread_count_;
+  static std::shared_ptr<CompletionQueuePool> pool_;
+
+  std::vector<std::unique_ptr<grpc::CompletionQueue>> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> next_queue_;
 };
 
 class InferGrpcContextImpl : public InferContextImpl {
  public:
   InferGrpcContextImpl(
-      const std::string&, const std::string&, int64_t, CorrelationID, bool);
+      const std::string&, const std::string&, int64_t, CorrelationID, bool,
+      const std::string&, grpc_compression_algorithm,
+      const std::shared_ptr<CompletionQueuePool>& completion_pool = nullptr);
   virtual ~InferGrpcContextImpl();
 
   Error InitGrpc(const std::string& server_url);
@@ -514,14 +649,47 @@ class InferGrpcContextImpl : public InferContextImpl {
   virtual Error AsyncRun(
       std::shared_ptr<Request>* async_request, OnCompleteFn callback);
   virtual void AsyncTransfer();
-  Error PreRunProcessing(std::shared_ptr<Request>& request);
+
+  // Complete the asynchronous call of the request with 'run_index'.
+  void CompleteAsyncRequest(uintptr_t run_index);
+
+  // Prepare 'request_' for 'request'. If 'request_buffer' is given
+  // then it returns the serialized request, whose raw inputs reference
+  // the buffers given to SetRaw() instead of copying them, and the raw
+  // inputs are not added to 'request_'.
+  Error PreRunProcessing(
+      std::shared_ptr<Request>& request,
+      grpc::ByteBuffer* request_buffer = nullptr);
+
+  // Compress requests sent with 'context' and ask the server to
+  // compress their responses using the same algorithm.
+  void SetCompression(grpc::ClientContext* context);
 
   // The producer-consumer queue used to communicate asynchronously with
   // the GRPC runtime.
   grpc::CompletionQueue async_request_completion_queue_;
 
-  // GRPC end point.
+  // The compression algorithm for requests and responses, and its name
+  // as understood by the server.
+  const std::string compression_name_;
+  const grpc_compression_algorithm compression_algorithm_;
+
+  // GRPC end point. Infer calls are made through 'generic_stub_' so
+  // that their requests can be sent without copying the raw inputs.
   std::unique_ptr<GRPCService::Stub> stub_;
+  std::unique_ptr<grpc::GenericStub> generic_stub_;
+
+  // The queue used to wait for the completion of synchronous Infer
+  // calls.
+  grpc::CompletionQueue sync_request_completion_queue_;
+
+  // If set, asynchronous Infer calls are completed by the threads of
+  // 'completion_pool_' instead of by 'worker_'. The number of calls
+  // yet to be completed by the pool is 'pool_pending_cnt_'.
+  std::shared_ptr<CompletionQueuePool> completion_pool_;
+  size_t pool_pending_cnt_;
+
+  friend class CompletionQueuePool;
 
   // request for GRPC call, one request object can be used for multiple calls
   // since it can be overwritten as soon as the GRPC send finishes.
@@ -533,11 +701,24 @@ class InferGrpcContextImpl : public InferContextImpl {
 GrpcRequestImpl::GrpcRequestImpl(
     const uint64_t id, InferContext::OnCompleteFn callback)
     : RequestImpl(id, std::move(callback)), grpc_status_(),
-      grpc_response_(std::make_shared<InferResponse>())
+      grpc_response_(std::make_shared<InferResponse>()), context_(nullptr)
 {
   SetRunIndex(id);
 }
 
+void
+GrpcRequestImpl::ParseReply()
+{
+  Timer().CaptureTimestamp(RequestTimers::Kind::UNMARSHAL_START);
+  grpc_response_->Clear();
+  if (grpc_status_.ok()) {
+    grpc_status_ = grpc::SerializationTraits<InferResponse>::Deserialize(
+        &grpc_reply_, grpc_response_.get());
+  }
+  grpc_reply_.Clear();
+  Timer().CaptureTimestamp(RequestTimers::Kind::UNMARSHAL_END);
+}
+
 Error
 GrpcRequestImpl::InitResult(
     const std::shared_ptr<InferContext::Output>& infer_output,
@@ -662,12 +843,28 @@ InferGrpcContextImpl::InitGrpc(const std::string& server_url)
 
 InferGrpcContextImpl::InferGrpcContextImpl(
     const std::string& server_url, const std::string& model_name,
-    int64_t model_version, CorrelationID correlation_id, bool verbose)
+    int64_t model_version, CorrelationID correlation_id, bool verbose,
+    const std::string& compression_name,
+    grpc_compression_algorithm compression_algorithm,
+    const std::shared_ptr<CompletionQueuePool>& completion_pool)
     : InferContextImpl(model_name, model_version, correlation_id, verbose),
-      stub_(GRPCService::NewStub(GetChannel(server_url)))
+      compression_name_(compression_name),
+      compression_algorithm_(compression_algorithm),
+      stub_(GRPCService::NewStub(GetChannel(server_url))),
+      generic_stub_(new grpc::GenericStub(GetChannel(server_url))),
+      completion_pool_(completion_pool), pool_pending_cnt_(0)
 {
 }
 
+void
+InferGrpcContextImpl::SetCompression(grpc::ClientContext* context)
+{
+  if (compression_algorithm_ != GRPC_COMPRESS_NONE) {
+    context->set_compression_algorithm(compression_algorithm_);
+    context->AddMetadata(kResponseCompressionGRPCMetadata, compression_name_);
+  }
+}
+
 InferGrpcContextImpl::~InferGrpcContextImpl()
 {
   exiting_ = true;
@@ -678,7 +875,13 @@ InferGrpcContextImpl::~InferGrpcContextImpl()
     worker_.join();
   }
 
-  // Close complete queue and drain its content
+  // Wait for the calls being completed by the completion queue pool
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return pool_pending_cnt_ == 0; });
+  }
+
+  // Close complete queues and drain their content
   async_request_completion_queue_.Shutdown();
   bool has_next = true;
   void* tag;
@@ -686,12 +889,18 @@ InferGrpcContextImpl::~InferGrpcContextImpl()
   do {
     has_next = async_request_completion_queue_.Next(&tag, &ok);
   } while (has_next);
+
+  sync_request_completion_queue_.Shutdown();
+  do {
+    has_next = sync_request_completion_queue_.Next(&tag, &ok);
+  } while (has_next);
 }
 
 Error
 InferGrpcContextImpl::Run(ResultMap* results)
 {
   grpc::ClientContext context;
+  SetCompression(&context);
 
   std::shared_ptr<GrpcRequestImpl> sync_request =
       std::static_pointer_cast<GrpcRequestImpl>(sync_request_);
@@ -701,15 +910,30 @@ InferGrpcContextImpl::Run(ResultMap* results)
 
   // Use send timer to measure time for marshalling infer request
   sync_request->Timer().CaptureTimestamp(RequestTimers::Kind::SEND_START);
-  Error err = PreRunProcessing(sync_request_);
+  sync_request->Timer().CaptureTimestamp(RequestTimers::Kind::MARSHAL_START);
+  grpc::ByteBuffer request_buffer;
+  Error err = PreRunProcessing(sync_request_, &request_buffer);
   if (!err.IsOk()) {
     return err;
   }
+  sync_request->Timer().CaptureTimestamp(RequestTimers::Kind::MARSHAL_END);
   sync_request->Timer().CaptureTimestamp(RequestTimers::Kind::SEND_END);
 
-  sync_request->grpc_response_->Clear();
-  sync_request->grpc_status_ =
-      stub_->Infer(&context, request_, sync_request->grpc_response_.get());
+  std::unique_ptr<grpc::GenericClientAsyncResponseReader> rpc(
+      generic_stub_->PrepareUnaryCall(
+          &context, kInferMethod, request_buffer,
+          &sync_request_completion_queue_));
+  rpc->StartCall();
+  rpc->Finish(
+      &sync_request->grpc_reply_, &sync_request->grpc_status_,
+      sync_request.get());
+
+  void* tag;
+  bool ok;
+  sync_request_completion_queue_.Next(&tag, &ok);
+  sync_request->Timer().CaptureTimestamp(
+      RequestTimers::Kind::RESPONSE_FIRST_BYTE);
+  sync_request->ParseReply();
 
   sync_request->Timer().CaptureTimestamp(RequestTimers::Kind::RECV_START);
   Error request_status = sync_request->GetResults(*this, results);
@@ -742,7 +966,7 @@ Error
 InferGrpcContextImpl::AsyncRun(
     std::shared_ptr<Request>* async_request, OnCompleteFn callback)
 {
-  if (!worker_.joinable()) {
+  if ((completion_pool_ == nullptr) && !worker_.joinable()) {
     worker_ = std::thread(&InferGrpcContextImpl::AsyncTransfer, this);
   }
 
@@ -763,29 +987,48 @@ InferGrpcContextImpl::AsyncRun(
           RequestStatusCode::INTERNAL,
           "Failed to insert new asynchronous request context.");
     }
+    if (completion_pool_ != nullptr) {
+      pool_pending_cnt_++;
+    }
   }
 
   current_context->Timer().CaptureTimestamp(RequestTimers::Kind::REQUEST_START);
   current_context->Timer().CaptureTimestamp(RequestTimers::Kind::SEND_START);
+  current_context->Timer().CaptureTimestamp(
+      RequestTimers::Kind::MARSHAL_START);
 
-  Error err = PreRunProcessing(*async_request);
+  grpc::ByteBuffer request_buffer;
+  Error err = PreRunProcessing(*async_request, &request_buffer);
   if (!err.IsOk()) {
+    std::lock_guard<std::mutex> lock(mutex_);
     ongoing_async_requests_.erase(current_context->Id());
+    if (completion_pool_ != nullptr) {
+      pool_pending_cnt_--;
+    }
     return err;
   }
 
+  current_context->Timer().CaptureTimestamp(RequestTimers::Kind::MARSHAL_END);
   current_context->Timer().CaptureTimestamp(RequestTimers::Kind::SEND_END);
 
-  std::unique_ptr<grpc::ClientAsyncResponseReader<InferResponse>> rpc(
-      stub_->PrepareAsyncInfer(
-          &current_context->grpc_context_, request_,
-          &async_request_completion_queue_));
+  grpc::CompletionQueue* completion_queue = &async_request_completion_queue_;
+  void* tag = (void*)run_index;
+  if (completion_pool_ != nullptr) {
+    current_context->context_ = this;
+    completion_queue = completion_pool_->NextQueue();
+    tag = current_context;
+  }
+
+  SetCompression(&current_context->grpc_context_);
+  std::unique_ptr<grpc::GenericClientAsyncResponseReader> rpc(
+      generic_stub_->PrepareUnaryCall(
+          &current_context->grpc_context_, kInferMethod, request_buffer,
+          completion_queue));
 
   rpc->StartCall();
 
   rpc->Finish(
-      current_context->grpc_response_.get(), &current_context->grpc_status_,
-      (void*)run_index);
+      &current_context->grpc_reply_, &current_context->grpc_status_, tag);
 
   cv_.notify_all();
   return Error(RequestStatusCode::SUCCESS);
@@ -819,7 +1062,8 @@ InferGrpcContextImpl::GetAsyncRunResults(
 }
 
 Error
-InferGrpcContextImpl::PreRunProcessing(std::shared_ptr<Request>& request)
+InferGrpcContextImpl::PreRunProcessing(
+    std::shared_ptr<Request>& request, grpc::ByteBuffer* request_buffer)
 {
   // Create the input metadata for the request now that all input
   // sizes are known. For non-fixed-sized datatypes the
@@ -857,6 +1101,49 @@ InferGrpcContextImpl::PreRunProcessing(std::shared_ptr<Request>& request)
   request_.set_model_version(model_version_);
   request_.mutable_meta_data()->MergeFrom(infer_request_);
 
+  // Send the raw inputs as the 'raw_input' fields that follow the
+  // rest of the request, each given by slices that reference the
+  // buffers of its batches.
+  if (request_buffer != nullptr) {
+    std::vector<grpc::Slice> slices;
+    slices.emplace_back(request_.SerializeAsString());
+    size_t request_size = slices.back().size();
+    for (auto& input : inputs_) {
+      InputImpl* io = reinterpret_cast<InputImpl*>(input.get());
+      if (io->IsSharedMemory()) {
+        continue;
+      }
+
+      const size_t header_idx = slices.size();
+      slices.emplace_back();
+      size_t input_size = 0;
+      for (size_t batch_idx = 0; batch_idx < batch_size_; batch_idx++) {
+        const uint8_t* data_ptr;
+        size_t data_byte_size;
+        io->GetRaw(batch_idx, &data_ptr, &data_byte_size);
+        if (data_byte_size != 0) {
+          slices.emplace_back(
+              data_ptr, data_byte_size, grpc::Slice::STATIC_SLICE);
+          input_size += data_byte_size;
+        }
+      }
+      slices[header_idx] = RawInputFieldHeader(input_size);
+      request_size += slices[header_idx].size() + input_size;
+    }
+
+    if (request_size > INT_MAX) {
+      request_.Clear();
+      return Error(
+          RequestStatusCode::INVALID_ARG,
+          "Request has byte size " + std::to_string(request_size) +
+              " which exceed gRPC's byte size limit " +
+              std::to_string(INT_MAX) + ".");
+    }
+
+    *request_buffer = grpc::ByteBuffer(slices.data(), slices.size());
+    return Error::Success;
+  }
+
   size_t input_pos_idx = 0;
   while (input_pos_idx < inputs_.size()) {
     InputImpl* io = reinterpret_cast<InputImpl*>(inputs_[input_pos_idx].get());
@@ -911,68 +1198,173 @@ InferGrpcContextImpl::AsyncTransfer()
     lock.unlock();
     // GRPC async APIs are thread-safe https://github.com/grpc/grpc/issues/4486
     if (!exiting_) {
-      std::shared_ptr<Request> request_with_callback;
       size_t got;
       bool ok = true;
       bool status = async_request_completion_queue_.Next((void**)(&got), &ok);
-      {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (!ok) {
-          fprintf(stderr, "Unexpected not ok on client side.");
-        }
-        if (!status) {
-          fprintf(stderr, "Completion queue is closed.");
-        }
-        auto itr = ongoing_async_requests_.find(got);
-        if (itr == ongoing_async_requests_.end()) {
-          fprintf(
-              stderr,
-              "Unexpected error: received completed request that"
-              " is not in the list of asynchronous requests.\n");
-          continue;
-        }
-
-        std::shared_ptr<GrpcRequestImpl> grpc_request =
-            std::static_pointer_cast<GrpcRequestImpl>(itr->second);
-        grpc_request->Timer().CaptureTimestamp(
-            RequestTimers::Kind::REQUEST_END);
-        grpc_request->SetIsReady(true);
-        if (grpc_request->HasCallback()) {
-          request_with_callback = itr->second;
-        }
+      if (!ok) {
+        fprintf(stderr, "Unexpected not ok on client side.");
       }
-      // send signal in case the main thread is waiting
-      cv_.notify_all();
-      if (request_with_callback != nullptr) {
-        GrpcRequestImpl* request =
-            static_cast<GrpcRequestImpl*>(request_with_callback.get());
-        request->callback_(this, std::move(request_with_callback));
+      if (!status) {
+        fprintf(stderr, "Completion queue is closed.");
       }
+      CompleteAsyncRequest(got);
     }
   } while (!exiting_);
 }
 
+void
+InferGrpcContextImpl::CompleteAsyncRequest(uintptr_t run_index)
+{
+  std::shared_ptr<GrpcRequestImpl> grpc_request;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itr = ongoing_async_requests_.find(run_index);
+    if (itr != ongoing_async_requests_.end()) {
+      grpc_request = std::static_pointer_cast<GrpcRequestImpl>(itr->second);
+    } else {
+      fprintf(
+          stderr,
+          "Unexpected error: received completed request that"
+          " is not in the list of asynchronous requests.\n");
+    }
+  }
+
+  if (grpc_request != nullptr) {
+    // The reply is parsed without holding the lock so that the
+    // replies of different calls can be parsed in parallel.
+    grpc_request->Timer().CaptureTimestamp(RequestTimers::Kind::REQUEST_END);
+    grpc_request->Timer().CaptureTimestamp(
+        RequestTimers::Kind::RESPONSE_FIRST_BYTE);
+    grpc_request->ParseReply();
+
+    std::shared_ptr<Request> request_with_callback;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      grpc_request->SetIsReady(true);
+      if (grpc_request->HasCallback()) {
+        request_with_callback = grpc_request;
+      }
+    }
+    // send signal in case the main thread is waiting
+    cv_.notify_all();
+    if (request_with_callback != nullptr) {
+      grpc_request->callback_(this, std::move(request_with_callback));
+    }
+  }
+
+  // This must be the last use of the context as it can be destroyed
+  // once no calls are pending.
+  if (completion_pool_ != nullptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pool_pending_cnt_--;
+    cv_.notify_all();
+  }
+}
+
+//==============================================================================
+
+std::mutex CompletionQueuePool::mu_;
+size_t CompletionQueuePool::thread_count_ = 0;
+std::shared_ptr<CompletionQueuePool> CompletionQueuePool::pool_;
+
+CompletionQueuePool::CompletionQueuePool(size_t thread_count)
+    : next_queue_(0)
+{
+  for (size_t i = 0; i < thread_count; ++i) {
+    queues_.emplace_back(new grpc::CompletionQueue());
+    threads_.emplace_back(
+        &CompletionQueuePool::Process, this, queues_.back().get());
+  }
+}
+
+CompletionQueuePool::~CompletionQueuePool()
+{
+  for (auto& queue : queues_) {
+    queue->Shutdown();
+  }
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+std::shared_ptr<CompletionQueuePool>
+CompletionQueuePool::Get()
+{
+  std::lock_guard<std::mutex> lock(mu_);
+  if ((pool_ == nullptr) && (thread_count_ != 0)) {
+    pool_.reset(new CompletionQueuePool(thread_count_));
+  }
+
+  return pool_;
+}
+
+void
+CompletionQueuePool::SetThreadCount(size_t thread_count)
+{
+  // Contexts using the current pool keep it until they are destroyed.
+  std::lock_guard<std::mutex> lock(mu_);
+  if (thread_count != thread_count_) {
+    thread_count_ = thread_count;
+    pool_.reset();
+  }
+}
+
+grpc::CompletionQueue*
+CompletionQueuePool::NextQueue()
+{
+  return queues_[next_queue_++ % queues_.size()].get();
+}
+
+void
+CompletionQueuePool::Process(grpc::CompletionQueue* queue)
+{
+  void* tag;
+  bool ok;
+  while (queue->Next(&tag, &ok)) {
+    GrpcRequestImpl* request = reinterpret_cast<GrpcRequestImpl*>(tag);
+    request->context_->CompleteAsyncRequest(request->RunIndex());
+  }
+}
+
+//==============================================================================
+
+Error
+InferGrpcContext::SetCompletionThreadCount(size_t thread_count)
+{
+  CompletionQueuePool::SetThreadCount(thread_count);
+  return Error::Success;
+}
+
 Error
 InferGrpcContext::Create(
     std::unique_ptr<InferContext>* ctx, const std::string& server_url,
-    const std::string& model_name, int64_t model_version, bool verbose)
+    const std::string& model_name, int64_t model_version, bool verbose,
+    const std::string& compression_algorithm)
 {
   return Create(
       ctx, 0 /* correlation_id */, server_url, model_name, model_version,
-      verbose);
+      verbose, compression_algorithm);
 }
 
 Error
 InferGrpcContext::Create(
     std::unique_ptr<InferContext>* ctx, CorrelationID correlation_id,
     const std::string& server_url, const std::string& model_name,
-    int64_t model_version, bool verbose)
+    int64_t model_version, bool verbose,
+    const std::string& compression_algorithm)
 {
+  grpc_compression_algorithm algorithm;
+  Error err = ParseCompressionAlgorithm(compression_algorithm, &algorithm);
+  if (!err.IsOk()) {
+    return err;
+  }
+
   InferGrpcContextImpl* ctx_ptr = new InferGrpcContextImpl(
-      server_url, model_name, model_version, correlation_id, verbose);
+      server_url, model_name, model_version, correlation_id, verbose,
+      compression_algorithm, algorithm, CompletionQueuePool::Get());
   ctx->reset(static_cast<InferContext*>(ctx_ptr));
 
-  Error err = ctx_ptr->InitGrpc(server_url);
+  err = ctx_ptr->InitGrpc(server_url);
   if (!err.IsOk()) {
     ctx->reset();
   }
@@ -987,7 +1379,8 @@ class InferGrpcStreamContextImpl : public InferGrpcContextImpl {
   using InferGrpcContextImpl::AsyncRun;
 
   InferGrpcStreamContextImpl(
-      const std::string&, const std::string&, int64_t, CorrelationID, bool);
+      const std::string&, const std::string&, int64_t, CorrelationID, bool,
+      const std::string&, grpc_compression_algorithm);
   virtual ~InferGrpcStreamContextImpl();
 
   Error Run(ResultMap* results) override;
@@ -1005,10 +1398,14 @@ class InferGrpcStreamContextImpl : public InferGrpcContextImpl {
 
 InferGrpcStreamContextImpl::InferGrpcStreamContextImpl(
     const std::string& server_url, const std::string& model_name,
-    int64_t model_version, CorrelationID correlation_id, bool verbose)
+    int64_t model_version, CorrelationID correlation_id, bool verbose,
+    const std::string& compression_name,
+    grpc_compression_algorithm compression_algorithm)
     : InferGrpcContextImpl(
-          server_url, model_name, model_version, correlation_id, verbose)
+          server_url, model_name, model_version, correlation_id, verbose,
+          compression_name, compression_algorithm)
 {
+  SetCompression(&context_);
   stream_ = stub_->StreamInfer(&context_);
   // Initiate worker thread to read constantly
   worker_ = std::thread(&InferGrpcStreamContextImpl::AsyncTransfer, this);
@@ -1058,12 +1455,15 @@ InferGrpcStreamContextImpl::AsyncRun(
 
   current_context->Timer().CaptureTimestamp(RequestTimers::Kind::REQUEST_START);
   current_context->Timer().CaptureTimestamp(RequestTimers::Kind::SEND_START);
+  current_context->Timer().CaptureTimestamp(
+      RequestTimers::Kind::MARSHAL_START);
 
   Error err = PreRunProcessing(*async_request);
   if (!err.IsOk()) {
     ongoing_async_requests_.erase(current_context->Id());
     return err;
   }
+  current_context->Timer().CaptureTimestamp(RequestTimers::Kind::MARSHAL_END);
   current_context->Timer().CaptureTimestamp(RequestTimers::Kind::SEND_END);
 
   bool ok = stream_->Write(request_);
@@ -1103,6 +1503,8 @@ InferGrpcStreamContextImpl::AsyncTransfer()
           std::static_pointer_cast<GrpcRequestImpl>(itr->second);
       grpc_request->grpc_response_->Swap(&response);
       grpc_request->Timer().CaptureTimestamp(RequestTimers::Kind::REQUEST_END);
+      grpc_request->Timer().CaptureTimestamp(
+          RequestTimers::Kind::RESPONSE_FIRST_BYTE);
       grpc_request->SetIsReady(true);
       if (grpc_request->HasCallback()) {
         request_with_callback = itr->second;
@@ -1122,24 +1524,33 @@ InferGrpcStreamContextImpl::AsyncTransfer()
 Error
 InferGrpcStreamContext::Create(
     std::unique_ptr<InferContext>* ctx, const std::string& server_url,
-    const std::string& model_name, int64_t model_version, bool verbose)
+    const std::string& model_name, int64_t model_version, bool verbose,
+    const std::string& compression_algorithm)
 {
   return Create(
       ctx, 0 /* correlation_id */, server_url, model_name, model_version,
-      verbose);
+      verbose, compression_algorithm);
 }
 
 Error
 InferGrpcStreamContext::Create(
     std::unique_ptr<InferContext>* ctx, CorrelationID correlation_id,
     const std::string& server_url, const std::string& model_name,
-    int64_t model_version, bool verbose)
+    int64_t model_version, bool verbose,
+    const std::string& compression_algorithm)
 {
+  grpc_compression_algorithm algorithm;
+  Error err = ParseCompressionAlgorithm(compression_algorithm, &algorithm);
+  if (!err.IsOk()) {
+    return err;
+  }
+
   InferGrpcStreamContextImpl* ctx_ptr = new InferGrpcStreamContextImpl(
-      server_url, model_name, model_version, correlation_id, verbose);
+      server_url, model_name, model_version, correlation_id, verbose,
+      compression_algorithm, algorithm);
   ctx->reset(static_cast<InferContext*>(ctx_ptr));
 
-  Error err = ctx_ptr->InitGrpc(server_url);
+  err = ctx_ptr->InitGrpc(server_url);
   if (!err.IsOk()) {
     ctx->reset();
   }
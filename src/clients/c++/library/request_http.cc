@@ -45,6 +45,11 @@ using ResponseHandlerUserP = std::pair<InferHttpContextImpl*, HttpRequestImpl*>;
 
 namespace {
 
+// The maximum time the asynchronous worker waits for activity on the
+// transfers in progress before progressing them again, in
+// milliseconds.
+constexpr int kAsyncPollTimeoutMs = 1000;
+
 //==============================================================================
 
 // Global initialization for libcurl. Libcurl requires global
@@ -76,6 +81,118 @@ CurlGlobal::~CurlGlobal()
 
 static CurlGlobal curl_global;
 
+// Pool of idle curl easy handles. An easy handle keeps the
+// connections it has used open for reuse, so taking handles from the
+// pool lets requests reuse kept-alive connections instead of
+// establishing a new connection for every request. All handles also
+// share DNS lookups and TLS sessions.
+class CurlHandlePool {
+ public:
+  CurlHandlePool();
+  ~CurlHandlePool();
+
+  // Return an easy handle with default options, or nullptr if a
+  // handle can't be created.
+  CURL* Acquire();
+
+  // Return 'curl' to the pool. The handle must not be in use.
+  void Release(CURL* curl);
+
+ private:
+  static void Lock(
+      CURL* curl, curl_lock_data data, curl_lock_access access, void* userp);
+  static void Unlock(CURL* curl, curl_lock_data data, void* userp);
+
+  // The maximum number of idle handles kept in the pool.
+  static constexpr size_t kMaxIdleHandleCount = 64;
+
+  std::mutex mu_;
+  std::vector<CURL*> handles_;
+
+  CURLSH* share_;
+  std::mutex share_mu_[CURL_LOCK_DATA_LAST];
+};
+
+CurlHandlePool::CurlHandlePool() : share_(curl_share_init())
+{
+  if (share_ != nullptr) {
+    curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, Lock);
+    curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, Unlock);
+    curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+  }
+}
+
+CurlHandlePool::~CurlHandlePool()
+{
+  for (CURL* curl : handles_) {
+    curl_easy_cleanup(curl);
+  }
+  if (share_ != nullptr) {
+    curl_share_cleanup(share_);
+  }
+}
+
+CURL*
+CurlHandlePool::Acquire()
+{
+  CURL* curl = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!handles_.empty()) {
+      curl = handles_.back();
+      handles_.pop_back();
+    }
+  }
+
+  if (curl == nullptr) {
+    curl = curl_easy_init();
+    if (curl == nullptr) {
+      return nullptr;
+    }
+  }
+
+  if (share_ != nullptr) {
+    curl_easy_setopt(curl, CURLOPT_SHARE, share_);
+  }
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
+  return curl;
+}
+
+void
+CurlHandlePool::Release(CURL* curl)
+{
+  // Resetting the options keeps the handle's open connections.
+  curl_easy_reset(curl);
+
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (handles_.size() < kMaxIdleHandleCount) {
+      handles_.push_back(curl);
+      return;
+    }
+  }
+
+  curl_easy_cleanup(curl);
+}
+
+void
+CurlHandlePool::Lock(
+    CURL* curl, curl_lock_data data, curl_lock_access access, void* userp)
+{
+  reinterpret_cast<CurlHandlePool*>(userp)->share_mu_[data].lock();
+}
+
+void
+CurlHandlePool::Unlock(CURL* curl, curl_lock_data data, void* userp)
+{
+  reinterpret_cast<CurlHandlePool*>(userp)->share_mu_[data].unlock();
+}
+
+static CurlHandlePool curl_handle_pool;
+
 }  // namespace
 
 //==============================================================================
@@ -124,7 +241,7 @@ ServerHealthHttpContextImpl::GetHealth(const std::string& url, bool* health)
     return curl_global.Status();
   }
 
-  CURL* curl = curl_easy_init();
+  CURL* curl = curl_handle_pool.Acquire();
   if (!curl) {
     return Error(
         RequestStatusCode::INTERNAL, "failed to initialize HTTP client");
@@ -150,7 +267,7 @@ ServerHealthHttpContextImpl::GetHealth(const std::string& url, bool* health)
   CURLcode res = curl_easy_perform(curl);
   if (res != CURLE_OK) {
     curl_slist_free_all(header_list);
-    curl_easy_cleanup(curl);
+    curl_handle_pool.Release(curl);
     return Error(
         RequestStatusCode::INTERNAL,
         "HTTP client failed: " + std::string(curl_easy_strerror(res)));
@@ -161,7 +278,7 @@ ServerHealthHttpContextImpl::GetHealth(const std::string& url, bool* health)
   curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
 
   curl_slist_free_all(header_list);
-  curl_easy_cleanup(curl);
+  curl_handle_pool.Release(curl);
 
   *health = (http_code == 200) ? true : false;
 
@@ -276,7 +393,7 @@ ServerStatusHttpContextImpl::GetServerStatus(ServerStatus* server_status)
     return curl_global.Status();
   }
 
-  CURL* curl = curl_easy_init();
+  CURL* curl = curl_handle_pool.Acquire();
   if (!curl) {
     return Error(
         RequestStatusCode::INTERNAL, "failed to initialize HTTP client");
@@ -312,7 +429,7 @@ ServerStatusHttpContextImpl::GetServerStatus(ServerStatus* server_status)
   CURLcode res = curl_easy_perform(curl);
   if (res != CURLE_OK) {
     curl_slist_free_all(header_list);
-    curl_easy_cleanup(curl);
+    curl_handle_pool.Release(curl);
     return Error(
         RequestStatusCode::INTERNAL,
         "HTTP client failed: " + std::string(curl_easy_strerror(res)));
@@ -323,7 +440,7 @@ ServerStatusHttpContextImpl::GetServerStatus(ServerStatus* server_status)
   curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
 
   curl_slist_free_all(header_list);
-  curl_easy_cleanup(curl);
+  curl_handle_pool.Release(curl);
 
   // Should have a request status, if not then create an error status.
   if (request_status_.code() == RequestStatusCode::INVALID) {
@@ -491,7 +608,7 @@ ModelControlHttpContextImpl::SendRequest(
     return curl_global.Status();
   }
 
-  CURL* curl = curl_easy_init();
+  CURL* curl = curl_handle_pool.Acquire();
   if (!curl) {
     return Error(
         RequestStatusCode::INTERNAL, "failed to initialize HTTP client");
@@ -525,7 +642,7 @@ ModelControlHttpContextImpl::SendRequest(
   CURLcode res = curl_easy_perform(curl);
   if (res != CURLE_OK) {
     curl_slist_free_all(header_list);
-    curl_easy_cleanup(curl);
+    curl_handle_pool.Release(curl);
     return Error(
         RequestStatusCode::INTERNAL,
         "HTTP client failed: " + std::string(curl_easy_strerror(res)));
@@ -536,7 +653,7 @@ ModelControlHttpContextImpl::SendRequest(
   curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
 
   curl_slist_free_all(header_list);
-  curl_easy_cleanup(curl);
+  curl_handle_pool.Release(curl);
 
   // Should have a request status, if not then create an error status.
   if (request_status_.code() == RequestStatusCode::INVALID) {
@@ -597,6 +714,11 @@ class SharedMemoryControlHttpContextImpl : public SharedMemoryControlContext {
   Error RegisterSharedMemory(
       const std::string& name, const std::string& shm_key, const size_t offset,
       const size_t byte_size) override;
+  Error RegisterCudaSharedMemory(
+      const std::string& name, const std::string& shm_key,
+      const size_t handle_offset, const size_t handle_byte_size,
+      const size_t offset, const size_t byte_size,
+      const int device_id) override;
   Error UnregisterSharedMemory(const std::string& name) override;
   Error UnregisterAllSharedMemory() override;
   Error GetSharedMemoryStatus(SharedMemoryStatus* status) override;
@@ -652,6 +774,17 @@ SharedMemoryControlHttpContextImpl::RegisterSharedMemory(
   return SendRequest("register", name, shm_key, offset, byte_size);
 }
 
+Error
+SharedMemoryControlHttpContextImpl::RegisterCudaSharedMemory(
+    const std::string& name, const std::string& shm_key,
+    const size_t handle_offset, const size_t handle_byte_size,
+    const size_t offset, const size_t byte_size, const int device_id)
+{
+  return Error(
+      RequestStatusCode::UNSUPPORTED,
+      "CUDA shared memory registration is only supported using GRPC");
+}
+
 Error
 SharedMemoryControlHttpContextImpl::UnregisterSharedMemory(
     const std::string& name)
@@ -698,7 +831,7 @@ SharedMemoryControlHttpContextImpl::SendRequest(
     return curl_global.Status();
   }
 
-  CURL* curl = curl_easy_init();
+  CURL* curl = curl_handle_pool.Acquire();
   if (!curl) {
     return Error(
         RequestStatusCode::INTERNAL, "failed to initialize HTTP client");
@@ -746,7 +879,7 @@ SharedMemoryControlHttpContextImpl::SendRequest(
   CURLcode res = curl_easy_perform(curl);
   if (res != CURLE_OK) {
     curl_slist_free_all(header_list);
-    curl_easy_cleanup(curl);
+    curl_handle_pool.Release(curl);
     return Error(
         RequestStatusCode::INTERNAL,
         "HTTP client failed: " + std::string(curl_easy_strerror(res)));
@@ -757,7 +890,7 @@ SharedMemoryControlHttpContextImpl::SendRequest(
   curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
 
   curl_slist_free_all(header_list);
-  curl_easy_cleanup(curl);
+  curl_handle_pool.Release(curl);
 
   // Should have a request status, if not then create an error status.
   if (request_status_.code() == RequestStatusCode::INVALID) {
@@ -812,6 +945,24 @@ SharedMemoryControlHttpContext::Create(
 
 //==============================================================================
 
+class HttpResultImpl : public ResultImpl {
+ public:
+  HttpResultImpl(
+      const std::shared_ptr<std::string>& response_body,
+      const std::shared_ptr<InferContext::Output>& output, uint64_t batch_size)
+      : ResultImpl(output, batch_size), response_body_(response_body)
+  {
+  }
+  ~HttpResultImpl() = default;
+
+ private:
+  // Result tensor data is used in-place from the response body so we
+  // must hold a reference to it.
+  std::shared_ptr<std::string> response_body_;
+};
+
+//==============================================================================
+
 class HttpRequestImpl : public RequestImpl {
  public:
   HttpRequestImpl(
@@ -832,9 +983,9 @@ class HttpRequestImpl : public RequestImpl {
       const InferHttpContextImpl& ctx,
       const InferResponseHeader::Output& output, const size_t batch_size);
 
-  // Copy into the context 'size' bytes of result data from
-  // 'buf'. Return the actual amount copied in 'result_bytes'.
-  Error SetNextRawResult(const uint8_t* buf, size_t size, size_t* result_bytes);
+  // Append 'size' bytes of the response body from 'buf' to the
+  // receive buffer.
+  void AddResponseBody(const uint8_t* buf, size_t size);
 
   // Get results from an inference request.
   Error GetResults(InferContext::ResultMap* results);
@@ -858,9 +1009,11 @@ class HttpRequestImpl : public RequestImpl {
   // The partial InferResponseHeader delivered via HTTP header.
   InferResponseHeader response_header_;
 
-  // Buffer that accumulates the serialized InferResponseHeader at the
-  // end of the body.
-  std::string infer_response_buffer_;
+  // Buffer that accumulates the response body, which is the RAW
+  // results followed by the serialized InferResponseHeader. The
+  // results refer to the RAW result data in-place so the buffer is
+  // shared with them.
+  std::shared_ptr<std::string> response_body_;
 
   // The inputs for the request. For asynchronous request, it should
   // be a deep copy of the inputs set by the user in case the user modifies
@@ -873,9 +1026,6 @@ class HttpRequestImpl : public RequestImpl {
   // Current positions within input vectors when sending request.
   size_t input_pos_idx_;
 
-  // Current positions within output vectors when processing response.
-  size_t result_pos_idx_;
-
   // Callback data for response handler.
   ResponseHandlerUserP response_handler_userp_;
 
@@ -916,8 +1066,11 @@ class InferHttpContextImpl : public InferContextImpl {
   // Custom HTTP headers
   const std::map<std::string, std::string> headers_;
 
-  // curl multi handle for processing asynchronous requests
+  // curl multi handle for processing asynchronous requests. Only the
+  // worker thread uses it, AsyncRun() queues the easy handles of new
+  // requests in 'pending_handles_' and wakes the worker to add them.
   CURLM* multi_handle_;
+  std::vector<CURL*> pending_handles_;
 
   // URL to POST to
   std::string url_;
@@ -932,9 +1085,10 @@ HttpRequestImpl::HttpRequestImpl(
     const uint64_t id,
     const std::vector<std::shared_ptr<InferContext::Input>> inputs,
     InferContext::OnCompleteFn callback)
-    : RequestImpl(id, std::move(callback)), easy_handle_(curl_easy_init()),
-      header_list_(nullptr), inputs_(inputs), total_input_byte_size_(0),
-      input_pos_idx_(0), result_pos_idx_(0)
+    : RequestImpl(id, std::move(callback)),
+      easy_handle_(curl_handle_pool.Acquire()), header_list_(nullptr),
+      response_body_(std::make_shared<std::string>()), inputs_(inputs),
+      total_input_byte_size_(0), input_pos_idx_(0)
 {
   if (easy_handle_ != nullptr) {
     SetRunIndex(reinterpret_cast<uintptr_t>(easy_handle_));
@@ -949,7 +1103,7 @@ HttpRequestImpl::~HttpRequestImpl()
   }
 
 if (easy_handle_ != nullptr) {
-    curl_easy_cleanup(easy_handle_);
+    curl_handle_pool.Release(easy_handle_);
   }
 }
 
@@ -996,42 +1150,22 @@ HttpRequestImpl::GetNextInput(uint8_t* buf, size_t size, size_t* input_bytes)
   return Error::Success;
 }
 
-Error
-HttpRequestImpl::SetNextRawResult(
-    const uint8_t* buf, size_t size, size_t* result_bytes)
+void
+HttpRequestImpl::AddResponseBody(const uint8_t* buf, size_t size)
 {
-  *result_bytes = 0;
-
-  while ((size > 0) && (result_pos_idx_ < ordered_results_.size())) {
-    ResultImpl* io = ordered_results_[result_pos_idx_].get();
-    size_t ob = 0;
-
-    // Only try to read raw result for RAW
-    if (io->ResultFormat() == InferContext::Result::ResultFormat::RAW) {
-      Error err = io->SetNextRawResult(buf, size, false /* inplace */, &ob);
-      if (!err.IsOk()) {
-        return err;
-      }
-    }
-
-    // If output couldn't accept any more bytes then move to the next.
-    if (ob == 0) {
-      result_pos_idx_++;
-    } else {
-      *result_bytes += ob;
-      size -= ob;
-      buf += ob;
+  // Size the buffer for the entire body up front when the length is
+  // known so that it is not reallocated and copied as it grows.
+  if (response_body_->empty()) {
+    curl_off_t content_length = -1;
+    if ((curl_easy_getinfo(
+             easy_handle_, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T,
+             &content_length) == CURLE_OK) &&
+        (content_length > 0)) {
+      response_body_->reserve(content_length);
     }
   }
 
-  // If there is any bytes left then they belong to the response
-  // header, since all the RAW results have been filled.
-  if (size > 0) {
-    infer_response_buffer_.append(reinterpret_cast<const char*>(buf), size);
-    *result_bytes += size;
-  }
-
-  return Error::Success;
+  response_body_->append(reinterpret_cast<const char*>(buf), size);
 }
 
 Error
@@ -1045,7 +1179,8 @@ HttpRequestImpl::CreateResult(
     return err;
   }
 
-  std::unique_ptr<ResultImpl> result(new ResultImpl(infer_output, batch_size));
+  std::unique_ptr<ResultImpl> result(
+      new HttpResultImpl(response_body_, infer_output, batch_size));
 
   result->SetBatch1Shape(output.raw().dims());
   if (IsFixedSizeDataType(infer_output->DType())) {
@@ -1102,15 +1237,35 @@ HttpRequestImpl::GetResults(InferContext::ResultMap* results)
     return Error(request_status_);
   }
 
+  // The RAW results are at the start of the body, in order. Each
+  // result refers to its part of the body in-place.
+  const uint8_t* buf =
+      reinterpret_cast<const uint8_t*>(response_body_->data());
+  size_t size = response_body_->size();
+  for (auto& r : ordered_results_) {
+    if (r->ResultFormat() == InferContext::Result::ResultFormat::RAW) {
+      size_t result_bytes = 0;
+      Error err =
+          r->SetNextRawResult(buf, size, true /* inplace */, &result_bytes);
+      if (!err.IsOk()) {
+        ordered_results_.clear();
+        return err;
+      }
+
+      buf += result_bytes;
+      size -= result_bytes;
+    }
+  }
+
   // The infer response header should be available...
-  if (infer_response_buffer_.empty()) {
+  if (size == 0) {
     ordered_results_.clear();
     return Error(
         RequestStatusCode::INTERNAL,
         "infer request did not return result header");
   }
 
-  infer_response.ParseFromString(infer_response_buffer_);
+  infer_response.ParseFromArray(buf, size);
 
   results->clear();
   for (auto& r : ordered_results_) {
@@ -1148,6 +1303,7 @@ InferHttpContextImpl::~InferHttpContextImpl()
   // (it is default constructed thread before the first AsyncRun() call)
   if (worker_.joinable()) {
     cv_.notify_all();
+    curl_multi_wakeup(multi_handle_);
     worker_.join();
   }
 
@@ -1198,10 +1354,12 @@ InferHttpContextImpl::Run(ResultMap* results)
   }
 
   std::shared_ptr<Request> lr = std::static_pointer_cast<Request>(sync_request);
+  sync_request->Timer().CaptureTimestamp(RequestTimers::Kind::MARSHAL_START);
   Error err = PreRunProcessing(lr);
   if (!err.IsOk()) {
     return err;
   }
+  sync_request->Timer().CaptureTimestamp(RequestTimers::Kind::MARSHAL_END);
 
   sync_request->Timer().CaptureTimestamp(RequestTimers::Kind::SEND_START);
   if (sync_request->total_input_byte_size_ == 0) {
@@ -1215,7 +1373,9 @@ InferHttpContextImpl::Run(ResultMap* results)
   // RECV_END will be set.
   sync_request->http_status_ = curl_easy_perform(sync_request->easy_handle_);
 
+  sync_request->Timer().CaptureTimestamp(RequestTimers::Kind::UNMARSHAL_START);
   err = sync_request->GetResults(results);
+  sync_request->Timer().CaptureTimestamp(RequestTimers::Kind::UNMARSHAL_END);
 
   sync_request->Timer().CaptureTimestamp(RequestTimers::Kind::REQUEST_END);
 
@@ -1270,7 +1430,10 @@ InferHttpContextImpl::AsyncRun(
 
   current_context->Timer().CaptureTimestamp(RequestTimers::Kind::REQUEST_START);
 
+  current_context->Timer().CaptureTimestamp(
+      RequestTimers::Kind::MARSHAL_START);
   Error err = PreRunProcessing(*async_request);
+  current_context->Timer().CaptureTimestamp(RequestTimers::Kind::MARSHAL_END);
 
   {
     std::lock_guard<std::mutex> lock(mutex_);
@@ -1287,7 +1450,7 @@ InferHttpContextImpl::AsyncRun(
           "Failed to insert new asynchronous request context.");
     }
 
-    curl_multi_add_handle(multi_handle_, current_context->easy_handle_);
+    pending_handles_.push_back(current_context->easy_handle_);
 
     current_context->Timer().CaptureTimestamp(RequestTimers::Kind::SEND_START);
     if (current_context->total_input_byte_size_ == 0) {
@@ -1298,7 +1461,10 @@ InferHttpContextImpl::AsyncRun(
     }
   }
 
+  // The worker is either waiting on 'cv_' because no transfer is in
+  // progress or is polling the transfers in progress.
   cv_.notify_all();
+  curl_multi_wakeup(multi_handle_);
   return Error(RequestStatusCode::SUCCESS);
 }
 
@@ -1318,14 +1484,17 @@ InferHttpContextImpl::GetAsyncRunResults(
   {
     std::lock_guard<std::mutex> lock(mutex_);
     ongoing_async_requests_.erase(http_request->RunIndex());
-    curl_multi_remove_handle(multi_handle_, http_request->easy_handle_);
   }
 
+  http_request->Timer().CaptureTimestamp(RequestTimers::Kind::UNMARSHAL_START);
+  Error request_status = http_request->GetResults(results);
+  http_request->Timer().CaptureTimestamp(RequestTimers::Kind::UNMARSHAL_END);
+
   err = UpdateStat(http_request->Timer());
   if (!err.IsOk()) {
     std::cerr << "Failed to update context stat: " << err << std::endl;
   }
-  return http_request->GetResults(results);
+  return request_status;
 }
 
 size_t
@@ -1354,6 +1523,12 @@ InferHttpContextImpl::ResponseHeaderHandler(
       reinterpret_cast<InferHttpContextImpl*>(pr->first);
   HttpRequestImpl* request = reinterpret_cast<HttpRequestImpl*>(pr->second);
 
+  // The status line is the first byte of the response.
+  if (request->Timer().Timestamp(RequestTimers::Kind::RESPONSE_FIRST_BYTE) ==
+      0) {
+    request->Timer().CaptureTimestamp(RequestTimers::Kind::RESPONSE_FIRST_BYTE);
+  }
+
   char* buf = reinterpret_cast<char*>(contents);
   size_t byte_size = size * nmemb;
   size_t idx;
@@ -1406,18 +1581,13 @@ InferHttpContextImpl::ResponseHandler(
     void* contents, size_t size, size_t nmemb, void* userp)
 {
   HttpRequestImpl* request = reinterpret_cast<HttpRequestImpl*>(userp);
-  size_t result_bytes = 0;
+  const size_t result_bytes = size * nmemb;
 
   if (request->Timer().Timestamp(RequestTimers::Kind::RECV_START) == 0) {
     request->Timer().CaptureTimestamp(RequestTimers::Kind::RECV_START);
   }
 
-  Error err = request->SetNextRawResult(
-      reinterpret_cast<uint8_t*>(contents), size * nmemb, &result_bytes);
-  if (!err.IsOk()) {
-    std::cerr << "ResponseHandler: " << err << std::endl;
-    return 0;
-  }
+  request->AddResponseBody(reinterpret_cast<uint8_t*>(contents), result_bytes);
 
   // ResponseHandler may be called multiple times so we overwrite
   // RECV_END so that we always have the time of the last.
@@ -1526,31 +1696,38 @@ InferHttpContextImpl::PreRunProcessing(std::shared_ptr<Request>& request)
 void
 InferHttpContextImpl::AsyncTransfer()
 {
+  int running_cnt = 0;
   int place_holder = 0;
   CURLMsg* msg = nullptr;
   do {
     std::vector<std::shared_ptr<Request>> request_with_callback;
     bool has_completed = false;
 
-    // sleep if no work is available
+    // Sleep if no transfer is in progress and no new request is
+    // waiting, otherwise add any new requests to the transfers.
     std::unique_lock<std::mutex> lock(mutex_);
-    cv_.wait(lock, [this] {
-      if (this->exiting_) {
-        return true;
-      }
-      // wake up if at least one request is not ready
-      for (auto& ongoing_async_request : this->ongoing_async_requests_) {
-        if (!std::static_pointer_cast<HttpRequestImpl>(
-                 ongoing_async_request.second)
-                 ->IsReady()) {
-          return true;
-        }
-      }
-      return false;
+    cv_.wait(lock, [this, running_cnt] {
+      return (
+          this->exiting_ || (running_cnt > 0) ||
+          !this->pending_handles_.empty());
     });
 
-    curl_multi_perform(multi_handle_, &place_holder);
+    for (CURL* easy_handle : pending_handles_) {
+      curl_multi_add_handle(multi_handle_, easy_handle);
+    }
+    pending_handles_.clear();
+
+    // Progress the transfers without holding the lock so AsyncRun()
+    // and GetAsyncRunResults() aren't blocked by network I/O.
+    lock.unlock();
+    curl_multi_perform(multi_handle_, &running_cnt);
+    lock.lock();
+
     while ((msg = curl_multi_info_read(multi_handle_, &place_holder))) {
+      // The transfer is finished so the handle no longer belongs to
+      // the multi handle.
+      curl_multi_remove_handle(multi_handle_, msg->easy_handle);
+
       // update request status
       uintptr_t identifier = reinterpret_cast<uintptr_t>(msg->easy_handle);
       auto itr = ongoing_async_requests_.find(identifier);
@@ -1560,7 +1737,6 @@ InferHttpContextImpl::AsyncTransfer()
             stderr,
             "Unexpected error: received completed request that"
             " is not in the list of asynchronous requests.\n");
-        curl_multi_remove_handle(multi_handle_, msg->easy_handle);
         curl_easy_cleanup(msg->easy_handle);
         continue;
       }
@@ -1598,6 +1774,13 @@ InferHttpContextImpl::AsyncTransfer()
           static_cast<HttpRequestImpl*>(request.get());
       request_ptr->callback_(this, std::move(request));
     }
+
+    // Wait for activity on the transfers in progress. AsyncRun() and
+    // the destructor interrupt the wait with curl_multi_wakeup().
+    if (running_cnt > 0) {
+      curl_multi_poll(
+          multi_handle_, nullptr, 0, kAsyncPollTimeoutMs, nullptr);
+    }
   } while (!exiting_);
 }
 
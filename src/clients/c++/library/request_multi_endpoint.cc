@@ -0,0 +1,550 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#define DLL_EXPORTING
+
+#include "src/clients/c++/library/request_common.h"
+
+namespace nvidia { namespace inferenceserver { namespace client {
+
+//==============================================================================
+
+// A request made with a MultiEndpointInferContextImpl. The request
+// holds the status and results of the request sent to an endpoint
+// once that request completes.
+class MultiEndpointRequestImpl : public RequestImpl {
+ public:
+  MultiEndpointRequestImpl(
+      const uint64_t id, InferContext::OnCompleteFn callback)
+      : RequestImpl(id, std::move(callback))
+  {
+  }
+
+ private:
+  friend class MultiEndpointInferContextImpl;
+
+  // The index of the endpoint the request was sent to.
+  size_t endpoint_idx_;
+
+  // The status and results of the completed request.
+  Error status_;
+  InferContext::ResultMap results_;
+};
+
+//==============================================================================
+
+class MultiEndpointInferContextImpl : public InferContextImpl {
+ public:
+  MultiEndpointInferContextImpl(
+      std::vector<std::unique_ptr<InferContext>>&& endpoint_ctxs,
+      std::vector<std::unique_ptr<ServerHealthContext>>&& health_ctxs,
+      uint64_t ejection_us);
+  ~MultiEndpointInferContextImpl();
+
+  Error SetRunOptions(const Options& options) override;
+  Error Run(ResultMap* results) override;
+  Error AsyncRun(std::shared_ptr<Request>* async_request) override;
+  Error AsyncRun(OnCompleteFn callback) override;
+  Error GetAsyncRunResults(
+      ResultMap* results, bool* is_ready,
+      const std::shared_ptr<Request>& async_request, bool wait) override;
+
+ private:
+  struct Endpoint {
+    std::unique_ptr<InferContext> ctx_;
+    std::unique_ptr<ServerHealthContext> health_ctx_;
+
+    // The number of requests sent to the endpoint that are not yet
+    // complete.
+    size_t outstanding_cnt_;
+
+    // If ejected, the endpoint receives no requests until
+    // 'ejected_until_' has passed and it is ready again.
+    bool ejected_;
+    std::chrono::steady_clock::time_point ejected_until_;
+
+    // The generation of the options last set on 'ctx_'.
+    uint64_t options_generation_;
+  };
+
+  Error AsyncRun(
+      std::shared_ptr<Request>* async_request, OnCompleteFn callback);
+
+  // Return the index of the endpoint to send the next request to.
+  size_t SelectEndpoint();
+
+  // Set the options and inputs of the next request on 'endpoint'.
+  Error PrepareEndpoint(Endpoint* endpoint);
+
+  // Called when the request sent to an endpoint for 'request' is
+  // complete.
+  void RequestComplete(
+      const std::shared_ptr<MultiEndpointRequestImpl>& request,
+      const Error& status, ResultMap&& results);
+
+  std::vector<Endpoint> endpoints_;
+  const std::chrono::microseconds ejection_;
+
+  // The endpoint to start looking from when selecting an endpoint,
+  // so that endpoints with the same number of outstanding requests
+  // are used in turn.
+  size_t next_endpoint_idx_;
+
+  // The options set by the most recent SetRunOptions() and their
+  // generation, incremented each time the options are set.
+  std::shared_ptr<InferOptionsImpl> options_;
+  uint64_t options_generation_;
+
+  // The number of requests that are not yet complete.
+  size_t pending_cnt_;
+};
+
+//==============================================================================
+
+MultiEndpointInferContextImpl::MultiEndpointInferContextImpl(
+    std::vector<std::unique_ptr<InferContext>>&& endpoint_ctxs,
+    std::vector<std::unique_ptr<ServerHealthContext>>&& health_ctxs,
+    uint64_t ejection_us)
+    : InferContextImpl(
+          endpoint_ctxs.front()->ModelName(),
+          endpoint_ctxs.front()->ModelVersion(), 0, false),
+      ejection_(ejection_us), next_endpoint_idx_(0), options_generation_(0),
+      pending_cnt_(0)
+{
+  const InferContext& base = *endpoint_ctxs.front();
+  max_batch_size_ = base.MaxBatchSize();
+
+  for (const auto& io : base.Inputs()) {
+    std::shared_ptr<Input> input =
+        std::make_shared<InputImpl>(*reinterpret_cast<InputImpl*>(io.get()));
+    input->Reset();
+    inputs_.emplace_back(std::move(input));
+  }
+  for (const auto& io : base.Outputs()) {
+    outputs_.emplace_back(
+        std::make_shared<OutputImpl>(*reinterpret_cast<OutputImpl*>(io.get())));
+  }
+
+  for (size_t i = 0; i < endpoint_ctxs.size(); ++i) {
+    Endpoint endpoint;
+    endpoint.ctx_ = std::move(endpoint_ctxs[i]);
+    if (!health_ctxs.empty()) {
+      endpoint.health_ctx_ = std::move(health_ctxs[i]);
+    }
+    endpoint.outstanding_cnt_ = 0;
+    endpoint.ejected_ = false;
+    endpoint.options_generation_ = 0;
+    endpoints_.emplace_back(std::move(endpoint));
+  }
+}
+
+MultiEndpointInferContextImpl::~MultiEndpointInferContextImpl()
+{
+  // The endpoint contexts reference this context until all of its
+  // requests are complete.
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this] { return pending_cnt_ == 0; });
+}
+
+Error
+MultiEndpointInferContextImpl::SetRunOptions(const Options& boptions)
+{
+  const InferOptionsImpl& options =
+      reinterpret_cast<const InferOptionsImpl&>(boptions);
+
+  // If the model doesn't support batching (i.e. max_batch_size_ == 0)
+  // then still allow batch size of 1 to be specified.
+  uint64_t effective_max_batch_size = std::max((uint64_t)1, max_batch_size_);
+  if (options.BatchSize() > effective_max_batch_size) {
+    return Error(
+        RequestStatusCode::INVALID_ARG,
+        "run batch-size " + std::to_string(options.BatchSize()) +
+            " exceeds maximum batch size " +
+            std::to_string(effective_max_batch_size) + " allowed for model '" +
+            model_name_ + "'");
+  }
+
+  if (options.CorrelationId() != 0) {
+    return Error(
+        RequestStatusCode::UNSUPPORTED,
+        "a correlation ID is not supported for multi-endpoint requests");
+  }
+
+  batch_size_ = std::max((uint64_t)1, options.BatchSize());
+  for (const auto& io : inputs_) {
+    reinterpret_cast<InputImpl*>(io.get())->SetBatchSize(batch_size_);
+  }
+
+  // The options are set on an endpoint's context when a request is
+  // next sent to it.
+  options_ = std::make_shared<InferOptionsImpl>(options);
+  options_generation_++;
+
+  return Error::Success;
+}
+
+Error
+MultiEndpointInferContextImpl::Run(ResultMap* results)
+{
+  std::shared_ptr<Request> request;
+  Error err = AsyncRun(&request, nullptr);
+  if (!err.IsOk()) {
+    return err;
+  }
+
+  bool is_ready;
+  return GetAsyncRunResults(results, &is_ready, request, true /* wait */);
+}
+
+Error
+MultiEndpointInferContextImpl::AsyncRun(
+    std::shared_ptr<Request>* async_request)
+{
+  return AsyncRun(async_request, nullptr);
+}
+
+Error
+MultiEndpointInferContextImpl::AsyncRun(OnCompleteFn callback)
+{
+  std::shared_ptr<Request> request;
+  return AsyncRun(&request, std::move(callback));
+}
+
+Error
+MultiEndpointInferContextImpl::AsyncRun(
+    std::shared_ptr<Request>* async_request, OnCompleteFn callback)
+{
+  if (options_ == nullptr) {
+    return Error(
+        RequestStatusCode::INVALID_ARG,
+        "run options must be set before making a request");
+  }
+
+  const size_t endpoint_idx = SelectEndpoint();
+  Endpoint& endpoint = endpoints_[endpoint_idx];
+
+  Error err = PrepareEndpoint(&endpoint);
+  if (!err.IsOk()) {
+    return err;
+  }
+
+  std::shared_ptr<MultiEndpointRequestImpl> request;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    request = std::make_shared<MultiEndpointRequestImpl>(
+        async_request_id_++, std::move(callback));
+    request->endpoint_idx_ = endpoint_idx;
+    request->SetRunIndex(reinterpret_cast<uintptr_t>(request.get()));
+    ongoing_async_requests_.emplace(request->RunIndex(), request);
+    endpoint.outstanding_cnt_++;
+    pending_cnt_++;
+  }
+
+  request->Timer().CaptureTimestamp(RequestTimers::Kind::REQUEST_START);
+
+  err = endpoint.ctx_->AsyncRun(
+      [this, request](
+          InferContext* ctx,
+          const std::shared_ptr<InferContext::Request>& endpoint_request) {
+        ResultMap results;
+        bool is_ready;
+        Error err = ctx->GetAsyncRunResults(
+            &results, &is_ready, endpoint_request, true /* wait */);
+        RequestComplete(request, err, std::move(results));
+      });
+  if (!err.IsOk()) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ongoing_async_requests_.erase(request->RunIndex());
+    endpoint.outstanding_cnt_--;
+    pending_cnt_--;
+    return err;
+  }
+
+  *async_request = request;
+  return Error::Success;
+}
+
+Error
+MultiEndpointInferContextImpl::GetAsyncRunResults(
+    ResultMap* results, bool* is_ready,
+    const std::shared_ptr<Request>& async_request, bool wait)
+{
+  Error err = IsRequestReady(async_request, is_ready, wait);
+  if (!err.IsOk() || !(*is_ready)) {
+    return err;
+  }
+
+  std::shared_ptr<MultiEndpointRequestImpl> request =
+      std::static_pointer_cast<MultiEndpointRequestImpl>(async_request);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ongoing_async_requests_.erase(request->RunIndex());
+  }
+
+  *results = std::move(request->results_);
+  return request->status_;
+}
+
+size_t
+MultiEndpointInferContextImpl::SelectEndpoint()
+{
+  const auto now = std::chrono::steady_clock::now();
+
+  // An ejected endpoint whose ejection interval has passed is used
+  // again if it is ready. Only the calling thread changes
+  // 'health_ctx_' so the check is made without holding the lock.
+  for (auto& endpoint : endpoints_) {
+    bool readmit = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!endpoint.ejected_ || (now < endpoint.ejected_until_)) {
+        continue;
+      }
+      readmit = (endpoint.health_ctx_ == nullptr);
+    }
+
+    if (!readmit) {
+      bool ready = false;
+      Error err = endpoint.health_ctx_->GetReady(&ready);
+      readmit = err.IsOk() && ready;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (readmit) {
+      endpoint.ejected_ = false;
+    } else {
+      endpoint.ejected_until_ = now + ejection_;
+    }
+  }
+
+  // Use the endpoint with the fewest outstanding requests, ignoring
+  // ejected endpoints unless all endpoints are ejected.
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t selected = endpoints_.size();
+  for (size_t i = 0; i < endpoints_.size(); ++i) {
+    const size_t idx = (next_endpoint_idx_ + i) % endpoints_.size();
+    const Endpoint& endpoint = endpoints_[idx];
+    if (endpoint.ejected_) {
+      continue;
+    }
+    if ((selected == endpoints_.size()) ||
+        (endpoint.outstanding_cnt_ < endpoints_[selected].outstanding_cnt_)) {
+      selected = idx;
+    }
+  }
+
+  if (selected == endpoints_.size()) {
+    selected = next_endpoint_idx_;
+    for (size_t i = 0; i < endpoints_.size(); ++i) {
+      const size_t idx = (next_endpoint_idx_ + i) % endpoints_.size();
+      if (endpoints_[idx].outstanding_cnt_ <
+          endpoints_[selected].outstanding_cnt_) {
+        selected = idx;
+      }
+    }
+  }
+
+  next_endpoint_idx_ = (selected + 1) % endpoints_.size();
+  return selected;
+}
+
+Error
+MultiEndpointInferContextImpl::PrepareEndpoint(Endpoint* endpoint)
+{
+  InferContext* ctx = endpoint->ctx_.get();
+
+  // Translate the options to the outputs of the endpoint's context.
+  if (endpoint->options_generation_ != options_generation_) {
+    InferOptionsImpl options;
+    options.SetFlags(options_->Flags());
+    options.SetBatchSize(options_->BatchSize());
+    options.SetPriority(options_->Priority());
+    options.SetTimeoutMicroseconds(options_->TimeoutMicroseconds());
+    options.SetMaxQueueDelayMicroseconds(
+        options_->MaxQueueDelayMicroseconds());
+
+    for (const auto& p : options_->Outputs()) {
+      const InferOptionsImpl::OutputOptions& ooptions = p.second;
+      std::shared_ptr<Output> output;
+      Error err = ctx->GetOutput(p.first->Name(), &output);
+      if (!err.IsOk()) {
+        return err;
+      }
+
+      if (!ooptions.shm_name.empty()) {
+        err = options.AddSharedMemoryResult(
+            output, ooptions.shm_name, ooptions.shm_offset,
+            ooptions.shm_byte_size);
+      } else if (ooptions.result_format == Result::ResultFormat::CLASS) {
+        err = options.AddClassResult(output, ooptions.u64);
+      } else {
+        err = options.AddRawResult(output);
+      }
+      if (!err.IsOk()) {
+        return err;
+      }
+    }
+
+    Error err = ctx->SetRunOptions(options);
+    if (!err.IsOk()) {
+      return err;
+    }
+    endpoint->options_generation_ = options_generation_;
+  }
+
+  // Set each input of the endpoint's context to reference the values
+  // of the corresponding input.
+  for (const auto& io : inputs_) {
+    InputImpl* input = reinterpret_cast<InputImpl*>(io.get());
+    Error err = input->PrepareForRequest();
+    if (!err.IsOk()) {
+      return err;
+    }
+
+    std::shared_ptr<Input> endpoint_input;
+    err = ctx->GetInput(input->Name(), &endpoint_input);
+    if (err.IsOk()) {
+      err = endpoint_input->Reset();
+    }
+    if (err.IsOk() && !input->Shape().empty()) {
+      err = endpoint_input->SetShape(input->Shape());
+    }
+
+    if (input->IsSharedMemory()) {
+      if (err.IsOk()) {
+        err = endpoint_input->SetSharedMemory(
+            input->GetSharedMemoryName(), input->GetSharedMemoryOffset(),
+            input->TotalByteSize());
+      }
+    } else {
+      for (size_t b = 0; err.IsOk() && (b < batch_size_); ++b) {
+        const uint8_t* buf;
+        size_t byte_size;
+        err = input->GetRaw(b, &buf, &byte_size);
+        if (err.IsOk()) {
+          err = endpoint_input->SetRaw(buf, byte_size);
+        }
+      }
+    }
+
+    if (!err.IsOk()) {
+      return err;
+    }
+  }
+
+  return Error::Success;
+}
+
+void
+MultiEndpointInferContextImpl::RequestComplete(
+    const std::shared_ptr<MultiEndpointRequestImpl>& request,
+    const Error& status, ResultMap&& results)
+{
+  request->Timer().CaptureTimestamp(RequestTimers::Kind::REQUEST_END);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Endpoint& endpoint = endpoints_[request->endpoint_idx_];
+    endpoint.outstanding_cnt_--;
+
+    // Eject the endpoint if the request failed because the server
+    // could not be reached or could not handle the request.
+    if ((status.Code() == RequestStatusCode::INTERNAL) ||
+        (status.Code() == RequestStatusCode::UNAVAILABLE)) {
+      endpoint.ejected_ = true;
+      endpoint.ejected_until_ = std::chrono::steady_clock::now() + ejection_;
+    }
+
+    request->status_ = status;
+    request->results_ = std::move(results);
+    request->SetIsReady(true);
+
+    context_stat_.completed_request_count++;
+    context_stat_.cumulative_total_request_time_ns +=
+        request->Timer().Duration(
+            RequestTimers::Kind::REQUEST_START,
+            RequestTimers::Kind::REQUEST_END);
+  }
+  cv_.notify_all();
+
+  if (request->HasCallback()) {
+    request->callback_(this, request);
+  }
+
+  // Only now can the context be destroyed, so notify while holding
+  // the lock to keep 'cv_' valid until the notification is done.
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_cnt_--;
+  cv_.notify_all();
+}
+
+//==============================================================================
+
+Error
+InferMultiEndpointContext::Create(
+    std::unique_ptr<InferContext>* ctx,
+    std::vector<std::unique_ptr<InferContext>>&& endpoint_ctxs,
+    std::vector<std::unique_ptr<ServerHealthContext>>&& health_ctxs,
+    uint64_t ejection_us)
+{
+  if (endpoint_ctxs.empty()) {
+    return Error(
+        RequestStatusCode::INVALID_ARG,
+        "at least one endpoint context must be provided");
+  }
+
+  if (!health_ctxs.empty() && (health_ctxs.size() != endpoint_ctxs.size())) {
+    return Error(
+        RequestStatusCode::INVALID_ARG,
+        "expected " + std::to_string(endpoint_ctxs.size()) +
+            " health contexts, got " + std::to_string(health_ctxs.size()));
+  }
+
+  const InferContext& base = *endpoint_ctxs.front();
+  for (const auto& endpoint_ctx : endpoint_ctxs) {
+    if (endpoint_ctx->CorrelationId() != 0) {
+      return Error(
+          RequestStatusCode::INVALID_ARG,
+          "a context with a correlation ID can't be used as an endpoint");
+    }
+
+    if ((endpoint_ctx->ModelName() != base.ModelName()) ||
+        (endpoint_ctx->MaxBatchSize() != base.MaxBatchSize())) {
+      return Error(
+          RequestStatusCode::INVALID_ARG,
+          "all endpoint contexts must be for the same model, expected '" +
+              base.ModelName() + "' with maximum batch size " +
+              std::to_string(base.MaxBatchSize()));
+    }
+  }
+
+  ctx->reset(new MultiEndpointInferContextImpl(
+      std::move(endpoint_ctxs), std::move(health_ctxs), ejection_us));
+  return Error::Success;
+}
+
+}}}  // namespace nvidia::inferenceserver::client
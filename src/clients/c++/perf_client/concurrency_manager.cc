@@ -26,7 +26,7 @@
 
 #include "src/clients/c++/perf_client/concurrency_manager.h"
 
-#include "src/core/model_config.h"
+#include <algorithm>
 
 namespace perfclient {
 
@@ -35,6 +35,10 @@ ConcurrencyManager::~ConcurrencyManager()
   early_exit = true;
   // wake up all threads
   wake_signal_.notify_all();
+  {
+    std::lock_guard<std::mutex> lk(sequence_mutex_);
+    sequence_cv_.notify_all();
+  }
 
   size_t cnt = 0;
   for (auto& thread : threads_) {
@@ -50,82 +54,28 @@ ConcurrencyManager::~ConcurrencyManager()
 nic::Error
 ConcurrencyManager::Create(
     const int32_t batch_size, const size_t max_threads,
-    const size_t sequence_length, const bool zero_input,
+    const size_t sequence_length, const size_t num_of_sequences,
+    const bool zero_input,
     const std::unordered_map<std::string, std::vector<int64_t>>& input_shapes,
     const std::string& data_directory,
+    const SharedMemoryType shared_memory_type, const size_t output_shm_size,
     const std::shared_ptr<ContextFactory>& factory,
     std::unique_ptr<LoadManager>* manager)
 {
   std::unique_ptr<ConcurrencyManager> local_manager(new ConcurrencyManager(
-      input_shapes, batch_size, max_threads, sequence_length, factory));
-
-  std::unique_ptr<nic::InferContext> ctx;
-  RETURN_IF_ERROR(local_manager->factory_->CreateInferContext(&ctx));
-
-  size_t max_input_byte_size = 0;
-  for (const auto& input : ctx->Inputs()) {
-    // Validate user provided shape
-    if (!input_shapes.empty()) {
-      auto it = input_shapes.find(input->Name());
-      if (it != input_shapes.end()) {
-        const auto& dims = it->second;
-        const auto& config_dims = input->Dims();
-        if (!ni::CompareDimsWithWildcard(config_dims, dims)) {
-          return nic::Error(
-              ni::RequestStatusCode::INVALID_ARG,
-              "input '" + input->Name() + "' expects shape " +
-                  ni::DimsListToString(config_dims) +
-                  " and user supplied shape " + ni::DimsListToString(dims));
-        }
-      }
-    }
-
-    // For variable shape, set the shape if specified
-    if (input->Shape().empty()) {
-      auto it = input_shapes.find(input->Name());
-      if (it != input_shapes.end()) {
-        input->SetShape(it->second);
-      }
-    }
-    const int64_t bs = input->ByteSize();
-    if (bs < 0) {
-      std::string error_detail;
-      if (input->Shape().empty()) {
-        error_detail =
-            "has variable-size shape and the shape to be used is not specified";
-      } else {
-        error_detail = "has STRING data type";
-      }
-      return nic::Error(
-          ni::RequestStatusCode::INVALID_ARG,
-          "input '" + input->Name() + "' " + error_detail +
-              ", unable to create input values for "
-              "model '" +
-              ctx->ModelName() + "'");
-    }
-
-    max_input_byte_size =
-        std::max(max_input_byte_size, (size_t)input->ByteSize());
-
-    // Read provided data
-    if (!data_directory.empty()) {
-      const auto file_path = data_directory + "/" + input->Name();
-      auto it =
-          local_manager->input_data_.emplace(input->Name(), std::vector<char>())
-              .first;
-      RETURN_IF_ERROR(ReadFile(file_path, &it->second));
-    }
-  }
-
-  // Create a zero or randomly (as indicated by zero_input_)
-  // initialized buffer that is large enough to provide the largest
-  // needed input. We (re)use this buffer for all input values.
-  if (zero_input) {
-    local_manager->input_buf_.resize(max_input_byte_size, 0);
-  } else {
-    local_manager->input_buf_.resize(max_input_byte_size);
-    for (auto& byte : local_manager->input_buf_) {
-      byte = rand();
+      input_shapes, batch_size, max_threads, sequence_length,
+      num_of_sequences, factory));
+
+  RETURN_IF_ERROR(local_manager->InitManager(
+      zero_input, data_directory, shared_memory_type, output_shm_size));
+
+  // All sequences of the pool are live from the start
+  if (local_manager->num_of_sequences_ != 0) {
+    std::lock_guard<std::mutex> lk(local_manager->sequence_mutex_);
+    local_manager->sequences_.resize(local_manager->num_of_sequences_);
+    for (size_t idx = 0; idx < local_manager->sequences_.size(); idx++) {
+      local_manager->NewSequence(&local_manager->sequences_[idx]);
+      local_manager->new_sequences_.push_back(idx);
     }
   }
 
@@ -136,14 +86,13 @@ ConcurrencyManager::Create(
 ConcurrencyManager::ConcurrencyManager(
     const std::unordered_map<std::string, std::vector<int64_t>>& input_shapes,
     const int32_t batch_size, const size_t max_threads,
-    const size_t sequence_length,
+    const size_t sequence_length, const size_t num_of_sequences,
     const std::shared_ptr<ContextFactory>& factory)
-    : batch_size_(batch_size), max_threads_(max_threads),
-      sequence_length_(sequence_length), factory_(factory),
-      input_shapes_(input_shapes)
+    : LoadManager(
+          batch_size, max_threads, sequence_length, input_shapes, factory),
+      num_of_sequences_(on_sequence_model_ ? num_of_sequences : 0),
+      starting_sequence_cnt_(0), max_starting_sequences_(0)
 {
-  request_timestamps_.reset(new TimestampVector());
-  on_sequence_model_ = (factory_->SchedulerType() == ContextFactory::SEQUENCE);
 }
 
 nic::Error
@@ -158,6 +107,7 @@ ConcurrencyManager::ChangeConcurrencyLevel(
         new nic::Error(ni::RequestStatusCode::SUCCESS));
     threads_contexts_stat_.emplace_back(
         new std::vector<nic::InferContext::Stat>());
+    threads_latencies_.emplace_back(new RequestLatencies());
     threads_concurrency_.emplace_back(new size_t(0));
 
     // Worker maintains concurrency in different ways.
@@ -167,8 +117,15 @@ ConcurrencyManager::ChangeConcurrencyLevel(
     // at the same time. Thus it uses one single context as every infer context
     // creates a worker thread implicitly.
     threads_.emplace_back(
-        &ConcurrencyManager::AsyncInfer, this, threads_status_.back(),
-        threads_contexts_stat_.back(), threads_concurrency_.back());
+        (num_of_sequences_ != 0) ? &ConcurrencyManager::AsyncSequenceInfer
+                                 : &ConcurrencyManager::AsyncInfer,
+        this, threads_status_.back(), threads_contexts_stat_.back(),
+        threads_latencies_.back(), threads_concurrency_.back());
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(sequence_mutex_);
+    max_starting_sequences_ = concurrent_request_count / 2;
   }
 
   // Compute the new concurrency level for each thread (take floor)
@@ -187,134 +144,6 @@ ConcurrencyManager::ChangeConcurrencyLevel(
   return nic::Error::Success;
 }
 
-nic::Error
-ConcurrencyManager::CheckHealth()
-{
-  // Check thread status to make sure that the actual concurrency level is
-  // consistent to the one being reported
-  // If some thread return early, main thread will return and
-  // the worker thread's error message will be reported
-  // when ConcurrencyManager's destructor get called.
-  for (auto& thread_status : threads_status_) {
-    if (!thread_status->IsOk()) {
-      return nic::Error(
-          ni::RequestStatusCode::INTERNAL,
-          "Failed to maintain concurrency level requested."
-          " Worker thread(s) failed to generate concurrent requests.");
-    }
-  }
-  return nic::Error::Success;
-}
-
-nic::Error
-ConcurrencyManager::SwapTimestamps(TimestampVector& new_timestamps)
-{
-  // Get the requests in the shared vector
-  std::lock_guard<std::mutex> lock(status_report_mutex_);
-  request_timestamps_->swap(new_timestamps);
-  return nic::Error::Success;
-}
-
-nic::Error
-ConcurrencyManager::PrepareInfer(
-    std::unique_ptr<nic::InferContext>* ctx,
-    std::unique_ptr<nic::InferContext::Options>* options)
-{
-  RETURN_IF_ERROR(factory_->CreateInferContext(ctx));
-
-  uint64_t max_batch_size = (*ctx)->MaxBatchSize();
-
-  // Model specifying maximum batch size of 0 indicates that batching
-  // is not supported and so the input tensors do not expect a "N"
-  // dimension (and 'batch_size' should be 1 so that only a single
-  // image instance is inferred at a time).
-  if (max_batch_size == 0) {
-    if (batch_size_ != 1) {
-      return nic::Error(
-          ni::RequestStatusCode::INVALID_ARG,
-          "expecting batch size 1 for model '" + (*ctx)->ModelName() +
-              "' which does not support batching");
-    }
-  } else if (batch_size_ > max_batch_size) {
-    return nic::Error(
-        ni::RequestStatusCode::INVALID_ARG,
-        "expecting batch size <= " + std::to_string(max_batch_size) +
-            " for model '" + (*ctx)->ModelName() + "'");
-  }
-
-  // Prepare context for 'batch_size' batches. Request that all
-  // outputs be returned.
-  // Only set options if it has not been created, otherwise,
-  // assuming that the options for this model has been created previously
-  if (*options == nullptr) {
-    RETURN_IF_ERROR(nic::InferContext::Options::Create(options));
-
-    (*options)->SetBatchSize(batch_size_);
-    for (const auto& output : (*ctx)->Outputs()) {
-      (*options)->AddRawResult(output);
-    }
-  }
-
-  RETURN_IF_ERROR((*ctx)->SetRunOptions(*(*options)));
-
-  // Set the provided shape for variable shape tensor
-  for (const auto& input : (*ctx)->Inputs()) {
-    if (input->Shape().empty()) {
-      auto it = input_shapes_.find(input->Name());
-      if (it != input_shapes_.end()) {
-        input->SetShape(it->second);
-      }
-    }
-  }
-
-  // Initialize inputs
-  for (const auto& input : (*ctx)->Inputs()) {
-    RETURN_IF_ERROR(input->Reset());
-
-    size_t batch1_size = (size_t)input->ByteSize();
-    const uint8_t* data = &input_buf_[0];
-    // if available, use provided data instead
-    auto it = input_data_.find(input->Name());
-    if (it != input_data_.end()) {
-      if (batch1_size != it->second.size()) {
-        return nic::Error(
-            ni::RequestStatusCode::INVALID_ARG,
-            "input '" + input->Name() + "' requires " +
-                std::to_string(batch1_size) +
-                " bytes for each batch, but provided data has " +
-                std::to_string(it->second.size()) + " bytes");
-      }
-      data = (const uint8_t*)&(it->second)[0];
-    }
-
-    for (size_t i = 0; i < batch_size_; ++i) {
-      RETURN_IF_ERROR(input->SetRaw(data, batch1_size));
-    }
-  }
-
-  return nic::Error::Success;
-}
-
-nic::Error
-ConcurrencyManager::GetAccumulatedContextStat(
-    nic::InferContext::Stat* contexts_stat)
-{
-  std::lock_guard<std::mutex> lk(status_report_mutex_);
-  for (auto& thread_contexts_stat : threads_contexts_stat_) {
-    for (auto& context_stat : (*thread_contexts_stat)) {
-      contexts_stat->completed_request_count +=
-          context_stat.completed_request_count;
-      contexts_stat->cumulative_total_request_time_ns +=
-          context_stat.cumulative_total_request_time_ns;
-      contexts_stat->cumulative_send_time_ns +=
-          context_stat.cumulative_send_time_ns;
-      contexts_stat->cumulative_receive_time_ns +=
-          context_stat.cumulative_receive_time_ns;
-    }
-  }
-  return nic::Error::Success;
-}
-
 // Function for worker threads.
 // If the model is non-sequence model, each worker uses only one context
 // to maintain concurrency assigned to worker.
@@ -324,6 +153,7 @@ void
 ConcurrencyManager::AsyncInfer(
     std::shared_ptr<nic::Error> err,
     std::shared_ptr<std::vector<nic::InferContext::Stat>> stats,
+    std::shared_ptr<RequestLatencies> latencies,
     std::shared_ptr<size_t> concurrency)
 {
   std::vector<std::unique_ptr<InferContextMetaData>> ctxs;
@@ -393,14 +223,32 @@ ConcurrencyManager::AsyncInfer(
         }
         struct timespec start_time;
         clock_gettime(CLOCK_MONOTONIC, &start_time);
+        const uint64_t start_ns = TIMESPEC_TO_NANOS(start_time);
+        // The request should have been sent as soon as a slot became free,
+        // any time in between is spent by the worker falling behind. A new
+        // sequence can only start once the previous one has completed.
+        uint64_t intended_start_ns = start_ns;
+        auto& free_slot_ns = ctxs[idx]->free_slot_ns_;
+        if (!free_slot_ns.empty()) {
+          intended_start_ns = std::min(
+              on_sequence_model_ ? free_slot_ns.back() : free_slot_ns.front(),
+              start_ns);
+          if (!on_sequence_model_) {
+            free_slot_ns.pop_front();
+          }
+        }
         *err = ctxs[idx]->ctx_->AsyncRun(
-            [&notified, &cb_mtx, &cb_cv, &ctxs, start_time, flags, idx](
+            [&notified, &cb_mtx, &cb_cv, &ctxs, intended_start_ns, start_ns,
+             flags, idx](
                 nic::InferContext* ctx,
                 std::shared_ptr<nic::InferContext::Request> request) {
+              struct timespec end_time;
+              clock_gettime(CLOCK_MONOTONIC, &end_time);
               {
                 std::lock_guard<std::mutex> lk(ctxs[idx]->mtx_);
                 ctxs[idx]->completed_requests_.emplace_back(
-                    std::move(request), start_time, flags);
+                    std::move(request), intended_start_ns, start_ns,
+                    TIMESPEC_TO_NANOS(end_time), flags, 0);
               }
 
               // avoid competition over 'cb_mtx'
@@ -417,10 +265,12 @@ ConcurrencyManager::AsyncInfer(
           return;
         }
       }
+      // The slots that are not reused belong to a lower concurrency level
+      ctxs[idx]->free_slot_ns_.clear();
     }
 
     // wait for signal from callback that there is completed request,
-    // and then record the end time of the request
+    // and then record the request
     {
       std::unique_lock<std::mutex> lk(cb_mtx);
       cb_cv.wait(lk, [&notified] {
@@ -453,19 +303,36 @@ ConcurrencyManager::AsyncInfer(
                 "AsyncRun callback is invoked but request is not ready");
           }
 
-          struct timespec end_time;
-          clock_gettime(CLOCK_MONOTONIC, &end_time);
-          struct timespec start_time = request.start_time_;
-          uint32_t flags = request.flags_;
-
           ctxs[idx]->inflight_request_cnt_--;
+          ctxs[idx]->free_slot_ns_.push_back(request.end_ns_);
+
+          // The sequence of a context is done once all its requests have
+          // completed
+          uint64_t sequence_step_latency_ns = 0;
+          if (on_sequence_model_) {
+            ctxs[idx]->sequence_latency_ns_ +=
+                request.end_ns_ - request.start_ns_;
+            ctxs[idx]->sequence_step_cnt_++;
+            if (ctxs[idx]->inflight_request_cnt_ == 0) {
+              sequence_step_latency_ns = ctxs[idx]->sequence_latency_ns_ /
+                                         ctxs[idx]->sequence_step_cnt_;
+              ctxs[idx]->sequence_latency_ns_ = 0;
+              ctxs[idx]->sequence_step_cnt_ = 0;
+            }
+          }
 
           {
-            // Add the request timestamp to shared vector with proper locking
+            // Record the request latency with proper locking
             std::lock_guard<std::mutex> lk(status_report_mutex_);
-            request_timestamps_->emplace_back(
-                std::make_tuple(start_time, end_time, flags));
-            ctxs[idx]->ctx_->GetStat(&((*stats)[idx]));
+            latencies->Record(
+                request.intended_start_ns_, request.start_ns_, request.end_ns_,
+                request.flags_ & ni::InferRequestHeader::FLAG_SEQUENCE_END);
+            if (sequence_step_latency_ns != 0) {
+              latencies->sequence_step_latencies_.Record(
+                  sequence_step_latency_ns);
+            }
+            latencies->RecordClientStages(
+                *ctxs[idx]->ctx_, &((*stats)[idx]));
           }
         }
       }
@@ -494,6 +361,225 @@ ConcurrencyManager::AsyncInfer(
   } while (true);
 }
 
+// Function for worker threads when the number of sequences is set. Each
+// worker uses one context to keep its share of the concurrency in flight,
+// every request is the next request of a sequence that has no request in
+// flight, so the requests of a sequence are sent in order.
+void
+ConcurrencyManager::AsyncSequenceInfer(
+    std::shared_ptr<nic::Error> err,
+    std::shared_ptr<std::vector<nic::InferContext::Stat>> stats,
+    std::shared_ptr<RequestLatencies> latencies,
+    std::shared_ptr<size_t> concurrency)
+{
+  std::unique_ptr<InferContextMetaData> ctx(new InferContextMetaData());
+  std::unique_ptr<nic::InferContext::Options> options(nullptr);
+  std::map<std::string, std::unique_ptr<nic::InferContext::Result>> results;
+  stats->emplace_back();
+  *err = PrepareInfer(&(ctx->ctx_), &options);
+  if (!err->IsOk()) {
+    return;
+  }
+
+  // Variable used to signal request completion
+  bool notified = false;
+  std::mutex cb_mtx;
+  std::condition_variable cb_cv;
+
+  do {
+    // Only interact with synchronous mechanism if the worker should wait
+    if (*concurrency == 0) {
+      // Wait if no request should be sent and it is not exiting
+      std::unique_lock<std::mutex> lock(wake_mutex_);
+      wake_signal_.wait(
+          lock, [concurrency]() { return early_exit || (*concurrency > 0); });
+    }
+
+    while (!early_exit && (ctx->inflight_request_cnt_ < *concurrency)) {
+      size_t sequence_idx;
+      uint32_t flags = 0;
+      ni::CorrelationID correlation_id;
+      {
+        std::unique_lock<std::mutex> lk(sequence_mutex_);
+        if (ready_sequences_.empty() && new_sequences_.empty()) {
+          // A completed request of the worker makes a sequence ready, if
+          // the worker has none in flight wait for the other workers
+          if (ctx->inflight_request_cnt_ != 0) {
+            break;
+          }
+          sequence_cv_.wait(lk, [this]() {
+            return early_exit || !ready_sequences_.empty() ||
+                   !new_sequences_.empty();
+          });
+          if (early_exit) {
+            break;
+          }
+        }
+
+        // The first request of a sequence may wait in the backlog of the
+        // server until a sequence slot is free, so at most half of the
+        // concurrency starts sequences while started sequences are ready.
+        // The rest keeps the sequences in the slots going until they end
+        // and free their slots.
+        auto& sequence_queue =
+            (!new_sequences_.empty() &&
+             ((starting_sequence_cnt_ < max_starting_sequences_) ||
+              ready_sequences_.empty()))
+                ? new_sequences_
+                : ready_sequences_;
+        sequence_idx = sequence_queue.front();
+        sequence_queue.pop_front();
+
+        auto& sequence = sequences_[sequence_idx];
+        if (sequence.start_) {
+          flags |= ni::InferRequestHeader::FLAG_SEQUENCE_START;
+          sequence.start_ = false;
+          starting_sequence_cnt_++;
+        }
+        if (sequence.remaining_steps_ == 1) {
+          flags |= ni::InferRequestHeader::FLAG_SEQUENCE_END;
+        }
+        sequence.remaining_steps_--;
+        correlation_id = sequence.correlation_id_;
+      }
+
+      options->SetFlags(flags);
+      options->SetCorrelationId(correlation_id);
+      *err = ctx->ctx_->SetRunOptions(*options);
+      if (!err->IsOk()) {
+        return;
+      }
+
+      struct timespec start_time;
+      clock_gettime(CLOCK_MONOTONIC, &start_time);
+      const uint64_t start_ns = TIMESPEC_TO_NANOS(start_time);
+      // The request should have been sent as soon as a slot became free
+      uint64_t intended_start_ns = start_ns;
+      if (!ctx->free_slot_ns_.empty()) {
+        intended_start_ns = std::min(ctx->free_slot_ns_.front(), start_ns);
+        ctx->free_slot_ns_.pop_front();
+      }
+      *err = ctx->ctx_->AsyncRun(
+          [&notified, &cb_mtx, &cb_cv, &ctx, intended_start_ns, start_ns,
+           flags, sequence_idx](
+              nic::InferContext* infer_ctx,
+              std::shared_ptr<nic::InferContext::Request> request) {
+            struct timespec end_time;
+            clock_gettime(CLOCK_MONOTONIC, &end_time);
+            {
+              std::lock_guard<std::mutex> lk(ctx->mtx_);
+              ctx->completed_requests_.emplace_back(
+                  std::move(request), intended_start_ns, start_ns,
+                  TIMESPEC_TO_NANOS(end_time), flags, sequence_idx);
+            }
+
+            // avoid competition over 'cb_mtx'
+            if (!notified) {
+              {
+                std::lock_guard<std::mutex> lk(cb_mtx);
+                notified = true;
+              }
+              cb_cv.notify_all();
+            }
+          });
+      if (!err->IsOk()) {
+        return;
+      }
+      ctx->inflight_request_cnt_++;
+    }
+    // The slots that are not reused belong to a lower concurrency level
+    ctx->free_slot_ns_.clear();
+
+    // wait for signal from callback that there is completed request,
+    // and then record the request
+    if (ctx->inflight_request_cnt_ > 0) {
+      std::unique_lock<std::mutex> lk(cb_mtx);
+      cb_cv.wait(lk, [&notified] {
+        if (notified) {
+          notified = false;
+          return true;
+        }
+        return false;
+      });
+    }
+
+    std::vector<RequestMetaData> swap_vector;
+    {
+      std::lock_guard<std::mutex> lk(ctx->mtx_);
+      swap_vector.swap(ctx->completed_requests_);
+    }
+    for (const auto& request : swap_vector) {
+      bool is_ready = false;
+      *err = ctx->ctx_->GetAsyncRunResults(
+          &results, &is_ready, request.request_, true);
+      if (!err->IsOk()) {
+        return;
+      }
+      ctx->inflight_request_cnt_--;
+      ctx->free_slot_ns_.push_back(request.end_ns_);
+
+      // The sequence is ready for its next request, or is replaced by a new
+      // sequence once it ends
+      uint64_t sequence_step_latency_ns = 0;
+      {
+        std::lock_guard<std::mutex> lk(sequence_mutex_);
+        auto& sequence = sequences_[request.sequence_idx_];
+        sequence.latency_ns_ += request.end_ns_ - request.start_ns_;
+        sequence.completed_steps_++;
+        if (request.flags_ & ni::InferRequestHeader::FLAG_SEQUENCE_START) {
+          starting_sequence_cnt_--;
+        }
+        if (request.flags_ & ni::InferRequestHeader::FLAG_SEQUENCE_END) {
+          sequence_step_latency_ns =
+              sequence.latency_ns_ / sequence.completed_steps_;
+          NewSequence(&sequence);
+          new_sequences_.push_back(request.sequence_idx_);
+        } else {
+          ready_sequences_.push_back(request.sequence_idx_);
+        }
+      }
+      sequence_cv_.notify_one();
+
+      {
+        // Record the request latency with proper locking
+        std::lock_guard<std::mutex> lk(status_report_mutex_);
+        latencies->Record(
+            request.intended_start_ns_, request.start_ns_, request.end_ns_,
+            request.flags_ & ni::InferRequestHeader::FLAG_SEQUENCE_END);
+        if (sequence_step_latency_ns != 0) {
+          latencies->sequence_step_latencies_.Record(sequence_step_latency_ns);
+        }
+        latencies->RecordClientStages(*ctx->ctx_, &((*stats)[0]));
+      }
+    }
+
+    // Stop inferencing and wait for all callbacks are invoked
+    // if an early exit has been signaled, in case of referencing on
+    // released resources in the callback function.
+    if (early_exit) {
+      while (ctx->inflight_request_cnt_ != 0) {
+        std::unique_lock<std::mutex> lk(ctx->mtx_);
+        cb_cv.wait_for(lk, std::chrono::milliseconds(500), [&ctx] {
+          ctx->inflight_request_cnt_ -= ctx->completed_requests_.size();
+          ctx->completed_requests_.clear();
+          return (ctx->inflight_request_cnt_ == 0);
+        });
+      }
+      break;
+    }
+  } while (true);
+}
+
+void
+ConcurrencyManager::NewSequence(SequenceState* sequence)
+{
+  sequence->correlation_id_ = factory_->NewCorrelationId();
+  sequence->start_ = true;
+  sequence->remaining_steps_ = GetRandomLength(0.2);
+  sequence->latency_ns_ = 0;
+  sequence->completed_steps_ = 0;
+}
+
 size_t
 ConcurrencyManager::GetRandomLength(double offset_ratio)
 {
@@ -25,13 +25,9 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
-#include "src/clients/c++/perf_client/context_factory.h"
 #include "src/clients/c++/perf_client/load_manager.h"
-#include "src/clients/c++/perf_client/perf_utils.h"
-
-#include <condition_variable>
-#include <thread>
 
+#include <deque>
 
 namespace perfclient {
 //==============================================================================
@@ -49,6 +45,14 @@ namespace perfclient {
 /// server. The worker threads will record the start time and end
 /// time of each request into a shared vector.
 ///
+/// For a sequence model, each concurrent request is by default a sequence
+/// of its own context, so the number of live sequences equals the
+/// concurrency. If the number of sequences is set, the manager instead
+/// keeps that many sequences live and the concurrency only limits the
+/// requests in flight: each worker thread sends the next request of a
+/// sequence that has no request in flight, using one context and the
+/// correlation ID of the sequence in the request options.
+///
 class ConcurrencyManager : public LoadManager {
  public:
   ~ConcurrencyManager();
@@ -58,15 +62,27 @@ class ConcurrencyManager : public LoadManager {
   /// \param batch_size The batch size used for each request.
   /// \param max_threads The maximum number of working threads to be spawned.
   /// \param sequence_length The base length of each sequence.
+  /// \param num_of_sequences The number of live sequences shared by all
+  /// concurrent requests, or 0 for one sequence per concurrent request.
+  /// Ignored if the model is not a sequence model.
   /// \param zero_input Whether to fill the input tensors with zero.
+  /// \param input_shapes The shapes of the inputs with variable-size shape.
+  /// \param data_directory The directory containing the user provided data
+  /// for each input, or empty to use synthetic data.
+  /// \param shared_memory_type The type of shared memory used to pass the
+  /// tensors, or NO_SHARED_MEMORY to pass them in the requests and responses.
+  /// \param output_shm_size The size of the shared memory region of an
+  /// output whose size can't be derived from the model configuration.
   /// \param factory The ContextFactory object used to create InferContext.
   /// \param manger Returns a new ConcurrencyManager object.
   /// \return Error object indicating success or failure.
   static nic::Error Create(
       const int32_t batch_size, const size_t max_threads,
-      const size_t sequence_length, const bool zero_input,
+      const size_t sequence_length, const size_t num_of_sequences,
+      const bool zero_input,
       const std::unordered_map<std::string, std::vector<int64_t>>& input_shapes,
       const std::string& data_directory,
+      const SharedMemoryType shared_memory_type, const size_t output_shm_size,
       const std::shared_ptr<ContextFactory>& factory,
       std::unique_ptr<LoadManager>* manager);
 
@@ -74,35 +90,37 @@ class ConcurrencyManager : public LoadManager {
   nic::Error ChangeConcurrencyLevel(
       const size_t concurrent_request_count) override;
 
-  /// @ See LoadManager.CheckHealth()
-  nic::Error CheckHealth() override;
-
-  /// @ See LoadManager.SwapTimestamps()
-  nic::Error SwapTimestamps(TimestampVector& new_timestamps) override;
-
-  /// @ See LoadManager.GetAccumulatedContextStat()
-  nic::Error GetAccumulatedContextStat(
-      nic::InferContext::Stat* contexts_stat) override;
-
-  /// @ See LoadManager.BatchSize()
-  size_t BatchSize() const override { return batch_size_; }
-
  public:
   struct RequestMetaData {
     RequestMetaData(
         const std::shared_ptr<nic::InferContext::Request> request,
-        const struct timespec start_time, const uint32_t flags)
-        : request_(std::move(request)), start_time_(start_time), flags_(flags)
+        const uint64_t intended_start_ns, const uint64_t start_ns,
+        const uint64_t end_ns, const uint32_t flags,
+        const size_t sequence_idx)
+        : request_(std::move(request)), intended_start_ns_(intended_start_ns),
+          start_ns_(start_ns), end_ns_(end_ns), flags_(flags),
+          sequence_idx_(sequence_idx)
     {
     }
 
     const std::shared_ptr<nic::InferContext::Request> request_;
-    const struct timespec start_time_;
+    // The time that the request should have been sent, which is the time
+    // that a previous request completed and freed its slot
+    const uint64_t intended_start_ns_;
+    const uint64_t start_ns_;
+    const uint64_t end_ns_;
     const uint32_t flags_;
+    // The index of the sequence in the sequence pool, only used if the
+    // number of sequences is set
+    const size_t sequence_idx_;
   };
 
   struct InferContextMetaData {
-    InferContextMetaData() : inflight_request_cnt_(0) {}
+    InferContextMetaData()
+        : inflight_request_cnt_(0), sequence_latency_ns_(0),
+          sequence_step_cnt_(0)
+    {
+    }
     InferContextMetaData(InferContextMetaData&&) = delete;
     InferContextMetaData(const InferContextMetaData&) = delete;
 
@@ -112,30 +130,62 @@ class ConcurrencyManager : public LoadManager {
     // both the main thread and callback thread
     std::mutex mtx_;
     std::vector<RequestMetaData> completed_requests_;
+    // The completion time of the requests whose slot has not been reused
+    // yet, only accessed by the worker thread
+    std::deque<uint64_t> free_slot_ns_;
+    // The sum of the latencies and the number of the completed requests of
+    // the current sequence of the context
+    uint64_t sequence_latency_ns_;
+    size_t sequence_step_cnt_;
+  };
+
+  /// A live sequence of the sequence pool.
+  struct SequenceState {
+    ni::CorrelationID correlation_id_;
+    // Whether the next request starts the sequence
+    bool start_;
+    // The number of requests of the sequence that are not sent yet
+    size_t remaining_steps_;
+    // The sum of the latencies and the number of the completed requests
+    uint64_t latency_ns_;
+    size_t completed_steps_;
   };
 
  private:
   ConcurrencyManager(
       const std::unordered_map<std::string, std::vector<int64_t>>& input_shapes,
       const int32_t batch_size, const size_t max_threads,
-      const size_t sequence_length,
+      const size_t sequence_length, const size_t num_of_sequences,
       const std::shared_ptr<ContextFactory>& factory);
 
   /// Function for worker that sends async inference requests.
   /// \param err Returns the status of the worker
   /// \param stats Returns the statistic of the InferContexts
+  /// \param latencies Returns the requests completed by the worker.
   /// \param concurrency The concurrency level that the worker should produce.
   void AsyncInfer(
       std::shared_ptr<nic::Error> err,
       std::shared_ptr<std::vector<nic::InferContext::Stat>> stats,
+      std::shared_ptr<RequestLatencies> latencies,
+      std::shared_ptr<size_t> concurrency);
+
+  /// Function for worker that sends async inference requests of the
+  /// sequences in the sequence pool.
+  /// \param err Returns the status of the worker
+  /// \param stats Returns the statistic of the InferContexts
+  /// \param latencies Returns the requests completed by the worker.
+  /// \param concurrency The number of requests that the worker should keep
+  /// in flight.
+  void AsyncSequenceInfer(
+      std::shared_ptr<nic::Error> err,
+      std::shared_ptr<std::vector<nic::InferContext::Stat>> stats,
+      std::shared_ptr<RequestLatencies> latencies,
       std::shared_ptr<size_t> concurrency);
 
-  /// Helper function to prepare the InferContext for sending inference request.
-  /// \param ctx Returns a new InferContext.
-  /// \param options Returns the options used by 'ctx'.
-  nic::Error PrepareInfer(
-      std::unique_ptr<nic::InferContext>* ctx,
-      std::unique_ptr<nic::InferContext::Options>* options);
+  /// Replace a sequence with a new sequence that has not started.
+  /// Must be called with 'sequence_mutex_' held.
+  /// \param sequence Returns the new sequence.
+  void NewSequence(SequenceState* sequence);
 
   /// Generate random sequence length based on 'offset_ratio' and
   /// 'sequence_length_'. (1 +/- 'offset_ratio') * 'sequence_length_'
@@ -143,40 +193,26 @@ class ConcurrencyManager : public LoadManager {
   /// \return random sequence length
   size_t GetRandomLength(double offset_ratio);
 
-  size_t batch_size_;
-  size_t max_threads_;
-  size_t sequence_length_;
-
-  bool on_sequence_model_;
-
-  std::shared_ptr<ContextFactory> factory_;
-
-  // User provided input shape
-  std::unordered_map<std::string, std::vector<int64_t>> input_shapes_;
-
-  // User provided input data, it will be preferred over synthetic data
-  std::unordered_map<std::string, std::vector<char>> input_data_;
-
-  // Placeholder for generated input data, which will be used for all inputs
-  std::vector<uint8_t> input_buf_;
-
-  // Note: early_exit signal is kept global
-  std::vector<std::thread> threads_;
-  std::vector<std::shared_ptr<nic::Error>> threads_status_;
-  std::vector<std::shared_ptr<std::vector<nic::InferContext::Stat>>>
-      threads_contexts_stat_;
   std::vector<std::shared_ptr<size_t>> threads_concurrency_;
 
+  // The sequence pool used if the number of sequences is set. The
+  // sequences that have no request in flight are either started and ready
+  // for their next request, or new, each in the order they became ready.
+  // 'sequence_cv_' is signaled when a sequence becomes ready.
+  size_t num_of_sequences_;
+  std::vector<SequenceState> sequences_;
+  std::deque<size_t> ready_sequences_;
+  std::deque<size_t> new_sequences_;
+  // The number of sequences whose first request is in flight, and the
+  // limit of it while started sequences are ready
+  size_t starting_sequence_cnt_;
+  size_t max_starting_sequences_;
+  std::mutex sequence_mutex_;
+  std::condition_variable sequence_cv_;
+
   // Use condition variable to pause/continue worker threads
   std::condition_variable wake_signal_;
   std::mutex wake_mutex_;
-
-  // Pointer to a vector of request timestamps <start_time, end_time>
-  // Request latency will be end_time - start_time
-  std::shared_ptr<TimestampVector> request_timestamps_;
-  // Mutex to avoid race condition on adding elements into the timestamp vector
-  // and on updating context statistic.
-  std::mutex status_report_mutex_;
 };
 
 }  // namespace perfclient
@@ -72,6 +72,42 @@ ContextFactory::CreateServerStatusContext(
   return err;
 }
 
+nic::Error
+ContextFactory::CreateSharedMemoryControlContext(
+    std::unique_ptr<nic::SharedMemoryControlContext>* ctx)
+{
+  nic::Error err;
+  if (protocol_ == ProtocolType::HTTP) {
+    err = nic::SharedMemoryControlHttpContext::Create(
+        ctx, url_, http_headers_, false);
+  } else {
+    err = nic::SharedMemoryControlGrpcContext::Create(ctx, url_, false);
+  }
+  return err;
+}
+
+nic::Error
+ContextFactory::CreateModelControlContext(
+    std::unique_ptr<nic::ModelControlContext>* ctx)
+{
+  nic::Error err;
+  if (protocol_ == ProtocolType::HTTP) {
+    err =
+        nic::ModelControlHttpContext::Create(ctx, url_, http_headers_, false);
+  } else {
+    err = nic::ModelControlGrpcContext::Create(ctx, url_, false);
+  }
+  return err;
+}
+
+ni::CorrelationID
+ContextFactory::NewCorrelationId()
+{
+  std::lock_guard<std::mutex> lock(correlation_id_mutex_);
+  current_correlation_id_++;
+  return current_correlation_id_;
+}
+
 nic::Error
 ContextFactory::CreateInferContext(std::unique_ptr<nic::InferContext>* ctx)
 {
@@ -81,9 +117,7 @@ ContextFactory::CreateInferContext(std::unique_ptr<nic::InferContext>* ctx)
   ni::CorrelationID correlation_id = 0;
 
   if (scheduler_type_ == SEQUENCE) {
-    std::lock_guard<std::mutex> lock(correlation_id_mutex_);
-    current_correlation_id_++;
-    correlation_id = current_correlation_id_;
+    correlation_id = NewCorrelationId();
   }
 
   if (streaming_) {
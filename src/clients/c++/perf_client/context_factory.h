@@ -62,10 +62,32 @@ class ContextFactory {
   nic::Error CreateServerStatusContext(
       std::unique_ptr<nic::ServerStatusContext>* ctx);
 
+  /// Create a SharedMemoryControlContext.
+  /// \param ctx Returns a new SharedMemoryControlContext object.
+  nic::Error CreateSharedMemoryControlContext(
+      std::unique_ptr<nic::SharedMemoryControlContext>* ctx);
+
+  /// Create a ModelControlContext.
+  /// \param ctx Returns a new ModelControlContext object.
+  nic::Error CreateModelControlContext(
+      std::unique_ptr<nic::ModelControlContext>* ctx);
+
   /// Create a InferContext.
   /// \param ctx Returns a new InferContext object.
   nic::Error CreateInferContext(std::unique_ptr<nic::InferContext>* ctx);
 
+  /// \return A correlation ID that has not been handed out before.
+  ni::CorrelationID NewCorrelationId();
+
+  /// Hand out the correlation IDs of the sequences after 'base', so that
+  /// the factories of different hosts use distinct correlation IDs.
+  /// Must be called before any InferContext is created.
+  /// \param base The correlation ID preceding the first one handed out.
+  void SetCorrelationIdBase(const ni::CorrelationID base)
+  {
+    current_correlation_id_ = base;
+  }
+
   /// \return The model name.
   const std::string& ModelName() const { return model_name_; }
 
@@ -0,0 +1,596 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/clients/c++/perf_client/distributed_load_manager.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+namespace perfclient {
+
+namespace {
+
+// The correlation IDs of the sequences of each host start at a multiple of
+// this, so that concurrent sequences of different hosts never collide.
+constexpr ni::CorrelationID CORRELATION_ID_STRIDE = (1ULL << 40);
+
+// A message is sent as its length (4 bytes in network byte order) followed
+// by the text of the message.
+nic::Error
+SendMessage(const int fd, const std::string& msg)
+{
+  const uint32_t length = htonl(msg.size());
+  std::string frame(reinterpret_cast<const char*>(&length), sizeof(length));
+  frame += msg;
+
+  size_t sent = 0;
+  while (sent < frame.size()) {
+    const ssize_t n =
+        send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return nic::Error(
+          ni::RequestStatusCode::UNAVAILABLE,
+          "failed to send message: " + std::string(strerror(errno)));
+    }
+    sent += n;
+  }
+  return nic::Error::Success;
+}
+
+nic::Error
+ReceiveBytes(const int fd, char* buf, const size_t size)
+{
+  size_t received = 0;
+  while (received < size) {
+    const ssize_t n = recv(fd, buf + received, size - received, 0);
+    if (n == 0) {
+      return nic::Error(
+          ni::RequestStatusCode::UNAVAILABLE, "connection closed by peer");
+    } else if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return nic::Error(
+          ni::RequestStatusCode::UNAVAILABLE,
+          "failed to receive message: " + std::string(strerror(errno)));
+    }
+    received += n;
+  }
+  return nic::Error::Success;
+}
+
+nic::Error
+ReceiveMessage(const int fd, std::string* msg)
+{
+  uint32_t length;
+  RETURN_IF_ERROR(
+      ReceiveBytes(fd, reinterpret_cast<char*>(&length), sizeof(length)));
+  msg->resize(ntohl(length));
+  if (!msg->empty()) {
+    RETURN_IF_ERROR(ReceiveBytes(fd, &(*msg)[0], msg->size()));
+  }
+  return nic::Error::Success;
+}
+
+// A response is "ok" followed by the result of the command, or "error"
+// followed by the status code and the message of the error.
+std::string
+MakeResponse(const nic::Error& err, const std::string& payload)
+{
+  if (err.IsOk()) {
+    return payload.empty() ? "ok" : ("ok " + payload);
+  }
+  return "error " + std::to_string(static_cast<int>(err.Code())) + " " +
+         err.Message();
+}
+
+nic::Error
+ParseResponse(
+    const std::string& address, const std::string& response,
+    std::string* payload)
+{
+  std::istringstream in(response);
+  std::string status;
+  in >> status;
+  if (status == "ok") {
+    payload->clear();
+    if (response.size() > status.size()) {
+      *payload = response.substr(status.size() + 1);
+    }
+    return nic::Error::Success;
+  }
+
+  int code = static_cast<int>(ni::RequestStatusCode::INTERNAL);
+  std::string msg;
+  if (status == "error") {
+    in >> code;
+    std::getline(in >> std::ws, msg);
+  } else {
+    msg = "unexpected response '" + response + "'";
+  }
+  return nic::Error(
+      static_cast<ni::RequestStatusCode>(code),
+      "worker " + address + ": " + msg);
+}
+
+}  // namespace
+
+//==============================================================================
+DistributedLoadManager::~DistributedLoadManager()
+{
+  // End the session of each worker, which stops the load of the worker
+  for (size_t i = 0; i < worker_fds_.size(); ++i) {
+    std::string response;
+    if (SendMessage(worker_fds_[i], "exit").IsOk()) {
+      ReceiveMessage(worker_fds_[i], &response);
+    }
+    close(worker_fds_[i]);
+  }
+}
+
+nic::Error
+DistributedLoadManager::Create(
+    std::unique_ptr<LoadManager> local_manager,
+    const std::vector<std::string>& workers, const bool request_rate_mode,
+    const RequestRateManager::Distribution distribution,
+    const std::shared_ptr<ContextFactory>& factory,
+    std::unique_ptr<LoadManager>* manager)
+{
+  std::string mode = "concurrency";
+  if (request_rate_mode) {
+    switch (distribution) {
+      case RequestRateManager::CONSTANT:
+        mode = "constant";
+        break;
+      case RequestRateManager::POISSON:
+        mode = "poisson";
+        break;
+      default:
+        return nic::Error(
+            ni::RequestStatusCode::INVALID_ARG,
+            "request intervals can't be used with workers");
+    }
+  }
+
+  std::unique_ptr<DistributedLoadManager> local(
+      new DistributedLoadManager(std::move(local_manager), factory));
+  for (size_t i = 0; i < workers.size(); ++i) {
+    RETURN_IF_ERROR(local->Connect(workers[i], i + 1, mode));
+  }
+  local->load_started_.resize(workers.size() + 1, false);
+
+  *manager = std::move(local);
+  return nic::Error::Success;
+}
+
+DistributedLoadManager::DistributedLoadManager(
+    std::unique_ptr<LoadManager> local_manager,
+    const std::shared_ptr<ContextFactory>& factory)
+    : LoadManager(local_manager->BatchSize(), 1, 0, {}, factory),
+      local_manager_(std::move(local_manager))
+{
+}
+
+nic::Error
+DistributedLoadManager::Connect(
+    const std::string& address, const size_t index, const std::string& mode)
+{
+  const size_t colon_pos = address.rfind(':');
+  if ((colon_pos == std::string::npos) || (colon_pos == 0)) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG,
+        "worker address must be 'host:port', got '" + address + "'");
+  }
+  const std::string host = address.substr(0, colon_pos);
+  const std::string port = address.substr(colon_pos + 1);
+
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* addrs = nullptr;
+  const int gai_err = getaddrinfo(host.c_str(), port.c_str(), &hints, &addrs);
+  if (gai_err != 0) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG,
+        "failed to resolve worker " + address + ": " +
+            std::string(gai_strerror(gai_err)));
+  }
+
+  int fd = -1;
+  for (struct addrinfo* addr = addrs; addr != nullptr; addr = addr->ai_next) {
+    fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    if (connect(fd, addr->ai_addr, addr->ai_addrlen) == 0) {
+      break;
+    }
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(addrs);
+  if (fd < 0) {
+    return nic::Error(
+        ni::RequestStatusCode::UNAVAILABLE,
+        "failed to connect to worker " + address);
+  }
+
+  // The commands are small and latency sensitive
+  const int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  worker_fds_.push_back(fd);
+  worker_addresses_.push_back(address);
+
+  // The worker checks that it sends requests to the same model with the
+  // same batch size as the coordinator
+  std::string response, payload;
+  RETURN_IF_ERROR(SendMessage(
+      fd, "hello " + factory_->ModelName() + " " +
+              std::to_string(factory_->ModelVersion()) + " " +
+              std::to_string(batch_size_) + " " + mode + " " +
+              std::to_string(index)));
+  RETURN_IF_ERROR(ReceiveMessage(fd, &response));
+  return ParseResponse(address, response, &payload);
+}
+
+nic::Error
+DistributedLoadManager::Broadcast(
+    const std::vector<std::string>& commands,
+    const std::function<nic::Error()>& local,
+    std::vector<std::string>* responses)
+{
+  nic::Error err;
+  for (size_t i = 0; i < worker_fds_.size(); ++i) {
+    if (!commands[i].empty()) {
+      err = SendMessage(worker_fds_[i], commands[i]);
+      if (!err.IsOk()) {
+        return nic::Error(
+            err.Code(),
+            "worker " + worker_addresses_[i] + ": " + err.Message());
+      }
+    }
+  }
+
+  // Wait for all responses even if the local command fails, to keep the
+  // sessions in step
+  nic::Error local_err = local();
+  responses->clear();
+  responses->resize(worker_fds_.size());
+  for (size_t i = 0; i < worker_fds_.size(); ++i) {
+    if (!commands[i].empty()) {
+      std::string response;
+      nic::Error worker_err = ReceiveMessage(worker_fds_[i], &response);
+      if (worker_err.IsOk()) {
+        worker_err =
+            ParseResponse(worker_addresses_[i], response, &(*responses)[i]);
+      }
+      if (err.IsOk() && !worker_err.IsOk()) {
+        err = worker_err;
+      }
+    }
+  }
+  RETURN_IF_ERROR(local_err);
+  return err;
+}
+
+nic::Error
+DistributedLoadManager::ChangeConcurrencyLevel(
+    const size_t concurrent_request_count)
+{
+  // Split the concurrency evenly and spread the remainder
+  const size_t hosts = worker_fds_.size() + 1;
+  std::vector<size_t> shares(hosts, concurrent_request_count / hosts);
+  for (size_t i = 0; i < (concurrent_request_count % hosts); ++i) {
+    shares[i]++;
+  }
+
+  std::vector<std::string> commands(worker_fds_.size());
+  for (size_t i = 0; i < worker_fds_.size(); ++i) {
+    if ((shares[i + 1] != 0) || load_started_[i + 1]) {
+      commands[i] = "concurrency " + std::to_string(shares[i + 1]);
+      load_started_[i + 1] = true;
+    }
+  }
+
+  std::vector<std::string> responses;
+  return Broadcast(
+      commands,
+      [this, &shares]() {
+        if ((shares[0] == 0) && !load_started_[0]) {
+          return nic::Error::Success;
+        }
+        load_started_[0] = true;
+        return local_manager_->ChangeConcurrencyLevel(shares[0]);
+      },
+      &responses);
+}
+
+nic::Error
+DistributedLoadManager::ChangeRequestRate(const double request_rate)
+{
+  const double share = request_rate / (worker_fds_.size() + 1);
+  std::ostringstream command;
+  command.precision(std::numeric_limits<double>::digits10 + 2);
+  command << "rate " << share;
+
+  std::vector<std::string> commands(worker_fds_.size(), command.str());
+  std::vector<std::string> responses;
+  return Broadcast(
+      commands,
+      [this, share]() { return local_manager_->ChangeRequestRate(share); },
+      &responses);
+}
+
+nic::Error
+DistributedLoadManager::CheckHealth()
+{
+  std::vector<std::string> commands(worker_fds_.size(), "health");
+  std::vector<std::string> responses;
+  return Broadcast(
+      commands, [this]() { return local_manager_->CheckHealth(); },
+      &responses);
+}
+
+nic::Error
+DistributedLoadManager::CollectLatencies(RequestLatencies* latencies)
+{
+  std::vector<std::string> commands(worker_fds_.size(), "collect");
+  std::vector<std::string> responses;
+  RETURN_IF_ERROR(Broadcast(
+      commands,
+      [this, latencies]() {
+        return local_manager_->CollectLatencies(latencies);
+      },
+      &responses));
+
+  for (size_t i = 0; i < responses.size(); ++i) {
+    std::istringstream in(responses[i]);
+    RequestLatencies worker_latencies;
+    if (!worker_latencies.Deserialize(in)) {
+      return nic::Error(
+          ni::RequestStatusCode::INTERNAL,
+          "worker " + worker_addresses_[i] + ": malformed latencies");
+    }
+    latencies->Merge(worker_latencies);
+  }
+  return nic::Error::Success;
+}
+
+nic::Error
+DistributedLoadManager::GetAccumulatedContextStat(
+    nic::InferContext::Stat* contexts_stat)
+{
+  std::vector<std::string> commands(worker_fds_.size(), "stat");
+  std::vector<std::string> responses;
+  RETURN_IF_ERROR(Broadcast(
+      commands,
+      [this, contexts_stat]() {
+        return local_manager_->GetAccumulatedContextStat(contexts_stat);
+      },
+      &responses));
+
+  for (size_t i = 0; i < responses.size(); ++i) {
+    std::istringstream in(responses[i]);
+    nic::InferContext::Stat stat;
+    if (!(in >> stat.completed_request_count >>
+          stat.cumulative_total_request_time_ns >>
+          stat.cumulative_send_time_ns >> stat.cumulative_receive_time_ns)) {
+      return nic::Error(
+          ni::RequestStatusCode::INTERNAL,
+          "worker " + worker_addresses_[i] + ": malformed context stat");
+    }
+    contexts_stat->completed_request_count += stat.completed_request_count;
+    contexts_stat->cumulative_total_request_time_ns +=
+        stat.cumulative_total_request_time_ns;
+    contexts_stat->cumulative_send_time_ns += stat.cumulative_send_time_ns;
+    contexts_stat->cumulative_receive_time_ns +=
+        stat.cumulative_receive_time_ns;
+  }
+  return nic::Error::Success;
+}
+
+//==============================================================================
+LoadWorker::~LoadWorker()
+{
+  close(listen_fd_);
+}
+
+nic::Error
+LoadWorker::Create(
+    const uint16_t port, const int32_t batch_size,
+    const std::shared_ptr<ContextFactory>& factory,
+    const CreateManagerFn& create_manager, std::unique_ptr<LoadWorker>* worker)
+{
+  const int fd = socket(AF_INET6, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return nic::Error(
+        ni::RequestStatusCode::INTERNAL,
+        "failed to create socket: " + std::string(strerror(errno)));
+  }
+
+  // Accept both IPv4 and IPv6 coordinators
+  const int zero = 0, one = 1;
+  setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero));
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  struct sockaddr_in6 addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin6_family = AF_INET6;
+  addr.sin6_addr = in6addr_any;
+  addr.sin6_port = htons(port);
+  if ((bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) !=
+       0) ||
+      (listen(fd, 1) != 0)) {
+    const std::string msg = strerror(errno);
+    close(fd);
+    return nic::Error(
+        ni::RequestStatusCode::INTERNAL,
+        "failed to listen on port " + std::to_string(port) + ": " + msg);
+  }
+
+  worker->reset(new LoadWorker(fd, batch_size, factory, create_manager));
+  return nic::Error::Success;
+}
+
+nic::Error
+LoadWorker::Serve()
+{
+  const int fd = accept(listen_fd_, nullptr, nullptr);
+  if (fd < 0) {
+    return nic::Error(
+        ni::RequestStatusCode::INTERNAL,
+        "failed to accept coordinator: " + std::string(strerror(errno)));
+  }
+  const int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  nic::Error err;
+  bool done = false;
+  while (!done) {
+    std::string command;
+    err = ReceiveMessage(fd, &command);
+    if (!err.IsOk()) {
+      break;
+    }
+
+    std::string payload;
+    const nic::Error cmd_err = Handle(command, &payload, &done);
+    err = SendMessage(fd, MakeResponse(cmd_err, payload));
+    if (!err.IsOk()) {
+      break;
+    }
+  }
+
+  // Stop sending requests once the coordinator is gone
+  manager_.reset();
+  close(fd);
+  return err;
+}
+
+nic::Error
+LoadWorker::Handle(const std::string& command, std::string* payload, bool* done)
+{
+  std::istringstream in(command);
+  std::string name;
+  in >> name;
+
+  if (name == "exit") {
+    *done = true;
+    return nic::Error::Success;
+  }
+
+  if (name == "hello") {
+    std::string model_name, mode;
+    int64_t model_version;
+    int32_t batch_size;
+    size_t index;
+    if (!(in >> model_name >> model_version >> batch_size >> mode >> index)) {
+      return nic::Error(
+          ni::RequestStatusCode::INVALID_ARG,
+          "malformed command '" + command + "'");
+    }
+    if (manager_ != nullptr) {
+      return nic::Error(
+          ni::RequestStatusCode::INVALID_ARG, "the session already started");
+    }
+    if ((model_name != factory_->ModelName()) ||
+        (model_version != factory_->ModelVersion()) ||
+        (batch_size != batch_size_)) {
+      return nic::Error(
+          ni::RequestStatusCode::INVALID_ARG,
+          "the coordinator profiles model '" + model_name + "' version " +
+              std::to_string(model_version) + " with batch size " +
+              std::to_string(batch_size) + ", the worker is set for model '" +
+              factory_->ModelName() + "' version " +
+              std::to_string(factory_->ModelVersion()) + " with batch size " +
+              std::to_string(batch_size_));
+    }
+
+    RequestRateManager::Distribution distribution =
+        RequestRateManager::CONSTANT;
+    const bool request_rate_mode = (mode != "concurrency");
+    if (request_rate_mode) {
+      RETURN_IF_ERROR(
+          RequestRateManager::ParseDistribution(mode, &distribution));
+    }
+    factory_->SetCorrelationIdBase(index * CORRELATION_ID_STRIDE);
+    std::cout << "Coordinator connected, worker " << index << std::endl;
+    return create_manager_(request_rate_mode, distribution, &manager_);
+  }
+
+  if (manager_ == nullptr) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG,
+        "the session has not started, expecting 'hello'");
+  }
+
+  if (name == "concurrency") {
+    size_t concurrency;
+    if (in >> concurrency) {
+      return manager_->ChangeConcurrencyLevel(concurrency);
+    }
+  } else if (name == "rate") {
+    double request_rate;
+    if (in >> request_rate) {
+      return manager_->ChangeRequestRate(request_rate);
+    }
+  } else if (name == "health") {
+    return manager_->CheckHealth();
+  } else if (name == "collect") {
+    RequestLatencies latencies;
+    RETURN_IF_ERROR(manager_->CollectLatencies(&latencies));
+    std::ostringstream out;
+    latencies.Serialize(out);
+    *payload = out.str();
+    return nic::Error::Success;
+  } else if (name == "stat") {
+    nic::InferContext::Stat stat;
+    RETURN_IF_ERROR(manager_->GetAccumulatedContextStat(&stat));
+    *payload = std::to_string(stat.completed_request_count) + " " +
+               std::to_string(stat.cumulative_total_request_time_ns) + " " +
+               std::to_string(stat.cumulative_send_time_ns) + " " +
+               std::to_string(stat.cumulative_receive_time_ns);
+    return nic::Error::Success;
+  }
+
+  return nic::Error(
+      ni::RequestStatusCode::INVALID_ARG,
+      "malformed command '" + command + "'");
+}
+
+}  // namespace perfclient
@@ -0,0 +1,194 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "src/clients/c++/perf_client/load_manager.h"
+#include "src/clients/c++/perf_client/request_rate_manager.h"
+
+#include <functional>
+
+namespace perfclient {
+
+//==============================================================================
+/// DistributedLoadManager is a helper class to generate the load of a model
+/// from several hosts, so that the load is not limited by the CPU of a
+/// single client host. The host running the perf_client that profiles the
+/// model (the coordinator) connects to perf_client instances running as
+/// workers (see LoadWorker) on other hosts.
+///
+/// Detail:
+/// The load level requested by the profiler is the total load of all
+/// hosts, it is split evenly between the local load manager and the load
+/// managers of the workers. The measurement window is controlled by the
+/// coordinator: collecting the requests completed by the hosts is sent to
+/// all workers before it is done locally, so the windows of all hosts end
+/// at the same time within the network latency. The latency histograms of
+/// all hosts are merged, so the reported percentiles are the percentiles
+/// of all requests and not an aggregate of per-host percentiles.
+///
+class DistributedLoadManager : public LoadManager {
+ public:
+  ~DistributedLoadManager();
+
+  /// Create a load manager that distributes the load over 'local_manager'
+  /// and the given workers.
+  /// \param local_manager The load manager that generates the share of the
+  /// load of this host.
+  /// \param workers The addresses 'host:port' of the workers.
+  /// \param request_rate_mode Whether the load is set by request rate
+  /// instead of by concurrency.
+  /// \param distribution The distribution of the time between requests in
+  /// request rate mode.
+  /// \param factory The ContextFactory object used by 'local_manager'.
+  /// \param manager Returns a new DistributedLoadManager object.
+  /// \return Error object indicating success or failure.
+  static nic::Error Create(
+      std::unique_ptr<LoadManager> local_manager,
+      const std::vector<std::string>& workers, const bool request_rate_mode,
+      const RequestRateManager::Distribution distribution,
+      const std::shared_ptr<ContextFactory>& factory,
+      std::unique_ptr<LoadManager>* manager);
+
+  /// @ See LoadManager.ChangeConcurrencyLevel()
+  nic::Error ChangeConcurrencyLevel(
+      const size_t concurrent_request_count) override;
+
+  /// @ See LoadManager.ChangeRequestRate()
+  nic::Error ChangeRequestRate(const double request_rate) override;
+
+  /// @ See LoadManager.CheckHealth()
+  nic::Error CheckHealth() override;
+
+  /// @ See LoadManager.CollectLatencies()
+  nic::Error CollectLatencies(RequestLatencies* latencies) override;
+
+  /// @ See LoadManager.GetAccumulatedContextStat()
+  nic::Error GetAccumulatedContextStat(
+      nic::InferContext::Stat* contexts_stat) override;
+
+ private:
+  DistributedLoadManager(
+      std::unique_ptr<LoadManager> local_manager,
+      const std::shared_ptr<ContextFactory>& factory);
+
+  /// Connect to a worker and set up its load manager.
+  /// \param address The address 'host:port' of the worker.
+  /// \param index The index of the worker, starting from 1.
+  /// \param mode The load mode sent to the worker.
+  /// \return Error object indicating success or failure.
+  nic::Error Connect(
+      const std::string& address, const size_t index,
+      const std::string& mode);
+
+  /// Send a command to the workers, then run 'local' and wait for the
+  /// responses of the workers.
+  /// \param commands The command for each worker, the worker is skipped if
+  /// its command is empty.
+  /// \param local The function that performs the command on this host.
+  /// \param responses Returns the response of each worker.
+  /// \return Error object indicating success or failure.
+  nic::Error Broadcast(
+      const std::vector<std::string>& commands,
+      const std::function<nic::Error()>& local,
+      std::vector<std::string>* responses);
+
+  std::unique_ptr<LoadManager> local_manager_;
+
+  // The socket connected to each worker and its address
+  std::vector<int> worker_fds_;
+  std::vector<std::string> worker_addresses_;
+
+  // Whether each host has been given a non-zero load, the local host is
+  // the first. A load manager only accepts a zero load after it has had
+  // a non-zero one.
+  std::vector<bool> load_started_;
+};
+
+//==============================================================================
+/// LoadWorker runs a load manager on behalf of a DistributedLoadManager on
+/// another host. The load manager is created when the coordinator connects
+/// and the coordinator then controls the load and collects the completed
+/// requests.
+///
+class LoadWorker {
+ public:
+  /// The function to create the load manager of the worker.
+  /// \param request_rate_mode Whether to create a load manager whose load
+  /// is set by request rate instead of by concurrency.
+  /// \param distribution The distribution of the time between requests in
+  /// request rate mode.
+  /// \param manager Returns the load manager.
+  /// \return Error object indicating success or failure.
+  using CreateManagerFn = std::function<nic::Error(
+      const bool request_rate_mode,
+      const RequestRateManager::Distribution distribution,
+      std::unique_ptr<LoadManager>* manager)>;
+
+  ~LoadWorker();
+
+  /// Create a worker that listens for the coordinator.
+  /// \param port The TCP port to listen on.
+  /// \param batch_size The batch size of the requests.
+  /// \param factory The ContextFactory object of the model.
+  /// \param create_manager The function to create the load manager.
+  /// \param worker Returns a new LoadWorker object.
+  /// \return Error object indicating success or failure.
+  static nic::Error Create(
+      const uint16_t port, const int32_t batch_size,
+      const std::shared_ptr<ContextFactory>& factory,
+      const CreateManagerFn& create_manager,
+      std::unique_ptr<LoadWorker>* worker);
+
+  /// Wait for a coordinator to connect and serve it until it disconnects.
+  /// \return Error object indicating success or failure.
+  nic::Error Serve();
+
+ private:
+  LoadWorker(
+      const int listen_fd, const int32_t batch_size,
+      const std::shared_ptr<ContextFactory>& factory,
+      const CreateManagerFn& create_manager)
+      : listen_fd_(listen_fd), batch_size_(batch_size), factory_(factory),
+        create_manager_(create_manager)
+  {
+  }
+
+  /// Perform a command of the coordinator.
+  /// \param command The command.
+  /// \param payload Returns the result of the command.
+  /// \param done Returns whether the coordinator ends the session.
+  /// \return Error object indicating success or failure.
+  nic::Error Handle(
+      const std::string& command, std::string* payload, bool* done);
+
+  const int listen_fd_;
+  const int32_t batch_size_;
+  std::shared_ptr<ContextFactory> factory_;
+  CreateManagerFn create_manager_;
+  std::unique_ptr<LoadManager> manager_;
+};
+
+}  // namespace perfclient
@@ -0,0 +1,156 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/clients/c++/perf_client/gpu_metrics.h"
+
+#include <curl/curl.h>
+#include <map>
+#include <sstream>
+
+namespace perfclient {
+
+namespace {
+
+size_t
+MetricsHandler(void* contents, size_t size, size_t nmemb, void* userp)
+{
+  std::string* body = reinterpret_cast<std::string*>(userp);
+  body->append(reinterpret_cast<char*>(contents), size * nmemb);
+  return size * nmemb;
+}
+
+// Parse a sample line of the Prometheus text format:
+//   <metric name>{<label>="<value>",...} <sample value>
+bool
+ParseSample(
+    const std::string& line, std::string* name, std::string* gpu_uuid,
+    double* value)
+{
+  const size_t name_end = line.find_first_of("{ ");
+  if (name_end == std::string::npos) {
+    return false;
+  }
+  *name = line.substr(0, name_end);
+
+  size_t value_pos = name_end;
+  gpu_uuid->clear();
+  if (line[name_end] == '{') {
+    const size_t labels_end = line.find('}', name_end);
+    if (labels_end == std::string::npos) {
+      return false;
+    }
+    const std::string labels =
+        line.substr(name_end + 1, labels_end - name_end - 1);
+    const std::string uuid_label = "gpu_uuid=\"";
+    const size_t uuid_pos = labels.find(uuid_label);
+    if (uuid_pos != std::string::npos) {
+      const size_t uuid_start = uuid_pos + uuid_label.size();
+      *gpu_uuid =
+          labels.substr(uuid_start, labels.find('"', uuid_start) - uuid_start);
+    }
+    value_pos = labels_end + 1;
+  }
+
+  std::istringstream value_in(line.substr(value_pos));
+  return static_cast<bool>(value_in >> *value);
+}
+
+}  // namespace
+
+nic::Error
+ScrapeGpuMetrics(const std::string& url, std::vector<GpuMetrics>* metrics)
+{
+  metrics->clear();
+
+  CURL* curl = curl_easy_init();
+  if (curl == nullptr) {
+    return nic::Error(
+        ni::RequestStatusCode::INTERNAL, "failed to initialize HTTP client");
+  }
+
+  std::string body;
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, "libcurl-agent/1.0");
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, MetricsHandler);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
+  CURLcode res = curl_easy_perform(curl);
+  long http_code = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+  curl_easy_cleanup(curl);
+  if (res != CURLE_OK) {
+    return nic::Error(
+        ni::RequestStatusCode::UNAVAILABLE,
+        "failed to get metrics from " + url + ": " + curl_easy_strerror(res));
+  }
+  if (http_code != 200) {
+    return nic::Error(
+        ni::RequestStatusCode::UNAVAILABLE,
+        "failed to get metrics from " + url + ": HTTP status " +
+            std::to_string(http_code));
+  }
+
+  std::map<std::string, GpuMetrics> gpus;
+  std::istringstream in(body);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || (line[0] == '#')) {
+      continue;
+    }
+
+    std::string name, gpu_uuid;
+    double value;
+    if (!ParseSample(line, &name, &gpu_uuid, &value) || gpu_uuid.empty()) {
+      continue;
+    }
+    // The inference metrics of the models are also labeled by GPU
+    if (name.compare(0, 7, "nv_gpu_") != 0) {
+      continue;
+    }
+
+    auto it = gpus.find(gpu_uuid);
+    if (it == gpus.end()) {
+      it = gpus.emplace(gpu_uuid, GpuMetrics{gpu_uuid, 0, 0, 0, 0}).first;
+    }
+    if (name == "nv_gpu_utilization") {
+      it->second.utilization_ = value;
+    } else if (name == "nv_gpu_memory_used_bytes") {
+      it->second.memory_used_bytes_ = static_cast<uint64_t>(value);
+    } else if (name == "nv_gpu_memory_total_bytes") {
+      it->second.memory_total_bytes_ = static_cast<uint64_t>(value);
+    } else if (name == "nv_gpu_power_usage") {
+      it->second.power_usage_ = value;
+    }
+  }
+
+  for (const auto& gpu : gpus) {
+    metrics->push_back(gpu.second);
+  }
+
+  return nic::Error::Success;
+}
+
+}  // namespace perfclient
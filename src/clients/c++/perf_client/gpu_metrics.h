@@ -0,0 +1,56 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "src/clients/c++/perf_client/perf_utils.h"
+
+#include <string>
+#include <vector>
+
+namespace perfclient {
+
+/// The state of a GPU as reported by the metrics endpoint of the server.
+struct GpuMetrics {
+  std::string gpu_uuid_;
+  // GPU utilization in range [0, 1] over the last metrics interval
+  double utilization_;
+  uint64_t memory_used_bytes_;
+  uint64_t memory_total_bytes_;
+  // Power usage in watts
+  double power_usage_;
+};
+
+/// Get the state of every GPU used by the server from its Prometheus
+/// metrics endpoint, for example 'localhost:8002/metrics'. A server
+/// without GPUs reports no GPU metrics.
+/// \param url The URL of the metrics endpoint.
+/// \param metrics Returns the metrics of each GPU ordered by UUID.
+/// \return Error object indicating success or failure.
+nic::Error ScrapeGpuMetrics(
+    const std::string& url, std::vector<GpuMetrics>* metrics);
+
+}  // namespace perfclient
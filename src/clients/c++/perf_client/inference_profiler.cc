@@ -26,15 +26,14 @@
 
 #include "src/clients/c++/perf_client/inference_profiler.h"
 
-#include <math.h>
-
 namespace perfclient {
 
 nic::Error
 InferenceProfiler::Create(
     const bool verbose, const double stable_offset,
     const uint64_t measurement_window_ms, const size_t max_measurement_count,
-    const int64_t percentile, std::shared_ptr<ContextFactory>& factory,
+    const int64_t percentile, const std::string& metrics_url,
+    std::shared_ptr<ContextFactory>& factory,
     std::unique_ptr<LoadManager> manager,
     std::unique_ptr<InferenceProfiler>* profiler)
 {
@@ -44,8 +43,8 @@ InferenceProfiler::Create(
   std::unique_ptr<InferenceProfiler> local_profiler(new InferenceProfiler(
       verbose, stable_offset, measurement_window_ms, max_measurement_count,
       (percentile != -1), percentile, factory->SchedulerType(),
-      factory->ModelName(), factory->ModelVersion(), std::move(status_ctx),
-      std::move(manager)));
+      factory->ModelName(), factory->ModelVersion(), metrics_url,
+      std::move(status_ctx), std::move(manager)));
 
   if (local_profiler->scheduler_type_ == ContextFactory::ENSEMBLE) {
     ni::ServerStatus server_status;
@@ -96,14 +95,15 @@ InferenceProfiler::InferenceProfiler(
     const bool extra_percentile, const size_t percentile,
     const ContextFactory::ModelSchedulerType scheduler_type,
     const std::string& model_name, const int64_t model_version,
+    const std::string& metrics_url,
     std::unique_ptr<nic::ServerStatusContext> status_ctx,
     std::unique_ptr<LoadManager> manager)
     : verbose_(verbose), measurement_window_ms_(measurement_window_ms),
       max_measurement_count_(max_measurement_count),
       extra_percentile_(extra_percentile), percentile_(percentile),
       scheduler_type_(scheduler_type), model_name_(model_name),
-      model_version_(model_version), status_ctx_(std::move(status_ctx)),
-      manager_(std::move(manager))
+      model_version_(model_version), metrics_url_(metrics_url),
+      status_ctx_(std::move(status_ctx)), manager_(std::move(manager))
 {
   load_parameters_.stable_offset = stable_offset;
   load_parameters_.stability_window = 3;
@@ -114,17 +114,85 @@ InferenceProfiler::Profile(
     const size_t concurrent_request_count, PerfStatus& status_summary)
 {
   status_summary.concurrency = concurrent_request_count;
+  status_summary.request_rate = 0;
 
   RETURN_IF_ERROR(manager_->ChangeConcurrencyLevel(concurrent_request_count));
 
+  bool is_stable;
+  RETURN_IF_ERROR(ProfileHelper(status_summary, &is_stable));
+  if (!is_stable) {
+    std::cerr << "Failed to obtain stable measurement within "
+              << max_measurement_count_
+              << " measurement windows for concurrency "
+              << concurrent_request_count << ". Please try to "
+              << "increase the time window." << std::endl;
+  }
+
+  return nic::Error::Success;
+}
+
+nic::Error
+InferenceProfiler::Warmup(
+    const size_t concurrent_request_count, const uint64_t warmup_ms)
+{
+  RETURN_IF_ERROR(manager_->ChangeConcurrencyLevel(concurrent_request_count));
+  std::this_thread::sleep_for(std::chrono::milliseconds(warmup_ms));
+
+  // The requests completed during the warmup are discarded by the next
+  // measurement
+  return manager_->CheckHealth();
+}
+
+nic::Error
+InferenceProfiler::ProfileRequestRate(
+    const double request_rate, PerfStatus& status_summary)
+{
+  status_summary.concurrency = 0;
+  status_summary.request_rate = request_rate;
+
+  RETURN_IF_ERROR(manager_->ChangeRequestRate(request_rate));
+
+  bool is_stable;
+  RETURN_IF_ERROR(ProfileHelper(status_summary, &is_stable));
+  if (!is_stable) {
+    std::cerr << "Failed to obtain stable measurement within "
+              << max_measurement_count_
+              << " measurement windows for request rate " << request_rate
+              << ". Please try to increase the time window." << std::endl;
+  }
+
+  return nic::Error::Success;
+}
+
+nic::Error
+InferenceProfiler::ProfileReplay(
+    const uint64_t start_ns, PerfStatus& status_summary)
+{
+  status_summary.concurrency = 0;
+  status_summary.request_rate = 0;
+
+  RETURN_IF_ERROR(manager_->CheckHealth());
+  status_summary.windows.clear();
+  RETURN_IF_ERROR(Measure(
+      [this, start_ns]() { return manager_->Replay(start_ns); },
+      status_summary));
+  RecordWindow(status_summary);
+  return nic::Error::Success;
+}
+
+nic::Error
+InferenceProfiler::ProfileHelper(PerfStatus& status_summary, bool* is_stable)
+{
   // Start measurement
-  bool is_stable = true;
+  *is_stable = true;
   LoadStatus load_status;
+  status_summary.windows.clear();
 
   do {
     RETURN_IF_ERROR(manager_->CheckHealth());
 
     RETURN_IF_ERROR(Measure(status_summary));
+    RecordWindow(status_summary);
 
     load_status.infer_per_sec.push_back(status_summary.client_infer_per_sec);
     load_status.latencies.push_back(status_summary.stabilizing_latency_ns);
@@ -150,6 +218,12 @@ InferenceProfiler::Profile(
                   << " usec (std " << status_summary.std_us << " usec)"
                   << std::endl;
       }
+      if (status_summary.client_load_delayed) {
+        std::cout << "  Pass [" << load_status.infer_per_sec.size()
+                  << "] fell behind: "
+                  << status_summary.client_delayed_request_count
+                  << " requests delayed" << std::endl;
+      }
     }
 
     if (load_status.infer_per_sec.size() >= load_parameters_.stability_window) {
@@ -162,7 +236,7 @@ InferenceProfiler::Profile(
         load_status.avg_latency -=
             load_status.latencies[idx - 1] / load_parameters_.stability_window;
       }
-      is_stable = true;
+      *is_stable = true;
       for (; idx < load_status.infer_per_sec.size(); idx++) {
         // We call it complete only if stability_window measurements are within
         // +/-(stable_offset)% of the average infer per second and latency
@@ -170,16 +244,16 @@ InferenceProfiler::Profile(
              load_status.avg_ips * (1 - load_parameters_.stable_offset)) ||
             (load_status.infer_per_sec[idx] >
              load_status.avg_ips * (1 + load_parameters_.stable_offset))) {
-          is_stable = false;
+          *is_stable = false;
         }
         if ((load_status.latencies[idx] <
              load_status.avg_latency * (1 - load_parameters_.stable_offset)) ||
             (load_status.latencies[idx] >
              load_status.avg_latency * (1 + load_parameters_.stable_offset))) {
-          is_stable = false;
+          *is_stable = false;
         }
       }
-      if (is_stable) {
+      if (*is_stable) {
         break;
       }
     }
@@ -187,12 +261,6 @@ InferenceProfiler::Profile(
            (load_status.infer_per_sec.size() < max_measurement_count_));
   if (early_exit) {
     return nic::Error(ni::RequestStatusCode::INTERNAL, "Received exit signal.");
-  } else if (!is_stable) {
-    std::cerr << "Failed to obtain stable measurement within "
-              << max_measurement_count_
-              << " measurement windows for concurrency "
-              << concurrent_request_count << ". Please try to "
-              << "increase the time window." << std::endl;
   }
 
   return nic::Error::Success;
@@ -251,6 +319,21 @@ InferenceProfiler::GetServerSideStatus(
 // Used for measurement
 nic::Error
 InferenceProfiler::Measure(PerfStatus& status_summary)
+{
+  // Wait for specified time interval in msec
+  return Measure(
+      [this]() {
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(measurement_window_ms_));
+        return nic::Error::Success;
+      },
+      status_summary);
+}
+
+nic::Error
+InferenceProfiler::Measure(
+    const std::function<nic::Error()>& generate_load,
+    PerfStatus& status_summary)
 {
   std::map<std::string, ni::ModelStatus> start_status;
   std::map<std::string, ni::ModelStatus> end_status;
@@ -260,9 +343,17 @@ InferenceProfiler::Measure(PerfStatus& status_summary)
   RETURN_IF_ERROR(GetServerSideStatus(&start_status));
   RETURN_IF_ERROR(manager_->GetAccumulatedContextStat(&start_stat));
 
-  // Wait for specified time interval in msec
-  std::this_thread::sleep_for(
-      std::chrono::milliseconds((uint64_t)(measurement_window_ms_ * 1.2)));
+  // Only measure the requests that complete within the time interval
+  RequestLatencies latencies;
+  RETURN_IF_ERROR(manager_->CollectLatencies(&latencies));
+  struct timespec start_time;
+  clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+  RETURN_IF_ERROR(generate_load());
+
+  RETURN_IF_ERROR(manager_->CollectLatencies(&latencies));
+  struct timespec end_time;
+  clock_gettime(CLOCK_MONOTONIC, &end_time);
 
   RETURN_IF_ERROR(manager_->GetAccumulatedContextStat(&end_stat));
 
@@ -270,35 +361,45 @@ InferenceProfiler::Measure(PerfStatus& status_summary)
   // before and after status.
   RETURN_IF_ERROR(GetServerSideStatus(&end_status));
 
-  TimestampVector current_timestamps;
-  RETURN_IF_ERROR(manager_->SwapTimestamps(current_timestamps));
+  status_summary.gpu_metrics.clear();
+  if (!metrics_url_.empty()) {
+    RETURN_IF_ERROR(
+        ScrapeGpuMetrics(metrics_url_, &(status_summary.gpu_metrics)));
+  }
 
   RETURN_IF_ERROR(Summarize(
-      current_timestamps, start_status, end_status, start_stat, end_stat,
-      status_summary));
+      latencies, TIMESPEC_TO_NANOS(end_time) - TIMESPEC_TO_NANOS(start_time),
+      start_status, end_status, start_stat, end_stat, status_summary));
 
   return nic::Error::Success;
 }
 
+void
+InferenceProfiler::RecordWindow(PerfStatus& status_summary)
+{
+  MeasurementWindow window;
+  window.duration_ns = status_summary.client_duration_ns;
+  window.request_count = status_summary.client_request_count;
+  window.infer_per_sec = status_summary.client_infer_per_sec;
+  window.avg_latency_ns = status_summary.client_avg_latency_ns;
+  window.percentile_latency_ns = status_summary.client_percentile_latency_ns;
+  window.max_latency_ns = status_summary.client_max_latency_ns;
+  window.gpu_metrics = status_summary.gpu_metrics;
+  status_summary.windows.push_back(std::move(window));
+}
+
 nic::Error
 InferenceProfiler::Summarize(
-    const TimestampVector& timestamps,
+    const RequestLatencies& latencies, const uint64_t duration_ns,
     const std::map<std::string, ni::ModelStatus>& start_status,
     const std::map<std::string, ni::ModelStatus>& end_status,
     const nic::InferContext::Stat& start_stat,
     const nic::InferContext::Stat& end_stat, PerfStatus& summary)
 {
-  size_t valid_sequence_count = 0;
-
-  // Get measurement from requests that fall within the time interval
-  std::pair<uint64_t, uint64_t> valid_range = MeasurementTimestamp(timestamps);
-  std::vector<uint64_t> latencies =
-      ValidLatencyMeasurement(timestamps, valid_range, valid_sequence_count);
-
   RETURN_IF_ERROR(SummarizeLatency(latencies, summary));
   RETURN_IF_ERROR(SummarizeClientStat(
-      start_stat, end_stat, valid_range.second - valid_range.first,
-      latencies.size(), valid_sequence_count, summary));
+      start_stat, end_stat, duration_ns, latencies.latencies_.Count(),
+      latencies.sequence_count_, summary));
 
   RETURN_IF_ERROR(
       SummarizeServerStats(start_status, end_status, &(summary.server_stats)));
@@ -306,100 +407,88 @@ InferenceProfiler::Summarize(
   return nic::Error::Success;
 }
 
-std::pair<uint64_t, uint64_t>
-InferenceProfiler::MeasurementTimestamp(const TimestampVector& timestamps)
-{
-  // finding the start time of the first request
-  // and the end time of the last request in the timestamp queue
-  uint64_t first_request_start_ns = 0;
-  uint64_t last_request_end_ns = 0;
-  for (auto& timestamp : timestamps) {
-    uint64_t request_start_time = TIMESPEC_TO_NANOS(std::get<0>(timestamp));
-    uint64_t request_end_time = TIMESPEC_TO_NANOS(std::get<1>(timestamp));
-    if ((first_request_start_ns > request_start_time) ||
-        (first_request_start_ns == 0)) {
-      first_request_start_ns = request_start_time;
-    }
-    if ((last_request_end_ns < request_end_time) ||
-        (last_request_end_ns == 0)) {
-      last_request_end_ns = request_end_time;
-    }
-  }
-
-  // Define the measurement window [client_start_ns, client_end_ns) to be
-  // in the middle of the queue
-  uint64_t measurement_window_ns = measurement_window_ms_ * 1000 * 1000;
-  uint64_t offset = first_request_start_ns + measurement_window_ns;
-  offset =
-      (offset > last_request_end_ns) ? 0 : (last_request_end_ns - offset) / 2;
-
-  uint64_t start_ns = first_request_start_ns + offset;
-  uint64_t end_ns = start_ns + measurement_window_ns;
-
-  return std::make_pair(start_ns, end_ns);
-}
-
-std::vector<uint64_t>
-InferenceProfiler::ValidLatencyMeasurement(
-    const TimestampVector& timestamps,
-    const std::pair<uint64_t, uint64_t>& valid_range,
-    size_t& valid_sequence_count)
-{
-  std::vector<uint64_t> valid_latencies;
-  valid_sequence_count = 0;
-  for (auto& timestamp : timestamps) {
-    uint64_t request_start_ns = TIMESPEC_TO_NANOS(std::get<0>(timestamp));
-    uint64_t request_end_ns = TIMESPEC_TO_NANOS(std::get<1>(timestamp));
-
-    if (request_start_ns <= request_end_ns) {
-      // Only counting requests that end within the time interval
-      if ((request_end_ns >= valid_range.first) &&
-          (request_end_ns <= valid_range.second)) {
-        valid_latencies.push_back(request_end_ns - request_start_ns);
-        if (std::get<2>(timestamp) & ni::InferRequestHeader::FLAG_SEQUENCE_END)
-          valid_sequence_count++;
-      }
-    }
-  }
-
-  // Always sort measured latencies as percentile will be reported as default
-  std::sort(valid_latencies.begin(), valid_latencies.end());
-
-  return valid_latencies;
-}
-
 nic::Error
 InferenceProfiler::SummarizeLatency(
-    const std::vector<uint64_t>& latencies, PerfStatus& summary)
+    const RequestLatencies& request_latencies, PerfStatus& summary)
 {
-  if (latencies.size() == 0) {
+  const LatencyHistogram& latencies = request_latencies.latencies_;
+  if (latencies.Count() == 0) {
     return nic::Error(
         ni::RequestStatusCode::INTERNAL,
         "No valid requests recorded within time interval."
         " Please use a larger time window.");
   }
 
-  uint64_t tol_latency_ns = 0;
-  uint64_t tol_square_latency_us = 0;
-
-  for (const auto& latency : latencies) {
-    tol_latency_ns += latency;
-    tol_square_latency_us += (latency * latency) / (1000 * 1000);
-  }
-
-  summary.client_avg_latency_ns = tol_latency_ns / latencies.size();
+  summary.client_avg_latency_ns = latencies.Mean();
+  summary.client_max_latency_ns = latencies.Max();
 
   // retrieve other interesting percentile
   summary.client_percentile_latency_ns.clear();
-  std::set<size_t> percentiles{50, 90, 95, 99};
+  std::set<double> percentiles{50, 90, 95, 99, 99.9};
   if (extra_percentile_) {
     percentiles.emplace(percentile_);
   }
 
   for (const auto percentile : percentiles) {
-    size_t index = (percentile / 100.0) * (latencies.size() - 1) + 0.5;
-    summary.client_percentile_latency_ns.emplace(percentile, latencies[index]);
+    summary.client_percentile_latency_ns.emplace(
+        percentile, latencies.ValueAtPercentile(percentile));
+  }
+
+  // Correct for coordinated omission. Measuring from the intended send time
+  // counts the time that the client fell behind. With a fixed number of
+  // concurrent requests, a slot sends nothing while its request is stalled,
+  // so also add the requests that it would have sent at the typical latency
+  // in the meantime.
+  LatencyHistogram corrected;
+  if (summary.request_rate == 0) {
+    request_latencies.intended_latencies_.CopyCorrectedForCoordinatedOmission(
+        latencies.ValueAtPercentile(50), &corrected);
+  } else {
+    corrected = request_latencies.intended_latencies_;
+  }
+
+  summary.client_corrected_percentile_latency_ns.clear();
+  for (const auto percentile : percentiles) {
+    summary.client_corrected_percentile_latency_ns.emplace(
+        percentile, corrected.ValueAtPercentile(percentile));
   }
+  summary.client_corrected_max_latency_ns = corrected.Max();
+
+  const LatencyHistogram& sequence_step_latencies =
+      request_latencies.sequence_step_latencies_;
+  summary.client_sequence_step_percentile_latency_ns.clear();
+  if (sequence_step_latencies.Count() != 0) {
+    for (const auto percentile : percentiles) {
+      summary.client_sequence_step_percentile_latency_ns.emplace(
+          percentile, sequence_step_latencies.ValueAtPercentile(percentile));
+    }
+  }
+  summary.client_sequence_step_max_latency_ns = sequence_step_latencies.Max();
+
+  const std::vector<std::pair<
+      const LatencyHistogram*, std::map<double, uint64_t>*>>
+      stages{{&request_latencies.marshal_latencies_,
+              &summary.client_marshal_percentile_ns},
+             {&request_latencies.response_wait_latencies_,
+              &summary.client_response_wait_percentile_ns},
+             {&request_latencies.unmarshal_latencies_,
+              &summary.client_unmarshal_percentile_ns}};
+  for (const auto& stage : stages) {
+    stage.second->clear();
+    if (stage.first->Count() != 0) {
+      for (const auto percentile : percentiles) {
+        stage.second->emplace(
+            percentile, stage.first->ValueAtPercentile(percentile));
+      }
+    }
+  }
+
+  // The measurement does not reflect the intended load if more than 1% of
+  // the requests were delayed
+  summary.client_delayed_request_count = request_latencies.delayed_count_;
+  summary.client_max_send_delay_ns = request_latencies.max_send_delay_ns_;
+  summary.client_load_delayed =
+      (request_latencies.delayed_count_ * 100) > latencies.Count();
 
   if (extra_percentile_) {
     summary.stabilizing_latency_ns =
@@ -408,16 +497,7 @@ InferenceProfiler::SummarizeLatency(
     summary.stabilizing_latency_ns = summary.client_avg_latency_ns;
   }
 
-  // calculate standard deviation
-  uint64_t expected_square_latency_us =
-      tol_square_latency_us / latencies.size();
-  uint64_t square_avg_latency_us =
-      (summary.client_avg_latency_ns * summary.client_avg_latency_ns) /
-      (1000 * 1000);
-  uint64_t var_us = (expected_square_latency_us > square_avg_latency_us)
-                        ? (expected_square_latency_us - square_avg_latency_us)
-                        : 0;
-  summary.std_us = (uint64_t)(sqrt(var_us));
+  summary.std_us = latencies.StdDev() / 1000;
 
   return nic::Error::Success;
 }
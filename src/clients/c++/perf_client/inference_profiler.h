@@ -25,8 +25,10 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <functional>
 #include <thread>
 #include "src/clients/c++/perf_client/context_factory.h"
+#include "src/clients/c++/perf_client/gpu_metrics.h"
 #include "src/clients/c++/perf_client/load_manager.h"
 
 
@@ -69,8 +71,24 @@ struct ServerSideStats {
   std::map<ModelInfo, ServerSideStats> composing_models_stat;
 };
 
+/// The client side measurement of a single measurement window.
+struct MeasurementWindow {
+  uint64_t duration_ns;
+  uint64_t request_count;
+  int infer_per_sec;
+  uint64_t avg_latency_ns;
+  std::map<double, uint64_t> percentile_latency_ns;
+  uint64_t max_latency_ns;
+  // The state of the GPUs at the end of the window, empty if the metrics
+  // endpoint is not given
+  std::vector<GpuMetrics> gpu_metrics;
+};
+
 struct PerfStatus {
   uint32_t concurrency;
+  // The request rate of the measurement, 0 if the measurement is made
+  // with a fixed number of concurrent requests
+  double request_rate;
   size_t batch_size;
   // Request count and elapsed time measured by server
   ServerSideStats server_stats;
@@ -79,15 +97,37 @@ struct PerfStatus {
   uint64_t client_request_count;
   // Only record sequences that finish within the measurement window
   uint64_t client_sequence_count;
+  // The percentiles of the average request latency of each sequence that
+  // finishes within the measurement window, empty if none finishes
+  std::map<double, uint64_t> client_sequence_step_percentile_latency_ns;
+  uint64_t client_sequence_step_max_latency_ns;
   uint64_t client_duration_ns;
   uint64_t client_avg_latency_ns;
   // a ordered map of percentiles to be reported (<percentile, value> pair)
-  std::map<size_t, uint64_t> client_percentile_latency_ns;
+  std::map<double, uint64_t> client_percentile_latency_ns;
+  uint64_t client_max_latency_ns;
+  // The same percentiles corrected for coordinated omission, i.e. measured
+  // from the time that the requests should have been sent
+  std::map<double, uint64_t> client_corrected_percentile_latency_ns;
+  uint64_t client_corrected_max_latency_ns;
+  // The number of requests that were not sent at the intended time and the
+  // maximum delay, the client fell behind the intended load if
+  // 'client_load_delayed' is set
+  uint64_t client_delayed_request_count;
+  uint64_t client_max_send_delay_ns;
+  bool client_load_delayed;
   // Using usec to avoid square of large number (large in nsec)
   uint64_t std_us;
   uint64_t client_avg_request_time_ns;
   uint64_t client_avg_send_time_ns;
   uint64_t client_avg_receive_time_ns;
+  // The percentiles of the time that the client library spent building
+  // the requests, waiting from sending a request until the first byte of
+  // its response, and extracting the responses. A map is empty if the
+  // protocol doesn't measure the stage.
+  std::map<double, uint64_t> client_marshal_percentile_ns;
+  std::map<double, uint64_t> client_response_wait_percentile_ns;
+  std::map<double, uint64_t> client_unmarshal_percentile_ns;
   // Per sec stat
   int client_infer_per_sec;
   int client_sequence_per_sec;
@@ -95,6 +135,13 @@ struct PerfStatus {
 
   // placeholder for the latency value that is used for conditional checking
   uint64_t stabilizing_latency_ns;
+
+  // The state of the GPUs at the end of the measurement, empty if the
+  // metrics endpoint is not given
+  std::vector<GpuMetrics> gpu_metrics;
+  // Every measurement window taken until the measurement is stable, the
+  // last window is the one summarized above
+  std::vector<MeasurementWindow> windows;
 };
 
 
@@ -109,13 +156,13 @@ struct PerfStatus {
 /// 'status_summary' based on the most recent measurement.
 ///
 /// The measurement procedure:
-/// 1. The profiler gets start status from the server and records the start
-/// time.
-/// 2. After given time interval, the profiler gets end status from the server
-///    and records the end time.
-/// 3. The profiler obtains the timestamps recorded by concurrency manager,
-///    and uses the timestamps that are recorded between start time and end time
-///    to measure client side status and update status_summary.
+/// 1. The profiler gets start status from the server, discards the requests
+///    recorded by the load manager so far and records the start time.
+/// 2. After given time interval, the profiler obtains the latencies of the
+///    requests completed during the interval from the load manager, records
+///    the end time and gets end status from the server.
+/// 3. The profiler uses the latencies and the elapsed time to measure client
+///    side status and update status_summary.
 ///
 class InferenceProfiler {
  public:
@@ -133,13 +180,17 @@ class InferenceProfiler {
   /// if it is a valid percentile value, the percentile latency will reported
   /// and used as stable criteria instead of average latency. If it is -1,
   /// average latency will be reported and used as stable criteria.
+  /// \param metrics_url The URL of the metrics endpoint of the server that
+  /// the GPU metrics are scraped from at the end of each measurement window.
+  /// Empty to not collect GPU metrics.
   /// \param factory The ContextFactory object used to create InferContext.
   /// \param manger Returns a new InferenceProfiler object.
   /// \return Error object indicating success or failure.
   static nic::Error Create(
       const bool verbose, const double stable_offset,
       const uint64_t measurement_window_ms, const size_t max_measurement_count,
-      const int64_t percentile, std::shared_ptr<ContextFactory>& factory,
+      const int64_t percentile, const std::string& metrics_url,
+      std::shared_ptr<ContextFactory>& factory,
       std::unique_ptr<LoadManager> manager,
       std::unique_ptr<InferenceProfiler>* profiler);
 
@@ -157,6 +208,34 @@ class InferenceProfiler {
   nic::Error Profile(
       const size_t concurrent_request_count, PerfStatus& status_summary);
 
+  /// Send requests with 'concurrent_request_count' concurrent requests for
+  /// 'warmup_ms' msec without measuring them, so that the following
+  /// Profile() at the same concurrency does not measure the cost of
+  /// warming up the model and the load.
+  /// \param concurrent_request_count The concurrency level of the warmup.
+  /// \param warmup_ms The duration of the warmup in msec.
+  /// \return Error object indicating success or failure.
+  nic::Error Warmup(
+      const size_t concurrent_request_count, const uint64_t warmup_ms);
+
+  /// Same as Profile() except that requests are sent at the rate
+  /// 'request_rate' instead of with a fixed number of concurrent requests.
+  /// \param request_rate The request rate for the measurement.
+  /// \param status_summary Returns the summary of the measurement.
+  /// \return Error object indicating success or failure.
+  nic::Error ProfileRequestRate(
+      const double request_rate, PerfStatus& status_summary);
+
+  /// Replay the recorded requests of the load manager once and summarize
+  /// all of them into 'status_summary'. Unlike Profile(), the load is not
+  /// steady, so the measurement is the whole replay instead of a stable
+  /// measurement window.
+  /// \param start_ns The time in nsec (CLOCK_MONOTONIC) that the recorded
+  /// times of the requests are relative to.
+  /// \param status_summary Returns the summary of the replay.
+  /// \return Error object indicating success or failure.
+  nic::Error ProfileReplay(const uint64_t start_ns, PerfStatus& status_summary);
+
  private:
   InferenceProfiler(
       const bool verbose, const double stable_offset,
@@ -164,6 +243,7 @@ class InferenceProfiler {
       const bool extra_percentile, const size_t percentile,
       const ContextFactory::ModelSchedulerType scheduler_type,
       const std::string& model_name, const int64_t model_version,
+      const std::string& metrics_url,
       std::unique_ptr<nic::ServerStatusContext> status_ctx,
       std::unique_ptr<LoadManager> manager);
 
@@ -182,11 +262,27 @@ class InferenceProfiler {
   /// \return Error object indicating success or failure
   nic::Error BuildComposingModelMap(const ni::ServerStatus& server_status);
 
+  /// Helper function to measure repeatedly until the measurement is stable
+  /// or the maximum number of measurements is reached.
+  /// \param status_summary The summary of the most recent measurement.
+  /// \param is_stable Returns whether the measurement is stable.
+  /// \return Error object indicating success or failure.
+  nic::Error ProfileHelper(PerfStatus& status_summary, bool* is_stable);
+
   /// Helper function to perform measurement.
   /// \param status_summary The summary of this measurement.
   /// \return Error object indicating success or failure.
   nic::Error Measure(PerfStatus& status_summary);
 
+  /// Helper function to perform measurement while 'generate_load' runs.
+  /// \param generate_load The function that returns when the measurement
+  /// should end.
+  /// \param status_summary The summary of this measurement.
+  /// \return Error object indicating success or failure.
+  nic::Error Measure(
+      const std::function<nic::Error()>& generate_load,
+      PerfStatus& status_summary);
+
   /// \param server_status Returns the status of the models provided by
   /// the server. If the model being profiled is non-ensemble model,
   /// only its status will be returned. Otherwise, the status of the composing
@@ -201,9 +297,14 @@ class InferenceProfiler {
       ni::ServerStatus& server_status, const ModelInfo model_info,
       std::map<std::string, ni::ModelStatus>* model_status);
 
+  /// Append the client side measurement of the last measurement window to
+  /// the windows of the summary.
+  /// \param status_summary The summary of the last measurement window.
+  void RecordWindow(PerfStatus& status_summary);
+
   /// Sumarize the measurement with the provided statistics.
-  /// \param timestamps The timestamps of the requests completed during the
-  /// measurement.
+  /// \param latencies The requests completed during the measurement.
+  /// \param duration_ns The duration of the measurement in nsec.
   /// \param start_status The model status at the start of the measurement.
   /// \param end_status The model status at the end of the measurement.
   /// \param start_stat The accumulated context status at the start.
@@ -211,35 +312,18 @@ class InferenceProfiler {
   /// \param summary Returns the summary of the measurement.
   /// \return Error object indicating success or failure.
   nic::Error Summarize(
-      const TimestampVector& timestamps,
+      const RequestLatencies& latencies, const uint64_t duration_ns,
       const std::map<std::string, ni::ModelStatus>& start_status,
       const std::map<std::string, ni::ModelStatus>& end_status,
       const nic::InferContext::Stat& start_stat,
       const nic::InferContext::Stat& end_stat, PerfStatus& summary);
 
-  /// \param timestamps The timestamps collected for the measurement.
-  /// \return the start and end timestamp of the measurement window.
-  std::pair<uint64_t, uint64_t> MeasurementTimestamp(
-      const TimestampVector& timestamps);
-
-  /// \param timestamps The timestamps collected for the measurement.
-  /// \param valid_range The start and end timestamp of the measurement window.
-  /// \param valid_sequence_count Returns the number of completed sequences
-  /// during the measurement. A sequence is a set of correlated requests sent to
-  /// sequence model.
-  /// \return the vector of request latencies where the requests are completed
-  /// within the measurement window.
-  std::vector<uint64_t> ValidLatencyMeasurement(
-      const TimestampVector& timestamps,
-      const std::pair<uint64_t, uint64_t>& valid_range,
-      size_t& valid_sequence_count);
-
-  /// \param latencies The vector of request latencies collected.
+  /// \param latencies The requests completed during the measurement.
   /// \param summary Returns the summary that the latency related fields are
   /// set.
   /// \return Error object indicating success or failure.
   nic::Error SummarizeLatency(
-      const std::vector<uint64_t>& latencies, PerfStatus& summary);
+      const RequestLatencies& latencies, PerfStatus& summary);
 
   /// \param start_stat The accumulated context status at the start.
   /// \param end_stat The accumulated context status at the end.
@@ -299,6 +383,7 @@ class InferenceProfiler {
   std::string model_name_;
   int64_t model_version_;
   ComposingModelMap composing_models_map_;
+  std::string metrics_url_;
 
   std::unique_ptr<nic::ServerStatusContext> status_ctx_;
   std::unique_ptr<LoadManager> manager_;
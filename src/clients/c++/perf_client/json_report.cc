@@ -0,0 +1,312 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/clients/c++/perf_client/json_report.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace perfclient {
+
+namespace {
+
+// Minimal writer of indented JSON, the caller is responsible for the
+// calls being well-formed.
+class JsonWriter {
+ public:
+  explicit JsonWriter(std::ostream& out) : out_(out), after_key_(false) {}
+
+  void BeginObject() { Begin('{'); }
+  void EndObject() { End('}'); }
+  void BeginArray() { Begin('['); }
+  void EndArray() { End(']'); }
+
+  void Key(const std::string& key)
+  {
+    Separator();
+    String(key);
+    out_ << ": ";
+    after_key_ = true;
+  }
+
+  void Value(const std::string& value)
+  {
+    Separator();
+    String(value);
+  }
+
+  void Value(const bool value)
+  {
+    Separator();
+    out_ << (value ? "true" : "false");
+  }
+
+  template <typename T>
+  void Value(const T value)
+  {
+    Separator();
+    out_ << value;
+  }
+
+  template <typename T>
+  void Field(const std::string& key, const T& value)
+  {
+    Key(key);
+    Value(value);
+  }
+
+ private:
+  void Begin(const char bracket)
+  {
+    Separator();
+    out_ << bracket;
+    first_.push_back(true);
+  }
+
+  void End(const char bracket)
+  {
+    const bool empty = first_.back();
+    first_.pop_back();
+    if (!empty) {
+      out_ << std::endl << std::string(2 * first_.size(), ' ');
+    }
+    out_ << bracket;
+  }
+
+  // Separate the next value from the previous one in the enclosing
+  // object or array, a value that follows its key is not separated.
+  void Separator()
+  {
+    if (after_key_) {
+      after_key_ = false;
+    } else if (!first_.empty()) {
+      if (!first_.back()) {
+        out_ << ",";
+      }
+      first_.back() = false;
+      out_ << std::endl << std::string(2 * first_.size(), ' ');
+    }
+  }
+
+  void String(const std::string& str)
+  {
+    out_ << '"';
+    for (const char c : str) {
+      if ((c == '"') || (c == '\\')) {
+        out_ << '\\' << c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        out_ << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+             << static_cast<int>(c) << std::dec << std::setfill(' ');
+      } else {
+        out_ << c;
+      }
+    }
+    out_ << '"';
+  }
+
+  std::ostream& out_;
+  std::vector<bool> first_;
+  bool after_key_;
+};
+
+void
+WritePercentiles(
+    JsonWriter& writer, const std::string& key,
+    const std::map<double, uint64_t>& percentiles_ns)
+{
+  writer.Key(key);
+  writer.BeginObject();
+  for (const auto& percentile : percentiles_ns) {
+    std::ostringstream name;
+    name << "p" << percentile.first;
+    writer.Field(name.str(), percentile.second / 1000);
+  }
+  writer.EndObject();
+}
+
+void
+WriteGpuMetrics(JsonWriter& writer, const std::vector<GpuMetrics>& metrics)
+{
+  writer.Key("gpus");
+  writer.BeginArray();
+  for (const auto& gpu : metrics) {
+    writer.BeginObject();
+    writer.Field("uuid", gpu.gpu_uuid_);
+    writer.Field("utilization", gpu.utilization_);
+    writer.Field("memory_used_bytes", gpu.memory_used_bytes_);
+    writer.Field("memory_total_bytes", gpu.memory_total_bytes_);
+    writer.Field("power_usage_watts", gpu.power_usage_);
+    writer.EndObject();
+  }
+  writer.EndArray();
+}
+
+void
+WriteServerStats(
+    JsonWriter& writer, const std::string& model_name,
+    const int64_t model_version, const ServerSideStats& stats)
+{
+  const uint64_t request_count = std::max<uint64_t>(1, stats.request_count);
+  writer.BeginObject();
+  writer.Field("name", model_name);
+  writer.Field("version", model_version);
+  writer.Field("request_count", stats.request_count);
+  writer.Field("avg_request_us", stats.cumm_time_ns / request_count / 1000);
+  writer.Field("avg_queue_us", stats.queue_time_ns / request_count / 1000);
+  writer.Field("avg_compute_us", stats.compute_time_ns / request_count / 1000);
+  writer.Key("composing_models");
+  writer.BeginArray();
+  for (const auto& composing_model : stats.composing_models_stat) {
+    WriteServerStats(
+        writer, composing_model.first.first, composing_model.first.second,
+        composing_model.second);
+  }
+  writer.EndArray();
+  writer.EndObject();
+}
+
+void
+WriteMeasurement(
+    JsonWriter& writer, const std::string& model_name,
+    const int64_t model_version, const PerfStatus& status)
+{
+  writer.BeginObject();
+  writer.Field("concurrency", status.concurrency);
+  writer.Field("request_rate", status.request_rate);
+  writer.Field("batch_size", status.batch_size);
+
+  writer.Key("client");
+  writer.BeginObject();
+  writer.Field("request_count", status.client_request_count);
+  writer.Field("duration_us", status.client_duration_ns / 1000);
+  writer.Field("infer_per_sec", status.client_infer_per_sec);
+  writer.Field("avg_latency_us", status.client_avg_latency_ns / 1000);
+  writer.Field("std_latency_us", status.std_us);
+  WritePercentiles(writer, "latency_us", status.client_percentile_latency_ns);
+  writer.Field("max_latency_us", status.client_max_latency_ns / 1000);
+  WritePercentiles(
+      writer, "corrected_latency_us",
+      status.client_corrected_percentile_latency_ns);
+  writer.Field(
+      "corrected_max_latency_us",
+      status.client_corrected_max_latency_ns / 1000);
+  writer.Field("avg_request_us", status.client_avg_request_time_ns / 1000);
+  writer.Field("avg_send_us", status.client_avg_send_time_ns / 1000);
+  writer.Field("avg_receive_us", status.client_avg_receive_time_ns / 1000);
+  if (!status.client_marshal_percentile_ns.empty()) {
+    WritePercentiles(
+        writer, "marshal_us", status.client_marshal_percentile_ns);
+  }
+  if (!status.client_response_wait_percentile_ns.empty()) {
+    WritePercentiles(
+        writer, "response_wait_us",
+        status.client_response_wait_percentile_ns);
+  }
+  if (!status.client_unmarshal_percentile_ns.empty()) {
+    WritePercentiles(
+        writer, "unmarshal_us", status.client_unmarshal_percentile_ns);
+  }
+  writer.Field("delayed_request_count", status.client_delayed_request_count);
+  writer.Field("max_send_delay_us", status.client_max_send_delay_ns / 1000);
+  writer.Field("load_delayed", status.client_load_delayed);
+  if (status.on_sequence_model) {
+    writer.Field("sequence_count", status.client_sequence_count);
+    writer.Field("sequence_per_sec", status.client_sequence_per_sec);
+    WritePercentiles(
+        writer, "sequence_step_latency_us",
+        status.client_sequence_step_percentile_latency_ns);
+    writer.Field(
+        "sequence_step_max_latency_us",
+        status.client_sequence_step_max_latency_ns / 1000);
+  }
+  writer.EndObject();
+
+  writer.Key("windows");
+  writer.BeginArray();
+  for (const auto& window : status.windows) {
+    writer.BeginObject();
+    writer.Field("duration_us", window.duration_ns / 1000);
+    writer.Field("request_count", window.request_count);
+    writer.Field("infer_per_sec", window.infer_per_sec);
+    writer.Field("avg_latency_us", window.avg_latency_ns / 1000);
+    WritePercentiles(writer, "latency_us", window.percentile_latency_ns);
+    writer.Field("max_latency_us", window.max_latency_ns / 1000);
+    WriteGpuMetrics(writer, window.gpu_metrics);
+    writer.EndObject();
+  }
+  writer.EndArray();
+
+  writer.Key("server");
+  WriteServerStats(writer, model_name, model_version, status.server_stats);
+
+  WriteGpuMetrics(writer, status.gpu_metrics);
+  writer.EndObject();
+}
+
+}  // namespace
+
+nic::Error
+WriteJsonReport(
+    const std::string& filename, const std::vector<ModelReport>& reports)
+{
+  std::ofstream ofs(filename, std::ofstream::out);
+  if (!ofs) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG,
+        "failed to open JSON report file " + filename);
+  }
+
+  JsonWriter writer(ofs);
+  writer.BeginObject();
+  writer.Key("models");
+  writer.BeginArray();
+  for (const auto& report : reports) {
+    writer.BeginObject();
+    writer.Field("name", report.model_name_);
+    writer.Field("version", report.model_version_);
+    if (report.instance_count_ != 0) {
+      writer.Field("instance_count", report.instance_count_);
+    }
+    writer.Key("measurements");
+    writer.BeginArray();
+    for (const auto& status : report.measurements_) {
+      WriteMeasurement(
+          writer, report.model_name_, report.model_version_, status);
+    }
+    writer.EndArray();
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.EndObject();
+  ofs << std::endl;
+  ofs.close();
+
+  return nic::Error::Success;
+}
+
+}  // namespace perfclient
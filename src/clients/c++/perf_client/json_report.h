@@ -0,0 +1,60 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "src/clients/c++/perf_client/inference_profiler.h"
+
+#include <string>
+#include <vector>
+
+namespace perfclient {
+
+/// The measurements of one model to be written to a JSON report.
+struct ModelReport {
+  std::string model_name_;
+  int64_t model_version_;
+  std::vector<PerfStatus> measurements_;
+  // The number of instances the model was reloaded with for the
+  // measurements, 0 if the model was measured as loaded.
+  size_t instance_count_;
+};
+
+/// Write the measurements in JSON so that runs can be compared by tools:
+///
+///   {"models": [{"name": ..., "version": ..., "measurements": [...]}]}
+///
+/// Each measurement has the load, the client side statistic, the client
+/// side statistic of every measurement window, the server side statistic
+/// of the model and, recursively, of its composing models, and the state
+/// of the GPUs if scraped. The times are in usec.
+/// \param filename The file to write the report to.
+/// \param reports The measurements of each model.
+/// \return Error object indicating success or failure.
+nic::Error WriteJsonReport(
+    const std::string& filename, const std::vector<ModelReport>& reports);
+
+}  // namespace perfclient
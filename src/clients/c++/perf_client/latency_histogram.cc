@@ -0,0 +1,226 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/clients/c++/perf_client/latency_histogram.h"
+
+#include <math.h>
+#include <algorithm>
+#include <limits>
+
+namespace perfclient {
+
+LatencyHistogram::LatencyHistogram()
+{
+  Reset();
+}
+
+size_t
+LatencyHistogram::Index(const uint64_t value)
+{
+  if (value < (2 * SUB_BUCKET_COUNT)) {
+    return value;
+  }
+
+  // Shift the value so that it falls in [SUB_BUCKET_COUNT,
+  // 2 * SUB_BUCKET_COUNT), each shift is a bucket of SUB_BUCKET_COUNT
+  // sub-buckets following the exact values.
+  const uint32_t shift = (63 - __builtin_clzll(value)) - SUB_BUCKET_BITS;
+  return (shift + 1) * SUB_BUCKET_COUNT + ((value >> shift) - SUB_BUCKET_COUNT);
+}
+
+uint64_t
+LatencyHistogram::HighestEquivalentValue(const size_t index)
+{
+  if (index < (2 * SUB_BUCKET_COUNT)) {
+    return index;
+  }
+
+  const uint32_t shift = (index / SUB_BUCKET_COUNT) - 1;
+  const uint64_t sub_bucket = (index % SUB_BUCKET_COUNT) + SUB_BUCKET_COUNT;
+  return ((sub_bucket + 1) << shift) - 1;
+}
+
+void
+LatencyHistogram::Record(const uint64_t value)
+{
+  Record(value, 1);
+}
+
+void
+LatencyHistogram::Record(const uint64_t value, const uint64_t count)
+{
+  const size_t index = Index(value);
+  if (index >= counts_.size()) {
+    counts_.resize(index + 1, 0);
+  }
+  counts_[index] += count;
+
+  count_ += count;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, value);
+  sum_ += (double)value * count;
+  sum_of_squares_ += (double)value * value * count;
+}
+
+void
+LatencyHistogram::Merge(const LatencyHistogram& other)
+{
+  if (other.counts_.size() > counts_.size()) {
+    counts_.resize(other.counts_.size(), 0);
+  }
+  for (size_t i = 0; i < other.counts_.size(); ++i) {
+    counts_[i] += other.counts_[i];
+  }
+
+  count_ += other.count_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+  sum_ += other.sum_;
+  sum_of_squares_ += other.sum_of_squares_;
+}
+
+void
+LatencyHistogram::Reset()
+{
+  counts_.clear();
+  count_ = 0;
+  min_ = UINT64_MAX;
+  max_ = 0;
+  sum_ = 0;
+  sum_of_squares_ = 0;
+}
+
+void
+LatencyHistogram::Serialize(std::ostream& out) const
+{
+  // Only the non-empty sub-buckets are written, as (index, count) pairs
+  size_t non_empty = 0;
+  for (const auto count : counts_) {
+    non_empty += (count != 0) ? 1 : 0;
+  }
+
+  const auto precision =
+      out.precision(std::numeric_limits<double>::digits10 + 2);
+  out << count_ << " " << min_ << " " << max_ << " " << sum_ << " "
+      << sum_of_squares_ << " " << counts_.size() << " " << non_empty;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    if (counts_[i] != 0) {
+      out << " " << i << " " << counts_[i];
+    }
+  }
+  out.precision(precision);
+}
+
+bool
+LatencyHistogram::Deserialize(std::istream& in)
+{
+  Reset();
+
+  size_t size, non_empty;
+  if (!(in >> count_ >> min_ >> max_ >> sum_ >> sum_of_squares_ >> size >>
+        non_empty)) {
+    return false;
+  }
+  counts_.resize(size, 0);
+  for (size_t i = 0; i < non_empty; ++i) {
+    size_t index;
+    uint64_t count;
+    if (!(in >> index >> count) || (index >= size)) {
+      Reset();
+      return false;
+    }
+    counts_[index] = count;
+  }
+  return true;
+}
+
+void
+LatencyHistogram::CopyCorrectedForCoordinatedOmission(
+    const uint64_t expected_interval, LatencyHistogram* corrected) const
+{
+  *corrected = *this;
+  if ((expected_interval == 0) || (count_ == 0)) {
+    return;
+  }
+
+  // The synthetic values are derived from the value of each sub-bucket,
+  // which is within the resolution of the histogram.
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    if (counts_[i] == 0) {
+      continue;
+    }
+
+    const uint64_t value = std::min(HighestEquivalentValue(i), max_);
+    for (uint64_t missing = (value > expected_interval)
+                                ? (value - expected_interval)
+                                : 0;
+         missing >= expected_interval; missing -= expected_interval) {
+      corrected->Record(missing, counts_[i]);
+    }
+  }
+}
+
+uint64_t
+LatencyHistogram::Mean() const
+{
+  return (count_ == 0) ? 0 : (uint64_t)(sum_ / count_);
+}
+
+uint64_t
+LatencyHistogram::StdDev() const
+{
+  if (count_ == 0) {
+    return 0;
+  }
+
+  const double mean = sum_ / count_;
+  const double var = (sum_of_squares_ / count_) - (mean * mean);
+  return (var > 0) ? (uint64_t)sqrt(var) : 0;
+}
+
+uint64_t
+LatencyHistogram::ValueAtPercentile(const double percentile) const
+{
+  if (count_ == 0) {
+    return 0;
+  }
+
+  // The rank of the value at the percentile, at least the first value
+  uint64_t rank = (uint64_t)ceil((percentile / 100.0) * count_);
+  rank = std::max((uint64_t)1, std::min(rank, count_));
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      return std::min(HighestEquivalentValue(i), max_);
+    }
+  }
+
+  return max_;
+}
+
+}  // namespace perfclient
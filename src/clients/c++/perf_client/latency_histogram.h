@@ -0,0 +1,132 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace perfclient {
+
+//==============================================================================
+/// LatencyHistogram records latency values in a histogram with a fixed
+/// relative resolution, in the style of an HDR histogram. Values below
+/// 2 * SUB_BUCKET_COUNT are recorded exactly. Larger values are recorded in
+/// buckets whose width is a power of two, each divided into SUB_BUCKET_COUNT
+/// sub-buckets, so a value is recorded with an error of at most
+/// 1 / SUB_BUCKET_COUNT (about 0.1%) of the value. The memory used only
+/// depends on the largest value recorded and recording takes constant
+/// time, so any number of values can be recorded.
+///
+/// Histograms recorded separately (for example by different threads) can be
+/// merged. A LatencyHistogram is not thread-safe.
+///
+class LatencyHistogram {
+ public:
+  LatencyHistogram();
+
+  /// Record a value.
+  /// \param value The value to record.
+  void Record(const uint64_t value);
+
+  /// Add the values recorded in another histogram to this histogram.
+  /// \param other The histogram to merge.
+  void Merge(const LatencyHistogram& other);
+
+  /// Remove all recorded values.
+  void Reset();
+
+  /// Get a copy of this histogram corrected for coordinated omission. A
+  /// load generator that waits for a response before sending the next
+  /// request sends no requests while the server stalls, so a stall is
+  /// recorded as a single large value. For each recorded value larger than
+  /// 'expected_interval' the copy also contains the values that the
+  /// requests that would have been sent every 'expected_interval' during
+  /// the stall would have had (value - expected_interval,
+  /// value - 2 * expected_interval, ...).
+  /// \param expected_interval The expected interval between requests, the
+  /// copy is not corrected if 0.
+  /// \param corrected Returns the corrected copy.
+  void CopyCorrectedForCoordinatedOmission(
+      const uint64_t expected_interval, LatencyHistogram* corrected) const;
+
+  /// Write the histogram to a stream as text, so that it can be sent to
+  /// another host and merged there.
+  /// \param out The stream to write to.
+  void Serialize(std::ostream& out) const;
+
+  /// Replace the histogram with one written by Serialize().
+  /// \param in The stream to read from.
+  /// \return Whether the histogram was read successfully.
+  bool Deserialize(std::istream& in);
+
+  /// \return The number of values recorded.
+  uint64_t Count() const { return count_; }
+
+  /// \return The smallest value recorded, 0 if no value is recorded.
+  uint64_t Min() const { return (count_ == 0) ? 0 : min_; }
+
+  /// \return The largest value recorded, 0 if no value is recorded.
+  uint64_t Max() const { return max_; }
+
+  /// \return The average of the recorded values, 0 if no value is recorded.
+  uint64_t Mean() const;
+
+  /// \return The standard deviation of the recorded values.
+  uint64_t StdDev() const;
+
+  /// Get the value at a percentile. The value is the largest value that is
+  /// recorded in the same sub-bucket as the value at the percentile, but
+  /// no larger than the largest value recorded.
+  /// \param percentile The percentile, in range [0, 100].
+  /// \return The value at the percentile, 0 if no value is recorded.
+  uint64_t ValueAtPercentile(const double percentile) const;
+
+ private:
+  // The number of sub-buckets in each bucket, as a power of two.
+  static constexpr uint32_t SUB_BUCKET_BITS = 10;
+  static constexpr uint64_t SUB_BUCKET_COUNT = (1 << SUB_BUCKET_BITS);
+
+  static size_t Index(const uint64_t value);
+  static uint64_t HighestEquivalentValue(const size_t index);
+
+  // Record 'count' occurrences of a value.
+  void Record(const uint64_t value, const uint64_t count);
+
+  std::vector<uint64_t> counts_;
+  uint64_t count_;
+  uint64_t min_;
+  uint64_t max_;
+
+  // The sum of the values and of the squares of the values, used to
+  // compute the exact mean and standard deviation.
+  double sum_;
+  double sum_of_squares_;
+};
+
+}  // namespace perfclient
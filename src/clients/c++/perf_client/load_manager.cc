@@ -0,0 +1,579 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/clients/c++/perf_client/load_manager.h"
+
+#include "src/core/model_config.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+
+#ifdef TRTIS_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRTIS_ENABLE_GPU
+
+namespace perfclient {
+
+namespace {
+
+#ifdef TRTIS_ENABLE_GPU
+#define RETURN_IF_CUDA_ERR(X, MSG)                                   \
+  do {                                                               \
+    cudaError_t cuda_err__ = (X);                                    \
+    if (cuda_err__ != cudaSuccess) {                                 \
+      return nic::Error(                                             \
+          ni::RequestStatusCode::INTERNAL,                           \
+          std::string(MSG) + ": " + cudaGetErrorString(cuda_err__)); \
+    }                                                                \
+  } while (false)
+#endif  // TRTIS_ENABLE_GPU
+
+// Create a system shared memory region of 'byte_size' bytes with 'key'
+// and map it into the address space of the process.
+nic::Error
+CreateSystemSharedMemory(
+    const std::string& key, const size_t byte_size, void** addr)
+{
+  int shm_fd = shm_open(key.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+  if (shm_fd == -1) {
+    return nic::Error(
+        ni::RequestStatusCode::INTERNAL,
+        "unable to create shared memory region '" + key + "'");
+  }
+  if (ftruncate(shm_fd, byte_size) == -1) {
+    close(shm_fd);
+    shm_unlink(key.c_str());
+    return nic::Error(
+        ni::RequestStatusCode::INTERNAL,
+        "unable to set the size of shared memory region '" + key + "'");
+  }
+  *addr = mmap(NULL, byte_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+  close(shm_fd);
+  if (*addr == MAP_FAILED) {
+    shm_unlink(key.c_str());
+    return nic::Error(
+        ni::RequestStatusCode::INTERNAL,
+        "unable to map shared memory region '" + key + "'");
+  }
+
+  return nic::Error::Success;
+}
+
+}  // namespace
+
+void
+RequestLatencies::Record(
+    const uint64_t intended_ns, const uint64_t send_ns, const uint64_t end_ns,
+    const bool sequence_end)
+{
+  latencies_.Record((end_ns > send_ns) ? (end_ns - send_ns) : 0);
+  intended_latencies_.Record(
+      (end_ns > intended_ns) ? (end_ns - intended_ns) : 0);
+  if (sequence_end) {
+    sequence_count_++;
+  }
+
+  const uint64_t send_delay_ns =
+      (send_ns > intended_ns) ? (send_ns - intended_ns) : 0;
+  if (send_delay_ns > SEND_DELAY_THRESHOLD_NS) {
+    delayed_count_++;
+  }
+  max_send_delay_ns_ = std::max(max_send_delay_ns_, send_delay_ns);
+}
+
+void
+RequestLatencies::RecordClientStages(
+    const nic::InferContext& ctx, nic::InferContext::Stat* stat)
+{
+  nic::InferContext::Stat curr;
+  ctx.GetStat(&curr);
+  const size_t count =
+      curr.completed_request_count - stat->completed_request_count;
+  if (count != 0) {
+    const std::vector<std::pair<LatencyHistogram*, uint64_t>> stages{
+        {&marshal_latencies_,
+         curr.cumulative_marshal_time_ns - stat->cumulative_marshal_time_ns},
+        {&response_wait_latencies_, curr.cumulative_response_wait_time_ns -
+                                        stat->cumulative_response_wait_time_ns},
+        {&unmarshal_latencies_, curr.cumulative_unmarshal_time_ns -
+                                    stat->cumulative_unmarshal_time_ns}};
+    for (const auto& stage : stages) {
+      if (stage.second != 0) {
+        for (size_t i = 0; i < count; i++) {
+          stage.first->Record(stage.second / count);
+        }
+      }
+    }
+  }
+
+  *stat = curr;
+}
+
+void
+RequestLatencies::Merge(const RequestLatencies& other)
+{
+  latencies_.Merge(other.latencies_);
+  intended_latencies_.Merge(other.intended_latencies_);
+  sequence_count_ += other.sequence_count_;
+  delayed_count_ += other.delayed_count_;
+  max_send_delay_ns_ = std::max(max_send_delay_ns_, other.max_send_delay_ns_);
+  sequence_step_latencies_.Merge(other.sequence_step_latencies_);
+  marshal_latencies_.Merge(other.marshal_latencies_);
+  response_wait_latencies_.Merge(other.response_wait_latencies_);
+  unmarshal_latencies_.Merge(other.unmarshal_latencies_);
+}
+
+void
+RequestLatencies::Reset()
+{
+  latencies_.Reset();
+  intended_latencies_.Reset();
+  sequence_count_ = 0;
+  delayed_count_ = 0;
+  max_send_delay_ns_ = 0;
+  sequence_step_latencies_.Reset();
+  marshal_latencies_.Reset();
+  response_wait_latencies_.Reset();
+  unmarshal_latencies_.Reset();
+}
+
+void
+RequestLatencies::Serialize(std::ostream& out) const
+{
+  latencies_.Serialize(out);
+  out << " ";
+  intended_latencies_.Serialize(out);
+  out << " " << sequence_count_ << " " << delayed_count_ << " "
+      << max_send_delay_ns_ << " ";
+  sequence_step_latencies_.Serialize(out);
+  for (const auto* stage :
+       {&marshal_latencies_, &response_wait_latencies_,
+        &unmarshal_latencies_}) {
+    out << " ";
+    stage->Serialize(out);
+  }
+}
+
+bool
+RequestLatencies::Deserialize(std::istream& in)
+{
+  if (latencies_.Deserialize(in) && intended_latencies_.Deserialize(in) &&
+      (in >> sequence_count_ >> delayed_count_ >> max_send_delay_ns_) &&
+      sequence_step_latencies_.Deserialize(in) &&
+      marshal_latencies_.Deserialize(in) &&
+      response_wait_latencies_.Deserialize(in) &&
+      unmarshal_latencies_.Deserialize(in)) {
+    return true;
+  }
+  Reset();
+  return false;
+}
+
+LoadManager::LoadManager(
+    const int32_t batch_size, const size_t max_threads,
+    const size_t sequence_length,
+    const std::unordered_map<std::string, std::vector<int64_t>>& input_shapes,
+    const std::shared_ptr<ContextFactory>& factory)
+    : batch_size_(batch_size), max_threads_(max_threads),
+      sequence_length_(sequence_length), factory_(factory),
+      input_shapes_(input_shapes), shared_memory_type_(NO_SHARED_MEMORY)
+{
+  on_sequence_model_ = (factory_->SchedulerType() == ContextFactory::SEQUENCE);
+}
+
+LoadManager::~LoadManager()
+{
+  for (auto* regions : {&shm_inputs_, &shm_outputs_}) {
+    for (const auto& region : *regions) {
+      const std::string& name = region.second.name_;
+      nic::Error err = shm_ctx_->UnregisterSharedMemory(name);
+      if (!err.IsOk()) {
+        std::cerr << "Failed to unregister shared memory region '" << name
+                  << "': " << err << std::endl;
+      }
+      shm_unlink(("/" + name).c_str());
+      if (shared_memory_type_ == SYSTEM_SHARED_MEMORY) {
+        munmap(region.second.addr_, region.second.byte_size_);
+      } else {
+#ifdef TRTIS_ENABLE_GPU
+        cudaFree(region.second.addr_);
+#endif  // TRTIS_ENABLE_GPU
+      }
+    }
+  }
+}
+
+nic::Error
+LoadManager::InitManager(
+    const bool zero_input, const std::string& data_directory,
+    const SharedMemoryType shared_memory_type, const size_t output_shm_size)
+{
+  std::unique_ptr<nic::InferContext> ctx;
+  RETURN_IF_ERROR(factory_->CreateInferContext(&ctx));
+
+  size_t max_input_byte_size = 0;
+  for (const auto& input : ctx->Inputs()) {
+    // Validate user provided shape
+    if (!input_shapes_.empty()) {
+      auto it = input_shapes_.find(input->Name());
+      if (it != input_shapes_.end()) {
+        const auto& dims = it->second;
+        const auto& config_dims = input->Dims();
+        if (!ni::CompareDimsWithWildcard(config_dims, dims)) {
+          return nic::Error(
+              ni::RequestStatusCode::INVALID_ARG,
+              "input '" + input->Name() + "' expects shape " +
+                  ni::DimsListToString(config_dims) +
+                  " and user supplied shape " + ni::DimsListToString(dims));
+        }
+      }
+    }
+
+    // For variable shape, set the shape if specified
+    if (input->Shape().empty()) {
+      auto it = input_shapes_.find(input->Name());
+      if (it != input_shapes_.end()) {
+        input->SetShape(it->second);
+      }
+    }
+    const int64_t bs = input->ByteSize();
+    if (bs < 0) {
+      std::string error_detail;
+      if (input->Shape().empty()) {
+        error_detail =
+            "has variable-size shape and the shape to be used is not specified";
+      } else {
+        error_detail = "has STRING data type";
+      }
+      return nic::Error(
+          ni::RequestStatusCode::INVALID_ARG,
+          "input '" + input->Name() + "' " + error_detail +
+              ", unable to create input values for "
+              "model '" +
+              ctx->ModelName() + "'");
+    }
+
+    max_input_byte_size =
+        std::max(max_input_byte_size, (size_t)input->ByteSize());
+
+    // Read provided data
+    if (!data_directory.empty()) {
+      const auto file_path = data_directory + "/" + input->Name();
+      auto it = input_data_.emplace(input->Name(), std::vector<char>()).first;
+      RETURN_IF_ERROR(ReadFile(file_path, &it->second));
+    }
+  }
+
+  // Create a zero or randomly (as indicated by zero_input_)
+  // initialized buffer that is large enough to provide the largest
+  // needed input. We (re)use this buffer for all input values.
+  if (zero_input) {
+    input_buf_.resize(max_input_byte_size, 0);
+  } else {
+    input_buf_.resize(max_input_byte_size);
+    for (auto& byte : input_buf_) {
+      byte = rand();
+    }
+  }
+
+  if (shared_memory_type != NO_SHARED_MEMORY) {
+    shared_memory_type_ = shared_memory_type;
+    RETURN_IF_ERROR(InitSharedMemory(ctx, output_shm_size));
+  }
+
+  return nic::Error::Success;
+}
+
+nic::Error
+LoadManager::GetInputData(
+    const std::shared_ptr<nic::InferContext::Input>& input,
+    const uint8_t** data)
+{
+  *data = &input_buf_[0];
+  // if available, use provided data instead
+  auto it = input_data_.find(input->Name());
+  if (it != input_data_.end()) {
+    const size_t batch1_size = (size_t)input->ByteSize();
+    if (batch1_size != it->second.size()) {
+      return nic::Error(
+          ni::RequestStatusCode::INVALID_ARG,
+          "input '" + input->Name() + "' requires " +
+              std::to_string(batch1_size) +
+              " bytes for each batch, but provided data has " +
+              std::to_string(it->second.size()) + " bytes");
+    }
+    *data = (const uint8_t*)&(it->second)[0];
+  }
+
+  return nic::Error::Success;
+}
+
+nic::Error
+LoadManager::InitSharedMemory(
+    const std::unique_ptr<nic::InferContext>& ctx,
+    const size_t output_shm_size)
+{
+#ifndef TRTIS_ENABLE_GPU
+  if (shared_memory_type_ == CUDA_SHARED_MEMORY) {
+    return nic::Error(
+        ni::RequestStatusCode::UNSUPPORTED,
+        "perf_client is built without CUDA shared memory support");
+  }
+#endif  // !TRTIS_ENABLE_GPU
+
+  RETURN_IF_ERROR(factory_->CreateSharedMemoryControlContext(&shm_ctx_));
+
+  // The region names must be unique on the server across perf_client
+  // processes and the models that a single process profiles
+  const std::string prefix = "perf_client_" + std::to_string(getpid()) +
+                             "_" + factory_->ModelName() + "_";
+
+  size_t idx = 0;
+  for (const auto& input : ctx->Inputs()) {
+    const uint8_t* data;
+    RETURN_IF_ERROR(GetInputData(input, &data));
+    const size_t batch1_size = (size_t)input->ByteSize();
+    SharedMemoryRegion region;
+    RETURN_IF_ERROR(CreateSharedMemoryRegion(
+        prefix + "input" + std::to_string(idx++), batch1_size * batch_size_,
+        data, batch_size_, &region));
+    shm_inputs_.emplace(input->Name(), region);
+  }
+
+  idx = 0;
+  for (const auto& output : ctx->Outputs()) {
+    const int64_t batch1_size =
+        ni::GetByteSize(output->DType(), output->Dims());
+    const size_t byte_size =
+        (batch1_size < 0) ? output_shm_size : (batch1_size * batch_size_);
+    SharedMemoryRegion region;
+    RETURN_IF_ERROR(CreateSharedMemoryRegion(
+        prefix + "output" + std::to_string(idx++), byte_size, nullptr, 0,
+        &region));
+    shm_outputs_.emplace(output->Name(), region);
+  }
+
+  return nic::Error::Success;
+}
+
+nic::Error
+LoadManager::CreateSharedMemoryRegion(
+    const std::string& name, const size_t byte_size, const uint8_t* data,
+    const size_t repeat, SharedMemoryRegion* region)
+{
+  const std::string key = "/" + name;
+  region->name_ = name;
+  region->byte_size_ = byte_size;
+  const size_t data_byte_size = (repeat == 0) ? 0 : (byte_size / repeat);
+
+  if (shared_memory_type_ == SYSTEM_SHARED_MEMORY) {
+    RETURN_IF_ERROR(CreateSystemSharedMemory(key, byte_size, &region->addr_));
+    for (size_t i = 0; i < repeat; ++i) {
+      memcpy(
+          (uint8_t*)region->addr_ + (i * data_byte_size), data,
+          data_byte_size);
+    }
+
+    nic::Error err = shm_ctx_->RegisterSharedMemory(name, key, 0, byte_size);
+    if (!err.IsOk()) {
+      munmap(region->addr_, byte_size);
+      shm_unlink(key.c_str());
+      return err;
+    }
+  } else {
+#ifdef TRTIS_ENABLE_GPU
+    int device_id;
+    RETURN_IF_CUDA_ERR(cudaGetDevice(&device_id), "unable to get GPU device");
+    RETURN_IF_CUDA_ERR(
+        cudaMalloc(&region->addr_, byte_size),
+        "unable to allocate CUDA memory");
+    for (size_t i = 0; i < repeat; ++i) {
+      RETURN_IF_CUDA_ERR(
+          cudaMemcpy(
+              (uint8_t*)region->addr_ + (i * data_byte_size), data,
+              data_byte_size, cudaMemcpyHostToDevice),
+          "unable to copy input data to CUDA memory");
+    }
+
+    // The server opens the CUDA memory from its IPC handle, which is
+    // passed in a system shared memory region
+    cudaIpcMemHandle_t ipc_handle;
+    RETURN_IF_CUDA_ERR(
+        cudaIpcGetMemHandle(&ipc_handle, region->addr_),
+        "unable to get CUDA IPC handle");
+    void* handle_addr;
+    RETURN_IF_ERROR(
+        CreateSystemSharedMemory(key, sizeof(ipc_handle), &handle_addr));
+    memcpy(handle_addr, &ipc_handle, sizeof(ipc_handle));
+    munmap(handle_addr, sizeof(ipc_handle));
+
+    nic::Error err = shm_ctx_->RegisterCudaSharedMemory(
+        name, key, 0, sizeof(ipc_handle), 0, byte_size, device_id);
+    if (!err.IsOk()) {
+      shm_unlink(key.c_str());
+      cudaFree(region->addr_);
+      return err;
+    }
+#endif  // TRTIS_ENABLE_GPU
+  }
+
+  return nic::Error::Success;
+}
+
+nic::Error
+LoadManager::CheckHealth()
+{
+  // Check thread status to make sure that the actual load is
+  // consistent to the one being reported
+  // If some thread return early, main thread will return and
+  // the worker thread's error message will be reported
+  // when the load manager's destructor get called.
+  for (auto& thread_status : threads_status_) {
+    if (!thread_status->IsOk()) {
+      return nic::Error(
+          ni::RequestStatusCode::INTERNAL,
+          "Failed to maintain the requested load."
+          " Worker thread(s) failed to generate requests.");
+    }
+  }
+  return nic::Error::Success;
+}
+
+nic::Error
+LoadManager::CollectLatencies(RequestLatencies* latencies)
+{
+  latencies->Reset();
+
+  std::lock_guard<std::mutex> lock(status_report_mutex_);
+  for (auto& thread_latencies : threads_latencies_) {
+    latencies->Merge(*thread_latencies);
+    thread_latencies->Reset();
+  }
+  return nic::Error::Success;
+}
+
+nic::Error
+LoadManager::PrepareInfer(
+    std::unique_ptr<nic::InferContext>* ctx,
+    std::unique_ptr<nic::InferContext::Options>* options)
+{
+  RETURN_IF_ERROR(factory_->CreateInferContext(ctx));
+
+  uint64_t max_batch_size = (*ctx)->MaxBatchSize();
+
+  // Model specifying maximum batch size of 0 indicates that batching
+  // is not supported and so the input tensors do not expect a "N"
+  // dimension (and 'batch_size' should be 1 so that only a single
+  // image instance is inferred at a time).
+  if (max_batch_size == 0) {
+    if (batch_size_ != 1) {
+      return nic::Error(
+          ni::RequestStatusCode::INVALID_ARG,
+          "expecting batch size 1 for model '" + (*ctx)->ModelName() +
+              "' which does not support batching");
+    }
+  } else if (batch_size_ > max_batch_size) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG,
+        "expecting batch size <= " + std::to_string(max_batch_size) +
+            " for model '" + (*ctx)->ModelName() + "'");
+  }
+
+  // Prepare context for 'batch_size' batches. Request that all
+  // outputs be returned.
+  // Only set options if it has not been created, otherwise,
+  // assuming that the options for this model has been created previously
+  if (*options == nullptr) {
+    RETURN_IF_ERROR(nic::InferContext::Options::Create(options));
+
+    (*options)->SetBatchSize(batch_size_);
+    for (const auto& output : (*ctx)->Outputs()) {
+      auto it = shm_outputs_.find(output->Name());
+      if (it != shm_outputs_.end()) {
+        RETURN_IF_ERROR((*options)->AddSharedMemoryResult(
+            output, it->second.name_, 0, it->second.byte_size_));
+      } else {
+        (*options)->AddRawResult(output);
+      }
+    }
+  }
+
+  RETURN_IF_ERROR((*ctx)->SetRunOptions(*(*options)));
+
+  // Set the provided shape for variable shape tensor
+  for (const auto& input : (*ctx)->Inputs()) {
+    if (input->Shape().empty()) {
+      auto it = input_shapes_.find(input->Name());
+      if (it != input_shapes_.end()) {
+        input->SetShape(it->second);
+      }
+    }
+  }
+
+  // Initialize inputs
+  for (const auto& input : (*ctx)->Inputs()) {
+    RETURN_IF_ERROR(input->Reset());
+
+    auto it = shm_inputs_.find(input->Name());
+    if (it != shm_inputs_.end()) {
+      RETURN_IF_ERROR(input->SetSharedMemory(
+          it->second.name_, 0, it->second.byte_size_));
+      continue;
+    }
+
+    size_t batch1_size = (size_t)input->ByteSize();
+    const uint8_t* data;
+    RETURN_IF_ERROR(GetInputData(input, &data));
+    for (size_t i = 0; i < batch_size_; ++i) {
+      RETURN_IF_ERROR(input->SetRaw(data, batch1_size));
+    }
+  }
+
+  return nic::Error::Success;
+}
+
+nic::Error
+LoadManager::GetAccumulatedContextStat(nic::InferContext::Stat* contexts_stat)
+{
+  std::lock_guard<std::mutex> lk(status_report_mutex_);
+  for (auto& thread_contexts_stat : threads_contexts_stat_) {
+    for (auto& context_stat : (*thread_contexts_stat)) {
+      contexts_stat->completed_request_count +=
+          context_stat.completed_request_count;
+      contexts_stat->cumulative_total_request_time_ns +=
+          context_stat.cumulative_total_request_time_ns;
+      contexts_stat->cumulative_send_time_ns +=
+          context_stat.cumulative_send_time_ns;
+      contexts_stat->cumulative_receive_time_ns +=
+          context_stat.cumulative_receive_time_ns;
+    }
+  }
+  return nic::Error::Success;
+}
+
+}  // namespace perfclient
@@ -23,42 +23,261 @@
 // OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
 #pragma once
 
+#include "src/clients/c++/perf_client/context_factory.h"
+#include "src/clients/c++/perf_client/latency_histogram.h"
 #include "src/clients/c++/perf_client/perf_utils.h"
 
+#include <condition_variable>
+#include <thread>
+
 namespace perfclient {
 
+/// A request is considered delayed if it is sent later than this after the
+/// time the load manager intended to send it.
+constexpr uint64_t SEND_DELAY_THRESHOLD_NS = 1000000;
+
+/// The requests completed by the worker threads of a load manager.
+struct RequestLatencies {
+  RequestLatencies()
+      : sequence_count_(0), delayed_count_(0), max_send_delay_ns_(0)
+  {
+  }
+
+  /// Record a completed request.
+  /// \param intended_ns The time that the request should have been sent.
+  /// \param send_ns The time that the request was sent.
+  /// \param end_ns The time that the response was received.
+  /// \param sequence_end Whether the request ends a sequence.
+  void Record(
+      const uint64_t intended_ns, const uint64_t send_ns,
+      const uint64_t end_ns, const bool sequence_end);
+
+  /// Record the time that the client library spent on each stage of the
+  /// requests completed on a context since its stat was last updated, and
+  /// update the stat. If several requests completed in the meantime each
+  /// is recorded with their average.
+  /// \param ctx The context.
+  /// \param stat The stat of 'ctx' as of the last update, returns the
+  /// current stat.
+  void RecordClientStages(
+      const nic::InferContext& ctx, nic::InferContext::Stat* stat);
+
+  /// Add the requests recorded in 'other'.
+  void Merge(const RequestLatencies& other);
+
+  /// Remove all recorded requests.
+  void Reset();
+
+  /// Write the recorded requests to a stream as text.
+  /// \param out The stream to write to.
+  void Serialize(std::ostream& out) const;
+
+  /// Replace the recorded requests with the ones written by Serialize().
+  /// \param in The stream to read from.
+  /// \return Whether the requests were read successfully.
+  bool Deserialize(std::istream& in);
+
+  // The latency of each completed request in nsec, measured from the time
+  // that the request was sent
+  LatencyHistogram latencies_;
+  // The latency of each completed request in nsec, measured from the time
+  // that the request should have been sent
+  LatencyHistogram intended_latencies_;
+  // The number of completed requests that end a sequence
+  uint64_t sequence_count_;
+  // The number of requests that were delayed, i.e. the load manager fell
+  // behind and could not send them at the intended time
+  uint64_t delayed_count_;
+  // The maximum delay between the intended and the actual send time
+  uint64_t max_send_delay_ns_;
+  // The average latency of the requests of each completed sequence
+  LatencyHistogram sequence_step_latencies_;
+  // The time in nsec that the client library spent building each request,
+  // waiting from sending it until the first byte of the response, and
+  // extracting the response. A stage is not recorded for the requests
+  // whose protocol doesn't measure it.
+  LatencyHistogram marshal_latencies_;
+  LatencyHistogram response_wait_latencies_;
+  LatencyHistogram unmarshal_latencies_;
+};
+
+//==============================================================================
+/// LoadManager is the base class of the helper classes that send inference
+/// requests to the inference server to produce a specific load. It prepares
+/// the input data shared by all requests and collects the per-request
+/// statistic recorded by the worker threads of the derived class.
+///
 class LoadManager {
  public:
-  /// Virtual destructor for well defined cleanup
-  virtual ~LoadManager(){};
+  /// Virtual destructor for well defined cleanup. The shared memory regions
+  /// are released here, after the derived class has stopped its workers.
+  virtual ~LoadManager();
 
   /// Adjust the number of concurrent requests to be the same as
   /// 'concurrent_request_count' (by creating threads or by pausing threads)
   /// \parm concurent_request_count The number of concurrent requests.
   /// \return Error object indicating success or failure.
   virtual nic::Error ChangeConcurrencyLevel(
-      const size_t concurrent_request_count) = 0;
+      const size_t concurrent_request_count)
+  {
+    return nic::Error(
+        ni::RequestStatusCode::UNSUPPORTED,
+        "load manager does not support changing the concurrency level");
+  }
+
+  /// Adjust the rate at which requests are issued to be the same as
+  /// 'request_rate'.
+  /// \param request_rate The number of requests to issue per second.
+  /// \return Error object indicating success or failure.
+  virtual nic::Error ChangeRequestRate(const double request_rate)
+  {
+    return nic::Error(
+        ni::RequestStatusCode::UNSUPPORTED,
+        "load manager does not support changing the request rate");
+  }
+
+  /// Send the recorded requests of the load manager, each at its recorded
+  /// time relative to 'start_ns', and wait until all of them complete.
+  /// \param start_ns The time in nsec (CLOCK_MONOTONIC) that the recorded
+  /// times are relative to.
+  /// \return Error object indicating success or failure.
+  virtual nic::Error Replay(const uint64_t start_ns)
+  {
+    return nic::Error(
+        ni::RequestStatusCode::UNSUPPORTED,
+        "load manager does not support replaying requests");
+  }
 
   /// Check if the load manager is working as expected.
   /// \return Error object indicating success or failure.
-  virtual nic::Error CheckHealth() = 0;
+  virtual nic::Error CheckHealth();
 
-  /// Swap the content of the timestamp vector recorded by the load
-  /// manager with a new timestamp vector
-  /// \param new_timestamps The timestamp vector to be swapped.
+  /// Get the requests completed since the last call, merged across all
+  /// worker threads, and start recording anew.
+  /// \param latencies Returns the requests completed since the last call.
   /// \return Error object indicating success or failure.
-  virtual nic::Error SwapTimestamps(TimestampVector& new_timestamps) = 0;
+  virtual nic::Error CollectLatencies(RequestLatencies* latencies);
 
   /// Get the sum of all contexts' stat
   /// \param contexts_stat Returned the accumulated stat from all contexts
   /// in load manager
   virtual nic::Error GetAccumulatedContextStat(
-      nic::InferContext::Stat* contexts_stat) = 0;
+      nic::InferContext::Stat* contexts_stat);
 
   /// \return the batch size used for the inference requests
-  virtual size_t BatchSize() const = 0;
+  size_t BatchSize() const { return batch_size_; }
+
+ protected:
+  LoadManager(
+      const int32_t batch_size, const size_t max_threads,
+      const size_t sequence_length,
+      const std::unordered_map<std::string, std::vector<int64_t>>& input_shapes,
+      const std::shared_ptr<ContextFactory>& factory);
+
+  /// Validate the model inputs and prepare the data used for them.
+  /// \param zero_input Whether to fill the input tensors with zero.
+  /// \param data_directory The directory containing the user provided
+  /// data for each input, or empty to use synthetic data.
+  /// \param shared_memory_type The type of shared memory used to pass the
+  /// input and output tensors, or NO_SHARED_MEMORY to pass them in the
+  /// requests and responses.
+  /// \param output_shm_size The size in bytes of the shared memory region
+  /// of an output whose size can't be derived from the model configuration.
+  /// \return Error object indicating success or failure.
+  nic::Error InitManager(
+      const bool zero_input, const std::string& data_directory,
+      const SharedMemoryType shared_memory_type, const size_t output_shm_size);
+
+  /// Helper function to prepare the InferContext for sending inference request.
+  /// \param ctx Returns a new InferContext.
+  /// \param options Returns the options used by 'ctx'.
+  nic::Error PrepareInfer(
+      std::unique_ptr<nic::InferContext>* ctx,
+      std::unique_ptr<nic::InferContext::Options>* options);
+
+  /// A shared memory region that holds the tensor values of an input or an
+  /// output for all requests. The output values of concurrent requests
+  /// overwrite each other, which is fine as they are never read.
+  struct SharedMemoryRegion {
+    // The name registered with the server, the region is also created
+    // with key '/' + 'name_'
+    std::string name_;
+    size_t byte_size_;
+    // The address of the system shared memory or the CUDA device memory
+    void* addr_;
+  };
+
+  /// Get the data of a single batch of 'input'.
+  /// \param input The input.
+  /// \param data Returns the data, the user provided data if available.
+  /// \return Error object indicating success or failure.
+  nic::Error GetInputData(
+      const std::shared_ptr<nic::InferContext::Input>& input,
+      const uint8_t** data);
+
+  /// Create and register the shared memory regions of the inputs and
+  /// outputs of the model.
+  /// \param ctx The InferContext whose inputs have their shapes set.
+  /// \param output_shm_size The size of the region of an output whose size
+  /// can't be derived from the model configuration.
+  /// \return Error object indicating success or failure.
+  nic::Error InitSharedMemory(
+      const std::unique_ptr<nic::InferContext>& ctx,
+      const size_t output_shm_size);
+
+  /// Create a shared memory region of 'shared_memory_type_' and register it
+  /// with the server.
+  /// \param name The name of the region.
+  /// \param byte_size The size of the region in bytes.
+  /// \param data The values to fill the region with 'repeat' times, or
+  /// nullptr to leave the region uninitialized.
+  /// \param repeat The number of times to copy 'data' into the region.
+  /// \param region Returns the region.
+  /// \return Error object indicating success or failure.
+  nic::Error CreateSharedMemoryRegion(
+      const std::string& name, const size_t byte_size, const uint8_t* data,
+      const size_t repeat, SharedMemoryRegion* region);
+
+  size_t batch_size_;
+  size_t max_threads_;
+  size_t sequence_length_;
+
+  bool on_sequence_model_;
+
+  std::shared_ptr<ContextFactory> factory_;
+
+  // User provided input shape
+  std::unordered_map<std::string, std::vector<int64_t>> input_shapes_;
+
+  // User provided input data, it will be preferred over synthetic data
+  std::unordered_map<std::string, std::vector<char>> input_data_;
+
+  // Placeholder for generated input data, which will be used for all inputs
+  std::vector<uint8_t> input_buf_;
+
+  // The shared memory regions of the inputs and outputs, keyed by the
+  // tensor name, used if 'shared_memory_type_' is not NO_SHARED_MEMORY
+  SharedMemoryType shared_memory_type_;
+  std::unique_ptr<nic::SharedMemoryControlContext> shm_ctx_;
+  std::unordered_map<std::string, SharedMemoryRegion> shm_inputs_;
+  std::unordered_map<std::string, SharedMemoryRegion> shm_outputs_;
+
+  // Note: early_exit signal is kept global
+  std::vector<std::thread> threads_;
+  std::vector<std::shared_ptr<nic::Error>> threads_status_;
+  std::vector<std::shared_ptr<std::vector<nic::InferContext::Stat>>>
+      threads_contexts_stat_;
+  // The requests completed by each worker thread, request latency is the
+  // time between sending (or intending to send) the request and receiving
+  // the response.
+  std::vector<std::shared_ptr<RequestLatencies>> threads_latencies_;
+
+  // Mutex to avoid race condition on recording the completed requests
+  // and on updating context statistic.
+  std::mutex status_report_mutex_;
 };
 
 }  // namespace perfclient
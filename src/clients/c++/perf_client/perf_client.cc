@@ -25,12 +25,20 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <getopt.h>
+#include <google/protobuf/text_format.h>
+#include <sstream>
+#include <tuple>
 
 #include "src/clients/c++/perf_client/concurrency_manager.h"
 #include "src/clients/c++/perf_client/context_factory.h"
+#include "src/clients/c++/perf_client/distributed_load_manager.h"
 #include "src/clients/c++/perf_client/inference_profiler.h"
+#include "src/clients/c++/perf_client/json_report.h"
 #include "src/clients/c++/perf_client/load_manager.h"
 #include "src/clients/c++/perf_client/perf_utils.h"
+#include "src/clients/c++/perf_client/request_rate_manager.h"
+#include "src/clients/c++/perf_client/trace_replay_manager.h"
+#include "src/clients/c++/perf_client/workload.h"
 
 
 namespace perfclient {
@@ -115,6 +123,16 @@ SignalHandler(int signum)
 //     of "throughput, latency, concurrent request count" tuples will be
 //     reported in increasing load level order.
 //
+// - Request rate mode (see --request-rate-range option):
+//     In this setting, the client will send requests at a given rate
+//     regardless of how many requests are outstanding (open-loop load),
+//     see RequestRateManager for more detail. The time between requests is
+//     constant, follows a Poisson process or is read from a file (see
+//     --request-distribution and --request-intervals options). The client
+//     follows the procedure in fixed concurrent request mode for each rate
+//     in the range and reports the same data, where the latency of a request
+//     is measured from the time the request was scheduled to be sent.
+//
 // Options:
 // -b: batch size for each request sent.
 // -t: number of concurrent requests sent. If -d is set, -t indicate the number
@@ -230,6 +248,17 @@ Report(
   if (summary.on_sequence_model) {
     std::cout << "    Sequence count: " << summary.client_sequence_count << " ("
               << summary.client_sequence_per_sec << " seq/sec)" << std::endl;
+    if (!summary.client_sequence_step_percentile_latency_ns.empty()) {
+      std::cout << "    Sequence step latency:";
+      for (const auto& percentile :
+           summary.client_sequence_step_percentile_latency_ns) {
+        std::cout << " p" << percentile.first << " "
+                  << (percentile.second / 1000) << " usec,";
+      }
+      std::cout << " max "
+                << (summary.client_sequence_step_max_latency_ns / 1000)
+                << " usec" << std::endl;
+    }
   }
   std::cout << "    Throughput: " << summary.client_infer_per_sec
             << " infer/sec" << std::endl;
@@ -239,16 +268,509 @@ Report(
   }
   for (const auto& percentile : summary.client_percentile_latency_ns) {
     std::cout << "    p" << percentile.first
-              << " latency: " << (percentile.second / 1000) << " usec"
+              << " latency: " << (percentile.second / 1000)
+              << " usec (corrected "
+              << (summary.client_corrected_percentile_latency_ns.at(
+                      percentile.first) /
+                  1000)
+              << " usec)" << std::endl;
+  }
+  std::cout << "    max latency: " << (summary.client_max_latency_ns / 1000)
+            << " usec (corrected "
+            << (summary.client_corrected_max_latency_ns / 1000) << " usec)"
+            << std::endl;
+  if (summary.client_load_delayed) {
+    std::cout << "    WARNING: " << summary.client_delayed_request_count
+              << " of " << summary.client_request_count
+              << " requests were sent more than "
+              << (SEND_DELAY_THRESHOLD_NS / 1000)
+              << " usec late (max "
+              << (summary.client_max_send_delay_ns / 1000)
+              << " usec), perf_client could not generate the intended load"
               << std::endl;
   }
   std::cout << client_library_detail << std::endl;
+  const std::vector<std::pair<std::string, const std::map<double, uint64_t>*>>
+      stages{{"marshal", &summary.client_marshal_percentile_ns},
+             {"response wait", &summary.client_response_wait_percentile_ns},
+             {"unmarshal", &summary.client_unmarshal_percentile_ns}};
+  for (const auto& stage : stages) {
+    if (!stage.second->empty()) {
+      std::cout << "      " << stage.first << ":";
+      std::string separator = " ";
+      for (const auto& percentile : *stage.second) {
+        std::cout << separator << "p" << percentile.first << " "
+                  << (percentile.second / 1000) << " usec";
+        separator = ", ";
+      }
+      std::cout << std::endl;
+    }
+  }
 
   std::cout << "  Server: " << std::endl;
   ReportServerSideStats(summary.server_stats, 1);
 
   return nic::Error(ni::RequestStatusCode::SUCCESS);
 }
+
+// Profile all models of a mixed workload at the same time, so that each
+// model is measured under the interference of the others, and report the
+// measurement of each model.
+nic::Error
+ProfileWorkload(
+    const std::vector<WorkloadEntry>& entries, const std::string& url,
+    const ProtocolType protocol,
+    const std::map<std::string, std::string>& http_headers,
+    const bool streaming, const SharedMemoryType shared_memory_type,
+    const size_t output_shm_size, const size_t max_threads,
+    const size_t sequence_length, const size_t num_of_sequences,
+    const double stable_offset, const uint64_t measurement_window_ms,
+    const size_t max_measurement_count, const int32_t percentile,
+    const std::string& metrics_url, const bool verbose,
+    const std::string& filename, const std::string& json_filename)
+{
+  std::vector<std::unique_ptr<InferenceProfiler>> profilers;
+  for (const auto& entry : entries) {
+    std::shared_ptr<ContextFactory> factory;
+    std::unique_ptr<LoadManager> manager;
+    std::unique_ptr<InferenceProfiler> profiler;
+    RETURN_IF_ERROR(ContextFactory::Create(
+        url, protocol, http_headers, streaming, entry.model_name_,
+        entry.model_version_, &factory));
+    if (entry.request_rate_ > 0) {
+      RETURN_IF_ERROR(RequestRateManager::Create(
+          entry.batch_size_, max_threads, entry.distribution_, {},
+          entry.zero_input_, entry.input_shapes_, entry.data_directory_,
+          shared_memory_type, output_shm_size, factory, &manager));
+    } else {
+      RETURN_IF_ERROR(ConcurrencyManager::Create(
+          entry.batch_size_, max_threads, sequence_length, num_of_sequences,
+          entry.zero_input_, entry.input_shapes_, entry.data_directory_,
+          shared_memory_type, output_shm_size, factory, &manager));
+    }
+    // The measurement passes of the models are interleaved, so they are not
+    // reported even if verbose
+    RETURN_IF_ERROR(InferenceProfiler::Create(
+        false, stable_offset, measurement_window_ms, max_measurement_count,
+        percentile, metrics_url, factory, std::move(manager), &profiler));
+    profilers.emplace_back(std::move(profiler));
+  }
+
+  // The load of each model is kept until all profilers are done and
+  // destroyed, so the models that stabilize later are still measured
+  // under the full workload.
+  std::vector<PerfStatus> summary(entries.size());
+  std::vector<nic::Error> errs(entries.size());
+  std::vector<std::thread> threads;
+  for (size_t idx = 0; idx < entries.size(); idx++) {
+    threads.emplace_back([&entries, &profilers, &summary, &errs, idx]() {
+      if (entries[idx].request_rate_ > 0) {
+        errs[idx] = profilers[idx]->ProfileRequestRate(
+            entries[idx].request_rate_, summary[idx]);
+      } else {
+        errs[idx] =
+            profilers[idx]->Profile(entries[idx].concurrency_, summary[idx]);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& err : errs) {
+    RETURN_IF_ERROR(err);
+  }
+
+  int total_infer_per_sec = 0;
+  for (size_t idx = 0; idx < entries.size(); idx++) {
+    std::cout << "Model: " << entries[idx].model_name_ << " (";
+    if (entries[idx].request_rate_ > 0) {
+      std::cout << "request rate " << entries[idx].request_rate_;
+    } else {
+      std::cout << "concurrency " << entries[idx].concurrency_;
+    }
+    std::cout << ", batch size " << entries[idx].batch_size_ << ")"
+              << std::endl;
+    RETURN_IF_ERROR(Report(
+        summary[idx], summary[idx].concurrency, percentile, protocol,
+        verbose));
+    total_infer_per_sec += summary[idx].client_infer_per_sec;
+  }
+  std::cout << "Total throughput: " << total_infer_per_sec << " infer/sec"
+            << std::endl;
+
+  if (!filename.empty()) {
+    std::ofstream ofs(filename, std::ofstream::out);
+    ofs << "Model,Concurrency,Request Rate,Batch Size,Inferences/Second,"
+        << "Server Queue,Server Compute";
+    for (const auto& percentile : summary[0].client_percentile_latency_ns) {
+      ofs << ",p" << percentile.first << " latency";
+    }
+    ofs << ",max latency" << std::endl;
+    for (size_t idx = 0; idx < entries.size(); idx++) {
+      const PerfStatus& status = summary[idx];
+      const uint64_t request_count =
+          std::max<uint64_t>(1, status.server_stats.request_count);
+      ofs << entries[idx].model_name_ << "," << status.concurrency << ","
+          << status.request_rate << "," << status.batch_size << ","
+          << status.client_infer_per_sec << ","
+          << (status.server_stats.queue_time_ns / request_count / 1000) << ","
+          << (status.server_stats.compute_time_ns / request_count / 1000);
+      for (const auto& percentile : status.client_percentile_latency_ns) {
+        ofs << "," << (percentile.second / 1000);
+      }
+      ofs << "," << (status.client_max_latency_ns / 1000) << std::endl;
+    }
+    ofs.close();
+  }
+
+  if (!json_filename.empty()) {
+    std::vector<ModelReport> reports;
+    for (size_t idx = 0; idx < entries.size(); idx++) {
+      reports.push_back(
+          {entries[idx].model_name_, entries[idx].model_version_,
+           {summary[idx]}, 0});
+    }
+    RETURN_IF_ERROR(WriteJsonReport(json_filename, reports));
+  }
+
+  return nic::Error::Success;
+}
+
+// Replay the requests of all models recorded in a trace at the same time
+// and report the measurement of each model over the whole replay.
+nic::Error
+ReplayTrace(
+    const std::map<std::string, std::vector<TraceRecord>>& records,
+    const double speed, const std::string& url, const ProtocolType protocol,
+    const std::map<std::string, std::string>& http_headers,
+    const bool streaming, const int64_t model_version, const bool zero_input,
+    const std::unordered_map<std::string, std::vector<int64_t>>& input_shapes,
+    const std::string& data_directory, const int32_t percentile,
+    const std::string& metrics_url, const bool verbose,
+    const std::string& filename, const std::string& json_filename)
+{
+  std::vector<std::string> model_names;
+  std::vector<std::unique_ptr<InferenceProfiler>> profilers;
+  for (const auto& model_records : records) {
+    std::shared_ptr<ContextFactory> factory;
+    std::unique_ptr<LoadManager> manager;
+    std::unique_ptr<InferenceProfiler> profiler;
+    RETURN_IF_ERROR(ContextFactory::Create(
+        url, protocol, http_headers, streaming, model_records.first,
+        model_version, &factory));
+    RETURN_IF_ERROR(TraceReplayManager::Create(
+        model_records.second, speed, zero_input, input_shapes, data_directory,
+        factory, &manager));
+    // The stability parameters are not used as the replay is measured once
+    RETURN_IF_ERROR(InferenceProfiler::Create(
+        false, 0.1, 1, 1, percentile, metrics_url, factory,
+        std::move(manager), &profiler));
+    model_names.push_back(model_records.first);
+    profilers.emplace_back(std::move(profiler));
+  }
+
+  // Start the replay of all models from the same time, leaving time for
+  // the profilers to collect the server status before the first request
+  const uint64_t start_ns = MonotonicNanos() + 100 * 1000 * 1000;
+  std::vector<PerfStatus> summary(profilers.size());
+  std::vector<nic::Error> errs(profilers.size());
+  std::vector<std::thread> threads;
+  for (size_t idx = 0; idx < profilers.size(); idx++) {
+    threads.emplace_back([&profilers, &summary, &errs, start_ns, idx]() {
+      errs[idx] = profilers[idx]->ProfileReplay(start_ns, summary[idx]);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& err : errs) {
+    RETURN_IF_ERROR(err);
+  }
+
+  int total_infer_per_sec = 0;
+  for (size_t idx = 0; idx < profilers.size(); idx++) {
+    std::cout << "Model: " << model_names[idx] << " ("
+              << records.at(model_names[idx]).size() << " requests)"
+              << std::endl;
+    RETURN_IF_ERROR(Report(summary[idx], 0, percentile, protocol, verbose));
+    total_infer_per_sec += summary[idx].client_infer_per_sec;
+  }
+  std::cout << "Total throughput: " << total_infer_per_sec << " infer/sec"
+            << std::endl;
+
+  if (!filename.empty()) {
+    std::ofstream ofs(filename, std::ofstream::out);
+    ofs << "Model,Requests,Inferences/Second,Server Queue,Server Compute";
+    for (const auto& percentile : summary[0].client_percentile_latency_ns) {
+      ofs << ",p" << percentile.first << " latency";
+    }
+    ofs << ",max latency" << std::endl;
+    for (size_t idx = 0; idx < profilers.size(); idx++) {
+      const PerfStatus& status = summary[idx];
+      const uint64_t request_count =
+          std::max<uint64_t>(1, status.server_stats.request_count);
+      ofs << model_names[idx] << "," << status.client_request_count << ","
+          << status.client_infer_per_sec << ","
+          << (status.server_stats.queue_time_ns / request_count / 1000) << ","
+          << (status.server_stats.compute_time_ns / request_count / 1000);
+      for (const auto& percentile : status.client_percentile_latency_ns) {
+        ofs << "," << (percentile.second / 1000);
+      }
+      ofs << "," << (status.client_max_latency_ns / 1000) << std::endl;
+    }
+    ofs.close();
+  }
+
+  if (!json_filename.empty()) {
+    std::vector<ModelReport> reports;
+    for (size_t idx = 0; idx < profilers.size(); idx++) {
+      reports.push_back({model_names[idx], model_version, {summary[idx]}, 0});
+    }
+    RETURN_IF_ERROR(WriteJsonReport(json_filename, reports));
+  }
+
+  return nic::Error::Success;
+}
+
+// Write 'config' as the configuration of the model at 'config_path'.
+nic::Error
+WriteModelConfig(const std::string& config_path, const std::string& config)
+{
+  std::ofstream ofs(config_path, std::ofstream::out | std::ofstream::trunc);
+  if (!ofs) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG,
+        "failed to open model configuration " + config_path);
+  }
+  ofs << config;
+  ofs.close();
+  return nic::Error::Success;
+}
+
+// Rewrite the model configuration 'original_config' at 'config_path' with
+// every instance group set to 'instance_count' instances and reload the
+// model so that it runs with that many instances.
+nic::Error
+ReloadWithInstanceCount(
+    const std::string& config_path, const std::string& original_config,
+    const size_t instance_count, const std::string& model_name,
+    nic::ModelControlContext* ctx)
+{
+  ni::ModelConfig config;
+  if (!google::protobuf::TextFormat::ParseFromString(
+          original_config, &config)) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG,
+        "failed to parse model configuration " + config_path);
+  }
+  if (config.instance_group().empty()) {
+    config.add_instance_group();
+  }
+  for (auto& group : *config.mutable_instance_group()) {
+    group.set_count(instance_count);
+  }
+
+  std::string config_str;
+  google::protobuf::TextFormat::PrintToString(config, &config_str);
+  RETURN_IF_ERROR(WriteModelConfig(config_path, config_str));
+  return ctx->Load(model_name);
+}
+
+// Profile the model at every combination of the batch sizes, the
+// concurrencies and, if any, the instance counts. Each measurement is
+// preceded by a warmup at the same load that is discarded. Report the
+// throughput and latency of every combination as a matrix.
+nic::Error
+ProfileSweep(
+    const std::vector<size_t>& batch_sizes,
+    const std::vector<size_t>& concurrencies,
+    const std::vector<size_t>& instance_counts,
+    const std::string& model_repository, const uint64_t warmup_ms,
+    std::shared_ptr<ContextFactory>& factory, const int64_t model_version,
+    const ProtocolType protocol, const size_t max_threads,
+    const size_t sequence_length, const size_t num_of_sequences,
+    const bool zero_input,
+    const std::unordered_map<std::string, std::vector<int64_t>>& input_shapes,
+    const std::string& data_directory,
+    const SharedMemoryType shared_memory_type, const size_t output_shm_size,
+    const double stable_offset, const uint64_t measurement_window_ms,
+    const size_t max_measurement_count, const int32_t percentile,
+    const std::string& metrics_url, const bool verbose,
+    const std::string& filename, const std::string& json_filename)
+{
+  const std::string& model_name = factory->ModelName();
+
+  // An instance count of 0 measures the model as it is loaded
+  std::vector<size_t> counts(instance_counts);
+  if (counts.empty()) {
+    counts.push_back(0);
+  }
+
+  std::unique_ptr<nic::ModelControlContext> control_ctx;
+  const std::string config_path =
+      model_repository + "/" + model_name + "/config.pbtxt";
+  std::string original_config;
+  if (!instance_counts.empty()) {
+    RETURN_IF_ERROR(factory->CreateModelControlContext(&control_ctx));
+    std::vector<char> contents;
+    RETURN_IF_ERROR(ReadFile(config_path, &contents));
+    original_config.assign(contents.begin(), contents.end());
+  }
+
+  // The measurement of each (instance count, batch size, concurrency)
+  std::map<std::tuple<size_t, size_t, size_t>, PerfStatus> summary;
+  nic::Error err;
+  for (const size_t instance_count : counts) {
+    if (instance_count != 0) {
+      std::cout << "Reloading " << model_name << " with " << instance_count
+                << " instances" << std::endl;
+      err = ReloadWithInstanceCount(
+          config_path, original_config, instance_count, model_name,
+          control_ctx.get());
+    }
+
+    for (const size_t batch_size : batch_sizes) {
+      if (!err.IsOk() || early_exit) {
+        break;
+      }
+
+      std::unique_ptr<LoadManager> manager;
+      std::unique_ptr<InferenceProfiler> profiler;
+      err = ConcurrencyManager::Create(
+          batch_size, max_threads, sequence_length, num_of_sequences,
+          zero_input, input_shapes, data_directory, shared_memory_type,
+          output_shm_size, factory, &manager);
+      if (err.IsOk()) {
+        err = InferenceProfiler::Create(
+            verbose, stable_offset, measurement_window_ms,
+            max_measurement_count, percentile, metrics_url, factory,
+            std::move(manager), &profiler);
+      }
+
+      for (const size_t concurrency : concurrencies) {
+        if (!err.IsOk() || early_exit) {
+          break;
+        }
+
+        std::cout << "Batch size " << batch_size << ", concurrency "
+                  << concurrency;
+        if (instance_count != 0) {
+          std::cout << ", " << instance_count << " instances";
+        }
+        std::cout << std::endl;
+
+        PerfStatus status;
+        err = profiler->Warmup(concurrency, warmup_ms);
+        if (err.IsOk()) {
+          err = profiler->Profile(concurrency, status);
+        }
+        if (err.IsOk()) {
+          err = Report(status, concurrency, percentile, protocol, verbose);
+          summary.emplace(
+              std::make_tuple(instance_count, batch_size, concurrency),
+              status);
+        }
+      }
+    }
+
+    if (!err.IsOk() || early_exit) {
+      break;
+    }
+  }
+
+  // Leave the model as it was even if the sweep failed
+  if (!instance_counts.empty()) {
+    nic::Error restore_err = WriteModelConfig(config_path, original_config);
+    if (restore_err.IsOk()) {
+      restore_err = control_ctx->Load(model_name);
+    }
+    if (err.IsOk()) {
+      err = restore_err;
+    }
+  }
+  RETURN_IF_ERROR(err);
+
+  std::cout << "Inferences/Second and ";
+  if (percentile == -1) {
+    std::cout << "Average";
+  } else {
+    std::cout << "p" << percentile;
+  }
+  std::cout << " Batch Latency (usec) vs. Batch Size and Concurrency"
+            << std::endl;
+  for (const size_t instance_count : counts) {
+    if (instance_count != 0) {
+      std::cout << "Instances: " << instance_count << std::endl;
+    }
+    std::cout << std::setw(12) << "Batch Size";
+    for (const size_t concurrency : concurrencies) {
+      std::cout << std::setw(24)
+                << ("Concurrency " + std::to_string(concurrency));
+    }
+    std::cout << std::endl;
+    for (const size_t batch_size : batch_sizes) {
+      std::cout << std::setw(12) << batch_size;
+      for (const size_t concurrency : concurrencies) {
+        const auto itr = summary.find(
+            std::make_tuple(instance_count, batch_size, concurrency));
+        if (itr == summary.end()) {
+          std::cout << std::setw(24) << "-";
+        } else {
+          std::cout << std::setw(24)
+                    << (std::to_string(itr->second.client_infer_per_sec) +
+                        " / " +
+                        std::to_string(
+                            itr->second.stabilizing_latency_ns / 1000));
+        }
+      }
+      std::cout << std::endl;
+    }
+  }
+
+  if (!filename.empty()) {
+    std::ofstream ofs(filename, std::ofstream::out);
+    ofs << "Instance Count,Batch Size,Concurrency,Inferences/Second,"
+        << "Server Queue,Server Compute";
+    if (!summary.empty()) {
+      for (const auto& percentile :
+           summary.begin()->second.client_percentile_latency_ns) {
+        ofs << ",p" << percentile.first << " latency";
+      }
+    }
+    ofs << ",max latency" << std::endl;
+    for (const auto& point : summary) {
+      const PerfStatus& status = point.second;
+      const uint64_t request_count =
+          std::max<uint64_t>(1, status.server_stats.request_count);
+      ofs << std::get<0>(point.first) << "," << std::get<1>(point.first)
+          << "," << std::get<2>(point.first) << ","
+          << status.client_infer_per_sec << ","
+          << (status.server_stats.queue_time_ns / request_count / 1000) << ","
+          << (status.server_stats.compute_time_ns / request_count / 1000);
+      for (const auto& percentile : status.client_percentile_latency_ns) {
+        ofs << "," << (percentile.second / 1000);
+      }
+      ofs << "," << (status.client_max_latency_ns / 1000) << std::endl;
+    }
+    ofs.close();
+  }
+
+  if (!json_filename.empty()) {
+    std::vector<ModelReport> reports;
+    for (const size_t instance_count : counts) {
+      ModelReport report{model_name, model_version, {}, instance_count};
+      for (const auto& point : summary) {
+        if (std::get<0>(point.first) == instance_count) {
+          report.measurements_.push_back(point.second);
+        }
+      }
+      reports.push_back(report);
+    }
+    RETURN_IF_ERROR(WriteJsonReport(json_filename, reports));
+  }
+
+  return nic::Error::Success;
+}
 }  // namespace perfclient
 
 void
@@ -261,6 +783,9 @@ Usage(char** argv, const std::string& msg = std::string())
   std::cerr << "Usage: " << argv[0] << " [options]" << std::endl;
   std::cerr << "\t-v" << std::endl;
   std::cerr << "\t-f <filename for storing report in csv format>" << std::endl;
+  std::cerr << "\t--json <filename for storing report in json format>"
+            << std::endl;
+  std::cerr << "\t--metrics-url <URL for server metrics>" << std::endl;
   std::cerr << "\t-b <batch size>" << std::endl;
   std::cerr << "\t-t <number of concurrent requests>" << std::endl;
   std::cerr << "\t-d" << std::endl;
@@ -283,9 +808,26 @@ Usage(char** argv, const std::string& msg = std::string())
             << std::endl;
   std::cerr << "\t-H <HTTP header>" << std::endl;
   std::cerr << "\t--sequence-length <length>" << std::endl;
+  std::cerr << "\t--num-of-sequences <number of live sequences>" << std::endl;
   std::cerr << "\t--percentile <percentile>" << std::endl;
   std::cerr << "\t--shape <name:shape>" << std::endl;
   std::cerr << "\t--data-directory <path>" << std::endl;
+  std::cerr << "\t--request-rate-range <start:end:step>" << std::endl;
+  std::cerr << "\t--request-distribution <constant|poisson>" << std::endl;
+  std::cerr << "\t--request-intervals <path>" << std::endl;
+  std::cerr << "\t--workload <path>" << std::endl;
+  std::cerr << "\t--binary-search" << std::endl;
+  std::cerr << "\t--shared-memory <none|system|cuda>" << std::endl;
+  std::cerr << "\t--output-shared-memory-size <size (in bytes)>" << std::endl;
+  std::cerr << "\t--trace <path>" << std::endl;
+  std::cerr << "\t--trace-speed <factor>" << std::endl;
+  std::cerr << "\t--workers <host:port,...>" << std::endl;
+  std::cerr << "\t--worker-port <port>" << std::endl;
+  std::cerr << "\t--sweep-batch-sizes <batch size,...>" << std::endl;
+  std::cerr << "\t--sweep-concurrency <concurrency,...>" << std::endl;
+  std::cerr << "\t--sweep-instance-counts <instance count,...>" << std::endl;
+  std::cerr << "\t--model-repository <path>" << std::endl;
+  std::cerr << "\t--warmup-window <warmup window (in msec)>" << std::endl;
   std::cerr << std::endl;
   std::cerr
       << "The -d flag enables dynamic concurrent request count where the number"
@@ -345,6 +887,16 @@ Usage(char** argv, const std::string& msg = std::string())
       << " of x requests to be sent as the elements in the sequence. The length"
       << " of the actual sequence will be within +/- 20% of the base length."
       << std::endl;
+  std::cerr
+      << "For --num-of-sequences, it indicates the number of sequences that"
+      << " are live at the same time when measuring a sequence model with a"
+      << " fixed number of concurrent requests. The concurrency then only"
+      << " limits the requests in flight, each one being the next request of"
+      << " a live sequence, and an ended sequence is replaced by a new one."
+      << " The sequence step latency, the average request latency of each"
+      << " completed sequence, is also reported. Default is 0 to use one"
+      << " sequence for each concurrent request. It can't be used with"
+      << " --request-rate-range or --request-intervals." << std::endl;
   std::cerr
       << "For --percentile, it indicates that the specified percentile in terms"
       << " of latency will also be reported and used to detemine if the"
@@ -365,6 +917,127 @@ Usage(char** argv, const std::string& msg = std::string())
       << " will reuse the data to match the specified batch size."
       << " Note that the files should contain only the raw binary"
       << " representation of the data in row major order." << std::endl;
+  std::cerr
+      << "For --request-rate-range, it indicates that the perf client will"
+      << " send requests at the given rates (in requests per second) instead"
+      << " of with a fixed number of concurrent requests. The argument must be"
+      << " specified as 'start:end:step', the client measures at each rate from"
+      << " 'start' to 'end' in increments of 'step'. 'end' and 'step' may be"
+      << " omitted to measure at a single rate. If -l is set, the perf client"
+      << " stops once the latency exceeds the threshold. This option can't be"
+      << " used with -d or -t." << std::endl;
+  std::cerr
+      << "For --request-distribution, it indicates the distribution of the"
+      << " time between requests in request rate mode. 'constant' sends"
+      << " requests at fixed intervals and 'poisson' sends requests as a"
+      << " Poisson process. Default is 'constant'." << std::endl;
+  std::cerr
+      << "For --request-intervals, it indicates that the perf client will send"
+      << " requests with the time intervals listed in the file, one interval"
+      << " in microseconds per line, using the intervals in turn. It can't be"
+      << " used with --request-rate-range." << std::endl;
+  std::cerr
+      << "For --workload, it indicates that the perf client will send requests"
+      << " to all the models listed in the file at the same time and report"
+      << " the measurement of each model. Each line of the file lists a model"
+      << " name followed by options 'version=<v>', 'batch-size=<n>',"
+      << " 'concurrency=<n>', 'rate=<requests per second>', 'weight=<w>',"
+      << " 'distribution=<constant|poisson>', 'data-directory=<path>',"
+      << " 'shape=<name:shape>' and 'zero-input'. Models given by weight share"
+      << " the concurrency set by -t in proportion to their weights, a model"
+      << " without 'concurrency', 'rate' or 'weight' has weight 1. The options"
+      << " not listed default to the command-line values. This option can't be"
+      << " used with -m, -d, --request-rate-range or --request-intervals."
+      << std::endl;
+  std::cerr
+      << "The --binary-search flag makes the perf client binary search for"
+      << " the highest load whose latency (see --percentile) stays under the"
+      << " limit set by -l, instead of measuring every load in the range. The"
+      << " range is 't' to 'c' concurrent requests, or the request rates of"
+      << " --request-rate-range. The latency is assumed to increase with the"
+      << " load. The highest load found is reported as the knee point."
+      << std::endl;
+  std::cerr
+      << "For --shared-memory, it indicates that the perf client will register"
+      << " a shared memory region for each input and output before profiling"
+      << " and send requests that reference the regions instead of carrying"
+      << " the tensors, so that the measurement excludes the cost of"
+      << " transferring the tensors. 'system' uses system shared memory and"
+      << " 'cuda' uses CUDA memory on the current GPU, which is only allowed"
+      << " with gRPC protocol. Default is 'none'." << std::endl;
+  std::cerr
+      << "For --output-shared-memory-size, it indicates the size of the shared"
+      << " memory region of an output whose size can't be derived from the"
+      << " model configuration. Default is 102400." << std::endl;
+  std::cerr
+      << "For --trace, it indicates that the perf client will replay the"
+      << " requests recorded in the file at their recorded times instead of"
+      << " generating a steady load, and report the measurement of each model"
+      << " over the whole replay. Each line of the file is a request"
+      << " '<time in usec>,<model name>,<batch size>[,<correlation ID>"
+      << "[,<input>]]' where the input is either a data directory (see"
+      << " --data-directory) or a list of 'name:shape' separated by ';'. The"
+      << " requests with the same non-zero correlation ID to a sequence model"
+      << " are replayed as a sequence. This option can't be used with -m, -d,"
+      << " --request-rate-range, --request-intervals, --workload,"
+      << " --binary-search or --shared-memory." << std::endl;
+  std::cerr
+      << "For --trace-speed, it indicates the speed of the replay relative to"
+      << " the recorded times, for example 2 replays the trace in half of the"
+      << " recorded time. Default is 1." << std::endl;
+  std::cerr
+      << "For --workers, it indicates that the perf client will generate the"
+      << " load together with perf client workers on other hosts, so that the"
+      << " load is not limited by a single client host. The argument is a"
+      << " comma-separated list of worker addresses 'host:port'. The load set"
+      << " by -t, -c or --request-rate-range is the total load of all hosts"
+      << " and is split evenly between this host and the workers. The latency"
+      << " percentiles are computed over the requests of all hosts. This"
+      << " option can't be used with --request-intervals, --workload or"
+      << " --trace." << std::endl;
+  std::cerr
+      << "For --worker-port, it indicates that the perf client will run as a"
+      << " worker of a perf client started with --workers, listening on the"
+      << " given port. The worker sends requests with its own -m, -x, -b,"
+      << " -z, --shape, --data-directory and --shared-memory options, which"
+      << " must give the same model, version and batch size as the"
+      << " coordinator, at the load set by the coordinator. It exits when the"
+      << " coordinator is done." << std::endl;
+  std::cerr
+      << "For --json, it indicates that the perf client will also write the"
+      << " report in JSON, including the measurement of every measurement"
+      << " window, the server side statistic of every composing model and the"
+      << " GPU metrics (see --metrics-url), so that runs can be compared"
+      << " automatically." << std::endl;
+  std::cerr
+      << "For --metrics-url, it indicates the URL of the metrics endpoint of"
+      << " the server, for example 'localhost:8002/metrics'. The utilization,"
+      << " memory and power usage of each GPU are collected at the end of"
+      << " every measurement window and included in the JSON report. Default"
+      << " is to not collect GPU metrics." << std::endl;
+  std::cerr
+      << "For --sweep-batch-sizes and --sweep-concurrency, they indicate that"
+      << " the perf client will measure every combination of the listed batch"
+      << " sizes and concurrencies and report the throughput and latency of"
+      << " the combinations as a matrix. A list not given defaults to the"
+      << " value of -b or -t. Each measurement is preceded by a warmup at the"
+      << " same load that is not measured (see --warmup-window). This option"
+      << " can't be used with -d, --binary-search, --request-rate-range,"
+      << " --request-intervals, --workload, --trace, --workers or"
+      << " --worker-port." << std::endl;
+  std::cerr
+      << "For --sweep-instance-counts, it indicates that the sweep is"
+      << " repeated for each listed instance count. Before each repetition"
+      << " the perf client sets the count of every instance group in the"
+      << " model configuration in the model repository given by"
+      << " --model-repository, which must be the repository of the server,"
+      << " and reloads the model. The server must be started with"
+      << " --model-control-mode=explicit. The original configuration is"
+      << " restored and reloaded after the sweep." << std::endl;
+  std::cerr
+      << "For --warmup-window, it indicates the duration of the warmup before"
+      << " each measurement of a sweep. Default is the measurement window."
+      << std::endl;
 
   exit(1);
 }
@@ -379,6 +1052,7 @@ main(int argc, char** argv)
   size_t max_threads = 16;
   // average length of a sentence
   size_t sequence_length = 20;
+  size_t num_of_sequences = 0;
   int32_t percentile = -1;
   uint64_t latency_threshold_ms = 0;
   int32_t batch_size = 1;
@@ -391,10 +1065,32 @@ main(int argc, char** argv)
   int64_t model_version = -1;
   std::string url("localhost:8000");
   std::string filename("");
+  std::string json_filename("");
+  std::string metrics_url("");
   std::string data_directory("");
   perfclient::ProtocolType protocol = perfclient::ProtocolType::HTTP;
   std::map<std::string, std::string> http_headers;
   std::unordered_map<std::string, std::vector<int64_t>> input_shapes;
+  std::vector<double> request_rate_range;
+  perfclient::RequestRateManager::Distribution request_distribution =
+      perfclient::RequestRateManager::CONSTANT;
+  std::string request_intervals_file("");
+  std::vector<uint64_t> request_intervals_us;
+  bool concurrency_specified = false;
+  std::string workload_file("");
+  perfclient::SharedMemoryType shared_memory_type =
+      perfclient::NO_SHARED_MEMORY;
+  size_t output_shm_size = 100 * 1024;
+  bool binary_search = false;
+  std::string trace_file("");
+  double trace_speed = 1.0;
+  std::vector<std::string> workers;
+  int worker_port = 0;
+  std::vector<size_t> sweep_batch_sizes;
+  std::vector<size_t> sweep_concurrency;
+  std::vector<size_t> sweep_instance_counts;
+  std::string model_repository("");
+  uint64_t warmup_window_ms = 0;
 
   // {name, has_arg, *flag, val}
   static struct option long_options[] = {{"streaming", 0, 0, 0},
@@ -403,6 +1099,26 @@ main(int argc, char** argv)
                                          {"percentile", 1, 0, 3},
                                          {"data-directory", 1, 0, 4},
                                          {"shape", 1, 0, 5},
+                                         {"request-rate-range", 1, 0, 6},
+                                         {"request-distribution", 1, 0, 7},
+                                         {"request-intervals", 1, 0, 8},
+                                         {"workload", 1, 0, 9},
+                                         {"shared-memory", 1, 0, 10},
+                                         {"output-shared-memory-size", 1, 0,
+                                          11},
+                                         {"binary-search", 0, 0, 12},
+                                         {"trace", 1, 0, 13},
+                                         {"trace-speed", 1, 0, 14},
+                                         {"workers", 1, 0, 15},
+                                         {"worker-port", 1, 0, 16},
+                                         {"num-of-sequences", 1, 0, 17},
+                                         {"json", 1, 0, 18},
+                                         {"metrics-url", 1, 0, 19},
+                                         {"sweep-batch-sizes", 1, 0, 20},
+                                         {"sweep-concurrency", 1, 0, 21},
+                                         {"sweep-instance-counts", 1, 0, 22},
+                                         {"model-repository", 1, 0, 23},
+                                         {"warmup-window", 1, 0, 24},
                                          {0, 0, 0, 0}};
 
   // Parse commandline...
@@ -427,34 +1143,123 @@ main(int argc, char** argv)
         data_directory = optarg;
         break;
       case 5: {
+        std::string name;
+        std::vector<int64_t> shape;
+        nic::Error err = perfclient::ParseInputShape(optarg, &name, &shape);
+        if (!err.IsOk()) {
+          Usage(argv, err.Message());
+        }
+        input_shapes[name] = shape;
+        break;
+      }
+      case 6: {
         std::string arg = optarg;
-        std::string name = arg.substr(0, arg.rfind(":"));
-        std::string shape_str = arg.substr(name.size() + 1);
         size_t pos = 0;
-        std::vector<int64_t> shape;
         try {
           while (pos != std::string::npos) {
-            size_t comma_pos = shape_str.find(",", pos);
-            int64_t dim;
-            if (comma_pos == std::string::npos) {
-              dim = std::stoll(shape_str.substr(pos, comma_pos));
-              pos = comma_pos;
+            size_t colon_pos = arg.find(":", pos);
+            if (colon_pos == std::string::npos) {
+              request_rate_range.push_back(std::stod(arg.substr(pos)));
+              pos = colon_pos;
             } else {
-              dim = std::stoll(shape_str.substr(pos, comma_pos - pos));
-              pos = comma_pos + 1;
+              request_rate_range.push_back(
+                  std::stod(arg.substr(pos, colon_pos - pos)));
+              pos = colon_pos + 1;
             }
-            if (dim <= 0) {
-              Usage(argv, "input shape must be > 0");
-            }
-            shape.emplace_back(dim);
           }
         }
         catch (const std::invalid_argument& ia) {
-          Usage(argv, "failed to parse input shape: " + std::string(optarg));
+          Usage(
+              argv,
+              "failed to parse request rate range: " + std::string(optarg));
+        }
+        if (request_rate_range.size() > 3) {
+          Usage(argv, "request rate range must be 'start:end:step'");
+        }
+        break;
+      }
+      case 7: {
+        nic::Error err = perfclient::RequestRateManager::ParseDistribution(
+            optarg, &request_distribution);
+        if (!err.IsOk()) {
+          Usage(argv, err.Message());
         }
-        input_shapes[name] = shape;
         break;
       }
+      case 8:
+        request_intervals_file = optarg;
+        break;
+      case 9:
+        workload_file = optarg;
+        break;
+      case 10:
+        shared_memory_type = perfclient::ParseSharedMemoryType(optarg);
+        break;
+      case 11:
+        output_shm_size = std::atoll(optarg);
+        break;
+      case 12:
+        binary_search = true;
+        break;
+      case 13:
+        trace_file = optarg;
+        break;
+      case 14:
+        trace_speed = std::atof(optarg);
+        break;
+      case 15: {
+        std::istringstream in(optarg);
+        std::string worker;
+        while (std::getline(in, worker, ',')) {
+          if (!worker.empty()) {
+            workers.push_back(worker);
+          }
+        }
+        break;
+      }
+      case 16:
+        worker_port = std::atoi(optarg);
+        break;
+      case 17:
+        num_of_sequences = std::atoi(optarg);
+        break;
+      case 18:
+        json_filename = optarg;
+        break;
+      case 19:
+        metrics_url = optarg;
+        break;
+      case 20: {
+        nic::Error err =
+            perfclient::ParseSizeList(optarg, &sweep_batch_sizes);
+        if (!err.IsOk()) {
+          Usage(argv, "failed to parse sweep batch sizes: " + err.Message());
+        }
+        break;
+      }
+      case 21: {
+        nic::Error err =
+            perfclient::ParseSizeList(optarg, &sweep_concurrency);
+        if (!err.IsOk()) {
+          Usage(argv, "failed to parse sweep concurrency: " + err.Message());
+        }
+        break;
+      }
+      case 22: {
+        nic::Error err =
+            perfclient::ParseSizeList(optarg, &sweep_instance_counts);
+        if (!err.IsOk()) {
+          Usage(
+              argv, "failed to parse sweep instance counts: " + err.Message());
+        }
+        break;
+      }
+      case 23:
+        model_repository = optarg;
+        break;
+      case 24:
+        warmup_window_ms = std::atoi(optarg);
+        break;
       case 'v':
         verbose = true;
         break;
@@ -478,6 +1283,7 @@ main(int argc, char** argv)
         break;
       case 't':
         concurrent_request_count = std::atoi(optarg);
+        concurrency_specified = true;
         break;
       case 'p':
         measurement_window_ms = std::atoi(optarg);
@@ -516,13 +1322,64 @@ main(int argc, char** argv)
     }
   }
 
-  if (model_name.empty()) {
+  if (model_name.empty() && workload_file.empty() && trace_file.empty()) {
     Usage(argv, "-m flag must be specified");
   }
+  if (!trace_file.empty() &&
+      (!model_name.empty() || dynamic_concurrency_mode ||
+       !request_rate_range.empty() || !request_intervals_file.empty() ||
+       !workload_file.empty() || binary_search ||
+       (shared_memory_type != perfclient::NO_SHARED_MEMORY))) {
+    Usage(
+        argv,
+        "trace can't be used with -m, -d, --request-rate-range, "
+        "--request-intervals, --workload, --binary-search or "
+        "--shared-memory");
+  }
+  if (!(trace_speed > 0)) {
+    Usage(argv, "trace speed must be > 0");
+  }
+  if ((num_of_sequences != 0) &&
+      (!request_rate_range.empty() || !request_intervals_file.empty())) {
+    Usage(
+        argv,
+        "number of sequences can't be set with --request-rate-range or "
+        "--request-intervals");
+  }
+  if (!workers.empty() &&
+      (!request_intervals_file.empty() || !workload_file.empty() ||
+       !trace_file.empty())) {
+    Usage(
+        argv,
+        "workers can't be used with --request-intervals, --workload or "
+        "--trace");
+  }
+  if ((worker_port < 0) || (worker_port > 65535)) {
+    Usage(argv, "worker port must be in range [1, 65535]");
+  }
+  if ((worker_port != 0) &&
+      (model_name.empty() || !workers.empty() || !workload_file.empty() ||
+       !trace_file.empty() || dynamic_concurrency_mode || binary_search ||
+       !request_rate_range.empty() || !request_intervals_file.empty())) {
+    Usage(
+        argv,
+        "worker requires -m and can't be used with --workers, --workload, "
+        "--trace, -d, --binary-search, --request-rate-range or "
+        "--request-intervals, the load is set by the coordinator");
+  }
+  if (!workload_file.empty() &&
+      (!model_name.empty() || dynamic_concurrency_mode ||
+       !request_rate_range.empty() || !request_intervals_file.empty())) {
+    Usage(
+        argv,
+        "workload can't be used with -m, -d, --request-rate-range or "
+        "--request-intervals");
+  }
   if (batch_size <= 0) {
     Usage(argv, "batch size must be > 0");
   }
-  if (measurement_window_ms <= 0) {
+  if (trace_file.empty() && (worker_port == 0) &&
+      (measurement_window_ms <= 0)) {
     Usage(argv, "measurement window must be > 0 in msec");
   }
   if (concurrent_request_count <= 0) {
@@ -551,13 +1408,238 @@ main(int argc, char** argv)
   if (percentile != -1 && (percentile > 99 || percentile < 1)) {
     Usage(argv, "percentile must be -1 for not reporting or in range (0, 100)");
   }
+  if (shared_memory_type == perfclient::UNKNOWN_SHARED_MEMORY) {
+    Usage(argv, "shared memory type should be none, system or cuda");
+  }
+  if ((shared_memory_type == perfclient::CUDA_SHARED_MEMORY) &&
+      (protocol != perfclient::ProtocolType::GRPC)) {
+    Usage(argv, "CUDA shared memory is only allowed with gRPC protocol");
+  }
   if (zero_input && !data_directory.empty()) {
     Usage(argv, "zero input can't be set when data directory is provided");
   }
+  if (!request_rate_range.empty() && !request_intervals_file.empty()) {
+    Usage(argv, "request rate range can't be set with request intervals");
+  }
+
+  const bool request_rate_mode =
+      !request_rate_range.empty() || !request_intervals_file.empty();
+  const bool sweep_mode = !sweep_batch_sizes.empty() ||
+                          !sweep_concurrency.empty() ||
+                          !sweep_instance_counts.empty();
+  if (sweep_mode) {
+    if (dynamic_concurrency_mode || binary_search || request_rate_mode ||
+        !workload_file.empty() || !trace_file.empty() || !workers.empty() ||
+        (worker_port != 0)) {
+      Usage(
+          argv,
+          "sweep can't be used with -d, --binary-search, "
+          "--request-rate-range, --request-intervals, --workload, --trace, "
+          "--workers or --worker-port");
+    }
+    if (!sweep_instance_counts.empty() && model_repository.empty()) {
+      Usage(argv, "sweep over instance counts requires --model-repository");
+    }
+    if (sweep_batch_sizes.empty()) {
+      sweep_batch_sizes.push_back(batch_size);
+    }
+    if (sweep_concurrency.empty()) {
+      sweep_concurrency.push_back(concurrent_request_count);
+    }
+    if (warmup_window_ms == 0) {
+      warmup_window_ms = measurement_window_ms;
+    }
+  }
+  if (binary_search) {
+    if (latency_threshold_ms == 0) {
+      Usage(argv, "binary search requires a latency limit set by -l");
+    }
+    if (dynamic_concurrency_mode || !request_intervals_file.empty() ||
+        !workload_file.empty()) {
+      Usage(
+          argv,
+          "binary search can't be used with -d, --request-intervals or "
+          "--workload");
+    }
+    if (!request_rate_mode &&
+        (max_concurrency < (size_t)concurrent_request_count)) {
+      Usage(
+          argv,
+          "binary search over concurrency requires a maximum concurrency set "
+          "by -c that is not less than -t");
+    }
+  }
+  if (request_rate_mode) {
+    if (dynamic_concurrency_mode || concurrency_specified) {
+      Usage(argv, "request rate mode can't be used with -d or -t");
+    }
+    if (!request_intervals_file.empty()) {
+      FAIL_IF_ERR(
+          perfclient::ReadTimeIntervalsFile(
+              request_intervals_file, &request_intervals_us),
+          "failed to read request intervals");
+      request_distribution = perfclient::RequestRateManager::CUSTOM;
+
+      // Report the average rate of the intervals
+      uint64_t total_interval_us = 0;
+      for (const auto interval_us : request_intervals_us) {
+        total_interval_us += interval_us;
+      }
+      if (total_interval_us == 0) {
+        Usage(argv, "request intervals must not all be 0");
+      }
+      request_rate_range.push_back(
+          1000000.0 * request_intervals_us.size() / total_interval_us);
+    }
+    if (request_rate_range.size() == 1) {
+      request_rate_range.push_back(request_rate_range[0]);
+    }
+    if (request_rate_range.size() == 2) {
+      request_rate_range.push_back(1);
+    }
+    if ((request_rate_range[0] <= 0) ||
+        (request_rate_range[1] < request_rate_range[0]) ||
+        (request_rate_range[2] <= 0)) {
+      Usage(
+          argv, "request rate range must have 0 < start <= end and step > 0");
+    }
+  }
 
   // trap SIGINT to allow threads to exit gracefully
   signal(SIGINT, perfclient::SignalHandler);
 
+  if (worker_port != 0) {
+    std::shared_ptr<perfclient::ContextFactory> factory;
+    FAIL_IF_ERR(
+        perfclient::ContextFactory::Create(
+            url, protocol, http_headers, streaming, model_name, model_version,
+            &factory),
+        "failed to create context factory");
+    std::unique_ptr<perfclient::LoadWorker> worker;
+    FAIL_IF_ERR(
+        perfclient::LoadWorker::Create(
+            worker_port, batch_size, factory,
+            [=](const bool request_rate_mode,
+                const perfclient::RequestRateManager::Distribution
+                    distribution,
+                std::unique_ptr<perfclient::LoadManager>* manager) {
+              if (request_rate_mode) {
+                return perfclient::RequestRateManager::Create(
+                    batch_size, max_threads, distribution, {}, zero_input,
+                    input_shapes, data_directory, shared_memory_type,
+                    output_shm_size, factory, manager);
+              }
+              return perfclient::ConcurrencyManager::Create(
+                  batch_size, max_threads, sequence_length, num_of_sequences,
+                  zero_input, input_shapes, data_directory, shared_memory_type,
+                  output_shm_size, factory, manager);
+            },
+            &worker),
+        "failed to start worker");
+
+    std::cout << "*** Worker ***" << std::endl
+              << "  Waiting for the coordinator on port " << worker_port
+              << std::endl;
+    nic::Error err = worker->Serve();
+    if (!err.IsOk()) {
+      std::cerr << err << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
+  if (!trace_file.empty()) {
+    std::map<std::string, std::vector<perfclient::TraceRecord>> records;
+    FAIL_IF_ERR(
+        perfclient::TraceReplayManager::ReadTraceFile(trace_file, &records),
+        "failed to read trace");
+
+    std::cout << "*** Measurement Settings ***" << std::endl
+              << "  Trace: " << trace_file << " (" << records.size()
+              << " models)" << std::endl
+              << "  Replay speed: " << trace_speed << "x" << std::endl
+              << std::endl;
+
+    nic::Error err = perfclient::ReplayTrace(
+        records, trace_speed, url, protocol, http_headers, streaming,
+        model_version, zero_input, input_shapes, data_directory, percentile,
+        metrics_url, verbose, filename, json_filename);
+    if (!err.IsOk()) {
+      std::cerr << err << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
+  if (!workload_file.empty()) {
+    perfclient::WorkloadEntry defaults;
+    defaults.model_version_ = -1;
+    defaults.batch_size_ = batch_size;
+    defaults.distribution_ = request_distribution;
+    defaults.zero_input_ = zero_input;
+    defaults.data_directory_ = data_directory;
+    defaults.input_shapes_ = input_shapes;
+    std::vector<perfclient::WorkloadEntry> entries;
+    FAIL_IF_ERR(
+        perfclient::ReadWorkloadFile(workload_file, defaults, &entries),
+        "failed to read workload");
+    perfclient::ResolveWorkload(concurrent_request_count, &entries);
+
+    std::cout << "*** Measurement Settings ***" << std::endl
+              << "  Workload: " << workload_file << " (" << entries.size()
+              << " models)" << std::endl
+              << "  Measurement window: " << measurement_window_ms << " msec"
+              << std::endl
+              << std::endl;
+
+    nic::Error err = perfclient::ProfileWorkload(
+        entries, url, protocol, http_headers, streaming, shared_memory_type,
+        output_shm_size, max_threads, sequence_length, num_of_sequences,
+        stable_offset, measurement_window_ms, max_measurement_count,
+        percentile, metrics_url, verbose, filename, json_filename);
+    if (!err.IsOk()) {
+      std::cerr << err << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
+  if (sweep_mode) {
+    std::shared_ptr<perfclient::ContextFactory> factory;
+    FAIL_IF_ERR(
+        perfclient::ContextFactory::Create(
+            url, protocol, http_headers, streaming, model_name, model_version,
+            &factory),
+        "failed to create context factory");
+
+    std::cout << "*** Measurement Settings ***" << std::endl
+              << "  Sweep: " << sweep_batch_sizes.size() << " batch sizes x "
+              << sweep_concurrency.size() << " concurrencies";
+    if (!sweep_instance_counts.empty()) {
+      std::cout << " x " << sweep_instance_counts.size()
+                << " instance counts";
+    }
+    std::cout << std::endl
+              << "  Warmup window: " << warmup_window_ms << " msec"
+              << std::endl
+              << "  Measurement window: " << measurement_window_ms << " msec"
+              << std::endl
+              << std::endl;
+
+    nic::Error err = perfclient::ProfileSweep(
+        sweep_batch_sizes, sweep_concurrency, sweep_instance_counts,
+        model_repository, warmup_window_ms, factory, model_version, protocol,
+        max_threads, sequence_length, num_of_sequences, zero_input,
+        input_shapes, data_directory, shared_memory_type, output_shm_size,
+        stable_offset, measurement_window_ms, max_measurement_count,
+        percentile, metrics_url, verbose, filename, json_filename);
+    if (!err.IsOk()) {
+      std::cerr << err << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
   nic::Error err;
   std::shared_ptr<perfclient::ContextFactory> factory;
   std::unique_ptr<perfclient::LoadManager> manager;
@@ -569,16 +1651,29 @@ main(int argc, char** argv)
     std::cerr << err << std::endl;
     return 1;
   }
-  err = perfclient::ConcurrencyManager::Create(
-      batch_size, max_threads, sequence_length, zero_input, input_shapes,
-      data_directory, factory, &manager);
+  if (request_rate_mode) {
+    err = perfclient::RequestRateManager::Create(
+        batch_size, max_threads, request_distribution, request_intervals_us,
+        zero_input, input_shapes, data_directory, shared_memory_type,
+        output_shm_size, factory, &manager);
+  } else {
+    err = perfclient::ConcurrencyManager::Create(
+        batch_size, max_threads, sequence_length, num_of_sequences,
+        zero_input, input_shapes, data_directory, shared_memory_type,
+        output_shm_size, factory, &manager);
+  }
+  if (err.IsOk() && !workers.empty()) {
+    err = perfclient::DistributedLoadManager::Create(
+        std::move(manager), workers, request_rate_mode, request_distribution,
+        factory, &manager);
+  }
   if (!err.IsOk()) {
     std::cerr << err << std::endl;
     return 1;
   }
   err = perfclient::InferenceProfiler::Create(
       verbose, stable_offset, measurement_window_ms, max_measurement_count,
-      percentile, factory, std::move(manager), &profiler);
+      percentile, metrics_url, factory, std::move(manager), &profiler);
   if (!err.IsOk()) {
     std::cerr << err << std::endl;
     return 1;
@@ -589,6 +1684,49 @@ main(int argc, char** argv)
             << "  Batch size: " << batch_size << std::endl
             << "  Measurement window: " << measurement_window_ms << " msec"
             << std::endl;
+  if (!workers.empty()) {
+    std::cout << "  Load generated by this host and " << workers.size()
+              << " workers" << std::endl;
+  }
+  if ((num_of_sequences != 0) &&
+      (factory->SchedulerType() == perfclient::ContextFactory::SEQUENCE)) {
+    std::cout << "  Live sequences: " << num_of_sequences << std::endl;
+  }
+  if (shared_memory_type != perfclient::NO_SHARED_MEMORY) {
+    std::cout << "  Using "
+              << ((shared_memory_type == perfclient::CUDA_SHARED_MEMORY)
+                      ? "CUDA"
+                      : "system")
+              << " shared memory for inputs and outputs" << std::endl;
+  }
+  if (request_rate_mode) {
+    std::cout << "  Request distribution: ";
+    switch (request_distribution) {
+      case perfclient::RequestRateManager::POISSON:
+        std::cout << "poisson" << std::endl;
+        break;
+      case perfclient::RequestRateManager::CUSTOM:
+        std::cout << "intervals from " << request_intervals_file << std::endl;
+        break;
+      default:
+        std::cout << "constant" << std::endl;
+        break;
+    }
+    if (latency_threshold_ms != 0) {
+      std::cout << "  Latency limit: " << latency_threshold_ms << " msec"
+                << std::endl;
+    }
+  }
+  if (binary_search) {
+    std::cout << "  Binary search for the highest ";
+    if (request_rate_mode) {
+      std::cout << "request rate";
+    } else {
+      std::cout << "concurrency";
+    }
+    std::cout << " within " << latency_threshold_ms << " msec latency"
+              << std::endl;
+  }
   if (dynamic_concurrency_mode) {
     std::cout << "  Latency limit: " << latency_threshold_ms << " msec"
               << std::endl;
@@ -607,8 +1745,100 @@ main(int argc, char** argv)
 
   perfclient::PerfStatus status_summary;
   std::vector<perfclient::PerfStatus> summary;
+  // The highest load found within the latency limit by the binary search
+  bool knee_found = false;
+  perfclient::PerfStatus knee_status;
 
-  if (!dynamic_concurrency_mode) {
+  if (binary_search) {
+    // Search over the steps of the load range, the load at step 'lo' is
+    // within the latency limit and the load at step 'hi' is not. Each
+    // measurement reuses the stabilization of the profiler, so the search
+    // takes log2 of the number of steps measurements instead of one per step.
+    size_t step_count = 0;
+    if (request_rate_mode) {
+      while ((request_rate_range[0] + step_count * request_rate_range[2]) <=
+             request_rate_range[1]) {
+        step_count++;
+      }
+    } else {
+      step_count = max_concurrency - concurrent_request_count + 1;
+    }
+
+    auto profile_step = [&](const size_t step, bool* within_limit) {
+      if (request_rate_mode) {
+        RETURN_IF_ERROR(profiler->ProfileRequestRate(
+            request_rate_range[0] + step * request_rate_range[2],
+            status_summary));
+      } else {
+        RETURN_IF_ERROR(profiler->Profile(
+            concurrent_request_count + step, status_summary));
+      }
+      RETURN_IF_ERROR(perfclient::Report(
+          status_summary, status_summary.concurrency, percentile, protocol,
+          verbose));
+      summary.push_back(status_summary);
+
+      *within_limit = (status_summary.stabilizing_latency_ns <=
+                       (latency_threshold_ms * 1000 * 1000));
+      // The search only measures loads above the highest one found within
+      // the limit so far, so the last one found is the knee point
+      if (*within_limit) {
+        knee_found = true;
+        knee_status = status_summary;
+      }
+      return nic::Error::Success;
+    };
+
+    size_t lo = 0;
+    size_t hi = step_count - 1;
+    bool within_limit;
+    err = profile_step(lo, &within_limit);
+    if (err.IsOk() && within_limit && (hi > lo)) {
+      err = profile_step(hi, &within_limit);
+      // Nothing to search if the highest load is within the limit
+      if (err.IsOk() && within_limit) {
+        lo = hi;
+      }
+      while (err.IsOk() && ((hi - lo) > 1)) {
+        const size_t mid = lo + (hi - lo) / 2;
+        err = profile_step(mid, &within_limit);
+        if (within_limit) {
+          lo = mid;
+        } else {
+          hi = mid;
+        }
+      }
+    }
+  } else if (request_rate_mode) {
+    // Step through the range by index to avoid accumulating floating
+    // point error in the rate
+    for (size_t idx = 0;
+         (request_rate_range[0] + idx * request_rate_range[2]) <=
+         request_rate_range[1];
+         idx++) {
+      const double rate = request_rate_range[0] + idx * request_rate_range[2];
+      err = profiler->ProfileRequestRate(rate, status_summary);
+      if (!err.IsOk()) {
+        break;
+      }
+      err = perfclient::Report(
+          status_summary, 0, percentile, protocol, verbose);
+      summary.push_back(status_summary);
+      uint64_t stabilizing_latency_ms =
+          status_summary.stabilizing_latency_ns / (1000 * 1000);
+      if (!err.IsOk()) {
+        std::cerr << err << std::endl;
+        break;
+      } else if (
+          (latency_threshold_ms != 0) &&
+          (stabilizing_latency_ms >= latency_threshold_ms)) {
+        std::cerr << "Aborting execution as measured latency went over "
+                     "the set limit of "
+                  << latency_threshold_ms << " msec. " << std::endl;
+        break;
+      }
+    }
+  } else if (!dynamic_concurrency_mode) {
     err = profiler->Profile(concurrent_request_count, status_summary);
     if (err.IsOk()) {
       err = perfclient::Report(
@@ -651,6 +1881,8 @@ main(int argc, char** argv)
   }
   if (summary.size()) {
     // Can print more depending on verbose, but it seems too much information
+    const std::string load_name =
+        request_rate_mode ? "Request Rate" : "Concurrency";
     std::cout << "Inferences/Second vs. Client ";
     if (percentile == -1) {
       std::cout << "Average Batch Latency" << std::endl;
@@ -659,22 +1891,61 @@ main(int argc, char** argv)
     }
 
     for (perfclient::PerfStatus& status : summary) {
-      std::cout << "Concurrency: " << status.concurrency << ", "
+      std::cout << load_name << ": ";
+      if (request_rate_mode) {
+        std::cout << status.request_rate;
+      } else {
+        std::cout << status.concurrency;
+      }
+      std::cout << ", "
                 << status.client_infer_per_sec << " infer/sec, latency "
                 << (status.stabilizing_latency_ns / 1000) << " usec"
                 << std::endl;
     }
 
+    if (binary_search) {
+      if (knee_found) {
+        std::cout << "Knee point: " << load_name << " ";
+        if (request_rate_mode) {
+          std::cout << knee_status.request_rate;
+        } else {
+          std::cout << knee_status.concurrency;
+        }
+        std::cout << ", " << knee_status.client_infer_per_sec
+                  << " infer/sec, latency "
+                  << (knee_status.stabilizing_latency_ns / 1000) << " usec"
+                  << std::endl;
+      } else {
+        std::cout << "Knee point: none, the lowest load exceeds the latency "
+                  << "limit of " << latency_threshold_ms << " msec"
+                  << std::endl;
+      }
+    }
+
+    if (!json_filename.empty()) {
+      err = perfclient::WriteJsonReport(
+          json_filename, {{model_name, model_version, summary, 0}});
+      if (!err.IsOk()) {
+        std::cerr << err << std::endl;
+        return 1;
+      }
+    }
+
     if (!filename.empty()) {
       std::ofstream ofs(filename, std::ofstream::out);
 
-      ofs << "Concurrency,Inferences/Second,Client Send,"
+      ofs << load_name << ",Inferences/Second,Client Send,"
           << "Network+Server Send/Recv,Server Queue,"
           << "Server Compute,Client Recv";
       for (const auto& percentile : summary[0].client_percentile_latency_ns) {
         ofs << ",p" << percentile.first << " latency";
       }
-      ofs << std::endl;
+      ofs << ",max latency";
+      for (const auto& percentile :
+           summary[0].client_corrected_percentile_latency_ns) {
+        ofs << ",corrected p" << percentile.first << " latency";
+      }
+      ofs << ",corrected max latency,Delayed Requests" << std::endl;
 
       // Sort summary results in order of increasing infer/sec.
       std::sort(
@@ -700,7 +1971,12 @@ main(int argc, char** argv)
                 ? avg_client_wait_ns - (avg_queue_ns + avg_compute_ns)
                 : 0;
 
-        ofs << status.concurrency << "," << status.client_infer_per_sec << ","
+        if (request_rate_mode) {
+          ofs << status.request_rate;
+        } else {
+          ofs << status.concurrency;
+        }
+        ofs << "," << status.client_infer_per_sec << ","
             << (status.client_avg_send_time_ns / 1000) << ","
             << (avg_network_misc_ns / 1000) << "," << (avg_queue_ns / 1000)
             << "," << (avg_compute_ns / 1000) << ","
@@ -708,7 +1984,13 @@ main(int argc, char** argv)
         for (const auto& percentile : status.client_percentile_latency_ns) {
           ofs << "," << (percentile.second / 1000);
         }
-        ofs << std::endl;
+        ofs << "," << (status.client_max_latency_ns / 1000);
+        for (const auto& percentile :
+             status.client_corrected_percentile_latency_ns) {
+          ofs << "," << (percentile.second / 1000);
+        }
+        ofs << "," << (status.client_corrected_max_latency_ns / 1000) << ","
+            << status.client_delayed_request_count << std::endl;
       }
       ofs.close();
 
@@ -723,7 +2005,7 @@ main(int argc, char** argv)
           const auto name_ver = name + "_v" + std::to_string(version);
 
           std::ofstream ofs(name_ver + "." + filename, std::ofstream::out);
-          ofs << "Concurrency,Inferences/Second,Client Send,"
+          ofs << load_name << ",Inferences/Second,Client Send,"
               << "Network+Server Send/Recv,Server Queue,"
               << "Server Compute,Client Recv" << std::endl;
 
@@ -744,7 +2026,12 @@ main(int argc, char** argv)
             double infer_ratio =
                 1.0 * stats.request_count / status.server_stats.request_count;
             int infer_per_sec = infer_ratio * status.client_infer_per_sec;
-            ofs << status.concurrency << "," << infer_per_sec << ",0,"
+            if (request_rate_mode) {
+              ofs << status.request_rate;
+            } else {
+              ofs << status.concurrency;
+            }
+            ofs << "," << infer_per_sec << ",0,"
                 << (avg_overhead_ns / 1000) << "," << (avg_queue_ns / 1000)
                 << "," << (avg_compute_ns / 1000) << ",0" << std::endl;
           }
@@ -26,8 +26,18 @@
 
 #include "src/clients/c++/perf_client/perf_utils.h"
 
+#include <sstream>
+
 namespace perfclient {
 
+uint64_t
+MonotonicNanos()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return TIMESPEC_TO_NANOS(ts);
+}
+
 ProtocolType
 ParseProtocol(const std::string& str)
 {
@@ -41,6 +51,21 @@ ParseProtocol(const std::string& str)
   return ProtocolType::UNKNOWN;
 }
 
+SharedMemoryType
+ParseSharedMemoryType(const std::string& str)
+{
+  std::string type(str);
+  std::transform(type.begin(), type.end(), type.begin(), ::tolower);
+  if (type == "none") {
+    return SharedMemoryType::NO_SHARED_MEMORY;
+  } else if (type == "system") {
+    return SharedMemoryType::SYSTEM_SHARED_MEMORY;
+  } else if (type == "cuda") {
+    return SharedMemoryType::CUDA_SHARED_MEMORY;
+  }
+  return SharedMemoryType::UNKNOWN_SHARED_MEMORY;
+}
+
 nic::Error
 ReadFile(const std::string& path, std::vector<char>* contents)
 {
@@ -75,4 +100,114 @@ ReadFile(const std::string& path, std::vector<char>* contents)
   return nic::Error::Success;
 }
 
+nic::Error
+ParseInputShape(
+    const std::string& arg, std::string* name, std::vector<int64_t>* shape)
+{
+  const size_t colon_pos = arg.rfind(":");
+  if (colon_pos == std::string::npos) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG,
+        "input shape '" + arg + "' must be specified as 'name:shape'");
+  }
+  *name = arg.substr(0, colon_pos);
+  const std::string shape_str = arg.substr(colon_pos + 1);
+
+  shape->clear();
+  size_t pos = 0;
+  try {
+    while (pos != std::string::npos) {
+      size_t comma_pos = shape_str.find(",", pos);
+      int64_t dim;
+      if (comma_pos == std::string::npos) {
+        dim = std::stoll(shape_str.substr(pos, comma_pos));
+        pos = comma_pos;
+      } else {
+        dim = std::stoll(shape_str.substr(pos, comma_pos - pos));
+        pos = comma_pos + 1;
+      }
+      if (dim <= 0) {
+        return nic::Error(
+            ni::RequestStatusCode::INVALID_ARG, "input shape must be > 0");
+      }
+      shape->emplace_back(dim);
+    }
+  }
+  catch (const std::exception& e) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG,
+        "failed to parse input shape: " + arg);
+  }
+
+  return nic::Error::Success;
+}
+
+nic::Error
+ParseSizeList(const std::string& arg, std::vector<size_t>* values)
+{
+  values->clear();
+  std::istringstream in(arg);
+  std::string value;
+  while (std::getline(in, value, ',')) {
+    size_t pos = 0;
+    long long parsed = 0;
+    try {
+      parsed = std::stoll(value, &pos);
+    }
+    catch (const std::exception& e) {
+      pos = 0;
+    }
+    if ((pos == 0) || (pos != value.size()) || (parsed <= 0)) {
+      return nic::Error(
+          ni::RequestStatusCode::INVALID_ARG,
+          "list '" + arg + "' must be comma-separated integers > 0");
+    }
+    values->push_back(parsed);
+  }
+
+  if (values->empty()) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG, "list '" + arg + "' is empty");
+  }
+
+  return nic::Error::Success;
+}
+
+nic::Error
+ReadTimeIntervalsFile(const std::string& path, std::vector<uint64_t>* contents)
+{
+  std::ifstream in(path);
+  if (!in) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG,
+        "failed to open file '" + path + "'");
+  }
+
+  std::string current_string;
+  while (std::getline(in, current_string)) {
+    if (current_string.empty()) {
+      continue;
+    }
+    try {
+      contents->push_back(std::stoull(current_string));
+    }
+    catch (const std::exception& e) {
+      in.close();
+      return nic::Error(
+          ni::RequestStatusCode::INVALID_ARG,
+          "failed to parse time interval '" + current_string + "' in file '" +
+              path + "'");
+    }
+  }
+
+  in.close();
+
+  if (contents->empty()) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG, "file '" + path + "' is empty");
+  }
+
+  return nic::Error::Success;
+}
+
 }  // namespace perfclient
@@ -39,9 +39,6 @@ namespace nic = nvidia::inferenceserver::client;
 
 namespace perfclient {
 
-using TimestampVector =
-    std::vector<std::tuple<struct timespec, struct timespec, uint32_t>>;
-
 // A boolean flag to mark an interrupt and commencement of early exit
 extern volatile bool early_exit;
 
@@ -65,9 +62,23 @@ extern volatile bool early_exit;
 
 enum ProtocolType { HTTP = 0, GRPC = 1, UNKNOWN = 2 };
 
+// \return The current time in nsec of CLOCK_MONOTONIC, which is also the
+// clock of std::chrono::steady_clock
+uint64_t MonotonicNanos();
+
 // Parse the communication protocol type
 ProtocolType ParseProtocol(const std::string& str);
 
+enum SharedMemoryType {
+  NO_SHARED_MEMORY = 0,
+  SYSTEM_SHARED_MEMORY = 1,
+  CUDA_SHARED_MEMORY = 2,
+  UNKNOWN_SHARED_MEMORY = 3
+};
+
+// Parse the type of shared memory used to pass the tensors
+SharedMemoryType ParseSharedMemoryType(const std::string& str);
+
 // Reads the data from file specified by path into vector of characters
 // \param path The complete path to the file to be read
 // \param contents The character vector that will contain the data read
@@ -75,4 +86,28 @@ ProtocolType ParseProtocol(const std::string& str);
 //  read operation.
 nic::Error ReadFile(const std::string& path, std::vector<char>* contents);
 
+// Parse an input shape specified as 'name:shape' where the shape is a
+// comma-separated list of dimension sizes, for example 'input_name:1,2,3'
+// \param arg The input shape specification
+// \param name Returns the name of the input
+// \param shape Returns the shape of the input
+// \return error status. Returns Non-Ok if 'arg' is not a valid input shape.
+nic::Error ParseInputShape(
+    const std::string& arg, std::string* name, std::vector<int64_t>* shape);
+
+// Parse a comma-separated list of positive integers, for example '1,2,4'
+// \param arg The list specification
+// \param values Returns the values in the list
+// \return error status. Returns Non-Ok if 'arg' is not a valid list.
+nic::Error ParseSizeList(const std::string& arg, std::vector<size_t>* values);
+
+// Reads the time intervals from file specified by path, one interval in
+// microseconds per line
+// \param path The complete path to the file to be read
+// \param contents The vector that will contain the intervals read
+// \return error status. Returns Non-Ok if an error is encountered during
+//  read operation.
+nic::Error ReadTimeIntervalsFile(
+    const std::string& path, std::vector<uint64_t>* contents);
+
 }  // namespace perfclient
@@ -0,0 +1,290 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/clients/c++/perf_client/request_rate_manager.h"
+
+namespace perfclient {
+
+RequestRateManager::~RequestRateManager()
+{
+  {
+    std::lock_guard<std::mutex> lock(schedule_mutex_);
+    early_exit = true;
+  }
+  // wake up all threads
+  schedule_cv_.notify_all();
+
+  size_t cnt = 0;
+  for (auto& thread : threads_) {
+    thread.join();
+    if (!threads_status_[cnt]->IsOk()) {
+      std::cerr << "Thread [" << cnt
+                << "] had error: " << *(threads_status_[cnt]) << std::endl;
+    }
+    cnt++;
+  }
+}
+
+nic::Error
+RequestRateManager::Create(
+    const int32_t batch_size, const size_t max_threads,
+    const Distribution distribution,
+    const std::vector<uint64_t>& custom_intervals_us, const bool zero_input,
+    const std::unordered_map<std::string, std::vector<int64_t>>& input_shapes,
+    const std::string& data_directory,
+    const SharedMemoryType shared_memory_type, const size_t output_shm_size,
+    const std::shared_ptr<ContextFactory>& factory,
+    std::unique_ptr<LoadManager>* manager)
+{
+  if ((distribution == CUSTOM) && custom_intervals_us.empty()) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG,
+        "custom request intervals must be provided");
+  }
+
+  std::unique_ptr<RequestRateManager> local_manager(new RequestRateManager(
+      input_shapes, batch_size, max_threads, distribution, custom_intervals_us,
+      factory));
+
+  // The requests of a sequence must be sent in order, which can't be
+  // guaranteed when each request is sent at its scheduled time.
+  if (local_manager->on_sequence_model_) {
+    return nic::Error(
+        ni::RequestStatusCode::UNSUPPORTED,
+        "request rate mode is not supported for sequence models");
+  }
+
+  RETURN_IF_ERROR(local_manager->InitManager(
+      zero_input, data_directory, shared_memory_type, output_shm_size));
+
+  *manager = std::move(local_manager);
+  return nic::Error::Success;
+}
+
+nic::Error
+RequestRateManager::ParseDistribution(
+    const std::string& str, Distribution* distribution)
+{
+  if (str == "constant") {
+    *distribution = CONSTANT;
+  } else if (str == "poisson") {
+    *distribution = POISSON;
+  } else {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG,
+        "unknown request distribution '" + str +
+            "', expected 'constant' or 'poisson'");
+  }
+  return nic::Error::Success;
+}
+
+RequestRateManager::RequestRateManager(
+    const std::unordered_map<std::string, std::vector<int64_t>>& input_shapes,
+    const int32_t batch_size, const size_t max_threads,
+    const Distribution distribution,
+    const std::vector<uint64_t>& custom_intervals_us,
+    const std::shared_ptr<ContextFactory>& factory)
+    : LoadManager(batch_size, max_threads, 0, input_shapes, factory),
+      distribution_(distribution), custom_interval_idx_(0),
+      rng_(std::random_device()()), request_rate_(0), next_send_ns_(0),
+      generation_(0)
+{
+  for (const auto interval_us : custom_intervals_us) {
+    custom_intervals_ns_.push_back(interval_us * 1000);
+  }
+}
+
+nic::Error
+RequestRateManager::ChangeRequestRate(const double request_rate)
+{
+  if (request_rate <= 0) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG, "request rate must be > 0");
+  }
+
+  // Launch all worker threads the first time a rate is set, each worker
+  // sends requests at the times it claims from the shared schedule.
+  while (threads_.size() < max_threads_) {
+    threads_status_.emplace_back(
+        new nic::Error(ni::RequestStatusCode::SUCCESS));
+    threads_contexts_stat_.emplace_back(
+        new std::vector<nic::InferContext::Stat>());
+    threads_latencies_.emplace_back(new RequestLatencies());
+    threads_.emplace_back(
+        &RequestRateManager::AsyncInfer, this, threads_status_.back(),
+        threads_contexts_stat_.back(), threads_latencies_.back());
+  }
+
+  // Restart the schedule at the new rate
+  {
+    std::lock_guard<std::mutex> lock(schedule_mutex_);
+    request_rate_ = request_rate;
+    next_send_ns_ = MonotonicNanos();
+    generation_++;
+  }
+  schedule_cv_.notify_all();
+
+  std::cout << "Request rate: " << request_rate << " requests/sec"
+            << std::endl;
+  return nic::Error::Success;
+}
+
+uint64_t
+RequestRateManager::NextIntervalNs()
+{
+  switch (distribution_) {
+    case POISSON: {
+      std::exponential_distribution<double> dist(request_rate_);
+      return (uint64_t)(dist(rng_) * ni::NANOS_PER_SECOND);
+    }
+    case CUSTOM: {
+      const uint64_t interval_ns = custom_intervals_ns_[custom_interval_idx_];
+      custom_interval_idx_ =
+          (custom_interval_idx_ + 1) % custom_intervals_ns_.size();
+      return interval_ns;
+    }
+    default:
+      return (uint64_t)(ni::NANOS_PER_SECOND / request_rate_);
+  }
+}
+
+// Function for worker threads.
+// Each worker uses one context to send its requests, a context can have
+// many requests in flight so a worker never waits for a response before
+// sending the next request.
+void
+RequestRateManager::AsyncInfer(
+    std::shared_ptr<nic::Error> err,
+    std::shared_ptr<std::vector<nic::InferContext::Stat>> stats,
+    std::shared_ptr<RequestLatencies> latencies)
+{
+  std::unique_ptr<nic::InferContext> ctx;
+  std::unique_ptr<nic::InferContext::Options> options(nullptr);
+  *err = PrepareInfer(&ctx, &options);
+  if (!err->IsOk()) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(status_report_mutex_);
+    stats->emplace_back();
+  }
+
+  // Variables used to track the requests in flight and the error of
+  // a completed request, they are updated by the callback thread
+  size_t inflight_request_cnt = 0;
+  nic::Error callback_err(ni::RequestStatusCode::SUCCESS);
+  std::mutex cb_mtx;
+  std::condition_variable cb_cv;
+
+  // run inferencing until receiving exit signal to maintain server load.
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lk(cb_mtx);
+      if (!callback_err.IsOk()) {
+        *err = callback_err;
+        break;
+      }
+    }
+
+    // Claim the next time in the schedule and wait until then, giving up
+    // the time if the schedule is changed in the meantime.
+    uint64_t send_ns;
+    {
+      std::unique_lock<std::mutex> lock(schedule_mutex_);
+      schedule_cv_.wait(
+          lock, [this]() { return early_exit || (request_rate_ > 0); });
+      if (early_exit) {
+        break;
+      }
+
+      const uint64_t generation = generation_;
+      send_ns = next_send_ns_;
+      next_send_ns_ += NextIntervalNs();
+
+      // CLOCK_MONOTONIC is the clock of std::chrono::steady_clock
+      const std::chrono::steady_clock::time_point send_time(
+          std::chrono::nanoseconds{send_ns});
+      schedule_cv_.wait_until(lock, send_time, [this, generation]() {
+        return early_exit || (generation != generation_);
+      });
+      if (early_exit) {
+        break;
+      }
+      if (generation != generation_) {
+        continue;
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lk(cb_mtx);
+      inflight_request_cnt++;
+    }
+
+    const uint64_t start_ns = MonotonicNanos();
+    *err = ctx->AsyncRun(
+        [this, stats, latencies, send_ns, start_ns, &inflight_request_cnt,
+         &callback_err, &cb_mtx, &cb_cv](
+            nic::InferContext* ctx,
+            const std::shared_ptr<nic::InferContext::Request>& request) {
+          std::map<std::string, std::unique_ptr<nic::InferContext::Result>>
+              results;
+          bool is_ready = false;
+          nic::Error request_err =
+              ctx->GetAsyncRunResults(&results, &is_ready, request, true);
+
+          const uint64_t end_ns = MonotonicNanos();
+
+          if (request_err.IsOk()) {
+            // Record the request latency with proper locking
+            std::lock_guard<std::mutex> lk(status_report_mutex_);
+            latencies->Record(send_ns, start_ns, end_ns, false);
+            latencies->RecordClientStages(*ctx, &((*stats)[0]));
+          }
+
+          {
+            std::lock_guard<std::mutex> lk(cb_mtx);
+            if (!request_err.IsOk()) {
+              callback_err = request_err;
+            }
+            inflight_request_cnt--;
+          }
+          cb_cv.notify_all();
+        });
+    if (!err->IsOk()) {
+      std::lock_guard<std::mutex> lk(cb_mtx);
+      inflight_request_cnt--;
+      break;
+    }
+  }
+
+  // Wait for all callbacks to be invoked, in case of referencing on
+  // released resources in the callback function.
+  std::unique_lock<std::mutex> lk(cb_mtx);
+  cb_cv.wait(lk, [&inflight_request_cnt] { return inflight_request_cnt == 0; });
+}
+
+}  // namespace perfclient
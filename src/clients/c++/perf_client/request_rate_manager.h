@@ -0,0 +1,136 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "src/clients/c++/perf_client/load_manager.h"
+
+#include <random>
+
+namespace perfclient {
+//==============================================================================
+/// RequestRateManager is a helper class to send inference requests to
+/// inference server at a given rate, so that the perf_client can measure
+/// performance under a specific arrival rate (open-loop load) rather than a
+/// fixed number of concurrent requests (closed-loop load).
+///
+/// Detail:
+/// Request Rate Manager keeps a schedule of the times at which requests
+/// should be sent. The time between two consecutive requests is constant,
+/// drawn from an exponential distribution (Poisson arrivals), or taken in
+/// turn from user provided intervals. Worker threads claim the next time in
+/// the schedule, wait until that time and send the request asynchronously,
+/// so a slow request never delays the requests scheduled after it. The
+/// latency of a request is recorded both from the time it was sent and from
+/// its scheduled time, the latter counts the delays in sending the request
+/// when the workers fall behind the schedule.
+///
+class RequestRateManager : public LoadManager {
+ public:
+  ~RequestRateManager();
+
+  /// The distribution of the time between consecutive requests.
+  enum Distribution { CONSTANT = 0, POISSON = 1, CUSTOM = 2 };
+
+  /// Create a request rate manager that is responsible to maintain specified
+  /// load on inference server.
+  /// \param batch_size The batch size used for each request.
+  /// \param max_threads The number of worker threads that send requests.
+  /// \param distribution The distribution of the time between requests.
+  /// \param custom_intervals_us The time in usec between requests used in
+  /// turn if 'distribution' is CUSTOM.
+  /// \param zero_input Whether to fill the input tensors with zero.
+  /// \param input_shapes The shapes of the inputs with variable-size shape.
+  /// \param data_directory The directory containing the user provided data
+  /// for each input, or empty to use synthetic data.
+  /// \param shared_memory_type The type of shared memory used to pass the
+  /// tensors, or NO_SHARED_MEMORY to pass them in the requests and responses.
+  /// \param output_shm_size The size of the shared memory region of an
+  /// output whose size can't be derived from the model configuration.
+  /// \param factory The ContextFactory object used to create InferContext.
+  /// \param manger Returns a new RequestRateManager object.
+  /// \return Error object indicating success or failure.
+  static nic::Error Create(
+      const int32_t batch_size, const size_t max_threads,
+      const Distribution distribution,
+      const std::vector<uint64_t>& custom_intervals_us, const bool zero_input,
+      const std::unordered_map<std::string, std::vector<int64_t>>& input_shapes,
+      const std::string& data_directory,
+      const SharedMemoryType shared_memory_type, const size_t output_shm_size,
+      const std::shared_ptr<ContextFactory>& factory,
+      std::unique_ptr<LoadManager>* manager);
+
+  /// Parse the distribution of the time between requests.
+  /// \param str The name of the distribution, "constant" or "poisson".
+  /// \param distribution Returns the distribution.
+  /// \return Error object indicating success or failure.
+  static nic::Error ParseDistribution(
+      const std::string& str, Distribution* distribution);
+
+  /// @ See LoadManager.ChangeRequestRate()
+  nic::Error ChangeRequestRate(const double request_rate) override;
+
+ private:
+  RequestRateManager(
+      const std::unordered_map<std::string, std::vector<int64_t>>& input_shapes,
+      const int32_t batch_size, const size_t max_threads,
+      const Distribution distribution,
+      const std::vector<uint64_t>& custom_intervals_us,
+      const std::shared_ptr<ContextFactory>& factory);
+
+  /// Function for worker that sends async inference requests.
+  /// \param err Returns the status of the worker
+  /// \param stats Returns the statistic of the InferContexts
+  /// \param latencies Returns the requests completed by the worker.
+  void AsyncInfer(
+      std::shared_ptr<nic::Error> err,
+      std::shared_ptr<std::vector<nic::InferContext::Stat>> stats,
+      std::shared_ptr<RequestLatencies> latencies);
+
+  /// \return the time in nsec between the next two requests in the
+  /// schedule. Must be called with 'schedule_mutex_' held.
+  uint64_t NextIntervalNs();
+
+  const Distribution distribution_;
+  std::vector<uint64_t> custom_intervals_ns_;
+  size_t custom_interval_idx_;
+  std::default_random_engine rng_;
+
+  // The current request rate and the time in nsec (CLOCK_MONOTONIC) at
+  // which the next request in the schedule should be sent. 'generation_'
+  // is incremented each time the rate is changed so that worker threads
+  // waiting on the previous schedule give up their time.
+  double request_rate_;
+  uint64_t next_send_ns_;
+  uint64_t generation_;
+
+  // Use condition variable to pause/continue worker threads and to wake
+  // them when the schedule is changed
+  std::condition_variable schedule_cv_;
+  std::mutex schedule_mutex_;
+};
+
+}  // namespace perfclient
@@ -0,0 +1,494 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/clients/c++/perf_client/trace_replay_manager.h"
+
+#include "src/core/model_config.h"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <set>
+#include <sstream>
+
+namespace perfclient {
+
+TraceReplayManager::~TraceReplayManager()
+{
+  // Replay() waits for all of its requests, this is only reached with
+  // requests in flight if the manager is destroyed during a replay.
+  std::unique_lock<std::mutex> lk(mtx_);
+  cv_.wait(lk, [this]() { return (inflight_request_cnt_ == 0); });
+}
+
+nic::Error
+TraceReplayManager::Create(
+    const std::vector<TraceRecord>& records, const double speed,
+    const bool zero_input,
+    const std::unordered_map<std::string, std::vector<int64_t>>& input_shapes,
+    const std::string& data_directory,
+    const std::shared_ptr<ContextFactory>& factory,
+    std::unique_ptr<LoadManager>* manager)
+{
+  if (records.empty()) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG, "trace has no request to replay");
+  }
+  if (!(speed > 0)) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG, "replay speed must be > 0");
+  }
+
+  // The inputs whose shape is not given on the command line use the shape
+  // of the first request that specifies it to prepare the default data
+  std::unordered_map<std::string, std::vector<int64_t>> default_shapes(
+      input_shapes);
+  for (const auto& record : records) {
+    for (const auto& shape : record.input_shapes_) {
+      default_shapes.emplace(shape.first, shape.second);
+    }
+  }
+
+  std::unique_ptr<TraceReplayManager> local_manager(
+      new TraceReplayManager(records, speed, default_shapes, factory));
+
+  RETURN_IF_ERROR(local_manager->InitManager(
+      zero_input, data_directory, NO_SHARED_MEMORY, 0));
+  RETURN_IF_ERROR(local_manager->InitTrace(zero_input));
+
+  *manager = std::move(local_manager);
+  return nic::Error::Success;
+}
+
+nic::Error
+TraceReplayManager::ReadTraceFile(
+    const std::string& path,
+    std::map<std::string, std::vector<TraceRecord>>* records)
+{
+  std::ifstream in(path);
+  if (!in) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG,
+        "failed to open file '" + path + "'");
+  }
+
+  std::map<std::string, std::vector<uint64_t>> timestamps;
+  uint64_t first_timestamp_us = std::numeric_limits<uint64_t>::max();
+  std::string line;
+  size_t line_number = 0;
+  while (std::getline(in, line)) {
+    line_number++;
+    line.erase(0, line.find_first_not_of(" \t"));
+    if (line.empty() || (line[0] == '#')) {
+      continue;
+    }
+
+    std::vector<std::string> fields;
+    std::istringstream line_stream(line);
+    std::string field;
+    while (std::getline(line_stream, field, ',')) {
+      field.erase(0, field.find_first_not_of(" \t"));
+      field.erase(field.find_last_not_of(" \t\r") + 1);
+      fields.push_back(field);
+    }
+
+    const std::string location =
+        " at line " + std::to_string(line_number) + " of '" + path + "'";
+    if ((fields.size() < 3) || (fields.size() > 5)) {
+      in.close();
+      return nic::Error(
+          ni::RequestStatusCode::INVALID_ARG,
+          "expected '<time in usec>,<model name>,<batch size>"
+          "[,<correlation ID>[,<input>]]'" +
+              location);
+    }
+
+    TraceRecord record;
+    uint64_t timestamp_us;
+    try {
+      timestamp_us = std::stoull(fields[0]);
+      record.batch_size_ = std::stoi(fields[2]);
+      record.correlation_id_ =
+          ((fields.size() > 3) && !fields[3].empty()) ? std::stoull(fields[3])
+                                                      : 0;
+    }
+    catch (const std::exception& e) {
+      in.close();
+      return nic::Error(
+          ni::RequestStatusCode::INVALID_ARG,
+          "failed to parse request" + location);
+    }
+    if (record.batch_size_ <= 0) {
+      in.close();
+      return nic::Error(
+          ni::RequestStatusCode::INVALID_ARG,
+          "batch size must be > 0" + location);
+    }
+    record.flags_ = 0;
+
+    if ((fields.size() > 4) && !fields[4].empty()) {
+      if (fields[4].find(':') == std::string::npos) {
+        record.data_directory_ = fields[4];
+      } else {
+        std::istringstream shapes_stream(fields[4]);
+        std::string shape_str;
+        while (std::getline(shapes_stream, shape_str, ';')) {
+          std::string name;
+          std::vector<int64_t> shape;
+          nic::Error err = ParseInputShape(shape_str, &name, &shape);
+          if (!err.IsOk()) {
+            in.close();
+            return nic::Error(
+                ni::RequestStatusCode::INVALID_ARG, err.Message() + location);
+          }
+          record.input_shapes_[name] = shape;
+        }
+      }
+    }
+
+    first_timestamp_us = std::min(first_timestamp_us, timestamp_us);
+    timestamps[fields[1]].push_back(timestamp_us);
+    (*records)[fields[1]].push_back(std::move(record));
+  }
+
+  in.close();
+
+  if (records->empty()) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG,
+        "file '" + path + "' does not contain any request");
+  }
+
+  for (auto& model_records : *records) {
+    auto& model_timestamps = timestamps[model_records.first];
+    auto& requests = model_records.second;
+    for (size_t i = 0; i < requests.size(); ++i) {
+      requests[i].offset_us_ = model_timestamps[i] - first_timestamp_us;
+    }
+    std::stable_sort(
+        requests.begin(), requests.end(),
+        [](const TraceRecord& a, const TraceRecord& b) {
+          return a.offset_us_ < b.offset_us_;
+        });
+
+    // The first and the last request of each sequence in the trace start
+    // and end the sequence
+    std::set<uint64_t> started;
+    for (auto& request : requests) {
+      if ((request.correlation_id_ != 0) &&
+          started.insert(request.correlation_id_).second) {
+        request.flags_ |= ni::InferRequestHeader::FLAG_SEQUENCE_START;
+      }
+    }
+    std::set<uint64_t> ended;
+    for (auto it = requests.rbegin(); it != requests.rend(); ++it) {
+      if ((it->correlation_id_ != 0) &&
+          ended.insert(it->correlation_id_).second) {
+        it->flags_ |= ni::InferRequestHeader::FLAG_SEQUENCE_END;
+      }
+    }
+  }
+
+  return nic::Error::Success;
+}
+
+TraceReplayManager::TraceReplayManager(
+    const std::vector<TraceRecord>& records, const double speed,
+    const std::unordered_map<std::string, std::vector<int64_t>>& input_shapes,
+    const std::shared_ptr<ContextFactory>& factory)
+    : LoadManager(1, 1, 0, input_shapes, factory), records_(records),
+      speed_(speed), inflight_request_cnt_(0)
+{
+  threads_status_.emplace_back(new nic::Error(ni::RequestStatusCode::SUCCESS));
+  threads_contexts_stat_.emplace_back(
+      new std::vector<nic::InferContext::Stat>());
+  threads_latencies_.emplace_back(new RequestLatencies());
+}
+
+nic::Error
+TraceReplayManager::InitTrace(const bool zero_input)
+{
+  std::unique_ptr<nic::InferContext> ctx;
+  RETURN_IF_ERROR(factory_->CreateInferContext(&ctx));
+
+  // Model specifying maximum batch size of 0 indicates that batching
+  // is not supported and so only batch size 1 can be sent
+  const size_t max_batch_size = std::max<uint64_t>(1, ctx->MaxBatchSize());
+  size_t max_input_byte_size = input_buf_.size();
+  for (const auto& record : records_) {
+    if ((size_t)record.batch_size_ > max_batch_size) {
+      return nic::Error(
+          ni::RequestStatusCode::INVALID_ARG,
+          "expecting batch size <= " + std::to_string(max_batch_size) +
+              " for model '" + ctx->ModelName() + "', the trace has " +
+              std::to_string(record.batch_size_));
+    }
+
+    for (const auto& input : ctx->Inputs()) {
+      auto it = record.input_shapes_.find(input->Name());
+      if (it != record.input_shapes_.end()) {
+        if (!ni::CompareDimsWithWildcard(input->Dims(), it->second)) {
+          return nic::Error(
+              ni::RequestStatusCode::INVALID_ARG,
+              "input '" + input->Name() + "' expects shape " +
+                  ni::DimsListToString(input->Dims()) +
+                  " and the trace has shape " +
+                  ni::DimsListToString(it->second));
+        }
+        const int64_t byte_size = ni::GetByteSize(input->DType(), it->second);
+        if (byte_size < 0) {
+          return nic::Error(
+              ni::RequestStatusCode::INVALID_ARG,
+              "input '" + input->Name() + "' has STRING data type");
+        }
+        max_input_byte_size =
+            std::max(max_input_byte_size, (size_t)byte_size);
+      }
+
+      if (!record.data_directory_.empty()) {
+        auto& data = trace_data_[record.data_directory_];
+        if (data.find(input->Name()) == data.end()) {
+          const auto file_path = record.data_directory_ + "/" + input->Name();
+          auto it = data.emplace(input->Name(), std::vector<char>()).first;
+          RETURN_IF_ERROR(ReadFile(file_path, &it->second));
+        }
+      }
+    }
+  }
+
+  // Extend the synthetic data to the largest input of the trace
+  input_buf_.resize(max_input_byte_size, 0);
+  if (!zero_input) {
+    for (auto& byte : input_buf_) {
+      byte = rand();
+    }
+  }
+
+  return nic::Error::Success;
+}
+
+nic::Error
+TraceReplayManager::GetContext(const TraceRecord& record, ReplayContext** ctx)
+{
+  // The requests of an ongoing sequence are sent with the context of the
+  // sequence, which has its own correlation ID
+  const bool in_sequence = on_sequence_model_ && (record.correlation_id_ != 0);
+  if (in_sequence) {
+    auto it = sequence_ctxs_.find(record.correlation_id_);
+    if (it != sequence_ctxs_.end()) {
+      *ctx = it->second;
+      if (record.flags_ & ni::InferRequestHeader::FLAG_SEQUENCE_END) {
+        sequence_ctxs_.erase(it);
+      }
+      return nic::Error::Success;
+    }
+  }
+
+  if (!idle_ctxs_.empty()) {
+    *ctx = idle_ctxs_.back();
+    idle_ctxs_.pop_back();
+  } else {
+    std::unique_ptr<ReplayContext> replay_ctx(new ReplayContext());
+    RETURN_IF_ERROR(factory_->CreateInferContext(&replay_ctx->ctx_));
+    RETURN_IF_ERROR(
+        nic::InferContext::Options::Create(&replay_ctx->options_));
+    for (const auto& output : replay_ctx->ctx_->Outputs()) {
+      replay_ctx->options_->AddRawResult(output);
+    }
+    {
+      std::lock_guard<std::mutex> lk(status_report_mutex_);
+      replay_ctx->stat_idx_ = threads_contexts_stat_[0]->size();
+      threads_contexts_stat_[0]->emplace_back();
+    }
+    *ctx = replay_ctx.get();
+    ctxs_.emplace_back(std::move(replay_ctx));
+  }
+
+  if (in_sequence &&
+      !(record.flags_ & ni::InferRequestHeader::FLAG_SEQUENCE_END)) {
+    sequence_ctxs_.emplace(record.correlation_id_, *ctx);
+  }
+  return nic::Error::Success;
+}
+
+nic::Error
+TraceReplayManager::PrepareRequest(
+    const TraceRecord& record, ReplayContext* ctx)
+{
+  // A request of a sequence model outside of any sequence in the trace is
+  // sent as a sequence of its own
+  uint32_t flags = 0;
+  if (on_sequence_model_) {
+    flags = (record.correlation_id_ == 0)
+                ? (ni::InferRequestHeader::FLAG_SEQUENCE_START |
+                   ni::InferRequestHeader::FLAG_SEQUENCE_END)
+                : record.flags_;
+  }
+  ctx->options_->SetBatchSize(record.batch_size_);
+  ctx->options_->SetFlags(flags);
+  RETURN_IF_ERROR(ctx->ctx_->SetRunOptions(*(ctx->options_)));
+
+  const std::unordered_map<std::string, std::vector<char>>* record_data =
+      nullptr;
+  if (!record.data_directory_.empty()) {
+    record_data = &trace_data_[record.data_directory_];
+  }
+
+  for (const auto& input : ctx->ctx_->Inputs()) {
+    RETURN_IF_ERROR(input->Reset());
+
+    auto shape_it = record.input_shapes_.find(input->Name());
+    if (shape_it != record.input_shapes_.end()) {
+      RETURN_IF_ERROR(input->SetShape(shape_it->second));
+    } else {
+      shape_it = input_shapes_.find(input->Name());
+      if (shape_it != input_shapes_.end()) {
+        RETURN_IF_ERROR(input->SetShape(shape_it->second));
+      }
+    }
+
+    const size_t batch1_size = (size_t)input->ByteSize();
+    const uint8_t* data = &input_buf_[0];
+    if (record_data != nullptr) {
+      const auto& input_data = record_data->find(input->Name())->second;
+      if (batch1_size != input_data.size()) {
+        return nic::Error(
+            ni::RequestStatusCode::INVALID_ARG,
+            "input '" + input->Name() + "' requires " +
+                std::to_string(batch1_size) + " bytes for each batch, but '" +
+                record.data_directory_ + "' has " +
+                std::to_string(input_data.size()) + " bytes");
+      }
+      data = (const uint8_t*)&input_data[0];
+    } else {
+      RETURN_IF_ERROR(GetInputData(input, &data));
+    }
+
+    for (int32_t i = 0; i < record.batch_size_; ++i) {
+      RETURN_IF_ERROR(input->SetRaw(data, batch1_size));
+    }
+  }
+
+  return nic::Error::Success;
+}
+
+nic::Error
+TraceReplayManager::Replay(const uint64_t start_ns)
+{
+  auto& stats = threads_contexts_stat_[0];
+  auto& latencies = threads_latencies_[0];
+
+  nic::Error err;
+  for (const auto& record : records_) {
+    const uint64_t send_ns =
+        start_ns + (uint64_t)(record.offset_us_ * 1000 / speed_);
+
+    ReplayContext* ctx = nullptr;
+    {
+      // Wait until the time of the request, waking up periodically to
+      // react to an early exit during a gap in the trace
+      std::unique_lock<std::mutex> lk(mtx_);
+      uint64_t now_ns = MonotonicNanos();
+      while (!early_exit && callback_err_.IsOk() && (now_ns < send_ns)) {
+        const uint64_t wake_ns = std::min(send_ns, now_ns + 500000000);
+        cv_.wait_until(
+            lk, std::chrono::steady_clock::time_point(
+                    std::chrono::nanoseconds{wake_ns}));
+        now_ns = MonotonicNanos();
+      }
+      if (early_exit || !callback_err_.IsOk()) {
+        break;
+      }
+
+      err = GetContext(record, &ctx);
+      if (!err.IsOk()) {
+        break;
+      }
+      inflight_request_cnt_++;
+    }
+
+    err = PrepareRequest(record, ctx);
+    if (err.IsOk()) {
+      const uint64_t start_ns = MonotonicNanos();
+      err = ctx->ctx_->AsyncRun(
+          [this, ctx, &record, stats, latencies, send_ns, start_ns](
+              nic::InferContext* infer_ctx,
+              const std::shared_ptr<nic::InferContext::Request>& request) {
+            std::map<std::string, std::unique_ptr<nic::InferContext::Result>>
+                results;
+            bool is_ready = false;
+            nic::Error request_err = infer_ctx->GetAsyncRunResults(
+                &results, &is_ready, request, true);
+            const uint64_t end_ns = MonotonicNanos();
+
+            if (request_err.IsOk()) {
+              // Record the request latency with proper locking
+              std::lock_guard<std::mutex> lk(status_report_mutex_);
+              latencies->Record(
+                  send_ns, start_ns, end_ns,
+                  record.flags_ & ni::InferRequestHeader::FLAG_SEQUENCE_END);
+              latencies->RecordClientStages(
+                  *infer_ctx, &((*stats)[ctx->stat_idx_]));
+            }
+
+            {
+              std::lock_guard<std::mutex> lk(mtx_);
+              if (!request_err.IsOk() && callback_err_.IsOk()) {
+                callback_err_ = request_err;
+              }
+              // The context of a sequence is reused once the sequence ends
+              if (!on_sequence_model_ || (record.correlation_id_ == 0) ||
+                  (record.flags_ &
+                   ni::InferRequestHeader::FLAG_SEQUENCE_END)) {
+                idle_ctxs_.push_back(ctx);
+              }
+              inflight_request_cnt_--;
+            }
+            cv_.notify_all();
+          });
+    }
+    if (!err.IsOk()) {
+      std::lock_guard<std::mutex> lk(mtx_);
+      inflight_request_cnt_--;
+      break;
+    }
+  }
+
+  // Wait for all requests to complete
+  std::unique_lock<std::mutex> lk(mtx_);
+  cv_.wait(lk, [this]() { return (inflight_request_cnt_ == 0); });
+  if (!err.IsOk()) {
+    *threads_status_[0] = err;
+    return err;
+  }
+  if (!callback_err_.IsOk()) {
+    *threads_status_[0] = callback_err_;
+    return callback_err_;
+  }
+  return nic::Error::Success;
+}
+
+}  // namespace perfclient
@@ -0,0 +1,166 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "src/clients/c++/perf_client/load_manager.h"
+
+#include <map>
+
+namespace perfclient {
+
+/// A request recorded in a trace.
+struct TraceRecord {
+  // The time of the request in usec relative to the first request of the
+  // trace
+  uint64_t offset_us_;
+  int32_t batch_size_;
+  // The correlation ID of the sequence in the trace, 0 if the request is not
+  // part of a sequence
+  uint64_t correlation_id_;
+  // The sequence flags derived from the order of the requests of a sequence
+  uint32_t flags_;
+  // The directory containing the input data of the request, empty to use
+  // the data of the command-line options
+  std::string data_directory_;
+  // The shapes of the inputs of the request
+  std::unordered_map<std::string, std::vector<int64_t>> input_shapes_;
+};
+
+//==============================================================================
+/// TraceReplayManager is a helper class to send the requests recorded in a
+/// trace to the inference server at their recorded times, so that the
+/// perf_client can measure performance under the load of real traffic
+/// instead of a synthetic steady load.
+///
+/// Detail:
+/// The trace is replayed once by Replay(), which sends each request at its
+/// recorded time (optionally scaled) and returns when all the requests have
+/// completed. A request that is not part of a sequence is sent using a
+/// context that has no request in flight, so that each request can have its
+/// own batch size and input data. The requests of a sequence are sent using
+/// a context assigned to the sequence, with the START flag set on the first
+/// request of the sequence in the trace and the END flag on the last one.
+///
+class TraceReplayManager : public LoadManager {
+ public:
+  ~TraceReplayManager();
+
+  /// Create a trace replay manager that is responsible to replay the
+  /// requests of a model recorded in a trace.
+  /// \param records The requests of the model, ordered by time.
+  /// \param speed The speed of the replay relative to the recorded times,
+  /// for example 2 replays the trace in half of the recorded time.
+  /// \param zero_input Whether to fill the input tensors with zero.
+  /// \param input_shapes The shapes of the inputs with variable-size shape
+  /// that are not specified by a request.
+  /// \param data_directory The directory containing the input data of the
+  /// requests without their own data directory, or empty to use synthetic
+  /// data.
+  /// \param factory The ContextFactory object used to create InferContext.
+  /// \param manger Returns a new TraceReplayManager object.
+  /// \return Error object indicating success or failure.
+  static nic::Error Create(
+      const std::vector<TraceRecord>& records, const double speed,
+      const bool zero_input,
+      const std::unordered_map<std::string, std::vector<int64_t>>& input_shapes,
+      const std::string& data_directory,
+      const std::shared_ptr<ContextFactory>& factory,
+      std::unique_ptr<LoadManager>* manager);
+
+  /// Read a trace, one request per line:
+  ///
+  ///   <time in usec>,<model name>,<batch size>[,<correlation ID>[,<input>]]
+  ///
+  /// The input is either a directory containing the input data, or a
+  /// list of input shapes 'name:shape' separated by ';'. Empty lines and
+  /// lines starting with '#' are ignored.
+  /// \param path The path to the trace.
+  /// \param records Returns the requests of each model ordered by time.
+  /// \return Error object indicating success or failure.
+  static nic::Error ReadTraceFile(
+      const std::string& path,
+      std::map<std::string, std::vector<TraceRecord>>* records);
+
+  /// @ See LoadManager.Replay()
+  nic::Error Replay(const uint64_t start_ns) override;
+
+ private:
+  TraceReplayManager(
+      const std::vector<TraceRecord>& records, const double speed,
+      const std::unordered_map<std::string, std::vector<int64_t>>& input_shapes,
+      const std::shared_ptr<ContextFactory>& factory);
+
+  /// A context used to send the requests of the trace.
+  struct ReplayContext {
+    std::unique_ptr<nic::InferContext> ctx_;
+    std::unique_ptr<nic::InferContext::Options> options_;
+    // The index of the statistic of the context
+    size_t stat_idx_;
+  };
+
+  /// Read the input data of the requests and validate the requests.
+  /// \param zero_input Whether to fill the input tensors with zero.
+  /// \return Error object indicating success or failure.
+  nic::Error InitTrace(const bool zero_input);
+
+  /// Get the context to send 'record', must be called with 'mtx_' held.
+  /// \param record The request to be sent.
+  /// \param ctx Returns the context.
+  /// \return Error object indicating success or failure.
+  nic::Error GetContext(const TraceRecord& record, ReplayContext** ctx);
+
+  /// Set the options and inputs of 'ctx' for sending 'record'.
+  /// \param record The request to be sent.
+  /// \param ctx The context.
+  /// \return Error object indicating success or failure.
+  nic::Error PrepareRequest(const TraceRecord& record, ReplayContext* ctx);
+
+  const std::vector<TraceRecord> records_;
+  const double speed_;
+
+  // The input data of the requests keyed by the data directory and then
+  // by the input name
+  std::unordered_map<
+      std::string, std::unordered_map<std::string, std::vector<char>>>
+      trace_data_;
+
+  // All the contexts, the contexts that can be used for a request that is
+  // not part of a sequence and the context of each ongoing sequence keyed
+  // by the correlation ID in the trace.
+  std::vector<std::unique_ptr<ReplayContext>> ctxs_;
+  std::vector<ReplayContext*> idle_ctxs_;
+  std::unordered_map<uint64_t, ReplayContext*> sequence_ctxs_;
+
+  // The number of requests in flight and the first error reported by a
+  // request callback, guarded by 'mtx_'
+  size_t inflight_request_cnt_;
+  nic::Error callback_err_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+};
+
+}  // namespace perfclient
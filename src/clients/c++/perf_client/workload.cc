@@ -0,0 +1,217 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/clients/c++/perf_client/workload.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <sstream>
+
+namespace perfclient {
+
+namespace {
+
+nic::Error
+ParseOption(
+    const std::string& option, const std::string& value, WorkloadEntry* entry,
+    bool* has_load)
+{
+  try {
+    if (option == "version") {
+      entry->model_version_ = std::stoll(value);
+    } else if (option == "batch-size") {
+      entry->batch_size_ = std::stoi(value);
+      if (entry->batch_size_ <= 0) {
+        return nic::Error(
+            ni::RequestStatusCode::INVALID_ARG, "batch size must be > 0");
+      }
+    } else if ((option == "concurrency") || (option == "rate") ||
+               (option == "weight")) {
+      if (*has_load) {
+        return nic::Error(
+            ni::RequestStatusCode::INVALID_ARG,
+            "only one of 'concurrency', 'rate' and 'weight' can be specified");
+      }
+      *has_load = true;
+      entry->concurrency_ = 0;
+      entry->request_rate_ = 0;
+      entry->weight_ = 0;
+      if (option == "concurrency") {
+        const int concurrency = std::stoi(value);
+        if (concurrency <= 0) {
+          return nic::Error(
+              ni::RequestStatusCode::INVALID_ARG, "concurrency must be > 0");
+        }
+        entry->concurrency_ = concurrency;
+      } else if (option == "rate") {
+        entry->request_rate_ = std::stod(value);
+        if (!(entry->request_rate_ > 0)) {
+          return nic::Error(
+              ni::RequestStatusCode::INVALID_ARG, "rate must be > 0");
+        }
+      } else {
+        entry->weight_ = std::stod(value);
+        if (!(entry->weight_ > 0)) {
+          return nic::Error(
+              ni::RequestStatusCode::INVALID_ARG, "weight must be > 0");
+        }
+      }
+    } else if (option == "distribution") {
+      RETURN_IF_ERROR(
+          RequestRateManager::ParseDistribution(value, &entry->distribution_));
+    } else if (option == "data-directory") {
+      entry->data_directory_ = value;
+    } else if (option == "shape") {
+      std::string name;
+      std::vector<int64_t> shape;
+      RETURN_IF_ERROR(ParseInputShape(value, &name, &shape));
+      entry->input_shapes_[name] = shape;
+    } else if (option == "zero-input") {
+      entry->zero_input_ = true;
+    } else {
+      return nic::Error(
+          ni::RequestStatusCode::INVALID_ARG,
+          "unknown option '" + option + "'");
+    }
+  }
+  catch (const std::exception& e) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG,
+        "failed to parse value '" + value + "' of option '" + option + "'");
+  }
+
+  return nic::Error::Success;
+}
+
+}  // namespace
+
+nic::Error
+ReadWorkloadFile(
+    const std::string& path, const WorkloadEntry& defaults,
+    std::vector<WorkloadEntry>* entries)
+{
+  std::ifstream in(path);
+  if (!in) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG,
+        "failed to open file '" + path + "'");
+  }
+
+  std::set<std::pair<std::string, int64_t>> models;
+  std::string line;
+  size_t line_number = 0;
+  while (std::getline(in, line)) {
+    line_number++;
+    std::istringstream tokens(line);
+    std::string model_name;
+    if (!(tokens >> model_name) || (model_name[0] == '#')) {
+      continue;
+    }
+
+    WorkloadEntry entry = defaults;
+    entry.model_name_ = model_name;
+    entry.concurrency_ = 0;
+    entry.request_rate_ = 0;
+    entry.weight_ = 1;
+
+    bool has_load = false;
+    std::string token;
+    while (tokens >> token) {
+      const size_t eq_pos = token.find('=');
+      const std::string option = token.substr(0, eq_pos);
+      const std::string value =
+          (eq_pos == std::string::npos) ? "" : token.substr(eq_pos + 1);
+      if ((eq_pos == std::string::npos) != (option == "zero-input")) {
+        in.close();
+        return nic::Error(
+            ni::RequestStatusCode::INVALID_ARG,
+            "invalid option '" + token + "' at line " +
+                std::to_string(line_number) + " of '" + path + "'");
+      }
+
+      nic::Error err = ParseOption(option, value, &entry, &has_load);
+      if (!err.IsOk()) {
+        in.close();
+        return nic::Error(
+            ni::RequestStatusCode::INVALID_ARG,
+            err.Message() + " at line " + std::to_string(line_number) +
+                " of '" + path + "'");
+      }
+    }
+
+    if (entry.zero_input_ && !entry.data_directory_.empty()) {
+      in.close();
+      return nic::Error(
+          ni::RequestStatusCode::INVALID_ARG,
+          "zero input can't be set when data directory is provided at line " +
+              std::to_string(line_number) + " of '" + path + "'");
+    }
+
+    // Requests of the same model from different entries would reuse the
+    // same correlation IDs
+    if (!models.emplace(entry.model_name_, entry.model_version_).second) {
+      in.close();
+      return nic::Error(
+          ni::RequestStatusCode::INVALID_ARG,
+          "model '" + entry.model_name_ +
+              "' is listed more than once at line " +
+              std::to_string(line_number) + " of '" + path + "'");
+    }
+
+    entries->push_back(std::move(entry));
+  }
+
+  in.close();
+
+  if (entries->empty()) {
+    return nic::Error(
+        ni::RequestStatusCode::INVALID_ARG,
+        "file '" + path + "' does not list any model");
+  }
+
+  return nic::Error::Success;
+}
+
+void
+ResolveWorkload(
+    const size_t total_concurrency, std::vector<WorkloadEntry>* entries)
+{
+  double total_weight = 0;
+  for (const auto& entry : *entries) {
+    total_weight += entry.weight_;
+  }
+
+  for (auto& entry : *entries) {
+    if (entry.weight_ > 0) {
+      entry.concurrency_ = std::max<size_t>(
+          1, std::lround(total_concurrency * entry.weight_ / total_weight));
+      entry.weight_ = 0;
+    }
+  }
+}
+
+}  // namespace perfclient
@@ -0,0 +1,80 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "src/clients/c++/perf_client/request_rate_manager.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace perfclient {
+
+/// The load that perf_client produces for one model of a mixed workload.
+struct WorkloadEntry {
+  std::string model_name_;
+  int64_t model_version_;
+  int32_t batch_size_;
+  // Exactly one of the number of concurrent requests, the request rate and
+  // the share of the total concurrency is non-zero after parsing, the share
+  // is converted to a number of concurrent requests by ResolveWorkload().
+  size_t concurrency_;
+  double request_rate_;
+  double weight_;
+  RequestRateManager::Distribution distribution_;
+  bool zero_input_;
+  std::string data_directory_;
+  std::unordered_map<std::string, std::vector<int64_t>> input_shapes_;
+};
+
+/// Read a workload specification that lists the models to be profiled
+/// at the same time, one model per line:
+///
+///   <model name> [<option>=<value> ...]
+///
+/// The options are 'version', 'batch-size', 'concurrency', 'rate',
+/// 'weight', 'distribution', 'data-directory', 'shape' (may be repeated)
+/// and 'zero-input' (without value). Empty lines and lines starting with
+/// '#' are ignored. Options not given default to the values in 'defaults'.
+/// A model without 'concurrency', 'rate' or 'weight' has weight 1.
+/// \param path The path to the workload specification.
+/// \param defaults The entry that provides the default of each option.
+/// \param entries Returns the workload entries.
+/// \return Error object indicating success or failure.
+nic::Error ReadWorkloadFile(
+    const std::string& path, const WorkloadEntry& defaults,
+    std::vector<WorkloadEntry>* entries);
+
+/// Divide 'total_concurrency' among the entries that are specified by
+/// weight in proportion to their weights, each of them gets at least one
+/// concurrent request.
+/// \param total_concurrency The number of concurrent requests to divide.
+/// \param entries The workload entries to be updated.
+void ResolveWorkload(
+    const size_t total_concurrency, std::vector<WorkloadEntry>* entries);
+
+}  // namespace perfclient
@@ -132,7 +132,7 @@ _crequest_infer_ctx_new = _crequest.InferContextNew
 _crequest_infer_ctx_new.restype = c_void_p
 _crequest_infer_ctx_new.argtypes = [POINTER(c_void_p), _utf8, c_int,
                                     POINTER(c_char_p), c_int, _utf8, c_int64,
-                                    c_uint64, c_bool, c_bool]
+                                    c_uint64, c_bool, c_bool, _utf8]
 _crequest_infer_ctx_del = _crequest.InferContextDelete
 _crequest_infer_ctx_del.argtypes = [c_void_p]
 _crequest_infer_ctx_set_options = _crequest.InferContextSetOptions
@@ -157,7 +157,7 @@ _crequest_infer_ctx_get_ready_async_request.argtypes = [c_void_p, POINTER(c_bool
 
 _crequest_infer_ctx_options_new = _crequest.InferContextOptionsNew
 _crequest_infer_ctx_options_new.restype = c_void_p
-_crequest_infer_ctx_options_new.argtypes = [POINTER(c_void_p), c_uint32, c_uint64]
+_crequest_infer_ctx_options_new.argtypes = [POINTER(c_void_p), c_uint32, c_uint64, c_uint32]
 _crequest_infer_ctx_options_del = _crequest.InferContextOptionsDelete
 _crequest_infer_ctx_options_del.argtypes = [c_void_p]
 _crequest_infer_ctx_options_add_raw = _crequest.InferContextOptionsAddRaw
@@ -223,7 +223,7 @@ _crequest_infer_ctx_result_next_class.argtypes = [c_void_p, c_uint64, POINTER(c_
                                                   POINTER(c_float), POINTER(c_char_p)]
 _crequest_get_shared_memory_handle_info = _crequest.SharedMemoryControlContextGetSharedMemoryHandle
 _crequest_get_shared_memory_handle_info.restype = c_void_p
-_crequest_get_shared_memory_handle_info.argtypes = [c_void_p, POINTER(c_void_p), POINTER(c_char_p), POINTER(c_int), POINTER(c_uint64), POINTER(c_uint64)]
+_crequest_get_shared_memory_handle_info.argtypes = [c_void_p, POINTER(c_void_p), POINTER(c_char_p), POINTER(c_int), POINTER(c_uint64), POINTER(c_uint64), POINTER(c_int)]
 
 def _raise_if_error(err):
     """
@@ -245,6 +245,19 @@ def _raise_error(msg):
     _crequest_error_del(err)
     raise ex
 
+class _Result:
+    """Owns a result of an inference request. Numpy arrays that refer
+    to the result data in-place hold a reference to this object so
+    that the result is only deleted once the last of them is deleted.
+
+    """
+    def __init__(self):
+        self.handle = c_void_p()
+
+    def __del__(self):
+        if self.handle.value is not None:
+            _crequest_infer_ctx_result_del(self.handle)
+
 
 class ProtocolType(IntEnum):
     """Protocol types supported by the client API
@@ -740,7 +753,11 @@ class SharedMemoryControlContext:
         Parameters
         ----------
         shm_handle : c_void_p
-            The handle for the shared memory region.
+            The handle for the shared memory region, created with
+            tensorrtserver.shared_memory or, for a CUDA shared memory
+            region, with tensorrtserver.cuda_shared_memory. CUDA
+            shared memory can only be registered using the GRPC
+            protocol.
 
         Raises
         ------
@@ -876,6 +893,11 @@ class InferContext:
         HTTP headers to send with request. Ignored for GRPC
         protocol. Each header must be specified as "Header:Value".
 
+    compression_algorithm : str
+        The algorithm, one of 'none', 'deflate' or 'gzip', used to
+        compress requests. The server is asked to compress responses
+        with the same algorithm. Ignored for HTTP protocol.
+
     """
     class ResultFormat:
         """Formats for output tensor results.
@@ -893,7 +915,8 @@ class InferContext:
         CLASS = 2
 
     def __init__(self, url, protocol, model_name, model_version=None,
-                 verbose=False, correlation_id=0, streaming=False, http_headers=[]):
+                 verbose=False, correlation_id=0, streaming=False, http_headers=[],
+                 compression_algorithm='none'):
         self._correlation_id = correlation_id
         self._last_request_id = None
         self._last_request_model_name = None
@@ -918,7 +941,7 @@ class InferContext:
                     byref(self._ctx), url, int(protocol),
                     http_headers_arr, len(http_headers),
                     model_name, imodel_version, correlation_id,
-                    streaming, verbose)))
+                    streaming, verbose, compression_algorithm)))
 
     def __del__(self):
         # when module is unloading may get called after
@@ -974,7 +997,8 @@ class InferContext:
         _raise_error("unknown result datatype " + ctype.value)
 
     def _prepare_request(self, inputs, outputs,
-                         flags, batch_size, contiguous_input_values):
+                         flags, batch_size, contiguous_input_values,
+                         priority=0):
         # Make sure each input is given as a list (one entry per
         # batch). It is a common error when using batch-size 1 to
         # specify an input directly as an array instead of as a list
@@ -1007,7 +1031,8 @@ class InferContext:
         options = c_void_p()
         try:
             _raise_if_error(c_void_p(
-                _crequest_infer_ctx_options_new(byref(options), flags, batch_size)))
+                _crequest_infer_ctx_options_new(byref(options), flags, batch_size,
+                                                priority)))
 
             for (output_name, output_format) in iteritems(outputs):
                 if len(output_format) == 2 and isinstance(output_format, (list, tuple)) \
@@ -1119,171 +1144,185 @@ class InferContext:
         # Create the result map.
         results = dict()
         for (output_name, output_format) in iteritems(outputs):
-            result = c_void_p()
-            try:
-                if request_id is None:
-                    _raise_if_error(
-                        c_void_p(_crequest_infer_ctx_result_new(byref(result), self._ctx, output_name)))
-                else:
-                    _raise_if_error(
-                        c_void_p(_crequest_infer_ctx_async_result_new(byref(result), self._ctx, request_id, output_name)))
+            # RAW results are returned as numpy arrays that refer to
+            # the result data in-place, so the result is deleted when
+            # 'result_owner' and all those arrays are deleted.
+            result_owner = _Result()
+            result = result_owner.handle
+            if request_id is None:
+                _raise_if_error(
+                    c_void_p(_crequest_infer_ctx_result_new(byref(result), self._ctx, output_name)))
+            else:
+                _raise_if_error(
+                    c_void_p(_crequest_infer_ctx_async_result_new(byref(result), self._ctx, request_id, output_name)))
 
-                # The model name and version are the same for every
-                # result so only set once
-                if self._last_request_model_name is None:
-                    cmodelname = c_char_p()
-                    _raise_if_error(
-                        c_void_p(
-                            _crequest_infer_ctx_result_modelname(result, byref(cmodelname))))
-                    if cmodelname.value is not None:
-                        self._last_request_model_name = cmodelname.value.decode('utf-8')
-                if self._last_request_model_version is None:
-                    cmodelver = c_int64()
-                    _raise_if_error(
-                        c_void_p(
-                            _crequest_infer_ctx_result_modelver(result, byref(cmodelver))))
-                    self._last_request_model_version = cmodelver.value
-
-                result_dtype = self._get_result_numpy_dtype(result)
-                results[output_name] = list()
-                if output_format == InferContext.ResultFormat.RAW:
-                    # Get the shape of each result tensor
-                    max_shape_dims = 16
-                    shape_array = np.zeros(max_shape_dims, dtype=np.int64)
-                    shape_len = c_uint64()
+            # The model name and version are the same for every
+            # result so only set once
+            if self._last_request_model_name is None:
+                cmodelname = c_char_p()
+                _raise_if_error(
+                    c_void_p(
+                        _crequest_infer_ctx_result_modelname(result, byref(cmodelname))))
+                if cmodelname.value is not None:
+                    self._last_request_model_name = cmodelname.value.decode('utf-8')
+            if self._last_request_model_version is None:
+                cmodelver = c_int64()
+                _raise_if_error(
+                    c_void_p(
+                        _crequest_infer_ctx_result_modelver(result, byref(cmodelver))))
+                self._last_request_model_version = cmodelver.value
+
+            result_dtype = self._get_result_numpy_dtype(result)
+            results[output_name] = list()
+            if output_format == InferContext.ResultFormat.RAW:
+                # Get the shape of each result tensor
+                max_shape_dims = 16
+                shape_array = np.zeros(max_shape_dims, dtype=np.int64)
+                shape_len = c_uint64()
+                _raise_if_error(
+                    c_void_p(
+                        _crequest_infer_ctx_result_shape(
+                            result, c_uint64(max_shape_dims),
+                            shape_array, byref(shape_len))))
+                shape = np.resize(shape_array, shape_len.value).tolist()
+
+                for b in range(batch_size):
+                    # Get the result value into a 1-dim np array
+                    # of the appropriate type
+                    cval = c_char_p()
+                    cval_len = c_uint64()
                     _raise_if_error(
                         c_void_p(
-                            _crequest_infer_ctx_result_shape(
-                                result, c_uint64(max_shape_dims),
-                                shape_array, byref(shape_len))))
-                    shape = np.resize(shape_array, shape_len.value).tolist()
+                            _crequest_infer_ctx_result_next_raw(
+                                result, b, byref(cval), byref(cval_len))))
+                    if cval_len.value == 0:
+                        val = np.empty(shape, dtype=result_dtype)
+                        results[output_name].append(val)
+                    else:
+                        val_buf = cast(cval, POINTER(c_byte * cval_len.value))[0]
+
+                        # If the result is not a string datatype
+                        # then convert directly. Otherwise parse
+                        # 'val_buf' into an array of strings and
+                        # from that into a numpy array of string
+                        # objects.
+                        if result_dtype != np.object:
+                            val_buf._trtis_result = result_owner
+                            val = np.frombuffer(val_buf, dtype=result_dtype)
+                        else:
+                            # String results contain a 4-byte
+                            # string length followed by the actual
+                            # string characters.
+                            strs = list()
+                            offset = 0
+                            while offset < len(val_buf):
+                                l = struct.unpack_from("<I", val_buf, offset)[0]
+                                offset += 4
+                                sb = struct.unpack_from("<{}s".format(l), val_buf, offset)[0]
+                                offset += l
+                                strs.append(sb)
+                            val = np.array(strs, dtype=object)
 
-                    for b in range(batch_size):
-                        # Get the result value into a 1-dim np array
-                        # of the appropriate type
-                        cval = c_char_p()
-                        cval_len = c_uint64()
+                        # Reshape the result to the appropriate shape
+                        shaped = np.reshape(val, shape)
+                        results[output_name].append(shaped)
+
+            elif (isinstance(output_format, (list, tuple)) and
+                  (output_format[0] == InferContext.ResultFormat.CLASS)):
+                for b in range(batch_size):
+                    classes = list()
+                    ccnt = c_uint64()
+                    _raise_if_error(
+                       c_void_p(_crequest_infer_ctx_result_class_cnt(result, b, byref(ccnt))))
+                    for cc in range(ccnt.value):
+                        cidx = c_uint64()
+                        cprob = c_float()
+                        clabel = c_char_p()
                         _raise_if_error(
                             c_void_p(
-                                _crequest_infer_ctx_result_next_raw(
-                                    result, b, byref(cval), byref(cval_len))))
-                        if cval_len.value == 0:
+                                _crequest_infer_ctx_result_next_class(
+                                    result, b, byref(cidx), byref(cprob), byref(clabel))))
+                        label = None if clabel.value is None else clabel.value.decode('utf-8')
+                        classes.append((cidx.value, cprob.value, label))
+                    results[output_name].append(classes)
+            elif (isinstance(output_format, (list, tuple)) and
+                (output_format[0] == InferContext.ResultFormat.RAW) and (len(output_format) == 2)):
+                # Get the shape of each result tensor
+                max_shape_dims = 16
+                shape_array = np.zeros(max_shape_dims, dtype=np.int64)
+                shape_len = c_uint64()
+                _raise_if_error(
+                    c_void_p(
+                        _crequest_infer_ctx_result_shape(
+                            result, c_uint64(max_shape_dims),
+                            shape_array, byref(shape_len))))
+                shape = np.resize(shape_array, shape_len.value).tolist()
+
+                # get info for shared memory regions and read results
+                shm_fd = c_int()
+                offset = c_uint64()
+                byte_size = c_uint64()
+                shm_addr = c_void_p()
+                shm_key = c_char_p()
+                device_id = c_int()
+                _raise_if_error(
+                    c_void_p(_crequest_get_shared_memory_handle_info(output_format[1], \
+                            byref(shm_addr), byref(shm_key), byref(shm_fd), \
+                            byref(offset), byref(byte_size), byref(device_id))))
+                if (np.prod(shape) * np.dtype(result_dtype).itemsize) < int(byte_size.value/batch_size):
+                    element_byte_size = np.prod(shape) * np.dtype(result_dtype).itemsize
+                else:
+                    element_byte_size = int(byte_size.value/batch_size)
+                start_pos = offset.value
+                if device_id.value >= 0:
+                    # CUDA shared memory must be copied to the host.
+                    if result_dtype == np.object:
+                        _raise_error("string output '" + output_name +
+                                     "' is not supported in CUDA shared memory")
+                    import tensorrtserver.cuda_shared_memory as cudashm
+                    for b in range(batch_size):
+                        results[output_name].append(
+                            cudashm.get_contents_as_numpy(output_format[1], result_dtype,
+                                                          shape, start_pos))
+                        start_pos += element_byte_size
+                elif result_dtype != np.object:
+                    cval = shm_addr
+                    for b in range(batch_size):
+                        cval_len = start_pos + element_byte_size
+                        if cval_len == 0:
                             val = np.empty(shape, dtype=result_dtype)
                             results[output_name].append(val)
                         else:
-                            val_buf = cast(cval, POINTER(c_byte * cval_len.value))[0]
-
-                            # If the result is not a string datatype
-                            # then convert directly. Otherwise parse
-                            # 'val_buf' into an array of strings and
-                            # from that into a numpy array of string
-                            # objects.
-                            if result_dtype != np.object:
-                                val = np.frombuffer(val_buf, dtype=result_dtype)
-                            else:
-                                # String results contain a 4-byte
-                                # string length followed by the actual
-                                # string characters.
-                                strs = list()
-                                offset = 0
-                                while offset < len(val_buf):
-                                    l = struct.unpack_from("<I", val_buf, offset)[0]
-                                    offset += 4
-                                    sb = struct.unpack_from("<{}s".format(l), val_buf, offset)[0]
-                                    offset += l
-                                    strs.append(sb)
-                                val = np.array(strs, dtype=object)
-
-                            # Reshape the result to the appropriate shape
-                            shaped = np.reshape(np.copy(val), shape)
-                            results[output_name].append(shaped)
+                            val_buf = cast(cval, POINTER(c_byte * cval_len))[0]
+                            val = np.frombuffer(val_buf, dtype=result_dtype, offset=start_pos)
 
-                elif (isinstance(output_format, (list, tuple)) and
-                      (output_format[0] == InferContext.ResultFormat.CLASS)):
-                    for b in range(batch_size):
-                        classes = list()
-                        ccnt = c_uint64()
-                        _raise_if_error(
-                           c_void_p(_crequest_infer_ctx_result_class_cnt(result, b, byref(ccnt))))
-                        for cc in range(ccnt.value):
-                            cidx = c_uint64()
-                            cprob = c_float()
-                            clabel = c_char_p()
-                            _raise_if_error(
-                                c_void_p(
-                                    _crequest_infer_ctx_result_next_class(
-                                        result, b, byref(cidx), byref(cprob), byref(clabel))))
-                            label = None if clabel.value is None else clabel.value.decode('utf-8')
-                            classes.append((cidx.value, cprob.value, label))
-                        results[output_name].append(classes)
-                elif (isinstance(output_format, (list, tuple)) and
-                    (output_format[0] == InferContext.ResultFormat.RAW) and (len(output_format) == 2)):
-                    # Get the shape of each result tensor
-                    max_shape_dims = 16
-                    shape_array = np.zeros(max_shape_dims, dtype=np.int64)
-                    shape_len = c_uint64()
-                    _raise_if_error(
-                        c_void_p(
-                            _crequest_infer_ctx_result_shape(
-                                result, c_uint64(max_shape_dims),
-                                shape_array, byref(shape_len))))
-                    shape = np.resize(shape_array, shape_len.value).tolist()
-
-                    # get info for shared memory regions and read results
-                    shm_fd = c_int()
-                    offset = c_uint64()
-                    byte_size = c_uint64()
-                    shm_addr = c_void_p()
-                    shm_key = c_char_p()
-                    _raise_if_error(
-                        c_void_p(_crequest_get_shared_memory_handle_info(output_format[1], \
-                                byref(shm_addr), byref(shm_key), byref(shm_fd), \
-                                byref(offset), byref(byte_size))))
-                    if (np.prod(shape) * np.dtype(result_dtype).itemsize) < int(byte_size.value/batch_size):
-                        element_byte_size = np.prod(shape) * np.dtype(result_dtype).itemsize
-                    else:
-                        element_byte_size = int(byte_size.value/batch_size)
-                    start_pos = offset.value
-                    if result_dtype != np.object:
-                        cval = shm_addr
-                        for b in range(batch_size):
-                            cval_len = start_pos + element_byte_size
-                            if cval_len == 0:
-                                val = np.empty(shape, dtype=result_dtype)
-                                results[output_name].append(val)
-                            else:
-                                val_buf = cast(cval, POINTER(c_byte * cval_len))[0]
-                                val = np.frombuffer(val_buf, dtype=result_dtype, offset=start_pos)
-
-                            # Reshape the result to the appropriate shape
-                            start_pos += element_byte_size
-                            shaped = np.reshape(val, shape)
-                            results[output_name].append(shaped)
-                    else:
-                        cval = shm_addr
-                        str_offset = start_pos
-                        val_buf = cast(cval, POINTER(c_byte * byte_size.value))[0]
-                        b = 0
-                        while b < batch_size:
-                            ii = 0
-                            strs = list()
-                            while (ii % np.prod(shape) != 0) or (ii == 0):
-                                l = struct.unpack_from("<I", val_buf, str_offset)[0]
-                                str_offset += 4
-                                sb = struct.unpack_from("<{}s".format(l), val_buf, str_offset)[0]
-                                str_offset += l
-                                strs.append(sb)
-                                ii+=1
-                            b+=1
-
-                            # Reshape the result to the appropriate shape
-                            val = np.array(strs, dtype=object)
-                            shaped = np.reshape(val, shape)
-                            results[output_name].append(shaped)
+                        # Reshape the result to the appropriate shape
+                        start_pos += element_byte_size
+                        shaped = np.reshape(val, shape)
+                        results[output_name].append(shaped)
                 else:
-                    _raise_error("unrecognized output format")
-            finally:
-                _crequest_infer_ctx_result_del(result)
+                    cval = shm_addr
+                    str_offset = start_pos
+                    val_buf = cast(cval, POINTER(c_byte * byte_size.value))[0]
+                    b = 0
+                    while b < batch_size:
+                        ii = 0
+                        strs = list()
+                        while (ii % np.prod(shape) != 0) or (ii == 0):
+                            l = struct.unpack_from("<I", val_buf, str_offset)[0]
+                            str_offset += 4
+                            sb = struct.unpack_from("<{}s".format(l), val_buf, str_offset)[0]
+                            str_offset += l
+                            strs.append(sb)
+                            ii+=1
+                        b+=1
+
+                        # Reshape the result to the appropriate shape
+                        val = np.array(strs, dtype=object)
+                        shaped = np.reshape(val, shape)
+                        results[output_name].append(shaped)
+            else:
+                _raise_error("unrecognized output format")
 
         return results
 
@@ -1306,7 +1345,7 @@ class InferContext:
         """
         return self._correlation_id
 
-    def run(self, inputs, outputs, batch_size=1, flags=0):
+    def run(self, inputs, outputs, batch_size=1, flags=0, priority=0):
         """Run inference using the supplied 'inputs' to calculate the outputs
         specified by 'outputs'.
 
@@ -1317,7 +1356,8 @@ class InferContext:
             input. An input value is specified as a numpy array. Each
             input in the dictionary maps to a list of values (i.e. a
             list of numpy array objects), where the length of the list
-            must equal the 'batch_size'.
+            must equal the 'batch_size'. The data of a C-contiguous
+            numpy array is sent without a copy.
 
         outputs : dict
             Dictionary from output name to a value indicating the
@@ -1335,6 +1375,12 @@ class InferContext:
             The flags to use for the inference. The bitwise-or of
             InferRequestHeader.Flag values.
 
+        priority : int
+            The priority of the inference, where 1 is the highest
+            priority. The default of 0 indicates that the model's
+            default priority level should be used. Ignored if the
+            model does not enable priority levels.
+
         Returns
         -------
         dict
@@ -1343,7 +1389,9 @@ class InferContext:
             batch). The format of a value returned for an output
             depends on the output format specified in 'outputs'. For
             format RAW a value is a numpy array of the appropriate
-            type and shape for the output. For format CLASS a value is
+            type and shape for the output. Unless the output is a
+            string, the numpy array refers to the data received from
+            the server without a copy. For format CLASS a value is
             the top 'k' output values returned as an array of (class
             index, class value, class label) tuples.
 
@@ -1365,14 +1413,15 @@ class InferContext:
         contiguous_input = list()
 
         # Set run option and input values
-        self._prepare_request(inputs, outputs, flags, batch_size, contiguous_input)
+        self._prepare_request(inputs, outputs, flags, batch_size, contiguous_input,
+                              priority)
 
         # Run inference...
         self._last_request_id = _raise_if_error(c_void_p(_crequest_infer_ctx_run(self._ctx)))
 
         return self._get_results(outputs, batch_size)
 
-    def async_run(self, inputs, outputs, batch_size=1, flags=0):
+    def async_run(self, inputs, outputs, batch_size=1, flags=0, priority=0):
         """DEPRECATED: This function is deprecated and will be removed in
         a future version of this API. Instead use async_run_with_cb().
 
@@ -1409,6 +1458,12 @@ class InferContext:
             The flags to use for the inference. The bitwise-or of
             InferRequestHeader.Flag values.
 
+        priority : int
+            The priority of the inference, where 1 is the highest
+            priority. The default of 0 indicates that the model's
+            default priority level should be used. Ignored if the
+            model does not enable priority levels.
+
         Returns
         -------
         int
@@ -1429,7 +1484,8 @@ class InferContext:
         contiguous_input = list()
 
         # Set run option and input values
-        self._prepare_request(inputs, outputs, flags, batch_size, contiguous_input)
+        self._prepare_request(inputs, outputs, flags, batch_size, contiguous_input,
+                              priority)
 
         # Run asynchronous inference...
         c_request_id = c_uint64()
@@ -1441,7 +1497,7 @@ class InferContext:
 
         return c_request_id.value
 
-    def async_run_with_cb(self, callback, inputs, outputs, batch_size=1, flags=0):
+    def async_run_with_cb(self, callback, inputs, outputs, batch_size=1, flags=0, priority=0):
         """Run inference using the supplied 'inputs' to calculate the outputs
         specified by 'outputs'.
 
@@ -1482,6 +1538,12 @@ class InferContext:
             The flags to use for the inference. The bitwise-or of
             InferRequestHeader.Flag values.
 
+        priority : int
+            The priority of the inference, where 1 is the highest
+            priority. The default of 0 indicates that the model's
+            default priority level should be used. Ignored if the
+            model does not enable priority levels.
+
         Raises
         ------
         InferenceServerException
@@ -1495,7 +1557,8 @@ class InferContext:
         contiguous_input = list()
 
         # Set run option and input values
-        self._prepare_request(inputs, outputs, flags, batch_size, contiguous_input)
+        self._prepare_request(inputs, outputs, flags, batch_size, contiguous_input,
+                              priority)
 
         # Wrap over the provided callback
         wrapped_cb = partial(self._async_callback_wrapper, self._callback_resources_dict_id, callback)
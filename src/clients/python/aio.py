@@ -0,0 +1,185 @@
+# Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+import asyncio
+from tensorrtserver.api import InferContext, InferenceServerException
+
+class AsyncInferContext:
+    """An AsyncInferContext object is used to run inference on an
+    inference server for a specific model from an asyncio event loop.
+
+    Inference requests are sent and their responses are received by
+    the threads of the client library, which do not hold the Python
+    GIL, and each run() is an awaitable that completes in the event
+    loop when the response is received. Any number of run() calls can
+    be awaited concurrently. With a streaming context all requests
+    are sent over a single gRPC stream.
+
+    An AsyncInferContext must only be used from the event loop it was
+    created for.
+
+    Parameters
+    ----------
+    url : str
+        The inference server URL, e.g. localhost:8000.
+
+    protocol : ProtocolType
+        The protocol used to communicate with the server.
+
+    model_name : str
+        The name of the model to use for inference.
+
+    model_version : int
+        The version of the model to use for inference,
+        or None to indicate that the latest (i.e. highest version number)
+        version should be used.
+
+    verbose : bool
+        If True generate verbose output.
+
+    correlation_id : int
+        The correlation ID for the inference. If not specified (or if
+        specified as 0), the inference will have no correlation ID.
+
+    streaming : bool
+        If True create streaming context. Streaming is only allowed with
+        gRPC protocol.
+
+    http_headers : list of strings
+        HTTP headers to send with request. Ignored for GRPC
+        protocol. Each header must be specified as "Header:Value".
+
+    compression_algorithm : str
+        The algorithm, one of 'none', 'deflate' or 'gzip', used to
+        compress requests. The server is asked to compress responses
+        with the same algorithm. Ignored for HTTP protocol.
+
+    loop : asyncio.AbstractEventLoop
+        The event loop that completes the requests, or None to use the
+        current event loop.
+
+    """
+    def __init__(self, url, protocol, model_name, model_version=None,
+                 verbose=False, correlation_id=0, streaming=False, http_headers=[],
+                 compression_algorithm='none', loop=None):
+        self._loop = asyncio.get_event_loop() if loop is None else loop
+        self._ctx = InferContext(url, protocol, model_name, model_version,
+                                 verbose, correlation_id, streaming, http_headers,
+                                 compression_algorithm)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, type, value, traceback):
+        self.close()
+
+    def _on_complete(self, future, infer_ctx, request_id):
+        # Called by a client library thread, so defer getting the
+        # results to the event loop.
+        if not self._loop.is_closed():
+            self._loop.call_soon_threadsafe(self._complete, future, request_id)
+
+    def _complete(self, future, request_id):
+        # The results are retrieved even if the awaiting task was
+        # cancelled so that the resources of the request are released.
+        try:
+            results = self._ctx.get_async_run_results(request_id, True)
+        except InferenceServerException as ex:
+            if not future.cancelled():
+                future.set_exception(ex)
+            return
+
+        if not future.cancelled():
+            future.set_result(results)
+
+    def close(self):
+        """Close the context. Any future calls to object will result in an
+        Error. All requests must be complete before the context is
+        closed.
+
+        """
+        self._ctx.close()
+
+    async def run(self, inputs, outputs, batch_size=1, flags=0, priority=0):
+        """Run inference using the supplied 'inputs' to calculate the outputs
+        specified by 'outputs'.
+
+        The arguments and the results are the same as for
+        InferContext.run(). The inputs must not be modified until the
+        run is complete.
+
+        Parameters
+        ----------
+        inputs : dict
+            Dictionary from input name to the value(s) for that
+            input. An input value is specified as a numpy array. Each
+            input in the dictionary maps to a list of values (i.e. a
+            list of numpy array objects), where the length of the list
+            must equal the 'batch_size'.
+
+        outputs : dict
+            Dictionary from output name to a value indicating the
+            ResultFormat that should be used for that output. For RAW
+            the value should be ResultFormat.RAW. For CLASS the value
+            should be a tuple (ResultFormat.CLASS, k), where 'k'
+            indicates how many classification results should be
+            returned for the output.
+
+        batch_size : int
+            The batch size of the inference. Each input must provide
+            an appropriately sized batch of inputs.
+
+        flags : int
+            The flags to use for the inference. The bitwise-or of
+            InferRequestHeader.Flag values.
+
+        priority : int
+            The priority of the inference, where 1 is the highest
+            priority. The default of 0 indicates that the model's
+            default priority level should be used. Ignored if the
+            model does not enable priority levels.
+
+        Returns
+        -------
+        dict
+            A dictionary from output name to the list of values for
+            that output (one list element for each entry of the
+            batch), as returned by InferContext.run().
+
+        Raises
+        ------
+        InferenceServerException
+            If all inputs are not specified, if the size of input data
+            does not match expectations, if unknown output names are
+            specified or if server fails to perform inference.
+
+        """
+        future = self._loop.create_future()
+        self._ctx.async_run_with_cb(
+            lambda infer_ctx, request_id: self._on_complete(future, infer_ctx, request_id),
+            inputs, outputs, batch_size, flags, priority)
+        return await future
@@ -67,6 +67,8 @@ function main() {
 
   cp __init__.py \
     "${WHLDIR}/tensorrtserver/api/."
+  cp aio.py \
+    "${WHLDIR}/tensorrtserver/api/."
 
   if [ "$(expr substr $(uname -s) 1 5)" == "Linux" ]; then
     mkdir -p ${WHLDIR}/tensorrtserver/shared_memory
@@ -76,6 +78,14 @@ function main() {
       "${WHLDIR}/tensorrtserver/shared_memory/."
   fi
 
+  if [ -f libccudashm.so ]; then
+    mkdir -p ${WHLDIR}/tensorrtserver/cuda_shared_memory
+    cp libccudashm.so \
+      "${WHLDIR}/tensorrtserver/cuda_shared_memory/."
+    cp cuda_shared_memory/__init__.py \
+      "${WHLDIR}/tensorrtserver/cuda_shared_memory/."
+  fi
+
   cp setup.py "${WHLDIR}"
 	touch ${WHLDIR}/tensorrtserver/__init__.py
 
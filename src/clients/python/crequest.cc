@@ -378,9 +378,17 @@ SharedMemoryControlContextRegister(
 {
   SharedMemoryHandle* handle =
       reinterpret_cast<SharedMemoryHandle*>(shm_handle);
-  nic::Error err = ctx->ctx->RegisterSharedMemory(
-      handle->trtis_shm_name_, handle->shm_key_, handle->offset_,
-      handle->byte_size_);
+  nic::Error err;
+  if (handle->device_id_ < 0) {
+    err = ctx->ctx->RegisterSharedMemory(
+        handle->trtis_shm_name_, handle->shm_key_, handle->offset_,
+        handle->byte_size_);
+  } else {
+    err = ctx->ctx->RegisterCudaSharedMemory(
+        handle->trtis_shm_name_, handle->shm_key_, 0 /* handle_offset */,
+        handle->ipc_handle_byte_size_, handle->offset_, handle->byte_size_,
+        handle->device_id_);
+  }
   if (err.IsOk()) {
     return nullptr;
   }
@@ -437,7 +445,7 @@ SharedMemoryControlContextGetStatus(
 nic::Error*
 SharedMemoryControlContextGetSharedMemoryHandle(
     void* shm_handle, void** shm_addr, const char** shm_key, int* shm_fd,
-    size_t* offset, size_t* byte_size)
+    size_t* offset, size_t* byte_size, int* device_id)
 {
   SharedMemoryHandle* handle =
       reinterpret_cast<SharedMemoryHandle*>(shm_handle);
@@ -446,6 +454,7 @@ SharedMemoryControlContextGetSharedMemoryHandle(
   *shm_fd = handle->shm_fd_;
   *offset = handle->offset_;
   *byte_size = handle->byte_size_;
+  *device_id = handle->device_id_;
   return nullptr;
 }
 
@@ -463,7 +472,7 @@ InferContextNew(
     InferContextCtx** ctx, const char* url, int protocol_int,
     const char** headers, int num_headers, const char* model_name,
     int64_t model_version, ni::CorrelationID correlation_id, bool streaming,
-    bool verbose)
+    bool verbose, const char* compression_algorithm)
 {
   nic::Error err;
   ProtocolType protocol;
@@ -478,7 +487,8 @@ InferContextNew(
     if (streaming) {
       err = nic::InferGrpcStreamContext::Create(
           &(lctx->ctx), correlation_id, std::string(url),
-          std::string(model_name), model_version, verbose);
+          std::string(model_name), model_version, verbose,
+          std::string(compression_algorithm));
     } else if (protocol == ProtocolType::HTTP) {
       std::map<std::string, std::string> http_headers;
       err = ParseHttpHeaders(&http_headers, headers, num_headers);
@@ -490,7 +500,8 @@ InferContextNew(
     } else {
       err = nic::InferGrpcContext::Create(
           &(lctx->ctx), correlation_id, std::string(url),
-          std::string(model_name), model_version, verbose);
+          std::string(model_name), model_version, verbose,
+          std::string(compression_algorithm));
     }
 
     if (err.IsOk()) {
@@ -588,7 +599,8 @@ InferContextGetReadyAsyncRequest(
 //==============================================================================
 nic::Error*
 InferContextOptionsNew(
-    nic::InferContext::Options** ctx, uint32_t flags, uint64_t batch_size)
+    nic::InferContext::Options** ctx, uint32_t flags, uint64_t batch_size,
+    uint32_t priority)
 {
   std::unique_ptr<nic::InferContext::Options> uctx;
   nic::Error err = nic::InferContext::Options::Create(&uctx);
@@ -596,6 +608,7 @@ InferContextOptionsNew(
     *ctx = uctx.release();
     (*ctx)->SetFlags(flags);
     (*ctx)->SetBatchSize(batch_size);
+    (*ctx)->SetPriority(priority);
     return nullptr;
   }
 
@@ -97,7 +97,7 @@ nic::Error* SharedMemoryControlContextGetStatus(
     SharedMemoryControlContextCtx* ctx, char** status, uint32_t* status_len);
 nic::Error* SharedMemoryControlContextGetSharedMemoryHandle(
     void* shm_handle, void** shm_addr, const char** shm_key, int* shm_fd,
-    size_t* offset, size_t* byte_size);
+    size_t* offset, size_t* byte_size, int* device_id);
 //==============================================================================
 // InferContext
 typedef struct InferContextCtx InferContextCtx;
@@ -105,7 +105,7 @@ nic::Error* InferContextNew(
     InferContextCtx** ctx, const char* url, int protocol_int,
     const char** headers, int num_headers, const char* model_name,
     int64_t model_version, ni::CorrelationID correlation_id, bool streaming,
-    bool verbose);
+    bool verbose, const char* compression_algorithm);
 void InferContextDelete(InferContextCtx* ctx);
 nic::Error* InferContextSetOptions(
     InferContextCtx* ctx, nic::InferContext::Options* options);
@@ -121,7 +121,8 @@ nic::Error* InferContextGetReadyAsyncRequest(
 //==============================================================================
 // InferContext::Options
 nic::Error* InferContextOptionsNew(
-    nic::InferContext::Options** ctx, uint32_t flags, uint64_t batch_size);
+    nic::InferContext::Options** ctx, uint32_t flags, uint64_t batch_size,
+    uint32_t priority);
 void InferContextOptionsDelete(nic::InferContext::Options* ctx);
 nic::Error* InferContextOptionsAddRaw(
     InferContextCtx* infer_ctx, nic::InferContext::Options* ctx,
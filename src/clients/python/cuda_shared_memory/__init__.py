@@ -0,0 +1,228 @@
+# Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+from ctypes import *
+import numpy as np
+import pkg_resources
+
+class _utf8(object):
+    @classmethod
+    def from_param(cls, value):
+        if value is None:
+            return None
+        elif isinstance(value, bytes):
+            return value
+        else:
+            return value.encode('utf8')
+
+_ccudashm_lib = 'libccudashm.so'
+_ccudashm_path = pkg_resources.resource_filename('tensorrtserver.cuda_shared_memory', _ccudashm_lib)
+_ccudashm = cdll.LoadLibrary(_ccudashm_path)
+
+_ccudashm_shared_memory_region_create = _ccudashm.CudaSharedMemoryRegionCreate
+_ccudashm_shared_memory_region_create.restype = c_int
+_ccudashm_shared_memory_region_create.argtypes = [_utf8, _utf8, c_uint64, c_int, POINTER(c_void_p)]
+_ccudashm_shared_memory_region_set = _ccudashm.CudaSharedMemoryRegionSet
+_ccudashm_shared_memory_region_set.restype = c_int
+_ccudashm_shared_memory_region_set.argtypes = [c_void_p, c_uint64, c_uint64, c_void_p]
+_ccudashm_shared_memory_region_get = _ccudashm.CudaSharedMemoryRegionGet
+_ccudashm_shared_memory_region_get.restype = c_int
+_ccudashm_shared_memory_region_get.argtypes = [c_void_p, c_uint64, c_uint64, c_void_p]
+_ccudashm_shared_memory_region_destroy = _ccudashm.CudaSharedMemoryRegionDestroy
+_ccudashm_shared_memory_region_destroy.restype = c_int
+_ccudashm_shared_memory_region_destroy.argtypes = [c_void_p]
+
+def _raise_if_error(errno):
+    """
+    Raise CudaSharedMemoryException if 'err' is non-success.
+    Otherwise return nothing.
+    """
+    if errno.value != 0:
+        ex = CudaSharedMemoryException(errno)
+        raise ex
+    return
+
+def _raise_error(msg):
+    ex = CudaSharedMemoryException(msg)
+    raise ex
+
+def create_shared_memory_region(trtis_shm_name, shm_key, byte_size, device_id):
+    """Allocates a CUDA shared memory region of the specified size on a
+    GPU. The cudaIpcMemHandle_t of the region is placed in a system
+    shared memory region so that the region can be registered with
+    the inference server using SharedMemoryControlContext.register().
+
+    Parameters
+    ----------
+    trtis_shm_name : str
+        The name of the region when registered with the inference
+        server.
+    shm_key : str
+        The unique key of the system shared memory object holding the
+        cudaIpcMemHandle_t.
+    byte_size : int
+        The size in bytes of the CUDA shared memory region to be
+        created.
+    device_id : int
+        The GPU device on which to allocate the region.
+
+    Returns
+    -------
+    shm_handle : c_void_p
+        The handle for the CUDA shared memory region.
+
+    Raises
+    ------
+    CudaSharedMemoryException
+        If unable to create the CUDA shared memory region.
+    """
+
+    shm_handle = c_void_p()
+    _raise_if_error(
+        c_int(_ccudashm_shared_memory_region_create(
+            trtis_shm_name, shm_key, byte_size, device_id, byref(shm_handle))))
+
+    return shm_handle
+
+def set_shared_memory_region(shm_handle, input_values):
+    """Copy the contents of the numpy arrays into a CUDA shared memory
+    region, one after the other starting at the beginning of the
+    region.
+
+    Parameters
+    ----------
+    shm_handle : c_void_p
+        The handle for the CUDA shared memory region.
+    input_values : list
+        The list of numpy arrays to be copied into the CUDA shared
+        memory region.
+
+    Raises
+    ------
+    CudaSharedMemoryException
+        If unable to copy the values into the CUDA shared memory
+        region.
+    """
+
+    if not isinstance(input_values, (list,tuple)):
+        _raise_error("input_values must be specified as a numpy array")
+    for input_value in input_values:
+        if not isinstance(input_value, (np.ndarray,)):
+            _raise_error("input_values must be specified as a list/tuple of numpy arrays")
+
+    offset_current = 0
+    for input_value in input_values:
+        input_value = np.ascontiguousarray(input_value)
+        byte_size = input_value.size * input_value.itemsize
+        _raise_if_error(
+            c_int(_ccudashm_shared_memory_region_set(shm_handle, c_uint64(offset_current), \
+                c_uint64(byte_size), input_value.ctypes.data_as(c_void_p))))
+        offset_current += byte_size
+    return
+
+def get_contents_as_numpy(shm_handle, datatype, shape, offset=0):
+    """Copy contents of a CUDA shared memory region into a new numpy
+    array.
+
+    Parameters
+    ----------
+    shm_handle : c_void_p
+        The handle for the CUDA shared memory region.
+    datatype : np.dtype
+        The datatype of the array. String datatypes are not supported.
+    shape : list
+        The shape of the array.
+    offset : int
+        The offset, in bytes, of the array within the region.
+
+    Returns
+    -------
+    np.array
+        A numpy array holding a copy of the contents of the region.
+
+    Raises
+    ------
+    CudaSharedMemoryException
+        If unable to copy the contents of the CUDA shared memory
+        region.
+    """
+
+    val = np.empty(shape, dtype=datatype)
+    byte_size = val.size * val.itemsize
+    if byte_size > 0:
+        _raise_if_error(
+            c_int(_ccudashm_shared_memory_region_get(shm_handle, c_uint64(offset), \
+                c_uint64(byte_size), val.ctypes.data_as(c_void_p))))
+    return val
+
+def destroy_shared_memory_region(shm_handle):
+    """Free a CUDA shared memory region and unlink the system shared
+    memory region holding its cudaIpcMemHandle_t. The region must be
+    unregistered from the inference server first.
+
+    Parameters
+    ----------
+    shm_handle : c_void_p
+        The handle for the CUDA shared memory region.
+
+    Raises
+    ------
+    CudaSharedMemoryException
+        If unable to free the CUDA shared memory region.
+    """
+
+    _raise_if_error(
+        c_int(_ccudashm_shared_memory_region_destroy(shm_handle)))
+    return
+
+class CudaSharedMemoryException(Exception):
+    """Exception indicating non-Success status.
+
+    Parameters
+    ----------
+    err : c_int
+        The error code that should be used to initialize the exception.
+
+    """
+    def __init__(self, err):
+        self.err_code_map = { -2: "unable to get shared memory descriptor",
+                            -3: "unable to initialize the size",
+                            -4: "unable to write the CUDA IPC handle",
+                            -5: "unable to unlink the shared memory region",
+                            -6: "unable to set the GPU device",
+                            -7: "unable to allocate and export CUDA memory",
+                            -8: "access outside of the CUDA shared memory region",
+                            -9: "unable to copy CUDA shared memory",
+                            -10: "unable to free CUDA memory"}
+        self._msg = None
+        if isinstance(err, str):
+            self._msg = err
+        elif err.value != 0 and err.value in self.err_code_map:
+            self._msg = self.err_code_map[err.value]
+
+    def __str__(self):
+        msg = super().__str__() if self._msg is None else self._msg
+        return msg
@@ -0,0 +1,180 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/clients/python/cuda_shared_memory/cuda_shared_memory.h"
+
+#include <cuda_runtime_api.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <string>
+#include "src/clients/python/shared_memory/shared_memory_handle.h"
+
+//==============================================================================
+// CUDA shared memory regions
+
+namespace {
+
+// Write 'ipc_handle' into the system shared memory region 'shm_key'
+// where the inference server can read it. Return the descriptor of
+// the region in 'shm_fd'.
+int
+WriteIpcHandle(
+    const std::string& shm_key, const cudaIpcMemHandle_t& ipc_handle,
+    int* shm_fd)
+{
+  *shm_fd = shm_open(shm_key.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+  if (*shm_fd == -1) {
+    return -2;
+  }
+
+  if (ftruncate(*shm_fd, sizeof(ipc_handle)) == -1) {
+    close(*shm_fd);
+    shm_unlink(shm_key.c_str());
+    return -3;
+  }
+
+  if (pwrite(*shm_fd, &ipc_handle, sizeof(ipc_handle), 0) !=
+      (ssize_t)sizeof(ipc_handle)) {
+    close(*shm_fd);
+    shm_unlink(shm_key.c_str());
+    return -4;
+  }
+
+  return 0;
+}
+
+}  // namespace
+
+int
+CudaSharedMemoryRegionCreate(
+    const char* trtis_shm_name, const char* shm_key, size_t byte_size,
+    int device_id, void** shm_handle)
+{
+  // Allocate the device memory on the requested GPU and export it so
+  // that the inference server can open it.
+  int prev_device_id;
+  if (cudaGetDevice(&prev_device_id) != cudaSuccess) {
+    return -6;
+  }
+  if (cudaSetDevice(device_id) != cudaSuccess) {
+    return -6;
+  }
+
+  void* dev_ptr = nullptr;
+  cudaIpcMemHandle_t ipc_handle;
+  cudaError_t cuerr = cudaMalloc(&dev_ptr, byte_size);
+  if (cuerr == cudaSuccess) {
+    cuerr = cudaIpcGetMemHandle(&ipc_handle, dev_ptr);
+    if (cuerr != cudaSuccess) {
+      cudaFree(dev_ptr);
+    }
+  }
+  cudaSetDevice(prev_device_id);
+
+  if (cuerr != cudaSuccess) {
+    return -7;
+  }
+
+  int shm_fd;
+  int err = WriteIpcHandle(shm_key, ipc_handle, &shm_fd);
+  if (err != 0) {
+    cudaFree(dev_ptr);
+    return err;
+  }
+
+  SharedMemoryHandle* handle = new SharedMemoryHandle();
+  handle->trtis_shm_name_ = trtis_shm_name;
+  handle->base_addr_ = dev_ptr;
+  handle->shm_key_ = shm_key;
+  handle->shm_fd_ = shm_fd;
+  handle->offset_ = 0;
+  handle->byte_size_ = byte_size;
+  handle->device_id_ = device_id;
+  handle->ipc_handle_byte_size_ = sizeof(ipc_handle);
+
+  *shm_handle = reinterpret_cast<void*>(handle);
+  return 0;
+}
+
+int
+CudaSharedMemoryRegionSet(
+    void* shm_handle, size_t offset, size_t byte_size, const void* data)
+{
+  SharedMemoryHandle* handle =
+      reinterpret_cast<SharedMemoryHandle*>(shm_handle);
+  if ((offset + byte_size) > handle->byte_size_) {
+    return -8;
+  }
+
+  char* dev_ptr = reinterpret_cast<char*>(handle->base_addr_);
+  if (cudaMemcpy(dev_ptr + offset, data, byte_size, cudaMemcpyHostToDevice) !=
+      cudaSuccess) {
+    return -9;
+  }
+
+  return 0;
+}
+
+int
+CudaSharedMemoryRegionGet(
+    void* shm_handle, size_t offset, size_t byte_size, void* data)
+{
+  SharedMemoryHandle* handle =
+      reinterpret_cast<SharedMemoryHandle*>(shm_handle);
+  if ((offset + byte_size) > handle->byte_size_) {
+    return -8;
+  }
+
+  const char* dev_ptr = reinterpret_cast<const char*>(handle->base_addr_);
+  if (cudaMemcpy(data, dev_ptr + offset, byte_size, cudaMemcpyDeviceToHost) !=
+      cudaSuccess) {
+    return -9;
+  }
+
+  return 0;
+}
+
+int
+CudaSharedMemoryRegionDestroy(void* shm_handle)
+{
+  SharedMemoryHandle* handle =
+      reinterpret_cast<SharedMemoryHandle*>(shm_handle);
+
+  int err = 0;
+  close(handle->shm_fd_);
+  if (shm_unlink(handle->shm_key_.c_str()) == -1) {
+    err = -5;
+  }
+  if (cudaFree(handle->base_addr_) != cudaSuccess) {
+    err = -10;
+  }
+
+  delete handle;
+  return err;
+}
+
+//==============================================================================
@@ -57,7 +57,7 @@ except ImportError:
 if os.name == 'nt':
     platform_package_data = [ 'crequest.dll', 'request.dll']
 else:
-    platform_package_data = [ 'libcrequest.so', 'librequest.so', 'libcshm.so' ]
+    platform_package_data = [ 'libcrequest.so', 'librequest.so', 'libcshm.so', 'libccudashm.so' ]
 
 setup(
     name='tensorrtserver',
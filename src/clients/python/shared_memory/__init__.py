@@ -55,6 +55,9 @@ _cshm_shared_memory_region_create.argtypes = [_utf8, _utf8, c_uint64, POINTER(c_
 _cshm_shared_memory_region_set = _cshm.SharedMemoryRegionSet
 _cshm_shared_memory_region_set.restype = c_int
 _cshm_shared_memory_region_set.argtypes = [c_void_p, c_uint64, c_uint64, c_void_p]
+_cshm_shared_memory_region_info = _cshm.SharedMemoryRegionInfo
+_cshm_shared_memory_region_info.restype = c_int
+_cshm_shared_memory_region_info.argtypes = [c_void_p, POINTER(c_void_p), POINTER(c_uint64)]
 _cshm_shared_memory_region_destroy = _cshm.SharedMemoryRegionDestroy
 _cshm_shared_memory_region_destroy.restype = c_int
 _cshm_shared_memory_region_destroy.argtypes = [c_void_p]
@@ -133,6 +136,57 @@ def set_shared_memory_region(shm_handle, input_values):
         offset_current += byte_size
     return
 
+def get_contents_as_numpy(shm_handle, datatype, shape, offset=0):
+    """Return a numpy array that is a view of the contents of a shared
+    memory region. The contents are not copied, so writing to the array
+    writes directly into the region and the array reflects the values
+    written into the region by the inference server. The array must not
+    be used after the region is destroyed.
+
+    Parameters
+    ----------
+    shm_handle : c_void_p
+        The handle for the shared memory region.
+    datatype : np.dtype
+        The datatype of the array. String datatypes are not supported.
+    shape : list
+        The shape of the array.
+    offset : int
+        The offset, in bytes, of the array within the region.
+
+    Returns
+    -------
+    np.array
+        A writable numpy array viewing the contents of the region.
+
+    Raises
+    ------
+    SharedMemoryException
+        If the array does not fit in the shared memory region.
+    """
+
+    datatype = np.dtype(datatype)
+    if datatype == np.object:
+        _raise_error("string datatype is not supported for a shared memory view")
+
+    shm_addr = c_void_p()
+    region_byte_size = c_uint64()
+    _raise_if_error(
+        c_int(_cshm_shared_memory_region_info(shm_handle, byref(shm_addr), \
+            byref(region_byte_size))))
+
+    count = int(np.prod(shape))
+    byte_size = count * datatype.itemsize
+    if offset < 0 or offset + byte_size > region_byte_size.value:
+        _raise_error("array of " + str(byte_size) + " bytes at offset " +
+                     str(offset) + " exceeds the shared memory region of " +
+                     str(region_byte_size.value) + " bytes")
+    if byte_size == 0:
+        return np.empty(shape, dtype=datatype)
+
+    buf = (c_byte * byte_size).from_address(shm_addr.value + offset)
+    return np.frombuffer(buf, dtype=datatype, count=count).reshape(shape)
+
 def destroy_shared_memory_region(shm_handle):
     """Unlink a shared memory region with the specified name.
 
@@ -166,7 +220,9 @@ class SharedMemoryException(Exception):
                             -4: "unable to read/mmap the shared memory region",
                             -5: "unable to unlink the shared memory region"}
         self._msg = None
-        if err.value != 0 and err.value in self.err_code_map:
+        if isinstance(err, str):
+            self._msg = err
+        elif err.value != 0 and err.value in self.err_code_map:
             self._msg = self.err_code_map[err.value]
 
     def __str__(self):
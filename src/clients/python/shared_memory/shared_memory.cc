@@ -59,7 +59,8 @@ SharedMemoryRegionMap(
     int shm_fd, size_t offset, size_t byte_size, void** shm_addr)
 {
   // map shared memory to process address space
-  *shm_addr = mmap(NULL, byte_size, PROT_WRITE, MAP_SHARED, shm_fd, offset);
+  *shm_addr = mmap(
+      NULL, byte_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, offset);
   if (*shm_addr == MAP_FAILED) {
     return -1;
   }
@@ -110,6 +111,16 @@ SharedMemoryRegionSet(
   return 0;
 }
 
+int
+SharedMemoryRegionInfo(void* shm_handle, void** shm_addr, size_t* byte_size)
+{
+  SharedMemoryHandle* handle =
+      reinterpret_cast<SharedMemoryHandle*>(shm_handle);
+  *shm_addr = reinterpret_cast<char*>(handle->base_addr_) + handle->offset_;
+  *byte_size = handle->byte_size_;
+  return 0;
+}
+
 int
 SharedMemoryRegionDestroy(void* shm_handle)
 {
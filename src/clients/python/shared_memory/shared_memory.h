@@ -41,6 +41,8 @@ int SharedMemoryRegionCreate(
     void** shm_handle);
 int SharedMemoryRegionSet(
     void* shm_addr, size_t offset, size_t byte_size, const void* data);
+int SharedMemoryRegionInfo(
+    void* shm_handle, void** shm_addr, size_t* byte_size);
 int SharedMemoryRegionDestroy(void* shm_handle);
 
 //==============================================================================
@@ -33,4 +33,11 @@ struct SharedMemoryHandle {
   int shm_fd_;
   size_t offset_;
   size_t byte_size_;
+
+  // For a CUDA shared memory region 'base_addr_' is the device
+  // memory, on GPU 'device_id_', and 'shm_key_' is the system shared
+  // memory region holding the 'ipc_handle_byte_size_' bytes of its
+  // cudaIpcMemHandle_t. 'device_id_' is -1 for system shared memory.
+  int device_id_ = -1;
+  size_t ipc_handle_byte_size_ = 0;
 };
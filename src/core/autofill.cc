@@ -41,7 +41,11 @@
 #ifdef TRTIS_ENABLE_PYTORCH
 #include "src/backends/pytorch/autofill.h"
 #endif  // TRTIS_ENABLE_PYTORCH
+#include <google/protobuf/text_format.h>
+#include <functional>
+#include <map>
 #include "src/core/constants.h"
+#include "src/core/filesystem.h"
 #include "src/core/logging.h"
 #include "src/core/model_config.h"
 
@@ -233,4 +237,99 @@ AutoFill::Create(
   return Status::Success;
 }
 
+//
+// AutoFillCache
+//
+namespace {
+
+// The first line of a recorded configuration holds the fingerprint of
+// the model files that the configuration was completed from.
+const std::string kFingerprintPrefix = "# fingerprint: ";
+
+}  // namespace
+
+Status
+AutoFillCache::Fingerprint(const std::string& model_path, size_t* fingerprint)
+{
+  std::map<std::string, std::string> versions;
+  RETURN_IF_ERROR(GetDirectoryFileVersions(model_path, &versions));
+
+  std::string files;
+  for (const auto& version : versions) {
+    files.append(version.first).append(1, '\0');
+    files.append(version.second).append(1, '\0');
+  }
+
+  *fingerprint = std::hash<std::string>()(files);
+  return Status::Success;
+}
+
+bool
+AutoFillCache::Lookup(
+    const std::string& model_name, const size_t fingerprint,
+    ModelConfig* config)
+{
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    const auto itr = configs_.find(model_name);
+    if ((itr != configs_.end()) && (itr->second.first == fingerprint)) {
+      *config = itr->second.second;
+      return true;
+    }
+  }
+
+  if (dir_.empty()) {
+    return false;
+  }
+
+  std::string contents;
+  if (!ReadTextFile(JoinPath({dir_, model_name + ".pbtxt"}), &contents)
+           .IsOk()) {
+    return false;
+  }
+
+  const std::string header =
+      kFingerprintPrefix + std::to_string(fingerprint) + "\n";
+  ModelConfig recorded;
+  if ((contents.compare(0, header.size(), header) != 0) ||
+      !google::protobuf::TextFormat::ParseFromString(
+          contents.substr(header.size()), &recorded)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mu_);
+  configs_[model_name] = std::make_pair(fingerprint, recorded);
+  *config = recorded;
+  return true;
+}
+
+void
+AutoFillCache::Insert(
+    const std::string& model_name, const size_t fingerprint,
+    const ModelConfig& config)
+{
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    configs_[model_name] = std::make_pair(fingerprint, config);
+  }
+
+  if (dir_.empty()) {
+    return;
+  }
+
+  std::string prototxt;
+  if (!google::protobuf::TextFormat::PrintToString(config, &prototxt)) {
+    LOG_WARNING << "failed to record autofilled config for " << model_name;
+    return;
+  }
+
+  Status status = WriteTextFile(
+      JoinPath({dir_, model_name + ".pbtxt"}),
+      kFingerprintPrefix + std::to_string(fingerprint) + "\n" + prototxt);
+  if (!status.IsOk()) {
+    LOG_WARNING << "failed to record autofilled config for " << model_name
+                << ": " << status.AsString();
+  }
+}
+
 }}  // namespace nvidia::inferenceserver
@@ -25,7 +25,10 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include "src/core/model_config.h"
 #include "src/core/model_config.pb.h"
 #include "src/core/status.h"
@@ -49,4 +52,47 @@ class AutoFill {
   const std::string model_name_;
 };
 
+/// Cache of the model configurations completed by autofill. The
+/// configuration of a model is reused as long as the files of the model,
+/// including the configuration provided for it, are unchanged.
+class AutoFillCache {
+ public:
+  /// Create a cache.
+  /// \param dir The directory where the configurations are also recorded
+  /// so that they are reused after the server restarts, or empty to only
+  /// keep them in memory.
+  explicit AutoFillCache(const std::string& dir) : dir_(dir) {}
+
+  /// Get the fingerprint of the files of a model.
+  /// \param model_path The full-path to the directory of the model.
+  /// \param fingerprint Returns the fingerprint.
+  /// \return The error status.
+  Status Fingerprint(const std::string& model_path, size_t* fingerprint);
+
+  /// Get the configuration completed for a model with the given
+  /// fingerprint.
+  /// \param model_name The name of the model.
+  /// \param fingerprint The fingerprint of the files of the model.
+  /// \param config Returns the configuration.
+  /// \return True if the configuration is found, false otherwise.
+  bool Lookup(
+      const std::string& model_name, const size_t fingerprint,
+      ModelConfig* config);
+
+  /// Record the configuration completed for a model with the given
+  /// fingerprint.
+  /// \param model_name The name of the model.
+  /// \param fingerprint The fingerprint of the files of the model.
+  /// \param config The configuration.
+  void Insert(
+      const std::string& model_name, const size_t fingerprint,
+      const ModelConfig& config);
+
+ private:
+  const std::string dir_;
+
+  std::mutex mu_;
+  std::unordered_map<std::string, std::pair<size_t, ModelConfig>> configs_;
+};
+
 }}  // namespace nvidia::inferenceserver
@@ -27,19 +27,126 @@
 #include "src/core/backend.h"
 
 #include <chrono>
+#include <condition_variable>
+#include <future>
+#include <random>
 #include "src/core/constants.h"
 #include "src/core/dynamic_batch_scheduler.h"
 #include "src/core/filesystem.h"
 #include "src/core/logging.h"
 #include "src/core/metric_model_reporter.h"
 #include "src/core/model_config_utils.h"
+#include "src/core/provider.h"
+#include "src/core/provider_utils.h"
+#include "src/core/rate_limiter.h"
 #include "src/core/sequence_batch_scheduler.h"
+#include "src/core/server_status.h"
+#include "src/core/trtserver.h"
 
 namespace nvidia { namespace inferenceserver {
 
+namespace {
+
+// Return true if the deadline of the request tracked by 'stats' has
+// passed.
+bool
+DeadlineExpired(const ModelInferStats& stats)
+{
+  if (stats.Deadline() == UINT64_MAX) {
+    return false;
+  }
+
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return TIMESPEC_TO_NANOS(now) >= stats.Deadline();
+}
+
+// The outputs of a warmup request are allocated in the memory type
+// the backend prefers and discarded once the request completes.
+TRTSERVER_Error*
+WarmupResponseAlloc(
+    TRTSERVER_ResponseAllocator* allocator, void** buffer, void** buffer_userp,
+    const char* tensor_name, size_t byte_size,
+    TRTSERVER_Memory_Type memory_type, int64_t memory_type_id, void* userp)
+{
+  *buffer = nullptr;
+  *buffer_userp = nullptr;
+
+  auto allocated_buffer =
+      std::make_shared<AllocatedSystemMemory>(byte_size, memory_type);
+  TRTSERVER_Memory_Type allocated_memory_type;
+  char* mutable_buffer =
+      allocated_buffer->MutableBuffer(&allocated_memory_type);
+  if ((mutable_buffer != nullptr) || (byte_size == 0)) {
+    *buffer = static_cast<void*>(mutable_buffer);
+    *buffer_userp =
+        new std::shared_ptr<AllocatedSystemMemory>(std::move(allocated_buffer));
+  }
+
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+WarmupResponseRelease(
+    TRTSERVER_ResponseAllocator* allocator, void* buffer, void* buffer_userp,
+    size_t byte_size, TRTSERVER_Memory_Type memory_type,
+    int64_t memory_type_id)
+{
+  delete reinterpret_cast<std::shared_ptr<AllocatedSystemMemory>*>(
+      buffer_userp);
+  return nullptr;  // Success
+}
+
+// Bounds the number of batches of a model that execute at the same
+// time on each GPU, see ModelConfig::max_concurrent_executions.
+class ExecutionLimit {
+ public:
+  explicit ExecutionLimit(const uint32_t max_executions)
+      : max_executions_(max_executions)
+  {
+  }
+
+  // Wait until fewer than the maximum batches execute on
+  // 'gpu_device' and count the caller's batch as executing.
+  void Acquire(const int gpu_device)
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    uint32_t& cnt = executing_cnt_[gpu_device];
+    cv_.wait(lock, [this, &cnt]() { return cnt < max_executions_; });
+    cnt++;
+  }
+
+  void Release(const int gpu_device)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      executing_cnt_[gpu_device]--;
+    }
+    cv_.notify_all();
+  }
+
+ private:
+  const uint32_t max_executions_;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::unordered_map<int, uint32_t> executing_cnt_;
+};
+
+}  // namespace
+
 Status
 InferenceBackend::GetInput(
     const std::string& name, const ModelInput** input) const
+{
+  const FixedInputShape* fixed_shape;
+  return GetInput(name, input, &fixed_shape);
+}
+
+Status
+InferenceBackend::GetInput(
+    const std::string& name, const ModelInput** input,
+    const FixedInputShape** fixed_shape) const
 {
   const auto itr = input_map_.find(name);
   if (itr == input_map_.end()) {
@@ -48,7 +155,8 @@ InferenceBackend::GetInput(
         "unexpected inference input '" + name + "' for model '" + Name() + "'");
   }
 
-  *input = &itr->second;
+  *input = &itr->second.first;
+  *fixed_shape = itr->second.second.get();
   return Status::Success;
 }
 
@@ -67,6 +175,25 @@ InferenceBackend::GetOutput(
   return Status::Success;
 }
 
+InferenceBackend::~InferenceBackend()
+{
+#ifdef TRTIS_ENABLE_METRICS
+  // The gauges are shared with any other backend for the same model
+  // version, so take back only the usage of this backend.
+  if (metric_reporter_ != nullptr) {
+    for (const auto& pr : memory_usage_) {
+      const ModelMemoryUsage& usage = pr.second;
+      metric_reporter_->MetricGpuMemoryModel(pr.first)
+          .Decrement(usage.model_byte_size());
+      metric_reporter_->MetricGpuMemoryWorkspace(pr.first)
+          .Decrement(usage.workspace_byte_size());
+      metric_reporter_->MetricGpuMemoryIO(pr.first)
+          .Decrement(usage.io_byte_size());
+    }
+  }
+#endif  // TRTIS_ENABLE_METRICS
+}
+
 Status
 InferenceBackend::SetModelConfig(
     const std::string& path, const ModelConfig& config)
@@ -78,19 +205,37 @@ InferenceBackend::SetModelConfig(
   metric_reporter_ = std::make_shared<MetricModelReporter>(
       Name(), version_, config_.metric_tags());
 
-  // Initialize the input map
+  // Initialize the input map. The shape of an input is fixed if
+  // neither its dims nor its reshape have a variable-size dimension.
+  fixed_input_shapes_ = true;
   for (const auto& io : config.input()) {
-    input_map_.insert(std::make_pair(io.name(), io));
+    std::unique_ptr<FixedInputShape> fixed_shape;
+    const DimsList& shape =
+        (io.has_reshape()) ? io.reshape().shape() : io.dims();
+    if (IsFixedSizeDataType(io.data_type()) &&
+        (GetElementCount(io.dims()) != -1) && (GetElementCount(shape) != -1)) {
+      fixed_shape.reset(new FixedInputShape());
+      fixed_shape->shape_ = shape;
+      // A zero-rank input of a batching model has one element for each
+      // batch element.
+      fixed_shape->byte_size_ =
+          ((config.max_batch_size() > 0) && (shape.size() == 0))
+              ? GetDataTypeByteSize(io.data_type())
+              : GetByteSize(io.data_type(), shape);
+    } else {
+      fixed_input_shapes_ = false;
+    }
+    input_map_.emplace(io.name(), std::make_pair(io, std::move(fixed_shape)));
   }
 
   // Initialize the output map and label provider for each output
   label_provider_ = std::make_shared<LabelProvider>();
-  const auto model_dir = DirName(path);
+  model_dir_ = DirName(path);
   for (const auto& io : config.output()) {
     output_map_.insert(std::make_pair(io.name(), io));
 
     if (!io.label_filename().empty()) {
-      const auto label_path = JoinPath({model_dir, io.label_filename()});
+      const auto label_path = JoinPath({model_dir_, io.label_filename()});
       RETURN_IF_ERROR(label_provider_->AddLabels(io.name(), label_path));
     }
   }
@@ -114,17 +259,80 @@ Status
 InferenceBackend::SetConfiguredScheduler(
     const uint32_t runner_cnt, Scheduler::StandardInitFunc OnInit,
     Scheduler::StandardRunFunc OnRun)
+{
+  return SetConfiguredScheduler(
+      runner_cnt, OnInit, OnRun, nullptr /* OnRelease */);
+}
+
+Status
+InferenceBackend::SetConfiguredScheduler(
+    const uint32_t runner_cnt, Scheduler::StandardInitFunc OnInit,
+    Scheduler::StandardRunFunc OnRun, Scheduler::StandardReleaseFunc OnRelease)
 {
   std::unique_ptr<Scheduler> scheduler;
 
+  // When the server-wide rate limiter is enabled each runner holds
+  // the tokens of the model while it executes a batch.
+  if (RateLimiter::Enabled()) {
+    RETURN_IF_ERROR(RateLimiter::ValidateConfig(config_));
+
+    std::vector<RunnerPlacement> placements;
+    GetRunnerPlacements(config_, runner_cnt, &placements);
+    auto limiter = std::make_shared<ModelRateLimiter>(config_.rate_limiter());
+    Scheduler::StandardRunFunc LimitedOnRun =
+        [OnRun, placements, limiter](
+            uint32_t runner_idx, std::vector<Scheduler::Payload>* payloads,
+            std::function<void(const Status&)> OnRunComplete) {
+          const int gpu_device = placements[runner_idx].gpu_device_;
+          RateLimiter::Acquire(gpu_device, *limiter);
+          OnRun(
+              runner_idx, payloads,
+              [gpu_device, limiter, OnRunComplete](const Status& status) {
+                RateLimiter::Release(gpu_device, *limiter);
+                OnRunComplete(status);
+              });
+        };
+    OnRun = LimitedOnRun;
+  }
+
+  // The per-model limit is applied outside of the rate limiter so
+  // that a runner waiting for its model's limit doesn't hold tokens
+  // that other models could use. Only runners on a GPU are limited.
+  if (config_.max_concurrent_executions() > 0) {
+    std::vector<RunnerPlacement> placements;
+    GetRunnerPlacements(config_, runner_cnt, &placements);
+    auto limit =
+        std::make_shared<ExecutionLimit>(config_.max_concurrent_executions());
+    Scheduler::StandardRunFunc LimitedOnRun =
+        [OnRun, placements, limit](
+            uint32_t runner_idx, std::vector<Scheduler::Payload>* payloads,
+            std::function<void(const Status&)> OnRunComplete) {
+          const int gpu_device = placements[runner_idx].gpu_device_;
+          if (gpu_device < 0) {
+            OnRun(runner_idx, payloads, OnRunComplete);
+            return;
+          }
+
+          limit->Acquire(gpu_device);
+          OnRun(
+              runner_idx, payloads,
+              [gpu_device, limit, OnRunComplete](const Status& status) {
+                limit->Release(gpu_device);
+                OnRunComplete(status);
+              });
+        };
+    OnRun = LimitedOnRun;
+  }
+
   // If 'sequence_batching' is configured use the SequenceBatchScheduler,
   // otherwise use the default DynamicBatchScheduler.
   if (config_.has_sequence_batching()) {
     RETURN_IF_ERROR(SequenceBatchScheduler::Create(
-        config_, runner_cnt, OnInit, OnRun, &scheduler));
+        config_, runner_cnt, OnInit, OnRun, metric_reporter_, &scheduler));
   } else {
     RETURN_IF_ERROR(DynamicBatchScheduler::Create(
-        config_, runner_cnt, OnInit, OnRun, &scheduler));
+        config_, runner_cnt, OnInit, OnRun, OnRelease, metric_reporter_,
+        &scheduler));
   }
 
   return SetScheduler(std::move(scheduler));
@@ -137,8 +345,242 @@ InferenceBackend::Run(
     std::shared_ptr<InferResponseProvider> response_provider,
     std::function<void(const Status&)> OnCompleteHandleInfer)
 {
+  // A request whose deadline has already passed is not scheduled, so
+  // neither is an ensemble step whose request is out of time.
+  if (DeadlineExpired(*stats)) {
+    OnCompleteHandleInfer(Status(
+        RequestStatusCode::UNAVAILABLE,
+        "Request deadline expired for '" + Name() + "'"));
+    return;
+  }
+
   scheduler_->Enqueue(
       stats, request_provider, response_provider, OnCompleteHandleInfer);
 }
 
+void
+InferenceBackend::RunBatch(std::vector<Scheduler::Payload>* payloads)
+{
+  std::vector<Scheduler::Payload> live_payloads;
+  live_payloads.reserve(payloads->size());
+  for (auto& payload : *payloads) {
+    if (DeadlineExpired(*payload.stats_)) {
+      payload.complete_function_(Status(
+          RequestStatusCode::UNAVAILABLE,
+          "Request deadline expired for '" + Name() + "'"));
+    } else {
+      live_payloads.emplace_back(std::move(payload));
+    }
+  }
+
+  if (!live_payloads.empty()) {
+    scheduler_->EnqueueBatch(&live_payloads);
+  }
+}
+
+void
+InferenceBackend::GetStatus(ModelVersionStatus* status)
+{
+  if (scheduler_ != nullptr) {
+    scheduler_->GetStatus(status);
+  }
+
+  std::lock_guard<std::mutex> lock(memory_mu_);
+  for (const auto& pr : memory_usage_) {
+    *status->add_memory_usage() = pr.second;
+  }
+}
+
+void
+InferenceBackend::Drain(const uint64_t deadline_ns)
+{
+  if (scheduler_ != nullptr) {
+    scheduler_->Drain(deadline_ns);
+  }
+}
+
+std::map<int, ModelMemoryUsage>
+InferenceBackend::MemoryUsage()
+{
+  std::lock_guard<std::mutex> lock(memory_mu_);
+  return memory_usage_;
+}
+
+void
+InferenceBackend::AddMemoryUsage(
+    const int gpu_device, const MemoryKind kind, const uint64_t byte_size)
+{
+  std::lock_guard<std::mutex> lock(memory_mu_);
+  ModelMemoryUsage& usage = memory_usage_[gpu_device];
+  usage.set_device_id(gpu_device);
+  switch (kind) {
+    case MemoryKind::MODEL:
+      usage.set_model_byte_size(usage.model_byte_size() + byte_size);
+      break;
+    case MemoryKind::WORKSPACE:
+      usage.set_workspace_byte_size(usage.workspace_byte_size() + byte_size);
+      break;
+    case MemoryKind::IO:
+      usage.set_io_byte_size(usage.io_byte_size() + byte_size);
+      break;
+  }
+
+#ifdef TRTIS_ENABLE_METRICS
+  if (metric_reporter_ != nullptr) {
+    prometheus::Gauge& gauge =
+        (kind == MemoryKind::MODEL)
+            ? metric_reporter_->MetricGpuMemoryModel(gpu_device)
+            : (kind == MemoryKind::WORKSPACE)
+                  ? metric_reporter_->MetricGpuMemoryWorkspace(gpu_device)
+                  : metric_reporter_->MetricGpuMemoryIO(gpu_device);
+    gauge.Increment(byte_size);
+  }
+#endif  // TRTIS_ENABLE_METRICS
+}
+
+Status
+InferenceBackend::WarmUp()
+{
+  for (const auto& warmup : config_.model_warmup()) {
+    LOG_INFO << "warming up '" << Name() << "' version " << version_
+             << " with '" << warmup.name() << "'";
+    Status status = WarmUp(warmup);
+    if (!status.IsOk()) {
+      return Status(
+          status.Code(), "failed to warm up '" + Name() + "' with '" +
+                             warmup.name() + "': " + status.Message());
+    }
+  }
+
+  return Status::Success;
+}
+
+Status
+InferenceBackend::WarmUp(const ModelWarmup& warmup)
+{
+  const uint32_t batch_size = std::max(1u, warmup.batch_size());
+
+  // All warmup requests share the same header.
+  auto request_header = std::make_shared<InferRequestHeader>();
+  request_header->set_batch_size(batch_size);
+
+  // A sequence batching model only accepts requests of a sequence,
+  // so the warmup request is a sequence of its own. No other
+  // sequence is in progress while the model is loading.
+  if (config_.has_sequence_batching()) {
+    request_header->set_correlation_id(1);
+    request_header->set_flags(
+        InferRequestHeader::FLAG_SEQUENCE_START |
+        InferRequestHeader::FLAG_SEQUENCE_END);
+  }
+
+  // The inputs are created for one batch entry and the same content
+  // is used for every entry of the batch.
+  std::unordered_map<std::string, std::shared_ptr<SystemMemory>> input_map;
+  std::vector<std::vector<char>> input_contents;
+  std::default_random_engine generator;
+  for (const auto& pr : warmup.inputs()) {
+    const auto& name = pr.first;
+    const auto& input = pr.second;
+
+    const int64_t element_count = GetElementCount(input.dims());
+    if (element_count < 0) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "warmup input '" + name + "' must have a fixed shape");
+    }
+
+    // A string element is a 4-byte length followed by the string, so
+    // the empty strings are all zeros.
+    const bool is_string = (input.data_type() == TYPE_STRING);
+    const size_t byte_size =
+        is_string ? element_count * sizeof(uint32_t)
+                  : GetByteSize(input.data_type(), input.dims());
+
+    std::vector<char> content;
+    if (!input.input_data_file().empty()) {
+      const std::string path =
+          JoinPath({model_dir_, "warmup", input.input_data_file()});
+      std::string file_content;
+      RETURN_IF_ERROR(ReadTextFile(path, &file_content));
+      if (!is_string && (file_content.size() != byte_size)) {
+        return Status(
+            RequestStatusCode::INVALID_ARG,
+            "warmup input '" + name + "' expects " +
+                std::to_string(byte_size) + " bytes but file '" + path +
+                "' has " + std::to_string(file_content.size()) + " bytes");
+      }
+      content.assign(file_content.begin(), file_content.end());
+    } else {
+      content.resize(byte_size, 0);
+      if (input.random_data() && !is_string) {
+        std::uniform_int_distribution<int> distribution(0, 255);
+        for (auto& c : content) {
+          c = static_cast<char>(distribution(generator));
+        }
+      }
+    }
+
+    auto memory = std::make_shared<SystemMemoryReference>();
+    input_contents.emplace_back(std::move(content));
+    for (uint32_t b = 0; b < batch_size; ++b) {
+      memory->AddBuffer(
+          input_contents.back().data(), input_contents.back().size(),
+          TRTSERVER_MEMORY_CPU);
+    }
+    input_map.emplace(name, memory);
+
+    auto request_input = request_header->add_input();
+    request_input->set_name(name);
+    request_input->mutable_dims()->CopyFrom(input.dims());
+    request_input->set_batch_byte_size(
+        input_contents.back().size() * batch_size);
+  }
+
+  for (const auto& output : config_.output()) {
+    request_header->add_output()->set_name(output.name());
+  }
+
+  RETURN_IF_ERROR(NormalizeRequestHeader(*this, *request_header));
+
+  TRTSERVER_ResponseAllocator* allocator;
+  TRTSERVER_Error* err = TRTSERVER_ResponseAllocatorNew(
+      &allocator, WarmupResponseAlloc, WarmupResponseRelease);
+  if (err != nullptr) {
+    Status status = Status(
+        TrtServerCodeToRequestStatus(TRTSERVER_ErrorCode(err)),
+        TRTSERVER_ErrorMessage(err));
+    TRTSERVER_ErrorDelete(err);
+    return status;
+  }
+  std::unique_ptr<
+      TRTSERVER_ResponseAllocator, decltype(&TRTSERVER_ResponseAllocatorDelete)>
+      allocator_ptr(allocator, TRTSERVER_ResponseAllocatorDelete);
+
+  const uint32_t count = std::max(1u, warmup.count());
+  for (uint32_t i = 0; i < count; ++i) {
+    std::shared_ptr<InferRequestProvider> request_provider;
+    RETURN_IF_ERROR(InferRequestProvider::Create(
+        Name(), version_, request_header, input_map, &request_provider));
+
+    std::shared_ptr<InferResponseProvider> response_provider;
+    RETURN_IF_ERROR(InferResponseProvider::Create(
+        request_header, label_provider_, allocator, WarmupResponseAlloc,
+        nullptr, WarmupResponseRelease, &response_provider));
+
+    // The statistics of a warmup request are not reported.
+    auto stats = std::make_shared<ModelInferStats>(nullptr, Name());
+
+    std::promise<Status> warmup_promise;
+    std::future<Status> warmup_future = warmup_promise.get_future();
+    Run(stats, request_provider, response_provider,
+        [&warmup_promise](const Status& status) {
+          warmup_promise.set_value(status);
+        });
+    RETURN_IF_ERROR(warmup_future.get());
+  }
+
+  return Status::Success;
+}
+
 }}  // namespace nvidia::inferenceserver
@@ -25,7 +25,10 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <map>
+#include <mutex>
 #include "src/core/label_provider.h"
+#include "src/core/model_config.h"
 #include "src/core/model_config.pb.h"
 #include "src/core/scheduler.h"
 #include "src/core/status.h"
@@ -41,8 +44,11 @@ class MetricModelReporter;
 //
 class InferenceBackend {
  public:
+  // Kind of GPU memory held by a model, see ModelMemoryUsage.
+  enum class MemoryKind { MODEL, WORKSPACE, IO };
+
   InferenceBackend() = default;
-  virtual ~InferenceBackend() {}
+  virtual ~InferenceBackend();
 
   // Get the name of model being served.
   const std::string& Name() const { return config_.name(); }
@@ -59,9 +65,31 @@ class InferenceBackend {
     return metric_reporter_;
   }
 
+  // The shape and byte size that a normalized request header has for
+  // an input whose shape is fixed by the model configuration. They are
+  // computed when the model is loaded so that the requests for the
+  // input are normalized without computing them again.
+  struct FixedInputShape {
+    // The reshape of the input if it has one, else its dims.
+    DimsList shape_;
+
+    // The byte size of one batch element of the input.
+    uint64_t byte_size_;
+  };
+
   // Get the model configuration for a named input.
   Status GetInput(const std::string& name, const ModelInput** input) const;
 
+  // Get the model configuration for a named input and its fixed shape,
+  // which is nullptr if the input has variable-size dimensions or a
+  // datatype whose elements don't all have the same byte size.
+  Status GetInput(
+      const std::string& name, const ModelInput** input,
+      const FixedInputShape** fixed_shape) const;
+
+  // Return true if every input of the model has a fixed shape.
+  bool HasFixedInputShapes() const { return fixed_input_shapes_; }
+
   // Get the model configuration for a named output.
   Status GetOutput(const std::string& name, const ModelOutput** output) const;
 
@@ -80,6 +108,28 @@ class InferenceBackend {
       std::shared_ptr<InferResponseProvider> response_provider,
       std::function<void(const Status&)> OnCompleteHandleInfer);
 
+  // Run inference on several requests, which are enqueued with the
+  // scheduler together. The complete function of each payload is
+  // called once its inference is completed.
+  void RunBatch(std::vector<Scheduler::Payload>* payloads);
+
+  // Add the current state of the backend to the status of the model
+  // version being served.
+  void GetStatus(ModelVersionStatus* status);
+
+  // Start draining the backend's queued requests because the server
+  // is exiting. \see Scheduler::Drain()
+  void Drain(const uint64_t deadline_ns);
+
+  // Get the GPU memory held by the model, as a map from device to
+  // usage. Empty if the backend doesn't account its memory.
+  std::map<int, ModelMemoryUsage> MemoryUsage();
+
+  // Run the warmup requests of the model configuration through the
+  // backend and wait for them to complete. Must be called before the
+  // backend serves inference requests.
+  Status WarmUp();
+
  protected:
   // Set the configuration of the model being served.
   Status SetModelConfig(const std::string& path, const ModelConfig& config);
@@ -89,21 +139,39 @@ class InferenceBackend {
   Status SetScheduler(std::unique_ptr<Scheduler> scheduler);
 
   // Set the scheduler based on the model configuration. The scheduler
-  // can only be set once for a backend.
+  // can only be set once for a backend. If 'OnRelease' is given the
+  // dynamic batcher calls it to release the resources of a runner
+  // that instance autoscaling deactivates.
   Status SetConfiguredScheduler(
       const uint32_t runner_cnt, Scheduler::StandardInitFunc OnInit,
       Scheduler::StandardRunFunc OnRun);
+  Status SetConfiguredScheduler(
+      const uint32_t runner_cnt, Scheduler::StandardInitFunc OnInit,
+      Scheduler::StandardRunFunc OnRun,
+      Scheduler::StandardReleaseFunc OnRelease);
 
   // Get the raw pointer to the scheduler of this backend.
   Scheduler* BackendScheduler() { return scheduler_.get(); }
 
+  // Account 'byte_size' bytes of memory on 'gpu_device' as held by
+  // the model for 'kind' until the backend is destroyed. The usage
+  // is reported in the model status and metrics.
+  void AddMemoryUsage(
+      const int gpu_device, const MemoryKind kind, const uint64_t byte_size);
+
  private:
+  // Run one warmup request described by 'warmup'.
+  Status WarmUp(const ModelWarmup& warmup);
+
   // Configuration of the model that this backend represents.
   ModelConfig config_;
 
   // Version of the model that this backend represents.
   int64_t version_;
 
+  // The directory of the model that this backend represents.
+  std::string model_dir_;
+
   // The metric reporter for the model that this backend represents.
   std::shared_ptr<MetricModelReporter> metric_reporter_;
 
@@ -113,11 +181,21 @@ class InferenceBackend {
   // The scheduler to use for this backend.
   std::unique_ptr<Scheduler> scheduler_;
 
-  // Map from input name to the model configuration for that input.
-  std::unordered_map<std::string, ModelInput> input_map_;
+  // Map from input name to the model configuration for that input and
+  // its fixed shape, if any.
+  std::unordered_map<
+      std::string, std::pair<ModelInput, std::unique_ptr<FixedInputShape>>>
+      input_map_;
+
+  // True if every input of the model has a fixed shape.
+  bool fixed_input_shapes_;
 
   // Map from output name to the model configuration for that output.
   std::unordered_map<std::string, ModelOutput> output_map_;
+
+  // GPU memory held by the model, as a map from device to usage.
+  std::mutex memory_mu_;
+  std::map<int, ModelMemoryUsage> memory_usage_;
 };
 
 }}  // namespace nvidia::inferenceserver
@@ -26,22 +26,81 @@
 
 #include "src/core/backend_context.h"
 
+#include <algorithm>
+#include "src/core/cuda_memory_manager.h"
+#include "src/core/host_copy.h"
 #include "src/core/logging.h"
+#include "src/core/nvtx.h"
+#include "src/core/pinned_memory_manager.h"
 #include "src/core/provider.h"
 
+#ifdef TRTIS_ENABLE_GPU
+#include "src/core/topk_kernel.h"
+#endif  // TRTIS_ENABLE_GPU
+
 namespace nvidia { namespace inferenceserver {
 
+// A copy of an input chunk, or of chunks that are adjacent in both
+// source and destination, into an input buffer.
+struct BackendContext::InputCopy {
+  const char* src_;
+  TRTSERVER_Memory_Type src_memory_type_;
+  size_t dst_offset_;
+  size_t byte_size_;
+
+  // The range of payloads whose data is copied.
+  size_t first_payload_;
+  size_t last_payload_;
+
+  // True if the copy is done as part of a gather.
+  bool gathered_;
+};
+
+void
+BackendContext::AddInputCopy(
+    std::vector<InputCopy>* copies, const char* src,
+    const TRTSERVER_Memory_Type src_memory_type, const size_t dst_offset,
+    const size_t byte_size, const size_t payload_idx)
+{
+  if (!copies->empty()) {
+    InputCopy& last = copies->back();
+    if ((last.src_memory_type_ == src_memory_type) &&
+        ((last.src_ + last.byte_size_) == src) &&
+        ((last.dst_offset_ + last.byte_size_) == dst_offset)) {
+      last.byte_size_ += byte_size;
+      last.last_payload_ = payload_idx;
+      return;
+    }
+  }
+
+  copies->push_back(InputCopy{src, src_memory_type, dst_offset, byte_size,
+                              payload_idx, payload_idx, false});
+}
+
 BackendContext::BackendContext(
     const std::string& name, const int gpu_device, const int max_batch_size)
     : name_(name), gpu_device_(gpu_device), max_batch_size_(max_batch_size)
 {
 #ifdef TRTIS_ENABLE_GPU
   stream_ = nullptr;
+  completion_exit_ = false;
 #endif  // TRTIS_ENABLE_GPU
 }
 
 BackendContext::~BackendContext()
 {
+  StopCompletions();
+  ReleaseGatherBuffers(true /* wait */);
+
+#ifdef TRTIS_ENABLE_GPU
+  for (cudaEvent_t event : gather_events_) {
+    cudaError_t err = cudaEventDestroy(event);
+    if (err != cudaSuccess) {
+      LOG_ERROR << "Failed to destroy cuda event: " << cudaGetErrorString(err);
+    }
+  }
+#endif  // TRTIS_ENABLE_GPU
+
 #ifdef TRTIS_ENABLE_GPU
   if (stream_ != nullptr) {
     cudaError_t err = cudaStreamDestroy(stream_);
@@ -54,9 +113,14 @@ BackendContext::~BackendContext()
 }
 
 Status
-BackendContext::CreateCudaStream(const int cuda_stream_priority)
+BackendContext::CreateCudaStream(
+    const int cuda_stream_priority, cudaStream_t* stream)
 {
 #ifdef TRTIS_ENABLE_GPU
+  if (stream == nullptr) {
+    stream = &stream_;
+  }
+
   int device_cnt;
   auto cuerr = cudaGetDeviceCount(&device_cnt);
   // Do nothing if there is no CUDA device since all data transfer will be done
@@ -64,7 +128,7 @@ BackendContext::CreateCudaStream(const int cuda_stream_priority)
   if ((cuerr != cudaErrorNoDevice) && (cuerr != cudaErrorInsufficientDriver)) {
     if (cuerr == cudaSuccess) {
       cuerr = cudaStreamCreateWithPriority(
-          &stream_, cudaStreamDefault, cuda_stream_priority);
+          stream, cudaStreamDefault, cuda_stream_priority);
     }
     if (cuerr != cudaSuccess) {
       return Status(
@@ -80,50 +144,49 @@ bool
 BackendContext::SetInputBuffer(
     const std::string& name, const std::vector<size_t>& expected_byte_sizes,
     std::vector<Scheduler::Payload>* payloads,
-    TRTSERVER_Memory_Type dst_memory_type, char* input_buffer)
+    TRTSERVER_Memory_Type dst_memory_type, char* input_buffer,
+    cudaStream_t stream)
 {
-  bool cuda_copy = false;
-  // Visit the payloads in order and copy the input tensors to
-  // 'buffer'.
+  NVTX_RANGE(nvtx_, "BackendContext input copy");
+
+  // Visit the payloads in order and collect the copies of the input
+  // chunks to 'input_buffer', merging chunks that are adjacent in
+  // memory so that each merged run needs only one copy.
+  std::vector<InputCopy> copies;
   size_t buffer_copy_offset = 0;
   for (size_t idx = 0; idx < expected_byte_sizes.size(); idx++) {
     auto& payload = (*payloads)[idx];
     const size_t expected_byte_size = expected_byte_sizes[idx];
 
+    // Gather every chunk of the input straight into its place in
+    // 'input_buffer' instead of first making the input contiguous.
     size_t copied_byte_size = 0;
-    while (payload.status_.IsOk()) {
-      auto src_memory_type = dst_memory_type;
-      const void* content;
-      size_t content_byte_size = expected_byte_size - copied_byte_size;
-      payload.status_ = payload.request_provider_->GetNextInputContent(
-          name, &content, &content_byte_size, &src_memory_type, false);
-      if (!payload.status_.IsOk()) {
-        break;
-      }
+    std::vector<InferRequestProvider::InputChunk> chunks;
+    if (payload.status_.IsOk()) {
+      payload.status_ = payload.request_provider_->GetInputChunks(
+          name, expected_byte_size, &chunks);
+    }
 
-      // No more input content available then done with copying...
-      if (content == nullptr) {
+    for (const auto& chunk : chunks) {
+      if (!payload.status_.IsOk()) {
         break;
       }
 
-      if ((copied_byte_size + content_byte_size) > expected_byte_size) {
+      if ((copied_byte_size + chunk.byte_size_) > expected_byte_size) {
         payload.status_ = Status(
             RequestStatusCode::INVALID_ARG,
             "unexpected size " +
-                std::to_string(copied_byte_size + content_byte_size) +
+                std::to_string(copied_byte_size + chunk.byte_size_) +
                 " for inference input '" + name + "', expecting " +
                 std::to_string(expected_byte_size));
         break;
       }
 
-      if (content_byte_size > 0) {
-        bool cuda_used = false;
-        payload.status_ = CopyBuffer(
-            name, src_memory_type, dst_memory_type, content_byte_size, content,
-            input_buffer + buffer_copy_offset + copied_byte_size, &cuda_used);
-        cuda_copy |= cuda_used;
-      }
-      copied_byte_size += content_byte_size;
+      AddInputCopy(
+          &copies, static_cast<const char*>(chunk.content_),
+          chunk.memory_type_, buffer_copy_offset + copied_byte_size,
+          chunk.byte_size_, idx);
+      copied_byte_size += chunk.byte_size_;
     }
 
     if (payload.status_.IsOk() && (copied_byte_size != expected_byte_size)) {
@@ -137,6 +200,228 @@ BackendContext::SetInputBuffer(
     buffer_copy_offset += expected_byte_size;
   }
 
+  // Copies from host to GPU memory are gathered into a single copy
+  // when possible. The remaining copies are issued one at a time,
+  // except those within host memory that are made together so that a
+  // large batch is copied in parallel.
+  bool cuda_copy = GatherInputCopies(
+      name, payloads, dst_memory_type, input_buffer, stream, &copies);
+  std::vector<HostCopy> host_copies;
+  for (const auto& copy : copies) {
+    if (copy.gathered_) {
+      continue;
+    }
+
+    if ((copy.src_memory_type_ == TRTSERVER_MEMORY_CPU) &&
+        (dst_memory_type == TRTSERVER_MEMORY_CPU)) {
+      host_copies.push_back(
+          HostCopy{input_buffer + copy.dst_offset_, copy.src_,
+                   copy.byte_size_});
+      continue;
+    }
+
+    bool cuda_used = false;
+    Status status = CopyBuffer(
+        name, copy.src_memory_type_, dst_memory_type, copy.byte_size_,
+        copy.src_, input_buffer + copy.dst_offset_, &cuda_used, stream);
+    cuda_copy |= cuda_used;
+    if (!status.IsOk()) {
+      for (size_t idx = copy.first_payload_; idx <= copy.last_payload_;
+           ++idx) {
+        if ((*payloads)[idx].status_.IsOk()) {
+          (*payloads)[idx].status_ = status;
+        }
+      }
+    }
+  }
+  CopyHostBuffers(host_copies);
+
+  return cuda_copy;
+}
+
+bool
+BackendContext::GatherInputCopies(
+    const std::string& name, std::vector<Scheduler::Payload>* payloads,
+    TRTSERVER_Memory_Type dst_memory_type, char* input_buffer,
+    cudaStream_t stream, std::vector<InputCopy>* copies)
+{
+#ifdef TRTIS_ENABLE_GPU
+  if (dst_memory_type != TRTSERVER_MEMORY_GPU) {
+    return false;
+  }
+
+  // Only worth it if there are several copies from host memory. The
+  // copies are in order of their destination.
+  size_t host_copy_cnt = 0;
+  size_t begin = 0, end = 0;
+  for (const auto& copy : *copies) {
+    if (copy.src_memory_type_ == TRTSERVER_MEMORY_CPU) {
+      if (host_copy_cnt == 0) {
+        begin = copy.dst_offset_;
+      }
+      end = copy.dst_offset_ + copy.byte_size_;
+      host_copy_cnt++;
+    }
+  }
+  if (host_copy_cnt < 2) {
+    return false;
+  }
+
+  ReleaseGatherBuffers(false /* wait */);
+
+  void* gather = nullptr;
+  bool is_pinned = false;
+  Status status = PinnedMemoryManager::Alloc(
+      &gather, end - begin, false /* allow_nonpinned_fallback */,
+      &is_pinned);
+  if (!status.IsOk()) {
+    return false;
+  }
+
+  cudaEvent_t event = nullptr;
+  if (!gather_events_.empty()) {
+    event = gather_events_.back();
+    gather_events_.pop_back();
+  } else if (
+      cudaEventCreateWithFlags(&event, cudaEventDisableTiming) !=
+      cudaSuccess) {
+    PinnedMemoryManager::Free(gather);
+    return false;
+  }
+
+  // Gather the host chunks into the pinned buffer at their offsets in
+  // 'input_buffer'. Any range between them that holds chunks from
+  // GPU memory splits the copy to GPU.
+  char* base = static_cast<char*>(gather);
+  size_t run_begin = begin, run_end = begin;
+  bool cuda_used = false;
+  for (auto& copy : *copies) {
+    if (copy.src_memory_type_ != TRTSERVER_MEMORY_CPU) {
+      continue;
+    }
+
+    if ((copy.dst_offset_ != run_end) && status.IsOk()) {
+      status = CopyBuffer(
+          name, TRTSERVER_MEMORY_CPU, TRTSERVER_MEMORY_GPU,
+          run_end - run_begin, base + (run_begin - begin),
+          input_buffer + run_begin, &cuda_used, stream);
+      run_begin = copy.dst_offset_;
+    }
+
+    memcpy(base + (copy.dst_offset_ - begin), copy.src_, copy.byte_size_);
+    run_end = copy.dst_offset_ + copy.byte_size_;
+    copy.gathered_ = true;
+  }
+  if (status.IsOk()) {
+    status = CopyBuffer(
+        name, TRTSERVER_MEMORY_CPU, TRTSERVER_MEMORY_GPU, run_end - run_begin,
+        base + (run_begin - begin), input_buffer + run_begin, &cuda_used,
+        stream);
+  }
+
+  // The pinned buffer is released once the copies out of it are
+  // done. If a copy failed the inputs of every payload with a
+  // gathered chunk are not known.
+  cudaEventRecord(event, (stream != nullptr) ? stream : stream_);
+  gather_buffers_.emplace_back(gather, event);
+  if (!status.IsOk()) {
+    for (const auto& copy : *copies) {
+      if (copy.gathered_) {
+        for (size_t idx = copy.first_payload_; idx <= copy.last_payload_;
+             ++idx) {
+          if ((*payloads)[idx].status_.IsOk()) {
+            (*payloads)[idx].status_ = status;
+          }
+        }
+      }
+    }
+  }
+
+  return true;
+#else
+  return false;
+#endif  // TRTIS_ENABLE_GPU
+}
+
+void
+BackendContext::ReleaseGatherBuffers(const bool wait)
+{
+#ifdef TRTIS_ENABLE_GPU
+  while (!gather_buffers_.empty()) {
+    cudaEvent_t event = gather_buffers_.front().second;
+    if (wait) {
+      cudaEventSynchronize(event);
+    } else if (cudaEventQuery(event) != cudaSuccess) {
+      break;
+    }
+
+    PinnedMemoryManager::Free(gather_buffers_.front().first);
+    gather_events_.push_back(event);
+    gather_buffers_.pop_front();
+  }
+#endif  // TRTIS_ENABLE_GPU
+}
+
+bool
+BackendContext::SetStagedInputBuffer(
+    const std::string& name, const std::vector<size_t>& expected_byte_sizes,
+    std::vector<Scheduler::Payload>* payloads,
+    TRTSERVER_Memory_Type dst_memory_type, char* input_buffer,
+    std::vector<char>* staged, cudaStream_t stream)
+{
+  size_t total_byte_size = 0;
+  for (const size_t byte_size : expected_byte_sizes) {
+    total_byte_size += byte_size;
+  }
+
+  // Gather the input in host memory. The part belonging to a payload
+  // that fails keeps its staged contents.
+  std::vector<char> contents(*staged);
+  contents.resize(total_byte_size);
+  bool cuda_copy = SetInputBuffer(
+      name, expected_byte_sizes, payloads, TRTSERVER_MEMORY_CPU,
+      contents.data(), stream);
+#ifdef TRTIS_ENABLE_GPU
+  if (cuda_copy) {
+    cudaStreamSynchronize((stream != nullptr) ? stream : stream_);
+  }
+#endif  // TRTIS_ENABLE_GPU
+  cuda_copy = false;
+
+  // Copy each run of bytes that is not already in 'input_buffer'.
+  size_t offset = 0;
+  while (offset < total_byte_size) {
+    if ((offset < staged->size()) && (contents[offset] == (*staged)[offset])) {
+      offset++;
+      continue;
+    }
+
+    size_t end = offset + 1;
+    while ((end < total_byte_size) &&
+           ((end >= staged->size()) || (contents[end] != (*staged)[end]))) {
+      end++;
+    }
+
+    bool cuda_used = false;
+    Status status = CopyBuffer(
+        name, TRTSERVER_MEMORY_CPU, dst_memory_type, end - offset,
+        contents.data() + offset, input_buffer + offset, &cuda_used, stream);
+    cuda_copy |= cuda_used;
+    if (!status.IsOk()) {
+      // The contents of 'input_buffer' are no longer known.
+      for (auto& payload : *payloads) {
+        if (payload.status_.IsOk()) {
+          payload.status_ = status;
+        }
+      }
+      staged->clear();
+      return cuda_copy;
+    }
+
+    offset = end;
+  }
+
+  staged->swap(contents);
   return cuda_copy;
 }
 
@@ -145,9 +430,15 @@ BackendContext::SetFixedSizeOutputBuffer(
     const std::string& name, const size_t batch1_byte_size, const char* content,
     const std::vector<int64_t>& content_shape,
     TRTSERVER_Memory_Type src_memory_type,
-    std::vector<Scheduler::Payload>* payloads)
+    std::vector<Scheduler::Payload>* payloads, const DataType datatype)
 {
+  NVTX_RANGE(nvtx_, "BackendContext output copy");
+
+  // The copies within host memory are made together once all the
+  // output buffers are allocated, so that a large batch is scattered
+  // in parallel.
   bool cuda_copy = false;
+  std::vector<HostCopy> host_copies;
   size_t content_offset = 0;
   for (auto& payload : *payloads) {
     const InferRequestHeader& request_header =
@@ -161,6 +452,15 @@ BackendContext::SetFixedSizeOutputBuffer(
     // skip it in the 'content'.
     if (payload.status_.IsOk() && (payload.response_provider_ != nullptr) &&
         payload.response_provider_->RequiresOutput(name)) {
+      if ((src_memory_type == TRTSERVER_MEMORY_GPU) &&
+          SetGpuClassificationOutput(
+              name, batch1_byte_size, content + content_offset,
+              content_shape, datatype, &payload)) {
+        cuda_copy = true;
+        content_offset += expected_byte_size;
+        continue;
+      }
+
       auto dst_memory_type = src_memory_type;
       void* buffer = nullptr;
 
@@ -169,11 +469,16 @@ BackendContext::SetFixedSizeOutputBuffer(
           name, &buffer, expected_byte_size, content_shape, src_memory_type);
 
       if (status.IsOk() && (expected_byte_size != 0)) {
-        if ((buffer == nullptr) && (src_memory_type != TRTSERVER_MEMORY_CPU)) {
-          // Use default (CPU memory type) if preferred type can't be fulfilled
+        if (buffer == nullptr) {
+          // Use the other memory type if preferred type can't be
+          // fulfilled. A CPU output may still be requested in GPU
+          // memory, for example a CUDA shared memory region.
+          dst_memory_type = (src_memory_type == TRTSERVER_MEMORY_CPU)
+                                ? TRTSERVER_MEMORY_GPU
+                                : TRTSERVER_MEMORY_CPU;
           status = payload.response_provider_->AllocateOutputBuffer(
-              name, &buffer, expected_byte_size, content_shape);
-          dst_memory_type = TRTSERVER_MEMORY_CPU;
+              name, &buffer, expected_byte_size, content_shape,
+              dst_memory_type);
         }
 
         if (status.IsOk()) {
@@ -182,6 +487,11 @@ BackendContext::SetFixedSizeOutputBuffer(
                 RequestStatusCode::INTERNAL,
                 "all attempts to allocate buffer for output '" + name +
                     "' failed");
+          } else if (
+              (src_memory_type == TRTSERVER_MEMORY_CPU) &&
+              (dst_memory_type == TRTSERVER_MEMORY_CPU)) {
+            host_copies.push_back(HostCopy{
+                buffer, content + content_offset, expected_byte_size});
           } else {
             bool cuda_used = false;
             status = CopyBuffer(
@@ -197,15 +507,131 @@ BackendContext::SetFixedSizeOutputBuffer(
 
     content_offset += expected_byte_size;
   }
+  CopyHostBuffers(host_copies);
 
   return cuda_copy;
 }
 
+bool
+BackendContext::SetGpuClassificationOutput(
+    const std::string& name, const size_t batch1_byte_size,
+    const char* content, const std::vector<int64_t>& content_shape,
+    const DataType datatype, Scheduler::Payload* payload)
+{
+#ifdef TRTIS_ENABLE_GPU
+  const size_t cls_count =
+      payload->response_provider_->ClassificationCount(name);
+  const size_t element_byte_size = GetDataTypeByteSize(datatype);
+  if ((cls_count == 0) || (element_byte_size == 0) ||
+      (datatype == DataType::TYPE_BOOL) || (datatype == DataType::TYPE_FP16)) {
+    return false;
+  }
+
+  const size_t element_cnt = batch1_byte_size / element_byte_size;
+  const size_t k = std::min(cls_count, element_cnt);
+  if ((k == 0) || (k > MAX_DEVICE_CLASSIFICATION_COUNT)) {
+    return false;
+  }
+
+  const size_t batch_size =
+      payload->request_provider_->RequestHeader().batch_size();
+  const size_t entry_cnt = batch_size * k;
+
+  auto run_kernel = [&](uint64_t* idx, float* values) {
+    switch (datatype) {
+      case DataType::TYPE_UINT8:
+        return RunTopKKernel(
+            reinterpret_cast<const uint8_t*>(content), batch_size,
+            element_cnt, k, idx, values, stream_);
+      case DataType::TYPE_UINT16:
+        return RunTopKKernel(
+            reinterpret_cast<const uint16_t*>(content), batch_size,
+            element_cnt, k, idx, values, stream_);
+      case DataType::TYPE_UINT32:
+        return RunTopKKernel(
+            reinterpret_cast<const uint32_t*>(content), batch_size,
+            element_cnt, k, idx, values, stream_);
+      case DataType::TYPE_UINT64:
+        return RunTopKKernel(
+            reinterpret_cast<const uint64_t*>(content), batch_size,
+            element_cnt, k, idx, values, stream_);
+      case DataType::TYPE_INT8:
+        return RunTopKKernel(
+            reinterpret_cast<const int8_t*>(content), batch_size,
+            element_cnt, k, idx, values, stream_);
+      case DataType::TYPE_INT16:
+        return RunTopKKernel(
+            reinterpret_cast<const int16_t*>(content), batch_size,
+            element_cnt, k, idx, values, stream_);
+      case DataType::TYPE_INT32:
+        return RunTopKKernel(
+            reinterpret_cast<const int32_t*>(content), batch_size,
+            element_cnt, k, idx, values, stream_);
+      case DataType::TYPE_INT64:
+        return RunTopKKernel(
+            reinterpret_cast<const int64_t*>(content), batch_size,
+            element_cnt, k, idx, values, stream_);
+      case DataType::TYPE_FP32:
+        return RunTopKKernel(
+            reinterpret_cast<const float*>(content), batch_size,
+            element_cnt, k, idx, values, stream_);
+      case DataType::TYPE_FP64:
+        return RunTopKKernel(
+            reinterpret_cast<const double*>(content), batch_size,
+            element_cnt, k, idx, values, stream_);
+      default:
+        return cudaErrorInvalidValue;
+    }
+  };
+
+  // The indices of the selected results are followed by their values
+  // in a single device buffer so that they take a single copy.
+  const size_t byte_size = entry_cnt * (sizeof(uint64_t) + sizeof(float));
+  void* device_buffer = nullptr;
+  Status status = CudaMemoryManager::Alloc(
+      &device_buffer, byte_size, gpu_device_, stream_);
+  if (!status.IsOk()) {
+    return false;
+  }
+
+  uint64_t* device_idx = static_cast<uint64_t*>(device_buffer);
+  float* device_values = reinterpret_cast<float*>(device_idx + entry_cnt);
+  cudaError_t err = run_kernel(device_idx, device_values);
+  if (err != cudaSuccess) {
+    status = Status(
+        RequestStatusCode::INTERNAL,
+        "failed to select classification results for output '" + name +
+            "': " + cudaGetErrorString(err));
+  }
+
+  if (status.IsOk()) {
+    uint64_t* idx;
+    float* values;
+    status = payload->response_provider_->AllocateClassificationBuffer(
+        name, content_shape, k, &idx, &values);
+    if (status.IsOk()) {
+      // 'values' follows 'idx' in the host buffer, as in
+      // 'device_buffer'.
+      bool cuda_used;
+      status = CopyBuffer(
+          name, TRTSERVER_MEMORY_GPU, TRTSERVER_MEMORY_CPU, byte_size,
+          device_buffer, idx, &cuda_used);
+    }
+  }
+
+  CudaMemoryManager::Free(device_buffer, stream_);
+  payload->status_ = status;
+  return true;
+#else
+  return false;
+#endif  // TRTIS_ENABLE_GPU
+}
+
 Status
 BackendContext::CopyBuffer(
     const std::string& name, const TRTSERVER_Memory_Type src_memory_type,
     const TRTSERVER_Memory_Type dst_memory_type, const size_t byte_size,
-    const void* src, void* dst, bool* cuda_used)
+    const void* src, void* dst, bool* cuda_used, cudaStream_t stream)
 {
   *cuda_used = false;
 
@@ -221,7 +647,9 @@ BackendContext::CopyBuffer(
     } else if (dst_memory_type == TRTSERVER_MEMORY_CPU) {
       copy_kind = cudaMemcpyDeviceToHost;
     }
-    cudaError_t err = cudaMemcpyAsync(dst, src, byte_size, copy_kind, stream_);
+    cudaError_t err = cudaMemcpyAsync(
+        dst, src, byte_size, copy_kind,
+        (stream != nullptr) ? stream : stream_);
     if (err != cudaSuccess) {
       return Status(
           RequestStatusCode::INTERNAL,
@@ -239,4 +667,179 @@ BackendContext::CopyBuffer(
   return Status::Success;
 }
 
+#ifdef TRTIS_ENABLE_GPU
+namespace {
+
+// The stats whose timestamp is set by a host function queued on a
+// stream.
+struct StreamTimestamp {
+  ModelInferStats::TimestampKind kind_;
+  std::vector<std::shared_ptr<ModelInferStats>> stats_;
+};
+
+void
+CaptureStreamTimestampFn(void* userp)
+{
+  StreamTimestamp* timestamp = reinterpret_cast<StreamTimestamp*>(userp);
+  for (auto& stats : timestamp->stats_) {
+    stats->CaptureTimestamp(timestamp->kind_);
+  }
+  delete timestamp;
+}
+
+}  // namespace
+#endif  // TRTIS_ENABLE_GPU
+
+void
+BackendContext::CaptureStreamTimestamp(
+    ModelInferStats::TimestampKind kind,
+    std::vector<Scheduler::Payload>* payloads, cudaStream_t stream)
+{
+  std::vector<std::shared_ptr<ModelInferStats>> stats;
+  for (auto& payload : *payloads) {
+    if (payload.stats_ != nullptr) {
+      stats.push_back(payload.stats_);
+    }
+  }
+  if (stats.empty()) {
+    return;
+  }
+
+#ifdef TRTIS_ENABLE_GPU
+  if (gpu_device_ != NO_GPU_DEVICE) {
+    StreamTimestamp* timestamp = new StreamTimestamp{kind, std::move(stats)};
+    cudaError_t err = cudaLaunchHostFunc(
+        (stream != nullptr) ? stream : stream_, CaptureStreamTimestampFn,
+        timestamp);
+    if (err == cudaSuccess) {
+      return;
+    }
+
+    LOG_VERBOSE(1) << "unable to queue timestamp capture for " << name_
+                   << ": " << cudaGetErrorString(err);
+    stats = std::move(timestamp->stats_);
+    delete timestamp;
+  }
+#endif  // TRTIS_ENABLE_GPU
+
+  for (auto& s : stats) {
+    s->CaptureTimestamp(kind);
+  }
+}
+
+void
+BackendContext::CompleteAsync(
+    std::function<void()>&& OnComplete, const size_t max_pending)
+{
+#ifdef TRTIS_ENABLE_GPU
+  cudaEvent_t event = nullptr;
+  {
+    std::unique_lock<std::mutex> lock(completion_mu_);
+    completion_cv_.wait(lock, [this, max_pending] {
+      return completions_.size() < std::max(max_pending, (size_t)1);
+    });
+    if (!completion_events_.empty()) {
+      event = completion_events_.back();
+      completion_events_.pop_back();
+    }
+  }
+
+  cudaError_t err = cudaSuccess;
+  if (event == nullptr) {
+    err = cudaEventCreateWithFlags(&event, cudaEventDisableTiming);
+    if (err != cudaSuccess) {
+      event = nullptr;
+    }
+  }
+  if (err == cudaSuccess) {
+    err = cudaEventRecord(event, stream_);
+  }
+
+  // Without an event to wait for, complete synchronously.
+  if (err != cudaSuccess) {
+    LOG_ERROR << "unable to queue completion for " << name_ << ": "
+              << cudaGetErrorString(err);
+    if (event != nullptr) {
+      cudaEventDestroy(event);
+    }
+    cudaStreamSynchronize(stream_);
+    OnComplete();
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(completion_mu_);
+    if (!completion_thread_.joinable()) {
+      completion_exit_ = false;
+      completion_thread_ = std::thread([this]() { CompletionThread(); });
+    }
+    completions_.emplace_back(event, std::move(OnComplete));
+  }
+  completion_cv_.notify_all();
+#else
+  OnComplete();
+#endif  // TRTIS_ENABLE_GPU
+}
+
+void
+BackendContext::StopCompletions()
+{
+#ifdef TRTIS_ENABLE_GPU
+  if (completion_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(completion_mu_);
+      completion_exit_ = true;
+    }
+    completion_cv_.notify_all();
+    completion_thread_.join();
+  }
+
+  for (cudaEvent_t event : completion_events_) {
+    cudaError_t err = cudaEventDestroy(event);
+    if (err != cudaSuccess) {
+      LOG_ERROR << "Failed to destroy cuda event: " << cudaGetErrorString(err);
+    }
+  }
+  completion_events_.clear();
+#endif  // TRTIS_ENABLE_GPU
+}
+
+#ifdef TRTIS_ENABLE_GPU
+void
+BackendContext::CompletionThread()
+{
+  if (gpu_device_ != NO_GPU_DEVICE) {
+    cudaSetDevice(gpu_device_);
+  }
+
+  std::unique_lock<std::mutex> lock(completion_mu_);
+  while (true) {
+    completion_cv_.wait(
+        lock, [this]() { return completion_exit_ || !completions_.empty(); });
+
+    // Only exit once every queued completion is called.
+    if (completions_.empty()) {
+      break;
+    }
+
+    cudaEvent_t event = completions_.front().first;
+    std::function<void()> OnComplete =
+        std::move(completions_.front().second);
+    lock.unlock();
+
+    cudaError_t err = cudaEventSynchronize(event);
+    if (err != cudaSuccess) {
+      LOG_ERROR << "unable to wait for completion for " << name_ << ": "
+                << cudaGetErrorString(err);
+    }
+    OnComplete();
+
+    lock.lock();
+    completions_.pop_front();
+    completion_events_.push_back(event);
+    completion_cv_.notify_all();
+  }
+}
+#endif  // TRTIS_ENABLE_GPU
+
 }}  // namespace nvidia::inferenceserver
@@ -25,8 +25,14 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
+#include "src/core/model_config.h"
 #include "src/core/scheduler.h"
 
 #ifdef TRTIS_ENABLE_GPU
@@ -35,6 +41,10 @@
 
 namespace nvidia { namespace inferenceserver {
 
+#ifndef TRTIS_ENABLE_GPU
+using cudaStream_t = void*;
+#endif  // TRTIS_ENABLE_GPU
+
 struct BackendContext {
   // GPU device number that indicates that no gpu is available for a
   // context (which is an invalid state since TensorRT requires a
@@ -50,8 +60,10 @@ struct BackendContext {
   virtual ~BackendContext();
 
   // Create the CUDA stream for data transfer operations. Have no effect
-  // if GPU support is disabled.
-  Status CreateCudaStream(const int cuda_stream_priority = 0);
+  // if GPU support is disabled. The stream is created as 'stream_'
+  // unless 'stream' is given.
+  Status CreateCudaStream(
+      const int cuda_stream_priority = 0, cudaStream_t* stream = nullptr);
 
   // Helper function to batch input data from payloads into 'input_buffer'.
   // 'input_buffer' must be a continuous block that can hold the sum of
@@ -59,24 +71,87 @@ struct BackendContext {
   // set the status of the payload accordingly.
   // Return true if cudaMemcpyAsync is called, and the caller should call
   // cudaStreamSynchronize before using the data. Otherwise, return false.
+  // The copies are issued on 'stream', or on 'stream_' if 'stream' is
+  // nullptr. Chunks that are adjacent in memory are copied together,
+  // and chunks in host memory copied to GPU memory are first gathered
+  // into a pinned buffer, when the pinned memory pool has room, so
+  // that they take a single copy.
   bool SetInputBuffer(
       const std::string& name, const std::vector<size_t>& expected_byte_sizes,
       std::vector<Scheduler::Payload>* payloads,
-      TRTSERVER_Memory_Type dst_memory_type, char* input_buffer);
+      TRTSERVER_Memory_Type dst_memory_type, char* input_buffer,
+      cudaStream_t stream = nullptr);
+
+  // Like SetInputBuffer() but only copy to 'input_buffer' the bytes
+  // that differ from 'staged'. 'staged' must hold the contents that
+  // 'input_buffer' had after the previous call, or be empty, and is
+  // updated to the new contents. This avoids copying small inputs
+  // whose values rarely change between executions, like sequence
+  // control tensors, into device memory on every execution.
+  bool SetStagedInputBuffer(
+      const std::string& name, const std::vector<size_t>& expected_byte_sizes,
+      std::vector<Scheduler::Payload>* payloads,
+      TRTSERVER_Memory_Type dst_memory_type, char* input_buffer,
+      std::vector<char>* staged, cudaStream_t stream = nullptr);
 
   // Helper function to set output buffer of fixed size data type to payloads
   // Return true if cudaMemcpyAsync is called, and the caller should call
   // cudaStreamSynchronize before using the data. Otherwise, return false.
+  // If the output is in GPU memory and its 'datatype' is given, the
+  // classification results requested by a payload are selected on the
+  // GPU so that only they are copied to the host.
   bool SetFixedSizeOutputBuffer(
       const std::string& name, const size_t batch1_byte_size,
       const char* content, const std::vector<int64_t>& content_shape,
       TRTSERVER_Memory_Type src_memory_type,
-      std::vector<Scheduler::Payload>* payloads);
+      std::vector<Scheduler::Payload>* payloads,
+      const DataType datatype = DataType::TYPE_INVALID);
 
+  // Copy 'byte_size' bytes from 'src' to 'dst'. A copy involving GPU
+  // memory is issued asynchronously on 'stream', or on 'stream_' if
+  // 'stream' is nullptr, and sets 'cuda_used' to true.
   Status CopyBuffer(
       const std::string& name, const TRTSERVER_Memory_Type src_memory_type,
       const TRTSERVER_Memory_Type dst_memory_type, const size_t byte_size,
-      const void* src, void* dst, bool* cuda_used);
+      const void* src, void* dst, bool* cuda_used,
+      cudaStream_t stream = nullptr);
+
+  // Set the kComputeInputEnd timestamp of the payloads once the input
+  // copies issued on 'stream', or on 'stream_' if 'stream' is
+  // nullptr, have completed, so that the timestamp marks the end of
+  // the host-to-device transfer rather than when it was issued.
+  void CaptureInputCopyEnd(
+      std::vector<Scheduler::Payload>* payloads, cudaStream_t stream = nullptr)
+  {
+    CaptureStreamTimestamp(
+        ModelInferStats::TimestampKind::kComputeInputEnd, payloads, stream);
+  }
+
+  // Set the kComputeOutputStart timestamp of the payloads once the
+  // execution issued on 'stream', or on 'stream_' if 'stream' is
+  // nullptr, has completed, so that the timestamp marks the start of
+  // the device-to-host transfer of the outputs.
+  void CaptureOutputCopyStart(
+      std::vector<Scheduler::Payload>* payloads, cudaStream_t stream = nullptr)
+  {
+    CaptureStreamTimestamp(
+        ModelInferStats::TimestampKind::kComputeOutputStart, payloads, stream);
+  }
+
+  // Call 'OnComplete' from the context's completion thread once all
+  // the work issued on 'stream_' so far has finished, so that the
+  // caller can go on to issue more work without waiting. Completions
+  // are called in the order they are queued. If 'max_pending'
+  // completions are already queued the call first waits for the
+  // oldest one. Without GPU support 'OnComplete' is called before
+  // returning.
+  void CompleteAsync(
+      std::function<void()>&& OnComplete, const size_t max_pending);
+
+  // Wait for every completion queued by CompleteAsync() and stop the
+  // completion thread. A derived context must call this before
+  // releasing anything that the queued work uses.
+  void StopCompletions();
 
   // Name of the model instance
   std::string name_;
@@ -84,6 +159,10 @@ struct BackendContext {
   // The GPU index active when this context was created.
   int gpu_device_;
 
+  // All the GPUs of a KIND_MULTI_GPU instance, the first of which is
+  // 'gpu_device_'. Empty for other instances.
+  std::vector<int> gpu_devices_;
+
   // Maximum batch size to allow. This is the minimum of what is
   // supported by the model and what is requested in the
   // configuration.
@@ -93,6 +172,66 @@ struct BackendContext {
   // The stream where data transfer operations are executed on.
   cudaStream_t stream_;
 #endif  // TRTIS_ENABLE_GPU
+
+ private:
+  struct InputCopy;
+
+  // Add a copy to 'copies', merging it into the last copy if both
+  // are adjacent in source and destination memory.
+  static void AddInputCopy(
+      std::vector<InputCopy>* copies, const char* src,
+      const TRTSERVER_Memory_Type src_memory_type, const size_t dst_offset,
+      const size_t byte_size, const size_t payload_idx);
+
+  // Gather the copies from host memory in 'copies' into a pinned
+  // buffer and issue a single copy of it to 'input_buffer' in GPU
+  // memory. The gathered copies are marked so. Return true if the
+  // copies were gathered.
+  bool GatherInputCopies(
+      const std::string& name, std::vector<Scheduler::Payload>* payloads,
+      TRTSERVER_Memory_Type dst_memory_type, char* input_buffer,
+      cudaStream_t stream, std::vector<InputCopy>* copies);
+
+  // Select the classification results of the 'name'd output of
+  // 'payload' from 'content' in GPU memory, on 'stream_', and copy
+  // only them to the payload's response provider. Return false,
+  // without doing anything, if they can't be selected on the GPU.
+  bool SetGpuClassificationOutput(
+      const std::string& name, const size_t batch1_byte_size,
+      const char* content, const std::vector<int64_t>& content_shape,
+      const DataType datatype, Scheduler::Payload* payload);
+
+  // Set the 'kind' timestamp of the payloads when the work issued on
+  // 'stream' so far completes. The timestamp is captured by a host
+  // function queued on the stream, or immediately for a context
+  // without a GPU or when the host function can't be queued.
+  void CaptureStreamTimestamp(
+      ModelInferStats::TimestampKind kind,
+      std::vector<Scheduler::Payload>* payloads, cudaStream_t stream);
+
+  // Free the pinned gather buffers whose copies have completed, or
+  // all of them after waiting for their copies if 'wait' is true.
+  void ReleaseGatherBuffers(const bool wait);
+
+#ifdef TRTIS_ENABLE_GPU
+  void CompletionThread();
+
+  // The completions queued by CompleteAsync(), each with the event
+  // recorded on 'stream_' that it waits for, and the events that can
+  // be reused.
+  std::mutex completion_mu_;
+  std::condition_variable completion_cv_;
+  std::deque<std::pair<cudaEvent_t, std::function<void()>>> completions_;
+  std::vector<cudaEvent_t> completion_events_;
+  bool completion_exit_;
+  std::thread completion_thread_;
+
+  // The pinned buffers that inputs were gathered into, each with the
+  // event recorded after the copy out of it, and the events that can
+  // be reused.
+  std::deque<std::pair<void*, cudaEvent_t>> gather_buffers_;
+  std::vector<cudaEvent_t> gather_events_;
+#endif  // TRTIS_ENABLE_GPU
 };
 
 }}  // namespace nvidia::inferenceserver
@@ -32,6 +32,11 @@ namespace nvidia { namespace inferenceserver {
 constexpr char kInferRequestHTTPHeader[] = "NV-InferRequest";
 constexpr char kInferResponseHTTPHeader[] = "NV-InferResponse";
 constexpr char kStatusHTTPHeader[] = "NV-Status";
+constexpr char kStreamResponseOrderGRPCMetadata[] = "nv-stream-response-order";
+constexpr char kStreamPartialOutputsGRPCMetadata[] =
+    "nv-stream-partial-outputs";
+constexpr char kResponseCompressionGRPCMetadata[] = "nv-response-compression";
+constexpr char kPeerForwardedGRPCMetadata[] = "nv-peer-forwarded";
 
 constexpr char kInferRESTEndpoint[] = "api/infer";
 constexpr char kStatusRESTEndpoint[] = "api/status";
@@ -74,6 +79,8 @@ constexpr char kCustomFilename[] = "libcustom.so";
 
 constexpr char kTensorRTExecutionAccelerator[] = "tensorrt";
 constexpr char kOpenVINOExecutionAccelerator[] = "openvino";
+constexpr char kDLAExecutionAccelerator[] = "dla";
+constexpr char kXLAExecutionAccelerator[] = "xla";
 
 constexpr char kEnsemblePlatform[] = "ensemble";
 constexpr char kModelConfigPbTxt[] = "config.pbtxt";
@@ -81,6 +88,10 @@ constexpr char kModelConfigPbTxt[] = "config.pbtxt";
 constexpr char kMetricsLabelModelName[] = "model";
 constexpr char kMetricsLabelModelVersion[] = "version";
 constexpr char kMetricsLabelGpuUuid[] = "gpu_uuid";
+constexpr char kMetricsLabelBatcher[] = "batcher";
+constexpr char kMetricsLabelStepModel[] = "step_model";
+constexpr char kMetricsLabelModelInstance[] = "model_instance";
+constexpr char kMetricsLabelThreadGroup[] = "thread_group";
 
 constexpr uint64_t NANOS_PER_SECOND = 1000000000;
 constexpr int MAX_GRPC_MESSAGE_SIZE = INT32_MAX;
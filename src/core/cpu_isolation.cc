@@ -0,0 +1,285 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/core/cpu_isolation.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "src/core/logging.h"
+
+namespace nvidia { namespace inferenceserver {
+
+namespace {
+
+constexpr size_t THREAD_CLASS_COUNT = 4;
+
+const char*
+ThreadClassName(const ThreadClass thread_class)
+{
+  switch (thread_class) {
+    case ThreadClass::FRONTEND:
+      return "frontend";
+    case ThreadClass::SCHEDULER:
+      return "scheduler";
+    case ThreadClass::BACKEND:
+      return "backend";
+    case ThreadClass::BACKGROUND:
+      return "background";
+  }
+
+  return "<invalid>";
+}
+
+// The CPUs of each thread class. Assigned while the server is created,
+// before any threads that read them are started, so not locked.
+struct CpuIsolation {
+  bool enabled_ = false;
+  std::vector<int> process_cpus_;
+  std::vector<int> class_cpus_[THREAD_CLASS_COUNT];
+};
+
+CpuIsolation&
+Isolation()
+{
+  static CpuIsolation isolation;
+  return isolation;
+}
+
+std::vector<int>
+ProcessCpus()
+{
+  std::vector<int> cpus;
+
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  if (sched_getaffinity(0, sizeof(cpuset), &cpuset) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &cpuset)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+
+  return cpus;
+}
+
+// Return the number of CPUs the cgroup CPU quota of the process
+// allows, or 0 if there is no quota. Both cgroup v2 and v1 are
+// checked.
+uint32_t
+CgroupCpuQuota()
+{
+  long long quota = -1, period = 0;
+
+  std::ifstream v2("/sys/fs/cgroup/cpu.max");
+  if (v2) {
+    std::string max;
+    if (!(v2 >> max >> period) || (max == "max")) {
+      return 0;
+    }
+    quota = atoll(max.c_str());
+  } else {
+    std::ifstream q("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+    std::ifstream p("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+    if (!q || !p || !(q >> quota) || !(p >> period)) {
+      return 0;
+    }
+  }
+
+  if ((quota <= 0) || (period <= 0)) {
+    return 0;
+  }
+
+  // Round up so that a fractional quota still gets a thread.
+  return std::max(1LL, (quota + period - 1) / period);
+}
+
+Status
+BindCurrentThread(const std::vector<int>& cpus)
+{
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (const int cpu : cpus) {
+    CPU_SET(cpu, &cpuset);
+  }
+
+  const int err =
+      pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+  if (err != 0) {
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "unable to set CPU affinity: " + std::string(strerror(err)));
+  }
+
+  return Status::Success;
+}
+
+}  // namespace
+
+bool
+ParseCpuList(const std::string& list, std::vector<int>* cpus)
+{
+  std::istringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty() || (range == "\n")) {
+      continue;
+    }
+
+    int first, last;
+    if (sscanf(range.c_str(), "%d-%d", &first, &last) != 2) {
+      if (sscanf(range.c_str(), "%d", &first) != 1) {
+        return false;
+      }
+      last = first;
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus->push_back(cpu);
+    }
+  }
+
+  return true;
+}
+
+Status
+SetThreadClassCpus(
+    const ThreadClass thread_class, const std::vector<int>& cpus)
+{
+  CpuIsolation& isolation = Isolation();
+  if (!isolation.enabled_) {
+    isolation.process_cpus_ = ProcessCpus();
+    for (auto& class_cpus : isolation.class_cpus_) {
+      class_cpus = isolation.process_cpus_;
+    }
+  }
+
+  if (cpus.empty()) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "no CPUs specified for " + std::string(ThreadClassName(thread_class)) +
+            " threads");
+  }
+
+  std::vector<int> sorted(cpus);
+  std::sort(sorted.begin(), sorted.end());
+  sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+  for (const int cpu : sorted) {
+    if (!std::binary_search(
+            isolation.process_cpus_.begin(), isolation.process_cpus_.end(),
+            cpu)) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "CPU " + std::to_string(cpu) + " for " +
+              ThreadClassName(thread_class) +
+              " threads is not available to the server");
+    }
+  }
+
+  isolation.enabled_ = true;
+  isolation.class_cpus_[static_cast<size_t>(thread_class)] = sorted;
+
+  LOG_VERBOSE(1) << ThreadClassName(thread_class) << " threads use "
+                 << sorted.size() << " CPUs";
+
+  return Status::Success;
+}
+
+const std::vector<int>&
+ThreadClassCpus(const ThreadClass thread_class)
+{
+  static const std::vector<int> no_cpus;
+
+  const CpuIsolation& isolation = Isolation();
+  if (!isolation.enabled_) {
+    return no_cpus;
+  }
+
+  return isolation.class_cpus_[static_cast<size_t>(thread_class)];
+}
+
+void
+SetThreadClass(const ThreadClass thread_class)
+{
+  const std::vector<int>& cpus = ThreadClassCpus(thread_class);
+  if (cpus.empty()) {
+    return;
+  }
+
+  Status status = BindCurrentThread(cpus);
+  if (!status.IsOk()) {
+    LOG_ERROR << "failed to bind " << ThreadClassName(thread_class)
+              << " thread: " << status.Message();
+  }
+}
+
+uint32_t
+AvailableCpuCount(const ThreadClass thread_class)
+{
+  const std::vector<int>& cpus = ThreadClassCpus(thread_class);
+  if (!cpus.empty() && (cpus.size() < Isolation().process_cpus_.size())) {
+    return cpus.size();
+  }
+
+  uint32_t count = ProcessCpus().size();
+  const uint32_t quota = CgroupCpuQuota();
+  if (quota != 0) {
+    count = std::min(count, quota);
+  }
+
+  return std::max(1u, count);
+}
+
+ScopedThreadClass::ScopedThreadClass(const ThreadClass thread_class)
+    : restore_(false)
+{
+  const std::vector<int>& cpus = ThreadClassCpus(thread_class);
+  if (cpus.empty()) {
+    return;
+  }
+
+  CPU_ZERO(&previous_);
+  if (pthread_getaffinity_np(pthread_self(), sizeof(previous_), &previous_) !=
+      0) {
+    return;
+  }
+
+  SetThreadClass(thread_class);
+  restore_ = true;
+}
+
+ScopedThreadClass::~ScopedThreadClass()
+{
+  if (restore_) {
+    pthread_setaffinity_np(pthread_self(), sizeof(previous_), &previous_);
+  }
+}
+
+}}  // namespace nvidia::inferenceserver
@@ -0,0 +1,95 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <sched.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "src/core/status.h"
+
+namespace nvidia { namespace inferenceserver {
+
+// The classes of server threads that can each be isolated on their
+// own set of host CPUs, so that, for example, request parsing in the
+// front ends doesn't take CPU time from CPU backends.
+enum class ThreadClass {
+  // HTTP and GRPC threads that receive requests and send responses.
+  FRONTEND,
+
+  // Scheduler threads that form batches and run them on a model
+  // instance.
+  SCHEDULER,
+
+  // The thread pools of the frameworks, for example TensorFlow's
+  // inter-op and intra-op threads. These are created while a model is
+  // loaded and so inherit the CPUs of the loading thread.
+  BACKEND,
+
+  // Model loading, metrics, status and other housekeeping threads.
+  BACKGROUND
+};
+
+// Parse a Linux CPU list, for example "0-3,8-11", into 'cpus'. Return
+// false if the list can't be parsed.
+bool ParseCpuList(const std::string& list, std::vector<int>* cpus);
+
+// Set the host CPUs that threads of 'thread_class' run on. Must be
+// called before the server creates any threads. Once any class has
+// CPUs assigned, the threads of a class without assigned CPUs run on
+// all the CPUs available to the process.
+Status SetThreadClassCpus(
+    const ThreadClass thread_class, const std::vector<int>& cpus);
+
+// Return the host CPUs that threads of 'thread_class' run on, or
+// empty if no class has CPUs assigned and so threads are not bound.
+const std::vector<int>& ThreadClassCpus(const ThreadClass thread_class);
+
+// Bind the calling thread to the CPUs of 'thread_class'. Does nothing
+// if no class has CPUs assigned. Failures are logged.
+void SetThreadClass(const ThreadClass thread_class);
+
+// Return the number of CPUs that threads of 'thread_class' can use:
+// the number of CPUs assigned to the class or, if none are, the
+// number of CPUs the process may run on, limited by the CPU quota of
+// the process's cgroup. Used to size thread pools.
+uint32_t AvailableCpuCount(const ThreadClass thread_class);
+
+// Bind the calling thread to the CPUs of a thread class for the
+// lifetime of the object, restoring the thread's previous CPUs when
+// it is destroyed. Threads created meanwhile inherit the CPUs of the
+// class.
+class ScopedThreadClass {
+ public:
+  explicit ScopedThreadClass(const ThreadClass thread_class);
+  ~ScopedThreadClass();
+
+ private:
+  bool restore_;
+  cpu_set_t previous_;
+};
+
+}}  // namespace nvidia::inferenceserver
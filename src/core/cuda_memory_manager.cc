@@ -0,0 +1,302 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/core/cuda_memory_manager.h"
+
+#include <algorithm>
+#include <iterator>
+#include "src/core/logging.h"
+
+namespace nvidia { namespace inferenceserver {
+
+namespace {
+
+// The smallest size class. Blocks of size class 'c' hold
+// 'kMinBlockByteSize << c' bytes.
+constexpr uint64_t kMinBlockByteSize = 256;
+
+// The upper bound on the bytes of each device that are cached but not
+// in use. Blocks freed beyond this are released to CUDA.
+constexpr uint64_t kMaxCachedByteSize = 256 * 1024 * 1024;
+
+#ifdef TRTIS_ENABLE_GPU
+// Make 'device_id' the current device for the lifetime of the object.
+class ScopedDevice {
+ public:
+  explicit ScopedDevice(int64_t device_id) : previous_device_(-1)
+  {
+    int current_device;
+    if ((cudaGetDevice(&current_device) == cudaSuccess) &&
+        (current_device != device_id) &&
+        (cudaSetDevice(device_id) == cudaSuccess)) {
+      previous_device_ = current_device;
+    }
+  }
+
+  ~ScopedDevice()
+  {
+    if (previous_device_ >= 0) {
+      cudaSetDevice(previous_device_);
+    }
+  }
+
+ private:
+  int previous_device_;
+};
+#endif  // TRTIS_ENABLE_GPU
+
+}  // namespace
+
+CudaMemoryManager::~CudaMemoryManager()
+{
+  for (auto& pr : devices_) {
+    for (auto& blocks : pr.second.free_blocks_) {
+      for (Block* block : blocks) {
+        DestroyBlock(block);
+      }
+    }
+  }
+}
+
+CudaMemoryManager*
+CudaMemoryManager::GetSingleton()
+{
+  static CudaMemoryManager singleton;
+  return &singleton;
+}
+
+size_t
+CudaMemoryManager::SizeClass(uint64_t size)
+{
+  size_t size_class = 0;
+  while ((kMinBlockByteSize << size_class) < size) {
+    size_class++;
+  }
+
+  return size_class;
+}
+
+Status
+CudaMemoryManager::Alloc(
+    void** ptr, uint64_t size, int64_t device_id, cudaStream_t stream)
+{
+  *ptr = nullptr;
+
+#ifdef TRTIS_ENABLE_GPU
+  CudaMemoryManager* manager = GetSingleton();
+  const size_t size_class = SizeClass(size);
+  const uint64_t block_byte_size = kMinBlockByteSize << size_class;
+
+  Block* block = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(manager->mu_);
+    DeviceMemory& device = manager->devices_[device_id];
+    block = manager->ReuseBlock(&device, size_class, stream);
+    if (block != nullptr) {
+      device.cached_byte_size_ -= block_byte_size;
+    }
+  }
+
+  const bool new_block = (block == nullptr);
+  if (new_block) {
+    char* buffer = nullptr;
+    cudaError_t err;
+    {
+      ScopedDevice scoped_device(device_id);
+      err = cudaMalloc((void**)&buffer, block_byte_size);
+    }
+    if (err != cudaSuccess) {
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "failed to allocate " + std::to_string(block_byte_size) +
+              " bytes of GPU memory on device " + std::to_string(device_id) +
+              ": " + std::string(cudaGetErrorString(err)));
+    }
+
+    block = new Block();
+    block->ptr_ = buffer;
+    block->device_id_ = device_id;
+    block->size_class_ = size_class;
+    block->event_ = nullptr;
+    block->pending_ = false;
+  }
+
+  block->requested_byte_size_ = size;
+  block->stream_ = stream;
+
+  {
+    std::lock_guard<std::mutex> lock(manager->mu_);
+    DeviceMemory& device = manager->devices_[device_id];
+    if (new_block) {
+      device.device_alloc_count_++;
+    }
+    device.allocated_byte_size_ += block_byte_size;
+    device.requested_byte_size_ += size;
+    device.peak_allocated_byte_size_ = std::max(
+        device.peak_allocated_byte_size_, device.allocated_byte_size_);
+    manager->allocated_blocks_.emplace(block->ptr_, block);
+  }
+
+  *ptr = block->ptr_;
+  return Status::Success;
+#else
+  return Status(
+      RequestStatusCode::UNSUPPORTED,
+      "GPU memory allocation is not supported, GPU support is disabled");
+#endif  // TRTIS_ENABLE_GPU
+}
+
+Status
+CudaMemoryManager::Free(void* ptr, cudaStream_t stream)
+{
+  if (ptr == nullptr) {
+    return Status::Success;
+  }
+
+  CudaMemoryManager* manager = GetSingleton();
+  Block* block = nullptr;
+  bool cached = false;
+  {
+    std::lock_guard<std::mutex> lock(manager->mu_);
+    auto it = manager->allocated_blocks_.find(ptr);
+    if (it == manager->allocated_blocks_.end()) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "unable to free GPU memory that was not allocated by the server");
+    }
+
+    block = it->second;
+    manager->allocated_blocks_.erase(it);
+
+    DeviceMemory& device = manager->devices_[block->device_id_];
+    const uint64_t block_byte_size = kMinBlockByteSize << block->size_class_;
+    device.allocated_byte_size_ -= block_byte_size;
+    device.requested_byte_size_ -= block->requested_byte_size_;
+
+    if ((device.cached_byte_size_ + block_byte_size) <= kMaxCachedByteSize) {
+      // Remember where the work using the block is queued so that a
+      // different stream does not reuse the block before it is done.
+      block->stream_ = stream;
+      block->pending_ = false;
+      cached = true;
+#ifdef TRTIS_ENABLE_GPU
+      if (stream != nullptr) {
+        ScopedDevice scoped_device(block->device_id_);
+        cudaError_t err = cudaSuccess;
+        if (block->event_ == nullptr) {
+          err = cudaEventCreateWithFlags(
+              &block->event_, cudaEventDisableTiming);
+        }
+        if (err == cudaSuccess) {
+          err = cudaEventRecord(block->event_, stream);
+        }
+        block->pending_ = (err == cudaSuccess);
+        cached = block->pending_;
+      }
+#endif  // TRTIS_ENABLE_GPU
+
+      if (cached) {
+        if (block->size_class_ >= device.free_blocks_.size()) {
+          device.free_blocks_.resize(block->size_class_ + 1);
+        }
+        device.free_blocks_[block->size_class_].push_back(block);
+        device.cached_byte_size_ += block_byte_size;
+      }
+    }
+  }
+
+  if (!cached) {
+    DestroyBlock(block);
+  }
+
+  return Status::Success;
+}
+
+void
+CudaMemoryManager::GetStatus(ServerStatus* server_status)
+{
+  CudaMemoryManager* manager = GetSingleton();
+  std::lock_guard<std::mutex> lock(manager->mu_);
+  for (const auto& pr : manager->devices_) {
+    const DeviceMemory& device = pr.second;
+    GpuMemoryStatus* status = server_status->add_gpu_memory_status();
+    status->set_device_id(pr.first);
+    status->set_allocated_byte_size(device.allocated_byte_size_);
+    status->set_requested_byte_size(device.requested_byte_size_);
+    status->set_cached_byte_size(device.cached_byte_size_);
+    status->set_peak_allocated_byte_size(device.peak_allocated_byte_size_);
+    status->set_device_alloc_count(device.device_alloc_count_);
+  }
+}
+
+CudaMemoryManager::Block*
+CudaMemoryManager::ReuseBlock(
+    DeviceMemory* device, size_t size_class, cudaStream_t stream)
+{
+  if (size_class >= device->free_blocks_.size()) {
+    return nullptr;
+  }
+
+  // Prefer the most recently freed blocks since they are the most
+  // likely to be used by the same stream.
+  auto& blocks = device->free_blocks_[size_class];
+  for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+    Block* block = *it;
+    bool ready = !block->pending_ || (block->stream_ == stream);
+#ifdef TRTIS_ENABLE_GPU
+    if (!ready) {
+      ready = (cudaEventQuery(block->event_) == cudaSuccess);
+    }
+#endif  // TRTIS_ENABLE_GPU
+    if (ready) {
+      block->pending_ = false;
+      blocks.erase(std::next(it).base());
+      return block;
+    }
+  }
+
+  return nullptr;
+}
+
+void
+CudaMemoryManager::DestroyBlock(Block* block)
+{
+#ifdef TRTIS_ENABLE_GPU
+  ScopedDevice scoped_device(block->device_id_);
+  cudaError_t err = cudaFree(block->ptr_);
+  if (err != cudaSuccess) {
+    LOG_ERROR << "failed to free GPU memory at address "
+              << static_cast<void*>(block->ptr_) << ": "
+              << cudaGetErrorString(err);
+  }
+  if (block->event_ != nullptr) {
+    cudaEventDestroy(block->event_);
+  }
+#endif  // TRTIS_ENABLE_GPU
+  delete block;
+}
+
+}}  // namespace nvidia::inferenceserver
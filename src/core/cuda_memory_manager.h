@@ -0,0 +1,124 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "src/core/server_status.pb.h"
+#include "src/core/status.h"
+
+#ifdef TRTIS_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRTIS_ENABLE_GPU
+
+namespace nvidia { namespace inferenceserver {
+
+#ifndef TRTIS_ENABLE_GPU
+using cudaStream_t = void*;
+using cudaEvent_t = void*;
+#endif  // TRTIS_ENABLE_GPU
+
+// This is a singleton class that caches the GPU memory the server
+// allocates for tensors, such as the outputs of ensemble steps and
+// response buffers, so that it can be reused across requests.
+// Frequent cudaMalloc() and cudaFree() calls are costly, and
+// cudaFree() synchronizes the whole device, which would stall every
+// other model running on it. Memory is cached per device in
+// power-of-two size classes so that requests with different batch
+// sizes can share it.
+//
+// Reuse is stream-ordered. A buffer freed with a stream may be used
+// right away by an allocation on the same stream, but is given to
+// another stream only once the work that was queued on the freeing
+// stream has completed.
+class CudaMemoryManager {
+ public:
+  ~CudaMemoryManager();
+
+  // Allocate a buffer of 'size' bytes on GPU 'device_id' and return it
+  // in 'ptr'. The buffer is to be used by work queued on 'stream',
+  // which may be nullptr if the caller synchronizes the buffer's use
+  // itself.
+  static Status Alloc(
+      void** ptr, uint64_t size, int64_t device_id, cudaStream_t stream);
+
+  // Free a buffer returned by Alloc(). 'stream' is the stream that
+  // may still have work queued that uses the buffer, or nullptr if
+  // there is no such work.
+  static Status Free(void* ptr, cudaStream_t stream);
+
+  // Add the memory usage of each device to 'server_status'.
+  static void GetStatus(ServerStatus* server_status);
+
+ private:
+  struct Block {
+    char* ptr_;
+    int64_t device_id_;
+    size_t size_class_;
+    uint64_t requested_byte_size_;
+
+    // The stream that last used the block and, if 'pending_' is true,
+    // an event recorded on it after that use.
+    cudaStream_t stream_;
+    cudaEvent_t event_;
+    bool pending_;
+  };
+
+  struct DeviceMemory {
+    // Free blocks, indexed by size class.
+    std::vector<std::vector<Block*>> free_blocks_;
+
+    uint64_t allocated_byte_size_ = 0;
+    uint64_t requested_byte_size_ = 0;
+    uint64_t cached_byte_size_ = 0;
+    uint64_t peak_allocated_byte_size_ = 0;
+    uint64_t device_alloc_count_ = 0;
+  };
+
+  CudaMemoryManager() = default;
+  static CudaMemoryManager* GetSingleton();
+
+  // Return the index of the smallest size class that can hold 'size'
+  // bytes.
+  static size_t SizeClass(uint64_t size);
+
+  // Return a cached block of 'size_class' on 'device' that can be used
+  // by 'stream', or nullptr if there is none.
+  Block* ReuseBlock(
+      DeviceMemory* device, size_t size_class, cudaStream_t stream);
+
+  // Release the device memory of 'block' and delete it.
+  static void DestroyBlock(Block* block);
+
+  std::mutex mu_;
+  std::map<int64_t, DeviceMemory> devices_;
+  std::unordered_map<void*, Block*> allocated_blocks_;
+};
+
+}}  // namespace nvidia::inferenceserver
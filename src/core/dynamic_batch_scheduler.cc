@@ -31,27 +31,135 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <algorithm>
+#include <map>
 #include "src/core/constants.h"
 #include "src/core/logging.h"
+#include "src/core/metrics.h"
 #include "src/core/model_config.h"
+#include "src/core/nvtx.h"
 #include "src/core/provider.h"
 #include "src/core/server_status.h"
 
 namespace nvidia { namespace inferenceserver {
 
+namespace {
+
+// The number of batches currently executing on each GPU. This is
+// counted across all models that use dynamic batching so that a GPU
+// shared with another model is seen as busy.
+constexpr int kMaxTrackedGpuDevices = 64;
+std::atomic<uint32_t> gpu_executing_batch_cnt[kMaxTrackedGpuDevices];
+
+uint32_t
+GpuLoad(const int gpu_device)
+{
+  if ((gpu_device < 0) || (gpu_device >= kMaxTrackedGpuDevices)) {
+    return 0;
+  }
+
+  return gpu_executing_batch_cnt[gpu_device].load();
+}
+
+void
+GpuBatchStarted(const int gpu_device)
+{
+  if ((gpu_device >= 0) && (gpu_device < kMaxTrackedGpuDevices)) {
+    gpu_executing_batch_cnt[gpu_device]++;
+  }
+}
+
+void
+GpuBatchCompleted(const int gpu_device)
+{
+  if ((gpu_device >= 0) && (gpu_device < kMaxTrackedGpuDevices)) {
+    gpu_executing_batch_cnt[gpu_device]--;
+  }
+}
+
+// Move the payloads of cancelled requests from 'payloads' to
+// 'cancelled', keeping the order of the others, and return the total
+// batch size of the moved payloads.
+size_t
+RemoveCancelled(
+    std::vector<Scheduler::Payload>* payloads,
+    std::vector<Scheduler::Payload>* cancelled)
+{
+  std::vector<size_t> cancelled_idxs;
+  for (size_t idx = 0; idx < payloads->size(); ++idx) {
+    if ((*payloads)[idx].request_provider_->IsCancelled()) {
+      cancelled_idxs.push_back(idx);
+    }
+  }
+
+  if (cancelled_idxs.empty()) {
+    return 0;
+  }
+
+  size_t cancelled_batch_size = 0;
+  std::vector<Scheduler::Payload> remaining;
+  auto citr = cancelled_idxs.begin();
+  for (size_t idx = 0; idx < payloads->size(); ++idx) {
+    auto& payload = (*payloads)[idx];
+    if ((citr != cancelled_idxs.end()) && (*citr == idx)) {
+      cancelled_batch_size +=
+          payload.request_provider_->RequestHeader().batch_size();
+      cancelled->emplace_back(std::move(payload));
+      ++citr;
+    } else {
+      remaining.emplace_back(std::move(payload));
+    }
+  }
+
+  payloads->swap(remaining);
+  return cancelled_batch_size;
+}
+
+}  // namespace
+
 DynamicBatchScheduler::DynamicBatchScheduler(
     const ModelConfig& config, const uint32_t runner_cnt,
-    StandardInitFunc OnInit, StandardRunFunc OnSchedule)
-    : OnInit_(OnInit), OnSchedule_(OnSchedule),
-      scheduler_thread_cnt_(runner_cnt), idle_scheduler_thread_cnt_(0),
-      pending_batch_size_(0), pending_batch_queue_cnt_(0)
+    const uint32_t first_runner_id, const uint32_t thread_cnt,
+    StandardInitFunc OnInit, StandardRunFunc OnSchedule,
+    StandardReleaseFunc OnRelease)
+    : OnInit_(OnInit), OnSchedule_(OnSchedule), OnRelease_(OnRelease),
+      scheduler_thread_cnt_(thread_cnt), first_runner_id_(first_runner_id),
+      idle_scheduler_thread_cnt_(0),
+      queued_cnt_(0), default_priority_level_(1), pending_request_cnt_(0),
+      max_queue_size_(0), default_queue_timeout_ns_(0),
+      next_timeout_ns_(UINT64_MAX), drain_deadline_ns_(UINT64_MAX),
+      timer_deadline_ns_(UINT64_MAX),
+      timer_generation_(0), adaptive_queue_delay_(false),
+      target_latency_ns_(0), max_queue_delay_ns_(0),
+      arrival_window_start_ns_(0), arrival_window_cnt_(0), arrival_rate_(0),
+      autoscaling_(false), min_active_runner_cnt_(runner_cnt),
+      active_runner_cnt_(runner_cnt), scale_up_queue_depth_(0),
+      scale_up_delay_ns_(0), scale_down_idle_ns_(0), deep_queue_since_ns_(0),
+      learn_preferred_batch_size_(false), exec_updated_(false),
+      next_instance_(0), parent_(nullptr)
 {
   dynamic_batching_enabled_ = config.has_dynamic_batching();
   scheduler_threads_exit_.store(false);
 
+  // Find the GPU and host CPUs of each runner. Work is only directed
+  // based on GPU load if the runners use more than one GPU.
+  std::vector<RunnerPlacement> placements;
+  GetRunnerPlacements(config, runner_cnt, &placements);
+
+  std::set<int> gpu_devices;
+  for (const auto& placement : placements) {
+    runners_.emplace_back(new RunnerState(placement));
+    if (placement.gpu_device_ >= 0) {
+      gpu_devices.insert(placement.gpu_device_);
+    }
+  }
+  load_aware_ = (gpu_devices.size() > 1);
+
   // Need to keep track of input tensor shapes if the model allows one
   // or more variable-size input tensors. Requests to the same model
-  // can't be batched if any of the inputs have different shape.
+  // can't be batched if any of the inputs have different shape. Inputs
+  // with padding are padded to their length bucket before the request
+  // is scheduled, so such requests are batched by bucket.
   need_pending_shape_ = false;
   for (const auto input : config.input()) {
     if (GetElementCount(input) == -1) {
@@ -61,6 +169,7 @@ DynamicBatchScheduler::DynamicBatchScheduler(
   }
 
   max_preferred_batch_size_ = 0;
+  queue_batch_size_ = 0;
   preferred_batch_sizes_.clear();
   pending_batch_delay_ns_ = 0;
 
@@ -70,9 +179,78 @@ DynamicBatchScheduler::DynamicBatchScheduler(
           std::max(max_preferred_batch_size_, (size_t)size);
       preferred_batch_sizes_.insert(size);
     }
+    queue_batch_size_ = (max_preferred_batch_size_ != 0)
+                            ? max_preferred_batch_size_
+                            : std::max(0, config.max_batch_size());
 
     pending_batch_delay_ns_ =
         config.dynamic_batching().max_queue_delay_microseconds() * 1000;
+
+    // Model configuration normalization and validation ensure that the
+    // default level is in range when priority levels are enabled.
+    if (config.dynamic_batching().priority_levels() > 0) {
+      priority_queues_.resize(config.dynamic_batching().priority_levels());
+      default_priority_level_ =
+          config.dynamic_batching().default_priority_level();
+    }
+
+    max_queue_size_ = config.dynamic_batching().max_queue_size();
+    default_queue_timeout_ns_ =
+        config.dynamic_batching().default_queue_timeout_microseconds() * 1000;
+
+    // The configured queue delay is used until enough has been
+    // observed to adjust it. If a maximum delay isn't configured the
+    // latency budget is the only bound on the delay.
+    if (config.dynamic_batching().has_adaptive_queue_delay()) {
+      adaptive_queue_delay_ = true;
+      target_latency_ns_ = config.dynamic_batching()
+                               .adaptive_queue_delay()
+                               .target_latency_microseconds() *
+                           1000;
+      max_queue_delay_ns_ = (pending_batch_delay_ns_ != 0)
+                                ? pending_batch_delay_ns_
+                                : target_latency_ns_;
+    }
+
+    // When learning the preferred batch sizes, batches up to the
+    // maximum batch size are allowed so that sizes larger than the
+    // configured preferred sizes can be measured.
+    if (config.dynamic_batching().learn_preferred_batch_size()) {
+      learn_preferred_batch_size_ = true;
+      configured_preferred_batch_sizes_ = preferred_batch_sizes_;
+      max_preferred_batch_size_ = std::max(
+          max_preferred_batch_size_, (size_t)config.max_batch_size());
+    }
+
+    if (adaptive_queue_delay_ || learn_preferred_batch_size_) {
+      exec_ns_.resize(max_preferred_batch_size_ + 1, 0);
+    }
+
+    // With instance autoscaling only the minimum number of runners are
+    // active at first, the others are activated as the queue deepens.
+    if (config.dynamic_batching().has_instance_autoscaling()) {
+      const auto& scaling = config.dynamic_batching().instance_autoscaling();
+      autoscaling_ = true;
+      min_active_runner_cnt_ =
+          std::min(runner_cnt, std::max(1u, scaling.min_instance_count()));
+      active_runner_cnt_ = min_active_runner_cnt_;
+      scale_up_queue_depth_ = (scaling.scale_up_queue_depth() != 0)
+                                  ? scaling.scale_up_queue_depth()
+                                  : std::max(1, config.max_batch_size());
+      scale_up_delay_ns_ = scaling.scale_up_delay_microseconds() * 1000;
+      scale_down_idle_ns_ =
+          ((scaling.scale_down_idle_microseconds() != 0)
+               ? scaling.scale_down_idle_microseconds()
+               : 60 * 1000 * 1000) *
+          1000;
+      for (uint32_t r = min_active_runner_cnt_; r < runners_.size(); ++r) {
+        runners_[r]->active_ = false;
+      }
+    }
+  }
+
+  if (priority_queues_.empty()) {
+    priority_queues_.resize(1);
   }
 }
 
@@ -80,50 +258,128 @@ Status
 DynamicBatchScheduler::Create(
     const ModelConfig& config, const uint32_t runner_cnt,
     StandardInitFunc OnInit, StandardRunFunc OnSchedule,
+    StandardReleaseFunc OnRelease,
+    const std::shared_ptr<MetricModelReporter>& metric_reporter,
     std::unique_ptr<Scheduler>* scheduler)
 {
-  DynamicBatchScheduler* dyna_sched =
-      new DynamicBatchScheduler(config, runner_cnt, OnInit, OnSchedule);
-  std::unique_ptr<DynamicBatchScheduler> sched(dyna_sched);
+  // With instance queues each runner has its own scheduler, which
+  // forms batches from its own queue, and the returned scheduler only
+  // directs requests to them. The queue size limit is divided among
+  // the instances.
+  if (config.dynamic_batching().instance_queues() && (runner_cnt > 1)) {
+    std::unique_ptr<DynamicBatchScheduler> sched(new DynamicBatchScheduler(
+        config, runner_cnt, 0 /* first_runner_id */, 0 /* thread_cnt */,
+        OnInit, OnSchedule, OnRelease));
+    const uint64_t max_queue_size = config.dynamic_batching().max_queue_size();
+    for (uint32_t c = 0; c < runner_cnt; ++c) {
+      std::unique_ptr<DynamicBatchScheduler> instance(
+          new DynamicBatchScheduler(
+              config, runner_cnt, c /* first_runner_id */, 1 /* thread_cnt */,
+              OnInit, OnSchedule, OnRelease));
+      instance->parent_ = sched.get();
+      instance->max_queue_size_ =
+          (max_queue_size + runner_cnt - 1) / runner_cnt;
+      sched->instance_schedulers_.emplace_back(std::move(instance));
+    }
+
+    // Idle threads steal from the other instances so every instance
+    // must exist before any thread starts. An instance whose runner
+    // fails to initialize is never sent requests.
+    bool started = false;
+    for (auto& instance : sched->instance_schedulers_) {
+      if (instance->StartThreads(config, metric_reporter).IsOk()) {
+        started = true;
+      }
+    }
+    if (!started) {
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "Initialization failed for all dynamic-batch scheduler threads");
+    }
+
+    scheduler->reset(sched.release());
+    return Status::Success;
+  }
+
+  std::unique_ptr<DynamicBatchScheduler> sched(new DynamicBatchScheduler(
+      config, runner_cnt, 0 /* first_runner_id */, runner_cnt, OnInit,
+      OnSchedule, OnRelease));
+  RETURN_IF_ERROR(sched->StartThreads(config, metric_reporter));
+
+  scheduler->reset(sched.release());
+
+  return Status::Success;
+}
+
+Status
+DynamicBatchScheduler::StartThreads(
+    const ModelConfig& config,
+    const std::shared_ptr<MetricModelReporter>& metric_reporter)
+{
+#ifdef TRTIS_ENABLE_METRICS
+  metric_reporter_ = metric_reporter;
+  metric_queue_length_ = nullptr;
+  metric_exec_batch_size_ = nullptr;
+  if (metric_reporter != nullptr) {
+    metric_queue_length_ = &metric_reporter->MetricQueueLength();
+    for (uint32_t c = 0; c < runners_.size(); ++c) {
+      metric_inflight_executions_.push_back(
+          &metric_reporter->MetricInflightExecutions(c));
+    }
+    metric_exec_batch_size_ =
+        &metric_reporter->MetricExecutionBatchSize(config.max_batch_size());
+  }
+#endif  // TRTIS_ENABLE_METRICS
 
   // Create one scheduler thread for each requested runner. Associate
   // each scheduler thread with a runner.
   const int nice = GetCpuNiceLevel(config);
-  for (uint32_t c = 0; c < sched->scheduler_thread_cnt_; ++c) {
+  for (uint32_t c = 0; c < scheduler_thread_cnt_; ++c) {
+    const uint32_t runner_id = first_runner_id_ + c;
     std::promise<bool> init_state;
-    sched->scheduler_threads_.emplace_back(
-        new std::thread([dyna_sched, c, nice, &init_state]() {
-          dyna_sched->SchedulerThread(c, nice, &init_state);
+    scheduler_threads_.emplace_back(
+        new std::thread([this, runner_id, nice, &init_state]() {
+          SchedulerThread(runner_id, nice, &init_state);
         }));
     if (!init_state.get_future().get()) {
-      if (sched->scheduler_threads_.back()->joinable()) {
-        sched->scheduler_threads_.back()->join();
+      if (scheduler_threads_.back()->joinable()) {
+        scheduler_threads_.back()->join();
       }
-      sched->scheduler_threads_.pop_back();
+      scheduler_threads_.pop_back();
     }
   }
-  if (sched->scheduler_threads_.empty()) {
+  if (scheduler_threads_.empty()) {
     return Status(
         RequestStatusCode::INTERNAL,
         "Initialization failed for all dynamic-batch scheduler threads");
   }
 
-  scheduler->reset(sched.release());
-
   return Status::Success;
 }
 
 DynamicBatchScheduler::~DynamicBatchScheduler()
 {
-  // Signal the scheduler threads to exit and then wait for them...
-  {
-    std::unique_lock<std::mutex> lock(mu_);
-    scheduler_threads_exit_.store(true);
-    cv_.notify_all();
+  // Signal the scheduler threads to exit and then wait for them. The
+  // threads of all instances must exit before any instance is
+  // destroyed because idle threads steal from the other instances.
+  std::vector<DynamicBatchScheduler*> scheds{this};
+  for (auto& instance : instance_schedulers_) {
+    scheds.push_back(instance.get());
   }
 
-  for (auto& thd : scheduler_threads_) {
-    thd->join();
+  for (auto sched : scheds) {
+    std::unique_lock<std::mutex> lock(sched->mu_);
+    sched->scheduler_threads_exit_.store(true);
+    for (auto& runner : sched->runners_) {
+      runner->cv_.notify_all();
+    }
+  }
+
+  for (auto sched : scheds) {
+    for (auto& thd : sched->scheduler_threads_) {
+      thd->join();
+    }
+    sched->scheduler_threads_.clear();
   }
 }
 
@@ -134,23 +390,141 @@ DynamicBatchScheduler::Enqueue(
     const std::shared_ptr<InferResponseProvider>& response_provider,
     std::function<void(const Status&)> OnComplete)
 {
+  // With instance queues the request is queued by the least loaded
+  // instance.
+  if (!instance_schedulers_.empty()) {
+    instance_schedulers_[LeastLoadedInstance(nullptr)]->Enqueue(
+        stats, request_provider, response_provider, OnComplete);
+    return;
+  }
+
+  NVTX_RANGE(nvtx_, "DynamicBatchScheduler enqueue");
+
   // Queue timer starts at the beginning of the queueing and
   // scheduling process
   stats->CaptureTimestamp(ModelInferStats::TimestampKind::kQueueStart);
 
-  bool wake_runner = false;
-  {
-    std::lock_guard<std::mutex> lock(mu_);
-    queue_.emplace_back(stats, request_provider, response_provider, OnComplete);
+  // Reject the request immediately if the queue is full so that the
+  // server degrades gracefully when overloaded.
+  const uint64_t pending_cnt = pending_request_cnt_++;
+  if ((max_queue_size_ != 0) && (pending_cnt >= max_queue_size_)) {
+    pending_request_cnt_--;
+    OnComplete(Status(
+        RequestStatusCode::UNAVAILABLE,
+        "Exceeds maximum queue size for '" +
+            request_provider->ModelName() + "'"));
+    return;
+  }
 
-    // If there are any idle runners then wake one up to service this
-    // request. We do the actual wake outside of the lock to avoid
-    // having the woken thread immediately block on the lock
-    wake_runner = (idle_scheduler_thread_cnt_ > 0);
+#ifdef TRTIS_ENABLE_METRICS
+  if (metric_queue_length_ != nullptr) {
+    metric_queue_length_->Increment();
   }
+#endif  // TRTIS_ENABLE_METRICS
 
-  if (wake_runner) {
-    cv_.notify_one();
+  intake_.Push(Scheduler::Payload(
+      stats, request_provider, response_provider, OnComplete));
+
+  // If there are any idle runners then wake one up to service this
+  // request. An idle runner increments 'idle_scheduler_thread_cnt_'
+  // and checks 'intake_' while holding 'mu_' and only then waits, so
+  // acquiring 'mu_' here guarantees that a runner that didn't see
+  // this request is already waiting and so receives the
+  // notification. We do the actual wake outside of the lock to avoid
+  // having the woken thread immediately block on the lock.
+  if (idle_scheduler_thread_cnt_ > 0) {
+    std::condition_variable* wake_cv = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      wake_cv = ClaimIdleRunner(nullptr);
+    }
+    if (wake_cv != nullptr) {
+      wake_cv->notify_one();
+    }
+  }
+}
+
+void
+DynamicBatchScheduler::EnqueueBatch(std::vector<Scheduler::Payload>* payloads)
+{
+  // With instance queues the requests are spread across the instances
+  // as if each was enqueued in turn.
+  if (!instance_schedulers_.empty()) {
+    std::vector<std::vector<Scheduler::Payload>> assigned(
+        instance_schedulers_.size());
+    std::vector<size_t> assigned_cnts(instance_schedulers_.size(), 0);
+    for (auto& payload : *payloads) {
+      const size_t idx = LeastLoadedInstance(&assigned_cnts);
+      assigned[idx].emplace_back(std::move(payload));
+      assigned_cnts[idx]++;
+    }
+    for (size_t idx = 0; idx < assigned.size(); ++idx) {
+      if (!assigned[idx].empty()) {
+        instance_schedulers_[idx]->EnqueueBatch(&assigned[idx]);
+      }
+    }
+    return;
+  }
+
+  NVTX_RANGE(nvtx_, "DynamicBatchScheduler enqueue batch");
+
+  // Reject the requests that don't fit in the queue, the others are
+  // pushed to the intake together.
+  std::vector<Scheduler::Payload> accepted;
+  accepted.reserve(payloads->size());
+  for (auto& payload : *payloads) {
+    payload.stats_->CaptureTimestamp(
+        ModelInferStats::TimestampKind::kQueueStart);
+
+    const uint64_t pending_cnt = pending_request_cnt_++;
+    if ((max_queue_size_ != 0) && (pending_cnt >= max_queue_size_)) {
+      pending_request_cnt_--;
+      payload.complete_function_(Status(
+          RequestStatusCode::UNAVAILABLE,
+          "Exceeds maximum queue size for '" +
+              payload.request_provider_->ModelName() + "'"));
+      continue;
+    }
+
+    accepted.emplace_back(std::move(payload));
+  }
+
+  if (accepted.empty()) {
+    return;
+  }
+
+#ifdef TRTIS_ENABLE_METRICS
+  if (metric_queue_length_ != nullptr) {
+    metric_queue_length_->Increment(accepted.size());
+  }
+#endif  // TRTIS_ENABLE_METRICS
+
+  // Wake an idle runner for each batch of the maximum preferred size
+  // that the requests can fill, or for each request if there are no
+  // preferred sizes. See Enqueue() for why 'mu_' is acquired.
+  size_t wake_cnt = accepted.size();
+  if (dynamic_batching_enabled_ && (max_preferred_batch_size_ > 1)) {
+    wake_cnt = (wake_cnt + max_preferred_batch_size_ - 1) /
+               max_preferred_batch_size_;
+  }
+
+  intake_.PushAll(&accepted);
+
+  if (idle_scheduler_thread_cnt_ > 0) {
+    std::vector<std::condition_variable*> wake_cvs;
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      while (wake_cvs.size() < wake_cnt) {
+        std::condition_variable* wake_cv = ClaimIdleRunner(nullptr);
+        if (wake_cv == nullptr) {
+          break;
+        }
+        wake_cvs.push_back(wake_cv);
+      }
+    }
+    for (auto wake_cv : wake_cvs) {
+      wake_cv->notify_one();
+    }
   }
 }
 
@@ -168,18 +542,49 @@ DynamicBatchScheduler::SchedulerThread(
                    << " failed)...";
   }
 
+  // Run near the runner's GPU so that the host side of the
+  // execution, including any staging buffers first touched by this
+  // thread, stays on the GPU's NUMA node.
+  RunnerState* runner = runners_[runner_id].get();
+  Status affinity_status = SetThreadCpuAffinity(runner->host_cpus_);
+  if (!affinity_status.IsOk()) {
+    LOG_ERROR << "Failed to set CPU affinity for dynamic-batch scheduler "
+              << "thread " << runner_id << ": " << affinity_status.Message();
+  }
+
+#ifdef TRTIS_ENABLE_METRICS
+  if (metric_reporter_ != nullptr) {
+    Metrics::RegisterThread("scheduler", metric_reporter_->ModelName());
+  }
+#endif  // TRTIS_ENABLE_METRICS
+
   // Initialize using the thread. If error then just exit this thread
   // now... that means the corresponding model instance will not have
-  // any runner and so will not get used for execution.
-  Status init_status = OnInit_(runner_id);
-  if (!init_status.IsOk()) {
-    LOG_ERROR << "Initialization failed for dynamic-batch scheduler thread "
-              << runner_id << ": " << init_status.Message();
-    is_initialized->set_value(false);
-    return;
-  } else {
-    is_initialized->set_value(true);
+  // any runner and so will not get used for execution. A runner that
+  // is not active is only initialized once it is activated.
+  bool active;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    active = runner->active_;
+  }
+  bool initialized = false;
+  if (active) {
+    Status init_status = OnInit_(runner_id);
+    if (!init_status.IsOk()) {
+      LOG_ERROR << "Initialization failed for dynamic-batch scheduler thread "
+                << runner_id << ": " << init_status.Message();
+      {
+        std::lock_guard<std::mutex> lock(mu_);
+        runner->active_ = false;
+        runner->failed_ = true;
+        active_runner_cnt_--;
+      }
+      is_initialized->set_value(false);
+      return;
+    }
+    initialized = true;
   }
+  is_initialized->set_value(true);
 
   // For debugging/testing, delay start of threads until the queue
   // contains the specified number of entries.
@@ -191,38 +596,129 @@ DynamicBatchScheduler::SchedulerThread(
              << delay_cnt << " queued payloads...";
   }
 
-  const uint64_t default_wait_microseconds = 500 * 1000;
+  // With instance queues a thread that runs out of work tries once to
+  // steal from the other instances before it waits.
+  bool may_steal = (parent_ != nullptr);
 
   while (!scheduler_threads_exit_.load()) {
-    std::shared_ptr<std::vector<Scheduler::Payload>> payloads;
-    bool wake_thread = false;
+    // A runner that is not active waits until instance autoscaling
+    // activates it, and initializes again if it was released.
+    if (!active) {
+      {
+        std::unique_lock<std::mutex> lock(mu_);
+        runner->cv_.wait(lock, [this, runner] {
+          return runner->active_ || scheduler_threads_exit_.load();
+        });
+      }
+      if (scheduler_threads_exit_.load()) {
+        break;
+      }
+
+      if (!initialized) {
+        Status init_status = OnInit_(runner_id);
+        if (!init_status.IsOk()) {
+          LOG_ERROR << "Initialization failed for dynamic-batch scheduler "
+                    << "thread " << runner_id << ": "
+                    << init_status.Message();
+          std::lock_guard<std::mutex> lock(mu_);
+          runner->active_ = false;
+          runner->failed_ = true;
+          active_runner_cnt_--;
+          break;
+        }
+        initialized = true;
+      }
+
+      LOG_VERBOSE(1) << "Activated dynamic-batch scheduler thread "
+                     << runner_id;
+      active = true;
+    }
+
+    std::unique_ptr<ScheduledBatch> batch;
+    std::vector<Scheduler::Payload> rejected;
+    std::vector<Scheduler::Payload> cancelled;
+    std::condition_variable* wake_cv = nullptr;
+    std::condition_variable* activate_cv = nullptr;
+    bool steal = false;
+
+    // The time to wait before checking the queues again. UINT64_MAX
+    // indicates that there is no deadline and the thread should wait
+    // until it is notified of new work.
     uint64_t wait_microseconds = 0;
+    size_t batch_size = 0;
 
     // Hold the lock for as short a time as possible.
     {
       std::unique_lock<std::mutex> lock(mu_);
+      if (intake_.DrainTo(&arrivals_) > 0) {
+        for (auto& payload : arrivals_) {
+          QueuePayload(std::move(payload));
+        }
+        arrivals_.clear();
+      }
+
+      // Remove any requests that have waited longer than their queue
+      // timeout so that they are not executed.
+      struct timespec now;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      const uint64_t now_ns = TIMESPEC_TO_NANOS(now);
+      if (now_ns >= next_timeout_ns_) {
+        RejectTimedOut(now_ns, &rejected);
+      }
+
+      if (learn_preferred_batch_size_ && exec_updated_.exchange(false)) {
+        UpdatePreferredBatchSizes();
+      }
+
+      if (autoscaling_) {
+        activate_cv = ScaleUp(now_ns);
+      }
+
+      if (adaptive_queue_delay_) {
+        UpdateQueueDelay(now_ns);
+      }
+
       if (delay_cnt > 0) {
         // Debugging/testing... wait until queue contains 'delay_cnt'
         // items...
         wait_microseconds = 10 * 1000;
-        if (queue_.size() >= delay_cnt) {
+        if (queued_cnt_ >= delay_cnt) {
           delay_cnt = 0;
         }
-      } else if (queue_.empty()) {
-        wait_microseconds = default_wait_microseconds;
+      } else if ((queued_cnt_ == 0) && may_steal) {
+        // Steal once 'mu_' is released so that an instance never
+        // holds its lock while locking another instance.
+        steal = true;
+      } else if (queued_cnt_ == 0) {
+        wait_microseconds = UINT64_MAX;
       } else if (dynamic_batching_enabled_) {
         // Use dynamic batching to get request payload(s) to execute.
-        wait_microseconds = GetDynamicBatch();
-        if (wait_microseconds == 0) {
-          payloads = std::make_shared<std::vector<Scheduler::Payload>>();
-          for (size_t idx = 0; idx < pending_batch_queue_cnt_; ++idx) {
-            payloads->emplace_back(std::move(queue_.front()));
-            queue_.pop_front();
+        NVTX_RANGE(nvtx_, "DynamicBatchScheduler batch formation");
+        ShapeQueueMap* batch_queues = nullptr;
+        ShapeQueueMap::iterator batch_itr;
+        wait_microseconds =
+            GetDynamicBatch(now_ns, &batch_queues, &batch_itr);
+        if ((wait_microseconds == 0) && HandOff(runner, &wake_cv)) {
+          wait_microseconds = UINT64_MAX;
+        } else if (wait_microseconds == 0) {
+          ShapeQueue* batch_queue = &batch_itr->second;
+          batch = AcquireBatch();
+          for (size_t idx = 0; idx < batch_queue->pending_batch_queue_cnt_;
+               ++idx) {
+            batch->payloads_.emplace_back(
+                std::move(batch_queue->queue_.front()));
+            batch_queue->queue_.pop_front();
           }
 
-          pending_batch_size_ = 0;
-          pending_batch_queue_cnt_ = 0;
-          pending_batch_shapes_.clear();
+          queued_cnt_ -= batch_queue->pending_batch_queue_cnt_;
+          batch_size = batch_queue->pending_batch_size_;
+          batch_queue->ResetPendingBatch();
+
+          // Don't let queues for shapes that are no longer being
+          // requested accumulate.
+          if (need_pending_shape_ && batch_queue->queue_.empty()) {
+            batch_queues->erase(batch_itr);
+          }
 
           // If there are still requests in the queue after removing
           // the pending batch and if there are any idle threads then
@@ -233,51 +729,159 @@ DynamicBatchScheduler::SchedulerThread(
           // handling those requests. We do the actual wake outside of
           // the lock to avoid having the woken thread immediately
           // block on the lock.
-          wake_thread = !queue_.empty() && (idle_scheduler_thread_cnt_ > 0);
+          if ((queued_cnt_ > 0) && (idle_scheduler_thread_cnt_ > 0)) {
+            wake_cv = ClaimIdleRunner(nullptr);
+          }
         }
+      } else if (HandOff(runner, &wake_cv)) {
+        wait_microseconds = UINT64_MAX;
       } else {
         // No batching... execute next request payload
-        payloads = std::make_shared<std::vector<Scheduler::Payload>>();
-        payloads->emplace_back(std::move(queue_.front()));
-        queue_.pop_front();
+        auto& queue = priority_queues_[0][""].queue_;
+        batch = AcquireBatch();
+        batch->payloads_.emplace_back(std::move(queue.front()));
+        queue.pop_front();
+        queued_cnt_--;
       }
 
-      // If no requests are to be handled, wait for notification or
-      // for the specified timeout before checking the queue again.
+      if (batch != nullptr) {
+        pending_request_cnt_ -= batch->payloads_.size();
+#ifdef TRTIS_ENABLE_METRICS
+        if (metric_queue_length_ != nullptr) {
+          metric_queue_length_->Decrement(batch->payloads_.size());
+        }
+#endif  // TRTIS_ENABLE_METRICS
+
+        // Don't execute the requests that were cancelled while they
+        // were queued, for example because the client disconnected.
+        const size_t cancelled_batch_size =
+            RemoveCancelled(&batch->payloads_, &cancelled);
+        batch_size -= std::min(batch_size, cancelled_batch_size);
+      }
+
+      // Don't wait past the time when the next queued request times
+      // out.
+      if ((wait_microseconds > 0) && (next_timeout_ns_ != UINT64_MAX)) {
+        const uint64_t timeout_microseconds =
+            (next_timeout_ns_ > now_ns) ? (next_timeout_ns_ - now_ns) / 1000
+                                        : 0;
+        wait_microseconds = std::max(
+            (uint64_t)1, std::min(wait_microseconds, timeout_microseconds));
+      }
+
+      // Requests that arrived after 'intake_' was drained above
+      // haven't been considered yet so check for those before
+      // waiting.
       if (wait_microseconds > 0) {
+        runner->idle_ = true;
         idle_scheduler_thread_cnt_++;
-        std::chrono::microseconds wait_timeout(wait_microseconds);
-        cv_.wait_for(lock, wait_timeout);
-        idle_scheduler_thread_cnt_--;
+        if (intake_.Empty()) {
+          if (delay_cnt > 0) {
+            std::chrono::microseconds wait_timeout(wait_microseconds);
+            runner->cv_.wait_for(lock, wait_timeout);
+          } else if ((wait_microseconds == UINT64_MAX) && CanScaleDown()) {
+            // Deactivate the runner if it stays idle, and no work
+            // arrives, for the scale-down period.
+            std::chrono::nanoseconds wait_timeout(scale_down_idle_ns_);
+            if ((runner->cv_.wait_for(lock, wait_timeout) ==
+                 std::cv_status::timeout) &&
+                runner->idle_ && (queued_cnt_ == 0) && intake_.Empty() &&
+                CanScaleDown()) {
+              runner->active_ = false;
+              active_runner_cnt_--;
+              active = false;
+            }
+          } else {
+            WaitForWork(runner, &lock, now_ns, wait_microseconds);
+          }
+        }
+
+        // A runner that was woken by another thread has already been
+        // removed from the idle runners.
+        if (runner->idle_) {
+          runner->idle_ = false;
+          idle_scheduler_thread_cnt_--;
+        }
+        may_steal = (parent_ != nullptr);
+      }
+    }
+
+    if (wake_cv != nullptr) {
+      wake_cv->notify_one();
+    }
+    if (activate_cv != nullptr) {
+      activate_cv->notify_one();
+    }
+
+    // Release the resources of a runner that was deactivated, they are
+    // acquired again when it is next activated.
+    if (!active) {
+      LOG_VERBOSE(1) << "Deactivated dynamic-batch scheduler thread "
+                     << runner_id;
+      if (OnRelease_ != nullptr) {
+        OnRelease_(runner_id);
+        initialized = false;
       }
+      continue;
     }
 
-    if (wake_thread) {
-      cv_.notify_one();
+    for (auto& payload : rejected) {
+      if (payload.complete_function_ != nullptr) {
+        payload.complete_function_(Status(
+            RequestStatusCode::UNAVAILABLE,
+            "Request timeout expired for '" +
+                payload.request_provider_->ModelName() + "'"));
+      }
     }
 
-    if ((payloads != nullptr) && !payloads->empty()) {
-      auto OnCompleteQueuedPayloads = [payloads](const Status& status) {
-        bool found_success = false;
-        for (auto& payload : *payloads) {
-          Status final_status = status.IsOk() ? payload.status_ : status;
+    for (auto& payload : cancelled) {
+      if (payload.complete_function_ != nullptr) {
+        payload.complete_function_(Status(
+            RequestStatusCode::UNAVAILABLE,
+            "Request cancelled for '" + payload.request_provider_->ModelName() +
+                "'"));
+      }
+    }
 
-          // All the payloads executed together, so count 1 execution in
-          // the first successful payload. Other payloads stay at 0
-          // executions.
-          if (!found_success && final_status.IsOk() &&
-              (payload.stats_ != nullptr)) {
-            payload.stats_->SetModelExecutionCount(1);
-            found_success = true;
-          }
+    if ((batch != nullptr) && !batch->payloads_.empty()) {
+      // When adjusting the queue delay or learning the preferred
+      // batch sizes, record the compute time of the batch as
+      // measured by the backend.
+      batch->batch_size_ = batch_size;
+      batch->record_execution_ = (batch_size > 0) && !exec_ns_.empty();
+      batch->gpu_device_ = runner->gpu_device_;
+      batch->runner_id_ = runner_id;
+      GpuBatchStarted(batch->gpu_device_);
 
-          if (payload.complete_function_ != nullptr) {
-            payload.complete_function_(final_status);
-          }
+#ifdef TRTIS_ENABLE_METRICS
+      if (metric_reporter_ != nullptr) {
+        size_t exec_batch_size = 0;
+        for (const auto& payload : batch->payloads_) {
+          exec_batch_size +=
+              payload.request_provider_->RequestHeader().batch_size();
         }
+        metric_exec_batch_size_->Observe(exec_batch_size);
+        metric_inflight_executions_[runner_id]->Increment();
+      }
+#endif  // TRTIS_ENABLE_METRICS
+
+      // The batch is returned to the pool when it completes. Capture
+      // only pointers so that the completion function doesn't need to
+      // allocate.
+      ScheduledBatch* scheduled = batch.release();
+      auto OnCompleteQueuedPayloads = [this, scheduled](const Status& status) {
+        CompleteBatch(scheduled, status);
       };
 
-      OnSchedule_(runner_id, payloads.get(), OnCompleteQueuedPayloads);
+      NVTX_RANGE(nvtx_, "DynamicBatchScheduler execute");
+      OnSchedule_(runner_id, &scheduled->payloads_, OnCompleteQueuedPayloads);
+    } else if (batch != nullptr) {
+      ReleaseBatch(batch.release());
+    }
+
+    // If nothing was stolen wait for work the next time around.
+    if (steal) {
+      may_steal = parent_->StealWork(this);
     }
   }  // end runner loop
 
@@ -285,86 +889,627 @@ DynamicBatchScheduler::SchedulerThread(
                  << "...";
 }
 
+std::unique_ptr<DynamicBatchScheduler::ScheduledBatch>
+DynamicBatchScheduler::AcquireBatch()
+{
+  std::unique_ptr<ScheduledBatch> batch;
+  {
+    std::lock_guard<std::mutex> lock(batch_pool_mu_);
+    if (!batch_pool_.empty()) {
+      batch = std::move(batch_pool_.back());
+      batch_pool_.pop_back();
+    }
+  }
+
+  if (batch == nullptr) {
+    batch.reset(new ScheduledBatch());
+  }
+
+  return batch;
+}
+
 void
-DynamicBatchScheduler::InitPendingShape(const InferRequestHeader& request)
+DynamicBatchScheduler::ReleaseBatch(ScheduledBatch* batch)
 {
-  pending_batch_shapes_.clear();
+  // Clearing the payloads keeps the capacity of the vector so that
+  // the recycled batch can be filled without allocating.
+  batch->payloads_.clear();
 
-  for (const auto& input : request.input()) {
-    pending_batch_shapes_.emplace(std::make_pair(input.name(), input.dims()));
+  std::lock_guard<std::mutex> lock(batch_pool_mu_);
+  batch_pool_.emplace_back(batch);
+}
+
+void
+DynamicBatchScheduler::CompleteBatch(
+    ScheduledBatch* batch, const Status& status)
+{
+  GpuBatchCompleted(batch->gpu_device_);
+#ifdef TRTIS_ENABLE_METRICS
+  if (metric_reporter_ != nullptr) {
+    metric_inflight_executions_[batch->runner_id_]->Decrement();
+  }
+#endif  // TRTIS_ENABLE_METRICS
+  if (batch->record_execution_ && status.IsOk()) {
+    RecordExecution(batch->batch_size_, batch->payloads_);
   }
+
+  bool found_success = false;
+  for (auto& payload : batch->payloads_) {
+    Status final_status = status.IsOk() ? payload.status_ : status;
+
+    // All the payloads executed together, so count 1 execution in
+    // the first successful payload. Other payloads stay at 0
+    // executions.
+    if (!found_success && final_status.IsOk() &&
+        (payload.stats_ != nullptr)) {
+      payload.stats_->SetModelExecutionCount(1);
+      found_success = true;
+    }
+
+    if (payload.complete_function_ != nullptr) {
+      payload.complete_function_(final_status);
+    }
+  }
+
+  ReleaseBatch(batch);
+}
+
+std::condition_variable*
+DynamicBatchScheduler::ClaimIdleRunner(const RunnerState* busier_than)
+{
+  // 'mu_' mutex must be held when this function is called.
+
+  // Choose the idle runner whose GPU has the least executing work. If
+  // 'busier_than' is given, only a runner whose GPU is less loaded
+  // than the GPU of that runner is chosen. The chosen runner is
+  // removed from the idle runners so that it isn't chosen again
+  // before it wakes.
+  RunnerState* chosen = nullptr;
+  uint32_t chosen_load = UINT32_MAX;
+  if (busier_than != nullptr) {
+    chosen_load = GpuLoad(busier_than->gpu_device_);
+  }
+
+  for (auto& runner : runners_) {
+    if (!runner->idle_) {
+      continue;
+    }
+    if (!load_aware_) {
+      chosen = runner.get();
+      break;
+    }
+
+    const uint32_t load = GpuLoad(runner->gpu_device_);
+    if ((runner->gpu_device_ >= 0) && (load < chosen_load)) {
+      chosen = runner.get();
+      chosen_load = load;
+    } else if ((chosen == nullptr) && (busier_than == nullptr)) {
+      chosen = runner.get();
+    }
+  }
+
+  if (chosen == nullptr) {
+    return nullptr;
+  }
+
+  chosen->idle_ = false;
+  idle_scheduler_thread_cnt_--;
+  return &chosen->cv_;
 }
 
 bool
-DynamicBatchScheduler::CompareWithPendingShape(
-    const InferRequestHeader& request) const
+DynamicBatchScheduler::HandOff(
+    const RunnerState* runner, std::condition_variable** wake_cv)
 {
-  for (const auto& input : request.input()) {
-    const auto itr = pending_batch_shapes_.find(input.name());
+  // 'mu_' mutex must be held when this function is called.
+
+  // A runner whose GPU is busy leaves a ready batch to an idle runner
+  // on a less loaded GPU, if there is one, instead of executing it
+  // itself.
+  if (!load_aware_ || (runner->gpu_device_ < 0) ||
+      (GpuLoad(runner->gpu_device_) == 0) ||
+      (idle_scheduler_thread_cnt_ == 0)) {
+    return false;
+  }
+
+  *wake_cv = ClaimIdleRunner(runner);
+  return (*wake_cv != nullptr);
+}
+
+void
+DynamicBatchScheduler::WaitForWork(
+    RunnerState* runner, std::unique_lock<std::mutex>* lock,
+    const uint64_t now_ns, const uint64_t wait_microseconds)
+{
+  // 'mu_' mutex must be held, via 'lock', when this function is
+  // called.
+
+  // At most one idle thread waits for the earliest deadline, either
+  // the expiration of a pending batch's queue delay or a queued
+  // request's timeout. All other idle threads wait until they are
+  // notified, either by Enqueue() or by a thread that leaves requests
+  // in the queue after taking a batch, so that a deadline wakes
+  // exactly one thread instead of every idle thread polling the
+  // queues.
+  if (wait_microseconds != UINT64_MAX) {
+    const uint64_t deadline_ns = now_ns + (wait_microseconds * 1000);
+    if (deadline_ns < timer_deadline_ns_) {
+      timer_deadline_ns_ = deadline_ns;
+      const uint64_t generation = ++timer_generation_;
+
+      std::chrono::microseconds wait_timeout(wait_microseconds);
+      runner->cv_.wait_for(*lock, wait_timeout);
+
+      // Another thread may have taken over the deadline with an
+      // earlier one while this thread was waiting, in which case
+      // leave it to that thread.
+      if (timer_generation_ == generation) {
+        timer_deadline_ns_ = UINT64_MAX;
+      }
+      return;
+    }
+  }
+
+  runner->cv_.wait(*lock);
+}
+
+std::condition_variable*
+DynamicBatchScheduler::ScaleUp(const uint64_t now_ns)
+{
+  // 'mu_' mutex must be held when this function is called.
+
+  // Activate another runner once the queue has been too deep for the
+  // active runners for the scale-up delay. The delay then starts
+  // again so that runners are activated one at a time.
+  if ((active_runner_cnt_ >= runners_.size()) ||
+      (queued_cnt_ <= active_runner_cnt_ * scale_up_queue_depth_)) {
+    deep_queue_since_ns_ = 0;
+    return nullptr;
+  }
+
+  if (deep_queue_since_ns_ == 0) {
+    deep_queue_since_ns_ = now_ns;
+  }
+  if ((now_ns - deep_queue_since_ns_) < scale_up_delay_ns_) {
+    return nullptr;
+  }
+
+  for (auto& runner : runners_) {
+    if (!runner->active_ && !runner->failed_) {
+      runner->active_ = true;
+      active_runner_cnt_++;
+      deep_queue_since_ns_ = now_ns;
+      return &runner->cv_;
+    }
+  }
+
+  return nullptr;
+}
+
+bool
+DynamicBatchScheduler::CanScaleDown() const
+{
+  // 'mu_' mutex must be held when this function is called.
+  return autoscaling_ && (active_runner_cnt_ > min_active_runner_cnt_);
+}
+
+size_t
+DynamicBatchScheduler::LeastLoadedInstance(
+    const std::vector<size_t>* assigned_cnts)
+{
+  // The load of an instance is the number of its pending requests,
+  // plus the number in 'assigned_cnts' about to be enqueued to it,
+  // plus the number of its runners that are busy. Instances with the
+  // same load are chosen in turn. An instance whose runner failed to
+  // initialize is never chosen, at least one runner is initialized.
+  const size_t instance_cnt = instance_schedulers_.size();
+  const size_t start = next_instance_++;
+  size_t chosen = start % instance_cnt;
+  uint64_t chosen_load = UINT64_MAX;
+  for (size_t c = 0; c < instance_cnt; ++c) {
+    const size_t idx = (start + c) % instance_cnt;
+    const DynamicBatchScheduler* instance = instance_schedulers_[idx].get();
+    if (instance->scheduler_threads_.empty()) {
+      continue;
+    }
 
-    // It should never happen that we don't find the shape for an
-    // input, but if it does just return to be conservative.
-    if (itr == pending_batch_shapes_.end()) {
-      LOG_ERROR << "expected to find shape for input '" << input.name() << "'";
-      return false;
+    uint64_t load = instance->pending_request_cnt_ +
+                    (instance->scheduler_thread_cnt_ -
+                     instance->idle_scheduler_thread_cnt_);
+    if (assigned_cnts != nullptr) {
+      load += (*assigned_cnts)[idx];
+    }
+    if (load < chosen_load) {
+      chosen = idx;
+      chosen_load = load;
     }
+  }
 
-    if (!CompareDims(itr->second, input.dims())) {
-      return false;
+  return chosen;
+}
+
+bool
+DynamicBatchScheduler::StealWork(DynamicBatchScheduler* thief)
+{
+  // Take requests from the instance with the most pending requests
+  // and move them to 'thief'. At most half of the requests of that
+  // instance, and no more than a batch, are taken and an instance
+  // with a single request keeps it, so that requests don't move back
+  // and forth between instances. Return true if any requests were
+  // taken.
+  DynamicBatchScheduler* victim = nullptr;
+  uint64_t victim_cnt = 1;
+  for (auto& instance : instance_schedulers_) {
+    const uint64_t cnt = instance->pending_request_cnt_;
+    if ((instance.get() != thief) && (cnt > victim_cnt)) {
+      victim = instance.get();
+      victim_cnt = cnt;
     }
   }
 
+  if (victim == nullptr) {
+    return false;
+  }
+
+  std::vector<Scheduler::Payload> stolen;
+  victim->TakeFromBack(
+      std::min(
+          (size_t)(victim_cnt / 2), std::max((size_t)1, queue_batch_size_)),
+      &stolen);
+  if (stolen.empty()) {
+    return false;
+  }
+
+  // The requests are taken last queued first, so reverse them to
+  // queue them in the thief in their original order.
+  std::reverse(stolen.begin(), stolen.end());
+  thief->pending_request_cnt_ += stolen.size();
+  thief->intake_.PushAll(&stolen);
   return true;
 }
 
+void
+DynamicBatchScheduler::TakeFromBack(
+    const size_t max_cnt, std::vector<Scheduler::Payload>* taken)
+{
+  // Take up to 'max_cnt' of the requests that this instance would
+  // execute last, from the lowest priority level first and from the
+  // back of each queue. The pending batch of a queue that requests
+  // are taken from must be formed again.
+  std::lock_guard<std::mutex> lock(mu_);
+  if (intake_.DrainTo(&arrivals_) > 0) {
+    for (auto& payload : arrivals_) {
+      QueuePayload(std::move(payload));
+    }
+    arrivals_.clear();
+  }
+
+  for (auto pitr = priority_queues_.rbegin();
+       (pitr != priority_queues_.rend()) && (taken->size() < max_cnt);
+       ++pitr) {
+    ShapeQueueMap& shape_queues = *pitr;
+    for (auto itr = shape_queues.begin();
+         (itr != shape_queues.end()) && (taken->size() < max_cnt);) {
+      ShapeQueue* sq = &itr->second;
+      while (!sq->queue_.empty() && (taken->size() < max_cnt)) {
+        taken->emplace_back(std::move(sq->queue_.back()));
+        sq->queue_.pop_back();
+        queued_cnt_--;
+        sq->ResetPendingBatch();
+      }
+
+      if (need_pending_shape_ && sq->queue_.empty()) {
+        itr = shape_queues.erase(itr);
+      } else {
+        ++itr;
+      }
+    }
+  }
+
+  pending_request_cnt_ -= taken->size();
+}
+
+void
+DynamicBatchScheduler::GetStatus(ModelVersionStatus* status)
+{
+  if (!dynamic_batching_enabled_) {
+    return;
+  }
+
+  // With instance queues the first instance reports the status, other
+  // than the queue depth, for all of them.
+  if (!instance_schedulers_.empty()) {
+    uint64_t queued, batch_size;
+    instance_schedulers_.front()->GetStatus(status);
+    GetQueueDepth(&queued, &batch_size);
+    status->mutable_dynamic_batch_status()->set_queue_depth(queued);
+    return;
+  }
+
+  DynamicBatchStatus* dbs = status->mutable_dynamic_batch_status();
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    dbs->set_queue_delay_microseconds(pending_batch_delay_ns_ / 1000);
+    dbs->set_queue_depth(pending_request_cnt_);
+    for (const auto size : preferred_batch_sizes_) {
+      dbs->add_preferred_batch_size(size);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(exec_mu_);
+  for (size_t b = 1; b < exec_ns_.size(); ++b) {
+    if (exec_ns_[b] != 0) {
+      (*dbs->mutable_execution_time_ns())[b] = exec_ns_[b];
+    }
+  }
+}
+
+void
+DynamicBatchScheduler::GetQueueDepth(uint64_t* queued, uint64_t* batch_size)
+{
+  *queued = pending_request_cnt_;
+  for (const auto& instance : instance_schedulers_) {
+    *queued += instance->pending_request_cnt_;
+  }
+  *batch_size = queue_batch_size_;
+}
+
+std::string
+DynamicBatchScheduler::ShapeKey(const InferRequestHeader& request) const
+{
+  // Requests can only be batched together if all their inputs have
+  // the same shape. Inputs can appear in any order in the request so
+  // order by name when forming the key.
+  if (!need_pending_shape_ || !dynamic_batching_enabled_) {
+    return std::string();
+  }
+
+  std::map<std::string, const DimsList*> shapes;
+  for (const auto& input : request.input()) {
+    shapes.emplace(input.name(), &input.dims());
+  }
+
+  std::string key;
+  for (const auto& pr : shapes) {
+    key += pr.first + DimsListToString(*pr.second);
+  }
+
+  return key;
+}
+
 uint64_t
-DynamicBatchScheduler::GetDynamicBatch()
+DynamicBatchScheduler::TimeoutNs(const Scheduler::Payload& payload) const
+{
+  // Return the time at which 'payload' times out, or UINT64_MAX if it
+  // doesn't have a timeout. A timeout in the request overrides the
+  // model's default.
+  uint64_t timeout_ns =
+      payload.request_provider_->RequestHeader().timeout_microseconds() * 1000;
+  if (timeout_ns == 0) {
+    timeout_ns = default_queue_timeout_ns_;
+  }
+
+  // No request is executed after its deadline, or after the drain
+  // deadline while the server drains, whether or not it has a timeout.
+  const uint64_t deadline_ns =
+      std::min(payload.stats_->Deadline(), drain_deadline_ns_);
+  if (!dynamic_batching_enabled_ || (timeout_ns == 0)) {
+    return deadline_ns;
+  }
+
+  const struct timespec& queued =
+      payload.stats_->Timestamp(ModelInferStats::TimestampKind::kQueueStart);
+  return std::min(TIMESPEC_TO_NANOS(queued) + timeout_ns, deadline_ns);
+}
+
+void
+DynamicBatchScheduler::Drain(const uint64_t deadline_ns)
 {
-  // 'mu_' mutex must be held when this function is called. queue_
+  // Requests past their own timeout are already rejected as soon as
+  // they expire, so only the drain deadline needs to be added. Wake
+  // an idle thread so that it waits for the new deadline.
+  for (auto& instance : instance_schedulers_) {
+    instance->Drain(deadline_ns);
+  }
+
+  std::condition_variable* wake_cv = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    drain_deadline_ns_ = std::min(drain_deadline_ns_, deadline_ns);
+    if ((queued_cnt_ > 0) || !intake_.Empty()) {
+      next_timeout_ns_ = std::min(next_timeout_ns_, drain_deadline_ns_);
+      wake_cv = ClaimIdleRunner(nullptr);
+    }
+  }
+
+  if (wake_cv != nullptr) {
+    wake_cv->notify_one();
+  }
+}
+
+void
+DynamicBatchScheduler::QueuePayload(Scheduler::Payload&& payload)
+{
+  // 'mu_' mutex must be held when this function is called.
+  const InferRequestHeader& request =
+      payload.request_provider_->RequestHeader();
+
+  // Priority 0 indicates the default priority level. The request
+  // header has been validated to not exceed the number of priority
+  // levels but clamp anyway to be safe, and ignore priority entirely
+  // if the model doesn't use priority levels.
+  uint32_t level = default_priority_level_;
+  if ((priority_queues_.size() > 1) && (request.priority() != 0)) {
+    level = std::min(request.priority(), (uint32_t)priority_queues_.size());
+  }
+
+  next_timeout_ns_ = std::min(next_timeout_ns_, TimeoutNs(payload));
+
+  arrival_window_cnt_ += request.batch_size();
+
+  // A request with a deadline is queued ahead of the requests with a
+  // later deadline, or no deadline, so that requests are executed in
+  // order of earliest deadline. The requests already in the pending
+  // batch are not reordered.
+  ShapeQueue& sq = priority_queues_[level - 1][ShapeKey(request)];
+  auto pos = sq.queue_.end();
+  const uint64_t deadline_ns = payload.stats_->Deadline();
+  if (deadline_ns != UINT64_MAX) {
+    pos = std::find_if(
+        sq.queue_.begin() + sq.pending_batch_queue_cnt_, sq.queue_.end(),
+        [deadline_ns](const Scheduler::Payload& queued) {
+          return queued.stats_->Deadline() > deadline_ns;
+        });
+  }
+  sq.queue_.insert(pos, std::move(payload));
+  queued_cnt_++;
+}
+
+void
+DynamicBatchScheduler::RejectTimedOut(
+    const uint64_t now_ns, std::vector<Scheduler::Payload>* rejected)
+{
+  // 'mu_' mutex must be held when this function is called.
+  next_timeout_ns_ = UINT64_MAX;
+
+  for (auto& shape_queues : priority_queues_) {
+    for (auto itr = shape_queues.begin(); itr != shape_queues.end();) {
+      ShapeQueue* sq = &itr->second;
+      std::deque<Scheduler::Payload> remaining;
+      for (auto& payload : sq->queue_) {
+        const uint64_t timeout_ns = TimeoutNs(payload);
+        if (timeout_ns <= now_ns) {
+          rejected->emplace_back(std::move(payload));
+        } else {
+          next_timeout_ns_ = std::min(next_timeout_ns_, timeout_ns);
+          remaining.emplace_back(std::move(payload));
+        }
+      }
+
+      // If any requests were removed the pending batch must be formed
+      // again from the remaining requests.
+      if (remaining.size() != sq->queue_.size()) {
+        queued_cnt_ -= sq->queue_.size() - remaining.size();
+        sq->queue_.swap(remaining);
+        sq->ResetPendingBatch();
+      }
+
+      if (need_pending_shape_ && sq->queue_.empty()) {
+        itr = shape_queues.erase(itr);
+      } else {
+        ++itr;
+      }
+    }
+  }
+
+  pending_request_cnt_ -= rejected->size();
+#ifdef TRTIS_ENABLE_METRICS
+  if (metric_queue_length_ != nullptr) {
+    metric_queue_length_->Decrement(rejected->size());
+  }
+#endif  // TRTIS_ENABLE_METRICS
+}
+
+uint64_t
+DynamicBatchScheduler::GetDynamicBatch(
+    const uint64_t now_ns, ShapeQueueMap** batch_queues,
+    ShapeQueueMap::iterator* batch_itr)
+{
+  // 'mu_' mutex must be held when this function is called. At least
+  // one request must be queued.
+
+  // Priority levels are examined from highest to lowest and the first
+  // level that has a batch ready to execute is used. Within a level
+  // each shape forms its own pending batch. If more than one of those
+  // batches are ready to execute choose the one that holds the oldest
+  // request so that no shape is starved by another that fills its
+  // preferred batch sizes more quickly. If no batch is ready return
+  // the shortest time until one of them will be.
+  uint64_t wait_microseconds = UINT64_MAX;
+
+  for (auto& shape_queues : priority_queues_) {
+    uint64_t oldest_ready_ns = UINT64_MAX;
+    bool found_ready = false;
+
+    for (auto itr = shape_queues.begin(); itr != shape_queues.end(); ++itr) {
+      ShapeQueue* sq = &itr->second;
+      if (sq->queue_.empty()) {
+        continue;
+      }
+
+      const uint64_t sq_wait_microseconds = UpdatePendingBatch(sq, now_ns);
+      if (sq_wait_microseconds == 0) {
+        const uint64_t queued_ns =
+            TIMESPEC_TO_NANOS(sq->queue_.front().stats_->Timestamp(
+                ModelInferStats::TimestampKind::kQueueStart));
+        if (!found_ready || (queued_ns < oldest_ready_ns)) {
+          *batch_itr = itr;
+          oldest_ready_ns = queued_ns;
+          found_ready = true;
+        }
+      } else {
+        wait_microseconds = std::min(wait_microseconds, sq_wait_microseconds);
+      }
+    }
+
+    if (found_ready) {
+      *batch_queues = &shape_queues;
+      return 0;
+    }
+  }
+
+  return wait_microseconds;
+}
+
+uint64_t
+DynamicBatchScheduler::UpdatePendingBatch(
+    ShapeQueue* sq, const uint64_t now_ns)
+{
+  // 'mu_' mutex must be held when this function is called. 'sq'
   // must not be empty.
 
   // Examine the new requests. If adding these new requests to the
   // pending batch allows a preferred batch size then execute it
   // immediately. Stop examining requests if the maximum preferred
-  // batch size would be exceeded or if the shape of the next request
-  // does not match the shape of the pending batch.
+  // batch size would be exceeded. All requests in 'sq' have the same
+  // shape.
   bool send_now = false;
   size_t best_preferred_batch_size = 0;
   size_t best_preferred_batch_cnt = 0;
-  size_t search_batch_size = pending_batch_size_;
-  size_t search_batch_cnt = pending_batch_queue_cnt_;
-  for (auto idx = pending_batch_queue_cnt_; idx < queue_.size(); ++idx) {
-    const auto batch_size =
-        queue_[idx].request_provider_->RequestHeader().batch_size();
-
-    // If there is no pending batch, then this request is starting a
-    // new batch.
-    if (search_batch_cnt == 0) {
-      // Get the shape of the new batch that is being started...
-      if (need_pending_shape_) {
-        InitPendingShape(queue_[idx].request_provider_->RequestHeader());
-      }
-    } else {
-      // There is a pending batch and adding this request would make
-      // the batch size too large, so send the pending batch as it is.
-      if ((search_batch_size + batch_size) > max_preferred_batch_size_) {
-        send_now = true;
-        break;
-      }
+  size_t search_batch_size = sq->pending_batch_size_;
+  size_t search_batch_cnt = sq->pending_batch_queue_cnt_;
+  for (auto idx = sq->pending_batch_queue_cnt_; idx < sq->queue_.size();
+       ++idx) {
+    const Scheduler::Payload& payload = sq->queue_[idx];
+    const InferRequestHeader& request =
+        payload.request_provider_->RequestHeader();
+    const auto batch_size = request.batch_size();
 
-      // There is a pending batch and it has a different shape then
-      // this request, so send the pending batch as it is.
-      if (need_pending_shape_ &&
-          !CompareWithPendingShape(
-              queue_[idx].request_provider_->RequestHeader())) {
-        send_now = true;
-        break;
-      }
+    // There is a pending batch and adding this request would make
+    // the batch size too large, so send the pending batch as it is.
+    if ((search_batch_cnt != 0) &&
+        ((search_batch_size + batch_size) > max_preferred_batch_size_)) {
+      send_now = true;
+      break;
     }
 
     search_batch_size += batch_size;
     search_batch_cnt++;
 
+    // A preferred batch is sent at once, so the time at which the
+    // pending batch must be sent only matters for the requests that
+    // stay in it.
+    const uint64_t queued_ns = TIMESPEC_TO_NANOS(payload.stats_->Timestamp(
+        ModelInferStats::TimestampKind::kQueueStart));
+    if (request.max_queue_delay_microseconds() != 0) {
+      sq->pending_batch_send_ns_ = std::min(
+          sq->pending_batch_send_ns_,
+          queued_ns + request.max_queue_delay_microseconds() * 1000);
+    } else {
+      sq->pending_batch_queued_ns_ =
+          std::min(sq->pending_batch_queued_ns_, queued_ns);
+    }
+
     if (preferred_batch_sizes_.find(search_batch_size) !=
         preferred_batch_sizes_.end()) {
       best_preferred_batch_size = search_batch_size;
@@ -374,40 +1519,38 @@ DynamicBatchScheduler::GetDynamicBatch()
 
   // If we found a preferred batch size then execute that.
   if (best_preferred_batch_size != 0) {
-    pending_batch_size_ = best_preferred_batch_size;
-    pending_batch_queue_cnt_ = best_preferred_batch_cnt;
+    sq->pending_batch_size_ = best_preferred_batch_size;
+    sq->pending_batch_queue_cnt_ = best_preferred_batch_cnt;
     return 0;
   }
 
-  pending_batch_size_ = search_batch_size;
-  pending_batch_queue_cnt_ = search_batch_cnt;
+  sq->pending_batch_size_ = search_batch_size;
+  sq->pending_batch_queue_cnt_ = search_batch_cnt;
 
   // Should always have at least one request in the pending batch at
   // this point.
-  if (pending_batch_queue_cnt_ == 0) {
+  if (sq->pending_batch_queue_cnt_ == 0) {
     LOG_ERROR << "unexpected pending batch size 0";
     return 0;
   }
 
-  // If there is no batch queuing delay or if the current batch can't
-  // grow any larger then just immediately execute whatever is
-  // pending.
-  if (send_now || (pending_batch_delay_ns_ == 0) ||
-      (pending_batch_size_ >= max_preferred_batch_size_)) {
+  // If the current batch can't grow any larger then just immediately
+  // execute whatever is pending.
+  if (send_now || (sq->pending_batch_size_ >= max_preferred_batch_size_)) {
     return 0;
   }
 
-  // Compare the age of the oldest pending request to the maximum
-  // batch queuing delay and execute now if queuing delay is
-  // exceeded. If queuing delay not exceeded create a timer to wakeup
-  // a thread to check again at the maximum allowed delay.
-  struct timespec now;
-  clock_gettime(CLOCK_MONOTONIC, &now);
-  const struct timespec& queued = queue_.front().stats_->Timestamp(
-      ModelInferStats::TimestampKind::kQueueStart);
-  uint64_t delay_ns = TIMESPEC_TO_NANOS(now) - TIMESPEC_TO_NANOS(queued);
+  // The pending batch must be sent once the queue delay of any of its
+  // requests is exceeded: the delay the request carries, or else the
+  // model's queue delay. If no delay is exceeded create a timer to
+  // wakeup a thread to check again when the earliest one is.
+  uint64_t send_ns = sq->pending_batch_send_ns_;
+  if (sq->pending_batch_queued_ns_ != UINT64_MAX) {
+    send_ns = std::min(
+        send_ns, sq->pending_batch_queued_ns_ + pending_batch_delay_ns_);
+  }
 
-  if (delay_ns >= pending_batch_delay_ns_) {
+  if (now_ns >= send_ns) {
     return 0;
   }
 
@@ -418,7 +1561,183 @@ DynamicBatchScheduler::GetDynamicBatch()
   // then this thread will wake and revisit the pending batch (and at
   // that time will then see the delay has been exceeded and will send
   // the batch).
-  return (pending_batch_delay_ns_ - delay_ns) / 1000;
+  return (send_ns - now_ns) / 1000;
+}
+
+void
+DynamicBatchScheduler::UpdateQueueDelay(const uint64_t now_ns)
+{
+  // 'mu_' mutex must be held when this function is called.
+
+  // The arrival rate is measured over windows of at least 100
+  // milliseconds and the queue delay is adjusted at the end of each
+  // window.
+  const uint64_t window_ns = 100 * 1000 * 1000;
+  if (arrival_window_start_ns_ == 0) {
+    arrival_window_start_ns_ = now_ns;
+    return;
+  }
+
+  const uint64_t elapsed_ns = now_ns - arrival_window_start_ns_;
+  if (elapsed_ns < window_ns) {
+    return;
+  }
+
+  const double window_rate = (arrival_window_cnt_ * 1e9) / elapsed_ns;
+  arrival_rate_ = (arrival_rate_ == 0)
+                      ? window_rate
+                      : (0.75 * arrival_rate_) + (0.25 * window_rate);
+  arrival_window_start_ns_ = now_ns;
+  arrival_window_cnt_ = 0;
+
+  // Without any arrivals there is nothing to batch, so keep the
+  // current delay.
+  if (arrival_rate_ == 0) {
+    return;
+  }
+
+  std::vector<uint64_t> exec_ns;
+  {
+    std::lock_guard<std::mutex> lock(exec_mu_);
+    exec_ns = exec_ns_;
+  }
+
+  // Waiting for a batch of size 'b' takes about (b - 1) / rate, and
+  // the oldest request in the batch sees that delay plus the
+  // execution time of the batch. Among the batch sizes that fit
+  // within the latency budget choose the one with the highest
+  // throughput, which can't exceed the arrival rate, preferring the
+  // smaller batch (and so the smaller delay) for equal
+  // throughput. Batch sizes that haven't executed yet are optimistically
+  // assumed to take as long as the next smaller observed size so that
+  // larger batches are tried when they might help. Keep the current
+  // delay until at least one execution time has been observed.
+  uint64_t est_exec_ns = 0;
+  double best_throughput = 0;
+  uint64_t best_delay_ns = 0;
+  bool found = false;
+  for (size_t b = 1; b < exec_ns.size(); ++b) {
+    if (exec_ns[b] != 0) {
+      est_exec_ns = exec_ns[b];
+      found = true;
+    }
+    if (est_exec_ns == 0) {
+      continue;
+    }
+
+    const double fill_ns = ((b - 1) * 1e9) / arrival_rate_;
+    if ((fill_ns + est_exec_ns) > target_latency_ns_) {
+      continue;
+    }
+
+    const double throughput =
+        std::min(arrival_rate_, (b * 1e9) / est_exec_ns);
+    if (throughput > best_throughput) {
+      best_throughput = throughput;
+      best_delay_ns = (uint64_t)fill_ns;
+    }
+  }
+
+  if (found) {
+    pending_batch_delay_ns_ = std::min(best_delay_ns, max_queue_delay_ns_);
+  }
+}
+
+void
+DynamicBatchScheduler::UpdatePreferredBatchSizes()
+{
+  // 'mu_' mutex must be held when this function is called.
+  std::vector<uint64_t> exec_ns;
+  {
+    std::lock_guard<std::mutex> lock(exec_mu_);
+    exec_ns = exec_ns_;
+  }
+
+  // A measured batch size is preferred if it has higher throughput
+  // than every smaller measured size and if the next larger size,
+  // when measured, has lower throughput. So a size that runs
+  // particularly well, for example because it fits the model's
+  // kernels, is executed as soon as it is available instead of
+  // growing the batch to a size that runs worse. Configured preferred
+  // sizes that haven't been measured yet remain preferred.
+  std::set<int32_t> preferred;
+  double best_throughput = 0;
+  for (size_t b = 1; b < exec_ns.size(); ++b) {
+    if (exec_ns[b] == 0) {
+      if (configured_preferred_batch_sizes_.find(b) !=
+          configured_preferred_batch_sizes_.end()) {
+        preferred.insert(b);
+      }
+      continue;
+    }
+
+    const double throughput = (double)b / exec_ns[b];
+    if (throughput <= best_throughput) {
+      continue;
+    }
+    best_throughput = throughput;
+
+    if (((b + 1) < exec_ns.size()) &&
+        ((exec_ns[b + 1] == 0) ||
+         (((double)(b + 1) / exec_ns[b + 1]) >= throughput))) {
+      continue;
+    }
+
+    preferred.insert(b);
+  }
+
+  if (preferred != preferred_batch_sizes_) {
+    preferred_batch_sizes_.swap(preferred);
+
+    // The pending batches were formed using the previous preferred
+    // sizes so they must be formed again.
+    for (auto& shape_queues : priority_queues_) {
+      for (auto& pr : shape_queues) {
+        pr.second.ResetPendingBatch();
+      }
+    }
+
+    std::string sizes;
+    for (const auto size : preferred_batch_sizes_) {
+      sizes += (sizes.empty() ? "" : ", ") + std::to_string(size);
+    }
+    LOG_VERBOSE(1) << "Dynamic batcher preferred batch sizes [ " << sizes
+                   << " ]";
+  }
+}
+
+void
+DynamicBatchScheduler::RecordExecution(
+    const size_t batch_size, const std::vector<Scheduler::Payload>& payloads)
+{
+  // All the payloads of a batch are executed together so the compute
+  // time recorded in any of them is the execution time of the batch.
+  for (const auto& payload : payloads) {
+    if (payload.stats_ == nullptr) {
+      continue;
+    }
+
+    const uint64_t start_ns = TIMESPEC_TO_NANOS(payload.stats_->Timestamp(
+        ModelInferStats::TimestampKind::kComputeStart));
+    const uint64_t end_ns = TIMESPEC_TO_NANOS(payload.stats_->Timestamp(
+        ModelInferStats::TimestampKind::kComputeEnd));
+    if ((start_ns == 0) || (end_ns <= start_ns)) {
+      continue;
+    }
+
+    const uint64_t exec_ns = end_ns - start_ns;
+    {
+      std::lock_guard<std::mutex> lock(exec_mu_);
+      if (batch_size < exec_ns_.size()) {
+        uint64_t& smoothed_ns = exec_ns_[batch_size];
+        smoothed_ns =
+            (smoothed_ns == 0) ? exec_ns : ((3 * smoothed_ns) + exec_ns) / 4;
+      }
+    }
+
+    exec_updated_ = true;
+    break;
+  }
 }
 
 }}  // namespace nvidia::inferenceserver
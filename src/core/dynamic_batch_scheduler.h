@@ -30,9 +30,15 @@
 #include <deque>
 #include <future>
 #include <mutex>
+#include <set>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 #include "src/core/api.pb.h"
+#include "src/core/metric_model_reporter.h"
 #include "src/core/model_config.pb.h"
+#include "src/core/model_config_utils.h"
+#include "src/core/mpsc_queue.h"
 #include "src/core/scheduler.h"
 #include "src/core/status.h"
 
@@ -42,10 +48,17 @@ namespace nvidia { namespace inferenceserver {
 class DynamicBatchScheduler : public Scheduler {
  public:
   // Create a scheduler to support a given number of runners and a run
-  // function to call when a request is scheduled.
+  // function to call when a request is scheduled. If 'OnRelease' is
+  // not nullptr it is called when a runner is deactivated by instance
+  // autoscaling. The scheduler metrics are reported to
+  // 'metric_reporter' if it is not nullptr. If the model uses
+  // instance queues each runner is given its own scheduler and the
+  // returned scheduler directs requests to them.
   static Status Create(
       const ModelConfig& config, const uint32_t runner_cnt,
       StandardInitFunc OnInit, StandardRunFunc OnSchedule,
+      StandardReleaseFunc OnRelease,
+      const std::shared_ptr<MetricModelReporter>& metric_reporter,
       std::unique_ptr<Scheduler>* scheduler);
 
   ~DynamicBatchScheduler();
@@ -57,16 +70,141 @@ class DynamicBatchScheduler : public Scheduler {
       const std::shared_ptr<InferResponseProvider>& response_provider,
       std::function<void(const Status&)> OnComplete) override;
 
+  // \see Scheduler::EnqueueBatch()
+  void EnqueueBatch(std::vector<Scheduler::Payload>* payloads) override;
+
+  // \see Scheduler::GetStatus()
+  void GetStatus(ModelVersionStatus* status) override;
+
+  // \see Scheduler::GetQueueDepth()
+  void GetQueueDepth(uint64_t* queued, uint64_t* batch_size) override;
+
+  // \see Scheduler::Drain()
+  void Drain(const uint64_t deadline_ns) override;
+
  private:
+  // Create a scheduler for 'runner_cnt' runners that starts
+  // 'thread_cnt' of them, beginning with 'first_runner_id'.
   DynamicBatchScheduler(
       const ModelConfig& config, const uint32_t runner_cnt,
-      StandardInitFunc OnInit, StandardRunFunc OnSchedule);
+      const uint32_t first_runner_id, const uint32_t thread_cnt,
+      StandardInitFunc OnInit, StandardRunFunc OnSchedule,
+      StandardReleaseFunc OnRelease);
+  Status StartThreads(
+      const ModelConfig& config,
+      const std::shared_ptr<MetricModelReporter>& metric_reporter);
   void SchedulerThread(
       const uint32_t runner_id, const int nice,
       std::promise<bool>* is_initialized);
-  void InitPendingShape(const InferRequestHeader& request);
-  bool CompareWithPendingShape(const InferRequestHeader& request) const;
-  uint64_t GetDynamicBatch();
+
+  // Requests that share the same input shapes, in arrival order,
+  // along with the state of the batch being formed from those
+  // requests. For the requests of the pending batch that carry their
+  // own maximum queue delay, 'pending_batch_send_ns_' is the earliest
+  // time at which one of them must be sent. For the others,
+  // 'pending_batch_queued_ns_' is the earliest time at which one of
+  // them was queued, the model's queue delay applying from that time.
+  // Both are UINT64_MAX if there is no such request.
+  struct ShapeQueue {
+    ShapeQueue()
+        : pending_batch_size_(0), pending_batch_queue_cnt_(0),
+          pending_batch_send_ns_(UINT64_MAX),
+          pending_batch_queued_ns_(UINT64_MAX)
+    {
+    }
+    void ResetPendingBatch()
+    {
+      pending_batch_size_ = 0;
+      pending_batch_queue_cnt_ = 0;
+      pending_batch_send_ns_ = UINT64_MAX;
+      pending_batch_queued_ns_ = UINT64_MAX;
+    }
+    std::deque<Scheduler::Payload> queue_;
+    size_t pending_batch_size_;
+    size_t pending_batch_queue_cnt_;
+    uint64_t pending_batch_send_ns_;
+    uint64_t pending_batch_queued_ns_;
+  };
+
+  using ShapeQueueMap = std::unordered_map<std::string, ShapeQueue>;
+
+  // The state of a runner and its scheduler thread.
+  struct RunnerState {
+    explicit RunnerState(const RunnerPlacement& placement)
+        : gpu_device_(placement.gpu_device_),
+          host_cpus_(placement.host_cpus_), idle_(false), active_(true),
+          failed_(false)
+    {
+    }
+
+    // The GPU that the runner executes on, or -1 if not known or if
+    // the runner doesn't use a GPU.
+    const int gpu_device_;
+
+    // The host CPUs that the scheduler thread runs on, or empty if
+    // the thread is not bound to specific CPUs.
+    const std::vector<int> host_cpus_;
+
+    // True if the runner is waiting for work and hasn't yet been
+    // chosen to wake. Protected by 'mu_'.
+    bool idle_;
+
+    // True if the runner takes work. With instance autoscaling only
+    // some of the runners are active. Protected by 'mu_'.
+    bool active_;
+
+    // True if the runner failed to initialize and so is never
+    // activated. Protected by 'mu_'.
+    bool failed_;
+
+    // Condvar the runner waits on when it is idle.
+    std::condition_variable cv_;
+  };
+
+  std::string ShapeKey(const InferRequestHeader& request) const;
+  uint64_t TimeoutNs(const Scheduler::Payload& payload) const;
+  void QueuePayload(Scheduler::Payload&& payload);
+  void RejectTimedOut(
+      const uint64_t now_ns, std::vector<Scheduler::Payload>* rejected);
+  uint64_t GetDynamicBatch(
+      const uint64_t now_ns, ShapeQueueMap** batch_queues,
+      ShapeQueueMap::iterator* batch_itr);
+  uint64_t UpdatePendingBatch(ShapeQueue* sq, const uint64_t now_ns);
+  // A batch of payloads executed together by a runner, along with
+  // what is needed when the execution completes. Batches are recycled
+  // through 'batch_pool_' so that dispatching a batch doesn't
+  // allocate once the pool has warmed up.
+  struct ScheduledBatch {
+    ScheduledBatch()
+        : batch_size_(0), record_execution_(false), gpu_device_(-1),
+          runner_id_(0)
+    {
+    }
+    std::vector<Scheduler::Payload> payloads_;
+    size_t batch_size_;
+    bool record_execution_;
+    int gpu_device_;
+    uint32_t runner_id_;
+  };
+
+  std::unique_ptr<ScheduledBatch> AcquireBatch();
+  void ReleaseBatch(ScheduledBatch* batch);
+  void CompleteBatch(ScheduledBatch* batch, const Status& status);
+  std::condition_variable* ClaimIdleRunner(const RunnerState* busier_than);
+  bool HandOff(const RunnerState* runner, std::condition_variable** wake_cv);
+  void WaitForWork(
+      RunnerState* runner, std::unique_lock<std::mutex>* lock,
+      const uint64_t now_ns, const uint64_t wait_microseconds);
+  std::condition_variable* ScaleUp(const uint64_t now_ns);
+  bool CanScaleDown() const;
+  size_t LeastLoadedInstance(const std::vector<size_t>* assigned_cnts);
+  bool StealWork(DynamicBatchScheduler* thief);
+  void TakeFromBack(
+      const size_t max_cnt, std::vector<Scheduler::Payload>* taken);
+  void UpdateQueueDelay(const uint64_t now_ns);
+  void UpdatePreferredBatchSizes();
+  void RecordExecution(
+      const size_t batch_size, const std::vector<Scheduler::Payload>& payloads);
 
   // Function the scheduler will call to initialize a runner.
   const StandardInitFunc OnInit_;
@@ -75,34 +213,176 @@ class DynamicBatchScheduler : public Scheduler {
   // execution.
   const StandardRunFunc OnSchedule_;
 
-  // The number of scheduler threads.
+  // Function the scheduler will call to release a deactivated runner,
+  // or nullptr if the runner is kept initialized.
+  const StandardReleaseFunc OnRelease_;
+
+  // The number of scheduler threads and the runner id of the first
+  // of them.
   const uint32_t scheduler_thread_cnt_;
+  const uint32_t first_runner_id_;
 
-  // The number of scheduler threads currently idle.
-  uint32_t idle_scheduler_thread_cnt_;
+  // The number of scheduler threads currently idle. Only modified
+  // while holding 'mu_' but read without the lock by Enqueue().
+  std::atomic<uint32_t> idle_scheduler_thread_cnt_;
 
   // True if dynamic batching is enabled.
   bool dynamic_batching_enabled_;
 
-  // Mutex and condvar protecting the scheduling queue.
+  // Mutex protecting the scheduling queue.
   std::mutex mu_;
-  std::condition_variable cv_;
 
-  // Queue holding inference requests for the model represented by
-  // this scheduler.
-  std::deque<Scheduler::Payload> queue_;
+  // The state of each runner, indexed by runner id.
+  std::vector<std::unique_ptr<RunnerState>> runners_;
+
+  // True if the runners use more than one GPU, in which case ready
+  // batches are directed to runners on the least loaded GPUs.
+  bool load_aware_;
+
+  // Lock-free intake for newly enqueued requests. Enqueue() pushes
+  // here without taking 'mu_' and the scheduler threads move the
+  // requests into 'priority_queues_' while holding 'mu_'.
+  MpscQueue<Scheduler::Payload> intake_;
+
+  // Scratch space used when draining 'intake_'. Protected by 'mu_'.
+  std::vector<Scheduler::Payload> arrivals_;
+
+  // Queues holding inference requests for the model represented by
+  // this scheduler. There is one map of queues for each priority
+  // level, with the highest priority (level 1) first. Within a
+  // priority level the queues are keyed by the shape of the request
+  // inputs. If the model has no variable-size inputs (or dynamic
+  // batching is not enabled) all requests of a priority level share a
+  // single queue with an empty key. Protected by 'mu_'.
+  std::vector<ShapeQueueMap> priority_queues_;
+
+  // The total number of requests in 'priority_queues_'. Protected by
+  // 'mu_'.
+  size_t queued_cnt_;
+
+  // The priority level, in the range [ 1, priority_queues_.size() ],
+  // used for requests that don't specify a priority.
+  uint32_t default_priority_level_;
+
+  // The number of requests that have been accepted by Enqueue() but
+  // not yet removed from the queues, either for execution or because
+  // they were rejected.
+  std::atomic<uint64_t> pending_request_cnt_;
+
+  // The maximum number of pending requests, or 0 if not limited.
+  uint64_t max_queue_size_;
+
+  // The queue timeout for requests that don't specify their own
+  // timeout, or 0 if requests don't time out.
+  uint64_t default_queue_timeout_ns_;
+
+  // The earliest time at which a queued request times out, or
+  // UINT64_MAX if no queued request can time out. Protected by 'mu_'.
+  uint64_t next_timeout_ns_;
+
+  // The time after which no queued request is executed because the
+  // server is draining, or UINT64_MAX if it is not draining. Protected
+  // by 'mu_'.
+  uint64_t drain_deadline_ns_;
+
+  // The deadline of the idle scheduler thread that is waiting for the
+  // next pending batch delay or request timeout to expire, or
+  // UINT64_MAX if no thread is waiting for a deadline. Each time a
+  // thread takes over the deadline 'timer_generation_' is
+  // incremented. Protected by 'mu_'.
+  uint64_t timer_deadline_ns_;
+  uint64_t timer_generation_;
 
   std::vector<std::unique_ptr<std::thread>> scheduler_threads_;
   std::atomic<bool> scheduler_threads_exit_;
 
   size_t max_preferred_batch_size_;
+
+  // The largest configured preferred batch size, reported by
+  // GetQueueDepth() without locking. 'max_preferred_batch_size_'
+  // changes as preferred batch sizes are learned.
+  size_t queue_batch_size_;
   std::set<int32_t> preferred_batch_sizes_;
   uint64_t pending_batch_delay_ns_;
-  size_t pending_batch_size_;
-  size_t pending_batch_queue_cnt_;
 
+  // True if requests must be separated by input shape because the
+  // model allows one or more variable-size input tensors.
   bool need_pending_shape_;
-  std::unordered_map<std::string, DimsList> pending_batch_shapes_;
+
+  // True if 'pending_batch_delay_ns_' is adjusted based on the
+  // observed arrival rate and execution times, in which case
+  // 'pending_batch_delay_ns_' is protected by 'mu_'.
+  bool adaptive_queue_delay_;
+
+  // The latency budget and the upper bound used when adjusting the
+  // queue delay.
+  uint64_t target_latency_ns_;
+  uint64_t max_queue_delay_ns_;
+
+  // The start of the current arrival rate measurement window and the
+  // number of inferences that have arrived during it, along with the
+  // smoothed arrival rate, in inferences per second, of the previous
+  // windows. Protected by 'mu_'.
+  uint64_t arrival_window_start_ns_;
+  uint64_t arrival_window_cnt_;
+  double arrival_rate_;
+
+  // True if runners are activated and deactivated based on the queue
+  // depth. 'active_runner_cnt_' is kept between
+  // 'min_active_runner_cnt_' and the number of runners. A runner is
+  // activated once more than 'scale_up_queue_depth_' requests per
+  // active runner have been queued since 'deep_queue_since_ns_' for
+  // 'scale_up_delay_ns_', and a runner deactivates itself after it
+  // has been idle for 'scale_down_idle_ns_'. 'active_runner_cnt_' and
+  // 'deep_queue_since_ns_', which is 0 if the queue is not too deep,
+  // are protected by 'mu_'.
+  bool autoscaling_;
+  uint32_t min_active_runner_cnt_;
+  uint32_t active_runner_cnt_;
+  size_t scale_up_queue_depth_;
+  uint64_t scale_up_delay_ns_;
+  uint64_t scale_down_idle_ns_;
+  uint64_t deep_queue_since_ns_;
+
+  // True if 'preferred_batch_sizes_' is learned from the observed
+  // execution times, in which case 'preferred_batch_sizes_' is
+  // protected by 'mu_'. The preferred batch sizes from the model
+  // configuration are used for sizes that haven't been observed.
+  bool learn_preferred_batch_size_;
+  std::set<int32_t> configured_preferred_batch_sizes_;
+
+  // The smoothed execution time for each batch size, or 0 if a batch
+  // of that size has not been executed. Empty if execution times are
+  // not needed. Executions complete outside of the scheduler threads
+  // so these are protected by a separate mutex. 'exec_updated_' is
+  // set whenever an execution time is recorded.
+  std::mutex exec_mu_;
+  std::vector<uint64_t> exec_ns_;
+  std::atomic<bool> exec_updated_;
+
+  // With instance queues, the scheduler of each runner, indexed by
+  // runner id, and the instance at which the search for the least
+  // loaded instance starts next. Empty if the runners share this
+  // scheduler's queue. The scheduler of a runner has 'parent_' set to
+  // the scheduler that directs requests to it, otherwise 'parent_' is
+  // nullptr.
+  std::vector<std::unique_ptr<DynamicBatchScheduler>> instance_schedulers_;
+  std::atomic<size_t> next_instance_;
+  DynamicBatchScheduler* parent_;
+
+  // Batches available for reuse. Batches complete outside of the
+  // scheduler threads so the pool has its own mutex.
+  std::mutex batch_pool_mu_;
+  std::vector<std::unique_ptr<ScheduledBatch>> batch_pool_;
+
+#ifdef TRTIS_ENABLE_METRICS
+  // The scheduler metrics, nullptr if not reported. The in-flight
+  // executions are indexed by runner id.
+  std::shared_ptr<MetricModelReporter> metric_reporter_;
+  prometheus::Gauge* metric_queue_length_;
+  std::vector<prometheus::Gauge*> metric_inflight_executions_;
+  prometheus::Histogram* metric_exec_batch_size_;
+#endif  // TRTIS_ENABLE_METRICS
 };
 
 }}  // namespace nvidia::inferenceserver
@@ -26,30 +26,112 @@
 
 #include "src/core/ensemble_scheduler.h"
 
+#include <cstring>
+#include <deque>
 #include <mutex>
+#include <unordered_set>
 #include "src/core/api.pb.h"
 #include "src/core/backend.h"
+#include "src/core/dynamic_batch_scheduler.h"
 #include "src/core/logging.h"
 #include "src/core/provider_utils.h"
 #include "src/core/server.h"
 #include "src/core/server_status.h"
 
+#ifdef TRTIS_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRTIS_ENABLE_GPU
+
 namespace nvidia { namespace inferenceserver {
 
+#ifndef TRTIS_ENABLE_GPU
+using cudaStream_t = void*;
+#endif  // TRTIS_ENABLE_GPU
+
 namespace {
 
+// Return the value of the 'idx'-th element of 'dtype' in 'buffer'.
+double
+ElementValue(const DataType dtype, const char* buffer, size_t idx)
+{
+  switch (dtype) {
+    case TYPE_BOOL:
+      return (buffer[idx] != 0) ? 1.0 : 0.0;
+    case TYPE_UINT8:
+      return reinterpret_cast<const uint8_t*>(buffer)[idx];
+    case TYPE_UINT16:
+      return reinterpret_cast<const uint16_t*>(buffer)[idx];
+    case TYPE_UINT32:
+      return reinterpret_cast<const uint32_t*>(buffer)[idx];
+    case TYPE_UINT64:
+      return reinterpret_cast<const uint64_t*>(buffer)[idx];
+    case TYPE_INT8:
+      return reinterpret_cast<const int8_t*>(buffer)[idx];
+    case TYPE_INT16:
+      return reinterpret_cast<const int16_t*>(buffer)[idx];
+    case TYPE_INT32:
+      return reinterpret_cast<const int32_t*>(buffer)[idx];
+    case TYPE_INT64:
+      return reinterpret_cast<const int64_t*>(buffer)[idx];
+    case TYPE_FP32:
+      return reinterpret_cast<const float*>(buffer)[idx];
+    case TYPE_FP64:
+      return reinterpret_cast<const double*>(buffer)[idx];
+    default:
+      break;
+  }
+
+  return 0;
+}
+
+// Return true if 'value' satisfies the comparison of 'condition'.
+bool
+CompareWithThreshold(
+    const ModelEnsembling::Step::Condition& condition, const double value)
+{
+  switch (condition.comparison()) {
+    case ModelEnsembling::Step::Condition::GREATER:
+      return value > condition.threshold();
+    case ModelEnsembling::Step::Condition::GREATER_EQUAL:
+      return value >= condition.threshold();
+    case ModelEnsembling::Step::Condition::LESS:
+      return value < condition.threshold();
+    case ModelEnsembling::Step::Condition::LESS_EQUAL:
+      return value <= condition.threshold();
+    default:
+      break;
+  }
+
+  return false;
+}
+
+class EnsembleContext;
+
 // Step specifies the backend, providers and status objects used for
 // the internal infer request
 struct Step {
-  Step(size_t step_idx) : step_idx_(step_idx) {}
+  Step(EnsembleContext* context, size_t step_idx)
+      : context_(context), step_idx_(step_idx)
+  {
+  }
+
+  // Release the objects used by the last request that ran the step.
+  void Reset()
+  {
+    backend_.reset();
+    request_provider_.reset();
+    response_provider_.reset();
+    output_map_.clear();
+    infer_status_ = Status::Success;
+  }
 
   std::shared_ptr<InferenceBackend> backend_;
   std::shared_ptr<InferRequestProvider> request_provider_;
   std::shared_ptr<InferResponseProvider> response_provider_;
-  std::unordered_map<std::string, std::shared_ptr<AllocatedSystemMemory>>
-      output_map_;
+  std::unordered_map<std::string, std::shared_ptr<SystemMemory>> output_map_;
   Status infer_status_;
 
+  EnsembleContext* context_;
   size_t step_idx_;
 };
 
@@ -62,20 +144,33 @@ struct Step {
 // request.
 // So we don't have to maintian the context in scheduler as the shared_ptr
 // will destroy the context for us if there are no "in-flight" steps.
+//
+// Contexts are recycled by EnsembleContextPool. A context and the
+// steps, tensor map and allocator it owns are created once and reset
+// between requests, so a request only allocates the objects that are
+// handed to the composing models.
 class EnsembleContext {
  public:
-  EnsembleContext(
-      InferenceServer* is, EnsembleInfo* info,
-      const std::shared_ptr<ModelInferStats>& stats,
+  EnsembleContext(InferenceServer* is, EnsembleInfo* info);
+  ~EnsembleContext();
+
+  // Prepare the context to run the ensemble request given by
+  // 'request_provider'.
+  void Init(
+      const std::vector<std::shared_ptr<ModelInferStats>>& stats,
       const std::shared_ptr<InferRequestProvider>& request_provider,
       const std::shared_ptr<InferResponseProvider>& response_provider,
-      std::function<void(const Status&)> OnComplete, cudaStream_t stream);
+      std::function<void(const Status&)> OnComplete);
+
+  // Release the objects used by the last request so that the context
+  // can be reused.
+  void Reset();
 
   // Perform transition on 'context' state given the information of
   // 'completed_step'
   static void Proceed(
       const std::shared_ptr<EnsembleContext>& context,
-      const std::shared_ptr<Step>& completed_step = nullptr);
+      Step* completed_step = nullptr);
 
  private:
   static TRTSERVER_Error* ResponseAlloc(
@@ -87,7 +182,7 @@ class EnsembleContext {
       size_t byte_size, TRTSERVER_Memory_Type memory_type,
       int64_t memory_type_id);
 
-  using StepList = std::vector<std::shared_ptr<Step>>;
+  using StepList = std::vector<Step*>;
   using VersionMap =
       std::unordered_map<int64_t, std::shared_ptr<InferenceBackend>>;
   // Storing each tensor's meta data in 1st element, batch size in 2nd
@@ -97,8 +192,12 @@ class EnsembleContext {
 
   // Return the list of step that becomes ready due to tensor update
   // from 'completed_step'
-  Status PrepareSteps(
-      const std::shared_ptr<Step>& completed_step, StepList& steps);
+  Status PrepareSteps(Step* completed_step, StepList& steps);
+
+  // Add the timing of a successful execution of 'step' to the
+  // ensemble's step statistics.
+  static void RecordStepStats(
+      EnsembleInfo* info, const Step& step, const ModelInferStats& stats);
 
   // Prepare infer stats and call the inference server's function to process
   // the infer requests specified in 'steps'
@@ -108,8 +207,7 @@ class EnsembleContext {
   // Helper function that updates ensemble state given 'completed_step' and
   // returns the list of updated tensors in 'updated_tensors'
   Status UpdateEnsembleState(
-      const std::shared_ptr<Step>& completed_step,
-      std::vector<std::string>& updated_tensors);
+      Step* completed_step, std::vector<std::string>& updated_tensors);
 
   // Helper function that returns a list of 'steps' that should be run under
   // current ensemble state. 'updated_tensors' is used so that we don't need to
@@ -117,12 +215,40 @@ class EnsembleContext {
   Status GetNextSteps(
       const std::vector<std::string>& updated_tensors, StepList& steps);
 
+  // Return true if the tensor 'name' is either set or skipped, in
+  // which case 'skipped' is set to true.
+  bool TensorResolved(const std::string& name, bool* skipped);
+
+  // Return in 'holds' if the condition of 'step_info' holds for the
+  // current value of its condition tensor.
+  Status EvaluateCondition(
+      const EnsembleInfo::StepInfo& step_info, bool* holds);
+
+  // Return the data type of the ensemble tensor 'name'.
+  Status TensorDataType(const std::string& name, DataType* dtype);
+
+  // Mark the tensor 'name' as skipped. If the tensor is an ensemble
+  // output it is set to zeros.
+  Status SkipTensor(const std::string& name);
+
   // Helper function that completes the response of the ensemble request
   Status FinishEnsemble();
 
   // Helper function that initialize the 'step' given the info at 'step_idx'.
   // The 'step' will have proper request / response provider for the model
-  Status InitStep(size_t step_idx, std::shared_ptr<Step>* step);
+  Status InitStep(size_t step_idx, Step** step);
+
+  // If the 'output_name'd output of 'step' is a requested ensemble
+  // output, allocate its buffer from the ensemble response so that
+  // the step writes the output in place. Return in 'buffer' the
+  // buffer or nullptr if the output must be allocated internally.
+  Status AllocateEnsembleOutput(
+      Step* step, const std::string& output_name, size_t byte_size,
+      TRTSERVER_Memory_Type memory_type, void** buffer);
+
+  // If the ensemble tensor 'name' is a requested ensemble output and
+  // the request reports outputs early, report the tensor's contents.
+  void ReportEarlyOutput(const std::string& name);
 
   // Helper function that set the output of the ensemble request if it is ready
   // and valid.
@@ -140,8 +266,9 @@ class EnsembleContext {
 
   EnsembleInfo* info_;
 
-  // All EnsembleContext will use the same CUDA stream managed by
-  // the ensemble scheduler
+  // The CUDA stream used for the data transfers of the request. Each
+  // context owns a stream so that the copies of concurrent requests
+  // don't serialize on, or wait for, each other.
   cudaStream_t stream_;
 
   // Mutex to avoid concurrent call on 'PrepareSteps' where ensemble state
@@ -155,8 +282,20 @@ class EnsembleContext {
   std::unordered_map<std::string, std::set<size_t>>* tensor_to_step_;
 
   std::unordered_map<std::string, std::set<size_t>> pruned_tensor_to_step_;
+
+  // The data of every ensemble tensor. The map is populated once and
+  // its values are reset between requests.
   std::unordered_map<std::string, TensorData> tensor_data_;
 
+  // The state of each step, indexed like 'info_->steps_'. A step runs
+  // at most once per request.
+  std::vector<Step> steps_;
+
+  // The steps whose condition doesn't hold, or that depend on a skipped
+  // step, and the tensors that those steps would have produced.
+  std::unordered_set<size_t> skipped_steps_;
+  std::unordered_set<std::string> skipped_tensors_;
+
   // Handle to all backend that may be used in the ensemble
   std::unordered_map<std::string, VersionMap> handles_;
 
@@ -166,9 +305,10 @@ class EnsembleContext {
   uint64_t correlation_id_;
   uint32_t batch_size_;
 
-  // Objects related to the ensemble infer request
+  // Objects related to the ensemble infer request. There is more than
+  // one 'stats_' if the request merges a batch of requests.
   Status ensemble_status_;
-  std::shared_ptr<ModelInferStats> stats_;
+  std::vector<std::shared_ptr<ModelInferStats>> stats_;
   std::shared_ptr<InferRequestProvider> request_provider_;
   std::shared_ptr<InferResponseProvider> response_provider_;
   std::function<void(const Status&)> OnComplete_;
@@ -176,6 +316,12 @@ class EnsembleContext {
   // Output tensors whose labels are not provided by the ensemble
   std::set<std::string> no_label_tensors_;
 
+  // The ensemble outputs that were written by their step directly
+  // into the buffer allocated from 'response_provider_', and the mutex
+  // that serializes the allocations from concurrent steps.
+  std::mutex output_mu_;
+  std::unordered_set<std::string> aliased_outputs_;
+
   // The allocator that will be used to allocate buffers for the
   // inference result tensors.
   std::unique_ptr<
@@ -183,36 +329,87 @@ class EnsembleContext {
       allocator_;
 };
 
-EnsembleContext::EnsembleContext(
-    InferenceServer* is, EnsembleInfo* info,
-    const std::shared_ptr<ModelInferStats>& stats,
+EnsembleContext::EnsembleContext(InferenceServer* is, EnsembleInfo* info)
+    : is_(is), info_(info), stream_(nullptr), inflight_step_counter_(0),
+      tensor_to_step_(&(info_->tensor_to_step_)), batch_size_(0),
+      allocator_(nullptr, TRTSERVER_ResponseAllocatorDelete)
+{
+  for (const auto& pair : info_->tensor_to_step_) {
+    tensor_data_.emplace(pair.first, TensorData());
+  }
+
+  steps_.reserve(info_->steps_.size());
+  for (size_t idx = 0; idx < info_->steps_.size(); ++idx) {
+    steps_.emplace_back(this, idx);
+  }
+
+  TRTSERVER_ResponseAllocator* allocator;
+  TRTSERVER_Error* err = TRTSERVER_ResponseAllocatorNew(
+      &allocator, ResponseAlloc, ResponseRelease);
+  if (err != nullptr) {
+    LOG_ERROR << "failed to create response allocator for ensemble '"
+              << info_->ensemble_name_ << "': " << TRTSERVER_ErrorMessage(err);
+    TRTSERVER_ErrorDelete(err);
+  } else {
+    allocator_.reset(allocator);
+  }
+
+#ifdef TRTIS_ENABLE_GPU
+  cudaError_t cuerr = cudaStreamCreate(&stream_);
+  if (cuerr != cudaSuccess) {
+    stream_ = nullptr;
+    LOG_ERROR << "unable to create stream for " << info_->ensemble_name_
+              << ": " << cudaGetErrorString(cuerr);
+  }
+#endif  // TRTIS_ENABLE_GPU
+}
+
+EnsembleContext::~EnsembleContext()
+{
+#ifdef TRTIS_ENABLE_GPU
+  if (stream_ != nullptr) {
+    cudaError_t err = cudaStreamDestroy(stream_);
+    if (err != cudaSuccess) {
+      LOG_ERROR << "Failed to destroy cuda stream: " << cudaGetErrorString(err);
+    }
+  }
+#endif  // TRTIS_ENABLE_GPU
+}
+
+void
+EnsembleContext::Init(
+    const std::vector<std::shared_ptr<ModelInferStats>>& stats,
     const std::shared_ptr<InferRequestProvider>& request_provider,
     const std::shared_ptr<InferResponseProvider>& response_provider,
-    std::function<void(const Status&)> OnComplete, cudaStream_t stream)
-    : is_(is), info_(info), stream_(stream), inflight_step_counter_(0),
-      stats_(stats), request_provider_(request_provider),
-      response_provider_(response_provider), OnComplete_(OnComplete),
-      allocator_(nullptr, TRTSERVER_ResponseAllocatorDelete)
+    std::function<void(const Status&)> OnComplete)
 {
+  stats_ = stats;
+  request_provider_ = request_provider;
+  response_provider_ = response_provider;
+  OnComplete_ = std::move(OnComplete);
+
+  if (allocator_ == nullptr) {
+    ensemble_status_ = Status(
+        RequestStatusCode::INTERNAL,
+        "unable to create the response allocator for internal requests");
+  }
+
   // Obtain backend handles of all models in ensemble request such that
   // they have the same lifetime as the ensemble request to avoid unloading
   // while the ensemble is executing.
   for (const auto& step_info : info_->steps_) {
+    if (!ensemble_status_.IsOk()) {
+      break;
+    }
     auto it = handles_.find(step_info.model_name_);
     if (it == handles_.end()) {
       it = handles_.emplace(std::make_pair(step_info.model_name_, VersionMap()))
                .first;
     }
-    auto ver_it = it->second.find(step_info.model_version_);
-    if (ver_it == it->second.end()) {
-      std::shared_ptr<InferenceBackend> backend = nullptr;
+    auto& backend = it->second[step_info.model_version_];
+    if (backend == nullptr) {
       ensemble_status_ = is_->GetInferenceBackend(
           step_info.model_name_, step_info.model_version_, &backend);
-      if (!ensemble_status_.IsOk()) {
-        break;
-      }
-
-      it->second.emplace(std::make_pair(step_info.model_version_, backend));
     }
   }
 
@@ -245,13 +442,20 @@ EnsembleContext::EnsembleContext(
         // If none of the outputs of the step is requested,
         // then the step can be pruned
         if (--it->second == 0) {
+          std::vector<std::string> step_tensors;
           for (const auto& input : step.input_to_tensor_) {
-            auto& step_set = pruned_tensor_to_step_[input.second];
+            step_tensors.push_back(input.second);
+          }
+          if (step.has_condition_) {
+            step_tensors.push_back(step.condition_.tensor());
+          }
+          for (const auto& tensor : step_tensors) {
+            auto& step_set = pruned_tensor_to_step_[tensor];
             step_set.erase(step_idx);
             // If all steps depend on a tensor are pruned,
             // then the tensor can be ignored.
             if (step_set.empty()) {
-              new_ignored_tensor.insert(input.second);
+              new_ignored_tensor.insert(tensor);
             }
           }
         }
@@ -260,10 +464,6 @@ EnsembleContext::EnsembleContext(
     }
   }
 
-  for (const auto& pair : *tensor_to_step_) {
-    tensor_data_.emplace(pair.first, TensorData());
-  }
-
   if (ensemble_status_.IsOk()) {
     const auto& request_header = request_provider_->RequestHeader();
 
@@ -292,24 +492,45 @@ EnsembleContext::EnsembleContext(
     const std::shared_ptr<LabelProvider>& label_provider =
         response_provider_->GetLabelProvider();
     for (const auto& pair : info_->ensemble_output_shape_) {
-      const auto& label = label_provider->GetLabel(pair.first, 0);
-      if (label == "") {
+      if (!label_provider->HasLabel(pair.first, 0)) {
         no_label_tensors_.emplace(pair.first);
       }
     }
   }
+}
 
-  TRTSERVER_ResponseAllocator* allocator;
-  TRTSERVER_Error* err = TRTSERVER_ResponseAllocatorNew(
-      &allocator, ResponseAlloc, ResponseRelease);
-  if (err != nullptr) {
-    ensemble_status_ = Status(
-        TrtServerCodeToRequestStatus(TRTSERVER_ErrorCode(err)),
-        TRTSERVER_ErrorMessage(err));
-    TRTSERVER_ErrorDelete(err);
-  } else {
-    allocator_.reset(allocator);
+void
+EnsembleContext::Reset()
+{
+  // Drop the backend handles so that the models can be unloaded
+  // while the context is idle.
+  for (auto& pair : handles_) {
+    for (auto& version : pair.second) {
+      version.second.reset();
+    }
+  }
+
+  for (auto& pair : tensor_data_) {
+    std::get<0>(pair.second).Clear();
+    std::get<1>(pair.second) = 0;
+    std::get<2>(pair.second).reset();
+  }
+  for (auto& step : steps_) {
+    step.Reset();
   }
+
+  inflight_step_counter_ = 0;
+  tensor_to_step_ = &(info_->tensor_to_step_);
+  pruned_tensor_to_step_.clear();
+  skipped_steps_.clear();
+  skipped_tensors_.clear();
+  no_label_tensors_.clear();
+  aliased_outputs_.clear();
+  ensemble_status_ = Status::Success;
+  stats_.clear();
+  request_provider_.reset();
+  response_provider_.reset();
+  OnComplete_ = nullptr;
 }
 
 TRTSERVER_Error*
@@ -318,23 +539,48 @@ EnsembleContext::ResponseAlloc(
     const char* tensor_name, size_t byte_size,
     TRTSERVER_Memory_Type memory_type, int64_t memory_type_id, void* userp)
 {
-  auto tensor_data_map = reinterpret_cast<
-      std::unordered_map<std::string, std::shared_ptr<AllocatedSystemMemory>>*>(
-      userp);
+  auto step = reinterpret_cast<Step*>(userp);
 
   *buffer = nullptr;
   *buffer_userp = nullptr;
 
+  // An ensemble output is written directly into the ensemble response
+  // when possible, which saves copying it once the ensemble completes.
+  // Steps consuming the tensor read it from there.
+  if (byte_size != 0) {
+    Status status = step->context_->AllocateEnsembleOutput(
+        step, tensor_name, byte_size, memory_type, buffer);
+    if (!status.IsOk()) {
+      return TRTSERVER_ErrorNew(
+          RequestStatusToTrtServerCode(status.Code()),
+          status.Message().c_str());
+    }
+    if (*buffer != nullptr) {
+      auto memory = std::make_shared<SystemMemoryReference>();
+      memory->AddBuffer(
+          static_cast<const char*>(*buffer), byte_size, memory_type);
+      step->output_map_.emplace(tensor_name, std::move(memory));
+      LOG_VERBOSE(1) << "Internal response allocation: " << tensor_name
+                     << ", size " << byte_size << ", addr " << *buffer
+                     << ", memory type " << memory_type
+                     << ", in ensemble response";
+      return nullptr;  // Success
+    }
+  }
+
+  // GPU outputs are written into a device buffer from the cached GPU
+  // memory that is passed as-is to the steps consuming the tensor.
+  TRTSERVER_Memory_Type allocated_memory_type;
   auto allocated_buffer =
       std::make_shared<AllocatedSystemMemory>(byte_size, memory_type);
+  char* mutable_buffer =
+      allocated_buffer->MutableBuffer(&allocated_memory_type);
 
-  TRTSERVER_Memory_Type allocated_memory_type;
-  auto mutable_buffer = allocated_buffer->MutableBuffer(&allocated_memory_type);
   if ((mutable_buffer != nullptr) || (byte_size == 0)) {
     if (byte_size != 0) {
       *buffer = static_cast<void*>(mutable_buffer);
     }
-    tensor_data_map->emplace(tensor_name, std::move(allocated_buffer));
+    step->output_map_.emplace(tensor_name, std::move(allocated_buffer));
     LOG_VERBOSE(1) << "Internal response allocation: " << tensor_name
                    << ", size " << byte_size << ", addr " << *buffer
                    << ", memory type " << allocated_memory_type;
@@ -358,8 +604,7 @@ EnsembleContext::ResponseRelease(
 
 void
 EnsembleContext::Proceed(
-    const std::shared_ptr<EnsembleContext>& context,
-    const std::shared_ptr<Step>& completed_step)
+    const std::shared_ptr<EnsembleContext>& context, Step* completed_step)
 {
   StepList ready_steps;
   Status status = context->PrepareSteps(completed_step, ready_steps);
@@ -369,8 +614,7 @@ EnsembleContext::Proceed(
 }
 
 Status
-EnsembleContext::PrepareSteps(
-    const std::shared_ptr<Step>& completed_step, StepList& ready_steps)
+EnsembleContext::PrepareSteps(Step* completed_step, StepList& ready_steps)
 {
   {
     std::lock_guard<std::mutex> lock(mutex_);
@@ -384,6 +628,13 @@ EnsembleContext::PrepareSteps(
       StepList res;
       std::vector<std::string> updated_tensors;
       ensemble_status_ = UpdateEnsembleState(completed_step, updated_tensors);
+      // Don't start more steps for a request that has been cancelled,
+      // the steps in flight complete but their results are dropped.
+      if (ensemble_status_.IsOk() && request_provider_->IsCancelled()) {
+        ensemble_status_ = Status(
+            RequestStatusCode::UNAVAILABLE, "Request cancelled for '" +
+                                                info_->ensemble_name_ + "'");
+      }
       if (ensemble_status_.IsOk()) {
         ensemble_status_ = GetNextSteps(updated_tensors, res);
       }
@@ -401,8 +652,7 @@ EnsembleContext::PrepareSteps(
 
 Status
 EnsembleContext::UpdateEnsembleState(
-    const std::shared_ptr<Step>& completed_step,
-    std::vector<std::string>& updated_tensors)
+    Step* completed_step, std::vector<std::string>& updated_tensors)
 {
   updated_tensors.clear();
   if (completed_step == nullptr) {
@@ -438,6 +688,7 @@ EnsembleContext::UpdateEnsembleState(
           std::get<2>(tensor_data) =
               std::move(completed_step->output_map_[it->first]);
           updated_tensors.push_back(it->second);
+          ReportEarlyOutput(it->second);
 
           auto tensor_it = no_label_tensors_.find(it->second);
           if (tensor_it != no_label_tensors_.end()) {
@@ -481,18 +732,47 @@ EnsembleContext::GetNextSteps(
   steps.clear();
 
   std::set<size_t> next_step_idx;
-  // Get steps whose tensors used for input are set
-  for (const auto tensor_name : updated_tensors) {
+  // Get steps whose tensors used for input are set. A step whose
+  // condition doesn't hold, or that uses a skipped tensor, is skipped
+  // and the tensors it would have produced are resolved as skipped so
+  // that the steps using them are checked as well.
+  std::deque<std::string> resolved_tensors(
+      updated_tensors.begin(), updated_tensors.end());
+  while (!resolved_tensors.empty()) {
+    const std::string tensor_name = resolved_tensors.front();
+    resolved_tensors.pop_front();
+
     const auto& step_idx = (*tensor_to_step_)[tensor_name];
     for (const auto& idx : step_idx) {
+      const auto& step_info = info_->steps_[idx];
       bool ready = true;
-      for (const auto& input_pair : info_->steps_[idx].input_to_tensor_) {
-        if (std::get<2>(tensor_data_[input_pair.second]) == nullptr) {
+      bool skipped = false;
+      for (const auto& input_pair : step_info.input_to_tensor_) {
+        if (!TensorResolved(input_pair.second, &skipped)) {
           ready = false;
           break;
         }
       }
-      if (ready) {
+      if (ready && step_info.has_condition_) {
+        ready = TensorResolved(step_info.condition_.tensor(), &skipped);
+      }
+      if (!ready || (skipped_steps_.find(idx) != skipped_steps_.end())) {
+        continue;
+      }
+
+      if (!skipped && step_info.has_condition_) {
+        bool holds = false;
+        RETURN_IF_ERROR(EvaluateCondition(step_info, &holds));
+        skipped = !holds;
+      }
+
+      if (skipped) {
+        skipped_steps_.insert(idx);
+        for (const auto& output_pair : step_info.output_to_tensor_) {
+          RETURN_IF_ERROR(SkipTensor(output_pair.second));
+          resolved_tensors.push_back(output_pair.second);
+        }
+      } else {
         next_step_idx.insert(idx);
       }
     }
@@ -507,11 +787,152 @@ EnsembleContext::GetNextSteps(
   return Status::Success;
 }
 
+bool
+EnsembleContext::TensorResolved(const std::string& name, bool* skipped)
+{
+  if (skipped_tensors_.find(name) != skipped_tensors_.end()) {
+    *skipped = true;
+    return true;
+  }
+
+  auto it = tensor_data_.find(name);
+  return (it != tensor_data_.end()) && (std::get<2>(it->second) != nullptr);
+}
+
 Status
-EnsembleContext::InitStep(size_t step_idx, std::shared_ptr<Step>* step)
+EnsembleContext::EvaluateCondition(
+    const EnsembleInfo::StepInfo& step_info, bool* holds)
+{
+  const auto& condition = step_info.condition_;
+  DataType dtype;
+  RETURN_IF_ERROR(TensorDataType(condition.tensor(), &dtype));
+
+  // Gather the tensor into system memory. The condition tensor is
+  // typically a small score so a synchronous copy is used for the
+  // portion that is in GPU memory.
+  const auto& memory_block = std::get<2>(tensor_data_[condition.tensor()]);
+  std::vector<char> values(memory_block->TotalByteSize());
+  size_t offset = 0;
+  size_t content_idx = 0;
+  size_t content_size;
+  TRTSERVER_Memory_Type memory_type;
+  const char* content =
+      memory_block->BufferAt(content_idx, &content_size, &memory_type);
+  while (content != nullptr) {
+    if (memory_type == TRTSERVER_MEMORY_CPU) {
+      memcpy(values.data() + offset, content, content_size);
+    } else {
+#ifdef TRTIS_ENABLE_GPU
+      cudaError_t err = cudaMemcpy(
+          values.data() + offset, content, content_size,
+          cudaMemcpyDeviceToHost);
+      if (err != cudaSuccess) {
+        return Status(
+            RequestStatusCode::INTERNAL,
+            "failed to copy condition tensor '" + condition.tensor() +
+                "' to host: " + std::string(cudaGetErrorString(err)));
+      }
+#else
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "unexpected GPU memory for condition tensor '" + condition.tensor() +
+              "' while GPU is not supported");
+#endif  // TRTIS_ENABLE_GPU
+    }
+    offset += content_size;
+    content =
+        memory_block->BufferAt(++content_idx, &content_size, &memory_type);
+  }
+
+  // The step runs if any element satisfies the comparison, so that
+  // a batch is executed if the condition holds for any request in it.
+  *holds = false;
+  const size_t element_cnt = values.size() / GetDataTypeByteSize(dtype);
+  for (size_t idx = 0; (idx < element_cnt) && !*holds; ++idx) {
+    *holds = CompareWithThreshold(
+        condition, ElementValue(dtype, values.data(), idx));
+  }
+
+  return Status::Success;
+}
+
+Status
+EnsembleContext::TensorDataType(const std::string& name, DataType* dtype)
+{
+  const auto dit = info_->tensor_datatype_.find(name);
+  if (dit != info_->tensor_datatype_.end()) {
+    *dtype = dit->second;
+    return Status::Success;
+  }
+
+  // Otherwise the data type is that of the model output producing the
+  // tensor.
+  const auto pit = info_->tensor_to_prev_step_.find(name);
+  if (pit != info_->tensor_to_prev_step_.end()) {
+    const auto& step_info = info_->steps_[pit->second];
+    auto& backend = handles_[step_info.model_name_][step_info.model_version_];
+    for (const auto& output_pair : step_info.output_to_tensor_) {
+      if (output_pair.second == name) {
+        const ModelOutput* output;
+        RETURN_IF_ERROR(backend->GetOutput(output_pair.first, &output));
+        *dtype = output->data_type();
+        return Status::Success;
+      }
+    }
+  }
+
+  return Status(
+      RequestStatusCode::INTERNAL,
+      "unable to determine the data type of ensemble tensor '" + name + "'");
+}
+
+Status
+EnsembleContext::SkipTensor(const std::string& name)
+{
+  skipped_tensors_.insert(name);
+
+  const auto it = info_->ensemble_output_shape_.find(name);
+  if (it == info_->ensemble_output_shape_.end()) {
+    return Status::Success;
+  }
+
+  // A skipped ensemble output is returned filled with zeros. Its shape
+  // is fixed, which is checked when the configuration is validated.
+  DataType dtype;
+  RETURN_IF_ERROR(TensorDataType(name, &dtype));
+  const int64_t element_cnt = GetElementCount(it->second);
+  if (element_cnt < 0) {
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "skipped output '" + name + "' does not have a fixed shape");
+  }
+  const size_t byte_size = element_cnt * GetDataTypeByteSize(dtype) *
+                           (info_->allow_batching_ ? batch_size_ : 1);
+
+  auto memory_block =
+      std::make_shared<AllocatedSystemMemory>(byte_size, TRTSERVER_MEMORY_CPU);
+  TRTSERVER_Memory_Type memory_type;
+  char* buffer = memory_block->MutableBuffer(&memory_type);
+  if (buffer != nullptr) {
+    memset(buffer, 0, byte_size);
+  }
+
+  auto& tensor_data = tensor_data_[name];
+  auto& meta_data = std::get<0>(tensor_data);
+  meta_data.set_name(name);
+  *(meta_data.mutable_dims()) = it->second;
+  meta_data.set_batch_byte_size(byte_size);
+  std::get<1>(tensor_data) = (info_->allow_batching_ ? batch_size_ : 0);
+  std::get<2>(tensor_data) = std::move(memory_block);
+
+  return Status::Success;
+}
+
+Status
+EnsembleContext::InitStep(size_t step_idx, Step** step)
 {
   std::unordered_map<std::string, std::shared_ptr<SystemMemory>> input_map;
-  InferRequestHeader request_header;
+  auto request_header = std::make_shared<InferRequestHeader>();
   auto& version_map = handles_[info_->steps_[step_idx].model_name_];
   auto& backend = version_map[info_->steps_[step_idx].model_version_];
 
@@ -520,7 +941,7 @@ EnsembleContext::InitStep(size_t step_idx, std::shared_ptr<Step>* step)
 
   // Set inputs in request header and prepare input map
   for (const auto& pair : info_->steps_[step_idx].input_to_tensor_) {
-    auto input = request_header.add_input();
+    auto input = request_header->add_input();
     *input = std::get<0>(tensor_data_[pair.second]);
     input->set_name(pair.first);
 
@@ -537,27 +958,27 @@ EnsembleContext::InitStep(size_t step_idx, std::shared_ptr<Step>* step)
 
   // Set requested outputs in request header
   for (const auto& pair : info_->steps_[step_idx].output_to_tensor_) {
-    request_header.add_output()->set_name(pair.first);
+    request_header->add_output()->set_name(pair.first);
   }
 
-  request_header.set_correlation_id(correlation_id_);
-  request_header.set_flags(flags_);
-  request_header.set_batch_size((batch_size == 0 ? 1 : batch_size));
-  RETURN_IF_ERROR(NormalizeRequestHeader(*backend, request_header));
+  request_header->set_correlation_id(correlation_id_);
+  request_header->set_flags(flags_);
+  request_header->set_batch_size((batch_size == 0 ? 1 : batch_size));
+  RETURN_IF_ERROR(NormalizeRequestHeader(*backend, *request_header));
 
-  step->reset(new Step(step_idx));
+  *step = &steps_[step_idx];
   (*step)->backend_ = backend;
   RETURN_IF_ERROR(InferRequestProvider::Create(
       info_->steps_[step_idx].model_name_,
       info_->steps_[step_idx].model_version_, request_header, input_map,
       &((*step)->request_provider_)));
-  // Request header is stored in response provider as reference, so use
-  // header from request provider as the providers have same lifetime
+  // The step is cancelled along with the ensemble request so that it
+  // is dropped if still queued for the step's model.
+  (*step)->request_provider_->SetCancelledFunction(
+      request_provider_->CancelledFunction());
   RETURN_IF_ERROR(InferResponseProvider::Create(
-      (*step)->request_provider_->RequestHeader(),
-      (*step)->backend_->GetLabelProvider(), allocator_.get(), ResponseAlloc,
-      &((*step)->output_map_), ResponseRelease,
-      &((*step)->response_provider_)));
+      request_header, (*step)->backend_->GetLabelProvider(), allocator_.get(),
+      ResponseAlloc, *step, ResponseRelease, &((*step)->response_provider_)));
 
   return Status::Success;
 }
@@ -594,7 +1015,9 @@ EnsembleContext::ReshapeTensorDims(
 Status
 EnsembleContext::FinishEnsemble()
 {
-  stats_->SetModelExecutionCount(1);
+  if (!stats_.empty()) {
+    stats_.front()->SetModelExecutionCount(1);
+  }
   if (ensemble_status_.IsOk()) {
     ensemble_status_ = CheckAndSetEnsembleOutput();
   }
@@ -609,10 +1032,100 @@ EnsembleContext::FinishEnsemble()
   // Reset stats_ to make sure the timers are stopped even though
   // there may be other internal requests (i.e. invoke FinishEnsemble()
   // because of failure in one of the internal requests)
-  stats_.reset();
+  stats_.clear();
   return ensemble_status_;
 }
 
+Status
+EnsembleContext::AllocateEnsembleOutput(
+    Step* step, const std::string& output_name, size_t byte_size,
+    TRTSERVER_Memory_Type memory_type, void** buffer)
+{
+  *buffer = nullptr;
+
+  const auto& output_to_tensor =
+      info_->steps_[step->step_idx_].output_to_tensor_;
+  const auto tensor_it = output_to_tensor.find(output_name);
+  if (tensor_it == output_to_tensor.end()) {
+    return Status::Success;
+  }
+  const std::string& tensor_name = tensor_it->second;
+  const auto shape_it = info_->ensemble_output_shape_.find(tensor_name);
+  if ((shape_it == info_->ensemble_output_shape_.end()) ||
+      !response_provider_->RequiresOutput(tensor_name)) {
+    return Status::Success;
+  }
+
+  // Form the shape of the ensemble output from the shape of the step
+  // output as CheckAndSetEnsembleOutput() does.
+  std::vector<int64_t> step_shape;
+  if (!step->response_provider_->OutputShape(output_name, &step_shape)) {
+    return Status::Success;
+  }
+  const bool step_batching = (step->backend_->Config().max_batch_size() > 0);
+  if (step_batching && step_shape.empty()) {
+    return Status::Success;
+  }
+  const size_t tensor_batch_size = step_batching ? step_shape[0] : 0;
+  DimsList output_dims;
+  for (size_t i = (step_batching ? 1 : 0); i < step_shape.size(); ++i) {
+    output_dims.Add(step_shape[i]);
+  }
+  ReshapeTensorDims(
+      shape_it->second, info_->allow_batching_, tensor_batch_size,
+      &output_dims);
+
+  std::vector<int64_t> shape;
+  if (info_->allow_batching_) {
+    shape.push_back(batch_size_);
+  }
+  for (const auto& dim : output_dims) {
+    shape.push_back(dim);
+  }
+
+  std::lock_guard<std::mutex> lock(output_mu_);
+  RETURN_IF_ERROR(response_provider_->AllocateOutputBuffer(
+      tensor_name, buffer, byte_size, shape, memory_type));
+  if (*buffer != nullptr) {
+    aliased_outputs_.insert(tensor_name);
+  }
+
+  return Status::Success;
+}
+
+void
+EnsembleContext::ReportEarlyOutput(const std::string& name)
+{
+  const auto& output_ready_fn = request_provider_->OutputReadyFunction();
+  if (output_ready_fn == nullptr) {
+    return;
+  }
+  const auto shape_it = info_->ensemble_output_shape_.find(name);
+  if ((shape_it == info_->ensemble_output_shape_.end()) ||
+      !response_provider_->RequiresOutput(name)) {
+    return;
+  }
+
+  // Only contents held in a single buffer are reported, which is
+  // always the case for the outputs of a step.
+  const auto& tensor_data = tensor_data_[name];
+  const auto& memory_block = std::get<2>(tensor_data);
+  size_t content_size;
+  TRTSERVER_Memory_Type memory_type;
+  const char* content = memory_block->BufferAt(0, &content_size, &memory_type);
+  if (content_size != memory_block->TotalByteSize()) {
+    return;
+  }
+
+  DimsList output_dims = std::get<0>(tensor_data).dims();
+  ReshapeTensorDims(
+      shape_it->second, info_->allow_batching_, std::get<1>(tensor_data),
+      &output_dims);
+  std::vector<int64_t> dims(output_dims.begin(), output_dims.end());
+
+  output_ready_fn(name, dims, content, content_size, memory_type);
+}
+
 Status
 EnsembleContext::CheckAndSetEnsembleOutput()
 {
@@ -638,6 +1151,11 @@ EnsembleContext::CheckAndSetEnsembleOutput()
               std::to_string(memory_block->TotalByteSize()));
     }
 
+    // Done with this output if its step wrote it in place.
+    if (aliased_outputs_.find(output_pair.first) != aliased_outputs_.end()) {
+      continue;
+    }
+
     // copy data to ensemble response provider
     size_t expected_byte_size = meta_data.batch_byte_size();
     DimsList output_dims = meta_data.dims();
@@ -748,11 +1266,42 @@ EnsembleContext::CheckAndSetEnsembleOutput()
   return Status::Success;
 }
 
+void
+EnsembleContext::RecordStepStats(
+    EnsembleInfo* info, const Step& step, const ModelInferStats& stats)
+{
+  using TimestampKind = ModelInferStats::TimestampKind;
+  const uint64_t queue_ns =
+      stats.Duration(TimestampKind::kQueueStart, TimestampKind::kComputeStart);
+  const uint64_t input_ns = stats.Duration(
+      TimestampKind::kComputeStart, TimestampKind::kComputeInputEnd);
+  const uint64_t compute_ns = stats.Duration(
+      TimestampKind::kComputeInputEnd, TimestampKind::kComputeEnd);
+
+  auto& step_info = info->steps_[step.step_idx_];
+  {
+    std::lock_guard<std::mutex> lock(info->stats_mu_);
+    step_info.execution_count_++;
+    step_info.queue_ns_ += queue_ns;
+    step_info.input_ns_ += input_ns;
+    step_info.compute_ns_ += compute_ns;
+  }
+
+#ifdef TRTIS_ENABLE_METRICS
+  if (step_info.metric_count_ != nullptr) {
+    step_info.metric_count_->Increment(1);
+    step_info.metric_queue_duration_us_->Increment(queue_ns / 1000);
+    step_info.metric_input_duration_us_->Increment(input_ns / 1000);
+    step_info.metric_compute_duration_us_->Increment(compute_ns / 1000);
+  }
+#endif  // TRTIS_ENABLE_METRICS
+}
+
 void
 EnsembleContext::ScheduleSteps(
     const std::shared_ptr<EnsembleContext>& context, const StepList& steps)
 {
-  for (const auto& step : steps) {
+  for (Step* step : steps) {
     auto infer_stats = std::make_shared<ModelInferStats>(
         context->is_->StatusManager(), step->backend_->Name());
     infer_stats->CaptureTimestamp(
@@ -763,6 +1312,17 @@ EnsembleContext::ScheduleSteps(
         step->request_provider_->RequestHeader().batch_size());
     infer_stats->SetFailed(true);
 
+    // A step is given the deadline of the ensemble request, the latest
+    // deadline when requests are batched, so that it isn't scheduled
+    // once no request in the ensemble can use its result.
+    uint64_t deadline_ns = 0;
+    for (const auto& stats : context->stats_) {
+      deadline_ns = std::max(deadline_ns, stats->Deadline());
+    }
+    if (!context->stats_.empty()) {
+      infer_stats->SetDeadline(deadline_ns);
+    }
+
     context->is_->Infer(
         step->backend_, step->request_provider_, step->response_provider_,
         infer_stats,
@@ -774,11 +1334,16 @@ EnsembleContext::ScheduleSteps(
 
           infer_stats->CaptureTimestamp(
               ModelInferStats::TimestampKind::kRequestEnd);
+          if (status.IsOk()) {
+            RecordStepStats(context->info_, *step, *infer_stats);
+          }
 
           // Accumulate the queue and compute durations from this
           // composing model
-          context->stats_->IncrementQueueDuration(*infer_stats);
-          context->stats_->IncrementComputeDuration(*infer_stats);
+          for (const auto& stats : context->stats_) {
+            stats->IncrementQueueDuration(*infer_stats);
+            stats->IncrementComputeDuration(*infer_stats);
+          }
 
           infer_stats.reset();
 
@@ -788,14 +1353,392 @@ EnsembleContext::ScheduleSteps(
   }
 }
 
+// EnsembleBatch merges a batch of ensemble requests, formed by the
+// ensemble's dynamic batcher, into a single ensemble request. The
+// inputs of the merged request reference the inputs of the individual
+// requests, so no input is copied. The outputs of the merged request
+// are collected in CPU memory and split back into the responses of the
+// individual requests when the merged request completes.
+class EnsembleBatch {
+ public:
+  static Status Create(
+      std::vector<Scheduler::Payload>* payloads,
+      std::shared_ptr<EnsembleBatch>* batch);
+
+  // Copy the outputs of the merged request into the response of each
+  // request in the batch and return the status of the batch. The
+  // status of each request is set in its payload.
+  Status Split(const Status& status);
+
+  const std::shared_ptr<InferRequestProvider>& RequestProvider() const
+  {
+    return request_provider_;
+  }
+
+  const std::shared_ptr<InferResponseProvider>& ResponseProvider() const
+  {
+    return response_provider_;
+  }
+
+ private:
+  explicit EnsembleBatch(std::vector<Scheduler::Payload>* payloads)
+      : payloads_(payloads),
+        allocator_(nullptr, TRTSERVER_ResponseAllocatorDelete)
+  {
+  }
+
+  static TRTSERVER_Error* ResponseAlloc(
+      TRTSERVER_ResponseAllocator* allocator, void** buffer,
+      void** buffer_userp, const char* tensor_name, size_t byte_size,
+      TRTSERVER_Memory_Type memory_type, int64_t memory_type_id, void* userp);
+  static TRTSERVER_Error* ResponseRelease(
+      TRTSERVER_ResponseAllocator* allocator, void* buffer, void* buffer_userp,
+      size_t byte_size, TRTSERVER_Memory_Type memory_type,
+      int64_t memory_type_id);
+
+  std::vector<Scheduler::Payload>* payloads_;
+
+  std::shared_ptr<InferRequestProvider> request_provider_;
+  std::shared_ptr<InferResponseProvider> response_provider_;
+
+  // The output buffers of the merged request.
+  std::unordered_map<std::string, std::shared_ptr<AllocatedSystemMemory>>
+      output_map_;
+
+  std::unique_ptr<
+      TRTSERVER_ResponseAllocator, decltype(&TRTSERVER_ResponseAllocatorDelete)>
+      allocator_;
+};
+
+Status
+EnsembleBatch::Create(
+    std::vector<Scheduler::Payload>* payloads,
+    std::shared_ptr<EnsembleBatch>* batch)
+{
+  batch->reset(new EnsembleBatch(payloads));
+
+  // The dynamic batcher only batches requests whose inputs have the
+  // same shapes, so the merged request has the shapes of the first
+  // request and the sum of the batch sizes and byte sizes.
+  const auto& first_provider = payloads->front().request_provider_;
+  auto request_header =
+      std::make_shared<InferRequestHeader>(first_provider->RequestHeader());
+  request_header->clear_output();
+  request_header->set_batch_size(0);
+  for (auto& input : *request_header->mutable_input()) {
+    input.set_batch_byte_size(0);
+  }
+
+  std::unordered_map<std::string, std::shared_ptr<SystemMemory>> input_map;
+  std::set<std::string> outputs;
+  for (const auto& payload : *payloads) {
+    const auto& payload_header = payload.request_provider_->RequestHeader();
+    request_header->set_batch_size(
+        request_header->batch_size() + payload_header.batch_size());
+
+    for (const auto& payload_input : payload_header.input()) {
+      InferRequestHeader::Input* input = nullptr;
+      for (auto& merged_input : *request_header->mutable_input()) {
+        if (merged_input.name() == payload_input.name()) {
+          input = &merged_input;
+          break;
+        }
+      }
+      if (input == nullptr) {
+        return Status(
+            RequestStatusCode::INTERNAL,
+            "unexpected input '" + payload_input.name() +
+                "' in batched ensemble request");
+      }
+      input->set_batch_byte_size(
+          input->batch_byte_size() + payload_input.batch_byte_size());
+
+      std::shared_ptr<SystemMemory> memory;
+      RETURN_IF_ERROR(payload.request_provider_->GetSystemMemory(
+          payload_input.name(), &memory));
+      auto& merged_memory = input_map[payload_input.name()];
+      if (merged_memory == nullptr) {
+        merged_memory = std::make_shared<SystemMemoryReference>();
+      }
+      auto reference =
+          std::static_pointer_cast<SystemMemoryReference>(merged_memory);
+      size_t idx = 0;
+      size_t byte_size;
+      TRTSERVER_Memory_Type memory_type;
+      const char* buffer = memory->BufferAt(idx, &byte_size, &memory_type);
+      while (buffer != nullptr) {
+        reference->AddBuffer(buffer, byte_size, memory_type);
+        buffer = memory->BufferAt(++idx, &byte_size, &memory_type);
+      }
+    }
+
+    // Classification is done for each request, so the merged request
+    // asks for raw outputs.
+    for (const auto& output : payload_header.output()) {
+      outputs.insert(output.name());
+    }
+  }
+
+  for (const auto& output : outputs) {
+    request_header->add_output()->set_name(output);
+  }
+
+  RETURN_IF_ERROR(InferRequestProvider::Create(
+      first_provider->ModelName(), first_provider->ModelVersion(),
+      request_header, input_map, &((*batch)->request_provider_)));
+
+  // The merged request is cancelled once all of its requests are.
+  std::vector<std::shared_ptr<InferRequestProvider>> providers;
+  for (const auto& payload : *payloads) {
+    if (payload.request_provider_->CancelledFunction() == nullptr) {
+      providers.clear();
+      break;
+    }
+    providers.push_back(payload.request_provider_);
+  }
+  if (!providers.empty()) {
+    (*batch)->request_provider_->SetCancelledFunction([providers]() {
+      for (const auto& provider : providers) {
+        if (!provider->IsCancelled()) {
+          return false;
+        }
+      }
+      return true;
+    });
+  }
+
+  TRTSERVER_ResponseAllocator* allocator;
+  TRTSERVER_Error* err = TRTSERVER_ResponseAllocatorNew(
+      &allocator, ResponseAlloc, ResponseRelease);
+  if (err != nullptr) {
+    Status status = Status(
+        TrtServerCodeToRequestStatus(TRTSERVER_ErrorCode(err)),
+        TRTSERVER_ErrorMessage(err));
+    TRTSERVER_ErrorDelete(err);
+    return status;
+  }
+  (*batch)->allocator_.reset(allocator);
+
+  RETURN_IF_ERROR(InferResponseProvider::Create(
+      (*batch)->request_provider_->SharedRequestHeader(),
+      payloads->front().response_provider_->GetLabelProvider(),
+      (*batch)->allocator_.get(), ResponseAlloc, &((*batch)->output_map_),
+      ResponseRelease, &((*batch)->response_provider_)));
+
+  return Status::Success;
+}
+
+TRTSERVER_Error*
+EnsembleBatch::ResponseAlloc(
+    TRTSERVER_ResponseAllocator* allocator, void** buffer, void** buffer_userp,
+    const char* tensor_name, size_t byte_size,
+    TRTSERVER_Memory_Type memory_type, int64_t memory_type_id, void* userp)
+{
+  auto output_map = reinterpret_cast<
+      std::unordered_map<std::string, std::shared_ptr<AllocatedSystemMemory>>*>(
+      userp);
+
+  *buffer = nullptr;
+  *buffer_userp = nullptr;
+
+  // The merged outputs are split on the host, so only CPU memory is
+  // provided. The caller retries with CPU memory.
+  if (memory_type != TRTSERVER_MEMORY_CPU) {
+    return nullptr;  // Success
+  }
+
+  auto allocated_buffer =
+      std::make_shared<AllocatedSystemMemory>(byte_size, memory_type);
+  TRTSERVER_Memory_Type allocated_memory_type;
+  auto mutable_buffer = allocated_buffer->MutableBuffer(&allocated_memory_type);
+  if ((mutable_buffer != nullptr) || (byte_size == 0)) {
+    if (byte_size != 0) {
+      *buffer = static_cast<void*>(mutable_buffer);
+    }
+    (*output_map)[tensor_name] = std::move(allocated_buffer);
+  }
+
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+EnsembleBatch::ResponseRelease(
+    TRTSERVER_ResponseAllocator* allocator, void* buffer, void* buffer_userp,
+    size_t byte_size, TRTSERVER_Memory_Type memory_type, int64_t memory_type_id)
+{
+  // The buffers are owned by 'output_map_'.
+  return nullptr;  // Success
+}
+
+Status
+EnsembleBatch::Split(const Status& status)
+{
+  if (!status.IsOk()) {
+    return status;
+  }
+
+  const auto& request_header = request_provider_->RequestHeader();
+  for (const auto& output : request_header.output()) {
+    const void* content;
+    size_t content_byte_size;
+    TRTSERVER_Memory_Type memory_type;
+    std::vector<int64_t> shape;
+    RETURN_IF_ERROR(response_provider_->OutputBufferContents(
+        output.name(), &content, &content_byte_size, &memory_type));
+    RETURN_IF_ERROR(
+        response_provider_->OutputBufferShape(output.name(), &shape));
+    if (shape.empty() || (memory_type != TRTSERVER_MEMORY_CPU)) {
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "unexpected batched ensemble output '" + output.name() + "'");
+    }
+
+    InferResponseProvider::SecondaryLabelProvider label_provider;
+    const bool has_label_provider =
+        response_provider_->GetSecondaryLabelProvider(
+            output.name(), &label_provider);
+
+    const size_t batch1_byte_size =
+        content_byte_size / request_header.batch_size();
+    size_t content_offset = 0;
+    for (auto& payload : *payloads_) {
+      const size_t batch_size =
+          payload.request_provider_->RequestHeader().batch_size();
+      const size_t byte_size = batch_size * batch1_byte_size;
+      if (payload.status_.IsOk() &&
+          payload.response_provider_->RequiresOutput(output.name())) {
+        shape[0] = batch_size;
+        void* buffer;
+        payload.status_ = payload.response_provider_->AllocateOutputBuffer(
+            output.name(), &buffer, byte_size, shape, TRTSERVER_MEMORY_CPU);
+        if (payload.status_.IsOk() && (byte_size != 0)) {
+          if (buffer == nullptr) {
+            payload.status_ = Status(
+                RequestStatusCode::INTERNAL,
+                "all attempts to allocate buffer for output '" +
+                    output.name() + "' failed");
+          } else {
+            memcpy(
+                buffer, static_cast<const char*>(content) + content_offset,
+                byte_size);
+          }
+        }
+        if (has_label_provider) {
+          payload.response_provider_->SetSecondaryLabelProvider(
+              output.name(), label_provider);
+        }
+      }
+      content_offset += byte_size;
+    }
+  }
+
+  return Status::Success;
+}
+
 }  // namespace
 
+// Pool of idle ensemble contexts. A context acquired from the pool is
+// returned to it, after being reset, once the last reference to it is
+// released, so the number of contexts, and of the CUDA streams they
+// own, is bounded by the peak number of concurrent ensemble requests.
+class EnsembleContextPool
+    : public std::enable_shared_from_this<EnsembleContextPool> {
+ public:
+  EnsembleContextPool(InferenceServer* is, EnsembleInfo* info)
+      : is_(is), info_(info)
+  {
+  }
+
+  // Return a context initialized for the given request.
+  std::shared_ptr<EnsembleContext> Acquire(
+      const std::vector<std::shared_ptr<ModelInferStats>>& stats,
+      const std::shared_ptr<InferRequestProvider>& request_provider,
+      const std::shared_ptr<InferResponseProvider>& response_provider,
+      std::function<void(const Status&)> OnComplete);
+
+ private:
+  void Release(EnsembleContext* context);
+
+  InferenceServer* const is_;
+  EnsembleInfo* const info_;
+
+  std::mutex mu_;
+  std::vector<std::unique_ptr<EnsembleContext>> idle_contexts_;
+};
+
+std::shared_ptr<EnsembleContext>
+EnsembleContextPool::Acquire(
+    const std::vector<std::shared_ptr<ModelInferStats>>& stats,
+    const std::shared_ptr<InferRequestProvider>& request_provider,
+    const std::shared_ptr<InferResponseProvider>& response_provider,
+    std::function<void(const Status&)> OnComplete)
+{
+  std::unique_ptr<EnsembleContext> context;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!idle_contexts_.empty()) {
+      context = std::move(idle_contexts_.back());
+      idle_contexts_.pop_back();
+    }
+  }
+
+  if (context == nullptr) {
+    context.reset(new EnsembleContext(is_, info_));
+  }
+
+  context->Init(
+      stats, request_provider, response_provider, std::move(OnComplete));
+
+  // The deleter holds a reference to the pool so that the pool
+  // outlives every context that is in use.
+  auto pool = shared_from_this();
+  return std::shared_ptr<EnsembleContext>(
+      context.release(),
+      [pool](EnsembleContext* released) { pool->Release(released); });
+}
+
+void
+EnsembleContextPool::Release(EnsembleContext* context)
+{
+  context->Reset();
+
+  std::lock_guard<std::mutex> lock(mu_);
+  idle_contexts_.emplace_back(context);
+}
+
 Status
 EnsembleScheduler::Create(
     InferenceServer* const server, const ModelConfig& config,
+    const std::shared_ptr<MetricModelReporter>& metric_reporter,
     std::unique_ptr<Scheduler>* scheduler)
 {
-  scheduler->reset(new EnsembleScheduler(server, config));
+  std::unique_ptr<EnsembleScheduler> sched(
+      new EnsembleScheduler(server, config, metric_reporter));
+
+  // The dynamic batcher is given a copy of the configuration with the
+  // ensemble's batching settings as its own. The batcher's run
+  // function only starts the ensemble request, so a single runner is
+  // enough.
+  if (config.ensemble_scheduling().has_dynamic_batching()) {
+    ModelConfig batcher_config(config);
+    *batcher_config.mutable_dynamic_batching() =
+        config.ensemble_scheduling().dynamic_batching();
+
+    EnsembleScheduler* raw = sched.get();
+    auto OnInit = [](uint32_t runner_idx) { return Status::Success; };
+    auto OnSchedule = [raw](
+                          uint32_t runner_idx,
+                          std::vector<Scheduler::Payload>* payloads,
+                          std::function<void(const Status&)> OnComplete) {
+      raw->EnqueueBatch(payloads, OnComplete);
+    };
+    RETURN_IF_ERROR(DynamicBatchScheduler::Create(
+        batcher_config, 1 /* runner_cnt */, OnInit, OnSchedule,
+        nullptr /* OnRelease */, nullptr /* metric_reporter */,
+        &sched->batcher_));
+  }
+
+  scheduler->reset(sched.release());
   return Status::Success;
 }
 
@@ -806,26 +1749,80 @@ EnsembleScheduler::Enqueue(
     const std::shared_ptr<InferResponseProvider>& response_provider,
     std::function<void(const Status&)> OnComplete)
 {
-  std::shared_ptr<EnsembleContext> context(new EnsembleContext(
-      is_, info_.get(), stats, request_provider, response_provider, OnComplete,
-      stream_));
+  // A request that reports outputs early is run on its own since the
+  // outputs of a merged request are only split once it completes.
+  if ((batcher_ != nullptr) &&
+      (request_provider->OutputReadyFunction() == nullptr)) {
+    batcher_->Enqueue(stats, request_provider, response_provider, OnComplete);
+    return;
+  }
+
+  std::shared_ptr<EnsembleContext> context = context_pool_->Acquire(
+      {stats}, request_provider, response_provider, OnComplete);
   EnsembleContext::Proceed(context);
 }
 
-EnsembleScheduler::EnsembleScheduler(
-    InferenceServer* const server, const ModelConfig& config)
-    : is_(server), stream_(nullptr)
+void
+EnsembleScheduler::GetStatus(ModelVersionStatus* status)
 {
-#ifdef TRTIS_ENABLE_GPU
-  // create CUDA stream
-  auto cuerr = cudaStreamCreate(&stream_);
-  if (cuerr != cudaSuccess) {
-    stream_ = nullptr;
-    LOG_ERROR << "unable to create stream for " << config.name() << ": "
-              << cudaGetErrorString(cuerr);
+  EnsembleStatus* es = status->mutable_ensemble_status();
+
+  std::lock_guard<std::mutex> lock(info_->stats_mu_);
+  for (const auto& step_info : info_->steps_) {
+    EnsembleStepStats* ss = es->add_step_stats();
+    ss->set_model_name(step_info.model_name_);
+    ss->set_model_version(step_info.model_version_);
+    ss->mutable_queue()->set_count(step_info.execution_count_);
+    ss->mutable_queue()->set_total_time_ns(step_info.queue_ns_);
+    ss->mutable_input()->set_count(step_info.execution_count_);
+    ss->mutable_input()->set_total_time_ns(step_info.input_ns_);
+    ss->mutable_compute()->set_count(step_info.execution_count_);
+    ss->mutable_compute()->set_total_time_ns(step_info.compute_ns_);
+  }
+}
+
+void
+EnsembleScheduler::EnqueueBatch(
+    std::vector<Scheduler::Payload>* payloads,
+    std::function<void(const Status&)> OnComplete)
+{
+  // A batch of one request doesn't need to be merged.
+  if (payloads->size() == 1) {
+    const auto& payload = payloads->front();
+    std::shared_ptr<EnsembleContext> context = context_pool_->Acquire(
+        {payload.stats_}, payload.request_provider_,
+        payload.response_provider_, OnComplete);
+    EnsembleContext::Proceed(context);
+    return;
+  }
+
+  std::shared_ptr<EnsembleBatch> batch;
+  Status status = EnsembleBatch::Create(payloads, &batch);
+  if (!status.IsOk()) {
+    OnComplete(status);
+    return;
+  }
+
+  std::vector<std::shared_ptr<ModelInferStats>> stats;
+  for (const auto& payload : *payloads) {
+    if (payload.stats_ != nullptr) {
+      stats.push_back(payload.stats_);
+    }
   }
-#endif  // TRTIS_ENABLE_GPU
 
+  std::shared_ptr<EnsembleContext> context = context_pool_->Acquire(
+      stats, batch->RequestProvider(), batch->ResponseProvider(),
+      [batch, OnComplete](const Status& status) {
+        OnComplete(batch->Split(status));
+      });
+  EnsembleContext::Proceed(context);
+}
+
+EnsembleScheduler::EnsembleScheduler(
+    InferenceServer* const server, const ModelConfig& config,
+    const std::shared_ptr<MetricModelReporter>& metric_reporter)
+    : is_(server)
+{
   // Set 'info_' based on 'config'
   info_.reset(new EnsembleInfo());
 
@@ -834,9 +1831,11 @@ EnsembleScheduler::EnsembleScheduler(
 
   for (const auto& input : config.input()) {
     info_->tensor_to_step_.emplace(input.name(), std::set<size_t>());
+    info_->tensor_datatype_.emplace(input.name(), input.data_type());
   }
   for (const auto& output : config.output()) {
     info_->tensor_to_step_.emplace(output.name(), std::set<size_t>());
+    info_->tensor_datatype_.emplace(output.name(), output.data_type());
 
     if (output.has_reshape()) {
       info_->ensemble_output_shape_[output.name()] = output.reshape().shape();
@@ -870,19 +1869,41 @@ EnsembleScheduler::EnsembleScheduler(
 
       info_->tensor_to_prev_step_.emplace(pair.second, step_idx);
     }
+
+    // A conditional step also waits for its condition tensor.
+    if (element.has_condition()) {
+      auto& step_info = info_->steps_[step_idx];
+      step_info.has_condition_ = true;
+      step_info.condition_ = element.condition();
+      info_->tensor_to_step_[element.condition().tensor()].insert(step_idx);
+    }
+
+#ifdef TRTIS_ENABLE_METRICS
+    if (metric_reporter != nullptr) {
+      auto& step_info = info_->steps_[step_idx];
+      step_info.metric_count_ =
+          &metric_reporter->MetricEnsembleStepCount(element.model_name());
+      step_info.metric_queue_duration_us_ =
+          &metric_reporter->MetricEnsembleStepQueueDuration(
+              element.model_name());
+      step_info.metric_input_duration_us_ =
+          &metric_reporter->MetricEnsembleStepInputDuration(
+              element.model_name());
+      step_info.metric_compute_duration_us_ =
+          &metric_reporter->MetricEnsembleStepComputeDuration(
+              element.model_name());
+    }
+#endif  // TRTIS_ENABLE_METRICS
   }
+
+  context_pool_ = std::make_shared<EnsembleContextPool>(is_, info_.get());
 }
 
 EnsembleScheduler::~EnsembleScheduler()
 {
-#ifdef TRTIS_ENABLE_GPU
-  if (stream_ != nullptr) {
-    cudaError_t err = cudaStreamDestroy(stream_);
-    if (err != cudaSuccess) {
-      LOG_ERROR << "Failed to destroy cuda stream: " << cudaGetErrorString(err);
-    }
-  }
-#endif  // TRTIS_ENABLE_GPU
+  // Stop the batcher first since it runs requests through the
+  // ensemble.
+  batcher_.reset();
 }
 
 }}  // namespace nvidia::inferenceserver
@@ -26,23 +26,18 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
+#include "src/core/metric_model_reporter.h"
 #include "src/core/model_config.pb.h"
 #include "src/core/model_config_utils.h"
 #include "src/core/provider.h"
 #include "src/core/scheduler.h"
 #include "src/core/status.h"
 
-#ifdef TRTIS_ENABLE_GPU
-#include <cuda_runtime_api.h>
-#endif  // TRTIS_ENABLE_GPU
-
 namespace nvidia { namespace inferenceserver {
 
-#ifndef TRTIS_ENABLE_GPU
-using cudaStream_t = void*;
-#endif  // TRTIS_ENABLE_GPU
-
 class InferenceServer;
+class EnsembleContextPool;
 
 struct EnsembleInfo {
   struct StepInfo {
@@ -55,6 +50,25 @@ struct EnsembleInfo {
     int64_t model_version_;
     std::unordered_map<std::string, std::string> input_to_tensor_;
     std::unordered_map<std::string, std::string> output_to_tensor_;
+
+    // The condition that must hold for the step to be executed, if
+    // 'has_condition_' is true.
+    bool has_condition_ = false;
+    ModelEnsembling::Step::Condition condition_;
+
+    // Cumulative durations, in nanoseconds, of the successful
+    // executions of the step. Protected by EnsembleInfo::stats_mu_.
+    uint64_t execution_count_ = 0;
+    uint64_t queue_ns_ = 0;
+    uint64_t input_ns_ = 0;
+    uint64_t compute_ns_ = 0;
+
+#ifdef TRTIS_ENABLE_METRICS
+    prometheus::Counter* metric_count_ = nullptr;
+    prometheus::Counter* metric_queue_duration_us_ = nullptr;
+    prometheus::Counter* metric_input_duration_us_ = nullptr;
+    prometheus::Counter* metric_compute_duration_us_ = nullptr;
+#endif  // TRTIS_ENABLE_METRICS
   };
 
   std::string ensemble_name_;
@@ -64,6 +78,9 @@ struct EnsembleInfo {
   // the ensemble output (re)shape expected by the ensemble
   std::unordered_map<std::string, DimsList> ensemble_output_shape_;
 
+  // the data type of the ensemble inputs and outputs
+  std::unordered_map<std::string, DataType> tensor_datatype_;
+
   std::vector<StepInfo> steps_;
 
   // Only include a step if the ensemble tensor is used as input in that step
@@ -71,6 +88,9 @@ struct EnsembleInfo {
 
   // backward path, ensemble tensor to the step that provides its data
   std::unordered_map<std::string, size_t> tensor_to_prev_step_;
+
+  // Protects the step statistics in 'steps_'.
+  std::mutex stats_mu_;
 };
 
 // Scheduler that implements ensemble scheduling.
@@ -80,6 +100,7 @@ class EnsembleScheduler : public Scheduler {
   // to dispatch requests to models in ensemble internally.
   static Status Create(
       InferenceServer* const server, const ModelConfig& config,
+      const std::shared_ptr<MetricModelReporter>& metric_reporter,
       std::unique_ptr<Scheduler>* scheduler);
 
   ~EnsembleScheduler();
@@ -91,16 +112,33 @@ class EnsembleScheduler : public Scheduler {
       const std::shared_ptr<InferResponseProvider>& response_provider,
       std::function<void(const Status&)> OnComplete) override;
 
+  // \see Scheduler::GetStatus()
+  void GetStatus(ModelVersionStatus* status) override;
+
  private:
-  EnsembleScheduler(InferenceServer* const server, const ModelConfig& config);
+  EnsembleScheduler(
+      InferenceServer* const server, const ModelConfig& config,
+      const std::shared_ptr<MetricModelReporter>& metric_reporter);
+
+  // Run the requests in 'payloads', formed by the dynamic batcher, as
+  // a single ensemble request and call 'OnComplete' when all of them
+  // are complete.
+  void EnqueueBatch(
+      std::vector<Scheduler::Payload>* payloads,
+      std::function<void(const Status&)> OnComplete);
 
   InferenceServer* const is_;
 
   // Ensemble information that is built from model config
   std::unique_ptr<EnsembleInfo> info_;
 
-  // The stream used for data transfer.
-  cudaStream_t stream_;
+  // The contexts used to run ensemble requests, recycled across
+  // requests.
+  std::shared_ptr<EnsembleContextPool> context_pool_;
+
+  // The dynamic batcher that merges requests before they enter the
+  // ensemble, or nullptr if the ensemble doesn't batch requests.
+  std::unique_ptr<Scheduler> batcher_;
 };
 
 }}  // namespace nvidia::inferenceserver
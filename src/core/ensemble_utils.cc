@@ -314,6 +314,33 @@ ValidateEnsembleConfig(
         ensemble_name, step, model_config, &ensemble_tensors));
   }
 
+  // The condition of a step is evaluated on the tensor values, so the
+  // tensor must have a data type that can be compared with the
+  // threshold.
+  for (const auto& step : ensemble_config.ensemble_scheduling().step()) {
+    if (!step.has_condition()) {
+      continue;
+    }
+    const auto& condition_tensor = step.condition().tensor();
+    auto it = ensemble_tensors.find(condition_tensor);
+    if (it == ensemble_tensors.end()) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "in ensemble " + ensemble_name + ", condition tensor " +
+              condition_tensor + " of model " + step.model_name() +
+              " is not an ensemble tensor");
+    }
+    const DataType type = it->second.type_;
+    if ((type == TYPE_INVALID) || (type == TYPE_FP16) ||
+        (type == TYPE_STRING)) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "in ensemble " + ensemble_name + ", condition tensor " +
+              condition_tensor + " of model " + step.model_name() +
+              " has unsupported data type " + DataType_Name(type));
+    }
+  }
+
   return Status::Success;
 }
 
@@ -41,12 +41,26 @@
 #include <aws/s3/model/ListObjectsRequest.h>
 #endif  // TRTIS_ENABLE_S3
 
+#include <fcntl.h>
 #include <google/protobuf/text_format.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <utime.h>
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <fstream>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include "src/core/constants.h"
+#include "src/core/logging.h"
 
 namespace nvidia { namespace inferenceserver {
 
@@ -64,10 +78,23 @@ class FileSystem {
       const std::string& path, std::set<std::string>* subdirs) = 0;
   virtual Status GetDirectoryFiles(
       const std::string& path, std::set<std::string>* files) = 0;
+  virtual Status GetDirectoryFileVersions(
+      const std::string& path,
+      std::map<std::string, std::string>* versions) = 0;
   virtual Status ReadTextFile(
       const std::string& path, std::string* contents) = 0;
   virtual Status WriteTextFile(
       const std::string& path, const std::string& contents) = 0;
+
+  // Return the address and byte size of the contents of the file
+  // mapped into memory. Return false in 'mapped' if the file system
+  // can't map files, the caller must read the file instead.
+  virtual Status MapFile(
+      const std::string& path, bool* mapped, void** base, size_t* byte_size)
+  {
+    *mapped = false;
+    return Status::Success;
+  }
 };
 
 class LocalFileSystem : public FileSystem {
@@ -82,9 +109,15 @@ class LocalFileSystem : public FileSystem {
       const std::string& path, std::set<std::string>* subdirs) override;
   Status GetDirectoryFiles(
       const std::string& path, std::set<std::string>* files) override;
+  Status GetDirectoryFileVersions(
+      const std::string& path,
+      std::map<std::string, std::string>* versions) override;
   Status ReadTextFile(const std::string& path, std::string* contents) override;
   Status WriteTextFile(
       const std::string& path, const std::string& contents) override;
+  Status MapFile(
+      const std::string& path, bool* mapped, void** base,
+      size_t* byte_size) override;
 };
 
 
@@ -185,6 +218,38 @@ LocalFileSystem::GetDirectoryFiles(
   return Status::Success;
 }
 
+Status
+LocalFileSystem::GetDirectoryFileVersions(
+    const std::string& path, std::map<std::string, std::string>* versions)
+{
+  std::set<std::string> contents;
+  RETURN_IF_ERROR(GetDirectoryContents(path, &contents));
+
+  for (const auto& name : contents) {
+    const std::string full_path = JoinPath({path, name});
+    struct stat st;
+    if (stat(full_path.c_str(), &st) != 0) {
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "failed to stat file " + full_path + ": " + strerror(errno));
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+      std::map<std::string, std::string> subdir_versions;
+      RETURN_IF_ERROR(GetDirectoryFileVersions(full_path, &subdir_versions));
+      for (const auto& version : subdir_versions) {
+        versions->emplace(JoinPath({name, version.first}), version.second);
+      }
+    } else {
+      versions->emplace(
+          name, std::to_string(TIMESPEC_TO_NANOS(st.st_mtim)) + ":" +
+                    std::to_string(st.st_size));
+    }
+  }
+
+  return Status::Success;
+}
+
 Status
 LocalFileSystem::ReadTextFile(const std::string& path, std::string* contents)
 {
@@ -204,6 +269,46 @@ LocalFileSystem::ReadTextFile(const std::string& path, std::string* contents)
   return Status::Success;
 }
 
+Status
+LocalFileSystem::MapFile(
+    const std::string& path, bool* mapped, void** base, size_t* byte_size)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "failed to open file for mapping " + path + ": " + strerror(errno));
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "failed to stat file " + path + ": " + strerror(errno));
+  }
+
+  // An empty file can't be mapped, it is read instead.
+  *mapped = (st.st_size > 0);
+  if (*mapped) {
+    *byte_size = st.st_size;
+    *base = mmap(nullptr, *byte_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (*base == MAP_FAILED) {
+      close(fd);
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "failed to map file " + path + ": " + strerror(errno));
+    }
+
+    // Model files are deserialized from start to end.
+    madvise(*base, *byte_size, MADV_SEQUENTIAL);
+  }
+
+  // The mapping stays valid after the file is closed.
+  close(fd);
+  return Status::Success;
+}
+
 Status
 LocalFileSystem::WriteTextFile(
     const std::string& path, const std::string& contents)
@@ -221,6 +326,298 @@ LocalFileSystem::WriteTextFile(
   return Status::Success;
 }
 
+// Local disk cache of the files read from the remote file
+// systems. The cached copy of a file is named by a hash of its path
+// and of the version of the remote object (the GCS generation or the
+// S3 ETag), so a changed object is never read from a stale copy and
+// the copies survive a restart of the server. When the cached files
+// exceed the size limit the least recently used ones are removed.
+class RemoteFileCache {
+ public:
+  static RemoteFileCache* Instance()
+  {
+    static RemoteFileCache cache;
+    return &cache;
+  }
+
+  Status SetDirectory(const std::string& dir, const uint64_t byte_size_limit);
+
+  // Return true and the cached contents of version 'version' of
+  // 'path', or false if it is not cached.
+  bool Read(
+      const std::string& path, const std::string& version,
+      std::string* contents);
+
+  // Add the contents of version 'version' of 'path' to the cache.
+  void Write(
+      const std::string& path, const std::string& version,
+      const std::string& contents);
+
+ private:
+  RemoteFileCache() : byte_size_limit_(0), byte_size_(0) {}
+
+  std::string CacheFileName(
+      const std::string& path, const std::string& version) const;
+
+  // Remove the least recently used files until the cache is within
+  // the size limit. Must be called with 'mu_' held.
+  void Evict();
+
+  std::mutex mu_;
+  std::string dir_;
+  uint64_t byte_size_limit_;
+  uint64_t byte_size_;
+
+  // The cached file names, most recently used first, and for each
+  // name its position in 'lru_' and its byte size.
+  std::list<std::string> lru_;
+  std::unordered_map<
+      std::string, std::pair<std::list<std::string>::iterator, uint64_t>>
+      files_;
+
+  LocalFileSystem local_fs_;
+};
+
+Status
+RemoteFileCache::SetDirectory(
+    const std::string& dir, const uint64_t byte_size_limit)
+{
+  std::lock_guard<std::mutex> lock(mu_);
+
+  dir_ = dir;
+  byte_size_limit_ = byte_size_limit;
+  byte_size_ = 0;
+  lru_.clear();
+  files_.clear();
+  if (dir_.empty()) {
+    return Status::Success;
+  }
+
+  DIR* d = opendir(dir_.c_str());
+  if (d == nullptr) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "failed to open remote repository cache directory " + dir_ + ": " +
+            strerror(errno));
+  }
+
+  // Pick up the files cached before a restart, using the modification
+  // time, which is updated on every cache hit, as the last use.
+  std::vector<std::pair<int64_t, std::string>> cached;
+  struct dirent* entry;
+  while ((entry = readdir(d)) != nullptr) {
+    const std::string name(entry->d_name);
+    struct stat st;
+    if ((name.find('.') != std::string::npos) ||
+        (stat(JoinPath({dir_, name}).c_str(), &st) != 0) ||
+        !S_ISREG(st.st_mode)) {
+      continue;
+    }
+
+    cached.emplace_back(TIMESPEC_TO_NANOS(st.st_mtim), name);
+    files_[name].second = st.st_size;
+    byte_size_ += st.st_size;
+  }
+  closedir(d);
+
+  std::sort(cached.rbegin(), cached.rend());
+  for (const auto& file : cached) {
+    files_[file.second].first = lru_.insert(lru_.end(), file.second);
+  }
+
+  Evict();
+
+  LOG_INFO << "Caching remote repository files in " << dir_ << ", "
+           << files_.size() << " files cached";
+  return Status::Success;
+}
+
+std::string
+RemoteFileCache::CacheFileName(
+    const std::string& path, const std::string& version) const
+{
+  // FNV-1a, which unlike std::hash gives the same name in every run
+  // of the server.
+  uint64_t hash = 14695981039346656037ULL;
+  for (const std::string& s : {path, std::string(1, '\0'), version}) {
+    for (const char c : s) {
+      hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ULL;
+    }
+  }
+
+  char name[17];
+  snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+  return name;
+}
+
+bool
+RemoteFileCache::Read(
+    const std::string& path, const std::string& version,
+    std::string* contents)
+{
+  const std::string name = CacheFileName(path, version);
+  const std::string cache_path = JoinPath({dir_, name});
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (dir_.empty()) {
+      return false;
+    }
+
+    auto itr = files_.find(name);
+    if (itr == files_.end()) {
+      return false;
+    }
+
+    lru_.splice(lru_.begin(), lru_, itr->second.first);
+    utime(cache_path.c_str(), nullptr);
+  }
+
+  // Read outside of the lock so that the models loading in parallel
+  // don't wait for each other. A file evicted after the lookup is
+  // simply read from the remote file system again.
+  if (!local_fs_.ReadTextFile(cache_path, contents).IsOk()) {
+    return false;
+  }
+
+  LOG_VERBOSE(1) << "Read " << path << " from remote repository cache "
+                 << cache_path;
+  return true;
+}
+
+void
+RemoteFileCache::Write(
+    const std::string& path, const std::string& version,
+    const std::string& contents)
+{
+  std::string dir;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if ((byte_size_limit_ != 0) && (contents.size() > byte_size_limit_)) {
+      return;
+    }
+    dir = dir_;
+  }
+  if (dir.empty()) {
+    return;
+  }
+
+  // Write to a temporary name first so that a partially written file
+  // is never found in the cache. The temporary names contain a '.' so
+  // they are ignored when the cache is picked up after a restart.
+  const std::string name = CacheFileName(path, version);
+  const std::string cache_path = JoinPath({dir, name});
+  std::stringstream tmp_name;
+  tmp_name << name << ".tmp" << std::this_thread::get_id();
+  const std::string tmp_path = JoinPath({dir, tmp_name.str()});
+
+  Status status = local_fs_.WriteTextFile(tmp_path, contents);
+  if (status.IsOk() && (rename(tmp_path.c_str(), cache_path.c_str()) != 0)) {
+    status = Status(
+        RequestStatusCode::INTERNAL,
+        "failed to rename " + tmp_path + ": " + strerror(errno));
+  }
+  if (!status.IsOk()) {
+    LOG_WARNING << "failed to cache " << path << ": " << status.Message();
+    unlink(tmp_path.c_str());
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mu_);
+  auto itr = files_.find(name);
+  if (itr != files_.end()) {
+    byte_size_ -= itr->second.second;
+    lru_.erase(itr->second.first);
+  }
+
+  files_[name] =
+      std::make_pair(lru_.insert(lru_.begin(), name), contents.size());
+  byte_size_ += contents.size();
+  Evict();
+}
+
+void
+RemoteFileCache::Evict()
+{
+  while ((byte_size_limit_ != 0) && (byte_size_ > byte_size_limit_) &&
+         !lru_.empty()) {
+    const std::string& name = lru_.back();
+    auto itr = files_.find(name);
+    byte_size_ -= itr->second.second;
+    unlink(JoinPath({dir_, name}).c_str());
+    LOG_VERBOSE(1) << "Evicted " << name << " from remote repository cache";
+    files_.erase(itr);
+    lru_.pop_back();
+  }
+}
+
+// The size of the parts that the remote file systems download in
+// parallel, and the number of parts downloaded at the same time.
+uint64_t remote_download_part_byte_size_ = 64 * 1024 * 1024;
+uint32_t remote_download_concurrency_ = 8;
+
+#if defined(TRTIS_ENABLE_GCS) || defined(TRTIS_ENABLE_S3)
+// Read 'byte_size' bytes of the remote file 'path' into 'contents' in
+// parts of at most 'remote_download_part_byte_size_' bytes, of which
+// up to 'remote_download_concurrency_' are read at the same
+// time. 'ReadRange' reads 'size' bytes starting at 'offset' into
+// 'dst', it is called from multiple threads.
+Status
+ParallelDownload(
+    const std::string& path, const uint64_t byte_size,
+    const std::function<Status(uint64_t offset, uint64_t size, char* dst)>&
+        ReadRange,
+    std::string* contents)
+{
+  contents->resize(byte_size);
+  if (byte_size == 0) {
+    return Status::Success;
+  }
+
+  const uint64_t part_size =
+      std::max(remote_download_part_byte_size_, (uint64_t)1);
+  const uint64_t part_cnt = (byte_size + part_size - 1) / part_size;
+
+  std::atomic<uint64_t> next_part(0);
+  std::mutex mu;
+  Status status;
+  auto DownloadParts = [&]() {
+    uint64_t part;
+    while ((part = next_part++) < part_cnt) {
+      const uint64_t offset = part * part_size;
+      const uint64_t size = std::min(part_size, byte_size - offset);
+      Status part_status = ReadRange(offset, size, &(*contents)[offset]);
+      if (!part_status.IsOk()) {
+        // Skip the remaining parts.
+        next_part = part_cnt;
+        std::lock_guard<std::mutex> lock(mu);
+        status = part_status;
+      }
+    }
+  };
+
+  // The calling thread downloads parts too.
+  std::vector<std::thread> threads;
+  const uint64_t thread_cnt =
+      std::min(part_cnt, (uint64_t)std::max(remote_download_concurrency_, 1u));
+  for (uint64_t i = 1; i < thread_cnt; ++i) {
+    threads.emplace_back(DownloadParts);
+  }
+  DownloadParts();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  if (!status.IsOk()) {
+    return Status(
+        status.Code(), "failed to download " + path + ": " + status.Message());
+  }
+
+  LOG_VERBOSE(1) << "Downloaded " << path << ", " << byte_size << " bytes in "
+                 << part_cnt << " parts";
+  return Status::Success;
+}
+#endif  // TRTIS_ENABLE_GCS || TRTIS_ENABLE_S3
+
 #ifdef TRTIS_ENABLE_GCS
 
 namespace gcs = google::cloud::storage;
@@ -239,6 +636,9 @@ class GCSFileSystem : public FileSystem {
       const std::string& path, std::set<std::string>* subdirs) override;
   Status GetDirectoryFiles(
       const std::string& path, std::set<std::string>* files) override;
+  Status GetDirectoryFileVersions(
+      const std::string& path,
+      std::map<std::string, std::string>* versions) override;
   Status ReadTextFile(const std::string& path, std::string* contents) override;
   Status WriteTextFile(
       const std::string& path, const std::string& contents) override;
@@ -478,34 +878,81 @@ GCSFileSystem::GetDirectoryFiles(
 }
 
 Status
-GCSFileSystem::ReadTextFile(const std::string& path, std::string* contents)
+GCSFileSystem::GetDirectoryFileVersions(
+    const std::string& path, std::map<std::string, std::string>* versions)
 {
-  bool exists;
-  RETURN_IF_ERROR(FileExists(path, &exists));
+  std::string bucket, dir_path;
+  RETURN_IF_ERROR(ParsePath(path, &bucket, &dir_path));
+  std::string full_dir = AppendSlash(dir_path);
 
-  if (!exists) {
-    return Status(
-        RequestStatusCode::INTERNAL, "File does not exist at " + path);
+  // A single listing returns all the objects below the directory with
+  // their generation.
+  for (auto&& object_metadata :
+       client_->ListObjects(bucket, gcs::Prefix(full_dir))) {
+    if (!object_metadata) {
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "Could not list contents of directory at " + path);
+    }
+
+    const std::string& name = object_metadata->name();
+    if ((name.size() > full_dir.size()) && (name.back() != '/')) {
+      versions->emplace(
+          name.substr(full_dir.size()),
+          std::to_string(object_metadata->generation()));
+    }
   }
 
-  std::string bucket, object;
-  ParsePath(path, &bucket, &object);
+  return Status::Success;
+}
 
-  gcs::ObjectReadStream stream = client_->ReadObject(bucket, object);
+Status
+GCSFileSystem::ReadTextFile(const std::string& path, std::string* contents)
+{
+  std::string bucket, object;
+  RETURN_IF_ERROR(ParsePath(path, &bucket, &object));
 
-  if (!stream) {
+  google::cloud::StatusOr<gcs::ObjectMetadata> object_metadata =
+      client_->GetObjectMetadata(bucket, object);
+  if (!object_metadata) {
     return Status(
-        RequestStatusCode::INTERNAL,
-        "Failed to open object read stream for " + path);
+        RequestStatusCode::INTERNAL, "File does not exist at " + path);
   }
 
-  std::string data = "";
-  char c;
-  while (stream.get(c)) {
-    data += c;
+  // The generation of an object changes whenever it is overwritten.
+  const std::string generation =
+      std::to_string(object_metadata->generation());
+  if (RemoteFileCache::Instance()->Read(path, generation, contents)) {
+    return Status::Success;
   }
 
-  *contents = data;
+  // Read the generation found above so that the cached copy matches it.
+  const int64_t generation_id = object_metadata->generation();
+  RETURN_IF_ERROR(ParallelDownload(
+      path, object_metadata->size(),
+      [this, &bucket, &object, generation_id](
+          uint64_t offset, uint64_t size, char* dst) {
+        gcs::ObjectReadStream stream = client_->ReadObject(
+            bucket, object, gcs::Generation(generation_id),
+            gcs::ReadRange(offset, offset + size));
+        if (!stream) {
+          return Status(
+              RequestStatusCode::INTERNAL, "Failed to open object read stream");
+        }
+
+        stream.read(dst, size);
+        if ((uint64_t)stream.gcount() != size) {
+          return Status(
+              RequestStatusCode::INTERNAL,
+              "Unexpected end of object read stream at byte " +
+                  std::to_string(offset + stream.gcount()));
+        }
+
+        return Status::Success;
+      },
+      contents));
+
+  RemoteFileCache::Instance()->Write(path, generation, *contents);
 
   return Status::Success;
 }
@@ -539,6 +986,9 @@ class S3FileSystem : public FileSystem {
       const std::string& path, std::set<std::string>* subdirs) override;
   Status GetDirectoryFiles(
       const std::string& path, std::set<std::string>* files) override;
+  Status GetDirectoryFileVersions(
+      const std::string& path,
+      std::map<std::string, std::string>* versions) override;
   Status ReadTextFile(const std::string& path, std::string* contents) override;
   Status WriteTextFile(
       const std::string& path, const std::string& contents) override;
@@ -770,41 +1220,105 @@ S3FileSystem::GetDirectoryFiles(
 
   return Status::Success;
 }
+
 Status
-S3FileSystem::ReadTextFile(const std::string& path, std::string* contents)
+S3FileSystem::GetDirectoryFileVersions(
+    const std::string& path, std::map<std::string, std::string>* versions)
 {
-  bool exists;
-  RETURN_IF_ERROR(FileExists(path, &exists));
+  std::string bucket, dir_path;
+  RETURN_IF_ERROR(ParsePath(path, &bucket, &dir_path));
+  std::string full_dir = AppendSlash(dir_path);
 
-  if (!exists) {
-    return Status(
-        RequestStatusCode::INTERNAL, "File does not exist at " + path);
+  // A listing returns the objects below the directory with their ETag,
+  // at most 1000 at a time.
+  s3::Model::ListObjectsRequest objects_request;
+  objects_request.SetBucket(bucket.c_str());
+  objects_request.SetPrefix(full_dir.c_str());
+  while (true) {
+    auto list_objects_outcome = client_.ListObjects(objects_request);
+    if (!list_objects_outcome.IsSuccess()) {
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "Failed to list directory contents with at " + path);
+    }
+
+    const auto& result = list_objects_outcome.GetResult();
+    for (const auto& s3_object : result.GetContents()) {
+      const std::string name(s3_object.GetKey().c_str());
+      if ((name.size() > full_dir.size()) && (name.back() != '/')) {
+        versions->emplace(
+            name.substr(full_dir.size()), s3_object.GetETag().c_str());
+      }
+    }
+
+    if (!result.GetIsTruncated() || result.GetContents().empty()) {
+      break;
+    }
+    objects_request.SetMarker(result.GetContents().back().GetKey());
   }
 
+  return Status::Success;
+}
+Status
+S3FileSystem::ReadTextFile(const std::string& path, std::string* contents)
+{
   std::string bucket, object;
   RETURN_IF_ERROR(ParsePath(path, &bucket, &object));
 
-  // Send a request for the objects metadata
-  s3::Model::GetObjectRequest object_request;
-  object_request.SetBucket(bucket.c_str());
-  object_request.SetKey(object.c_str());
-
-  auto get_object_outcome = client_.GetObject(object_request);
-  if (get_object_outcome.IsSuccess()) {
-    auto& object_result = get_object_outcome.GetResultWithOwnership().GetBody();
-
-    std::string data = "";
-    char c;
-    while (object_result.get(c)) {
-      data += c;
-    }
+  s3::Model::HeadObjectRequest head_request;
+  head_request.SetBucket(bucket.c_str());
+  head_request.SetKey(object.c_str());
 
-    *contents = data;
-  } else {
+  auto head_object_outcome = client_.HeadObject(head_request);
+  if (!head_object_outcome.IsSuccess()) {
     return Status(
-        RequestStatusCode::INTERNAL, "Failed to get object at " + path);
+        RequestStatusCode::INTERNAL, "File does not exist at " + path);
   }
 
+  // The ETag of an object changes whenever it is overwritten.
+  const std::string etag(head_object_outcome.GetResult().GetETag().c_str());
+  if (RemoteFileCache::Instance()->Read(path, etag, contents)) {
+    return Status::Success;
+  }
+
+  // Send ranged requests for the object, matching the ETag found
+  // above so that the cached copy matches it.
+  RETURN_IF_ERROR(ParallelDownload(
+      path, head_object_outcome.GetResult().GetContentLength(),
+      [this, &bucket, &object, &etag](
+          uint64_t offset, uint64_t size, char* dst) {
+        s3::Model::GetObjectRequest object_request;
+        object_request.SetBucket(bucket.c_str());
+        object_request.SetKey(object.c_str());
+        object_request.SetIfMatch(etag.c_str());
+        object_request.SetRange(
+            ("bytes=" + std::to_string(offset) + "-" +
+             std::to_string(offset + size - 1))
+                .c_str());
+
+        auto get_object_outcome = client_.GetObject(object_request);
+        if (!get_object_outcome.IsSuccess()) {
+          return Status(
+              RequestStatusCode::INTERNAL,
+              std::string("Failed to get object: ") +
+                  get_object_outcome.GetError().GetMessage().c_str());
+        }
+
+        auto& body = get_object_outcome.GetResult().GetBody();
+        body.read(dst, size);
+        if ((uint64_t)body.gcount() != size) {
+          return Status(
+              RequestStatusCode::INTERNAL,
+              "Unexpected end of object at byte " +
+                  std::to_string(offset + body.gcount()));
+        }
+
+        return Status::Success;
+      },
+      contents));
+
+  RemoteFileCache::Instance()->Write(path, etag, *contents);
+
   return Status::Success;
 }
 Status
@@ -994,6 +1508,15 @@ GetDirectoryFiles(const std::string& path, std::set<std::string>* files)
   return fs->GetDirectoryFiles(path, files);
 }
 
+Status
+GetDirectoryFileVersions(
+    const std::string& path, std::map<std::string, std::string>* versions)
+{
+  FileSystem* fs;
+  RETURN_IF_ERROR(GetFileSystem(path, &fs));
+  return fs->GetDirectoryFileVersions(path, versions);
+}
+
 Status
 ReadTextFile(const std::string& path, std::string* contents)
 {
@@ -1002,6 +1525,56 @@ ReadTextFile(const std::string& path, std::string* contents)
   return fs->ReadTextFile(path, contents);
 }
 
+MappedFile::~MappedFile()
+{
+  if (mapped_) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+Status
+MapFile(const std::string& path, std::shared_ptr<MappedFile>* file)
+{
+  FileSystem* fs;
+  RETURN_IF_ERROR(GetFileSystem(path, &fs));
+
+  std::shared_ptr<MappedFile> lfile(new MappedFile());
+  void* base = nullptr;
+  RETURN_IF_ERROR(fs->MapFile(path, &lfile->mapped_, &base, &lfile->size_));
+  if (lfile->mapped_) {
+    lfile->data_ = reinterpret_cast<const char*>(base);
+  } else {
+    RETURN_IF_ERROR(fs->ReadTextFile(path, &lfile->contents_));
+    lfile->data_ = lfile->contents_.data();
+    lfile->size_ = lfile->contents_.size();
+  }
+
+  *file = std::move(lfile);
+  return Status::Success;
+}
+
+Status
+WriteTextFile(const std::string& path, const std::string& contents)
+{
+  FileSystem* fs;
+  RETURN_IF_ERROR(GetFileSystem(path, &fs));
+  return fs->WriteTextFile(path, contents);
+}
+
+Status
+SetRemoteFileCache(const std::string& dir, const uint64_t byte_size_limit)
+{
+  return RemoteFileCache::Instance()->SetDirectory(dir, byte_size_limit);
+}
+
+void
+SetRemoteDownloadParallelism(
+    const uint64_t part_byte_size, const uint32_t concurrency)
+{
+  remote_download_part_byte_size_ = part_byte_size;
+  remote_download_concurrency_ = concurrency;
+}
+
 Status
 ReadTextProto(const std::string& path, google::protobuf::Message* msg)
 {
@@ -1037,11 +1610,11 @@ WriteTextProto(const std::string& path, const google::protobuf::Message& msg)
 Status
 ReadBinaryProto(const std::string& path, google::protobuf::MessageLite* msg)
 {
-  std::string msg_str;
-  RETURN_IF_ERROR(ReadTextFile(path, &msg_str));
+  std::shared_ptr<MappedFile> file;
+  RETURN_IF_ERROR(MapFile(path, &file));
 
   google::protobuf::io::CodedInputStream coded_stream(
-      reinterpret_cast<const uint8_t*>(msg_str.c_str()), msg_str.size());
+      reinterpret_cast<const uint8_t*>(file->Data()), file->Size());
   coded_stream.SetTotalBytesLimit(INT_MAX, INT_MAX);
   if (!msg->ParseFromCodedStream(&coded_stream)) {
     return Status(
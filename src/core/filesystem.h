@@ -25,6 +25,8 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <map>
+#include <memory>
 #include <string>
 #include "google/protobuf/message.h"
 #include "src/core/status.h"
@@ -89,12 +91,79 @@ Status GetDirectorySubdirs(
 /// \return Error status
 Status GetDirectoryFiles(const std::string& path, std::set<std::string>* files);
 
+/// Cache the files read from remote file systems (GCS and S3) in a
+/// local directory, so that loading a model again, also after a
+/// restart, doesn't download the files that haven't changed.
+/// \param dir The cache directory, which must exist, or empty to not
+/// cache the files.
+/// \param byte_size_limit The size of the cached files above which the
+/// least recently used ones are removed, or 0 for no limit.
+/// \return Error status
+Status SetRemoteFileCache(
+    const std::string& dir, const uint64_t byte_size_limit);
+
+/// Set how the files are downloaded from remote file systems (GCS and
+/// S3). A file is downloaded in parts using ranged reads, of which
+/// several are read at the same time.
+/// \param part_byte_size The maximum byte size of each part.
+/// \param concurrency The maximum number of parts of a file read at
+/// the same time.
+void SetRemoteDownloadParallelism(
+    const uint64_t part_byte_size, const uint32_t concurrency);
+
+/// Get the version of each file below a directory, at any depth. The
+/// version of a file changes whenever the file is modified. On Google
+/// Cloud Storage and Amazon S3 the versions of all the files are
+/// returned by listing the directory once.
+/// \param path The directory.
+/// \param versions Returns the version of each file, keyed by the
+/// path of the file relative to 'path'.
+/// \return Error status
+Status GetDirectoryFileVersions(
+    const std::string& path, std::map<std::string, std::string>* versions);
+
 /// Read a text file into a string.
 /// \param path The path of the file.
 /// \param contents Returns the contents of the file.
 /// \return Error status
 Status ReadTextFile(const std::string& path, std::string* contents);
 
+/// The read-only contents of a file. A file on the local file system
+/// is mapped into memory, so its pages are read from disk only when
+/// they are used, are shared with every other mapping of the file,
+/// and are released when the object is destroyed. A file on a remote
+/// file system is read into memory.
+class MappedFile {
+ public:
+  ~MappedFile();
+
+  /// \return The contents of the file.
+  const char* Data() const { return data_; }
+
+  /// \return The byte size of the file.
+  size_t Size() const { return size_; }
+
+ private:
+  friend Status MapFile(
+      const std::string& path, std::shared_ptr<MappedFile>* file);
+  MappedFile() : data_(nullptr), size_(0), mapped_(false) {}
+
+  const char* data_;
+  size_t size_;
+
+  // True if 'data_' is mapped, otherwise 'data_' points into
+  // 'contents_'.
+  bool mapped_;
+  std::string contents_;
+};
+
+/// Map a file into memory, or read it into memory if it is not on
+/// the local file system.
+/// \param path The path of the file.
+/// \param file Returns the contents of the file.
+/// \return Error status
+Status MapFile(const std::string& path, std::shared_ptr<MappedFile>* file);
+
 /// Write a string to a file.
 /// \param path The path of the file.
 /// \param contents The contents to write to the file.
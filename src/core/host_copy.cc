@@ -0,0 +1,262 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "src/core/host_copy.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "src/core/cpu_isolation.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif  // __SSE2__
+
+namespace nvidia { namespace inferenceserver {
+
+namespace {
+
+// The total size from which copies are made in parallel. Below it
+// waking the copy threads costs more than it saves.
+constexpr size_t kParallelCopyByteSize = 1 << 20;
+
+// The total size from which non-temporal stores are used.
+constexpr size_t kNonTemporalCopyByteSize = 16 << 20;
+
+// The smallest range that is given to a thread.
+constexpr size_t kMinRangeByteSize = 256 << 10;
+
+// The maximum number of copy threads, in addition to the calling
+// thread.
+constexpr uint32_t kMaxCopyThreadCount = 3;
+
+// Copy 'byte_size' bytes from 'src' to 'dst' with stores that bypass
+// the cache when supported.
+void
+StreamCopy(char* dst, const char* src, size_t byte_size)
+{
+#ifdef __SSE2__
+  // Align the destination for the streaming stores.
+  const size_t head = std::min(
+      byte_size, (16 - (reinterpret_cast<uintptr_t>(dst) & 15)) & 15);
+  memcpy(dst, src, head);
+  dst += head;
+  src += head;
+  byte_size -= head;
+
+  for (; byte_size >= 64; dst += 64, src += 64, byte_size -= 64) {
+    const __m128i* s = reinterpret_cast<const __m128i*>(src);
+    __m128i* d = reinterpret_cast<__m128i*>(dst);
+    const __m128i v0 = _mm_loadu_si128(s);
+    const __m128i v1 = _mm_loadu_si128(s + 1);
+    const __m128i v2 = _mm_loadu_si128(s + 2);
+    const __m128i v3 = _mm_loadu_si128(s + 3);
+    _mm_stream_si128(d, v0);
+    _mm_stream_si128(d + 1, v1);
+    _mm_stream_si128(d + 2, v2);
+    _mm_stream_si128(d + 3, v3);
+  }
+  memcpy(dst, src, byte_size);
+
+  // Streaming stores are weakly ordered, make them visible before the
+  // copy is reported done.
+  _mm_sfence();
+#else
+  memcpy(dst, src, byte_size);
+#endif  // __SSE2__
+}
+
+// The threads that copy ranges for CopyHostBuffers(). The threads are
+// created on first use and run on the CPUs of the scheduler threads
+// that request the copies.
+class HostCopyPool {
+ public:
+  static HostCopyPool* Get()
+  {
+    static HostCopyPool pool(std::min(
+        kMaxCopyThreadCount,
+        AvailableCpuCount(ThreadClass::SCHEDULER) / 2));
+    return &pool;
+  }
+
+  ~HostCopyPool()
+  {
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      exiting_ = true;
+    }
+    cv_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  // The number of threads, not counting the calling thread.
+  size_t ThreadCount() const { return threads_.size(); }
+
+  // Run 'tasks' on the copy threads and the calling thread, and
+  // return once all are done.
+  void Run(std::vector<std::function<void()>>&& tasks)
+  {
+    struct Pending {
+      std::mutex mu_;
+      std::condition_variable cv_;
+      size_t remaining_;
+    };
+    auto pending = std::make_shared<Pending>();
+    pending->remaining_ = tasks.size() - 1;
+
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      for (size_t i = 1; i < tasks.size(); ++i) {
+        std::function<void()> task = std::move(tasks[i]);
+        queue_.emplace_back([task, pending]() {
+          task();
+          std::lock_guard<std::mutex> lk(pending->mu_);
+          if (--pending->remaining_ == 0) {
+            pending->cv_.notify_one();
+          }
+        });
+      }
+    }
+    cv_.notify_all();
+
+    tasks[0]();
+
+    std::unique_lock<std::mutex> lk(pending->mu_);
+    pending->cv_.wait(lk, [&pending] { return pending->remaining_ == 0; });
+  }
+
+ private:
+  explicit HostCopyPool(const uint32_t thread_count) : exiting_(false)
+  {
+    for (uint32_t i = 0; i < thread_count; ++i) {
+      threads_.emplace_back(&HostCopyPool::CopyThread, this);
+    }
+  }
+
+  void CopyThread()
+  {
+    SetThreadClass(ThreadClass::SCHEDULER);
+
+    std::unique_lock<std::mutex> lk(mu_);
+    while (true) {
+      cv_.wait(lk, [this] { return exiting_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+
+      std::function<void()> task = std::move(queue_.front());
+      queue_.pop_front();
+      lk.unlock();
+      task();
+      lk.lock();
+    }
+  }
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool exiting_;
+  std::deque<std::function<void()>> queue_;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace
+
+void
+CopyHostBuffers(const std::vector<HostCopy>& copies)
+{
+  size_t total_byte_size = 0;
+  for (const auto& copy : copies) {
+    total_byte_size += copy.byte_size_;
+  }
+
+  HostCopyPool* pool = nullptr;
+  if (total_byte_size >= kParallelCopyByteSize) {
+    pool = HostCopyPool::Get();
+  }
+  if ((pool == nullptr) || (pool->ThreadCount() == 0)) {
+    for (const auto& copy : copies) {
+      memcpy(copy.dst_, copy.src_, copy.byte_size_);
+    }
+    return;
+  }
+
+  // Split the copies into one run of ranges of similar total size for
+  // each thread, a copy larger than the rest of a run being split
+  // across runs.
+  const size_t run_cnt = std::min(
+      pool->ThreadCount() + 1,
+      std::max(total_byte_size / kMinRangeByteSize, (size_t)1));
+  const size_t run_byte_size = (total_byte_size + run_cnt - 1) / run_cnt;
+  const bool non_temporal = (total_byte_size >= kNonTemporalCopyByteSize);
+
+  std::vector<std::vector<HostCopy>> runs(1);
+  size_t run_left = run_byte_size;
+  for (const auto& copy : copies) {
+    char* dst = static_cast<char*>(copy.dst_);
+    const char* src = static_cast<const char*>(copy.src_);
+    size_t left = copy.byte_size_;
+    while (left > 0) {
+      if (run_left == 0) {
+        runs.emplace_back();
+        run_left = run_byte_size;
+      }
+      const size_t byte_size = std::min(left, run_left);
+      runs.back().push_back(HostCopy{dst, src, byte_size});
+      dst += byte_size;
+      src += byte_size;
+      left -= byte_size;
+      run_left -= byte_size;
+    }
+  }
+
+  std::vector<std::function<void()>> tasks;
+  for (auto& run : runs) {
+    tasks.emplace_back([&run, non_temporal]() {
+      for (const auto& copy : run) {
+        if (non_temporal) {
+          StreamCopy(
+              static_cast<char*>(copy.dst_),
+              static_cast<const char*>(copy.src_), copy.byte_size_);
+        } else {
+          memcpy(copy.dst_, copy.src_, copy.byte_size_);
+        }
+      }
+    });
+  }
+
+  pool->Run(std::move(tasks));
+}
+
+}}  // namespace nvidia::inferenceserver
@@ -26,49 +26,111 @@
 
 #include "src/core/label_provider.h"
 
-#include <iostream>
-#include <iterator>
-#include <sstream>
+#include <cstring>
+#include <mutex>
 #include "src/core/filesystem.h"
 
 namespace nvidia { namespace inferenceserver {
 
-const std::string&
-LabelProvider::GetLabel(const std::string& name, size_t index) const
+namespace {
+
+uint64_t
+HashContents(const std::string& contents)
 {
-  static const std::string not_found;
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  for (const char c : contents) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+}  // namespace
 
+bool
+LabelProvider::GetLabel(
+    const std::string& name, size_t index, const char** label,
+    size_t* label_byte_size) const
+{
   auto itr = label_map_.find(name);
   if (itr == label_map_.end()) {
-    return not_found;
+    return false;
+  }
+
+  const LabelSet& labels = *itr->second;
+  if ((index + 1) >= labels.offsets_.size()) {
+    return false;
+  }
+
+  size_t start = labels.offsets_[index];
+  size_t end = labels.offsets_[index + 1];
+  if ((end > start) && (labels.contents_[end - 1] == '\n')) {
+    end--;
+  }
+
+  *label = labels.contents_.data() + start;
+  *label_byte_size = end - start;
+  return true;
+}
+
+bool
+LabelProvider::HasLabel(const std::string& name, size_t index) const
+{
+  const char* label;
+  size_t label_byte_size;
+  return GetLabel(name, index, &label, &label_byte_size) &&
+         (label_byte_size > 0);
+}
+
+std::shared_ptr<const LabelProvider::LabelSet>
+LabelProvider::GetLabelSet(std::string&& contents)
+{
+  // The label sets are found by the hash of the file contents. A set
+  // is released when the last provider using it is destroyed.
+  static std::mutex mu;
+  static std::unordered_map<uint64_t, std::weak_ptr<const LabelSet>> sets;
+
+  const uint64_t hash = HashContents(contents);
+
+  std::lock_guard<std::mutex> lock(mu);
+  auto itr = sets.find(hash);
+  if (itr != sets.end()) {
+    std::shared_ptr<const LabelSet> labels = itr->second.lock();
+    if ((labels != nullptr) && (labels->contents_ == contents)) {
+      return labels;
+    }
   }
 
-  if (itr->second.size() <= index) {
-    return not_found;
+  std::shared_ptr<LabelSet> labels = std::make_shared<LabelSet>();
+  labels->contents_ = std::move(contents);
+
+  const std::string& lc = labels->contents_;
+  size_t start = 0;
+  while (start < lc.size()) {
+    labels->offsets_.push_back(start);
+    const char* nl = static_cast<const char*>(
+        memchr(lc.data() + start, '\n', lc.size() - start));
+    start = (nl == nullptr) ? lc.size() : (nl - lc.data()) + 1;
   }
+  labels->offsets_.push_back(lc.size());
 
-  return itr->second[index];
+  sets[hash] = labels;
+  return labels;
 }
 
 Status
 LabelProvider::AddLabels(const std::string& name, const std::string& filepath)
 {
-  std::string label_file_contents;
-  RETURN_IF_ERROR(ReadTextFile(filepath, &label_file_contents));
-
-  auto p = label_map_.insert(std::make_pair(name, std::vector<std::string>()));
-  if (!p.second) {
+  if (label_map_.find(name) != label_map_.end()) {
     return Status(
         RequestStatusCode::INTERNAL, "multiple label files for '" + name + "'");
   }
 
-  auto itr = p.first;
+  std::string label_file_contents;
+  RETURN_IF_ERROR(ReadTextFile(filepath, &label_file_contents));
 
-  std::istringstream label_file_stream(label_file_contents);
-  std::string line;
-  while (std::getline(label_file_stream, line)) {
-    itr->second.push_back(line);
-  }
+  label_map_.emplace(name, GetLabelSet(std::move(label_file_contents)));
 
   return Status::Success;
 }
@@ -25,6 +25,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -38,20 +39,41 @@ class LabelProvider {
  public:
   LabelProvider() = default;
 
-  // Return the label associated with 'name' for a given
-  // 'index'. Return empty string if no label is available.
-  const std::string& GetLabel(const std::string& name, size_t index) const;
+  // Return in 'label' and 'label_byte_size' the label associated
+  // with 'name' for a given 'index'. The label is not
+  // null-terminated. Return false if no label is available.
+  bool GetLabel(
+      const std::string& name, size_t index, const char** label,
+      size_t* label_byte_size) const;
+
+  // Return true if a label is associated with 'name' for a given
+  // 'index'.
+  bool HasLabel(const std::string& name, size_t index) const;
 
   // Associate with 'name' a set of labels initialized from a given
   // 'filepath'. Within the file each label is specified on its own
   // line. The first label (line 0) is the index-0 label, the second
-  // label (line 1) is the index-1 label, etc.
+  // label (line 1) is the index-1 label, etc. Label files with
+  // identical contents, for example the same file in several versions
+  // of a model, share one set of labels.
   Status AddLabels(const std::string& name, const std::string& filepath);
 
  private:
   DISALLOW_COPY_AND_ASSIGN(LabelProvider);
 
-  std::unordered_map<std::string, std::vector<std::string>> label_map_;
+  // The labels of a label file. 'contents_' holds the whole file and
+  // label 'i' is the line starting at 'offsets_[i]', up to but not
+  // including the newline before 'offsets_[i + 1]'.
+  struct LabelSet {
+    std::string contents_;
+    std::vector<size_t> offsets_;
+  };
+
+  // Return the label set for the file contents 'contents', shared
+  // with any other provider that added the same contents.
+  static std::shared_ptr<const LabelSet> GetLabelSet(std::string&& contents);
+
+  std::unordered_map<std::string, std::shared_ptr<const LabelSet>> label_map_;
 };
 
 }}  // namespace nvidia::inferenceserver
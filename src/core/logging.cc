@@ -29,27 +29,204 @@
 #include <sys/types.h>
 #include <time.h>
 #include <unistd.h>
+#include <chrono>
 #include <iomanip>
 #include <iostream>
 
 namespace nvidia { namespace inferenceserver {
 
+namespace {
+
+// Number of messages the ring of an asynchronous log can hold. Must
+// be a power of 2.
+constexpr size_t kAsyncLogRingSize = 16384;
+
+// Interval at which the writer thread looks for queued messages.
+constexpr std::chrono::milliseconds kAsyncLogInterval(10);
+
+}  // namespace
+
+//
+// Bounded lock-free ring of messages that any number of threads may
+// push to and a single thread pops from. Each cell carries a sequence
+// number that tells whether it is free for the producer claiming the
+// position or holds a message for the consumer.
+//
+class Logger::Ring {
+ public:
+  explicit Ring(const size_t size)
+      : mask_(size - 1), cells_(new Cell[size]), push_pos_(0), pop_pos_(0)
+  {
+    for (size_t i = 0; i < size; ++i) {
+      cells_[i].seq_.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Queue 'msg'. Return false without blocking if the ring is full.
+  bool TryPush(std::string&& msg)
+  {
+    Cell* cell;
+    size_t pos = push_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells_[pos & mask_];
+      const size_t seq = cell->seq_.load(std::memory_order_acquire);
+      const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        if (push_pos_.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = push_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->msg_ = std::move(msg);
+    cell->seq_.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Remove the oldest message into 'msg'. Return false if there is
+  // none. Only one thread may pop.
+  bool TryPop(std::string* msg)
+  {
+    Cell& cell = cells_[pop_pos_ & mask_];
+    const size_t seq = cell.seq_.load(std::memory_order_acquire);
+    if (seq != pop_pos_ + 1) {
+      return false;
+    }
+
+    *msg = std::move(cell.msg_);
+    cell.msg_.clear();
+    cell.seq_.store(pop_pos_ + mask_ + 1, std::memory_order_release);
+    pop_pos_++;
+    return true;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> seq_;
+    std::string msg_;
+  };
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  std::atomic<size_t> push_pos_;
+  size_t pop_pos_;
+};
+
 Logger gLogger_;
 
-Logger::Logger() : enables_{true, true, true}, vlevel_(0) {}
+Logger::Logger()
+    : enables_{true, true, true}, vlevel_(0), async_(false), queued_cnt_(0),
+      written_cnt_(0), dropped_cnt_(0), writer_exit_(false)
+{
+}
+
+Logger::~Logger()
+{
+  SetAsync(false);
+}
+
+void
+Logger::SetAsync(bool async)
+{
+  if (async == async_) {
+    return;
+  }
+
+  if (async) {
+    if (ring_ == nullptr) {
+      ring_.reset(new Ring(kAsyncLogRingSize));
+    }
+    writer_exit_ = false;
+    writer_ = std::thread([this] { WriterThread(); });
+    async_ = true;
+    return;
+  }
+
+  // Stop queueing and let the writer thread write out what is
+  // already queued before exiting.
+  async_ = false;
+  {
+    std::lock_guard<std::mutex> lock(writer_mu_);
+    writer_exit_ = true;
+  }
+  writer_cv_.notify_all();
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+}
 
 void
-Logger::Log(const std::string& msg)
+Logger::Log(std::string&& msg)
 {
+  if (async_) {
+    if (ring_->TryPush(std::move(msg))) {
+      queued_cnt_++;
+    } else {
+      dropped_cnt_++;
+    }
+    return;
+  }
+
   std::cerr << msg << std::endl;
 }
 
 void
 Logger::Flush()
 {
+  if (async_) {
+    const uint64_t queued_cnt = queued_cnt_;
+    writer_cv_.notify_all();
+    while (written_cnt_ < queued_cnt) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
   std::cerr << std::flush;
 }
 
+void
+Logger::WriterThread()
+{
+  uint64_t reported_dropped_cnt = dropped_cnt_;
+  std::string msg;
+  while (true) {
+    bool exiting;
+    {
+      std::unique_lock<std::mutex> lock(writer_mu_);
+      writer_cv_.wait_for(lock, kAsyncLogInterval);
+      exiting = writer_exit_;
+    }
+
+    // Write the messages in one batch and flush once.
+    uint64_t write_cnt = 0;
+    while (ring_->TryPop(&msg)) {
+      std::cerr << msg << '\n';
+      write_cnt++;
+    }
+
+    const uint64_t dropped_cnt = dropped_cnt_;
+    if (dropped_cnt != reported_dropped_cnt) {
+      std::cerr << "dropped " << (dropped_cnt - reported_dropped_cnt)
+                << " log messages because the log ring was full" << '\n';
+      reported_dropped_cnt = dropped_cnt;
+    }
+
+    if ((write_cnt > 0) || exiting) {
+      std::cerr << std::flush;
+      written_cnt_ += write_cnt;
+    }
+
+    if (exiting) {
+      break;
+    }
+  }
+}
+
 
 const std::vector<char> LogMessage::level_name_{'E', 'W', 'I'};
 
@@ -25,8 +25,13 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace nvidia { namespace inferenceserver {
@@ -51,6 +56,7 @@ class LogMessage {
 class Logger {
  public:
   Logger();
+  ~Logger();
 
   // Is a log level enabled.
   bool IsEnabled(LogMessage::Level level) const { return enables_[level]; }
@@ -67,15 +73,45 @@ class Logger {
   // Set the current verbose logging level.
   void SetVerboseLevel(uint32_t vlevel) { vlevel_ = vlevel; }
 
+  // Is the log written asynchronously.
+  bool IsAsync() const { return async_; }
+
+  // Set whether the log is written asynchronously. When enabled,
+  // messages are queued in a fixed-size lock-free ring and written by
+  // a background thread. A message that doesn't fit in the ring is
+  // dropped and counted instead of blocking the logging thread.
+  // Disabling writes out the queued messages and must not race with
+  // other threads logging.
+  void SetAsync(bool async);
+
+  // Get the number of messages dropped because the ring was full.
+  uint64_t DroppedCount() const { return dropped_cnt_; }
+
   // Log a message.
-  void Log(const std::string& msg);
+  void Log(std::string&& msg);
 
-  // Flush the log.
+  // Flush the log. When the log is written asynchronously this waits
+  // for the messages queued so far to be written.
   void Flush();
 
  private:
+  class Ring;
+
+  void WriterThread();
+
   std::vector<bool> enables_;
   uint32_t vlevel_;
+
+  std::atomic<bool> async_;
+  std::unique_ptr<Ring> ring_;
+  std::atomic<uint64_t> queued_cnt_;
+  std::atomic<uint64_t> written_cnt_;
+  std::atomic<uint64_t> dropped_cnt_;
+
+  std::mutex writer_mu_;
+  std::condition_variable writer_cv_;
+  std::thread writer_;
+  bool writer_exit_;
 };
 
 extern Logger gLogger_;
@@ -134,6 +170,8 @@ extern Logger gLogger_;
       nvidia::inferenceserver::LogMessage::Level::kINFO) \
       .stream()
 
+#define LOG_SET_ASYNC(A) nvidia::inferenceserver::gLogger_.SetAsync((A))
+
 #define LOG_FLUSH nvidia::inferenceserver::gLogger_.Flush()
 
 }}  // namespace nvidia::inferenceserver
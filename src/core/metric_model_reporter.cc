@@ -26,6 +26,7 @@
 
 #include "src/core/metric_model_reporter.h"
 
+#include <algorithm>
 #include "src/core/constants.h"
 #include "src/core/metrics.h"
 
@@ -84,6 +85,26 @@ MetricModelReporter::GetCounterMetric(
   return counter;
 }
 
+prometheus::Histogram&
+MetricModelReporter::GetHistogramMetric(
+    std::map<int, prometheus::Histogram*>& metrics,
+    prometheus::Family<prometheus::Histogram>& family,
+    const std::vector<double>& buckets, const int gpu_device) const
+{
+  const auto itr = metrics.find(gpu_device);
+  if (itr != metrics.end()) {
+    return *(itr->second);
+  }
+
+  std::map<std::string, std::string> labels;
+  GetMetricLabels(&labels, gpu_device);
+
+  prometheus::Histogram& hist = family.Add(labels, buckets);
+  metrics.insert(
+      std::map<int, prometheus::Histogram*>::value_type(gpu_device, &hist));
+  return hist;
+}
+
 prometheus::Counter&
 MetricModelReporter::MetricInferenceSuccess(int gpu_device) const
 {
@@ -137,22 +158,239 @@ MetricModelReporter::MetricInferenceQueueDuration(int gpu_device) const
       gpu_device);
 }
 
+prometheus::Counter&
+MetricModelReporter::MetricInferenceComputeInputDuration(int gpu_device) const
+{
+  return GetCounterMetric(
+      metric_inf_compute_input_duration_us_,
+      Metrics::FamilyInferenceComputeInputDuration(), gpu_device);
+}
+
+prometheus::Counter&
+MetricModelReporter::MetricInferenceComputeInferDuration(int gpu_device) const
+{
+  return GetCounterMetric(
+      metric_inf_compute_infer_duration_us_,
+      Metrics::FamilyInferenceComputeInferDuration(), gpu_device);
+}
+
+prometheus::Counter&
+MetricModelReporter::MetricInferenceComputeOutputDuration(int gpu_device) const
+{
+  return GetCounterMetric(
+      metric_inf_compute_output_duration_us_,
+      Metrics::FamilyInferenceComputeOutputDuration(), gpu_device);
+}
+
+prometheus::Histogram&
+MetricModelReporter::MetricInferenceRequestLatency(int gpu_device) const
+{
+  return GetHistogramMetric(
+      metric_inf_request_latency_us_, Metrics::FamilyInferenceRequestLatency(),
+      Metrics::LatencyBuckets(), gpu_device);
+}
+
+prometheus::Histogram&
+MetricModelReporter::MetricInferenceComputeLatency(int gpu_device) const
+{
+  return GetHistogramMetric(
+      metric_inf_compute_latency_us_, Metrics::FamilyInferenceComputeLatency(),
+      Metrics::LatencyBuckets(), gpu_device);
+}
+
+prometheus::Histogram&
+MetricModelReporter::MetricInferenceQueueLatency(int gpu_device) const
+{
+  return GetHistogramMetric(
+      metric_inf_queue_latency_us_, Metrics::FamilyInferenceQueueLatency(),
+      Metrics::LatencyBuckets(), gpu_device);
+}
+
 prometheus::Histogram&
 MetricModelReporter::MetricInferenceLoadRatio(int gpu_device) const
 {
-  const auto itr = metric_inf_load_ratio_.find(gpu_device);
-  if (itr != metric_inf_load_ratio_.end()) {
-    return *(itr->second);
-  }
+  return GetHistogramMetric(
+      metric_inf_load_ratio_, Metrics::FamilyInferenceLoadRatio(),
+      std::vector<double>{1.05, 1.10, 1.25, 1.5, 2.0, 10.0, 50.0},
+      gpu_device);
+}
 
+prometheus::Gauge&
+MetricModelReporter::GetGpuMemoryMetric(
+    prometheus::Family<prometheus::Gauge>& family, const int gpu_device) const
+{
   std::map<std::string, std::string> labels;
   GetMetricLabels(&labels, gpu_device);
 
-  prometheus::Histogram& hist = Metrics::FamilyInferenceLoadRatio().Add(
-      labels, std::vector<double>{1.05, 1.10, 1.25, 1.5, 2.0, 10.0, 50.0});
-  metric_inf_load_ratio_.insert(
-      std::map<int, prometheus::Histogram*>::value_type(gpu_device, &hist));
-  return hist;
+  return family.Add(labels);
+}
+
+prometheus::Gauge&
+MetricModelReporter::MetricGpuMemoryModel(int gpu_device) const
+{
+  return GetGpuMemoryMetric(Metrics::FamilyGpuMemoryModel(), gpu_device);
+}
+
+prometheus::Gauge&
+MetricModelReporter::MetricGpuMemoryWorkspace(int gpu_device) const
+{
+  return GetGpuMemoryMetric(Metrics::FamilyGpuMemoryWorkspace(), gpu_device);
+}
+
+prometheus::Gauge&
+MetricModelReporter::MetricGpuMemoryIO(int gpu_device) const
+{
+  return GetGpuMemoryMetric(Metrics::FamilyGpuMemoryIO(), gpu_device);
+}
+
+prometheus::Gauge&
+MetricModelReporter::MetricQueueLength() const
+{
+  std::map<std::string, std::string> labels;
+  GetMetricLabels(&labels, -1 /* gpu_device */);
+
+  return Metrics::FamilyQueueLength().Add(labels);
+}
+
+prometheus::Gauge&
+MetricModelReporter::MetricInflightExecutions(uint32_t instance_idx) const
+{
+  std::map<std::string, std::string> labels;
+  GetMetricLabels(&labels, -1 /* gpu_device */);
+  labels.insert(std::map<std::string, std::string>::value_type(
+      std::string(kMetricsLabelModelInstance), std::to_string(instance_idx)));
+
+  return Metrics::FamilyInflightExecutions().Add(labels);
+}
+
+prometheus::Histogram&
+MetricModelReporter::MetricExecutionBatchSize(int max_batch_size) const
+{
+  std::map<std::string, std::string> labels;
+  GetMetricLabels(&labels, -1 /* gpu_device */);
+
+  std::vector<double> buckets;
+  for (int size = 1; size < max_batch_size; size *= 2) {
+    buckets.push_back(size);
+  }
+  buckets.push_back(std::max(1, max_batch_size));
+
+  return Metrics::FamilyExecutionBatchSize().Add(labels, buckets);
+}
+
+prometheus::Counter&
+MetricModelReporter::MetricResponseCacheHits() const
+{
+  std::map<std::string, std::string> labels;
+  GetMetricLabels(&labels, -1 /* gpu_device */);
+
+  return Metrics::FamilyResponseCacheHits().Add(labels);
+}
+
+prometheus::Counter&
+MetricModelReporter::MetricResponseCacheMisses() const
+{
+  std::map<std::string, std::string> labels;
+  GetMetricLabels(&labels, -1 /* gpu_device */);
+
+  return Metrics::FamilyResponseCacheMisses().Add(labels);
+}
+
+prometheus::Gauge&
+MetricModelReporter::MetricSequenceActiveSlots(uint32_t batcher_idx) const
+{
+  std::map<std::string, std::string> labels;
+  GetMetricLabels(&labels, -1 /* gpu_device */);
+  labels.insert(std::map<std::string, std::string>::value_type(
+      std::string(kMetricsLabelBatcher), std::to_string(batcher_idx)));
+
+  return Metrics::FamilySequenceActiveSlots().Add(labels);
+}
+
+prometheus::Gauge&
+MetricModelReporter::MetricSequenceBacklogSequences() const
+{
+  std::map<std::string, std::string> labels;
+  GetMetricLabels(&labels, -1 /* gpu_device */);
+
+  return Metrics::FamilySequenceBacklogSequences().Add(labels);
+}
+
+prometheus::Gauge&
+MetricModelReporter::MetricSequenceBacklogRequests() const
+{
+  std::map<std::string, std::string> labels;
+  GetMetricLabels(&labels, -1 /* gpu_device */);
+
+  return Metrics::FamilySequenceBacklogRequests().Add(labels);
+}
+
+prometheus::Histogram&
+MetricModelReporter::GetSequenceDurationMetric(
+    prometheus::Family<prometheus::Histogram>& family) const
+{
+  std::map<std::string, std::string> labels;
+  GetMetricLabels(&labels, -1 /* gpu_device */);
+
+  // From 1 millisecond to 10 minutes.
+  return family.Add(
+      labels, std::vector<double>{1e3, 1e4, 1e5, 1e6, 1e7, 6e7, 6e8});
+}
+
+prometheus::Histogram&
+MetricModelReporter::MetricSequenceBacklogDuration() const
+{
+  return GetSequenceDurationMetric(Metrics::FamilySequenceBacklogDuration());
+}
+
+prometheus::Histogram&
+MetricModelReporter::MetricSequenceLifetime() const
+{
+  return GetSequenceDurationMetric(Metrics::FamilySequenceLifetime());
+}
+
+prometheus::Counter&
+MetricModelReporter::GetEnsembleStepMetric(
+    prometheus::Family<prometheus::Counter>& family,
+    const std::string& step_model) const
+{
+  std::map<std::string, std::string> labels;
+  GetMetricLabels(&labels, -1 /* gpu_device */);
+  labels.insert(std::map<std::string, std::string>::value_type(
+      std::string(kMetricsLabelStepModel), step_model));
+
+  return family.Add(labels);
+}
+
+prometheus::Counter&
+MetricModelReporter::MetricEnsembleStepCount(
+    const std::string& step_model) const
+{
+  return GetEnsembleStepMetric(Metrics::FamilyEnsembleStepCount(), step_model);
+}
+
+prometheus::Counter&
+MetricModelReporter::MetricEnsembleStepQueueDuration(
+    const std::string& step_model) const
+{
+  return GetEnsembleStepMetric(
+      Metrics::FamilyEnsembleStepQueueDuration(), step_model);
+}
+
+prometheus::Counter&
+MetricModelReporter::MetricEnsembleStepInputDuration(
+    const std::string& step_model) const
+{
+  return GetEnsembleStepMetric(
+      Metrics::FamilyEnsembleStepInputDuration(), step_model);
+}
+
+prometheus::Counter&
+MetricModelReporter::MetricEnsembleStepComputeDuration(
+    const std::string& step_model) const
+{
+  return GetEnsembleStepMetric(
+      Metrics::FamilyEnsembleStepComputeDuration(), step_model);
 }
 
 #endif  // TRTIS_ENABLE_METRICS
@@ -59,7 +59,52 @@ class MetricModelReporter {
   prometheus::Counter& MetricInferenceRequestDuration(int gpu_device) const;
   prometheus::Counter& MetricInferenceComputeDuration(int gpu_device) const;
   prometheus::Counter& MetricInferenceQueueDuration(int gpu_device) const;
+  prometheus::Counter& MetricInferenceComputeInputDuration(
+      int gpu_device) const;
+  prometheus::Counter& MetricInferenceComputeInferDuration(
+      int gpu_device) const;
+  prometheus::Counter& MetricInferenceComputeOutputDuration(
+      int gpu_device) const;
+  prometheus::Histogram& MetricInferenceRequestLatency(int gpu_device) const;
+  prometheus::Histogram& MetricInferenceComputeLatency(int gpu_device) const;
+  prometheus::Histogram& MetricInferenceQueueLatency(int gpu_device) const;
   prometheus::Histogram& MetricInferenceLoadRatio(int gpu_device) const;
+
+  // Get a metric of the memory held by the model on a GPU, see
+  // ModelMemoryUsage.
+  prometheus::Gauge& MetricGpuMemoryModel(int gpu_device) const;
+  prometheus::Gauge& MetricGpuMemoryWorkspace(int gpu_device) const;
+  prometheus::Gauge& MetricGpuMemoryIO(int gpu_device) const;
+
+  // Get a scheduler metric for the model. In-flight executions are
+  // reported separately for each model instance. The batch size
+  // buckets are the powers of 2 up to 'max_batch_size'.
+  prometheus::Gauge& MetricQueueLength() const;
+  prometheus::Gauge& MetricInflightExecutions(uint32_t instance_idx) const;
+  prometheus::Histogram& MetricExecutionBatchSize(int max_batch_size) const;
+
+  // Get a response cache metric for the model.
+  prometheus::Counter& MetricResponseCacheHits() const;
+  prometheus::Counter& MetricResponseCacheMisses() const;
+
+  // Get a sequence batcher metric for the model. Active slots are
+  // reported separately for each batcher.
+  prometheus::Gauge& MetricSequenceActiveSlots(uint32_t batcher_idx) const;
+  prometheus::Gauge& MetricSequenceBacklogSequences() const;
+  prometheus::Gauge& MetricSequenceBacklogRequests() const;
+  prometheus::Histogram& MetricSequenceBacklogDuration() const;
+  prometheus::Histogram& MetricSequenceLifetime() const;
+
+  // Get an ensemble metric for the steps of the model that execute
+  // 'step_model'.
+  prometheus::Counter& MetricEnsembleStepCount(
+      const std::string& step_model) const;
+  prometheus::Counter& MetricEnsembleStepQueueDuration(
+      const std::string& step_model) const;
+  prometheus::Counter& MetricEnsembleStepInputDuration(
+      const std::string& step_model) const;
+  prometheus::Counter& MetricEnsembleStepComputeDuration(
+      const std::string& step_model) const;
 #endif  // TRTIS_ENABLE_METRICS
 
  private:
@@ -74,6 +119,18 @@ class MetricModelReporter {
       std::map<int, prometheus::Counter*>& metrics,
       prometheus::Family<prometheus::Counter>& family,
       const int gpu_device) const;
+  prometheus::Histogram& GetHistogramMetric(
+      std::map<int, prometheus::Histogram*>& metrics,
+      prometheus::Family<prometheus::Histogram>& family,
+      const std::vector<double>& buckets, const int gpu_device) const;
+  prometheus::Gauge& GetGpuMemoryMetric(
+      prometheus::Family<prometheus::Gauge>& family,
+      const int gpu_device) const;
+  prometheus::Histogram& GetSequenceDurationMetric(
+      prometheus::Family<prometheus::Histogram>& family) const;
+  prometheus::Counter& GetEnsembleStepMetric(
+      prometheus::Family<prometheus::Counter>& family,
+      const std::string& step_model) const;
 
   mutable std::map<int, prometheus::Counter*> metric_inf_success_;
   mutable std::map<int, prometheus::Counter*> metric_inf_failure_;
@@ -82,6 +139,15 @@ class MetricModelReporter {
   mutable std::map<int, prometheus::Counter*> metric_inf_request_duration_us_;
   mutable std::map<int, prometheus::Counter*> metric_inf_compute_duration_us_;
   mutable std::map<int, prometheus::Counter*> metric_inf_queue_duration_us_;
+  mutable std::map<int, prometheus::Counter*>
+      metric_inf_compute_input_duration_us_;
+  mutable std::map<int, prometheus::Counter*>
+      metric_inf_compute_infer_duration_us_;
+  mutable std::map<int, prometheus::Counter*>
+      metric_inf_compute_output_duration_us_;
+  mutable std::map<int, prometheus::Histogram*> metric_inf_request_latency_us_;
+  mutable std::map<int, prometheus::Histogram*> metric_inf_compute_latency_us_;
+  mutable std::map<int, prometheus::Histogram*> metric_inf_queue_latency_us_;
   mutable std::map<int, prometheus::Histogram*> metric_inf_load_ratio_;
 #endif  // TRTIS_ENABLE_METRICS
 };
@@ -29,8 +29,16 @@
 
 #include "src/core/metrics.h"
 
+#include <dirent.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
 #include <thread>
 #include "src/core/constants.h"
+#include "src/core/cpu_isolation.h"
 #include "src/core/logging.h"
 
 #ifdef TRTIS_ENABLE_GPU
@@ -40,6 +48,56 @@
 
 namespace nvidia { namespace inferenceserver {
 
+namespace {
+
+// Read the name, the CPU time and the start time of a thread or a
+// process from its 'stat' file in /proc. The times are in clock
+// ticks.
+bool
+ReadProcStat(
+    const std::string& path, std::string* name, uint64_t* cpu_ticks,
+    uint64_t* start_ticks)
+{
+  std::ifstream file(path);
+  std::string stat;
+  if (!std::getline(file, stat)) {
+    return false;
+  }
+
+  // The name is in parentheses and may itself contain spaces and
+  // parentheses, the fields that follow start at the last ')'.
+  const size_t name_begin = stat.find('(');
+  const size_t name_end = stat.rfind(')');
+  if ((name_begin == std::string::npos) || (name_end == std::string::npos) ||
+      (name_end < name_begin)) {
+    return false;
+  }
+  *name = stat.substr(name_begin + 1, name_end - name_begin - 1);
+
+  // Fields 14 and 15 are the user and system time and field 22 is
+  // the start time. The first field after the name is field 3.
+  std::istringstream fields(stat.substr(name_end + 1));
+  std::string field;
+  uint64_t utime = 0, stime = 0;
+  for (int idx = 3; idx <= 22; ++idx) {
+    if (!(fields >> field)) {
+      return false;
+    }
+    if (idx == 14) {
+      utime = std::stoull(field);
+    } else if (idx == 15) {
+      stime = std::stoull(field);
+    } else if (idx == 22) {
+      *start_ticks = std::stoull(field);
+    }
+  }
+
+  *cpu_ticks = utime + stime;
+  return true;
+}
+
+}  // namespace
+
 Metrics::Metrics()
     : registry_(std::make_shared<prometheus::Registry>()),
       serializer_(new prometheus::TextSerializer()),
@@ -76,9 +134,147 @@ Metrics::Metrics()
               .Name("nv_inference_queue_duration_us")
               .Help("Cummulative inference queuing duration in microseconds")
               .Register(*registry_)),
+      inf_compute_input_duration_us_family_(
+          prometheus::BuildCounter()
+              .Name("nv_inference_compute_input_duration_us")
+              .Help("Cummulative compute duration spent preparing and "
+                    "copying inputs in microseconds")
+              .Register(*registry_)),
+      inf_compute_infer_duration_us_family_(
+          prometheus::BuildCounter()
+              .Name("nv_inference_compute_infer_duration_us")
+              .Help("Cummulative compute duration spent executing the model "
+                    "in microseconds")
+              .Register(*registry_)),
+      inf_compute_output_duration_us_family_(
+          prometheus::BuildCounter()
+              .Name("nv_inference_compute_output_duration_us")
+              .Help("Cummulative compute duration spent copying and "
+                    "processing outputs in microseconds")
+              .Register(*registry_)),
+      inf_request_latency_us_family_(
+          prometheus::BuildHistogram()
+              .Name("nv_inference_request_latency_us")
+              .Help("Inference request latency in microseconds")
+              .Register(*registry_)),
+      inf_compute_latency_us_family_(
+          prometheus::BuildHistogram()
+              .Name("nv_inference_compute_latency_us")
+              .Help("Inference compute latency in microseconds")
+              .Register(*registry_)),
+      inf_queue_latency_us_family_(
+          prometheus::BuildHistogram()
+              .Name("nv_inference_queue_latency_us")
+              .Help("Inference queuing latency in microseconds")
+              .Register(*registry_)),
       inf_load_ratio_family_(prometheus::BuildHistogram()
                                  .Name("nv_inference_load_ratio")
                                  .Register(*registry_)),
+      gpu_memory_model_family_(
+          prometheus::BuildGauge()
+              .Name("nv_gpu_memory_model_bytes")
+              .Help("GPU memory held by the model weights and engines, in "
+                    "bytes")
+              .Register(*registry_)),
+      gpu_memory_workspace_family_(
+          prometheus::BuildGauge()
+              .Name("nv_gpu_memory_workspace_bytes")
+              .Help("GPU memory held by the model for activations and "
+                    "scratch space, in bytes")
+              .Register(*registry_)),
+      gpu_memory_io_family_(
+          prometheus::BuildGauge()
+              .Name("nv_gpu_memory_io_bytes")
+              .Help("GPU memory held by the model for input and output "
+                    "buffers, in bytes")
+              .Register(*registry_)),
+      queue_length_family_(
+          prometheus::BuildGauge()
+              .Name("nv_inference_queue_length")
+              .Help("Number of inference requests waiting in the scheduler "
+                    "queue")
+              .Register(*registry_)),
+      inflight_executions_family_(
+          prometheus::BuildGauge()
+              .Name("nv_inference_inflight_executions")
+              .Help("Number of executions in progress on a model instance")
+              .Register(*registry_)),
+      exec_batch_size_family_(
+          prometheus::BuildHistogram()
+              .Name("nv_inference_exec_batch_size")
+              .Help("Batch size of the model executions")
+              .Register(*registry_)),
+      response_cache_hits_family_(
+          prometheus::BuildCounter()
+              .Name("nv_inference_response_cache_hits")
+              .Help("Number of inference requests whose response was found "
+                    "in the response cache")
+              .Register(*registry_)),
+      response_cache_misses_family_(
+          prometheus::BuildCounter()
+              .Name("nv_inference_response_cache_misses")
+              .Help("Number of inference requests whose response was not "
+                    "found in the response cache")
+              .Register(*registry_)),
+      seq_active_slots_family_(
+          prometheus::BuildGauge()
+              .Name("nv_sequence_active_slots")
+              .Help("Number of sequence batch slots holding a sequence")
+              .Register(*registry_)),
+      seq_backlog_sequences_family_(
+          prometheus::BuildGauge()
+              .Name("nv_sequence_backlog_sequences")
+              .Help("Number of sequences waiting for a sequence batch slot")
+              .Register(*registry_)),
+      seq_backlog_requests_family_(
+          prometheus::BuildGauge()
+              .Name("nv_sequence_backlog_requests")
+              .Help("Number of requests held in the sequence backlog")
+              .Register(*registry_)),
+      seq_backlog_duration_us_family_(
+          prometheus::BuildHistogram()
+              .Name("nv_sequence_backlog_duration_us")
+              .Help("Time sequences wait in the backlog in microseconds")
+              .Register(*registry_)),
+      seq_lifetime_us_family_(
+          prometheus::BuildHistogram()
+              .Name("nv_sequence_lifetime_us")
+              .Help("Time sequences hold a sequence batch slot in "
+                    "microseconds")
+              .Register(*registry_)),
+      ens_step_count_family_(
+          prometheus::BuildCounter()
+              .Name("nv_ensemble_step_count")
+              .Help("Number of executions of an ensemble step")
+              .Register(*registry_)),
+      ens_step_queue_duration_us_family_(
+          prometheus::BuildCounter()
+              .Name("nv_ensemble_step_queue_duration_us")
+              .Help("Cummulative ensemble step queuing duration in "
+                    "microseconds")
+              .Register(*registry_)),
+      ens_step_input_duration_us_family_(
+          prometheus::BuildCounter()
+              .Name("nv_ensemble_step_input_duration_us")
+              .Help("Cummulative ensemble step input duration in "
+                    "microseconds")
+              .Register(*registry_)),
+      ens_step_compute_duration_us_family_(
+          prometheus::BuildCounter()
+              .Name("nv_ensemble_step_compute_duration_us")
+              .Help("Cummulative ensemble step compute duration in "
+                    "microseconds")
+              .Register(*registry_)),
+      pinned_memory_pool_total_family_(
+          prometheus::BuildGauge()
+              .Name("nv_pinned_memory_pool_total_bytes")
+              .Help("Pinned memory pool total memory, in bytes")
+              .Register(*registry_)),
+      pinned_memory_pool_used_family_(
+          prometheus::BuildGauge()
+              .Name("nv_pinned_memory_pool_used_bytes")
+              .Help("Pinned memory pool used memory, in bytes")
+              .Register(*registry_)),
       gpu_utilization_family_(prometheus::BuildGauge()
                                   .Name("nv_gpu_utilization")
                                   .Help("GPU utilization rate [0.0 - 1.0)")
@@ -105,7 +301,29 @@ Metrics::Metrics()
               .Help("GPU energy consumption in joules since the trtserver "
                     "started")
               .Register(*registry_)),
-      gpu_metrics_enabled_(false)
+      cpu_thread_time_us_family_(
+          prometheus::BuildCounter()
+              .Name("nv_cpu_thread_time_us")
+              .Help("CPU time used by a group of server threads, in "
+                    "microseconds")
+              .Register(*registry_)),
+      cpu_process_time_us_family_(
+          prometheus::BuildCounter()
+              .Name("nv_cpu_process_time_us")
+              .Help("CPU time used by the server process, in microseconds")
+              .Register(*registry_)),
+      cpu_memory_resident_family_(
+          prometheus::BuildGauge()
+              .Name("nv_cpu_memory_resident_bytes")
+              .Help("Resident memory of the server process, in bytes")
+              .Register(*registry_)),
+      // From 100 microseconds to 10 seconds.
+      latency_buckets_({100, 250, 500, 1e3, 2.5e3, 5e3, 1e4, 2.5e4, 5e4, 1e5,
+                        2.5e5, 5e5, 1e6, 1e7}),
+      gpu_metrics_enabled_(false), cpu_process_time_us_(nullptr),
+      cpu_memory_resident_(nullptr), cpu_process_ticks_(0),
+      serialized_max_age_ms_(0), serialized_ns_(0),
+      gpu_poll_interval_ms_(2000), cpu_metrics_enabled_(false)
 {
 }
 
@@ -116,6 +334,11 @@ Metrics::~Metrics()
     nvml_thread_exit_.store(true);
     nvml_thread_->join();
   }
+
+  if (cpu_thread_ != nullptr) {
+    cpu_thread_exit_.store(true);
+    cpu_thread_->join();
+  }
 }
 
 void
@@ -134,6 +357,169 @@ Metrics::EnableGPUMetrics()
   singleton->gpu_metrics_enabled_ = true;
 }
 
+void
+Metrics::EnableCPUMetrics()
+{
+  auto singleton = GetSingleton();
+  if (singleton->cpu_metrics_enabled_) {
+    LOG_WARNING << "CPU Metrics already enabled";
+    return;
+  }
+
+  singleton->cpu_process_time_us_ =
+      &singleton->cpu_process_time_us_family_.Add({});
+  singleton->cpu_memory_resident_ =
+      &singleton->cpu_memory_resident_family_.Add({});
+
+  // Periodically send the CPU metrics...
+  singleton->cpu_thread_exit_.store(false);
+  singleton->cpu_thread_.reset(new std::thread([singleton] {
+    SetThreadClass(ThreadClass::BACKGROUND);
+    while (!singleton->cpu_thread_exit_.load()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+      singleton->PollCpuMetrics();
+    }
+  }));
+
+  singleton->cpu_metrics_enabled_ = true;
+}
+
+void
+Metrics::RegisterThread(
+    const std::string& group, const std::string& model_name)
+{
+  const pid_t tid = syscall(SYS_gettid);
+
+  CpuThread thread;
+  std::string name;
+  if (!ReadProcStat(
+          "/proc/self/task/" + std::to_string(tid) + "/stat", &name,
+          &thread.cpu_ticks_, &thread.start_ticks_)) {
+    return;
+  }
+  thread.group_ = group;
+  thread.model_name_ = model_name;
+
+  auto singleton = GetSingleton();
+  std::lock_guard<std::mutex> lock(singleton->cpu_threads_mu_);
+  singleton->registered_threads_[tid] = std::move(thread);
+}
+
+void
+Metrics::PollCpuMetrics()
+{
+  static const double us_per_tick = 1e6 / sysconf(_SC_CLK_TCK);
+
+  std::string name;
+  uint64_t cpu_ticks, start_ticks;
+  if (ReadProcStat("/proc/self/stat", &name, &cpu_ticks, &start_ticks)) {
+    if (cpu_ticks > cpu_process_ticks_) {
+      cpu_process_time_us_->Increment(
+          (cpu_ticks - cpu_process_ticks_) * us_per_tick);
+      cpu_process_ticks_ = cpu_ticks;
+    }
+  }
+
+  {
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size_pages, resident_pages;
+    if (statm >> size_pages >> resident_pages) {
+      cpu_memory_resident_->Set(
+          (double)resident_pages * sysconf(_SC_PAGESIZE));
+    }
+  }
+
+  DIR* dir = opendir("/proc/self/task");
+  if (dir == nullptr) {
+    return;
+  }
+
+  // Report the CPU time each thread used since the previous poll, or
+  // since it started if it is new. The time that a thread uses after
+  // the last poll before it exits is not reported.
+  std::lock_guard<std::mutex> lock(cpu_threads_mu_);
+  std::unordered_map<pid_t, CpuThread> threads;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != nullptr) {
+    const pid_t tid = atoi(entry->d_name);
+    if (tid <= 0) {
+      continue;
+    }
+
+    CpuThread thread;
+    if (!ReadProcStat(
+            std::string("/proc/self/task/") + entry->d_name + "/stat",
+            &thread.group_, &thread.cpu_ticks_, &thread.start_ticks_)) {
+      continue;
+    }
+
+    const auto& reg_itr = registered_threads_.find(tid);
+    if ((reg_itr != registered_threads_.end()) &&
+        (reg_itr->second.start_ticks_ == thread.start_ticks_)) {
+      thread.group_ = reg_itr->second.group_;
+      thread.model_name_ = reg_itr->second.model_name_;
+    }
+
+    uint64_t delta_ticks = thread.cpu_ticks_;
+    const auto& prev_itr = polled_threads_.find(tid);
+    if ((prev_itr != polled_threads_.end()) &&
+        (prev_itr->second.start_ticks_ == thread.start_ticks_)) {
+      delta_ticks = thread.cpu_ticks_ - prev_itr->second.cpu_ticks_;
+    }
+
+    const auto key = std::make_pair(thread.group_, thread.model_name_);
+    auto counter_itr = cpu_thread_time_us_.find(key);
+    if (counter_itr == cpu_thread_time_us_.end()) {
+      std::map<std::string, std::string> labels{
+          {kMetricsLabelThreadGroup, thread.group_}};
+      if (!thread.model_name_.empty()) {
+        labels.emplace(kMetricsLabelModelName, thread.model_name_);
+      }
+      counter_itr =
+          cpu_thread_time_us_
+              .emplace(key, &cpu_thread_time_us_family_.Add(labels))
+              .first;
+    }
+    counter_itr->second->Increment(delta_ticks * us_per_tick);
+
+    threads.emplace(tid, std::move(thread));
+  }
+  closedir(dir);
+
+  // Forget the registrations of threads that have exited.
+  for (auto itr = registered_threads_.begin();
+       itr != registered_threads_.end();) {
+    const auto& thread_itr = threads.find(itr->first);
+    if ((thread_itr == threads.end()) ||
+        (thread_itr->second.start_ticks_ != itr->second.start_ticks_)) {
+      itr = registered_threads_.erase(itr);
+    } else {
+      ++itr;
+    }
+  }
+
+  polled_threads_.swap(threads);
+}
+
+void
+Metrics::SetLatencyBuckets(const std::vector<double>& buckets)
+{
+  GetSingleton()->latency_buckets_ = buckets;
+}
+
+void
+Metrics::SetSerializedMaxAge(uint64_t max_age_ms)
+{
+  GetSingleton()->serialized_max_age_ms_.store(max_age_ms);
+}
+
+void
+Metrics::SetGpuPollInterval(uint64_t interval_ms)
+{
+  GetSingleton()->gpu_poll_interval_ms_.store(
+      std::max((uint64_t)1, interval_ms));
+}
+
 bool
 Metrics::InitializeNvmlMetrics()
 {
@@ -200,6 +586,8 @@ Metrics::InitializeNvmlMetrics()
   if (dcnt > 0) {
     nvml_thread_exit_.store(false);
     nvml_thread_.reset(new std::thread([this, dcnt] {
+      SetThreadClass(ThreadClass::BACKGROUND);
+
       // Stop attempting any metric the fails multiple consecutive
       // times for a device.
       constexpr int fail_threshold = 3;
@@ -215,7 +603,8 @@ Metrics::InitializeNvmlMetrics()
       }
 
       while (!nvml_thread_exit_.load()) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(gpu_poll_interval_ms_.load()));
 
         for (unsigned int didx = 0; didx < dcnt; ++didx) {
           nvmlDevice_t gpu;
@@ -372,8 +761,28 @@ const std::string
 Metrics::SerializedMetrics()
 {
   auto singleton = Metrics::GetSingleton();
-  return singleton->serializer_->Serialize(
-      singleton->registry_.get()->Collect());
+  const uint64_t max_age_ms = singleton->serialized_max_age_ms_.load();
+  if (max_age_ms == 0) {
+    return singleton->serializer_->Serialize(
+        singleton->registry_.get()->Collect());
+  }
+
+  // Concurrent scrapes wait for the one that serializes stale
+  // metrics instead of each collecting the registry.
+  std::lock_guard<std::mutex> lock(singleton->serialized_mu_);
+
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  const uint64_t now_ns = TIMESPEC_TO_NANOS(now);
+  if ((singleton->serialized_ns_ == 0) ||
+      ((now_ns - singleton->serialized_ns_) >
+       (max_age_ms * 1000000))) {
+    singleton->serialized_ = singleton->serializer_->Serialize(
+        singleton->registry_.get()->Collect());
+    singleton->serialized_ns_ = now_ns;
+  }
+
+  return singleton->serialized_;
 }
 
 Metrics*
@@ -28,8 +28,13 @@
 
 #ifdef TRTIS_ENABLE_METRICS
 
+#include <sys/types.h>
 #include <atomic>
+#include <map>
+#include <mutex>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 #include "prometheus/registry.h"
 #include "prometheus/serializer.h"
 #include "prometheus/text_serializer.h"
@@ -41,12 +46,45 @@ class Metrics {
   // Enable reporting of GPU metrics
   static void EnableGPUMetrics();
 
+  // Enable reporting of the CPU time of the server threads and of
+  // the process memory
+  static void EnableCPUMetrics();
+
+  // Report the CPU time of the calling thread in thread group 'group'
+  // and, if 'model_name' is not empty, for that model. The CPU time
+  // of a thread that isn't registered is reported in the thread
+  // group named by the thread name.
+  static void RegisterThread(
+      const std::string& group, const std::string& model_name);
+
   // Get the prometheus registry
   static std::shared_ptr<prometheus::Registry> GetRegistry();
 
-  // Get serialized metrics
+  // Get serialized metrics. The serialized metrics are reused until
+  // they are older than the serialized max age.
   static const std::string SerializedMetrics();
 
+  // Set the maximum age, in milliseconds, of the serialized metrics
+  // returned by SerializedMetrics(). 0 serializes the registry on
+  // every call.
+  static void SetSerializedMaxAge(uint64_t max_age_ms);
+
+  // Set the interval, in milliseconds, at which the GPU metrics are
+  // collected from NVML.
+  static void SetGpuPollInterval(uint64_t interval_ms);
+
+  // Set the bucket boundaries, in microseconds, of the inference
+  // latency histograms. Must be called before any model creates its
+  // latency metrics.
+  static void SetLatencyBuckets(const std::vector<double>& buckets);
+
+  // Get the bucket boundaries, in microseconds, of the inference
+  // latency histograms
+  static const std::vector<double>& LatencyBuckets()
+  {
+    return GetSingleton()->latency_buckets_;
+  }
+
   // Get the UUID for a CUDA device. Return true and initialize 'uuid'
   // if a UUID is found, return false if a UUID cannot be returned.
   static bool UUIDForCudaDevice(int cuda_device, std::string* uuid);
@@ -101,17 +139,192 @@ class Metrics {
     return GetSingleton()->inf_queue_duration_us_family_;
   }
 
+  // Metric families of the cumulative input, infer and output parts
+  // of the inference compute duration, in microseconds
+  static prometheus::Family<prometheus::Counter>&
+  FamilyInferenceComputeInputDuration()
+  {
+    return GetSingleton()->inf_compute_input_duration_us_family_;
+  }
+
+  static prometheus::Family<prometheus::Counter>&
+  FamilyInferenceComputeInferDuration()
+  {
+    return GetSingleton()->inf_compute_infer_duration_us_family_;
+  }
+
+  static prometheus::Family<prometheus::Counter>&
+  FamilyInferenceComputeOutputDuration()
+  {
+    return GetSingleton()->inf_compute_output_duration_us_family_;
+  }
+
+  // Metric family of inference request latency histogram, in
+  // microseconds
+  static prometheus::Family<prometheus::Histogram>&
+  FamilyInferenceRequestLatency()
+  {
+    return GetSingleton()->inf_request_latency_us_family_;
+  }
+
+  // Metric family of inference compute latency histogram, in
+  // microseconds
+  static prometheus::Family<prometheus::Histogram>&
+  FamilyInferenceComputeLatency()
+  {
+    return GetSingleton()->inf_compute_latency_us_family_;
+  }
+
+  // Metric family of inference queuing latency histogram, in
+  // microseconds
+  static prometheus::Family<prometheus::Histogram>&
+  FamilyInferenceQueueLatency()
+  {
+    return GetSingleton()->inf_queue_latency_us_family_;
+  }
+
   // Metric family of load-ratio histogram
   static prometheus::Family<prometheus::Histogram>& FamilyInferenceLoadRatio()
   {
     return GetSingleton()->inf_load_ratio_family_;
   }
 
+  // Metric family of the GPU memory held by a model for its weights
+  // and engines, in bytes
+  static prometheus::Family<prometheus::Gauge>& FamilyGpuMemoryModel()
+  {
+    return GetSingleton()->gpu_memory_model_family_;
+  }
+
+  // Metric family of the GPU memory held by a model for activations
+  // and scratch space, in bytes
+  static prometheus::Family<prometheus::Gauge>& FamilyGpuMemoryWorkspace()
+  {
+    return GetSingleton()->gpu_memory_workspace_family_;
+  }
+
+  // Metric family of the GPU memory held by a model for input and
+  // output buffers, in bytes
+  static prometheus::Family<prometheus::Gauge>& FamilyGpuMemoryIO()
+  {
+    return GetSingleton()->gpu_memory_io_family_;
+  }
+
+  // Metric family of the number of requests waiting in the scheduler
+  // queue
+  static prometheus::Family<prometheus::Gauge>& FamilyQueueLength()
+  {
+    return GetSingleton()->queue_length_family_;
+  }
+
+  // Metric family of the number of executions in progress on a model
+  // instance
+  static prometheus::Family<prometheus::Gauge>& FamilyInflightExecutions()
+  {
+    return GetSingleton()->inflight_executions_family_;
+  }
+
+  // Metric family of the batch size of the executions histogram
+  static prometheus::Family<prometheus::Histogram>& FamilyExecutionBatchSize()
+  {
+    return GetSingleton()->exec_batch_size_family_;
+  }
+
+  // Metric family of the number of requests whose response was and
+  // was not found in the response cache
+  static prometheus::Family<prometheus::Counter>& FamilyResponseCacheHits()
+  {
+    return GetSingleton()->response_cache_hits_family_;
+  }
+  static prometheus::Family<prometheus::Counter>& FamilyResponseCacheMisses()
+  {
+    return GetSingleton()->response_cache_misses_family_;
+  }
+
+  // Metric family of the number of sequence batch slots holding a
+  // sequence
+  static prometheus::Family<prometheus::Gauge>& FamilySequenceActiveSlots()
+  {
+    return GetSingleton()->seq_active_slots_family_;
+  }
+
+  // Metric family of the number of sequences waiting in the backlog
+  // for a sequence batch slot
+  static prometheus::Family<prometheus::Gauge>& FamilySequenceBacklogSequences()
+  {
+    return GetSingleton()->seq_backlog_sequences_family_;
+  }
+
+  // Metric family of the number of requests held in the sequence
+  // backlog
+  static prometheus::Family<prometheus::Gauge>& FamilySequenceBacklogRequests()
+  {
+    return GetSingleton()->seq_backlog_requests_family_;
+  }
+
+  // Metric family of the time, in microseconds, that sequences wait
+  // in the backlog
+  static prometheus::Family<prometheus::Histogram>&
+  FamilySequenceBacklogDuration()
+  {
+    return GetSingleton()->seq_backlog_duration_us_family_;
+  }
+
+  // Metric family of the time, in microseconds, that sequences hold a
+  // sequence batch slot
+  static prometheus::Family<prometheus::Histogram>& FamilySequenceLifetime()
+  {
+    return GetSingleton()->seq_lifetime_us_family_;
+  }
+
+  // Metric family of the number of executions of an ensemble step
+  static prometheus::Family<prometheus::Counter>& FamilyEnsembleStepCount()
+  {
+    return GetSingleton()->ens_step_count_family_;
+  }
+
+  // Metric family of cumulative ensemble step queue duration, in
+  // microseconds
+  static prometheus::Family<prometheus::Counter>&
+  FamilyEnsembleStepQueueDuration()
+  {
+    return GetSingleton()->ens_step_queue_duration_us_family_;
+  }
+
+  // Metric family of cumulative ensemble step input duration, in
+  // microseconds
+  static prometheus::Family<prometheus::Counter>&
+  FamilyEnsembleStepInputDuration()
+  {
+    return GetSingleton()->ens_step_input_duration_us_family_;
+  }
+
+  // Metric family of cumulative ensemble step compute duration, in
+  // microseconds
+  static prometheus::Family<prometheus::Counter>&
+  FamilyEnsembleStepComputeDuration()
+  {
+    return GetSingleton()->ens_step_compute_duration_us_family_;
+  }
+
+  // Metric family of the size of the pinned memory pool, in bytes
+  static prometheus::Family<prometheus::Gauge>& FamilyPinnedMemoryPoolTotal()
+  {
+    return GetSingleton()->pinned_memory_pool_total_family_;
+  }
+
+  // Metric family of the pinned memory pool bytes in use
+  static prometheus::Family<prometheus::Gauge>& FamilyPinnedMemoryPoolUsed()
+  {
+    return GetSingleton()->pinned_memory_pool_used_family_;
+  }
+
  private:
   Metrics();
   virtual ~Metrics();
   static Metrics* GetSingleton();
   bool InitializeNvmlMetrics();
+  void PollCpuMetrics();
 
   std::shared_ptr<prometheus::Registry> registry_;
   std::unique_ptr<prometheus::Serializer> serializer_;
@@ -123,13 +336,45 @@ class Metrics {
   prometheus::Family<prometheus::Counter>& inf_request_duration_us_family_;
   prometheus::Family<prometheus::Counter>& inf_compute_duration_us_family_;
   prometheus::Family<prometheus::Counter>& inf_queue_duration_us_family_;
+  prometheus::Family<prometheus::Counter>&
+      inf_compute_input_duration_us_family_;
+  prometheus::Family<prometheus::Counter>&
+      inf_compute_infer_duration_us_family_;
+  prometheus::Family<prometheus::Counter>&
+      inf_compute_output_duration_us_family_;
+  prometheus::Family<prometheus::Histogram>& inf_request_latency_us_family_;
+  prometheus::Family<prometheus::Histogram>& inf_compute_latency_us_family_;
+  prometheus::Family<prometheus::Histogram>& inf_queue_latency_us_family_;
   prometheus::Family<prometheus::Histogram>& inf_load_ratio_family_;
+  prometheus::Family<prometheus::Gauge>& gpu_memory_model_family_;
+  prometheus::Family<prometheus::Gauge>& gpu_memory_workspace_family_;
+  prometheus::Family<prometheus::Gauge>& gpu_memory_io_family_;
+  prometheus::Family<prometheus::Gauge>& queue_length_family_;
+  prometheus::Family<prometheus::Gauge>& inflight_executions_family_;
+  prometheus::Family<prometheus::Histogram>& exec_batch_size_family_;
+  prometheus::Family<prometheus::Counter>& response_cache_hits_family_;
+  prometheus::Family<prometheus::Counter>& response_cache_misses_family_;
+  prometheus::Family<prometheus::Gauge>& seq_active_slots_family_;
+  prometheus::Family<prometheus::Gauge>& seq_backlog_sequences_family_;
+  prometheus::Family<prometheus::Gauge>& seq_backlog_requests_family_;
+  prometheus::Family<prometheus::Histogram>& seq_backlog_duration_us_family_;
+  prometheus::Family<prometheus::Histogram>& seq_lifetime_us_family_;
+  prometheus::Family<prometheus::Counter>& ens_step_count_family_;
+  prometheus::Family<prometheus::Counter>& ens_step_queue_duration_us_family_;
+  prometheus::Family<prometheus::Counter>& ens_step_input_duration_us_family_;
+  prometheus::Family<prometheus::Counter>&
+      ens_step_compute_duration_us_family_;
+  prometheus::Family<prometheus::Gauge>& pinned_memory_pool_total_family_;
+  prometheus::Family<prometheus::Gauge>& pinned_memory_pool_used_family_;
   prometheus::Family<prometheus::Gauge>& gpu_utilization_family_;
   prometheus::Family<prometheus::Gauge>& gpu_memory_total_family_;
   prometheus::Family<prometheus::Gauge>& gpu_memory_used_family_;
   prometheus::Family<prometheus::Gauge>& gpu_power_usage_family_;
   prometheus::Family<prometheus::Gauge>& gpu_power_limit_family_;
   prometheus::Family<prometheus::Counter>& gpu_energy_consumption_family_;
+  prometheus::Family<prometheus::Counter>& cpu_thread_time_us_family_;
+  prometheus::Family<prometheus::Counter>& cpu_process_time_us_family_;
+  prometheus::Family<prometheus::Gauge>& cpu_memory_resident_family_;
 
   std::vector<prometheus::Gauge*> gpu_utilization_;
   std::vector<prometheus::Gauge*> gpu_memory_total_;
@@ -138,9 +383,45 @@ class Metrics {
   std::vector<prometheus::Gauge*> gpu_power_limit_;
   std::vector<prometheus::Counter*> gpu_energy_consumption_;
 
+  std::vector<double> latency_buckets_;
+
+  // The last serialized metrics and the CLOCK_MONOTONIC time, in
+  // nanoseconds, at which they were serialized.
+  std::atomic<uint64_t> serialized_max_age_ms_;
+  std::mutex serialized_mu_;
+  std::string serialized_;
+  uint64_t serialized_ns_;
+
+  std::atomic<uint64_t> gpu_poll_interval_ms_;
+
   bool gpu_metrics_enabled_;
   std::unique_ptr<std::thread> nvml_thread_;
   std::atomic<bool> nvml_thread_exit_;
+
+  // A thread whose CPU time is reported. 'start_ticks_' is the start
+  // time of the thread, which tells apart threads that reuse a
+  // thread ID.
+  struct CpuThread {
+    std::string group_;
+    std::string model_name_;
+    uint64_t start_ticks_;
+    uint64_t cpu_ticks_;
+  };
+
+  // The registered threads, and the threads seen by the last poll,
+  // by thread ID.
+  std::mutex cpu_threads_mu_;
+  std::unordered_map<pid_t, CpuThread> registered_threads_;
+  std::unordered_map<pid_t, CpuThread> polled_threads_;
+  std::map<std::pair<std::string, std::string>, prometheus::Counter*>
+      cpu_thread_time_us_;
+  prometheus::Counter* cpu_process_time_us_;
+  prometheus::Gauge* cpu_memory_resident_;
+  uint64_t cpu_process_ticks_;
+
+  bool cpu_metrics_enabled_;
+  std::unique_ptr<std::thread> cpu_thread_;
+  std::atomic<bool> cpu_thread_exit_;
 };
 
 }}  // namespace nvidia::inferenceserver
@@ -80,6 +80,18 @@ enum Platform {
 #endif  // TRTIS_ENABLE_PYTORCH
 };
 
+/// Policy for placing the instances of a KIND_GPU instance group that
+/// doesn't list its GPUs. With PLACEMENT_NONE the group has 'count'
+/// instances on every GPU. Otherwise the group has 'count' instances in
+/// total, each placed on the GPU with the least estimated memory and
+/// instances (PLACEMENT_BALANCED) or on the GPU with the most estimated
+/// memory and instances that still has room for it (PLACEMENT_PACK).
+enum InstancePlacement {
+  PLACEMENT_NONE = 0,
+  PLACEMENT_BALANCED = 1,
+  PLACEMENT_PACK = 2
+};
+
 /// Get the number of elements in a shape.
 /// \param dims The shape.
 /// \return The number of elements, or -1 if the number of elements
@@ -26,10 +26,18 @@
 
 #include "src/core/model_config_utils.h"
 
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
 #include <deque>
+#include <fstream>
+#include <map>
 #include <set>
 #include "src/core/autofill.h"
 #include "src/core/constants.h"
+#include "src/core/cpu_isolation.h"
 #include "src/core/filesystem.h"
 #include "src/core/logging.h"
 
@@ -39,6 +47,89 @@
 
 namespace nvidia { namespace inferenceserver {
 
+namespace {
+
+// Choose defaults for the unspecified settings of 'batcher'.
+void
+NormalizeDynamicBatching(
+    const int32_t max_batch_size, ModelDynamicBatching* batcher)
+{
+  // If preferred batch size is not specified choose
+  // automatically. For now we just choose 4, 8 as those are
+  // generally good values for GPUs.
+  if (batcher->preferred_batch_size().size() == 0) {
+    if (max_batch_size >= 4) {
+      batcher->mutable_preferred_batch_size()->Add(4);
+    }
+    if (max_batch_size >= 8) {
+      batcher->mutable_preferred_batch_size()->Add(8);
+    }
+  }
+
+  // If priority levels are enabled and a default level is not
+  // specified then requests default to the lowest priority.
+  if ((batcher->priority_levels() > 0) &&
+      (batcher->default_priority_level() == 0)) {
+    batcher->set_default_priority_level(batcher->priority_levels());
+  }
+}
+
+// Validate the settings of 'batcher', a dynamic batcher of 'config'.
+Status
+ValidateDynamicBatching(
+    const ModelConfig& config, const ModelDynamicBatching& batcher)
+{
+  for (const auto size : batcher.preferred_batch_size()) {
+    if (size <= 0) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "dynamic batching preferred size must be positive for " +
+              config.name());
+    }
+    if (size > config.max_batch_size()) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "dynamic batching preferred size must be <= max batch size for " +
+              config.name());
+    }
+  }
+
+  if ((batcher.priority_levels() == 0) &&
+      (batcher.default_priority_level() != 0)) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "dynamic batching default priority level requires priority levels "
+        "to be enabled for " +
+            config.name());
+  }
+  if (batcher.default_priority_level() > batcher.priority_levels()) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "dynamic batching default priority level must be in range [ 1, " +
+            std::to_string(batcher.priority_levels()) + " ] for " +
+            config.name());
+  }
+  if (batcher.has_adaptive_queue_delay() &&
+      (batcher.adaptive_queue_delay().target_latency_microseconds() == 0)) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "dynamic batching adaptive queue delay requires a non-zero target "
+        "latency for " +
+            config.name());
+  }
+  if (batcher.instance_queues() && batcher.has_instance_autoscaling()) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "dynamic batching instance queues can't be used with instance "
+        "autoscaling for " +
+            config.name());
+  }
+
+  return Status::Success;
+}
+
+}  // namespace
+
 Status
 GetModelVersionFromPath(const std::string& path, int64_t* version)
 {
@@ -180,27 +271,42 @@ GetSequenceControlProperties(
 Status
 GetNormalizedModelConfig(
     const std::string& path, const BackendConfigMap& backend_config_map,
-    const bool autofill, ModelConfig* config)
+    const bool autofill, AutoFillCache* autofill_cache,
+    const bool assign_all_gpus, ModelConfig* config)
 {
-  // If 'autofill' then the configuration file can be empty.
-  const auto config_path = JoinPath({path, kModelConfigPbTxt});
-  bool model_config_exists;
-  RETURN_IF_ERROR(FileExists(config_path, &model_config_exists));
-  if (autofill && !model_config_exists) {
-    config->Clear();
+  // Autofill is skipped if the model files, including the configuration
+  // file, are unchanged since the configuration was last autofilled.
+  const std::string model_name(BaseName(path));
+  size_t fingerprint = 0;
+  const bool cacheable =
+      autofill && (autofill_cache != nullptr) &&
+      autofill_cache->Fingerprint(path, &fingerprint).IsOk();
+  if (cacheable && autofill_cache->Lookup(model_name, fingerprint, config)) {
+    LOG_VERBOSE(1) << "using cached autofilled config for " << model_name;
   } else {
-    RETURN_IF_ERROR(ReadTextProto(config_path, config));
-  }
+    // If 'autofill' then the configuration file can be empty.
+    const auto config_path = JoinPath({path, kModelConfigPbTxt});
+    bool model_config_exists;
+    RETURN_IF_ERROR(FileExists(config_path, &model_config_exists));
+    if (autofill && !model_config_exists) {
+      config->Clear();
+    } else {
+      RETURN_IF_ERROR(ReadTextProto(config_path, config));
+    }
+
+    // Autofill if requested...
+    if (autofill) {
+      std::unique_ptr<AutoFill> af;
+      RETURN_IF_ERROR(AutoFill::Create(
+          model_name, backend_config_map, std::string(path), *config, &af));
+      RETURN_IF_ERROR(af->Fix(config));
 
-  // Autofill if requested...
-  if (autofill) {
-    const std::string model_name(BaseName(path));
-    std::unique_ptr<AutoFill> af;
-    RETURN_IF_ERROR(AutoFill::Create(
-        model_name, backend_config_map, std::string(path), *config, &af));
-    RETURN_IF_ERROR(af->Fix(config));
+      LOG_VERBOSE(1) << "autofilled config: " << config->DebugString();
 
-    LOG_VERBOSE(1) << "autofilled config: " << config->DebugString();
+      if (cacheable) {
+        autofill_cache->Insert(model_name, fingerprint, *config);
+      }
+    }
   }
 
   if (config->platform().empty()) {
@@ -263,19 +369,14 @@ GetNormalizedModelConfig(
 
   // If dynamic batching is specified...
   if (config->has_dynamic_batching()) {
-    // If preferred batch size is not specified choose
-    // automatically. For now we just choose 4, 8 as those are
-    // generally good values for GPUs.
-    if (config->dynamic_batching().preferred_batch_size().size() == 0) {
-      if (config->max_batch_size() >= 4) {
-        config->mutable_dynamic_batching()->mutable_preferred_batch_size()->Add(
-            4);
-      }
-      if (config->max_batch_size() >= 8) {
-        config->mutable_dynamic_batching()->mutable_preferred_batch_size()->Add(
-            8);
-      }
-    }
+    NormalizeDynamicBatching(
+        config->max_batch_size(), config->mutable_dynamic_batching());
+  }
+  if (config->has_ensemble_scheduling() &&
+      config->ensemble_scheduling().has_dynamic_batching()) {
+    NormalizeDynamicBatching(
+        config->max_batch_size(),
+        config->mutable_ensemble_scheduling()->mutable_dynamic_batching());
   }
 
   // If sequence batching is specified...
@@ -309,7 +410,8 @@ GetNormalizedModelConfig(
 
     // Assign default name, kind and count to each instance group that
     // doesn't give those values explicitly. For KIND_GPU, set GPUs to
-    // all available if not specified explicitly.
+    // all available if not specified explicitly, unless the caller
+    // places them.
     size_t cnt = 0;
     for (auto& group : *config->mutable_instance_group()) {
       // Name
@@ -342,8 +444,12 @@ GetNormalizedModelConfig(
         group.set_count(1);
       }
 
-      // GPUs
-      if ((group.kind() == ModelInstanceGroup::KIND_GPU) &&
+      // GPUs. A KIND_MULTI_GPU instance spans all available GPUs if
+      // not specified explicitly.
+      if ((assign_all_gpus ||
+           (group.kind() == ModelInstanceGroup::KIND_MULTI_GPU)) &&
+          ((group.kind() == ModelInstanceGroup::KIND_GPU) ||
+           (group.kind() == ModelInstanceGroup::KIND_MULTI_GPU)) &&
           (group.gpus().size() == 0)) {
         for (auto d : supported_gpus) {
           group.add_gpus(d);
@@ -398,24 +504,62 @@ ValidateModelConfig(
     }
   }
 
+  // An output trimmed to a padded input must have no more
+  // variable-size dimensions than the input to be trimmed to.
+  for (const auto& io : config.output()) {
+    if (io.padded_input().empty()) {
+      continue;
+    }
+    const ModelInput* padded_input = nullptr;
+    for (const auto& input : config.input()) {
+      if ((input.name() == io.padded_input()) && input.has_padding()) {
+        padded_input = &input;
+      }
+    }
+    if (padded_input == nullptr) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "model output '" + io.name() + "' padded input '" +
+              io.padded_input() + "' is not an input with padding for " +
+              config.name());
+    }
+    if ((io.data_type() == DataType::TYPE_STRING) || io.has_reshape() ||
+        (std::count(io.dims().begin(), io.dims().end(), -1) >
+         std::count(
+             padded_input->dims().begin(), padded_input->dims().end(), -1))) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "model output '" + io.name() +
+              "' trimmed to a padded input requires a fixed-size data-type, "
+              "no reshape and at most as many variable-size dimensions as "
+              "the input for " +
+              config.name());
+    }
+  }
+
   // If dynamic batching is specified make sure the preferred batch
   // sizes are positive and don't exceed maximum batch size. Make sure
   // the max delay is non-negative.
   if (config.has_dynamic_batching()) {
-    for (const auto size : config.dynamic_batching().preferred_batch_size()) {
-      if (size <= 0) {
-        return Status(
-            RequestStatusCode::INVALID_ARG,
-            "dynamic batching preferred size must be positive for " +
-                config.name());
-      }
-      if (size > config.max_batch_size()) {
-        return Status(
-            RequestStatusCode::INVALID_ARG,
-            "dynamic batching preferred size must be <= max batch size for " +
-                config.name());
-      }
-    }
+    RETURN_IF_ERROR(ValidateDynamicBatching(config, config.dynamic_batching()));
+  }
+
+  // The response cache returns stored outputs without executing the
+  // model, so it can't be used with stateful models.
+  if (config.response_cache().enable() && config.has_sequence_batching()) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "response cache can't be enabled for model '" + config.name() +
+            "' that uses sequence batching");
+  }
+
+  // Requests of a sequence must all execute on the same version.
+  if ((config.version_routing().weights_size() > 0) &&
+      config.has_sequence_batching()) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "version routing can't be used for model '" + config.name() +
+            "' that uses sequence batching");
   }
 
   // If sequence batching is specified make sure the control is
@@ -443,6 +587,72 @@ ValidateModelConfig(
         ModelSequenceBatching::Control::CONTROL_SEQUENCE_READY,
         true /* required */, &tensor_name, nullptr, nullptr, nullptr, nullptr,
         nullptr));
+
+    // Make sure each implicit state is fed by a model output of the
+    // same type and feeds an input that the client does not provide.
+    std::set<std::string> state_inputs;
+    for (const auto& state : batcher.state()) {
+      if (state.input_name().empty() || state.output_name().empty()) {
+        return Status(
+            RequestStatusCode::INVALID_ARG,
+            "sequence batching state must specify an input and output name "
+            "for " +
+                config.name());
+      }
+
+      bool input_conflict = !state_inputs.insert(state.input_name()).second;
+      for (const auto& io : config.input()) {
+        input_conflict |= (io.name() == state.input_name());
+      }
+      for (const auto& control_input : batcher.control_input()) {
+        input_conflict |= (control_input.name() == state.input_name());
+      }
+      if (input_conflict) {
+        return Status(
+            RequestStatusCode::INVALID_ARG,
+            "sequence batching state input '" + state.input_name() +
+                "' conflicts with another input for " + config.name());
+      }
+
+      const ModelOutput* output = nullptr;
+      for (const auto& io : config.output()) {
+        if (io.name() == state.output_name()) {
+          output = &io;
+          break;
+        }
+      }
+      if (output == nullptr) {
+        return Status(
+            RequestStatusCode::INVALID_ARG,
+            "sequence batching state output '" + state.output_name() +
+                "' must be a model output for " + config.name());
+      }
+
+      if ((state.data_type() == DataType::TYPE_INVALID) ||
+          (state.data_type() == DataType::TYPE_STRING) ||
+          (state.data_type() != output->data_type())) {
+        return Status(
+            RequestStatusCode::INVALID_ARG,
+            "sequence batching state '" + state.input_name() +
+                "' must have a fixed-size data-type matching output '" +
+                state.output_name() + "' for " + config.name());
+      }
+
+      if (state.dims_size() == 0) {
+        return Status(
+            RequestStatusCode::INVALID_ARG,
+            "sequence batching state '" + state.input_name() +
+                "' must specify dims for " + config.name());
+      }
+      for (const auto dim : state.dims()) {
+        if (dim <= 0) {
+          return Status(
+              RequestStatusCode::INVALID_ARG,
+              "sequence batching state '" + state.input_name() +
+                  "' dims must be fixed size for " + config.name());
+        }
+      }
+    }
   }
 
   // If ensemble scheduling is specified, validate it.
@@ -475,6 +685,15 @@ ValidateModelConfig(
 #endif  // TRTIS_ENABLE_GPU
 
     for (const auto& group : config.instance_group()) {
+      for (const int32_t cpu : group.host_cpus()) {
+        if (cpu < 0) {
+          return Status(
+              RequestStatusCode::INVALID_ARG,
+              "instance group " + group.name() + " of model " + config.name() +
+                  " specifies invalid host cpu id of " + std::to_string(cpu));
+        }
+      }
+
       // KIND_MODEL is supported only on TensorFlow.
       if (group.kind() == ModelInstanceGroup::KIND_MODEL) {
         if (group.gpus().size() > 0) {
@@ -495,18 +714,53 @@ ValidateModelConfig(
                   " has kind KIND_MODEL which is supported only on TensorFlow "
                   "models");
         }
-      } else if (group.kind() == ModelInstanceGroup::KIND_GPU) {
+      } else if (
+          (group.kind() == ModelInstanceGroup::KIND_GPU) ||
+          (group.kind() == ModelInstanceGroup::KIND_MULTI_GPU)) {
+        const std::string& kind_name =
+            ModelInstanceGroup::Kind_Name(group.kind());
 #ifndef TRTIS_ENABLE_GPU
         return Status(
             RequestStatusCode::INVALID_ARG,
             "instance group " + group.name() + " of model " + config.name() +
-                " has kind KIND_GPU but server does not support GPUs");
+                " has kind " + kind_name +
+                " but server does not support GPUs");
 #else
         if (group.gpus().size() == 0) {
           return Status(
               RequestStatusCode::INVALID_ARG,
               "instance group " + group.name() + " of model " + config.name() +
-                  " has kind KIND_GPU but specifies no GPUs");
+                  " has kind " + kind_name + " but specifies no GPUs");
+        }
+
+        // KIND_MULTI_GPU is supported only on the backends that give an
+        // instance all of its GPUs.
+        if (group.kind() == ModelInstanceGroup::KIND_MULTI_GPU) {
+          bool supported = false;
+#ifdef TRTIS_ENABLE_CUSTOM
+          supported |= (config.platform() == kCustomPlatform);
+#endif  // TRTIS_ENABLE_CUSTOM
+#ifdef TRTIS_ENABLE_PYTORCH
+          supported |= (config.platform() == kPyTorchLibTorchPlatform);
+#endif  // TRTIS_ENABLE_PYTORCH
+          if (!supported) {
+            return Status(
+                RequestStatusCode::INVALID_ARG,
+                "instance group " + group.name() + " of model " +
+                    config.name() + " on platform " + config.platform() +
+                    " has kind KIND_MULTI_GPU which is supported only on "
+                    "Custom and PyTorch models");
+          }
+
+          const std::set<int32_t> unique_gpus(
+              group.gpus().begin(), group.gpus().end());
+          if (unique_gpus.size() != (size_t)group.gpus().size()) {
+            return Status(
+                RequestStatusCode::INVALID_ARG,
+                "instance group " + group.name() + " of model " +
+                    config.name() +
+                    " has kind KIND_MULTI_GPU but lists a GPU more than once");
+          }
         }
 
         for (const int32_t gid : group.gpus()) {
@@ -562,6 +816,16 @@ ValidateEnsembleSchedulingConfig(const ModelConfig& config)
         "optimization should not be specified for ensemble '" + config.name() +
             "'");
   }
+  if (config.ensemble_scheduling().has_dynamic_batching()) {
+    if (config.max_batch_size() == 0) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "dynamic batching requires a non-zero max batch size for ensemble '" +
+              config.name() + "'");
+    }
+    RETURN_IF_ERROR(ValidateDynamicBatching(
+        config, config.ensemble_scheduling().dynamic_batching()));
+  }
 
   // Make sure step is not empty and all fields are set
   if (config.ensemble_scheduling().step_size() == 0) {
@@ -625,6 +889,43 @@ ValidateEnsembleSchedulingConfig(const ModelConfig& config)
       outputs.insert(it->first);
     }
   }
+  // The outputs of a skipped step are filled with zeros, which requires
+  // every ensemble output that may be skipped to have a fixed size.
+  std::set<std::string> skippable_tensors;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (const auto& element : config.ensemble_scheduling().step()) {
+      bool skippable = element.has_condition();
+      for (const auto& input_map : element.input_map()) {
+        if (skippable_tensors.find(input_map.second) !=
+            skippable_tensors.end()) {
+          skippable = true;
+          break;
+        }
+      }
+      if (skippable) {
+        for (const auto& output_map : element.output_map()) {
+          changed |= skippable_tensors.insert(output_map.second).second;
+        }
+      }
+    }
+  }
+  for (const auto& output : config.output()) {
+    if (skippable_tensors.find(output.name()) == skippable_tensors.end()) {
+      continue;
+    }
+    const auto& dims =
+        output.has_reshape() ? output.reshape().shape() : output.dims();
+    if ((output.data_type() == TYPE_STRING) || (GetElementCount(dims) < 0)) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "output '" + output.name() + "' for ensemble '" + config.name() +
+              "' can be skipped by a conditional step and must have a "
+              "fixed-size data type and shape");
+    }
+  }
+
   // Check redundant ensemble tensors
   for (const auto& tensor : tensors) {
     // skip ensemble outputs as they have been checked and can have no
@@ -717,6 +1018,30 @@ BuildEnsembleGraph(
       }
     }
 
+    // The condition tensor must be ready before the step can run so
+    // it is linked like an input.
+    if (element.has_condition()) {
+      const auto& condition_tensor = element.condition().tensor();
+      if (condition_tensor.empty()) {
+        return Status(
+            RequestStatusCode::INVALID_ARG,
+            "must specify 'tensor' for the condition in step " +
+                std::to_string(step_idx) + " of ensemble '" + config.name() +
+                "'");
+      }
+      auto it = keyed_ensemble_graph.find(condition_tensor);
+      if (it == keyed_ensemble_graph.end()) {
+        it = keyed_ensemble_graph
+                 .emplace(
+                     std::make_pair(condition_tensor, EnsembleTensor(false)))
+                 .first;
+      }
+      for (auto output : tensor_as_output) {
+        output->prev_nodes.push_back(&(it->second));
+        it->second.next_nodes.push_back(output);
+      }
+    }
+
     step_idx++;
   }
 
@@ -857,6 +1182,48 @@ ValidateModelInput(const ModelInput& io, int32_t max_batch_size)
         RequestStatusCode::INVALID_ARG, "model input NHWC/NCHW require 3 dims");
   }
 
+  if (io.conversion().data_type_size() > 0) {
+    if (io.data_type() != DataType::TYPE_FP32) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "model input '" + io.name() +
+              "' conversion requires data-type TYPE_FP32");
+    }
+    for (const auto data_type : io.conversion().data_type()) {
+      if ((data_type != DataType::TYPE_UINT8) &&
+          (data_type != DataType::TYPE_INT8) &&
+          (data_type != DataType::TYPE_FP16)) {
+        return Status(
+            RequestStatusCode::INVALID_ARG,
+            "model input '" + io.name() + "' can't be converted from " +
+                DataType_Name(static_cast<DataType>(data_type)) +
+                ", allowed data-types are TYPE_UINT8, TYPE_INT8 and "
+                "TYPE_FP16");
+      }
+    }
+  }
+
+  if (io.has_padding()) {
+    if ((io.data_type() == DataType::TYPE_STRING) || io.has_reshape() ||
+        (GetElementCount(io) != -1)) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "model input '" + io.name() +
+              "' padding requires a fixed-size data-type, a variable-size "
+              "dimension and no reshape");
+    }
+    int64_t prev_size = 0;
+    for (const auto bucket_size : io.padding().bucket_size()) {
+      if (bucket_size <= prev_size) {
+        return Status(
+            RequestStatusCode::INVALID_ARG,
+            "model input '" + io.name() +
+                "' padding bucket sizes must be positive and increasing");
+      }
+      prev_size = bucket_size;
+    }
+  }
+
   return Status::Success;
 }
 
@@ -888,6 +1255,138 @@ ValidateModelOutput(const ModelOutput& io, int32_t max_batch_size)
   return Status::Success;
 }
 
+float
+HalfToFloat(const uint16_t half)
+{
+  const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+  uint32_t exponent = (half >> 10) & 0x1f;
+  uint32_t mantissa = half & 0x3ff;
+
+  uint32_t bits;
+  if (exponent == 0x1f) {
+    // Infinity or NaN
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  } else if (exponent != 0) {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  } else if (mantissa == 0) {
+    bits = sign;
+  } else {
+    // A subnormal half is a normal float.
+    exponent = 113;
+    while ((mantissa & 0x400) == 0) {
+      mantissa <<= 1;
+      exponent--;
+    }
+    bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+  }
+
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+uint16_t
+FloatToHalf(const float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const uint16_t sign = (bits >> 16) & 0x8000;
+  const uint32_t exponent = (bits >> 23) & 0xff;
+  const uint32_t mantissa = bits & 0x7fffff;
+
+  if (exponent == 0xff) {
+    // Infinity or NaN, a NaN stays a (quiet) NaN.
+    return sign | ((mantissa == 0) ? 0x7c00 : (0x7e00 | (mantissa >> 13)));
+  }
+
+  const int32_t half_exponent = static_cast<int32_t>(exponent) - 112;
+  if (half_exponent >= 0x1f) {
+    return sign | 0x7c00;
+  }
+
+  // The half value and the bits of 'value' that are shifted out of it.
+  uint32_t half;
+  uint32_t shift;
+  uint32_t rest_mantissa;
+  if (half_exponent > 0) {
+    half = (static_cast<uint32_t>(half_exponent) << 10) | (mantissa >> 13);
+    shift = 13;
+    rest_mantissa = mantissa;
+  } else {
+    // A subnormal half, or zero if even rounding can't reach the
+    // smallest subnormal.
+    shift = static_cast<uint32_t>(14 - half_exponent);
+    if (shift > 24) {
+      return sign;
+    }
+    rest_mantissa = mantissa | 0x800000;
+    half = rest_mantissa >> shift;
+  }
+
+  // Round to nearest even. A carry out of the mantissa correctly
+  // increments the exponent, up to infinity.
+  const uint32_t rest = rest_mantissa & ((1u << shift) - 1);
+  const uint32_t halfway = 1u << (shift - 1);
+  if ((rest > halfway) || ((rest == halfway) && ((half & 1) != 0))) {
+    half++;
+  }
+
+  return sign | static_cast<uint16_t>(half);
+}
+
+void
+CopyTensorRegion(
+    const char* src, const std::vector<int64_t>& src_shape, char* dst,
+    const std::vector<int64_t>& dst_shape, const size_t element_byte_size)
+{
+  const size_t rank = src_shape.size();
+  if (rank == 0) {
+    memmove(dst, src, element_byte_size);
+    return;
+  }
+
+  std::vector<int64_t> region(rank);
+  std::vector<size_t> src_stride(rank), dst_stride(rank);
+  size_t src_byte_size = element_byte_size;
+  size_t dst_byte_size = element_byte_size;
+  for (size_t d = rank; d-- > 0;) {
+    region[d] = std::min(src_shape[d], dst_shape[d]);
+    if (region[d] <= 0) {
+      return;
+    }
+    src_stride[d] = src_byte_size;
+    dst_stride[d] = dst_byte_size;
+    src_byte_size *= src_shape[d];
+    dst_byte_size *= dst_shape[d];
+  }
+
+  // Copy one innermost row of the region at a time. Rows are copied
+  // in order with memmove, so when trimming in place no row is
+  // overwritten before it is copied.
+  const size_t row_byte_size = region[rank - 1] * element_byte_size;
+  std::vector<int64_t> idx(rank, 0);
+  while (true) {
+    size_t src_offset = 0;
+    size_t dst_offset = 0;
+    for (size_t d = 0; d < rank - 1; ++d) {
+      src_offset += idx[d] * src_stride[d];
+      dst_offset += idx[d] * dst_stride[d];
+    }
+    memmove(dst + dst_offset, src + src_offset, row_byte_size);
+
+    size_t d = rank - 1;
+    for (; d > 0; --d) {
+      if (++idx[d - 1] < region[d - 1]) {
+        break;
+      }
+      idx[d - 1] = 0;
+    }
+    if (d == 0) {
+      return;
+    }
+  }
+}
+
 Status
 CheckAllowedModelOutput(
     const ModelOutput& io, const std::set<std::string>& allowed)
@@ -910,6 +1409,153 @@ CheckAllowedModelOutput(
   return Status::Success;
 }
 
+namespace {
+
+// Get the host CPUs that are local to a GPU, that is, on the same
+// NUMA node as the GPU's PCIe root. Return an empty list if the CPUs
+// can't be determined or if all CPUs in the system are local, since
+// there is then no benefit in binding to them.
+std::vector<int>
+GetGpuLocalCpus(const int gpu_device)
+{
+  std::vector<int> cpus;
+
+#ifdef TRTIS_ENABLE_GPU
+  char pcibusid[64];
+  cudaError_t cuerr =
+      cudaDeviceGetPCIBusId(pcibusid, sizeof(pcibusid) - 1, gpu_device);
+  if (cuerr != cudaSuccess) {
+    return cpus;
+  }
+
+  std::string busid(pcibusid);
+  std::transform(busid.begin(), busid.end(), busid.begin(), ::tolower);
+
+  std::ifstream file("/sys/bus/pci/devices/" + busid + "/local_cpulist");
+  std::string list;
+  if (!file || !std::getline(file, list) || !ParseCpuList(list, &cpus)) {
+    cpus.clear();
+    return cpus;
+  }
+
+  if (cpus.size() >= (size_t)sysconf(_SC_NPROCESSORS_ONLN)) {
+    cpus.clear();
+  }
+#endif  // TRTIS_ENABLE_GPU
+
+  return cpus;
+}
+
+// Restrict the GPU-local CPUs to the scheduler CPUs when thread
+// classes are isolated. If none of them are scheduler CPUs, or if the
+// GPU-local CPUs aren't known, use all the scheduler CPUs.
+std::vector<int>
+SchedulerCpus(const std::vector<int>& local_cpus)
+{
+  const std::vector<int>& scheduler_cpus =
+      ThreadClassCpus(ThreadClass::SCHEDULER);
+  if (scheduler_cpus.empty()) {
+    return local_cpus;
+  }
+
+  std::vector<int> cpus;
+  for (const int cpu : local_cpus) {
+    if (std::find(scheduler_cpus.begin(), scheduler_cpus.end(), cpu) !=
+        scheduler_cpus.end()) {
+      cpus.push_back(cpu);
+    }
+  }
+
+  return cpus.empty() ? scheduler_cpus : cpus;
+}
+
+}  // namespace
+
+void
+GetRunnerPlacements(
+    const ModelConfig& config, const uint32_t runner_cnt,
+    std::vector<RunnerPlacement>* placements)
+{
+  placements->clear();
+
+  // Find the host CPUs local to each GPU only once.
+  std::map<int, std::vector<int>> gpu_local_cpus;
+
+  for (const auto& group : config.instance_group()) {
+    std::vector<int> host_cpus(
+        group.host_cpus().begin(), group.host_cpus().end());
+    auto AddGpuPlacement = [&](const int gpu_device) {
+      RunnerPlacement placement;
+      placement.gpu_device_ = gpu_device;
+      if (!host_cpus.empty()) {
+        placement.host_cpus_ = host_cpus;
+      } else {
+        auto itr = gpu_local_cpus.find(gpu_device);
+        if (itr == gpu_local_cpus.end()) {
+          itr = gpu_local_cpus
+                    .emplace(
+                        gpu_device, SchedulerCpus(GetGpuLocalCpus(gpu_device)))
+                    .first;
+        }
+        placement.host_cpus_ = itr->second;
+      }
+      placements->push_back(placement);
+    };
+
+    for (int c = 0; c < group.count(); c++) {
+      if (group.kind() == ModelInstanceGroup::KIND_GPU) {
+        for (const int gpu_device : group.gpus()) {
+          AddGpuPlacement(gpu_device);
+        }
+      } else if (
+          (group.kind() == ModelInstanceGroup::KIND_MULTI_GPU) &&
+          (group.gpus().size() > 0)) {
+        AddGpuPlacement(group.gpus(0));
+      } else {
+        RunnerPlacement placement;
+        placement.host_cpus_ =
+            host_cpus.empty() ? ThreadClassCpus(ThreadClass::SCHEDULER)
+                              : host_cpus;
+        placements->push_back(placement);
+      }
+    }
+  }
+
+  // If the runners don't follow the instance groups then their
+  // placement isn't known, so they run on the scheduler CPUs.
+  if (placements->size() != runner_cnt) {
+    RunnerPlacement placement;
+    placement.host_cpus_ = ThreadClassCpus(ThreadClass::SCHEDULER);
+    placements->assign(runner_cnt, placement);
+  }
+}
+
+Status
+SetThreadCpuAffinity(const std::vector<int>& host_cpus)
+{
+  if (host_cpus.empty()) {
+    return Status::Success;
+  }
+
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (const int cpu : host_cpus) {
+    if ((cpu >= 0) && (cpu < CPU_SETSIZE)) {
+      CPU_SET(cpu, &cpuset);
+    }
+  }
+
+  const int err =
+      pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+  if (err != 0) {
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "unable to set CPU affinity: " + std::string(strerror(err)));
+  }
+
+  return Status::Success;
+}
+
 #ifdef TRTIS_ENABLE_GPU
 Status
 CheckGPUCompatibility(const int gpu_id)
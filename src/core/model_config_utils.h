@@ -31,6 +31,8 @@
 
 namespace nvidia { namespace inferenceserver {
 
+class AutoFillCache;
+
 struct EnsembleTensor {
   EnsembleTensor(bool isOutput) : ready(false), isOutput(isOutput) {}
   bool ready;
@@ -65,11 +67,18 @@ Status GetSequenceControlProperties(
 /// configuration for that platform.
 /// \param autofill If true attempt to determine any missing required
 /// configuration from the model definition.
+/// \param autofill_cache If non-null the cache of the configurations
+/// completed by autofill, so that autofill is skipped for a model whose
+/// files haven't changed since it was last autofilled.
+/// \param assign_all_gpus If true a KIND_GPU instance group that
+/// doesn't list its GPUs is given all the available GPUs, otherwise its
+/// GPUs are left for the caller to place.
 /// \param config Returns the normalized model configuration.
 /// \return The error status.
 Status GetNormalizedModelConfig(
     const std::string& path, const BackendConfigMap& backend_config_map,
-    const bool autofill, ModelConfig* config);
+    const bool autofill, AutoFillCache* autofill_cache,
+    const bool assign_all_gpus, ModelConfig* config);
 
 /// Validate that a model is specified correctly.
 /// \param config The model configuration to validate.
@@ -131,6 +140,62 @@ Status ValidateModelOutput(const ModelOutput& io, int32_t max_batch_size);
 Status CheckAllowedModelOutput(
     const ModelOutput& io, const std::set<std::string>& allowed);
 
+/// Convert an IEEE 754 half-precision value, given by its bits, to
+/// single precision.
+/// \param half The bits of the half-precision value.
+/// \return The single-precision value.
+float HalfToFloat(const uint16_t half);
+
+/// Convert a single-precision value to IEEE 754 half precision,
+/// rounding to the nearest even value.
+/// \param value The single-precision value.
+/// \return The bits of the half-precision value.
+uint16_t FloatToHalf(const float value);
+
+/// Copy the region that two row-major tensors of the same rank have
+/// in common, the smaller extent in each dimension, from 'src' to
+/// 'dst'. Elements of 'dst' outside the region are not written. A
+/// tensor can be trimmed in place by passing the same buffer as 'src'
+/// and 'dst'.
+/// \param src The source tensor.
+/// \param src_shape The shape of the source tensor.
+/// \param dst The destination tensor.
+/// \param dst_shape The shape of the destination tensor.
+/// \param element_byte_size The size of each element, in bytes.
+void CopyTensorRegion(
+    const char* src, const std::vector<int64_t>& src_shape, char* dst,
+    const std::vector<int64_t>& dst_shape, const size_t element_byte_size);
+
+/// The placement of a runner, that is, an execution context, of a
+/// model.
+struct RunnerPlacement {
+  RunnerPlacement() : gpu_device_(-1) {}
+
+  /// The GPU that the runner executes on, or -1 if the runner
+  /// doesn't use a specific GPU.
+  int gpu_device_;
+
+  /// The host CPUs that the threads of the runner should run on, or
+  /// empty if the threads should not be bound to specific CPUs.
+  std::vector<int> host_cpus_;
+};
+
+/// Get the placement of each runner of a model. Backends create one
+/// runner for each instance of each instance group, in order, and a
+/// GPU instance has one runner for each of its GPUs. A KIND_MULTI_GPU
+/// instance has a single runner placed on its first GPU.
+/// \param config The model configuration.
+/// \param runner_cnt The number of runners created for the model.
+/// \param placements Returns the placement of each runner.
+void GetRunnerPlacements(
+    const ModelConfig& config, const uint32_t runner_cnt,
+    std::vector<RunnerPlacement>* placements);
+
+/// Bind the calling thread to a set of host CPUs.
+/// \param host_cpus The CPUs. If empty the thread is not bound.
+/// \return The error status.
+Status SetThreadCpuAffinity(const std::vector<int>& host_cpus);
+
 #ifdef TRTIS_ENABLE_GPU
 /// Validates the compute capability of the GPU indexed
 /// \param The index of the target GPU.
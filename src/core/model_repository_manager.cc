@@ -27,17 +27,31 @@
 
 #include "src/core/model_repository_manager.h"
 
+#include <google/protobuf/text_format.h>
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <deque>
 #include <future>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <sstream>
 #include <stdexcept>
 #include <thread>
+#include "src/core/autofill.h"
 #include "src/core/backend.h"
 #include "src/core/constants.h"
+#include "src/core/cpu_isolation.h"
 #include "src/core/ensemble_utils.h"
 #include "src/core/filesystem.h"
 #include "src/core/logging.h"
 #include "src/core/model_config_utils.h"
+#include "src/core/repository_watcher.h"
 #include "src/core/server_status.h"
 
 #ifdef TRTIS_ENABLE_GPU
@@ -69,12 +83,113 @@ namespace nvidia { namespace inferenceserver {
 
 namespace {
 
+// The first line of the record of each model in the startup snapshot.
+const std::string kSnapshotModelPrefix = "# model: ";
+
+// Get the number of bytes of memory that are free and in use on each
+// GPU device in 'devices'. Devices that can't be queried are omitted.
+void
+GetGpuMemoryInfo(
+    const std::set<int>& devices, std::map<int, uint64_t>* free,
+    std::map<int, uint64_t>* used)
+{
+#ifdef TRTIS_ENABLE_GPU
+  int current_device;
+  if (devices.empty() || (cudaGetDevice(&current_device) != cudaSuccess)) {
+    return;
+  }
+
+  for (const int device : devices) {
+    size_t free_byte_size, total_byte_size;
+    if ((cudaSetDevice(device) == cudaSuccess) &&
+        (cudaMemGetInfo(&free_byte_size, &total_byte_size) == cudaSuccess)) {
+      if (free != nullptr) {
+        (*free)[device] = free_byte_size;
+      }
+      if (used != nullptr) {
+        (*used)[device] = total_byte_size - free_byte_size;
+      }
+    }
+  }
+
+  cudaSetDevice(current_device);
+#endif  // TRTIS_ENABLE_GPU
+}
+
+// Get the number of bytes of memory in use on each GPU device that is a
+// key of 'devices'.
+void
+GetGpuMemoryUsed(
+    const std::map<int, uint64_t>& devices, std::map<int, uint64_t>* used)
+{
+  std::set<int> device_set;
+  for (const auto& pr : devices) {
+    device_set.insert(pr.first);
+  }
+  GetGpuMemoryInfo(device_set, nullptr /* free */, used);
+}
+
+// Get the number of instances of a model on each GPU device.
+std::map<int, uint32_t>
+GpuInstanceCounts(const ModelConfig& model_config)
+{
+  std::map<int, uint32_t> counts;
+  for (const auto& group : model_config.instance_group()) {
+    if ((group.kind() == ModelInstanceGroup::KIND_GPU) ||
+        (group.kind() == ModelInstanceGroup::KIND_MULTI_GPU)) {
+      for (const int32_t gpu : group.gpus()) {
+        counts[gpu] += group.count();
+      }
+    }
+  }
+  return counts;
+}
+
+// Select the device for an instance with 'estimate' bytes of GPU
+// memory. 'placed' is the estimated memory and the number of instances
+// already placed on each device and 'capacity' is the total memory of
+// each device that could be queried.
+int
+SelectPlacementDevice(
+    const InstancePlacement placement, const uint64_t estimate,
+    const std::map<int, std::pair<uint64_t, uint32_t>>& placed,
+    const std::map<int, uint64_t>& capacity)
+{
+  // Pack onto the fullest device that still has room for the instance,
+  // and balance if no device has room so that admission reports the
+  // shortage of the least used device.
+  if (placement == PLACEMENT_PACK) {
+    auto selected = placed.end();
+    for (auto itr = placed.begin(); itr != placed.end(); ++itr) {
+      const auto citr = capacity.find(itr->first);
+      if ((citr != capacity.end()) &&
+          (itr->second.first + estimate > citr->second)) {
+        continue;
+      }
+      if ((selected == placed.end()) || (itr->second > selected->second)) {
+        selected = itr;
+      }
+    }
+    if (selected != placed.end()) {
+      return selected->first;
+    }
+  }
+
+  auto selected = placed.begin();
+  for (auto itr = placed.begin(); itr != placed.end(); ++itr) {
+    if (itr->second < selected->second) {
+      selected = itr;
+    }
+  }
+  return selected->first;
+}
+
 void
 BuildBackendConfigMap(
     const std::string& version, const bool strict_model_config,
     const float tf_gpu_memory_fraction, const bool tf_allow_soft_placement,
     const std::map<int, std::pair<int, uint64_t>> tf_vgpu_memory_limit_mb,
-    BackendConfigMap* backend_configs)
+    const std::string& trt_engine_cache_dir, BackendConfigMap* backend_configs)
 {
 #ifdef TRTIS_ENABLE_TENSORFLOW
   //// Tensorflow GraphDef and SavedModel
@@ -117,6 +232,7 @@ BuildBackendConfigMap(
 #endif  // TRTIS_ENABLE_GPU
 
     graphdef_config->allow_soft_placement = tf_allow_soft_placement;
+    graphdef_config->engine_cache_dir = trt_engine_cache_dir;
 
     (*backend_configs)[kTensorFlowGraphDefPlatform] = graphdef_config;
     (*backend_configs)[kTensorFlowSavedModelPlatform] = graphdef_config;
@@ -137,6 +253,7 @@ BuildBackendConfigMap(
   {
     auto plan_config = std::make_shared<PlanBackendFactory::Config>();
     plan_config->autofill = !strict_model_config;
+    plan_config->engine_cache_dir = trt_engine_cache_dir;
     (*backend_configs)[kTensorRTPlanPlatform] = plan_config;
   }
 #endif  // TRTIS_ENABLE_TENSORRT
@@ -146,6 +263,7 @@ BuildBackendConfigMap(
   {
     auto onnx_config = std::make_shared<OnnxBackendFactory::Config>();
     onnx_config->autofill = !strict_model_config;
+    onnx_config->engine_cache_dir = trt_engine_cache_dir;
     (*backend_configs)[kOnnxRuntimeOnnxPlatform] = onnx_config;
   }
 #endif  // TRTIS_ENABLE_ONNXRUNTIME
@@ -232,6 +350,112 @@ IsModified(const std::string& path, int64_t* last_ns)
   return modified;
 }
 
+// Run model loads on a fixed number of threads. Each load names the
+// resources it uses, the GPUs of its instances and the storage the
+// model is read from, and no more than the limit of a resource (0 for
+// no limit) of loads that use the resource run at the same time. The
+// loads run in the order they are queued, except that a load waiting
+// for a busy resource doesn't hold back the loads queued behind it.
+class ModelLoadPool {
+ public:
+  using Resources = std::map<std::string, uint32_t>;
+
+  explicit ModelLoadPool(const uint32_t thread_count) : exiting_(false)
+  {
+    for (uint32_t i = 0; i < std::max(thread_count, 1u); ++i) {
+      threads_.emplace_back(&ModelLoadPool::LoadThread, this);
+    }
+  }
+
+  ~ModelLoadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      exiting_ = true;
+    }
+    cv_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  void Enqueue(Resources&& resources, std::function<void()>&& load)
+  {
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      queue_.emplace_back(std::move(resources), std::move(load));
+    }
+    cv_.notify_one();
+  }
+
+ private:
+  using Load = std::pair<Resources, std::function<void()>>;
+
+  // Return the first queued load whose resources are not all in use,
+  // or queue_.end() if there is none. Must be called with 'mu_' held.
+  std::deque<Load>::iterator NextLoad()
+  {
+    return std::find_if(
+        queue_.begin(), queue_.end(), [this](const Load& load) {
+          for (const auto& resource : load.first) {
+            if ((resource.second != 0) &&
+                (in_use_[resource.first] >= resource.second)) {
+              return false;
+            }
+          }
+          return true;
+        });
+  }
+
+  void LoadThread()
+  {
+    SetThreadClass(ThreadClass::BACKGROUND);
+
+    std::unique_lock<std::mutex> lk(mu_);
+    while (true) {
+      std::deque<Load>::iterator next;
+      cv_.wait(lk, [this, &next] {
+        next = NextLoad();
+        return exiting_ || (next != queue_.end());
+      });
+      if (exiting_) {
+        break;
+      }
+
+      Load load = std::move(*next);
+      queue_.erase(next);
+      for (const auto& resource : load.first) {
+        in_use_[resource.first]++;
+      }
+
+      // The framework thread pools are created while the model is
+      // loaded and inherit the CPUs of this thread, so load on the
+      // backend CPUs.
+      lk.unlock();
+      {
+        ScopedThreadClass backend_cpus(ThreadClass::BACKEND);
+        load.second();
+      }
+      lk.lock();
+
+      for (const auto& resource : load.first) {
+        in_use_[resource.first]--;
+      }
+
+      // A finished load may free a resource that any of the queued
+      // loads is waiting for.
+      cv_.notify_all();
+    }
+  }
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool exiting_;
+  std::deque<Load> queue_;
+  std::map<std::string, uint32_t> in_use_;
+  std::vector<std::thread> threads_;
+};
+
 // Use smart pointer with custom deleter so that model state will be updated
 // to UNAVAILABLE if all smart pointer copies are out of scope
 struct BackendDeleter {
@@ -242,8 +466,17 @@ struct BackendDeleter {
 
   void operator()(InferenceBackend* backend)
   {
-    delete backend;
-    OnDestroyBackend_();
+    // The last copy may be released by one of the backend's own
+    // threads, for example a scheduler thread completing a request
+    // after the model was unloaded, and destroying the backend joins
+    // those threads. So destroy the backend on a separate thread.
+    std::function<void()> OnDestroyBackend = OnDestroyBackend_;
+    std::thread destroyer([backend, OnDestroyBackend]() {
+      SetThreadClass(ThreadClass::BACKGROUND);
+      delete backend;
+      OnDestroyBackend();
+    });
+    destroyer.detach();
   }
 
   // Use to inform the BackendLifeCycle that the backend handle is destroyed
@@ -257,15 +490,25 @@ struct ModelRepositoryManager::ModelInfo {
   // so that we have more information on whether the model reload
   // is necessary
   int64_t mtime_nsec_;
+  // For a repository on Google Cloud Storage or Amazon S3, a hash of
+  // the versions of all the files of the model.
+  size_t fingerprint_;
   ModelConfig model_config_;
   Platform platform_;
   std::string model_repository_path_;
+  // True if the info was read from the startup snapshot and the model
+  // has not been polled since, so it must be checked for changes even
+  // if its repository is watched.
+  bool unverified_;
 };
 
 class ModelRepositoryManager::BackendLifeCycle {
  public:
   static Status Create(
       InferenceServer* server, const BackendConfigMap& backend_map,
+      const uint32_t load_thread_count, const uint32_t load_gpu_limit,
+      const uint32_t load_storage_limit,
+      const std::string& memory_estimate_dir,
       std::unique_ptr<BackendLifeCycle>* life_cycle);
 
   ~BackendLifeCycle() = default;
@@ -287,6 +530,13 @@ class ModelRepositoryManager::BackendLifeCycle {
       const std::string& model_name, const int64_t version,
       std::shared_ptr<InferenceBackend>* backend);
 
+  // Replace 'backend', the latest of the 'ready' versions of a model,
+  // with the version chosen by the version routing of the model, if
+  // any.
+  void RouteLatestVersion(
+      const std::vector<std::shared_ptr<InferenceBackend>>& ready,
+      std::shared_ptr<InferenceBackend>* backend);
+
   // Get the ModelStateMap representation of the live backends. A backend is
   // live if at least one of the versions is not unknown nor unavailable.
   const ModelStateMap GetLiveBackendStates();
@@ -294,6 +544,15 @@ class ModelRepositoryManager::BackendLifeCycle {
   // Get the VersionStateMap representation of the specified model.
   const VersionStateMap GetVersionStates(const std::string& model_name);
 
+  // Return the estimated GPU memory, in bytes, of an instance of a model
+  // version, or 0 if there is no estimate. The estimate is the memory
+  // accounted by the backend when the version was last loaded, recorded
+  // in the memory estimate directory, or else for a TensorRT plan the
+  // size of the plan.
+  uint64_t InstanceMemoryEstimate(
+      const std::string& model_name, const int64_t version,
+      const std::string& version_path, const Platform platform);
+
  private:
   struct BackendInfo {
     BackendInfo(
@@ -343,11 +602,36 @@ class ModelRepositoryManager::BackendLifeCycle {
       const std::string& model_name, const int64_t version,
       BackendInfo* backend_info);
 
+  // Return the resources used while loading the backend, see
+  // ModelLoadPool.
+  ModelLoadPool::Resources LoadResources(const BackendInfo& backend_info);
+
+  // Record the GPU memory accounted by 'backend' as the estimate for
+  // the instances of a model version.
+  void RecordInstanceMemoryEstimate(
+      const std::string& model_name, const int64_t version,
+      const ModelConfig& model_config, InferenceBackend* backend);
+
+  // Admit the load of a model version if every GPU it has instances on
+  // has enough free memory for the estimated memory of the instances,
+  // in addition to the memory reserved by the other loads in progress.
+  // Return in 'reservation' the memory reserved for the load, which
+  // must be released with ReleaseLoad() once the load completes.
+  Status AdmitLoad(
+      const std::string& model_name, const int64_t version,
+      const std::string& version_path, const Platform platform,
+      const ModelConfig& model_config, std::map<int, uint64_t>* reservation);
+  void ReleaseLoad(const std::map<int, uint64_t>& reservation);
+
   using VersionMap = std::map<int64_t, std::unique_ptr<BackendInfo>>;
   using BackendMap = std::map<std::string, VersionMap>;
   BackendMap map_;
   std::mutex map_mtx_;
 
+  // The number of AsyncLoad() calls for each model, a deferred unload
+  // is dropped if the model was loaded again since it was deferred.
+  std::unordered_map<std::string, uint64_t> load_generations_;
+
 #ifdef TRTIS_ENABLE_CAFFE2
   std::unique_ptr<NetDefBackendFactory> netdef_factory_;
 #endif  // TRTIS_ENABLE_CAFFE2
@@ -368,14 +652,37 @@ class ModelRepositoryManager::BackendLifeCycle {
   std::unique_ptr<LibTorchBackendFactory> libtorch_factory_;
 #endif  // TRTIS_ENABLE_PYTORCH
   std::unique_ptr<EnsembleBackendFactory> ensemble_factory_;
+
+  uint32_t load_gpu_limit_;
+  uint32_t load_storage_limit_;
+
+  // The directory where the estimated GPU memory of the instances of
+  // each model version is recorded, or empty to only keep them in
+  // 'instance_memory_estimates_'.
+  std::string memory_estimate_dir_;
+
+  std::mutex admission_mtx_;
+  std::unordered_map<std::string, uint64_t> instance_memory_estimates_;
+  // The GPU memory reserved by the loads in progress on each device.
+  std::map<int, uint64_t> reserved_gpu_memory_;
+
+  // Declared last so that the loads in progress finish before the
+  // rest of the life cycle is destroyed.
+  std::unique_ptr<ModelLoadPool> load_pool_;
 };
 
 Status
 ModelRepositoryManager::BackendLifeCycle::Create(
     InferenceServer* server, const BackendConfigMap& backend_map,
+    const uint32_t load_thread_count, const uint32_t load_gpu_limit,
+    const uint32_t load_storage_limit, const std::string& memory_estimate_dir,
     std::unique_ptr<BackendLifeCycle>* life_cycle)
 {
   std::unique_ptr<BackendLifeCycle> local_life_cycle(new BackendLifeCycle());
+  local_life_cycle->load_gpu_limit_ = load_gpu_limit;
+  local_life_cycle->load_storage_limit_ = load_storage_limit;
+  local_life_cycle->memory_estimate_dir_ = memory_estimate_dir;
+  local_life_cycle->load_pool_.reset(new ModelLoadPool(load_thread_count));
 
 #ifdef TRTIS_ENABLE_TENSORFLOW
   {
@@ -507,6 +814,7 @@ ModelRepositoryManager::BackendLifeCycle::GetInferenceBackend(
   if (vit == mit->second.end()) {
     // In case the request is asking for latest version
     int64_t latest = -1;
+    std::vector<std::shared_ptr<InferenceBackend>> ready;
     if (version == -1) {
       for (auto& version_backend : mit->second) {
         if (version_backend.first > latest) {
@@ -519,10 +827,14 @@ ModelRepositoryManager::BackendLifeCycle::GetInferenceBackend(
             // "versions : 1 3 2", version 3 is latest but is requested
             // to be unloaded when the iterator is examining version 2.
             *backend = version_backend.second->backend_;
+            ready.push_back(*backend);
           }
         }
       }
     }
+    if (ready.size() > 1) {
+      RouteLatestVersion(ready, backend);
+    }
     if (latest == -1) {
       return Status(
           RequestStatusCode::NOT_FOUND, "model '" + model_name + "' version " +
@@ -543,6 +855,58 @@ ModelRepositoryManager::BackendLifeCycle::GetInferenceBackend(
   return Status::Success;
 }
 
+void
+ModelRepositoryManager::BackendLifeCycle::RouteLatestVersion(
+    const std::vector<std::shared_ptr<InferenceBackend>>& ready,
+    std::shared_ptr<InferenceBackend>* backend)
+{
+  // The routing of the latest ready version applies, 'backend' is
+  // that version on entry.
+  const ModelVersionRouting& routing = (*backend)->Config().version_routing();
+  if (routing.weights().empty()) {
+    return;
+  }
+
+  std::vector<double> weights;
+  weights.reserve(ready.size());
+  double total_weight = 0;
+  for (const auto& candidate : ready) {
+    const auto itr = routing.weights().find(candidate->Version());
+    double weight = (itr == routing.weights().end()) ? 0 : itr->second;
+
+    // Favor the version whose pending batch is closest to complete,
+    // so that the versions don't each form partial batches.
+    if (routing.queue_aware() && (weight > 0)) {
+      uint64_t queued = 0, batch_size = 0;
+      Scheduler* scheduler = candidate->BackendScheduler();
+      if (scheduler != nullptr) {
+        scheduler->GetQueueDepth(&queued, &batch_size);
+      }
+      if (batch_size > 1) {
+        weight *= 1.0 + (double)(queued % batch_size) / batch_size;
+      }
+    }
+
+    weights.push_back(weight);
+    total_weight += weight;
+  }
+
+  if (total_weight <= 0) {
+    return;
+  }
+
+  static thread_local std::minstd_rand generator(std::random_device{}());
+  std::uniform_real_distribution<double> distribution(0, total_weight);
+  double pick = distribution(generator);
+  for (size_t i = 0; i < ready.size(); ++i) {
+    if ((weights[i] > 0) && ((pick < weights[i]) || (i + 1 == ready.size()))) {
+      *backend = ready[i];
+      return;
+    }
+    pick -= weights[i];
+  }
+}
+
 Status
 ModelRepositoryManager::BackendLifeCycle::AsyncLoad(
     const std::string& repository_path, const std::string& model_name,
@@ -567,17 +931,76 @@ ModelRepositoryManager::BackendLifeCycle::AsyncLoad(
     }
   }
 
+  // Switch the served versions without downtime. If a version to be
+  // served must be loaded, the ready versions to be unloaded keep
+  // serving until the loads complete. "Latest" routes to a new version
+  // as soon as it is loaded and warmed up, and an unloaded version is
+  // only destroyed once the requests holding it have completed.
+  const uint64_t generation = ++load_generations_[model_name];
+  std::vector<std::pair<int64_t, BackendInfo*>> deferred_unloads;
+  if (force_unload) {
+    bool needs_load = false;
+    for (auto& version_backend : it->second) {
+      std::lock_guard<std::recursive_mutex> lock(version_backend.second->mtx_);
+      const bool ready =
+          (version_backend.second->state_ == ModelReadyState::MODEL_READY);
+      if (versions.find(version_backend.first) != versions.end()) {
+        needs_load |= !ready;
+      } else if (ready) {
+        deferred_unloads.emplace_back(
+            version_backend.first, version_backend.second.get());
+      }
+    }
+    if (!needs_load) {
+      deferred_unloads.clear();
+    }
+  }
+
+  // The deferred unloads run once the count of pending loads drops to
+  // zero. The count starts at one so that it can't drop to zero before
+  // all the loads are counted.
+  auto pending_loads = std::make_shared<std::atomic<size_t>>(1);
+  std::function<void()> UnloadDeferred = [this, model_name, generation,
+                                          deferred_unloads]() {
+    // Run from a load thread, the last load completes while holding
+    // the mutex of its version.
+    load_pool_->Enqueue(
+        ModelLoadPool::Resources(),
+        [this, model_name, generation, deferred_unloads]() {
+          std::lock_guard<std::mutex> map_lock(map_mtx_);
+          // A later load of the model has decided the versions to
+          // serve since.
+          if (load_generations_[model_name] != generation) {
+            return;
+          }
+          for (const auto& deferred : deferred_unloads) {
+            std::lock_guard<std::recursive_mutex> lock(deferred.second->mtx_);
+            deferred.second->next_action_ = ActionType::UNLOAD;
+            TriggerNextAction(model_name, deferred.first, deferred.second);
+          }
+        });
+  };
+
   Status status = Status::Success;
   size_t affected_version_cnt =
       force_unload ? it->second.size() : versions.size();
   for (auto& version_backend : it->second) {
     std::lock_guard<std::recursive_mutex> lock(version_backend.second->mtx_);
+    bool deferred = false;
     if (versions.find(version_backend.first) != versions.end()) {
       version_backend.second->repository_path_ = repository_path;
       version_backend.second->model_config_ = model_config;
       version_backend.second->next_action_ = ActionType::LOAD;
     } else if (force_unload) {
-      version_backend.second->next_action_ = ActionType::UNLOAD;
+      deferred = std::find_if(
+                     deferred_unloads.begin(), deferred_unloads.end(),
+                     [&version_backend](
+                         const std::pair<int64_t, BackendInfo*>& unload) {
+                       return unload.first == version_backend.first;
+                     }) != deferred_unloads.end();
+      if (!deferred) {
+        version_backend.second->next_action_ = ActionType::UNLOAD;
+      }
     }
 
     auto version = version_backend.first;
@@ -589,6 +1012,26 @@ ModelRepositoryManager::BackendLifeCycle::AsyncLoad(
             OnComplete(version, backend_info->state_, affected_version_cnt);
           };
     }
+    if (!deferred_unloads.empty() &&
+        (backend_info->next_action_ == ActionType::LOAD) &&
+        (backend_info->state_ != ModelReadyState::MODEL_READY)) {
+      pending_loads->fetch_add(1);
+      auto VersionComplete = std::move(backend_info->OnComplete_);
+      backend_info->OnComplete_ = [VersionComplete, pending_loads,
+                                   UnloadDeferred]() {
+        if (VersionComplete != nullptr) {
+          VersionComplete();
+        }
+        if (pending_loads->fetch_sub(1) == 1) {
+          UnloadDeferred();
+        }
+      };
+    }
+    if (deferred) {
+      LOG_INFO << "serving " << model_name << ":" << version
+               << " until the new versions are loaded";
+      continue;
+    }
     Status action_status = TriggerNextAction(model_name, version, backend_info);
     // Only care about status on unloading case
     if (!action_status.IsOk() && versions.empty()) {
@@ -596,6 +1039,10 @@ ModelRepositoryManager::BackendLifeCycle::AsyncLoad(
     }
   }
 
+  if (!deferred_unloads.empty() && (pending_loads->fetch_sub(1) == 1)) {
+    UnloadDeferred();
+  }
+
   return status;
 }
 
@@ -662,18 +1109,197 @@ ModelRepositoryManager::BackendLifeCycle::Load(
     default:
       LOG_INFO << "loading: " << model_name << ":" << version;
       backend_info->state_ = ModelReadyState::MODEL_LOADING;
-      {
-        std::thread worker(
-            &ModelRepositoryManager::BackendLifeCycle::CreateInferenceBackend,
-            this, model_name, version, backend_info);
-        worker.detach();
-      }
+      load_pool_->Enqueue(
+          LoadResources(*backend_info),
+          [this, model_name, version, backend_info]() {
+            CreateInferenceBackend(model_name, version, backend_info);
+          });
       break;
   }
 
   return status;
 }
 
+ModelLoadPool::Resources
+ModelRepositoryManager::BackendLifeCycle::LoadResources(
+    const BackendInfo& backend_info)
+{
+  ModelLoadPool::Resources resources;
+
+  // The storage is named by the scheme of the repository path, all
+  // the repositories on the local file system are the same storage.
+  const std::string& path = backend_info.repository_path_;
+  std::string storage("local");
+  const size_t scheme_end = path.find("://");
+  if (scheme_end != std::string::npos) {
+    storage = path.substr(0, scheme_end);
+  }
+  resources.emplace("storage:" + storage, load_storage_limit_);
+
+  for (const auto& group : backend_info.model_config_.instance_group()) {
+    if ((group.kind() == ModelInstanceGroup::KIND_GPU) ||
+        (group.kind() == ModelInstanceGroup::KIND_MULTI_GPU)) {
+      for (const int32_t gpu : group.gpus()) {
+        resources.emplace("gpu:" + std::to_string(gpu), load_gpu_limit_);
+      }
+    }
+  }
+
+  return resources;
+}
+
+uint64_t
+ModelRepositoryManager::BackendLifeCycle::InstanceMemoryEstimate(
+    const std::string& model_name, const int64_t version,
+    const std::string& version_path, const Platform platform)
+{
+  const std::string key = model_name + "_" + std::to_string(version);
+  {
+    std::lock_guard<std::mutex> lock(admission_mtx_);
+    const auto itr = instance_memory_estimates_.find(key);
+    if (itr != instance_memory_estimates_.end()) {
+      return itr->second;
+    }
+  }
+
+  uint64_t estimate = 0;
+  std::string contents;
+  if (!memory_estimate_dir_.empty() &&
+      ReadTextFile(JoinPath({memory_estimate_dir_, key + ".memory"}), &contents)
+          .IsOk()) {
+    try {
+      estimate = std::stoull(contents);
+    }
+    catch (const std::exception& ex) {
+      LOG_WARNING << "ignoring invalid GPU memory estimate for '" << model_name
+                  << "' version " << version << ": " << ex.what();
+    }
+  }
+#ifdef TRTIS_ENABLE_TENSORRT
+  if ((estimate == 0) && (platform == Platform::PLATFORM_TENSORRT_PLAN)) {
+    // Without a recorded estimate the engine is the best guess, the
+    // plan is read once more but only for the first load.
+    std::set<std::string> plan_files;
+    if (GetDirectoryFiles(version_path, &plan_files).IsOk()) {
+      for (const auto& filename : plan_files) {
+        if (ReadTextFile(JoinPath({version_path, filename}), &contents)
+                .IsOk()) {
+          estimate = std::max(estimate, (uint64_t)contents.size());
+        }
+      }
+    }
+  }
+#endif  // TRTIS_ENABLE_TENSORRT
+
+  std::lock_guard<std::mutex> lock(admission_mtx_);
+  instance_memory_estimates_.emplace(key, estimate);
+  return estimate;
+}
+
+void
+ModelRepositoryManager::BackendLifeCycle::RecordInstanceMemoryEstimate(
+    const std::string& model_name, const int64_t version,
+    const ModelConfig& model_config, InferenceBackend* backend)
+{
+  const auto usages = backend->MemoryUsage();
+  if (usages.empty()) {
+    return;
+  }
+
+  const auto instance_counts = GpuInstanceCounts(model_config);
+  uint64_t estimate = 0;
+  for (const auto& pr : usages) {
+    const auto itr = instance_counts.find(pr.first);
+    const uint64_t byte_size = pr.second.model_byte_size() +
+                               pr.second.workspace_byte_size() +
+                               pr.second.io_byte_size();
+    const uint32_t count =
+        (itr == instance_counts.end()) ? 1 : std::max(itr->second, 1u);
+    estimate = std::max(estimate, (byte_size + count - 1) / count);
+  }
+
+  const std::string key = model_name + "_" + std::to_string(version);
+  {
+    std::lock_guard<std::mutex> lock(admission_mtx_);
+    uint64_t& recorded = instance_memory_estimates_[key];
+    if (recorded == estimate) {
+      return;
+    }
+    recorded = estimate;
+  }
+
+  if (!memory_estimate_dir_.empty()) {
+    Status status = WriteTextFile(
+        JoinPath({memory_estimate_dir_, key + ".memory"}),
+        std::to_string(estimate));
+    if (!status.IsOk()) {
+      LOG_WARNING << "failed to record GPU memory estimate for '"
+                  << model_name << "' version " << version << ": "
+                  << status.Message();
+    }
+  }
+}
+
+Status
+ModelRepositoryManager::BackendLifeCycle::AdmitLoad(
+    const std::string& model_name, const int64_t version,
+    const std::string& version_path, const Platform platform,
+    const ModelConfig& model_config, std::map<int, uint64_t>* reservation)
+{
+  const auto instance_counts = GpuInstanceCounts(model_config);
+  if (instance_counts.empty()) {
+    return Status::Success;
+  }
+
+  const uint64_t estimate =
+      InstanceMemoryEstimate(model_name, version, version_path, platform);
+  if (estimate == 0) {
+    return Status::Success;
+  }
+
+  std::set<int> devices;
+  for (const auto& pr : instance_counts) {
+    devices.insert(pr.first);
+  }
+
+  std::lock_guard<std::mutex> lock(admission_mtx_);
+  std::map<int, uint64_t> free;
+  GetGpuMemoryInfo(devices, &free, nullptr /* used */);
+  for (const auto& pr : free) {
+    const uint64_t needed = estimate * instance_counts.at(pr.first);
+    const uint64_t reserved = reserved_gpu_memory_[pr.first];
+    const uint64_t available =
+        (pr.second > reserved) ? (pr.second - reserved) : 0;
+    if (needed > available) {
+      return Status(
+          RequestStatusCode::UNAVAILABLE,
+          "not enough GPU memory to load '" + model_name + "' version " +
+              std::to_string(version) + ": its instances on GPU " +
+              std::to_string(pr.first) + " need an estimated " +
+              std::to_string(needed) + " bytes but only " +
+              std::to_string(available) + " bytes are available");
+    }
+  }
+
+  for (const auto& pr : free) {
+    const uint64_t needed = estimate * instance_counts.at(pr.first);
+    reserved_gpu_memory_[pr.first] += needed;
+    (*reservation)[pr.first] = needed;
+  }
+
+  return Status::Success;
+}
+
+void
+ModelRepositoryManager::BackendLifeCycle::ReleaseLoad(
+    const std::map<int, uint64_t>& reservation)
+{
+  std::lock_guard<std::mutex> lock(admission_mtx_);
+  for (const auto& pr : reservation) {
+    reserved_gpu_memory_[pr.first] -= pr.second;
+  }
+}
+
 Status
 ModelRepositoryManager::BackendLifeCycle::Unload(
     const std::string& model_name, const int64_t version,
@@ -723,54 +1349,71 @@ ModelRepositoryManager::BackendLifeCycle::CreateInferenceBackend(
     model_config = backend_info->model_config_;
   }
 
-  // Create backend
-  Status status;
+  // Create backend, if the GPUs have enough free memory for it
+  std::map<int, uint64_t> reservation;
+  Status status = AdmitLoad(
+      model_name, version, version_path, backend_info->platform_, model_config,
+      &reservation);
   std::unique_ptr<InferenceBackend> is;
-  switch (backend_info->platform_) {
+  if (status.IsOk()) {
+    switch (backend_info->platform_) {
 #ifdef TRTIS_ENABLE_TENSORFLOW
-    case Platform::PLATFORM_TENSORFLOW_GRAPHDEF:
-      status =
-          graphdef_factory_->CreateBackend(version_path, model_config, &is);
-      break;
-    case Platform::PLATFORM_TENSORFLOW_SAVEDMODEL:
-      status =
-          savedmodel_factory_->CreateBackend(version_path, model_config, &is);
-      break;
+      case Platform::PLATFORM_TENSORFLOW_GRAPHDEF:
+        status =
+            graphdef_factory_->CreateBackend(version_path, model_config, &is);
+        break;
+      case Platform::PLATFORM_TENSORFLOW_SAVEDMODEL:
+        status = savedmodel_factory_->CreateBackend(
+            version_path, model_config, &is);
+        break;
 #endif  // TRTIS_ENABLE_TENSORFLOW
 #ifdef TRTIS_ENABLE_TENSORRT
-    case Platform::PLATFORM_TENSORRT_PLAN:
-      status = plan_factory_->CreateBackend(version_path, model_config, &is);
-      break;
+      case Platform::PLATFORM_TENSORRT_PLAN:
+        status = plan_factory_->CreateBackend(version_path, model_config, &is);
+        break;
 #endif  // TRTIS_ENABLE_TENSORRT
 #ifdef TRTIS_ENABLE_CAFFE2
-    case Platform::PLATFORM_CAFFE2_NETDEF:
-      status = netdef_factory_->CreateBackend(version_path, model_config, &is);
-      break;
+      case Platform::PLATFORM_CAFFE2_NETDEF:
+        status =
+            netdef_factory_->CreateBackend(version_path, model_config, &is);
+        break;
 #endif  // TRTIS_ENABLE_CAFFE2
 #ifdef TRTIS_ENABLE_ONNXRUNTIME
-    case Platform::PLATFORM_ONNXRUNTIME_ONNX:
-      status = onnx_factory_->CreateBackend(version_path, model_config, &is);
-      break;
+      case Platform::PLATFORM_ONNXRUNTIME_ONNX:
+        status = onnx_factory_->CreateBackend(version_path, model_config, &is);
+        break;
 #endif  // TRTIS_ENABLE_ONNXRUNTIME
 #ifdef TRTIS_ENABLE_PYTORCH
-    case Platform::PLATFORM_PYTORCH_LIBTORCH:
-      status =
-          libtorch_factory_->CreateBackend(version_path, model_config, &is);
-      break;
+      case Platform::PLATFORM_PYTORCH_LIBTORCH:
+        status =
+            libtorch_factory_->CreateBackend(version_path, model_config, &is);
+        break;
 #endif  // TRTIS_ENABLE_PYTORCH
 #ifdef TRTIS_ENABLE_CUSTOM
-    case Platform::PLATFORM_CUSTOM:
-      status = custom_factory_->CreateBackend(
-          backend_info->repository_path_, model_name, version, model_config,
-          &is);
-      break;
+      case Platform::PLATFORM_CUSTOM:
+        status = custom_factory_->CreateBackend(
+            backend_info->repository_path_, model_name, version, model_config,
+            &is);
+        break;
 #endif  // TRTIS_ENABLE_CUSTOM
-    case Platform::PLATFORM_ENSEMBLE:
-      status =
-          ensemble_factory_->CreateBackend(version_path, model_config, &is);
-      break;
-    default:
-      break;
+      case Platform::PLATFORM_ENSEMBLE:
+        status =
+            ensemble_factory_->CreateBackend(version_path, model_config, &is);
+        break;
+      default:
+        break;
+    }
+  }
+
+  // Run the warmup requests before the model is marked ready so that
+  // the first inference requests don't pay for lazy initialization.
+  if (status.IsOk()) {
+    status = is->WarmUp();
+  }
+
+  ReleaseLoad(reservation);
+  if (status.IsOk()) {
+    RecordInstanceMemoryEstimate(model_name, version, model_config, is.get());
   }
 
   // Update backend state
@@ -821,15 +1464,36 @@ ModelRepositoryManager::ModelRepositoryManager(
     const std::shared_ptr<ServerStatusManager>& status_manager,
     const std::set<std::string>& repository_paths,
     const BackendConfigMap& backend_config_map, const bool autofill,
-    const bool polling_enabled, const bool model_control_enabled,
+    const std::string& model_config_cache_dir,
+    const std::string& startup_snapshot, const bool polling_enabled,
+    const bool model_control_enabled, const bool load_on_demand,
+    const std::map<int, uint64_t>& gpu_memory_budget,
+    const InstancePlacement instance_placement,
     std::unique_ptr<BackendLifeCycle> life_cycle)
     : repository_paths_(repository_paths),
       backend_config_map_(backend_config_map), autofill_(autofill),
-      polling_enabled_(polling_enabled),
+      autofill_cache_(
+          autofill ? new AutoFillCache(model_config_cache_dir) : nullptr),
+      startup_snapshot_(startup_snapshot), polling_enabled_(polling_enabled),
       model_control_enabled_(model_control_enabled),
+      load_on_demand_(load_on_demand), gpu_memory_budget_(gpu_memory_budget),
+      instance_placement_(instance_placement), use_counter_(0),
       status_manager_(status_manager),
       backend_life_cycle_(std::move(life_cycle))
 {
+  if (polling_enabled_) {
+    for (const auto& repository_path : repository_paths_) {
+      std::unique_ptr<RepositoryWatcher> watcher;
+      Status status = RepositoryWatcher::Create(repository_path, &watcher);
+      if (status.IsOk()) {
+        watchers_.emplace(repository_path, std::move(watcher));
+      } else if (repository_path.find("://") == std::string::npos) {
+        LOG_INFO << "polling model repository '" << repository_path
+                 << "' by walking all model directories: "
+                 << status.Message();
+      }
+    }
+  }
 }
 
 ModelRepositoryManager::~ModelRepositoryManager() {}
@@ -842,7 +1506,14 @@ ModelRepositoryManager::Create(
     const std::set<std::string>& startup_models, const bool strict_model_config,
     const float tf_gpu_memory_fraction, const bool tf_allow_soft_placement,
     const std::map<int, std::pair<int, uint64_t>> tf_memory_limit_mb,
-    const bool polling_enabled, const bool model_control_enabled,
+    const std::string& trt_engine_cache_dir, const bool polling_enabled,
+    const bool model_control_enabled, const bool load_on_demand,
+    const std::map<int, uint64_t>& gpu_memory_budget,
+    const uint32_t load_thread_count, const uint32_t load_gpu_limit,
+    const uint32_t load_storage_limit, const std::string& memory_estimate_dir,
+    const std::string& model_config_cache_dir,
+    const std::string& model_startup_snapshot,
+    const InstancePlacement instance_placement,
     std::unique_ptr<ModelRepositoryManager>* model_repository_manager)
 {
   // The rest only matters if repository path is valid directory
@@ -862,25 +1533,50 @@ ModelRepositoryManager::Create(
         "cannot enable both polling and explicit model control");
   }
 
+  if (load_on_demand && !model_control_enabled) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "loading models on demand requires explicit model control");
+  }
+
+#ifndef TRTIS_ENABLE_GPU
+  if (!gpu_memory_budget.empty()) {
+    LOG_WARNING << "GPU memory budget is ignored without GPU support";
+  }
+#endif  // TRTIS_ENABLE_GPU
+
   BackendConfigMap backend_config_map;
 
   BuildBackendConfigMap(
       server_version, strict_model_config, tf_gpu_memory_fraction,
-      tf_allow_soft_placement, tf_memory_limit_mb, &backend_config_map);
+      tf_allow_soft_placement, tf_memory_limit_mb, trt_engine_cache_dir,
+      &backend_config_map);
 
   std::unique_ptr<BackendLifeCycle> life_cycle;
-  RETURN_IF_ERROR(
-      BackendLifeCycle::Create(server, backend_config_map, &life_cycle));
+  RETURN_IF_ERROR(BackendLifeCycle::Create(
+      server, backend_config_map, load_thread_count, load_gpu_limit,
+      load_storage_limit, memory_estimate_dir, &life_cycle));
 
   // Not setting the smart pointer directly to simplify clean up
   std::unique_ptr<ModelRepositoryManager> local_manager(
       new ModelRepositoryManager(
           status_manager, repository_paths, backend_config_map,
-          !strict_model_config, polling_enabled, model_control_enabled,
+          !strict_model_config, model_config_cache_dir,
+          model_startup_snapshot, polling_enabled, model_control_enabled,
+          load_on_demand, gpu_memory_budget, instance_placement,
           std::move(life_cycle)));
 
   bool all_models_polled = true;
   if (!model_control_enabled) {
+    // Start loading the models known from the last run while the
+    // repositories are polled. A snapshot that can't be read only
+    // means that the models are loaded after the poll.
+    Status status = local_manager->LoadStartupSnapshot();
+    if (!status.IsOk()) {
+      LOG_WARNING << "failed to load startup snapshot '"
+                  << model_startup_snapshot << "': " << status.AsString();
+    }
+
     // only error happens before model load / unload will be return
     // model loading / unloading error will be printed but ignored
     RETURN_IF_ERROR(local_manager->PollAndUpdateInternal(&all_models_polled));
@@ -955,16 +1651,19 @@ ModelRepositoryManager::PollAndUpdateInternal(bool* all_models_polled)
     }
   }
 
+  // Swap even if nothing changed, the unmodified models may have been
+  // verified against the startup snapshot.
+  infos_.swap(new_infos);
+
   // Nothing to do if no model adds, deletes or modifies.
   if (added.empty() && deleted.empty() && modified.empty()) {
     return Status::Success;
   }
 
-  infos_.swap(new_infos);
-
   Update(added, deleted, modified);
 
   for (const auto& name : deleted) {
+    placements_.erase(name);
     ModelConfig model_config;
     std::set<int64_t> versions;
     std::string empty_path;
@@ -972,12 +1671,180 @@ ModelRepositoryManager::PollAndUpdateInternal(bool* all_models_polled)
     backend_life_cycle_->AsyncLoad(empty_path, name, versions, model_config);
   }
 
+  RecordStartupSnapshot();
+
+  // model loading / unloading error will be printed but ignored
+  LoadModelByDependency();
+
+  return Status::Success;
+}
+
+Status
+ModelRepositoryManager::LoadStartupSnapshot()
+{
+  if (startup_snapshot_.empty()) {
+    return Status::Success;
+  }
+
+  std::lock_guard<std::mutex> lock(poll_mu_);
+
+  bool exists = false;
+  RETURN_IF_ERROR(FileExists(startup_snapshot_, &exists));
+  if (!exists) {
+    return Status::Success;
+  }
+
+  std::string contents;
+  RETURN_IF_ERROR(ReadTextFile(startup_snapshot_, &contents));
+
+  // Split the snapshot into one record for each model, a record being
+  // the "# <key>: <value>" header lines followed by the configuration.
+  std::vector<std::pair<std::map<std::string, std::string>, std::string>>
+      records;
+  std::istringstream in(contents);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.compare(0, kSnapshotModelPrefix.size(), kSnapshotModelPrefix) ==
+        0) {
+      records.emplace_back();
+    }
+    if (records.empty()) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "unexpected line before the first model: " + line);
+    }
+    const size_t sep = line.find(": ");
+    if ((line.compare(0, 2, "# ") == 0) && (sep != std::string::npos)) {
+      records.back().first[line.substr(2, sep - 2)] = line.substr(sep + 2);
+    } else {
+      records.back().second.append(line).append(1, '\n');
+    }
+  }
+
+  std::set<std::string> added;
+  for (auto& record : records) {
+    auto& header = record.first;
+    const std::string& name = header["model"];
+    const std::string& repository = header["repository"];
+
+    // Skip the models that can no longer be loaded, the poll that
+    // follows sees whether they moved to another repository.
+    bool model_exists = false;
+    if ((repository_paths_.find(repository) == repository_paths_.end()) ||
+        !FileExists(JoinPath({repository, name}), &model_exists).IsOk() ||
+        !model_exists) {
+      continue;
+    }
+
+    std::unique_ptr<ModelInfo> model_info(new ModelInfo());
+    ModelConfig& model_config = model_info->model_config_;
+    model_info->mtime_nsec_ =
+        std::strtoll(header["mtime_ns"].c_str(), nullptr, 10);
+    model_info->fingerprint_ =
+        std::strtoull(header["fingerprint"].c_str(), nullptr, 10);
+    model_info->model_repository_path_ = repository;
+    model_info->unverified_ = true;
+    if (!google::protobuf::TextFormat::ParseFromString(
+            record.second, &model_config) ||
+        (model_config.name() != name) ||
+        !ValidateModelConfig(model_config, std::string()).IsOk()) {
+      LOG_WARNING << "ignoring invalid configuration of model '" << name
+                  << "' in startup snapshot";
+      continue;
+    }
+    model_info->platform_ = GetPlatform(model_config.platform());
+
+    if (!infos_.emplace(name, std::move(model_info)).second) {
+      continue;
+    }
+    added.insert(name);
+
+    // Each placement is "<device>:<estimated bytes>:<instances>".
+    std::istringstream placements(header["placement"]);
+    std::string placement;
+    while (placements >> placement) {
+      std::istringstream fields(placement);
+      int device;
+      uint64_t bytes;
+      uint32_t count;
+      char sep0, sep1;
+      if ((fields >> device >> sep0 >> bytes >> sep1 >> count) &&
+          (sep0 == ':') && (sep1 == ':')) {
+        placements_[name][device] = std::make_pair(bytes, count);
+      }
+    }
+  }
+
+  if (added.empty()) {
+    return Status::Success;
+  }
+
+  LOG_INFO << "loading " << added.size() << " models from startup snapshot '"
+           << startup_snapshot_ << "'";
+
+  RETURN_IF_ERROR(
+      Update(added, std::set<std::string>(), std::set<std::string>()));
+
   // model loading / unloading error will be printed but ignored
   LoadModelByDependency();
 
   return Status::Success;
 }
 
+void
+ModelRepositoryManager::RecordStartupSnapshot()
+{
+  if (startup_snapshot_.empty()) {
+    return;
+  }
+
+  std::string contents;
+  for (const auto& pr : infos_) {
+    const ModelInfo& info = *pr.second;
+
+    std::string prototxt;
+    if (!google::protobuf::TextFormat::PrintToString(
+            info.model_config_, &prototxt)) {
+      LOG_WARNING << "failed to record startup snapshot: failed to print "
+                  << "configuration of model '" << pr.first << "'";
+      return;
+    }
+
+    std::string placement;
+    const auto pitr = placements_.find(pr.first);
+    if (pitr != placements_.end()) {
+      for (const auto& device_placed : pitr->second) {
+        placement += (placement.empty() ? "" : " ") +
+                     std::to_string(device_placed.first) + ":" +
+                     std::to_string(device_placed.second.first) + ":" +
+                     std::to_string(device_placed.second.second);
+      }
+    }
+
+    contents += kSnapshotModelPrefix + pr.first + "\n";
+    contents += "# repository: " + info.model_repository_path_ + "\n";
+    contents += "# mtime_ns: " + std::to_string(info.mtime_nsec_) + "\n";
+    contents += "# fingerprint: " + std::to_string(info.fingerprint_) + "\n";
+    contents += "# placement: " + placement + "\n";
+    contents += prototxt;
+  }
+
+  // Replace the snapshot at once so that a crash while it is written
+  // leaves the previous snapshot.
+  const std::string tmp_path = startup_snapshot_ + ".tmp";
+  Status status = WriteTextFile(tmp_path, contents);
+  if (status.IsOk() &&
+      (std::rename(tmp_path.c_str(), startup_snapshot_.c_str()) != 0)) {
+    status = Status(
+        RequestStatusCode::INTERNAL,
+        "failed to rename '" + tmp_path + "': " + std::strerror(errno));
+  }
+  if (!status.IsOk()) {
+    LOG_WARNING << "failed to record startup snapshot '" << startup_snapshot_
+                << "': " << status.AsString();
+  }
+}
+
 Status
 ModelRepositoryManager::Update(
     const std::set<std::string>& added, const std::set<std::string>& deleted,
@@ -1095,6 +1962,13 @@ ModelRepositoryManager::LoadUnloadModel(
   // Serialize all operations that change model state
   std::lock_guard<std::mutex> lock(poll_mu_);
 
+  return LoadUnloadModelInternal(model_name, type);
+}
+
+Status
+ModelRepositoryManager::LoadUnloadModelInternal(
+    const std::string& model_name, ActionType type)
+{
   bool polled = true;
   RETURN_IF_ERROR(LoadUnloadModels({model_name}, type, &polled));
 
@@ -1220,6 +2094,7 @@ ModelRepositoryManager::LoadUnloadModels(
   // In all cases, should unload them and remove from 'infos_' explicitly.
   for (const auto& name : deleted) {
     infos_.erase(name);
+    placements_.erase(name);
     ModelConfig model_config;
     std::set<int64_t> versions;
     std::string empty_path;
@@ -1284,6 +2159,143 @@ ModelRepositoryManager::GetInferenceBackend(
   return status;
 }
 
+Status
+ModelRepositoryManager::GetInferenceBackendOrLoad(
+    const std::string& model_name, const int64_t model_version,
+    std::shared_ptr<InferenceBackend>* backend)
+{
+  if (!load_on_demand_) {
+    return GetInferenceBackend(model_name, model_version, backend);
+  }
+
+  Status status = backend_life_cycle_->GetInferenceBackend(
+      model_name, model_version, backend);
+  if (!status.IsOk()) {
+    backend->reset();
+    RETURN_IF_ERROR(LoadOnDemand(model_name, model_version));
+    RETURN_IF_ERROR(GetInferenceBackend(model_name, model_version, backend));
+  }
+
+  std::lock_guard<std::mutex> lock(use_mu_);
+  last_use_[model_name] = ++use_counter_;
+
+  return Status::Success;
+}
+
+Status
+ModelRepositoryManager::LoadOnDemand(
+    const std::string& model_name, const int64_t model_version)
+{
+  // Serialize all operations that change model state, the requests
+  // for a model that is being loaded wait here for the load to
+  // complete.
+  std::lock_guard<std::mutex> lock(poll_mu_);
+
+  // Another request may have loaded the model while this one waited.
+  std::shared_ptr<InferenceBackend> backend;
+  if (backend_life_cycle_->GetInferenceBackend(
+          model_name, model_version, &backend)
+          .IsOk()) {
+    return Status::Success;
+  }
+
+  LOG_INFO << "loading model '" << model_name << "' on demand";
+
+  // The loads are serialized so the growth of the memory used on a
+  // device while the model loads is the memory used by the model.
+  std::map<int, uint64_t> used_before;
+  GetGpuMemoryUsed(gpu_memory_budget_, &used_before);
+
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  RETURN_IF_ERROR(LoadUnloadModelInternal(model_name, ActionType::LOAD));
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  status_manager_->UpdateOnDemandLoadStats(
+      model_name, TIMESPEC_TO_NANOS(end) - TIMESPEC_TO_NANOS(start));
+
+  std::map<int, uint64_t> used_after;
+  GetGpuMemoryUsed(gpu_memory_budget_, &used_after);
+  auto& model_used = gpu_memory_used_[model_name];
+  model_used.clear();
+  for (const auto& pr : used_after) {
+    const auto itr = used_before.find(pr.first);
+    if ((itr != used_before.end()) && (pr.second > itr->second)) {
+      model_used[pr.first] = pr.second - itr->second;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> use_lock(use_mu_);
+    last_use_[model_name] = ++use_counter_;
+  }
+
+  EvictOnDemand(model_name);
+
+  return Status::Success;
+}
+
+void
+ModelRepositoryManager::EvictOnDemand(const std::string& loaded_model)
+{
+  for (const auto& budget : gpu_memory_budget_) {
+    const int device = budget.first;
+    while (true) {
+      // Forget the models that are no longer loaded, for example the
+      // ensembles unloaded along with an evicted step.
+      for (auto itr = gpu_memory_used_.begin();
+           itr != gpu_memory_used_.end();) {
+        bool ready = false;
+        for (const auto& vs : GetVersionStates(itr->first)) {
+          ready |= (vs.second == ModelReadyState::MODEL_READY);
+        }
+        itr = ready ? std::next(itr) : gpu_memory_used_.erase(itr);
+      }
+
+      uint64_t used = 0;
+      std::string victim;
+      uint64_t victim_use = std::numeric_limits<uint64_t>::max();
+      {
+        std::lock_guard<std::mutex> lock(use_mu_);
+        for (const auto& pr : gpu_memory_used_) {
+          const auto ditr = pr.second.find(device);
+          if ((ditr == pr.second.end()) || (ditr->second == 0)) {
+            continue;
+          }
+          used += ditr->second;
+          const uint64_t last_use = last_use_[pr.first];
+          if ((pr.first != loaded_model) && (last_use < victim_use)) {
+            victim = pr.first;
+            victim_use = last_use;
+          }
+        }
+      }
+
+      if (used <= budget.second) {
+        break;
+      }
+      if (victim.empty()) {
+        LOG_WARNING << "GPU memory budget of " << budget.second
+                    << " bytes on device " << device
+                    << " is exceeded but no model can be evicted";
+        break;
+      }
+
+      LOG_INFO << "evicting model '" << victim << "' to meet the GPU memory "
+               << "budget of " << budget.second << " bytes on device "
+               << device;
+      Status status = LoadUnloadModelInternal(victim, ActionType::UNLOAD);
+      if (status.IsOk()) {
+        status_manager_->UpdateOnDemandEvictionStats(victim);
+      } else {
+        LOG_ERROR << "failed to evict model '" << victim
+                  << "': " << status.Message();
+      }
+      gpu_memory_used_.erase(victim);
+    }
+  }
+}
+
 Status
 ModelRepositoryManager::Poll(
     const std::set<std::string>& models, std::set<std::string>* added,
@@ -1352,6 +2364,50 @@ ModelRepositoryManager::Poll(
     }
   }
 
+  // Where possible, find the models that have changed without walking
+  // the directories of all the models. For a watched repository the
+  // watcher reports the models that have changed. For a repository on
+  // Google Cloud Storage or Amazon S3 a single listing returns the
+  // versions of all the files, and a model has changed if the hash of
+  // the versions of its files has.
+  std::unordered_map<std::string, std::set<std::string>> changed_models;
+  for (const auto& watcher : watchers_) {
+    std::set<std::string> changed;
+    if (watcher.second->Changed(&changed)) {
+      changed_models.emplace(watcher.first, std::move(changed));
+    }
+  }
+
+  std::unordered_map<std::string, std::unordered_map<std::string, size_t>>
+      fingerprints;
+  for (const auto& repository_path : repository_paths_) {
+    if (repository_path.find("://") == std::string::npos) {
+      continue;
+    }
+
+    std::map<std::string, std::string> versions;
+    Status status = GetDirectoryFileVersions(repository_path, &versions);
+    if (!status.IsOk()) {
+      LOG_ERROR << "failed to list model repository '" << repository_path
+                << "': " << status.Message();
+      continue;
+    }
+
+    std::unordered_map<std::string, std::string> model_versions;
+    for (const auto& version : versions) {
+      const size_t model_end = version.first.find('/');
+      if (model_end != std::string::npos) {
+        std::string& mv = model_versions[version.first.substr(0, model_end)];
+        mv += version.first + '\0' + version.second + '\0';
+      }
+    }
+
+    auto& repository_fingerprints = fingerprints[repository_path];
+    for (const auto& mv : model_versions) {
+      repository_fingerprints[mv.first] = std::hash<std::string>()(mv.second);
+    }
+  }
+
   // State of the model in terms of polling. If error happens during polling
   // an individual model, its state will fallback to different states to be
   // ignored from the polling. i.e. STATE_ADDED -> STATE_INVALID,
@@ -1376,15 +2432,36 @@ ModelRepositoryManager::Poll(
     // If 'child' is a new model or an existing model that has been
     // modified since the last time it was polled, then need to
     // (re)load, normalize and validate the configuration.
-    int64_t mtime_ns;
-    if (iitr == infos_.end()) {
-      mtime_ns = GetModifiedTime(std::string(full_path));
-      model_poll_state = STATE_ADDED;
-    } else {
-      mtime_ns = iitr->second->mtime_nsec_;
-      if (IsModified(std::string(full_path), &mtime_ns)) {
+    int64_t mtime_ns = 0;
+    size_t fingerprint = 0;
+    const auto fitr = fingerprints.find(repository);
+    const auto citr = changed_models.find(repository);
+    const auto witr = watchers_.find(repository);
+    if (fitr != fingerprints.end()) {
+      fingerprint = fitr->second[child];
+      if (iitr == infos_.end()) {
+        model_poll_state = STATE_ADDED;
+      } else if (fingerprint != iitr->second->fingerprint_) {
         model_poll_state = STATE_MODIFIED;
       }
+    } else {
+      const bool may_be_changed =
+          (iitr == infos_.end()) || iitr->second->unverified_ ||
+          (citr == changed_models.end()) ||
+          (citr->second.find(child) != citr->second.end());
+      if (may_be_changed && (witr != watchers_.end())) {
+        witr->second->WatchModel(child);
+      }
+
+      if (iitr == infos_.end()) {
+        mtime_ns = GetModifiedTime(std::string(full_path));
+        model_poll_state = STATE_ADDED;
+      } else {
+        mtime_ns = iitr->second->mtime_nsec_;
+        if (may_be_changed && IsModified(std::string(full_path), &mtime_ns)) {
+          model_poll_state = STATE_MODIFIED;
+        }
+      }
     }
 
     Status status = Status::Success;
@@ -1392,13 +2469,19 @@ ModelRepositoryManager::Poll(
       model_info.reset(new ModelInfo());
       ModelConfig& model_config = model_info->model_config_;
       model_info->mtime_nsec_ = mtime_ns;
+      model_info->fingerprint_ = fingerprint;
       model_info->model_repository_path_ = repository;
 
       // If enabled, try to automatically generate missing parts of
       // the model configuration (autofill) from the model
       // definition. In all cases normalize and validate the config.
       status = GetNormalizedModelConfig(
-          full_path, backend_config_map_, autofill_, &model_config);
+          full_path, backend_config_map_, autofill_, autofill_cache_.get(),
+          (instance_placement_ == PLACEMENT_NONE) /* assign_all_gpus */,
+          &model_config);
+      if (status.IsOk() && (instance_placement_ != PLACEMENT_NONE)) {
+        PlaceInstances(repository, child, &model_config);
+      }
       if (status.IsOk()) {
         status = ValidateModelConfig(model_config, std::string());
       }
@@ -1438,6 +2521,7 @@ ModelRepositoryManager::Poll(
 
       if (model_poll_state == STATE_UNMODIFIED) {
         ret.first->second.reset(new ModelInfo(*iitr->second));
+        ret.first->second->unverified_ = false;
         unmodified->insert(child);
       } else {
         ret.first->second = std::move(model_info);
@@ -1779,4 +2863,117 @@ ModelRepositoryManager::VersionsToLoad(
   return Status::Success;
 }
 
+void
+ModelRepositoryManager::PlaceInstances(
+    const std::string& model_repository_path, const std::string& name,
+    ModelConfig* model_config)
+{
+  placements_.erase(name);
+
+  std::set<int> devices;
+#ifdef TRTIS_ENABLE_GPU
+  Status status = GetSupportedGPUs(devices);
+  if (!status.IsOk()) {
+    LOG_WARNING << "failed to place the instances of '" << name
+                << "': " << status.Message();
+    return;
+  }
+#endif  // TRTIS_ENABLE_GPU
+  if (devices.empty()) {
+    return;
+  }
+
+  // The estimated memory of an instance is the largest estimate of
+  // the versions to be loaded, instances without an estimate are
+  // placed by the number of instances on each device.
+  uint64_t estimate = 0;
+  std::set<int64_t> versions;
+  if (VersionsToLoad(model_repository_path, name, *model_config, &versions)
+          .IsOk()) {
+    const Platform platform = GetPlatform(model_config->platform());
+    for (const int64_t version : versions) {
+      estimate = std::max(
+          estimate, backend_life_cycle_->InstanceMemoryEstimate(
+                        name, version,
+                        JoinPath(
+                            {model_repository_path, name,
+                             std::to_string(version)}),
+                        platform));
+    }
+  }
+
+  std::map<int, std::pair<uint64_t, uint32_t>> placed;
+  for (const int device : devices) {
+    placed[device] = std::make_pair(0, 0);
+  }
+  for (const auto& model : placements_) {
+    for (const auto& pr : model.second) {
+      auto& device_placed = placed[pr.first];
+      device_placed.first += pr.second.first;
+      device_placed.second += pr.second.second;
+    }
+  }
+
+  std::map<int, uint64_t> free, used, capacity;
+  GetGpuMemoryInfo(devices, &free, &used);
+  for (const auto& pr : free) {
+    capacity[pr.first] = pr.second + used[pr.first];
+  }
+
+  google::protobuf::RepeatedPtrField<ModelInstanceGroup> groups;
+  for (const auto& group : model_config->instance_group()) {
+    if ((group.kind() != ModelInstanceGroup::KIND_GPU) ||
+        (group.gpus().size() != 0)) {
+      *groups.Add() = group;
+      continue;
+    }
+
+    std::map<int, int32_t> counts;
+    for (int32_t i = 0; i < group.count(); ++i) {
+      const int device = SelectPlacementDevice(
+          instance_placement_, estimate, placed, capacity);
+      counts[device]++;
+      placed[device].first += estimate;
+      placed[device].second++;
+    }
+
+    // Every GPU of a group has the same number of instances, so the
+    // GPUs with fewer instances go in groups of their own.
+    std::map<int32_t, std::vector<int>> devices_by_count;
+    for (const auto& pr : counts) {
+      devices_by_count[pr.second].push_back(pr.first);
+    }
+    size_t split = 0;
+    for (auto itr = devices_by_count.rbegin(); itr != devices_by_count.rend();
+         ++itr, ++split) {
+      ModelInstanceGroup* placed_group = groups.Add();
+      *placed_group = group;
+      placed_group->set_count(itr->first);
+      if (split > 0) {
+        placed_group->set_name(group.name() + "_" + std::to_string(split));
+      }
+      for (const int device : itr->second) {
+        placed_group->add_gpus(device);
+      }
+    }
+
+    std::string placement_str;
+    for (const auto& pr : counts) {
+      placement_str += (placement_str.empty() ? "" : ", ") +
+                       std::to_string(pr.second) + " on GPU " +
+                       std::to_string(pr.first);
+    }
+    LOG_INFO << "placed instance group '" << group.name() << "' of '" << name
+             << "': " << placement_str;
+  }
+  model_config->mutable_instance_group()->Swap(&groups);
+
+  // Record every GPU instance of the model, including those of the
+  // groups that list their GPUs, for the placement of later models.
+  for (const auto& pr : GpuInstanceCounts(*model_config)) {
+    placements_[name][pr.first] =
+        std::make_pair(estimate * pr.second, pr.second);
+  }
+}
+
 }}  // namespace nvidia::inferenceserver
@@ -36,8 +36,11 @@
 
 namespace nvidia { namespace inferenceserver {
 
+class AutoFillCache;
+
 class InferenceServer;
 class InferenceBackend;
+class RepositoryWatcher;
 class ServerStatusManager;
 
 /// An object to manage the model repository active in the server.
@@ -82,12 +85,39 @@ class ModelRepositoryManager {
   /// for TensorFlow models.
   /// \param tf_allow_soft_placement If true instruct TensorFlow to use CPU
   /// implementation of an operation when a GPU implementation is not available
+  /// \param tf_memory_limit_mb The virtual GPUs to create for TensorFlow.
+  /// \param trt_engine_cache_dir The directory where TensorRT engines
+  /// built from ONNX models and graphs converted by TF-TRT are cached,
+  /// or empty to not cache them.
   /// \param polling_enabled If true, then PollAndUpdate() is allowed.
   /// Otherwise, it is not allowed.
   /// \param model_control_enabled If true, then LoadUnloadModel() is allowed
   /// and the models in the model repository will not be loaded at startup.
   /// Otherwise, LoadUnloadModel() is not allowed and the models will be loaded.
   /// Cannot be set to true if polling_enabled is true.
+  /// \param load_on_demand If true, a model that is not loaded is loaded
+  /// when an inference request for it is received. Requires
+  /// model_control_enabled to be true.
+  /// \param gpu_memory_budget The GPU memory, in bytes, that the models
+  /// loaded on demand may use on each device. When a budget is exceeded
+  /// the least recently used models loaded on demand are unloaded.
+  /// \param load_thread_count The number of threads loading models.
+  /// \param load_gpu_limit The maximum number of models loading at the
+  /// same time on each GPU, or 0 for no limit.
+  /// \param load_storage_limit The maximum number of models loading at
+  /// the same time from each storage (local, gs, s3), or 0 for no limit.
+  /// \param memory_estimate_dir The directory where the estimated GPU
+  /// memory of each model version is recorded for the admission of later
+  /// loads, or empty to not record the estimates.
+  /// \param model_config_cache_dir The directory where the model
+  /// configurations completed by autofill are recorded so that they are
+  /// reused after a restart, or empty to only reuse them in memory.
+  /// \param model_startup_snapshot The file where the resolved
+  /// configurations of the models are recorded so that the models start
+  /// loading before the repositories are polled after a restart, or empty
+  /// to not record them. Only used if model_control_enabled is false.
+  /// \param instance_placement The policy for placing the instances of
+  /// the KIND_GPU instance groups that don't list their GPUs.
   /// \return The error status.
   static Status Create(
       InferenceServer* server, const std::string& server_version,
@@ -97,7 +127,14 @@ class ModelRepositoryManager {
       const bool strict_model_config, const float tf_gpu_memory_fraction,
       const bool tf_allow_soft_placement,
       const std::map<int, std::pair<int, uint64_t>> tf_memory_limit_mb,
-      const bool polling_enabled, const bool model_control_enabled,
+      const std::string& trt_engine_cache_dir, const bool polling_enabled,
+      const bool model_control_enabled, const bool load_on_demand,
+      const std::map<int, uint64_t>& gpu_memory_budget,
+      const uint32_t load_thread_count, const uint32_t load_gpu_limit,
+      const uint32_t load_storage_limit, const std::string& memory_estimate_dir,
+      const std::string& model_config_cache_dir,
+      const std::string& model_startup_snapshot,
+      const InstancePlacement instance_placement,
       std::unique_ptr<ModelRepositoryManager>* model_repository_manager);
 
   /// Poll the model repository to determine the new set of models and
@@ -139,6 +176,17 @@ class ModelRepositoryManager {
       const std::string& model_name, const int64_t model_version,
       std::shared_ptr<InferenceBackend>* backend);
 
+  /// Obtain the specified backend to serve an inference request. If
+  /// models are loaded on demand and the model is not loaded, load it
+  /// and wait for the load to complete.
+  /// \param model_name The model name of the backend handle.
+  /// \param model_version The model version of the backend handle.
+  /// \param backend Return the inference backend object.
+  /// \return error status.
+  Status GetInferenceBackendOrLoad(
+      const std::string& model_name, const int64_t model_version,
+      std::shared_ptr<InferenceBackend>* backend);
+
  private:
   struct ModelInfo;
   class BackendLifeCycle;
@@ -154,12 +202,46 @@ class ModelRepositoryManager {
       const std::shared_ptr<ServerStatusManager>& status_manager,
       const std::set<std::string>& repository_paths,
       const BackendConfigMap& backend_config_map, const bool autofill,
-      const bool polling_enabled, const bool model_control_enabled,
+      const std::string& model_config_cache_dir,
+      const std::string& startup_snapshot, const bool polling_enabled,
+      const bool model_control_enabled, const bool load_on_demand,
+      const std::map<int, uint64_t>& gpu_memory_budget,
+      const InstancePlacement instance_placement,
       std::unique_ptr<BackendLifeCycle> life_cycle);
 
   /// The internal function that are called in Create() and PollAndUpdate().
   Status PollAndUpdateInternal(bool* all_models_polled);
 
+  /// Start loading the models recorded in 'startup_snapshot_', if it
+  /// exists, with their recorded configurations and placements, without
+  /// polling the repositories. The models are verified by the next poll,
+  /// which reloads those that changed since the snapshot was recorded.
+  /// \return The error status.
+  Status LoadStartupSnapshot();
+
+  /// Record the configurations and placements of all the models in
+  /// 'startup_snapshot_', if not empty. The caller must hold 'poll_mu_'.
+  void RecordStartupSnapshot();
+
+  /// The internal function of LoadUnloadModel(), the caller must hold
+  /// 'poll_mu_'.
+  Status LoadUnloadModelInternal(
+      const std::string& model_name, ActionType type);
+
+  /// Load a model for an inference request, unless another request
+  /// loaded it meanwhile, and then evict the least recently used
+  /// models if the GPU memory budget is exceeded.
+  /// \param model_name The name of the model to load.
+  /// \param model_version The version requested by the inference request.
+  /// \return The error status.
+  Status LoadOnDemand(
+      const std::string& model_name, const int64_t model_version);
+
+  /// Unload the least recently used models loaded on demand, other than
+  /// 'loaded_model', until the GPU memory budget of every device is met.
+  /// The caller must hold 'poll_mu_'.
+  void EvictOnDemand(const std::string& loaded_model);
+
   /// The internal function that load or unload a set of models.
   Status LoadUnloadModels(
       const std::set<std::string>& models, ActionType type,
@@ -261,15 +343,55 @@ class ModelRepositoryManager {
       const std::string model_repository_path, const std::string& name,
       const ModelConfig& model_config, std::set<int64_t>* versions);
 
+  /// Place the instances of the KIND_GPU instance groups of a model
+  /// that don't list their GPUs according to 'instance_placement_', and
+  /// record the estimated GPU memory and instances of the model on each
+  /// GPU for the placement of later models. A group whose instances
+  /// are placed on GPUs with different counts is split into one group
+  /// for each count. The caller must hold 'poll_mu_'.
+  /// \param model_repository_path The file-system path of the repository
+  /// that the model is at.
+  /// \param name The model name.
+  /// \param model_config The model configuration to place.
+  void PlaceInstances(
+      const std::string& model_repository_path, const std::string& name,
+      ModelConfig* model_config);
+
   const std::set<std::string> repository_paths_;
   const BackendConfigMap backend_config_map_;
   const bool autofill_;
+  std::unique_ptr<AutoFillCache> autofill_cache_;
+  const std::string startup_snapshot_;
   const bool polling_enabled_;
   const bool model_control_enabled_;
+  const bool load_on_demand_;
+  const std::map<int, uint64_t> gpu_memory_budget_;
+  const InstancePlacement instance_placement_;
 
   std::mutex poll_mu_;
   ModelInfoMap infos_;
 
+  // The GPU memory, as a map from device to bytes, used by each model
+  // loaded on demand. Protected by 'poll_mu_'.
+  std::unordered_map<std::string, std::map<int, uint64_t>> gpu_memory_used_;
+
+  // The estimated GPU memory, in bytes, and the number of instances of
+  // each model on each device, as recorded by PlaceInstances(). Protected
+  // by 'poll_mu_'.
+  std::unordered_map<std::string, std::map<int, std::pair<uint64_t, uint32_t>>>
+      placements_;
+
+  // The order in which the models loaded on demand were last used, as a
+  // map from model name to a counter value.
+  std::mutex use_mu_;
+  uint64_t use_counter_;
+  std::unordered_map<std::string, uint64_t> last_use_;
+
+  // The watchers of the repositories that can be watched for changes
+  // instead of walking all the model directories on every poll.
+  std::unordered_map<std::string, std::unique_ptr<RepositoryWatcher>>
+      watchers_;
+
   std::unordered_map<std::string, std::unique_ptr<DependencyNode>>
       dependency_graph_;
   std::unordered_map<std::string, std::unique_ptr<DependencyNode>>
@@ -0,0 +1,142 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stddef.h>
+#include <atomic>
+#include <utility>
+
+namespace nvidia { namespace inferenceserver {
+
+//
+// Lock-free multi-producer, single-consumer intake queue. Any number
+// of threads may Push() concurrently without taking a lock. Items are
+// removed in bulk by DrainTo(), which must be serialized by the
+// caller (for example by holding the consumer's mutex). Because the
+// consumer always takes the entire list in a single atomic exchange
+// there is no ABA hazard, and the order of items returned by DrainTo()
+// matches the order in which Push() operations completed.
+//
+template <typename T>
+class MpscQueue {
+ public:
+  MpscQueue() : head_(nullptr) {}
+  ~MpscQueue()
+  {
+    Node* node = head_.exchange(nullptr);
+    while (node != nullptr) {
+      Node* next = node->next_;
+      delete node;
+      node = next;
+    }
+  }
+
+  // Add an item to the queue. Safe to call from any thread.
+  void Push(T&& item)
+  {
+    Node* node = new Node(std::move(item));
+    node->next_ = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_weak(node->next_, node)) {
+    }
+  }
+
+  // Add all items of 'container' to the queue, in order, with a
+  // single atomic update so that they are drained together. Safe to
+  // call from any thread.
+  template <typename Container>
+  void PushAll(Container* container)
+  {
+    if (container->empty()) {
+      return;
+    }
+
+    // Link the nodes newest-first, as individual pushes would.
+    Node* first = nullptr;
+    Node* last = nullptr;
+    for (auto& item : *container) {
+      Node* node = new Node(std::move(item));
+      node->next_ = last;
+      if (first == nullptr) {
+        first = node;
+      }
+      last = node;
+    }
+
+    first->next_ = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_weak(first->next_, last)) {
+    }
+  }
+
+  // Return true if the queue has no items. The result is only a
+  // snapshot since producers may be pushing concurrently. Push() and
+  // Empty() are sequentially consistent so that they can be paired
+  // with a separate atomic (for example an idle-waiter count) to
+  // avoid lost wakeups.
+  bool Empty() const { return head_.load() == nullptr; }
+
+  // Move all items currently in the queue to the back of 'container',
+  // oldest first, and return the number of items moved. Only one
+  // thread may call DrainTo() at a time.
+  template <typename Container>
+  size_t DrainTo(Container* container)
+  {
+    Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+    if (node == nullptr) {
+      return 0;
+    }
+
+    // The list is newest-first so reverse it before appending.
+    Node* reversed = nullptr;
+    while (node != nullptr) {
+      Node* next = node->next_;
+      node->next_ = reversed;
+      reversed = node;
+      node = next;
+    }
+
+    size_t cnt = 0;
+    while (reversed != nullptr) {
+      Node* next = reversed->next_;
+      container->emplace_back(std::move(reversed->item_));
+      delete reversed;
+      reversed = next;
+      cnt++;
+    }
+
+    return cnt;
+  }
+
+ private:
+  struct Node {
+    explicit Node(T&& item) : item_(std::move(item)), next_(nullptr) {}
+    T item_;
+    Node* next_;
+  };
+
+  std::atomic<Node*> head_;
+};
+
+}}  // namespace nvidia::inferenceserver
@@ -0,0 +1,90 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#ifdef TRTIS_ENABLE_NVTX
+#include <nvToolsExt.h>
+#include <atomic>
+#endif  // TRTIS_ENABLE_NVTX
+
+namespace nvidia { namespace inferenceserver {
+
+#ifdef TRTIS_ENABLE_NVTX
+
+// Whether NVTX ranges are emitted. Ranges are enabled by default
+// when the server is built with NVTX support and can be toggled at
+// runtime. The flag is local to the module (library or executable)
+// that includes this header.
+inline std::atomic<bool>&
+NvtxEnabledFlag()
+{
+  static std::atomic<bool> enabled(true);
+  return enabled;
+}
+
+inline bool
+NvtxEnabled()
+{
+  return NvtxEnabledFlag().load(std::memory_order_relaxed);
+}
+
+inline void
+SetNvtxEnabled(bool enabled)
+{
+  NvtxEnabledFlag().store(enabled, std::memory_order_relaxed);
+}
+
+// An NVTX range on the calling thread that covers the lifetime of
+// the object.
+class NvtxRange {
+ public:
+  explicit NvtxRange(const char* label) : pushed_(NvtxEnabled())
+  {
+    if (pushed_) {
+      nvtxRangePushA(label);
+    }
+  }
+
+  ~NvtxRange()
+  {
+    if (pushed_) {
+      nvtxRangePop();
+    }
+  }
+
+ private:
+  const bool pushed_;
+};
+
+#define NVTX_RANGE(V, L) nvidia::inferenceserver::NvtxRange V(L)
+
+#else
+
+#define NVTX_RANGE(V, L)
+
+#endif  // TRTIS_ENABLE_NVTX
+
+}}  // namespace nvidia::inferenceserver
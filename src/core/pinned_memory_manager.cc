@@ -0,0 +1,232 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/core/pinned_memory_manager.h"
+
+#include <stdlib.h>
+#include "src/core/logging.h"
+
+#ifdef TRTIS_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRTIS_ENABLE_GPU
+
+#ifdef TRTIS_ENABLE_METRICS
+#include "src/core/metrics.h"
+#endif  // TRTIS_ENABLE_METRICS
+
+namespace nvidia { namespace inferenceserver {
+
+namespace {
+
+// The smallest size class. Blocks of size class 'c' hold
+// 'kMinBlockByteSize << c' bytes.
+constexpr uint64_t kMinBlockByteSize = 256;
+
+}  // namespace
+
+std::unique_ptr<PinnedMemoryManager> PinnedMemoryManager::instance_;
+
+PinnedMemoryManager::PinnedMemoryManager(
+    char* pinned_memory_buffer, uint64_t size)
+    : pinned_memory_buffer_(pinned_memory_buffer), pool_byte_size_(size),
+      next_offset_(0), used_byte_size_(0)
+{
+#ifdef TRTIS_ENABLE_METRICS
+  metric_pool_total_ = &Metrics::FamilyPinnedMemoryPoolTotal().Add({});
+  metric_pool_used_ = &Metrics::FamilyPinnedMemoryPoolUsed().Add({});
+  metric_pool_total_->Set(pool_byte_size_);
+  metric_pool_used_->Set(0);
+#endif  // TRTIS_ENABLE_METRICS
+}
+
+PinnedMemoryManager::~PinnedMemoryManager()
+{
+#ifdef TRTIS_ENABLE_GPU
+  if (pinned_memory_buffer_ != nullptr) {
+    cudaError_t err = cudaFreeHost(pinned_memory_buffer_);
+    if (err != cudaSuccess) {
+      LOG_ERROR << "failed to free pinned memory: "
+                << std::string(cudaGetErrorString(err));
+    }
+  }
+#endif  // TRTIS_ENABLE_GPU
+}
+
+Status
+PinnedMemoryManager::Create(uint64_t pinned_memory_pool_byte_size)
+{
+  if (instance_ != nullptr) {
+    LOG_WARNING << "pinned memory pool has already been created";
+    return Status::Success;
+  }
+
+  char* buffer = nullptr;
+#ifdef TRTIS_ENABLE_GPU
+  if (pinned_memory_pool_byte_size > 0) {
+    cudaError_t err = cudaHostAlloc(
+        (void**)&buffer, pinned_memory_pool_byte_size, cudaHostAllocPortable);
+    if (err != cudaSuccess) {
+      // Pinned memory only makes staging faster so continue without
+      // it, for example when the server runs on a system without GPUs.
+      LOG_WARNING << "unable to allocate pinned memory pool of "
+                  << pinned_memory_pool_byte_size
+                  << " bytes, pinned memory will not be used: "
+                  << std::string(cudaGetErrorString(err));
+      buffer = nullptr;
+    }
+  }
+#endif  // TRTIS_ENABLE_GPU
+
+  if (buffer == nullptr) {
+    pinned_memory_pool_byte_size = 0;
+  } else {
+    LOG_INFO << "Pinned memory pool is created with "
+             << pinned_memory_pool_byte_size << " bytes";
+  }
+
+  instance_.reset(
+      new PinnedMemoryManager(buffer, pinned_memory_pool_byte_size));
+  return Status::Success;
+}
+
+size_t
+PinnedMemoryManager::SizeClass(uint64_t size)
+{
+  size_t size_class = 0;
+  while ((kMinBlockByteSize << size_class) < size) {
+    size_class++;
+  }
+
+  return size_class;
+}
+
+Status
+PinnedMemoryManager::Alloc(
+    void** ptr, uint64_t size, bool allow_nonpinned_fallback, bool* is_pinned)
+{
+  *ptr = nullptr;
+  *is_pinned = false;
+
+  Status status =
+      (instance_ == nullptr)
+          ? Status(
+                RequestStatusCode::UNAVAILABLE,
+                "pinned memory pool has not been created")
+          : instance_->AllocPinned(ptr, size);
+  if (status.IsOk()) {
+    *is_pinned = true;
+    return status;
+  }
+
+  if (!allow_nonpinned_fallback) {
+    return status;
+  }
+
+  *ptr = malloc(size);
+  if ((*ptr == nullptr) && (size != 0)) {
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "failed to allocate " + std::to_string(size) + " bytes");
+  }
+
+  return Status::Success;
+}
+
+Status
+PinnedMemoryManager::Free(void* ptr)
+{
+  if ((instance_ == nullptr) || !instance_->FreePinned(ptr)) {
+    free(ptr);
+  }
+
+  return Status::Success;
+}
+
+Status
+PinnedMemoryManager::AllocPinned(void** ptr, uint64_t size)
+{
+  if (size > pool_byte_size_) {
+    return Status(
+        RequestStatusCode::UNAVAILABLE,
+        "pinned memory pool cannot hold " + std::to_string(size) + " bytes");
+  }
+
+  const size_t size_class = SizeClass(size);
+  const uint64_t block_byte_size = kMinBlockByteSize << size_class;
+
+  std::lock_guard<std::mutex> lock(mu_);
+
+  char* block = nullptr;
+  if ((size_class < free_blocks_.size()) &&
+      !free_blocks_[size_class].empty()) {
+    block = free_blocks_[size_class].back();
+    free_blocks_[size_class].pop_back();
+  } else if (block_byte_size <= (pool_byte_size_ - next_offset_)) {
+    block = pinned_memory_buffer_ + next_offset_;
+    next_offset_ += block_byte_size;
+  } else {
+    return Status(
+        RequestStatusCode::UNAVAILABLE,
+        "pinned memory pool exhausted, unable to allocate " +
+            std::to_string(size) + " bytes");
+  }
+
+  allocated_blocks_.emplace(block, size_class);
+  used_byte_size_ += block_byte_size;
+#ifdef TRTIS_ENABLE_METRICS
+  metric_pool_used_->Set(used_byte_size_);
+#endif  // TRTIS_ENABLE_METRICS
+
+  *ptr = block;
+  return Status::Success;
+}
+
+bool
+PinnedMemoryManager::FreePinned(void* ptr)
+{
+  std::lock_guard<std::mutex> lock(mu_);
+
+  auto it = allocated_blocks_.find(ptr);
+  if (it == allocated_blocks_.end()) {
+    return false;
+  }
+
+  const size_t size_class = it->second;
+  allocated_blocks_.erase(it);
+  if (size_class >= free_blocks_.size()) {
+    free_blocks_.resize(size_class + 1);
+  }
+  free_blocks_[size_class].push_back(static_cast<char*>(ptr));
+
+  used_byte_size_ -= kMinBlockByteSize << size_class;
+#ifdef TRTIS_ENABLE_METRICS
+  metric_pool_used_->Set(used_byte_size_);
+#endif  // TRTIS_ENABLE_METRICS
+
+  return true;
+}
+
+}}  // namespace nvidia::inferenceserver
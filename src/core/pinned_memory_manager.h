@@ -0,0 +1,108 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "src/core/status.h"
+
+#ifdef TRTIS_ENABLE_METRICS
+#include "prometheus/registry.h"
+#endif  // TRTIS_ENABLE_METRICS
+
+namespace nvidia { namespace inferenceserver {
+
+// This is a singleton class responsible for maintaining the
+// server-wide pool of pinned (page-locked) host memory. Pinned memory
+// is used for the host buffers that tensors are staged in so that
+// copies to and from GPU memory can be done asynchronously and at
+// full bandwidth. The pool is allocated once, when the manager is
+// created, and is carved into blocks on demand. Each block is rounded
+// up to a power-of-two size class and a freed block is kept on the
+// free list of its class for reuse, so steady-state allocation does
+// not call into CUDA.
+class PinnedMemoryManager {
+ public:
+  ~PinnedMemoryManager();
+
+  // Create the pinned memory manager with a pool of
+  // 'pinned_memory_pool_byte_size' bytes. A zero size, or a build
+  // without GPU support, results in a manager that never returns
+  // pinned memory.
+  static Status Create(uint64_t pinned_memory_pool_byte_size);
+
+  // Allocate a buffer of 'size' bytes and return it in 'ptr'. The
+  // buffer is taken from the pinned memory pool if possible. If the
+  // pool cannot satisfy the request and 'allow_nonpinned_fallback' is
+  // true the buffer is allocated from regular system memory,
+  // otherwise an error is returned. 'is_pinned' returns whether the
+  // buffer is pinned.
+  static Status Alloc(
+      void** ptr, uint64_t size, bool allow_nonpinned_fallback,
+      bool* is_pinned);
+
+  // Free a buffer returned by Alloc().
+  static Status Free(void* ptr);
+
+ private:
+  PinnedMemoryManager(char* pinned_memory_buffer, uint64_t size);
+
+  // Return the index of the smallest size class that can hold 'size'
+  // bytes.
+  static size_t SizeClass(uint64_t size);
+
+  Status AllocPinned(void** ptr, uint64_t size);
+  bool FreePinned(void* ptr);
+
+  static std::unique_ptr<PinnedMemoryManager> instance_;
+
+  std::mutex mu_;
+
+  // The pinned memory pool. Blocks are carved from the unused tail
+  // starting at 'next_offset_'.
+  char* pinned_memory_buffer_;
+  uint64_t pool_byte_size_;
+  uint64_t next_offset_;
+
+  // Free blocks, indexed by size class.
+  std::vector<std::vector<char*>> free_blocks_;
+
+  // The size class of each block that is currently allocated.
+  std::unordered_map<void*, size_t> allocated_blocks_;
+
+  // The number of pool bytes held by allocated blocks.
+  uint64_t used_byte_size_;
+
+#ifdef TRTIS_ENABLE_METRICS
+  prometheus::Gauge* metric_pool_total_;
+  prometheus::Gauge* metric_pool_used_;
+#endif  // TRTIS_ENABLE_METRICS
+};
+
+}}  // namespace nvidia::inferenceserver
@@ -26,13 +26,17 @@
 
 #include "src/core/provider.h"
 
+#include <algorithm>
+#include <cstring>
 #include <deque>
 #include <numeric>
 #include "src/core/backend.h"
 #include "src/core/constants.h"
+#include "src/core/cuda_memory_manager.h"
 #include "src/core/logging.h"
 #include "src/core/model_config.h"
 #include "src/core/model_config_utils.h"
+#include "src/core/pinned_memory_manager.h"
 
 #ifdef TRTIS_ENABLE_GPU
 #include <cuda_runtime_api.h>
@@ -75,13 +79,30 @@ AllocatedSystemMemory::AllocatedSystemMemory(
   buffer_ = nullptr;
   if (byte_size != 0) {
     if (memory_type_ == TRTSERVER_MEMORY_CPU) {
-      buffer_ = new char[byte_size];
+      // Use pinned memory when available so that the buffer can be
+      // copied to or from GPU memory asynchronously.
+      bool is_pinned;
+      Status status = PinnedMemoryManager::Alloc(
+          (void**)&buffer_, byte_size, true /* allow_nonpinned_fallback */,
+          &is_pinned);
+      if (!status.IsOk()) {
+        LOG_ERROR << status.Message();
+        buffer_ = nullptr;
+      }
     } else {
 #ifdef TRTIS_ENABLE_GPU
-      cudaError_t err = cudaMalloc((void**)&buffer_, byte_size);
-      if (err != cudaSuccess) {
-        LOG_ERROR << "failed to allocate GPU memory with byte size" << byte_size
-                  << ": " << std::string(cudaGetErrorString(err));
+      int device_id;
+      cudaError_t err = cudaGetDevice(&device_id);
+      Status status =
+          (err == cudaSuccess)
+              ? CudaMemoryManager::Alloc(
+                    (void**)&buffer_, byte_size, device_id, nullptr)
+              : Status(
+                    RequestStatusCode::INTERNAL,
+                    "failed to get current CUDA device: " +
+                        std::string(cudaGetErrorString(err)));
+      if (!status.IsOk()) {
+        LOG_ERROR << status.Message();
         buffer_ = nullptr;
       }
 #else
@@ -96,13 +117,12 @@ AllocatedSystemMemory::~AllocatedSystemMemory()
 {
   if (buffer_ != nullptr) {
     if (memory_type_ == TRTSERVER_MEMORY_CPU) {
-      delete buffer_;
+      PinnedMemoryManager::Free(buffer_);
     } else {
 #ifdef TRTIS_ENABLE_GPU
-      cudaError_t err = cudaFree(buffer_);
-      if (err != cudaSuccess) {
-        LOG_ERROR << "failed to free GPU memory at address " << buffer_ << ": "
-                  << std::string(cudaGetErrorString(err));
+      Status status = CudaMemoryManager::Free(buffer_, nullptr);
+      if (!status.IsOk()) {
+        LOG_ERROR << status.Message();
       }
 #endif  // TRTIS_ENABLE_GPU
     }
@@ -137,7 +157,7 @@ AllocatedSystemMemory::MutableBuffer(TRTSERVER_Memory_Type* memory_type)
 Status
 InferRequestProvider::Create(
     const std::string& model_name, const int64_t model_version,
-    const InferRequestHeader& request_header,
+    const std::shared_ptr<const InferRequestHeader>& request_header,
     const std::unordered_map<std::string, std::shared_ptr<SystemMemory>>&
         input_buffer,
     std::shared_ptr<InferRequestProvider>* provider)
@@ -146,7 +166,7 @@ InferRequestProvider::Create(
 
   (*provider)->request_header_ = request_header;
 
-  for (const auto& io : request_header.input()) {
+  for (const auto& io : request_header->input()) {
     auto it = input_buffer.find(io.name());
     if (it == input_buffer.end()) {
       return Status(
@@ -169,6 +189,74 @@ InferRequestProvider::Create(
   return Status::Success;
 }
 
+Status
+InferRequestProvider::CreateBatchSlice(
+    const std::shared_ptr<InferRequestProvider>& provider,
+    const size_t batch_offset, const size_t batch_size,
+    std::shared_ptr<InferRequestProvider>* slice)
+{
+  if ((provider->overrides_ != nullptr) && !provider->overrides_->empty()) {
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "can't split a request with input overrides for model '" +
+            provider->model_name_ + "'");
+  }
+
+  const InferRequestHeader& request_header = provider->RequestHeader();
+  auto slice_header = std::make_shared<InferRequestHeader>(request_header);
+  slice_header->set_batch_size(batch_size);
+
+  // Each batch element of an input has the same byte size, so the
+  // slice's part of the input is a byte range of the input data that
+  // may span several of its buffers.
+  std::unordered_map<std::string, std::shared_ptr<SystemMemory>> input_map;
+  for (InferRequestHeader::Input& io : *slice_header->mutable_input()) {
+    const size_t element_byte_size =
+        io.batch_byte_size() / request_header.batch_size();
+    io.set_batch_byte_size(element_byte_size * batch_size);
+
+    std::shared_ptr<SystemMemory> memory;
+    RETURN_IF_ERROR(provider->GetSystemMemory(io.name(), &memory));
+
+    auto reference = std::make_shared<SystemMemoryReference>();
+    size_t skip_byte_size = element_byte_size * batch_offset;
+    size_t remaining_byte_size = io.batch_byte_size();
+    for (size_t idx = 0; remaining_byte_size > 0; ++idx) {
+      size_t byte_size;
+      TRTSERVER_Memory_Type memory_type;
+      const char* buffer = memory->BufferAt(idx, &byte_size, &memory_type);
+      if (buffer == nullptr) {
+        break;
+      }
+      if (skip_byte_size >= byte_size) {
+        skip_byte_size -= byte_size;
+        continue;
+      }
+
+      const size_t slice_byte_size =
+          std::min(byte_size - skip_byte_size, remaining_byte_size);
+      reference->AddBuffer(
+          buffer + skip_byte_size, slice_byte_size, memory_type);
+      remaining_byte_size -= slice_byte_size;
+      skip_byte_size = 0;
+    }
+
+    input_map.emplace(io.name(), std::move(reference));
+  }
+
+  for (InferRequestHeader::Output& io : *slice_header->mutable_output()) {
+    io.clear_cls();
+    io.set_data_type(DataType::TYPE_INVALID);
+  }
+
+  RETURN_IF_ERROR(Create(
+      provider->model_name_, provider->version_, slice_header, input_map,
+      slice));
+  (*slice)->SetCancelledFunction(provider->CancelledFunction());
+
+  return Status::Success;
+}
+
 const std::shared_ptr<InferRequestProvider::InputOverrideMap>&
 InferRequestProvider::GetInputOverride() const
 {
@@ -183,22 +271,48 @@ InferRequestProvider::SetInputOverride(
   return Status::Success;
 }
 
+void
+InferRequestProvider::AddImplicitOutput(const std::string& name)
+{
+  for (const auto& output : request_header_->output()) {
+    if (output.name() == name) {
+      return;
+    }
+  }
+
+  auto request_header = std::make_shared<InferRequestHeader>(*request_header_);
+  request_header->add_output()->set_name(name);
+  request_header_ = request_header;
+}
+
 bool
 InferRequestProvider::GetInputOverrideContent(
-    const std::string& name, const void** content, size_t* content_byte_size)
+    const std::string& name, const void** content, size_t* content_byte_size,
+    TRTSERVER_Memory_Type* memory_type)
 {
   if (overrides_ != nullptr) {
     const auto& pr = overrides_->find(name);
     if (pr != overrides_->end()) {
-      if ((*content_byte_size == 0) ||
-          (overrides_consumed_.find(name) != overrides_consumed_.end())) {
-        *content = nullptr;
+      const InputOverride& override = *pr->second;
+      size_t& chunk_idx = overrides_next_chunk_[name];
+      *content = nullptr;
+      *memory_type = TRTSERVER_MEMORY_CPU;
+      if (*content_byte_size == 0) {
+        // No content is expected.
+      } else if (override.memory_ != nullptr) {
+        *content = override.memory_->BufferAt(
+            chunk_idx, content_byte_size, memory_type);
+        if (*content != nullptr) {
+          chunk_idx++;
+        }
+      } else if (chunk_idx == 0) {
+        *content = reinterpret_cast<const void*>(&(override.content_[0]));
+        *content_byte_size = override.content_.size();
+        chunk_idx++;
+      }
+
+      if (*content == nullptr) {
         *content_byte_size = 0;
-      } else {
-        std::shared_ptr<InputOverride>& override = pr->second;
-        *content = reinterpret_cast<void*>(&(override->content_[0]));
-        *content_byte_size = override->content_.size();
-        overrides_consumed_.insert(name);
       }
 
       return true;
@@ -208,6 +322,29 @@ InferRequestProvider::GetInputOverrideContent(
   return false;
 }
 
+bool
+InferRequestProvider::GetInputOverrideChunks(
+    const std::string& name, std::vector<InputChunk>* chunks)
+{
+  while (true) {
+    const void* content;
+    size_t content_byte_size = 1;
+    TRTSERVER_Memory_Type memory_type;
+    if (!GetInputOverrideContent(
+            name, &content, &content_byte_size, &memory_type)) {
+      return false;
+    }
+
+    if (content == nullptr) {
+      return true;
+    }
+
+    if (content_byte_size > 0) {
+      chunks->push_back(InputChunk{content, content_byte_size, memory_type});
+    }
+  }
+}
+
 Status
 InferRequestProvider::GetNextInputContent(
     const std::string& name, const void** content, size_t* content_byte_size,
@@ -218,9 +355,8 @@ InferRequestProvider::GetNextInputContent(
     return Status::Success;
   }
 
-  if (GetInputOverrideContent(name, content, content_byte_size)) {
-    *memory_type = TRTSERVER_MEMORY_CPU;
-  } else {
+  if (!GetInputOverrideContent(
+          name, content, content_byte_size, memory_type)) {
     const auto& pr = input_buffer_.find(name);
     if (pr == input_buffer_.end()) {
       return Status(
@@ -269,6 +405,43 @@ InferRequestProvider::GetNextInputContent(
   return Status::Success;
 }
 
+Status
+InferRequestProvider::GetInputChunks(
+    const std::string& name, size_t byte_size, std::vector<InputChunk>* chunks)
+{
+  if (byte_size == 0) {
+    return Status::Success;
+  }
+
+  if (GetInputOverrideChunks(name, chunks)) {
+    return Status::Success;
+  }
+
+  const auto& pr = input_buffer_.find(name);
+  if (pr == input_buffer_.end()) {
+    return Status(
+        RequestStatusCode::INTERNAL, "unexpected input '" + name + "'");
+  }
+
+  auto& input_content = pr->second;
+  while (true) {
+    size_t content_byte_size;
+    TRTSERVER_Memory_Type memory_type;
+    const char* block = input_content.first->BufferAt(
+        input_content.second, &content_byte_size, &memory_type);
+    if (block == nullptr) {
+      break;
+    }
+
+    input_content.second++;
+    if (content_byte_size > 0) {
+      chunks->push_back(InputChunk{block, content_byte_size, memory_type});
+    }
+  }
+
+  return Status::Success;
+}
+
 Status
 InferRequestProvider::GetSystemMemory(
     const std::string& name, std::shared_ptr<SystemMemory>* input_buffer)
@@ -286,9 +459,6 @@ InferRequestProvider::GetSystemMemory(
 //
 // NULLInferRequestProvider
 //
-std::vector<uint8_t> NULLInferRequestProvider::buf_;
-std::mutex NULLInferRequestProvider::mu_;
-
 Status
 NULLInferRequestProvider::GetNextInputContent(
     const std::string& name, const void** content, size_t* content_byte_size,
@@ -300,19 +470,51 @@ NULLInferRequestProvider::GetNextInputContent(
     return Status::Success;
   }
 
-  if (!GetInputOverrideContent(name, content, content_byte_size)) {
-    std::lock_guard<std::mutex> lock(mu_);
-
+  if (!GetInputOverrideContent(
+          name, content, content_byte_size, memory_type)) {
     // Must return content with all zero data. This is required by
     // string-datatype tensors where it is interpreted as all empty
-    // strings. Clamp the maximum size that we allow the buffer to
-    // grow to avoid massive allocation.
-    if (buf_.size() < *content_byte_size) {
-      constexpr size_t max_size = 16 * 1024 * 1024;
-      buf_.resize(std::min(max_size, *content_byte_size), 0);
+    // strings. Content larger than the zero buffer is returned in
+    // chunks of it unless it must be contiguous.
+    size_t zeros_byte_size;
+    const char* zeros = zeros_->BufferAt(0, &zeros_byte_size, memory_type);
+    if (*content_byte_size <= zeros_byte_size) {
+      *content = zeros;
+    } else if (force_contiguous) {
+      contiguous_buffers_.emplace_back(*content_byte_size, 0);
+      *content = &(contiguous_buffers_.back()[0]);
+      *memory_type = TRTSERVER_MEMORY_CPU;
+    } else {
+      *content = zeros;
+      *content_byte_size = zeros_byte_size;
     }
+  }
+
+  return Status::Success;
+}
+
+Status
+NULLInferRequestProvider::GetInputChunks(
+    const std::string& name, size_t byte_size, std::vector<InputChunk>* chunks)
+{
+  if (byte_size == 0) {
+    return Status::Success;
+  }
+
+  if (GetInputOverrideChunks(name, chunks)) {
+    return Status::Success;
+  }
 
-    *content = &(buf_[0]);
+  // Deliver 'byte_size' bytes of zeros, reusing the zero buffer as
+  // many times as needed.
+  size_t zeros_byte_size;
+  TRTSERVER_Memory_Type zeros_memory_type;
+  const char* zeros =
+      zeros_->BufferAt(0, &zeros_byte_size, &zeros_memory_type);
+  for (size_t offset = 0; offset < byte_size; offset += zeros_byte_size) {
+    chunks->push_back(InputChunk{
+        zeros, std::min(zeros_byte_size, byte_size - offset),
+        zeros_memory_type});
   }
 
   return Status::Success;
@@ -320,6 +522,81 @@ NULLInferRequestProvider::GetNextInputContent(
 
 namespace {
 
+// Set 'idx' to the indices of the 'k' largest of the 'n' values in
+// 'probs', from largest to smallest with ties broken by the lower
+// index. Only a heap of the current top 'k' is maintained, so most
+// values are rejected by a single comparison against the smallest of
+// them instead of sorting all 'n' values.
+template <typename T>
+void
+TopK(const T* probs, const size_t n, const size_t k, std::vector<size_t>* idx)
+{
+  idx->resize(k);
+  if (k == 0) {
+    return;
+  }
+
+  const auto greater = [probs](size_t i1, size_t i2) {
+    return (probs[i1] > probs[i2]) || ((probs[i1] == probs[i2]) && (i1 < i2));
+  };
+
+  std::iota(idx->begin(), idx->end(), 0);
+  std::make_heap(idx->begin(), idx->end(), greater);
+
+  // Later indices lose ties, so only a strictly larger value can
+  // enter the heap.
+  T min_value = probs[idx->front()];
+  for (size_t i = k; i < n; ++i) {
+    if (probs[i] > min_value) {
+      std::pop_heap(idx->begin(), idx->end(), greater);
+      idx->back() = i;
+      std::push_heap(idx->begin(), idx->end(), greater);
+      min_value = probs[idx->front()];
+    }
+  }
+
+  std::sort_heap(idx->begin(), idx->end(), greater);
+}
+
+// Convert the 'cnt' values in 'src' to half precision in 'dst', which
+// need not be aligned.
+void
+ConvertToHalf(const float* src, const size_t cnt, char* dst)
+{
+  for (size_t i = 0; i < cnt; ++i) {
+    const uint16_t half = FloatToHalf(src[i]);
+    memcpy(dst + (i * sizeof(half)), &half, sizeof(half));
+  }
+}
+
+// Add the result for class 'idx' with 'value' to 'bcls', labeled
+// for output 'name'.
+void
+AddClassResult(
+    InferResponseHeader::Output::Classes* bcls, const std::string& name,
+    const size_t idx, const float value,
+    const std::shared_ptr<LabelProvider>& label_provider,
+    const InferResponseProvider::SecondaryLabelProviderMap& lookup_map)
+{
+  auto cls = bcls->add_cls();
+  cls->set_idx(idx);
+  const char* label;
+  size_t label_byte_size;
+  if (label_provider->GetLabel(name, idx, &label, &label_byte_size) &&
+      (label_byte_size > 0)) {
+    cls->set_label(label, label_byte_size);
+  } else if (!lookup_map.empty()) {
+    auto it = lookup_map.find(name);
+    if ((it != lookup_map.end()) &&
+        it->second.second->GetLabel(
+            it->second.first, idx, &label, &label_byte_size)) {
+      cls->set_label(label, label_byte_size);
+    }
+  }
+
+  cls->set_value(value);
+}
+
 template <typename T>
 void
 AddClassResults(
@@ -332,54 +609,66 @@ AddClassResults(
   T* probs = reinterpret_cast<T*>(poutput_buffer);
   const size_t entry_cnt = batch1_element_count;
   const size_t class_cnt = std::min(cls_count, entry_cnt);
-  std::vector<size_t> idx(entry_cnt);
+  std::vector<size_t> idx;
+  idx.reserve(class_cnt);
 
   for (size_t i = 0; i < batch_size; ++i) {
-    iota(idx.begin(), idx.end(), 0);
-    sort(idx.begin(), idx.end(), [&probs](size_t i1, size_t i2) {
-      return probs[i1] > probs[i2];
-    });
+    TopK(probs, entry_cnt, class_cnt, &idx);
 
     auto bcls = poutput->add_batch_classes();
     for (size_t k = 0; k < class_cnt; ++k) {
-      auto cls = bcls->add_cls();
-      cls->set_idx(idx[k]);
-      const auto& label = label_provider->GetLabel(poutput->name(), idx[k]);
-      cls->set_label(label);
-
-      if (label == "" && !lookup_map.empty()) {
-        auto it = lookup_map.find(poutput->name());
-        if (it != lookup_map.end()) {
-          cls->set_label(it->second.second->GetLabel(it->second.first, idx[k]));
-        }
-      }
-
-      cls->set_value(static_cast<float>(probs[idx[k]]));
+      AddClassResult(
+          bcls, poutput->name(), idx[k], static_cast<float>(probs[idx[k]]),
+          label_provider, lookup_map);
     }
 
     probs += entry_cnt;
   }
 }
 
+// Add the 'cls_count' results of each batch element that were
+// already selected into 'buffer', as the indices of all batch
+// elements followed by their values.
+void
+AddSelectedClassResults(
+    InferResponseHeader::Output* poutput, const char* buffer,
+    const size_t batch_size, const size_t cls_count,
+    const std::shared_ptr<LabelProvider>& label_provider,
+    const InferResponseProvider::SecondaryLabelProviderMap& lookup_map)
+{
+  const uint64_t* idx = reinterpret_cast<const uint64_t*>(buffer);
+  const float* values =
+      reinterpret_cast<const float*>(idx + (batch_size * cls_count));
+
+  for (size_t i = 0; i < batch_size; ++i) {
+    auto bcls = poutput->add_batch_classes();
+    for (size_t k = 0; k < cls_count; ++k) {
+      AddClassResult(
+          bcls, poutput->name(), *idx++, *values++, label_provider,
+          lookup_map);
+    }
+  }
+}
+
 }  // namespace
 
 //
 // InferResponseProvider
 //
 InferResponseProvider::InferResponseProvider(
-    const InferRequestHeader& request_header,
+    const std::shared_ptr<const InferRequestHeader>& request_header,
     const std::shared_ptr<LabelProvider>& label_provider,
     TRTSERVER_ResponseAllocator* allocator,
     TRTSERVER_ResponseAllocatorAllocFn_t alloc_fn, void* alloc_userp,
     TRTSERVER_ResponseAllocatorReleaseFn_t release_fn)
     : request_header_(request_header), label_provider_(label_provider),
       allocator_(allocator), alloc_fn_(alloc_fn), alloc_userp_(alloc_userp),
-      release_fn_(release_fn)
+      release_fn_(release_fn), batch_offset_(0)
 {
   // Create a map from output name to the InferRequestHeader::Output
   // object for that output.
-  for (const InferRequestHeader::Output& output : request_header.output()) {
-    output_map_.emplace(std::make_pair(output.name(), output));
+  for (const InferRequestHeader::Output& output : request_header->output()) {
+    output_map_.emplace(std::make_pair(output.name(), &output));
   }
 }
 
@@ -389,6 +678,32 @@ InferResponseProvider::RequiresOutput(const std::string& name)
   return output_map_.find(name) != output_map_.end();
 }
 
+bool
+InferResponseProvider::OutputShape(
+    const std::string& name, std::vector<int64_t>* shape) const
+{
+  for (auto itr = outputs_.rbegin(); itr != outputs_.rend(); ++itr) {
+    if (itr->name_ == name) {
+      *shape = itr->padded_shape_.empty() ? itr->shape_ : itr->padded_shape_;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void
+InferResponseProvider::AddImplicitOutput(const std::string& name)
+{
+  if (output_map_.find(name) == output_map_.end()) {
+    // An implicit output is never classified so it has the default
+    // output information.
+    output_map_.emplace(
+        std::make_pair(name, &InferRequestHeader::Output::default_instance()));
+    implicit_outputs_.insert(name);
+  }
+}
+
 Status
 InferResponseProvider::OutputBufferContents(
     const std::string& name, const void** content, size_t* content_byte_size,
@@ -408,6 +723,38 @@ InferResponseProvider::OutputBufferContents(
       "request for unallocated output '" + name + "'");
 }
 
+Status
+InferResponseProvider::OutputBufferMemory(
+    const std::string& name, std::shared_ptr<SystemMemory>* memory) const
+{
+  for (const auto& output : outputs_) {
+    if ((name == output.name_) && (output.memory_ != nullptr)) {
+      *memory = output.memory_;
+      return Status::Success;
+    }
+  }
+
+  return Status(
+      RequestStatusCode::UNAVAILABLE,
+      "request for unallocated implicit output '" + name + "'");
+}
+
+Status
+InferResponseProvider::OutputBufferShape(
+    const std::string& name, std::vector<int64_t>* shape) const
+{
+  for (const auto& output : outputs_) {
+    if (name == output.name_) {
+      *shape = output.shape_;
+      return Status::Success;
+    }
+  }
+
+  return Status(
+      RequestStatusCode::UNAVAILABLE,
+      "request for unallocated output '" + name + "'");
+}
+
 bool
 InferResponseProvider::GetSecondaryLabelProvider(
     const std::string& name, SecondaryLabelProvider* provider)
@@ -427,6 +774,13 @@ InferResponseProvider::SetSecondaryLabelProvider(
   secondary_label_provider_map_[name] = provider;
 }
 
+void
+InferResponseProvider::SetOutputTrim(
+    const std::string& name, const std::vector<int64_t>& shape)
+{
+  output_trims_[name] = shape;
+}
+
 Status
 InferResponseProvider::FinalizeResponse(const InferenceBackend& is)
 {
@@ -436,11 +790,16 @@ InferResponseProvider::FinalizeResponse(const InferenceBackend& is)
   response_header->set_model_name(is.Name());
   response_header->set_model_version(is.Version());
 
-  const size_t batch_size = request_header_.batch_size();
+  const size_t batch_size = request_header_->batch_size();
   response_header->set_batch_size(batch_size);
 
   int output_idx = 0;
   for (const auto& output : outputs_) {
+    // Implicit outputs are consumed by the server and not returned.
+    if (implicit_outputs_.find(output.name_) != implicit_outputs_.end()) {
+      continue;
+    }
+
     const ModelOutput* output_config;
     RETURN_IF_ERROR(is.GetOutput(output.name_, &output_config));
 
@@ -476,6 +835,20 @@ InferResponseProvider::FinalizeResponse(const InferenceBackend& is)
 
     if (output.cls_count_ == 0) {
       // Raw result...
+      if (!output.padded_shape_.empty()) {
+        CopyTensorRegion(
+            output.buffer_.get(), output.padded_shape_, output.buffer_.get(),
+            output.shape_, GetDataTypeByteSize(output_config->data_type()));
+      }
+      if (output.data_type_ == DataType::TYPE_FP16) {
+        ConvertToHalf(
+            reinterpret_cast<const float*>(output.buffer_.get()),
+            output.byte_size_ / sizeof(uint16_t),
+            static_cast<char*>(output.ptr_));
+      } else if (!output.padded_shape_.empty()) {
+        memcpy(output.ptr_, output.buffer_.get(), output.byte_size_);
+      }
+
       poutput->mutable_raw()->Clear();
       poutput->mutable_raw()->set_batch_byte_size(output.byte_size_);
 
@@ -503,6 +876,10 @@ InferResponseProvider::FinalizeResponse(const InferenceBackend& is)
       } else {
         poutput->mutable_raw()->mutable_dims()->CopyFrom(batch1_backend_shape);
       }
+    } else if (output.cls_selected_) {
+      AddSelectedClassResults(
+          poutput, output.buffer_.get(), batch_size, output.cls_count_,
+          label_provider_, secondary_label_provider_map_);
     } else {
       // Class result...
       switch (output_config->data_type()) {
@@ -586,7 +963,7 @@ InferResponseProvider::FinalizeResponse(const InferenceBackend& is)
 
 Status
 InferResponseProvider::Create(
-    const InferRequestHeader& request_header,
+    const std::shared_ptr<const InferRequestHeader>& request_header,
     const std::shared_ptr<LabelProvider>& label_provider,
     TRTSERVER_ResponseAllocator* allocator,
     TRTSERVER_ResponseAllocatorAllocFn_t alloc_fn, void* alloc_userp,
@@ -601,6 +978,104 @@ InferResponseProvider::Create(
   return Status::Success;
 }
 
+Status
+InferResponseProvider::CreateBatchSlice(
+    const std::shared_ptr<InferResponseProvider>& provider,
+    const std::shared_ptr<const InferRequestHeader>& request_header,
+    const size_t batch_offset, std::shared_ptr<InferResponseProvider>* slice)
+{
+  InferResponseProvider* slice_provider = new InferResponseProvider(
+      request_header, provider->label_provider_, nullptr /* allocator */,
+      BatchSliceAlloc, nullptr /* alloc_userp */, BatchSliceRelease);
+  slice_provider->alloc_userp_ = slice_provider;
+  slice_provider->batch_parent_ = provider;
+  slice_provider->batch_offset_ = batch_offset;
+  slice->reset(slice_provider);
+
+  return Status::Success;
+}
+
+TRTSERVER_Error*
+InferResponseProvider::BatchSliceAlloc(
+    TRTSERVER_ResponseAllocator* allocator, void** buffer, void** buffer_userp,
+    const char* tensor_name, size_t byte_size,
+    TRTSERVER_Memory_Type memory_type, int64_t region_id, void* userp)
+{
+  // The output being allocated is the last output of the slice.
+  InferResponseProvider* slice =
+      reinterpret_cast<InferResponseProvider*>(userp);
+  *buffer = nullptr;
+  *buffer_userp = nullptr;
+
+  Status status = slice->batch_parent_->AllocateBatchSliceBuffer(
+      tensor_name, slice->outputs_.back().shape_, byte_size,
+      slice->batch_offset_, memory_type, buffer);
+  if (!status.IsOk()) {
+    return TRTSERVER_ErrorNew(
+        RequestStatusToTrtServerCode(status.Code()), status.Message().c_str());
+  }
+
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+InferResponseProvider::BatchSliceRelease(
+    TRTSERVER_ResponseAllocator* allocator, void* buffer, void* buffer_userp,
+    size_t byte_size, TRTSERVER_Memory_Type memory_type, int64_t region_id)
+{
+  // The buffer is released by the provider the slice is a slice of.
+  return nullptr;  // Success
+}
+
+Status
+InferResponseProvider::AllocateBatchSliceBuffer(
+    const std::string& name, const std::vector<int64_t>& shape,
+    const size_t byte_size, const size_t batch_offset,
+    const TRTSERVER_Memory_Type memory_type, void** buffer)
+{
+  if (shape.empty() || (shape[0] <= 0)) {
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "output '" + name + "' of a batch slice must have a batch dimension");
+  }
+
+  const size_t element_byte_size = byte_size / shape[0];
+
+  std::lock_guard<std::mutex> lock(batch_slice_mu_);
+  auto itr = batch_slice_outputs_.find(name);
+  if (itr == batch_slice_outputs_.end()) {
+    std::vector<int64_t> batch_shape(shape);
+    batch_shape[0] = request_header_->batch_size();
+
+    void* content;
+    RETURN_IF_ERROR(AllocateOutputBuffer(
+        name, &content, element_byte_size * request_header_->batch_size(),
+        batch_shape, memory_type));
+    if ((content == nullptr) && (byte_size != 0)) {
+      return Status::Success;
+    }
+
+    itr = batch_slice_outputs_
+              .emplace(
+                  name, BatchSliceOutput{static_cast<char*>(content),
+                                         element_byte_size, memory_type})
+              .first;
+  }
+
+  if (itr->second.element_byte_size_ != element_byte_size) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "output '" + name + "' has a different shape in each batch slice");
+  }
+
+  if ((itr->second.memory_type_ == memory_type) &&
+      (itr->second.base_ != nullptr)) {
+    *buffer = itr->second.base_ + (element_byte_size * batch_offset);
+  }
+
+  return Status::Success;
+}
+
 InferResponseProvider::~InferResponseProvider()
 {
   for (const auto& output : outputs_) {
@@ -652,9 +1127,13 @@ InferResponseProvider::AllocateOutputBuffer(
   loutput->name_ = name;
   loutput->shape_ = content_shape;
   loutput->cls_count_ = 0;
+  loutput->cls_selected_ = false;
+  loutput->data_type_ = DataType::TYPE_INVALID;
+  loutput->padded_shape_.clear();
   loutput->ptr_ = nullptr;
   loutput->byte_size_ = content_byte_size;
   loutput->memory_type_ = preferred_memory_type;
+  loutput->memory_.reset();
 
   // For cls result, the provider will be responsible for allocating
   // the requested memory. The user-provided allocator should only be invoked
@@ -662,7 +1141,7 @@ InferResponseProvider::AllocateOutputBuffer(
   // For cls result, the preferred memory type must be CPU. Otherwise,
   // return success and nullptr to align with the behavior of
   // 'TRTSERVER_ResponseAllocatorAllocFn_t'
-  if (pr->second.has_cls()) {
+  if (pr->second->has_cls()) {
     if (content_byte_size == 0) {
       Status(
           RequestStatusCode::INVALID_ARG,
@@ -670,21 +1149,94 @@ InferResponseProvider::AllocateOutputBuffer(
               " while its output buffer size is 0");
     }
     if (preferred_memory_type == TRTSERVER_MEMORY_CPU) {
-      loutput->cls_count_ = pr->second.cls().count();
-      char* buffer = new char[content_byte_size];
+      loutput->cls_count_ = pr->second->cls().count();
+      char* buffer = loutput->buffer_.Reset(content_byte_size);
       *content = static_cast<void*>(buffer);
       loutput->ptr_ = static_cast<void*>(buffer);
-      loutput->buffer_.reset(buffer);
     } else {
+      outputs_.pop_back();
       return Status::Success;
     }
   }
 
+  // An output requested in another datatype, which is always TYPE_FP16
+  // for a TYPE_FP32 output, or trimmed to the request's size of a
+  // padded input is written to a buffer of the provider in CPU memory
+  // and converted or trimmed into the buffer from 'alloc_fn_' when the
+  // response is finalized. As for cls result, return success and
+  // nullptr for another preferred memory type. Classification is
+  // over the untrimmed output.
+  const auto trim = pr->second->has_cls() ? output_trims_.end()
+                                          : output_trims_.find(name);
+  const bool copied = (pr->second->data_type() != DataType::TYPE_INVALID) ||
+                      (trim != output_trims_.end());
+  if (copied) {
+    if (preferred_memory_type != TRTSERVER_MEMORY_CPU) {
+      outputs_.pop_back();
+      return Status::Success;
+    }
+    if (trim != output_trims_.end()) {
+      bool trimmable = (trim->second.size() == content_shape.size());
+      for (size_t i = 0; trimmable && (i < content_shape.size()); ++i) {
+        trimmable = (trim->second[i] <= content_shape[i]);
+      }
+      if (!trimmable) {
+        outputs_.pop_back();
+        return Status(
+            RequestStatusCode::INVALID_ARG,
+            "output '" + name + "' with shape " +
+                DimsListToString(content_shape) +
+                " can't be trimmed to shape " +
+                DimsListToString(trim->second));
+      }
+      const int64_t element_cnt = GetElementCount(content_shape);
+      loutput->padded_shape_ = content_shape;
+      loutput->shape_ = trim->second;
+      loutput->byte_size_ = (element_cnt <= 0)
+                                ? 0
+                                : content_byte_size / element_cnt *
+                                      GetElementCount(trim->second);
+    }
+    if (pr->second->data_type() != DataType::TYPE_INVALID) {
+      loutput->data_type_ = pr->second->data_type();
+      loutput->byte_size_ = loutput->byte_size_ /
+                            GetDataTypeByteSize(DataType::TYPE_FP32) *
+                            GetDataTypeByteSize(loutput->data_type_);
+    }
+    char* buffer = loutput->buffer_.Reset(content_byte_size);
+    *content = static_cast<void*>(buffer);
+  }
 
   // If a buffer has been allocated for cls result, then no
   // additional buffer is needed from alloc_fn, but still need to call the
   // alloc_fn_ with byte-size == 0 since that is what the API requires.
-  const size_t alloc_byte_size = (*content != nullptr) ? 0 : content_byte_size;
+  // A converted or trimmed output needs a buffer for its final contents.
+  const size_t alloc_byte_size =
+      copied ? loutput->byte_size_
+             : ((*content != nullptr) ? 0 : content_byte_size);
+
+  // An implicit output is never seen by the client so the provider
+  // owns its buffer, which can be shared with whoever consumes the
+  // output. As with 'alloc_fn_', return nullptr if the buffer can't
+  // be allocated in the preferred memory type.
+  if (implicit_outputs_.find(name) != implicit_outputs_.end()) {
+    if ((*content == nullptr) && (content_byte_size != 0)) {
+      auto memory = std::make_shared<AllocatedSystemMemory>(
+          content_byte_size, preferred_memory_type);
+      char* buffer = memory->MutableBuffer(&loutput->memory_type_);
+      if (buffer != nullptr) {
+        *content = static_cast<void*>(buffer);
+        loutput->ptr_ = static_cast<void*>(buffer);
+        loutput->memory_ = std::move(memory);
+      }
+    }
+    loutput->release_buffer_ = nullptr;
+    loutput->release_userp_ = nullptr;
+    if ((*content == nullptr) && (content_byte_size != 0)) {
+      outputs_.pop_back();
+    }
+    return Status::Success;
+  }
 
   void* buffer = nullptr;
   void* buffer_userp = nullptr;
@@ -703,11 +1255,98 @@ InferResponseProvider::AllocateOutputBuffer(
   if (*content == nullptr) {
     *content = buffer;
     loutput->ptr_ = buffer;
+  } else if (copied) {
+    loutput->ptr_ = buffer;
+    if ((buffer == nullptr) && (alloc_byte_size != 0)) {
+      outputs_.pop_back();
+      *content = nullptr;
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "output '" + name + "' that is converted or trimmed must be " +
+              "returned in CPU memory");
+    }
   }
 
   loutput->release_buffer_ = buffer;
   loutput->release_userp_ = buffer_userp;
 
+  // Don't keep an output that couldn't be allocated in the preferred
+  // memory type. A later call for the output in another memory type
+  // appends it again, so 'outputs_' stays in the order in which the
+  // output buffers were successfully allocated even when an output is
+  // attempted out of order.
+  if ((*content == nullptr) && (content_byte_size != 0)) {
+    outputs_.pop_back();
+  }
+
+  return Status::Success;
+}
+
+size_t
+InferResponseProvider::ClassificationCount(const std::string& name) const
+{
+  const auto& pr = output_map_.find(name);
+  if ((pr == output_map_.end()) || !pr->second->has_cls()) {
+    return 0;
+  }
+
+  return pr->second->cls().count();
+}
+
+Status
+InferResponseProvider::AllocateClassificationBuffer(
+    const std::string& name, const std::vector<int64_t>& content_shape,
+    const size_t cls_count, uint64_t** idx, float** values)
+{
+  *idx = nullptr;
+  *values = nullptr;
+
+  if (ClassificationCount(name) == 0) {
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "unexpected classification output '" + name + "'");
+  }
+
+  const size_t entry_cnt = request_header_->batch_size() * cls_count;
+  const size_t byte_size = entry_cnt * (sizeof(uint64_t) + sizeof(float));
+
+  outputs_.emplace_back();
+  Output* loutput = &(outputs_.back());
+  loutput->name_ = name;
+  loutput->shape_ = content_shape;
+  loutput->cls_count_ = cls_count;
+  loutput->cls_selected_ = true;
+  loutput->data_type_ = DataType::TYPE_INVALID;
+  loutput->byte_size_ = byte_size;
+  loutput->memory_type_ = TRTSERVER_MEMORY_CPU;
+
+  char* buffer = loutput->buffer_.Reset(byte_size);
+  loutput->ptr_ = static_cast<void*>(buffer);
+  *idx = reinterpret_cast<uint64_t*>(buffer);
+  *values = reinterpret_cast<float*>(*idx + entry_cnt);
+
+  // As for other classification outputs the allocator is only called
+  // with byte size 0, since that is what the API requires.
+  void* release_buffer = nullptr;
+  void* release_userp = nullptr;
+  TRTSERVER_Error* err = alloc_fn_(
+      allocator_, &release_buffer, &release_userp, name.c_str(),
+      0 /* byte_size */, TRTSERVER_MEMORY_CPU, 0 /* region_id */,
+      alloc_userp_);
+  if (err != nullptr) {
+    Status status = Status(
+        TrtServerCodeToRequestStatus(TRTSERVER_ErrorCode(err)),
+        TRTSERVER_ErrorMessage(err));
+    TRTSERVER_ErrorDelete(err);
+    outputs_.pop_back();
+    *idx = nullptr;
+    *values = nullptr;
+    return status;
+  }
+
+  loutput->release_buffer_ = release_buffer;
+  loutput->release_userp_ = release_userp;
+
   return Status::Success;
 }
 
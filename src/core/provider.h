@@ -26,9 +26,12 @@
 #pragma once
 
 #include <event2/buffer.h>
+#include <functional>
+#include <mutex>
 #include "src/core/api.pb.h"
 #include "src/core/grpc_service.pb.h"
 #include "src/core/model_config.h"
+#include "src/core/response_buffer_pool.h"
 #include "src/core/status.h"
 #include "src/core/trtserver.h"
 
@@ -36,6 +39,7 @@ namespace nvidia { namespace inferenceserver {
 
 class InferenceBackend;
 class LabelProvider;
+class SequenceBinding;
 
 //
 // SystemMemory used to access data in providers
@@ -85,6 +89,9 @@ class SystemMemoryReference : public SystemMemory {
 class AllocatedSystemMemory : public SystemMemory {
  public:
   // Create a continuous data buffer with 'byte_size' and 'memory_type'.
+  // A CPU buffer is allocated from the pinned memory pool when
+  // possible and a GPU buffer is allocated on the current device from
+  // the cached GPU memory.
   AllocatedSystemMemory(size_t byte_size, TRTSERVER_Memory_Type memory_type);
 
   ~AllocatedSystemMemory();
@@ -109,14 +116,28 @@ class AllocatedSystemMemory : public SystemMemory {
 class InferRequestProvider {
  public:
   // Initialize based on map from input name to data. The 'input_buffer' object
-  // is mapping from input name to data buffer for that input.
+  // is mapping from input name to data buffer for that input. The
+  // normalized 'request_header' is shared, not copied, and must not be
+  // modified once the provider is created.
   static Status Create(
       const std::string& model_name, const int64_t model_version,
-      const InferRequestHeader& request_header,
+      const std::shared_ptr<const InferRequestHeader>& request_header,
       const std::unordered_map<std::string, std::shared_ptr<SystemMemory>>&
           input_buffer,
       std::shared_ptr<InferRequestProvider>* provider);
 
+  // Create a provider for the 'batch_size' batch elements of the
+  // request of 'provider' that start at batch element
+  // 'batch_offset'. The inputs of the slice reference the input data
+  // of 'provider' instead of copying it. The slice requests each
+  // output as the model produces it, any classification or datatype
+  // conversion is left to the response to 'provider', see
+  // InferResponseProvider::CreateBatchSlice().
+  static Status CreateBatchSlice(
+      const std::shared_ptr<InferRequestProvider>& provider,
+      const size_t batch_offset, const size_t batch_size,
+      std::shared_ptr<InferRequestProvider>* slice);
+
   // Return the requested model name.
   const std::string& ModelName() const { return model_name_; }
 
@@ -127,7 +148,14 @@ class InferRequestProvider {
   // Get the request header for this inference request that has been
   // validated and normalized so that all inputs have shape and
   // batch-byte-size defined.
-  const InferRequestHeader& RequestHeader() const { return request_header_; }
+  const InferRequestHeader& RequestHeader() const { return *request_header_; }
+
+  // Get shared ownership of the request header, so that other
+  // providers for the same request can reference it without copying.
+  const std::shared_ptr<const InferRequestHeader>& SharedRequestHeader() const
+  {
+    return request_header_;
+  }
 
   // Get the next contiguous chunk of bytes for the 'name'd
   // input. Return a pointer to the chunk in 'content'.
@@ -150,14 +178,35 @@ class InferRequestProvider {
       const std::string& name, const void** content, size_t* content_byte_size,
       TRTSERVER_Memory_Type* memory_type, bool force_contiguous);
 
+  // A chunk of the content of an input.
+  struct InputChunk {
+    const void* content_;
+    size_t byte_size_;
+    TRTSERVER_Memory_Type memory_type_;
+  };
+
+  // Append to 'chunks', in order, all the remaining chunks of bytes
+  // for the 'name'd input without copying them, so that the caller can
+  // gather them directly into its destination. 'byte_size' is the
+  // number of bytes expected for the input and no chunks are returned
+  // if it is zero. The returned chunks are consumed, as if they had
+  // been returned by GetNextInputContent().
+  virtual Status GetInputChunks(
+      const std::string& name, size_t byte_size,
+      std::vector<InputChunk>* chunks);
+
   // Retrieve the data buffer of input 'name'.
   Status GetSystemMemory(
       const std::string& name, std::shared_ptr<SystemMemory>* input_buffer);
 
   // Set content for named inputs. If the input already has content,
-  // this content will be in-place of existing content.
+  // this content will be in-place of existing content. The content
+  // is held in 'content_' unless 'memory_' is set, in which case the
+  // content is referenced from 'memory_', which may be in GPU memory
+  // and is shared with its producer instead of copied.
   struct InputOverride {
     std::vector<uint8_t> content_;
+    std::shared_ptr<SystemMemory> memory_;
     DimsList dims_;
     DataType datatype_;
   };
@@ -167,6 +216,59 @@ class InferRequestProvider {
   const std::shared_ptr<InputOverrideMap>& GetInputOverride() const;
   Status SetInputOverride(const std::shared_ptr<InputOverrideMap>& override);
 
+  // Require the backend to produce the 'name'd output for this
+  // request even if the request did not ask for it. Used by
+  // schedulers that consume outputs themselves, see
+  // InferResponseProvider::AddImplicitOutput(). The request header
+  // is copied the first time an output is added, so that the shared
+  // header is not modified.
+  void AddImplicitOutput(const std::string& name);
+
+  // Function that returns true if the request has been cancelled, for
+  // example because the client that sent it has disconnected. It is
+  // called by the schedulers while holding their locks and so must be
+  // cheap, and it may be called from any thread until the request
+  // completes.
+  using CancelledFunc = std::function<bool()>;
+  const CancelledFunc& CancelledFunction() const { return cancelled_fn_; }
+  void SetCancelledFunction(const CancelledFunc& fn) { cancelled_fn_ = fn; }
+
+  // Return true if the request has been cancelled. A cancelled
+  // request that has not started executing should not be executed.
+  bool IsCancelled() const
+  {
+    return (cancelled_fn_ != nullptr) && cancelled_fn_();
+  }
+
+  // Function that is called with the contents of a requested output
+  // as soon as the output is complete, before the request itself
+  // completes. 'dims' is the shape of the output, not including the
+  // batch dimension, and the contents are only valid during the
+  // call. Only ensembles report outputs early.
+  using OutputReadyFunc = std::function<void(
+      const std::string& name, const std::vector<int64_t>& dims,
+      const void* content, size_t content_byte_size,
+      TRTSERVER_Memory_Type memory_type)>;
+  const OutputReadyFunc& OutputReadyFunction() const
+  {
+    return output_ready_fn_;
+  }
+  void SetOutputReadyFunction(const OutputReadyFunc& fn)
+  {
+    output_ready_fn_ = fn;
+  }
+
+  // The sequence binding of the stream that sent the request, if any,
+  // used by the sequence batcher to route the request.
+  const std::shared_ptr<SequenceBinding>& GetSequenceBinding() const
+  {
+    return sequence_binding_;
+  }
+  void SetSequenceBinding(const std::shared_ptr<SequenceBinding>& binding)
+  {
+    sequence_binding_ = binding;
+  }
+
  protected:
   explicit InferRequestProvider(
       const std::string& model_name, const int64_t version)
@@ -174,32 +276,49 @@ class InferRequestProvider {
   {
   }
 
-  // Get the override content for 'name'd input. Return a pointer to
-  // the override content in 'content'.  Return the override content
-  // byte-size in 'content_byte_size'.  Return true if there is
-  // override content (and so 'content' and 'content_byte_size' are
-  // valid) or false if there is no override content (and so 'content'
-  // and 'content_byte_size' are unchanged).
+  // Get the next chunk of override content for 'name'd input. Return
+  // a pointer to the chunk in 'content'.  Return the chunk byte-size
+  // in 'content_byte_size' and its memory type in 'memory_type'.
+  // Return true if there is override content (and so 'content',
+  // 'content_byte_size' and 'memory_type' are valid) or false if
+  // there is no override content (and so they are unchanged).
   bool GetInputOverrideContent(
-      const std::string& name, const void** content, size_t* content_byte_size);
+      const std::string& name, const void** content, size_t* content_byte_size,
+      TRTSERVER_Memory_Type* memory_type);
+
+  // Append the remaining chunks of override content for 'name'd input
+  // to 'chunks'. Return true if there is override content or false if
+  // there is no override content (and so 'chunks' is unchanged).
+  bool GetInputOverrideChunks(
+      const std::string& name, std::vector<InputChunk>* chunks);
 
   const std::string model_name_;
   const int64_t version_;
-  InferRequestHeader request_header_;
+  std::shared_ptr<const InferRequestHeader> request_header_;
 
   // Input content overrides.
   std::shared_ptr<InputOverrideMap> overrides_;
 
-  // The inputs that have had their override content consumed by a
-  // call to GetInputOverrideContent. A given input override will only
-  // return the content once and on subsequent calls will return
-  // 'content' == nullptr to indicate that all the override content
-  // has been consumed.
-  std::set<std::string> overrides_consumed_;
+  // The index of the next chunk of override content to return for
+  // each input that has had content consumed by a call to
+  // GetInputOverrideContent. Once all the chunks of an input override
+  // are returned, subsequent calls return 'content' == nullptr to
+  // indicate that all the override content has been consumed.
+  std::unordered_map<std::string, size_t> overrides_next_chunk_;
 
   // Placeholder for providing buffer as contiguous block.
   std::vector<std::vector<char>> contiguous_buffers_;
 
+  // The function checking whether the request has been cancelled, if
+  // any.
+  CancelledFunc cancelled_fn_;
+
+  // The function reporting outputs that complete early, if any.
+  OutputReadyFunc output_ready_fn_;
+
+  // The sequence binding of the request, if any.
+  std::shared_ptr<SequenceBinding> sequence_binding_;
+
   // Map from input name to the content of the input. The content contains
   // the buffer and index to the next data block for the named input.
   std::unordered_map<
@@ -215,8 +334,14 @@ class InferRequestProvider {
 //
 class NULLInferRequestProvider : public InferRequestProvider {
  public:
-  explicit NULLInferRequestProvider(const InferRequestHeader& request_header)
-      : InferRequestProvider("<NULL>", -1)
+  // The all-zero 'zeros' buffer is shared, read-only, by all the
+  // NULL providers of a model so no locking is needed to deliver the
+  // NULL input. An input larger than 'zeros' is delivered as
+  // repeated chunks of it.
+  NULLInferRequestProvider(
+      const std::shared_ptr<const InferRequestHeader>& request_header,
+      const std::shared_ptr<const AllocatedSystemMemory>& zeros)
+      : InferRequestProvider("<NULL>", -1), zeros_(zeros)
   {
     request_header_ = request_header;
   }
@@ -225,12 +350,12 @@ class NULLInferRequestProvider : public InferRequestProvider {
       const std::string& name, const void** content, size_t* content_byte_size,
       TRTSERVER_Memory_Type* memory_type, bool force_contiguous) override;
 
- private:
-  // A buffer of zero bytes that is used commonly as the NULL input.
-  static std::vector<uint8_t> buf_;
+  Status GetInputChunks(
+      const std::string& name, size_t byte_size,
+      std::vector<InputChunk>* chunks) override;
 
-  // Mutex to guard buf_
-  static std::mutex mu_;
+ private:
+  const std::shared_ptr<const AllocatedSystemMemory> zeros_;
 };
 
 //
@@ -244,14 +369,29 @@ class InferResponseProvider {
   using SecondaryLabelProviderMap =
       std::unordered_map<std::string, SecondaryLabelProvider>;
 
+  // The normalized 'request_header' is shared, not copied, and must
+  // not be modified once the provider is created.
   static Status Create(
-      const InferRequestHeader& request_header,
+      const std::shared_ptr<const InferRequestHeader>& request_header,
       const std::shared_ptr<LabelProvider>& label_provider,
       TRTSERVER_ResponseAllocator* allocator,
       TRTSERVER_ResponseAllocatorAllocFn_t alloc_fn, void* alloc_userp,
       TRTSERVER_ResponseAllocatorReleaseFn_t release_fn,
       std::shared_ptr<InferResponseProvider>* infer_provider);
 
+  // Create a provider for the response to 'request_header', the
+  // request of a batch slice that starts at batch element
+  // 'batch_offset' of the request of 'provider'. The slice writes each
+  // output directly to its batch elements in the output buffer of
+  // 'provider', which is allocated for the full batch the first time
+  // any slice allocates the output, so the slices' outputs are not
+  // copied. The response to 'provider' must be finalized once all its
+  // slices are finalized.
+  static Status CreateBatchSlice(
+      const std::shared_ptr<InferResponseProvider>& provider,
+      const std::shared_ptr<const InferRequestHeader>& request_header,
+      const size_t batch_offset, std::shared_ptr<InferResponseProvider>* slice);
+
   ~InferResponseProvider();
 
   // Get the full response header for this inference request.
@@ -263,20 +403,62 @@ class InferResponseProvider {
   // Return true if this provider requires a named output.
   bool RequiresOutput(const std::string& name);
 
+  // Return in 'shape' the shape of the contents of the 'name'd output
+  // as given to the last AllocateOutputBuffer() call for it, which
+  // can be queried from within the allocator function. Return false if
+  // no buffer has been allocated for the output.
+  bool OutputShape(const std::string& name, std::vector<int64_t>* shape) const;
+
+  // Make this provider require the 'name'd output even if the request
+  // did not ask for it. If the request did not ask for the output its
+  // buffer is allocated by the provider itself, in the preferred
+  // memory type when possible, and it is not included in the
+  // response.
+  void AddImplicitOutput(const std::string& name);
+
   // Get a buffer to store results for a named output. Must be called
   // exactly once for each output that is being returned for the
-  // request. The output must be listed in the request header.
+  // request, except that a call that returns 'content' == nullptr
+  // because the buffer can't be allocated in the preferred memory
+  // type may be followed by another call for the same output. The
+  // output must be listed in the request header.
   Status AllocateOutputBuffer(
       const std::string& name, void** content, size_t content_byte_size,
       const std::vector<int64_t>& content_shape,
       const TRTSERVER_Memory_Type preferred_memory_type = TRTSERVER_MEMORY_CPU);
 
+  // Return the classification count requested for the 'name'd
+  // output, or 0 if the output is not requested as a classification.
+  size_t ClassificationCount(const std::string& name) const;
+
+  // Get the host buffers for the classification results of the
+  // 'name'd output when they are selected by the backend, for example
+  // on the GPU, instead of calling AllocateOutputBuffer() for the
+  // full output. The caller must write the 'cls_count' indices and
+  // values of each batch element to 'idx' and 'values', ordered from
+  // the largest value, before the response is finalized.
+  Status AllocateClassificationBuffer(
+      const std::string& name, const std::vector<int64_t>& content_shape,
+      const size_t cls_count, uint64_t** idx, float** values);
+
   // Get the address and byte-size of an output buffer. Error is
   // returned if the buffer is not already allocated.
   Status OutputBufferContents(
       const std::string& name, const void** content, size_t* content_byte_size,
       TRTSERVER_Memory_Type* memory_type) const;
 
+  // Get shared ownership of the buffer of an implicit output that was
+  // not requested, so that its contents can be used after this
+  // provider is destroyed without copying them. Error is returned if
+  // the buffer is not allocated or is not owned by the provider.
+  Status OutputBufferMemory(
+      const std::string& name, std::shared_ptr<SystemMemory>* memory) const;
+
+  // Get the shape of an output buffer. Error is returned if the
+  // buffer is not already allocated.
+  Status OutputBufferShape(
+      const std::string& name, std::vector<int64_t>* shape) const;
+
   // Get label provider.
   const std::shared_ptr<LabelProvider>& GetLabelProvider() const
   {
@@ -292,34 +474,85 @@ class InferResponseProvider {
   void SetSecondaryLabelProvider(
       const std::string& name, const SecondaryLabelProvider& provider);
 
+  // Set the shape, including the batch dimension, that output 'name'
+  // is trimmed to when the response is finalized. The backend writes
+  // the output, padded along with an input, to a buffer of the
+  // provider.
+  void SetOutputTrim(
+      const std::string& name, const std::vector<int64_t>& shape);
+
   // Finalize response based on a backend.
   Status FinalizeResponse(const InferenceBackend& is);
 
  private:
   InferResponseProvider(
-      const InferRequestHeader& request_header,
+      const std::shared_ptr<const InferRequestHeader>& request_header,
       const std::shared_ptr<LabelProvider>& label_provider,
       TRTSERVER_ResponseAllocator* allocator,
       TRTSERVER_ResponseAllocatorAllocFn_t alloc_fn, void* alloc_userp,
       TRTSERVER_ResponseAllocatorReleaseFn_t release_fn);
 
-  InferRequestHeader request_header_;
+  // The allocator functions of a batch slice, which allocate the
+  // output buffers of the slice from the provider it is a slice of.
+  static TRTSERVER_Error* BatchSliceAlloc(
+      TRTSERVER_ResponseAllocator* allocator, void** buffer,
+      void** buffer_userp, const char* tensor_name, size_t byte_size,
+      TRTSERVER_Memory_Type memory_type, int64_t region_id, void* userp);
+  static TRTSERVER_Error* BatchSliceRelease(
+      TRTSERVER_ResponseAllocator* allocator, void* buffer, void* buffer_userp,
+      size_t byte_size, TRTSERVER_Memory_Type memory_type, int64_t region_id);
+
+  // Return in 'buffer' the part of the 'name'd output buffer for the
+  // batch elements of a slice that starts at 'batch_offset', whose
+  // output has 'shape' and 'byte_size'. The output buffer is allocated
+  // for the full batch by the first slice. Return 'buffer' == nullptr
+  // if the buffer isn't in 'memory_type'.
+  Status AllocateBatchSliceBuffer(
+      const std::string& name, const std::vector<int64_t>& shape,
+      const size_t byte_size, const size_t batch_offset,
+      const TRTSERVER_Memory_Type memory_type, void** buffer);
+
+  std::shared_ptr<const InferRequestHeader> request_header_;
 
   // Map from output name to the InferRequestHeader output information
-  // for that output.
-  std::unordered_map<std::string, const InferRequestHeader::Output> output_map_;
+  // for that output, which is held by 'request_header_'.
+  std::unordered_map<std::string, const InferRequestHeader::Output*>
+      output_map_;
+
+  // The outputs required by AddImplicitOutput() that were not
+  // requested.
+  std::set<std::string> implicit_outputs_;
 
   // Information about each output.
   struct Output {
     std::string name_;
     std::vector<int64_t> shape_;
     size_t cls_count_;
+
+    // True if 'buffer_' holds classification results that were
+    // selected by the backend instead of the output contents.
+    bool cls_selected_;
+
+    // The datatype that the output contents, written by the backend to
+    // 'buffer_', are converted to in 'ptr_' when the response is
+    // finalized, or TYPE_INVALID if the output is not converted.
+    DataType data_type_;
+
+    // The shape of the output contents written by the backend to
+    // 'buffer_' when the output is trimmed to 'shape_' in 'ptr_', or
+    // empty if the output is not trimmed.
+    std::vector<int64_t> padded_shape_;
+
     void* ptr_;
     size_t byte_size_;
     TRTSERVER_Memory_Type memory_type_;
 
-    // Created buffer for non-RAW results
-    std::unique_ptr<char[]> buffer_;
+    // Created buffer for non-RAW results, recycled through the
+    // response buffer pool.
+    ResponseBufferPool::Buffer buffer_;
+
+    // Created buffer for implicit outputs
+    std::shared_ptr<AllocatedSystemMemory> memory_;
 
     void* release_buffer_;
     void* release_userp_;
@@ -336,12 +569,32 @@ class InferResponseProvider {
   // that doesn't provide labels directly, i.e. ensemble models.
   SecondaryLabelProviderMap secondary_label_provider_map_;
 
+  // Map from output name to the shape the output is trimmed to.
+  std::unordered_map<std::string, std::vector<int64_t>> output_trims_;
+
   TRTSERVER_ResponseAllocator* allocator_;
   TRTSERVER_ResponseAllocatorAllocFn_t alloc_fn_;
   void* alloc_userp_;
   TRTSERVER_ResponseAllocatorReleaseFn_t release_fn_;
 
   InferResponseHeader response_header_;
+
+  // For a batch slice the provider it is a slice of and the batch
+  // element the slice starts at.
+  std::shared_ptr<InferResponseProvider> batch_parent_;
+  size_t batch_offset_;
+
+  // For a provider with batch slices the start, byte size per batch
+  // element and memory type of each output buffer allocated by the
+  // slices.
+  struct BatchSliceOutput {
+    char* base_;
+    size_t element_byte_size_;
+    TRTSERVER_Memory_Type memory_type_;
+  };
+
+  std::mutex batch_slice_mu_;
+  std::unordered_map<std::string, BatchSliceOutput> batch_slice_outputs_;
 };
 
 }}  // namespace nvidia::inferenceserver
@@ -27,6 +27,8 @@
 #include "src/core/provider_utils.h"
 
 #include <google/protobuf/text_format.h>
+#include <algorithm>
+#include <cstring>
 #include <deque>
 #include "src/core/backend.h"
 #include "src/core/constants.h"
@@ -36,6 +38,128 @@
 
 namespace nvidia { namespace inferenceserver {
 
+namespace {
+
+// Convert the 'cnt' values of type T in 'src', which need not be
+// aligned, to 'value * scale + offset' in 'dst'.
+template <typename T>
+void
+ConvertToFloat(
+    const char* src, const size_t cnt, const float scale, const float offset,
+    float* dst)
+{
+  for (size_t i = 0; i < cnt; ++i) {
+    T value;
+    memcpy(&value, src + (i * sizeof(T)), sizeof(T));
+    dst[i] = static_cast<float>(value) * scale + offset;
+  }
+}
+
+// Like ConvertToFloat() for half-precision values.
+void
+ConvertHalfToFloat(
+    const char* src, const size_t cnt, const float scale, const float offset,
+    float* dst)
+{
+  for (size_t i = 0; i < cnt; ++i) {
+    uint16_t half;
+    memcpy(&half, src + (i * sizeof(half)), sizeof(half));
+    dst[i] = HalfToFloat(half) * scale + offset;
+  }
+}
+
+// Return in 'src' the 'byte_size' bytes of input 'name' held in
+// 'memory', which must be in CPU memory to be 'action'. The input may
+// be split into chunks at any byte, so it is gathered into 'gathered'
+// unless it is a single chunk.
+Status
+GatherRequestInput(
+    const InferenceBackend& is, const std::string& name,
+    const SystemMemory& memory, const uint64_t byte_size,
+    const std::string& action, std::vector<char>* gathered, const char** src)
+{
+  *src = nullptr;
+  size_t idx = 0;
+  size_t chunk_byte_size;
+  TRTSERVER_Memory_Type memory_type;
+  const char* chunk = memory.BufferAt(idx, &chunk_byte_size, &memory_type);
+  while (chunk != nullptr) {
+    if (memory_type != TRTSERVER_MEMORY_CPU) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "input '" + name + "' for model '" + is.Name() +
+              "' must be in CPU memory to be " + action);
+    }
+    if (chunk_byte_size == byte_size) {
+      *src = chunk;
+    } else {
+      gathered->insert(gathered->end(), chunk, chunk + chunk_byte_size);
+    }
+    chunk = memory.BufferAt(++idx, &chunk_byte_size, &memory_type);
+  }
+  if (*src == nullptr) {
+    *src = gathered->data();
+  }
+
+  return Status::Success;
+}
+
+// Return in 'padded' the dims of 'io' with each variable-size
+// dimension padded to its bucket in 'input_config'. Return true if
+// any dimension is padded.
+bool
+PaddedInputDims(
+    const ModelInput& input_config, const InferRequestHeader::Input& io,
+    DimsList* padded)
+{
+  bool is_padded = false;
+  padded->CopyFrom(io.dims());
+  for (int i = 0; i < padded->size(); ++i) {
+    if ((i >= input_config.dims_size()) || (input_config.dims(i) != -1)) {
+      continue;
+    }
+    for (const auto bucket_size : input_config.padding().bucket_size()) {
+      if (bucket_size >= padded->Get(i)) {
+        is_padded |= (bucket_size != padded->Get(i));
+        padded->Set(i, bucket_size);
+        break;
+      }
+    }
+  }
+
+  return is_padded;
+}
+
+// Return true if a request for a model with 'config' whose batch-size
+// exceeds the model's maximum batch-size can be split into smaller
+// requests. The requests of a sequence must be executed in order, and
+// an ensemble sets the labels of its outputs on the response provider
+// of the request, so neither is split. A string tensor doesn't have
+// the same byte size for each batch element so can't be split.
+bool
+IsBatchSplittable(const ModelConfig& config)
+{
+  if ((config.max_batch_size() <= 0) || config.has_sequence_batching() ||
+      (config.platform() == kEnsemblePlatform)) {
+    return false;
+  }
+
+  for (const auto& io : config.input()) {
+    if (io.data_type() == DataType::TYPE_STRING) {
+      return false;
+    }
+  }
+  for (const auto& io : config.output()) {
+    if (io.data_type() == DataType::TYPE_STRING) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace
+
 Status
 NormalizeRequestHeader(
     const InferenceBackend& is, InferRequestHeader& request_header)
@@ -53,9 +177,13 @@ NormalizeRequestHeader(
 
   // Make sure request batch-size doesn't exceed what is supported by
   // the model. For models that don't support batching the request
-  // batch-size will still be 1.
+  // batch-size will still be 1. A larger request for a model that
+  // supports batching is split into requests of at most the maximum
+  // batch-size when it is run, see InferenceServer::Infer(), unless
+  // its requests can't be split.
   if ((request_header.batch_size() != 1) &&
-      ((int)request_header.batch_size() > model_config.max_batch_size())) {
+      ((int)request_header.batch_size() > model_config.max_batch_size()) &&
+      !IsBatchSplittable(model_config)) {
     return Status(
         RequestStatusCode::INVALID_ARG,
         "inference request batch-size must be <= " +
@@ -63,6 +191,43 @@ NormalizeRequestHeader(
             model_name + "'");
   }
 
+  // If the model uses priority levels make sure the requested
+  // priority is valid. A priority of 0 indicates the model's default
+  // priority level. Priority is ignored for other models.
+  if (model_config.has_dynamic_batching() &&
+      (model_config.dynamic_batching().priority_levels() > 0) &&
+      (request_header.priority() >
+       model_config.dynamic_batching().priority_levels())) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "inference request priority must be in range [ 0, " +
+            std::to_string(model_config.dynamic_batching().priority_levels()) +
+            " ] for '" + model_name + "'");
+  }
+
+  // An output may be requested in a narrower datatype that the server
+  // converts it to. As for inputs, a TYPE_INVALID datatype in the
+  // normalized header means the model output's datatype.
+  for (InferRequestHeader::Output& io : *request_header.mutable_output()) {
+    if (io.data_type() == DataType::TYPE_INVALID) {
+      continue;
+    }
+
+    const ModelOutput* output_config;
+    RETURN_IF_ERROR(is.GetOutput(io.name(), &output_config));
+    if (io.data_type() == output_config->data_type()) {
+      io.set_data_type(DataType::TYPE_INVALID);
+    } else if (
+        (output_config->data_type() != DataType::TYPE_FP32) ||
+        (io.data_type() != DataType::TYPE_FP16) || io.has_cls()) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "output '" + io.name() + "' for model '" + model_name +
+              "' can't be returned as " + DataType_Name(io.data_type()) +
+              (io.has_cls() ? " classification" : ""));
+    }
+  }
+
   // Make sure that the request is providing the same number of inputs
   // as is expected by the model.
   if (request_header.input_size() != model_config.input_size()) {
@@ -76,11 +241,30 @@ NormalizeRequestHeader(
   // Update each input to have shape and batch-byte-size.
   for (InferRequestHeader::Input& io : *request_header.mutable_input()) {
     const ModelInput* input_config;
-    RETURN_IF_ERROR(is.GetInput(io.name(), &input_config));
+    const InferenceBackend::FixedInputShape* fixed_shape;
+    RETURN_IF_ERROR(is.GetInput(io.name(), &input_config, &fixed_shape));
+
+    // If the input has a fixed shape the request can only give the dims
+    // of the model input, and the normalized shape and byte size are
+    // known from the model configuration.
+    if (fixed_shape != nullptr) {
+      if ((io.dims_size() > 0) &&
+          !CompareDims(io.dims(), input_config->dims())) {
+        return Status(
+            RequestStatusCode::INVALID_ARG,
+            "unexpected shape for input '" + io.name() + "' for model '" +
+                model_name + "'. Expected " +
+                DimsListToString(input_config->dims()) + ", got " +
+                DimsListToString(io.dims()));
+      }
+      if ((io.dims_size() == 0) || input_config->has_reshape()) {
+        io.mutable_dims()->CopyFrom(fixed_shape->shape_);
+      }
+    }
 
     // If the inference request specifies a shape for an input, make
     // sure it matches what the model expects.
-    if (io.dims_size() > 0) {
+    if ((fixed_shape == nullptr) && (io.dims_size() > 0)) {
       if (!CompareDimsWithWildcard(io.dims(), input_config->dims())) {
         return Status(
             RequestStatusCode::INVALID_ARG,
@@ -117,7 +301,7 @@ NormalizeRequestHeader(
     // If we don't have shape for the input at this point then the
     // request didn't specify it, or it has a reshape that we must use
     // instead.
-    if (io.dims_size() == 0) {
+    if ((fixed_shape == nullptr) && (io.dims_size() == 0)) {
       const DimsList& dims = (input_config->has_reshape())
                                  ? input_config->reshape().shape()
                                  : input_config->dims();
@@ -156,21 +340,50 @@ NormalizeRequestHeader(
     // Note that non-batching zero-rank tensor is not allowed since
     // that will always be shape [], i.e. a tensor with no contents.
     //
+    // An input may be sent in another datatype that the model input
+    // converts from. A TYPE_INVALID datatype in the normalized header
+    // means that the input is sent in the model input's datatype.
+    if (io.data_type() == input_config->data_type()) {
+      io.set_data_type(DataType::TYPE_INVALID);
+    } else if (io.data_type() != DataType::TYPE_INVALID) {
+      const auto& data_types = input_config->conversion().data_type();
+      if (std::find(data_types.begin(), data_types.end(), io.data_type()) ==
+          data_types.end()) {
+        return Status(
+            RequestStatusCode::INVALID_ARG,
+            "input '" + io.name() + "' for model '" + model_name +
+                "' can't be sent as " + DataType_Name(io.data_type()) +
+                ", expected " + DataType_Name(input_config->data_type()));
+      }
+    }
+
     uint64_t bs = 0;
     if (IsFixedSizeDataType(input_config->data_type())) {
-      bs = GetByteSize(input_config->data_type(), io.dims());
-      if (model_config.max_batch_size() > 0) {
-        if (io.dims_size() == 0) {
-          bs = GetDataTypeByteSize(input_config->data_type()) *
-               request_header.batch_size();
-        } else {
+      if (fixed_shape != nullptr) {
+        bs = fixed_shape->byte_size_;
+        if (model_config.max_batch_size() > 0) {
           bs *= request_header.batch_size();
         }
+      } else {
+        bs = GetByteSize(input_config->data_type(), io.dims());
+        if (model_config.max_batch_size() > 0) {
+          if (io.dims_size() == 0) {
+            bs = GetDataTypeByteSize(input_config->data_type()) *
+                 request_header.batch_size();
+          } else {
+            bs *= request_header.batch_size();
+          }
+        }
       }
 
       // If batch-byte-size is given check to make sure that the
-      // calculated batch size matches
-      if ((io.batch_byte_size() != 0) && (io.batch_byte_size() != bs)) {
+      // calculated batch size, of the input as sent, matches
+      uint64_t request_bs = bs;
+      if (io.data_type() != DataType::TYPE_INVALID) {
+        request_bs = bs / GetDataTypeByteSize(input_config->data_type()) *
+                     GetDataTypeByteSize(io.data_type());
+      }
+      if ((io.batch_byte_size() != 0) && (io.batch_byte_size() != request_bs)) {
         return Status(
             RequestStatusCode::INVALID_ARG,
             "specific batch-byte-size for input '" + io.name() +
@@ -190,4 +403,227 @@ NormalizeRequestHeader(
   return Status::Success;
 }
 
+uint64_t
+RequestInputByteSize(
+    const ModelInput& input_config, const InferRequestHeader::Input& io)
+{
+  if (io.data_type() == DataType::TYPE_INVALID) {
+    return io.batch_byte_size();
+  }
+
+  return io.batch_byte_size() / GetDataTypeByteSize(input_config.data_type()) *
+         GetDataTypeByteSize(io.data_type());
+}
+
+bool
+HasInputConversion(const InferRequestHeader& request_header)
+{
+  for (const auto& io : request_header.input()) {
+    if (io.data_type() != DataType::TYPE_INVALID) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+Status
+ConvertRequestInputs(
+    const InferenceBackend& is, const InferRequestHeader& request_header,
+    std::unordered_map<std::string, std::shared_ptr<SystemMemory>>* input_map)
+{
+  for (const auto& io : request_header.input()) {
+    if (io.data_type() == DataType::TYPE_INVALID) {
+      continue;
+    }
+
+    const ModelInput* input_config;
+    RETURN_IF_ERROR(is.GetInput(io.name(), &input_config));
+
+    auto it = input_map->find(io.name());
+    if (it == input_map->end()) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "input '" + io.name() + "' is specified in request header but" +
+              " not found in memory block mapping for model '" + is.Name() +
+              "'");
+    }
+
+    const uint64_t byte_size = RequestInputByteSize(*input_config, io);
+    if (it->second->TotalByteSize() != byte_size) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "unexpected size " + std::to_string(it->second->TotalByteSize()) +
+              " for input '" + io.name() + "', expecting " +
+              std::to_string(byte_size) + " for model '" + is.Name() + "'");
+    }
+
+    std::vector<char> gathered;
+    const char* src;
+    RETURN_IF_ERROR(GatherRequestInput(
+        is, io.name(), *it->second, byte_size,
+        "converted from " + DataType_Name(io.data_type()), &gathered, &src));
+
+    TRTSERVER_Memory_Type memory_type;
+    auto converted = std::make_shared<AllocatedSystemMemory>(
+        io.batch_byte_size(), TRTSERVER_MEMORY_CPU);
+    float* dst =
+        reinterpret_cast<float*>(converted->MutableBuffer(&memory_type));
+    if ((dst == nullptr) && (io.batch_byte_size() != 0)) {
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "failed to allocate buffer to convert input '" + io.name() +
+              "' for model '" + is.Name() + "'");
+    }
+
+    const size_t cnt = io.batch_byte_size() / sizeof(float);
+    const float scale = (input_config->conversion().scale() == 0)
+                            ? 1.0f
+                            : input_config->conversion().scale();
+    const float offset = input_config->conversion().offset();
+    switch (io.data_type()) {
+      case DataType::TYPE_UINT8:
+        ConvertToFloat<uint8_t>(src, cnt, scale, offset, dst);
+        break;
+      case DataType::TYPE_INT8:
+        ConvertToFloat<int8_t>(src, cnt, scale, offset, dst);
+        break;
+      case DataType::TYPE_FP16:
+        ConvertHalfToFloat(src, cnt, scale, offset, dst);
+        break;
+      default:
+        return Status(
+            RequestStatusCode::INVALID_ARG,
+            "input '" + io.name() + "' for model '" + is.Name() +
+                "' can't be converted from " + DataType_Name(io.data_type()));
+    }
+
+    it->second = std::move(converted);
+  }
+
+  return Status::Success;
+}
+
+bool
+HasInputPadding(
+    const InferenceBackend& is, const InferRequestHeader& request_header)
+{
+  // Only variable-size dimensions are padded.
+  if (is.HasFixedInputShapes()) {
+    return false;
+  }
+
+  for (const auto& io : request_header.input()) {
+    const ModelInput* input_config;
+    if (!is.GetInput(io.name(), &input_config).IsOk() ||
+        !input_config->has_padding()) {
+      continue;
+    }
+
+    DimsList padded;
+    if (PaddedInputDims(*input_config, io, &padded)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+Status
+PadRequestInputs(
+    const InferenceBackend& is, InferRequestHeader* request_header,
+    std::unordered_map<std::string, std::shared_ptr<SystemMemory>>* input_map,
+    std::unordered_map<std::string, std::vector<int64_t>>* output_shapes)
+{
+  const ModelConfig& config = is.Config();
+  for (auto& io : *request_header->mutable_input()) {
+    const ModelInput* input_config;
+    RETURN_IF_ERROR(is.GetInput(io.name(), &input_config));
+
+    DimsList padded_dims;
+    if (!input_config->has_padding() ||
+        !PaddedInputDims(*input_config, io, &padded_dims)) {
+      continue;
+    }
+
+    auto it = input_map->find(io.name());
+    if (it == input_map->end()) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "input '" + io.name() + "' is specified in request header but" +
+              " not found in memory block mapping for model '" + is.Name() +
+              "'");
+    }
+    if (it->second->TotalByteSize() != io.batch_byte_size()) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "unexpected size " + std::to_string(it->second->TotalByteSize()) +
+              " for input '" + io.name() + "', expecting " +
+              std::to_string(io.batch_byte_size()) + " for model '" +
+              is.Name() + "'");
+    }
+
+    std::vector<char> gathered;
+    const char* src;
+    RETURN_IF_ERROR(GatherRequestInput(
+        is, io.name(), *it->second, io.batch_byte_size(), "padded",
+        &gathered, &src));
+
+    // The batch items of the request are padded together by treating
+    // the batch as the outermost dimension.
+    std::vector<int64_t> shape{(int64_t)request_header->batch_size()};
+    std::vector<int64_t> padded_shape{(int64_t)request_header->batch_size()};
+    shape.insert(shape.end(), io.dims().begin(), io.dims().end());
+    padded_shape.insert(
+        padded_shape.end(), padded_dims.begin(), padded_dims.end());
+
+    const size_t element_byte_size =
+        GetDataTypeByteSize(input_config->data_type());
+    const uint64_t padded_byte_size =
+        GetElementCount(padded_shape) * element_byte_size;
+    auto padded = std::make_shared<AllocatedSystemMemory>(
+        padded_byte_size, TRTSERVER_MEMORY_CPU);
+    TRTSERVER_Memory_Type memory_type;
+    char* dst = padded->MutableBuffer(&memory_type);
+    if (dst == nullptr) {
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "failed to allocate buffer to pad input '" + io.name() +
+              "' for model '" + is.Name() + "'");
+    }
+    memset(dst, 0, padded_byte_size);
+    CopyTensorRegion(src, shape, dst, padded_shape, element_byte_size);
+
+    // Each output trimmed to this input has its variable-size
+    // dimensions, in order, set to those of the input as sent.
+    for (const auto& output_config : config.output()) {
+      if (output_config.padded_input() != io.name()) {
+        continue;
+      }
+      std::vector<int64_t> output_shape;
+      if (config.max_batch_size() != 0) {
+        output_shape.push_back(request_header->batch_size());
+      }
+      int input_idx = 0;
+      for (const auto dim : output_config.dims()) {
+        if (dim == -1) {
+          while (input_config->dims(input_idx) != -1) {
+            ++input_idx;
+          }
+          output_shape.push_back(io.dims(input_idx++));
+        } else {
+          output_shape.push_back(dim);
+        }
+      }
+      (*output_shapes)[output_config.name()] = std::move(output_shape);
+    }
+
+    it->second = std::move(padded);
+    io.mutable_dims()->Swap(&padded_dims);
+    io.set_batch_byte_size(padded_byte_size);
+  }
+
+  return Status::Success;
+}
+
 }}  // namespace nvidia::inferenceserver
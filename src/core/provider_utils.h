@@ -36,8 +36,42 @@ namespace nvidia { namespace inferenceserver {
 class InferenceBackend;
 
 // Validate request header and modify as necessary so that every
-// input has a shape and a batch-byte-size.
+// input has a shape and a batch-byte-size. The batch-byte-size of an
+// input sent in another datatype than the model input's is the size
+// of the input once converted to the model input's datatype.
 Status NormalizeRequestHeader(
     const InferenceBackend& is, InferRequestHeader& request_header);
 
+// Return the size, in bytes, of the data sent for 'io', an input of a
+// normalized request header for the 'input_config' model input.
+uint64_t RequestInputByteSize(
+    const ModelInput& input_config, const InferRequestHeader::Input& io);
+
+// Return true if any input of the normalized 'request_header' is
+// sent in another datatype than the model input's.
+bool HasInputConversion(const InferRequestHeader& request_header);
+
+// Convert the inputs of the normalized 'request_header' that are
+// sent in another datatype than the model input's, replacing their
+// data in 'input_map' with the converted data.
+Status ConvertRequestInputs(
+    const InferenceBackend& is, const InferRequestHeader& request_header,
+    std::unordered_map<std::string, std::shared_ptr<SystemMemory>>* input_map);
+
+// Return true if any input of the normalized 'request_header' has a
+// variable-size dimension that is padded to a larger length bucket.
+bool HasInputPadding(
+    const InferenceBackend& is, const InferRequestHeader& request_header);
+
+// Pad the variable-size dimensions of the inputs of the normalized
+// 'request_header' to their length buckets, updating the shape and
+// batch-byte-size of each padded input and replacing its data in
+// 'input_map' with the zero-padded data. Return in 'output_shapes'
+// the shape, including the batch dimension if the model batches, that
+// each output trimmed to a padded input must be trimmed to.
+Status PadRequestInputs(
+    const InferenceBackend& is, InferRequestHeader* request_header,
+    std::unordered_map<std::string, std::shared_ptr<SystemMemory>>* input_map,
+    std::unordered_map<std::string, std::vector<int64_t>>* output_shapes);
+
 }}  // namespace nvidia::inferenceserver
@@ -0,0 +1,257 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/core/rate_limiter.h"
+
+#include <algorithm>
+#include <limits>
+#include <set>
+#include "src/core/logging.h"
+
+namespace nvidia { namespace inferenceserver {
+
+std::unique_ptr<RateLimiter> RateLimiter::instance_;
+
+RateLimiter::RateLimiter(
+    uint32_t gpu_slots, const std::map<std::string, uint32_t>& resources)
+    : gpu_slots_(gpu_slots), resources_(resources), next_waiter_id_(0)
+{
+}
+
+Status
+RateLimiter::Create(
+    uint32_t gpu_slots, const std::map<std::string, uint32_t>& resources)
+{
+  if (instance_ != nullptr) {
+    LOG_WARNING << "rate limiter has already been created";
+    return Status::Success;
+  }
+
+  if ((gpu_slots == 0) && resources.empty()) {
+    return Status::Success;
+  }
+
+  for (const auto& resource : resources) {
+    if (resource.second == 0) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "rate limiter resource '" + resource.first +
+              "' must have at least one unit");
+    }
+  }
+
+  LOG_INFO << "Rate limiting execution to "
+           << ((gpu_slots == 0) ? std::string("unlimited")
+                                : std::to_string(gpu_slots))
+           << " slots per GPU and " << resources.size()
+           << " named resource(s)";
+
+  instance_.reset(new RateLimiter(gpu_slots, resources));
+  return Status::Success;
+}
+
+bool
+RateLimiter::Enabled()
+{
+  return instance_ != nullptr;
+}
+
+Status
+RateLimiter::ValidateConfig(const ModelConfig& config)
+{
+  if (instance_ == nullptr) {
+    return Status::Success;
+  }
+
+  const ModelRateLimiter& limiter = config.rate_limiter();
+  if ((instance_->gpu_slots_ != 0) &&
+      (instance_->RequiredSlots(0, limiter) > instance_->gpu_slots_)) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "rate limiter weight " + std::to_string(limiter.weight()) +
+            " for " + config.name() + " exceeds the " +
+            std::to_string(instance_->gpu_slots_) + " slots of a GPU");
+  }
+
+  for (const auto& resource : limiter.resources()) {
+    const auto itr = instance_->resources_.find(resource.name());
+    if (itr == instance_->resources_.end()) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "rate limiter resource '" + resource.name() + "' for " +
+              config.name() + " is not available");
+    }
+    if (resource.count() > itr->second) {
+      return Status(
+          RequestStatusCode::INVALID_ARG,
+          "rate limiter resource '" + resource.name() + "' for " +
+              config.name() + " requires " + std::to_string(resource.count()) +
+              " units but only " + std::to_string(itr->second) +
+              " are available");
+    }
+  }
+
+  return Status::Success;
+}
+
+void
+RateLimiter::Acquire(const int gpu_device, const ModelRateLimiter& limiter)
+{
+  RateLimiter* rl = instance_.get();
+  std::unique_lock<std::mutex> lk(rl->mu_);
+
+  // Only take the tokens directly if no one is waiting, otherwise
+  // queue behind the waiters so priority order is respected.
+  if (rl->waiters_.empty() && rl->CanTake(gpu_device, limiter)) {
+    rl->Take(gpu_device, limiter);
+    return;
+  }
+
+  const uint32_t priority = (limiter.priority() == 0)
+                                ? std::numeric_limits<uint32_t>::max()
+                                : limiter.priority();
+  Waiter waiter{gpu_device, &limiter, false};
+  rl->waiters_.emplace(
+      std::make_pair(priority, rl->next_waiter_id_++), &waiter);
+  rl->GrantWaiters();
+  rl->cv_.wait(lk, [&waiter] { return waiter.granted_; });
+}
+
+void
+RateLimiter::Release(const int gpu_device, const ModelRateLimiter& limiter)
+{
+  RateLimiter* rl = instance_.get();
+  std::lock_guard<std::mutex> lk(rl->mu_);
+  rl->Give(gpu_device, limiter);
+  rl->GrantWaiters();
+}
+
+uint32_t
+RateLimiter::RequiredSlots(
+    const int gpu_device, const ModelRateLimiter& limiter) const
+{
+  if ((gpu_device < 0) || (gpu_slots_ == 0)) {
+    return 0;
+  }
+
+  return std::max(1u, limiter.weight());
+}
+
+bool
+RateLimiter::CanTake(
+    const int gpu_device, const ModelRateLimiter& limiter) const
+{
+  const uint32_t slots = RequiredSlots(gpu_device, limiter);
+  if (slots != 0) {
+    const auto itr = used_slots_.find(gpu_device);
+    const uint32_t used = (itr == used_slots_.end()) ? 0 : itr->second;
+    if (used + slots > gpu_slots_) {
+      return false;
+    }
+  }
+
+  for (const auto& resource : limiter.resources()) {
+    const auto itr = used_resources_.find(resource.name());
+    const uint32_t used = (itr == used_resources_.end()) ? 0 : itr->second;
+    if (used + resource.count() > resources_.at(resource.name())) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void
+RateLimiter::Take(const int gpu_device, const ModelRateLimiter& limiter)
+{
+  const uint32_t slots = RequiredSlots(gpu_device, limiter);
+  if (slots != 0) {
+    used_slots_[gpu_device] += slots;
+  }
+
+  for (const auto& resource : limiter.resources()) {
+    used_resources_[resource.name()] += resource.count();
+  }
+}
+
+void
+RateLimiter::Give(const int gpu_device, const ModelRateLimiter& limiter)
+{
+  const uint32_t slots = RequiredSlots(gpu_device, limiter);
+  if (slots != 0) {
+    used_slots_[gpu_device] -= slots;
+  }
+
+  for (const auto& resource : limiter.resources()) {
+    used_resources_[resource.name()] -= resource.count();
+  }
+}
+
+void
+RateLimiter::GrantWaiters()
+{
+  // A waiter that cannot take its tokens blocks the GPU and resources
+  // it needs from lower-priority waiters so that it is not starved by
+  // them. Waiters that need other tokens may still proceed.
+  std::set<int> blocked_gpus;
+  std::set<std::string> blocked_resources;
+  bool granted = false;
+
+  for (auto itr = waiters_.begin(); itr != waiters_.end();) {
+    Waiter* waiter = itr->second;
+    const ModelRateLimiter& limiter = *waiter->limiter_;
+    const bool needs_slots =
+        (RequiredSlots(waiter->gpu_device_, limiter) != 0);
+
+    bool blocked =
+        needs_slots && (blocked_gpus.count(waiter->gpu_device_) != 0);
+    for (const auto& resource : limiter.resources()) {
+      blocked |= (blocked_resources.count(resource.name()) != 0);
+    }
+
+    if (!blocked && CanTake(waiter->gpu_device_, limiter)) {
+      Take(waiter->gpu_device_, limiter);
+      waiter->granted_ = true;
+      granted = true;
+      itr = waiters_.erase(itr);
+      continue;
+    }
+
+    if (needs_slots) {
+      blocked_gpus.insert(waiter->gpu_device_);
+    }
+    for (const auto& resource : limiter.resources()) {
+      blocked_resources.insert(resource.name());
+    }
+    ++itr;
+  }
+
+  if (granted) {
+    cv_.notify_all();
+  }
+}
+
+}}  // namespace nvidia::inferenceserver
@@ -0,0 +1,112 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stdint.h>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "src/core/model_config.pb.h"
+#include "src/core/status.h"
+
+namespace nvidia { namespace inferenceserver {
+
+// This is a singleton class that limits the batches executing
+// concurrently across all models. Each GPU has a number of execution
+// slots and the server may also have named resources, each with a
+// number of units. An instance acquires the slots and resources given
+// by its model's 'rate_limiter' configuration before it executes a
+// batch and releases them once the batch completes. Instances that
+// cannot acquire their tokens wait and are given tokens in the order
+// of their model's priority.
+class RateLimiter {
+ public:
+  // Create the rate limiter. Each GPU has 'gpu_slots' execution slots,
+  // a zero value means the slots are not limited. 'resources' gives
+  // the number of units of each named resource. If there are neither
+  // slots nor resources the rate limiter is disabled.
+  static Status Create(
+      uint32_t gpu_slots, const std::map<std::string, uint32_t>& resources);
+
+  // Return true if the rate limiter is enabled.
+  static bool Enabled();
+
+  // Check that the tokens required by a model can ever be acquired.
+  static Status ValidateConfig(const ModelConfig& config);
+
+  // Block until the tokens required by 'limiter' for an instance on
+  // 'gpu_device' are acquired. 'gpu_device' is -1 for an instance
+  // that doesn't execute on a specific GPU.
+  static void Acquire(const int gpu_device, const ModelRateLimiter& limiter);
+
+  // Release the tokens acquired by Acquire().
+  static void Release(const int gpu_device, const ModelRateLimiter& limiter);
+
+ private:
+  struct Waiter {
+    int gpu_device_;
+    const ModelRateLimiter* limiter_;
+    bool granted_;
+  };
+
+  RateLimiter(
+      uint32_t gpu_slots, const std::map<std::string, uint32_t>& resources);
+
+  // Return the number of GPU slots required by 'limiter' on
+  // 'gpu_device'.
+  uint32_t RequiredSlots(
+      const int gpu_device, const ModelRateLimiter& limiter) const;
+
+  bool CanTake(const int gpu_device, const ModelRateLimiter& limiter) const;
+  void Take(const int gpu_device, const ModelRateLimiter& limiter);
+  void Give(const int gpu_device, const ModelRateLimiter& limiter);
+
+  // Give tokens to the waiters that can take them, in priority order.
+  // Must be called with 'mu_' held.
+  void GrantWaiters();
+
+  static std::unique_ptr<RateLimiter> instance_;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+
+  const uint32_t gpu_slots_;
+  const std::map<std::string, uint32_t> resources_;
+
+  // The slots in use on each GPU.
+  std::map<int, uint32_t> used_slots_;
+
+  // The units in use of each named resource.
+  std::map<std::string, uint32_t> used_resources_;
+
+  // The waiting instances, keyed by priority and then arrival order.
+  std::map<std::pair<uint32_t, uint64_t>, Waiter*> waiters_;
+  uint64_t next_waiter_id_;
+};
+
+}}  // namespace nvidia::inferenceserver
@@ -0,0 +1,219 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/core/repository_watcher.h"
+
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include "src/core/filesystem.h"
+#include "src/core/logging.h"
+
+namespace nvidia { namespace inferenceserver {
+
+namespace {
+
+// The changes to the files of a model that are watched.
+constexpr uint32_t kModelEvents = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE |
+                                  IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                                  IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+
+// The changes to the repository directory that are watched, which
+// add, remove or replace a model directory.
+constexpr uint32_t kRepositoryEvents =
+    IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+
+// Return true if 'path' is on a file system where inotify doesn't
+// report the changes made by other hosts.
+bool
+IsNetworkFileSystem(const std::string& path)
+{
+  struct statfs st;
+  if (statfs(path.c_str(), &st) != 0) {
+    return false;
+  }
+
+  switch ((uint32_t)st.f_type) {
+    case 0x6969:      // NFS
+    case 0x517b:      // SMB
+    case 0xfe534d42:  // SMB2
+    case 0xff534d42:  // CIFS
+    case 0x65735546:  // FUSE
+    case 0x00c36400:  // Ceph
+    case 0x0bd00bd0:  // Lustre
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+Status
+RepositoryWatcher::Create(
+    const std::string& repository_path,
+    std::unique_ptr<RepositoryWatcher>* watcher)
+{
+  if (repository_path.find("://") != std::string::npos) {
+    return Status(
+        RequestStatusCode::UNSUPPORTED,
+        "only repositories on a local file system can be watched");
+  }
+  if (IsNetworkFileSystem(repository_path)) {
+    return Status(
+        RequestStatusCode::UNSUPPORTED,
+        "repositories on a network file system can't be watched");
+  }
+
+  const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) {
+    return Status(
+        RequestStatusCode::INTERNAL,
+        std::string("failed to initialize inotify: ") + strerror(errno));
+  }
+
+  watcher->reset(new RepositoryWatcher(repository_path, fd));
+
+  const int wd = inotify_add_watch(
+      fd, repository_path.c_str(), kRepositoryEvents | IN_ONLYDIR);
+  if (wd < 0) {
+    const std::string err = strerror(errno);
+    watcher->reset();
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "failed to watch " + repository_path + ": " + err);
+  }
+  (*watcher)->watches_.emplace(wd, std::string());
+
+  return Status::Success;
+}
+
+RepositoryWatcher::RepositoryWatcher(
+    const std::string& repository_path, const int fd)
+    : repository_path_(repository_path), fd_(fd)
+{
+}
+
+RepositoryWatcher::~RepositoryWatcher()
+{
+  close(fd_);
+}
+
+void
+RepositoryWatcher::WatchModel(const std::string& model_name)
+{
+  WatchDirectory(JoinPath({repository_path_, model_name}), model_name);
+}
+
+void
+RepositoryWatcher::WatchDirectory(
+    const std::string& path, const std::string& model_name)
+{
+  // Watching a directory that is already watched returns the existing
+  // watch descriptor.
+  const int wd =
+      inotify_add_watch(fd_, path.c_str(), kModelEvents | IN_ONLYDIR);
+  if (wd < 0) {
+    // Most likely the directory was just removed, which is reported
+    // as a change of the parent directory.
+    LOG_VERBOSE(1) << "failed to watch " << path << ": " << strerror(errno);
+    return;
+  }
+  watches_[wd] = model_name;
+
+  DIR* dir = opendir(path.c_str());
+  if (dir == nullptr) {
+    return;
+  }
+
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != nullptr) {
+    const std::string name(entry->d_name);
+    if ((name == ".") || (name == "..")) {
+      continue;
+    }
+
+    const std::string child = JoinPath({path, name});
+    struct stat st;
+    if ((stat(child.c_str(), &st) == 0) && S_ISDIR(st.st_mode)) {
+      WatchDirectory(child, model_name);
+    }
+  }
+
+  closedir(dir);
+}
+
+bool
+RepositoryWatcher::Changed(std::set<std::string>* model_names)
+{
+  bool complete = true;
+
+  alignas(struct inotify_event) char buf[16 * 1024];
+  while (true) {
+    const ssize_t len = read(fd_, buf, sizeof(buf));
+    if (len <= 0) {
+      // EAGAIN when all the queued events are read.
+      break;
+    }
+
+    for (char* ptr = buf; ptr < buf + len;) {
+      const struct inotify_event* event =
+          reinterpret_cast<const struct inotify_event*>(ptr);
+      ptr += sizeof(struct inotify_event) + event->len;
+
+      if ((event->mask & IN_Q_OVERFLOW) != 0) {
+        complete = false;
+        continue;
+      }
+
+      const auto itr = watches_.find(event->wd);
+      if (itr == watches_.end()) {
+        continue;
+      }
+
+      if (itr->second.empty()) {
+        // A model directory was added, removed or replaced.
+        if (event->len > 0) {
+          model_names->insert(event->name);
+        }
+      } else {
+        model_names->insert(itr->second);
+      }
+
+      if ((event->mask & IN_IGNORED) != 0) {
+        watches_.erase(itr);
+      }
+    }
+  }
+
+  return complete;
+}
+
+}}  // namespace nvidia::inferenceserver
@@ -0,0 +1,76 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include "src/core/status.h"
+
+namespace nvidia { namespace inferenceserver {
+
+// Watch a model repository on a local file system with inotify to
+// learn which models have changed, so that polling the repository
+// doesn't need to walk the directories of all the models. The kernel
+// queues the events until they are collected by Changed() and so no
+// thread is needed to watch the repository.
+class RepositoryWatcher {
+ public:
+  // Create a watcher for the repository at 'repository_path'. Return
+  // an error if the repository can't be watched, for example because
+  // it is on a network file system, where the changes made by other
+  // hosts are not reported.
+  static Status Create(
+      const std::string& repository_path,
+      std::unique_ptr<RepositoryWatcher>* watcher);
+
+  ~RepositoryWatcher();
+
+  // Watch the directory of model 'model_name' and all its
+  // subdirectories. Must be called before the model is read, so that
+  // the subdirectories created since it was last read are watched too.
+  void WatchModel(const std::string& model_name);
+
+  // Collect the events queued since the last call and return the
+  // names of the models that have changed. Return false if some
+  // events were lost, in which case any model may have changed.
+  bool Changed(std::set<std::string>* model_names);
+
+ private:
+  RepositoryWatcher(const std::string& repository_path, const int fd);
+
+  void WatchDirectory(const std::string& path, const std::string& model_name);
+
+  const std::string repository_path_;
+  const int fd_;
+
+  // The model that each watch descriptor watches a directory of, or
+  // empty for the repository directory itself.
+  std::unordered_map<int, std::string> watches_;
+};
+
+}}  // namespace nvidia::inferenceserver
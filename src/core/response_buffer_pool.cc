@@ -0,0 +1,162 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/core/response_buffer_pool.h"
+
+#include <algorithm>
+
+namespace nvidia { namespace inferenceserver {
+
+namespace {
+
+// The smallest size class. Buffers of size class 'c' hold
+// 'kMinBufferByteSize << c' bytes.
+constexpr size_t kMinBufferByteSize = 256;
+
+// The number of size classes. The largest pooled buffer is 16MB.
+constexpr size_t kSizeClassCount = 17;
+
+// The free buffers of a size class hold at most this many bytes, but
+// a class always keeps at least 'kMinFreeBufferCount' buffers.
+constexpr size_t kMaxFreeByteSizePerClass = 64 * 1024 * 1024;
+constexpr size_t kMinFreeBufferCount = 4;
+
+}  // namespace
+
+ResponseBufferPool::Buffer::Buffer(Buffer&& other)
+    : ptr_(other.ptr_), byte_size_(other.byte_size_)
+{
+  other.ptr_ = nullptr;
+  other.byte_size_ = 0;
+}
+
+ResponseBufferPool::Buffer&
+ResponseBufferPool::Buffer::operator=(Buffer&& other)
+{
+  if (this != &other) {
+    Release();
+    ptr_ = other.ptr_;
+    byte_size_ = other.byte_size_;
+    other.ptr_ = nullptr;
+    other.byte_size_ = 0;
+  }
+
+  return *this;
+}
+
+char*
+ResponseBufferPool::Buffer::Reset(size_t byte_size)
+{
+  Release();
+  ptr_ = ResponseBufferPool::Alloc(byte_size);
+  byte_size_ = byte_size;
+  return ptr_;
+}
+
+void
+ResponseBufferPool::Buffer::Release()
+{
+  if (ptr_ != nullptr) {
+    ResponseBufferPool::Free(ptr_, byte_size_);
+    ptr_ = nullptr;
+    byte_size_ = 0;
+  }
+}
+
+ResponseBufferPool::ResponseBufferPool() : size_classes_(kSizeClassCount) {}
+
+ResponseBufferPool*
+ResponseBufferPool::Instance()
+{
+  // The pool is never destroyed so that responses that outlive static
+  // destruction can still return their buffers.
+  static ResponseBufferPool* instance = new ResponseBufferPool();
+  return instance;
+}
+
+size_t
+ResponseBufferPool::SizeClassIndex(size_t byte_size)
+{
+  size_t size_class = 0;
+  while ((size_class < kSizeClassCount) &&
+         ((kMinBufferByteSize << size_class) < byte_size)) {
+    size_class++;
+  }
+
+  return size_class;
+}
+
+char*
+ResponseBufferPool::Alloc(size_t byte_size)
+{
+  const size_t size_class = SizeClassIndex(byte_size);
+  if (size_class >= kSizeClassCount) {
+    return new char[byte_size];
+  }
+
+  SizeClass& sc = Instance()->size_classes_[size_class];
+  {
+    std::lock_guard<std::mutex> lock(sc.mu_);
+    if (!sc.free_buffers_.empty()) {
+      char* ptr = sc.free_buffers_.back();
+      sc.free_buffers_.pop_back();
+      return ptr;
+    }
+  }
+
+  return new char[kMinBufferByteSize << size_class];
+}
+
+void
+ResponseBufferPool::Free(char* ptr, size_t byte_size)
+{
+  if (ptr == nullptr) {
+    return;
+  }
+
+  const size_t size_class = SizeClassIndex(byte_size);
+  if (size_class >= kSizeClassCount) {
+    delete[] ptr;
+    return;
+  }
+
+  const size_t max_free_count = std::max(
+      kMinFreeBufferCount,
+      kMaxFreeByteSizePerClass / (kMinBufferByteSize << size_class));
+
+  SizeClass& sc = Instance()->size_classes_[size_class];
+  {
+    std::lock_guard<std::mutex> lock(sc.mu_);
+    if (sc.free_buffers_.size() < max_free_count) {
+      sc.free_buffers_.push_back(ptr);
+      return;
+    }
+  }
+
+  delete[] ptr;
+}
+
+}}  // namespace nvidia::inferenceserver
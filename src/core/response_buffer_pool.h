@@ -0,0 +1,95 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stddef.h>
+#include <mutex>
+#include <vector>
+
+namespace nvidia { namespace inferenceserver {
+
+// This is a singleton class that recycles the host buffers that
+// response contents are written to. Each buffer is rounded up to a
+// power-of-two size class and a freed buffer is kept on the free list
+// of its class for reuse, so steady-state inference does not allocate
+// response buffers. Buffers larger than the largest size class are
+// allocated and freed directly, and each class keeps a bounded number
+// of free buffers.
+class ResponseBufferPool {
+ public:
+  // A buffer from the pool that is returned to the pool when it is
+  // reset, released or destroyed.
+  class Buffer {
+   public:
+    Buffer() : ptr_(nullptr), byte_size_(0) {}
+    Buffer(Buffer&& other);
+    Buffer& operator=(Buffer&& other);
+    ~Buffer() { Release(); }
+
+    // Return the current buffer, if any, to the pool and replace it
+    // with a buffer of at least 'byte_size' bytes. Return the new
+    // buffer.
+    char* Reset(size_t byte_size);
+
+    // Return the current buffer, if any, to the pool.
+    void Release();
+
+    char* get() const { return ptr_; }
+
+   private:
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+
+    char* ptr_;
+    size_t byte_size_;
+  };
+
+  // Allocate a buffer of at least 'byte_size' bytes.
+  static char* Alloc(size_t byte_size);
+
+  // Return to the pool a buffer returned by Alloc(). 'byte_size' must
+  // equal the size that the buffer was allocated with.
+  static void Free(char* ptr, size_t byte_size);
+
+ private:
+  struct SizeClass {
+    std::mutex mu_;
+    std::vector<char*> free_buffers_;
+  };
+
+  ResponseBufferPool();
+
+  static ResponseBufferPool* Instance();
+
+  // Return the index of the smallest size class that can hold
+  // 'byte_size' bytes, or the number of size classes if the size is
+  // not pooled.
+  static size_t SizeClassIndex(size_t byte_size);
+
+  std::vector<SizeClass> size_classes_;
+};
+
+}}  // namespace nvidia::inferenceserver
@@ -0,0 +1,407 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/core/response_cache.h"
+
+#include <string.h>
+#include "src/core/backend.h"
+#include "src/core/logging.h"
+#include "src/core/provider.h"
+
+#ifdef TRTIS_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRTIS_ENABLE_GPU
+
+namespace nvidia { namespace inferenceserver {
+
+namespace {
+
+// Streaming 64-bit xxHash (XXH64) of a sequence of byte ranges.
+class XXH64 {
+ public:
+  explicit XXH64(uint64_t seed = 0) : total_len_(0), buffer_len_(0)
+  {
+    v_[0] = seed + kPrime1 + kPrime2;
+    v_[1] = seed + kPrime2;
+    v_[2] = seed;
+    v_[3] = seed - kPrime1;
+  }
+
+  void Update(const void* data, size_t len)
+  {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    total_len_ += len;
+
+    if (buffer_len_ + len < sizeof(buffer_)) {
+      memcpy(buffer_ + buffer_len_, p, len);
+      buffer_len_ += len;
+      return;
+    }
+
+    if (buffer_len_ > 0) {
+      const size_t fill = sizeof(buffer_) - buffer_len_;
+      memcpy(buffer_ + buffer_len_, p, fill);
+      Stripe(buffer_);
+      p += fill;
+      len -= fill;
+      buffer_len_ = 0;
+    }
+
+    while (len >= sizeof(buffer_)) {
+      Stripe(p);
+      p += sizeof(buffer_);
+      len -= sizeof(buffer_);
+    }
+
+    memcpy(buffer_, p, len);
+    buffer_len_ = len;
+  }
+
+  void Update(const std::string& str)
+  {
+    const uint64_t len = str.size();
+    Update(&len, sizeof(len));
+    Update(str.data(), str.size());
+  }
+
+  uint64_t Digest() const
+  {
+    uint64_t h;
+    if (total_len_ >= sizeof(buffer_)) {
+      h = Rotl(v_[0], 1) + Rotl(v_[1], 7) + Rotl(v_[2], 12) + Rotl(v_[3], 18);
+      for (size_t i = 0; i < 4; ++i) {
+        h = (h ^ Round(0, v_[i])) * kPrime1 + kPrime4;
+      }
+    } else {
+      h = v_[2] + kPrime5;
+    }
+    h += total_len_;
+
+    const uint8_t* p = buffer_;
+    const uint8_t* end = buffer_ + buffer_len_;
+    for (; p + 8 <= end; p += 8) {
+      h ^= Round(0, Read64(p));
+      h = Rotl(h, 27) * kPrime1 + kPrime4;
+    }
+    if (p + 4 <= end) {
+      h ^= (uint64_t)Read32(p) * kPrime1;
+      h = Rotl(h, 23) * kPrime2 + kPrime3;
+      p += 4;
+    }
+    for (; p < end; ++p) {
+      h ^= (*p) * kPrime5;
+      h = Rotl(h, 11) * kPrime1;
+    }
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+  }
+
+ private:
+  static constexpr uint64_t kPrime1 = 11400714785074694791ULL;
+  static constexpr uint64_t kPrime2 = 14029467366897019727ULL;
+  static constexpr uint64_t kPrime3 = 1609587929392839161ULL;
+  static constexpr uint64_t kPrime4 = 9650029242287828579ULL;
+  static constexpr uint64_t kPrime5 = 2870177450012600261ULL;
+
+  static uint64_t Rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+  static uint64_t Round(uint64_t acc, uint64_t input)
+  {
+    acc += input * kPrime2;
+    return Rotl(acc, 31) * kPrime1;
+  }
+
+  static uint64_t Read64(const uint8_t* p)
+  {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  static uint32_t Read32(const uint8_t* p)
+  {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  void Stripe(const uint8_t* p)
+  {
+    for (size_t i = 0; i < 4; ++i) {
+      v_[i] = Round(v_[i], Read64(p + (i * 8)));
+    }
+  }
+
+  uint64_t v_[4];
+  uint64_t total_len_;
+  uint8_t buffer_[32];
+  size_t buffer_len_;
+};
+
+// Copy an output between host memory and the memory of an output
+// buffer.
+Status
+CopyOutput(
+    const std::string& name, const TRTSERVER_Memory_Type src_memory_type,
+    const TRTSERVER_Memory_Type dst_memory_type, const size_t byte_size,
+    const void* src, void* dst)
+{
+  if ((src_memory_type == TRTSERVER_MEMORY_CPU) &&
+      (dst_memory_type == TRTSERVER_MEMORY_CPU)) {
+    memcpy(dst, src, byte_size);
+  } else {
+#ifdef TRTIS_ENABLE_GPU
+    auto copy_kind = cudaMemcpyDeviceToDevice;
+    if (src_memory_type == TRTSERVER_MEMORY_CPU) {
+      copy_kind = cudaMemcpyHostToDevice;
+    } else if (dst_memory_type == TRTSERVER_MEMORY_CPU) {
+      copy_kind = cudaMemcpyDeviceToHost;
+    }
+    cudaError_t err = cudaMemcpy(dst, src, byte_size, copy_kind);
+    if (err != cudaSuccess) {
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "failed to copy cached output '" + name +
+              "': " + std::string(cudaGetErrorString(err)));
+    }
+#else
+    return Status(
+        RequestStatusCode::INTERNAL, "try to use CUDA copy for output '" +
+                                         name + "' while GPU is not supported");
+#endif  // TRTIS_ENABLE_GPU
+  }
+
+  return Status::Success;
+}
+
+}  // namespace
+
+ResponseCache::ResponseCache(uint64_t byte_size)
+    : byte_size_(byte_size), used_byte_size_(0)
+{
+}
+
+bool
+ResponseCache::RequestKey(
+    const InferenceBackend& backend,
+    const std::shared_ptr<InferRequestProvider>& request_provider,
+    uint64_t* key)
+{
+  // The inputs overridden by a scheduler are not part of the request.
+  const auto& overrides = request_provider->GetInputOverride();
+  if ((overrides != nullptr) && !overrides->empty()) {
+    return false;
+  }
+
+  // Requests with different inputs are the same once padded, so the
+  // request doesn't identify the trimmed outputs.
+  for (const auto& input : backend.Config().input()) {
+    if (input.has_padding()) {
+      return false;
+    }
+  }
+
+  // Only the fields of the request header that affect the outputs are
+  // hashed, where the inputs and outputs are held doesn't matter.
+  InferRequestHeader header = request_provider->RequestHeader();
+  header.clear_id();
+  header.clear_priority();
+  header.clear_timeout_microseconds();
+  header.clear_max_queue_delay_microseconds();
+  for (auto& input : *header.mutable_input()) {
+    input.clear_shared_memory();
+  }
+  for (auto& output : *header.mutable_output()) {
+    // Converted outputs are produced when the response is finalized and
+    // are not kept in the cache.
+    if (output.data_type() != DataType::TYPE_INVALID) {
+      return false;
+    }
+    output.clear_shared_memory();
+  }
+
+  std::string serialized;
+  if (!header.SerializeToString(&serialized)) {
+    return false;
+  }
+
+  XXH64 hash;
+  hash.Update(backend.Name());
+  const int64_t version = backend.Version();
+  hash.Update(&version, sizeof(version));
+  hash.Update(serialized);
+
+  for (const auto& input : header.input()) {
+    std::shared_ptr<SystemMemory> memory;
+    if (!request_provider->GetSystemMemory(input.name(), &memory).IsOk()) {
+      return false;
+    }
+
+    const uint64_t total_byte_size = memory->TotalByteSize();
+    hash.Update(&total_byte_size, sizeof(total_byte_size));
+
+    size_t idx = 0;
+    size_t byte_size;
+    TRTSERVER_Memory_Type memory_type;
+    const char* buffer;
+    while ((buffer = memory->BufferAt(idx++, &byte_size, &memory_type)) !=
+           nullptr) {
+      if (memory_type != TRTSERVER_MEMORY_CPU) {
+        return false;
+      }
+      hash.Update(buffer, byte_size);
+    }
+  }
+
+  *key = hash.Digest();
+  return true;
+}
+
+Status
+ResponseCache::Lookup(
+    const uint64_t key, InferResponseProvider* response_provider, bool* hit)
+{
+  *hit = false;
+
+  // Hold the lock while copying so that the entry isn't evicted, the
+  // copies are small compared to executing the model.
+  std::lock_guard<std::mutex> lock(mu_);
+
+  auto itr = map_.find(key);
+  if (itr == map_.end()) {
+    return Status::Success;
+  }
+
+  lru_.splice(lru_.begin(), lru_, itr->second);
+  *hit = true;
+
+  for (const auto& output : itr->second->outputs_) {
+    void* content;
+    RETURN_IF_ERROR(response_provider->AllocateOutputBuffer(
+        output.name_, &content, output.content_.size(), output.shape_));
+    if (output.content_.empty()) {
+      continue;
+    }
+
+    // The allocator may not provide the buffer in host memory.
+    if (content == nullptr) {
+      RETURN_IF_ERROR(response_provider->AllocateOutputBuffer(
+          output.name_, &content, output.content_.size(), output.shape_,
+          TRTSERVER_MEMORY_GPU));
+    }
+    const void* buffer;
+    size_t byte_size;
+    TRTSERVER_Memory_Type memory_type;
+    RETURN_IF_ERROR(response_provider->OutputBufferContents(
+        output.name_, &buffer, &byte_size, &memory_type));
+    if ((buffer == nullptr) || (byte_size != output.content_.size())) {
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "failed to allocate buffer for cached output '" + output.name_ +
+              "'");
+    }
+
+    RETURN_IF_ERROR(CopyOutput(
+        output.name_, TRTSERVER_MEMORY_CPU, memory_type, byte_size,
+        output.content_.data(), const_cast<void*>(buffer)));
+  }
+
+  return Status::Success;
+}
+
+void
+ResponseCache::Insert(
+    const uint64_t key, const InferRequestHeader& request_header,
+    const InferResponseProvider& response_provider)
+{
+  Entry entry;
+  entry.key_ = key;
+  entry.byte_size_ = 0;
+
+  for (const auto& requested : request_header.output()) {
+    Output output;
+    output.name_ = requested.name();
+
+    const void* content;
+    size_t byte_size;
+    TRTSERVER_Memory_Type memory_type;
+    if (!response_provider
+             .OutputBufferContents(
+                 output.name_, &content, &byte_size, &memory_type)
+             .IsOk() ||
+        !response_provider.OutputBufferShape(output.name_, &output.shape_)
+             .IsOk()) {
+      return;
+    }
+
+    if (byte_size > 0) {
+      if ((content == nullptr) || (memory_type != TRTSERVER_MEMORY_CPU)) {
+        return;
+      }
+      output.content_.assign(reinterpret_cast<const char*>(content), byte_size);
+    }
+
+    entry.byte_size_ += byte_size;
+    entry.outputs_.emplace_back(std::move(output));
+  }
+
+  if (entry.byte_size_ > byte_size_) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mu_);
+
+  // A concurrent request with the same inputs may have already
+  // cached the response.
+  if (map_.find(key) != map_.end()) {
+    return;
+  }
+
+  Evict(entry.byte_size_);
+
+  used_byte_size_ += entry.byte_size_;
+  lru_.emplace_front(std::move(entry));
+  map_.emplace(key, lru_.begin());
+}
+
+void
+ResponseCache::Evict(uint64_t byte_size)
+{
+  while (!lru_.empty() && (used_byte_size_ + byte_size > byte_size_)) {
+    const Entry& entry = lru_.back();
+    LOG_VERBOSE(2) << "evicting cached response " << entry.key_;
+    used_byte_size_ -= entry.byte_size_;
+    map_.erase(entry.key_);
+    lru_.pop_back();
+  }
+}
+
+}}  // namespace nvidia::inferenceserver
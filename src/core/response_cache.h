@@ -0,0 +1,104 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stdint.h>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "src/core/api.pb.h"
+#include "src/core/status.h"
+
+namespace nvidia { namespace inferenceserver {
+
+class InferenceBackend;
+class InferRequestProvider;
+class InferResponseProvider;
+
+// A cache of the responses of the models that enable the response
+// cache. A response is keyed by a hash of the model, the request
+// header and the bytes of the request inputs. Cached outputs are held
+// in host memory and the least-recently used responses are evicted
+// once the outputs exceed the byte size of the cache.
+class ResponseCache {
+ public:
+  explicit ResponseCache(uint64_t byte_size);
+
+  // Compute in 'key' the cache key of a request to 'backend'. Return
+  // false if the request can't be cached because an input is not in
+  // host memory.
+  static bool RequestKey(
+      const InferenceBackend& backend,
+      const std::shared_ptr<InferRequestProvider>& request_provider,
+      uint64_t* key);
+
+  // Lookup the response cached for 'key'. If found, set 'hit' to true
+  // and copy the cached outputs into the output buffers of
+  // 'response_provider'.
+  Status Lookup(
+      const uint64_t key, InferResponseProvider* response_provider,
+      bool* hit);
+
+  // Cache for 'key' the outputs requested by 'request_header' that
+  // are held by 'response_provider'. The response is not cached if an
+  // output is not in host memory or if the outputs are larger than
+  // the cache.
+  void Insert(
+      const uint64_t key, const InferRequestHeader& request_header,
+      const InferResponseProvider& response_provider);
+
+ private:
+  struct Output {
+    std::string name_;
+    std::vector<int64_t> shape_;
+    std::string content_;
+  };
+
+  struct Entry {
+    uint64_t key_;
+    uint64_t byte_size_;
+    std::vector<Output> outputs_;
+  };
+
+  // Evict the least-recently used entries until 'byte_size' more
+  // bytes fit in the cache.
+  void Evict(uint64_t byte_size);
+
+  const uint64_t byte_size_;
+
+  std::mutex mu_;
+  uint64_t used_byte_size_;
+
+  // The cached entries, most-recently used first, and the position of
+  // each key in the list.
+  std::list<Entry> lru_;
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> map_;
+};
+
+}}  // namespace nvidia::inferenceserver
@@ -51,6 +51,15 @@ class Scheduler {
           status_(payload.status_)
     {
     }
+    Payload& operator=(Payload&& payload)
+    {
+      stats_ = std::move(payload.stats_);
+      request_provider_ = std::move(payload.request_provider_);
+      response_provider_ = std::move(payload.response_provider_);
+      complete_function_ = std::move(payload.complete_function_);
+      status_ = payload.status_;
+      return *this;
+    }
     Payload(
         const std::shared_ptr<ModelInferStats>& stats,
         const std::shared_ptr<InferRequestProvider>& request_provider,
@@ -77,6 +86,14 @@ class Scheduler {
   // prevents scheduler from using the runner.
   using StandardInitFunc = std::function<Status(uint32_t runner_idx)>;
 
+  // The prototype for the release function that may be called by the
+  // "standard" schedulers when 'runner_idx' stops executing payloads
+  // for a while, for example because of instance autoscaling. The
+  // release function frees the resources acquired by the init
+  // function, which is called again before the runner next executes
+  // payloads.
+  using StandardReleaseFunc = std::function<void(uint32_t runner_idx)>;
+
   // The prototype for the run function that will be called by the
   // "standard" schedulers created based on a model's
   // scheduling_choice settings. The run function must accept a
@@ -96,6 +113,38 @@ class Scheduler {
       const std::shared_ptr<InferRequestProvider>& request_provider,
       const std::shared_ptr<InferResponseProvider>& response_provider,
       std::function<void(const Status&)> OnComplete) = 0;
+
+  // Enqueue several requests with the scheduler. The default is to
+  // enqueue the requests one at a time.
+  virtual void EnqueueBatch(std::vector<Payload>* payloads)
+  {
+    for (auto& payload : *payloads) {
+      Enqueue(
+          payload.stats_, payload.request_provider_,
+          payload.response_provider_, payload.complete_function_);
+    }
+  }
+
+  // Add the current state of the scheduler to 'status'. The default
+  // is to not report any scheduler state.
+  virtual void GetStatus(ModelVersionStatus* status) {}
+
+  // Get the number of requests that are queued and have not yet
+  // started executing, and the size of the batches the scheduler
+  // forms from them, or 0 if it doesn't form batches. Must not block,
+  // it is called when routing requests. The default is to report an
+  // empty queue.
+  virtual void GetQueueDepth(uint64_t* queued, uint64_t* batch_size)
+  {
+    *queued = 0;
+    *batch_size = 0;
+  }
+
+  // Called when the server starts draining before it exits. Queued
+  // requests that have not started executing by 'deadline_ns', a
+  // CLOCK_MONOTONIC time, should be failed instead of executed. The
+  // default is to execute every queued request.
+  virtual void Drain(const uint64_t deadline_ns) {}
 };
 
 }}  // namespace nvidia::inferenceserver
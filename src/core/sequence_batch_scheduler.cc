@@ -30,22 +30,226 @@
 #include <sys/syscall.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <algorithm>
 #include "src/core/constants.h"
+#include "src/core/cpu_isolation.h"
 #include "src/core/logging.h"
+#include "src/core/metrics.h"
 #include "src/core/model_config_utils.h"
 #include "src/core/provider.h"
 #include "src/core/server_status.h"
 
+#ifdef TRTIS_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRTIS_ENABLE_GPU
+
 namespace nvidia { namespace inferenceserver {
 
+namespace {
+
+uint64_t
+NowMicroseconds()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return TIMESPEC_TO_NANOS(now) / 1000;
+}
+
+// Copy the 'output_name' state output of 'response_provider' into
+// 'value'.
+Status
+CopyStateOutput(
+    const std::string& output_name, const size_t expected_byte_size,
+    const InferResponseProvider& response_provider,
+    InferRequestProvider::InputOverride* value)
+{
+  const void* content;
+  size_t content_byte_size;
+  TRTSERVER_Memory_Type memory_type;
+  RETURN_IF_ERROR(response_provider.OutputBufferContents(
+      output_name, &content, &content_byte_size, &memory_type));
+  if ((content == nullptr) || (content_byte_size != expected_byte_size)) {
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "unexpected size " + std::to_string(content_byte_size) +
+            " for state output '" + output_name + "', expecting " +
+            std::to_string(expected_byte_size));
+  }
+
+  value->content_.resize(content_byte_size);
+  if (memory_type == TRTSERVER_MEMORY_CPU) {
+    memcpy(&value->content_[0], content, content_byte_size);
+  } else {
+#ifdef TRTIS_ENABLE_GPU
+    cudaError_t err = cudaMemcpy(
+        &value->content_[0], content, content_byte_size,
+        cudaMemcpyDeviceToHost);
+    if (err != cudaSuccess) {
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "failed to copy state output '" + output_name +
+              "': " + std::string(cudaGetErrorString(err)));
+    }
+#else
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "state output '" + output_name +
+            "' is in GPU memory while GPU is not supported");
+#endif  // TRTIS_ENABLE_GPU
+  }
+
+  return Status::Success;
+}
+
+// Return the size of the zero buffer shared by the NULL providers
+// of a model. It holds the largest fixed-size input of one batch
+// element so that the NULL input for a slot is usually a single
+// chunk. Variable-size and string inputs use at least 'min_size'.
+size_t
+NullInputByteSize(const ModelConfig& config)
+{
+  constexpr size_t min_size = 64 * 1024;
+  constexpr size_t max_size = 16 * 1024 * 1024;
+
+  size_t byte_size = min_size;
+  for (const auto& input : config.input()) {
+    const int64_t input_byte_size = GetByteSize(input);
+    if (input_byte_size > 0) {
+      byte_size = std::max(byte_size, (size_t)input_byte_size);
+    }
+  }
+
+  return std::min(byte_size, max_size);
+}
+
+}  // namespace
+
+void
+SequenceBinding::Close()
+{
+  std::shared_ptr<Owner> owner;
+  CorrelationID correlation_id;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    owner = std::move(owner_);
+    correlation_id = correlation_id_;
+  }
+
+  // The owner lock keeps the scheduler from being destroyed while the
+  // sequence is ended.
+  if (owner != nullptr) {
+    std::lock_guard<std::mutex> owner_lock(owner->mu_);
+    if (owner->scheduler_ != nullptr) {
+      owner->scheduler_->EndBoundSequence(this, correlation_id);
+    }
+  }
+}
+
+void
+SequenceBinding::Bind(
+    const std::shared_ptr<Owner>& owner, const CorrelationID correlation_id,
+    const bool bound, const size_t batcher_idx, const uint32_t slot)
+{
+  std::lock_guard<std::mutex> lock(mu_);
+  owner_ = owner;
+  correlation_id_ = correlation_id;
+  bound_ = bound;
+  batcher_idx_ = batcher_idx;
+  slot_ = slot;
+}
+
+bool
+SequenceBinding::SetSlot(
+    const Owner* owner, const CorrelationID correlation_id,
+    const size_t batcher_idx, const uint32_t slot)
+{
+  std::lock_guard<std::mutex> lock(mu_);
+  if ((owner_.get() != owner) || (correlation_id_ != correlation_id)) {
+    return false;
+  }
+
+  bound_ = true;
+  batcher_idx_ = batcher_idx;
+  slot_ = slot;
+  return true;
+}
+
+void
+SequenceBinding::Unbind(const Owner* owner, const CorrelationID correlation_id)
+{
+  std::lock_guard<std::mutex> lock(mu_);
+  if ((owner_.get() == owner) && (correlation_id_ == correlation_id)) {
+    owner_.reset();
+    correlation_id_ = 0;
+    bound_ = false;
+  }
+}
+
+bool
+SequenceBinding::Route(
+    const Owner* owner, const CorrelationID correlation_id,
+    const uint64_t now_us, size_t* batcher_idx, uint32_t* slot)
+{
+  std::lock_guard<std::mutex> lock(mu_);
+  if (!bound_ || (owner_.get() != owner) ||
+      (correlation_id_ != correlation_id)) {
+    return false;
+  }
+
+  last_us_ = now_us;
+  *batcher_idx = batcher_idx_;
+  *slot = slot_;
+  return true;
+}
+
+bool
+SequenceBinding::LastRouted(
+    const Owner* owner, const CorrelationID correlation_id,
+    uint64_t* last_us)
+{
+  std::lock_guard<std::mutex> lock(mu_);
+  if (!bound_ || (owner_.get() != owner) ||
+      (correlation_id_ != correlation_id)) {
+    return false;
+  }
+
+  *last_us = last_us_;
+  return true;
+}
+
+SequenceBatchScheduler::SequenceBatchScheduler()
+    : binding_owner_(std::make_shared<SequenceBinding::Owner>()),
+      backlog_payload_cnt_(0)
+{
+  binding_owner_->scheduler_ = this;
+}
+
 Status
 SequenceBatchScheduler::Create(
     const ModelConfig& config, const uint32_t runner_cnt,
     StandardInitFunc OnInit, StandardRunFunc OnSchedule,
+    const std::shared_ptr<MetricModelReporter>& metric_reporter,
     std::unique_ptr<Scheduler>* scheduler)
 {
   std::unique_ptr<SequenceBatchScheduler> sched(new SequenceBatchScheduler());
 
+#ifdef TRTIS_ENABLE_METRICS
+  sched->metric_reporter_ = metric_reporter;
+  sched->metric_backlog_sequences_ = nullptr;
+  sched->metric_backlog_requests_ = nullptr;
+  sched->metric_backlog_duration_us_ = nullptr;
+  sched->metric_lifetime_us_ = nullptr;
+  if (metric_reporter != nullptr) {
+    sched->metric_backlog_sequences_ =
+        &metric_reporter->MetricSequenceBacklogSequences();
+    sched->metric_backlog_requests_ =
+        &metric_reporter->MetricSequenceBacklogRequests();
+    sched->metric_backlog_duration_us_ =
+        &metric_reporter->MetricSequenceBacklogDuration();
+    sched->metric_lifetime_us_ = &metric_reporter->MetricSequenceLifetime();
+  }
+#endif  // TRTIS_ENABLE_METRICS
+
   // For debugging and testing,
   const char* dstr = getenv("TRTSERVER_BACKLOG_DELAY_SCHEDULER");
   sched->backlog_delay_cnt_ = 0;
@@ -64,6 +268,18 @@ SequenceBatchScheduler::Create(
   // even if the model doesn't support batching.
   size_t batch_size = std::max(1, config.max_batch_size());
 
+  // With the direct strategy each runner has one slot per batch
+  // entry. With the oldest strategy each runner has one slot per
+  // candidate sequence and batches are formed from a subset of them.
+  size_t slot_cnt = batch_size;
+  if (config.sequence_batching().has_oldest()) {
+    const uint32_t max_candidate_sequences =
+        config.sequence_batching().oldest().max_candidate_sequences();
+    if (max_candidate_sequences > 0) {
+      slot_cnt = max_candidate_sequences;
+    }
+  }
+
   // Based on the model configuration create input tensors for control
   // signals indicating sequence start, sequence continue, and
   // sequence not ready.
@@ -73,19 +289,43 @@ SequenceBatchScheduler::Create(
   RETURN_IF_ERROR(
       sched->CreateControlTensors(config, &start, &cont, &notready));
 
+  // Allocate the zero buffer for the NULL input once, when the model
+  // is loaded, so that slots without a request never allocate or
+  // lock when a batch is formed.
+  std::shared_ptr<const AllocatedSystemMemory> null_input;
+  {
+    const size_t byte_size = NullInputByteSize(config);
+    auto zeros = std::make_shared<AllocatedSystemMemory>(
+        byte_size, TRTSERVER_MEMORY_CPU);
+    TRTSERVER_Memory_Type memory_type;
+    char* buffer = zeros->MutableBuffer(&memory_type);
+    if (buffer == nullptr) {
+      return Status(
+          RequestStatusCode::INTERNAL,
+          "failed to allocate NULL input buffer for sequence batcher of '" +
+              config.name() + "'");
+    }
+    memset(buffer, 0, byte_size);
+    null_input = zeros;
+  }
+
+  // Find the host CPUs that each runner's thread should run on.
+  std::vector<RunnerPlacement> placements;
+  GetRunnerPlacements(config, runner_cnt, &placements);
+
   // Create one SequenceBatch object for each requested runner. The
   // SequenceBatch object has a thread that manages the batch of
   // requests.
   for (uint32_t c = 0; c < runner_cnt; ++c) {
     std::promise<bool> init_state;
     std::shared_ptr<SequenceBatch> sb = std::make_shared<SequenceBatch>(
-        sched.get(), c, batch_size, config, OnInit, OnSchedule, start, cont,
-        notready, &init_state);
+        sched.get(), c, slot_cnt, config, placements[c].host_cpus_, OnInit,
+        OnSchedule, start, cont, notready, null_input, &init_state);
 
     if (init_state.get_future().get()) {
       sched->batchers_.push_back(sb);
       // All slots in the batch are initially ready for a new sequence.
-      for (size_t b = 0; b < batch_size; ++b) {
+      for (size_t b = 0; b < slot_cnt; ++b) {
         sched->ready_batch_slots_.push(SequenceBatchScheduler::BatchSlot(c, b));
       }
     }
@@ -102,7 +342,10 @@ SequenceBatchScheduler::Create(
 
   raw->reaper_thread_exit_ = false;
   raw->reaper_thread_.reset(
-      new std::thread([raw]() { raw->ReaperThread(10 /* nice */); }));
+      new std::thread([raw]() {
+        SetThreadClass(ThreadClass::BACKGROUND);
+        raw->ReaperThread(10 /* nice */);
+      }));
 
   scheduler->reset(raw);
 
@@ -111,6 +354,12 @@ SequenceBatchScheduler::Create(
 
 SequenceBatchScheduler::~SequenceBatchScheduler()
 {
+  // Bindings closed from now on must not use this scheduler.
+  {
+    std::lock_guard<std::mutex> owner_lock(binding_owner_->mu_);
+    binding_owner_->scheduler_ = nullptr;
+  }
+
   // Signal the reaper thread to exit...
   {
     std::unique_lock<std::mutex> lock(mu_);
@@ -266,18 +515,46 @@ SequenceBatchScheduler::Enqueue(
   const bool seq_end =
       ((request_header.flags() & InferRequestHeader::FLAG_SEQUENCE_END) != 0);
 
-  std::unique_lock<std::mutex> lock(mu_);
+  // A request that continues the sequence its stream is bound to is
+  // queued directly into the sequence's slot. The binding records the
+  // request for the reaper. Requests that start or end a sequence
+  // always take the path below since they change the routing state.
+  const auto& binding = request_provider->GetSequenceBinding();
+  if ((binding != nullptr) && !seq_start && !seq_end) {
+    size_t batcher_idx;
+    uint32_t slot;
+    if (binding->Route(
+            binding_owner_.get(), correlation_id, NowMicroseconds(),
+            &batcher_idx, &slot)) {
+      LOG_VERBOSE(1) << "Enqueuing bound sequence inference request for "
+                        "model '"
+                     << request_provider->ModelName() << "' into batcher "
+                     << batcher_idx << ", slot " << slot;
+
+      batchers_[batcher_idx]->Enqueue(
+          slot, correlation_id, stats, request_provider, response_provider,
+          OnComplete);
+      return;
+    }
+  }
 
-  auto sb_itr = sequence_to_batchslot_map_.find(correlation_id);
-  auto bl_itr = sequence_to_backlog_map_.find(correlation_id);
+  // Only the correlation ID's shard needs to be locked unless the
+  // request starts a new sequence.
+  CorrelationShard& shard = Shard(correlation_id);
+  std::unique_lock<std::mutex> lock(shard.mu_);
+
+  BatchSlotMap& sequence_to_batchslot_map = shard.sequence_to_batchslot_map_;
+  BacklogMap& sequence_to_backlog_map = shard.sequence_to_backlog_map_;
+  auto sb_itr = sequence_to_batchslot_map.find(correlation_id);
+  auto bl_itr = sequence_to_backlog_map.find(correlation_id);
 
   // If this request is not starting a new sequence its correlation ID
   // should already be known with a target in either a slot or in the
   // backlog. If it doesn't then the sequence wasn't started correctly
   // or there has been a correlation ID conflict. In either case fail
   // this request.
-  if (!seq_start && (sb_itr == sequence_to_batchslot_map_.end()) &&
-      (bl_itr == sequence_to_backlog_map_.end())) {
+  if (!seq_start && (sb_itr == sequence_to_batchslot_map.end()) &&
+      (bl_itr == sequence_to_backlog_map.end())) {
     OnComplete(Status(
         RequestStatusCode::INVALID_ARG,
         "inference request for sequence " + std::to_string(correlation_id) +
@@ -292,11 +569,15 @@ SequenceBatchScheduler::Enqueue(
   // max_sequence_idle_microseconds value is not exceed for any
   // sequence, and if it is it will release the slot (if any)
   // allocated to that sequence.
+  const uint64_t now_us = NowMicroseconds();
   {
-    struct timespec now;
-    clock_gettime(CLOCK_MONOTONIC, &now);
-    uint64_t now_us = TIMESPEC_TO_NANOS(now) / 1000;
-    correlation_id_timestamps_[correlation_id] = now_us;
+    auto ts = shard.correlation_id_timestamps_.emplace(correlation_id, now_us);
+    if (ts.second) {
+      shard.reaper_deadlines_.emplace(
+          now_us + max_sequence_idle_microseconds_, correlation_id);
+    } else {
+      ts.first->second = now_us;
+    }
   }
 
   // If this request starts a new sequence but the correlation ID
@@ -307,8 +588,8 @@ SequenceBatchScheduler::Enqueue(
   // long as it has a single end. The previous sequence that was not
   // correctly ended will have its existing requests handled and then
   // the new sequence will start.
-  if (seq_start && ((sb_itr != sequence_to_batchslot_map_.end()) ||
-                    (bl_itr != sequence_to_backlog_map_.end()))) {
+  if (seq_start && ((sb_itr != sequence_to_batchslot_map.end()) ||
+                    (bl_itr != sequence_to_backlog_map.end()))) {
     LOG_WARNING
         << "sequence " << correlation_id << " for model '"
         << request_provider->ModelName()
@@ -317,48 +598,70 @@ SequenceBatchScheduler::Enqueue(
   }
 
   // This request already has an assigned slot...
-  if (sb_itr != sequence_to_batchslot_map_.end()) {
+  if (sb_itr != sequence_to_batchslot_map.end()) {
     target = &sb_itr->second;
   }
   // This request already has a queue in the backlog...
-  else if (bl_itr != sequence_to_backlog_map_.end()) {
+  else if (bl_itr != sequence_to_backlog_map.end()) {
     LOG_VERBOSE(1)
         << "Enqueuing sequence inference request into backlog for model '"
         << request_provider->ModelName();
 
     bl_itr->second->emplace_back(
         stats, request_provider, response_provider, OnComplete);
+    backlog_payload_cnt_++;
+#ifdef TRTIS_ENABLE_METRICS
+    if (metric_backlog_requests_ != nullptr) {
+      metric_backlog_requests_->Set(backlog_payload_cnt_);
+    }
+#endif  // TRTIS_ENABLE_METRICS
     // If the sequence is ending then forget correlation ID
     // connection to this backlog queue. If another sequence starts
     // with the same correlation ID it will be collected in another
     // backlog queue.
     if (seq_end) {
-      sequence_to_backlog_map_.erase(bl_itr);
+      sequence_to_backlog_map.erase(bl_itr);
+      UnbindSequence(&shard, correlation_id);
+    } else if (seq_start && (binding != nullptr)) {
+      BindSequence(&shard, correlation_id, binding, nullptr);
     }
     return;
   }
   // This request does not have an assigned backlog or slot. By the
   // above checks it must be starting. If there is a free slot
-  // available then assign this sequence to that slot...
-  else if (!ready_batch_slots_.empty()) {
-    target = &sequence_to_batchslot_map_[correlation_id];
-    *target = ready_batch_slots_.top();
-    ready_batch_slots_.pop();
-  }
-  // Last option is to assign this request to the backlog...
+  // available then assign this sequence to that slot, otherwise
+  // assign it to the backlog. Both require the scheduler lock.
   else {
-    LOG_VERBOSE(1)
-        << "Enqueuing sequence inference request into new backlog for model '"
-        << request_provider->ModelName();
-
-    auto backlog = std::make_shared<std::deque<Scheduler::Payload>>();
-    backlog_queues_.push_back(backlog);
-    backlog->emplace_back(
-        stats, request_provider, response_provider, OnComplete);
-    if (!seq_end) {
-      sequence_to_backlog_map_[correlation_id] = std::move(backlog);
+    std::lock_guard<std::mutex> assign_lock(mu_);
+    if (!ready_batch_slots_.empty()) {
+      target = &sequence_to_batchslot_map[correlation_id];
+      *target = ready_batch_slots_.top();
+      ready_batch_slots_.pop();
+    } else {
+      LOG_VERBOSE(1) << "Enqueuing sequence inference request into new "
+                        "backlog for model '"
+                     << request_provider->ModelName();
+
+      auto backlog = std::make_shared<std::deque<Scheduler::Payload>>();
+      backlog_queues_.push_back(
+          BacklogSequence{correlation_id, backlog, now_us});
+      backlog->emplace_back(
+          stats, request_provider, response_provider, OnComplete);
+      backlog_payload_cnt_++;
+#ifdef TRTIS_ENABLE_METRICS
+      if (metric_backlog_sequences_ != nullptr) {
+        metric_backlog_sequences_->Set(backlog_queues_.size());
+        metric_backlog_requests_->Set(backlog_payload_cnt_);
+      }
+#endif  // TRTIS_ENABLE_METRICS
+      if (!seq_end) {
+        sequence_to_backlog_map[correlation_id] = std::move(backlog);
+        if (binding != nullptr) {
+          BindSequence(&shard, correlation_id, binding, nullptr);
+        }
+      }
+      return;
     }
-    return;
   }
 
   // Need to grab the target contents before the erase below since
@@ -367,9 +670,14 @@ SequenceBatchScheduler::Enqueue(
   const uint32_t slot = target->slot_;
 
   // At this point the request has been assigned to a slot. If the
-  // sequence is ending then stop tracking the correlation.
+  // sequence is ending then stop tracking the correlation. If it is
+  // starting then bind the request's stream to the slot.
   if (seq_end) {
-    sequence_to_batchslot_map_.erase(correlation_id);
+    sequence_to_batchslot_map.erase(correlation_id);
+    UnbindSequence(&shard, correlation_id);
+  } else if (seq_start && (binding != nullptr)) {
+    const BatchSlot batch_slot(batcher_idx, slot);
+    BindSequence(&shard, correlation_id, binding, &batch_slot);
   }
 
   // Enqueue request into batcher and slot.  No need to hold the lock
@@ -389,53 +697,118 @@ bool
 SequenceBatchScheduler::ReleaseBatchSlot(
     const BatchSlot& batch_slot, std::deque<Scheduler::Payload>* payloads)
 {
-  std::unique_lock<std::mutex> lock(mu_);
+  CorrelationID correlation_id;
+  Backlog backlog;
 
-  // If there is a backlogged sequence and it is requested, return it
-  // so that it can use the newly available slot.
-  if (!backlog_queues_.empty()) {
-    auto& backlog = backlog_queues_.front();
-    *payloads = std::move(*backlog);
+  // If there is a backlogged sequence, return it so that it can use
+  // the newly available slot. Otherwise just release the batch slot.
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (backlog_queues_.empty()) {
+      LOG_VERBOSE(1) << "Freeing slot in batcher " << batch_slot.batcher_idx_
+                     << ", slot " << batch_slot.slot_;
+
+      ready_batch_slots_.push(batch_slot);
+      return true;
+    }
+
+    correlation_id = backlog_queues_.front().correlation_id_;
+    backlog = std::move(backlog_queues_.front().queue_);
+#ifdef TRTIS_ENABLE_METRICS
+    if (metric_backlog_sequences_ != nullptr) {
+      metric_backlog_duration_us_->Observe(
+          NowMicroseconds() - backlog_queues_.front().enqueue_us_);
+      metric_backlog_sequences_->Set(backlog_queues_.size() - 1);
+    }
+#endif  // TRTIS_ENABLE_METRICS
     backlog_queues_.pop_front();
-    if (!payloads->empty()) {  // should never be empty...
-      const auto& request_provider = payloads->back().request_provider_;
-      const auto& request_header = request_provider->RequestHeader();
-      const CorrelationID correlation_id = request_header.correlation_id();
-
-      // If the last queue entry is not an END request then the entire
-      // sequence is not contained in the backlog. In that case must
-      // update backlog and batchslot maps so that future requests get
-      // directed to the batch slot instead of the backlog.
-      const bool seq_end =
-          ((request_header.flags() & InferRequestHeader::FLAG_SEQUENCE_END) !=
-           0);
-      if (!seq_end) {
-        // Since the correlation ID is being actively collected in the
-        // backlog, there should not be any in-flight sequences with
-        // that same correlation ID that have an assigned slot.
-        if (sequence_to_batchslot_map_.find(correlation_id) !=
-            sequence_to_batchslot_map_.end()) {
-          LOG_ERROR << "internal: backlog sequence " << correlation_id
-                    << " conflicts with in-flight sequence for model '"
-                    << request_provider->ModelName() << "'";
-        }
+  }
 
-        sequence_to_backlog_map_.erase(correlation_id);
-        sequence_to_batchslot_map_[correlation_id] = batch_slot;
-      }
+  // Requests for the sequence may still be arriving in the backlog
+  // queue, so the queue is moved to the slot while holding the
+  // correlation ID's shard lock. If the sequence is still being
+  // collected in the backlog then the backlog and batchslot maps must
+  // be updated so that future requests get directed to the batch slot
+  // instead of the backlog. The caller holds the batcher's lock until
+  // 'payloads' is in the slot, so those future requests stay ordered
+  // after the backlogged ones.
+  CorrelationShard& shard = Shard(correlation_id);
+  std::lock_guard<std::mutex> shard_lock(shard.mu_);
+
+  *payloads = std::move(*backlog);
+  backlog_payload_cnt_ -= payloads->size();
+#ifdef TRTIS_ENABLE_METRICS
+  if (metric_backlog_requests_ != nullptr) {
+    metric_backlog_requests_->Set(backlog_payload_cnt_);
+  }
+#endif  // TRTIS_ENABLE_METRICS
+
+  auto bl_itr = shard.sequence_to_backlog_map_.find(correlation_id);
+  if ((bl_itr != shard.sequence_to_backlog_map_.end()) &&
+      (bl_itr->second == backlog)) {
+    // Since the correlation ID is being actively collected in the
+    // backlog, there should not be any in-flight sequences with that
+    // same correlation ID that have an assigned slot.
+    if (shard.sequence_to_batchslot_map_.find(correlation_id) !=
+        shard.sequence_to_batchslot_map_.end()) {
+      LOG_ERROR << "internal: backlog sequence " << correlation_id
+                << " conflicts with in-flight sequence";
+    }
 
-      LOG_VERBOSE(1) << "Reusing slot in batcher " << batch_slot.batcher_idx_
-                     << ", slot " << batch_slot.slot_ << " for sequence "
-                     << correlation_id;
-      return false;
+    shard.sequence_to_backlog_map_.erase(bl_itr);
+    shard.sequence_to_batchslot_map_[correlation_id] = batch_slot;
+
+    auto bd_itr = shard.bindings_.find(correlation_id);
+    if (bd_itr != shard.bindings_.end()) {
+      bd_itr->second->SetSlot(
+          binding_owner_.get(), correlation_id, batch_slot.batcher_idx_,
+          batch_slot.slot_);
     }
   }
 
-  // There is no backlogged sequence so just release the batch slot
-  LOG_VERBOSE(1) << "Freeing slot in batcher " << batch_slot.batcher_idx_
-                 << ", slot " << batch_slot.slot_;
+  LOG_VERBOSE(1) << "Reusing slot in batcher " << batch_slot.batcher_idx_
+                 << ", slot " << batch_slot.slot_ << " for sequence "
+                 << correlation_id;
+  return false;
+}
+
+bool
+SequenceBatchScheduler::CompactBatchSlot(
+    const BatchSlot& from, const BatchSlot& to,
+    const CorrelationID correlation_id)
+{
+  CorrelationShard& shard = Shard(correlation_id);
+  std::lock_guard<std::mutex> shard_lock(shard.mu_);
+  std::lock_guard<std::mutex> lock(mu_);
+
+  // A backlogged sequence should get the freed slot instead.
+  if (!backlog_queues_.empty()) {
+    return false;
+  }
 
-  ready_batch_slots_.push(batch_slot);
+  // The sequence may have ended, or been ended by the reaper, since
+  // the batcher looked at it.
+  auto sb_itr = shard.sequence_to_batchslot_map_.find(correlation_id);
+  if ((sb_itr == shard.sequence_to_batchslot_map_.end()) ||
+      (sb_itr->second.batcher_idx_ != from.batcher_idx_) ||
+      (sb_itr->second.slot_ != from.slot_)) {
+    return false;
+  }
+
+  LOG_VERBOSE(1) << "Moving sequence " << correlation_id << " in batcher "
+                 << from.batcher_idx_ << " from slot " << from.slot_
+                 << " to slot " << to.slot_;
+
+  sb_itr->second = to;
+  ready_batch_slots_.push(from);
+
+  // A request routed through the binding to the old slot just before
+  // the move is redirected by the batcher.
+  auto bd_itr = shard.bindings_.find(correlation_id);
+  if (bd_itr != shard.bindings_.end()) {
+    bd_itr->second->SetSlot(
+        binding_owner_.get(), correlation_id, to.batcher_idx_, to.slot_);
+  }
   return true;
 }
 
@@ -455,18 +828,189 @@ SequenceBatchScheduler::DelayScheduler(
     return true;
   }
 
-  if (backlog_delay_cnt_ > 0) {
-    size_t backlog_seen = 0;
-    for (const auto& q : backlog_queues_) {
-      backlog_seen += q->size();
+  if ((backlog_delay_cnt_ > 0) &&
+      (backlog_payload_cnt_ < backlog_delay_cnt_)) {
+    return true;
+  }
+
+  return false;
+}
+
+uint64_t
+SequenceBatchScheduler::ReapShard(
+    CorrelationShard* shard, const uint64_t now_us,
+    std::vector<std::pair<BatchSlot, CorrelationID>>* force_ends)
+{
+  const uint64_t backlog_idle_wait_microseconds = 50 * 1000;
+  uint64_t wait_microseconds = max_sequence_idle_microseconds_;
+
+  // Visit only the correlation IDs whose deadline has passed. A
+  // correlation ID seen again since its deadline was set is re-armed
+  // with a deadline based on the newer timestamp, so each correlation
+  // ID has exactly one entry in 'reaper_deadlines_'.
+  auto& deadlines = shard->reaper_deadlines_;
+  auto& timestamps = shard->correlation_id_timestamps_;
+  while (!deadlines.empty()) {
+    const uint64_t deadline_us = deadlines.top().first;
+    if (deadline_us > now_us) {
+      wait_microseconds = std::min(wait_microseconds, deadline_us - now_us + 1);
+      break;
     }
 
-    if (backlog_seen < backlog_delay_cnt_) {
-      return true;
+    const CorrelationID idle_correlation_id = deadlines.top().second;
+    deadlines.pop();
+
+    auto cid_itr = timestamps.find(idle_correlation_id);
+    if (cid_itr == timestamps.end()) {
+      continue;
+    }
+
+    // Requests routed through a sequence binding are recorded in the
+    // binding instead of in 'timestamps'.
+    auto bd_itr = shard->bindings_.find(idle_correlation_id);
+    if (bd_itr != shard->bindings_.end()) {
+      uint64_t last_us;
+      if (bd_itr->second->LastRouted(
+              binding_owner_.get(), idle_correlation_id, &last_us)) {
+        cid_itr->second = std::max(cid_itr->second, last_us);
+      }
+    }
+
+    const uint64_t idle_deadline_us =
+        cid_itr->second + max_sequence_idle_microseconds_;
+    if (idle_deadline_us > now_us) {
+      deadlines.emplace(idle_deadline_us, idle_correlation_id);
+      continue;
+    }
+
+    LOG_VERBOSE(1) << "Max sequence idle exceeded for sequence "
+                   << idle_correlation_id;
+
+    auto idle_sb_itr =
+        shard->sequence_to_batchslot_map_.find(idle_correlation_id);
+
+    // If the idle correlation ID has an assigned slot, then release
+    // that assignment so it becomes available for another sequence. An
+    // assignment is released by enqueuing a payload with null
+    // providers and null completion callback. The scheduler thread
+    // will interpret the payload as meaning it should release the slot
+    // but otherwise do nothing with the payload.
+    if (idle_sb_itr != shard->sequence_to_batchslot_map_.end()) {
+      LOG_VERBOSE(1) << "reaper enqueuing force-end in batcher "
+                     << idle_sb_itr->second.batcher_idx_ << ", slot "
+                     << idle_sb_itr->second.slot_ << " for sequence "
+                     << idle_correlation_id;
+
+      force_ends->emplace_back(idle_sb_itr->second, idle_correlation_id);
+      shard->sequence_to_batchslot_map_.erase(idle_sb_itr);
+      timestamps.erase(cid_itr);
+      UnbindSequence(shard, idle_correlation_id);
+    } else {
+      // If the idle correlation ID is in the backlog, then just need
+      // to increase the timeout so that we revisit it again in the
+      // future to check if it is assigned to a slot.
+      auto idle_bl_itr =
+          shard->sequence_to_backlog_map_.find(idle_correlation_id);
+      if (idle_bl_itr != shard->sequence_to_backlog_map_.end()) {
+        LOG_VERBOSE(1) << "reaper found idle sequence in backlog so "
+                          "extending timeout for sequence "
+                       << idle_correlation_id;
+        deadlines.emplace(
+            now_us + backlog_idle_wait_microseconds, idle_correlation_id);
+        wait_microseconds =
+            std::min(wait_microseconds, backlog_idle_wait_microseconds);
+      } else {
+        LOG_VERBOSE(1) << "ignoring stale idle for sequence "
+                       << idle_correlation_id;
+        timestamps.erase(cid_itr);
+        UnbindSequence(shard, idle_correlation_id);
+      }
     }
   }
 
-  return false;
+  return wait_microseconds;
+}
+
+void
+SequenceBatchScheduler::BindSequence(
+    CorrelationShard* shard, const CorrelationID correlation_id,
+    const std::shared_ptr<SequenceBinding>& binding,
+    const BatchSlot* batch_slot)
+{
+  auto& bound = shard->bindings_[correlation_id];
+  if ((bound != nullptr) && (bound != binding)) {
+    bound->Unbind(binding_owner_.get(), correlation_id);
+  }
+
+  bound = binding;
+  if (batch_slot == nullptr) {
+    binding->Bind(binding_owner_, correlation_id, false, 0, 0);
+  } else {
+    binding->Bind(
+        binding_owner_, correlation_id, true, batch_slot->batcher_idx_,
+        batch_slot->slot_);
+  }
+}
+
+void
+SequenceBatchScheduler::UnbindSequence(
+    CorrelationShard* shard, const CorrelationID correlation_id)
+{
+  auto bd_itr = shard->bindings_.find(correlation_id);
+  if (bd_itr != shard->bindings_.end()) {
+    bd_itr->second->Unbind(binding_owner_.get(), correlation_id);
+    shard->bindings_.erase(bd_itr);
+  }
+}
+
+void
+SequenceBatchScheduler::EndBoundSequence(
+    SequenceBinding* binding, const CorrelationID correlation_id)
+{
+  CorrelationShard& shard = Shard(correlation_id);
+  std::unique_lock<std::mutex> lock(shard.mu_);
+
+  // The sequence may already have ended, or the binding may have been
+  // replaced by the binding of a later START.
+  auto bd_itr = shard.bindings_.find(correlation_id);
+  if ((bd_itr == shard.bindings_.end()) || (bd_itr->second.get() != binding)) {
+    return;
+  }
+  shard.bindings_.erase(bd_itr);
+
+  LOG_VERBOSE(1) << "Ending sequence " << correlation_id
+                 << " since its stream closed";
+
+  // A sequence waiting in the backlog is ended by a force-end payload
+  // after its requests, which releases its slot once it gets one.
+  auto bl_itr = shard.sequence_to_backlog_map_.find(correlation_id);
+  if (bl_itr != shard.sequence_to_backlog_map_.end()) {
+    bl_itr->second->emplace_back(nullptr, nullptr, nullptr, nullptr);
+    backlog_payload_cnt_++;
+#ifdef TRTIS_ENABLE_METRICS
+    if (metric_backlog_requests_ != nullptr) {
+      metric_backlog_requests_->Set(backlog_payload_cnt_);
+    }
+#endif  // TRTIS_ENABLE_METRICS
+    shard.sequence_to_backlog_map_.erase(bl_itr);
+    return;
+  }
+
+  auto sb_itr = shard.sequence_to_batchslot_map_.find(correlation_id);
+  if (sb_itr == shard.sequence_to_batchslot_map_.end()) {
+    return;
+  }
+
+  // Force-end the sequence the same way the reaper does. The payload
+  // is enqueued without holding the shard lock since the batcher may
+  // itself be waiting for it.
+  const BatchSlot batch_slot = sb_itr->second;
+  shard.sequence_to_batchslot_map_.erase(sb_itr);
+  shard.correlation_id_timestamps_.erase(correlation_id);
+  lock.unlock();
+
+  batchers_[batch_slot.batcher_idx_]->Enqueue(
+      batch_slot.slot_, correlation_id, nullptr, nullptr, nullptr, nullptr);
 }
 
 void
@@ -481,84 +1025,41 @@ SequenceBatchScheduler::ReaperThread(const int nice)
                    << nice << " failed)...";
   }
 
-  const uint64_t backlog_idle_wait_microseconds = 50 * 1000;
+  // The force-end payloads to enqueue once the shard locks are
+  // released.
+  std::vector<std::pair<BatchSlot, CorrelationID>> force_ends;
 
   while (!reaper_thread_exit_) {
-    std::unique_lock<std::mutex> lock(mu_);
-
     uint64_t wait_microseconds = max_sequence_idle_microseconds_;
 
-    struct timespec now;
-    clock_gettime(CLOCK_MONOTONIC, &now);
-    uint64_t now_us = TIMESPEC_TO_NANOS(now) / 1000;
+    // Each shard is locked only while its expired correlation IDs are
+    // handled, so requests for other shards are not blocked.
+    for (auto& shard : shards_) {
+      std::lock_guard<std::mutex> shard_lock(shard.mu_);
 
-    for (auto cid_itr = correlation_id_timestamps_.cbegin();
-         cid_itr != correlation_id_timestamps_.cend();) {
-      int64_t remaining_microseconds =
-          (int64_t)max_sequence_idle_microseconds_ - (now_us - cid_itr->second);
-      if (remaining_microseconds > 0) {
-        wait_microseconds =
-            std::min(wait_microseconds, (uint64_t)remaining_microseconds + 1);
-        ++cid_itr;
-        continue;
-      }
-
-      const CorrelationID idle_correlation_id = cid_itr->first;
-      LOG_VERBOSE(1) << "Max sequence idle exceeded for sequence "
-                     << idle_correlation_id;
-
-      auto idle_sb_itr = sequence_to_batchslot_map_.find(idle_correlation_id);
-
-      // If the idle correlation ID has an assigned slot, then release
-      // that assignment so it becomes available for another
-      // sequence. An assignment is released by enqueuing a payload
-      // with null providers and null completion callback. The
-      // scheduler thread will interpret the payload as meaning it
-      // should release the slot but otherwise do nothing with the
-      // payload.
-      if (idle_sb_itr != sequence_to_batchslot_map_.end()) {
-        // Need to grab the contents before the erase below since that
-        // can free it.
-        const size_t batcher_idx = idle_sb_itr->second.batcher_idx_;
-        const uint32_t slot = idle_sb_itr->second.slot_;
-
-        LOG_VERBOSE(1) << "reaper enqueuing force-end in batcher "
-                       << batcher_idx << ", slot " << slot << " for sequence "
-                       << idle_correlation_id;
-
-
-        sequence_to_batchslot_map_.erase(idle_correlation_id);
+      wait_microseconds = std::min(
+          wait_microseconds,
+          ReapShard(&shard, NowMicroseconds(), &force_ends));
+    }
 
-        batchers_[batcher_idx]->Enqueue(
-            slot, idle_correlation_id, nullptr, nullptr, nullptr, nullptr);
-        cid_itr = correlation_id_timestamps_.erase(cid_itr);
-      } else {
-        // If the idle correlation ID is in the backlog, then just
-        // need to increase the timeout so that we revisit it again
-        // in the future to check if it is assigned to a slot.
-        auto idle_bl_itr = sequence_to_backlog_map_.find(idle_correlation_id);
-        if (idle_bl_itr != sequence_to_backlog_map_.end()) {
-          LOG_VERBOSE(1) << "reaper found idle sequence in backlog so "
-                            "extending timeout for sequence "
-                         << idle_correlation_id;
-          wait_microseconds =
-              std::min(wait_microseconds, backlog_idle_wait_microseconds);
-          ++cid_itr;
-        } else {
-          LOG_VERBOSE(1) << "ignoring stale idle for sequence "
-                         << idle_correlation_id;
-          cid_itr = correlation_id_timestamps_.erase(cid_itr);
-        }
-      }
+    // The force-end payloads are enqueued without holding any
+    // scheduler lock since the batcher may itself be waiting for one.
+    for (const auto& force_end : force_ends) {
+      batchers_[force_end.first.batcher_idx_]->Enqueue(
+          force_end.first.slot_, force_end.second, nullptr, nullptr, nullptr,
+          nullptr);
     }
 
     // Wait until the next idle timeout needs to be checked
-    if (wait_microseconds > 0) {
+    std::unique_lock<std::mutex> lock(mu_);
+    if (force_ends.empty() && (wait_microseconds > 0) &&
+        !reaper_thread_exit_) {
       LOG_VERBOSE(1) << "Sequence-batch reaper sleeping for "
                      << wait_microseconds << "us...";
       std::chrono::microseconds wait_timeout(wait_microseconds);
       reaper_cv_.wait_for(lock, wait_timeout);
     }
+    force_ends.clear();
   }
 
   LOG_VERBOSE(1) << "Stopping sequence-batch reaper thread...";
@@ -567,7 +1068,8 @@ SequenceBatchScheduler::ReaperThread(const int nice)
 
 SequenceBatchScheduler::SequenceBatch::SequenceBatch(
     SequenceBatchScheduler* base, const uint32_t batcher_idx,
-    const size_t batch_size, const ModelConfig& config, StandardInitFunc OnInit,
+    const size_t slot_cnt, const ModelConfig& config,
+    const std::vector<int>& host_cpus, StandardInitFunc OnInit,
     StandardRunFunc OnSchedule,
     const std::shared_ptr<InferRequestProvider::InputOverrideMap>&
         start_input_overrides,
@@ -575,21 +1077,62 @@ SequenceBatchScheduler::SequenceBatch::SequenceBatch(
         continue_input_overrides,
     const std::shared_ptr<InferRequestProvider::InputOverrideMap>&
         notready_input_overrides,
+    const std::shared_ptr<const AllocatedSystemMemory>& null_input,
     std::promise<bool>* is_initialized)
     : OnInit_(OnInit), OnSchedule_(OnSchedule), base_(base),
-      batcher_idx_(batcher_idx), scheduler_thread_exit_(false),
-      scheduler_idle_(false), queues_(batch_size), max_active_slot_(-1),
-      slot_correlation_ids_(batch_size, 0),
+      batcher_idx_(batcher_idx),
+      oldest_(config.sequence_batching().has_oldest()),
+      compact_slots_(
+          config.sequence_batching().has_direct() &&
+          config.sequence_batching().direct().compact_slots()),
+      max_batch_size_(std::max(1, config.max_batch_size())),
+      scheduler_thread_exit_(false), scheduler_idle_(false), queues_(slot_cnt),
+      max_active_slot_(-1), slot_correlation_ids_(slot_cnt, 0),
+      slot_orders_(slot_cnt, 0), next_order_(0), slot_start_us_(slot_cnt, 0),
+      active_slot_cnt_(0),
       start_input_overrides_(start_input_overrides),
       continue_input_overrides_(continue_input_overrides),
-      notready_input_overrides_(notready_input_overrides)
+      notready_input_overrides_(notready_input_overrides),
+      null_input_(null_input), slot_states_(slot_cnt)
 {
+  // Each implicit state starts as all zeros. Not-ready slots are
+  // given the initial state so that every entry in a batch has the
+  // same inputs.
+  if (config.sequence_batching().state_size() > 0) {
+    notready_input_overrides_ =
+        std::make_shared<InferRequestProvider::InputOverrideMap>(
+            *notready_input_overrides);
+    for (const auto& sc : config.sequence_batching().state()) {
+      State state;
+      state.input_name_ = sc.input_name();
+      state.output_name_ = sc.output_name();
+      state.initial_ = std::make_shared<InferRequestProvider::InputOverride>();
+      state.initial_->content_.resize(
+          GetByteSize(sc.data_type(), sc.dims()), 0);
+      state.initial_->dims_ = sc.dims();
+      state.initial_->datatype_ = sc.data_type();
+      notready_input_overrides_->insert(
+          std::make_pair(state.input_name_, state.initial_));
+      states_.push_back(std::move(state));
+    }
+  }
+
+#ifdef TRTIS_ENABLE_METRICS
+  metric_active_slots_ = nullptr;
+  if (base_->metric_reporter_ != nullptr) {
+    metric_active_slots_ =
+        &base_->metric_reporter_->MetricSequenceActiveSlots(batcher_idx_);
+    metric_active_slots_->Set(0);
+  }
+#endif  // TRTIS_ENABLE_METRICS
+
   // Create a scheduler thread associated with 'batcher_idx' that
   // executes the queued payloads.
   const int nice = GetCpuNiceLevel(config);
-  scheduler_thread_.reset(new std::thread([this, nice, is_initialized]() {
-    SchedulerThread(nice, is_initialized);
-  }));
+  scheduler_thread_.reset(
+      new std::thread([this, nice, host_cpus, is_initialized]() {
+        SchedulerThread(nice, host_cpus, is_initialized);
+      }));
 }
 
 SequenceBatchScheduler::SequenceBatch::~SequenceBatch()
@@ -606,7 +1149,7 @@ SequenceBatchScheduler::SequenceBatch::~SequenceBatch()
 
 void
 SequenceBatchScheduler::SequenceBatch::Enqueue(
-    const uint32_t slot, const CorrelationID correlation_id,
+    uint32_t slot, const CorrelationID correlation_id,
     const std::shared_ptr<ModelInferStats>& stats,
     const std::shared_ptr<InferRequestProvider>& request_provider,
     const std::shared_ptr<InferResponseProvider>& response_provider,
@@ -617,20 +1160,51 @@ SequenceBatchScheduler::SequenceBatch::Enqueue(
   {
     std::lock_guard<std::mutex> lock(mu_);
 
+    // A request routed to a slot just before its sequence was moved
+    // by compaction belongs in the sequence's new slot. Once the
+    // sequence ends no more requests can be routed to the old slot.
+    if (!compacted_slots_.empty()) {
+      auto itr = compacted_slots_.find(correlation_id);
+      if (itr != compacted_slots_.end()) {
+        if (itr->second.first == slot) {
+          slot = itr->second.second;
+        }
+        if ((request_provider == nullptr) ||
+            ((request_provider->RequestHeader().flags() &
+              InferRequestHeader::FLAG_SEQUENCE_END) != 0)) {
+          compacted_slots_.erase(itr);
+        }
+      }
+    }
+
     // All requests in this SequenceBatch must have the same shape for
     // all inputs (since they are going to be executed together in a
     // batch). If this is the first request into this SequenceBatch
-    // then grab a copy of the request header that is needed to create
+    // then grab a reference to the request header that is needed to create
     // NULL version request providers that can stand in as
     // representative when inference is issuing and there is no
     // request available in one or more slots.
     if ((max_active_slot_ == -1) && (request_provider != nullptr)) {
-      null_request_header_ = request_provider->RequestHeader();
+      null_request_header_ = request_provider->SharedRequestHeader();
     }
 
     queues_[slot].emplace_back(
         stats, request_provider, response_provider, OnComplete);
 
+    // A request for a sequence not yet seen in this slot, or one that
+    // restarts the sequence, makes the slot's sequence the youngest.
+    if ((request_provider != nullptr) &&
+        ((slot_correlation_ids_[slot] != correlation_id) ||
+         ((request_provider->RequestHeader().flags() &
+           InferRequestHeader::FLAG_SEQUENCE_START) != 0))) {
+      slot_orders_[slot] = next_order_++;
+      slot_start_us_[slot] = NowMicroseconds();
+    }
+
+    if (slot_correlation_ids_[slot] == 0) {
+      active_slot_cnt_++;
+      ReportActiveSlots();
+    }
     slot_correlation_ids_[slot] = correlation_id;
     max_active_slot_ = std::max(max_active_slot_, static_cast<int32_t>(slot));
 
@@ -645,9 +1219,205 @@ SequenceBatchScheduler::SequenceBatch::Enqueue(
   }
 }
 
+void
+SequenceBatchScheduler::SequenceBatch::ReportActiveSlots()
+{
+#ifdef TRTIS_ENABLE_METRICS
+  if (metric_active_slots_ != nullptr) {
+    metric_active_slots_->Set(active_slot_cnt_);
+  }
+#endif  // TRTIS_ENABLE_METRICS
+}
+
+void
+SequenceBatchScheduler::SequenceBatch::RemoveCancelled(
+    const int32_t slot, std::vector<Scheduler::Payload>* cancelled)
+{
+  std::deque<Scheduler::Payload>& queue = queues_[slot];
+  while (!queue.empty()) {
+    const auto& request_provider = queue.front().request_provider_;
+    if ((request_provider == nullptr) ||
+        ((request_provider->RequestHeader().flags() &
+          (InferRequestHeader::FLAG_SEQUENCE_START |
+           InferRequestHeader::FLAG_SEQUENCE_END)) != 0) ||
+        !request_provider->IsCancelled()) {
+      break;
+    }
+
+    cancelled->emplace_back(std::move(queue.front()));
+    queue.pop_front();
+  }
+}
+
+void
+SequenceBatchScheduler::SequenceBatch::EndSequence(
+    const int32_t slot, bool* adjust_max_active_slot)
+{
+  LOG_VERBOSE(1) << "Ending sequence in batcher " << batcher_idx_ << ", slot "
+                 << slot;
+
+  // Should never be anything in a queue after the END marker. If it
+  // happens that means we will clobber that request if/when we swap
+  // in a backlog sequence in ReleaseBatchSlot below.
+  std::deque<Scheduler::Payload>& queue = queues_[slot];
+  if (!queue.empty()) {
+    LOG_ERROR << "internal: unexpected requests after sequence end in slot "
+              << slot;
+  }
+
+  const uint64_t now_us = NowMicroseconds();
+#ifdef TRTIS_ENABLE_METRICS
+  if (base_->metric_lifetime_us_ != nullptr) {
+    base_->metric_lifetime_us_->Observe(now_us - slot_start_us_[slot]);
+  }
+#endif  // TRTIS_ENABLE_METRICS
+
+  // The implicit state of the ended sequence is no longer needed.
+  slot_states_[slot].clear();
+
+  SequenceBatchScheduler::BatchSlot batch_slot(batcher_idx_, slot);
+
+  // When compacting, give the freed slot to the sequence in the
+  // highest active slot instead. That sequence has no request in the
+  // batch being formed (slots are visited in increasing order) so
+  // this is a step boundary for it and its state can move with it.
+  // The caller adjusts max_active_slot_ once all slots are processed.
+  if (compact_slots_ && queue.empty() && (max_active_slot_ > slot) &&
+      (slot_correlation_ids_[max_active_slot_] != 0)) {
+    const int32_t from = max_active_slot_;
+    const CorrelationID correlation_id = slot_correlation_ids_[from];
+    if (base_->CompactBatchSlot(
+            SequenceBatchScheduler::BatchSlot(batcher_idx_, from), batch_slot,
+            correlation_id)) {
+      queue.swap(queues_[from]);
+      slot_correlation_ids_[slot] = correlation_id;
+      slot_correlation_ids_[from] = 0;
+      slot_orders_[slot] = slot_orders_[from];
+      slot_start_us_[slot] = slot_start_us_[from];
+      slot_states_[slot].swap(slot_states_[from]);
+      compacted_slots_[correlation_id] = std::make_pair(from, slot);
+      active_slot_cnt_--;
+      ReportActiveSlots();
+      *adjust_max_active_slot = true;
+      return;
+    }
+  }
+
+  // Attempt to refill the slot with a sequence from the backlog. If
+  // there is no backlog show that the slot is no longer active, and
+  // if it is currently the maximum active slot note that the caller
+  // needs to adjust max_active_slot_ once all slots are processed
+  // (processing is deferred because multiple slots could have ending
+  // sequences).
+  bool released = base_->ReleaseBatchSlot(batch_slot, &queue);
+  if (released) {
+    slot_correlation_ids_[slot] = 0;
+    active_slot_cnt_--;
+    ReportActiveSlots();
+    if (slot == max_active_slot_) {
+      *adjust_max_active_slot = true;
+    }
+  } else if (!queue.empty()) {
+    // The backlogged sequence now in the slot is younger than every
+    // other sequence in the batcher.
+    slot_correlation_ids_[slot] =
+        queue.front().request_provider_->RequestHeader().correlation_id();
+    slot_orders_[slot] = next_order_++;
+    slot_start_us_[slot] = now_us;
+  }
+}
+
+std::shared_ptr<InferRequestProvider::InputOverrideMap>
+SequenceBatchScheduler::SequenceBatch::InputOverrides(
+    const int32_t slot,
+    const std::shared_ptr<InferRequestProvider::InputOverrideMap>& controls,
+    const bool start)
+{
+  if (states_.empty()) {
+    return controls;
+  }
+
+  auto overrides =
+      std::make_shared<InferRequestProvider::InputOverrideMap>(*controls);
+  const auto& values = slot_states_[slot];
+  for (size_t i = 0; i < states_.size(); ++i) {
+    const bool use_initial = start || values.empty();
+    overrides->insert(std::make_pair(
+        states_[i].input_name_,
+        use_initial ? states_[i].initial_ : values[i]));
+  }
+
+  return overrides;
+}
+
+void
+SequenceBatchScheduler::SequenceBatch::RequireStateOutputs(
+    const Scheduler::Payload& payload)
+{
+  for (const auto& state : states_) {
+    payload.request_provider_->AddImplicitOutput(state.output_name_);
+    if (payload.response_provider_ != nullptr) {
+      payload.response_provider_->AddImplicitOutput(state.output_name_);
+    }
+  }
+}
+
+void
+SequenceBatchScheduler::SequenceBatch::SaveState(
+    const int32_t slot, const Scheduler::Payload& payload)
+{
+  std::vector<std::shared_ptr<InferRequestProvider::InputOverride>> values;
+  for (const auto& state : states_) {
+    const size_t expected_byte_size = state.initial_->content_.size();
+    auto value = std::make_shared<InferRequestProvider::InputOverride>();
+    value->dims_ = state.initial_->dims_;
+    value->datatype_ = state.initial_->datatype_;
+
+    // The state output is normally an implicit output whose buffer is
+    // owned by the response provider, so the new state can reference
+    // it, wherever it is, instead of copying it. If the client also
+    // requested the output the buffer belongs to the client and must
+    // be copied.
+    Status status;
+    std::shared_ptr<SystemMemory> memory;
+    if (payload.response_provider_
+            ->OutputBufferMemory(state.output_name_, &memory)
+            .IsOk()) {
+      if (memory->TotalByteSize() != expected_byte_size) {
+        status = Status(
+            RequestStatusCode::INTERNAL,
+            "unexpected size " + std::to_string(memory->TotalByteSize()) +
+                " for state output '" + state.output_name_ +
+                "', expecting " + std::to_string(expected_byte_size));
+      } else {
+        value->memory_ = std::move(memory);
+      }
+    } else {
+      status = CopyStateOutput(
+          state.output_name_, expected_byte_size, *payload.response_provider_,
+          value.get());
+    }
+
+    // The sequence keeps its previous state if the new state can't be
+    // saved.
+    if (!status.IsOk()) {
+      LOG_ERROR << "Failed to save state for sequence in batcher "
+                << batcher_idx_ << ", slot " << slot << ": "
+                << status.Message();
+      return;
+    }
+
+    values.push_back(std::move(value));
+  }
+
+  std::lock_guard<std::mutex> lock(mu_);
+  slot_states_[slot].swap(values);
+}
+
 void
 SequenceBatchScheduler::SequenceBatch::SchedulerThread(
-    const int nice, std::promise<bool>* is_initialized)
+    const int nice, const std::vector<int>& host_cpus,
+    std::promise<bool>* is_initialized)
 {
   if (setpriority(PRIO_PROCESS, syscall(SYS_gettid), nice) == 0) {
     LOG_VERBOSE(1) << "Starting sequence-batch scheduler thread "
@@ -658,6 +1428,21 @@ SequenceBatchScheduler::SequenceBatch::SchedulerThread(
                    << nice << " failed)...";
   }
 
+  // Run near the runner's GPU so that the host side of the
+  // execution stays on the GPU's NUMA node.
+  Status affinity_status = SetThreadCpuAffinity(host_cpus);
+  if (!affinity_status.IsOk()) {
+    LOG_ERROR << "Failed to set CPU affinity for sequence-batch scheduler "
+              << "thread " << batcher_idx_ << ": "
+              << affinity_status.Message();
+  }
+
+#ifdef TRTIS_ENABLE_METRICS
+  if (base_->metric_reporter_ != nullptr) {
+    Metrics::RegisterThread("scheduler", base_->metric_reporter_->ModelName());
+  }
+#endif  // TRTIS_ENABLE_METRICS
+
   // Initialize using the thread. If error then just exit this thread
   // now... that means the corresponding model instance will not have
   // any runner and so will not get used for execution.
@@ -686,14 +1471,28 @@ SequenceBatchScheduler::SequenceBatch::SchedulerThread(
 
   while (!scheduler_thread_exit_) {
     auto payloads = std::make_shared<std::vector<Scheduler::Payload>>();
+    std::vector<Scheduler::Payload> cancelled;
     uint64_t wait_microseconds = 0;
 
+    // For models with implicit state, the slot of each payload whose
+    // output state must be saved, or -1 if there is none.
+    std::shared_ptr<std::vector<int32_t>> state_slots;
+    if (!states_.empty()) {
+      state_slots = std::make_shared<std::vector<int32_t>>();
+    }
+
     // Hold the lock for as short a time as possible.
     {
       std::unique_lock<std::mutex> lock(mu_);
 
       bool adjust_max_active_slot = false;
 
+      // Don't execute the requests that were cancelled while they
+      // were queued, for example because the client disconnected.
+      for (int32_t slot = 0; slot <= max_active_slot_; ++slot) {
+        RemoveCancelled(slot, &cancelled);
+      }
+
       if (delay_cnt > 0) {
         wait_microseconds = 10 * 1000;
         // Debugging/testing... wait until queues together contain at
@@ -708,6 +1507,72 @@ SequenceBatchScheduler::SequenceBatch::SchedulerThread(
         LOG_INFO << "Delaying scheduler thread " << batcher_idx_ << " until "
                  << delay_cnt
                  << " queued payloads, current total = " << total_size;
+      } else if (oldest_) {
+        // Find the slots that have a request ready and form the batch
+        // from the oldest of those sequences.
+        ready_slots_.clear();
+        for (int32_t slot = 0; slot <= max_active_slot_; ++slot) {
+          if (!queues_[slot].empty()) {
+            ready_slots_.push_back(slot);
+          }
+        }
+
+        if (ready_slots_.empty()) {
+          wait_microseconds = default_wait_microseconds;
+        } else {
+          std::sort(
+              ready_slots_.begin(), ready_slots_.end(),
+              [this](const int32_t a, const int32_t b) {
+                return slot_orders_[a] < slot_orders_[b];
+              });
+
+          for (const int32_t slot : ready_slots_) {
+            if (payloads->size() >= max_batch_size_) {
+              break;
+            }
+
+            std::deque<Scheduler::Payload>& queue = queues_[slot];
+            Scheduler::Payload& slot_payload = queue.front();
+
+            // A payload without a request provider forcibly ends the
+            // sequence. Since batches are formed only from ready
+            // requests it does not take an entry in the batch.
+            if (slot_payload.request_provider_ == nullptr) {
+              queue.pop_front();
+              EndSequence(slot, &adjust_max_active_slot);
+              continue;
+            }
+
+            const auto& request_provider = slot_payload.request_provider_;
+            const auto& request_header = request_provider->RequestHeader();
+            const bool start_of_sequence =
+                ((request_header.flags() &
+                  InferRequestHeader::FLAG_SEQUENCE_START) != 0);
+            const bool end_of_sequence =
+                ((request_header.flags() &
+                  InferRequestHeader::FLAG_SEQUENCE_END) != 0);
+
+            request_provider->SetInputOverride(InputOverrides(
+                slot,
+                start_of_sequence ? start_input_overrides_
+                                  : continue_input_overrides_,
+                start_of_sequence));
+            if (state_slots != nullptr) {
+              RequireStateOutputs(slot_payload);
+              state_slots->push_back(end_of_sequence ? -1 : slot);
+            }
+
+            payloads->emplace_back(
+                slot_payload.stats_, request_provider,
+                slot_payload.response_provider_,
+                slot_payload.complete_function_);
+            queue.pop_front();
+
+            if (end_of_sequence) {
+              EndSequence(slot, &adjust_max_active_slot);
+            }
+          }
+        }
       } else {
         // Make sure there is at least one request that needs to be
         // handled. Find the largest slot index that has a payload
@@ -751,12 +1616,15 @@ SequenceBatchScheduler::SequenceBatch::SchedulerThread(
             if (use_null_provider) {
               auto null_request_provider =
                   std::make_shared<NULLInferRequestProvider>(
-                      null_request_header_);
+                      null_request_header_, null_input_);
               null_request_provider->SetInputOverride(
                   notready_input_overrides_);
 
               payloads->emplace_back(
                   nullptr, null_request_provider, nullptr, nullptr);
+              if (state_slots != nullptr) {
+                state_slots->push_back(-1);
+              }
             } else {
               Scheduler::Payload& slot_payload = queue.front();
               const auto& request_provider = slot_payload.request_provider_;
@@ -765,11 +1633,19 @@ SequenceBatchScheduler::SequenceBatch::SchedulerThread(
               // If this is the first payload in a sequence then send
               // the appropriate sequence start indicator to the
               // backend.
-              if ((request_header.flags() &
-                   InferRequestHeader::FLAG_SEQUENCE_START) != 0) {
-                request_provider->SetInputOverride(start_input_overrides_);
-              } else {
-                request_provider->SetInputOverride(continue_input_overrides_);
+              const bool start_of_sequence =
+                  ((request_header.flags() &
+                    InferRequestHeader::FLAG_SEQUENCE_START) != 0);
+              end_of_sequence = ((request_header.flags() &
+                                  InferRequestHeader::FLAG_SEQUENCE_END) != 0);
+              request_provider->SetInputOverride(InputOverrides(
+                  slot,
+                  start_of_sequence ? start_input_overrides_
+                                    : continue_input_overrides_,
+                  start_of_sequence));
+              if (state_slots != nullptr) {
+                RequireStateOutputs(slot_payload);
+                state_slots->push_back(end_of_sequence ? -1 : slot);
               }
 
               payloads->emplace_back(
@@ -778,42 +1654,12 @@ SequenceBatchScheduler::SequenceBatch::SchedulerThread(
                   slot_payload.complete_function_);
 
               queue.pop_front();
-
-              if ((request_header.flags() &
-                   InferRequestHeader::FLAG_SEQUENCE_END) != 0) {
-                end_of_sequence = true;
-              }
             }
 
             // If the sequence has ended then attempt to refill the
-            // slot with a sequence from the backlog. If there is no
-            // backlog show that the slot is no longer active, and if
-            // it is currently the maximum active slot note that we
-            // need to adjust max_active_slot_ once all slots are
-            // processed (we defer processing because multiple slots
-            // could have ending sequences).
+            // slot with a sequence from the backlog.
             if (end_of_sequence) {
-              LOG_VERBOSE(1) << "Ending sequence in batcher " << batcher_idx_
-                             << ", slot " << slot;
-
-              // Should never be anything in a queue after the END
-              // marker. If it happens that means we will clobber
-              // that request if/when we swap in a backlog sequence
-              // in ReleaseBatchSlot below.
-              if (!queue.empty()) {
-                LOG_ERROR << "internal: unexpected requests after sequence "
-                             "end in slot "
-                          << slot;
-              }
-
-              SequenceBatchScheduler::BatchSlot batch_slot(batcher_idx_, slot);
-              bool released = base_->ReleaseBatchSlot(batch_slot, &queue);
-              if (released) {
-                slot_correlation_ids_[slot] = 0;
-                if (slot == max_active_slot_) {
-                  adjust_max_active_slot = true;
-                }
-              }
+              EndSequence(slot, &adjust_max_active_slot);
             }
           }
         }
@@ -838,8 +1684,18 @@ SequenceBatchScheduler::SequenceBatch::SchedulerThread(
       }
     }
 
+    for (auto& payload : cancelled) {
+      if (payload.complete_function_ != nullptr) {
+        payload.complete_function_(Status(
+            RequestStatusCode::UNAVAILABLE,
+            "Request cancelled for '" + payload.request_provider_->ModelName() +
+                "'"));
+      }
+    }
+
     if ((payloads != nullptr) && !payloads->empty()) {
-      auto OnCompleteQueuedPayloads = [payloads](const Status& rstatus) {
+      auto OnCompleteQueuedPayloads = [this, payloads,
+                                       state_slots](const Status& rstatus) {
         // Payloads that don't have a completion function don't have
         // anywhere to report their errors. Those errors could have
         // caused other payloads to have issues (due to mis-alignment
@@ -858,10 +1714,18 @@ SequenceBatchScheduler::SequenceBatch::SchedulerThread(
         }
 
         // Complete each payload by calling the competion function.
+        // The implicit state produced by a request must be saved
+        // before completion since that can release its outputs.
         bool found_success = false;
-        for (auto& payload : *payloads) {
+        for (size_t idx = 0; idx < payloads->size(); ++idx) {
+          auto& payload = (*payloads)[idx];
           const Status& final_status = status.IsOk() ? payload.status_ : status;
 
+          if ((state_slots != nullptr) && ((*state_slots)[idx] >= 0) &&
+              final_status.IsOk() && (payload.response_provider_ != nullptr)) {
+            SaveState((*state_slots)[idx], payload);
+          }
+
           // All the payloads executed together, so count 1 execution
           // in the first successful payload. Other payloads stay at 0
           // executions.
@@ -26,14 +26,17 @@
 #pragma once
 
 #include <sys/time.h>
+#include <array>
 #include <atomic>
 #include <condition_variable>
 #include <deque>
+#include <functional>
 #include <future>
 #include <mutex>
 #include <queue>
 #include <thread>
 #include <unordered_map>
+#include "src/core/metric_model_reporter.h"
 #include "src/core/model_config.h"
 #include "src/core/model_config.pb.h"
 #include "src/core/provider.h"
@@ -42,18 +45,95 @@
 
 namespace nvidia { namespace inferenceserver {
 
+class SequenceBatchScheduler;
+
+// Binds the requests of a client stream to the sequence that the
+// stream started, so that the requests that continue the sequence are
+// queued directly into the sequence's batch slot instead of being
+// routed by correlation ID. A binding holds at most one sequence. A
+// START of another sequence rebinds it, and the earlier sequence is
+// then routed by correlation ID. Closing the binding, which happens
+// when its stream closes, ends the bound sequence if the sequence has
+// not already ended.
+class SequenceBinding {
+ public:
+  SequenceBinding()
+      : correlation_id_(0), bound_(false), batcher_idx_(0), slot_(0),
+        last_us_(0)
+  {
+  }
+
+  // End the bound sequence, if any, and unbind.
+  void Close();
+
+ private:
+  friend class SequenceBatchScheduler;
+
+  // The scheduler of the bound sequence. 'scheduler_' is cleared when
+  // the scheduler is destroyed so that a binding closed afterward
+  // doesn't use it.
+  struct Owner {
+    std::mutex mu_;
+    SequenceBatchScheduler* scheduler_;
+  };
+
+  // Bind to sequence 'correlation_id' of 'owner'. If 'bound' is false
+  // the sequence is waiting in the backlog for a slot.
+  void Bind(
+      const std::shared_ptr<Owner>& owner, const CorrelationID correlation_id,
+      const bool bound, const size_t batcher_idx, const uint32_t slot);
+
+  // Move the bound sequence to a slot. Return false, and change
+  // nothing, if the binding is no longer bound to the sequence.
+  bool SetSlot(
+      const Owner* owner, const CorrelationID correlation_id,
+      const size_t batcher_idx, const uint32_t slot);
+
+  // Unbind from sequence 'correlation_id' of 'owner'. Does nothing if
+  // the binding is bound to another sequence.
+  void Unbind(const Owner* owner, const CorrelationID correlation_id);
+
+  // If the binding is bound to sequence 'correlation_id' of 'owner'
+  // and that sequence has a slot then record a request at 'now_us',
+  // return the slot in 'batcher_idx' and 'slot', and return
+  // true. Otherwise return false.
+  bool Route(
+      const Owner* owner, const CorrelationID correlation_id,
+      const uint64_t now_us, size_t* batcher_idx, uint32_t* slot);
+
+  // Return in 'last_us' the time of the latest request routed through
+  // the binding to sequence 'correlation_id' of 'owner'. Return false
+  // if the binding is not bound to that sequence.
+  bool LastRouted(
+      const Owner* owner, const CorrelationID correlation_id,
+      uint64_t* last_us);
+
+  std::mutex mu_;
+  std::shared_ptr<Owner> owner_;
+  CorrelationID correlation_id_;
+  bool bound_;
+  size_t batcher_idx_;
+  uint32_t slot_;
+
+  // The time, in microseconds, of the latest request routed through
+  // the binding.
+  uint64_t last_us_;
+};
+
 // Scheduler that implements batching across sequences of correlated
 // inferences.
 class SequenceBatchScheduler : public Scheduler {
  public:
-  SequenceBatchScheduler() = default;
+  SequenceBatchScheduler();
   ~SequenceBatchScheduler();
 
   // Create a scheduler to support a given number of runners and a run
-  // function to call when a request is scheduled.
+  // function to call when a request is scheduled. Sequence batcher
+  // metrics are reported to 'metric_reporter' if it is not nullptr.
   static Status Create(
       const ModelConfig& config, const uint32_t runner_cnt,
       StandardInitFunc OnInit, StandardRunFunc OnSchedule,
+      const std::shared_ptr<MetricModelReporter>& metric_reporter,
       std::unique_ptr<Scheduler>* scheduler);
 
   // \see Scheduler::Enqueue()
@@ -77,11 +157,25 @@ class SequenceBatchScheduler : public Scheduler {
   bool ReleaseBatchSlot(
       const BatchSlot& batch_slot, std::deque<Scheduler::Payload>* payloads);
 
+  // Move the sequence with 'correlation_id' from batch slot 'from' to
+  // the unused batch slot 'to', and make 'from' ready for a new
+  // sequence. Return false, and change nothing, if the sequence is no
+  // longer assigned to 'from' or if a backlogged sequence is waiting
+  // for 'to'.
+  bool CompactBatchSlot(
+      const BatchSlot& from, const BatchSlot& to,
+      const CorrelationID correlation_id);
+
   // For debugging/testing, batcher reports how many waiting requests
   // and returns true if the batcher should continue waiting.
   bool DelayScheduler(
       const uint32_t batcher_idx, const size_t cnt, const size_t total);
 
+  // End sequence 'correlation_id' if 'binding' is still bound to it.
+  // Called when the binding is closed.
+  void EndBoundSequence(
+      SequenceBinding* binding, const CorrelationID correlation_id);
+
  private:
   void ReaperThread(const int nice);
 
@@ -100,28 +194,65 @@ class SequenceBatchScheduler : public Scheduler {
    public:
     SequenceBatch(
         SequenceBatchScheduler* base, const uint32_t batcher_idx,
-        const size_t batch_size, const ModelConfig& config,
-        StandardInitFunc OnInit, StandardRunFunc OnSchedule,
+        const size_t slot_cnt, const ModelConfig& config,
+        const std::vector<int>& host_cpus, StandardInitFunc OnInit,
+        StandardRunFunc OnSchedule,
         const std::shared_ptr<InferRequestProvider::InputOverrideMap>&
             start_input_overrides,
         const std::shared_ptr<InferRequestProvider::InputOverrideMap>&
             continue_input_overrides,
         const std::shared_ptr<InferRequestProvider::InputOverrideMap>&
             notready_input_overrides,
+        const std::shared_ptr<const AllocatedSystemMemory>& null_input,
         std::promise<bool>* is_initialized);
     ~SequenceBatch();
 
     // Enqueue a payload into the appropriate queue for the requested
     // slot.
     void Enqueue(
-        const uint32_t slot, const CorrelationID correlation_id,
+        uint32_t slot, const CorrelationID correlation_id,
         const std::shared_ptr<ModelInferStats>& stats,
         const std::shared_ptr<InferRequestProvider>& request_provider,
         const std::shared_ptr<InferResponseProvider>& response_provider,
         std::function<void(const Status&)> OnComplete);
 
    private:
-    void SchedulerThread(const int nice, std::promise<bool>* is_initialized);
+    void SchedulerThread(
+        const int nice, const std::vector<int>& host_cpus,
+        std::promise<bool>* is_initialized);
+
+    // Handle the end of the sequence in 'slot', either by refilling
+    // the slot from the backlog or by releasing it. Must be called
+    // with 'mu_' held.
+    void EndSequence(const int32_t slot, bool* adjust_max_active_slot);
+
+    // Report the number of active slots. Must be called with 'mu_'
+    // held.
+    void ReportActiveSlots();
+
+    // Move the cancelled requests at the front of the 'slot' queue to
+    // 'cancelled'. Requests that start or end a sequence are kept
+    // since the slot depends on them. Must be called with 'mu_' held.
+    void RemoveCancelled(
+        const int32_t slot, std::vector<Scheduler::Payload>* cancelled);
+
+    // Return the input overrides for the next request in 'slot'. This
+    // is 'controls' together with the current value of each implicit
+    // state of the slot's sequence, or the initial value if 'start'.
+    // Must be called with 'mu_' held.
+    std::shared_ptr<InferRequestProvider::InputOverrideMap> InputOverrides(
+        const int32_t slot,
+        const std::shared_ptr<InferRequestProvider::InputOverrideMap>&
+            controls,
+        const bool start);
+
+    // Make the backend produce the implicit state outputs for the
+    // request in 'payload'.
+    void RequireStateOutputs(const Scheduler::Payload& payload);
+
+    // Save the implicit state outputs produced by the request in
+    // 'payload' as the state of the sequence in 'slot'.
+    void SaveState(const int32_t slot, const Scheduler::Payload& payload);
 
     // Function the scheduler will call to initialize a runner.
     const StandardInitFunc OnInit_;
@@ -135,6 +266,16 @@ class SequenceBatchScheduler : public Scheduler {
     // The index of this batcher within the controlling scheduler.
     const uint32_t batcher_idx_;
 
+    // True if batches are formed from the oldest ready sequences
+    // instead of from every slot.
+    const bool oldest_;
+
+    // True if sequences are moved to lower slots as slots are freed.
+    const bool compact_slots_;
+
+    // The maximum number of requests in a batch.
+    const size_t max_batch_size_;
+
     // The thread scheduling payloads queued in this batch.
     std::unique_ptr<std::thread> scheduler_thread_;
     bool scheduler_thread_exit_;
@@ -147,9 +288,9 @@ class SequenceBatchScheduler : public Scheduler {
     // The request header needed to create a null provider to use when
     // an inference is issuing and there is no request available in a
     // slot.
-    InferRequestHeader null_request_header_;
+    std::shared_ptr<const InferRequestHeader> null_request_header_;
 
-    // Queues holding inference requests. There are 'batch_size'
+    // Queues holding inference requests. There are 'slot_cnt'
     // queues, one for each batch slot where requests assigned to that
     // slot are enqueued to wait for inferencing.
     std::vector<std::deque<Scheduler::Payload>> queues_;
@@ -163,6 +304,30 @@ class SequenceBatchScheduler : public Scheduler {
     // requests pending at the moment.
     std::vector<CorrelationID> slot_correlation_ids_;
 
+    // For each slot the order in which its sequence started, used to
+    // find the oldest ready sequences. Smaller is older.
+    std::vector<uint64_t> slot_orders_;
+    uint64_t next_order_;
+
+    // For each slot the time, in microseconds, when its sequence
+    // started using the slot.
+    std::vector<uint64_t> slot_start_us_;
+
+    // The number of slots that hold a sequence.
+    uint32_t active_slot_cnt_;
+#ifdef TRTIS_ENABLE_METRICS
+    prometheus::Gauge* metric_active_slots_;
+#endif  // TRTIS_ENABLE_METRICS
+
+    // Scratch list of the slots with a request ready.
+    std::vector<int32_t> ready_slots_;
+
+    // For each sequence moved by slot compaction the slot it was
+    // moved from and the slot it was moved to. A request routed before
+    // the move can still arrive for the old slot and is redirected.
+    std::unordered_map<CorrelationID, std::pair<uint32_t, uint32_t>>
+        compacted_slots_;
+
     // The control values, delivered as input tensors, that should be
     // used when starting a sequence, continuing a sequence, and
     // showing that a sequence has not input available.
@@ -172,6 +337,28 @@ class SequenceBatchScheduler : public Scheduler {
         continue_input_overrides_;
     std::shared_ptr<InferRequestProvider::InputOverrideMap>
         notready_input_overrides_;
+
+    // The all-zero buffer, shared by all batchers of the model, that
+    // the NULL providers deliver as the input of slots without a
+    // request.
+    std::shared_ptr<const AllocatedSystemMemory> null_input_;
+
+    // The implicit states kept for each sequence, from the model
+    // configuration. 'initial_' is the all-zero value used when a
+    // sequence starts.
+    struct State {
+      std::string input_name_;
+      std::string output_name_;
+      std::shared_ptr<InferRequestProvider::InputOverride> initial_;
+    };
+    std::vector<State> states_;
+
+    // For each slot the current value of each implicit state of the
+    // slot's sequence, in the same order as 'states_'. Empty if the
+    // sequence has not yet produced a state.
+    std::vector<
+        std::vector<std::shared_ptr<InferRequestProvider::InputOverride>>>
+        slot_states_;
   };
 
  private:
@@ -185,7 +372,7 @@ class SequenceBatchScheduler : public Scheduler {
   // The max_sequence_idle_microseconds value for this scheduler.
   uint64_t max_sequence_idle_microseconds_;
 
-  // Mutex
+  // Mutex protecting the slot and backlog assignment state below.
   std::mutex mu_;
 
   // The reaper thread
@@ -199,16 +386,104 @@ class SequenceBatchScheduler : public Scheduler {
   // Map from a request's correlation ID to the BatchSlot assigned to
   // that correlation ID.
   using BatchSlotMap = std::unordered_map<CorrelationID, BatchSlot>;
-  BatchSlotMap sequence_to_batchslot_map_;
+
+  // A queue collecting the requests of a sequence that is waiting
+  // for a free slot.
+  using Backlog = std::shared_ptr<std::deque<Scheduler::Payload>>;
 
   // Map from a request's correlation ID to the backlog queue
   // collecting requests for that correlation ID.
-  using BacklogMap = std::unordered_map<
-      CorrelationID, std::shared_ptr<std::deque<Scheduler::Payload>>>;
-  BacklogMap sequence_to_backlog_map_;
+  using BacklogMap = std::unordered_map<CorrelationID, Backlog>;
+
+  // A deadline, in microseconds, at which the reaper must next check
+  // a correlation ID.
+  using ReaperDeadline = std::pair<uint64_t, CorrelationID>;
+
+  // The routing state for the correlation IDs that hash to a shard.
+  // Requests for sequences that already have a slot or backlog only
+  // need the lock of their shard, so they don't serialize with
+  // requests for other sequences. The shard lock must be acquired
+  // before 'mu_' when both are needed.
+  struct CorrelationShard {
+    std::mutex mu_;
+    BatchSlotMap sequence_to_batchslot_map_;
+    BacklogMap sequence_to_backlog_map_;
+
+    // For each correlation ID the most recently seen timestamp, in
+    // microseconds, for a request using that correlation ID.
+    std::unordered_map<CorrelationID, uint64_t> correlation_id_timestamps_;
+
+    // Min-heap of the time at which the reaper must next check each
+    // correlation ID in 'correlation_id_timestamps_'. A deadline can
+    // be earlier than the correlation ID's actual idle deadline, in
+    // which case the reaper re-arms it.
+    std::priority_queue<
+        ReaperDeadline, std::vector<ReaperDeadline>,
+        std::greater<ReaperDeadline>>
+        reaper_deadlines_;
+
+    // For each sequence started by a request with a sequence binding,
+    // that binding. A binding may since have been rebound to another
+    // sequence, so it is only used if it is still bound to the
+    // correlation ID.
+    std::unordered_map<CorrelationID, std::shared_ptr<SequenceBinding>>
+        bindings_;
+  };
+
+  static constexpr size_t kCorrelationShardCount = 16;
+  std::array<CorrelationShard, kCorrelationShardCount> shards_;
+
+  CorrelationShard& Shard(const CorrelationID correlation_id)
+  {
+    return shards_[correlation_id % kCorrelationShardCount];
+  }
+
+  // Handle the correlation IDs in 'shard' whose reaper deadline has
+  // passed, adding to 'force_ends' the slots of sequences that have
+  // been idle too long. Return the time, in microseconds, until the
+  // shard's next deadline. Must be called with the shard lock held.
+  uint64_t ReapShard(
+      CorrelationShard* shard, const uint64_t now_us,
+      std::vector<std::pair<BatchSlot, CorrelationID>>* force_ends);
+
+  // Bind 'binding' to the sequence 'correlation_id' in 'shard', at
+  // 'batch_slot' or, if nullptr, in the backlog. Must be called with
+  // the shard lock held.
+  void BindSequence(
+      CorrelationShard* shard, const CorrelationID correlation_id,
+      const std::shared_ptr<SequenceBinding>& binding,
+      const BatchSlot* batch_slot);
+
+  // Unbind the binding, if any, of the sequence 'correlation_id' in
+  // 'shard'. Must be called with the shard lock held.
+  void UnbindSequence(
+      CorrelationShard* shard, const CorrelationID correlation_id);
+
+  // The owner that this scheduler's sequence bindings refer to.
+  std::shared_ptr<SequenceBinding::Owner> binding_owner_;
+
+  // A sequence waiting for a free slot, with the time, in
+  // microseconds, when it entered the backlog.
+  struct BacklogSequence {
+    CorrelationID correlation_id_;
+    Backlog queue_;
+    uint64_t enqueue_us_;
+  };
 
   // The ordered backlog of sequences waiting for a free slot.
-  std::deque<std::shared_ptr<std::deque<Scheduler::Payload>>> backlog_queues_;
+  std::deque<BacklogSequence> backlog_queues_;
+
+  // The total number of requests in the backlog.
+  std::atomic<size_t> backlog_payload_cnt_;
+
+#ifdef TRTIS_ENABLE_METRICS
+  // The sequence batcher metrics, nullptr if not reported.
+  std::shared_ptr<MetricModelReporter> metric_reporter_;
+  prometheus::Gauge* metric_backlog_sequences_;
+  prometheus::Gauge* metric_backlog_requests_;
+  prometheus::Histogram* metric_backlog_duration_us_;
+  prometheus::Histogram* metric_lifetime_us_;
+#endif  // TRTIS_ENABLE_METRICS
 
   // The batch/slot locations ready to accept a new sequence. Ordered
   // from lowest slot-number to highest so that all batches grow at
@@ -216,10 +491,6 @@ class SequenceBatchScheduler : public Scheduler {
   std::priority_queue<BatchSlot, std::vector<BatchSlot>, BatchSlotCompare>
       ready_batch_slots_;
 
-  // For each correlation ID the most recently seen timestamp, in
-  // microseconds, for a request using that correlation ID.
-  std::unordered_map<CorrelationID, uint64_t> correlation_id_timestamps_;
-
   // Used for debugging/testing.
   size_t backlog_delay_cnt_;
   std::vector<size_t> queue_request_cnts_;
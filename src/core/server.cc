@@ -33,18 +33,22 @@
 #include <csignal>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <utility>
 #include <vector>
 
 #include "src/core/api.pb.h"
 #include "src/core/backend.h"
 #include "src/core/constants.h"
+#include "src/core/filesystem.h"
 #include "src/core/logging.h"
 #include "src/core/model_config.h"
 #include "src/core/model_config.pb.h"
 #include "src/core/model_config_utils.h"
 #include "src/core/model_repository_manager.h"
+#include "src/core/pinned_memory_manager.h"
 #include "src/core/provider.h"
+#include "src/core/rate_limiter.h"
 #include "src/core/server.h"
 #include "src/core/server_status.pb.h"
 
@@ -67,13 +71,185 @@ class ScopedAtomicIncrement {
   std::atomic<uint64_t>& counter_;
 };
 
+// The state shared by the batch slices of a request.
+struct BatchSlices {
+  std::mutex mu_;
+  size_t pending_cnt_;
+  uint32_t execution_cnt_;
+  Status status_;
+};
+
+// Run a request whose batch-size exceeds the maximum batch-size of
+// 'backend' as slices of at most the maximum batch-size. The slices
+// are all submitted at once so they can run in parallel on the
+// model's instances. They reference the inputs of 'request_provider' and
+// write their outputs directly to the output buffers of
+// 'response_provider'. 'OnComplete' is called once all slices have
+// completed, with the first error of any slice.
+void
+RunBatchSlices(
+    const std::shared_ptr<InferenceBackend>& backend,
+    const std::shared_ptr<ModelInferStats>& infer_stats,
+    const std::shared_ptr<InferRequestProvider>& request_provider,
+    const std::shared_ptr<InferResponseProvider>& response_provider,
+    const std::function<void(const Status&)>& OnComplete)
+{
+  const size_t batch_size = request_provider->RequestHeader().batch_size();
+  const size_t max_batch_size = backend->Config().max_batch_size();
+
+  std::vector<std::shared_ptr<InferRequestProvider>> request_slices;
+  std::vector<std::shared_ptr<InferResponseProvider>> response_slices;
+  for (size_t offset = 0; offset < batch_size; offset += max_batch_size) {
+    std::shared_ptr<InferRequestProvider> request_slice;
+    std::shared_ptr<InferResponseProvider> response_slice;
+    Status status = InferRequestProvider::CreateBatchSlice(
+        request_provider, offset, std::min(max_batch_size, batch_size - offset),
+        &request_slice);
+    if (status.IsOk()) {
+      status = InferResponseProvider::CreateBatchSlice(
+          response_provider, request_slice->SharedRequestHeader(), offset,
+          &response_slice);
+    }
+    if (!status.IsOk()) {
+      OnComplete(status);
+      return;
+    }
+
+    request_slices.emplace_back(std::move(request_slice));
+    response_slices.emplace_back(std::move(response_slice));
+  }
+
+  auto slices = std::make_shared<BatchSlices>();
+  slices->pending_cnt_ = request_slices.size();
+  slices->execution_cnt_ = 0;
+
+  for (size_t i = 0; i < request_slices.size(); ++i) {
+    // The statistics of the slices are not reported, their durations
+    // and executions are included in the statistics of the request.
+    auto slice_stats = std::make_shared<ModelInferStats>(
+        nullptr /* status_manager */, backend->Name());
+    slice_stats->CaptureTimestamp(
+        ModelInferStats::TimestampKind::kRequestStart);
+    slice_stats->SetBatchSize(request_slices[i]->RequestHeader().batch_size());
+    slice_stats->SetDeadline(infer_stats->Deadline());
+
+    const auto& response_slice = response_slices[i];
+    backend->Run(
+        slice_stats, request_slices[i], response_slice,
+        [backend, infer_stats, slice_stats, response_slice, slices,
+         OnComplete](const Status& status) {
+          const Status slice_status =
+              status.IsOk() ? response_slice->FinalizeResponse(*backend)
+                            : status;
+
+          bool completed;
+          {
+            std::lock_guard<std::mutex> lock(slices->mu_);
+            infer_stats->IncrementQueueDuration(*slice_stats);
+            infer_stats->IncrementComputeDuration(*slice_stats);
+            slices->execution_cnt_ += slice_stats->ModelExecutionCount();
+            if (!slice_status.IsOk() && slices->status_.IsOk()) {
+              slices->status_ = slice_status;
+            }
+            completed = (--slices->pending_cnt_ == 0);
+          }
+
+          if (completed) {
+            infer_stats->SetModelExecutionCount(slices->execution_cnt_);
+            OnComplete(slices->status_);
+          }
+        });
+  }
+}
+
+// Return true if the request of 'request_provider' must be split
+// into slices to run on 'backend', see RunBatchSlices().
+bool
+RequiresBatchSlices(
+    const InferenceBackend& backend,
+    const InferRequestProvider& request_provider)
+{
+  const int max_batch_size = backend.Config().max_batch_size();
+  return (max_batch_size > 0) &&
+         (request_provider.RequestHeader().batch_size() >
+          static_cast<uint32_t>(max_batch_size));
+}
+
+// Wrap 'OnComplete' so that the response is finalized once the
+// inference on 'backend' completes. If the model caches its responses
+// and the response is found in 'response_cache', the request is
+// completed here and false is returned, otherwise the response is
+// cached once the inference completes. 'inflight' is held until the
+// request completes.
+bool
+PrepareInfer(
+    ResponseCache* response_cache,
+    const std::shared_ptr<InferenceBackend>& backend,
+    const std::shared_ptr<ScopedAtomicIncrement>& inflight,
+    const std::shared_ptr<InferRequestProvider>& request_provider,
+    const std::shared_ptr<InferResponseProvider>& response_provider,
+    std::function<void(const Status&)>* OnComplete)
+{
+  // Need to capture 'backend' to keep it alive... it goes away when
+  // it goes out of scope which can cause the model to be unloaded,
+  // and we don't want that to happen when a request is in flight.
+  auto OnCompleteInfer = *OnComplete;
+  auto OnCompleteHandleInfer = [OnCompleteInfer, backend, response_provider,
+                                inflight](const Status& status) mutable {
+    if (status.IsOk()) {
+      OnCompleteInfer(response_provider->FinalizeResponse(*backend));
+    } else {
+      OnCompleteInfer(status);
+    }
+  };
+
+  // If the model caches its responses, return the cached outputs
+  // without running the model, otherwise cache the outputs once the
+  // model has run.
+  uint64_t cache_key;
+  if ((response_cache != nullptr) &&
+      backend->Config().response_cache().enable() &&
+      ResponseCache::RequestKey(*backend, request_provider, &cache_key)) {
+    bool hit;
+    Status status =
+        response_cache->Lookup(cache_key, response_provider.get(), &hit);
+#ifdef TRTIS_ENABLE_METRICS
+    if (backend->MetricReporter() != nullptr) {
+      if (hit) {
+        backend->MetricReporter()->MetricResponseCacheHits().Increment();
+      } else {
+        backend->MetricReporter()->MetricResponseCacheMisses().Increment();
+      }
+    }
+#endif  // TRTIS_ENABLE_METRICS
+    if (hit) {
+      OnCompleteHandleInfer(status);
+      return false;
+    }
+
+    *OnComplete = [response_cache, cache_key, request_provider,
+                   response_provider,
+                   OnCompleteHandleInfer](const Status& status) mutable {
+      if (status.IsOk()) {
+        response_cache->Insert(
+            cache_key, request_provider->RequestHeader(), *response_provider);
+      }
+      OnCompleteHandleInfer(status);
+    };
+  } else {
+    *OnComplete = OnCompleteHandleInfer;
+  }
+
+  return true;
+}
+
 }  // namespace
 
 //
 // InferenceServer
 //
 InferenceServer::InferenceServer()
-    : ready_state_(ServerReadyState::SERVER_INVALID)
+    : ready_state_(ServerReadyState::SERVER_INVALID), drain_start_ns_(0)
 {
   struct timespec ts;
   clock_gettime(CLOCK_MONOTONIC, &ts);
@@ -88,6 +264,17 @@ InferenceServer::InferenceServer()
   strict_model_config_ = true;
   strict_readiness_ = true;
   exit_timeout_secs_ = 30;
+  pinned_memory_pool_byte_size_ = 1 << 28;
+  model_load_thread_count_ = 4;
+  model_load_gpu_limit_ = 0;
+  model_load_storage_limit_ = 0;
+  rate_limit_gpu_slots_ = 0;
+  response_cache_byte_size_ = 0;
+  status_snapshot_interval_ms_ = 0;
+  instance_placement_ = PLACEMENT_NONE;
+  remote_repository_cache_byte_size_ = 0;
+  remote_repository_download_part_byte_size_ = 64 * 1024 * 1024;
+  remote_repository_download_concurrency_ = 8;
 
   tf_soft_placement_enabled_ = true;
   tf_gpu_memory_fraction_ = 0.0;
@@ -99,6 +286,12 @@ InferenceServer::InferenceServer()
   status_manager_.reset(new ServerStatusManager(version_));
 }
 
+InferenceServer::~InferenceServer()
+{
+  // The snapshot thread uses the model repository manager.
+  status_manager_->StopSnapshots();
+}
+
 Status
 InferenceServer::Init()
 {
@@ -114,6 +307,26 @@ InferenceServer::Init()
         RequestStatusCode::INVALID_ARG, "--model-repository must be specified");
   }
 
+  // Create the pool of pinned memory used to stage tensors that are
+  // copied between host and GPU memory.
+  status = PinnedMemoryManager::Create(pinned_memory_pool_byte_size_);
+  if (!status.IsOk()) {
+    ready_state_ = ServerReadyState::SERVER_FAILED_TO_INITIALIZE;
+    return status;
+  }
+
+  // Create the rate limiter that bounds the batches executing
+  // concurrently across all models.
+  status = RateLimiter::Create(rate_limit_gpu_slots_, rate_limit_resources_);
+  if (!status.IsOk()) {
+    ready_state_ = ServerReadyState::SERVER_FAILED_TO_INITIALIZE;
+    return status;
+  }
+
+  if (response_cache_byte_size_ > 0) {
+    response_cache_.reset(new ResponseCache(response_cache_byte_size_));
+  }
+
   // Create the shared memory manager that registers / unregisters and returns
   // the shared memory regions that are current registered.
   status =
@@ -123,15 +336,39 @@ InferenceServer::Init()
     return status;
   }
 
+  SetRemoteDownloadParallelism(
+      remote_repository_download_part_byte_size_,
+      remote_repository_download_concurrency_);
+  if (!remote_repository_cache_dir_.empty()) {
+    status = SetRemoteFileCache(
+        remote_repository_cache_dir_, remote_repository_cache_byte_size_);
+    if (!status.IsOk()) {
+      ready_state_ = ServerReadyState::SERVER_FAILED_TO_INITIALIZE;
+      return status;
+    }
+  }
+
   // Create the model manager for the repository. Unless model control
   // is disabled, all models are eagerly loaded when the manager is created.
   bool polling_enabled = (model_control_mode_ == MODE_POLL);
-  bool model_control_enabled = (model_control_mode_ == MODE_EXPLICIT);
+  bool model_control_enabled = (model_control_mode_ == MODE_EXPLICIT) ||
+                               (model_control_mode_ == MODE_ON_DEMAND);
+  bool load_on_demand = (model_control_mode_ == MODE_ON_DEMAND);
   status = ModelRepositoryManager::Create(
       this, version_, status_manager_, model_repository_paths_, startup_models_,
       strict_model_config_, tf_gpu_memory_fraction_, tf_soft_placement_enabled_,
-      tf_vgpu_memory_limits_, polling_enabled, model_control_enabled,
+      tf_vgpu_memory_limits_, trt_engine_cache_dir_, polling_enabled,
+      model_control_enabled, load_on_demand, model_gpu_memory_budget_,
+      model_load_thread_count_, model_load_gpu_limit_,
+      model_load_storage_limit_, model_memory_estimate_dir_,
+      model_config_cache_dir_, model_startup_snapshot_, instance_placement_,
       &model_repository_manager_);
+  if ((model_repository_manager_ != nullptr) &&
+      (status_snapshot_interval_ms_ > 0)) {
+    status_manager_->StartSnapshots(
+        status_snapshot_interval_ms_, model_repository_manager_.get());
+  }
+
   if (!status.IsOk()) {
     if (model_repository_manager_ == nullptr) {
       ready_state_ = ServerReadyState::SERVER_FAILED_TO_INITIALIZE;
@@ -155,6 +392,11 @@ InferenceServer::Stop()
     return Status::Success;
   }
 
+  // Readiness is lost and new requests are rejected as soon as the
+  // server is exiting.
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  drain_start_ns_ = TIMESPEC_TO_NANOS(now);
   ready_state_ = ServerReadyState::SERVER_EXITING;
 
   if (model_repository_manager_ == nullptr) {
@@ -164,6 +406,23 @@ InferenceServer::Stop()
     LOG_INFO << "Waiting for in-flight inferences to complete.";
   }
 
+  // Queued requests that can't start executing before the exit
+  // timeout expires are failed at that time instead of being dropped
+  // when the server exits. Requests with a queue timeout of their own
+  // still fail as soon as it expires.
+  const uint64_t drain_deadline_ns =
+      drain_start_ns_ + (exit_timeout_secs_ * NANOS_PER_SECOND);
+  for (const auto& m : model_repository_manager_->GetLiveBackendStates()) {
+    for (const auto& v : m.second) {
+      std::shared_ptr<InferenceBackend> backend;
+      if (model_repository_manager_
+              ->GetInferenceBackend(m.first, v.first, &backend)
+              .IsOk()) {
+        backend->Drain(drain_deadline_ns);
+      }
+    }
+  }
+
   Status status = model_repository_manager_->UnloadAllModels();
   if (!status.IsOk()) {
     LOG_ERROR << status.Message();
@@ -257,7 +516,7 @@ InferenceServer::IsReady(bool* ready)
     ServerStatus server_status;
     Status status = status_manager_->Get(
         &server_status, id_, ready_state_, UptimeNs(),
-        model_repository_manager_.get());
+        0 /* since_generation */, model_repository_manager_.get());
 
     *ready = status.IsOk();
     if (*ready) {
@@ -298,43 +557,98 @@ InferenceServer::Infer(
   std::shared_ptr<ScopedAtomicIncrement> inflight(
       new ScopedAtomicIncrement(inflight_request_counter_));
 
-  // Need to capture 'backend' to keep it alive... it goes away when
-  // it goes out of scope which can cause the model to be unloaded,
-  // and we don't want that to happen when a request is in flight.
-  auto OnCompleteHandleInfer = [this, OnCompleteInfer, backend,
-                                response_provider,
-                                inflight](const Status& status) mutable {
-    if (status.IsOk()) {
-      OnCompleteInfer(response_provider->FinalizeResponse(*backend));
+  std::function<void(const Status&)> OnCompleteHandleInfer = OnCompleteInfer;
+  if (PrepareInfer(
+          response_cache_.get(), backend, inflight, request_provider,
+          response_provider, &OnCompleteHandleInfer)) {
+    if (RequiresBatchSlices(*backend, *request_provider)) {
+      RunBatchSlices(
+          backend, infer_stats, request_provider, response_provider,
+          OnCompleteHandleInfer);
     } else {
-      OnCompleteInfer(status);
+      backend->Run(
+          infer_stats, request_provider, response_provider,
+          OnCompleteHandleInfer);
     }
-  };
+  }
+}
+
+void
+InferenceServer::InferBatch(
+    const std::shared_ptr<InferenceBackend>& backend,
+    std::vector<Scheduler::Payload>* payloads)
+{
+  if (ready_state_ != ServerReadyState::SERVER_READY) {
+    for (auto& payload : *payloads) {
+      payload.complete_function_(
+          Status(RequestStatusCode::UNAVAILABLE, "Server not ready"));
+    }
+    return;
+  }
+
+  std::shared_ptr<ScopedAtomicIncrement> inflight(
+      new ScopedAtomicIncrement(inflight_request_counter_));
 
-  backend->Run(
-      infer_stats, request_provider, response_provider, OnCompleteHandleInfer);
+  // Requests completed from the response cache are not run, and
+  // requests that must be split are run as their slices.
+  std::vector<Scheduler::Payload> run_payloads;
+  run_payloads.reserve(payloads->size());
+  for (auto& payload : *payloads) {
+    if (PrepareInfer(
+            response_cache_.get(), backend, inflight,
+            payload.request_provider_, payload.response_provider_,
+            &payload.complete_function_)) {
+      if (RequiresBatchSlices(*backend, *payload.request_provider_)) {
+        RunBatchSlices(
+            backend, payload.stats_, payload.request_provider_,
+            payload.response_provider_, payload.complete_function_);
+      } else {
+        run_payloads.emplace_back(std::move(payload));
+      }
+    }
+  }
+
+  if (!run_payloads.empty()) {
+    backend->RunBatch(&run_payloads);
+  }
 }
 
 Status
 InferenceServer::GetStatus(
-    ServerStatus* server_status, const std::string& model_name)
+    ServerStatus* server_status, const std::string& model_name,
+    uint64_t since_generation)
 {
-  if (ready_state_ == ServerReadyState::SERVER_EXITING) {
-    return Status(RequestStatusCode::UNAVAILABLE, "Server exiting");
-  }
-
+  // Status remains available while the server is exiting so that the
+  // progress of the drain can be followed.
+  const uint64_t inflight_cnt = inflight_request_counter_;
   ScopedAtomicIncrement inflight(inflight_request_counter_);
 
   // If no specific model request just return the entire status
   // object.
   if (model_name.empty()) {
-    return status_manager_->Get(
-        server_status, id_, ready_state_, UptimeNs(),
-        model_repository_manager_.get());
+    RETURN_IF_ERROR(status_manager_->Get(
+        server_status, id_, ready_state_, UptimeNs(), since_generation,
+        model_repository_manager_.get()));
   } else {
-    return status_manager_->Get(
+    RETURN_IF_ERROR(status_manager_->Get(
         server_status, id_, ready_state_, UptimeNs(), model_name,
-        model_repository_manager_.get());
+        model_repository_manager_.get()));
+  }
+
+  if ((ready_state_ == ServerReadyState::SERVER_EXITING) &&
+      (model_repository_manager_ != nullptr)) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const uint64_t elapsed_ns = TIMESPEC_TO_NANOS(now) - drain_start_ns_;
+    const uint64_t timeout_ns = exit_timeout_secs_ * NANOS_PER_SECOND;
+
+    DrainStatus* drain = server_status->mutable_drain_status();
+    drain->set_elapsed_ns(elapsed_ns);
+    drain->set_remaining_ns(
+        (elapsed_ns < timeout_ns) ? (timeout_ns - elapsed_ns) : 0);
+    drain->set_inflight_request_count(inflight_cnt);
+    drain->set_live_model_count(
+        model_repository_manager_->GetLiveBackendStates().size());
   }
 
   return Status::Success;
@@ -369,7 +683,7 @@ InferenceServer::UnloadModel(const std::string& model_name)
 Status
 InferenceServer::RegisterSharedMemory(
     const std::string& name, const std::string& shm_key, const size_t offset,
-    const size_t byte_size)
+    const size_t byte_size, const bool hugetlbfs, const bool lock_pages)
 {
   if (ready_state_ != ServerReadyState::SERVER_READY) {
     return Status(RequestStatusCode::UNAVAILABLE, "Server not ready");
@@ -378,7 +692,23 @@ InferenceServer::RegisterSharedMemory(
   ScopedAtomicIncrement inflight(inflight_request_counter_);
 
   return shared_memory_manager_->RegisterSharedMemory(
-      name, shm_key, offset, byte_size);
+      name, shm_key, offset, byte_size, hugetlbfs, lock_pages);
+}
+
+Status
+InferenceServer::RegisterCudaSharedMemory(
+    const std::string& name, const std::string& shm_key,
+    const size_t handle_offset, const size_t offset, const size_t byte_size,
+    const int device_id)
+{
+  if (ready_state_ != ServerReadyState::SERVER_READY) {
+    return Status(RequestStatusCode::UNAVAILABLE, "Server not ready");
+  }
+
+  ScopedAtomicIncrement inflight(inflight_request_counter_);
+
+  return shared_memory_manager_->RegisterCudaSharedMemory(
+      name, shm_key, handle_offset, offset, byte_size, device_id);
 }
 
 Status
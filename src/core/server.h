@@ -34,8 +34,11 @@
 #include <vector>
 
 #include "src/core/api.pb.h"
+#include "src/core/model_config.h"
 #include "src/core/model_config.pb.h"
 #include "src/core/provider.h"
+#include "src/core/response_cache.h"
+#include "src/core/scheduler.h"
 #include "src/core/server_status.h"
 #include "src/core/server_status.pb.h"
 #include "src/core/shared_memory_manager.h"
@@ -45,13 +48,14 @@ namespace nvidia { namespace inferenceserver {
 
 class InferenceBackend;
 
-enum ModelControlMode { MODE_NONE, MODE_POLL, MODE_EXPLICIT };
+enum ModelControlMode { MODE_NONE, MODE_POLL, MODE_EXPLICIT, MODE_ON_DEMAND };
 
 // Inference server information.
 class InferenceServer {
  public:
   // Construct an inference server.
   InferenceServer();
+  ~InferenceServer();
 
   // Initialize the server. Return true on success, false otherwise.
   Status Init();
@@ -77,9 +81,20 @@ class InferenceServer {
       std::shared_ptr<ModelInferStats> infer_stats,
       std::function<void(const Status&)> OnCompleteInfer);
 
+  // Perform inference on several requests for the same model, which
+  // are enqueued with the model's scheduler together. The status of
+  // each request is returned in the complete function of its payload.
+  void InferBatch(
+      const std::shared_ptr<InferenceBackend>& backend,
+      std::vector<Scheduler::Payload>* payloads);
+
   // Update the ServerStatus object with the status of the model. If
-  // 'model_name' is empty, update with the status of all models.
-  Status GetStatus(ServerStatus* server_status, const std::string& model_name);
+  // 'model_name' is empty, update with the status of all models, or
+  // of only the models that changed after snapshot 'since_generation'
+  // if it is non-zero.
+  Status GetStatus(
+      ServerStatus* server_status, const std::string& model_name,
+      uint64_t since_generation);
 
   // Load the corresponding model. Reload the model if it has been loaded.
   Status LoadModel(const std::string& model_name);
@@ -91,7 +106,14 @@ class InferenceServer {
   // memory region has been registered.
   Status RegisterSharedMemory(
       const std::string& name, const std::string& shm_key, const size_t offset,
-      const size_t byte_size);
+      const size_t byte_size, const bool hugetlbfs, const bool lock_pages);
+
+  // Register the CUDA shared memory region whose cudaIpcMemHandle_t is
+  // stored at 'handle_offset' in system shared memory 'shm_key'.
+  Status RegisterCudaSharedMemory(
+      const std::string& name, const std::string& shm_key,
+      const size_t handle_offset, const size_t offset, const size_t byte_size,
+      const int device_id);
 
   // Unregister the corresponding shared memory region.
   Status UnregisterSharedMemory(const std::string& name);
@@ -148,6 +170,16 @@ class InferenceServer {
   int32_t ExitTimeoutSeconds() const { return exit_timeout_secs_; }
   void SetExitTimeoutSeconds(int32_t s) { exit_timeout_secs_ = std::max(0, s); }
 
+  // Get / set the size of the pinned memory pool, in bytes.
+  uint64_t PinnedMemoryPoolByteSize() const
+  {
+    return pinned_memory_pool_byte_size_;
+  }
+  void SetPinnedMemoryPoolByteSize(uint64_t s)
+  {
+    pinned_memory_pool_byte_size_ = s;
+  }
+
   // Get / set Tensorflow soft placement enable.
   bool TensorFlowSoftPlacementEnabled() const
   {
@@ -175,18 +207,150 @@ class InferenceServer {
     tf_vgpu_memory_limits_ = memory_limits;
   }
 
+  // Get / set the number of threads loading models and the maximum
+  // number of models loading at the same time on each GPU and from
+  // each storage, 0 for no limit.
+  uint32_t ModelLoadThreadCount() const { return model_load_thread_count_; }
+  void SetModelLoadThreadCount(uint32_t c) { model_load_thread_count_ = c; }
+  uint32_t ModelLoadGpuLimit() const { return model_load_gpu_limit_; }
+  void SetModelLoadGpuLimit(uint32_t l) { model_load_gpu_limit_ = l; }
+  uint32_t ModelLoadStorageLimit() const { return model_load_storage_limit_; }
+  void SetModelLoadStorageLimit(uint32_t l) { model_load_storage_limit_ = l; }
+
+  // Get / set the GPU memory, as a map from device to bytes, that the
+  // models loaded on demand may use.
+  const std::map<int, uint64_t>& ModelGpuMemoryBudget() const
+  {
+    return model_gpu_memory_budget_;
+  }
+  void SetModelGpuMemoryBudget(const std::map<int, uint64_t>& budget)
+  {
+    model_gpu_memory_budget_ = budget;
+  }
+
+  // Get / set the number of execution slots of each GPU and the units
+  // of each named resource for the server-wide rate limiter.
+  uint32_t RateLimitGpuSlots() const { return rate_limit_gpu_slots_; }
+  void SetRateLimitGpuSlots(uint32_t s) { rate_limit_gpu_slots_ = s; }
+  const std::map<std::string, uint32_t>& RateLimitResources() const
+  {
+    return rate_limit_resources_;
+  }
+  void SetRateLimitResources(const std::map<std::string, uint32_t>& resources)
+  {
+    rate_limit_resources_ = resources;
+  }
+
+  // Get / set the byte size of the host memory that the response
+  // cache may use, 0 if the response cache is disabled.
+  uint64_t ResponseCacheByteSize() const { return response_cache_byte_size_; }
+  void SetResponseCacheByteSize(uint64_t s) { response_cache_byte_size_ = s; }
+
+  // Get / set the interval, in milliseconds, at which the status
+  // snapshot is refreshed, 0 if status snapshots are disabled.
+  uint64_t StatusSnapshotInterval() const
+  {
+    return status_snapshot_interval_ms_;
+  }
+  void SetStatusSnapshotInterval(uint64_t ms)
+  {
+    status_snapshot_interval_ms_ = ms;
+  }
+
+  // Get / set the directory where the estimated GPU memory of the
+  // model versions is recorded.
+  const std::string& ModelMemoryEstimateDirectory() const
+  {
+    return model_memory_estimate_dir_;
+  }
+  void SetModelMemoryEstimateDirectory(const std::string& dir)
+  {
+    model_memory_estimate_dir_ = dir;
+  }
+
+  // Get / set the directory where the generated model configurations
+  // are cached.
+  const std::string& ModelConfigCacheDirectory() const
+  {
+    return model_config_cache_dir_;
+  }
+  void SetModelConfigCacheDirectory(const std::string& dir)
+  {
+    model_config_cache_dir_ = dir;
+  }
+
+  // Get / set the file where the resolved model configurations are
+  // recorded for the next startup.
+  const std::string& ModelStartupSnapshot() const
+  {
+    return model_startup_snapshot_;
+  }
+  void SetModelStartupSnapshot(const std::string& path)
+  {
+    model_startup_snapshot_ = path;
+  }
+
+  // Get / set the policy for placing the instances of the instance
+  // groups that don't list their GPUs.
+  InstancePlacement GetInstancePlacement() const { return instance_placement_; }
+  void SetInstancePlacement(InstancePlacement p) { instance_placement_ = p; }
+
+  // Get / set the directory and the size limit of the local cache of
+  // the files read from remote model repositories.
+  const std::string& RemoteRepositoryCacheDirectory() const
+  {
+    return remote_repository_cache_dir_;
+  }
+  uint64_t RemoteRepositoryCacheByteSize() const
+  {
+    return remote_repository_cache_byte_size_;
+  }
+  void SetRemoteRepositoryCache(const std::string& dir, uint64_t byte_size)
+  {
+    remote_repository_cache_dir_ = dir;
+    remote_repository_cache_byte_size_ = byte_size;
+  }
+
+  // Get / set the byte size of the parts that files are downloaded in
+  // from remote model repositories, and the number of parts downloaded
+  // in parallel.
+  uint64_t RemoteRepositoryDownloadPartByteSize() const
+  {
+    return remote_repository_download_part_byte_size_;
+  }
+  uint32_t RemoteRepositoryDownloadConcurrency() const
+  {
+    return remote_repository_download_concurrency_;
+  }
+  void SetRemoteRepositoryDownload(uint64_t part_byte_size, uint32_t c)
+  {
+    remote_repository_download_part_byte_size_ = part_byte_size;
+    remote_repository_download_concurrency_ = c;
+  }
+
+  // Get / set TensorRT engine cache directory.
+  const std::string& TensorRTEngineCacheDirectory() const
+  {
+    return trt_engine_cache_dir_;
+  }
+  void SetTensorRTEngineCacheDirectory(const std::string& dir)
+  {
+    trt_engine_cache_dir_ = dir;
+  }
+
   // Return the status manager for this server.
   std::shared_ptr<ServerStatusManager> StatusManager() const
   {
     return status_manager_;
   }
 
-  // Return the requested InferenceBackend object.
+  // Return the requested InferenceBackend object. If models are
+  // loaded on demand, the model is loaded if it is not already.
   Status GetInferenceBackend(
       const std::string& model_name, const int64_t model_version,
       std::shared_ptr<InferenceBackend>* backend)
   {
-    return model_repository_manager_->GetInferenceBackend(
+    return model_repository_manager_->GetInferenceBackendOrLoad(
         model_name, model_version, backend);
   }
 
@@ -204,15 +368,39 @@ class InferenceServer {
   bool strict_model_config_;
   bool strict_readiness_;
   uint32_t exit_timeout_secs_;
+  uint64_t pinned_memory_pool_byte_size_;
+  uint32_t model_load_thread_count_;
+  uint32_t model_load_gpu_limit_;
+  uint32_t model_load_storage_limit_;
+  std::map<int, uint64_t> model_gpu_memory_budget_;
+  uint32_t rate_limit_gpu_slots_;
+  std::map<std::string, uint32_t> rate_limit_resources_;
+  uint64_t response_cache_byte_size_;
+  uint64_t status_snapshot_interval_ms_;
+  std::string model_memory_estimate_dir_;
+  std::string model_config_cache_dir_;
+  std::string model_startup_snapshot_;
+  InstancePlacement instance_placement_;
+  std::string remote_repository_cache_dir_;
+  uint64_t remote_repository_cache_byte_size_;
+  uint64_t remote_repository_download_part_byte_size_;
+  uint32_t remote_repository_download_concurrency_;
 
   // Tensorflow options
   bool tf_soft_placement_enabled_;
   float tf_gpu_memory_fraction_;
   std::map<int, std::pair<int, uint64_t>> tf_vgpu_memory_limits_;
 
+  // TensorRT options
+  std::string trt_engine_cache_dir_;
+
   // Current state of the inference server.
   ServerReadyState ready_state_;
 
+  // The time at which the server started draining, set when
+  // 'ready_state_' becomes SERVER_EXITING.
+  uint64_t drain_start_ns_;
+
   // Number of in-flight requests. During shutdown we attempt to wait
   // for all in-flight requests to complete before exiting.
   std::atomic<uint64_t> inflight_request_counter_;
@@ -220,6 +408,7 @@ class InferenceServer {
   std::shared_ptr<ServerStatusManager> status_manager_;
   std::unique_ptr<ModelRepositoryManager> model_repository_manager_;
   std::unique_ptr<SharedMemoryManager> shared_memory_manager_;
+  std::unique_ptr<ResponseCache> response_cache_;
 };
 
 }}  // namespace nvidia::inferenceserver
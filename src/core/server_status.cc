@@ -26,8 +26,14 @@
 
 #include "src/core/server_status.h"
 
+#include <google/protobuf/util/message_differencer.h>
 #include <time.h>
+#include <atomic>
+#include <chrono>
+#include "src/core/backend.h"
 #include "src/core/constants.h"
+#include "src/core/cpu_isolation.h"
+#include "src/core/cuda_memory_manager.h"
 #include "src/core/logging.h"
 #include "src/core/metric_model_reporter.h"
 #include "src/core/metrics.h"
@@ -58,18 +64,142 @@ SetModelVersionReadyState(
   const auto versions_and_states =
       model_repository_manager->GetVersionStates(model_name);
   for (const auto& version_and_state : versions_and_states) {
-    mvs[version_and_state.first].set_ready_state(version_and_state.second);
+    auto& vs = mvs[version_and_state.first];
+    vs.set_ready_state(version_and_state.second);
+
+    // Ready versions may also report the current state of their
+    // backend, for example the dynamic batcher's queue delay.
+    if (version_and_state.second == ModelReadyState::MODEL_READY) {
+      std::shared_ptr<InferenceBackend> backend;
+      Status status = model_repository_manager->GetInferenceBackend(
+          model_name, version_and_state.first, &backend);
+      if (status.IsOk()) {
+        backend->GetStatus(&vs);
+      }
+    }
+  }
+}
+
+void
+AddStatDuration(StatDuration* dst, const StatDuration& src)
+{
+  dst->set_count(dst->count() + src.count());
+  dst->set_total_time_ns(dst->total_time_ns() + src.total_time_ns());
+}
+
+void
+AddStatDuration(StatDuration* dst, uint64_t duration_ns)
+{
+  dst->set_count(dst->count() + 1);
+  dst->set_total_time_ns(dst->total_time_ns() + duration_ns);
+}
+
+// Add the request statistics of 'src' into 'dst'.
+void
+MergeModelStats(ModelStatus* dst, const ModelStatus& src)
+{
+  auto& dst_mvs = *dst->mutable_version_status();
+  for (const auto& mvs_itr : src.version_status()) {
+    const ModelVersionStatus& src_vs = mvs_itr.second;
+    ModelVersionStatus& dst_vs = dst_mvs[mvs_itr.first];
+    dst_vs.set_model_inference_count(
+        dst_vs.model_inference_count() + src_vs.model_inference_count());
+    dst_vs.set_model_execution_count(
+        dst_vs.model_execution_count() + src_vs.model_execution_count());
+
+    auto& dst_is = *dst_vs.mutable_infer_stats();
+    for (const auto& is_itr : src_vs.infer_stats()) {
+      const InferRequestStats& src_stats = is_itr.second;
+      InferRequestStats& dst_stats = dst_is[is_itr.first];
+      if (src_stats.has_success()) {
+        AddStatDuration(dst_stats.mutable_success(), src_stats.success());
+      }
+      if (src_stats.has_failed()) {
+        AddStatDuration(dst_stats.mutable_failed(), src_stats.failed());
+      }
+      if (src_stats.has_compute()) {
+        AddStatDuration(dst_stats.mutable_compute(), src_stats.compute());
+      }
+      if (src_stats.has_queue()) {
+        AddStatDuration(dst_stats.mutable_queue(), src_stats.queue());
+      }
+      if (src_stats.has_compute_input()) {
+        AddStatDuration(
+            dst_stats.mutable_compute_input(), src_stats.compute_input());
+      }
+      if (src_stats.has_compute_infer()) {
+        AddStatDuration(
+            dst_stats.mutable_compute_infer(), src_stats.compute_infer());
+      }
+      if (src_stats.has_compute_output()) {
+        AddStatDuration(
+            dst_stats.mutable_compute_output(), src_stats.compute_output());
+      }
+    }
   }
 }
 
 }  // namespace
 
 ServerStatusManager::ServerStatusManager(const std::string& server_version)
+    : snapshot_thread_exit_(false)
 {
   const auto& version = server_version;
   if (!version.empty()) {
     server_status_.set_version(version);
   }
+
+  for (size_t i = 0; i < kStatShardCount; ++i) {
+    stat_shards_.emplace_back(new StatShard());
+  }
+}
+
+ServerStatusManager::StatShard*
+ServerStatusManager::ThreadShard()
+{
+  // Threads are assigned shards round-robin the first time they
+  // record a statistic.
+  static std::atomic<size_t> next_shard_idx(0);
+  thread_local size_t shard_idx = next_shard_idx++ % kStatShardCount;
+  return stat_shards_[shard_idx].get();
+}
+
+void
+ServerStatusManager::MergeStatShards(ServerStatus* server_status) const
+{
+  auto& ms = *server_status->mutable_model_status();
+  for (const auto& shard : stat_shards_) {
+    std::lock_guard<std::mutex> lock(shard->mu_);
+    const ServerStatus& stats = shard->stats_;
+
+    if (stats.has_status_stats()) {
+      AddStatDuration(
+          server_status->mutable_status_stats()->mutable_success(),
+          stats.status_stats().success());
+    }
+    if (stats.has_health_stats()) {
+      AddStatDuration(
+          server_status->mutable_health_stats()->mutable_success(),
+          stats.health_stats().success());
+    }
+    if (stats.has_model_control_stats()) {
+      AddStatDuration(
+          server_status->mutable_model_control_stats()->mutable_success(),
+          stats.model_control_stats().success());
+    }
+    if (stats.has_shm_control_stats()) {
+      AddStatDuration(
+          server_status->mutable_shm_control_stats()->mutable_success(),
+          stats.shm_control_stats().success());
+    }
+
+    for (const auto& msitr : stats.model_status()) {
+      auto itr = ms.find(msitr.first);
+      if (itr != ms.end()) {
+        MergeModelStats(&itr->second, msitr.second);
+      }
+    }
+  }
 }
 
 Status
@@ -83,7 +213,21 @@ ServerStatusManager::InitForModel(
     LOG_INFO << "New status tracking for model '" << model_name << "'";
   } else {
     LOG_INFO << "New status tracking for re-added model '" << model_name << "'";
+    // A model loaded on demand is re-added every time it is loaded
+    // after an eviction, keep counting its loads and evictions.
+    const bool has_on_demand_stats = ms[model_name].has_on_demand_stats();
+    ModelOnDemandStats on_demand_stats = ms[model_name].on_demand_stats();
     ms[model_name].Clear();
+    if (has_on_demand_stats) {
+      ms[model_name].mutable_on_demand_stats()->Swap(&on_demand_stats);
+    }
+  }
+
+  // Drop any statistics recorded for a previous incarnation of the
+  // model.
+  for (const auto& shard : stat_shards_) {
+    std::lock_guard<std::mutex> shard_lock(shard->mu_);
+    shard->stats_.mutable_model_status()->erase(model_name);
   }
 
   ms[model_name].mutable_config()->CopyFrom(model_config);
@@ -111,20 +255,68 @@ ServerStatusManager::UpdateConfigForModel(
   return Status::Success;
 }
 
+void
+ServerStatusManager::BuildStatus(
+    ServerStatus* server_status,
+    ModelRepositoryManager* model_repository_manager) const
+{
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    server_status->CopyFrom(server_status_);
+  }
+
+  // The statistics and the version states are collected after
+  // releasing 'mu_' so that model loads and on-demand stat updates
+  // don't wait for the backends to report their state.
+  MergeStatShards(server_status);
+
+  for (auto& msitr : *server_status->mutable_model_status()) {
+    SetModelVersionReadyState(msitr.second, model_repository_manager);
+  }
+
+  CudaMemoryManager::GetStatus(server_status);
+}
+
 Status
 ServerStatusManager::Get(
     ServerStatus* server_status, const std::string& server_id,
     ServerReadyState server_ready_state, uint64_t server_uptime_ns,
+    uint64_t since_generation,
     ModelRepositoryManager* model_repository_manager) const
 {
-  std::lock_guard<std::mutex> lock(mu_);
-  server_status->CopyFrom(server_status_);
+  std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&snapshot_);
+  if (snapshot == nullptr) {
+    BuildStatus(server_status, model_repository_manager);
+  } else if (since_generation == 0) {
+    server_status->CopyFrom(snapshot->status_);
+  } else {
+    // Copy everything except the models that are unchanged since
+    // 'since_generation'.
+    const ServerStatus& ss = snapshot->status_;
+    server_status->Clear();
+    server_status->set_version(ss.version());
+    server_status->mutable_status_stats()->CopyFrom(ss.status_stats());
+    server_status->mutable_health_stats()->CopyFrom(ss.health_stats());
+    server_status->mutable_model_control_stats()->CopyFrom(
+        ss.model_control_stats());
+    server_status->mutable_shm_control_stats()->CopyFrom(
+        ss.shm_control_stats());
+    server_status->mutable_gpu_memory_status()->CopyFrom(
+        ss.gpu_memory_status());
+
+    auto& ms = *server_status->mutable_model_status();
+    for (const auto& msitr : ss.model_status()) {
+      if (msitr.second.generation() > since_generation) {
+        ms[msitr.first].CopyFrom(msitr.second);
+      }
+    }
+  }
+
   server_status->set_id(server_id);
   server_status->set_ready_state(server_ready_state);
   server_status->set_uptime_ns(server_uptime_ns);
-
-  for (auto& msitr : *server_status->mutable_model_status()) {
-    SetModelVersionReadyState(msitr.second, model_repository_manager);
+  if (snapshot != nullptr) {
+    server_status->set_generation(snapshot->generation_);
   }
 
   return Status::Success;
@@ -137,14 +329,29 @@ ServerStatusManager::Get(
     const std::string& model_name,
     ModelRepositoryManager* model_repository_manager) const
 {
-  std::lock_guard<std::mutex> lock(mu_);
-
   server_status->Clear();
-  server_status->set_version(server_status_.version());
   server_status->set_id(server_id);
   server_status->set_ready_state(server_ready_state);
   server_status->set_uptime_ns(server_uptime_ns);
 
+  std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&snapshot_);
+  if (snapshot != nullptr) {
+    server_status->set_version(snapshot->status_.version());
+    server_status->set_generation(snapshot->generation_);
+
+    // A model loaded after the snapshot was taken is built below.
+    const auto& itr = snapshot->status_.model_status().find(model_name);
+    if (itr != snapshot->status_.model_status().end()) {
+      (*server_status->mutable_model_status())[model_name].CopyFrom(
+          itr->second);
+      return Status::Success;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mu_);
+
+  server_status->set_version(server_status_.version());
+
   const auto& itr = server_status_.model_status().find(model_name);
   if (itr == server_status_.model_status().end()) {
     return Status(
@@ -154,6 +361,16 @@ ServerStatusManager::Get(
 
   auto& ms = *server_status->mutable_model_status();
   ms[model_name].CopyFrom(itr->second);
+
+  for (const auto& shard : stat_shards_) {
+    std::lock_guard<std::mutex> shard_lock(shard->mu_);
+    const auto& shard_ms = shard->stats_.model_status();
+    const auto& shard_itr = shard_ms.find(model_name);
+    if (shard_itr != shard_ms.end()) {
+      MergeModelStats(&ms[model_name], shard_itr->second);
+    }
+  }
+
   SetModelVersionReadyState(ms[model_name], model_repository_manager);
 
   return Status::Success;
@@ -163,149 +380,214 @@ void
 ServerStatusManager::UpdateServerStat(
     uint64_t duration, ServerStatTimerScoped::Kind kind)
 {
-  std::lock_guard<std::mutex> lock(mu_);
+  StatShard* shard = ThreadShard();
+  std::lock_guard<std::mutex> lock(shard->mu_);
+  ServerStatus& stats = shard->stats_;
 
   switch (kind) {
-    case ServerStatTimerScoped::Kind::STATUS: {
-      StatDuration* d =
-          server_status_.mutable_status_stats()->mutable_success();
-      d->set_count(d->count() + 1);
-      d->set_total_time_ns(d->total_time_ns() + duration);
+    case ServerStatTimerScoped::Kind::STATUS:
+      AddStatDuration(
+          stats.mutable_status_stats()->mutable_success(), duration);
       break;
-    }
 
-    case ServerStatTimerScoped::Kind::HEALTH: {
-      StatDuration* d =
-          server_status_.mutable_health_stats()->mutable_success();
-      d->set_count(d->count() + 1);
-      d->set_total_time_ns(d->total_time_ns() + duration);
+    case ServerStatTimerScoped::Kind::HEALTH:
+      AddStatDuration(
+          stats.mutable_health_stats()->mutable_success(), duration);
       break;
-    }
 
-    case ServerStatTimerScoped::Kind::MODEL_CONTROL: {
-      StatDuration* d =
-          server_status_.mutable_model_control_stats()->mutable_success();
-      d->set_count(d->count() + 1);
-      d->set_total_time_ns(d->total_time_ns() + duration);
+    case ServerStatTimerScoped::Kind::MODEL_CONTROL:
+      AddStatDuration(
+          stats.mutable_model_control_stats()->mutable_success(), duration);
       break;
-    }
 
-    case ServerStatTimerScoped::Kind::SHARED_MEMORY_CONTROL: {
-      StatDuration* d =
-          server_status_.mutable_shm_control_stats()->mutable_success();
-      d->set_count(d->count() + 1);
-      d->set_total_time_ns(d->total_time_ns() + duration);
+    case ServerStatTimerScoped::Kind::SHARED_MEMORY_CONTROL:
+      AddStatDuration(
+          stats.mutable_shm_control_stats()->mutable_success(), duration);
       break;
-    }
   }
 }
 
 void
-ServerStatusManager::UpdateFailedInferStats(
-    const std::string& model_name, const int64_t model_version,
-    size_t batch_size, uint64_t request_duration_ns)
+ServerStatusManager::UpdateOnDemandLoadStats(
+    const std::string& model_name, uint64_t load_duration_ns)
 {
   std::lock_guard<std::mutex> lock(mu_);
 
-  // Model must exist...
-  auto itr = server_status_.mutable_model_status()->find(model_name);
-  if (itr == server_status_.model_status().end()) {
-    LOG_ERROR << "can't update INFER duration stat for " << model_name;
-  } else {
-    // batch_size may be zero if the failure occurred before it could
-    // be determined... but we still record the failure.
-
-    // model version
-    auto& mvs = *itr->second.mutable_version_status();
-    auto mvs_itr = mvs.find(model_version);
-    if (mvs_itr == mvs.end()) {
-      ModelVersionStatus& version_status = mvs[model_version];
-      InferRequestStats& stats =
-          (*version_status.mutable_infer_stats())[batch_size];
-      stats.mutable_failed()->set_count(1);
-      stats.mutable_failed()->set_total_time_ns(request_duration_ns);
-    } else {
-      ModelVersionStatus& version_status = mvs_itr->second;
-      auto& is = *version_status.mutable_infer_stats();
-      auto is_itr = is.find(batch_size);
-      if (is_itr == is.end()) {
-        InferRequestStats& stats = is[batch_size];
-        stats.mutable_failed()->set_count(1);
-        stats.mutable_failed()->set_total_time_ns(request_duration_ns);
-      } else {
-        InferRequestStats& stats = is_itr->second;
-        stats.mutable_failed()->set_count(stats.failed().count() + 1);
-        stats.mutable_failed()->set_total_time_ns(
-            stats.failed().total_time_ns() + request_duration_ns);
-      }
-    }
+  auto& ms = *server_status_.mutable_model_status();
+  auto itr = ms.find(model_name);
+  if (itr != ms.end()) {
+    AddStatDuration(
+        itr->second.mutable_on_demand_stats()->mutable_load_stats(),
+        load_duration_ns);
+  }
+}
+
+void
+ServerStatusManager::UpdateOnDemandEvictionStats(const std::string& model_name)
+{
+  std::lock_guard<std::mutex> lock(mu_);
+
+  auto& ms = *server_status_.mutable_model_status();
+  auto itr = ms.find(model_name);
+  if (itr != ms.end()) {
+    ModelOnDemandStats* stats = itr->second.mutable_on_demand_stats();
+    stats->set_eviction_count(stats->eviction_count() + 1);
   }
 }
 
+void
+ServerStatusManager::UpdateFailedInferStats(
+    const std::string& model_name, const int64_t model_version,
+    size_t batch_size, uint64_t request_duration_ns)
+{
+  // batch_size may be zero if the failure occurred before it could
+  // be determined... but we still record the failure. Statistics
+  // for a model without status tracking are dropped when the shards
+  // are merged.
+  StatShard* shard = ThreadShard();
+  std::lock_guard<std::mutex> lock(shard->mu_);
+
+  ModelVersionStatus& version_status =
+      (*(*shard->stats_.mutable_model_status())[model_name]
+            .mutable_version_status())[model_version];
+  InferRequestStats& stats =
+      (*version_status.mutable_infer_stats())[batch_size];
+  AddStatDuration(stats.mutable_failed(), request_duration_ns);
+}
+
 void
 ServerStatusManager::UpdateSuccessInferStats(
     const std::string& model_name, const int64_t model_version,
     size_t batch_size, uint32_t execution_cnt, uint64_t request_duration_ns,
-    uint64_t queue_duration_ns, uint64_t compute_duration_ns)
+    uint64_t queue_duration_ns, uint64_t compute_duration_ns,
+    uint64_t compute_input_duration_ns, uint64_t compute_infer_duration_ns,
+    uint64_t compute_output_duration_ns)
 {
-  std::lock_guard<std::mutex> lock(mu_);
-
-  // Model must exist...
-  auto itr = server_status_.mutable_model_status()->find(model_name);
-  if (itr == server_status_.model_status().end()) {
-    LOG_ERROR << "can't update duration stat for " << model_name;
-  } else if (batch_size == 0) {
+  if (batch_size == 0) {
     LOG_ERROR << "can't update INFER durations without batch size for "
               << model_name;
-  } else {
-    // model version
-    auto& mvs = *itr->second.mutable_version_status();
-    auto mvs_itr = mvs.find(model_version);
-    InferRequestStats* new_stats = nullptr;
-    InferRequestStats* existing_stats = nullptr;
-    if (mvs_itr == mvs.end()) {
-      ModelVersionStatus& version_status = mvs[model_version];
-      version_status.set_model_inference_count(batch_size);
-      version_status.set_model_execution_count(execution_cnt);
-      new_stats = &((*version_status.mutable_infer_stats())[batch_size]);
-    } else {
-      ModelVersionStatus& version_status = mvs_itr->second;
-      version_status.set_model_inference_count(
-          version_status.model_inference_count() + batch_size);
-      version_status.set_model_execution_count(
-          version_status.model_execution_count() + execution_cnt);
-
-      auto& is = *version_status.mutable_infer_stats();
-      auto is_itr = is.find(batch_size);
-      if (is_itr == is.end()) {
-        new_stats = &is[batch_size];
-      } else {
-        existing_stats = &is_itr->second;
+    return;
+  }
+
+  StatShard* shard = ThreadShard();
+  std::lock_guard<std::mutex> lock(shard->mu_);
+
+  ModelVersionStatus& version_status =
+      (*(*shard->stats_.mutable_model_status())[model_name]
+            .mutable_version_status())[model_version];
+  version_status.set_model_inference_count(
+      version_status.model_inference_count() + batch_size);
+  version_status.set_model_execution_count(
+      version_status.model_execution_count() + execution_cnt);
+
+  InferRequestStats& stats =
+      (*version_status.mutable_infer_stats())[batch_size];
+  AddStatDuration(stats.mutable_success(), request_duration_ns);
+  AddStatDuration(stats.mutable_compute(), compute_duration_ns);
+  AddStatDuration(stats.mutable_queue(), queue_duration_ns);
+  AddStatDuration(stats.mutable_compute_input(), compute_input_duration_ns);
+  AddStatDuration(stats.mutable_compute_infer(), compute_infer_duration_ns);
+  AddStatDuration(stats.mutable_compute_output(), compute_output_duration_ns);
+}
+
+void
+ServerStatusManager::StartSnapshots(
+    uint64_t interval_ms, ModelRepositoryManager* model_repository_manager)
+{
+  StopSnapshots();
+
+  // Publish the first snapshot before returning so that status
+  // requests never see a missing snapshot while snapshots are enabled.
+  RefreshSnapshot(model_repository_manager);
+
+  snapshot_thread_exit_ = false;
+  snapshot_thread_.reset(
+      new std::thread([this, interval_ms, model_repository_manager]() {
+        SetThreadClass(ThreadClass::BACKGROUND);
+        SnapshotThread(interval_ms, model_repository_manager);
+      }));
+}
+
+void
+ServerStatusManager::StopSnapshots()
+{
+  // Signal the snapshot thread to exit...
+  {
+    std::unique_lock<std::mutex> lock(snapshot_mu_);
+    snapshot_thread_exit_ = true;
+  }
+
+  snapshot_cv_.notify_one();
+  if ((snapshot_thread_ != nullptr) && snapshot_thread_->joinable()) {
+    snapshot_thread_->join();
+  }
+  snapshot_thread_.reset();
+
+  std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>());
+}
+
+void
+ServerStatusManager::RefreshSnapshot(
+    ModelRepositoryManager* model_repository_manager)
+{
+  std::shared_ptr<const Snapshot> prev = std::atomic_load(&snapshot_);
+
+  std::shared_ptr<Snapshot> next = std::make_shared<Snapshot>();
+  BuildStatus(&next->status_, model_repository_manager);
+
+  // A model keeps the generation of the previous snapshot unless its
+  // status differs from the status in that snapshot. The generation
+  // only advances when at least one model changed.
+  next->generation_ = (prev == nullptr) ? 1 : prev->generation_;
+  std::vector<ModelStatus*> changed;
+  for (auto& msitr : *next->status_.mutable_model_status()) {
+    ModelStatus& ms = msitr.second;
+    if (prev != nullptr) {
+      const auto& prev_itr = prev->status_.model_status().find(msitr.first);
+      if (prev_itr != prev->status_.model_status().end()) {
+        ms.set_generation(prev_itr->second.generation());
+        if (google::protobuf::util::MessageDifferencer::Equals(
+                ms, prev_itr->second)) {
+          continue;
+        }
       }
     }
 
-    if (new_stats != nullptr) {
-      new_stats->mutable_success()->set_count(1);
-      new_stats->mutable_success()->set_total_time_ns(request_duration_ns);
-      new_stats->mutable_compute()->set_count(1);
-      new_stats->mutable_compute()->set_total_time_ns(compute_duration_ns);
-      new_stats->mutable_queue()->set_count(1);
-      new_stats->mutable_queue()->set_total_time_ns(queue_duration_ns);
-    } else if (existing_stats != nullptr) {
-      InferRequestStats& stats = *existing_stats;
-      stats.mutable_success()->set_count(stats.success().count() + 1);
-      stats.mutable_success()->set_total_time_ns(
-          stats.success().total_time_ns() + request_duration_ns);
-      stats.mutable_compute()->set_count(stats.compute().count() + 1);
-      stats.mutable_compute()->set_total_time_ns(
-          stats.compute().total_time_ns() + compute_duration_ns);
-      stats.mutable_queue()->set_count(stats.queue().count() + 1);
-      stats.mutable_queue()->set_total_time_ns(
-          stats.queue().total_time_ns() + queue_duration_ns);
-    } else {
-      LOG_ERROR << "Internal error logging INFER stats for " << model_name;
+    changed.push_back(&ms);
+  }
+
+  if ((prev != nullptr) && !changed.empty()) {
+    next->generation_++;
+  }
+  for (ModelStatus* ms : changed) {
+    ms->set_generation(next->generation_);
+  }
+
+  std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>(next));
+}
+
+void
+ServerStatusManager::SnapshotThread(
+    uint64_t interval_ms, ModelRepositoryManager* model_repository_manager)
+{
+  LOG_VERBOSE(1) << "Starting server status snapshot thread, refreshing every "
+                 << interval_ms << "ms...";
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(snapshot_mu_);
+      snapshot_cv_.wait_for(
+          lock, std::chrono::milliseconds(interval_ms),
+          [this] { return snapshot_thread_exit_; });
+      if (snapshot_thread_exit_) {
+        break;
+      }
     }
+
+    RefreshSnapshot(model_repository_manager);
   }
+
+  LOG_VERBOSE(1) << "Stopping server status snapshot thread...";
 }
 
 ServerStatTimerScoped::~ServerStatTimerScoped()
@@ -325,6 +607,12 @@ ServerStatTimerScoped::~ServerStatTimerScoped()
 
 ModelInferStats::~ModelInferStats()
 {
+  // Internal requests, such as warmup requests, have no status
+  // manager and are not reported.
+  if (status_manager_ == nullptr) {
+    return;
+  }
+
   // If the inference request failed before a backend could be
   // determined, there will be no metrics reporter.. so just use the
   // version directly from the inference request.
@@ -351,9 +639,21 @@ ModelInferStats::~ModelInferStats()
         extra_compute_duration_ +
         Duration(TimestampKind::kComputeStart, TimestampKind::kComputeEnd);
 
+    // Breakdown of the compute duration into the input copy, the
+    // model execution and the output copy, available when the backend
+    // captures the input-end and output-start timestamps.
+    uint64_t compute_input_duration_ns = Duration(
+        TimestampKind::kComputeStart, TimestampKind::kComputeInputEnd);
+    uint64_t compute_infer_duration_ns = Duration(
+        TimestampKind::kComputeInputEnd, TimestampKind::kComputeOutputStart);
+    uint64_t compute_output_duration_ns = Duration(
+        TimestampKind::kComputeOutputStart, TimestampKind::kComputeEnd);
+
     status_manager_->UpdateSuccessInferStats(
         model_name_, model_version, batch_size_, execution_count_,
-        request_duration_ns, queue_duration_ns, compute_duration_ns);
+        request_duration_ns, queue_duration_ns, compute_duration_ns,
+        compute_input_duration_ns, compute_infer_duration_ns,
+        compute_output_duration_ns);
 
 #ifdef TRTIS_ENABLE_METRICS
     if (metric_reporter_ != nullptr) {
@@ -371,6 +671,19 @@ ModelInferStats::~ModelInferStats()
           .Increment(compute_duration_ns / 1000);
       metric_reporter_->MetricInferenceQueueDuration(gpu_device_)
           .Increment(queue_duration_ns / 1000);
+      metric_reporter_->MetricInferenceComputeInputDuration(gpu_device_)
+          .Increment(compute_input_duration_ns / 1000);
+      metric_reporter_->MetricInferenceComputeInferDuration(gpu_device_)
+          .Increment(compute_infer_duration_ns / 1000);
+      metric_reporter_->MetricInferenceComputeOutputDuration(gpu_device_)
+          .Increment(compute_output_duration_ns / 1000);
+
+      metric_reporter_->MetricInferenceRequestLatency(gpu_device_)
+          .Observe(request_duration_ns / 1000);
+      metric_reporter_->MetricInferenceComputeLatency(gpu_device_)
+          .Observe(compute_duration_ns / 1000);
+      metric_reporter_->MetricInferenceQueueLatency(gpu_device_)
+          .Observe(queue_duration_ns / 1000);
 
       metric_reporter_->MetricInferenceLoadRatio(gpu_device_)
           .Observe(
@@ -26,7 +26,11 @@
 #pragma once
 
 #include <time.h>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
 #include "src/core/model_config.pb.h"
 #include "src/core/model_repository_manager.h"
 #include "src/core/server_status.pb.h"
@@ -85,8 +89,8 @@ class ModelInferStats {
     kRequestStart,        // Start request processing
     kQueueStart,          // Request enters the queue
     kComputeStart,        // Request leaves queue and starts compute
-    kComputeInputEnd,     // Requests finishes preparing inputs
-    kComputeOutputStart,  // Request starts processing outputs
+    kComputeInputEnd,     // Request finishes preparing and copying inputs
+    kComputeOutputStart,  // Request starts copying and processing outputs
     kComputeEnd,          // Request completes compute
     kRequestEnd,          // Done with request processing
     COUNT__
@@ -100,7 +104,7 @@ class ModelInferStats {
       const std::string& model_name)
       : status_manager_(status_manager), model_name_(model_name),
         requested_model_version_(-1), batch_size_(0), gpu_device_(-1),
-        failed_(false), execution_count_(0),
+        failed_(false), deadline_ns_(UINT64_MAX), execution_count_(0),
         timestamps_((size_t)TimestampKind::COUNT__), extra_queue_duration_(0),
         extra_compute_duration_(0)
   {
@@ -129,12 +133,24 @@ class ModelInferStats {
   // Set CUDA GPU device index where inference was performed.
   void SetGPUDevice(int idx) { gpu_device_ = idx; }
 
+  // Set the deadline of the inference request, a CLOCK_MONOTONIC time
+  // in nanoseconds.
+  void SetDeadline(uint64_t deadline_ns) { deadline_ns_ = deadline_ns; }
+
+  // Get the deadline of the inference request, or UINT64_MAX if the
+  // request has no deadline.
+  uint64_t Deadline() const { return deadline_ns_; }
+
   // Set the number of model executions that were performed for this
   // inference request. Can be zero if this request was dynamically
   // batched with another request (in dynamic batch case only one of
   // the batched requests will count the execution).
   void SetModelExecutionCount(uint32_t count) { execution_count_ = count; }
 
+  // Get the number of model executions that were performed for this
+  // inference request.
+  uint32_t ModelExecutionCount() const { return execution_count_; }
+
   // Get the timestamp for a kind.
   const struct timespec& Timestamp(TimestampKind kind) const
   {
@@ -156,11 +172,14 @@ class ModelInferStats {
   // time.
   void IncrementComputeDuration(const ModelInferStats& other);
 
- private:
+  // Return the duration, in nanoseconds, between two timestamps, or
+  // 0 if either timestamp has not been captured.
   uint64_t Duration(
       ModelInferStats::TimestampKind start_kind,
       ModelInferStats::TimestampKind end_kind) const;
 
+ private:
+
   std::shared_ptr<ServerStatusManager> status_manager_;
   std::shared_ptr<MetricModelReporter> metric_reporter_;
   const std::string model_name_;
@@ -168,6 +187,7 @@ class ModelInferStats {
   size_t batch_size_;
   int gpu_device_;
   bool failed_;
+  uint64_t deadline_ns_;
 
   uint32_t execution_count_;
   std::vector<struct timespec> timestamps_;
@@ -190,10 +210,14 @@ class ServerStatusManager {
   Status UpdateConfigForModel(
       const std::string& model_name, const ModelConfig& model_config);
 
-  // Get the entire server status, including status for all models.
+  // Get the entire server status. If 'since_generation' is non-zero
+  // and snapshots are enabled, only the models whose status changed
+  // in a snapshot generation later than 'since_generation' are
+  // included, otherwise the status for all models is included.
   Status Get(
       ServerStatus* server_status, const std::string& server_id,
       ServerReadyState server_ready_state, uint64_t server_uptime_ns,
+      uint64_t since_generation,
       ModelRepositoryManager* model_repository_manager) const;
 
   // Get the server status and the status for a single model.
@@ -211,14 +235,91 @@ class ServerStatusManager {
       const std::string& model_name, const int64_t model_version,
       size_t batch_size, uint64_t request_duration_ns);
 
-  // Add durations to Infer stats for a successful inference request.
+  // Add durations to Infer stats for a successful inference
+  // request. The compute input, infer and output durations break down
+  // the compute duration and are zero when the backend doesn't report
+  // them.
   void UpdateSuccessInferStats(
       const std::string& model_name, const int64_t model_version,
       size_t batch_size, uint32_t execution_cnt, uint64_t request_duration_ns,
-      uint64_t queue_duration_ns, uint64_t compute_duration_ns);
+      uint64_t queue_duration_ns, uint64_t compute_duration_ns,
+      uint64_t compute_input_duration_ns, uint64_t compute_infer_duration_ns,
+      uint64_t compute_output_duration_ns);
+
+  // Add the duration of a load of a model caused by an inference
+  // request to the on-demand stats of the model.
+  void UpdateOnDemandLoadStats(
+      const std::string& model_name, uint64_t load_duration_ns);
+
+  // Count an eviction of a model in the on-demand stats of the model.
+  void UpdateOnDemandEvictionStats(const std::string& model_name);
+
+  // Start a thread that refreshes a snapshot of the status of all
+  // models every 'interval_ms' milliseconds. While snapshots are
+  // enabled Get() copies the model status from the latest snapshot
+  // instead of building it, so status requests take neither 'mu_'
+  // nor the stat shard locks.
+  void StartSnapshots(
+      uint64_t interval_ms, ModelRepositoryManager* model_repository_manager);
+
+  // Stop the snapshot thread, if any. Must be called before the
+  // model repository manager given to StartSnapshots() is destroyed.
+  void StopSnapshots();
 
  private:
+  // An immutable status of all models. The server id, ready state
+  // and uptime are not set. The generation of each model status is
+  // the snapshot generation in which the model status last changed.
+  struct Snapshot {
+    uint64_t generation_;
+    ServerStatus status_;
+  };
+
+  // Build the status of all models into 'server_status'.
+  void BuildStatus(
+      ServerStatus* server_status,
+      ModelRepositoryManager* model_repository_manager) const;
+
+  // Build a new snapshot and publish it to 'snapshot_'.
+  void RefreshSnapshot(ModelRepositoryManager* model_repository_manager);
+
+  void SnapshotThread(
+      uint64_t interval_ms, ModelRepositoryManager* model_repository_manager);
+  // Number of shards used to accumulate request statistics. Each
+  // thread updates the shard selected by its thread-local index so
+  // that concurrent requests rarely contend on the same mutex.
+  static constexpr size_t kStatShardCount = 16;
+
+  // A shard of the request statistics. Only the stat fields of
+  // 'stats_' are populated, the shards are merged into the model
+  // status when the status is read.
+  struct StatShard {
+    std::mutex mu_;
+    ServerStatus stats_;
+  };
+
+  // Return the shard for the calling thread.
+  StatShard* ThreadShard();
+
+  // Merge the statistics from all shards into 'server_status'. Only
+  // models already present in 'server_status' receive statistics.
+  void MergeStatShards(ServerStatus* server_status) const;
+
+  // Protects 'server_status_', which holds the model configurations
+  // and versions but not the request statistics.
   mutable std::mutex mu_;
   ServerStatus server_status_;
+
+  std::vector<std::unique_ptr<StatShard>> stat_shards_;
+
+  // The latest snapshot, or nullptr if snapshots are not enabled.
+  // Only accessed with std::atomic_load / std::atomic_store so that
+  // readers never wait for the snapshot thread.
+  std::shared_ptr<const Snapshot> snapshot_;
+
+  std::unique_ptr<std::thread> snapshot_thread_;
+  std::mutex snapshot_mu_;
+  std::condition_variable snapshot_cv_;
+  bool snapshot_thread_exit_;
 };
 }}  // namespace nvidia::inferenceserver
@@ -29,9 +29,12 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <linux/magic.h>
 #include <sys/mman.h>
+#include <sys/vfs.h>
 #include <unistd.h>
 #include <algorithm>
+#include <cstring>
 #include <deque>
 #include <exception>
 #include <future>
@@ -39,6 +42,10 @@
 #include "src/core/logging.h"
 #include "src/core/server_status.h"
 
+#ifdef TRTIS_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRTIS_ENABLE_GPU
+
 namespace nvidia { namespace inferenceserver {
 
 namespace {
@@ -58,13 +65,51 @@ OpenSharedMemoryRegion(const std::string& shm_key, int* shm_fd)
   return Status::Success;
 }
 
+Status
+OpenHugetlbfsFile(const std::string& path, int* shm_fd)
+{
+  // hugetlbfs files are not POSIX shared memory objects so they are
+  // opened by path
+  *shm_fd = open(path.c_str(), O_RDWR);
+  if (*shm_fd == -1) {
+    LOG_VERBOSE(1) << "open failed, errno: " << errno;
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "Unable to open hugetlbfs file: '" + path + "'");
+  }
+
+  struct statfs fs;
+  if ((fstatfs(*shm_fd, &fs) != 0) || (fs.f_type != HUGETLBFS_MAGIC)) {
+    close(*shm_fd);
+    *shm_fd = -1;
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "'" + path + "' is not a file on a mounted hugetlbfs");
+  }
+
+  return Status::Success;
+}
+
+size_t
+PageByteSize(const int shm_fd)
+{
+  struct statfs fs;
+  if ((fstatfs(shm_fd, &fs) == 0) && (fs.f_type == HUGETLBFS_MAGIC)) {
+    return fs.f_bsize;
+  }
+
+  return sysconf(_SC_PAGESIZE);
+}
+
 Status
 MapSharedMemory(
     const int shm_fd, const size_t offset, const size_t byte_size,
-    void** mapped_addr)
+    void** mapped_addr, const bool populate = false)
 {
-  // map shared memory to process address space
-  *mapped_addr = mmap(NULL, byte_size, PROT_WRITE, MAP_SHARED, shm_fd, offset);
+  // map shared memory to process address space, optionally faulting
+  // in all pages up front
+  const int flags = MAP_SHARED | (populate ? MAP_POPULATE : 0);
+  *mapped_addr = mmap(NULL, byte_size, PROT_WRITE, flags, shm_fd, offset);
   if (*mapped_addr == MAP_FAILED) {
     LOG_VERBOSE(1) << "mmap failed, errno: " << errno;
     return Status(
@@ -98,117 +143,270 @@ UnmapSharedMemory(void* mapped_addr, size_t byte_size)
   return Status::Success;
 }
 
+#ifdef TRTIS_ENABLE_GPU
+Status
+ReadCudaIpcHandle(
+    const std::string& shm_key, const size_t handle_offset,
+    cudaIpcMemHandle_t* handle)
+{
+  int shm_fd = -1;
+  RETURN_IF_ERROR(OpenSharedMemoryRegion(shm_key, &shm_fd));
+
+  // mmap requires a page-aligned offset so map from the start of the
+  // region and read the handle at 'handle_offset'.
+  void* mapped_addr;
+  const size_t map_byte_size = handle_offset + sizeof(cudaIpcMemHandle_t);
+  Status status = MapSharedMemory(shm_fd, 0, map_byte_size, &mapped_addr);
+  if (status.IsOk()) {
+    memcpy(
+        handle, static_cast<uint8_t*>(mapped_addr) + handle_offset,
+        sizeof(cudaIpcMemHandle_t));
+    status = UnmapSharedMemory(mapped_addr, map_byte_size);
+  }
+
+  Status close_status = CloseSharedMemoryRegion(shm_fd);
+  return status.IsOk() ? close_status : status;
+}
+
+Status
+OpenCudaIpcRegion(
+    const cudaIpcMemHandle_t& handle, const int device_id, void** dev_ptr)
+{
+  int previous_device;
+  cudaError_t err = cudaGetDevice(&previous_device);
+  if (err == cudaSuccess) {
+    err = cudaSetDevice(device_id);
+  }
+  if (err == cudaSuccess) {
+    err = cudaIpcOpenMemHandle(dev_ptr, handle, cudaIpcMemLazyEnablePeerAccess);
+    cudaSetDevice(previous_device);
+  }
+  if (err != cudaSuccess) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "failed to open CUDA IPC handle on device " +
+            std::to_string(device_id) + ": " + cudaGetErrorString(err));
+  }
+
+  return Status::Success;
+}
+
+Status
+CloseCudaIpcRegion(void* dev_ptr, const int device_id)
+{
+  int previous_device;
+  cudaError_t err = cudaGetDevice(&previous_device);
+  if (err == cudaSuccess) {
+    err = cudaSetDevice(device_id);
+  }
+  if (err == cudaSuccess) {
+    err = cudaIpcCloseMemHandle(dev_ptr);
+    cudaSetDevice(previous_device);
+  }
+  if (err != cudaSuccess) {
+    return Status(
+        RequestStatusCode::INTERNAL,
+        "failed to close CUDA IPC handle: " +
+            std::string(cudaGetErrorString(err)));
+  }
+
+  return Status::Success;
+}
+#endif  // TRTIS_ENABLE_GPU
+
 }  // namespace
 
+SharedMemoryManager::SharedMemoryInfo::~SharedMemoryInfo()
+{
+  // Only called once no snapshot of the registered regions references
+  // this region, so no lookup can be using 'mapped_addr_'.
+  Status status;
+  if (memory_type_ == TRTSERVER_MEMORY_GPU) {
+#ifdef TRTIS_ENABLE_GPU
+    status = CloseCudaIpcRegion(mapped_addr_, device_id_);
+#endif  // TRTIS_ENABLE_GPU
+  } else {
+    status = UnmapSharedMemory(mapped_addr_, byte_size_);
+  }
+
+  if (!status.IsOk()) {
+    LOG_ERROR << "failed to release shared memory region '" << name_
+              << "': " << status.Message();
+  }
+}
+
+std::shared_ptr<const SharedMemoryManager::SharedMemoryStateMap>
+SharedMemoryManager::Snapshot() const
+{
+  return std::atomic_load(&shared_memory_map_);
+}
+
+Status
+SharedMemoryManager::AddRegion(std::unique_ptr<SharedMemoryInfo>&& info)
+{
+  // Must hold the lock on register_mu_ while calling this function.
+  std::shared_ptr<SharedMemoryStateMap> next_map =
+      std::make_shared<SharedMemoryStateMap>(*shared_memory_map_);
+  const std::string name = info->name_;
+  next_map->emplace(name, std::shared_ptr<SharedMemoryInfo>(std::move(info)));
+  std::atomic_store(
+      &shared_memory_map_,
+      std::shared_ptr<const SharedMemoryStateMap>(std::move(next_map)));
+
+  return Status::Success;
+}
+
 Status
 SharedMemoryManager::RegisterSharedMemory(
     const std::string& name, const std::string& shm_key, const size_t offset,
-    const size_t byte_size)
+    const size_t byte_size, const bool hugetlbfs, const bool lock_pages)
 {
-  // Serialize all operations that write/read current shared memory regions
+  // Serialize all operations that write current shared memory regions
   std::lock_guard<std::mutex> lock(register_mu_);
 
   // If key is already in shared_memory_map_ then return error saying already
   // registered
-  if (shared_memory_map_.find(name) != shared_memory_map_.end()) {
+  std::shared_ptr<const SharedMemoryStateMap> current_map = Snapshot();
+  if (current_map->find(name) != current_map->end()) {
     return Status(
         RequestStatusCode::ALREADY_EXISTS,
         "shared memory region '" + name + "' is already registered");
   }
 
-  // register (or re-register)
-  void* mapped_addr;
+  // The mapping remains valid after the descriptor is closed so each
+  // region holds only its mapping.
   int shm_fd = -1;
-
-  // don't re-open if shared memory is already open
-  for (auto itr = shared_memory_map_.begin(); itr != shared_memory_map_.end();
-       ++itr) {
-    if (itr->second->shm_key_ == shm_key) {
-      shm_fd = itr->second->shm_fd_;
-      break;
-    }
+  if (hugetlbfs) {
+    RETURN_IF_ERROR(OpenHugetlbfsFile(shm_key, &shm_fd));
+  } else {
+    RETURN_IF_ERROR(OpenSharedMemoryRegion(shm_key, &shm_fd));
   }
 
-  // open and set new shm_fd if new shared memory key
-  if (shm_fd == -1) {
-    RETURN_IF_ERROR(OpenSharedMemoryRegion(shm_key, &shm_fd));
+  // A hugetlbfs mapping must start on a huge page boundary
+  const size_t page_byte_size = PageByteSize(shm_fd);
+  if (hugetlbfs && ((offset % page_byte_size) != 0)) {
+    CloseSharedMemoryRegion(shm_fd);
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "failed to register shared memory region '" + name + "': offset " +
+            std::to_string(offset) + " is not a multiple of the " +
+            std::to_string(page_byte_size) + " byte huge page size");
   }
 
-  Status status = MapSharedMemory(shm_fd, offset, byte_size, &mapped_addr);
+  void* mapped_addr;
+  Status status = MapSharedMemory(
+      shm_fd, offset, byte_size, &mapped_addr, lock_pages /* populate */);
+  Status close_status = CloseSharedMemoryRegion(shm_fd);
   if (!status.IsOk()) {
     return Status(
         RequestStatusCode::INVALID_ARG,
         "failed to register shared memory region '" + name + "'");
   }
 
-  shared_memory_map_.insert(std::make_pair(
-      name, std::unique_ptr<SharedMemoryInfo>(new SharedMemoryInfo(
-                name, shm_key, offset, byte_size, shm_fd, mapped_addr))));
+  std::unique_ptr<SharedMemoryInfo> info(new SharedMemoryInfo(
+      name, shm_key, offset, byte_size, mapped_addr, TRTSERVER_MEMORY_CPU,
+      0 /* device_id */));
+  info->page_byte_size_ = page_byte_size;
+  if (!close_status.IsOk()) {
+    return close_status;
+  }
 
-  return Status::Success;
+  // The pages were faulted in by the mapping. Locking them also keeps
+  // them from being reclaimed but depends on RLIMIT_MEMLOCK, so a
+  // failure to lock doesn't fail the registration.
+  if (lock_pages) {
+    if (mlock(mapped_addr, byte_size) == 0) {
+      info->locked_ = true;
+    } else {
+      LOG_WARNING << "unable to lock shared memory region '" << name
+                  << "' in memory, errno: " << errno;
+    }
+  }
+
+  return AddRegion(std::move(info));
 }
 
 Status
-SharedMemoryManager::UnregisterSharedMemoryHelper(const std::string& name)
+SharedMemoryManager::RegisterCudaSharedMemory(
+    const std::string& name, const std::string& shm_key,
+    const size_t handle_offset, const size_t offset, const size_t byte_size,
+    const int device_id)
 {
-  // Must hold the lock on register_mu_ while calling this function.
-  auto it = shared_memory_map_.find(name);
-  if (it != shared_memory_map_.end()) {
-    RETURN_IF_ERROR(
-        UnmapSharedMemory(it->second->mapped_addr_, it->second->byte_size_));
-
-    // remove region info from shared_memory_map_
-    shared_memory_map_.erase(it);
-
-    // if no other region with same shm_key then close
-    bool last_one = true;
-    for (auto itr = shared_memory_map_.begin(); itr != shared_memory_map_.end();
-         ++itr) {
-      if (itr->second->shm_key_ == it->second->shm_key_) {
-        last_one = false;
-        break;
-      }
-    }
-    if (last_one) {
-      RETURN_IF_ERROR(CloseSharedMemoryRegion(it->second->shm_fd_));
-    }
+#ifdef TRTIS_ENABLE_GPU
+  // Serialize all operations that write current shared memory regions
+  std::lock_guard<std::mutex> lock(register_mu_);
+
+  std::shared_ptr<const SharedMemoryStateMap> current_map = Snapshot();
+  if (current_map->find(name) != current_map->end()) {
+    return Status(
+        RequestStatusCode::ALREADY_EXISTS,
+        "shared memory region '" + name + "' is already registered");
   }
 
-  return Status::Success;
+  cudaIpcMemHandle_t handle;
+  Status status = ReadCudaIpcHandle(shm_key, handle_offset, &handle);
+  if (!status.IsOk()) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "failed to read CUDA IPC handle for shared memory region '" + name +
+            "': " + status.Message());
+  }
+
+  // The handle references the start of the client's allocation so
+  // 'offset' is applied when an address is requested, the same as for
+  // system shared memory.
+  void* dev_ptr;
+  status = OpenCudaIpcRegion(handle, device_id, &dev_ptr);
+  if (!status.IsOk()) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "failed to register shared memory region '" + name +
+            "': " + status.Message());
+  }
+
+  return AddRegion(std::unique_ptr<SharedMemoryInfo>(new SharedMemoryInfo(
+      name, shm_key, offset, byte_size, dev_ptr, TRTSERVER_MEMORY_GPU,
+      device_id)));
+#else
+  return Status(
+      RequestStatusCode::UNSUPPORTED,
+      "failed to register shared memory region '" + name +
+          "': CUDA shared memory is not supported");
+#endif  // TRTIS_ENABLE_GPU
 }
 
 Status
 SharedMemoryManager::UnregisterSharedMemory(const std::string& name)
 {
-  // Serialize all operations that write/read current shared memory regions
+  // Serialize all operations that write current shared memory regions
   std::lock_guard<std::mutex> lock(register_mu_);
 
-  return UnregisterSharedMemoryHelper(name);
+  std::shared_ptr<const SharedMemoryStateMap> current_map = Snapshot();
+  if (current_map->find(name) == current_map->end()) {
+    return Status::Success;
+  }
+
+  // Publish a map without the region. The region itself is released
+  // when the last lookup still holding the previous map finishes.
+  std::shared_ptr<SharedMemoryStateMap> next_map =
+      std::make_shared<SharedMemoryStateMap>(*current_map);
+  next_map->erase(name);
+  std::atomic_store(
+      &shared_memory_map_,
+      std::shared_ptr<const SharedMemoryStateMap>(std::move(next_map)));
+
+  return Status::Success;
 }
 
 Status
 SharedMemoryManager::UnregisterAllSharedMemory()
 {
-  // Serialize all operations that write/read current shared memory regions
+  // Serialize all operations that write current shared memory regions
   std::lock_guard<std::mutex> lock(register_mu_);
 
-  std::string error_message =
-      "Failed to unregister the following shared memory regions: ";
-  std::vector<std::string> unregister_fails;
-  for (const auto& shm_info : shared_memory_map_) {
-    Status unregister_status = UnregisterSharedMemoryHelper(shm_info.first);
-    if (!unregister_status.IsOk()) {
-      unregister_fails.push_back(shm_info.first);
-    }
-  }
-
-  if (!unregister_fails.empty()) {
-    for (auto unreg_fail : unregister_fails) {
-      error_message += unreg_fail + " ,";
-    }
-    LOG_ERROR << error_message;
-    return Status(RequestStatusCode::INTERNAL, error_message);
-  }
+  std::atomic_store(
+      &shared_memory_map_, std::shared_ptr<const SharedMemoryStateMap>(
+                               std::make_shared<SharedMemoryStateMap>()));
 
   return Status::Success;
 }
@@ -216,15 +414,14 @@ SharedMemoryManager::UnregisterAllSharedMemory()
 Status
 SharedMemoryManager::GetSharedMemoryStatus(SharedMemoryStatus* shm_status)
 {
-  // Serialize all operations that write/read current shared memory regions
-  std::lock_guard<std::mutex> lock(register_mu_);
-
-  for (const auto& shm_info : shared_memory_map_) {
+  for (const auto& shm_info : *Snapshot()) {
     auto rshm_region = shm_status->add_shared_memory_region();
     rshm_region->set_name(shm_info.second->name_);
     rshm_region->set_shared_memory_key(shm_info.second->shm_key_);
     rshm_region->set_offset(shm_info.second->offset_);
     rshm_region->set_byte_size(shm_info.second->byte_size_);
+    rshm_region->set_page_byte_size(shm_info.second->page_byte_size_);
+    rshm_region->set_locked(shm_info.second->locked_);
   }
 
   return Status::Success;
@@ -232,7 +429,8 @@ SharedMemoryManager::GetSharedMemoryStatus(SharedMemoryStatus* shm_status)
 
 SharedMemoryManager::SharedMemoryManager(
     const std::shared_ptr<ServerStatusManager>& status_manager)
-    : status_manager_(status_manager)
+    : status_manager_(status_manager),
+      shared_memory_map_(std::make_shared<SharedMemoryStateMap>())
 {
 }
 
@@ -259,13 +457,22 @@ SharedMemoryManager::SharedMemoryAddress(
     const std::string& name, size_t offset, size_t byte_size,
     void** shm_mapped_addr)
 {
-  auto it = shared_memory_map_.find(name);
-  if (it == shared_memory_map_.end()) {
+  // Lookups don't take 'register_mu_', they search whatever snapshot
+  // of the registered regions is current.
+  std::shared_ptr<const SharedMemoryStateMap> current_map = Snapshot();
+  auto it = current_map->find(name);
+  if (it == current_map->end()) {
     return Status(
         RequestStatusCode::INTERNAL,
         "Unable to find shared memory region: '" + name + "'");
   }
 
+  if ((offset + byte_size) > it->second->byte_size_) {
+    return Status(
+        RequestStatusCode::INVALID_ARG,
+        "Invalid offset + byte size for shared memory region: '" + name + "'");
+  }
+
   *shm_mapped_addr =
       (void*)((uint8_t*)it->second->mapped_addr_ + it->second->offset_ + offset);
   return Status::Success;
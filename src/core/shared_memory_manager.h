@@ -26,11 +26,14 @@
 //
 #pragma once
 
+#include <map>
+#include <memory>
 #include <mutex>
 #include "src/core/model_config.h"
 #include "src/core/model_config.pb.h"
 #include "src/core/server_status.pb.h"
 #include "src/core/status.h"
+#include "src/core/trtserver.h"
 
 namespace nvidia { namespace inferenceserver {
 
@@ -42,27 +45,42 @@ class ServerStatusManager;
 class SharedMemoryManager {
  public:
   /// A struct that records the shared memory regions registered by the shared
-  /// memory manager.
+  /// memory manager. The mapping is released when the struct is
+  /// destroyed.
   struct SharedMemoryInfo {
     SharedMemoryInfo(
         const std::string& name, const std::string& shm_key,
-        const size_t offset, const size_t byte_size, int shm_fd,
-        void* mapped_addr)
+        const size_t offset, const size_t byte_size, void* mapped_addr,
+        TRTSERVER_Memory_Type memory_type, int device_id)
         : name_(name), shm_key_(shm_key), offset_(offset),
-          byte_size_(byte_size), shm_fd_(shm_fd), mapped_addr_(mapped_addr)
+          byte_size_(byte_size), mapped_addr_(mapped_addr),
+          memory_type_(memory_type), device_id_(device_id),
+          page_byte_size_(0), locked_(false)
     {
     }
+    ~SharedMemoryInfo();
 
     std::string name_;
     std::string shm_key_;
     size_t offset_;
     size_t byte_size_;
-    int shm_fd_;
     void* mapped_addr_;
+
+    // For a CUDA region 'mapped_addr_' is the device pointer returned
+    // by cudaIpcOpenMemHandle.
+    TRTSERVER_Memory_Type memory_type_;
+    int device_id_;
+
+    // The size of the pages backing a system region, which is the huge
+    // page size for a region on hugetlbfs. Zero for a CUDA region.
+    size_t page_byte_size_;
+
+    // True if the pages of the region are locked in memory.
+    bool locked_;
   };
 
   using SharedMemoryStateMap =
-      std::map<std::string, std::unique_ptr<SharedMemoryInfo>>;
+      std::map<std::string, std::shared_ptr<SharedMemoryInfo>>;
 
   ~SharedMemoryManager();
 
@@ -74,14 +92,34 @@ class SharedMemoryManager {
   /// registered.
   /// \param offset The offset into the shared memory region.
   /// \param byte_size The size, in bytes of the tensor data.
-  /// \parm type The type action to be performed. If the action is REGISTER and
-  /// the shared memory region has been registered, the shared memory region
-  /// will be re-registered.
+  /// \param hugetlbfs If true 'shm_key' is the path of a file on a mounted
+  /// hugetlbfs instead of the name of a POSIX shared memory object.
+  /// \param lock_pages If true fault in and lock the pages of the region at
+  /// registration so that inferences don't incur page faults.
   /// \return error status. Return an error if it tries to register a shared
   /// memory region that has already been registered.
   Status RegisterSharedMemory(
       const std::string& name, const std::string& shm_key, const size_t offset,
-      const size_t byte_size);
+      const size_t byte_size, const bool hugetlbfs, const bool lock_pages);
+
+  /// Register a CUDA shared memory region if valid. If already registered
+  /// return an error. The region is described by a cudaIpcMemHandle_t that
+  /// the client stores in a system shared memory region.
+  /// \param name The user-given name for the shared memory region to be
+  /// registered.
+  /// \param shm_key The name of the system shared memory region holding the
+  /// cudaIpcMemHandle_t.
+  /// \param handle_offset The offset of the cudaIpcMemHandle_t within the
+  /// system shared memory region.
+  /// \param offset The offset into the CUDA memory referenced by the handle.
+  /// \param byte_size The size, in bytes of the tensor data.
+  /// \param device_id The GPU device that the CUDA memory resides on.
+  /// \return error status. Return an error if it tries to register a shared
+  /// memory region that has already been registered.
+  Status RegisterCudaSharedMemory(
+      const std::string& name, const std::string& shm_key,
+      const size_t handle_offset, const size_t offset, const size_t byte_size,
+      const int device_id);
 
   /// Unregister a specified shared memory region if registered else do nothing
   /// and return success.
@@ -111,12 +149,25 @@ class SharedMemoryManager {
  private:
   SharedMemoryManager(
       const std::shared_ptr<ServerStatusManager>& status_manager);
-  Status UnregisterSharedMemoryHelper(const std::string& name);
 
+  // Return the current map of registered regions.
+  std::shared_ptr<const SharedMemoryStateMap> Snapshot() const;
+
+  // Publish a new map that adds 'info' to the registered regions. Must
+  // hold 'register_mu_'.
+  Status AddRegion(std::unique_ptr<SharedMemoryInfo>&& info);
+
+  // Serializes register and unregister. Lookups don't take the mutex.
   std::mutex register_mu_;
 
   std::shared_ptr<ServerStatusManager> status_manager_;
-  SharedMemoryStateMap shared_memory_map_;
+
+  // The registered regions. The map is never modified once published,
+  // instead writers atomically replace it with a modified copy. Each
+  // lookup holds a reference to the map it searched, so a region that
+  // is unregistered while a lookup is running is not released until
+  // that lookup completes.
+  std::shared_ptr<const SharedMemoryStateMap> shared_memory_map_;
 };
 
 }}  // namespace nvidia::inferenceserver
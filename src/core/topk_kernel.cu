@@ -0,0 +1,145 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "src/core/topk_kernel.h"
+
+namespace nvidia { namespace inferenceserver {
+
+namespace {
+
+constexpr unsigned int TOPK_BLOCK_SIZE = 256;
+
+// Return true if value 'v1' at index 'i1' comes before value 'v2' at
+// index 'i2' in the classification order.
+template <typename T>
+__device__ bool
+Precedes(const T v1, const uint64_t i1, const T v2, const uint64_t i2)
+{
+  return (v1 > v2) || ((v1 == v2) && (i1 < i2));
+}
+
+// Each block selects the top 'k' of one row. Round 'r' finds the
+// first value in classification order that comes after the one found
+// by round 'r - 1', which needs no memory beyond the block's
+// reduction buffers. 'k' is small so the 'k' scans of the row are
+// cheaper than sorting it.
+template <typename T>
+__global__ void
+TopKKernel(
+    const T* probs, const uint64_t n, const uint64_t k, uint64_t* idx,
+    float* values)
+{
+  __shared__ T block_values[TOPK_BLOCK_SIZE];
+  __shared__ uint64_t block_idx[TOPK_BLOCK_SIZE];
+
+  const unsigned int tid = threadIdx.x;
+  const T* row = probs + blockIdx.x * n;
+
+  T prev_value = T();
+  uint64_t prev_idx = 0;
+  for (uint64_t r = 0; r < k; ++r) {
+    // An index of 'n' marks that the thread found no candidate.
+    T best_value = T();
+    uint64_t best_idx = n;
+    for (uint64_t i = tid; i < n; i += TOPK_BLOCK_SIZE) {
+      const T v = row[i];
+      if (((r == 0) || Precedes(prev_value, prev_idx, v, i)) &&
+          ((best_idx == n) || Precedes(v, i, best_value, best_idx))) {
+        best_value = v;
+        best_idx = i;
+      }
+    }
+
+    block_values[tid] = best_value;
+    block_idx[tid] = best_idx;
+    __syncthreads();
+
+    for (unsigned int s = TOPK_BLOCK_SIZE / 2; s > 0; s >>= 1) {
+      if (tid < s) {
+        const unsigned int j = tid + s;
+        if ((block_idx[j] != n) &&
+            ((block_idx[tid] == n) ||
+             Precedes(
+                 block_values[j], block_idx[j], block_values[tid],
+                 block_idx[tid]))) {
+          block_values[tid] = block_values[j];
+          block_idx[tid] = block_idx[j];
+        }
+      }
+      __syncthreads();
+    }
+
+    prev_value = block_values[0];
+    prev_idx = block_idx[0];
+    if (tid == 0) {
+      idx[blockIdx.x * k + r] = prev_idx;
+      values[blockIdx.x * k + r] = static_cast<float>(prev_value);
+    }
+
+    // Don't let the next round overwrite the result before every
+    // thread has read it.
+    __syncthreads();
+  }
+}
+
+}  // namespace
+
+template <typename T>
+cudaError_t
+RunTopKKernel(
+    const T* probs, const size_t batch_size, const size_t n, const size_t k,
+    uint64_t* idx, float* values, cudaStream_t stream)
+{
+  if ((batch_size == 0) || (k == 0)) {
+    return cudaSuccess;
+  }
+
+  TopKKernel<T><<<batch_size, TOPK_BLOCK_SIZE, 0, stream>>>(
+      probs, n, k, idx, values);
+  return cudaGetLastError();
+}
+
+template cudaError_t RunTopKKernel<uint8_t>(
+    const uint8_t*, size_t, size_t, size_t, uint64_t*, float*, cudaStream_t);
+template cudaError_t RunTopKKernel<uint16_t>(
+    const uint16_t*, size_t, size_t, size_t, uint64_t*, float*, cudaStream_t);
+template cudaError_t RunTopKKernel<uint32_t>(
+    const uint32_t*, size_t, size_t, size_t, uint64_t*, float*, cudaStream_t);
+template cudaError_t RunTopKKernel<uint64_t>(
+    const uint64_t*, size_t, size_t, size_t, uint64_t*, float*, cudaStream_t);
+template cudaError_t RunTopKKernel<int8_t>(
+    const int8_t*, size_t, size_t, size_t, uint64_t*, float*, cudaStream_t);
+template cudaError_t RunTopKKernel<int16_t>(
+    const int16_t*, size_t, size_t, size_t, uint64_t*, float*, cudaStream_t);
+template cudaError_t RunTopKKernel<int32_t>(
+    const int32_t*, size_t, size_t, size_t, uint64_t*, float*, cudaStream_t);
+template cudaError_t RunTopKKernel<int64_t>(
+    const int64_t*, size_t, size_t, size_t, uint64_t*, float*, cudaStream_t);
+template cudaError_t RunTopKKernel<float>(
+    const float*, size_t, size_t, size_t, uint64_t*, float*, cudaStream_t);
+template cudaError_t RunTopKKernel<double>(
+    const double*, size_t, size_t, size_t, uint64_t*, float*, cudaStream_t);
+
+}}  // namespace nvidia::inferenceserver
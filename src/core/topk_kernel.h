@@ -0,0 +1,51 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <cuda_runtime_api.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace nvidia { namespace inferenceserver {
+
+// The largest classification count that is selected on the device.
+// Larger counts are selected on the host from the full output.
+constexpr size_t MAX_DEVICE_CLASSIFICATION_COUNT = 64;
+
+// Select the 'k' largest values of each of the 'batch_size' rows of
+// 'n' values in 'probs', ordered from largest to smallest with ties
+// broken by the lower index, as classification results are on the
+// host. The indices and the values, converted to float, of the
+// selected values of each row are written to 'idx' and 'values',
+// which must hold 'batch_size' * 'k' entries. All buffers are in GPU
+// memory and the kernel is issued on 'stream'. 'k' must not be
+// larger than 'n' or MAX_DEVICE_CLASSIFICATION_COUNT.
+template <typename T>
+cudaError_t RunTopKKernel(
+    const T* probs, const size_t batch_size, const size_t n, const size_t k,
+    uint64_t* idx, float* values, cudaStream_t stream);
+
+}}  // namespace nvidia::inferenceserver
@@ -26,18 +26,30 @@
 
 #include "src/core/trtserver.h"
 
+#include <atomic>
+#include <chrono>
 #include <string>
+#include <thread>
 #include <vector>
 #include "src/core/backend.h"
+#include "src/core/constants.h"
+#include "src/core/cpu_isolation.h"
 #include "src/core/logging.h"
 #include "src/core/metrics.h"
+#include "src/core/nvtx.h"
 #include "src/core/provider_utils.h"
 #include "src/core/request_status.pb.h"
+#include "src/core/response_buffer_pool.h"
+#include "src/core/sequence_batch_scheduler.h"
 #include "src/core/server.h"
 #include "src/core/server_status.h"
 #include "src/core/status.h"
 #include "src/core/tracing.h"
 
+#ifdef TRTIS_ENABLE_GPU
+#include <cuda_profiler_api.h>
+#endif  // TRTIS_ENABLE_GPU
+
 namespace ni = nvidia::inferenceserver;
 
 namespace {
@@ -121,27 +133,40 @@ class TrtServerSharedMemoryBlock {
  public:
   explicit TrtServerSharedMemoryBlock(
       TRTSERVER_Memory_Type type, const char* name, const char* shm_key,
-      const size_t offset, const size_t byte_size);
+      const size_t handle_offset, const size_t offset, const size_t byte_size,
+      const int device_id);
 
   TRTSERVER_Memory_Type Type() const { return type_; }
   const std::string& Name() const { return name_; }
   const std::string& ShmKey() const { return shm_key_; }
+  size_t HandleOffset() const { return handle_offset_; }
   size_t Offset() const { return offset_; }
   size_t ByteSize() const { return byte_size_; }
+  int DeviceId() const { return device_id_; }
+  bool Hugetlbfs() const { return hugetlbfs_; }
+  void SetHugetlbfs(bool h) { hugetlbfs_ = h; }
+  bool LockPages() const { return lock_pages_; }
+  void SetLockPages(bool l) { lock_pages_ = l; }
 
  private:
   const TRTSERVER_Memory_Type type_;
   const std::string name_;
   const std::string shm_key_;
+  const size_t handle_offset_;
   const size_t offset_;
   const size_t byte_size_;
+  const int device_id_;
+  bool hugetlbfs_;
+  bool lock_pages_;
 };
 
 TrtServerSharedMemoryBlock::TrtServerSharedMemoryBlock(
     TRTSERVER_Memory_Type type, const char* name, const char* shm_key,
-    const size_t offset, const size_t byte_size)
-    : type_(type), name_(name), shm_key_(shm_key), offset_(offset),
-      byte_size_(byte_size)
+    const size_t handle_offset, const size_t offset, const size_t byte_size,
+    const int device_id)
+    : type_(type), name_(name), shm_key_(shm_key),
+      handle_offset_(handle_offset), offset_(offset), byte_size_(byte_size),
+      device_id_(device_id), hugetlbfs_(false), lock_pages_(false)
 {
 }
 
@@ -174,6 +199,57 @@ TrtServerResponseAllocator::TrtServerResponseAllocator(
 {
 }
 
+// Allocation functions of the allocator returned by
+// TRTSERVER_ResponseAllocatorNewPooled. Buffers are always in CPU
+// memory and come from the response buffer pool.
+TRTSERVER_Error*
+PooledResponseAlloc(
+    TRTSERVER_ResponseAllocator* allocator, void** buffer, void** buffer_userp,
+    const char* tensor_name, size_t byte_size,
+    TRTSERVER_Memory_Type memory_type, int64_t memory_type_id, void* userp)
+{
+  *buffer = nullptr;
+  *buffer_userp = nullptr;
+  if ((byte_size > 0) && (memory_type == TRTSERVER_MEMORY_CPU)) {
+    *buffer = ni::ResponseBufferPool::Alloc(byte_size);
+  }
+
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+PooledResponseRelease(
+    TRTSERVER_ResponseAllocator* allocator, void* buffer, void* buffer_userp,
+    size_t byte_size, TRTSERVER_Memory_Type memory_type, int64_t memory_type_id)
+{
+  ni::ResponseBufferPool::Free(reinterpret_cast<char*>(buffer), byte_size);
+  return nullptr;  // Success
+}
+
+//
+// TrtServerSequenceBinding
+//
+// Implementation for TRTSERVER_SequenceBinding. Deleting the binding
+// closes it, ending its sequence. Request providers share the
+// binding and so it stays valid for the requests still in flight.
+//
+class TrtServerSequenceBinding {
+ public:
+  TrtServerSequenceBinding()
+      : binding_(std::make_shared<ni::SequenceBinding>())
+  {
+  }
+  ~TrtServerSequenceBinding() { binding_->Close(); }
+
+  const std::shared_ptr<ni::SequenceBinding>& Binding() const
+  {
+    return binding_;
+  }
+
+ private:
+  std::shared_ptr<ni::SequenceBinding> binding_;
+};
+
 //
 // TrtServerProtobuf
 //
@@ -266,12 +342,113 @@ class TrtServerOptions {
   unsigned int ExitTimeout() const { return exit_timeout_; }
   void SetExitTimeout(unsigned int t) { exit_timeout_ = t; }
 
+  uint64_t PinnedMemoryPoolByteSize() const { return pinned_memory_pool_size_; }
+  void SetPinnedMemoryPoolByteSize(uint64_t s) { pinned_memory_pool_size_ = s; }
+
+  unsigned int ModelLoadThreadCount() const { return load_thread_count_; }
+  void SetModelLoadThreadCount(unsigned int c) { load_thread_count_ = c; }
+
+  unsigned int ModelLoadGpuLimit() const { return load_gpu_limit_; }
+  unsigned int ModelLoadStorageLimit() const { return load_storage_limit_; }
+  void SetModelLoadLimits(unsigned int gpu_limit, unsigned int storage_limit)
+  {
+    load_gpu_limit_ = gpu_limit;
+    load_storage_limit_ = storage_limit;
+  }
+
+  const std::map<int, uint64_t>& ModelGpuMemoryBudget() const
+  {
+    return gpu_memory_budget_;
+  }
+  void AddModelGpuMemoryBudget(int gpu_device, uint64_t byte_size)
+  {
+    gpu_memory_budget_[gpu_device] = byte_size;
+  }
+
+  unsigned int RateLimitGpuSlots() const { return rate_limit_gpu_slots_; }
+  void SetRateLimitGpuSlots(unsigned int s) { rate_limit_gpu_slots_ = s; }
+
+  const std::map<std::string, uint32_t>& RateLimitResources() const
+  {
+    return rate_limit_resources_;
+  }
+  void AddRateLimitResource(const std::string& name, uint32_t count)
+  {
+    rate_limit_resources_[name] = count;
+  }
+
+  uint64_t ResponseCacheByteSize() const { return response_cache_size_; }
+  void SetResponseCacheByteSize(uint64_t s) { response_cache_size_ = s; }
+
+  uint64_t StatusSnapshotInterval() const { return status_snapshot_ms_; }
+  void SetStatusSnapshotInterval(uint64_t ms) { status_snapshot_ms_ = ms; }
+
+  const std::string& ModelMemoryEstimateDirectory() const
+  {
+    return memory_estimate_dir_;
+  }
+  void SetModelMemoryEstimateDirectory(const char* dir)
+  {
+    memory_estimate_dir_ = dir;
+  }
+
+  const std::string& ModelConfigCacheDirectory() const
+  {
+    return model_config_cache_dir_;
+  }
+  void SetModelConfigCacheDirectory(const char* dir)
+  {
+    model_config_cache_dir_ = dir;
+  }
+
+  const std::string& ModelStartupSnapshot() const
+  {
+    return model_startup_snapshot_;
+  }
+  void SetModelStartupSnapshot(const char* path)
+  {
+    model_startup_snapshot_ = path;
+  }
+
+  ni::InstancePlacement InstancePlacement() const
+  {
+    return instance_placement_;
+  }
+  void SetInstancePlacement(ni::InstancePlacement p)
+  {
+    instance_placement_ = p;
+  }
+
+  const std::map<ni::ThreadClass, std::vector<int>>& ThreadClassCpus() const
+  {
+    return thread_class_cpus_;
+  }
+  void SetThreadClassCpus(ni::ThreadClass c, const std::vector<int>& cpus)
+  {
+    thread_class_cpus_[c] = cpus;
+  }
+
   bool Metrics() const { return metrics_; }
   void SetMetrics(bool b) { metrics_ = b; }
 
   bool GpuMetrics() const { return gpu_metrics_; }
   void SetGpuMetrics(bool b) { gpu_metrics_ = b; }
 
+  const std::vector<double>& MetricsLatencyBuckets() const
+  {
+    return metrics_latency_buckets_;
+  }
+  void SetMetricsLatencyBuckets(const std::vector<double>& b)
+  {
+    metrics_latency_buckets_ = b;
+  }
+
+  uint64_t MetricsCacheMaxAge() const { return metrics_cache_max_age_ms_; }
+  void SetMetricsCacheMaxAge(uint64_t ms) { metrics_cache_max_age_ms_ = ms; }
+
+  uint64_t GpuMetricsPollInterval() const { return gpu_metrics_poll_ms_; }
+  void SetGpuMetricsPollInterval(uint64_t ms) { gpu_metrics_poll_ms_ = ms; }
+
   bool TensorFlowSoftPlacement() const { return tf_soft_placement_; }
   void SetTensorFlowSoftPlacement(bool b) { tf_soft_placement_ = b; }
 
@@ -290,6 +467,43 @@ class TrtServerOptions {
         std::make_pair(num_vgpus, per_vgpu_memory_mbytes);
   }
 
+  const std::string& TensorRTEngineCacheDirectory() const
+  {
+    return trt_engine_cache_dir_;
+  }
+  void SetTensorRTEngineCacheDirectory(const char* d)
+  {
+    trt_engine_cache_dir_ = d;
+  }
+
+  const std::string& RemoteRepositoryCacheDirectory() const
+  {
+    return remote_repo_cache_dir_;
+  }
+  uint64_t RemoteRepositoryCacheByteSize() const
+  {
+    return remote_repo_cache_byte_size_;
+  }
+  void SetRemoteRepositoryCache(const char* d, uint64_t s)
+  {
+    remote_repo_cache_dir_ = d;
+    remote_repo_cache_byte_size_ = s;
+  }
+
+  uint64_t RemoteRepositoryDownloadPartByteSize() const
+  {
+    return remote_repo_download_part_size_;
+  }
+  unsigned int RemoteRepositoryDownloadConcurrency() const
+  {
+    return remote_repo_download_concurrency_;
+  }
+  void SetRemoteRepositoryDownload(uint64_t s, unsigned int c)
+  {
+    remote_repo_download_part_size_ = s;
+    remote_repo_download_concurrency_ = c;
+  }
+
  private:
   std::string server_id_;
   std::set<std::string> repo_paths_;
@@ -300,18 +514,50 @@ class TrtServerOptions {
   bool strict_readiness_;
   bool metrics_;
   bool gpu_metrics_;
+  std::vector<double> metrics_latency_buckets_;
+  uint64_t metrics_cache_max_age_ms_;
+  uint64_t gpu_metrics_poll_ms_;
   unsigned int exit_timeout_;
+  uint64_t pinned_memory_pool_size_;
+  unsigned int load_thread_count_;
+  unsigned int load_gpu_limit_;
+  unsigned int load_storage_limit_;
+  std::map<int, uint64_t> gpu_memory_budget_;
+  unsigned int rate_limit_gpu_slots_;
+  std::map<std::string, uint32_t> rate_limit_resources_;
+  uint64_t response_cache_size_;
+  uint64_t status_snapshot_ms_;
+  std::string memory_estimate_dir_;
+  std::string model_config_cache_dir_;
+  std::string model_startup_snapshot_;
+  ni::InstancePlacement instance_placement_;
+  std::map<ni::ThreadClass, std::vector<int>> thread_class_cpus_;
 
   bool tf_soft_placement_;
   float tf_gpu_mem_fraction_;
   std::map<int, std::pair<int, uint64_t>> tf_vgpu_memory_limits_;
+
+  std::string trt_engine_cache_dir_;
+
+  std::string remote_repo_cache_dir_;
+  uint64_t remote_repo_cache_byte_size_;
+  uint64_t remote_repo_download_part_size_;
+  unsigned int remote_repo_download_concurrency_;
 };
 
 TrtServerOptions::TrtServerOptions()
     : server_id_("inference:0"), model_control_mode_(ni::MODE_POLL),
       exit_on_error_(true), strict_model_config_(true), strict_readiness_(true),
-      metrics_(true), gpu_metrics_(true), exit_timeout_(30),
-      tf_soft_placement_(true), tf_gpu_mem_fraction_(0)
+      metrics_(true), gpu_metrics_(true), metrics_cache_max_age_ms_(0),
+      gpu_metrics_poll_ms_(2000), exit_timeout_(30),
+      pinned_memory_pool_size_(1 << 28), load_thread_count_(4),
+      load_gpu_limit_(0), load_storage_limit_(0), rate_limit_gpu_slots_(0),
+      response_cache_size_(0), status_snapshot_ms_(0),
+      instance_placement_(ni::PLACEMENT_NONE),
+      tf_soft_placement_(true), tf_gpu_mem_fraction_(0),
+      remote_repo_cache_byte_size_(0),
+      remote_repo_download_part_size_(64 * 1024 * 1024),
+      remote_repo_download_concurrency_(8)
 {
 #ifndef TRTIS_ENABLE_METRICS
   metrics_ = false;
@@ -331,9 +577,17 @@ class TrtServerRequestProvider {
       const std::shared_ptr<ni::InferRequestHeader>& request_header);
   TRTSERVER_Error* Init(ni::InferenceServer* server);
 
+  // Create a provider for a request with the same meta-data as the
+  // initialized 'request_template', sharing its request header and
+  // backend.
+  static TrtServerRequestProvider* CreateFromTemplate(
+      const TrtServerRequestProvider& request_template);
+
   const std::string& ModelName() const { return model_name_; }
   int64_t ModelVersion() const { return model_version_; }
   ni::InferRequestHeader* InferRequestHeader() const;
+  const std::shared_ptr<ni::InferRequestHeader>& SharedInferRequestHeader()
+      const;
   const std::shared_ptr<ni::InferenceBackend>& Backend() const;
   const std::unordered_map<std::string, std::shared_ptr<ni::SystemMemory>>&
   InputMap() const;
@@ -342,12 +596,36 @@ class TrtServerRequestProvider {
       const char* input_name, const void* base, size_t byte_size,
       TRTSERVER_Memory_Type memory_type);
 
+  const ni::InferRequestProvider::CancelledFunc& CancelledFunction() const
+  {
+    return cancelled_fn_;
+  }
+  void SetCancelledFn(TRTSERVER_InferenceCancelledFn_t fn, void* userp);
+
+  const ni::InferRequestProvider::OutputReadyFunc& OutputReadyFunction() const
+  {
+    return output_ready_fn_;
+  }
+  void SetOutputReadyFn(TRTSERVER_InferenceOutputReadyFn_t fn, void* userp);
+
+  const std::shared_ptr<ni::SequenceBinding>& SequenceBinding() const
+  {
+    return sequence_binding_;
+  }
+  void SetSequenceBinding(const std::shared_ptr<ni::SequenceBinding>& binding)
+  {
+    sequence_binding_ = binding;
+  }
+
  private:
   const std::string model_name_;
   const int64_t model_version_;
   std::shared_ptr<ni::InferRequestHeader> request_header_;
   std::shared_ptr<ni::InferenceBackend> backend_;
   std::unordered_map<std::string, std::shared_ptr<ni::SystemMemory>> input_map_;
+  ni::InferRequestProvider::CancelledFunc cancelled_fn_;
+  ni::InferRequestProvider::OutputReadyFunc output_ready_fn_;
+  std::shared_ptr<ni::SequenceBinding> sequence_binding_;
 };
 
 TrtServerRequestProvider::TrtServerRequestProvider(
@@ -358,6 +636,35 @@ TrtServerRequestProvider::TrtServerRequestProvider(
 {
 }
 
+void
+TrtServerRequestProvider::SetCancelledFn(
+    TRTSERVER_InferenceCancelledFn_t fn, void* userp)
+{
+  if (fn == nullptr) {
+    cancelled_fn_ = nullptr;
+  } else {
+    cancelled_fn_ = [fn, userp]() { return fn(userp); };
+  }
+}
+
+void
+TrtServerRequestProvider::SetOutputReadyFn(
+    TRTSERVER_InferenceOutputReadyFn_t fn, void* userp)
+{
+  if (fn == nullptr) {
+    output_ready_fn_ = nullptr;
+  } else {
+    output_ready_fn_ = [fn, userp](
+                           const std::string& name,
+                           const std::vector<int64_t>& dims,
+                           const void* content, size_t content_byte_size,
+                           TRTSERVER_Memory_Type memory_type) {
+      fn(name.c_str(), dims.data(), dims.size(), content, content_byte_size,
+         memory_type, userp);
+    };
+  }
+}
+
 TRTSERVER_Error*
 TrtServerRequestProvider::Init(ni::InferenceServer* server)
 {
@@ -372,12 +679,29 @@ TrtServerRequestProvider::Init(ni::InferenceServer* server)
   return nullptr;  // Success
 }
 
+TrtServerRequestProvider*
+TrtServerRequestProvider::CreateFromTemplate(
+    const TrtServerRequestProvider& request_template)
+{
+  TrtServerRequestProvider* provider = new TrtServerRequestProvider(
+      request_template.model_name_.c_str(), request_template.model_version_,
+      request_template.request_header_);
+  provider->backend_ = request_template.backend_;
+  return provider;
+}
+
 ni::InferRequestHeader*
 TrtServerRequestProvider::InferRequestHeader() const
 {
   return request_header_.get();
 }
 
+const std::shared_ptr<ni::InferRequestHeader>&
+TrtServerRequestProvider::SharedInferRequestHeader() const
+{
+  return request_header_;
+}
+
 const std::shared_ptr<ni::InferenceBackend>&
 TrtServerRequestProvider::Backend() const
 {
@@ -457,6 +781,158 @@ TrtServerResponse::OutputData(
   return nullptr;  // Success
 }
 
+//
+// Create in 'payload' the stats, the providers and the complete
+// function of an inference request submitted through the C API.
+//
+TRTSERVER_Error*
+CreateInferPayload(
+    TRTSERVER_Server* server, TRTSERVER_Trace* trace,
+    TrtServerRequestProvider* lprovider,
+    TRTSERVER_ResponseAllocator* response_allocator,
+    void* response_allocator_userp, TRTSERVER_InferenceCompleteFn_t complete_fn,
+    void* complete_userp, ni::Scheduler::Payload* payload)
+{
+  ni::InferenceServer* lserver = reinterpret_cast<ni::InferenceServer*>(server);
+  TrtServerResponseAllocator* lresponsealloc =
+      reinterpret_cast<TrtServerResponseAllocator*>(response_allocator);
+
+  ni::InferRequestHeader* request_header = lprovider->InferRequestHeader();
+
+  auto infer_stats = std::make_shared<ni::ModelInferStats>(
+      lserver->StatusManager(), lprovider->ModelName());
+  const struct timespec& request_start = infer_stats->CaptureTimestamp(
+      ni::ModelInferStats::TimestampKind::kRequestStart);
+  infer_stats->SetRequestedVersion(lprovider->ModelVersion());
+
+  // The deadline is given as wall-clock time but is tracked, like the
+  // timestamps of the request, as CLOCK_MONOTONIC time.
+  const uint64_t deadline_us = request_header->deadline_microseconds();
+  if (deadline_us != 0) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    const uint64_t now_us = TIMESPEC_TO_NANOS(now) / 1000;
+    const uint64_t remaining_ns =
+        (deadline_us > now_us) ? (deadline_us - now_us) * 1000 : 0;
+    infer_stats->SetDeadline(TIMESPEC_TO_NANOS(request_start) + remaining_ns);
+  }
+  infer_stats->SetMetricReporter(lprovider->Backend()->MetricReporter());
+  infer_stats->SetBatchSize(request_header->batch_size());
+  infer_stats->SetFailed(true);
+
+  // Inputs sent in another datatype than the model's are converted
+  // before the request is scheduled, so that backends only see the
+  // datatypes of the model configuration.
+  const auto* input_map = &lprovider->InputMap();
+  std::unordered_map<std::string, std::shared_ptr<ni::SystemMemory>>
+      converted_input_map;
+  if (ni::HasInputConversion(*request_header)) {
+    converted_input_map = *input_map;
+    RETURN_IF_STATUS_ERROR(ni::ConvertRequestInputs(
+        *lprovider->Backend(), *request_header, &converted_input_map));
+    input_map = &converted_input_map;
+  }
+
+  // Inputs with padding are padded to their length bucket so that the
+  // request can be batched with others in the same bucket. The
+  // scheduled request has the padded shapes while the response is
+  // formed for the request as sent, with outputs trimmed to match.
+  std::shared_ptr<const ni::InferRequestHeader> scheduled_request_header =
+      lprovider->SharedInferRequestHeader();
+  std::unordered_map<std::string, std::vector<int64_t>> output_trims;
+  if (ni::HasInputPadding(*lprovider->Backend(), *request_header)) {
+    if (input_map != &converted_input_map) {
+      converted_input_map = *input_map;
+      input_map = &converted_input_map;
+    }
+    auto padded_request_header =
+        std::make_shared<ni::InferRequestHeader>(*request_header);
+    RETURN_IF_STATUS_ERROR(ni::PadRequestInputs(
+        *lprovider->Backend(), padded_request_header.get(),
+        &converted_input_map, &output_trims));
+    scheduled_request_header = std::move(padded_request_header);
+  }
+
+  std::shared_ptr<ni::InferRequestProvider> infer_request_provider;
+  RETURN_IF_STATUS_ERROR(ni::InferRequestProvider::Create(
+      lprovider->ModelName(), lprovider->ModelVersion(),
+      scheduled_request_header, *input_map, &infer_request_provider));
+  infer_request_provider->SetCancelledFunction(lprovider->CancelledFunction());
+  infer_request_provider->SetOutputReadyFunction(
+      lprovider->OutputReadyFunction());
+  infer_request_provider->SetSequenceBinding(lprovider->SequenceBinding());
+
+  std::shared_ptr<ni::InferResponseProvider> infer_response_provider;
+  {
+    std::shared_ptr<ni::InferResponseProvider> del_response_provider;
+    RETURN_IF_STATUS_ERROR(ni::InferResponseProvider::Create(
+        lprovider->SharedInferRequestHeader(),
+        lprovider->Backend()->GetLabelProvider(), response_allocator,
+        lresponsealloc->AllocFn(), response_allocator_userp,
+        lresponsealloc->ReleaseFn(), &del_response_provider));
+    infer_response_provider = del_response_provider;
+  }
+  for (const auto& trim : output_trims) {
+    infer_response_provider->SetOutputTrim(trim.first, trim.second);
+  }
+
+  *payload = ni::Scheduler::Payload(
+      infer_stats, infer_request_provider, infer_response_provider,
+      [infer_stats, trace, infer_response_provider, server, complete_fn,
+       complete_userp](const ni::Status& status) mutable {
+        infer_stats->SetFailed(!status.IsOk());
+        if (!status.IsOk()) {
+          LOG_VERBOSE(1) << "Infer failed: " << status.Message();
+        }
+
+        infer_stats->CaptureTimestamp(
+            ni::ModelInferStats::TimestampKind::kRequestEnd);
+
+#ifdef TRTIS_ENABLE_TRACING
+        if (trace != nullptr) {
+          ni::Trace* ltrace = reinterpret_cast<ni::Trace*>(trace);
+          ltrace->Report(infer_stats);
+        }
+#endif  // TRTIS_ENABLE_TRACING
+
+        TrtServerResponse* response =
+            new TrtServerResponse(status, infer_response_provider);
+        complete_fn(
+            server, trace,
+            reinterpret_cast<TRTSERVER_InferenceResponse*>(response),
+            complete_userp);
+      });
+
+  return nullptr;  // Success
+}
+
+// Convert a thread class from TRTSERVER_ to nvidia::inferenceserver.
+ni::Status
+ConvertThreadClass(
+    const TRTSERVER_Thread_Class thread_class, ni::ThreadClass* lclass)
+{
+  switch (thread_class) {
+    case TRTSERVER_THREAD_CLASS_FRONTEND:
+      *lclass = ni::ThreadClass::FRONTEND;
+      break;
+    case TRTSERVER_THREAD_CLASS_SCHEDULER:
+      *lclass = ni::ThreadClass::SCHEDULER;
+      break;
+    case TRTSERVER_THREAD_CLASS_BACKEND:
+      *lclass = ni::ThreadClass::BACKEND;
+      break;
+    case TRTSERVER_THREAD_CLASS_BACKGROUND:
+      *lclass = ni::ThreadClass::BACKGROUND;
+      break;
+    default:
+      return ni::Status(
+          ni::RequestStatusCode::INVALID_ARG,
+          "unknown thread class '" + std::to_string(thread_class) + "'");
+  }
+
+  return ni::Status::Success;
+}
+
 }  // namespace
 
 #ifdef __cplusplus
@@ -507,7 +983,53 @@ TRTSERVER_SharedMemoryBlockCpuNew(
 {
   *shared_memory_block = reinterpret_cast<TRTSERVER_SharedMemoryBlock*>(
       new TrtServerSharedMemoryBlock(
-          TRTSERVER_MEMORY_CPU, name, shm_key, offset, byte_size));
+          TRTSERVER_MEMORY_CPU, name, shm_key, 0 /* handle_offset */, offset,
+          byte_size, 0 /* device_id */));
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_SharedMemoryBlockGpuNew(
+    TRTSERVER_SharedMemoryBlock** shared_memory_block, const char* name,
+    const char* shm_key, const size_t handle_offset, const size_t offset,
+    const size_t byte_size, const int device_id)
+{
+  *shared_memory_block = reinterpret_cast<TRTSERVER_SharedMemoryBlock*>(
+      new TrtServerSharedMemoryBlock(
+          TRTSERVER_MEMORY_GPU, name, shm_key, handle_offset, offset,
+          byte_size, device_id));
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_SharedMemoryBlockSetHugetlbfs(
+    TRTSERVER_SharedMemoryBlock* shared_memory_block, bool hugetlbfs)
+{
+  TrtServerSharedMemoryBlock* lsmb =
+      reinterpret_cast<TrtServerSharedMemoryBlock*>(shared_memory_block);
+  lsmb->SetHugetlbfs(hugetlbfs);
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_SharedMemoryBlockSetLockPages(
+    TRTSERVER_SharedMemoryBlock* shared_memory_block, bool lock_pages)
+{
+  TrtServerSharedMemoryBlock* lsmb =
+      reinterpret_cast<TrtServerSharedMemoryBlock*>(shared_memory_block);
+  lsmb->SetLockPages(lock_pages);
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_SharedMemoryBlockMemoryType(
+    TRTSERVER_SharedMemoryBlock* shared_memory_block,
+    TRTSERVER_Memory_Type* memory_type, int64_t* memory_type_id)
+{
+  TrtServerSharedMemoryBlock* lsmb =
+      reinterpret_cast<TrtServerSharedMemoryBlock*>(shared_memory_block);
+  *memory_type = lsmb->Type();
+  *memory_type_id = lsmb->DeviceId();
   return nullptr;  // Success
 }
 
@@ -535,6 +1057,15 @@ TRTSERVER_ResponseAllocatorNew(
   return nullptr;  // Success
 }
 
+TRTSERVER_Error*
+TRTSERVER_ResponseAllocatorNewPooled(TRTSERVER_ResponseAllocator** allocator)
+{
+  *allocator = reinterpret_cast<TRTSERVER_ResponseAllocator*>(
+      new TrtServerResponseAllocator(
+          PooledResponseAlloc, PooledResponseRelease));
+  return nullptr;  // Success
+}
+
 TRTSERVER_Error*
 TRTSERVER_ResponseAllocatorDelete(TRTSERVER_ResponseAllocator* allocator)
 {
@@ -632,28 +1163,63 @@ TRTSERVER_TraceDelete(TRTSERVER_Trace* trace)
 }
 
 //
-// TRTSERVER_InferenceRequestProvider
+// TRTSERVER_InferenceRequestTemplate
+//
+// A template is a request provider that is never used for inference
+// and whose request header, once normalized, is shared with the
+// providers created from it.
 //
 TRTSERVER_Error*
-TRTSERVER_InferenceRequestProviderNew(
-    TRTSERVER_InferenceRequestProvider** request_provider,
+TRTSERVER_InferenceRequestTemplateNew(
+    TRTSERVER_InferenceRequestTemplate** request_template,
     TRTSERVER_Server* server, const char* model_name, int64_t model_version,
     const char* request_header_base, size_t request_header_byte_size)
 {
-  ni::InferenceServer* lserver = reinterpret_cast<ni::InferenceServer*>(server);
-
-  std::shared_ptr<ni::InferRequestHeader> request_header =
-      std::make_shared<ni::InferRequestHeader>();
-  if (!request_header->ParseFromArray(
-          request_header_base, request_header_byte_size)) {
-    return TrtServerError::Create(
-        ni::RequestStatusCode::INVALID_ARG,
-        "failed to parse InferRequestHeader");
+  TRTSERVER_InferenceRequestProvider* provider;
+  TRTSERVER_Error* err = TRTSERVER_InferenceRequestProviderNew(
+      &provider, server, model_name, model_version, request_header_base,
+      request_header_byte_size);
+  if (err == nullptr) {
+    *request_template =
+        reinterpret_cast<TRTSERVER_InferenceRequestTemplate*>(provider);
   }
 
-  TrtServerRequestProvider* provider =
-      new TrtServerRequestProvider(model_name, model_version, request_header);
-  TRTSERVER_Error* err = provider->Init(lserver);
+  return err;
+}
+
+TRTSERVER_Error*
+TRTSERVER_InferenceRequestTemplateDelete(
+    TRTSERVER_InferenceRequestTemplate* request_template)
+{
+  TrtServerRequestProvider* ltemplate =
+      reinterpret_cast<TrtServerRequestProvider*>(request_template);
+  delete ltemplate;
+  return nullptr;  // Success
+}
+
+//
+// TRTSERVER_InferenceRequestProvider
+//
+TRTSERVER_Error*
+TRTSERVER_InferenceRequestProviderNew(
+    TRTSERVER_InferenceRequestProvider** request_provider,
+    TRTSERVER_Server* server, const char* model_name, int64_t model_version,
+    const char* request_header_base, size_t request_header_byte_size)
+{
+  ni::InferenceServer* lserver = reinterpret_cast<ni::InferenceServer*>(server);
+
+  std::shared_ptr<ni::InferRequestHeader> request_header =
+      std::make_shared<ni::InferRequestHeader>();
+  if (!request_header->ParseFromArray(
+          request_header_base, request_header_byte_size)) {
+    return TrtServerError::Create(
+        ni::RequestStatusCode::INVALID_ARG,
+        "failed to parse InferRequestHeader");
+  }
+
+  TrtServerRequestProvider* provider =
+      new TrtServerRequestProvider(model_name, model_version, request_header);
+  TRTSERVER_Error* err = provider->Init(lserver);
   if (err == nullptr) {
     *request_provider =
         reinterpret_cast<TRTSERVER_InferenceRequestProvider*>(provider);
@@ -674,6 +1240,18 @@ TRTSERVER_InferenceRequestProviderDelete(
   return nullptr;  // Success
 }
 
+TRTSERVER_Error*
+TRTSERVER_InferenceRequestProviderNewFromTemplate(
+    TRTSERVER_InferenceRequestProvider** request_provider,
+    TRTSERVER_InferenceRequestTemplate* request_template)
+{
+  TrtServerRequestProvider* ltemplate =
+      reinterpret_cast<TrtServerRequestProvider*>(request_template);
+  *request_provider = reinterpret_cast<TRTSERVER_InferenceRequestProvider*>(
+      TrtServerRequestProvider::CreateFromTemplate(*ltemplate));
+  return nullptr;  // Success
+}
+
 TRTSERVER_Error*
 TRTSERVER_InferenceRequestProviderInputBatchByteSize(
     TRTSERVER_InferenceRequestProvider* request_provider, const char* name,
@@ -685,7 +1263,10 @@ TRTSERVER_InferenceRequestProviderInputBatchByteSize(
   ni::InferRequestHeader* request_header = lprovider->InferRequestHeader();
   for (const auto& io : request_header->input()) {
     if (io.name() == std::string(name)) {
-      *byte_size = io.batch_byte_size();
+      const ni::ModelInput* input_config;
+      RETURN_IF_STATUS_ERROR(
+          lprovider->Backend()->GetInput(io.name(), &input_config));
+      *byte_size = ni::RequestInputByteSize(*input_config, io);
       return nullptr;  // Success
     }
   }
@@ -710,6 +1291,63 @@ TRTSERVER_InferenceRequestProviderSetInputData(
   return nullptr;  // Success
 }
 
+TRTSERVER_Error*
+TRTSERVER_InferenceRequestProviderSetCancelledFn(
+    TRTSERVER_InferenceRequestProvider* request_provider,
+    TRTSERVER_InferenceCancelledFn_t cancelled_fn, void* cancelled_userp)
+{
+  TrtServerRequestProvider* lprovider =
+      reinterpret_cast<TrtServerRequestProvider*>(request_provider);
+  lprovider->SetCancelledFn(cancelled_fn, cancelled_userp);
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_InferenceRequestProviderSetOutputReadyFn(
+    TRTSERVER_InferenceRequestProvider* request_provider,
+    TRTSERVER_InferenceOutputReadyFn_t output_ready_fn,
+    void* output_ready_userp)
+{
+  TrtServerRequestProvider* lprovider =
+      reinterpret_cast<TrtServerRequestProvider*>(request_provider);
+  lprovider->SetOutputReadyFn(output_ready_fn, output_ready_userp);
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_InferenceRequestProviderSetSequenceBinding(
+    TRTSERVER_InferenceRequestProvider* request_provider,
+    TRTSERVER_SequenceBinding* sequence_binding)
+{
+  TrtServerRequestProvider* lprovider =
+      reinterpret_cast<TrtServerRequestProvider*>(request_provider);
+  TrtServerSequenceBinding* lbinding =
+      reinterpret_cast<TrtServerSequenceBinding*>(sequence_binding);
+  lprovider->SetSequenceBinding(
+      (lbinding == nullptr) ? nullptr : lbinding->Binding());
+  return nullptr;  // Success
+}
+
+//
+// TRTSERVER_SequenceBinding
+//
+TRTSERVER_Error*
+TRTSERVER_SequenceBindingNew(TRTSERVER_SequenceBinding** sequence_binding)
+{
+  *sequence_binding = reinterpret_cast<TRTSERVER_SequenceBinding*>(
+      new TrtServerSequenceBinding());
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_SequenceBindingDelete(TRTSERVER_SequenceBinding* sequence_binding)
+{
+  TrtServerSequenceBinding* lbinding =
+      reinterpret_cast<TrtServerSequenceBinding*>(sequence_binding);
+  delete lbinding;
+  return nullptr;  // Success
+}
+
 //
 // TRTSERVER_InferenceResponse
 //
@@ -808,6 +1446,10 @@ TRTSERVER_ServerOptionsSetModelControlMode(
       loptions->SetModelControlMode(ni::MODE_EXPLICIT);
       break;
     }
+    case TRTSERVER_MODEL_CONTROL_ON_DEMAND: {
+      loptions->SetModelControlMode(ni::MODE_ON_DEMAND);
+      break;
+    }
     default: {
       return TRTSERVER_ErrorNew(
           TRTSERVER_ERROR_INVALID_ARG,
@@ -864,6 +1506,166 @@ TRTSERVER_ServerOptionsSetExitTimeout(
   return nullptr;  // Success
 }
 
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetPinnedMemoryPoolByteSize(
+    TRTSERVER_ServerOptions* options, uint64_t size)
+{
+  TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
+  loptions->SetPinnedMemoryPoolByteSize(size);
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetModelLoadThreadCount(
+    TRTSERVER_ServerOptions* options, unsigned int thread_count)
+{
+  if (thread_count == 0) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_INVALID_ARG,
+        "model load thread count must be at least 1");
+  }
+
+  TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
+  loptions->SetModelLoadThreadCount(thread_count);
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetModelLoadLimits(
+    TRTSERVER_ServerOptions* options, unsigned int gpu_limit,
+    unsigned int storage_limit)
+{
+  TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
+  loptions->SetModelLoadLimits(gpu_limit, storage_limit);
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsAddModelGpuMemoryBudget(
+    TRTSERVER_ServerOptions* options, int gpu_device, uint64_t byte_size)
+{
+  TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
+  loptions->AddModelGpuMemoryBudget(gpu_device, byte_size);
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetRateLimitGpuSlots(
+    TRTSERVER_ServerOptions* options, unsigned int slots)
+{
+  TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
+  loptions->SetRateLimitGpuSlots(slots);
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsAddRateLimitResource(
+    TRTSERVER_ServerOptions* options, const char* name, unsigned int count)
+{
+  TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
+  loptions->AddRateLimitResource(name, count);
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetResponseCacheByteSize(
+    TRTSERVER_ServerOptions* options, uint64_t size)
+{
+  TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
+  loptions->SetResponseCacheByteSize(size);
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetStatusSnapshotInterval(
+    TRTSERVER_ServerOptions* options, uint64_t interval_ms)
+{
+  TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
+  loptions->SetStatusSnapshotInterval(interval_ms);
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetModelMemoryEstimateDirectory(
+    TRTSERVER_ServerOptions* options, const char* dir)
+{
+  TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
+  loptions->SetModelMemoryEstimateDirectory(dir);
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetModelConfigCacheDirectory(
+    TRTSERVER_ServerOptions* options, const char* dir)
+{
+  TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
+  loptions->SetModelConfigCacheDirectory(dir);
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetModelStartupSnapshot(
+    TRTSERVER_ServerOptions* options, const char* path)
+{
+  TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
+  loptions->SetModelStartupSnapshot(path);
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetInstancePlacement(
+    TRTSERVER_ServerOptions* options, TRTSERVER_Instance_Placement placement)
+{
+  TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
+
+  // convert placement from TRTSERVER_ to nvidia::inferenceserver
+  switch (placement) {
+    case TRTSERVER_INSTANCE_PLACEMENT_NONE: {
+      loptions->SetInstancePlacement(ni::PLACEMENT_NONE);
+      break;
+    }
+    case TRTSERVER_INSTANCE_PLACEMENT_BALANCED: {
+      loptions->SetInstancePlacement(ni::PLACEMENT_BALANCED);
+      break;
+    }
+    case TRTSERVER_INSTANCE_PLACEMENT_PACK: {
+      loptions->SetInstancePlacement(ni::PLACEMENT_PACK);
+      break;
+    }
+    default: {
+      return TRTSERVER_ErrorNew(
+          TRTSERVER_ERROR_INVALID_ARG,
+          std::string(
+              "unknown instance placement '" + std::to_string(placement) + "'")
+              .c_str());
+    }
+  }
+
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetThreadClassCpus(
+    TRTSERVER_ServerOptions* options, TRTSERVER_Thread_Class thread_class,
+    const char* cpu_list)
+{
+  TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
+
+  ni::ThreadClass lclass;
+  RETURN_IF_STATUS_ERROR(ConvertThreadClass(thread_class, &lclass));
+
+  std::vector<int> cpus;
+  if (!ni::ParseCpuList(cpu_list, &cpus) || cpus.empty()) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_INVALID_ARG,
+        std::string("invalid CPU list '" + std::string(cpu_list) + "'")
+            .c_str());
+  }
+
+  loptions->SetThreadClassCpus(lclass, cpus);
+  return nullptr;  // Success
+}
+
 TRTSERVER_Error*
 TRTSERVER_ServerOptionsSetLogInfo(TRTSERVER_ServerOptions* options, bool log)
 {
@@ -900,6 +1702,15 @@ TRTSERVER_ServerOptionsSetLogVerbose(
   return nullptr;  // Success
 }
 
+// Enable or disable writing the log from a background thread.
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetLogAsync(TRTSERVER_ServerOptions* options, bool async)
+{
+  // Logging is global for now...
+  LOG_SET_ASYNC(async);
+  return nullptr;  // Success
+}
+
 TRTSERVER_Error*
 TRTSERVER_ServerOptionsSetMetrics(
     TRTSERVER_ServerOptions* options, bool metrics)
@@ -928,6 +1739,68 @@ TRTSERVER_ServerOptionsSetGpuMetrics(
 #endif  // TRTIS_ENABLE_METRICS
 }
 
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetMetricsCacheMaxAge(
+    TRTSERVER_ServerOptions* options, uint64_t max_age_ms)
+{
+#ifdef TRTIS_ENABLE_METRICS
+  TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
+  loptions->SetMetricsCacheMaxAge(max_age_ms);
+  return nullptr;  // Success
+#else
+  return TRTSERVER_ErrorNew(
+      TRTSERVER_ERROR_UNSUPPORTED, "metrics not supported");
+#endif  // TRTIS_ENABLE_METRICS
+}
+
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetGpuMetricsPollInterval(
+    TRTSERVER_ServerOptions* options, uint64_t interval_ms)
+{
+#ifdef TRTIS_ENABLE_METRICS
+  if (interval_ms == 0) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_INVALID_ARG,
+        "GPU metrics poll interval must be at least 1 millisecond");
+  }
+
+  TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
+  loptions->SetGpuMetricsPollInterval(interval_ms);
+  return nullptr;  // Success
+#else
+  return TRTSERVER_ErrorNew(
+      TRTSERVER_ERROR_UNSUPPORTED, "metrics not supported");
+#endif  // TRTIS_ENABLE_METRICS
+}
+
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetMetricsLatencyBuckets(
+    TRTSERVER_ServerOptions* options, const double* buckets,
+    size_t bucket_count)
+{
+#ifdef TRTIS_ENABLE_METRICS
+  if (bucket_count == 0) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_INVALID_ARG, "expected at least one latency bucket");
+  }
+  for (size_t i = 1; i < bucket_count; ++i) {
+    if (!(buckets[i] > buckets[i - 1])) {
+      return TRTSERVER_ErrorNew(
+          TRTSERVER_ERROR_INVALID_ARG,
+          "latency buckets must be in strictly increasing order");
+    }
+  }
+
+  TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
+  loptions->SetMetricsLatencyBuckets(
+      std::vector<double>(buckets, buckets + bucket_count));
+  return nullptr;  // Success
+#else
+  return TRTSERVER_ErrorNew(
+      TRTSERVER_ERROR_UNSUPPORTED, "metrics not supported");
+#endif  // TRTIS_ENABLE_METRICS
+}
+
 TRTSERVER_Error*
 TRTSERVER_ServerOptionsSetTensorFlowSoftPlacement(
     TRTSERVER_ServerOptions* options, bool soft_placement)
@@ -957,19 +1830,70 @@ TRTSERVER_ServerOptionsAddTensorFlowVgpuMemoryLimits(
   return nullptr;  // Success
 }
 
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetTensorRTEngineCacheDirectory(
+    TRTSERVER_ServerOptions* options, const char* cache_dir)
+{
+  TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
+  loptions->SetTensorRTEngineCacheDirectory(cache_dir);
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetRemoteRepositoryCache(
+    TRTSERVER_ServerOptions* options, const char* cache_dir,
+    uint64_t byte_size)
+{
+  TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
+  loptions->SetRemoteRepositoryCache(cache_dir, byte_size);
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetRemoteRepositoryDownload(
+    TRTSERVER_ServerOptions* options, uint64_t part_byte_size,
+    unsigned int concurrency)
+{
+  if ((part_byte_size == 0) || (concurrency == 0)) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_INVALID_ARG,
+        "remote repository download part byte size and concurrency must be "
+        "at least 1");
+  }
+
+  TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
+  loptions->SetRemoteRepositoryDownload(part_byte_size, concurrency);
+  return nullptr;  // Success
+}
+
 //
 // TRTSERVER_Server
 //
 TRTSERVER_Error*
 TRTSERVER_ServerNew(TRTSERVER_Server** server, TRTSERVER_ServerOptions* options)
 {
-  ni::InferenceServer* lserver = new ni::InferenceServer();
   TrtServerOptions* loptions = reinterpret_cast<TrtServerOptions*>(options);
 
+  // Thread classes must be isolated before the server creates any
+  // threads.
+  for (const auto& itr : loptions->ThreadClassCpus()) {
+    RETURN_IF_STATUS_ERROR(ni::SetThreadClassCpus(itr.first, itr.second));
+  }
+
+  ni::InferenceServer* lserver = new ni::InferenceServer();
+
 #ifdef TRTIS_ENABLE_METRICS
+  ni::Metrics::SetSerializedMaxAge(loptions->MetricsCacheMaxAge());
+  ni::Metrics::SetGpuPollInterval(loptions->GpuMetricsPollInterval());
   if (loptions->Metrics() && loptions->GpuMetrics()) {
     ni::Metrics::EnableGPUMetrics();
   }
+  if (loptions->Metrics()) {
+    ni::Metrics::EnableCPUMetrics();
+  }
+  if (!loptions->MetricsLatencyBuckets().empty()) {
+    ni::Metrics::SetLatencyBuckets(loptions->MetricsLatencyBuckets());
+  }
 #endif  // TRTIS_ENABLE_METRICS
 
   lserver->SetId(loptions->ServerId());
@@ -979,12 +1903,34 @@ TRTSERVER_ServerNew(TRTSERVER_Server** server, TRTSERVER_ServerOptions* options)
   lserver->SetStrictModelConfigEnabled(loptions->StrictModelConfig());
   lserver->SetStrictReadinessEnabled(loptions->StrictReadiness());
   lserver->SetExitTimeoutSeconds(loptions->ExitTimeout());
+  lserver->SetPinnedMemoryPoolByteSize(loptions->PinnedMemoryPoolByteSize());
+  lserver->SetModelLoadThreadCount(loptions->ModelLoadThreadCount());
+  lserver->SetModelLoadGpuLimit(loptions->ModelLoadGpuLimit());
+  lserver->SetModelLoadStorageLimit(loptions->ModelLoadStorageLimit());
+  lserver->SetModelGpuMemoryBudget(loptions->ModelGpuMemoryBudget());
+  lserver->SetRateLimitGpuSlots(loptions->RateLimitGpuSlots());
+  lserver->SetRateLimitResources(loptions->RateLimitResources());
+  lserver->SetResponseCacheByteSize(loptions->ResponseCacheByteSize());
+  lserver->SetStatusSnapshotInterval(loptions->StatusSnapshotInterval());
+  lserver->SetModelMemoryEstimateDirectory(
+      loptions->ModelMemoryEstimateDirectory());
+  lserver->SetModelConfigCacheDirectory(loptions->ModelConfigCacheDirectory());
+  lserver->SetModelStartupSnapshot(loptions->ModelStartupSnapshot());
+  lserver->SetInstancePlacement(loptions->InstancePlacement());
   lserver->SetTensorFlowSoftPlacementEnabled(
       loptions->TensorFlowSoftPlacement());
   lserver->SetTensorFlowGPUMemoryFraction(
       loptions->TensorFlowGpuMemoryFraction());
   lserver->SetTensorFlowVGPUMemoryLimits(
       loptions->TensorFlowVgpuMemoryLimits());
+  lserver->SetTensorRTEngineCacheDirectory(
+      loptions->TensorRTEngineCacheDirectory());
+  lserver->SetRemoteRepositoryCache(
+      loptions->RemoteRepositoryCacheDirectory(),
+      loptions->RemoteRepositoryCacheByteSize());
+  lserver->SetRemoteRepositoryDownload(
+      loptions->RemoteRepositoryDownloadPartByteSize(),
+      loptions->RemoteRepositoryDownloadConcurrency());
 
   ni::Status status = lserver->Init();
   if (!status.IsOk()) {
@@ -1029,6 +1975,32 @@ TRTSERVER_ServerId(TRTSERVER_Server* server, const char** id)
   return nullptr;  // Success
 }
 
+TRTSERVER_Error*
+TRTSERVER_ServerThreadClassCpus(
+    TRTSERVER_Server* server, TRTSERVER_Thread_Class thread_class,
+    const int** cpus, size_t* cpu_count)
+{
+  ni::ThreadClass lclass;
+  RETURN_IF_STATUS_ERROR(ConvertThreadClass(thread_class, &lclass));
+
+  const std::vector<int>& lcpus = ni::ThreadClassCpus(lclass);
+  *cpus = lcpus.data();
+  *cpu_count = lcpus.size();
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+TRTSERVER_ServerAvailableCpuCount(
+    TRTSERVER_Server* server, TRTSERVER_Thread_Class thread_class,
+    uint32_t* count)
+{
+  ni::ThreadClass lclass;
+  RETURN_IF_STATUS_ERROR(ConvertThreadClass(thread_class, &lclass));
+
+  *count = ni::AvailableCpuCount(lclass);
+  return nullptr;  // Success
+}
+
 TRTSERVER_Error*
 TRTSERVER_ServerPollModelRepository(TRTSERVER_Server* server)
 {
@@ -1070,7 +2042,28 @@ TRTSERVER_ServerStatus(TRTSERVER_Server* server, TRTSERVER_Protobuf** status)
       lserver->StatusManager(), ni::ServerStatTimerScoped::Kind::STATUS);
 
   ni::ServerStatus server_status;
-  RETURN_IF_STATUS_ERROR(lserver->GetStatus(&server_status, std::string()));
+  RETURN_IF_STATUS_ERROR(lserver->GetStatus(
+      &server_status, std::string(), 0 /* since_generation */));
+
+  TrtServerProtobuf* protobuf = new TrtServerProtobuf(server_status);
+  *status = reinterpret_cast<TRTSERVER_Protobuf*>(protobuf);
+
+  return nullptr;  // success
+}
+
+TRTSERVER_Error*
+TRTSERVER_ServerStatusSince(
+    TRTSERVER_Server* server, uint64_t since_generation,
+    TRTSERVER_Protobuf** status)
+{
+  ni::InferenceServer* lserver = reinterpret_cast<ni::InferenceServer*>(server);
+
+  ni::ServerStatTimerScoped timer(
+      lserver->StatusManager(), ni::ServerStatTimerScoped::Kind::STATUS);
+
+  ni::ServerStatus server_status;
+  RETURN_IF_STATUS_ERROR(
+      lserver->GetStatus(&server_status, std::string(), since_generation));
 
   TrtServerProtobuf* protobuf = new TrtServerProtobuf(server_status);
   *status = reinterpret_cast<TRTSERVER_Protobuf*>(protobuf);
@@ -1089,8 +2082,8 @@ TRTSERVER_ServerModelStatus(
       lserver->StatusManager(), ni::ServerStatTimerScoped::Kind::STATUS);
 
   ni::ServerStatus server_status;
-  RETURN_IF_STATUS_ERROR(
-      lserver->GetStatus(&server_status, std::string(model_name)));
+  RETURN_IF_STATUS_ERROR(lserver->GetStatus(
+      &server_status, std::string(model_name), 0 /* since_generation */));
 
   TrtServerProtobuf* protobuf = new TrtServerProtobuf(server_status);
   *status = reinterpret_cast<TRTSERVER_Protobuf*>(protobuf);
@@ -1136,8 +2129,15 @@ TRTSERVER_ServerRegisterSharedMemory(
       lserver->StatusManager(),
       ni::ServerStatTimerScoped::Kind::SHARED_MEMORY_CONTROL);
 
-  RETURN_IF_STATUS_ERROR(lserver->RegisterSharedMemory(
-      lsmb->Name(), lsmb->ShmKey(), lsmb->Offset(), lsmb->ByteSize()));
+  if (lsmb->Type() == TRTSERVER_MEMORY_GPU) {
+    RETURN_IF_STATUS_ERROR(lserver->RegisterCudaSharedMemory(
+        lsmb->Name(), lsmb->ShmKey(), lsmb->HandleOffset(), lsmb->Offset(),
+        lsmb->ByteSize(), lsmb->DeviceId()));
+  } else {
+    RETURN_IF_STATUS_ERROR(lserver->RegisterSharedMemory(
+        lsmb->Name(), lsmb->ShmKey(), lsmb->Offset(), lsmb->ByteSize(),
+        lsmb->Hugetlbfs(), lsmb->LockPages()));
+  }
 
   return nullptr;  // success
 }
@@ -1225,6 +2225,69 @@ TRTSERVER_ServerMetrics(TRTSERVER_Server* server, TRTSERVER_Metrics** metrics)
 #endif  // TRTIS_ENABLE_METRICS
 }
 
+TRTSERVER_Error*
+TRTSERVER_ServerSetNvtxEnabled(TRTSERVER_Server* server, bool enabled)
+{
+#ifdef TRTIS_ENABLE_NVTX
+  ni::SetNvtxEnabled(enabled);
+  LOG_INFO << (enabled ? "Enabled" : "Disabled") << " NVTX ranges";
+  return nullptr;  // Success
+#else
+  return TRTSERVER_ErrorNew(
+      TRTSERVER_ERROR_UNSUPPORTED, "NVTX ranges not supported");
+#endif  // TRTIS_ENABLE_NVTX
+}
+
+TRTSERVER_Error*
+TRTSERVER_ServerStartProfile(TRTSERVER_Server* server, uint64_t duration_ms)
+{
+#ifdef TRTIS_ENABLE_GPU
+  // Set while a capture is in progress so that captures don't nest.
+  static std::atomic<bool> profile_active(false);
+
+  if (duration_ms == 0) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_INVALID_ARG,
+        "profile capture duration must be greater than zero");
+  }
+
+  bool expected = false;
+  if (!profile_active.compare_exchange_strong(expected, true)) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_ALREADY_EXISTS, "profile capture already in progress");
+  }
+
+  cudaError_t err = cudaProfilerStart();
+  if (err != cudaSuccess) {
+    profile_active = false;
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_INTERNAL,
+        (std::string("unable to start profile capture: ") +
+         cudaGetErrorString(err))
+            .c_str());
+  }
+
+  LOG_INFO << "Started profile capture for " << duration_ms << " ms";
+
+  std::thread([duration_ms]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+    cudaError_t err = cudaProfilerStop();
+    if (err != cudaSuccess) {
+      LOG_ERROR << "unable to stop profile capture: "
+                << cudaGetErrorString(err);
+    } else {
+      LOG_INFO << "Stopped profile capture";
+    }
+    profile_active = false;
+  }).detach();
+
+  return nullptr;  // Success
+#else
+  return TRTSERVER_ErrorNew(
+      TRTSERVER_ERROR_UNSUPPORTED, "profile capture not supported");
+#endif  // TRTIS_ENABLE_GPU
+}
+
 TRTSERVER_Error*
 TRTSERVER_ServerInferAsync(
     TRTSERVER_Server* server, TRTSERVER_Trace* trace,
@@ -1236,62 +2299,67 @@ TRTSERVER_ServerInferAsync(
   ni::InferenceServer* lserver = reinterpret_cast<ni::InferenceServer*>(server);
   TrtServerRequestProvider* lprovider =
       reinterpret_cast<TrtServerRequestProvider*>(request_provider);
-  TrtServerResponseAllocator* lresponsealloc =
-      reinterpret_cast<TrtServerResponseAllocator*>(response_allocator);
 
-  ni::InferRequestHeader* request_header = lprovider->InferRequestHeader();
+  ni::Scheduler::Payload payload;
+  TRTSERVER_Error* err = CreateInferPayload(
+      server, trace, lprovider, response_allocator, response_allocator_userp,
+      complete_fn, complete_userp, &payload);
+  if (err != nullptr) {
+    return err;
+  }
 
-  auto infer_stats = std::make_shared<ni::ModelInferStats>(
-      lserver->StatusManager(), lprovider->ModelName());
-  infer_stats->CaptureTimestamp(
-      ni::ModelInferStats::TimestampKind::kRequestStart);
-  infer_stats->SetRequestedVersion(lprovider->ModelVersion());
-  infer_stats->SetMetricReporter(lprovider->Backend()->MetricReporter());
-  infer_stats->SetBatchSize(request_header->batch_size());
-  infer_stats->SetFailed(true);
+  lserver->Infer(
+      lprovider->Backend(), payload.request_provider_,
+      payload.response_provider_, payload.stats_,
+      payload.complete_function_);
 
-  std::shared_ptr<ni::InferRequestProvider> infer_request_provider;
-  RETURN_IF_STATUS_ERROR(ni::InferRequestProvider::Create(
-      lprovider->ModelName(), lprovider->ModelVersion(), *request_header,
-      lprovider->InputMap(), &infer_request_provider));
+  return nullptr;  // Success
+}
 
-  std::shared_ptr<ni::InferResponseProvider> infer_response_provider;
-  {
-    std::shared_ptr<ni::InferResponseProvider> del_response_provider;
-    RETURN_IF_STATUS_ERROR(ni::InferResponseProvider::Create(
-        *request_header, lprovider->Backend()->GetLabelProvider(),
-        response_allocator, lresponsealloc->AllocFn(), response_allocator_userp,
-        lresponsealloc->ReleaseFn(), &del_response_provider));
-    infer_response_provider = del_response_provider;
+TRTSERVER_Error*
+TRTSERVER_ServerInferBatchAsync(
+    TRTSERVER_Server* server, TRTSERVER_Trace** traces,
+    TRTSERVER_InferenceRequestProvider** request_providers,
+    size_t request_count, TRTSERVER_ResponseAllocator* response_allocator,
+    void* response_allocator_userp, TRTSERVER_InferenceCompleteFn_t complete_fn,
+    void** complete_userps)
+{
+  if (request_count == 0) {
+    return nullptr;  // Success
   }
 
-  lserver->Infer(
-      lprovider->Backend(), infer_request_provider, infer_response_provider,
-      infer_stats,
-      [infer_stats, trace, infer_response_provider, server, complete_fn,
-       complete_userp](const ni::Status& status) mutable {
-        infer_stats->SetFailed(!status.IsOk());
-        if (!status.IsOk()) {
-          LOG_VERBOSE(1) << "Infer failed: " << status.Message();
-        }
+  ni::InferenceServer* lserver = reinterpret_cast<ni::InferenceServer*>(server);
 
-        infer_stats->CaptureTimestamp(
-            ni::ModelInferStats::TimestampKind::kRequestEnd);
+  // The backend is resolved when each request provider is created,
+  // so the requests share it only if they are for the same version of
+  // the same model.
+  const std::shared_ptr<ni::InferenceBackend>& backend =
+      reinterpret_cast<TrtServerRequestProvider*>(request_providers[0])
+          ->Backend();
+  for (size_t idx = 1; idx < request_count; ++idx) {
+    TrtServerRequestProvider* lprovider =
+        reinterpret_cast<TrtServerRequestProvider*>(request_providers[idx]);
+    if (lprovider->Backend() != backend) {
+      return TrtServerError::Create(
+          TRTSERVER_ERROR_INVALID_ARG,
+          "requests in a batch must be for the same model version");
+    }
+  }
 
-#ifdef TRTIS_ENABLE_TRACING
-        if (trace != nullptr) {
-          ni::Trace* ltrace = reinterpret_cast<ni::Trace*>(trace);
-          ltrace->Report(infer_stats);
-        }
-#endif  // TRTIS_ENABLE_TRACING
+  std::vector<ni::Scheduler::Payload> payloads(request_count);
+  for (size_t idx = 0; idx < request_count; ++idx) {
+    TrtServerRequestProvider* lprovider =
+        reinterpret_cast<TrtServerRequestProvider*>(request_providers[idx]);
+    TRTSERVER_Error* err = CreateInferPayload(
+        server, (traces != nullptr) ? traces[idx] : nullptr, lprovider,
+        response_allocator, response_allocator_userp, complete_fn,
+        complete_userps[idx], &payloads[idx]);
+    if (err != nullptr) {
+      return err;
+    }
+  }
 
-        TrtServerResponse* response =
-            new TrtServerResponse(status, infer_response_provider);
-        complete_fn(
-            server, trace,
-            reinterpret_cast<TRTSERVER_InferenceResponse*>(response),
-            complete_userp);
-      });
+  lserver->InferBatch(backend, &payloads);
 
   return nullptr;  // Success
 }
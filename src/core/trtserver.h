@@ -45,11 +45,13 @@ extern "C" {
 
 struct TRTSERVER_Error;
 struct TRTSERVER_InferenceRequestProvider;
+struct TRTSERVER_InferenceRequestTemplate;
 struct TRTSERVER_InferenceResponse;
 struct TRTSERVER_Metrics;
 struct TRTSERVER_Protobuf;
 struct TRTSERVER_ResponseAllocator;
 struct TRTSERVER_Server;
+struct TRTSERVER_SequenceBinding;
 struct TRTSERVER_ServerOptions;
 struct TRTSERVER_SharedMemoryBlock;
 struct TRTSERVER_Trace;
@@ -141,6 +143,60 @@ TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_SharedMemoryBlockCpuNew(
     TRTSERVER_SharedMemoryBlock** shared_memory_block, const char* name,
     const char* shm_key, const size_t offset, const size_t byte_size);
 
+/// Create a new shared memory block object referencing a shared
+/// memory block residing in TRTSERVER_MEMORY_GPU type memory. The
+/// GPU memory is shared by the client process with
+/// cudaIpcGetMemHandle and the resulting cudaIpcMemHandle_t is made
+/// available to the server through a posix shared memory object.
+/// \param shared_memory_block Returns the new shared memory block object.
+/// \param name A unique name for the shared memory block. This name
+/// is used in inference requests to refer to this shared memory
+/// block.
+/// \param shm_key The name of the posix shared memory object
+/// containing the cudaIpcMemHandle_t.
+/// \param handle_offset The offset within the posix shared memory
+/// object to the cudaIpcMemHandle_t.
+/// \param offset The offset within the GPU memory referenced by the
+/// cudaIpcMemHandle_t to the start of the block.
+/// \param byte_size The size, in bytes of the block.
+/// \param device_id The GPU device that holds the block.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_SharedMemoryBlockGpuNew(
+    TRTSERVER_SharedMemoryBlock** shared_memory_block, const char* name,
+    const char* shm_key, const size_t handle_offset, const size_t offset,
+    const size_t byte_size, const int device_id);
+
+/// Set whether a shared memory block residing in TRTSERVER_MEMORY_CPU
+/// type memory is backed by huge pages. If true the 'shm_key' of the
+/// block is the path of a file on a mounted hugetlbfs instead of the
+/// name of a posix shared memory object, and the 'offset' must be a
+/// multiple of the huge page size. Default is false.
+/// \param shared_memory_block The shared memory block object.
+/// \param hugetlbfs True if the block is in a hugetlbfs file.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_SharedMemoryBlockSetHugetlbfs(
+    TRTSERVER_SharedMemoryBlock* shared_memory_block, bool hugetlbfs);
+
+/// Set whether the pages of a shared memory block residing in
+/// TRTSERVER_MEMORY_CPU type memory are faulted in and locked into
+/// memory when the block is registered. Locking is best-effort and is
+/// limited by RLIMIT_MEMLOCK. Default is false.
+/// \param shared_memory_block The shared memory block object.
+/// \param lock_pages True to fault in and lock the pages.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_SharedMemoryBlockSetLockPages(
+    TRTSERVER_SharedMemoryBlock* shared_memory_block, bool lock_pages);
+
+/// Get the memory type of a shared memory block object.
+/// \param shared_memory_block The shared memory block object.
+/// \param memory_type Returns the type of memory holding the block.
+/// \param memory_type_id Returns the ID of the memory, which is the
+/// GPU device ID for TRTSERVER_MEMORY_GPU and 0 otherwise.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_SharedMemoryBlockMemoryType(
+    TRTSERVER_SharedMemoryBlock* shared_memory_block,
+    TRTSERVER_Memory_Type* memory_type, int64_t* memory_type_id);
+
 /// Delete a shared memory block object.
 /// \param shared_memory_block The object to delete.
 /// \return a TRTSERVER_Error indicating success or failure.
@@ -221,6 +277,19 @@ TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ResponseAllocatorNew(
     TRTSERVER_ResponseAllocatorAllocFn_t alloc_fn,
     TRTSERVER_ResponseAllocatorReleaseFn_t release_fn);
 
+/// Create a new response allocator object that allocates result
+/// tensors in CPU memory. The buffers are taken from a server-wide
+/// pool and are returned to the pool when released, so that buffers
+/// are recycled across inference requests instead of being allocated
+/// for each one. A result tensor requested in a memory type other
+/// than CPU is not allocated, which causes the server to request the
+/// result in CPU memory. Any number of pooled allocators may be
+/// created and they share the same pool.
+/// \param allocator Returns the new response allocator object.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ResponseAllocatorNewPooled(
+    TRTSERVER_ResponseAllocator** allocator);
+
 /// Delete a response allocator.
 /// \param allocator The response allocator object.
 /// \return a TRTSERVER_Error indicating success or failure.
@@ -340,6 +409,43 @@ TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_TraceNew(
 /// \return a TRTSERVER_Error indicating success or failure.
 TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_TraceDelete(TRTSERVER_Trace* trace);
 
+/// TRTSERVER_InferenceRequestTemplate
+///
+/// Object representing the validated meta-data of inference requests
+/// that are sent repeatedly with the same request header. Request
+/// providers created from the template share its meta-data, so that
+/// the request header is parsed and validated only once.
+///
+
+/// Create a new inference request template object. The request header
+/// protobuf must be serialized and provided as a base address and a
+/// size, in bytes. The template holds the model version that it is
+/// created for, which is not unloaded until the template and the
+/// request providers created from it are deleted.
+/// \param request_template Returns the new request template object.
+/// \param server the inference server object.
+/// \param model_name The name of the model that the inference requests
+/// are for.
+/// \param model_version The version of the model that the inference
+/// requests are for, or -1 to select the latest (highest numbered)
+/// version.
+/// \param request_header_base Pointer to the serialized request
+/// header protobuf.
+/// \param request_header_byte_size The size of the serialized request
+/// header in bytes.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_InferenceRequestTemplateNew(
+    TRTSERVER_InferenceRequestTemplate** request_template,
+    TRTSERVER_Server* server, const char* model_name, int64_t model_version,
+    const char* request_header_base, size_t request_header_byte_size);
+
+/// Delete an inference request template object. The request providers
+/// created from the template remain valid.
+/// \param request_template The request template object.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_InferenceRequestTemplateDelete(
+    TRTSERVER_InferenceRequestTemplate* request_template);
+
 /// TRTSERVER_InferenceRequestProvider
 ///
 /// Object representing the request provider for an inference
@@ -373,9 +479,22 @@ TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_InferenceRequestProviderNew(
 TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_InferenceRequestProviderDelete(
     TRTSERVER_InferenceRequestProvider* request_provider);
 
+/// Create a new inference request provider object for a request with
+/// the meta-data of a request template. Only the input data must be
+/// set on the new request provider. Request providers may be created
+/// from the same template by multiple threads at the same time.
+/// \param request_provider Returns the new request provider object.
+/// \param request_template The request template object.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error*
+TRTSERVER_InferenceRequestProviderNewFromTemplate(
+    TRTSERVER_InferenceRequestProvider** request_provider,
+    TRTSERVER_InferenceRequestTemplate* request_template);
+
 /// Get the size, in bytes, expected by the inference server for the
 /// named input tensor. The returned size is the total size for the
-/// entire batch of the input.
+/// entire batch of the input, in the datatype in which the input is
+/// sent.
 /// \param request_provider The request provider object.
 /// \param name The name of the input.
 /// \param byte_size Returns the size, in bytes, of the full batch of
@@ -404,6 +523,104 @@ TRTSERVER_InferenceRequestProviderSetInputData(
     TRTSERVER_InferenceRequestProvider* request_provider, const char* name,
     const void* base, size_t byte_size, TRTSERVER_Memory_Type memory_type);
 
+/// Type for the function that returns true if an inference request
+/// has been cancelled, for example because the client that sent it
+/// has disconnected. The 'userp' data is the same as what is supplied
+/// in the call to TRTSERVER_InferenceRequestProviderSetCancelledFn.
+typedef bool (*TRTSERVER_InferenceCancelledFn_t)(void* userp);
+
+/// Set the function that the server calls to check whether the
+/// inference request has been cancelled. A cancelled request that is
+/// still waiting to be scheduled is not executed, and a cancelled
+/// request for an ensemble doesn't start any more steps. Such a
+/// request completes with a TRTSERVER_ERROR_UNAVAILABLE error. The
+/// function is called while the server holds scheduler locks, so it
+/// must be cheap and must not block. It can be called from any thread
+/// until the completion function of the request is called, so
+/// 'cancelled_userp' must stay valid until then.
+/// \param request_provider The request provider object.
+/// \param cancelled_fn The function checking for cancellation.
+/// \param cancelled_userp User-provided pointer passed to
+/// 'cancelled_fn'.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error*
+TRTSERVER_InferenceRequestProviderSetCancelledFn(
+    TRTSERVER_InferenceRequestProvider* request_provider,
+    TRTSERVER_InferenceCancelledFn_t cancelled_fn, void* cancelled_userp);
+
+/// Type for the function that is called when a requested output of
+/// an inference request is complete before the request itself
+/// completes. 'dims' gives the 'dim_count' dimensions of the output,
+/// not including the batch dimension. The output contents are given
+/// by 'base', 'byte_size' and 'memory_type' and are only valid
+/// during the call. The 'userp' data is the same as what is supplied
+/// in the call to TRTSERVER_InferenceRequestProviderSetOutputReadyFn.
+typedef void (*TRTSERVER_InferenceOutputReadyFn_t)(
+    const char* name, const int64_t* dims, uint64_t dim_count,
+    const void* base, size_t byte_size, TRTSERVER_Memory_Type memory_type,
+    void* userp);
+
+/// Set the function that the server calls with each requested output
+/// that is complete before the inference request completes, so that
+/// the outputs of an early step of an ensemble can be used while the
+/// later steps are still running. The outputs are still included in
+/// the response of the request. Only ensembles report outputs early,
+/// and an ensemble request with this function set is not merged with
+/// other requests by the ensemble's dynamic batcher. The function is
+/// called while the server holds the ensemble's lock, so it must not
+/// block. It can be called from any thread until the completion
+/// function of the request is called, so 'output_ready_userp' must
+/// stay valid until then.
+/// \param request_provider The request provider object.
+/// \param output_ready_fn The function called with each early output.
+/// \param output_ready_userp User-provided pointer passed to
+/// 'output_ready_fn'.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error*
+TRTSERVER_InferenceRequestProviderSetOutputReadyFn(
+    TRTSERVER_InferenceRequestProvider* request_provider,
+    TRTSERVER_InferenceOutputReadyFn_t output_ready_fn,
+    void* output_ready_userp);
+
+/// Set the sequence binding of an inference request. The sequence
+/// that a request with the START flag begins is bound to the binding,
+/// and the later requests of that sequence that have the same binding
+/// are queued directly into the sequence's batch slot instead of
+/// being routed by correlation ID. Only models using the sequence
+/// batcher use the binding.
+/// \param request_provider The request provider object.
+/// \param sequence_binding The sequence binding object.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error*
+TRTSERVER_InferenceRequestProviderSetSequenceBinding(
+    TRTSERVER_InferenceRequestProvider* request_provider,
+    TRTSERVER_SequenceBinding* sequence_binding);
+
+/// TRTSERVER_SequenceBinding
+///
+/// Object binding the inference requests sent over a client stream to
+/// the sequence that the stream is sending. A binding holds one
+/// sequence at a time: the START of another sequence with the same
+/// binding rebinds it.
+///
+
+/// Create a new sequence binding object.
+/// \param sequence_binding Returns the new sequence binding object.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_SequenceBindingNew(
+    TRTSERVER_SequenceBinding** sequence_binding);
+
+/// Delete a sequence binding object. If the sequence bound to the
+/// binding has not ended it is ended, releasing its batch slot once
+/// the requests already sent for it complete, the same as when the
+/// sequence is idle for longer than the model's
+/// max_sequence_idle_microseconds. Request providers that the binding
+/// was set on remain valid.
+/// \param sequence_binding The sequence binding object.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_SequenceBindingDelete(
+    TRTSERVER_SequenceBinding* sequence_binding);
+
 /// TRTSERVER_InferenceResponse
 ///
 /// Object representing the response for an inference request. The
@@ -459,9 +676,25 @@ TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_InferenceResponseOutputData(
 typedef enum trtserver_modelcontrolmode_enum {
   TRTSERVER_MODEL_CONTROL_NONE,
   TRTSERVER_MODEL_CONTROL_POLL,
-  TRTSERVER_MODEL_CONTROL_EXPLICIT
+  TRTSERVER_MODEL_CONTROL_EXPLICIT,
+  TRTSERVER_MODEL_CONTROL_ON_DEMAND
 } TRTSERVER_Model_Control_Mode;
 
+/// Instance placement policies
+typedef enum trtserver_instanceplacement_enum {
+  TRTSERVER_INSTANCE_PLACEMENT_NONE,
+  TRTSERVER_INSTANCE_PLACEMENT_BALANCED,
+  TRTSERVER_INSTANCE_PLACEMENT_PACK
+} TRTSERVER_Instance_Placement;
+
+/// Classes of server threads that can be isolated on host CPUs
+typedef enum trtserver_threadclass_enum {
+  TRTSERVER_THREAD_CLASS_FRONTEND,
+  TRTSERVER_THREAD_CLASS_SCHEDULER,
+  TRTSERVER_THREAD_CLASS_BACKEND,
+  TRTSERVER_THREAD_CLASS_BACKGROUND
+} TRTSERVER_Thread_Class;
+
 /// Create a new server options object. The caller takes ownership of
 /// the TRTSERVER_ServerOptions object and must call
 /// TRTSERVER_ServerOptionsDelete to release the object.
@@ -512,6 +745,12 @@ TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerOptionsSetModelRepositoryPath(
 ///   be loaded on startup. The corresponding model control APIs must be called
 ///   to load / unload a model in the model repository.
 ///
+///   TRTSERVER_MODEL_CONTROL_ON_DEMAND: as TRTSERVER_MODEL_CONTROL_EXPLICIT,
+///   and in addition a model that is not loaded is loaded when an inference
+///   request for it is received. The requests for the model wait for the
+///   load to complete. See TRTSERVER_ServerOptionsAddModelGpuMemoryBudget
+///   for unloading the models that are no longer used.
+///
 /// \param options The server options object.
 /// \param mode The mode to use for the model control.
 /// \return a TRTSERVER_Error indicating success or failure.
@@ -562,6 +801,195 @@ TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerOptionsSetStrictReadiness(
 TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerOptionsSetExitTimeout(
     TRTSERVER_ServerOptions* options, unsigned int timeout);
 
+/// Set the total size of the pool of pinned host memory that the
+/// server uses to stage tensors copied to and from GPU memory.
+/// \param options The server options object.
+/// \param size The pinned memory pool byte size.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetPinnedMemoryPoolByteSize(
+    TRTSERVER_ServerOptions* options, uint64_t size);
+
+/// Set the number of threads that load models. The models are loaded
+/// in parallel up to this many at a time, the default is 4.
+/// \param options The server options object.
+/// \param thread_count The number of model load threads.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetModelLoadThreadCount(
+    TRTSERVER_ServerOptions* options, unsigned int thread_count);
+
+/// Limit the number of models that load at the same time using the
+/// same resource. Zero (0) indicates no limit other than the number
+/// of model load threads, which is the default.
+/// \param options The server options object.
+/// \param gpu_limit The maximum number of models with instances on a
+/// GPU that load at the same time.
+/// \param storage_limit The maximum number of models that load at the
+/// same time from the same storage: the local file system, Google
+/// Cloud Storage or Amazon S3.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerOptionsSetModelLoadLimits(
+    TRTSERVER_ServerOptions* options, unsigned int gpu_limit,
+    unsigned int storage_limit);
+
+/// Add a budget for the GPU memory used by the models loaded on demand
+/// on a GPU. Each time a model is loaded on demand the memory it
+/// allocates on the GPU is measured, and when the total of the models
+/// loaded on demand exceeds the budget the least recently used of them
+/// are unloaded. The models loaded at startup or with the model
+/// control API are never unloaded this way. Only takes affect in
+/// TRTSERVER_MODEL_CONTROL_ON_DEMAND mode.
+/// \param options The server options object.
+/// \param gpu_device The GPU device id.
+/// \param byte_size The budget, in bytes.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error*
+TRTSERVER_ServerOptionsAddModelGpuMemoryBudget(
+    TRTSERVER_ServerOptions* options, int gpu_device, uint64_t byte_size);
+
+/// Set the number of batches that may execute concurrently on each
+/// GPU, across all models. An instance on a GPU holds the number of
+/// execution slots given by its model's rate limiter weight while it
+/// executes a batch, and waits for the slots to be free before it
+/// executes. The default is 0, which means the slots are not limited.
+/// \param options The server options object.
+/// \param slots The number of execution slots of each GPU.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerOptionsSetRateLimitGpuSlots(
+    TRTSERVER_ServerOptions* options, unsigned int slots);
+
+/// Add a named resource that model instances hold while they execute
+/// a batch, as given by their model's rate limiter configuration.
+/// \param options The server options object.
+/// \param name The name of the resource.
+/// \param count The number of units of the resource.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error*
+TRTSERVER_ServerOptionsAddRateLimitResource(
+    TRTSERVER_ServerOptions* options, const char* name, unsigned int count);
+
+/// Set the total byte size of the host memory that the response cache
+/// can use to hold the outputs of the models that enable the response
+/// cache in their configuration. When the cache is full the
+/// least-recently used responses are evicted. The default is 0, which
+/// disables the response cache.
+/// \param options The server options object.
+/// \param size The byte size of the response cache.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetResponseCacheByteSize(
+    TRTSERVER_ServerOptions* options, uint64_t size);
+
+/// Set the interval at which the server refreshes a snapshot of the
+/// status of all models. While snapshots are enabled, status requests
+/// are served from the latest snapshot without blocking the inference
+/// statistics updates, and the status can be requested incrementally
+/// with TRTSERVER_ServerStatusSince. The default is 0, which disables
+/// snapshots so that every status request builds the current status.
+/// \param options The server options object.
+/// \param interval_ms The refresh interval, in milliseconds.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetStatusSnapshotInterval(
+    TRTSERVER_ServerOptions* options, uint64_t interval_ms);
+
+/// Set the directory where the GPU memory used by each instance of each
+/// model version is recorded after the version loads. Before a model
+/// version loads, its recorded estimate is compared to the free memory
+/// of each GPU it has instances on, and the load fails if a GPU doesn't
+/// have enough free memory. The directory must exist. By default the
+/// estimates are kept in memory only, and before a TensorRT model
+/// version has been loaded once its estimate is the size of its plan.
+/// \param options The server options object.
+/// \param dir The directory, or empty to not record the estimates.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetModelMemoryEstimateDirectory(
+    TRTSERVER_ServerOptions* options, const char* dir);
+
+/// Set the directory where the model configurations generated when
+/// strict model configuration is disabled are cached. The configuration
+/// of a model is only generated again when the files of the model,
+/// including its configuration file, change. The directory must exist.
+/// By default the generated configurations are cached in memory only,
+/// so they are generated again when the server restarts.
+/// \param options The server options object.
+/// \param dir The directory, or empty to only cache in memory.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetModelConfigCacheDirectory(
+    TRTSERVER_ServerOptions* options, const char* dir);
+
+/// Set the file where the resolved configurations and placements of the
+/// models in the model repositories are recorded. If the file exists
+/// when the server starts, the recorded models start loading before the
+/// model repositories are polled, and afterwards only the models whose
+/// files changed since the file was recorded are reloaded. The file is
+/// only used when the model control mode is TRTSERVER_MODEL_CONTROL_NONE
+/// or TRTSERVER_MODEL_CONTROL_POLL. By default no snapshot is recorded.
+/// \param options The server options object.
+/// \param path The path of the file, or empty to not record a snapshot.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetModelStartupSnapshot(
+    TRTSERVER_ServerOptions* options, const char* path);
+
+/// Set the policy for placing the instances of the KIND_GPU instance
+/// groups that don't list their GPUs. For each policy the instances
+/// are placed as the following:
+///
+///   TRTSERVER_INSTANCE_PLACEMENT_NONE: the group has 'count' instances
+///   on every GPU. This is the default.
+///
+///   TRTSERVER_INSTANCE_PLACEMENT_BALANCED: the group has 'count'
+///   instances in total, each placed on the GPU with the least
+///   estimated memory, and then the fewest instances, of the models
+///   placed so far.
+///
+///   TRTSERVER_INSTANCE_PLACEMENT_PACK: the group has 'count' instances
+///   in total, each placed on the GPU with the most estimated memory,
+///   and then the most instances, that still has room for it, so that
+///   the other GPUs are left free for larger models.
+///
+/// The estimated memory of an instance is the model's recorded memory
+/// estimate, see TRTSERVER_ServerOptionsSetModelMemoryEstimateDirectory.
+/// The chosen GPUs are reported in the model configuration in the
+/// server status.
+/// \param options The server options object.
+/// \param placement The placement policy.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerOptionsSetInstancePlacement(
+    TRTSERVER_ServerOptions* options, TRTSERVER_Instance_Placement placement);
+
+/// Set the host CPUs that a class of server threads runs on, so that
+/// the classes don't compete for the same cores:
+///
+///   TRTSERVER_THREAD_CLASS_FRONTEND: the threads of the HTTP and GRPC
+///   frontends, which are bound by the frontends themselves, see
+///   TRTSERVER_ServerThreadClassCpus.
+///
+///   TRTSERVER_THREAD_CLASS_SCHEDULER: the scheduler threads that run
+///   the models, unless the model's instance group sets 'host_cpus'.
+///
+///   TRTSERVER_THREAD_CLASS_BACKEND: the thread pools that frameworks
+///   create while a model is loaded.
+///
+///   TRTSERVER_THREAD_CLASS_BACKGROUND: the model loading, metrics and
+///   status threads.
+///
+/// Once any class has CPUs set, the classes without CPUs set run on
+/// all the CPUs available to the server. By default no threads are
+/// bound.
+/// \param options The server options object.
+/// \param thread_class The class of threads.
+/// \param cpu_list The CPUs as a Linux CPU list, for example
+/// "0-3,8-11". The CPUs must be available to the server process.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerOptionsSetThreadClassCpus(
+    TRTSERVER_ServerOptions* options, TRTSERVER_Thread_Class thread_class,
+    const char* cpu_list);
+
 /// Enable or disable info level logging.
 /// \param options The server options object.
 /// \param log True to enable info logging, false to disable.
@@ -590,6 +1018,16 @@ TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerOptionsSetLogError(
 TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerOptionsSetLogVerbose(
     TRTSERVER_ServerOptions* options, int level);
 
+/// Enable or disable writing the log from a background thread. When
+/// enabled, log messages are queued in a fixed-size ring and messages
+/// that don't fit are dropped instead of blocking the logging thread.
+/// \param options The server options object.
+/// \param async True to write the log asynchronously, false to write
+/// each message as it is logged.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerOptionsSetLogAsync(
+    TRTSERVER_ServerOptions* options, bool async);
+
 /// Enable or disable metrics collection in a server options.
 /// \param options The server options object.
 /// \param metrics True to enable metrics, false to disable.
@@ -606,6 +1044,40 @@ TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerOptionsSetMetrics(
 TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerOptionsSetGpuMetrics(
     TRTSERVER_ServerOptions* options, bool gpu_metrics);
 
+/// Set the bucket boundaries of the histograms of the inference
+/// request, queue and compute latency metrics in a server options.
+/// \param options The server options object.
+/// \param buckets The upper bounds of the buckets, in microseconds, in
+/// strictly increasing order.
+/// \param bucket_count The number of buckets in 'buckets'.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetMetricsLatencyBuckets(
+    TRTSERVER_ServerOptions* options, const double* buckets,
+    size_t bucket_count);
+
+/// Set the maximum age of the serialized metrics in a server
+/// options. A metrics scrape reuses the serialized metrics of an
+/// earlier scrape that are no older than the maximum age, instead of
+/// collecting the metrics again. The default is 0, which collects and
+/// serializes the metrics for every scrape.
+/// \param options The server options object.
+/// \param max_age_ms The maximum age, in milliseconds.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerOptionsSetMetricsCacheMaxAge(
+    TRTSERVER_ServerOptions* options, uint64_t max_age_ms);
+
+/// Set the interval at which GPU metrics are collected in a server
+/// options, independent of how often the metrics are scraped. The
+/// default is 2000 milliseconds.
+/// \param options The server options object.
+/// \param interval_ms The interval, in milliseconds. Must be at
+/// least 1.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetGpuMetricsPollInterval(
+    TRTSERVER_ServerOptions* options, uint64_t interval_ms);
+
 /// Enable or disable TensorFlow soft-placement of operators.
 /// \param options The server options object.
 /// \param soft_placement True to enable, false to disable.
@@ -639,6 +1111,48 @@ TRTSERVER_ServerOptionsAddTensorFlowVgpuMemoryLimits(
     TRTSERVER_ServerOptions* options, int gpu_device, int num_vgpus,
     uint64_t per_vgpu_memory_mbytes);
 
+/// Set the directory where TensorRT engines built from ONNX models
+/// are cached so that later loads of the models don't rebuild
+/// them. The engines built by the TensorRT execution accelerator of
+/// ONNX Runtime models, and the graphs converted by the TensorRT
+/// execution accelerator of TensorFlow GraphDef models, are cached
+/// too. An empty directory disables the cache.
+/// \param options The server options object.
+/// \param cache_dir The full path of the cache directory.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetTensorRTEngineCacheDirectory(
+    TRTSERVER_ServerOptions* options, const char* cache_dir);
+
+/// Cache the files read from model repositories on Google Cloud
+/// Storage or Amazon S3 in a local directory, so that loading a model
+/// again, also after a restart of the server, doesn't download the
+/// files that haven't changed. By default the files are not cached.
+/// \param options The server options object.
+/// \param cache_dir The full path of the cache directory, which must
+/// exist, or empty to not cache the files.
+/// \param byte_size The size of the cached files above which the
+/// least recently used ones are removed, or 0 for no limit.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetRemoteRepositoryCache(
+    TRTSERVER_ServerOptions* options, const char* cache_dir,
+    uint64_t byte_size);
+
+/// Set how files are downloaded from model repositories on Google
+/// Cloud Storage or Amazon S3. Each file is downloaded in parts using
+/// ranged reads, several at the same time. By default the parts are
+/// 64 MB and up to 8 parts of a file are downloaded in parallel.
+/// \param options The server options object.
+/// \param part_byte_size The maximum byte size of each part.
+/// \param concurrency The maximum number of parts of a file that are
+/// downloaded at the same time.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error*
+TRTSERVER_ServerOptionsSetRemoteRepositoryDownload(
+    TRTSERVER_ServerOptions* options, uint64_t part_byte_size,
+    unsigned int concurrency);
+
 /// TRTSERVER_Server
 ///
 /// An inference server.
@@ -677,6 +1191,34 @@ TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerStop(
 TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerId(
     TRTSERVER_Server* server, const char** id);
 
+/// Get the host CPUs that a class of server threads runs on. Threads
+/// created outside of the server, for example by a frontend, should
+/// bind themselves to the CPUs of their class. The caller does not own
+/// the returned array and must not modify or delete it. The lifetime of
+/// the array extends only as long as 'server'.
+/// \param server The inference server object.
+/// \param thread_class The class of threads.
+/// \param cpus Returns the CPUs.
+/// \param cpu_count Returns the number of CPUs, which is 0 if the
+/// server doesn't isolate thread classes and so threads should not be
+/// bound.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerThreadClassCpus(
+    TRTSERVER_Server* server, TRTSERVER_Thread_Class thread_class,
+    const int** cpus, size_t* cpu_count);
+
+/// Get the number of CPUs that a class of server threads can use, to
+/// size a thread pool of that class. This is the number of CPUs set for
+/// the class or, if none are, the number of CPUs available to the
+/// server, limited by the CPU quota of the server's cgroup.
+/// \param server The inference server object.
+/// \param thread_class The class of threads.
+/// \param count Returns the number of CPUs.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerAvailableCpuCount(
+    TRTSERVER_Server* server, TRTSERVER_Thread_Class thread_class,
+    uint32_t* count);
+
 /// Check the model repository for changes and update server state
 /// based on those changes.
 /// \param server The inference server object.
@@ -707,6 +1249,21 @@ TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerIsReady(
 TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerStatus(
     TRTSERVER_Server* server, TRTSERVER_Protobuf** status);
 
+/// Get the current server status for only the models whose status
+/// changed after a status snapshot generation, as a TRTSERVER_Protobuf
+/// object. The generation of a status is given by its 'generation'
+/// field. A 'since_generation' of 0, or a server without status
+/// snapshots, returns the status for all models. The caller takes
+/// ownership of the object and must call TRTSERVER_ProtobufDelete to
+/// release the object.
+/// \param server The inference server object.
+/// \param since_generation The generation of the previous status.
+/// \param status Returns the server status protobuf.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerStatusSince(
+    TRTSERVER_Server* server, uint64_t since_generation,
+    TRTSERVER_Protobuf** status);
+
 /// Get the current server status for a single model as a
 /// TRTSERVER_Protobuf object. The caller takes ownership of the object
 /// and must call TRTSERVER_ProtobufDelete to release the object.
@@ -802,6 +1359,29 @@ TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerSharedMemoryStatus(
 TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerMetrics(
     TRTSERVER_Server* server, TRTSERVER_Metrics** metrics);
 
+/// Enable or disable the NVTX range annotations of the server at
+/// runtime. The annotations are enabled by default.
+/// TRTSERVER_ERROR_UNSUPPORTED is returned if the server is not built
+/// with NVTX support.
+/// \param server The inference server object.
+/// \param enabled True to emit the NVTX ranges, false to not emit.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerSetNvtxEnabled(
+    TRTSERVER_Server* server, bool enabled);
+
+/// Start a CUDA profiler capture, as with cudaProfilerStart, that is
+/// stopped after the given duration. This limits the capture of a
+/// profiler attached to the server, for example Nsight Systems with
+/// --capture-range=cudaProfilerApi, to a window of interest.
+/// TRTSERVER_ERROR_ALREADY_EXISTS is returned if a capture is already
+/// in progress and TRTSERVER_ERROR_UNSUPPORTED if the server is not
+/// built with GPU support.
+/// \param server The inference server object.
+/// \param duration_ms The duration of the capture, in milliseconds.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerStartProfile(
+    TRTSERVER_Server* server, uint64_t duration_ms);
+
 /// Type for inference completion callback function. If non-nullptr,
 /// the 'trace' object is the trace associated with the request that
 /// is completing. The callback function takes ownership of the
@@ -840,6 +1420,36 @@ TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerInferAsync(
     void* response_allocator_userp, TRTSERVER_InferenceCompleteFn_t complete_fn,
     void* complete_userp);
 
+/// Perform inference on several requests for the same model. The
+/// requests are enqueued with the model's scheduler together, which
+/// costs less than calling TRTSERVER_ServerInferAsync for each
+/// request. Each request completes independently, as if it was
+/// submitted with TRTSERVER_ServerInferAsync. The caller retains
+/// ownership of the request providers but may release them by calling
+/// TRTSERVER_InferenceRequestProviderDelete once this function
+/// returns. An error is returned, and no request is performed, if the
+/// requests are not for the same version of the same model.
+/// \param server The inference server object.
+/// \param traces The trace object for each request, or nullptr if no
+/// tracing. An element may be nullptr if its request is not traced.
+/// \param request_providers The request provider for each request.
+/// \param request_count The number of requests.
+/// \param response_allocator The TRTSERVER_ResponseAllocator to use
+/// to allocate buffers to hold inference results.
+/// \param response_allocator_userp User-provided pointer that is
+/// delivered to the response allocator's allocation function.
+/// \param complete_fn The function called when each inference
+/// completes.
+/// \param complete_userps User-provided pointer for each request that
+/// is delivered to the completion function of the request.
+/// \return a TRTSERVER_Error indicating success or failure.
+TRTSERVER_EXPORT TRTSERVER_Error* TRTSERVER_ServerInferBatchAsync(
+    TRTSERVER_Server* server, TRTSERVER_Trace** traces,
+    TRTSERVER_InferenceRequestProvider** request_providers,
+    size_t request_count, TRTSERVER_ResponseAllocator* response_allocator,
+    void* response_allocator_userp, TRTSERVER_InferenceCompleteFn_t complete_fn,
+    void** complete_userps);
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,13 +32,16 @@
 #include "src/core/model_config.h"
 #include "src/core/model_config.pb.h"
 #include "src/custom/sdk/custom_instance.h"
+#include "src/custom/sdk/string_tensor.h"
 
 #define LOG_ERROR std::cerr
 #define LOG_INFO std::cout
 
 // This custom backend takes a byte string of original image as input and
 // returns preprocessed image in the shape and format specified in model
-// configuration.
+// configuration. The images of all the payloads of an execution are
+// decoded and preprocessed in parallel on the SDK thread pool, by at
+// most 'thread_count' threads if that parameter is set.
 //
 
 namespace nvidia { namespace inferenceserver { namespace custom {
@@ -63,15 +66,17 @@ class Context : public CustomInstance {
       CustomGetNextInputFn_t input_fn, CustomGetOutputFn_t output_fn);
 
  private:
-  // Obtain the input tensor as contiguous chunk. If batched, decompose it.
-  int GetInputTensor(
-      CustomGetNextInputFn_t input_fn, void* input_context, const char* name,
-      const uint32_t batch_size, std::vector<std::vector<char>>& input);
-
   int Preprocess(const cv::Mat& img, char* data, size_t* image_byte_size);
 
   bool ParseType(const DataType& dtype, int* type1, int* type3);
 
+  // The encoded images of each payload, reused across executions.
+  std::vector<StringTensor> inputs_;
+
+  // The maximum number of threads that preprocess the images of an
+  // execution, or 0 for all the threads of the pool.
+  size_t max_concurrency_;
+
   // The format of the preprocessed image
   ModelInput::Format format_;
 
@@ -91,17 +96,17 @@ class Context : public CustomInstance {
   const int kOutputBuffer =
       RegisterError("unable to get buffer for output tensor values");
   const int kInput = RegisterError("expected single input, 1 STRING element");
-  const int kInputBuffer =
-      RegisterError("unable to get buffer for input tensor values");
-  const int kInputSize =
-      RegisterError("input obtained does not match batch size");
   const int kOpenCV = RegisterError("unable to preprocess image");
+  const int kThreadCount =
+      RegisterError("expected 'thread_count' parameter to be >= 1");
 };
 
 Context::Context(
     const std::string& instance_name, const ModelConfig& model_config,
     const int gpu_device)
-    : CustomInstance(instance_name, model_config, gpu_device)
+    : CustomInstance(instance_name, model_config, gpu_device),
+      format_(ModelInput::FORMAT_NCHW), scaling_(ScaleType::NONE),
+      max_concurrency_(0)
 {
 }
 
@@ -157,6 +162,18 @@ Context::Init()
       } else {
         scaling_ = NONE;
       }
+    } else if (pr.first == "thread_count") {
+      int thread_count;
+      try {
+        thread_count = std::stoi(pr.second.string_value());
+      }
+      catch (const std::exception& ex) {
+        return kThreadCount;
+      }
+      if (thread_count < 1) {
+        return kThreadCount;
+      }
+      max_concurrency_ = thread_count;
     }
   }
 
@@ -168,6 +185,24 @@ Context::Execute(
     const uint32_t payload_cnt, CustomPayload* payloads,
     CustomGetNextInputFn_t input_fn, CustomGetOutputFn_t output_fn)
 {
+  // The images of all payloads, each with the payload it belongs to
+  // and where its preprocessed image is written.
+  struct Image {
+    uint32_t payload_idx_;
+    const char* data_;
+    size_t byte_size_;
+    char* output_;
+    int error_code_;
+  };
+
+  const size_t image_byte_size = GetByteSize(output_type_, output_shape_);
+
+  // The callbacks are only called from this thread, so first read the
+  // inputs and get the output buffers of all payloads.
+  if (inputs_.size() < payload_cnt) {
+    inputs_.resize(payload_cnt);
+  }
+  std::vector<Image> images;
   for (size_t idx = 0; idx < payload_cnt; idx++) {
     // If output wasn't requested just do nothing.
     if (payloads[idx].output_cnt == 0) {
@@ -177,9 +212,9 @@ Context::Execute(
     // Reads input
     uint32_t batch_size =
         (payloads[idx].batch_size == 0) ? 1 : payloads[idx].batch_size;
-    std::vector<std::vector<char>> input;
-    int err = GetInputTensor(
-        input_fn, payloads[idx].input_context, "INPUT", batch_size, input);
+    StringTensor& input = inputs_[idx];
+    int err = input.ReadInput(
+        input_fn, payloads[idx].input_context, "INPUT", batch_size);
     if (err != ErrorCodes::Success) {
       payloads[idx].error_code = err;
       continue;
@@ -202,105 +237,42 @@ Context::Execute(
     // If no error but the 'obuffer' is returned as nullptr, then
     // skip writing this output.
     if (obuffer != nullptr) {
-      size_t byte_used = 0;
-      for (const auto& data : input) {
-        cv::Mat img = imdecode(cv::Mat(data), 1);
-        if (img.empty()) {
-          payloads[idx].error_code = kOpenCV;
-          break;
-        }
-
-        size_t image_byte_size;
-
-        err = Preprocess(img, (char*)obuffer + byte_used, &image_byte_size);
-        if (err != ErrorCodes::Success) {
-          payloads[idx].error_code = err;
-          break;
-        }
-        byte_used += image_byte_size;
+      for (size_t i = 0; i < input.ElementCount(); ++i) {
+        size_t byte_size;
+        const char* data = input.Element(i, &byte_size);
+        images.push_back(
+            {static_cast<uint32_t>(idx), data, byte_size,
+             static_cast<char*>(obuffer) + (i * image_byte_size),
+             ErrorCodes::Success});
       }
     }
   }
 
-  return ErrorCodes::Success;
-}
-
-int
-Context::GetInputTensor(
-    CustomGetNextInputFn_t input_fn, void* input_context, const char* name,
-    const uint32_t batch_size, std::vector<std::vector<char>>& input)
-{
-  // The values for an input tensor are not necessarily in one
-  // contiguous chunk, so we copy the chunks into 'input' vector. A
-  // more performant solution would attempt to use the input tensors
-  // in-place instead of having this copy.
-
-  // The size of a STRING data type can only be obtained from the data
-  // (convention: first 4 bytes stores the size of the actual data)
-  uint32_t image_size = 0;
-  uint32_t byte_read = 0;
-  std::vector<char> size_buffer;
-  while (true) {
-    const void* content;
-    // Get all content out
-    uint64_t content_byte_size = -1;
-    if (!input_fn(input_context, name, &content, &content_byte_size)) {
-      return kInputBuffer;
-    }
-
-    // If 'content' returns nullptr we have all the input.
-    if (content == nullptr) {
-      break;
-    }
-
-    // Keep consuming the content because we want to decompose the batched input
-    while (content_byte_size > 0) {
-      // If there are input and 'image_size' is not set, try to read image_size
-      if (image_size == 0) {
-        // Make sure we have enought bytes to read as 'image_size'
-        uint64_t byte_to_append = 4 - size_buffer.size();
-        byte_to_append = (byte_to_append < content_byte_size)
-                             ? byte_to_append
-                             : content_byte_size;
-        size_buffer.insert(
-            size_buffer.end(), static_cast<const char*>(content),
-            static_cast<const char*>(content) + byte_to_append);
-
-        // modify position to unread content
-        content = static_cast<const char*>(content) + byte_to_append;
-        content_byte_size -= byte_to_append;
-        if (size_buffer.size() == 4) {
-          image_size = *(uint32_t*)(&size_buffer[0]);
-          byte_read = 0;
-          size_buffer.clear();
-          input.emplace_back();
-        } else {
-          break;
+  // Decode and preprocess the images in parallel, each directly into
+  // its place in the output buffer.
+  ThreadPool::Shared()->ParallelFor(
+      images.size(), max_concurrency_, [this, &images](size_t idx) {
+        Image& image = images[idx];
+        cv::Mat img = imdecode(
+            cv::Mat(
+                1, image.byte_size_, CV_8UC1, const_cast<char*>(image.data_)),
+            1);
+        if (img.empty()) {
+          image.error_code_ = kOpenCV;
+          return;
         }
-      }
 
-      uint32_t byte_to_read = image_size - byte_read;
-      byte_to_read =
-          (byte_to_read < content_byte_size) ? byte_to_read : content_byte_size;
+        size_t byte_size;
+        image.error_code_ = Preprocess(img, image.output_, &byte_size);
+      });
 
-      input.back().insert(
-          input.back().end(), static_cast<const char*>(content),
-          static_cast<const char*>(content) + byte_to_read);
-
-      content = static_cast<const char*>(content) + byte_to_read;
-      content_byte_size -= byte_to_read;
-      byte_read += byte_to_read;
-      if (byte_read == image_size) {
-        image_size = 0;
-      }
+  for (const auto& image : images) {
+    if ((image.error_code_ != ErrorCodes::Success) &&
+        (payloads[image.payload_idx_].error_code == ErrorCodes::Success)) {
+      payloads[image.payload_idx_].error_code = image.error_code_;
     }
   }
 
-  // Make sure we end up with exactly the amount of input we expect.
-  if (batch_size != input.size()) {
-    return kInputSize;
-  }
-
   return ErrorCodes::Success;
 }
 
@@ -350,63 +322,53 @@ Context::Preprocess(const cv::Mat& img, char* data, size_t* image_byte_size)
     sample_resized = sample;
   }
 
-  cv::Mat sample_type;
-  sample_resized.convertTo(sample_type, (c == 3) ? img_type3 : img_type1);
-
-  cv::Mat sample_final;
+  // The scaling is applied by converting each value to the output
+  // type as 'value * scale + offset[channel]', written directly into
+  // 'data' in the output format.
+  double scale = 1.0;
+  double offset[3] = {0.0, 0.0, 0.0};
   if (scaling_ == ScaleType::INCEPTION) {
-    if (c == 1) {
-      sample_final = sample_type.mul(cv::Scalar(1 / 128.0));
-      sample_final = sample_final - cv::Scalar(1.0);
-    } else {
-      sample_final =
-          sample_type.mul(cv::Scalar(1 / 128.0, 1 / 128.0, 1 / 128.0));
-      sample_final = sample_final - cv::Scalar(1.0, 1.0, 1.0);
-    }
+    scale = 1 / 128.0;
+    offset[0] = offset[1] = offset[2] = -1.0;
   } else if (scaling_ == ScaleType::VGG) {
     if (c == 1) {
-      sample_final = sample_type - cv::Scalar(128);
+      offset[0] = -128.0;
     } else {
-      sample_final = sample_type - cv::Scalar(104, 117, 123);
+      offset[0] = -104.0;
+      offset[1] = -117.0;
+      offset[2] = -123.0;
     }
-  } else {
-    sample_final = sample_type;
   }
 
-  // Allocate a buffer to hold all image elements.
-  *image_byte_size = sample_final.total() * sample_final.elemSize();
+  *image_byte_size = h * w * c * CV_ELEM_SIZE1(img_type1);
   size_t pos = 0;
 
-  // For NHWC format Mat is already in the correct order but need to
-  // handle both cases of data being contigious or not.
   if (format_ == ModelInput::FORMAT_NHWC) {
-    if (sample_final.isContinuous()) {
-      memcpy(data, sample_final.datastart, *image_byte_size);
-      pos = *image_byte_size;
-    } else {
-      size_t row_byte_size = sample_final.cols * sample_final.elemSize();
-      for (int r = 0; r < sample_final.rows; ++r) {
-        memcpy(&(data[pos]), sample_final.ptr<uint8_t>(r), row_byte_size);
-        pos += row_byte_size;
-      }
+    // For NHWC format the Mat is already in the correct order, so
+    // convert all channels at once when they share the offset.
+    cv::Mat output(img_size, (c == 3) ? img_type3 : img_type1, data);
+    const bool same_offset =
+        (c == 1) || ((offset[0] == offset[1]) && (offset[1] == offset[2]));
+    sample_resized.convertTo(
+        output, output.type(), scale, same_offset ? offset[0] : 0.0);
+    if (!same_offset) {
+      cv::add(output, cv::Scalar(offset[0], offset[1], offset[2]), output);
     }
+    pos = output.total() * output.elemSize();
   } else {
     // (format_ == ModelInput::FORMAT_NCHW)
     //
     // For CHW formats must split out each channel from the matrix and
-    // order them as BBBB...GGGG...RRRR. To do this split the channels
-    // of the image directly into 'input_data'. The BGR channels are
-    // backed by the 'input_data' vector so that ends up with CHW
-    // order of the data.
-    std::vector<cv::Mat> input_bgr_channels;
+    // order them as RRRR...GGGG...BBBB. To do this split the 8-bit
+    // channels and convert each one directly into its plane of
+    // 'data'.
+    std::vector<cv::Mat> channels;
+    cv::split(sample_resized, channels);
     for (size_t i = 0; i < c; ++i) {
-      input_bgr_channels.emplace_back(
-          img_size.height, img_size.width, img_type1, &(data[pos]));
-      pos += input_bgr_channels.back().total() *
-             input_bgr_channels.back().elemSize();
+      cv::Mat plane(img_size, img_type1, &(data[pos]));
+      channels[i].convertTo(plane, img_type1, scale, offset[i]);
+      pos += plane.total() * plane.elemSize();
     }
-
-    cv::split(sample_final, input_bgr_channels);
   }
 
   if (pos != *image_byte_size) {
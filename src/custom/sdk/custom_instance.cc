@@ -113,6 +113,38 @@ CustomExecuteV2(
   return instance->Execute(payload_cnt, payloads, input_fn, output_fn);
 }
 
+int
+CustomExecuteV3(
+    void* custom_instance, const uint32_t payload_cnt, CustomPayload* payloads,
+    const uint32_t input_cnt, const CustomTensor* inputs,
+    const uint32_t output_cnt, const CustomTensor* outputs, void* cuda_stream)
+{
+  if (custom_instance == nullptr) {
+    return ErrorCodes::Unknown;
+  }
+
+  CustomInstance* instance = static_cast<CustomInstance*>(custom_instance);
+  return instance->Execute(
+      payload_cnt, payloads, input_cnt, inputs, output_cnt, outputs,
+      cuda_stream);
+}
+
+int
+CustomExecuteAsync(
+    void* custom_instance, const uint32_t payload_cnt, CustomPayload* payloads,
+    CustomGetNextInputV2Fn_t input_fn, CustomGetOutputV2Fn_t output_fn,
+    CustomExecuteCompleteFn_t complete_fn, void* complete_context)
+{
+  if (custom_instance == nullptr) {
+    return ErrorCodes::Unknown;
+  }
+
+  CustomInstance* instance = static_cast<CustomInstance*>(custom_instance);
+  return instance->ExecuteAsync(
+      payload_cnt, payloads, input_fn, output_fn, complete_fn,
+      complete_context);
+}
+
 }  // extern "C"
 
 }}}  // namespace nvidia::inferenceserver::custom
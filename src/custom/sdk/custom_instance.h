@@ -33,6 +33,7 @@
 #include "src/core/model_config.h"
 #include "src/core/model_config.pb.h"
 #include "src/custom/sdk/error_codes.h"
+#include "src/custom/sdk/thread_pool.h"
 
 namespace nvidia { namespace inferenceserver { namespace custom {
 
@@ -97,6 +98,49 @@ class CustomInstance {
     return ErrorCodes::InvalidInvocationV2;
   }
 
+  /// Execute the custom instance. User should override this function
+  /// if version 3 of the custom interface is used.
+  ///
+  /// \param payload_cnt The number of payloads to execute.
+  /// \param payloads The payloads to execute.
+  /// \param input_cnt The number of input tensors.
+  /// \param inputs The input tensors, holding the inputs of all
+  /// payloads.
+  /// \param output_cnt The number of output tensors.
+  /// \param outputs The output tensors that must be computed.
+  /// \param cuda_stream The cudaStream_t to execute on, or nullptr if
+  /// the instance is not on a GPU (see CustomExecuteV3).
+  /// \return Error code indicating success or the type of failure
+  virtual int Execute(
+      const uint32_t payload_cnt, CustomPayload* payloads,
+      const uint32_t input_cnt, const CustomTensor* inputs,
+      const uint32_t output_cnt, const CustomTensor* outputs,
+      void* cuda_stream)
+  {
+    return ErrorCodes::InvalidInvocationV3;
+  }
+
+  /// Start to execute the custom instance. User should override this
+  /// function if version 4 of the custom interface is used.
+  ///
+  /// \param payload_cnt The number of payloads to execute.
+  /// \param payloads The payloads to execute.
+  /// \param input_fn The callback function to get tensor input (see
+  /// CustomGetNextInputV2Fn_t).
+  /// \param output_fn The callback function to get buffer for tensor
+  /// output (see CustomGetOutputV2Fn_t).
+  /// \param complete_fn The callback function to call with
+  /// 'complete_context' when the execution completes (see
+  /// CustomExecuteCompleteFn_t).
+  /// \return Error code indicating success or the type of failure
+  virtual int ExecuteAsync(
+      const uint32_t payload_cnt, CustomPayload* payloads,
+      CustomGetNextInputV2Fn_t input_fn, CustomGetOutputV2Fn_t output_fn,
+      CustomExecuteCompleteFn_t complete_fn, void* complete_context)
+  {
+    return ErrorCodes::InvalidInvocationV4;
+  }
+
   /// Get the string for an error code.
   ///
   /// /param error Error code returned by a CustomInstance function
@@ -117,6 +161,27 @@ class CustomInstance {
       const std::string& instance_name, const ModelConfig& model_config,
       int gpu_device);
 
+  /// Call 'fn' for each of the payloads, in parallel on the thread
+  /// pool shared by all the instances of the custom backend. This
+  /// suits a backend that executes each payload independently of the
+  /// others. The input and output callbacks may be called from 'fn'
+  /// but 'fn' must otherwise be thread-safe.
+  ///
+  /// \param payload_cnt The number of payloads to execute.
+  /// \param payloads The payloads to execute.
+  /// \param fn The function that executes a payload.
+  /// \param max_concurrency The maximum number of threads that execute
+  /// the payloads. 0 (zero) allows all the threads of the pool.
+  void ParallelForEachPayload(
+      const uint32_t payload_cnt, CustomPayload* payloads,
+      const std::function<void(CustomPayload*)>& fn,
+      const size_t max_concurrency = 0)
+  {
+    ThreadPool::Shared()->ParallelFor(
+        payload_cnt, max_concurrency,
+        [payloads, &fn](size_t idx) { fn(&payloads[idx]); });
+  }
+
   /// Register a custom error and error message.
   ///
   /// \param error_message A descriptive error message string
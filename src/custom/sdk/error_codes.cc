@@ -39,6 +39,17 @@ ErrorCodes::ErrorCodes()
   RegisterError(
       InvalidInvocationV2,
       "invalid V2 function invocation while the custom backend is not V2");
+  RegisterError(
+      InvalidInvocationV3,
+      "invalid V3 function invocation while the custom backend is not V3");
+  RegisterError(
+      InvalidInvocationV4,
+      "invalid V4 function invocation while the custom backend is not V4");
+  RegisterError(InputBuffer, "unable to get buffer for input tensor values");
+  RegisterError(
+      InvalidStringTensor,
+      "string input tensor does not hold the expected number of elements");
+  RegisterError(OutputBuffer, "unable to get buffer for output tensor values");
   RegisterError(Unknown, "unknown error");
 }
 
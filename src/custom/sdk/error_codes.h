@@ -55,8 +55,27 @@ class ErrorCodes {
   /// while the custom backend is not V2.
   static const int InvalidInvocationV2 = 4;
 
+  /// Error code when V3 version of a function is called
+  /// while the custom backend is not V3.
+  static const int InvalidInvocationV3 = 5;
+
+  /// Error code when V4 version of a function is called
+  /// while the custom backend is not V4.
+  static const int InvalidInvocationV4 = 6;
+
+  /// Error code when the values of an input tensor can't be obtained.
+  static const int InputBuffer = 7;
+
+  /// Error code when a TYPE_STRING input tensor is not correctly
+  /// serialized or doesn't have the expected number of elements.
+  static const int InvalidStringTensor = 8;
+
+  /// Error code when the buffer for an output tensor can't be
+  /// obtained.
+  static const int OutputBuffer = 9;
+
   /// Error code for an unknown error.
-  static const int Unknown = 5;
+  static const int Unknown = 10;
 
   ErrorCodes();
   ~ErrorCodes() = default;
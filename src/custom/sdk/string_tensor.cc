@@ -0,0 +1,200 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/custom/sdk/string_tensor.h"
+
+#include <string.h>
+#include <algorithm>
+#include "src/custom/sdk/error_codes.h"
+
+namespace nvidia { namespace inferenceserver { namespace custom {
+
+void
+StringTensor::Clear()
+{
+  data_.clear();
+  offsets_.resize(1);
+  length_byte_cnt_ = 0;
+  remaining_byte_cnt_ = 0;
+}
+
+int
+StringTensor::ReadInput(
+    CustomGetNextInputFn_t input_fn, void* input_context, const char* name,
+    size_t element_cnt)
+{
+  Clear();
+  while (true) {
+    const void* content;
+    uint64_t content_byte_size = -1;
+    if (!input_fn(input_context, name, &content, &content_byte_size)) {
+      return ErrorCodes::InputBuffer;
+    }
+
+    // If 'content' returns nullptr we have all the input.
+    if (content == nullptr) {
+      break;
+    }
+
+    Append(static_cast<const char*>(content), content_byte_size);
+  }
+
+  return Finish(element_cnt);
+}
+
+int
+StringTensor::ReadInput(
+    CustomGetNextInputV2Fn_t input_fn, void* input_context, const char* name,
+    size_t element_cnt)
+{
+  Clear();
+  while (true) {
+    const void* content;
+    uint64_t content_byte_size = -1;
+    CustomMemoryType memory_type = CUSTOM_MEMORY_CPU;
+    if (!input_fn(
+            input_context, name, &content, &content_byte_size,
+            &memory_type)) {
+      return ErrorCodes::InputBuffer;
+    }
+
+    // If 'content' returns nullptr we have all the input.
+    if (content == nullptr) {
+      break;
+    }
+
+    if (memory_type != CUSTOM_MEMORY_CPU) {
+      return ErrorCodes::InputBuffer;
+    }
+
+    Append(static_cast<const char*>(content), content_byte_size);
+  }
+
+  return Finish(element_cnt);
+}
+
+void
+StringTensor::Append(const char* content, uint64_t content_byte_size)
+{
+  // An element and its length may be split across chunks so the
+  // parse state is kept between calls.
+  while (content_byte_size > 0) {
+    if (remaining_byte_cnt_ == 0) {
+      const size_t cnt = std::min(
+          sizeof(length_bytes_) - length_byte_cnt_, (size_t)content_byte_size);
+      memcpy(length_bytes_ + length_byte_cnt_, content, cnt);
+      length_byte_cnt_ += cnt;
+      content += cnt;
+      content_byte_size -= cnt;
+      if (length_byte_cnt_ < sizeof(length_bytes_)) {
+        break;
+      }
+
+      uint32_t length;
+      memcpy(&length, length_bytes_, sizeof(length));
+      length_byte_cnt_ = 0;
+      remaining_byte_cnt_ = length;
+      offsets_.push_back(offsets_.back() + length);
+      if (length == 0) {
+        continue;
+      }
+    }
+
+    const size_t cnt =
+        std::min((uint64_t)remaining_byte_cnt_, content_byte_size);
+    data_.insert(data_.end(), content, content + cnt);
+    content += cnt;
+    content_byte_size -= cnt;
+    remaining_byte_cnt_ -= cnt;
+  }
+}
+
+int
+StringTensor::Finish(size_t element_cnt) const
+{
+  if ((length_byte_cnt_ != 0) || (remaining_byte_cnt_ != 0) ||
+      (ElementCount() != element_cnt)) {
+    return ErrorCodes::InvalidStringTensor;
+  }
+
+  return ErrorCodes::Success;
+}
+
+void
+StringTensorBuilder::Append(const char* data, uint32_t byte_size)
+{
+  const char* length = reinterpret_cast<const char*>(&byte_size);
+  buffer_.insert(buffer_.end(), length, length + sizeof(byte_size));
+  buffer_.insert(buffer_.end(), data, data + byte_size);
+  element_cnt_++;
+}
+
+int
+StringTensorBuilder::WriteOutput(
+    CustomGetOutputFn_t output_fn, void* output_context, const char* name,
+    const std::vector<int64_t>& shape) const
+{
+  void* obuffer;
+  if (!output_fn(
+          output_context, name, shape.size(),
+          const_cast<int64_t*>(shape.data()), buffer_.size(), &obuffer)) {
+    return ErrorCodes::OutputBuffer;
+  }
+
+  // If no error but the 'obuffer' is returned as nullptr, then the
+  // output should not be written.
+  if (obuffer != nullptr) {
+    memcpy(obuffer, buffer_.data(), buffer_.size());
+  }
+
+  return ErrorCodes::Success;
+}
+
+int
+StringTensorBuilder::WriteOutput(
+    CustomGetOutputV2Fn_t output_fn, void* output_context, const char* name,
+    const std::vector<int64_t>& shape) const
+{
+  void* obuffer;
+  CustomMemoryType memory_type = CUSTOM_MEMORY_CPU;
+  if (!output_fn(
+          output_context, name, shape.size(),
+          const_cast<int64_t*>(shape.data()), buffer_.size(), &obuffer,
+          &memory_type)) {
+    return ErrorCodes::OutputBuffer;
+  }
+
+  if (obuffer != nullptr) {
+    if (memory_type != CUSTOM_MEMORY_CPU) {
+      return ErrorCodes::OutputBuffer;
+    }
+    memcpy(obuffer, buffer_.data(), buffer_.size());
+  }
+
+  return ErrorCodes::Success;
+}
+
+}}}  // namespace nvidia::inferenceserver::custom
@@ -0,0 +1,177 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "src/backends/custom/custom.h"
+
+namespace nvidia { namespace inferenceserver { namespace custom {
+
+//==============================================================================
+/// StringTensor holds the elements of a TYPE_STRING input tensor as
+/// one contiguous buffer of the element bytes and the offset of each
+/// element in that buffer, so that a custom backend can use the
+/// elements without parsing the serialized tensor. A StringTensor can
+/// be reused across executions to reuse its buffers.
+///
+class StringTensor {
+ public:
+  StringTensor()
+      : offsets_(1, 0), length_byte_cnt_(0), remaining_byte_cnt_(0)
+  {
+  }
+
+  /// Read a serialized input tensor, in which each element is a
+  /// 4-byte length followed by the bytes of the element. Any earlier
+  /// contents are replaced.
+  ///
+  /// \param input_fn The callback function to get tensor input.
+  /// \param input_context The input context of the payload.
+  /// \param name The name of the input tensor.
+  /// \param element_cnt The number of elements expected in the tensor.
+  /// \return Error code indicating success or the type of failure.
+  int ReadInput(
+      CustomGetNextInputFn_t input_fn, void* input_context, const char* name,
+      size_t element_cnt);
+
+  /// See ReadInput above. The input is requested in CPU memory and is
+  /// an error if it can only be provided in GPU memory.
+  int ReadInput(
+      CustomGetNextInputV2Fn_t input_fn, void* input_context,
+      const char* name, size_t element_cnt);
+
+  /// \return The number of elements.
+  size_t ElementCount() const { return offsets_.size() - 1; }
+
+  /// \return The bytes of all the elements, one after the other.
+  const char* Data() const { return data_.data(); }
+
+  /// \return The offset of each element in Data(), followed by the
+  /// total byte size of the elements. Element 'i' has
+  /// Offsets()[i + 1] - Offsets()[i] bytes.
+  const uint64_t* Offsets() const { return offsets_.data(); }
+
+  /// Get an element.
+  ///
+  /// \param idx The index of the element.
+  /// \param byte_size Returns the size of the element, in bytes.
+  /// \return The bytes of the element.
+  const char* Element(size_t idx, size_t* byte_size) const
+  {
+    *byte_size = offsets_[idx + 1] - offsets_[idx];
+    return data_.data() + offsets_[idx];
+  }
+
+ private:
+  void Clear();
+
+  // Parse the next chunk of the serialized tensor.
+  void Append(const char* content, uint64_t content_byte_size);
+
+  // Check that the parsed tensor is complete and has 'element_cnt'
+  // elements.
+  int Finish(size_t element_cnt) const;
+
+  std::vector<char> data_;
+  std::vector<uint64_t> offsets_;
+
+  // The bytes of the length of the next element read so far, and the
+  // number of bytes of the current element still to read.
+  char length_bytes_[4];
+  size_t length_byte_cnt_;
+  uint32_t remaining_byte_cnt_;
+};
+
+//==============================================================================
+/// StringTensorBuilder builds a TYPE_STRING output tensor from its
+/// elements, directly in the serialized form, so that the tensor is
+/// written to the output buffer with a single copy. A builder can be
+/// cleared and reused across executions to reuse its buffer.
+///
+class StringTensorBuilder {
+ public:
+  StringTensorBuilder() : element_cnt_(0) {}
+
+  /// Reserve room for the elements of a tensor.
+  ///
+  /// \param element_cnt The number of elements.
+  /// \param byte_size The total size of the elements, in bytes.
+  void Reserve(size_t element_cnt, size_t byte_size)
+  {
+    buffer_.reserve((element_cnt * sizeof(uint32_t)) + byte_size);
+  }
+
+  /// Append an element.
+  ///
+  /// \param data The bytes of the element.
+  /// \param byte_size The size of the element, in bytes.
+  void Append(const char* data, uint32_t byte_size);
+
+  /// Append an element.
+  ///
+  /// \param str The element.
+  void Append(const std::string& str) { Append(str.data(), str.size()); }
+
+  /// Remove all elements.
+  void Clear()
+  {
+    buffer_.clear();
+    element_cnt_ = 0;
+  }
+
+  /// \return The number of elements.
+  size_t ElementCount() const { return element_cnt_; }
+
+  /// \return The size of the serialized tensor, in bytes.
+  uint64_t ByteSize() const { return buffer_.size(); }
+
+  /// Write the tensor to the 'name'd output of a payload.
+  ///
+  /// \param output_fn The callback function to get the output buffer.
+  /// \param output_context The output context of the payload.
+  /// \param name The name of the output tensor.
+  /// \param shape The shape of the output tensor.
+  /// \return Error code indicating success or the type of failure.
+  int WriteOutput(
+      CustomGetOutputFn_t output_fn, void* output_context, const char* name,
+      const std::vector<int64_t>& shape) const;
+
+  /// See WriteOutput above. The output buffer is requested in CPU
+  /// memory.
+  int WriteOutput(
+      CustomGetOutputV2Fn_t output_fn, void* output_context, const char* name,
+      const std::vector<int64_t>& shape) const;
+
+ private:
+  std::vector<char> buffer_;
+  size_t element_cnt_;
+};
+
+}}}  // namespace nvidia::inferenceserver::custom
@@ -0,0 +1,149 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/custom/sdk/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace nvidia { namespace inferenceserver { namespace custom {
+
+struct ThreadPool::Job {
+  Job(size_t cnt, const std::function<void(size_t)>& fn)
+      : cnt_(cnt), fn_(fn), next_(0), helper_cnt_(0)
+  {
+  }
+
+  const size_t cnt_;
+  const std::function<void(size_t)>& fn_;
+  std::atomic<size_t> next_;
+
+  // The number of pool threads helping with, or queued to help with,
+  // the jobs. Protected by the pool's 'mu_'.
+  size_t helper_cnt_;
+};
+
+ThreadPool::ThreadPool(size_t thread_cnt) : exit_(false)
+{
+  for (size_t i = 0; i < thread_cnt; ++i) {
+    threads_.emplace_back(&ThreadPool::WorkerThread, this);
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    exit_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+ThreadPool*
+ThreadPool::Shared()
+{
+  static ThreadPool pool(std::max(1U, std::thread::hardware_concurrency()));
+  return &pool;
+}
+
+void
+ThreadPool::ParallelFor(
+    size_t cnt, size_t max_concurrency, const std::function<void(size_t)>& fn)
+{
+  // The calling thread runs jobs too, so one less pool thread is
+  // needed.
+  size_t helper_cnt = std::min(threads_.size(), (cnt == 0) ? 0 : cnt - 1);
+  if (max_concurrency != 0) {
+    helper_cnt = std::min(helper_cnt, max_concurrency - 1);
+  }
+
+  Job job(cnt, fn);
+  if (helper_cnt > 0) {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      job.helper_cnt_ = helper_cnt;
+      queue_.insert(queue_.end(), helper_cnt, &job);
+    }
+    if (helper_cnt == 1) {
+      work_cv_.notify_one();
+    } else {
+      work_cv_.notify_all();
+    }
+  }
+
+  RunJobs(&job);
+
+  if (helper_cnt > 0) {
+    std::unique_lock<std::mutex> lock(mu_);
+
+    // All jobs are taken so the pool threads that haven't started to
+    // help are no longer needed.
+    auto end = std::remove(queue_.begin(), queue_.end(), &job);
+    job.helper_cnt_ -= std::distance(end, queue_.end());
+    queue_.erase(end, queue_.end());
+
+    // Wait for the pool threads still running a job.
+    done_cv_.wait(lock, [&job] { return job.helper_cnt_ == 0; });
+  }
+}
+
+void
+ThreadPool::WorkerThread()
+{
+  while (true) {
+    Job* job;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      work_cv_.wait(lock, [this] { return exit_ || !queue_.empty(); });
+      if (exit_) {
+        break;
+      }
+      job = queue_.front();
+      queue_.pop_front();
+    }
+
+    RunJobs(job);
+
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      job->helper_cnt_--;
+    }
+    done_cv_.notify_all();
+  }
+}
+
+void
+ThreadPool::RunJobs(Job* job)
+{
+  for (size_t idx = job->next_++; idx < job->cnt_; idx = job->next_++) {
+    job->fn_(idx);
+  }
+}
+
+}}}  // namespace nvidia::inferenceserver::custom
@@ -0,0 +1,95 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nvidia { namespace inferenceserver { namespace custom {
+
+//==============================================================================
+/// ThreadPool runs the independent jobs of an execution, such as the
+/// payloads, across a fixed set of threads. Each call to ParallelFor
+/// is run by the calling thread together with idle pool threads, each
+/// taking the next job not yet taken until none are left, so that
+/// threads that finish early take over the remaining jobs. Several
+/// instances may call ParallelFor on the same pool at once.
+///
+class ThreadPool {
+ public:
+  /// Create a pool.
+  ///
+  /// \param thread_cnt The number of threads of the pool.
+  explicit ThreadPool(size_t thread_cnt);
+  ~ThreadPool();
+
+  /// Get the pool shared by all instances of the custom backend, with
+  /// one thread for each CPU. The pool is created on first use.
+  ///
+  /// \return The shared pool.
+  static ThreadPool* Shared();
+
+  /// \return The number of threads of the pool.
+  size_t ThreadCount() const { return threads_.size(); }
+
+  /// Call 'fn' for each index in [0, 'cnt') and return once all the
+  /// calls have returned. The calls are made concurrently from the
+  /// calling thread and the pool threads so 'fn' must be thread-safe.
+  ///
+  /// \param cnt The number of jobs.
+  /// \param max_concurrency The maximum number of threads, including
+  /// the calling thread, that run the jobs. 0 (zero) allows all the
+  /// pool threads.
+  /// \param fn The function that runs a job.
+  void ParallelFor(
+      size_t cnt, size_t max_concurrency,
+      const std::function<void(size_t)>& fn);
+
+ private:
+  struct Job;
+
+  void WorkerThread();
+
+  // Run the jobs of 'job' that are not yet taken by another thread.
+  static void RunJobs(Job* job);
+
+  std::vector<std::thread> threads_;
+  std::mutex mu_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  bool exit_;
+
+  // For each ParallelFor call, one entry for each pool thread that
+  // may help with its jobs.
+  std::deque<Job*> queue_;
+};
+
+}}}  // namespace nvidia::inferenceserver::custom
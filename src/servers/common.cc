@@ -26,6 +26,10 @@
 
 #include "src/servers/common.h"
 
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
 namespace nvidia { namespace inferenceserver {
 
 void
@@ -102,4 +106,43 @@ RequestStatusUtil::NextUniqueRequestId()
   return ++id;
 }
 
+std::vector<int>
+ServerThreadClassCpus(
+    TRTSERVER_Server* server, TRTSERVER_Thread_Class thread_class)
+{
+  const int* cpus = nullptr;
+  size_t cpu_count = 0;
+  LOG_IF_ERR(
+      TRTSERVER_ServerThreadClassCpus(
+          server, thread_class, &cpus, &cpu_count),
+      "getting thread class CPUs");
+
+  return std::vector<int>(cpus, cpus + cpu_count);
+}
+
+TRTSERVER_Error*
+SetCurrentThreadCpus(const std::vector<int>& cpus)
+{
+  if (cpus.empty()) {
+    return nullptr;  // Success
+  }
+
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (const int cpu : cpus) {
+    CPU_SET(cpu, &cpuset);
+  }
+
+  const int err =
+      pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+  if (err != 0) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_INTERNAL,
+        ("unable to set CPU affinity: " + std::string(strerror(err)))
+            .c_str());
+  }
+
+  return nullptr;  // Success
+}
+
 }}  // namespace nvidia::inferenceserver
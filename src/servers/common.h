@@ -25,6 +25,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <vector>
 #include "src/core/request_status.pb.h"
 #include "src/core/trtserver.h"
 
@@ -96,4 +97,12 @@ class RequestStatusUtil {
   static uint64_t NextUniqueRequestId();
 };
 
+// Return the host CPUs that threads of 'thread_class' run on, or
+// empty if the server doesn't isolate thread classes.
+std::vector<int> ServerThreadClassCpus(
+    TRTSERVER_Server* server, TRTSERVER_Thread_Class thread_class);
+
+// Bind the calling thread to 'cpus'. Does nothing if 'cpus' is empty.
+TRTSERVER_Error* SetCurrentThreadCpus(const std::vector<int>& cpus);
+
 }}  // namespace nvidia::inferenceserver
@@ -26,21 +26,31 @@
 
 #include "src/servers/grpc_server.h"
 
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+#include <pthread.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <cstdint>
+#include <deque>
 #include <map>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <unordered_set>
 #include "grpc++/security/server_credentials.h"
 #include "grpc++/server.h"
 #include "grpc++/server_builder.h"
 #include "grpc++/server_context.h"
 #include "grpc++/support/status.h"
 #include "grpc/grpc.h"
+#include "grpcpp/impl/codegen/proto_buffer_reader.h"
 #include "src/core/constants.h"
+#include "src/core/nvtx.h"
 #include "src/core/trtserver.h"
 #include "src/servers/common.h"
+#include "src/servers/peer_forwarder.h"
 #include "src/servers/tracer.h"
 
 #ifdef TRTIS_ENABLE_TRACING
@@ -49,6 +59,182 @@
 
 namespace nvidia { namespace inferenceserver {
 
+//
+// RawInferRequest
+//
+// An InferRequest that is parsed directly from the received
+// grpc::ByteBuffer. Each raw_input is not copied out of the buffer
+// but is referenced in place as the one or more chunks of the
+// buffer's slices that hold it, so the buffer is kept alive until
+// the request is cleared.
+//
+class RawInferRequest {
+ public:
+  using Chunks = std::vector<std::pair<const char*, size_t>>;
+
+  RawInferRequest() : model_version_(0) {}
+  RawInferRequest(const RawInferRequest&) = delete;
+  RawInferRequest& operator=(const RawInferRequest&) = delete;
+
+  // Take ownership of 'buffer' and parse the InferRequest it
+  // holds. Return false if 'buffer' isn't a valid InferRequest.
+  bool Parse(grpc::ByteBuffer* buffer);
+
+  void Clear();
+
+  const std::string& model_name() const { return model_name_; }
+  int64_t model_version() const { return model_version_; }
+  const InferRequestHeader& meta_data() const { return meta_data_; }
+  int raw_input_size() const { return raw_inputs_.size(); }
+  const Chunks& raw_input(int idx) const { return raw_inputs_[idx]; }
+
+  // The received message, used to relay the request unchanged.
+  const grpc::ByteBuffer& buffer() const { return buffer_; }
+
+ private:
+  grpc::ByteBuffer buffer_;
+
+  // The reader holds the decompressed form of 'buffer_' if the
+  // message was compressed, so it must outlive the chunks.
+  std::unique_ptr<grpc::ProtoBufferReader> reader_;
+
+  std::string model_name_;
+  int64_t model_version_;
+  InferRequestHeader meta_data_;
+  std::vector<Chunks> raw_inputs_;
+};
+
+bool
+RawInferRequest::Parse(grpc::ByteBuffer* buffer)
+{
+  using google::protobuf::internal::WireFormatLite;
+
+  Clear();
+  buffer_.Swap(buffer);
+  reader_.reset(new grpc::ProtoBufferReader(&buffer_));
+  if (!reader_->status().ok()) {
+    return false;
+  }
+
+  // Field numbers and wire types must match InferRequest in
+  // grpc_service.proto.
+  google::protobuf::io::CodedInputStream stream(reader_.get());
+  while (true) {
+    const uint32_t tag = stream.ReadTag();
+    if (tag == 0) {
+      break;
+    }
+
+    const int field = WireFormatLite::GetTagFieldNumber(tag);
+    const WireFormatLite::WireType wire_type =
+        WireFormatLite::GetTagWireType(tag);
+    if ((field == 1) &&
+        (wire_type == WireFormatLite::WIRETYPE_LENGTH_DELIMITED)) {
+      uint32_t len;
+      if (!stream.ReadVarint32(&len) || !stream.ReadString(&model_name_, len)) {
+        return false;
+      }
+    } else if ((field == 2) && (wire_type == WireFormatLite::WIRETYPE_VARINT)) {
+      uint64_t version;
+      if (!stream.ReadVarint64(&version)) {
+        return false;
+      }
+      model_version_ = static_cast<int64_t>(version);
+    } else if (
+        (field == 3) &&
+        (wire_type == WireFormatLite::WIRETYPE_LENGTH_DELIMITED)) {
+      uint32_t len;
+      if (!stream.ReadVarint32(&len)) {
+        return false;
+      }
+      const auto limit = stream.PushLimit(len);
+      if (!meta_data_.MergePartialFromCodedStream(&stream) ||
+          !stream.ConsumedEntireMessage()) {
+        return false;
+      }
+      stream.PopLimit(limit);
+    } else if (
+        (field == 4) &&
+        (wire_type == WireFormatLite::WIRETYPE_LENGTH_DELIMITED)) {
+      uint32_t len;
+      if (!stream.ReadVarint32(&len)) {
+        return false;
+      }
+
+      // Reference the tensor data where it is, one chunk per slice it
+      // spans.
+      Chunks chunks;
+      while (len > 0) {
+        const void* data;
+        int size;
+        if (!stream.GetDirectBufferPointer(&data, &size)) {
+          return false;
+        }
+
+        const uint32_t chunk_size =
+            std::min(len, static_cast<uint32_t>(size));
+        chunks.emplace_back(reinterpret_cast<const char*>(data), chunk_size);
+        stream.Skip(chunk_size);
+        len -= chunk_size;
+      }
+
+      raw_inputs_.emplace_back(std::move(chunks));
+    } else if (!WireFormatLite::SkipField(&stream, tag)) {
+      return false;
+    }
+  }
+
+  return stream.ConsumedEntireMessage();
+}
+
+void
+RawInferRequest::Clear()
+{
+  raw_inputs_.clear();
+  meta_data_.Clear();
+  model_version_ = 0;
+  model_name_.clear();
+  reader_.reset();
+  buffer_.Clear();
+}
+
+}}  // namespace nvidia::inferenceserver
+
+namespace grpc {
+
+// Deserialize Infer requests received by
+// InferAsyncService::RequestRawInfer.
+template <>
+class SerializationTraits<nvidia::inferenceserver::RawInferRequest, void> {
+ public:
+  static Status Deserialize(
+      ByteBuffer* byte_buffer, nvidia::inferenceserver::RawInferRequest* msg)
+  {
+    if (!msg->Parse(byte_buffer)) {
+      return Status(StatusCode::INTERNAL, "failed to parse InferRequest");
+    }
+
+    return Status::OK;
+  }
+};
+
+}  // namespace grpc
+
+namespace nvidia { namespace inferenceserver {
+
+void
+InferAsyncService::RequestRawInfer(
+    grpc::ServerContext* context, RawInferRequest* request,
+    grpc::ServerAsyncResponseWriter<InferResponse>* response,
+    grpc::CompletionQueue* new_call_cq,
+    grpc::ServerCompletionQueue* notification_cq, void* tag)
+{
+  // Infer is the third method (index 2) of GRPCService in
+  // grpc_service.proto.
+  RequestAsyncUnary(
+      2, context, request, response, new_call_cq, notification_cq, tag);
+}
+
 namespace {
 
 //
@@ -81,6 +267,8 @@ class Barrier {
 
 // The step of processing that the state is in. Every state must
 // recognize START, COMPLETE and FINISH and the others are optional.
+// DONE is only used by the states that notify the handler that an
+// rpc is done, see Handler::NotifyWhenDone().
 typedef enum {
   START,
   COMPLETE,
@@ -88,7 +276,8 @@ typedef enum {
   ISSUED,
   READ,
   WRITEREADY,
-  WRITTEN
+  WRITTEN,
+  DONE
 } Steps;
 
 std::ostream&
@@ -116,6 +305,9 @@ operator<<(std::ostream& out, const Steps& step)
     case WRITTEN:
       out << "WRITTEN";
       break;
+    case DONE:
+      out << "DONE";
+      break;
   }
 
   return out;
@@ -128,17 +320,30 @@ operator<<(std::ostream& out, const Steps& step)
 // allocation. These are just pointers into a HandlerState
 // object. HandlerState lifetime is always longer than what is
 // required for allocation callback so HandlerState manages the
-// lifetime of the actual objects referenced by those pointers.
+// lifetime of the actual objects referenced by those pointers. The
+// exception is 'raw_output_pool_' which holds the raw output buffers
+// of earlier responses of the HandlerState so they can be reused.
 //
 struct AllocPayload {
   struct ShmInfo {
     void* base_;
     size_t byte_size_;
+    TRTSERVER_Memory_Type memory_type_;
   };
 
   using TensorShmMap = std::unordered_map<std::string, ShmInfo>;
 
-  explicit AllocPayload() : response_(nullptr), shm_map_(nullptr) {}
+  // A block of the output shared memory pool that an output was
+  // written to.
+  struct PoolBlock {
+    std::string shm_key_;
+    size_t byte_size_;
+  };
+
+  explicit AllocPayload()
+      : response_(nullptr), shm_map_(nullptr), smb_manager_(nullptr)
+  {
+  }
   ~AllocPayload()
   {
     // Don't delete 'response_'.. it is owned by the HandlerState
@@ -147,8 +352,95 @@ struct AllocPayload {
 
   InferResponse* response_;
   TensorShmMap* shm_map_;
+
+  // The outputs that asked to be returned in the server-owned output
+  // shared memory pool, and the pool block of each output that was.
+  SharedMemoryBlockManager* smb_manager_;
+  std::unordered_set<std::string> pool_outputs_;
+  std::unordered_map<std::string, PoolBlock> pool_blocks_;
+
+  // Buffers for raw outputs, indexed by output position. Reusing a
+  // buffer that is already at least the size of an output avoids
+  // both reallocating and zero-filling it.
+  std::vector<std::string> raw_output_pool_;
 };
 
+// Move the raw outputs of 'response' into 'pool' for reuse by later
+// responses, keeping the larger buffer for each output position.
+// Responses that don't have raw outputs have nothing to reuse.
+template <typename ResponseType>
+void
+ReclaimRawOutputs(ResponseType* response, std::vector<std::string>* pool)
+{
+}
+
+void
+ReclaimRawOutputs(InferResponse* response, std::vector<std::string>* pool)
+{
+  auto* raw_outputs = response->mutable_raw_output();
+  if (pool->size() < static_cast<size_t>(raw_outputs->size())) {
+    pool->resize(raw_outputs->size());
+  }
+
+  for (int i = 0; i < raw_outputs->size(); ++i) {
+    if (raw_outputs->Get(i).size() > (*pool)[i].size()) {
+      (*pool)[i].swap(*raw_outputs->Mutable(i));
+    }
+  }
+}
+
+// The request's compression algorithm isn't visible to the server
+// so a client that wants responses compressed with a specific
+// algorithm names it in the kResponseCompressionGRPCMetadata
+// metadata. Otherwise the server's default compression is used.
+void
+SetResponseCompression(grpc::ServerContext* ctx)
+{
+  const auto& metadata = ctx->client_metadata();
+  const auto itr = metadata.find(kResponseCompressionGRPCMetadata);
+  if (itr == metadata.end()) {
+    return;
+  }
+
+  const grpc::string_ref& algorithm = itr->second;
+  if (algorithm == "none") {
+    ctx->set_compression_algorithm(GRPC_COMPRESS_NONE);
+  } else if (algorithm == "deflate") {
+    ctx->set_compression_algorithm(GRPC_COMPRESS_DEFLATE);
+  } else if (algorithm == "gzip") {
+    ctx->set_compression_algorithm(GRPC_COMPRESS_GZIP);
+  }
+}
+
+// Serialize 'request_header' into 'serialized'. If the header doesn't
+// give a deadline the deadline of the call, if any, is used.
+bool
+SerializeRequestHeader(
+    const InferRequestHeader& request_header, const grpc::ServerContext& ctx,
+    std::string* serialized)
+{
+  const auto deadline = ctx.deadline();
+  if ((request_header.deadline_microseconds() != 0) ||
+      (deadline == std::chrono::system_clock::time_point::max())) {
+    return request_header.SerializeToString(serialized);
+  }
+
+  InferRequestHeader deadline_header(request_header);
+  deadline_header.set_deadline_microseconds(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          deadline.time_since_epoch())
+          .count());
+  return deadline_header.SerializeToString(serialized);
+}
+
+// The state pool of a handler is resized after this many states are
+// released. It never retains fewer than the low watermark of states
+// (or the pool size if smaller), and a released state whose retained
+// raw output buffers exceed the byte size limit has them freed.
+constexpr size_t kStatePoolWindowReleaseCount = 1024;
+constexpr size_t kStatePoolLowWatermark = 8;
+constexpr size_t kMaxStateRetainedByteSize = 16 * 1024 * 1024;
+
 //
 // HandlerState
 //
@@ -162,55 +454,92 @@ class HandlerState {
   // State that is shared across all state objects that make up a GRPC
   // transaction (e.g. a stream).
   struct Context {
-    explicit Context(const char* server_id, const uint64_t unique_id = 0)
-        : server_id_(server_id), unique_id_(unique_id), step_(Steps::START),
-          finish_ok_(true)
+    explicit Context(
+        const char* server_id, grpc::ServerCompletionQueue* cq,
+        const uint64_t unique_id = 0)
+        : server_id_(server_id), unique_id_(unique_id), cq_(cq),
+          step_(Steps::START), finish_ok_(true), ordered_(true),
+          partial_outputs_(false), cancelled_(false),
+          sequence_binding_(nullptr)
     {
       ctx_.reset(new grpc::ServerContext());
       responder_.reset(new ServerResponderType(ctx_.get()));
     }
 
+    // The context is destroyed once the stream is closed and all its
+    // requests are complete. Deleting the sequence binding then ends
+    // the stream's sequence if the client did not end it.
+    ~Context()
+    {
+      if (sequence_binding_ != nullptr) {
+        LOG_IF_ERR(
+            TRTSERVER_SequenceBindingDelete(sequence_binding_),
+            "deleting sequence binding");
+      }
+    }
+
     // Enqueue 'state' so that its response is delivered in the
     // correct order.
     void EnqueueForResponse(HandlerStateType* state)
     {
       std::unique_lock<std::mutex> lock(mu_);
-      states_.push(state);
+      states_.push_back(state);
+    }
+
+    // Enqueue 'state' immediately before 'before' so that its response
+    // is delivered ahead of the response of 'before'.
+    void EnqueueForResponseBefore(
+        HandlerStateType* state, HandlerStateType* before)
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      states_.insert(std::find(states_.begin(), states_.end(), before), state);
     }
 
-    // If the state at the front of the queue is ready for writing
-    // then return it, otherwise return nullptr.
+    // If a state is ready for writing and no other write is in
+    // progress then transition that state to WRITTEN and return it,
+    // otherwise return nullptr. When ordered only the state at the
+    // front of the queue can be written, otherwise the first state in
+    // the queue that is ready for writing is.
     HandlerStateType* ReadyResponse()
     {
       std::unique_lock<std::mutex> lock(mu_);
-      if (states_.empty()) {
-        return nullptr;
+      HandlerStateType* ready = nullptr;
+      for (HandlerStateType* state : states_) {
+        if (state->step_ == Steps::WRITTEN) {
+          return nullptr;
+        }
+        if ((ready == nullptr) && (state->step_ == Steps::WRITEREADY)) {
+          ready = state;
+        }
+        if (ordered_) {
+          break;
+        }
       }
 
-      HandlerStateType* state = states_.front();
-      if (state->step_ == Steps::WRITEREADY) {
-        return state;
+      if (ready != nullptr) {
+        ready->step_ = Steps::WRITTEN;
       }
 
-      return nullptr;
+      return ready;
     }
 
-    // If 'state' is at the front of the queue and written, pop it and
-    // return true. Other return false.
+    // If 'state' is the written state in the queue then remove it and
+    // return true. When ordered it must also be at the front of the
+    // queue. Otherwise return false.
     bool PopCompletedResponse(HandlerStateType* state)
     {
       std::unique_lock<std::mutex> lock(mu_);
-      if (states_.empty()) {
+      if (states_.empty() || (state->step_ != Steps::WRITTEN)) {
         return false;
       }
 
-      HandlerStateType* front = states_.front();
-      if ((front == state) && (state->step_ == Steps::WRITTEN)) {
-        states_.pop();
-        return true;
+      auto itr = std::find(states_.begin(), states_.end(), state);
+      if ((itr == states_.end()) || (ordered_ && (itr != states_.begin()))) {
+        return false;
       }
 
-      return false;
+      states_.erase(itr);
+      return true;
     }
 
     // Return true if this context has completed all reads and writes.
@@ -226,6 +555,11 @@ class HandlerState {
     // Unique ID for the context.
     const uint64_t unique_id_;
 
+    // The completion queue the rpc is bound to. The request that
+    // replaces this one is registered on the same queue so that each
+    // handler thread keeps its share of the waiting requests.
+    grpc::ServerCompletionQueue* const cq_;
+
     // Context for the rpc, allowing to tweak aspects of it such as
     // the use of compression, authentication, as well as to send
     // metadata back to the client.
@@ -237,7 +571,7 @@ class HandlerState {
     // orders. A state enters this queue when it has successfully read
     // a request and exits the queue when it is written.
     std::mutex mu_;
-    std::queue<HandlerStateType*> states_;
+    std::deque<HandlerStateType*> states_;
 
     // The step of the entire context.
     Steps step_;
@@ -245,6 +579,27 @@ class HandlerState {
     // True if this context should finish with OK status, false if
     // should finish with CANCELLED status.
     bool finish_ok_;
+
+    // True if responses must be written in the order the requests
+    // were read, false if they are written in the order they
+    // complete. Set for a stream by the client with the
+    // kStreamResponseOrderGRPCMetadata metadata.
+    bool ordered_;
+
+    // True if outputs that complete before their request are returned
+    // in partial responses ahead of the request's response. Set for a
+    // stream by the client with the kStreamPartialOutputsGRPCMetadata
+    // metadata.
+    bool partial_outputs_;
+
+    // True if the client cancelled the rpc, for example by
+    // disconnecting, and so its inference requests are cancelled.
+    std::atomic<bool> cancelled_;
+
+    // The binding of a stream to the sequence it is sending, so that
+    // the requests of the sequence after its START go directly to the
+    // sequence's batch slot. Created by stream handlers.
+    TRTSERVER_SequenceBinding* sequence_binding_;
   };
 
   explicit HandlerState(
@@ -259,6 +614,8 @@ class HandlerState {
     context_ = context;
     unique_id_ = RequestStatusUtil::NextUniqueRequestId();
     step_ = start_step;
+    forwarder_ = nullptr;
+    partial_state_fn_ = nullptr;
     request_.Clear();
     response_.Clear();
   }
@@ -266,10 +623,30 @@ class HandlerState {
   void Release()
   {
     context_ = nullptr;
+    partial_state_fn_ = nullptr;
     request_.Clear();
+    ReclaimRawOutputs(&response_, &alloc_payload_.raw_output_pool_);
     response_.Clear();
   }
 
+  // Return the byte size of the raw output buffers retained for
+  // reuse by this state.
+  size_t RetainedByteSize() const
+  {
+    size_t byte_size = RetainedByteSize(alloc_payload_);
+    for (const auto& payload : batch_alloc_payloads_) {
+      byte_size += RetainedByteSize(*payload);
+    }
+    return byte_size;
+  }
+
+  // Free the raw output buffers retained for reuse by this state.
+  void TrimRetained()
+  {
+    std::vector<std::string>().swap(alloc_payload_.raw_output_pool_);
+    batch_alloc_payloads_.clear();
+  }
+
   std::shared_ptr<Context> context_;
 
   uint64_t unique_id_;
@@ -285,6 +662,32 @@ class HandlerState {
   // For inference requests the allocator payload, unused for other
   // requests.
   AllocPayload alloc_payload_;
+
+  // For batch inference requests the allocator payload for each
+  // request in the batch and the number of those requests that have
+  // not yet completed. Unused for other requests.
+  std::vector<std::unique_ptr<AllocPayload>> batch_alloc_payloads_;
+  std::atomic<int> batch_pending_cnt_;
+
+  // For inference requests the forwarder that relays the request to
+  // a peer if it can't be served locally, nullptr if the request
+  // must not be forwarded. Unused for other requests.
+  PeerForwarder* forwarder_;
+
+  // For stream inference requests that return partial responses, the
+  // function that creates the state holding a partial response.
+  // Unused for other requests.
+  std::function<HandlerStateType*()> partial_state_fn_;
+
+ private:
+  static size_t RetainedByteSize(const AllocPayload& payload)
+  {
+    size_t byte_size = 0;
+    for (const auto& buffer : payload.raw_output_pool_) {
+      byte_size += buffer.capacity();
+    }
+    return byte_size;
+  }
 };
 
 //
@@ -298,14 +701,17 @@ class Handler : public GRPCServer::HandlerBase {
   Handler(
       const std::string& name,
       const std::shared_ptr<TRTSERVER_Server>& trtserver, const char* server_id,
-      ServiceType* service, grpc::ServerCompletionQueue* cq,
+      ServiceType* service,
+      const std::vector<grpc::ServerCompletionQueue*>& cqs,
       size_t max_state_bucket_count);
   virtual ~Handler();
 
   // Descriptive name of of the handler.
   const std::string& Name() const { return name_; }
 
-  // Start handling requests using 'thread_cnt' threads.
+  // Start handling requests using 'thread_cnt' threads. The threads
+  // are spread across the completion queues, each thread waiting on
+  // only one of them.
   void Start(int thread_cnt);
 
   // Stop handling requests.
@@ -324,10 +730,16 @@ class Handler : public GRPCServer::HandlerBase {
     {
       std::unique_lock<std::mutex> lock(alloc_mu_);
 
+      in_use_cnt_++;
+      window_peak_cnt_ = std::max(window_peak_cnt_, in_use_cnt_);
+
       if (!state_bucket_.empty()) {
         state = state_bucket_.back();
         state->Reset(context, start_step);
         state_bucket_.pop_back();
+        pool_hit_cnt_++;
+      } else {
+        pool_miss_cnt_++;
       }
     }
 
@@ -342,15 +754,75 @@ class Handler : public GRPCServer::HandlerBase {
   {
     std::unique_lock<std::mutex> lock(alloc_mu_);
 
+    in_use_cnt_--;
+
     state->Release();
-    if (state_bucket_.size() < max_state_bucket_count_) {
+    if (state->RetainedByteSize() > kMaxStateRetainedByteSize) {
+      state->TrimRetained();
+      pool_trim_cnt_++;
+    }
+
+    // Keep as many states as were in use at the peak of the current
+    // window, so a burst keeps the states it needs, but never more
+    // than the high watermark.
+    const size_t limit = std::min(
+        max_state_bucket_count_, std::max(retain_cnt_, window_peak_cnt_));
+    if (state_bucket_.size() < limit) {
       state_bucket_.push_back(state);
     } else {
       delete state;
     }
+
+    if (++window_release_cnt_ >= kStatePoolWindowReleaseCount) {
+      AdjustStatePool();
+    }
   }
 
-  virtual void StartNewRequest() = 0;
+  // At the end of each window set the number of states to retain to
+  // the peak in-use count of the window, bounded by the watermarks,
+  // and free any states beyond that. Must be called with 'alloc_mu_'
+  // held.
+  void AdjustStatePool()
+  {
+    const size_t retain_cnt = std::max(
+        min_state_bucket_count_,
+        std::min(max_state_bucket_count_, window_peak_cnt_));
+    if (retain_cnt != retain_cnt_) {
+      LOG_VERBOSE(1) << Name() << " state pool retains " << retain_cnt
+                     << " states (was " << retain_cnt_ << "), hits "
+                     << pool_hit_cnt_ << ", misses " << pool_miss_cnt_
+                     << ", trims " << pool_trim_cnt_;
+      retain_cnt_ = retain_cnt;
+    }
+
+    while (state_bucket_.size() > retain_cnt_) {
+      delete state_bucket_.back();
+      state_bucket_.pop_back();
+    }
+
+    window_release_cnt_ = 0;
+    window_peak_cnt_ = in_use_cnt_;
+  }
+
+  // Register to be notified when the rpc of 'context' is done, so
+  // that the inference requests of an rpc cancelled by the client are
+  // cancelled as well. Must be called before the rpc is requested.
+  void NotifyWhenDone(const std::shared_ptr<StateContext>& context)
+  {
+    State* state = StateNew(context, Steps::DONE);
+    context->ctx_->AsyncNotifyWhenDone(state);
+  }
+
+  // Return true if the rpc of 'userp', the state of an inference
+  // request, has been cancelled. The cancellation function of the
+  // inference requests issued by the handler.
+  static bool IsCancelled(void* userp)
+  {
+    return reinterpret_cast<State*>(userp)->context_->cancelled_;
+  }
+
+  // Register to receive a new request on completion queue 'cq'.
+  virtual void StartNewRequest(grpc::ServerCompletionQueue* cq) = 0;
   virtual bool Process(State* state, bool rpc_ok) = 0;
 
   const std::string name_;
@@ -358,16 +830,30 @@ class Handler : public GRPCServer::HandlerBase {
   const char* const server_id_;
 
   ServiceType* service_;
-  grpc::ServerCompletionQueue* cq_;
+  std::vector<grpc::ServerCompletionQueue*> cqs_;
   std::vector<std::unique_ptr<std::thread>> threads_;
 
   // Mutex to serialize State allocation
   std::mutex alloc_mu_;
 
   // Keep some number of state objects for reuse to avoid the overhead
-  // of creating a state for every new request.
+  // of creating a state for every new request. The number retained
+  // adapts to the recent peak number of states in use, between the
+  // low and high watermarks.
   const size_t max_state_bucket_count_;
+  const size_t min_state_bucket_count_;
   std::vector<State*> state_bucket_;
+  size_t retain_cnt_;
+  size_t in_use_cnt_;
+  size_t window_peak_cnt_;
+  size_t window_release_cnt_;
+
+  // Counts of states taken from the pool, states that had to be
+  // allocated because the pool was empty, and states whose retained
+  // buffers were freed because they were too large.
+  uint64_t pool_hit_cnt_;
+  uint64_t pool_miss_cnt_;
+  uint64_t pool_trim_cnt_;
 };
 
 template <
@@ -376,10 +862,16 @@ template <
 Handler<ServiceType, ServerResponderType, RequestType, ResponseType>::Handler(
     const std::string& name, const std::shared_ptr<TRTSERVER_Server>& trtserver,
     const char* server_id, ServiceType* service,
-    grpc::ServerCompletionQueue* cq, size_t max_state_bucket_count)
+    const std::vector<grpc::ServerCompletionQueue*>& cqs,
+    size_t max_state_bucket_count)
     : name_(name), trtserver_(trtserver), server_id_(server_id),
-      service_(service), cq_(cq),
-      max_state_bucket_count_(max_state_bucket_count)
+      service_(service), cqs_(cqs),
+      max_state_bucket_count_(max_state_bucket_count),
+      min_state_bucket_count_(
+          std::min(max_state_bucket_count, kStatePoolLowWatermark)),
+      retain_cnt_(min_state_bucket_count_), in_use_cnt_(0),
+      window_peak_cnt_(0), window_release_cnt_(0), pool_hit_cnt_(0),
+      pool_miss_cnt_(0), pool_trim_cnt_(0)
 {
 }
 
@@ -407,17 +899,30 @@ Handler<ServiceType, ServerResponderType, RequestType, ResponseType>::Start(
   // started.
   auto barrier = std::make_shared<Barrier>(thread_cnt + 1);
 
+  const std::vector<int> cpus =
+      ServerThreadClassCpus(trtserver_.get(), TRTSERVER_THREAD_CLASS_FRONTEND);
+
   for (int t = 0; t < thread_cnt; ++t) {
-    threads_.emplace_back(new std::thread([this, barrier] {
-      StartNewRequest();
+    grpc::ServerCompletionQueue* cq = cqs_[t % cqs_.size()];
+    threads_.emplace_back(new std::thread([this, barrier, cq, cpus] {
+      // The thread name groups the CPU time of the GRPC threads in
+      // the metrics.
+      pthread_setname_np(pthread_self(), "trtis-grpc");
+      LOG_IF_ERR(SetCurrentThreadCpus(cpus), "failed to pin GRPC thread");
+      StartNewRequest(cq);
       barrier->Wait();
 
       void* tag;
       bool ok;
 
-      while (cq_->Next(&tag, &ok)) {
+      while (cq->Next(&tag, &ok)) {
         State* state = static_cast<State*>(tag);
-        if (!Process(state, ok)) {
+        if (state->step_ == Steps::DONE) {
+          // IsCancelled() is only valid once the notification that
+          // the rpc is done has been delivered.
+          state->context_->cancelled_ = state->context_->ctx_->IsCancelled();
+          StateRelease(state);
+        } else if (!Process(state, ok)) {
           LOG_VERBOSE(1) << "Done for " << Name() << ", " << state->unique_id_;
           StateRelease(state);
         }
@@ -439,7 +944,9 @@ Handler<ServiceType, ServerResponderType, RequestType, ResponseType>::Stop()
     thread->join();
   }
 
-  LOG_VERBOSE(1) << "Threads exited for " << Name();
+  LOG_VERBOSE(1) << "Threads exited for " << Name() << ", state pool hits "
+                 << pool_hit_cnt_ << ", misses " << pool_miss_cnt_
+                 << ", trims " << pool_trim_cnt_;
 }
 
 //
@@ -455,23 +962,24 @@ class HealthHandler : public Handler<
       const std::shared_ptr<TRTSERVER_Server>& trtserver, const char* server_id,
       GRPCService::AsyncService* service, grpc::ServerCompletionQueue* cq,
       size_t max_state_bucket_count)
-      : Handler(name, trtserver, server_id, service, cq, max_state_bucket_count)
+      : Handler(
+            name, trtserver, server_id, service, {cq}, max_state_bucket_count)
   {
   }
 
  protected:
-  void StartNewRequest() override;
+  void StartNewRequest(grpc::ServerCompletionQueue* cq) override;
   bool Process(State* state, bool rpc_ok) override;
 };
 
 void
-HealthHandler::StartNewRequest()
+HealthHandler::StartNewRequest(grpc::ServerCompletionQueue* cq)
 {
-  auto context = std::make_shared<State::Context>(server_id_);
+  auto context = std::make_shared<State::Context>(server_id_, cq);
   State* state = StateNew(context);
   service_->RequestHealth(
       state->context_->ctx_.get(), &state->request_,
-      state->context_->responder_.get(), cq_, cq_, state);
+      state->context_->responder_.get(), cq, cq, state);
 
   LOG_VERBOSE(1) << "New request handler for " << Name() << ", "
                  << state->unique_id_;
@@ -526,7 +1034,7 @@ HealthHandler::Process(Handler::State* state, bool rpc_ok)
   // request cause too much load on server), so register for next
   // request only after this one finished.
   if (!shutdown && (state->step_ == Steps::FINISH)) {
-    StartNewRequest();
+    StartNewRequest(state->context_->cq_);
   }
 
   return state->step_ != Steps::FINISH;
@@ -545,23 +1053,24 @@ class StatusHandler : public Handler<
       const std::shared_ptr<TRTSERVER_Server>& trtserver, const char* server_id,
       GRPCService::AsyncService* service, grpc::ServerCompletionQueue* cq,
       size_t max_state_bucket_count)
-      : Handler(name, trtserver, server_id, service, cq, max_state_bucket_count)
+      : Handler(
+            name, trtserver, server_id, service, {cq}, max_state_bucket_count)
   {
   }
 
  protected:
-  void StartNewRequest() override;
+  void StartNewRequest(grpc::ServerCompletionQueue* cq) override;
   bool Process(State* state, bool rpc_ok) override;
 };
 
 void
-StatusHandler::StartNewRequest()
+StatusHandler::StartNewRequest(grpc::ServerCompletionQueue* cq)
 {
-  auto context = std::make_shared<State::Context>(server_id_);
+  auto context = std::make_shared<State::Context>(server_id_, cq);
   State* state = StateNew(context);
   service_->RequestStatus(
       state->context_->ctx_.get(), &state->request_,
-      state->context_->responder_.get(), cq_, cq_, state);
+      state->context_->responder_.get(), cq, cq, state);
 
   LOG_VERBOSE(1) << "New request handler for " << Name() << ", "
                  << state->unique_id_;
@@ -589,7 +1098,9 @@ StatusHandler::Process(Handler::State* state, bool rpc_ok)
     TRTSERVER_Protobuf* server_status_protobuf = nullptr;
     TRTSERVER_Error* err =
         (request.model_name().empty())
-            ? TRTSERVER_ServerStatus(trtserver_.get(), &server_status_protobuf)
+            ? TRTSERVER_ServerStatusSince(
+                  trtserver_.get(), request.since_generation(),
+                  &server_status_protobuf)
             : TRTSERVER_ServerModelStatus(
                   trtserver_.get(), request.model_name().c_str(),
                   &server_status_protobuf);
@@ -624,7 +1135,7 @@ StatusHandler::Process(Handler::State* state, bool rpc_ok)
   // request cause too much load on server), so register for next
   // request only after this one finished.
   if (!shutdown && (state->step_ == Steps::FINISH)) {
-    StartNewRequest();
+    StartNewRequest(state->context_->cq_);
   }
 
   return state->step_ != Steps::FINISH;
@@ -646,12 +1157,24 @@ InferResponseAlloc(
   *buffer = nullptr;
   *buffer_userp = nullptr;
 
-  // Can't allocate for any memory type other than CPU. If byte size is 0,
+  // Outputs in shared memory can only be written to the memory type
+  // of the shared memory block. All other outputs are written into
+  // the response protobuf and so can only be CPU. If byte size is 0,
   // proceed regardless of memory type as no allocation is required.
-  if ((memory_type != TRTSERVER_MEMORY_CPU) && (byte_size != 0)) {
-    LOG_VERBOSE(1) << "GRPC allocation failed for type " << memory_type
-                   << " for " << tensor_name;
-    return nullptr;
+  if (byte_size != 0) {
+    TRTSERVER_Memory_Type out_memory_type = TRTSERVER_MEMORY_CPU;
+    if (shm_map != nullptr) {
+      const auto& pr = shm_map->find(tensor_name);
+      if (pr != shm_map->end()) {
+        out_memory_type = pr->second.memory_type_;
+      }
+    }
+
+    if (memory_type != out_memory_type) {
+      LOG_VERBOSE(1) << "GRPC allocation failed for type " << memory_type
+                     << " for " << tensor_name;
+      return nullptr;
+    }
   }
 
   // Called once for each result tensor in the inference request. Must
@@ -686,7 +1209,33 @@ InferResponseAlloc(
       }
     }
 
+    // An output that asked for the server-owned output pool is
+    // written to a pool block when the pool has space for it.
+    if (!use_shm && (payload->pool_outputs_.find(tensor_name) !=
+                     payload->pool_outputs_.end())) {
+      std::string shm_key;
+      RETURN_IF_ERR(payload->smb_manager_->AllocateOutputBlock(
+          &shm_key, buffer, byte_size));
+      if (*buffer != nullptr) {
+        payload->pool_blocks_.emplace(
+            tensor_name, AllocPayload::PoolBlock{shm_key, byte_size});
+        use_shm = true;
+
+        LOG_VERBOSE(1) << "GRPC output pool: " << tensor_name << ", size "
+                       << byte_size << ", block " << shm_key;
+      }
+    }
+
     if (!use_shm) {
+      // Use the buffer for this output position from an earlier
+      // response if it is large enough. Shrinking it to 'byte_size'
+      // keeps its capacity and doesn't touch the contents.
+      const size_t idx = response->raw_output_size() - 1;
+      if ((idx < payload->raw_output_pool_.size()) &&
+          (payload->raw_output_pool_[idx].size() >= byte_size)) {
+        raw_output->swap(payload->raw_output_pool_[idx]);
+      }
+
       raw_output->resize(byte_size);
       *buffer = static_cast<void*>(&((*raw_output)[0]));
 
@@ -722,6 +1271,9 @@ InferAllocatorPayload(
   if (alloc_payload->shm_map_ != nullptr) {
     alloc_payload->shm_map_->clear();
   }
+  alloc_payload->smb_manager_ = smb_manager.get();
+  alloc_payload->pool_outputs_.clear();
+  alloc_payload->pool_blocks_.clear();
 
   // If any of the outputs use shared memory, then we must calculate
   // the memory address for that output and store it in the allocator
@@ -737,39 +1289,108 @@ InferAllocatorPayload(
           trtserver.get(), smb, io.shared_memory().offset(),
           io.shared_memory().byte_size(), &base));
 
+      TRTSERVER_Memory_Type memory_type;
+      int64_t memory_type_id;
+      RETURN_IF_ERR(TRTSERVER_SharedMemoryBlockMemoryType(
+          smb, &memory_type, &memory_type_id));
+
       if (alloc_payload->shm_map_ == nullptr) {
         alloc_payload->shm_map_ = new AllocPayload::TensorShmMap;
       }
 
       alloc_payload->shm_map_->emplace(
-          io.name(),
-          AllocPayload::ShmInfo{base, io.shared_memory().byte_size()});
+          io.name(), AllocPayload::ShmInfo{
+                         base, io.shared_memory().byte_size(), memory_type});
+    } else if (io.server_shared_memory()) {
+      alloc_payload->pool_outputs_.insert(io.name());
     }
   }
 
   return nullptr;  // Success
 }
 
+// Describe in 'response_header' the outputs that were written to
+// blocks of the output shared memory pool. If the inference failed
+// the client never learns of the blocks so they are returned to the
+// pool instead.
+void
+FinalizePoolOutputs(
+    AllocPayload* alloc_payload, InferResponseHeader* response_header,
+    const bool success)
+{
+  if (alloc_payload->pool_blocks_.empty()) {
+    return;
+  }
+
+  if (success) {
+    for (auto& output : *response_header->mutable_output()) {
+      const auto itr = alloc_payload->pool_blocks_.find(output.name());
+      if (itr != alloc_payload->pool_blocks_.end()) {
+        InferSharedMemory* shm = output.mutable_server_shared_memory();
+        shm->set_name(itr->second.shm_key_);
+        shm->set_offset(0);
+        shm->set_byte_size(itr->second.byte_size_);
+        alloc_payload->pool_blocks_.erase(itr);
+      }
+    }
+  }
+
+  // Any block not described in the response can't be released by
+  // the client.
+  for (const auto& pr : alloc_payload->pool_blocks_) {
+    LOG_IF_ERR(
+        alloc_payload->smb_manager_->ReleaseOutputBlock(pr.second.shm_key_),
+        "releasing output shared memory block");
+  }
+  alloc_payload->pool_blocks_.clear();
+}
+
+// Get the chunks of data that make up raw input 'idx' of 'request'.
+void
+RawInputChunks(
+    const InferRequest& request, const size_t idx,
+    RawInferRequest::Chunks* chunks)
+{
+  const std::string& raw = request.raw_input(idx);
+  chunks->emplace_back(raw.c_str(), raw.size());
+}
+
+void
+RawInputChunks(
+    const RawInferRequest& request, const size_t idx,
+    RawInferRequest::Chunks* chunks)
+{
+  *chunks = request.raw_input(idx);
+}
+
+template <typename RequestType>
 TRTSERVER_Error*
 InferGRPCToInput(
     const std::shared_ptr<TRTSERVER_Server>& trtserver,
     const std::shared_ptr<SharedMemoryBlockManager>& smb_manager,
-    const InferRequestHeader& request_header, const InferRequest& request,
+    const InferRequestHeader& request_header, const RequestType& request,
     TRTSERVER_InferenceRequestProvider* request_provider)
 {
   // Verify that the batch-byte-size of each input matches the size of
   // the provided tensor data (provided raw or from shared memory)
   size_t idx = 0;
+  RawInferRequest::Chunks chunks;
   for (const auto& io : request_header.input()) {
-    const void* base;
-    size_t byte_size;
+    chunks.clear();
+    size_t byte_size = 0;
+    TRTSERVER_Memory_Type memory_type = TRTSERVER_MEMORY_CPU;
     if (io.has_shared_memory()) {
+      const void* base;
       TRTSERVER_SharedMemoryBlock* smb = nullptr;
       RETURN_IF_ERR(smb_manager->Get(&smb, io.shared_memory().name()));
       RETURN_IF_ERR(TRTSERVER_ServerSharedMemoryAddress(
           trtserver.get(), smb, io.shared_memory().offset(),
           io.shared_memory().byte_size(), const_cast<void**>(&base)));
+      int64_t memory_type_id;
+      RETURN_IF_ERR(TRTSERVER_SharedMemoryBlockMemoryType(
+          smb, &memory_type, &memory_type_id));
       byte_size = io.shared_memory().byte_size();
+      chunks.emplace_back(reinterpret_cast<const char*>(base), byte_size);
     } else if ((int)idx >= request.raw_input_size()) {
       return TRTSERVER_ErrorNew(
           TRTSERVER_ERROR_INVALID_ARG,
@@ -780,9 +1401,10 @@ InferGRPCToInput(
               " sets of data for model '" + request.model_name() + "'")
               .c_str());
     } else {
-      const std::string& raw = request.raw_input(idx++);
-      base = raw.c_str();
-      byte_size = raw.size();
+      RawInputChunks(request, idx++, &chunks);
+      for (const auto& chunk : chunks) {
+        byte_size += chunk.second;
+      }
     }
 
     uint64_t expected_byte_size = 0;
@@ -799,9 +1421,13 @@ InferGRPCToInput(
               .c_str());
     }
 
-    RETURN_IF_ERR(TRTSERVER_InferenceRequestProviderSetInputData(
-        request_provider, io.name().c_str(), base, byte_size,
-        TRTSERVER_MEMORY_CPU));
+    // An input that spans several chunks is provided as several
+    // buffers, which the request provider appends together.
+    for (const auto& chunk : chunks) {
+      RETURN_IF_ERR(TRTSERVER_InferenceRequestProviderSetInputData(
+          request_provider, io.name().c_str(), chunk.first, chunk.second,
+          memory_type));
+    }
   }
 
   return nullptr;  // success
@@ -811,20 +1437,22 @@ InferGRPCToInput(
 // InferHandler
 //
 class InferHandler : public Handler<
-                         GRPCService::AsyncService,
+                         InferAsyncService,
                          grpc::ServerAsyncResponseWriter<InferResponse>,
-                         InferRequest, InferResponse> {
+                         RawInferRequest, InferResponse> {
  public:
   InferHandler(
       const std::string& name,
       const std::shared_ptr<TRTSERVER_Server>& trtserver, const char* server_id,
       const std::shared_ptr<TraceManager>& trace_manager,
       const std::shared_ptr<SharedMemoryBlockManager>& smb_manager,
-      GRPCService::AsyncService* service, grpc::ServerCompletionQueue* cq,
+      PeerForwarder* forwarder, InferAsyncService* service,
+      const std::vector<grpc::ServerCompletionQueue*>& cqs,
       size_t max_state_bucket_count)
       : Handler(
-            name, trtserver, server_id, service, cq, max_state_bucket_count),
-        trace_manager_(trace_manager), smb_manager_(smb_manager)
+            name, trtserver, server_id, service, cqs, max_state_bucket_count),
+        trace_manager_(trace_manager), smb_manager_(smb_manager),
+        forwarder_(forwarder)
   {
     // Create the allocator that will be used to allocate buffers for
     // the result tensors.
@@ -835,7 +1463,7 @@ class InferHandler : public Handler<
   }
 
  protected:
-  void StartNewRequest() override;
+  void StartNewRequest(grpc::ServerCompletionQueue* cq) override;
   bool Process(State* state, bool rpc_ok) override;
 
  private:
@@ -843,15 +1471,96 @@ class InferHandler : public Handler<
       TRTSERVER_Server* server, TRTSERVER_Trace* trace,
       TRTSERVER_InferenceResponse* response, void* userp);
 
+  // Return the forwarder to use for the request of 'state', nullptr
+  // if the request must not be forwarded.
+  PeerForwarder* RequestForwarder(const State* state) const;
+
+  // If the request of 'state' failed locally with 'err' because the
+  // model isn't available then forward it to a peer and return
+  // true. The forwarded request completes 'state' and takes
+  // ownership of 'err'. Otherwise return false.
+  static bool ForwardRequest(State* state, TRTSERVER_Error* err);
+
   std::shared_ptr<TraceManager> trace_manager_;
   std::shared_ptr<SharedMemoryBlockManager> smb_manager_;
+  PeerForwarder* forwarder_;
   TRTSERVER_ResponseAllocator* allocator_;
 };
 
+PeerForwarder*
+InferHandler::RequestForwarder(const State* state) const
+{
+  // A request forwarded by a peer is not forwarded again so requests
+  // can't circulate between peers. Shared memory is local to this
+  // server so a request that uses it can't be served by a peer.
+  if ((forwarder_ == nullptr) ||
+      PeerForwarder::IsForwarded(*state->context_->ctx_)) {
+    return nullptr;
+  }
+
+  const InferRequestHeader& header = state->request_.meta_data();
+  for (const auto& io : header.input()) {
+    if (io.has_shared_memory()) {
+      return nullptr;
+    }
+  }
+  for (const auto& io : header.output()) {
+    if (io.has_shared_memory() || io.server_shared_memory()) {
+      return nullptr;
+    }
+  }
+
+  return forwarder_;
+}
+
+bool
+InferHandler::ForwardRequest(State* state, TRTSERVER_Error* err)
+{
+  // The model is unknown or not ready, or its queue is full.
+  if ((state->forwarder_ == nullptr) ||
+      ((TRTSERVER_ErrorCode(err) != TRTSERVER_ERROR_UNAVAILABLE) &&
+       (TRTSERVER_ErrorCode(err) != TRTSERVER_ERROR_NOT_FOUND))) {
+    return false;
+  }
+
+  LOG_VERBOSE(1) << "Forwarding request " << state->unique_id_
+                 << ": " << TRTSERVER_ErrorMessage(err);
+
+  state->step_ = ISSUED;
+  state->forwarder_->Forward(
+      state->request_.model_name(), state->request_.buffer(),
+      *state->context_->ctx_, &state->response_, [state, err](bool forwarded) {
+        // If no peer served the request then respond with the local
+        // error.
+        InferResponse& response = state->response_;
+        if (!forwarded) {
+          RequestStatusUtil::Create(
+              response.mutable_request_status(), err, state->unique_id_,
+              state->context_->server_id_);
+          response.mutable_meta_data()->set_id(
+              state->request_.meta_data().id());
+        }
+        TRTSERVER_ErrorDelete(err);
+
+#ifdef TRTIS_ENABLE_TRACING
+        if (state->tracer_ != nullptr) {
+          state->tracer_->CaptureTimestamp(
+              TRTSERVER_TRACE_LEVEL_MIN, "grpc send start");
+        }
+#endif  // TRTIS_ENABLE_TRACING
+
+        state->step_ = COMPLETE;
+        state->context_->responder_->Finish(response, grpc::Status::OK, state);
+      });
+
+  return true;
+}
+
 void
-InferHandler::StartNewRequest()
+InferHandler::StartNewRequest(grpc::ServerCompletionQueue* cq)
 {
-  auto context = std::make_shared<State::Context>(server_id_);
+  auto context = std::make_shared<State::Context>(server_id_, cq);
+  NotifyWhenDone(context);
   State* state = StateNew(context);
 
 #ifdef TRTIS_ENABLE_TRACING
@@ -864,9 +1573,9 @@ InferHandler::StartNewRequest()
   }
 #endif  // TRTIS_ENABLE_TRACING
 
-  service_->RequestInfer(
+  service_->RequestRawInfer(
       state->context_->ctx_.get(), &state->request_,
-      state->context_->responder_.get(), cq_, cq_, state);
+      state->context_->responder_.get(), cq, cq, state);
 
   LOG_VERBOSE(1) << "New request handler for " << Name() << ", "
                  << state->unique_id_;
@@ -875,6 +1584,8 @@ InferHandler::StartNewRequest()
 bool
 InferHandler::Process(Handler::State* state, bool rpc_ok)
 {
+  NVTX_RANGE(nvtx_, "GRPC infer");
+
   LOG_VERBOSE(1) << "Process for " << Name() << ", rpc_ok=" << rpc_ok << ", "
                  << state->unique_id_ << " step " << state->step_;
 
@@ -893,7 +1604,7 @@ InferHandler::Process(Handler::State* state, bool rpc_ok)
     finished = true;
   }
 
-  const InferRequest& request = state->request_;
+  const RawInferRequest& request = state->request_;
   InferResponse& response = state->response_;
 
   if (state->step_ == Steps::START) {
@@ -907,13 +1618,18 @@ InferHandler::Process(Handler::State* state, bool rpc_ok)
 
     // Start a new request to replace this one...
     if (!shutdown) {
-      StartNewRequest();
+      StartNewRequest(state->context_->cq_);
     }
 
+    SetResponseCompression(state->context_->ctx_.get());
+    state->forwarder_ = RequestForwarder(state);
+
     TRTSERVER_Error* err = nullptr;
 
     std::string request_header_serialized;
-    if (!request.meta_data().SerializeToString(&request_header_serialized)) {
+    if (!SerializeRequestHeader(
+            request.meta_data(), *state->context_->ctx_,
+            &request_header_serialized)) {
       err = TRTSERVER_ErrorNew(
           TRTSERVER_ERROR_UNKNOWN, "failed to serialize request header");
     } else {
@@ -943,10 +1659,14 @@ InferHandler::Process(Handler::State* state, bool rpc_ok)
 #endif  // TRTIS_ENABLE_TRACING
 
             state->step_ = ISSUED;
-            err = TRTSERVER_ServerInferAsync(
-                trtserver_.get(), trace, request_provider, allocator_,
-                &state->alloc_payload_ /* response_allocator_userp */,
-                InferComplete, reinterpret_cast<void*>(state));
+            err = TRTSERVER_InferenceRequestProviderSetCancelledFn(
+                request_provider, IsCancelled, reinterpret_cast<void*>(state));
+            if (err == nullptr) {
+              err = TRTSERVER_ServerInferAsync(
+                  trtserver_.get(), trace, request_provider, allocator_,
+                  &state->alloc_payload_ /* response_allocator_userp */,
+                  InferComplete, reinterpret_cast<void*>(state));
+            }
 
             // The request provider can be deleted immediately after the
             // ServerInferAsync call returns.
@@ -958,7 +1678,13 @@ InferHandler::Process(Handler::State* state, bool rpc_ok)
 
     // If not error then state->step_ == ISSUED and inference request
     // has initiated... completion callback will transition to
-    // COMPLETE. If error go immediately to COMPLETE.
+    // COMPLETE. If the model isn't available the request may be
+    // forwarded to a peer, which also transitions to COMPLETE when
+    // done. Otherwise if error go immediately to COMPLETE.
+    if ((err != nullptr) && ForwardRequest(state, err)) {
+      err = nullptr;
+    }
+
     if (err != nullptr) {
       RequestStatusUtil::Create(
           response.mutable_request_status(), err, state->unique_id_,
@@ -972,6 +1698,12 @@ InferHandler::Process(Handler::State* state, bool rpc_ok)
       response.mutable_meta_data()->Clear();
       response.mutable_raw_output()->Clear();
 
+#ifdef TRTIS_ENABLE_TRACING
+      if (state->tracer_ != nullptr) {
+        state->tracer_->SetFailed();
+      }
+#endif  // TRTIS_ENABLE_TRACING
+
       response.mutable_meta_data()->set_id(request.meta_data().id());
 
 #ifdef TRTIS_ENABLE_TRACING
@@ -1009,11 +1741,21 @@ InferHandler::InferComplete(
   LOG_VERBOSE(1) << "InferHandler::InferComplete, " << state->unique_id_
                  << " step " << state->step_;
 
-  const InferRequest& request = state->request_;
+  const RawInferRequest& request = state->request_;
   InferResponse& response = state->response_;
 
   TRTSERVER_Error* response_status =
       TRTSERVER_InferenceResponseStatus(trtserver_response);
+
+  // A request rejected because the model's queue is full may be
+  // served by a peer instead.
+  if ((response_status != nullptr) && ForwardRequest(state, response_status)) {
+    LOG_IF_ERR(
+        TRTSERVER_InferenceResponseDelete(trtserver_response),
+        "deleting GRPC response");
+    return;
+  }
+
   if ((response_status == nullptr) && (response.ByteSizeLong() > INT_MAX)) {
     response_status = TRTSERVER_ErrorNew(
         TRTSERVER_ERROR_INVALID_ARG,
@@ -1045,11 +1787,20 @@ InferHandler::InferComplete(
     }
   }
 
+  FinalizePoolOutputs(
+      &state->alloc_payload_, response.mutable_meta_data(),
+      (response_status == nullptr));
+
   // If the response is an error then clear the meta-data and raw
   // output as they may be partially initialized or uninitialized.
   if (response_status != nullptr) {
     response.mutable_meta_data()->Clear();
     response.mutable_raw_output()->Clear();
+#ifdef TRTIS_ENABLE_TRACING
+    if (state->tracer_ != nullptr) {
+      state->tracer_->SetFailed();
+    }
+#endif  // TRTIS_ENABLE_TRACING
   }
 
   RequestStatusUtil::Create(
@@ -1090,10 +1841,11 @@ class StreamInferHandler
       const std::shared_ptr<TRTSERVER_Server>& trtserver, const char* server_id,
       const std::shared_ptr<TraceManager>& trace_manager,
       const std::shared_ptr<SharedMemoryBlockManager>& smb_manager,
-      GRPCService::AsyncService* service, grpc::ServerCompletionQueue* cq,
+      GRPCService::AsyncService* service,
+      const std::vector<grpc::ServerCompletionQueue*>& cqs,
       size_t max_state_bucket_count)
       : Handler(
-            name, trtserver, server_id, service, cq, max_state_bucket_count),
+            name, trtserver, server_id, service, cqs, max_state_bucket_count),
         trace_manager_(trace_manager), smb_manager_(smb_manager)
   {
     // Create the allocator that will be used to allocate buffers for
@@ -1105,13 +1857,17 @@ class StreamInferHandler
   }
 
  protected:
-  void StartNewRequest() override;
+  void StartNewRequest(grpc::ServerCompletionQueue* cq) override;
   bool Process(State* state, bool rpc_ok) override;
 
  private:
   static void StreamInferComplete(
       TRTSERVER_Server* server, TRTSERVER_Trace* trace,
       TRTSERVER_InferenceResponse* response, void* userp);
+  static void StreamOutputReady(
+      const char* name, const int64_t* dims, uint64_t dim_count,
+      const void* base, size_t byte_size, TRTSERVER_Memory_Type memory_type,
+      void* userp);
   static void CompleteResponse(Handler::State* state);
 
   std::shared_ptr<TraceManager> trace_manager_;
@@ -1120,10 +1876,11 @@ class StreamInferHandler
 };
 
 void
-StreamInferHandler::StartNewRequest()
+StreamInferHandler::StartNewRequest(grpc::ServerCompletionQueue* cq)
 {
   const uint64_t unique_id = RequestStatusUtil::NextUniqueRequestId();
-  auto context = std::make_shared<State::Context>(server_id_, unique_id);
+  auto context = std::make_shared<State::Context>(server_id_, cq, unique_id);
+  NotifyWhenDone(context);
   State* state = StateNew(context);
 
 #ifdef TRTIS_ENABLE_TRACING
@@ -1137,7 +1894,7 @@ StreamInferHandler::StartNewRequest()
 #endif  // TRTIS_ENABLE_TRACING
 
   service_->RequestStreamInfer(
-      state->context_->ctx_.get(), state->context_->responder_.get(), cq_, cq_,
+      state->context_->ctx_.get(), state->context_->responder_.get(), cq, cq,
       state);
 
   LOG_VERBOSE(1) << "New request handler for " << Name() << ", "
@@ -1147,6 +1904,8 @@ StreamInferHandler::StartNewRequest()
 bool
 StreamInferHandler::Process(Handler::State* state, bool rpc_ok)
 {
+  NVTX_RANGE(nvtx_, "GRPC stream infer");
+
   LOG_VERBOSE(1) << "Process for " << Name() << ", rpc_ok=" << rpc_ok
                  << ", context " << state->context_->unique_id_ << ", "
                  << state->unique_id_ << " step " << state->step_;
@@ -1165,7 +1924,30 @@ StreamInferHandler::Process(Handler::State* state, bool rpc_ok)
     }
 
     // Start a new request to replace this one...
-    StartNewRequest();
+    StartNewRequest(state->context_->cq_);
+
+    // The client may allow responses to be returned as soon as they
+    // complete instead of in request order. Each response's
+    // InferResponseHeader id identifies the request it belongs to.
+    const auto& metadata = state->context_->ctx_->client_metadata();
+    const auto order = metadata.find(kStreamResponseOrderGRPCMetadata);
+    if ((order != metadata.end()) && (order->second == "unordered")) {
+      state->context_->ordered_ = false;
+    }
+
+    // The client may also ask for the outputs that complete before
+    // their request, such as the outputs of an early step of an
+    // ensemble, to be returned right away in partial responses.
+    const auto partial = metadata.find(kStreamPartialOutputsGRPCMetadata);
+    if ((partial != metadata.end()) && (partial->second == "true")) {
+      state->context_->partial_outputs_ = true;
+    }
+
+    SetResponseCompression(state->context_->ctx_.get());
+
+    LOG_IF_ERR(
+        TRTSERVER_SequenceBindingNew(&state->context_->sequence_binding_),
+        "creating sequence binding");
 
     // Since this is the start of a connection, 'state' hasn't been
     // used yet so use it to read a request off the connection.
@@ -1249,10 +2031,28 @@ StreamInferHandler::Process(Handler::State* state, bool rpc_ok)
 #endif  // TRTIS_ENABLE_TRACING
 
             state->step_ = ISSUED;
-            err = TRTSERVER_ServerInferAsync(
-                trtserver_.get(), trace, request_provider, allocator_,
-                &state->alloc_payload_ /* response_allocator_userp */,
-                StreamInferComplete, reinterpret_cast<void*>(state));
+            err = TRTSERVER_InferenceRequestProviderSetCancelledFn(
+                request_provider, IsCancelled, reinterpret_cast<void*>(state));
+            if ((err == nullptr) &&
+                (context->sequence_binding_ != nullptr) &&
+                (request.meta_data().correlation_id() != 0)) {
+              err = TRTSERVER_InferenceRequestProviderSetSequenceBinding(
+                  request_provider, context->sequence_binding_);
+            }
+            if ((err == nullptr) && context->partial_outputs_) {
+              state->partial_state_fn_ = [this, context]() {
+                return StateNew(context, Steps::WRITEREADY);
+              };
+              err = TRTSERVER_InferenceRequestProviderSetOutputReadyFn(
+                  request_provider, StreamOutputReady,
+                  reinterpret_cast<void*>(state));
+            }
+            if (err == nullptr) {
+              err = TRTSERVER_ServerInferAsync(
+                  trtserver_.get(), trace, request_provider, allocator_,
+                  &state->alloc_payload_ /* response_allocator_userp */,
+                  StreamInferComplete, reinterpret_cast<void*>(state));
+            }
 
             // The request provider can be deleted immediately after the
             // ServerInferAsync call returns.
@@ -1280,6 +2080,12 @@ StreamInferHandler::Process(Handler::State* state, bool rpc_ok)
       response.mutable_meta_data()->Clear();
       response.mutable_raw_output()->Clear();
 
+#ifdef TRTIS_ENABLE_TRACING
+      if (state->tracer_ != nullptr) {
+        state->tracer_->SetFailed();
+      }
+#endif  // TRTIS_ENABLE_TRACING
+
       response.mutable_meta_data()->set_id(request.meta_data().id());
 
       state->step_ = Steps::WRITEREADY;
@@ -1336,7 +2142,6 @@ StreamInferHandler::Process(Handler::State* state, bool rpc_ok)
       }
 #endif  // TRTIS_ENABLE_TRACING
 
-      next_state->step_ = Steps::WRITTEN;
       next_state->context_->responder_->Write(
           next_state->response_, next_state);
     }
@@ -1410,11 +2215,20 @@ StreamInferHandler::StreamInferComplete(
     }
   }
 
+  FinalizePoolOutputs(
+      &state->alloc_payload_, response.mutable_meta_data(),
+      (response_status == nullptr));
+
   // If the response is an error then clear the meta-data and raw
   // output as they may be partially initialized or uninitialized.
   if (response_status != nullptr) {
     response.mutable_meta_data()->Clear();
     response.mutable_raw_output()->Clear();
+#ifdef TRTIS_ENABLE_TRACING
+    if (state->tracer_ != nullptr) {
+      state->tracer_->SetFailed();
+    }
+#endif  // TRTIS_ENABLE_TRACING
   }
 
   RequestStatusUtil::Create(
@@ -1434,24 +2248,351 @@ StreamInferHandler::StreamInferComplete(
   CompleteResponse(state);
 }
 
+void
+StreamInferHandler::StreamOutputReady(
+    const char* name, const int64_t* dims, uint64_t dim_count,
+    const void* base, size_t byte_size, TRTSERVER_Memory_Type memory_type,
+    void* userp)
+{
+  State* state = reinterpret_cast<State*>(userp);
+
+  // Only outputs in CPU memory can be returned early, any other output
+  // is only returned in the final response.
+  if (memory_type != TRTSERVER_MEMORY_CPU) {
+    return;
+  }
+
+  LOG_VERBOSE(1) << "StreamInferHandler::StreamOutputReady, context "
+                 << state->context_->unique_id_ << ", " << state->unique_id_
+                 << " output " << name;
+
+  const InferRequest& request = state->request_;
+  State* partial_state = state->partial_state_fn_();
+#ifdef TRTIS_ENABLE_TRACING
+  partial_state->tracer_.reset();
+#endif  // TRTIS_ENABLE_TRACING
+
+  InferResponse& response = partial_state->response_;
+  RequestStatusUtil::Create(
+      response.mutable_request_status(), nullptr /* success */,
+      state->unique_id_, state->context_->server_id_);
+
+  InferResponseHeader* response_header = response.mutable_meta_data();
+  response_header->set_id(request.meta_data().id());
+  response_header->set_model_name(request.model_name());
+  response_header->set_model_version(request.model_version());
+  response_header->set_batch_size(request.meta_data().batch_size());
+  response_header->set_partial(true);
+
+  InferResponseHeader::Output* output = response_header->add_output();
+  output->set_name(name);
+  for (uint64_t i = 0; i < dim_count; ++i) {
+    output->mutable_raw()->add_dims(dims[i]);
+  }
+  output->mutable_raw()->set_batch_byte_size(byte_size);
+  response.add_raw_output(reinterpret_cast<const char*>(base), byte_size);
+
+  // The partial response is delivered ahead of the response of the
+  // request, which can't be written yet as the request is in flight.
+  state->context_->EnqueueForResponseBefore(partial_state, state);
+  CompleteResponse(partial_state);
+}
+
 void
 StreamInferHandler::CompleteResponse(Handler::State* state)
 {
-  // If 'state' is at the front of the queued states then it's
-  // response should be sent next... so go ahead and send it. If
-  // 'state' is not the next to be sent then do nothing. When the
-  // front state is eventually written it will trigger a write of the
-  // next state in the queue.
-  if (state == state->context_->ReadyResponse()) {
+  // If a response can be sent next (for ordered streams only the
+  // state at the front of the queued states, which may be 'state')
+  // then go ahead and send it. Otherwise do nothing. When the
+  // in-progress write completes it will trigger a write of the next
+  // ready state in the queue.
+  auto ready_state = state->context_->ReadyResponse();
+  if (ready_state != nullptr) {
 #ifdef TRTIS_ENABLE_TRACING
-    if (state->tracer_ != nullptr) {
-      state->tracer_->CaptureTimestamp(
+    if (ready_state->tracer_ != nullptr) {
+      ready_state->tracer_->CaptureTimestamp(
           TRTSERVER_TRACE_LEVEL_MIN, "grpc send start");
     }
 #endif  // TRTIS_ENABLE_TRACING
 
-    state->step_ = Steps::WRITTEN;
-    state->context_->responder_->Write(state->response_, state);
+    ready_state->context_->responder_->Write(
+        ready_state->response_, ready_state);
+  }
+}
+
+//
+// BatchInferHandler
+//
+class BatchInferHandler
+    : public Handler<
+          GRPCService::AsyncService,
+          grpc::ServerAsyncResponseWriter<BatchInferResponse>,
+          BatchInferRequest, BatchInferResponse> {
+ public:
+  BatchInferHandler(
+      const std::string& name,
+      const std::shared_ptr<TRTSERVER_Server>& trtserver, const char* server_id,
+      const std::shared_ptr<SharedMemoryBlockManager>& smb_manager,
+      GRPCService::AsyncService* service,
+      const std::vector<grpc::ServerCompletionQueue*>& cqs,
+      size_t max_state_bucket_count)
+      : Handler(
+            name, trtserver, server_id, service, cqs, max_state_bucket_count),
+        smb_manager_(smb_manager)
+  {
+    // Create the allocator that will be used to allocate buffers for
+    // the result tensors.
+    FAIL_IF_ERR(
+        TRTSERVER_ResponseAllocatorNew(
+            &allocator_, InferResponseAlloc, InferResponseRelease),
+        "creating response allocator");
+  }
+
+ protected:
+  void StartNewRequest(grpc::ServerCompletionQueue* cq) override;
+  bool Process(State* state, bool rpc_ok) override;
+
+ private:
+  // The completion payload for one request of a batch.
+  struct Item {
+    State* state_;
+    int idx_;
+  };
+
+  TRTSERVER_Error* IssueRequest(State* state, int idx);
+  static void InferComplete(
+      TRTSERVER_Server* server, TRTSERVER_Trace* trace,
+      TRTSERVER_InferenceResponse* response, void* userp);
+  static void CompleteRequest(State* state);
+
+  std::shared_ptr<SharedMemoryBlockManager> smb_manager_;
+  TRTSERVER_ResponseAllocator* allocator_;
+};
+
+void
+BatchInferHandler::StartNewRequest(grpc::ServerCompletionQueue* cq)
+{
+  auto context = std::make_shared<State::Context>(server_id_, cq);
+  NotifyWhenDone(context);
+  State* state = StateNew(context);
+  service_->RequestBatchInfer(
+      state->context_->ctx_.get(), &state->request_,
+      state->context_->responder_.get(), cq, cq, state);
+
+  LOG_VERBOSE(1) << "New request handler for " << Name() << ", "
+                 << state->unique_id_;
+}
+
+bool
+BatchInferHandler::Process(Handler::State* state, bool rpc_ok)
+{
+  LOG_VERBOSE(1) << "Process for " << Name() << ", rpc_ok=" << rpc_ok << ", "
+                 << state->unique_id_ << " step " << state->step_;
+
+  // We need an explicit finish indicator. Can't use 'state->step_'
+  // because we launch async inferences that could update 'state's
+  // step_ to be COMPLETE before this thread exits this function.
+  bool finished = false;
+
+  // If RPC failed on a new request then the server is shutting down
+  // and so we should do nothing (including not registering for a new
+  // request).
+  const bool shutdown = (!rpc_ok && (state->step_ == Steps::START));
+  if (shutdown) {
+    state->step_ = Steps::FINISH;
+    finished = true;
+  }
+
+  if (state->step_ == Steps::START) {
+    // Start a new request to replace this one...
+    StartNewRequest(state->context_->cq_);
+
+    SetResponseCompression(state->context_->ctx_.get());
+
+    const BatchInferRequest& request = state->request_;
+    BatchInferResponse& response = state->response_;
+
+    // Create all the responses before issuing any request since
+    // completions fill them in concurrently.
+    const int cnt = request.request_size();
+    for (int idx = 0; idx < cnt; ++idx) {
+      response.add_response();
+      if (state->batch_alloc_payloads_.size() <= static_cast<size_t>(idx)) {
+        state->batch_alloc_payloads_.emplace_back(new AllocPayload());
+      }
+    }
+
+    // Hold one extra pending count while issuing so the batch can't
+    // complete before every request has been issued.
+    state->step_ = ISSUED;
+    state->batch_pending_cnt_ = cnt + 1;
+
+    for (int idx = 0; idx < cnt; ++idx) {
+      TRTSERVER_Error* err = IssueRequest(state, idx);
+      if (err != nullptr) {
+        InferResponse* item_response = response.mutable_response(idx);
+        RequestStatusUtil::Create(
+            item_response->mutable_request_status(), err, state->unique_id_,
+            server_id_);
+
+        LOG_VERBOSE(1) << "Infer failed: " << TRTSERVER_ErrorMessage(err);
+        TRTSERVER_ErrorDelete(err);
+
+        // Clear the meta-data and raw output as they may be partially
+        // initialized or uninitialized.
+        item_response->mutable_meta_data()->Clear();
+        item_response->mutable_raw_output()->Clear();
+        item_response->mutable_meta_data()->set_id(
+            request.request(idx).meta_data().id());
+
+        CompleteRequest(state);
+      }
+    }
+
+    CompleteRequest(state);
+  } else if (state->step_ == Steps::COMPLETE) {
+    state->step_ = Steps::FINISH;
+    finished = true;
+  }
+
+  return !finished;
+}
+
+TRTSERVER_Error*
+BatchInferHandler::IssueRequest(Handler::State* state, int idx)
+{
+  const InferRequest& request = state->request_.request(idx);
+  InferResponse& response = *state->response_.mutable_response(idx);
+  AllocPayload* alloc_payload = state->batch_alloc_payloads_[idx].get();
+
+  std::string request_header_serialized;
+  if (!request.meta_data().SerializeToString(&request_header_serialized)) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_UNKNOWN, "failed to serialize request header");
+  }
+
+  // Create the inference request provider which provides all the
+  // input information needed for an inference.
+  TRTSERVER_InferenceRequestProvider* request_provider = nullptr;
+  RETURN_IF_ERR(TRTSERVER_InferenceRequestProviderNew(
+      &request_provider, trtserver_.get(), request.model_name().c_str(),
+      request.model_version(), request_header_serialized.c_str(),
+      request_header_serialized.size()));
+
+  TRTSERVER_Error* err = InferGRPCToInput(
+      trtserver_, smb_manager_, request.meta_data(), request,
+      request_provider);
+  if (err == nullptr) {
+    err = InferAllocatorPayload(
+        trtserver_, smb_manager_, request.meta_data(), response,
+        alloc_payload);
+  }
+  if (err == nullptr) {
+    err = TRTSERVER_InferenceRequestProviderSetCancelledFn(
+        request_provider, IsCancelled, reinterpret_cast<void*>(state));
+  }
+  if (err == nullptr) {
+    Item* item = new Item{state, idx};
+    err = TRTSERVER_ServerInferAsync(
+        trtserver_.get(), nullptr /* trace */, request_provider, allocator_,
+        alloc_payload /* response_allocator_userp */, InferComplete,
+        reinterpret_cast<void*>(item));
+    if (err != nullptr) {
+      delete item;
+    }
+  }
+
+  // The request provider can be deleted immediately after the
+  // ServerInferAsync call returns.
+  TRTSERVER_InferenceRequestProviderDelete(request_provider);
+  return err;
+}
+
+void
+BatchInferHandler::InferComplete(
+    TRTSERVER_Server* server, TRTSERVER_Trace* trace,
+    TRTSERVER_InferenceResponse* trtserver_response, void* userp)
+{
+  Item* item = reinterpret_cast<Item*>(userp);
+  State* state = item->state_;
+  const int idx = item->idx_;
+  delete item;
+
+  LOG_VERBOSE(1) << "BatchInferHandler::InferComplete, " << state->unique_id_
+                 << " request " << idx << " step " << state->step_;
+
+  const InferRequest& request = state->request_.request(idx);
+  InferResponse& response = *state->response_.mutable_response(idx);
+
+  TRTSERVER_Error* response_status =
+      TRTSERVER_InferenceResponseStatus(trtserver_response);
+  if (response_status == nullptr) {
+    TRTSERVER_Protobuf* response_protobuf = nullptr;
+    response_status = TRTSERVER_InferenceResponseHeader(
+        trtserver_response, &response_protobuf);
+    if (response_status == nullptr) {
+      const char* buffer;
+      size_t byte_size;
+      response_status =
+          TRTSERVER_ProtobufSerialize(response_protobuf, &buffer, &byte_size);
+      if (response_status == nullptr) {
+        if (!response.mutable_meta_data()->ParseFromArray(buffer, byte_size)) {
+          response_status = TRTSERVER_ErrorNew(
+              TRTSERVER_ERROR_INTERNAL, "failed to parse response header");
+        }
+      }
+
+      TRTSERVER_ProtobufDelete(response_protobuf);
+    }
+  }
+
+  FinalizePoolOutputs(
+      state->batch_alloc_payloads_[idx].get(), response.mutable_meta_data(),
+      (response_status == nullptr));
+
+  // If the response is an error then clear the meta-data and raw
+  // output as they may be partially initialized or uninitialized.
+  if (response_status != nullptr) {
+    response.mutable_meta_data()->Clear();
+    response.mutable_raw_output()->Clear();
+  }
+
+  RequestStatusUtil::Create(
+      response.mutable_request_status(), response_status, state->unique_id_,
+      state->context_->server_id_);
+
+  LOG_IF_ERR(
+      TRTSERVER_InferenceResponseDelete(trtserver_response),
+      "deleting GRPC response");
+  TRTSERVER_ErrorDelete(response_status);
+
+  response.mutable_meta_data()->set_id(request.meta_data().id());
+
+  CompleteRequest(state);
+}
+
+void
+BatchInferHandler::CompleteRequest(Handler::State* state)
+{
+  if (--state->batch_pending_cnt_ != 0) {
+    return;
+  }
+
+  // All requests of the batch are complete so send the combined
+  // response.
+  state->step_ = COMPLETE;
+  const size_t byte_size = state->response_.ByteSizeLong();
+  if (byte_size > INT_MAX) {
+    state->context_->responder_->FinishWithError(
+        grpc::Status(
+            grpc::StatusCode::RESOURCE_EXHAUSTED,
+            "Response has byte size " + std::to_string(byte_size) +
+                " which exceeds gRPC's byte size limit " +
+                std::to_string(INT_MAX) + "."),
+        state);
+  } else {
+    state->context_->responder_->Finish(
+        state->response_, grpc::Status::OK, state);
   }
 }
 
@@ -1469,23 +2610,24 @@ class ModelControlHandler
       const std::shared_ptr<TRTSERVER_Server>& trtserver, const char* server_id,
       GRPCService::AsyncService* service, grpc::ServerCompletionQueue* cq,
       size_t max_state_bucket_count)
-      : Handler(name, trtserver, server_id, service, cq, max_state_bucket_count)
+      : Handler(
+            name, trtserver, server_id, service, {cq}, max_state_bucket_count)
   {
   }
 
  protected:
-  void StartNewRequest() override;
+  void StartNewRequest(grpc::ServerCompletionQueue* cq) override;
   bool Process(State* state, bool rpc_ok) override;
 };
 
 void
-ModelControlHandler::StartNewRequest()
+ModelControlHandler::StartNewRequest(grpc::ServerCompletionQueue* cq)
 {
-  auto context = std::make_shared<State::Context>(server_id_);
+  auto context = std::make_shared<State::Context>(server_id_, cq);
   State* state = StateNew(context);
   service_->RequestModelControl(
       state->context_->ctx_.get(), &state->request_,
-      state->context_->responder_.get(), cq_, cq_, state);
+      state->context_->responder_.get(), cq, cq, state);
 
   LOG_VERBOSE(1) << "New request handler for " << Name() << ", "
                  << state->unique_id_;
@@ -1534,7 +2676,7 @@ ModelControlHandler::Process(Handler::State* state, bool rpc_ok)
   // request cause too much load on server), so register for next
   // request only after this one finished.
   if (!shutdown && (state->step_ == Steps::FINISH)) {
-    StartNewRequest();
+    StartNewRequest(state->context_->cq_);
   }
 
   return state->step_ != Steps::FINISH;
@@ -1556,13 +2698,14 @@ class SharedMemoryControlHandler
       GRPCService::AsyncService* service, grpc::ServerCompletionQueue* cq,
       size_t max_state_bucket_count)
       : Handler(
-            name, trtserver, server_id, service, cq, max_state_bucket_count),
+            name, trtserver, server_id, service, {cq},
+            max_state_bucket_count),
         smb_manager_(smb_manager)
   {
   }
 
  protected:
-  void StartNewRequest() override;
+  void StartNewRequest(grpc::ServerCompletionQueue* cq) override;
   bool Process(State* state, bool rpc_ok) override;
 
  private:
@@ -1570,13 +2713,13 @@ class SharedMemoryControlHandler
 };
 
 void
-SharedMemoryControlHandler::StartNewRequest()
+SharedMemoryControlHandler::StartNewRequest(grpc::ServerCompletionQueue* cq)
 {
-  auto context = std::make_shared<State::Context>(server_id_);
+  auto context = std::make_shared<State::Context>(server_id_, cq);
   State* state = StateNew(context);
   service_->RequestSharedMemoryControl(
       state->context_->ctx_.get(), &state->request_,
-      state->context_->responder_.get(), cq_, cq_, state);
+      state->context_->responder_.get(), cq, cq, state);
 
   LOG_VERBOSE(1) << "New request handler for " << Name() << ", "
                  << state->unique_id_;
@@ -1609,11 +2752,20 @@ SharedMemoryControlHandler::Process(Handler::State* state, bool rpc_ok)
         err = smb_manager_->Create(
             &smb, request.register_().name(),
             request.register_().system_shared_memory().shared_memory_key(),
-            request.register_().offset(), request.register_().byte_size());
+            request.register_().offset(), request.register_().byte_size(),
+            request.register_().system_shared_memory().hugetlbfs(),
+            request.register_().lock_pages());
+      } else if (request.register_().has_cuda_shared_memory()) {
+        const auto& cuda_shm = request.register_().cuda_shared_memory();
+        err = smb_manager_->CreateCuda(
+            &smb, request.register_().name(), cuda_shm.shared_memory_key(),
+            cuda_shm.offset(), request.register_().offset(),
+            request.register_().byte_size(), cuda_shm.device_id());
       } else {
-        return TRTSERVER_ErrorNew(
-            TRTSERVER_ERROR_INTERNAL,
-            "only system shared memory is supported currently");
+        err = TRTSERVER_ErrorNew(
+            TRTSERVER_ERROR_INVALID_ARG,
+            "shared memory register request must specify system or CUDA "
+            "shared memory");
       }
       if (err == nullptr) {
         err = TRTSERVER_ServerRegisterSharedMemory(trtserver_.get(), smb);
@@ -1634,6 +2786,9 @@ SharedMemoryControlHandler::Process(Handler::State* state, bool rpc_ok)
       if (err == nullptr) {
         err = TRTSERVER_ServerUnregisterAllSharedMemory(trtserver_.get());
       }
+    } else if (request.has_release_output()) {
+      err = smb_manager_->ReleaseOutputBlock(
+          request.release_output().shared_memory_key());
     } else if (request.has_status()) {
       TRTSERVER_Protobuf* shm_status_protobuf = nullptr;
       err = TRTSERVER_ServerSharedMemoryStatus(
@@ -1674,7 +2829,7 @@ SharedMemoryControlHandler::Process(Handler::State* state, bool rpc_ok)
   // request cause too much load on server), so register for next
   // request only after this one finished.
   if (!shutdown && (state->step_ == Steps::FINISH)) {
-    StartNewRequest();
+    StartNewRequest(state->context_->cq_);
   }
 
   return state->step_ != Steps::FINISH;
@@ -1691,12 +2846,17 @@ GRPCServer::GRPCServer(
     const std::shared_ptr<SharedMemoryBlockManager>& smb_manager,
     const char* server_id, const std::string& server_addr,
     const int infer_thread_cnt, const int stream_infer_thread_cnt,
-    const int infer_allocation_pool_size)
+    const int infer_allocation_pool_size,
+    const grpc_compression_algorithm compression_algorithm,
+    const grpc_compression_level compression_level,
+    const std::vector<std::string>& peers)
     : server_(server), trace_manager_(trace_manager), smb_manager_(smb_manager),
       server_id_(server_id), server_addr_(server_addr),
       infer_thread_cnt_(infer_thread_cnt),
       stream_infer_thread_cnt_(stream_infer_thread_cnt),
-      infer_allocation_pool_size_(infer_allocation_pool_size), running_(false)
+      infer_allocation_pool_size_(infer_allocation_pool_size),
+      compression_algorithm_(compression_algorithm),
+      compression_level_(compression_level), peers_(peers), running_(false)
 {
 }
 
@@ -1711,8 +2871,45 @@ GRPCServer::Create(
     const std::shared_ptr<nvidia::inferenceserver::TraceManager>& trace_manager,
     const std::shared_ptr<SharedMemoryBlockManager>& smb_manager, int32_t port,
     int infer_thread_cnt, int stream_infer_thread_cnt,
-    int infer_allocation_pool_size, std::unique_ptr<GRPCServer>* grpc_server)
+    int infer_allocation_pool_size, const std::string& compression_algorithm,
+    const std::string& compression_level,
+    const std::vector<std::string>& peers,
+    std::unique_ptr<GRPCServer>* grpc_server)
 {
+  grpc_compression_algorithm algorithm;
+  if (compression_algorithm == "none") {
+    algorithm = GRPC_COMPRESS_NONE;
+  } else if (compression_algorithm == "deflate") {
+    algorithm = GRPC_COMPRESS_DEFLATE;
+  } else if (compression_algorithm == "gzip") {
+    algorithm = GRPC_COMPRESS_GZIP;
+  } else {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_INVALID_ARG,
+        std::string(
+            "unknown GRPC compression algorithm '" + compression_algorithm +
+            "', expected 'none', 'deflate' or 'gzip'")
+            .c_str());
+  }
+
+  grpc_compression_level level;
+  if (compression_level == "none") {
+    level = GRPC_COMPRESS_LEVEL_NONE;
+  } else if (compression_level == "low") {
+    level = GRPC_COMPRESS_LEVEL_LOW;
+  } else if (compression_level == "medium") {
+    level = GRPC_COMPRESS_LEVEL_MED;
+  } else if (compression_level == "high") {
+    level = GRPC_COMPRESS_LEVEL_HIGH;
+  } else {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_INVALID_ARG,
+        std::string(
+            "unknown GRPC compression level '" + compression_level +
+            "', expected 'none', 'low', 'medium' or 'high'")
+            .c_str());
+  }
+
   const char* server_id = nullptr;
   TRTSERVER_Error* err = TRTSERVER_ServerId(server.get(), &server_id);
   if (err != nullptr) {
@@ -1723,7 +2920,8 @@ GRPCServer::Create(
   const std::string addr = "0.0.0.0:" + std::to_string(port);
   grpc_server->reset(new GRPCServer(
       server, trace_manager, smb_manager, server_id, addr, infer_thread_cnt,
-      stream_infer_thread_cnt, infer_allocation_pool_size));
+      stream_infer_thread_cnt, infer_allocation_pool_size, algorithm, level,
+      peers));
 
   return nullptr;  // success
 }
@@ -1736,14 +2934,35 @@ GRPCServer::Start()
         TRTSERVER_ERROR_ALREADY_EXISTS, "GRPC server is already running.");
   }
 
+  if (!peers_.empty()) {
+    RETURN_IF_ERR(PeerForwarder::Create(peers_, &forwarder_));
+  }
+
   grpc_builder_.AddListeningPort(
       server_addr_, grpc::InsecureServerCredentials());
   grpc_builder_.SetMaxMessageSize(MAX_GRPC_MESSAGE_SIZE);
+  grpc_builder_.SetDefaultCompressionAlgorithm(compression_algorithm_);
+  grpc_builder_.SetDefaultCompressionLevel(compression_level_);
   grpc_builder_.RegisterService(&service_);
   health_cq_ = grpc_builder_.AddCompletionQueue();
   status_cq_ = grpc_builder_.AddCompletionQueue();
-  infer_cq_ = grpc_builder_.AddCompletionQueue();
-  stream_infer_cq_ = grpc_builder_.AddCompletionQueue();
+  // Each inference handler thread waits on its own completion queue
+  // so that threads don't contend on a single shared queue.
+  std::vector<grpc::ServerCompletionQueue*> infer_cqs;
+  for (int i = 0; i < std::max(1, infer_thread_cnt_); ++i) {
+    infer_cqs_.emplace_back(grpc_builder_.AddCompletionQueue());
+    infer_cqs.push_back(infer_cqs_.back().get());
+  }
+  std::vector<grpc::ServerCompletionQueue*> stream_infer_cqs;
+  for (int i = 0; i < std::max(1, stream_infer_thread_cnt_); ++i) {
+    stream_infer_cqs_.emplace_back(grpc_builder_.AddCompletionQueue());
+    stream_infer_cqs.push_back(stream_infer_cqs_.back().get());
+  }
+  std::vector<grpc::ServerCompletionQueue*> batch_infer_cqs;
+  for (int i = 0; i < std::max(1, infer_thread_cnt_); ++i) {
+    batch_infer_cqs_.emplace_back(grpc_builder_.AddCompletionQueue());
+    batch_infer_cqs.push_back(batch_infer_cqs_.back().get());
+  }
   modelcontrol_cq_ = grpc_builder_.AddCompletionQueue();
   shmcontrol_cq_ = grpc_builder_.AddCompletionQueue();
   grpc_server_ = grpc_builder_.BuildAndStart();
@@ -1767,7 +2986,7 @@ GRPCServer::Start()
   // Handler for inference requests.
   InferHandler* hinfer = new InferHandler(
       "InferHandler", server_, server_id_, trace_manager_, smb_manager_,
-      &service_, infer_cq_.get(),
+      forwarder_.get(), &service_, infer_cqs,
       infer_allocation_pool_size_ /* max_state_bucket_count */);
   hinfer->Start(infer_thread_cnt_);
   infer_handler_.reset(hinfer);
@@ -1775,11 +2994,19 @@ GRPCServer::Start()
   // Handler for streaming inference requests.
   StreamInferHandler* hstreaminfer = new StreamInferHandler(
       "StreamInferHandler", server_, server_id_, trace_manager_, smb_manager_,
-      &service_, stream_infer_cq_.get(),
+      &service_, stream_infer_cqs,
       infer_allocation_pool_size_ /* max_state_bucket_count */);
   hstreaminfer->Start(stream_infer_thread_cnt_);
   stream_infer_handler_.reset(hstreaminfer);
 
+  // Handler for batch inference requests.
+  BatchInferHandler* hbatchinfer = new BatchInferHandler(
+      "BatchInferHandler", server_, server_id_, smb_manager_, &service_,
+      batch_infer_cqs,
+      infer_allocation_pool_size_ /* max_state_bucket_count */);
+  hbatchinfer->Start(infer_thread_cnt_);
+  batch_infer_handler_.reset(hbatchinfer);
+
   // Handler for model-control requests. A single thread processes all
   // of these requests.
   ModelControlHandler* hmodelcontrol = new ModelControlHandler(
@@ -1809,13 +3036,23 @@ GRPCServer::Stop()
         TRTSERVER_ERROR_UNAVAILABLE, "GRPC server is not running.");
   }
 
-  // Always shutdown the completion queue after the server.
+  // Always shutdown the completion queue after the server. The
+  // server waits for forwarded requests to complete so the forwarder
+  // can be destroyed once it is shut down.
   grpc_server_->Shutdown();
+  forwarder_.reset();
 
   health_cq_->Shutdown();
   status_cq_->Shutdown();
-  infer_cq_->Shutdown();
-  stream_infer_cq_->Shutdown();
+  for (auto& cq : infer_cqs_) {
+    cq->Shutdown();
+  }
+  for (auto& cq : stream_infer_cqs_) {
+    cq->Shutdown();
+  }
+  for (auto& cq : batch_infer_cqs_) {
+    cq->Shutdown();
+  }
   modelcontrol_cq_->Shutdown();
   shmcontrol_cq_->Shutdown();
 
@@ -1825,6 +3062,7 @@ GRPCServer::Stop()
   dynamic_cast<StatusHandler*>(status_handler_.get())->Stop();
   dynamic_cast<InferHandler*>(infer_handler_.get())->Stop();
   dynamic_cast<StreamInferHandler*>(stream_infer_handler_.get())->Stop();
+  dynamic_cast<BatchInferHandler*>(batch_infer_handler_.get())->Stop();
   dynamic_cast<ModelControlHandler*>(modelcontrol_handler_.get())->Stop();
   dynamic_cast<SharedMemoryControlHandler*>(shmcontrol_handler_.get())->Stop();
 
@@ -28,11 +28,26 @@
 #include <grpc++/grpc++.h>
 #include "src/core/grpc_service.grpc.pb.h"
 #include "src/core/trtserver.h"
+#include "src/servers/peer_forwarder.h"
 #include "src/servers/shared_memory_block_manager.h"
 #include "src/servers/tracer.h"
 
 namespace nvidia { namespace inferenceserver {
 
+class RawInferRequest;
+
+// GRPCService::AsyncService that can also deliver Infer requests as
+// a RawInferRequest, which references the raw input tensors in the
+// received message instead of copying them into an InferRequest.
+class InferAsyncService : public GRPCService::AsyncService {
+ public:
+  void RequestRawInfer(
+      grpc::ServerContext* context, RawInferRequest* request,
+      grpc::ServerAsyncResponseWriter<InferResponse>* response,
+      grpc::CompletionQueue* new_call_cq,
+      grpc::ServerCompletionQueue* notification_cq, void* tag);
+};
+
 class GRPCServer {
  public:
   static TRTSERVER_Error* Create(
@@ -41,7 +56,10 @@ class GRPCServer {
           trace_manager,
       const std::shared_ptr<SharedMemoryBlockManager>& smb_manager,
       int32_t port, int infer_thread_cnt, int stream_infer_thread_cnt,
-      int infer_allocation_pool_size, std::unique_ptr<GRPCServer>* grpc_server);
+      int infer_allocation_pool_size, const std::string& compression_algorithm,
+      const std::string& compression_level,
+      const std::vector<std::string>& peers,
+      std::unique_ptr<GRPCServer>* grpc_server);
 
   ~GRPCServer();
 
@@ -62,7 +80,10 @@ class GRPCServer {
       const std::shared_ptr<SharedMemoryBlockManager>& smb_manager,
       const char* server_id, const std::string& server_addr,
       const int infer_thread_cnt, const int stream_infer_thread_cnt,
-      const int infer_allocation_pool_size);
+      const int infer_allocation_pool_size,
+      const grpc_compression_algorithm compression_algorithm,
+      const grpc_compression_level compression_level,
+      const std::vector<std::string>& peers);
 
   std::shared_ptr<TRTSERVER_Server> server_;
   std::shared_ptr<TraceManager> trace_manager_;
@@ -73,11 +94,19 @@ class GRPCServer {
   const int infer_thread_cnt_;
   const int stream_infer_thread_cnt_;
   const int infer_allocation_pool_size_;
+  const grpc_compression_algorithm compression_algorithm_;
+  const grpc_compression_level compression_level_;
+
+  // The peers that Infer requests for models that aren't available
+  // locally are forwarded to.
+  const std::vector<std::string> peers_;
+  std::unique_ptr<PeerForwarder> forwarder_;
 
   std::unique_ptr<grpc::ServerCompletionQueue> health_cq_;
   std::unique_ptr<grpc::ServerCompletionQueue> status_cq_;
-  std::unique_ptr<grpc::ServerCompletionQueue> infer_cq_;
-  std::unique_ptr<grpc::ServerCompletionQueue> stream_infer_cq_;
+  std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> infer_cqs_;
+  std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> stream_infer_cqs_;
+  std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> batch_infer_cqs_;
   std::unique_ptr<grpc::ServerCompletionQueue> modelcontrol_cq_;
   std::unique_ptr<grpc::ServerCompletionQueue> shmcontrol_cq_;
 
@@ -88,10 +117,11 @@ class GRPCServer {
   std::unique_ptr<HandlerBase> status_handler_;
   std::unique_ptr<HandlerBase> infer_handler_;
   std::unique_ptr<HandlerBase> stream_infer_handler_;
+  std::unique_ptr<HandlerBase> batch_infer_handler_;
   std::unique_ptr<HandlerBase> modelcontrol_handler_;
   std::unique_ptr<HandlerBase> shmcontrol_handler_;
 
-  GRPCService::AsyncService service_;
+  InferAsyncService service_;
   bool running_;
 };
 
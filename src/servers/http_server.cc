@@ -29,11 +29,21 @@
 #include <event2/buffer.h>
 #include <evhtp/evhtp.h>
 #include <google/protobuf/text_format.h>
+#include <google/protobuf/util/json_util.h>
 #include <re2/re2.h>
+#include <zlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
 #include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <mutex>
 #include <thread>
+#include <unordered_map>
 #include "src/core/api.pb.h"
 #include "src/core/constants.h"
+#include "src/core/nvtx.h"
 #include "src/core/server_status.pb.h"
 #include "src/core/trtserver.h"
 #include "src/servers/common.h"
@@ -44,11 +54,278 @@
 
 namespace nvidia { namespace inferenceserver {
 
+namespace {
+
+// Outputs of at least this size are written into a buffer of their
+// own that is attached to the response by reference, instead of into
+// space reserved in the response evbuffer.
+constexpr size_t kReferencedOutputByteSize = 64 * 1024;
+
+// Free an output buffer once the response evbuffer no longer
+// references it.
+void
+FreeReferencedOutput(const void* data, size_t datalen, void* extra)
+{
+  free(const_cast<void*>(data));
+}
+
+// Maximum number of parsed request headers held in the request
+// header cache. The cache is cleared when it fills, which only
+// happens if clients send many distinct headers.
+constexpr size_t kMaxCachedRequestHeaders = 1024;
+
+// Decode standard base64 'encoded' into 'decoded'. Padding is
+// optional. Return false if 'encoded' is not valid base64.
+bool
+Base64Decode(const std::string& encoded, std::string* decoded)
+{
+  decoded->clear();
+  decoded->reserve((encoded.size() / 4) * 3 + 2);
+
+  uint32_t bits = 0;
+  int bit_cnt = 0;
+  size_t pad_cnt = 0;
+  for (const char c : encoded) {
+    int val;
+    if ((c >= 'A') && (c <= 'Z')) {
+      val = c - 'A';
+    } else if ((c >= 'a') && (c <= 'z')) {
+      val = c - 'a' + 26;
+    } else if ((c >= '0') && (c <= '9')) {
+      val = c - '0' + 52;
+    } else if (c == '+') {
+      val = 62;
+    } else if (c == '/') {
+      val = 63;
+    } else if (c == '=') {
+      pad_cnt++;
+      continue;
+    } else {
+      return false;
+    }
+
+    // Data is not allowed after padding.
+    if (pad_cnt != 0) {
+      return false;
+    }
+
+    bits = (bits << 6) | val;
+    bit_cnt += 6;
+    if (bit_cnt >= 8) {
+      bit_cnt -= 8;
+      decoded->push_back(static_cast<char>((bits >> bit_cnt) & 0xFF));
+    }
+  }
+
+  // A single trailing character can't encode a full byte.
+  return (bit_cnt < 6) && (pad_cnt <= 2);
+}
+
+// Content encodings supported for request and response bodies.
+enum class CompressionType { NONE, DEFLATE, GZIP };
+
+// Response bodies smaller than this are never compressed since the
+// savings don't justify the compression cost.
+constexpr size_t kMinCompressByteSize = 1024;
+
+// Size of each chunk of output produced by deflate or inflate.
+constexpr size_t kCompressChunkByteSize = 64 * 1024;
+
+// Return the content encoding named by 'encoding', or false if it is
+// not supported. "identity" and the empty string mean no encoding.
+bool
+ParseContentEncoding(const std::string& encoding, CompressionType* type)
+{
+  if (encoding.empty() || (encoding == "identity")) {
+    *type = CompressionType::NONE;
+  } else if (encoding == "gzip") {
+    *type = CompressionType::GZIP;
+  } else if (encoding == "deflate") {
+    *type = CompressionType::DEFLATE;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+// Return the preferred supported encoding listed in an Accept-Encoding
+// header. gzip is preferred over deflate and encodings with q=0 are
+// ignored.
+CompressionType
+ParseAcceptEncoding(const std::string& accept_encoding)
+{
+  bool gzip = false, deflate = false;
+
+  size_t start = 0;
+  while (start < accept_encoding.size()) {
+    size_t end = accept_encoding.find(',', start);
+    if (end == std::string::npos) {
+      end = accept_encoding.size();
+    }
+
+    std::string coding = accept_encoding.substr(start, end - start);
+    start = end + 1;
+
+    std::string params;
+    const size_t semi = coding.find(';');
+    if (semi != std::string::npos) {
+      params = coding.substr(semi + 1);
+      coding.resize(semi);
+    }
+
+    coding.erase(0, coding.find_first_not_of(" \t"));
+    coding.erase(coding.find_last_not_of(" \t") + 1);
+    params.erase(
+        std::remove_if(
+            params.begin(), params.end(),
+            [](const char c) { return (c == ' ') || (c == '\t'); }),
+        params.end());
+    if ((params == "q=0") || (params == "q=0.0") || (params == "q=0.00") ||
+        (params == "q=0.000")) {
+      continue;
+    }
+
+    if ((coding == "gzip") || (coding == "*")) {
+      gzip = true;
+    } else if (coding == "deflate") {
+      deflate = true;
+    }
+  }
+
+  if (gzip) {
+    return CompressionType::GZIP;
+  }
+  if (deflate) {
+    return CompressionType::DEFLATE;
+  }
+
+  return CompressionType::NONE;
+}
+
+// Compress all of 'source' into 'compressed' using 'level'. Return
+// false if compression fails.
+bool
+CompressEVBuffer(
+    const CompressionType type, const int level, evbuffer* source,
+    evbuffer* compressed)
+{
+  z_stream stream;
+  stream.zalloc = Z_NULL;
+  stream.zfree = Z_NULL;
+  stream.opaque = Z_NULL;
+
+  // A window bits offset of 16 selects the gzip wrapper instead of
+  // the zlib wrapper that HTTP calls "deflate".
+  const int window_bits = (type == CompressionType::GZIP) ? (15 + 16) : 15;
+  if (deflateInit2(
+          &stream, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) !=
+      Z_OK) {
+    return false;
+  }
+
+  const int n = evbuffer_peek(source, -1, NULL, NULL, 0);
+  std::vector<evbuffer_iovec> chunks(n);
+  evbuffer_peek(source, -1, NULL, chunks.data(), n);
+
+  bool success = true;
+  for (int i = 0; success && (i <= n); ++i) {
+    const int flush = (i == n) ? Z_FINISH : Z_NO_FLUSH;
+    stream.next_in =
+        (i == n) ? NULL : reinterpret_cast<Bytef*>(chunks[i].iov_base);
+    stream.avail_in = (i == n) ? 0 : chunks[i].iov_len;
+
+    int ret;
+    do {
+      evbuffer_iovec out;
+      if (evbuffer_reserve_space(compressed, kCompressChunkByteSize, &out, 1) !=
+          1) {
+        success = false;
+        break;
+      }
+
+      stream.next_out = reinterpret_cast<Bytef*>(out.iov_base);
+      stream.avail_out = out.iov_len;
+      ret = deflate(&stream, flush);
+      out.iov_len -= stream.avail_out;
+      evbuffer_commit_space(compressed, &out, 1);
+      if (ret == Z_STREAM_ERROR) {
+        success = false;
+        break;
+      }
+    } while ((stream.avail_out == 0) ||
+             ((flush == Z_FINISH) && (ret != Z_STREAM_END)));
+  }
+
+  deflateEnd(&stream);
+  return success;
+}
+
+// Decompress all of 'source' into 'decompressed'. Both zlib and gzip
+// wrapped data is accepted. Return false if 'source' is not a complete
+// compressed stream.
+bool
+DecompressEVBuffer(evbuffer* source, evbuffer* decompressed)
+{
+  z_stream stream;
+  stream.zalloc = Z_NULL;
+  stream.zfree = Z_NULL;
+  stream.opaque = Z_NULL;
+  stream.next_in = Z_NULL;
+  stream.avail_in = 0;
+
+  // A window bits offset of 32 detects the zlib or gzip wrapper.
+  if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+    return false;
+  }
+
+  const int n = evbuffer_peek(source, -1, NULL, NULL, 0);
+  std::vector<evbuffer_iovec> chunks(n);
+  evbuffer_peek(source, -1, NULL, chunks.data(), n);
+
+  int ret = Z_OK;
+  for (int i = 0; (ret == Z_OK) && (i < n); ++i) {
+    stream.next_in = reinterpret_cast<Bytef*>(chunks[i].iov_base);
+    stream.avail_in = chunks[i].iov_len;
+
+    // Keep inflating while the output chunk fills up since inflate
+    // may hold back output even after consuming all the input.
+    do {
+      evbuffer_iovec out;
+      if (evbuffer_reserve_space(
+              decompressed, kCompressChunkByteSize, &out, 1) != 1) {
+        ret = Z_MEM_ERROR;
+        break;
+      }
+
+      stream.next_out = reinterpret_cast<Bytef*>(out.iov_base);
+      stream.avail_out = out.iov_len;
+      ret = inflate(&stream, Z_NO_FLUSH);
+      out.iov_len -= stream.avail_out;
+      evbuffer_commit_space(decompressed, &out, 1);
+
+      // No progress possible only means this input chunk is used up.
+      if (ret == Z_BUF_ERROR) {
+        ret = Z_OK;
+        break;
+      }
+    } while ((ret == Z_OK) && (stream.avail_out == 0));
+  }
+
+  inflateEnd(&stream);
+  return ret == Z_STREAM_END;
+}
+
+}  // namespace
+
 // Generic HTTP server using evhtp
 class HTTPServerImpl : public HTTPServer {
  public:
-  explicit HTTPServerImpl(const int32_t port, const int thread_cnt)
-      : port_(port), thread_cnt_(thread_cnt)
+  explicit HTTPServerImpl(
+      const int32_t port, const int thread_cnt, const std::vector<int>& cpus,
+      const int listener_cnt = 1)
+      : port_(port), thread_cnt_(thread_cnt),
+        listener_cnt_(std::max(1, listener_cnt)), cpus_(cpus)
   {
   }
 
@@ -62,57 +339,131 @@ class HTTPServerImpl : public HTTPServer {
  protected:
   virtual void Handle(evhtp_request_t* req) = 0;
 
+  // An independent accept loop on 'port_'. When there are multiple
+  // listeners each binds the port with SO_REUSEPORT so the kernel
+  // distributes incoming connections across them, and all threads of
+  // the listener are pinned to 'cpus_'.
+  struct Listener {
+    evhtp_t* htp_;
+    struct event_base* evbase_;
+    std::thread worker_;
+    int fds_[2];
+    event* break_ev_;
+    std::vector<int> cpus_;
+  };
+
   static void StopCallback(int sock, short events, void* arg);
+  static void InitThread(evhtp_t* htp, evthr_t* thr, void* arg);
+  static void InitCurrentThread(const std::vector<int>& cpus);
 
   int32_t port_;
   int thread_cnt_;
+  int listener_cnt_;
+
+  // The CPUs the server's threads run on, empty if not isolated.
+  std::vector<int> cpus_;
 
-  evhtp_t* htp_;
-  struct event_base* evbase_;
-  std::thread worker_;
-  int fds_[2];
-  event* break_ev_;
+  std::vector<std::unique_ptr<Listener>> listeners_;
 };
 
 TRTSERVER_Error*
 HTTPServerImpl::Start()
 {
-  if (!worker_.joinable()) {
-    evbase_ = event_base_new();
-    htp_ = evhtp_new(evbase_, NULL);
-    evhtp_set_gencb(htp_, HTTPServerImpl::Dispatch, this);
-    evhtp_use_threads_wexit(htp_, NULL, NULL, thread_cnt_, NULL);
-    evhtp_bind_socket(htp_, "0.0.0.0", port_, 1024);
+  if (!listeners_.empty()) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_ALREADY_EXISTS, "HTTP server is already running.");
+  }
+
+  // The request handling threads are divided across the listeners.
+  const int listener_thread_cnt = std::max(1, thread_cnt_ / listener_cnt_);
+  // Multiple listeners are each pinned to one CPU, taken from the
+  // server's CPUs if isolated.
+  const int cpu_cnt = std::max(1U, std::thread::hardware_concurrency());
+
+  for (int i = 0; i < listener_cnt_; ++i) {
+    std::unique_ptr<Listener> listener(new Listener());
+    if (listener_cnt_ == 1) {
+      listener->cpus_ = cpus_;
+    } else if (cpus_.empty()) {
+      listener->cpus_.push_back(i % cpu_cnt);
+    } else {
+      listener->cpus_.push_back(cpus_[i % cpus_.size()]);
+    }
+    listener->evbase_ = event_base_new();
+    listener->htp_ = evhtp_new(listener->evbase_, NULL);
+    evhtp_set_gencb(listener->htp_, HTTPServerImpl::Dispatch, this);
+    evhtp_use_threads_wexit(
+        listener->htp_, InitThread, NULL,
+        listener_thread_cnt, listener.get());
+    if (listener_cnt_ > 1) {
+      evhtp_enable_flag(listener->htp_, EVHTP_FLAG_ENABLE_REUSEPORT);
+    }
+    if (evhtp_bind_socket(listener->htp_, "0.0.0.0", port_, 1024) != 0) {
+      evhtp_free(listener->htp_);
+      event_base_free(listener->evbase_);
+      Stop();
+      return TRTSERVER_ErrorNew(
+          TRTSERVER_ERROR_UNAVAILABLE,
+          ("failed to bind HTTP listener to port " + std::to_string(port_))
+              .c_str());
+    }
+
     // Set listening event for breaking event loop
-    evutil_socketpair(AF_UNIX, SOCK_STREAM, 0, fds_);
-    break_ev_ = event_new(evbase_, fds_[0], EV_READ, StopCallback, evbase_);
-    event_add(break_ev_, NULL);
-    worker_ = std::thread(event_base_loop, evbase_, 0);
-    return nullptr;
+    evutil_socketpair(AF_UNIX, SOCK_STREAM, 0, listener->fds_);
+    listener->break_ev_ = event_new(
+        listener->evbase_, listener->fds_[0], EV_READ, StopCallback,
+        listener->evbase_);
+    event_add(listener->break_ev_, NULL);
+
+    Listener* l = listener.get();
+    listener->worker_ = std::thread([l] {
+      InitCurrentThread(l->cpus_);
+      event_base_loop(l->evbase_, 0);
+    });
+
+    listeners_.emplace_back(std::move(listener));
   }
 
-  return TRTSERVER_ErrorNew(
-      TRTSERVER_ERROR_ALREADY_EXISTS, "HTTP server is already running.");
+  return nullptr;
 }
 
 TRTSERVER_Error*
 HTTPServerImpl::Stop()
 {
-  if (worker_.joinable()) {
+  if (listeners_.empty()) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_UNAVAILABLE, "HTTP server is not running.");
+  }
+
+  for (auto& listener : listeners_) {
     // Notify event loop to break via fd write
-    send(fds_[1], &evbase_, sizeof(event_base*), 0);
-    worker_.join();
-    event_free(break_ev_);
-    evutil_closesocket(fds_[0]);
-    evutil_closesocket(fds_[1]);
-    evhtp_unbind_socket(htp_);
-    evhtp_free(htp_);
-    event_base_free(evbase_);
-    return nullptr;
+    send(listener->fds_[1], &listener->evbase_, sizeof(event_base*), 0);
+    listener->worker_.join();
+    event_free(listener->break_ev_);
+    evutil_closesocket(listener->fds_[0]);
+    evutil_closesocket(listener->fds_[1]);
+    evhtp_unbind_socket(listener->htp_);
+    evhtp_free(listener->htp_);
+    event_base_free(listener->evbase_);
   }
 
-  return TRTSERVER_ErrorNew(
-      TRTSERVER_ERROR_UNAVAILABLE, "HTTP server is not running.");
+  listeners_.clear();
+  return nullptr;
+}
+
+void
+HTTPServerImpl::InitThread(evhtp_t* htp, evthr_t* thr, void* arg)
+{
+  InitCurrentThread(static_cast<Listener*>(arg)->cpus_);
+}
+
+void
+HTTPServerImpl::InitCurrentThread(const std::vector<int>& cpus)
+{
+  // The thread name groups the CPU time of the HTTP threads in the
+  // metrics.
+  pthread_setname_np(pthread_self(), "trtis-http");
+  LOG_IF_ERR(SetCurrentThreadCpus(cpus), "failed to pin HTTP thread");
 }
 
 void
@@ -136,8 +487,11 @@ class HTTPMetricsServer : public HTTPServerImpl {
   explicit HTTPMetricsServer(
       const std::shared_ptr<TRTSERVER_Server>& server, const int32_t port,
       const int thread_cnt)
-      : HTTPServerImpl(port, thread_cnt), server_(server),
-        api_regex_(R"(/metrics/?)")
+      : HTTPServerImpl(
+            port, thread_cnt,
+            ServerThreadClassCpus(
+                server.get(), TRTSERVER_THREAD_CLASS_BACKGROUND)),
+        server_(server), api_regex_(R"(/metrics/?)")
   {
   }
 
@@ -196,17 +550,26 @@ class HTTPAPIServer : public HTTPServerImpl {
           trace_manager,
       const std::shared_ptr<SharedMemoryBlockManager>& smb_manager,
       const std::vector<std::string>& endpoints, const int32_t port,
-      const int thread_cnt)
-      : HTTPServerImpl(port, thread_cnt), server_(server),
-        trace_manager_(trace_manager), smb_manager_(smb_manager),
-        endpoint_names_(endpoints), allocator_(nullptr),
+      const int thread_cnt, const int listener_cnt,
+      const int compression_level)
+      : HTTPServerImpl(
+            port, thread_cnt,
+            ServerThreadClassCpus(
+                server.get(), TRTSERVER_THREAD_CLASS_FRONTEND),
+            listener_cnt),
+        server_(server), trace_manager_(trace_manager),
+        smb_manager_(smb_manager),
+        endpoint_names_(endpoints), compression_level_(compression_level),
+        allocator_(nullptr),
         api_regex_(
-            R"(/api/(health|infer|status|modelcontrol|sharedmemorycontrol)(.*))"),
+            R"(/api/(health|infer|status|modelcontrol|sharedmemorycontrol|)"
+            R"(profile)(.*))"),
         health_regex_(R"(/(live|ready))"),
         infer_regex_(R"(/([^/]+)(?:/(\d+))?)"), status_regex_(R"(/(.*))"),
         modelcontrol_regex_(R"(/(load|unload)/([^/]+))"),
         sharedmemorycontrol_regex_(
-            R"(/(register|unregister|status)(.*))")
+            R"(/(register|unregister|status)(.*))"),
+        profile_regex_(R"(/(nvtx|capture)/([^/]+))")
   {
     TRTSERVER_Error* err = TRTSERVER_ServerId(server_.get(), &server_id_);
     if (err != nullptr) {
@@ -227,9 +590,16 @@ class HTTPAPIServer : public HTTPServerImpl {
         "deleting response allocator");
   }
 
-  using EVBufferPair = std::pair<
-      evbuffer*,
-      std::unordered_map<std::string, std::pair<const void*, size_t>>>;
+  // Location of an output that the client requested be written to
+  // shared memory.
+  struct ShmInfo {
+    const void* base_;
+    size_t byte_size_;
+    TRTSERVER_Memory_Type memory_type_;
+  };
+
+  using TensorShmMap = std::unordered_map<std::string, ShmInfo>;
+  using EVBufferPair = std::pair<evbuffer*, TensorShmMap>;
 
   // Class object associated to evhtp thread, requests received are bounded
   // with the thread that accepts it. Need to keep track of that and let the
@@ -246,6 +616,7 @@ class HTTPAPIServer : public HTTPServerImpl {
     static void InferComplete(
         TRTSERVER_Server* server, TRTSERVER_Trace* trace,
         TRTSERVER_InferenceResponse* response, void* userp);
+    static bool IsCancelled(void* userp);
     evhtp_res FinalizeResponse(TRTSERVER_InferenceResponse* response);
 
 #ifdef TRTIS_ENABLE_TRACING
@@ -254,9 +625,15 @@ class HTTPAPIServer : public HTTPServerImpl {
 
     std::unique_ptr<EVBufferPair> response_pair_;
 
+    // The encoding and compression level to use for the response
+    // body.
+    CompressionType response_compression_;
+    int compression_level_;
+
    private:
     evhtp_request_t* req_;
     evthr_t* thread_;
+    evutil_socket_t sock_;
     const uint64_t request_id_;
     const char* const server_id_;
     const uint64_t unique_id_;
@@ -280,13 +657,23 @@ class HTTPAPIServer : public HTTPServerImpl {
       evhtp_request_t* req, const std::string& modelcontrol_uri);
   void HandleSharedMemoryControl(
       evhtp_request_t* req, const std::string& sharedmemorycontrol_uri);
+  void HandleProfile(evhtp_request_t* req, const std::string& profile_uri);
+
+  // A parsed NV-InferRequest header along with its binary
+  // serialization, which is what the request provider consumes.
+  struct ParsedRequestHeader {
+    InferRequestHeader header_;
+    std::string serialized_;
+  };
+
+  std::shared_ptr<const ParsedRequestHeader> ParseRequestHeader(
+      const std::string& format, const std::string& header);
 
   TRTSERVER_Error* EVBufferToInput(
       const std::string& model_name, const InferRequestHeader& request_header,
       evbuffer* input_buffer,
       TRTSERVER_InferenceRequestProvider* request_provider,
-      std::unordered_map<std::string, std::pair<const void*, size_t>>&
-          output_shm_map);
+      TensorShmMap& output_shm_map);
 
   static void OKReplyCallback(evthr_t* thr, void* arg, void* shared);
   static void BADReplyCallback(evthr_t* thr, void* arg, void* shared);
@@ -298,6 +685,10 @@ class HTTPAPIServer : public HTTPServerImpl {
   std::shared_ptr<SharedMemoryBlockManager> smb_manager_;
   std::vector<std::string> endpoint_names_;
 
+  // The zlib compression level for response bodies, or 0 if
+  // responses are never compressed.
+  const int compression_level_;
+
   // The allocator that will be used to allocate buffers for the
   // inference result tensors.
   TRTSERVER_ResponseAllocator* allocator_;
@@ -308,6 +699,14 @@ class HTTPAPIServer : public HTTPServerImpl {
   re2::RE2 status_regex_;
   re2::RE2 modelcontrol_regex_;
   re2::RE2 sharedmemorycontrol_regex_;
+  re2::RE2 profile_regex_;
+
+  // Parsed request headers keyed by the header format and the header
+  // string. Clients typically send the same header for every request
+  // so this avoids reparsing and reserializing it each time.
+  std::mutex request_header_cache_mu_;
+  std::unordered_map<std::string, std::shared_ptr<const ParsedRequestHeader>>
+      request_header_cache_;
 };
 
 TRTSERVER_Error*
@@ -318,36 +717,67 @@ HTTPAPIServer::ResponseAlloc(
 {
   auto userp_pair = reinterpret_cast<EVBufferPair*>(userp);
   evbuffer* evhttp_buffer = reinterpret_cast<evbuffer*>(userp_pair->first);
-  const std::unordered_map<std::string, std::pair<const void*, size_t>>&
-      output_shm_map = userp_pair->second;
+  const TensorShmMap& output_shm_map = userp_pair->second;
 
   *buffer = nullptr;
   *buffer_userp = nullptr;
 
   // Don't need to do anything if no memory was requested.
   if (byte_size > 0) {
-    // Can't allocate for any memory type other than CPU.
-    if (memory_type != TRTSERVER_MEMORY_CPU) {
+    auto pr = output_shm_map.find(tensor_name);
+
+    // Outputs in shared memory can only be written to the memory type
+    // of the shared memory block. All other outputs are written into
+    // the evbuffer and so can only be CPU.
+    const TRTSERVER_Memory_Type out_memory_type =
+        (pr != output_shm_map.end()) ? pr->second.memory_type_
+                                     : TRTSERVER_MEMORY_CPU;
+    if (memory_type != out_memory_type) {
       LOG_VERBOSE(1) << "HTTP allocation failed for type " << memory_type
                      << " for " << tensor_name;
       return nullptr;
     }
 
-    auto pr = output_shm_map.find(tensor_name);
     if (pr != output_shm_map.end()) {
       // If the output is in shared memory then check that the expected buffer
       // size is at least the byte size of the output.
-      if (byte_size > pr->second.second) {
+      if (byte_size > pr->second.byte_size_) {
         return TRTSERVER_ErrorNew(
             TRTSERVER_ERROR_INTERNAL,
             std::string(
                 "expected buffer size to be at least " +
-                std::to_string(pr->second.second) + " bytes but gets " +
+                std::to_string(pr->second.byte_size_) + " bytes but gets " +
                 std::to_string(byte_size) + " bytes in output tensor")
                 .c_str());
       }
 
-      *buffer = const_cast<void*>(pr->second.first);
+      *buffer = const_cast<void*>(pr->second.base_);
+    } else if (byte_size >= kReferencedOutputByteSize) {
+      // Growing the evbuffer to reserve space for a large output may
+      // move the outputs already in its last chain, so a large output
+      // gets a buffer of its own instead. The buffer is appended to
+      // the evbuffer by reference, so it is sent without being copied,
+      // and it is freed once the response is sent or drained.
+      void* output_buffer = malloc(byte_size);
+      if (output_buffer == nullptr) {
+        return TRTSERVER_ErrorNew(
+            TRTSERVER_ERROR_INTERNAL,
+            std::string(
+                "failed to allocate " + std::to_string(byte_size) +
+                " bytes for output tensor buffer")
+                .c_str());
+      }
+
+      if (evbuffer_add_reference(
+              evhttp_buffer, output_buffer, byte_size, FreeReferencedOutput,
+              nullptr) != 0) {
+        free(output_buffer);
+        return TRTSERVER_ErrorNew(
+            TRTSERVER_ERROR_INTERNAL,
+            "failed to add output tensor buffer to output buffer");
+      }
+
+      *buffer = output_buffer;
     } else {
       // Reserve requested space in evbuffer...
       struct evbuffer_iovec output_iovec;
@@ -402,7 +832,8 @@ HTTPAPIServer::ResponseRelease(
                  << "size " << byte_size << ", addr " << buffer;
 
   // Don't do anything when releasing a buffer since ResponseAlloc
-  // wrote directly into the response ebvuffer.
+  // wrote directly into the response ebvuffer, or into a buffer that
+  // the evbuffer frees once it no longer references it.
   return nullptr;  // Success
 }
 
@@ -452,6 +883,13 @@ HTTPAPIServer::Handle(evhtp_request_t* req)
       HandleSharedMemoryControl(req, rest);
       return;
     }
+    // profile
+    if (endpoint == "profile" &&
+        (std::find(endpoint_names_.begin(), endpoint_names_.end(), "profile") !=
+         endpoint_names_.end())) {
+      HandleProfile(req, rest);
+      return;
+    }
   }
 
   LOG_VERBOSE(1) << "HTTP error: " << req->method << " " << req->uri->path->full
@@ -519,10 +957,18 @@ HTTPAPIServer::HandleStatus(evhtp_request_t* req, const std::string& status_uri)
     }
   }
 
+  // Only the models that changed since an earlier status?
+  uint64_t since_generation = 0;
+  const char* since_c_str = evhtp_kv_find(req->uri->query, "since_generation");
+  if (since_c_str != NULL) {
+    since_generation = std::strtoull(since_c_str, nullptr, 10);
+  }
+
   TRTSERVER_Protobuf* server_status_protobuf = nullptr;
   TRTSERVER_Error* err =
       (model_name.empty())
-          ? TRTSERVER_ServerStatus(server_.get(), &server_status_protobuf)
+          ? TRTSERVER_ServerStatusSince(
+                server_.get(), since_generation, &server_status_protobuf)
           : TRTSERVER_ServerModelStatus(
                 server_.get(), model_name.c_str(), &server_status_protobuf);
   if (err == nullptr) {
@@ -626,6 +1072,70 @@ HTTPAPIServer::HandleModelControl(
   TRTSERVER_ErrorDelete(err);
 }
 
+void
+HTTPAPIServer::HandleProfile(
+    evhtp_request_t* req, const std::string& profile_uri)
+{
+  if (req->method != htp_method_POST) {
+    evhtp_send_reply(req, EVHTP_RES_METHNALLOWED);
+    return;
+  }
+
+  std::string action_type_str, value;
+  if ((profile_uri.empty()) ||
+      (!RE2::FullMatch(
+          profile_uri, profile_regex_, &action_type_str, &value))) {
+    evhtp_send_reply(req, EVHTP_RES_BADREQ);
+    return;
+  }
+
+  TRTSERVER_Error* err = nullptr;
+  if (action_type_str == "nvtx") {
+    // Toggle the ranges of the front-ends as well as those of the
+    // server library.
+    if ((value == "on") || (value == "off")) {
+      err = TRTSERVER_ServerSetNvtxEnabled(server_.get(), value == "on");
+#ifdef TRTIS_ENABLE_NVTX
+      if (err == nullptr) {
+        SetNvtxEnabled(value == "on");
+      }
+#endif  // TRTIS_ENABLE_NVTX
+    } else {
+      err = TRTSERVER_ErrorNew(
+          TRTSERVER_ERROR_INVALID_ARG,
+          std::string("expected 'on' or 'off' for NVTX, got '" + value + "'")
+              .c_str());
+    }
+  } else {
+    uint64_t duration_ms = 0;
+    if (RE2::FullMatch(value, R"(\d+)", &duration_ms)) {
+      err = TRTSERVER_ServerStartProfile(server_.get(), duration_ms);
+    } else {
+      err = TRTSERVER_ErrorNew(
+          TRTSERVER_ERROR_INVALID_ARG,
+          std::string("invalid profile capture duration '" + value + "'")
+              .c_str());
+    }
+  }
+
+  RequestStatus request_status;
+  RequestStatusUtil::Create(
+      &request_status, err, RequestStatusUtil::NextUniqueRequestId(),
+      server_id_);
+
+  evhtp_headers_add_header(
+      req->headers_out,
+      evhtp_header_new(
+          kStatusHTTPHeader, request_status.ShortDebugString().c_str(), 1, 1));
+
+  evhtp_send_reply(
+      req, (request_status.code() == RequestStatusCode::SUCCESS)
+               ? EVHTP_RES_OK
+               : EVHTP_RES_BADREQ);
+
+  TRTSERVER_ErrorDelete(err);
+}
+
 void
 HTTPAPIServer::HandleSharedMemoryControl(
     evhtp_request_t* req, const std::string& sharedmemorycontrol_uri)
@@ -685,7 +1195,8 @@ HTTPAPIServer::HandleSharedMemoryControl(
 
   if (action_type_str == "register") {
     err = smb_manager_->Create(
-        &smb, name.c_str(), shm_key.c_str(), offset, byte_size);
+        &smb, name.c_str(), shm_key.c_str(), offset, byte_size,
+        false /* hugetlbfs */, false /* lock_pages */);
     if (err == nullptr) {
       err = TRTSERVER_ServerRegisterSharedMemory(server_.get(), smb);
     }
@@ -772,8 +1283,7 @@ HTTPAPIServer::EVBufferToInput(
     const std::string& model_name, const InferRequestHeader& request_header,
     evbuffer* input_buffer,
     TRTSERVER_InferenceRequestProvider* request_provider,
-    std::unordered_map<std::string, std::pair<const void*, size_t>>&
-        output_shm_map)
+    TensorShmMap& output_shm_map)
 {
   // Extract individual input data from HTTP body and register in
   // 'request_provider'. The input data from HTTP body is not
@@ -831,9 +1341,13 @@ HTTPAPIServer::EVBufferToInput(
         RETURN_IF_ERR(TRTSERVER_ServerSharedMemoryAddress(
             server_.get(), smb, io.shared_memory().offset(),
             io.shared_memory().byte_size(), &base));
+        TRTSERVER_Memory_Type memory_type;
+        int64_t memory_type_id;
+        RETURN_IF_ERR(TRTSERVER_SharedMemoryBlockMemoryType(
+            smb, &memory_type, &memory_type_id));
         RETURN_IF_ERR(TRTSERVER_InferenceRequestProviderSetInputData(
             request_provider, io.name().c_str(), base, byte_size,
-            TRTSERVER_MEMORY_CPU));
+            memory_type));
       } else {
         while ((byte_size > 0) && (v_idx < n)) {
           char* base = static_cast<char*>(v[v_idx].iov_base);
@@ -885,10 +1399,13 @@ HTTPAPIServer::EVBufferToInput(
       RETURN_IF_ERR(TRTSERVER_ServerSharedMemoryAddress(
           server_.get(), smb, io.shared_memory().offset(),
           io.shared_memory().byte_size(), &base));
+      TRTSERVER_Memory_Type memory_type;
+      int64_t memory_type_id;
+      RETURN_IF_ERR(TRTSERVER_SharedMemoryBlockMemoryType(
+          smb, &memory_type, &memory_type_id));
       output_shm_map.emplace(
-          io.name(),
-          std::make_pair(
-              static_cast<const void*>(base), io.shared_memory().byte_size()));
+          io.name(), ShmInfo{static_cast<const void*>(base),
+                             io.shared_memory().byte_size(), memory_type});
     }
   }
 
@@ -898,6 +1415,8 @@ HTTPAPIServer::EVBufferToInput(
 void
 HTTPAPIServer::HandleInfer(evhtp_request_t* req, const std::string& infer_uri)
 {
+  NVTX_RANGE(nvtx_, "HTTP infer");
+
   if (req->method != htp_method_POST) {
     evhtp_send_reply(req, EVHTP_RES_METHNALLOWED);
     return;
@@ -934,22 +1453,67 @@ HTTPAPIServer::HandleInfer(evhtp_request_t* req, const std::string& infer_uri)
   }
 #endif  // TRTIS_ENABLE_TRACING
 
-  std::string infer_request_header(
-      evhtp_kv_find(req->headers_in, kInferRequestHTTPHeader));
+  // The request header is in text format by default. Query parameter
+  // request_format=binary indicates a base64 encoded binary
+  // serialization and request_format=json indicates JSON.
+  std::string request_format("text");
+  const char* request_format_c_str =
+      evhtp_kv_find(req->uri->query, "request_format");
+  if (request_format_c_str != NULL) {
+    request_format = std::string(request_format_c_str);
+  }
 
-  InferRequestHeader request_header;
-  if (!google::protobuf::TextFormat::ParseFromString(
-          infer_request_header, &request_header)) {
-    evhtp_send_reply(req, EVHTP_RES_BADREQ);
-    return;
+  std::string infer_request_header;
+  const char* infer_request_header_c_str =
+      evhtp_kv_find(req->headers_in, kInferRequestHTTPHeader);
+  if (infer_request_header_c_str != NULL) {
+    infer_request_header = std::string(infer_request_header_c_str);
   }
 
-  std::string request_header_serialized;
-  if (!request_header.SerializeToString(&request_header_serialized)) {
+  std::shared_ptr<const ParsedRequestHeader> parsed_header =
+      ParseRequestHeader(request_format, infer_request_header);
+  if (parsed_header == nullptr) {
     evhtp_send_reply(req, EVHTP_RES_BADREQ);
     return;
   }
 
+  const InferRequestHeader& request_header = parsed_header->header_;
+  const std::string& request_header_serialized = parsed_header->serialized_;
+
+  // Decompress the request body in place so the input tensors
+  // continue to reference memory owned by 'req'.
+  const char* content_encoding_c_str =
+      evhtp_kv_find(req->headers_in, "Content-Encoding");
+  if (content_encoding_c_str != NULL) {
+    CompressionType content_encoding;
+    if (!ParseContentEncoding(content_encoding_c_str, &content_encoding)) {
+      evhtp_send_reply(req, EVHTP_RES_UNSUPPORTED);
+      return;
+    }
+
+    if (content_encoding != CompressionType::NONE) {
+      evbuffer* decompressed = evbuffer_new();
+      if (!DecompressEVBuffer(req->buffer_in, decompressed)) {
+        evbuffer_free(decompressed);
+        evhtp_send_reply(req, EVHTP_RES_BADREQ);
+        return;
+      }
+
+      evbuffer_drain(req->buffer_in, -1);
+      evbuffer_add_buffer(req->buffer_in, decompressed);
+      evbuffer_free(decompressed);
+    }
+  }
+
+  CompressionType response_compression = CompressionType::NONE;
+  if (compression_level_ > 0) {
+    const char* accept_encoding_c_str =
+        evhtp_kv_find(req->headers_in, "Accept-Encoding");
+    if (accept_encoding_c_str != NULL) {
+      response_compression = ParseAcceptEncoding(accept_encoding_c_str);
+    }
+  }
+
   uint64_t unique_id = RequestStatusUtil::NextUniqueRequestId();
 
   // Create the inference request provider which provides all the
@@ -969,6 +1533,8 @@ HTTPAPIServer::HandleInfer(evhtp_request_t* req, const std::string& infer_uri)
 
       response_pair->first = req->buffer_out;
       infer_request->response_pair_.reset(response_pair);
+      infer_request->response_compression_ = response_compression;
+      infer_request->compression_level_ = compression_level_;
 
       // Get the trace object to use for this request. If nullptr then
       // no tracing will be performed.
@@ -980,11 +1546,22 @@ HTTPAPIServer::HandleInfer(evhtp_request_t* req, const std::string& infer_uri)
       }
 #endif  // TRTIS_ENABLE_TRACING
 
-      err = TRTSERVER_ServerInferAsync(
-          server_.get(), trace, request_provider, allocator_,
-          reinterpret_cast<void*>(response_pair), InferRequest::InferComplete,
+      err = TRTSERVER_InferenceRequestProviderSetCancelledFn(
+          request_provider, InferRequest::IsCancelled,
           reinterpret_cast<void*>(infer_request));
+      if (err == nullptr) {
+        err = TRTSERVER_ServerInferAsync(
+            server_.get(), trace, request_provider, allocator_,
+            reinterpret_cast<void*>(response_pair),
+            InferRequest::InferComplete,
+            reinterpret_cast<void*>(infer_request));
+      }
       if (err != nullptr) {
+#ifdef TRTIS_ENABLE_TRACING
+        if (infer_request->tracer_ != nullptr) {
+          infer_request->tracer_->SetFailed();
+        }
+#endif  // TRTIS_ENABLE_TRACING
         delete infer_request;
         infer_request = nullptr;
       }
@@ -996,6 +1573,14 @@ HTTPAPIServer::HandleInfer(evhtp_request_t* req, const std::string& infer_uri)
   }
 
   if (err != nullptr) {
+#ifdef TRTIS_ENABLE_TRACING
+    // The tracer is still here if the request failed before it was
+    // handed to the request.
+    if (tracer != nullptr) {
+      tracer->SetFailed();
+    }
+#endif  // TRTIS_ENABLE_TRACING
+
     RequestStatus request_status;
     RequestStatusUtil::Create(&request_status, err, unique_id, server_id_);
 
@@ -1026,6 +1611,58 @@ HTTPAPIServer::HandleInfer(evhtp_request_t* req, const std::string& infer_uri)
   TRTSERVER_ErrorDelete(err);
 }
 
+std::shared_ptr<const HTTPAPIServer::ParsedRequestHeader>
+HTTPAPIServer::ParseRequestHeader(
+    const std::string& format, const std::string& header)
+{
+  const std::string key = format + ":" + header;
+  {
+    std::lock_guard<std::mutex> lock(request_header_cache_mu_);
+    const auto itr = request_header_cache_.find(key);
+    if (itr != request_header_cache_.end()) {
+      return itr->second;
+    }
+  }
+
+  std::shared_ptr<ParsedRequestHeader> parsed =
+      std::make_shared<ParsedRequestHeader>();
+  if (format == "binary") {
+    if (!Base64Decode(header, &parsed->serialized_) ||
+        !parsed->header_.ParseFromString(parsed->serialized_)) {
+      return nullptr;
+    }
+  } else {
+    if (format == "json") {
+      const auto status =
+          google::protobuf::util::JsonStringToMessage(header, &parsed->header_);
+      if (!status.ok()) {
+        return nullptr;
+      }
+    } else if (format == "text") {
+      if (!google::protobuf::TextFormat::ParseFromString(
+              header, &parsed->header_)) {
+        return nullptr;
+      }
+    } else {
+      return nullptr;
+    }
+
+    if (!parsed->header_.SerializeToString(&parsed->serialized_)) {
+      return nullptr;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(request_header_cache_mu_);
+    if (request_header_cache_.size() >= kMaxCachedRequestHeaders) {
+      request_header_cache_.clear();
+    }
+    request_header_cache_.emplace(key, parsed);
+  }
+
+  return parsed;
+}
+
 void
 HTTPAPIServer::OKReplyCallback(evthr_t* thr, void* arg, void* shared)
 {
@@ -1033,6 +1670,32 @@ HTTPAPIServer::OKReplyCallback(evthr_t* thr, void* arg, void* shared)
       reinterpret_cast<HTTPAPIServer::InferRequest*>(arg);
 
   evhtp_request_t* request = infer_request->EvHtpRequest();
+
+  // Compress here, on the connection's thread, instead of when the
+  // inference completes so backend threads aren't delayed.
+  if ((infer_request->response_compression_ != CompressionType::NONE) &&
+      (evbuffer_get_length(request->buffer_out) >= kMinCompressByteSize)) {
+    evbuffer* compressed = evbuffer_new();
+    if (CompressEVBuffer(
+            infer_request->response_compression_,
+            infer_request->compression_level_, request->buffer_out,
+            compressed)) {
+      evbuffer_drain(request->buffer_out, -1);
+      evbuffer_add_buffer(request->buffer_out, compressed);
+      evhtp_headers_add_header(
+          request->headers_out,
+          evhtp_header_new(
+              "Content-Encoding",
+              (infer_request->response_compression_ == CompressionType::GZIP)
+                  ? "gzip"
+                  : "deflate",
+              1, 1));
+    } else {
+      LOG_ERROR << "failed to compress HTTP response";
+    }
+    evbuffer_free(compressed);
+  }
+
   evhtp_send_reply(request, EVHTP_RES_OK);
   evhtp_request_resume(request);
 
@@ -1062,6 +1725,7 @@ HTTPAPIServer::BADReplyCallback(evthr_t* thr, void* arg, void* shared)
 
 #ifdef TRTIS_ENABLE_TRACING
   if (infer_request->tracer_ != nullptr) {
+    infer_request->tracer_->SetFailed();
     infer_request->tracer_->CaptureTimestamp(
         TRTSERVER_TRACE_LEVEL_MIN, "http send start",
         TIMESPEC_TO_NANOS(request->send_start_ts));
@@ -1077,14 +1741,32 @@ HTTPAPIServer::BADReplyCallback(evthr_t* thr, void* arg, void* shared)
 HTTPAPIServer::InferRequest::InferRequest(
     evhtp_request_t* req, uint64_t request_id, const char* server_id,
     uint64_t unique_id)
-    : req_(req), request_id_(request_id), server_id_(server_id),
+    : response_compression_(CompressionType::NONE), compression_level_(0),
+      req_(req), request_id_(request_id), server_id_(server_id),
       unique_id_(unique_id)
 {
   evhtp_connection_t* htpconn = evhtp_request_get_connection(req);
   thread_ = htpconn->thread;
+  sock_ = bufferevent_getfd(evhtp_connection_get_bev(htpconn));
   evhtp_request_pause(req);
 }
 
+bool
+HTTPAPIServer::InferRequest::IsCancelled(void* userp)
+{
+  // The connection isn't read while the request is paused, so peek at
+  // the socket to see if the client has closed or reset it. Called
+  // from the server's scheduler threads, the connection stays open
+  // until the request is resumed after completion.
+  HTTPAPIServer::InferRequest* infer_request =
+      reinterpret_cast<HTTPAPIServer::InferRequest*>(userp);
+  char byte;
+  const ssize_t cnt =
+      recv(infer_request->sock_, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+  return (cnt == 0) || ((cnt < 0) && (errno != EAGAIN) &&
+                        (errno != EWOULDBLOCK) && (errno != EINTR));
+}
+
 void
 HTTPAPIServer::InferRequest::InferComplete(
     TRTSERVER_Server* server, TRTSERVER_Trace* trace,
@@ -1190,6 +1872,7 @@ HTTPServer::CreateAPIServer(
     const std::shared_ptr<nvidia::inferenceserver::TraceManager>& trace_manager,
     const std::shared_ptr<SharedMemoryBlockManager>& smb_manager,
     const std::map<int32_t, std::vector<std::string>>& port_map, int thread_cnt,
+    int control_thread_cnt, int listener_cnt, int compression_level,
     std::vector<std::unique_ptr<HTTPServer>>* http_servers)
 {
   if (port_map.empty()) {
@@ -1202,9 +1885,17 @@ HTTPServer::CreateAPIServer(
   for (auto const& ep_map : port_map) {
     std::string addr = "0.0.0.0:" + std::to_string(ep_map.first);
     LOG_INFO << "Starting HTTPService at " << addr;
+
+    // A port that doesn't serve inference only handles lightweight
+    // control requests (health, status, ...), so it gets its own small
+    // pool of threads that inference load can't starve.
+    const bool serves_infer =
+        std::find(ep_map.second.begin(), ep_map.second.end(), "infer") !=
+        ep_map.second.end();
     http_servers->emplace_back(new HTTPAPIServer(
         server, trace_manager, smb_manager, ep_map.second, ep_map.first,
-        thread_cnt));
+        serves_infer ? thread_cnt : control_thread_cnt,
+        serves_infer ? listener_cnt : 1, compression_level));
   }
 
   return nullptr;
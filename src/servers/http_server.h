@@ -43,7 +43,8 @@ class HTTPServer {
           trace_manager,
       const std::shared_ptr<SharedMemoryBlockManager>& smb_manager,
       const std::map<int32_t, std::vector<std::string>>& port_map,
-      const int thread_cnt,
+      const int thread_cnt, const int control_thread_cnt,
+      const int listener_cnt, const int compression_level,
       std::vector<std::unique_ptr<HTTPServer>>* http_servers);
 
   static TRTSERVER_Error* CreateMetricsServer(
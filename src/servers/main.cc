@@ -33,6 +33,8 @@
 #include <csignal>
 #include <iostream>
 #include <mutex>
+#include <sstream>
+#include <unordered_map>
 
 #ifdef TRTIS_ENABLE_ASAN
 #include <sanitizer/lsan_interface.h>
@@ -56,6 +58,10 @@ static_assert(
 #include "src/servers/grpc_server.h"
 #endif  // TRTIS_ENABLE_GRPC
 
+#ifdef TRTIS_ENABLE_TRACING
+#include "src/servers/tracer.h"
+#endif  // TRTIS_ENABLE_TRACING
+
 namespace {
 
 // Exit mutex and cv used to signal the main thread that it should
@@ -80,9 +86,11 @@ std::vector<std::unique_ptr<nvidia::inferenceserver::HTTPServer>>
 bool allow_http_ = true;
 int32_t http_port_ = 8000;
 int32_t http_health_port_ = -1;
+int32_t http_status_port_ = -1;
 std::vector<int32_t> http_ports_;
 std::vector<std::string> endpoint_names = {
-    "status", "health", "infer", "modelcontrol", "sharedmemorycontrol"};
+    "status",       "health",  "infer", "modelcontrol", "sharedmemorycontrol",
+    "profile"};
 #endif  // TRTIS_ENABLE_HTTP
 
 #ifdef TRTIS_ENABLE_GRPC
@@ -101,6 +109,13 @@ int32_t metrics_port_ = 8002;
 std::string trace_filepath_;
 TRTSERVER_Trace_Level trace_level_ = TRTSERVER_TRACE_LEVEL_DISABLED;
 int32_t trace_rate_ = 1000;
+nvidia::inferenceserver::TraceManager::Format trace_format_ =
+    nvidia::inferenceserver::TraceManager::Format::JSON;
+
+// Tail-based sampling is enabled if any latency threshold or a
+// percentile is given.
+std::unordered_map<std::string, uint64_t> trace_tail_latencies_;
+double trace_tail_percentile_ = 0;
 #endif  // TRTIS_ENABLE_TRACING
 
 #ifdef TRTIS_ENABLE_GRPC
@@ -112,17 +127,55 @@ int grpc_infer_thread_cnt_ = 4;
 // requests.
 int grpc_stream_infer_thread_cnt_ = 4;
 
+// Whether the GRPC thread counts were given on the command line. If
+// not they are limited to the CPUs available to the front-end.
+bool grpc_infer_thread_cnt_given_ = false;
+bool grpc_stream_infer_thread_cnt_given_ = false;
+
 // The maximum number of inference request/response objects that
 // remain allocated for reuse. As long as the number of in-flight
 // requests doesn't exceed this value there will be no
 // allocation/deallocation of request/response objects. Higher values
-// trade-off increased memory usage for higher performance.
+// trade-off increased memory usage for higher performance. Fewer
+// objects are retained while the recent number of in-flight requests
+// is lower.
 int grpc_infer_allocation_pool_size_ = 128;
+
+// The compression algorithm and level that the GRPC front-end uses
+// by default for responses to clients that accept it.
+std::string grpc_compression_algorithm_ = "none";
+std::string grpc_compression_level_ = "none";
+
+// The GRPC endpoints of peer servers that Infer requests are
+// forwarded to when the model isn't available on this server.
+std::vector<std::string> grpc_peers_;
+
+// The maximum total size of the server-owned shared memory pool that
+// GRPC outputs can be returned in. 0 disables the pool.
+int64_t grpc_output_shm_pool_byte_size_ = 0;
 #endif  // TRTIS_ENABLE_GRPC
 
 #ifdef TRTIS_ENABLE_HTTP
 // The number of threads to initialize for the HTTP front-end.
 int http_thread_cnt_ = 8;
+
+// Whether the HTTP thread count was given on the command line. If not
+// it is limited to the CPUs available to the front-end.
+bool http_thread_cnt_given_ = false;
+
+// The number of threads to initialize for HTTP ports that don't serve
+// inference requests.
+int http_control_thread_cnt_ = 2;
+
+// The number of independent listeners accepting HTTP connections on
+// each port. With more than one listener the port is shared using
+// SO_REUSEPORT and the HTTP threads are divided among the listeners.
+int http_listener_cnt_ = 1;
+
+// The zlib compression level used for HTTP inference responses when
+// the client accepts gzip or deflate encoding. 0 disables response
+// compression.
+int http_compression_level_ = 0;
 #endif  // TRTIS_ENABLE_HTTP
 
 // Command-line options
@@ -132,16 +185,25 @@ enum OptionId {
   OPTION_LOG_INFO,
   OPTION_LOG_WARNING,
   OPTION_LOG_ERROR,
+  OPTION_LOG_ASYNC,
   OPTION_ID,
   OPTION_MODEL_REPOSITORY,
   OPTION_EXIT_ON_ERROR,
   OPTION_STRICT_MODEL_CONFIG,
+  OPTION_MODEL_CONFIG_CACHE_DIR,
+  OPTION_MODEL_STARTUP_SNAPSHOT,
+  OPTION_INSTANCE_PLACEMENT,
+  OPTION_CPU_ISOLATION,
   OPTION_STRICT_READINESS,
 #ifdef TRTIS_ENABLE_HTTP
   OPTION_ALLOW_HTTP,
   OPTION_HTTP_PORT,
   OPTION_HTTP_HEALTH_PORT,
+  OPTION_HTTP_STATUS_PORT,
   OPTION_HTTP_THREAD_COUNT,
+  OPTION_HTTP_CONTROL_THREAD_COUNT,
+  OPTION_HTTP_LISTENER_COUNT,
+  OPTION_HTTP_COMPRESSION_LEVEL,
 #endif  // TRTIS_ENABLE_HTTP
 #ifdef TRTIS_ENABLE_GRPC
   OPTION_ALLOW_GRPC,
@@ -149,25 +211,51 @@ enum OptionId {
   OPTION_GRPC_INFER_THREAD_COUNT,
   OPTION_GRPC_STREAM_INFER_THREAD_COUNT,
   OPTION_GRPC_INFER_ALLOCATION_POOL_SIZE,
+  OPTION_GRPC_COMPRESSION_ALGORITHM,
+  OPTION_GRPC_COMPRESSION_LEVEL,
+  OPTION_GRPC_PEER,
+  OPTION_GRPC_OUTPUT_SHM_POOL_BYTE_SIZE,
 #endif  // TRTIS_ENABLE_GRPC
 #ifdef TRTIS_ENABLE_METRICS
   OPTION_ALLOW_METRICS,
   OPTION_ALLOW_GPU_METRICS,
   OPTION_METRICS_PORT,
+  OPTION_METRICS_LATENCY_BUCKETS,
+  OPTION_METRICS_CACHE_MAX_AGE,
+  OPTION_GPU_METRICS_POLL_INTERVAL,
 #endif  // TRTIS_ENABLE_METRICS
 #ifdef TRTIS_ENABLE_TRACING
   OPTION_TRACE_FILEPATH,
   OPTION_TRACE_LEVEL,
   OPTION_TRACE_RATE,
+  OPTION_TRACE_FORMAT,
+  OPTION_TRACE_TAIL_LATENCY,
+  OPTION_TRACE_TAIL_PERCENTILE,
 #endif  // TRTIS_ENABLE_TRACING
   OPTION_ALLOW_POLL_REPO,
   OPTION_POLL_REPO_SECS,
   OPTION_ALLOW_MODEL_CONTROL,
+  OPTION_ALLOW_MODEL_LOAD_ON_DEMAND,
+  OPTION_MODEL_GPU_MEMORY_BUDGET,
   OPTION_STARTUP_MODEL,
   OPTION_EXIT_TIMEOUT_SECS,
+  OPTION_PINNED_MEMORY_POOL_BYTE_SIZE,
+  OPTION_MODEL_LOAD_THREAD_COUNT,
+  OPTION_MODEL_LOAD_GPU_LIMIT,
+  OPTION_MODEL_LOAD_STORAGE_LIMIT,
+  OPTION_MODEL_MEMORY_ESTIMATE_DIR,
+  OPTION_RATE_LIMIT_GPU_SLOTS,
+  OPTION_RATE_LIMIT_RESOURCE,
+  OPTION_RESPONSE_CACHE_BYTE_SIZE,
+  OPTION_STATUS_SNAPSHOT_INTERVAL,
   OPTION_TF_ALLOW_SOFT_PLACEMENT,
   OPTION_TF_GPU_MEMORY_FRACTION,
   OPTION_TF_ADD_VGPU,
+  OPTION_TRT_ENGINE_CACHE_DIR,
+  OPTION_REMOTE_REPO_CACHE_DIR,
+  OPTION_REMOTE_REPO_CACHE_BYTE_SIZE,
+  OPTION_REMOTE_REPO_DOWNLOAD_PART_BYTE_SIZE,
+  OPTION_REMOTE_REPO_DOWNLOAD_CONCURRENCY,
 };
 
 struct Option {
@@ -198,6 +286,10 @@ std::vector<Option> options_{
     {OPTION_LOG_INFO, "log-info", "Enable/disable info-level logging"},
     {OPTION_LOG_WARNING, "log-warning", "Enable/disable warning-level logging"},
     {OPTION_LOG_ERROR, "log-error", "Enable/disable error-level logging"},
+    {OPTION_LOG_ASYNC, "log-async",
+     "Enable/disable writing the log from a background thread. When "
+     "enabled, messages logged faster than they can be written are "
+     "dropped instead of delaying the logging thread. Default is false."},
     {OPTION_ID, "id", "Identifier for this server"},
     {OPTION_MODEL_REPOSITORY, "model-store",
      "Path to model repository directory. It may be specified multiple times "
@@ -217,6 +309,38 @@ std::vector<Option> options_{
      "configuration settings must be specified. If false the model "
      "configuration may be absent or only partially specified and the "
      "server will attempt to derive the missing required configuration."},
+    {OPTION_MODEL_CONFIG_CACHE_DIR, "model-config-cache-dir",
+     "Directory where the model configurations derived when "
+     "--strict-model-config=false are cached, so that they are only derived "
+     "again for the models whose files have changed, even after the server "
+     "restarts. The directory must exist. By default the derived "
+     "configurations are only cached while the server runs."},
+    {OPTION_MODEL_STARTUP_SNAPSHOT, "model-startup-snapshot",
+     "File where the resolved configurations and placements of the models "
+     "in the model repositories are recorded. When the file exists at "
+     "startup the recorded models start loading immediately, before the "
+     "model repositories are polled, and only the models whose files have "
+     "changed since are reloaded. Ignored when "
+     "--allow-model-control=true."},
+    {OPTION_INSTANCE_PLACEMENT, "instance-placement",
+     "How to place the instances of the KIND_GPU instance groups that don't "
+     "list their GPUs. With 'none' a group has 'count' instances on every "
+     "GPU. With 'balanced' a group has 'count' instances in total, each "
+     "placed on the GPU with the least estimated memory and instances of "
+     "the models placed so far. With 'pack' each instance is placed on the "
+     "GPU with the most estimated memory and instances that still has room "
+     "for it. Default is 'none'."},
+    {OPTION_CPU_ISOLATION, "cpu-isolation",
+     "The host CPUs that a class of server threads runs on, so that the "
+     "classes don't compete for the same cores. Input should be a class "
+     "and a Linux CPU list separated by a colon in the format "
+     "<class>:<cpu list>, for example frontend:0-3. The classes are "
+     "'frontend' for the HTTP and GRPC threads, 'scheduler' for the "
+     "threads that run the models, 'backend' for the thread pools of the "
+     "frameworks and 'background' for the model loading, metrics and "
+     "status threads. This option can be used multiple times, once per "
+     "class. Classes that aren't given run on all the CPUs available to "
+     "the server. By default no threads are bound."},
     {OPTION_STRICT_READINESS, "strict-readiness",
      "If true /api/health/ready endpoint indicates ready if the server "
      "is responsive and all models are available. If false "
@@ -229,8 +353,30 @@ std::vector<Option> options_{
      "The port for the server to listen on for HTTP requests."},
     {OPTION_HTTP_HEALTH_PORT, "http-health-port",
      "The port for the server to listen on for HTTP Health requests."},
+    {OPTION_HTTP_STATUS_PORT, "http-status-port",
+     "The port for the server to listen on for HTTP Status requests."},
     {OPTION_HTTP_THREAD_COUNT, "http-thread-count",
-     "Number of threads handling HTTP requests."},
+     "Number of threads handling HTTP requests. Default is 8, or the "
+     "number of CPUs available to the front-end if fewer, which takes "
+     "--cpu-isolation and the CPU quota of the server's cgroup into "
+     "account."},
+    {OPTION_HTTP_CONTROL_THREAD_COUNT, "http-control-thread-count",
+     "Number of threads handling HTTP requests on ports that do not serve "
+     "inference requests, for example when --http-health-port and "
+     "--http-status-port differ from --http-port. Using a separate port "
+     "keeps health probes responsive under heavy inference load. Default "
+     "is 2."},
+    {OPTION_HTTP_LISTENER_COUNT, "http-listener-count",
+     "Number of listeners accepting HTTP connections on each port. When "
+     "greater than 1 each listener binds the port with SO_REUSEPORT, runs "
+     "its own event loop pinned to a CPU, and handles an equal share of "
+     "the HTTP threads. Default is 1."},
+    {OPTION_HTTP_COMPRESSION_LEVEL, "http-compression-level",
+     "The zlib compression level, 1 (fastest) to 9 (smallest), used to "
+     "compress HTTP inference responses of at least 1KB when the request's "
+     "Accept-Encoding allows gzip or deflate. Default is 0 which disables "
+     "response compression. Compressed request bodies are always "
+     "accepted."},
 #endif  // TRTIS_ENABLE_HTTP
 #ifdef TRTIS_ENABLE_GRPC
     {OPTION_ALLOW_GRPC, "allow-grpc",
@@ -238,15 +384,36 @@ std::vector<Option> options_{
     {OPTION_GRPC_PORT, "grpc-port",
      "The port for the server to listen on for GRPC requests."},
     {OPTION_GRPC_INFER_THREAD_COUNT, "grpc-infer-thread-count",
-     "Number of threads handling GRPC inference requests."},
+     "Number of threads handling GRPC inference requests. Default is 4, "
+     "or the number of CPUs available to the front-end if fewer."},
     {OPTION_GRPC_STREAM_INFER_THREAD_COUNT, "grpc-stream-infer-thread-count",
-     "Number of threads handling GRPC stream inference requests."},
+     "Number of threads handling GRPC stream inference requests. Default "
+     "is 4, or the number of CPUs available to the front-end if fewer."},
     {OPTION_GRPC_INFER_ALLOCATION_POOL_SIZE, "grpc-infer-allocation-pool-size",
      "The maximum number of inference request/response objects that remain "
      "allocated for reuse. As long as the number of in-flight requests doesn't "
      "exceed this value there will be no allocation/deallocation of "
      "request/response objects. Higher values trade-off increased memory usage "
-     "for higher performance."},
+     "for higher performance. Fewer objects are retained while the recent "
+     "number of in-flight requests is lower."},
+    {OPTION_GRPC_COMPRESSION_ALGORITHM, "grpc-compression-algorithm",
+     "The compression algorithm, one of 'none', 'deflate' or 'gzip', used by "
+     "default for GRPC responses to clients that accept it. A client can "
+     "override the algorithm for its own responses. Default is 'none'."},
+    {OPTION_GRPC_COMPRESSION_LEVEL, "grpc-compression-level",
+     "The compression level, one of 'none', 'low', 'medium' or 'high', used by "
+     "default for GRPC responses. Default is 'none'."},
+    {OPTION_GRPC_PEER, "grpc-peer",
+     "The GRPC endpoint, as <host>:<port>, of a peer server. A GRPC Infer "
+     "request for a model that isn't available on this server, or whose "
+     "queue is full, is forwarded to a peer that serves the model. Can be "
+     "specified multiple times to add multiple peers."},
+    {OPTION_GRPC_OUTPUT_SHM_POOL_BYTE_SIZE, "grpc-output-shm-pool-byte-size",
+     "The maximum total size, in bytes, of the server-owned pool of system "
+     "shared memory blocks that GRPC inference outputs requesting "
+     "'server_shared_memory' are returned in. The client maps the block "
+     "named in the response and releases it once read. Default is 0, which "
+     "returns such outputs in the response."},
 #endif  // TRTIS_ENABLE_GRPC
 #ifdef TRTIS_ENABLE_METRICS
     {OPTION_ALLOW_METRICS, "allow-metrics",
@@ -256,6 +423,20 @@ std::vector<Option> options_{
      "is true."},
     {OPTION_METRICS_PORT, "metrics-port",
      "The port reporting prometheus metrics."},
+    {OPTION_METRICS_LATENCY_BUCKETS, "metrics-latency-buckets",
+     "Comma-separated upper bounds, in microseconds and in increasing order, "
+     "of the buckets of the inference request, queue and compute latency "
+     "histograms. Default is "
+     "'100,250,500,1000,2500,5000,10000,25000,50000,100000,250000,500000,"
+     "1000000,10000000'."},
+    {OPTION_METRICS_CACHE_MAX_AGE, "metrics-cache-max-age-ms",
+     "The maximum age, in milliseconds, of the serialized metrics returned "
+     "by a scrape. A scrape within that time of the previous one reuses "
+     "its serialized metrics instead of collecting them again. Default is "
+     "0, which collects the metrics for every scrape."},
+    {OPTION_GPU_METRICS_POLL_INTERVAL, "gpu-metrics-poll-interval-ms",
+     "The interval, in milliseconds, at which GPU metrics are collected, "
+     "independent of how often the metrics are scraped. Default is 2000."},
 #endif  // TRTIS_ENABLE_METRICS
 #ifdef TRTIS_ENABLE_TRACING
     {OPTION_TRACE_FILEPATH, "trace-file",
@@ -265,6 +446,21 @@ std::vector<Option> options_{
      "MAX for maximal tracing. Default is OFF."},
     {OPTION_TRACE_RATE, "trace-rate",
      "Set the trace sampling rate. Default is 1000."},
+    {OPTION_TRACE_FORMAT, "trace-format",
+     "Set the format of the trace file. JSON writes each trace as a JSON "
+     "object. BINARY buffers compact binary records per thread and writes "
+     "them from a background thread, which has much lower overhead; convert "
+     "the file with trace_convert.py. Default is JSON."},
+    {OPTION_TRACE_TAIL_LATENCY, "trace-tail-latency",
+     "Enable tail-based trace sampling with a latency threshold, in "
+     "microseconds, as <model>:<usec>, or as <usec> for the models without "
+     "their own threshold. Every request is traced but the trace is only "
+     "written if the request is sampled by 'trace-rate', fails, or takes "
+     "longer than the threshold. This option can be used multiple times."},
+    {OPTION_TRACE_TAIL_PERCENTILE, "trace-tail-percentile",
+     "Enable tail-based trace sampling where the latency threshold of a "
+     "model without an explicit 'trace-tail-latency' is the given "
+     "percentile of the latency of its recent requests, e.g. 99."},
 #endif  // TRTIS_ENABLE_TRACING
     {OPTION_ALLOW_POLL_REPO, "allow-poll-model-repository",
      "Poll the model repository to detect changes. The poll rate is "
@@ -278,6 +474,17 @@ std::vector<Option> options_{
      "If true the models in the model repository will not be loaded at "
      "startup, unless the model is specified by --load-model. Cannot be "
      "specified if --allow-poll-model-repository is true."},
+    {OPTION_ALLOW_MODEL_LOAD_ON_DEMAND, "allow-model-load-on-demand",
+     "Load a model that is not loaded when an inference request for it is "
+     "received. The requests for the model wait until it is loaded. "
+     "Implies --allow-model-control=true."},
+    {OPTION_MODEL_GPU_MEMORY_BUDGET, "model-gpu-memory-budget",
+     "The GPU memory that the models loaded on demand may use on a GPU. "
+     "When the budget is exceeded the least recently used models loaded "
+     "on demand are unloaded. Input should be 2 integers separated by a "
+     "colon in the format <GPU>:<budget in bytes>. This option can be "
+     "used multiple times, once per GPU. By default there is no budget. "
+     "Valid only when --allow-model-load-on-demand=true is specified."},
     {OPTION_STARTUP_MODEL, "load-model",
      "Name of the model to be loaded on server startup. It may be specified "
      "multiple times to add multiple models. Note that this option will only "
@@ -286,6 +493,57 @@ std::vector<Option> options_{
      "Timeout (in seconds) when exiting to wait for in-flight inferences to "
      "finish. After the timeout expires the server exits even if inferences "
      "are still in flight."},
+    {OPTION_PINNED_MEMORY_POOL_BYTE_SIZE, "pinned-memory-pool-byte-size",
+     "The total byte size of the pinned host memory that the server can "
+     "allocate to stage tensors copied to and from GPU memory. When the "
+     "pool is exhausted, or if the size is 0, regular host memory is used "
+     "instead. Default is 256 MB."},
+    {OPTION_MODEL_LOAD_THREAD_COUNT, "model-load-thread-count",
+     "The number of threads that load models, which bounds how many "
+     "models are loaded in parallel. Models that other models depend "
+     "on, such as the models composing an ensemble, are always loaded "
+     "first. Default is 4."},
+    {OPTION_MODEL_LOAD_GPU_LIMIT, "model-load-gpu-limit",
+     "The maximum number of models with instances on the same GPU that "
+     "are loaded at the same time. Default is 0, which indicates no "
+     "limit other than --model-load-thread-count."},
+    {OPTION_MODEL_LOAD_STORAGE_LIMIT, "model-load-storage-limit",
+     "The maximum number of models that are loaded at the same time "
+     "from the same storage: the local file system, Google Cloud Storage "
+     "or Amazon S3. Default is 0, which indicates no limit other than "
+     "--model-load-thread-count."},
+    {OPTION_MODEL_MEMORY_ESTIMATE_DIR, "model-memory-estimate-dir",
+     "Directory where the GPU memory used by each instance of each model "
+     "version is recorded once the version loads. A model version is only "
+     "loaded if every GPU it has instances on has enough free memory for "
+     "its recorded estimate, otherwise the load fails with an error. The "
+     "directory must exist. By default the estimates are not recorded and "
+     "only apply to later loads by the same server."},
+    {OPTION_RATE_LIMIT_GPU_SLOTS, "rate-limit-gpu-slots",
+     "The number of batches that may execute concurrently on each GPU, "
+     "across all models. A model instance waits for a free slot before it "
+     "executes a batch, and instances of models with a higher rate "
+     "limiter priority are given slots first. Default is 0, which "
+     "indicates that GPU execution is not limited."},
+    {OPTION_RATE_LIMIT_RESOURCE, "rate-limit-resource",
+     "A named resource that model instances hold while they execute a "
+     "batch, as given by the rate_limiter setting of the model "
+     "configuration. Input should be a name and an integer separated by "
+     "a colon in the format <name>:<count>. This option can be used "
+     "multiple times, once per resource."},
+    {OPTION_RESPONSE_CACHE_BYTE_SIZE, "response-cache-byte-size",
+     "The total byte size of the host memory that the response cache can "
+     "use to hold the outputs of the models that enable the response "
+     "cache in their configuration. When the cache is full the "
+     "least-recently used responses are evicted. Default is 0, which "
+     "disables the response cache."},
+    {OPTION_STATUS_SNAPSHOT_INTERVAL, "status-snapshot-interval-ms",
+     "The interval, in milliseconds, at which the server refreshes a "
+     "snapshot of the status of all models. Status requests are served "
+     "from the latest snapshot without blocking inference statistics "
+     "updates, and may ask for only the models that changed since the "
+     "generation of an earlier status. Default is 0, which disables "
+     "snapshots so that each status request builds the current status."},
     {OPTION_TF_ALLOW_SOFT_PLACEMENT, "tf-allow-soft-placement",
      "Instruct TensorFlow to use CPU implementation of an operation when "
      "a GPU implementation is not available."},
@@ -300,7 +558,36 @@ std::vector<Option> options_{
      "<physical GPU>;<number of virtual GPUs>;<memory limit per VGPU in "
      "megabytes>. This option can be used multiple times, but only once per "
      "physical GPU device. Subsequent uses will overwrite previous uses with "
-     "the same physical device. By default, no VGPUs are enabled."}};
+     "the same physical device. By default, no VGPUs are enabled."},
+    {OPTION_TRT_ENGINE_CACHE_DIR, "tensorrt-engine-cache-dir",
+     "Directory where TensorRT engines built from ONNX models are cached, "
+     "keyed by GPU, TensorRT version and model, so that later loads of "
+     "the models don't rebuild them. The engines built by the TensorRT "
+     "execution accelerator of ONNX Runtime models are cached in a "
+     "subdirectory for each model version, and so are the graphs "
+     "converted by the TensorRT execution accelerator of TensorFlow "
+     "GraphDef models. The directory must exist. By default built "
+     "engines are not cached."},
+    {OPTION_REMOTE_REPO_CACHE_DIR, "remote-repository-cache-dir",
+     "Directory where the files read from model repositories on Google "
+     "Cloud Storage or Amazon S3 are cached, keyed by the path and the "
+     "version of each object, so that loading a model again, also after "
+     "a restart, doesn't download the files that haven't changed. The "
+     "directory must exist. By default the files are not cached."},
+    {OPTION_REMOTE_REPO_CACHE_BYTE_SIZE, "remote-repository-cache-byte-size",
+     "The size of the files cached in --remote-repository-cache-dir "
+     "above which the least recently used files are removed. Default is "
+     "0, which indicates no limit."},
+    {OPTION_REMOTE_REPO_DOWNLOAD_PART_BYTE_SIZE,
+     "remote-repository-download-part-byte-size",
+     "Files are downloaded from model repositories on Google Cloud "
+     "Storage or Amazon S3 in parts of at most this many bytes, several "
+     "parts at the same time. Default is 64 MB."},
+    {OPTION_REMOTE_REPO_DOWNLOAD_CONCURRENCY,
+     "remote-repository-download-concurrency",
+     "The maximum number of parts of a file that are downloaded at the "
+     "same time from model repositories on Google Cloud Storage or "
+     "Amazon S3. Default is 8."}};
 
 void
 SignalHandler(int signum)
@@ -370,7 +657,9 @@ StartGrpcService(
 {
   TRTSERVER_Error* err = nvidia::inferenceserver::GRPCServer::Create(
       server, trace_manager, smb_manager, grpc_port_, grpc_infer_thread_cnt_,
-      grpc_stream_infer_thread_cnt_, grpc_infer_allocation_pool_size_, service);
+      grpc_stream_infer_thread_cnt_, grpc_infer_allocation_pool_size_,
+      grpc_compression_algorithm_, grpc_compression_level_, grpc_peers_,
+      service);
   if (err == nullptr) {
     err = (*service)->Start();
   }
@@ -394,7 +683,9 @@ StartHttpService(
     std::map<int32_t, std::vector<std::string>>& port_map)
 {
   TRTSERVER_Error* err = nvidia::inferenceserver::HTTPServer::CreateAPIServer(
-      server, trace_manager, smb_manager, port_map, http_thread_cnt_, services);
+      server, trace_manager, smb_manager, port_map, http_thread_cnt_,
+      http_control_thread_cnt_, http_listener_cnt_, http_compression_level_,
+      services);
   if (err == nullptr) {
     for (auto& http_eps : *services) {
       if (http_eps != nullptr) {
@@ -435,6 +726,35 @@ StartMetricsService(
 }
 #endif  // TRTIS_ENABLE_METRICS
 
+void
+LimitFrontendThreads(const std::shared_ptr<TRTSERVER_Server>& server)
+{
+  uint32_t cpu_cnt = 0;
+  LOG_IF_ERR(
+      TRTSERVER_ServerAvailableCpuCount(
+          server.get(), TRTSERVER_THREAD_CLASS_FRONTEND, &cpu_cnt),
+      "getting front-end CPU count");
+  if (cpu_cnt == 0) {
+    return;
+  }
+
+  const int limit = static_cast<int>(cpu_cnt);
+#ifdef TRTIS_ENABLE_HTTP
+  if (!http_thread_cnt_given_) {
+    http_thread_cnt_ = std::min(http_thread_cnt_, limit);
+  }
+#endif  // TRTIS_ENABLE_HTTP
+#ifdef TRTIS_ENABLE_GRPC
+  if (!grpc_infer_thread_cnt_given_) {
+    grpc_infer_thread_cnt_ = std::min(grpc_infer_thread_cnt_, limit);
+  }
+  if (!grpc_stream_infer_thread_cnt_given_) {
+    grpc_stream_infer_thread_cnt_ =
+        std::min(grpc_stream_infer_thread_cnt_, limit);
+  }
+#endif  // TRTIS_ENABLE_GRPC
+}
+
 bool
 StartEndpoints(
     const std::shared_ptr<TRTSERVER_Server>& server,
@@ -566,12 +886,17 @@ StartTracing(
   // Configure tracing if host is specified.
   if (trace_level_ != TRTSERVER_TRACE_LEVEL_DISABLED) {
     err = nvidia::inferenceserver::TraceManager::Create(
-        trace_manager, trace_filepath_);
+        trace_manager, trace_filepath_, trace_format_);
     if (err == nullptr) {
       err = (*trace_manager)->SetRate(trace_rate_);
       if (err == nullptr) {
         err = (*trace_manager)->SetLevel(trace_level_);
       }
+      if ((err == nullptr) && (!trace_tail_latencies_.empty() ||
+                               (trace_tail_percentile_ != 0))) {
+        err = (*trace_manager)->SetTailSampling(
+            trace_tail_latencies_, trace_tail_percentile_);
+      }
     }
   }
 
@@ -632,6 +957,12 @@ ParseIntOption(const std::string arg)
   return std::stoi(arg);
 }
 
+int64_t
+ParseLongLongOption(const std::string arg)
+{
+  return std::stoll(arg);
+}
+
 float
 ParseFloatOption(const std::string arg)
 {
@@ -655,6 +986,31 @@ ParseIntBoolOption(std::string arg)
   return ParseIntOption(arg);
 }
 
+#ifdef TRTIS_ENABLE_METRICS
+std::vector<double>
+ParseLatencyBucketsOption(const std::string arg)
+{
+  std::vector<double> buckets;
+  std::istringstream in(arg);
+  std::string bucket;
+  while (std::getline(in, bucket, ',')) {
+    try {
+      buckets.push_back(std::stod(bucket));
+    }
+    catch (const std::exception& ex) {
+      LOG_ERROR << "Cannot parse latency bucket '" << bucket
+                << "', --metrics-latency-buckets argument requires a "
+                   "comma-separated list of microseconds. Found: "
+                << arg;
+      LOG_ERROR << Usage();
+      exit(1);
+    }
+  }
+
+  return buckets;
+}
+#endif  // TRTIS_ENABLE_METRICS
+
 #ifdef TRTIS_ENABLE_TRACING
 TRTSERVER_Trace_Level
 ParseTraceLevelOption(std::string arg)
@@ -677,8 +1033,160 @@ ParseTraceLevelOption(std::string arg)
   LOG_ERROR << Usage();
   exit(1);
 }
+
+nvidia::inferenceserver::TraceManager::Format
+ParseTraceFormatOption(std::string arg)
+{
+  std::transform(arg.begin(), arg.end(), arg.begin(), [](unsigned char c) {
+    return std::tolower(c);
+  });
+
+  if (arg == "json") {
+    return nvidia::inferenceserver::TraceManager::Format::JSON;
+  }
+  if (arg == "binary") {
+    return nvidia::inferenceserver::TraceManager::Format::BINARY;
+  }
+
+  LOG_ERROR << "invalid value for trace format option: " << arg;
+  LOG_ERROR << Usage();
+  exit(1);
+}
+
+std::pair<std::string, uint64_t>
+ParseTraceTailLatencyOption(const std::string arg)
+{
+  // The model name may itself contain ':' so split at the last one.
+  const size_t delim = arg.rfind(":");
+  if ((delim == 0) ||
+      ((delim != std::string::npos) && (delim + 1 == arg.size()))) {
+    LOG_ERROR << "--trace-tail-latency argument requires format "
+                 "<model>:<usec> or <usec>. Found: "
+              << arg;
+    LOG_ERROR << Usage();
+    exit(1);
+  }
+
+  const std::string model_name =
+      (delim == std::string::npos) ? "" : arg.substr(0, delim);
+  const int64_t latency_us = ParseLongLongOption(
+      (delim == std::string::npos) ? arg : arg.substr(delim + 1));
+  if (latency_us < 0) {
+    LOG_ERROR << "--trace-tail-latency must be >= 0. Found: " << arg;
+    LOG_ERROR << Usage();
+    exit(1);
+  }
+
+  return std::make_pair(model_name, latency_us);
+}
 #endif  // TRTIS_ENABLE_TRACING
 
+TRTSERVER_Instance_Placement
+ParseInstancePlacementOption(std::string arg)
+{
+  std::transform(arg.begin(), arg.end(), arg.begin(), [](unsigned char c) {
+    return std::tolower(c);
+  });
+
+  if (arg == "none") {
+    return TRTSERVER_INSTANCE_PLACEMENT_NONE;
+  }
+  if (arg == "balanced") {
+    return TRTSERVER_INSTANCE_PLACEMENT_BALANCED;
+  }
+  if (arg == "pack") {
+    return TRTSERVER_INSTANCE_PLACEMENT_PACK;
+  }
+
+  LOG_ERROR << "invalid value for instance placement option: " << arg;
+  LOG_ERROR << Usage();
+  exit(1);
+}
+
+std::pair<TRTSERVER_Thread_Class, std::string>
+ParseCpuIsolationOption(const std::string arg)
+{
+  const size_t delim = arg.find(":");
+  if ((delim == std::string::npos) || (delim + 1 == arg.size())) {
+    LOG_ERROR << "--cpu-isolation argument requires format "
+                 "<class>:<cpu list>. Found: "
+              << arg;
+    LOG_ERROR << Usage();
+    exit(1);
+  }
+
+  std::string name = arg.substr(0, delim);
+  std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) {
+    return std::tolower(c);
+  });
+
+  TRTSERVER_Thread_Class thread_class;
+  if (name == "frontend") {
+    thread_class = TRTSERVER_THREAD_CLASS_FRONTEND;
+  } else if (name == "scheduler") {
+    thread_class = TRTSERVER_THREAD_CLASS_SCHEDULER;
+  } else if (name == "backend") {
+    thread_class = TRTSERVER_THREAD_CLASS_BACKEND;
+  } else if (name == "background") {
+    thread_class = TRTSERVER_THREAD_CLASS_BACKGROUND;
+  } else {
+    LOG_ERROR << "invalid thread class for --cpu-isolation: " << name;
+    LOG_ERROR << Usage();
+    exit(1);
+  }
+
+  return std::make_pair(thread_class, arg.substr(delim + 1));
+}
+
+std::pair<int, int64_t>
+ParseGpuMemoryBudgetOption(const std::string arg)
+{
+  const size_t delim = arg.find(":");
+  if ((delim == std::string::npos) || (delim == 0) ||
+      (delim + 1 == arg.size())) {
+    LOG_ERROR << "--model-gpu-memory-budget argument requires format "
+                 "<GPU>:<budget in bytes>. Found: "
+              << arg;
+    LOG_ERROR << Usage();
+    exit(1);
+  }
+
+  const int gpu_device = ParseIntOption(arg.substr(0, delim));
+  const int64_t byte_size = ParseLongLongOption(arg.substr(delim + 1));
+  if ((gpu_device < 0) || (byte_size < 0)) {
+    LOG_ERROR << "--model-gpu-memory-budget GPU and budget must be >= 0. "
+                 "Found: "
+              << arg;
+    LOG_ERROR << Usage();
+    exit(1);
+  }
+
+  return std::make_pair(gpu_device, byte_size);
+}
+
+std::pair<std::string, int>
+ParseRateLimitResourceOption(const std::string arg)
+{
+  const size_t delim = arg.rfind(":");
+  if ((delim == std::string::npos) || (delim == 0) ||
+      (delim + 1 == arg.size())) {
+    LOG_ERROR << "--rate-limit-resource argument requires format "
+                 "<name>:<count>. Found: "
+              << arg;
+    LOG_ERROR << Usage();
+    exit(1);
+  }
+
+  const int count = ParseIntOption(arg.substr(delim + 1));
+  if (count <= 0) {
+    LOG_ERROR << "--rate-limit-resource count must be > 0. Found: " << arg;
+    LOG_ERROR << Usage();
+    exit(1);
+  }
+
+  return std::make_pair(arg.substr(0, delim), count);
+}
+
 struct VgpuOption {
   int gpu_device_;
   int num_vgpus_;
@@ -753,13 +1261,36 @@ Parse(TRTSERVER_ServerOptions* server_options, int argc, char** argv)
   bool tf_allow_soft_placement = true;
   float tf_gpu_memory_fraction = 0.0;
   VgpuOption tf_vgpu;
+  std::string trt_engine_cache_dir;
+  std::string remote_repo_cache_dir;
+  int64_t remote_repo_cache_byte_size = 0;
+  int64_t remote_repo_download_part_byte_size = 64 * 1024 * 1024;
+  int32_t remote_repo_download_concurrency = 8;
   int32_t exit_timeout_secs = 30;
+  int64_t pinned_memory_pool_byte_size = 1 << 28;
+  int32_t model_load_thread_count = 4;
+  int32_t model_load_gpu_limit = 0;
+  int32_t model_load_storage_limit = 0;
+  std::string model_memory_estimate_dir;
+  std::string model_config_cache_dir;
+  std::string model_startup_snapshot;
+  TRTSERVER_Instance_Placement instance_placement =
+      TRTSERVER_INSTANCE_PLACEMENT_NONE;
+  std::map<TRTSERVER_Thread_Class, std::string> cpu_isolation;
+  int32_t rate_limit_gpu_slots = 0;
+  std::map<std::string, int> rate_limit_resources;
+  int64_t response_cache_byte_size = 0;
+  int64_t status_snapshot_interval_ms = 0;
   int32_t repository_poll_secs = repository_poll_secs_;
 
 #ifdef TRTIS_ENABLE_HTTP
   int32_t http_port = http_port_;
   int32_t http_thread_cnt = http_thread_cnt_;
+  int32_t http_listener_cnt = http_listener_cnt_;
+  int32_t http_compression_level = http_compression_level_;
   int32_t http_health_port = http_port_;
+  int32_t http_status_port = http_port_;
+  int32_t http_control_thread_cnt = http_control_thread_cnt_;
 #endif  // TRTIS_ENABLE_HTTP
 
 #ifdef TRTIS_ENABLE_GRPC
@@ -767,27 +1298,40 @@ Parse(TRTSERVER_ServerOptions* server_options, int argc, char** argv)
   int32_t grpc_infer_thread_cnt = grpc_infer_thread_cnt_;
   int32_t grpc_stream_infer_thread_cnt = grpc_stream_infer_thread_cnt_;
   int32_t grpc_infer_allocation_pool_size = grpc_infer_allocation_pool_size_;
+  std::string grpc_compression_algorithm = grpc_compression_algorithm_;
+  std::string grpc_compression_level = grpc_compression_level_;
+  std::vector<std::string> grpc_peers = grpc_peers_;
+  int64_t grpc_output_shm_pool_byte_size = grpc_output_shm_pool_byte_size_;
 #endif  // TRTIS_ENABLE_GRPC
 
 #ifdef TRTIS_ENABLE_METRICS
   int32_t metrics_port = metrics_port_;
   bool allow_gpu_metrics = true;
+  std::vector<double> metrics_latency_buckets;
+  int64_t metrics_cache_max_age_ms = 0;
+  int64_t gpu_metrics_poll_interval_ms = 2000;
 #endif  // TRTIS_ENABLE_METRICS
 
 #ifdef TRTIS_ENABLE_TRACING
   std::string trace_filepath = trace_filepath_;
   TRTSERVER_Trace_Level trace_level = trace_level_;
   int32_t trace_rate = trace_rate_;
+  nvidia::inferenceserver::TraceManager::Format trace_format = trace_format_;
+  std::unordered_map<std::string, uint64_t> trace_tail_latencies;
+  double trace_tail_percentile = trace_tail_percentile_;
 #endif  // TRTIS_ENABLE_TRACING
 
   bool allow_poll_model_repository = repository_poll_secs > 0;
   bool allow_model_control = allow_model_control_;
+  bool allow_model_load_on_demand = false;
+  std::map<int, int64_t> model_gpu_memory_budget;
   std::set<std::string> startup_models_;
 
   bool log_info = true;
   bool log_warn = true;
   bool log_error = true;
   int32_t log_verbose = 0;
+  bool log_async = false;
 
   std::vector<struct option> long_options;
   for (const auto& o : options_) {
@@ -815,6 +1359,9 @@ Parse(TRTSERVER_ServerOptions* server_options, int argc, char** argv)
       case OPTION_LOG_ERROR:
         log_error = ParseBoolOption(optarg);
         break;
+      case OPTION_LOG_ASYNC:
+        log_async = ParseBoolOption(optarg);
+        break;
 
       case OPTION_ID:
         server_id = optarg;
@@ -832,6 +1379,20 @@ Parse(TRTSERVER_ServerOptions* server_options, int argc, char** argv)
       case OPTION_STRICT_READINESS:
         strict_readiness = ParseBoolOption(optarg);
         break;
+      case OPTION_MODEL_CONFIG_CACHE_DIR:
+        model_config_cache_dir = optarg;
+        break;
+      case OPTION_MODEL_STARTUP_SNAPSHOT:
+        model_startup_snapshot = optarg;
+        break;
+      case OPTION_INSTANCE_PLACEMENT:
+        instance_placement = ParseInstancePlacementOption(optarg);
+        break;
+      case OPTION_CPU_ISOLATION: {
+        const auto isolation = ParseCpuIsolationOption(optarg);
+        cpu_isolation[isolation.first] = isolation.second;
+        break;
+      }
 
 #ifdef TRTIS_ENABLE_HTTP
       case OPTION_ALLOW_HTTP:
@@ -840,12 +1401,26 @@ Parse(TRTSERVER_ServerOptions* server_options, int argc, char** argv)
       case OPTION_HTTP_PORT:
         http_port = ParseIntOption(optarg);
         http_health_port = http_port;
+        http_status_port = http_port;
         break;
       case OPTION_HTTP_HEALTH_PORT:
         http_health_port = ParseIntOption(optarg);
         break;
+      case OPTION_HTTP_STATUS_PORT:
+        http_status_port = ParseIntOption(optarg);
+        break;
       case OPTION_HTTP_THREAD_COUNT:
         http_thread_cnt = ParseIntOption(optarg);
+        http_thread_cnt_given_ = true;
+        break;
+      case OPTION_HTTP_LISTENER_COUNT:
+        http_listener_cnt = ParseIntOption(optarg);
+        break;
+      case OPTION_HTTP_COMPRESSION_LEVEL:
+        http_compression_level = ParseIntOption(optarg);
+        break;
+      case OPTION_HTTP_CONTROL_THREAD_COUNT:
+        http_control_thread_cnt = ParseIntOption(optarg);
         break;
 #endif  // TRTIS_ENABLE_HTTP
 
@@ -858,13 +1433,27 @@ Parse(TRTSERVER_ServerOptions* server_options, int argc, char** argv)
         break;
       case OPTION_GRPC_INFER_THREAD_COUNT:
         grpc_infer_thread_cnt = ParseIntOption(optarg);
+        grpc_infer_thread_cnt_given_ = true;
         break;
       case OPTION_GRPC_STREAM_INFER_THREAD_COUNT:
         grpc_stream_infer_thread_cnt = ParseIntOption(optarg);
+        grpc_stream_infer_thread_cnt_given_ = true;
         break;
       case OPTION_GRPC_INFER_ALLOCATION_POOL_SIZE:
         grpc_infer_allocation_pool_size = ParseIntOption(optarg);
         break;
+      case OPTION_GRPC_COMPRESSION_ALGORITHM:
+        grpc_compression_algorithm = optarg;
+        break;
+      case OPTION_GRPC_COMPRESSION_LEVEL:
+        grpc_compression_level = optarg;
+        break;
+      case OPTION_GRPC_PEER:
+        grpc_peers.push_back(optarg);
+        break;
+      case OPTION_GRPC_OUTPUT_SHM_POOL_BYTE_SIZE:
+        grpc_output_shm_pool_byte_size = ParseLongLongOption(optarg);
+        break;
 #endif  // TRTIS_ENABLE_GRPC
 
 #ifdef TRTIS_ENABLE_METRICS
@@ -877,6 +1466,15 @@ Parse(TRTSERVER_ServerOptions* server_options, int argc, char** argv)
       case OPTION_METRICS_PORT:
         metrics_port = ParseIntOption(optarg);
         break;
+      case OPTION_METRICS_LATENCY_BUCKETS:
+        metrics_latency_buckets = ParseLatencyBucketsOption(optarg);
+        break;
+      case OPTION_METRICS_CACHE_MAX_AGE:
+        metrics_cache_max_age_ms = ParseLongLongOption(optarg);
+        break;
+      case OPTION_GPU_METRICS_POLL_INTERVAL:
+        gpu_metrics_poll_interval_ms = ParseLongLongOption(optarg);
+        break;
 #endif  // TRTIS_ENABLE_METRICS
 
 #ifdef TRTIS_ENABLE_TRACING
@@ -889,6 +1487,15 @@ Parse(TRTSERVER_ServerOptions* server_options, int argc, char** argv)
       case OPTION_TRACE_RATE:
         trace_rate = ParseIntOption(optarg);
         break;
+      case OPTION_TRACE_FORMAT:
+        trace_format = ParseTraceFormatOption(optarg);
+        break;
+      case OPTION_TRACE_TAIL_LATENCY:
+        trace_tail_latencies.insert(ParseTraceTailLatencyOption(optarg));
+        break;
+      case OPTION_TRACE_TAIL_PERCENTILE:
+        trace_tail_percentile = ParseFloatOption(optarg);
+        break;
 #endif  // TRTIS_ENABLE_TRACING
 
       case OPTION_ALLOW_POLL_REPO:
@@ -900,12 +1507,45 @@ Parse(TRTSERVER_ServerOptions* server_options, int argc, char** argv)
       case OPTION_ALLOW_MODEL_CONTROL:
         allow_model_control = ParseBoolOption(optarg);
         break;
+      case OPTION_ALLOW_MODEL_LOAD_ON_DEMAND:
+        allow_model_load_on_demand = ParseBoolOption(optarg);
+        break;
+      case OPTION_MODEL_GPU_MEMORY_BUDGET:
+        model_gpu_memory_budget.insert(ParseGpuMemoryBudgetOption(optarg));
+        break;
       case OPTION_STARTUP_MODEL:
         startup_models_.insert(optarg);
         break;
       case OPTION_EXIT_TIMEOUT_SECS:
         exit_timeout_secs = ParseIntOption(optarg);
         break;
+      case OPTION_PINNED_MEMORY_POOL_BYTE_SIZE:
+        pinned_memory_pool_byte_size = ParseLongLongOption(optarg);
+        break;
+      case OPTION_MODEL_LOAD_THREAD_COUNT:
+        model_load_thread_count = ParseIntOption(optarg);
+        break;
+      case OPTION_MODEL_LOAD_GPU_LIMIT:
+        model_load_gpu_limit = ParseIntOption(optarg);
+        break;
+      case OPTION_MODEL_LOAD_STORAGE_LIMIT:
+        model_load_storage_limit = ParseIntOption(optarg);
+        break;
+      case OPTION_MODEL_MEMORY_ESTIMATE_DIR:
+        model_memory_estimate_dir = optarg;
+        break;
+      case OPTION_RATE_LIMIT_GPU_SLOTS:
+        rate_limit_gpu_slots = ParseIntOption(optarg);
+        break;
+      case OPTION_RATE_LIMIT_RESOURCE:
+        rate_limit_resources.insert(ParseRateLimitResourceOption(optarg));
+        break;
+      case OPTION_RESPONSE_CACHE_BYTE_SIZE:
+        response_cache_byte_size = ParseLongLongOption(optarg);
+        break;
+      case OPTION_STATUS_SNAPSHOT_INTERVAL:
+        status_snapshot_interval_ms = ParseLongLongOption(optarg);
+        break;
 
       case OPTION_TF_ALLOW_SOFT_PLACEMENT:
         tf_allow_soft_placement = ParseBoolOption(optarg);
@@ -921,6 +1561,23 @@ Parse(TRTSERVER_ServerOptions* server_options, int argc, char** argv)
                 tf_vgpu.mem_limit_mbytes_),
             "adding tensorflow VGPU instances");
         break;
+
+      case OPTION_TRT_ENGINE_CACHE_DIR:
+        trt_engine_cache_dir = optarg;
+        break;
+
+      case OPTION_REMOTE_REPO_CACHE_DIR:
+        remote_repo_cache_dir = optarg;
+        break;
+      case OPTION_REMOTE_REPO_CACHE_BYTE_SIZE:
+        remote_repo_cache_byte_size = ParseLongLongOption(optarg);
+        break;
+      case OPTION_REMOTE_REPO_DOWNLOAD_PART_BYTE_SIZE:
+        remote_repo_download_part_byte_size = ParseLongLongOption(optarg);
+        break;
+      case OPTION_REMOTE_REPO_DOWNLOAD_CONCURRENCY:
+        remote_repo_download_concurrency = ParseIntOption(optarg);
+        break;
     }
   }
 
@@ -934,10 +1591,12 @@ Parse(TRTSERVER_ServerOptions* server_options, int argc, char** argv)
   LOG_ENABLE_WARNING(log_warn);
   LOG_ENABLE_ERROR(log_error);
   LOG_SET_VERBOSE(log_verbose);
+  LOG_SET_ASYNC(log_async);
 
   repository_poll_secs_ =
       (allow_poll_model_repository) ? std::max(0, repository_poll_secs) : 0;
 
+  allow_model_control |= allow_model_load_on_demand;
   if (allow_model_control && allow_poll_model_repository) {
     LOG_ERROR << "--allow-model-control and --allow-poll-model-repository "
               << "can not be both set to true";
@@ -945,8 +1604,18 @@ Parse(TRTSERVER_ServerOptions* server_options, int argc, char** argv)
     return false;
   }
 
+#ifdef TRTIS_ENABLE_HTTP
+  if ((http_compression_level < 0) || (http_compression_level > 9)) {
+    LOG_ERROR << "--http-compression-level must be in the range [0, 9]";
+    LOG_ERROR << Usage();
+    return false;
+  }
+#endif  // TRTIS_ENABLE_HTTP
+
   TRTSERVER_Model_Control_Mode control_mode;
-  if (allow_model_control) {
+  if (allow_model_load_on_demand) {
+    control_mode = TRTSERVER_MODEL_CONTROL_ON_DEMAND;
+  } else if (allow_model_control) {
     control_mode = TRTSERVER_MODEL_CONTROL_EXPLICIT;
   } else if (repository_poll_secs_ > 0) {
     control_mode = TRTSERVER_MODEL_CONTROL_POLL;
@@ -957,9 +1626,13 @@ Parse(TRTSERVER_ServerOptions* server_options, int argc, char** argv)
 #ifdef TRTIS_ENABLE_HTTP
   http_port_ = http_port;
   http_health_port_ = http_health_port;
-  http_ports_ = {http_port_, http_health_port_, http_port_, http_port_,
-                 http_port_};
+  http_status_port_ = http_status_port;
+  http_ports_ = {http_status_port_, http_health_port_, http_port_, http_port_,
+                 http_port_,        http_port_};
   http_thread_cnt_ = http_thread_cnt;
+  http_listener_cnt_ = http_listener_cnt;
+  http_compression_level_ = http_compression_level;
+  http_control_thread_cnt_ = http_control_thread_cnt;
 #endif  // TRTIS_ENABLE_HTTP
 
 #ifdef TRTIS_ENABLE_GRPC
@@ -967,6 +1640,10 @@ Parse(TRTSERVER_ServerOptions* server_options, int argc, char** argv)
   grpc_infer_thread_cnt_ = grpc_infer_thread_cnt;
   grpc_stream_infer_thread_cnt_ = grpc_stream_infer_thread_cnt;
   grpc_infer_allocation_pool_size_ = grpc_infer_allocation_pool_size;
+  grpc_compression_algorithm_ = grpc_compression_algorithm;
+  grpc_compression_level_ = grpc_compression_level;
+  grpc_peers_ = grpc_peers;
+  grpc_output_shm_pool_byte_size_ = grpc_output_shm_pool_byte_size;
 #endif  // TRTIS_ENABLE_GRPC
 
 #ifdef TRTIS_ENABLE_METRICS
@@ -978,6 +1655,9 @@ Parse(TRTSERVER_ServerOptions* server_options, int argc, char** argv)
   trace_filepath_ = trace_filepath;
   trace_level_ = trace_level;
   trace_rate_ = trace_rate;
+  trace_format_ = trace_format;
+  trace_tail_latencies_ = trace_tail_latencies;
+  trace_tail_percentile_ = trace_tail_percentile;
 #endif  // TRTIS_ENABLE_TRACING
 
   // Check if HTTP, GRPC and metrics port clash
@@ -1016,6 +1696,66 @@ Parse(TRTSERVER_ServerOptions* server_options, int argc, char** argv)
       TRTSERVER_ServerOptionsSetExitTimeout(
           server_options, std::max(0, exit_timeout_secs)),
       "setting exit timeout");
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsSetPinnedMemoryPoolByteSize(
+          server_options,
+          std::max((int64_t)0, pinned_memory_pool_byte_size)),
+      "setting pinned memory pool byte size");
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsSetModelLoadThreadCount(
+          server_options, std::max(1, model_load_thread_count)),
+      "setting model load thread count");
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsSetModelLoadLimits(
+          server_options, std::max(0, model_load_gpu_limit),
+          std::max(0, model_load_storage_limit)),
+      "setting model load limits");
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsSetModelMemoryEstimateDirectory(
+          server_options, model_memory_estimate_dir.c_str()),
+      "setting model memory estimate directory");
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsSetModelConfigCacheDirectory(
+          server_options, model_config_cache_dir.c_str()),
+      "setting model config cache directory");
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsSetModelStartupSnapshot(
+          server_options, model_startup_snapshot.c_str()),
+      "setting model startup snapshot");
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsSetInstancePlacement(
+          server_options, instance_placement),
+      "setting instance placement");
+  for (const auto& isolation : cpu_isolation) {
+    FAIL_IF_ERR(
+        TRTSERVER_ServerOptionsSetThreadClassCpus(
+            server_options, isolation.first, isolation.second.c_str()),
+        "setting CPU isolation");
+  }
+  for (const auto& budget : model_gpu_memory_budget) {
+    FAIL_IF_ERR(
+        TRTSERVER_ServerOptionsAddModelGpuMemoryBudget(
+            server_options, budget.first, budget.second),
+        "adding model GPU memory budget");
+  }
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsSetRateLimitGpuSlots(
+          server_options, std::max(0, rate_limit_gpu_slots)),
+      "setting rate limit GPU slots");
+  for (const auto& resource : rate_limit_resources) {
+    FAIL_IF_ERR(
+        TRTSERVER_ServerOptionsAddRateLimitResource(
+            server_options, resource.first.c_str(), resource.second),
+        "adding rate limit resource");
+  }
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsSetResponseCacheByteSize(
+          server_options, std::max((int64_t)0, response_cache_byte_size)),
+      "setting response cache byte size");
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsSetStatusSnapshotInterval(
+          server_options, std::max((int64_t)0, status_snapshot_interval_ms)),
+      "setting status snapshot interval");
 
   FAIL_IF_ERR(
       TRTSERVER_ServerOptionsSetLogInfo(server_options, log_info),
@@ -1029,6 +1769,9 @@ Parse(TRTSERVER_ServerOptions* server_options, int argc, char** argv)
   FAIL_IF_ERR(
       TRTSERVER_ServerOptionsSetLogVerbose(server_options, log_verbose),
       "setting log verbose level");
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsSetLogAsync(server_options, log_async),
+      "setting log async enable");
 
 #ifdef TRTIS_ENABLE_METRICS
   FAIL_IF_ERR(
@@ -1037,6 +1780,21 @@ Parse(TRTSERVER_ServerOptions* server_options, int argc, char** argv)
   FAIL_IF_ERR(
       TRTSERVER_ServerOptionsSetGpuMetrics(server_options, allow_gpu_metrics),
       "setting GPU metrics enable");
+  if (!metrics_latency_buckets.empty()) {
+    FAIL_IF_ERR(
+        TRTSERVER_ServerOptionsSetMetricsLatencyBuckets(
+            server_options, &metrics_latency_buckets[0],
+            metrics_latency_buckets.size()),
+        "setting metrics latency buckets");
+  }
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsSetMetricsCacheMaxAge(
+          server_options, std::max((int64_t)0, metrics_cache_max_age_ms)),
+      "setting metrics cache max age");
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsSetGpuMetricsPollInterval(
+          server_options, std::max((int64_t)1, gpu_metrics_poll_interval_ms)),
+      "setting GPU metrics poll interval");
 #endif  // TRTIS_ENABLE_GRPC
 
   FAIL_IF_ERR(
@@ -1047,6 +1805,21 @@ Parse(TRTSERVER_ServerOptions* server_options, int argc, char** argv)
       TRTSERVER_ServerOptionsSetTensorFlowGpuMemoryFraction(
           server_options, tf_gpu_memory_fraction),
       "setting tensorflow GPU memory fraction");
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsSetTensorRTEngineCacheDirectory(
+          server_options, trt_engine_cache_dir.c_str()),
+      "setting tensorrt engine cache directory");
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsSetRemoteRepositoryCache(
+          server_options, remote_repo_cache_dir.c_str(),
+          std::max((int64_t)0, remote_repo_cache_byte_size)),
+      "setting remote repository cache");
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsSetRemoteRepositoryDownload(
+          server_options,
+          std::max((int64_t)1, remote_repo_download_part_byte_size),
+          std::max(1, remote_repo_download_concurrency)),
+      "setting remote repository download");
 
   return true;
 }
@@ -1071,6 +1844,9 @@ main(int argc, char** argv)
   // Manager for shared memory blocks.
   auto smb_manager =
       std::make_shared<nvidia::inferenceserver::SharedMemoryBlockManager>();
+#ifdef TRTIS_ENABLE_GRPC
+  smb_manager->SetOutputPoolByteSize(grpc_output_shm_pool_byte_size_);
+#endif  // TRTIS_ENABLE_GRPC
 
   // Create the server...
   TRTSERVER_Server* server_ptr = nullptr;
@@ -1081,6 +1857,9 @@ main(int argc, char** argv)
 
   std::shared_ptr<TRTSERVER_Server> server(server_ptr, TRTSERVER_ServerDelete);
 
+  // Size the front-end thread pools to the CPUs they can use.
+  LimitFrontendThreads(server);
+
   // Configure and start tracing if specified on the command line.
   if (!StartTracing(server, &trace_manager)) {
     exit(1);
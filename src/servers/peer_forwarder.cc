@@ -0,0 +1,204 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "src/servers/peer_forwarder.h"
+
+#include <grpc++/impl/codegen/proto_utils.h>
+#include "src/core/constants.h"
+#include "src/servers/common.h"
+
+namespace nvidia { namespace inferenceserver {
+
+namespace {
+
+// The full name of the Infer method of GRPCService in
+// grpc_service.proto.
+constexpr char kInferMethod[] = "/nvidia.inferenceserver.GRPCService/Infer";
+
+}  // namespace
+
+//
+// PeerForwarder::Call
+//
+// A request being forwarded. Each attempt at a peer uses a fresh
+// client context as a context can't be reused across calls.
+//
+struct PeerForwarder::Call {
+  std::string model_name_;
+  grpc::ByteBuffer request_;
+  std::chrono::system_clock::time_point deadline_;
+  InferResponse* response_;
+  CompleteFn fn_;
+
+  // The peer of the first attempt and the number of attempts made.
+  size_t first_peer_;
+  size_t attempt_cnt_;
+
+  std::unique_ptr<grpc::ClientContext> ctx_;
+  std::unique_ptr<grpc::GenericClientAsyncResponseReader> reader_;
+  grpc::ByteBuffer reply_;
+  grpc::Status status_;
+};
+
+PeerForwarder::PeerForwarder(const std::vector<std::string>& peers)
+    : peers_(peers)
+{
+  grpc::ChannelArguments arguments;
+  arguments.SetMaxSendMessageSize(MAX_GRPC_MESSAGE_SIZE);
+  arguments.SetMaxReceiveMessageSize(MAX_GRPC_MESSAGE_SIZE);
+  for (const auto& peer : peers_) {
+    stubs_.emplace_back(new grpc::GenericStub(grpc::CreateCustomChannel(
+        peer, grpc::InsecureChannelCredentials(), arguments)));
+  }
+
+  worker_ = std::thread([this]() { Process(); });
+}
+
+PeerForwarder::~PeerForwarder()
+{
+  cq_.Shutdown();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+TRTSERVER_Error*
+PeerForwarder::Create(
+    const std::vector<std::string>& peers,
+    std::unique_ptr<PeerForwarder>* forwarder)
+{
+  if (peers.empty()) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_INVALID_ARG,
+        "peer forwarding requires at least one peer");
+  }
+
+  forwarder->reset(new PeerForwarder(peers));
+  return nullptr;  // success
+}
+
+bool
+PeerForwarder::IsForwarded(const grpc::ServerContext& ctx)
+{
+  const auto& metadata = ctx.client_metadata();
+  return metadata.find(kPeerForwardedGRPCMetadata) != metadata.end();
+}
+
+void
+PeerForwarder::Forward(
+    const std::string& model_name, const grpc::ByteBuffer& request,
+    const grpc::ServerContext& ctx, InferResponse* response, CompleteFn fn)
+{
+  Call* call = new Call;
+  call->model_name_ = model_name;
+
+  // Copying the buffer only references its slices.
+  call->request_ = request;
+  call->deadline_ = ctx.deadline();
+  call->response_ = response;
+  call->fn_ = std::move(fn);
+  call->attempt_cnt_ = 0;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    const auto itr = model_peers_.find(model_name);
+    call->first_peer_ = (itr == model_peers_.end()) ? 0 : itr->second;
+  }
+
+  Issue(call);
+}
+
+void
+PeerForwarder::Issue(Call* call)
+{
+  const size_t peer = (call->first_peer_ + call->attempt_cnt_) % peers_.size();
+  call->attempt_cnt_++;
+
+  LOG_VERBOSE(1) << "forwarding request for '" << call->model_name_
+                 << "' to peer " << peers_[peer];
+
+  call->ctx_.reset(new grpc::ClientContext());
+  call->ctx_->AddMetadata(kPeerForwardedGRPCMetadata, "1");
+  if (call->deadline_ != std::chrono::system_clock::time_point::max()) {
+    call->ctx_->set_deadline(call->deadline_);
+  }
+
+  call->reply_.Clear();
+  call->reader_ = stubs_[peer]->PrepareUnaryCall(
+      call->ctx_.get(), kInferMethod, call->request_, &cq_);
+  call->reader_->StartCall();
+  call->reader_->Finish(&call->reply_, &call->status_, call);
+}
+
+void
+PeerForwarder::Process()
+{
+  void* tag;
+  bool ok;
+  while (cq_.Next(&tag, &ok)) {
+    Call* call = reinterpret_cast<Call*>(tag);
+    const size_t peer =
+        (call->first_peer_ + call->attempt_cnt_ - 1) % peers_.size();
+
+    // A peer that doesn't have the model, or is itself overloaded,
+    // responds with UNAVAILABLE or NOT_FOUND and the next peer is
+    // tried. Any other response, including other errors, is the
+    // response to the request.
+    bool served = false;
+    if (call->status_.ok()) {
+      served = grpc::SerializationTraits<InferResponse>::Deserialize(
+                   &call->reply_, call->response_)
+                   .ok();
+      if (served) {
+        const RequestStatusCode code =
+            call->response_->request_status().code();
+        served = (code != RequestStatusCode::UNAVAILABLE) &&
+                 (code != RequestStatusCode::NOT_FOUND);
+      }
+    } else {
+      LOG_VERBOSE(1) << "forwarding to peer " << peers_[peer]
+                     << " failed: " << call->status_.error_message();
+    }
+
+    const bool expired =
+        (call->status_.error_code() == grpc::StatusCode::DEADLINE_EXCEEDED);
+    if (!served && !expired && (call->attempt_cnt_ < peers_.size())) {
+      Issue(call);
+      continue;
+    }
+
+    if (served) {
+      std::lock_guard<std::mutex> lock(mu_);
+      model_peers_[call->model_name_] = peer;
+    } else {
+      call->response_->Clear();
+    }
+
+    call->fn_(served);
+    delete call;
+  }
+}
+
+}}  // namespace nvidia::inferenceserver
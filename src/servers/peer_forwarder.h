@@ -0,0 +1,99 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <grpc++/generic/generic_stub.h>
+#include <grpc++/grpc++.h>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include "src/core/grpc_service.pb.h"
+#include "src/core/trtserver.h"
+
+namespace nvidia { namespace inferenceserver {
+
+///
+/// Forward Infer requests that can't be served locally to peer
+/// servers over GRPC. The serialized request is relayed as received,
+/// so the input tensors are not copied or re-encoded.
+///
+class PeerForwarder {
+ public:
+  /// Called when a forwarded request completes. 'forwarded' is true
+  /// if a peer served the request, in which case the response holds
+  /// the peer's response. It is false if no peer could serve the
+  /// request and the response is cleared.
+  using CompleteFn = std::function<void(bool forwarded)>;
+
+  /// Create a forwarder to the peers.
+  /// \param peers The addresses, as host:port, of the GRPC endpoint
+  /// of each peer.
+  /// \param forwarder Returns the forwarder.
+  /// \return a TRTSERVER_Error indicating success or failure.
+  static TRTSERVER_Error* Create(
+      const std::vector<std::string>& peers,
+      std::unique_ptr<PeerForwarder>* forwarder);
+
+  ~PeerForwarder();
+
+  /// Return true if the request of 'ctx' was forwarded by a peer, in
+  /// which case it must not be forwarded again.
+  static bool IsForwarded(const grpc::ServerContext& ctx);
+
+  /// Forward an Infer request to the peers, trying each in turn
+  /// starting with the peer that last served 'model_name' until one
+  /// of them serves it.
+  /// \param model_name The name of the model of the request.
+  /// \param request The serialized InferRequest.
+  /// \param ctx The context of the call that received the request,
+  /// whose deadline is also the deadline of the forwarded request.
+  /// \param response Returns the response of the peer.
+  /// \param fn The function called when the request completes.
+  void Forward(
+      const std::string& model_name, const grpc::ByteBuffer& request,
+      const grpc::ServerContext& ctx, InferResponse* response,
+      CompleteFn fn);
+
+ private:
+  struct Call;
+
+  explicit PeerForwarder(const std::vector<std::string>& peers);
+  void Issue(Call* call);
+  void Process();
+
+  std::vector<std::string> peers_;
+  std::vector<std::unique_ptr<grpc::GenericStub>> stubs_;
+
+  grpc::CompletionQueue cq_;
+  std::thread worker_;
+
+  // The index of the peer that last served each model.
+  std::mutex mu_;
+  std::unordered_map<std::string, size_t> model_peers_;
+};
+
+}}  // namespace nvidia::inferenceserver
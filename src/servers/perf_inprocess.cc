@@ -0,0 +1,1093 @@
+// Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "src/core/api.pb.h"
+#include "src/core/model_config.h"
+#include "src/core/server_status.pb.h"
+#include "src/core/trtserver.h"
+#include "src/servers/common.h"
+
+namespace ni = nvidia::inferenceserver;
+
+//
+// In-process load generator. Loads a model repository into an
+// inference server created in this process and measures throughput
+// and latency of a model by calling TRTSERVER_ServerInferAsync
+// directly. The options follow perf_client so that results can be
+// compared with those measured through the HTTP and GRPC endpoints.
+//
+namespace {
+
+// The start and end time of a completed request, in nanoseconds.
+using Timestamp = std::pair<uint64_t, uint64_t>;
+
+uint64_t
+NowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void
+Usage(char** argv, const std::string& msg = std::string())
+{
+  if (!msg.empty()) {
+    LOG_ERROR << msg;
+  }
+
+  LOG_ERROR << "Usage: " << argv[0] << " [options]";
+  LOG_ERROR << "\t--model-repository <absolute path>";
+  LOG_ERROR << "\t-m <model name>";
+  LOG_ERROR << "\t-x <model version>";
+  LOG_ERROR << "\t-b <batch size>";
+  LOG_ERROR << "\t-t <number of concurrent requests>";
+  LOG_ERROR << "\t-d";
+  LOG_ERROR << "\t-c <maximum concurrency>";
+  LOG_ERROR << "\t-p <measurement window (in msec)>";
+  LOG_ERROR << "\t-s <deviation threshold for stable measurement"
+            << " (in percentage)>";
+  LOG_ERROR << "\t-r <maximum number of measurements for each profiling>";
+  LOG_ERROR << "\t-f <filename for storing report in csv format>";
+  LOG_ERROR << "\t-v";
+  LOG_ERROR << "\t--percentile <percentile>";
+  LOG_ERROR << "\t--shape <name:shape>";
+  LOG_ERROR << "\t--sequence-length <length>";
+  LOG_ERROR << "\t--shared-memory <\"system\"|\"none\">";
+  LOG_ERROR << "";
+  LOG_ERROR << "Without -d the model is measured at the concurrency given"
+            << " by -t. With -d the concurrency is increased by 1 from -t"
+            << " until it reaches -c.";
+
+  exit(1);
+}
+
+// Parse a "name:d0,d1,..." input shape.
+bool
+ParseInputShape(
+    const std::string& arg, std::string* name, std::vector<int64_t>* shape)
+{
+  const size_t colon_pos = arg.rfind(":");
+  if ((colon_pos == std::string::npos) || (colon_pos == 0)) {
+    return false;
+  }
+
+  *name = arg.substr(0, colon_pos);
+  shape->clear();
+  std::istringstream in(arg.substr(colon_pos + 1));
+  std::string dim;
+  while (std::getline(in, dim, ',')) {
+    try {
+      shape->push_back(std::stoll(dim));
+    }
+    catch (const std::exception& ex) {
+      return false;
+    }
+    if (shape->back() < 0) {
+      return false;
+    }
+  }
+
+  return !shape->empty();
+}
+
+// The output buffers of a worker that are in shared memory, keyed by
+// output name. Passed to the allocator as its user pointer.
+struct OutputBuffer {
+  void* base_;
+  size_t byte_size_;
+};
+using OutputBufferMap = std::unordered_map<std::string, OutputBuffer>;
+
+TRTSERVER_Error*
+ResponseAlloc(
+    TRTSERVER_ResponseAllocator* allocator, void** buffer, void** buffer_userp,
+    const char* tensor_name, size_t byte_size,
+    TRTSERVER_Memory_Type memory_type, int64_t memory_type_id, void* userp)
+{
+  *buffer = nullptr;
+  *buffer_userp = nullptr;
+  if (byte_size == 0) {
+    return nullptr;  // Success
+  }
+
+  const OutputBufferMap* shm_outputs =
+      reinterpret_cast<const OutputBufferMap*>(userp);
+  if (shm_outputs != nullptr) {
+    const auto itr = shm_outputs->find(tensor_name);
+    if ((itr != shm_outputs->end()) && (byte_size <= itr->second.byte_size_)) {
+      *buffer = itr->second.base_;
+      return nullptr;  // Success
+    }
+  }
+
+  // Buffers that are not in shared memory are malloced. A non-null
+  // 'buffer_userp' tells ResponseRelease to free the buffer. GPU
+  // memory is not used, which makes the server fall back to CPU.
+  if (memory_type == TRTSERVER_MEMORY_CPU) {
+    *buffer = malloc(byte_size);
+    *buffer_userp = *buffer;
+  }
+
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+ResponseRelease(
+    TRTSERVER_ResponseAllocator* allocator, void* buffer, void* buffer_userp,
+    size_t byte_size, TRTSERVER_Memory_Type memory_type, int64_t memory_type_id)
+{
+  if (buffer_userp != nullptr) {
+    free(buffer);
+  }
+
+  return nullptr;  // Success
+}
+
+void
+InferComplete(
+    TRTSERVER_Server* server, TRTSERVER_Trace* trace,
+    TRTSERVER_InferenceResponse* response, void* userp)
+{
+  std::promise<TRTSERVER_InferenceResponse*>* p =
+      reinterpret_cast<std::promise<TRTSERVER_InferenceResponse*>*>(userp);
+  p->set_value(response);
+  delete p;
+
+  TRTSERVER_TraceDelete(trace);
+}
+
+//
+// SharedMemoryRegion
+//
+// A posix shared memory object registered with the server as a
+// single shared memory block.
+//
+class SharedMemoryRegion {
+ public:
+  static TRTSERVER_Error* Create(
+      const std::shared_ptr<TRTSERVER_Server>& server, const std::string& key,
+      size_t byte_size, std::unique_ptr<SharedMemoryRegion>* region);
+  ~SharedMemoryRegion();
+
+  // Get the server's address of 'byte_size' bytes at 'offset' in the
+  // region.
+  TRTSERVER_Error* Address(size_t offset, size_t byte_size, void** base);
+
+ private:
+  SharedMemoryRegion(
+      const std::shared_ptr<TRTSERVER_Server>& server, const std::string& key)
+      : server_(server), key_(key), smb_(nullptr)
+  {
+  }
+
+  std::shared_ptr<TRTSERVER_Server> server_;
+  const std::string key_;
+  TRTSERVER_SharedMemoryBlock* smb_;
+};
+
+TRTSERVER_Error*
+SharedMemoryRegion::Create(
+    const std::shared_ptr<TRTSERVER_Server>& server, const std::string& key,
+    size_t byte_size, std::unique_ptr<SharedMemoryRegion>* region)
+{
+  int fd = shm_open(key.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+  if (fd == -1) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_INTERNAL,
+        std::string("unable to create shared memory object " + key).c_str());
+  }
+  region->reset(new SharedMemoryRegion(server, key));
+  const bool truncated = (ftruncate(fd, byte_size) == 0);
+  close(fd);
+  if (!truncated) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_INTERNAL,
+        std::string("unable to size shared memory object " + key).c_str());
+  }
+
+  // The server maps the object itself when the block is registered.
+  RETURN_IF_ERR(TRTSERVER_SharedMemoryBlockCpuNew(
+      &(*region)->smb_, key.c_str(), key.c_str(), 0 /* offset */, byte_size));
+  return TRTSERVER_ServerRegisterSharedMemory(server.get(), (*region)->smb_);
+}
+
+SharedMemoryRegion::~SharedMemoryRegion()
+{
+  if (smb_ != nullptr) {
+    LOG_IF_ERR(
+        TRTSERVER_ServerUnregisterSharedMemory(server_.get(), smb_),
+        "unregistering shared memory");
+    LOG_IF_ERR(
+        TRTSERVER_SharedMemoryBlockDelete(smb_), "deleting shared memory");
+  }
+  shm_unlink(key_.c_str());
+}
+
+TRTSERVER_Error*
+SharedMemoryRegion::Address(size_t offset, size_t byte_size, void** base)
+{
+  return TRTSERVER_ServerSharedMemoryAddress(
+      server_.get(), smb_, offset, byte_size, base);
+}
+
+// The input data sent with every request, and the expected size of
+// each output or 0 if the size is not known in advance.
+struct TensorData {
+  std::string name_;
+  std::vector<char> data_;
+  size_t byte_size_;
+};
+
+//
+// Worker
+//
+// Sends one request at a time, waiting for each to complete before
+// sending the next. Each worker adds one to the concurrency.
+//
+class Worker {
+ public:
+  Worker(
+      const std::shared_ptr<TRTSERVER_Server>& server,
+      TRTSERVER_ResponseAllocator* allocator, const std::string& model_name,
+      const int64_t model_version, const ni::InferRequestHeader& header,
+      const std::vector<TensorData>& inputs,
+      const std::vector<TensorData>& outputs, const uint64_t correlation_id,
+      const size_t sequence_length);
+  ~Worker();
+
+  // Place the inputs and outputs in 'region' instead of in memory
+  // that is private to the worker.
+  TRTSERVER_Error* UseSharedMemory(
+      std::unique_ptr<SharedMemoryRegion>&& region);
+
+  void Start();
+  void Stop();
+
+  // Move the timestamps of the requests completed since the last
+  // call into 'timestamps'. Return false if any request failed.
+  bool SwapTimestamps(std::vector<Timestamp>* timestamps);
+
+ private:
+  void Run();
+  TRTSERVER_Error* Infer(const std::string& header);
+
+  std::shared_ptr<TRTSERVER_Server> server_;
+  TRTSERVER_ResponseAllocator* allocator_;
+  const std::string model_name_;
+  const int64_t model_version_;
+  const std::vector<TensorData>& inputs_;
+  const std::vector<TensorData>& outputs_;
+  const size_t sequence_length_;
+
+  // The serialized request header for each combination of the
+  // sequence start (bit 0) and end (bit 1) flags. All are the same
+  // if the model is not stateful.
+  std::string headers_[4];
+
+  std::unique_ptr<SharedMemoryRegion> region_;
+  std::vector<const void*> input_bases_;
+  OutputBufferMap shm_outputs_;
+
+  std::thread thread_;
+  std::atomic<bool> exiting_;
+  std::mutex mu_;
+  std::vector<Timestamp> timestamps_;
+  bool failed_;
+};
+
+Worker::Worker(
+    const std::shared_ptr<TRTSERVER_Server>& server,
+    TRTSERVER_ResponseAllocator* allocator, const std::string& model_name,
+    const int64_t model_version, const ni::InferRequestHeader& header,
+    const std::vector<TensorData>& inputs,
+    const std::vector<TensorData>& outputs, const uint64_t correlation_id,
+    const size_t sequence_length)
+    : server_(server), allocator_(allocator), model_name_(model_name),
+      model_version_(model_version), inputs_(inputs), outputs_(outputs),
+      sequence_length_(sequence_length), exiting_(false), failed_(false)
+{
+  ni::InferRequestHeader request_header(header);
+  request_header.set_correlation_id(correlation_id);
+  for (uint32_t idx = 0; idx < 4; ++idx) {
+    uint32_t flags = ni::InferRequestHeader::FLAG_NONE;
+    if (correlation_id != 0) {
+      if ((idx & 1) != 0) {
+        flags |= ni::InferRequestHeader::FLAG_SEQUENCE_START;
+      }
+      if ((idx & 2) != 0) {
+        flags |= ni::InferRequestHeader::FLAG_SEQUENCE_END;
+      }
+    }
+    request_header.set_flags(flags);
+    request_header.SerializeToString(&headers_[idx]);
+  }
+
+  for (const auto& input : inputs_) {
+    input_bases_.push_back(&input.data_[0]);
+  }
+}
+
+Worker::~Worker()
+{
+  Stop();
+}
+
+TRTSERVER_Error*
+Worker::UseSharedMemory(std::unique_ptr<SharedMemoryRegion>&& region)
+{
+  region_ = std::move(region);
+
+  // Inputs are copied into the region once, the outputs follow them.
+  size_t offset = 0;
+  for (size_t idx = 0; idx < inputs_.size(); ++idx) {
+    void* base;
+    RETURN_IF_ERR(region_->Address(offset, inputs_[idx].byte_size_, &base));
+    memcpy(base, &inputs_[idx].data_[0], inputs_[idx].byte_size_);
+    input_bases_[idx] = base;
+    offset += inputs_[idx].byte_size_;
+  }
+  for (const auto& output : outputs_) {
+    if (output.byte_size_ != 0) {
+      void* base;
+      RETURN_IF_ERR(region_->Address(offset, output.byte_size_, &base));
+      shm_outputs_.emplace(output.name_, OutputBuffer{base, output.byte_size_});
+      offset += output.byte_size_;
+    }
+  }
+
+  return nullptr;  // Success
+}
+
+void
+Worker::Start()
+{
+  exiting_ = false;
+  thread_ = std::thread([this]() { Run(); });
+}
+
+void
+Worker::Stop()
+{
+  exiting_ = true;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+bool
+Worker::SwapTimestamps(std::vector<Timestamp>* timestamps)
+{
+  timestamps->clear();
+  std::lock_guard<std::mutex> lk(mu_);
+  timestamps_.swap(*timestamps);
+  return !failed_;
+}
+
+void
+Worker::Run()
+{
+  // A sequence is always completed so that the sequence slot is
+  // released before the worker exits.
+  size_t sequence_idx = 0;
+  while (!exiting_ || (sequence_idx != 0)) {
+    uint32_t header_idx = (sequence_idx == 0) ? 1 : 0;
+    if ((++sequence_idx >= sequence_length_) || exiting_) {
+      header_idx |= 2;
+      sequence_idx = 0;
+    }
+
+    const uint64_t start_ns = NowNs();
+    TRTSERVER_Error* err = Infer(headers_[header_idx]);
+    const uint64_t end_ns = NowNs();
+
+    std::lock_guard<std::mutex> lk(mu_);
+    if (err != nullptr) {
+      LOG_ERROR << "error: inference failed: "
+                << TRTSERVER_ErrorCodeString(err) << " - "
+                << TRTSERVER_ErrorMessage(err);
+      TRTSERVER_ErrorDelete(err);
+      failed_ = true;
+      break;
+    }
+    timestamps_.emplace_back(start_ns, end_ns);
+  }
+}
+
+TRTSERVER_Error*
+Worker::Infer(const std::string& header)
+{
+  TRTSERVER_InferenceRequestProvider* request_provider = nullptr;
+  RETURN_IF_ERR(TRTSERVER_InferenceRequestProviderNew(
+      &request_provider, server_.get(), model_name_.c_str(), model_version_,
+      header.c_str(), header.size()));
+  std::unique_ptr<
+      TRTSERVER_InferenceRequestProvider,
+      decltype(&TRTSERVER_InferenceRequestProviderDelete)>
+      provider(request_provider, TRTSERVER_InferenceRequestProviderDelete);
+
+  for (size_t idx = 0; idx < inputs_.size(); ++idx) {
+    RETURN_IF_ERR(TRTSERVER_InferenceRequestProviderSetInputData(
+        request_provider, inputs_[idx].name_.c_str(), input_bases_[idx],
+        inputs_[idx].byte_size_, TRTSERVER_MEMORY_CPU));
+  }
+
+  auto p = new std::promise<TRTSERVER_InferenceResponse*>();
+  std::future<TRTSERVER_InferenceResponse*> completed = p->get_future();
+  TRTSERVER_Error* err = TRTSERVER_ServerInferAsync(
+      server_.get(), nullptr /* trace */, request_provider, allocator_,
+      (region_ != nullptr) ? &shm_outputs_ : nullptr, InferComplete,
+      reinterpret_cast<void*>(p));
+  if (err != nullptr) {
+    delete p;
+    return err;
+  }
+
+  TRTSERVER_InferenceResponse* response = completed.get();
+  err = TRTSERVER_InferenceResponseStatus(response);
+  LOG_IF_ERR(
+      TRTSERVER_InferenceResponseDelete(response),
+      "deleting inference response");
+  return err;
+}
+
+// Server-side statistics of the model, accumulated since the model
+// was loaded.
+struct ServerStats {
+  uint64_t request_count_;
+  uint64_t cumm_time_ns_;
+  uint64_t queue_time_ns_;
+  uint64_t compute_time_ns_;
+};
+
+TRTSERVER_Error*
+GetModelStatus(
+    const std::shared_ptr<TRTSERVER_Server>& server,
+    const std::string& model_name, ni::ModelStatus* model_status)
+{
+  TRTSERVER_Protobuf* status_protobuf;
+  RETURN_IF_ERR(TRTSERVER_ServerModelStatus(
+      server.get(), model_name.c_str(), &status_protobuf));
+  std::unique_ptr<TRTSERVER_Protobuf, decltype(&TRTSERVER_ProtobufDelete)>
+      protobuf(status_protobuf, TRTSERVER_ProtobufDelete);
+
+  const char* buffer;
+  size_t byte_size;
+  RETURN_IF_ERR(
+      TRTSERVER_ProtobufSerialize(status_protobuf, &buffer, &byte_size));
+
+  ni::ServerStatus server_status;
+  if (!server_status.ParseFromArray(buffer, byte_size)) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_INTERNAL, "failed to parse model status");
+  }
+
+  const auto itr = server_status.model_status().find(model_name);
+  if (itr == server_status.model_status().end()) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_NOT_FOUND,
+        std::string("unable to find status for model '" + model_name + "'")
+            .c_str());
+  }
+
+  *model_status = itr->second;
+  return nullptr;  // Success
+}
+
+TRTSERVER_Error*
+GetServerStats(
+    const std::shared_ptr<TRTSERVER_Server>& server,
+    const std::string& model_name, const int64_t model_version,
+    const uint32_t batch_size, ServerStats* stats)
+{
+  *stats = ServerStats{0, 0, 0, 0};
+
+  ni::ModelStatus model_status;
+  RETURN_IF_ERR(GetModelStatus(server, model_name, &model_status));
+
+  const auto vitr = model_status.version_status().find(model_version);
+  if (vitr != model_status.version_status().end()) {
+    const auto sitr = vitr->second.infer_stats().find(batch_size);
+    if (sitr != vitr->second.infer_stats().end()) {
+      stats->request_count_ = sitr->second.success().count();
+      stats->cumm_time_ns_ = sitr->second.success().total_time_ns();
+      stats->queue_time_ns_ = sitr->second.queue().total_time_ns();
+      stats->compute_time_ns_ = sitr->second.compute().total_time_ns();
+    }
+  }
+
+  return nullptr;  // Success
+}
+
+// The result of one measurement window.
+struct PerfStatus {
+  size_t concurrency_;
+  size_t request_count_;
+  double infer_per_sec_;
+  uint64_t avg_latency_ns_;
+  uint64_t std_us_;
+  uint64_t max_latency_ns_;
+  std::map<size_t, uint64_t> percentile_latency_ns_;
+  ServerStats server_;
+};
+
+// Measure one window of 'window_ms' while the workers are running.
+// Return false if any request failed.
+bool
+Measure(
+    const std::shared_ptr<TRTSERVER_Server>& server,
+    const std::string& model_name, const int64_t model_version,
+    const uint32_t batch_size, const uint64_t window_ms,
+    std::vector<std::unique_ptr<Worker>>& workers, PerfStatus* status)
+{
+  std::vector<Timestamp> timestamps;
+  ServerStats start_stats, end_stats;
+  FAIL_IF_ERR(
+      GetServerStats(
+          server, model_name, model_version, batch_size, &start_stats),
+      "getting server statistics");
+  for (auto& worker : workers) {
+    worker->SwapTimestamps(&timestamps);
+  }
+
+  const uint64_t start_ns = NowNs();
+  std::this_thread::sleep_for(std::chrono::milliseconds(window_ms));
+
+  bool ok = true;
+  std::vector<uint64_t> latencies;
+  for (auto& worker : workers) {
+    ok &= worker->SwapTimestamps(&timestamps);
+    for (const auto& ts : timestamps) {
+      latencies.push_back(ts.second - ts.first);
+    }
+  }
+  const uint64_t end_ns = NowNs();
+  FAIL_IF_ERR(
+      GetServerStats(server, model_name, model_version, batch_size, &end_stats),
+      "getting server statistics");
+
+  std::sort(latencies.begin(), latencies.end());
+  status->concurrency_ = workers.size();
+  status->request_count_ = latencies.size();
+  status->infer_per_sec_ =
+      (latencies.size() * batch_size) / ((end_ns - start_ns) / 1e9);
+
+  uint64_t total_ns = 0;
+  for (const auto latency : latencies) {
+    total_ns += latency;
+  }
+  status->avg_latency_ns_ =
+      latencies.empty() ? 0 : (total_ns / latencies.size());
+  double variance_us = 0;
+  for (const auto latency : latencies) {
+    const double diff_us =
+        ((double)latency - (double)status->avg_latency_ns_) / 1000;
+    variance_us += diff_us * diff_us;
+  }
+  status->std_us_ =
+      latencies.empty() ? 0 : std::sqrt(variance_us / latencies.size());
+  status->max_latency_ns_ = latencies.empty() ? 0 : latencies.back();
+  for (const size_t p : {50, 90, 95, 99}) {
+    status->percentile_latency_ns_[p] =
+        latencies.empty() ? 0
+                          : latencies[(latencies.size() * p / 100 +
+                                       ((latencies.size() * p % 100) ? 1 : 0)) -
+                                      1];
+  }
+
+  status->server_.request_count_ =
+      end_stats.request_count_ - start_stats.request_count_;
+  status->server_.cumm_time_ns_ =
+      end_stats.cumm_time_ns_ - start_stats.cumm_time_ns_;
+  status->server_.queue_time_ns_ =
+      end_stats.queue_time_ns_ - start_stats.queue_time_ns_;
+  status->server_.compute_time_ns_ =
+      end_stats.compute_time_ns_ - start_stats.compute_time_ns_;
+
+  return ok;
+}
+
+// The latency used to decide stability and to report.
+uint64_t
+StableLatencyNs(const PerfStatus& status, const int64_t percentile)
+{
+  if (percentile == -1) {
+    return status.avg_latency_ns_;
+  }
+  return status.percentile_latency_ns_.at(percentile);
+}
+
+// Return true if throughput and latency of the last three windows
+// are all within 'threshold' of their average.
+bool
+IsStable(
+    const std::vector<PerfStatus>& windows, const double threshold,
+    const int64_t percentile)
+{
+  if (windows.size() < 3) {
+    return false;
+  }
+
+  double avg_infer_per_sec = 0, avg_latency = 0;
+  for (size_t idx = windows.size() - 3; idx < windows.size(); ++idx) {
+    avg_infer_per_sec += windows[idx].infer_per_sec_ / 3;
+    avg_latency += StableLatencyNs(windows[idx], percentile) / 3.0;
+  }
+  for (size_t idx = windows.size() - 3; idx < windows.size(); ++idx) {
+    const double latency = StableLatencyNs(windows[idx], percentile);
+    if ((std::fabs(windows[idx].infer_per_sec_ - avg_infer_per_sec) >
+         threshold * avg_infer_per_sec) ||
+        (std::fabs(latency - avg_latency) > threshold * avg_latency)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void
+Report(const PerfStatus& status, const int64_t percentile)
+{
+  const uint64_t request_count = std::max<uint64_t>(
+      1, status.server_.request_count_);
+  const uint64_t cumm_avg_us =
+      status.server_.cumm_time_ns_ / request_count / 1000;
+  const uint64_t queue_avg_us =
+      status.server_.queue_time_ns_ / request_count / 1000;
+  const uint64_t compute_avg_us =
+      status.server_.compute_time_ns_ / request_count / 1000;
+  const uint64_t overhead_us = (cumm_avg_us > queue_avg_us + compute_avg_us)
+                                   ? cumm_avg_us - queue_avg_us - compute_avg_us
+                                   : 0;
+
+  std::cout << "  Client: " << std::endl
+            << "    Request count: " << status.request_count_ << std::endl
+            << "    Throughput: " << status.infer_per_sec_ << " infer/sec"
+            << std::endl;
+  if (percentile == -1) {
+    std::cout << "    Avg latency: " << (status.avg_latency_ns_ / 1000)
+              << " usec (standard deviation " << status.std_us_ << " usec)"
+              << std::endl;
+  }
+  for (const auto& p : status.percentile_latency_ns_) {
+    std::cout << "    p" << p.first << " latency: " << (p.second / 1000)
+              << " usec" << std::endl;
+  }
+  std::cout << "  Server: " << std::endl
+            << "    Request count: " << status.server_.request_count_
+            << std::endl
+            << "    Avg request latency: " << cumm_avg_us << " usec"
+            << " (overhead " << overhead_us << " usec + queue "
+            << queue_avg_us << " usec + compute " << compute_avg_us
+            << " usec)" << std::endl
+            << std::endl;
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+  std::string model_repository_path;
+  std::string model_name;
+  int64_t model_version = -1;
+  uint32_t batch_size = 1;
+  size_t concurrency = 1;
+  bool dynamic_concurrency = false;
+  size_t max_concurrency = 0;
+  uint64_t window_ms = 5000;
+  double stability_threshold = 0.1;
+  size_t max_trials = 10;
+  int64_t percentile = -1;
+  size_t sequence_length = 20;
+  bool use_shared_memory = false;
+  std::string filename;
+  int verbose_level = 0;
+  std::unordered_map<std::string, std::vector<int64_t>> input_shapes;
+
+  static struct option long_options[] = {{"model-repository", 1, 0, 0},
+                                         {"percentile", 1, 0, 1},
+                                         {"shape", 1, 0, 2},
+                                         {"sequence-length", 1, 0, 3},
+                                         {"shared-memory", 1, 0, 4},
+                                         {0, 0, 0, 0}};
+
+  // Parse commandline...
+  int opt;
+  while ((opt = getopt_long(
+              argc, argv, "vdm:x:b:t:c:p:s:r:f:", long_options, NULL)) !=
+         -1) {
+    switch (opt) {
+      case 0:
+        model_repository_path = optarg;
+        break;
+      case 1:
+        percentile = std::atoi(optarg);
+        break;
+      case 2: {
+        std::string name;
+        std::vector<int64_t> shape;
+        if (!ParseInputShape(optarg, &name, &shape)) {
+          Usage(argv, "failed to parse input shape: " + std::string(optarg));
+        }
+        input_shapes[name] = shape;
+        break;
+      }
+      case 3:
+        sequence_length = std::atoi(optarg);
+        break;
+      case 4: {
+        const std::string type(optarg);
+        if (type == "system") {
+          use_shared_memory = true;
+        } else if (type != "none") {
+          Usage(argv, "unsupported shared memory type: " + type);
+        }
+        break;
+      }
+      case 'v':
+        verbose_level = 1;
+        break;
+      case 'd':
+        dynamic_concurrency = true;
+        break;
+      case 'm':
+        model_name = optarg;
+        break;
+      case 'x':
+        model_version = std::atoll(optarg);
+        break;
+      case 'b':
+        batch_size = std::atoi(optarg);
+        break;
+      case 't':
+        concurrency = std::atoi(optarg);
+        break;
+      case 'c':
+        max_concurrency = std::atoi(optarg);
+        break;
+      case 'p':
+        window_ms = std::atoi(optarg);
+        break;
+      case 's':
+        stability_threshold = atof(optarg) / 100;
+        break;
+      case 'r':
+        max_trials = std::atoi(optarg);
+        break;
+      case 'f':
+        filename = optarg;
+        break;
+      case '?':
+        Usage(argv);
+        break;
+    }
+  }
+
+  if (model_repository_path.empty()) {
+    Usage(argv, "--model-repository must be used to specify model repository");
+  }
+  if (model_name.empty()) {
+    Usage(argv, "-m flag must be specified");
+  }
+  if ((batch_size == 0) || (concurrency == 0) || (window_ms == 0)) {
+    Usage(argv, "batch size, concurrency and window must be > 0");
+  }
+  if (max_trials == 0) {
+    Usage(argv, "maximum number of measurements must be > 0");
+  }
+  if ((percentile != -1) && (percentile != 50) && (percentile != 90) &&
+      (percentile != 95) && (percentile != 99)) {
+    Usage(argv, "percentile must be one of 50, 90, 95 or 99");
+  }
+  if (sequence_length == 0) {
+    Usage(argv, "sequence length must be > 0");
+  }
+  if (!dynamic_concurrency) {
+    max_concurrency = concurrency;
+  } else if (max_concurrency < concurrency) {
+    Usage(argv, "-c must be >= -t when -d is specified");
+  }
+
+  // Create the server...
+  TRTSERVER_ServerOptions* server_options = nullptr;
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsNew(&server_options), "creating server options");
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsSetModelRepositoryPath(
+          server_options, model_repository_path.c_str()),
+      "setting model repository path");
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsSetLogVerbose(server_options, verbose_level),
+      "setting verbose logging level");
+
+  TRTSERVER_Server* server_ptr = nullptr;
+  FAIL_IF_ERR(
+      TRTSERVER_ServerNew(&server_ptr, server_options), "creating server");
+  FAIL_IF_ERR(
+      TRTSERVER_ServerOptionsDelete(server_options), "deleting server options");
+
+  std::shared_ptr<TRTSERVER_Server> server(server_ptr, TRTSERVER_ServerDelete);
+
+  // Wait for the model to become ready and resolve the latest version
+  // if no version is requested.
+  ni::ModelConfig config;
+  for (size_t iters = 0;; ++iters) {
+    ni::ModelStatus model_status;
+    FAIL_IF_ERR(
+        GetModelStatus(server, model_name, &model_status),
+        "getting model status");
+
+    int64_t ready_version = -1;
+    for (const auto& vs : model_status.version_status()) {
+      if ((vs.second.ready_state() == ni::ModelReadyState::MODEL_READY) &&
+          (((model_version == -1) && ((int64_t)vs.first > ready_version)) ||
+           ((int64_t)vs.first == model_version))) {
+        ready_version = vs.first;
+      }
+    }
+    if (ready_version != -1) {
+      model_version = ready_version;
+      config = model_status.config();
+      break;
+    }
+
+    if (iters >= 20) {
+      FAIL("model '" + model_name + "' is not ready");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  }
+
+  if ((config.max_batch_size() == 0) && (batch_size != 1)) {
+    FAIL("model '" + model_name + "' does not support batching");
+  } else if (batch_size > (uint32_t)std::max(1, config.max_batch_size())) {
+    FAIL(
+        "batch size " + std::to_string(batch_size) +
+        " exceeds the maximum batch size of model '" + model_name + "'");
+  }
+
+  // Zero-valued inputs and the size of each fixed-shape output.
+  ni::InferRequestHeader header;
+  header.set_batch_size(batch_size);
+  std::vector<TensorData> inputs, outputs;
+  for (const auto& io : config.input()) {
+    if (!ni::IsFixedSizeDataType(io.data_type())) {
+      FAIL("input '" + io.name() + "' must have a fixed-size data type");
+    }
+
+    auto input = header.add_input();
+    input->set_name(io.name());
+
+    std::vector<int64_t> shape(io.dims().begin(), io.dims().end());
+    const auto itr = input_shapes.find(io.name());
+    if (itr != input_shapes.end()) {
+      shape = itr->second;
+      for (const auto dim : shape) {
+        input->add_dims(dim);
+      }
+    }
+    const int64_t byte_size = ni::GetByteSize(io.data_type(), shape);
+    if (byte_size < 0) {
+      FAIL("input '" + io.name() + "' has variable-size shape, use --shape");
+    }
+
+    inputs.emplace_back();
+    inputs.back().name_ = io.name();
+    inputs.back().byte_size_ = byte_size * batch_size;
+    inputs.back().data_.resize(inputs.back().byte_size_);
+    input->set_batch_byte_size(inputs.back().byte_size_);
+  }
+  for (const auto& io : config.output()) {
+    header.add_output()->set_name(io.name());
+    const int64_t byte_size = ni::GetByteSize(io);
+    outputs.emplace_back();
+    outputs.back().name_ = io.name();
+    outputs.back().byte_size_ =
+        (byte_size < 0) ? 0 : (size_t)byte_size * batch_size;
+  }
+  size_t shm_byte_size = 0;
+  for (const auto& tensor : inputs) {
+    shm_byte_size += tensor.byte_size_;
+  }
+  for (const auto& tensor : outputs) {
+    shm_byte_size += tensor.byte_size_;
+  }
+
+  // Without shared memory the outputs are written to buffers recycled
+  // by the server's pooled allocator.
+  TRTSERVER_ResponseAllocator* allocator = nullptr;
+  if (use_shared_memory) {
+    FAIL_IF_ERR(
+        TRTSERVER_ResponseAllocatorNew(
+            &allocator, ResponseAlloc, ResponseRelease),
+        "creating response allocator");
+  } else {
+    FAIL_IF_ERR(
+        TRTSERVER_ResponseAllocatorNewPooled(&allocator),
+        "creating response allocator");
+  }
+
+  const bool is_sequence = config.has_sequence_batching();
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<PerfStatus> summary;
+  bool failed = false;
+  for (size_t cnt = concurrency; (cnt <= max_concurrency) && !failed; ++cnt) {
+    while (workers.size() < cnt) {
+      workers.emplace_back(new Worker(
+          server, allocator, model_name, model_version, header, inputs,
+          outputs, is_sequence ? workers.size() + 1 : 0,
+          is_sequence ? sequence_length : 1));
+      if (use_shared_memory) {
+        std::unique_ptr<SharedMemoryRegion> region;
+        FAIL_IF_ERR(
+            SharedMemoryRegion::Create(
+                server,
+                "/perf_inprocess_" + std::to_string(getpid()) + "_" +
+                    std::to_string(workers.size()),
+                shm_byte_size, &region),
+            "creating shared memory region");
+        FAIL_IF_ERR(
+            workers.back()->UseSharedMemory(std::move(region)),
+            "placing tensors in shared memory");
+      }
+      workers.back()->Start();
+    }
+
+    std::cout << "Request concurrency: " << cnt << std::endl;
+    std::vector<PerfStatus> windows;
+    for (size_t trial = 0; trial < max_trials; ++trial) {
+      windows.emplace_back();
+      if (!Measure(
+              server, model_name, model_version, batch_size, window_ms,
+              workers, &windows.back())) {
+        failed = true;
+        break;
+      }
+      if (verbose_level > 0) {
+        std::cout << "  Pass [" << (trial + 1)
+                  << "] throughput: " << windows.back().infer_per_sec_
+                  << " infer/sec. "
+                  << ((percentile == -1) ? "Avg latency: "
+                                         : "p" + std::to_string(percentile) +
+                                               " latency: ")
+                  << (StableLatencyNs(windows.back(), percentile) / 1000)
+                  << " usec" << std::endl;
+      }
+      if (IsStable(windows, stability_threshold, percentile)) {
+        break;
+      }
+    }
+    if (failed) {
+      break;
+    }
+    if (!IsStable(windows, stability_threshold, percentile)) {
+      std::cerr << "Failed to obtain stable measurement within " << max_trials
+                << " measurement windows for concurrency " << cnt
+                << ". Please try to increase the time window." << std::endl;
+    }
+
+    Report(windows.back(), percentile);
+    summary.push_back(windows.back());
+  }
+
+  // Workers must exit, completing any sequence they have started,
+  // before the allocator and the server are deleted.
+  workers.clear();
+  FAIL_IF_ERR(
+      TRTSERVER_ResponseAllocatorDelete(allocator),
+      "deleting response allocator");
+
+  if (failed) {
+    FAIL("inference request failed");
+  }
+
+  std::cout << "Inferences/Second vs. Client "
+            << ((percentile == -1) ? "Average Batch Latency"
+                                   : "p" + std::to_string(percentile) +
+                                         " Batch Latency")
+            << std::endl;
+  for (const auto& status : summary) {
+    std::cout << "Concurrency: " << status.concurrency_ << ", "
+              << status.infer_per_sec_ << " infer/sec, latency "
+              << (StableLatencyNs(status, percentile) / 1000) << " usec"
+              << std::endl;
+  }
+
+  // Same columns as perf_client so the results can be compared with
+  // those measured through an endpoint. There is no network, so the
+  // send and receive columns are zero and the 'Network+Server
+  // Send/Recv' column holds the time spent in the C API outside of
+  // the server's queue and compute.
+  if (!filename.empty()) {
+    std::ofstream ofs(filename, std::ofstream::out);
+    ofs << "Concurrency,Inferences/Second,Client Send,"
+        << "Network+Server Send/Recv,Server Queue,"
+        << "Server Compute,Client Recv";
+    for (const auto& p : summary.front().percentile_latency_ns_) {
+      ofs << ",p" << p.first << " latency";
+    }
+    ofs << ",max latency" << std::endl;
+
+    for (const auto& status : summary) {
+      const uint64_t request_count =
+          std::max<uint64_t>(1, status.server_.request_count_);
+      const uint64_t queue_ns = status.server_.queue_time_ns_ / request_count;
+      const uint64_t compute_ns =
+          status.server_.compute_time_ns_ / request_count;
+      const uint64_t overhead_ns =
+          (status.avg_latency_ns_ > (queue_ns + compute_ns))
+              ? status.avg_latency_ns_ - (queue_ns + compute_ns)
+              : 0;
+      ofs << status.concurrency_ << "," << status.infer_per_sec_ << ",0,"
+          << (overhead_ns / 1000) << "," << (queue_ns / 1000) << ","
+          << (compute_ns / 1000) << ",0";
+      for (const auto& p : status.percentile_latency_ns_) {
+        ofs << "," << (p.second / 1000);
+      }
+      ofs << "," << (status.max_latency_ns_ / 1000) << std::endl;
+    }
+  }
+
+  return 0;
+}
@@ -26,20 +26,48 @@
 
 #include "src/servers/shared_memory_block_manager.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
 namespace nvidia { namespace inferenceserver {
 
+namespace {
+
+// Pool blocks are sized in powers of two, no smaller than this, so
+// that a freed block can be reused by outputs of similar size.
+constexpr size_t kMinPoolBlockByteSize = 64 * 1024;
+
+}  // namespace
+
+SharedMemoryBlockManager::SharedMemoryBlockManager()
+    : pool_max_byte_size_(0), pool_byte_size_(0), next_pool_block_id_(0)
+{
+}
+
 SharedMemoryBlockManager::~SharedMemoryBlockManager()
 {
   TRTSERVER_Error* err = Clear();
   if (err != nullptr) {
     LOG_ERROR << TRTSERVER_ErrorMessage(err);
   }
+
+  std::lock_guard<std::mutex> lock(pool_mu_);
+  for (const auto& pr : free_pool_blocks_) {
+    DestroyPoolBlock(pr.second);
+  }
+  for (const auto& pr : used_pool_blocks_) {
+    DestroyPoolBlock(pr.second);
+  }
 }
 
 TRTSERVER_Error*
 SharedMemoryBlockManager::Create(
     TRTSERVER_SharedMemoryBlock** smb, const std::string& name,
-    const std::string& shm_key, const size_t offset, const size_t byte_size)
+    const std::string& shm_key, const size_t offset, const size_t byte_size,
+    const bool hugetlbfs, const bool lock_pages)
 {
   *smb = nullptr;
 
@@ -52,6 +80,39 @@ SharedMemoryBlockManager::Create(
 
   RETURN_IF_ERR(TRTSERVER_SharedMemoryBlockCpuNew(
       smb, name.c_str(), shm_key.c_str(), offset, byte_size));
+  TRTSERVER_Error* err =
+      TRTSERVER_SharedMemoryBlockSetHugetlbfs(*smb, hugetlbfs);
+  if (err == nullptr) {
+    err = TRTSERVER_SharedMemoryBlockSetLockPages(*smb, lock_pages);
+  }
+  if (err != nullptr) {
+    TRTSERVER_SharedMemoryBlockDelete(*smb);
+    *smb = nullptr;
+    return err;
+  }
+  blocks_.emplace(name, *smb);
+
+  return nullptr;  // success
+}
+
+TRTSERVER_Error*
+SharedMemoryBlockManager::CreateCuda(
+    TRTSERVER_SharedMemoryBlock** smb, const std::string& name,
+    const std::string& shm_key, const size_t handle_offset,
+    const size_t offset, const size_t byte_size, const int device_id)
+{
+  *smb = nullptr;
+
+  if (blocks_.find(name) != blocks_.end()) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_ALREADY_EXISTS,
+        std::string("shared memory block '" + name + "' already in manager")
+            .c_str());
+  }
+
+  RETURN_IF_ERR(TRTSERVER_SharedMemoryBlockGpuNew(
+      smb, name.c_str(), shm_key.c_str(), handle_offset, offset, byte_size,
+      device_id));
   blocks_.emplace(name, *smb);
 
   return nullptr;  // success
@@ -135,4 +196,129 @@ SharedMemoryBlockManager::Clear()
   return nullptr;  // success
 }
 
+void
+SharedMemoryBlockManager::SetOutputPoolByteSize(const size_t byte_size)
+{
+  std::lock_guard<std::mutex> lock(pool_mu_);
+  pool_max_byte_size_ = byte_size;
+}
+
+TRTSERVER_Error*
+SharedMemoryBlockManager::AllocateOutputBlock(
+    std::string* shm_key, void** base, const size_t byte_size)
+{
+  *base = nullptr;
+
+  size_t block_byte_size = kMinPoolBlockByteSize;
+  while (block_byte_size < byte_size) {
+    block_byte_size *= 2;
+  }
+
+  std::lock_guard<std::mutex> lock(pool_mu_);
+
+  PoolBlock block;
+  auto itr = free_pool_blocks_.find(block_byte_size);
+  if (itr != free_pool_blocks_.end()) {
+    block = itr->second;
+    free_pool_blocks_.erase(itr);
+  } else {
+    // Make room for a new block by destroying free blocks of other
+    // sizes. If the blocks in use leave no room then the output
+    // isn't returned in the pool.
+    while (((pool_byte_size_ + block_byte_size) > pool_max_byte_size_) &&
+           !free_pool_blocks_.empty()) {
+      auto evict = free_pool_blocks_.begin();
+      DestroyPoolBlock(evict->second);
+      free_pool_blocks_.erase(evict);
+    }
+    if ((pool_byte_size_ + block_byte_size) > pool_max_byte_size_) {
+      return nullptr;  // success
+    }
+
+    RETURN_IF_ERR(CreatePoolBlock(block_byte_size, &block));
+  }
+
+  *shm_key = block.shm_key_;
+  *base = block.base_;
+  used_pool_blocks_.emplace(block.shm_key_, block);
+
+  return nullptr;  // success
+}
+
+TRTSERVER_Error*
+SharedMemoryBlockManager::ReleaseOutputBlock(const std::string& shm_key)
+{
+  std::lock_guard<std::mutex> lock(pool_mu_);
+
+  auto itr = used_pool_blocks_.find(shm_key);
+  if (itr == used_pool_blocks_.end()) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_NOT_FOUND,
+        std::string("output shared memory block '" + shm_key + "' not found")
+            .c_str());
+  }
+
+  // A pool that was shrunk keeps only the blocks that still fit.
+  if (pool_byte_size_ > pool_max_byte_size_) {
+    DestroyPoolBlock(itr->second);
+  } else {
+    free_pool_blocks_.emplace(itr->second.byte_size_, itr->second);
+  }
+  used_pool_blocks_.erase(itr);
+
+  return nullptr;  // success
+}
+
+TRTSERVER_Error*
+SharedMemoryBlockManager::CreatePoolBlock(
+    const size_t byte_size, PoolBlock* block)
+{
+  const std::string shm_key = "/trtserver_output_" + std::to_string(getpid()) +
+                              "_" + std::to_string(next_pool_block_id_++);
+
+  int shm_fd =
+      shm_open(shm_key.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+  if (shm_fd == -1) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_INTERNAL,
+        std::string(
+            "failed to create output shared memory block '" + shm_key +
+            "': " + strerror(errno))
+            .c_str());
+  }
+
+  void* base = MAP_FAILED;
+  if (ftruncate(shm_fd, byte_size) == 0) {
+    base = mmap(
+        nullptr, byte_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+  }
+  const int err = errno;
+  close(shm_fd);
+
+  if (base == MAP_FAILED) {
+    shm_unlink(shm_key.c_str());
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_INTERNAL,
+        std::string(
+            "failed to map output shared memory block '" + shm_key +
+            "': " + strerror(err))
+            .c_str());
+  }
+
+  block->shm_key_ = shm_key;
+  block->base_ = base;
+  block->byte_size_ = byte_size;
+  pool_byte_size_ += byte_size;
+
+  return nullptr;  // success
+}
+
+void
+SharedMemoryBlockManager::DestroyPoolBlock(const PoolBlock& block)
+{
+  munmap(block.base_, block.byte_size_);
+  shm_unlink(block.shm_key_.c_str());
+  pool_byte_size_ -= block.byte_size_;
+}
+
 }}  // namespace nvidia::inferenceserver
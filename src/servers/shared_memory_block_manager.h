@@ -25,6 +25,8 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <map>
+#include <mutex>
 #include <unordered_map>
 #include "src/core/trtserver.h"
 #include "src/servers/common.h"
@@ -36,7 +38,7 @@ namespace nvidia { namespace inferenceserver {
 ///
 class SharedMemoryBlockManager {
  public:
-  SharedMemoryBlockManager() = default;
+  SharedMemoryBlockManager();
   ~SharedMemoryBlockManager();
 
   /// Add a shared memory block representing shared memory in system
@@ -50,10 +52,35 @@ class SharedMemoryBlockManager {
   /// \param offset The offset within the shared memory object to the
   /// start of the block.
   /// \param byte_size The size, in bytes of the block.
+  /// \param hugetlbfs If true 'shm_key' is the path of a file on a
+  /// mounted hugetlbfs.
+  /// \param lock_pages If true the pages of the block are faulted in
+  /// and locked when the block is registered.
   /// \return a TRTSERVER_Error indicating success or failure.
   TRTSERVER_Error* Create(
       TRTSERVER_SharedMemoryBlock** smb, const std::string& name,
-      const std::string& shm_key, const size_t offset, const size_t byte_size);
+      const std::string& shm_key, const size_t offset, const size_t byte_size,
+      const bool hugetlbfs, const bool lock_pages);
+
+  /// Add a shared memory block representing CUDA shared memory on a
+  /// GPU to the manager. Return TRTSERVER_ERROR_ALREADY_EXISTS if a
+  /// shared memory block of the same name already exists in the
+  /// manager.
+  /// \param smb Returns the shared memory block.
+  /// \param name The name of the memory block.
+  /// \param shm_key The name of the posix shared memory object
+  /// containing the cudaIpcMemHandle_t of the block.
+  /// \param handle_offset The offset within the posix shared memory
+  /// object to the cudaIpcMemHandle_t.
+  /// \param offset The offset within the GPU memory to the start of
+  /// the block.
+  /// \param byte_size The size, in bytes of the block.
+  /// \param device_id The GPU device that holds the block.
+  /// \return a TRTSERVER_Error indicating success or failure.
+  TRTSERVER_Error* CreateCuda(
+      TRTSERVER_SharedMemoryBlock** smb, const std::string& name,
+      const std::string& shm_key, const size_t handle_offset,
+      const size_t offset, const size_t byte_size, const int device_id);
 
   /// Get a named shared memory block. Return
   /// TRTSERVER_ERROR_NOT_FOUND if named block doesn't exist.
@@ -85,8 +112,60 @@ class SharedMemoryBlockManager {
   /// \return a TRTSERVER_Error indicating success or failure.
   TRTSERVER_Error* Clear();
 
+  /// Set the maximum total size of the server-owned pool of system
+  /// shared memory blocks that outputs can be returned in. Zero, the
+  /// default, disables the pool.
+  /// \param byte_size The maximum size, in bytes, of the pool.
+  void SetOutputPoolByteSize(const size_t byte_size);
+
+  /// Allocate a block from the server-owned output pool. Each block
+  /// is a POSIX shared memory object of its own, which the client
+  /// maps using 'shm_key' and must release with ReleaseOutputBlock
+  /// once it has read the output. Return 'base' == nullptr if the
+  /// pool is disabled or has no space for the block.
+  /// \param shm_key Returns the name of the posix shared memory
+  /// object of the block.
+  /// \param base Returns the address of the block in the server.
+  /// \param byte_size The minimum size, in bytes, of the block.
+  /// \return a TRTSERVER_Error indicating success or failure.
+  TRTSERVER_Error* AllocateOutputBlock(
+      std::string* shm_key, void** base, const size_t byte_size);
+
+  /// Return a block to the server-owned output pool so that later
+  /// outputs can reuse it. Return TRTSERVER_ERROR_NOT_FOUND if
+  /// 'shm_key' is not an allocated block of the pool.
+  /// \param shm_key The name of the posix shared memory object of the
+  /// block.
+  /// \return a TRTSERVER_Error indicating success or failure.
+  TRTSERVER_Error* ReleaseOutputBlock(const std::string& shm_key);
+
  private:
+  struct PoolBlock {
+    std::string shm_key_;
+    void* base_;
+    size_t byte_size_;
+  };
+
+  // Create a pool block of 'byte_size' bytes. Must hold 'pool_mu_'.
+  TRTSERVER_Error* CreatePoolBlock(const size_t byte_size, PoolBlock* block);
+
+  // Unmap and unlink a pool block. Must hold 'pool_mu_'.
+  void DestroyPoolBlock(const PoolBlock& block);
+
   std::unordered_map<std::string, TRTSERVER_SharedMemoryBlock*> blocks_;
+
+  // The output pool is used by the threads that allocate and
+  // complete inference responses and so, unlike 'blocks_', is
+  // protected by its own mutex.
+  std::mutex pool_mu_;
+  size_t pool_max_byte_size_;
+  size_t pool_byte_size_;
+  uint64_t next_pool_block_id_;
+
+  // The free blocks keyed by their size, and the blocks allocated to
+  // outputs that the client hasn't released, keyed by their name.
+  std::multimap<size_t, PoolBlock> free_pool_blocks_;
+  std::unordered_map<std::string, PoolBlock> used_pool_blocks_;
 };
 
 }}  // namespace nvidia::inferenceserver
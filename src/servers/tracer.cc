@@ -26,15 +26,94 @@
 
 #include "src/servers/tracer.h"
 
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <limits>
 #include "src/core/constants.h"
 #include "src/core/logging.h"
 #include "src/servers/common.h"
 
 namespace nvidia { namespace inferenceserver {
 
+namespace {
+
+// Magic and version at the start of a binary trace file.
+constexpr char kBinaryTraceMagic[] = "TRTISTRC";
+constexpr uint32_t kBinaryTraceVersion = 1;
+
+// Size of the ring buffer of each thread writing binary traces, and
+// the interval at which the rings are flushed to the trace file.
+constexpr size_t kTraceRingByteSize = 1 << 20;
+constexpr std::chrono::milliseconds kTraceFlushInterval(100);
+
+// Number of recent latencies of each model that the percentile of
+// tail-based sampling is computed from, and the number of requests
+// between recomputing it.
+constexpr size_t kTailLatencyWindow = 1000;
+constexpr size_t kTailUpdateInterval = 100;
+
+template <typename T>
+void
+AppendBinary(std::string* out, const T& value)
+{
+  out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void
+AppendBinaryString(std::string* out, const std::string& value)
+{
+  AppendBinary(out, static_cast<uint32_t>(value.size()));
+  out->append(value);
+}
+
+}  // namespace
+
+TraceRing::TraceRing(size_t byte_size)
+    : buffer_(byte_size), head_(0), tail_(0)
+{
+}
+
+bool
+TraceRing::Write(const std::string& record)
+{
+  const uint64_t head = head_.load(std::memory_order_relaxed);
+  const uint64_t tail = tail_.load(std::memory_order_acquire);
+  if ((buffer_.size() - (head - tail)) < record.size()) {
+    return false;
+  }
+
+  const size_t offset = head % buffer_.size();
+  const size_t first = std::min(record.size(), buffer_.size() - offset);
+  memcpy(&buffer_[offset], record.data(), first);
+  memcpy(&buffer_[0], record.data() + first, record.size() - first);
+
+  head_.store(head + record.size(), std::memory_order_release);
+  return true;
+}
+
+void
+TraceRing::Drain(std::ostream* out)
+{
+  const uint64_t tail = tail_.load(std::memory_order_relaxed);
+  const uint64_t head = head_.load(std::memory_order_acquire);
+  if (head == tail) {
+    return;
+  }
+
+  const size_t offset = tail % buffer_.size();
+  const size_t size = head - tail;
+  const size_t first = std::min(size, buffer_.size() - offset);
+  out->write(&buffer_[offset], first);
+  out->write(&buffer_[0], size - first);
+
+  tail_.store(head, std::memory_order_release);
+}
+
 TRTSERVER_Error*
 TraceManager::Create(
-    std::shared_ptr<TraceManager>* manager, const std::string& filepath)
+    std::shared_ptr<TraceManager>* manager, const std::string& filepath,
+    const Format format)
 {
   if (filepath.empty()) {
     return TRTSERVER_ErrorNew(
@@ -44,10 +123,19 @@ TraceManager::Create(
 
   try {
     std::unique_ptr<std::ofstream> trace_file(new std::ofstream);
-    trace_file->open(filepath);
+    if (format == Format::BINARY) {
+      trace_file->open(filepath, std::ios::out | std::ios::binary);
+      trace_file->write(kBinaryTraceMagic, sizeof(kBinaryTraceMagic) - 1);
+      trace_file->write(
+          reinterpret_cast<const char*>(&kBinaryTraceVersion),
+          sizeof(kBinaryTraceVersion));
+    } else {
+      trace_file->open(filepath);
+    }
 
-    LOG_INFO << "Configure trace: " << filepath;
-    manager->reset(new TraceManager(std::move(trace_file)));
+    LOG_INFO << "Configure trace: " << filepath
+             << ((format == Format::BINARY) ? " (binary)" : "");
+    manager->reset(new TraceManager(std::move(trace_file), format));
   }
   catch (const std::ofstream::failure& e) {
     return TRTSERVER_ErrorNew(
@@ -64,23 +152,50 @@ TraceManager::Create(
   return nullptr;  // success
 }
 
-TraceManager::TraceManager(std::unique_ptr<std::ofstream> trace_file)
-    : trace_file_(std::move(trace_file)), trace_cnt_(0),
-      level_(TRTSERVER_TRACE_LEVEL_DISABLED), rate_(1000), sample_(1)
+TraceManager::TraceManager(
+    std::unique_ptr<std::ofstream> trace_file, const Format format)
+    : trace_file_(std::move(trace_file)), trace_cnt_(0), format_(format),
+      id_(NextId()), dropped_cnt_(0), flush_exit_(false),
+      level_(TRTSERVER_TRACE_LEVEL_DISABLED), rate_(1000), sample_(1),
+      tail_sampling_(false), tail_percentile_(0)
 {
+  if (format_ == Format::BINARY) {
+    flush_thread_ = std::thread([this]() { FlushThread(); });
+  }
 }
 
 TraceManager::~TraceManager()
 {
   LOG_INFO << "Close trace";
 
-  if (trace_cnt_ > 0) {
+  if (flush_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(flush_mu_);
+      flush_exit_ = true;
+    }
+    flush_cv_.notify_all();
+    flush_thread_.join();
+  }
+
+  if (dropped_cnt_ > 0) {
+    LOG_WARNING << "Dropped " << dropped_cnt_
+                << " traces that didn't fit in the trace buffers";
+  }
+
+  if ((format_ == Format::JSON) && (trace_cnt_ > 0)) {
     *trace_file_ << "]";
   }
 
   trace_file_->close();
 }
 
+uint64_t
+TraceManager::NextId()
+{
+  static std::atomic<uint64_t> next_id(1);
+  return next_id++;
+}
+
 TRTSERVER_Error*
 TraceManager::SetLevel(TRTSERVER_Trace_Level level)
 {
@@ -103,15 +218,100 @@ TraceManager::SetRate(uint32_t rate)
   return nullptr;  // success
 }
 
+TRTSERVER_Error*
+TraceManager::SetTailSampling(
+    const std::unordered_map<std::string, uint64_t>& latency_thresholds_us,
+    double percentile)
+{
+  if ((percentile < 0) || (percentile >= 100)) {
+    return TRTSERVER_ErrorNew(
+        TRTSERVER_ERROR_INVALID_ARG,
+        "tail trace percentile must be >= 0 and < 100");
+  }
+
+  // We don't bother with a mutex here since this is the only writer.
+  tail_sampling_ = true;
+  tail_thresholds_ns_.clear();
+  for (const auto& threshold : latency_thresholds_us) {
+    tail_thresholds_ns_.emplace(threshold.first, threshold.second * 1000);
+  }
+  tail_percentile_ = percentile;
+
+  LOG_INFO << "Setting tail trace sampling: " << latency_thresholds_us.size()
+           << " latency thresholds, percentile " << percentile;
+
+  return nullptr;  // success
+}
+
+TraceManager::TailLatencies::TailLatencies()
+    : next_(0), update_cnt_(0),
+      threshold_ns_(std::numeric_limits<uint64_t>::max())
+{
+  latencies_ns_.reserve(kTailLatencyWindow);
+}
+
+bool
+TraceManager::KeepTrace(
+    const std::string& model_name, uint64_t latency_ns, bool failed,
+    bool sampled)
+{
+  if (!tail_sampling_) {
+    return true;
+  }
+
+  const bool keep = sampled || failed;
+
+  auto itr = tail_thresholds_ns_.find(model_name);
+  if (itr == tail_thresholds_ns_.end()) {
+    itr = tail_thresholds_ns_.find("");
+  }
+  if (itr != tail_thresholds_ns_.end()) {
+    return keep || (latency_ns > itr->second);
+  }
+
+  if (tail_percentile_ == 0) {
+    return keep;
+  }
+
+  std::lock_guard<std::mutex> lock(tail_mu_);
+  TailLatencies& tail = tail_latencies_[model_name];
+  if (tail.latencies_ns_.size() < kTailLatencyWindow) {
+    tail.latencies_ns_.push_back(latency_ns);
+  } else {
+    tail.latencies_ns_[tail.next_] = latency_ns;
+    tail.next_ = (tail.next_ + 1) % kTailLatencyWindow;
+  }
+
+  // The threshold is only derived once enough requests are recorded
+  // and is refreshed periodically as sorting the window for every
+  // request would be too costly.
+  tail.update_cnt_++;
+  if ((tail.update_cnt_ >= kTailUpdateInterval) &&
+      (tail.latencies_ns_.size() >= kTailUpdateInterval)) {
+    tail.update_cnt_ = 0;
+    std::vector<uint64_t> sorted(tail.latencies_ns_);
+    const size_t idx = std::min(
+        sorted.size() - 1,
+        static_cast<size_t>(sorted.size() * tail_percentile_ / 100));
+    std::nth_element(sorted.begin(), sorted.begin() + idx, sorted.end());
+    tail.threshold_ns_ = sorted[idx];
+  }
+
+  return keep || (latency_ns > tail.threshold_ns_);
+}
+
 Tracer*
 TraceManager::SampleTrace()
 {
+  // With tail-based sampling every request is traced and whether the
+  // trace is written is decided once the request completes.
   uint64_t s = sample_.fetch_add(1);
-  if ((s % rate_) != 0) {
+  const bool sampled = ((s % rate_) == 0);
+  if (!sampled && !tail_sampling_) {
     return nullptr;
   }
 
-  Tracer* tracer = new Tracer(shared_from_this(), level_);
+  Tracer* tracer = new Tracer(shared_from_this(), level_, sampled);
 
   TRTSERVER_Trace* trace = nullptr;
   TRTSERVER_Error* err = TRTSERVER_TraceNew(
@@ -149,22 +349,130 @@ TraceManager::WriteTrace(const std::stringstream& ss)
   trace_cnt_++;
 }
 
+void
+TraceManager::WriteBinaryTrace(const std::string& record)
+{
+  if (!ThreadRing()->Write(record)) {
+    dropped_cnt_++;
+  }
+}
+
+TraceRing*
+TraceManager::ThreadRing()
+{
+  // The ring is owned by the manager so a thread that exits leaves
+  // its records to be flushed. 'id_' rather than the manager address
+  // identifies the manager so that a ring of a destroyed manager is
+  // never reused.
+  struct ThreadRingCache {
+    uint64_t manager_id_;
+    TraceRing* ring_;
+  };
+  static thread_local ThreadRingCache cache{0, nullptr};
+
+  if (cache.manager_id_ != id_) {
+    std::lock_guard<std::mutex> lock(rings_mu_);
+    rings_.emplace_back(new TraceRing(kTraceRingByteSize));
+    cache.manager_id_ = id_;
+    cache.ring_ = rings_.back().get();
+  }
+
+  return cache.ring_;
+}
+
+void
+TraceManager::FlushThread()
+{
+  std::unique_lock<std::mutex> lock(flush_mu_);
+  while (!flush_exit_) {
+    flush_cv_.wait_for(lock, kTraceFlushInterval);
+    DrainRings();
+  }
+}
+
+void
+TraceManager::DrainRings()
+{
+  std::lock_guard<std::mutex> lock(rings_mu_);
+  for (auto& ring : rings_) {
+    ring->Drain(trace_file_.get());
+  }
+  trace_file_->flush();
+}
+
 Tracer::Tracer(
-    const std::shared_ptr<TraceManager>& manager, TRTSERVER_Trace_Level level)
-    : manager_(manager), level_(level), model_version_(-1), timestamp_cnt_(0)
+    const std::shared_ptr<TraceManager>& manager, TRTSERVER_Trace_Level level,
+    bool sampled)
+    : manager_(manager), level_(level), model_version_(-1), sampled_(sampled),
+      failed_(false)
 {
-  tout_ << "{ \"timestamps\": [";
 }
 
 Tracer::~Tracer()
 {
-  tout_ << "], \"model_name\": \"" << model_name_
-        << "\", \"model_version\": " << model_version_ << " }";
-  manager_->WriteTrace(tout_);
+  uint64_t first_ns = std::numeric_limits<uint64_t>::max();
+  uint64_t last_ns = 0;
+  for (const auto& timestamp : timestamps_) {
+    first_ns = std::min(first_ns, timestamp.second);
+    last_ns = std::max(last_ns, timestamp.second);
+  }
+  const uint64_t latency_ns = (last_ns > first_ns) ? (last_ns - first_ns) : 0;
+
+  if (manager_->KeepTrace(model_name_, latency_ns, failed_, sampled_)) {
+    if (manager_->TraceFormat() == TraceManager::Format::BINARY) {
+      WriteBinary();
+    } else {
+      WriteJson();
+    }
+  }
 
   LOG_IF_ERR(TRTSERVER_TraceDelete(trace_), "deleting trace");
 }
 
+void
+Tracer::WriteBinary()
+{
+  std::string bout;
+  for (const auto& timestamp : timestamps_) {
+    AppendBinaryString(&bout, timestamp.first);
+    AppendBinary(&bout, timestamp.second);
+  }
+
+  // A record is its byte size followed by the model version, the
+  // model name, the timestamp count and the timestamps each as a
+  // name and a nanosecond time.
+  std::string record;
+  record.reserve(
+      3 * sizeof(uint32_t) + sizeof(int64_t) + model_name_.size() +
+      bout.size());
+  AppendBinary(
+      &record, static_cast<uint32_t>(
+                   2 * sizeof(uint32_t) + sizeof(int64_t) +
+                   model_name_.size() + bout.size()));
+  AppendBinary(&record, model_version_);
+  AppendBinaryString(&record, model_name_);
+  AppendBinary(&record, static_cast<uint32_t>(timestamps_.size()));
+  record.append(bout);
+  manager_->WriteBinaryTrace(record);
+}
+
+void
+Tracer::WriteJson()
+{
+  std::stringstream tout;
+  tout << "{ \"timestamps\": [";
+  for (size_t i = 0; i < timestamps_.size(); ++i) {
+    if (i != 0) {
+      tout << ",";
+    }
+    tout << "{\"name\":\"" << timestamps_[i].first
+         << "\", \"ns\":" << timestamps_[i].second << "}";
+  }
+  tout << "], \"model_name\": \"" << model_name_
+       << "\", \"model_version\": " << model_version_ << " }";
+  manager_->WriteTrace(tout);
+}
+
 void
 Tracer::CaptureTimestamp(
     TRTSERVER_Trace_Level level, const std::string& name, uint64_t timestamp_ns)
@@ -176,12 +484,7 @@ Tracer::CaptureTimestamp(
       timestamp_ns = TIMESPEC_TO_NANOS(ts);
     }
 
-    if (timestamp_cnt_ != 0) {
-      tout_ << ",";
-    }
-
-    tout_ << "{\"name\":\"" << name << "\", \"ns\":" << timestamp_ns << "}";
-    timestamp_cnt_++;
+    timestamps_.emplace_back(name, timestamp_ns);
   }
 }
 
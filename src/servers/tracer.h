@@ -26,26 +26,62 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
 #include <fstream>
 #include <memory>
 #include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include "src/core/trtserver.h"
 
 namespace nvidia { namespace inferenceserver {
 
 class Tracer;
 
+//
+// A single-producer single-consumer ring buffer of binary trace
+// records. One thread appends records and the flush thread drains
+// them, without either taking a lock.
+//
+class TraceRing {
+ public:
+  explicit TraceRing(size_t byte_size);
+
+  // Append 'record'. Return false if the ring doesn't have room for
+  // it, in which case the record is dropped.
+  bool Write(const std::string& record);
+
+  // Write the records appended so far to 'out'.
+  void Drain(std::ostream* out);
+
+ private:
+  std::vector<char> buffer_;
+
+  // Total number of bytes appended and drained. Only the writer
+  // advances 'head_' and only the flush thread advances 'tail_'.
+  std::atomic<uint64_t> head_;
+  std::atomic<uint64_t> tail_;
+};
+
 //
 // Manager for tracing to a file.
 //
 class TraceManager : public std::enable_shared_from_this<TraceManager> {
  public:
+  // The format of the trace file. JSON writes each trace as a JSON
+  // object under a lock. BINARY appends each trace as a binary record
+  // to a per-thread ring buffer that a background thread flushes to
+  // the file, see qa/common/trace_convert.py for the record layout.
+  enum class Format { JSON, BINARY };
+
   // Create a trace manager that appends trace information
   // to a specified file.
   static TRTSERVER_Error* Create(
-      std::shared_ptr<TraceManager>* manager, const std::string& filepath);
+      std::shared_ptr<TraceManager>* manager, const std::string& filepath,
+      const Format format = Format::JSON);
 
   ~TraceManager();
 
@@ -53,26 +89,98 @@ class TraceManager : public std::enable_shared_from_this<TraceManager> {
   TRTSERVER_Error* SetLevel(TRTSERVER_Trace_Level level);
   TRTSERVER_Error* SetRate(uint32_t rate);
 
+  // Enable tail-based sampling. Every request is traced but a trace
+  // is only written if the request is selected by the sampling rate,
+  // if it failed, or if its latency exceeds the threshold of its
+  // model. 'latency_thresholds_us' maps a model name to its threshold
+  // in microseconds, the threshold of the empty name applies to the
+  // models not in the map. If 'percentile' is non-zero the threshold
+  // of a model without one is the 'percentile' latency of its recent
+  // requests.
+  TRTSERVER_Error* SetTailSampling(
+      const std::unordered_map<std::string, uint64_t>& latency_thresholds_us,
+      double percentile);
+
   // Return a trace object that should be used to collected trace
   // activities for an inference request. Return nullptr if no tracing
   // should occur.
   Tracer* SampleTrace();
 
+  // Return the format of the trace file.
+  Format TraceFormat() const { return format_; }
+
   // Write to the trace file.
   void WriteTrace(const std::stringstream& ss);
 
+  // Queue a binary trace record to be written to the trace file.
+  void WriteBinaryTrace(const std::string& record);
+
+  // Return true if the trace of a completed request should be
+  // written. 'latency_ns' is the time between the first and the last
+  // timestamp of the trace and 'sampled' is true if the request was
+  // selected by the sampling rate.
+  bool KeepTrace(
+      const std::string& model_name, uint64_t latency_ns, bool failed,
+      bool sampled);
+
  private:
-  TraceManager(std::unique_ptr<std::ofstream> trace_file);
+  // The latencies of the most recent requests of a model, used to
+  // derive the threshold of tail-based sampling by percentile.
+  struct TailLatencies {
+    TailLatencies();
+
+    std::vector<uint64_t> latencies_ns_;
+    size_t next_;
+    size_t update_cnt_;
+    uint64_t threshold_ns_;
+  };
+
+  TraceManager(std::unique_ptr<std::ofstream> trace_file, const Format format);
+
+  static uint64_t NextId();
+
+  // Return the ring buffer of the calling thread, creating it on
+  // first use.
+  TraceRing* ThreadRing();
+
+  // Periodically drain the ring buffers into the trace file until
+  // the manager is destroyed.
+  void FlushThread();
+  void DrainRings();
 
   std::mutex mu_;
   std::unique_ptr<std::ofstream> trace_file_;
   uint32_t trace_cnt_;
 
+  const Format format_;
+
+  // Identifies the manager to the thread-local ring lookup.
+  const uint64_t id_;
+
+  // The ring buffers of the threads that have written binary
+  // traces. 'rings_mu_' is only held to add a ring and while draining.
+  std::mutex rings_mu_;
+  std::vector<std::unique_ptr<TraceRing>> rings_;
+  std::atomic<uint64_t> dropped_cnt_;
+
+  std::mutex flush_mu_;
+  std::condition_variable flush_cv_;
+  bool flush_exit_;
+  std::thread flush_thread_;
+
   TRTSERVER_Trace_Level level_;
   uint32_t rate_;
 
   // Atomically incrementing counter used to implement sampling rate.
   std::atomic<uint64_t> sample_;
+
+  // Tail-based sampling configuration, set before any request is
+  // traced, and the recent latencies of each model.
+  bool tail_sampling_;
+  std::unordered_map<std::string, uint64_t> tail_thresholds_ns_;
+  double tail_percentile_;
+  std::mutex tail_mu_;
+  std::unordered_map<std::string, TailLatencies> tail_latencies_;
 };
 
 //
@@ -82,7 +190,7 @@ class Tracer {
  public:
   Tracer(
       const std::shared_ptr<TraceManager>& manager,
-      TRTSERVER_Trace_Level level);
+      TRTSERVER_Trace_Level level, bool sampled);
   ~Tracer();
 
   static void TraceActivity(
@@ -98,6 +206,10 @@ class Tracer {
   void SetServerTrace(TRTSERVER_Trace* trace) { trace_ = trace; }
   TRTSERVER_Trace* ServerTrace() const { return trace_; }
 
+  // Mark the request as failed, which always writes its trace when
+  // tail-based sampling is enabled.
+  void SetFailed() { failed_ = true; }
+
   // Capture a named timestamp using a nanosecond precision time. If
   // the time is not given (or is given as zero) then the current time
   // will be used.
@@ -106,14 +218,23 @@ class Tracer {
       uint64_t timestamp_ns = 0);
 
  private:
+  // Write the trace to the trace file of the manager.
+  void WriteBinary();
+  void WriteJson();
+
   std::shared_ptr<TraceManager> manager_;
   const TRTSERVER_Trace_Level level_;
 
   std::string model_name_;
   int64_t model_version_;
 
-  std::stringstream tout_;
-  uint32_t timestamp_cnt_;
+  // The captured timestamps, only formatted when the trace is
+  // written so that the traces discarded by tail-based sampling are
+  // cheap.
+  std::vector<std::pair<std::string, uint64_t>> timestamps_;
+
+  const bool sampled_;
+  bool failed_;
 
   TRTSERVER_Trace* trace_;
 };